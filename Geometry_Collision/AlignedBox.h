@@ -13,7 +13,7 @@
 
 namespace Vector_GM
 {
-    template <int32_t N, typename T>
+    template <typename T, size_t N>
     class AlignedBox
     {
     public:
@@ -23,7 +23,7 @@ namespace Vector_GM
         {
             T const negOne = static_cast<T>(-1);
             T const one = static_cast<T>(1);
-            for (int32_t i = 0; i < N; ++i)
+            for (size_t i = 0; i < N; ++i)
             {
                 min[i] = negOne;
                 max[i] = one;
@@ -31,9 +31,9 @@ namespace Vector_GM
         }
 
         // Please ensure that inMin[i] <= inMax[i] for all i.
-        AlignedBox(Vector<N, T> const& inMin, Vector<N, T> const& inMax)
+        AlignedBox(Vector<T, N> const& inMin, Vector<T, N> const& inMax)
         {
-            for (int32_t i = 0; i < N; ++i)
+            for (size_t i = 0; i < N; ++i)
             {
                 min[i] = inMin[i];
                 max[i] = inMax[i];
@@ -44,7 +44,7 @@ namespace Vector_GM
         // and maximum values, compute C and extents, and then recompute the
         // minimum and maximum values, the numerical round-off errors can lead
         // to results different from what you started with.
-        void GetCenteredForm(Vector<N, T>& center, Vector<N, T>& extent) const
+        void GetCenteredForm(Vector<T, N>& center, Vector<T, N>& extent) const
         {
             T const half = static_cast<T>(0.5);
             center = (max + min) * half;
@@ -55,12 +55,12 @@ namespace Vector_GM
         // i = b[N-1]...b[0], then the corner at index i is vertex[i], where
         // vertex[i][d] = min[d] whern b[d] = 0 or vertex[i][d = max[d] when
         // b[d] = 1.
-        void GetVertices(std::array<Vector<N, T>, (1 << N)>& vertex) const
+        void GetVertices(std::array<Vector<T, N>, (size_t(1) << N)>& vertex) const
         {
-            int32_t const imax = (1 << N);
-            for (int32_t i = 0; i < imax; ++i)
+            size_t const imax = (size_t(1) << N);
+            for (size_t i = 0; i < imax; ++i)
             {
-                for (int32_t d = 0, mask = 1; d < N; ++d, mask <<= 1)
+                for (size_t d = 0, mask = 1; d < N; ++d, mask <<= 1)
                 {
                     if ((i & mask) > 0)
                     {
@@ -75,7 +75,7 @@ namespace Vector_GM
         }
 
         // Public member access.  It is required that min[i] <= max[i].
-        Vector<N, T> min, max;
+        Vector<T, N> min, max;
 
     public:
         // Comparisons to support sorted containers.
@@ -122,9 +122,9 @@ namespace Vector_GM
 
     // Template aliases for convenience.
     template <typename T>
-    using AlignedBox2 = AlignedBox<2, T>;
+    using AlignedBox2 = AlignedBox<T, 2>;
 
     template <typename T>
-    using AlignedBox3 = AlignedBox<3, T>;
+    using AlignedBox3 = AlignedBox<T, 3>;
 }
 
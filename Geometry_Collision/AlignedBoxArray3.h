@@ -0,0 +1,68 @@
+#pragma once
+
+#include "AlignedBox.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure-of-arrays storage for the batched aligned-box queries. Each
+// coordinate of the minimum and maximum corners has its own contiguous
+// array, so the query loops load consecutive boxes with unit stride.
+
+namespace Vector_GM
+{
+    // A set of aligned boxes in structure-of-arrays form.
+    template <typename T>
+    class AlignedBoxArray3
+    {
+    public:
+        AlignedBoxArray3() = default;
+
+        inline size_t size() const
+        {
+            return min[0].size();
+        }
+
+        void Clear()
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                min[d].clear();
+                max[d].clear();
+            }
+        }
+
+        void Reserve(size_t numBoxes)
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                min[d].reserve(numBoxes);
+                max[d].reserve(numBoxes);
+            }
+        }
+
+        // Please ensure that box.min[d] <= box.max[d] for all d.
+        void Push(AlignedBox3<T> const& box)
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                min[d].push_back(box.min[d]);
+                max[d].push_back(box.max[d]);
+            }
+        }
+
+        AlignedBox3<T> Get(size_t i) const
+        {
+            AlignedBox3<T> box{};
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                box.min[d] = min[d][i];
+                box.max[d] = max[d][i];
+            }
+            return box;
+        }
+
+        std::array<std::vector<T>, 3> min, max;
+    };
+}
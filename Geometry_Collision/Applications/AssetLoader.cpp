@@ -0,0 +1,401 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Applications/GTApplicationsPCH.h>
+#include <Applications/AssetLoader.h>
+#include <Applications/WICFileIO.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+using namespace gte;
+
+namespace
+{
+    // Read one byte of each page so that the operating system pages in the
+    // data of a file mapping.
+    void TouchPages(char const* data, size_t numBytes)
+    {
+        if (data && numBytes > 0)
+        {
+            char sum = data[numBytes - 1];
+            for (size_t i = 0; i < numBytes; i += 4096)
+            {
+                sum ^= data[i];
+            }
+            volatile char sink = sum;
+            (void)sink;
+        }
+    }
+}
+
+AssetLoader::AssetLoader(uint32_t numThreads)
+    :
+    mNextTask(1),
+    mStop(false)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    mThreads.reserve(numThreads);
+    for (uint32_t t = 0; t < numThreads; ++t)
+    {
+        mThreads.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+AssetLoader::~AssetLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+        mWorkerQueue.clear();
+        mMainQueue.clear();
+    }
+    mWorkerWake.notify_all();
+
+    for (auto& thread : mThreads)
+    {
+        thread.join();
+    }
+}
+
+AssetLoader::Task AssetLoader::Run(std::function<void()> const& work,
+    std::vector<Task> const& dependencies)
+{
+    return Add(work, false, dependencies);
+}
+
+AssetLoader::Task AssetLoader::RunOnMain(std::function<void()> const& work,
+    std::vector<Task> const& dependencies)
+{
+    return Add(work, true, dependencies);
+}
+
+AssetLoader::Task AssetLoader::LoadTexture(std::string const& filename, bool wantMipmaps,
+    std::function<void(std::shared_ptr<Texture2> const&)> const& onLoaded,
+    std::vector<Task> const& dependencies)
+{
+    auto texture = std::make_shared<std::shared_ptr<Texture2>>();
+    Task decode = Run([texture, filename, wantMipmaps]()
+        {
+            *texture = WICFileIO::Load(filename, wantMipmaps);
+        },
+        dependencies);
+
+    return RunOnMain([texture, onLoaded]() { onLoaded(*texture); }, { decode });
+}
+
+AssetLoader::Task AssetLoader::LoadProgram(std::shared_ptr<ProgramFactory> const& factory,
+    std::string const& vsFile, std::string const& psFile, std::string const& gsFile,
+    std::function<void(std::shared_ptr<VisualProgram> const&)> const& onCreated,
+    std::vector<Task> const& dependencies)
+{
+    // The checks of ProgramFactory::CreateFromFiles.
+    auto sources = std::make_shared<std::array<std::string, 3>>();
+    std::array<std::string, 3> const files{ vsFile, psFile, gsFile };
+    Task read = Run([sources, files]()
+        {
+            for (size_t i = 0; i < 3; ++i)
+            {
+                if (files[i] != "")
+                {
+                    (*sources)[i] = ProgramFactory::GetStringFromFile(files[i]);
+                    LogAssert((*sources)[i] != "", "Empty shader source string: " + files[i]);
+                }
+                else
+                {
+                    LogAssert(i == 2, "A program must have vertex and pixel shaders.");
+                }
+            }
+        },
+        dependencies);
+
+    return RunOnMain([factory, sources, onCreated]()
+        {
+            onCreated(factory->CreateFromSources((*sources)[0], (*sources)[1], (*sources)[2]));
+        },
+        { read });
+}
+
+AssetLoader::Task AssetLoader::LoadMesh(MeshCache const& cache, uint64_t key,
+    std::function<void(std::shared_ptr<Visual> const&)> const& onLoaded,
+    std::vector<Task> const& dependencies)
+{
+    auto visual = std::make_shared<std::shared_ptr<Visual>>();
+    Task load = Run([visual, cache, key]()
+        {
+            *visual = cache.Load(key);
+            if (*visual)
+            {
+                auto const& vbuffer = (*visual)->GetVertexBuffer();
+                auto const& ibuffer = (*visual)->GetIndexBuffer();
+                TouchPages(vbuffer->GetData(), vbuffer->GetNumBytes());
+                if (ibuffer)
+                {
+                    TouchPages(ibuffer->GetData(), ibuffer->GetNumBytes());
+                }
+            }
+        },
+        dependencies);
+
+    return RunOnMain([visual, onLoaded]() { onLoaded(*visual); }, { load });
+}
+
+size_t AssetLoader::Poll(double maxSeconds)
+{
+    RethrowFailure();
+
+    auto const start = std::chrono::steady_clock::now();
+    size_t numExecuted = 0;
+    while (ExecuteMain())
+    {
+        ++numExecuted;
+        RethrowFailure();
+
+        double const elapsed = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - start).count();
+        if (elapsed >= maxSeconds)
+        {
+            break;
+        }
+    }
+    return numExecuted;
+}
+
+void AssetLoader::Wait(Task task)
+{
+    for (;;)
+    {
+        RethrowFailure();
+        if (IsDone(task))
+        {
+            return;
+        }
+
+        if (!ExecuteMain())
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mMainWake.wait(lock, [this, task]()
+            {
+                return !mMainQueue.empty() || mFailure || mNodes.find(task) == mNodes.end();
+            });
+        }
+    }
+}
+
+void AssetLoader::WaitAll()
+{
+    for (;;)
+    {
+        RethrowFailure();
+        if (GetNumPending() == 0)
+        {
+            return;
+        }
+
+        if (!ExecuteMain())
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mMainWake.wait(lock, [this]()
+            {
+                return !mMainQueue.empty() || mFailure || mNodes.empty();
+            });
+        }
+    }
+}
+
+bool AssetLoader::IsDone(Task task) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return task < mNextTask && mNodes.find(task) == mNodes.end();
+}
+
+size_t AssetLoader::GetNumPending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNodes.size();
+}
+
+AssetLoader::Task AssetLoader::Add(std::function<void()> const& work, bool onMain,
+    std::vector<Task> const& dependencies)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    Task const task = mNextTask++;
+
+    // A task that depends on a failed task is never executed.
+    Node node{ work, onMain, 0, {} };
+    for (auto dependency : dependencies)
+    {
+        if (mFailed.find(dependency) != mFailed.end())
+        {
+            mFailed.insert(task);
+            return task;
+        }
+    }
+
+    for (auto dependency : dependencies)
+    {
+        auto iter = mNodes.find(dependency);
+        if (iter != mNodes.end())
+        {
+            iter->second.dependents.push_back(task);
+            ++node.numWaiting;
+        }
+    }
+
+    auto const& added = mNodes.emplace(task, std::move(node)).first->second;
+    if (added.numWaiting == 0)
+    {
+        Enqueue(task, added);
+    }
+    return task;
+}
+
+void AssetLoader::Complete(Task task, std::exception_ptr const& failure)
+{
+    auto iter = mNodes.find(task);
+    std::vector<Task> dependents = std::move(iter->second.dependents);
+    mNodes.erase(iter);
+
+    if (failure)
+    {
+        if (!mFailure)
+        {
+            mFailure = failure;
+        }
+        mFailed.insert(task);
+        for (auto dependent : dependents)
+        {
+            Discard(dependent);
+        }
+    }
+    else
+    {
+        for (auto dependent : dependents)
+        {
+            auto node = mNodes.find(dependent);
+            if (node != mNodes.end() && --node->second.numWaiting == 0)
+            {
+                Enqueue(dependent, node->second);
+            }
+        }
+    }
+
+    // Wake the main thread also when no main-thread task became ready,
+    // because Wait and WaitAll test for completed tasks.
+    mMainWake.notify_all();
+}
+
+void AssetLoader::Discard(Task task)
+{
+    // A discarded task is waiting for a dependency, so it is in no queue.
+    auto iter = mNodes.find(task);
+    if (iter != mNodes.end())
+    {
+        std::vector<Task> dependents = std::move(iter->second.dependents);
+        mNodes.erase(iter);
+        mFailed.insert(task);
+        for (auto dependent : dependents)
+        {
+            Discard(dependent);
+        }
+    }
+}
+
+void AssetLoader::Enqueue(Task task, Node const& node)
+{
+    if (node.onMain)
+    {
+        mMainQueue.push_back(task);
+        mMainWake.notify_all();
+    }
+    else
+    {
+        mWorkerQueue.push_back(task);
+        mWorkerWake.notify_one();
+    }
+}
+
+bool AssetLoader::ExecuteMain()
+{
+    std::function<void()> work;
+    Task task = 0;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        if (mMainQueue.empty())
+        {
+            return false;
+        }
+        task = mMainQueue.front();
+        mMainQueue.pop_front();
+        work = std::move(mNodes[task].work);
+    }
+
+    std::exception_ptr failure;
+    try
+    {
+        work();
+    }
+    catch (...)
+    {
+        failure = std::current_exception();
+    }
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    Complete(task, failure);
+    return true;
+}
+
+void AssetLoader::RethrowFailure()
+{
+    std::exception_ptr failure;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::swap(failure, mFailure);
+    }
+
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+void AssetLoader::WorkerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> work;
+        Task task = 0;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mWorkerWake.wait(lock, [this]() { return mStop || !mWorkerQueue.empty(); });
+            if (mStop)
+            {
+                return;
+            }
+            task = mWorkerQueue.front();
+            mWorkerQueue.pop_front();
+            work = std::move(mNodes[task].work);
+        }
+
+        std::exception_ptr failure;
+        try
+        {
+            work();
+        }
+        catch (...)
+        {
+            failure = std::current_exception();
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        Complete(task, failure);
+    }
+}
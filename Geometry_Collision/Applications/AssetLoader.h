@@ -0,0 +1,174 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Applications/MeshCache.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/Texture2.h>
+#include <Graphics/Visual.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Asynchronous loading of the assets of an application, so that the file
+// reads, the image decoding and the paging of cached meshes overlap each
+// other and the startup of the application instead of running one after
+// the other in the constructor of the window. The work is a graph of
+// tasks. A task runs after the tasks it depends on have completed, either
+// on a pool of worker threads or on the main thread. The main-thread tasks
+// are those that use the graphics engine or the scene: the creation of
+// programs, which with OpenGL requires the context of the main thread and
+// which looks up the program cache of the factory, the upload of buffers
+// and textures and the attachment of the loaded objects to the scene. They
+// are executed by Poll, which the window calls in OnIdle with a time
+// budget, so the window draws the objects that are loaded while the
+// loading continues.
+//
+//   mLoader = std::make_unique<AssetLoader>();
+//   mLoader->LoadTexture(mEnvironment.GetPath("Floor.png"), true,
+//       [this](std::shared_ptr<Texture2> const& texture)
+//       {
+//           <create the floor effect and visual, attach it to mScene>
+//       });
+//
+//   void OnIdle()
+//   {
+//       mLoader->Poll(0.004);
+//       <draw the objects that exist>
+//   }
+//
+// A task that throws an exception fails. The tasks that depend on it are
+// not executed, and the next call of Poll or Wait rethrows the exception on
+// the main thread. The main thread is the one that calls Poll and Wait;
+// worker tasks must not use the graphics engine.
+
+namespace gte
+{
+    class AssetLoader
+    {
+    public:
+        // The identifier of a task, which is never 0.
+        using Task = uint64_t;
+
+        // The number of worker threads. When it is 0, the loader uses one
+        // thread less than the hardware has, but at least one.
+        AssetLoader(uint32_t numThreads = 0);
+
+        // The tasks that have not started are discarded. The destructor
+        // waits for the worker tasks that are running.
+        ~AssetLoader();
+
+        // Disallow copy and assignment.
+        AssetLoader(AssetLoader const&) = delete;
+        AssetLoader& operator=(AssetLoader const&) = delete;
+
+        inline uint32_t GetNumThreads() const
+        {
+            return static_cast<uint32_t>(mThreads.size());
+        }
+
+        // Add a task that runs on a worker thread, or on the main thread in
+        // Poll or Wait, after the dependencies have completed. Completed
+        // dependencies and the value 0 are allowed.
+        Task Run(std::function<void()> const& work,
+            std::vector<Task> const& dependencies = {});
+
+        Task RunOnMain(std::function<void()> const& work,
+            std::vector<Task> const& dependencies = {});
+
+        // Decode an image file with WICFileIO on a worker thread and pass
+        // the texture to 'onLoaded' on the main thread.
+        Task LoadTexture(std::string const& filename, bool wantMipmaps,
+            std::function<void(std::shared_ptr<Texture2> const&)> const& onLoaded,
+            std::vector<Task> const& dependencies = {});
+
+        // Read the shader files on a worker thread and create the program
+        // with factory->CreateFromSources on the main thread, using the
+        // program cache of the factory when it has one. The program is
+        // passed to 'onCreated'. The geometry shader file is empty for a
+        // program without a geometry shader. The sources are compiled
+        // without their filenames, so shaders that #include other files
+        // must be created by CreateFromFiles in a RunOnMain task.
+        Task LoadProgram(std::shared_ptr<ProgramFactory> const& factory,
+            std::string const& vsFile, std::string const& psFile, std::string const& gsFile,
+            std::function<void(std::shared_ptr<VisualProgram> const&)> const& onCreated,
+            std::vector<Task> const& dependencies = {});
+
+        // Load a mesh from the cache on a worker thread, which also reads
+        // every page of its buffers so that the upload does not wait for the
+        // disk, and pass it to 'onLoaded' on the main thread. The visual is
+        // null when the cache has no valid file for the key.
+        Task LoadMesh(MeshCache const& cache, uint64_t key,
+            std::function<void(std::shared_ptr<Visual> const&)> const& onLoaded,
+            std::vector<Task> const& dependencies = {});
+
+        // Execute the main-thread tasks that are ready, until the queue is
+        // empty or 'maxSeconds' have elapsed; at least one task is executed
+        // when one is ready. The function returns the number of tasks
+        // executed. A budget of a few milliseconds per frame keeps the
+        // window responsive while the loading continues.
+        size_t Poll(double maxSeconds = 0.004);
+
+        // Execute main-thread tasks until the task has completed, or has
+        // been discarded because a dependency failed. Call this for assets
+        // that the application cannot run without.
+        void Wait(Task task);
+
+        // Execute main-thread tasks until all tasks have completed.
+        void WaitAll();
+
+        bool IsDone(Task task) const;
+
+        // The number of tasks that have not completed.
+        size_t GetNumPending() const;
+
+    private:
+        struct Node
+        {
+            std::function<void()> work;
+            bool onMain;
+            size_t numWaiting;
+            std::vector<Task> dependents;
+        };
+
+        Task Add(std::function<void()> const& work, bool onMain,
+            std::vector<Task> const& dependencies);
+
+        // Remove the completed task and queue the dependents that are
+        // ready. When the task failed, its dependents are discarded.
+        // The caller holds the lock.
+        void Complete(Task task, std::exception_ptr const& failure);
+        void Discard(Task task);
+        void Enqueue(Task task, Node const& node);
+
+        // Execute one ready main-thread task. The function returns false
+        // when none is ready.
+        bool ExecuteMain();
+        void RethrowFailure();
+        void WorkerLoop();
+
+        mutable std::mutex mMutex;
+        std::condition_variable mWorkerWake, mMainWake;
+        std::unordered_map<Task, Node> mNodes;
+        std::unordered_set<Task> mFailed;
+        std::deque<Task> mWorkerQueue, mMainQueue;
+        std::exception_ptr mFailure;
+        Task mNextTask;
+        bool mStop;
+        std::vector<std::thread> mThreads;
+    };
+}
@@ -0,0 +1,88 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Applications/GTApplicationsPCH.h>
+#include <Applications/FileMapping.h>
+#if defined(GTE_USE_MSWINDOWS)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(GTE_USE_LINUX)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+using namespace gte;
+
+FileMapping::FileMapping(std::string const& filename)
+    :
+    mData(nullptr),
+    mSize(0)
+{
+#if defined(GTE_USE_MSWINDOWS)
+    HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ,
+        FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    LARGE_INTEGER size;
+    if (::GetFileSizeEx(file, &size) && size.QuadPart > 0)
+    {
+        HANDLE mapping = ::CreateFileMappingA(file, nullptr,
+            PAGE_WRITECOPY, 0, 0, nullptr);
+        if (mapping)
+        {
+            mData = static_cast<char*>(::MapViewOfFile(mapping,
+                FILE_MAP_COPY, 0, 0, 0));
+            if (mData)
+            {
+                mSize = static_cast<uint64_t>(size.QuadPart);
+            }
+            ::CloseHandle(mapping);
+        }
+    }
+    ::CloseHandle(file);
+#elif defined(GTE_USE_LINUX)
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return;
+    }
+
+    struct stat status;
+    if (::fstat(fd, &status) == 0 && status.st_size > 0)
+    {
+        void* data = ::mmap(nullptr, static_cast<size_t>(status.st_size),
+            PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED)
+        {
+            mData = static_cast<char*>(data);
+            mSize = static_cast<uint64_t>(status.st_size);
+        }
+    }
+    ::close(fd);
+#else
+    (void)filename;
+#endif
+}
+
+FileMapping::~FileMapping()
+{
+    if (mData)
+    {
+#if defined(GTE_USE_MSWINDOWS)
+        ::UnmapViewOfFile(mData);
+#elif defined(GTE_USE_LINUX)
+        ::munmap(mData, static_cast<size_t>(mSize));
+#endif
+    }
+}
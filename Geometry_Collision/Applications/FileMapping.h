@@ -0,0 +1,45 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+// A view of an entire file mapped copy-on-write into the address space, so
+// the data may be modified without changing the file. The start of the
+// view is aligned to a page. If the file cannot be opened or is empty,
+// GetData() returns nullptr.
+
+namespace gte
+{
+    class FileMapping
+    {
+    public:
+        FileMapping(std::string const& filename);
+        ~FileMapping();
+
+        // Disallow copy and assignment.
+        FileMapping(FileMapping const&) = delete;
+        FileMapping& operator=(FileMapping const&) = delete;
+
+        // Member access.
+        inline char* GetData() const
+        {
+            return mData;
+        }
+
+        inline uint64_t GetSize() const
+        {
+            return mSize;
+        }
+
+    private:
+        char* mData;
+        uint64_t mSize;
+    };
+}
@@ -0,0 +1,125 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Applications/GTApplicationsPCH.h>
+#include <Applications/FixedStepScheduler.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cmath>
+using namespace gte;
+
+FixedStepScheduler::FixedStepScheduler(double stepSize, uint32_t maxStepsPerFrame,
+    double maxFrameTime)
+    :
+    mStepSize(0.0),
+    mMaxFrameTime(0.0),
+    mMaxStepsPerFrame(0),
+    mNumRequestedSteps(0),
+    mPaused(false),
+    mAccumulator(0.0),
+    mSimulationTime(0.0),
+    mDroppedTime(0.0),
+    mNumSteps(0)
+{
+    SetStepSize(stepSize);
+    SetMaxStepsPerFrame(maxStepsPerFrame);
+    SetMaxFrameTime(maxFrameTime);
+    Reset();
+}
+
+void FixedStepScheduler::Reset()
+{
+    mNumRequestedSteps = 0;
+    mAccumulator = 0.0;
+    mSimulationTime = 0.0;
+    mDroppedTime = 0.0;
+    mNumSteps = 0;
+    mLastTime = Clock::now();
+}
+
+void FixedStepScheduler::SetStepSize(double stepSize)
+{
+    LogAssert(stepSize > 0.0, "The step size must be positive.");
+    mStepSize = stepSize;
+    mAccumulator = std::min(mAccumulator, mStepSize);
+}
+
+void FixedStepScheduler::SetMaxStepsPerFrame(uint32_t maxStepsPerFrame)
+{
+    LogAssert(maxStepsPerFrame > 0, "At least one step per frame is required.");
+    mMaxStepsPerFrame = maxStepsPerFrame;
+}
+
+void FixedStepScheduler::SetMaxFrameTime(double maxFrameTime)
+{
+    LogAssert(maxFrameTime > 0.0, "The maximum frame time must be positive.");
+    mMaxFrameTime = maxFrameTime;
+}
+
+void FixedStepScheduler::SetPaused(bool paused)
+{
+    if (mPaused && !paused)
+    {
+        mLastTime = Clock::now();
+    }
+    mPaused = paused;
+}
+
+double FixedStepScheduler::GetTimeToNextStep() const
+{
+    double const elapsedTime = std::chrono::duration<double>(Clock::now() - mLastTime).count();
+    return std::max(mStepSize - mAccumulator - elapsedTime, 0.0);
+}
+
+uint32_t FixedStepScheduler::Advance(Step const& step)
+{
+    Clock::time_point const now = Clock::now();
+    double const elapsedTime = std::chrono::duration<double>(now - mLastTime).count();
+    mLastTime = now;
+    return Advance(elapsedTime, step);
+}
+
+uint32_t FixedStepScheduler::Advance(double elapsedTime, Step const& step)
+{
+    uint32_t numSteps = 0;
+    for (; mNumRequestedSteps > 0; --mNumRequestedSteps, ++numSteps)
+    {
+        step(mSimulationTime, mStepSize);
+        mSimulationTime += mStepSize;
+        ++mNumSteps;
+    }
+
+    if (mPaused)
+    {
+        return numSteps;
+    }
+
+    if (elapsedTime > mMaxFrameTime)
+    {
+        mDroppedTime += elapsedTime - mMaxFrameTime;
+        elapsedTime = mMaxFrameTime;
+    }
+    mAccumulator += std::max(elapsedTime, 0.0);
+
+    for (uint32_t i = 0; i < mMaxStepsPerFrame && mAccumulator >= mStepSize; ++i, ++numSteps)
+    {
+        step(mSimulationTime, mStepSize);
+        mSimulationTime += mStepSize;
+        mAccumulator -= mStepSize;
+        ++mNumSteps;
+    }
+
+    // The backlog that the steps of this call could not absorb is
+    // discarded, except for the fraction of a step that GetAlpha reports.
+    if (mAccumulator >= mStepSize)
+    {
+        double const remainder = std::fmod(mAccumulator, mStepSize);
+        mDroppedTime += mAccumulator - remainder;
+        mAccumulator = remainder;
+    }
+    return numSteps;
+}
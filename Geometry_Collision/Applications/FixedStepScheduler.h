@@ -0,0 +1,132 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+// A scheduler of fixed time steps for simulations that are driven by a
+// loop of variable-length frames. Each call to Advance adds the elapsed
+// wall-clock time to an accumulator and executes as many steps of the
+// fixed size as the accumulator holds, so the simulation sees the same
+// sequence of step sizes however the frames are timed. A renderer draws the
+// state interpolated between the last two steps using GetAlpha.
+//
+// When a step costs more than its size, the accumulator grows without
+// bound (the "spiral of death"). To prevent this, at most maxStepsPerFrame
+// steps are executed per call and the elapsed time of a call is clamped to
+// maxFrameTime; the time that does not fit is discarded and reported by
+// GetDroppedTime. The simulation then runs slower than real time.
+//
+// While paused, the elapsed time is ignored and only the steps requested
+// by RequestSteps are executed, which supports single stepping. The class
+// is not thread-safe; the owner of the simulation calls all the functions.
+
+namespace gte
+{
+    class FixedStepScheduler
+    {
+    public:
+        // The function called for each step, with the simulation time at
+        // the beginning of the step and the step size.
+        using Step = std::function<void(double, double)>;
+
+        FixedStepScheduler(double stepSize = 1.0 / 60.0,
+            uint32_t maxStepsPerFrame = 4, double maxFrameTime = 0.25);
+
+        // Restart at simulation time zero with an empty accumulator. The
+        // wall-clock time of the next Advance call is measured from now.
+        void Reset();
+
+        // Member access. The step size must be positive and the maximum
+        // number of steps per frame at least 1.
+        void SetStepSize(double stepSize);
+        void SetMaxStepsPerFrame(uint32_t maxStepsPerFrame);
+        void SetMaxFrameTime(double maxFrameTime);
+
+        inline double GetStepSize() const
+        {
+            return mStepSize;
+        }
+
+        inline uint32_t GetMaxStepsPerFrame() const
+        {
+            return mMaxStepsPerFrame;
+        }
+
+        inline double GetMaxFrameTime() const
+        {
+            return mMaxFrameTime;
+        }
+
+        // Pause or resume. Resuming restarts the wall-clock measurement so
+        // that the paused time is not simulated.
+        void SetPaused(bool paused);
+
+        inline bool IsPaused() const
+        {
+            return mPaused;
+        }
+
+        // Execute numSteps steps at the next Advance call, also while
+        // paused. The requested steps are not limited by maxStepsPerFrame.
+        inline void RequestSteps(uint32_t numSteps)
+        {
+            mNumRequestedSteps += numSteps;
+        }
+
+        // Add the wall-clock time since the previous call and execute the
+        // steps that are due. The function returns the number of steps.
+        uint32_t Advance(Step const& step);
+
+        // Add the specified time instead of the measured one, for example
+        // to replay a recorded sequence of frame times.
+        uint32_t Advance(double elapsedTime, Step const& step);
+
+        // The simulation time after the last step.
+        inline double GetSimulationTime() const
+        {
+            return mSimulationTime;
+        }
+
+        inline uint64_t GetNumSteps() const
+        {
+            return mNumSteps;
+        }
+
+        // The fraction in [0,1) of a step that the accumulator holds. A
+        // renderer that keeps the states of the last two steps draws the
+        // state interpolated with this weight, one step behind the
+        // simulation.
+        inline double GetAlpha() const
+        {
+            return mAccumulator / mStepSize;
+        }
+
+        // The wall-clock time until the next step is due, for a loop that
+        // sleeps between steps. The function returns 0 when a step is due.
+        double GetTimeToNextStep() const;
+
+        // The total time discarded to prevent the spiral of death.
+        inline double GetDroppedTime() const
+        {
+            return mDroppedTime;
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        double mStepSize, mMaxFrameTime;
+        uint32_t mMaxStepsPerFrame, mNumRequestedSteps;
+        bool mPaused;
+        double mAccumulator, mSimulationTime, mDroppedTime;
+        uint64_t mNumSteps;
+        Clock::time_point mLastTime;
+    };
+}
@@ -13,7 +13,8 @@ Console::Parameters::Parameters()
     :
     display(nullptr),
     window(0),
-    deviceCreationFlags(0)
+    deviceCreationFlags(0),
+    headless(false)
 {
 }
 
@@ -22,7 +23,8 @@ Console::Parameters::Parameters(std::wstring const& inTitle)
     ConsoleApplication::Parameters(inTitle),
     display(nullptr),
     window(0),
-    deviceCreationFlags(0)
+    deviceCreationFlags(0),
+    headless(false)
 {
 }
 
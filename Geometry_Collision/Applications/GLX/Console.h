@@ -28,6 +28,13 @@ namespace gte
             _XDisplay* display;
             unsigned long window;
             uint32_t deviceCreationFlags;
+
+            // When true, the engine is an EGLEngine that needs no X server,
+            // for batch compute jobs on machines without a display; the
+            // display and window are then nullptr and 0. ConsoleSystem also
+            // creates an EGLEngine when the DISPLAY environment variable is
+            // not set. The default value is false.
+            bool headless;
         };
 
     public:
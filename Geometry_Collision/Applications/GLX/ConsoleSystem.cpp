@@ -7,6 +7,7 @@
 
 #include <Applications/GTApplicationsPCH.h>
 #include <Applications/GLX/Console.h>
+#include <cstdlib>
 using namespace gte;
 
 // The singleton used to create and destroy consoles for applications.
@@ -61,9 +62,39 @@ void ConsoleSystem::CreateEngineAndProgramFactory(Console::Parameters& parameter
 #if defined(GTE_USE_LINUX)
 void ConsoleSystem::CreateEngineAndProgramFactory(Console::Parameters& parameters)
 {
+    bool saveDriverInfo = ((parameters.deviceCreationFlags & 0x00000001) != 0);
+
+    // Without an X server, for example on render-farm nodes, the OpenGL
+    // context is created through EGL.
+    char const* displayName = std::getenv("DISPLAY");
+    if (parameters.headless || !displayName || displayName[0] == '\0')
+    {
+        auto engine = std::make_shared<EGLEngine>(saveDriverInfo);
+        if (!engine->MeetsRequirements())
+        {
+            LogError("OpenGL 4.5 or later is required.");
+        }
+
+        parameters.display = nullptr;
+        parameters.window = 0;
+        if (engine->GetDisplay())
+        {
+            parameters.engine = engine;
+            parameters.factory = std::make_shared<GLSLProgramFactory>();
+            parameters.created = true;
+        }
+        else
+        {
+            LogError("Cannot create compute engine.");
+            parameters.engine = nullptr;
+            parameters.factory = nullptr;
+            parameters.created = false;
+        }
+        return;
+    }
+
     // The construction of GLXEngine requires a depth24-stencil8 buffer
     // in order for X Windows to succeed in the call to glXChooseVisual.
-    bool saveDriverInfo = ((parameters.deviceCreationFlags & 0x00000001) != 0);
     auto engine = std::make_shared<GLXEngine>(true, saveDriverInfo);
     if (!engine->MeetsRequirements())
     {
@@ -57,7 +57,8 @@ namespace gte
         // both DX11-based and WGL-based console creation in the same
         // application, although it is possible to have DX11-based and
         // WGL-based graphics engines in the same application.  On Linux,
-        // there is an implementation for GLX.
+        // there is an implementation for GLX and, for machines without an
+        // X server, an implementation for EGL.
         void CreateEngineAndProgramFactory(Console::Parameters& parameters);
     };
 
@@ -11,9 +11,12 @@
 #include <Applications/GLX/WICFileIO.h>
 #include <Graphics/Texture2.h>
 #include <png.h>
+#include <algorithm>
+#include <atomic>
 #include <cstdint>
 #include <cstdio>
 #include <string>
+#include <thread>
 #include <vector>
 using namespace gte;
 
@@ -250,6 +253,45 @@ std::shared_ptr<Texture2> WICFileIO::Load(std::string const& filename, bool want
     return texture;
 }
 
+std::vector<std::shared_ptr<Texture2>> WICFileIO::Load(
+    std::vector<std::string> const& filenames, bool wantMipmaps,
+    uint32_t numThreads)
+{
+    size_t const numFiles = filenames.size();
+    std::vector<std::shared_ptr<Texture2>> textures(numFiles);
+
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    numThreads = static_cast<uint32_t>(std::min(static_cast<size_t>(numThreads), numFiles));
+
+    // The files are handed out one at a time so that a thread that draws
+    // small images takes on more of them. Each load has its own libpng
+    // state, so the decoding needs no synchronization.
+    std::atomic<size_t> next(0);
+    auto worker = [&filenames, &textures, &next, numFiles, wantMipmaps]()
+    {
+        for (size_t i = next++; i < numFiles; i = next++)
+        {
+            textures[i] = Load(filenames[i], wantMipmaps);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (uint32_t t = 1; t < numThreads; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    return textures;
+}
+
 bool WICFileIO::SaveToPNG(std::string const& filename, std::shared_ptr<Texture2> const& texture)
 {
     if (!texture)
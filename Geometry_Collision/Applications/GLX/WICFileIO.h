@@ -9,6 +9,8 @@
 
 #include <Graphics/Texture2.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 // The supported texture types are DF_R8G8B8A8_UNORM, DF_R8_UNORM
 // and DF_R8G8_UNORM (gray+alpha).
@@ -23,6 +25,15 @@ namespace gte
         static std::shared_ptr<Texture2> Load(std::string const& filename,
             bool wantMipmaps);
 
+        // Load the files on a pool of threads, each thread decoding one file
+        // at a time. The returned array has the textures in the order of the
+        // filenames, with a null object for each unsuccessful load. When
+        // numThreads is 0, std::thread::hardware_concurrency() threads are
+        // used.
+        static std::vector<std::shared_ptr<Texture2>> Load(
+            std::vector<std::string> const& filenames, bool wantMipmaps,
+            uint32_t numThreads = 0);
+
         // Support for saving to PNG format.  The function returns true when
         // successful.
         static bool SaveToPNG(std::string const& filename,
@@ -8,6 +8,8 @@
 #include <Applications/GTApplicationsPCH.h>
 #include <Applications/GLX/Window.h>
 #include <X11/Xlib.h>
+#include <poll.h>
+#include <ctime>
 
 // XWindows has a Window data structure, so the implementations of the
 // Geometric Tools class Window must be enclosed in "namespace gte".
@@ -84,6 +86,30 @@ namespace gte
         XDestroyWindow(mDisplay, mWindow);
     }
 
+    void Window::WaitForEvent(double waitTime)
+    {
+        if (XPending(mDisplay))
+        {
+            return;
+        }
+
+        // ppoll has nanosecond resolution, unlike the milliseconds of poll.
+        pollfd descriptor{};
+        descriptor.fd = ConnectionNumber(mDisplay);
+        descriptor.events = POLLIN;
+        if (waitTime < 0.0)
+        {
+            ppoll(&descriptor, 1, nullptr, nullptr);
+        }
+        else
+        {
+            timespec timeout{};
+            timeout.tv_sec = static_cast<time_t>(waitTime);
+            timeout.tv_nsec = static_cast<long>((waitTime - static_cast<double>(timeout.tv_sec)) * 1e9);
+            ppoll(&descriptor, 1, &timeout, nullptr);
+        }
+    }
+
     int32_t Window::ProcessedEvent()
     {
         if (!XPending(mDisplay))
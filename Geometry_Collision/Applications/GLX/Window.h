@@ -60,6 +60,10 @@ namespace gte
         };
         int32_t ProcessedEvent();
 
+        // Wait until an event is pending or the time in seconds has elapsed,
+        // without a time limit when the time is negative.
+        void WaitForEvent(double waitTime);
+
     protected:
         _XDisplay* mDisplay;
         unsigned long mWindow;
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Applications/GLX/Window.h>
+#include <Mathematics/Trace.h>
 #include <memory>
 
 // These forward declarations avoid name conflicts caused by #include-ing
@@ -98,14 +99,35 @@ namespace gte
                     return;
                 }
 
-                if (result == Window::EVT_NONE_PENDING)
+                if (result == Window::EVT_PROCESSED)
                 {
-                    if (!(flags & NO_IDLE_LOOP))
+                    window->Invalidate();
+                }
+                else if (flags & NO_IDLE_LOOP)
+                {
+                    window->WaitForEvent(-1.0);
+                }
+                else
+                {
+                    double waitTime = 0.0;
+                    if (window->IsMinimized())
+                    {
+                        // Nothing is drawn until an event restores the
+                        // window.
+                        window->WaitForEvent(-1.0);
+                    }
+                    else if (window->IsFrameDue(waitTime))
                     {
-                        if (!window->IsMinimized())
                         {
-                            window->OnIdle();
+                            GTE_TRACE_SCOPE("FixedSteps");
+                            window->AdvanceFixedSteps();
                         }
+                        GTE_TRACE_SCOPE("OnIdle");
+                        window->OnIdle();
+                    }
+                    else
+                    {
+                        window->WaitForEvent(waitTime);
                     }
                 }
             }
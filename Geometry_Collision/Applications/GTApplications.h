@@ -9,12 +9,17 @@
 
 // Applications/Common
 #include <Applications/Application.h>
+#include <Applications/AssetLoader.h>
 #include <Applications/CameraRig.h>
 #include <Applications/Command.h>
 #include <Applications/Console.h>
 #include <Applications/ConsoleApplication.h>
 #include <Applications/Environment.h>
+#include <Applications/FileMapping.h>
+#include <Applications/FixedStepScheduler.h>
+#include <Applications/MeshCache.h>
 #include <Applications/OnIdleTimer.h>
+#include <Applications/RawTextureFile.h>
 #include <Applications/Timer.h>
 #include <Applications/TrackBall.h>
 #include <Applications/TrackCylinder.h>
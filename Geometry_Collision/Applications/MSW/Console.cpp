@@ -11,14 +11,16 @@ using namespace gte;
 
 Console::Parameters::Parameters()
     :
-    deviceCreationFlags(0)
+    deviceCreationFlags(0),
+    useSoftwareDevice(false)
 {
 }
 
 Console::Parameters::Parameters(std::wstring const& inTitle)
     :
     ConsoleApplication::Parameters(inTitle),
-    deviceCreationFlags(0)
+    deviceCreationFlags(0),
+    useSoftwareDevice(false)
 {
 }
 
@@ -33,6 +33,13 @@ namespace gte
             // OpenGL driver information. Other bit flags may be defined at
             // a later date.
             uint32_t deviceCreationFlags;
+
+            // For DX11, when true the compute engine uses the WARP software
+            // rasterizer (D3D_DRIVER_TYPE_WARP) instead of a hardware
+            // adapter, so console applications run on machines without a
+            // GPU. The DX11 compute engine has no swap chain either way.
+            // For GL45, the flag is ignored. The default value is false.
+            bool useSoftwareDevice;
         };
 
     public:
@@ -18,7 +18,9 @@ namespace gte
 #if defined(GTE_USE_DIRECTX)
 void ConsoleSystem::CreateEngineAndProgramFactory(Console::Parameters& parameters)
 {
-    auto engine = std::make_shared<DX11Engine>(nullptr, D3D_DRIVER_TYPE_HARDWARE,
+    D3D_DRIVER_TYPE driverType = (parameters.useSoftwareDevice ?
+        D3D_DRIVER_TYPE_WARP : D3D_DRIVER_TYPE_HARDWARE);
+    auto engine = std::make_shared<DX11Engine>(nullptr, driverType,
         nullptr, parameters.deviceCreationFlags);
 
     if (engine->GetDevice())
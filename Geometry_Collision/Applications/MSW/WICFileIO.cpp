@@ -8,6 +8,11 @@
 #include <Applications/GTApplicationsPCH.h>
 #include <Applications/MSW/WICFileIO.h>
 #include <Mathematics/Logger.h>
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
 using namespace gte;
 
 std::shared_ptr<Texture2> WICFileIO::Load(std::string const& filename, bool wantMipmaps)
@@ -45,6 +50,67 @@ std::shared_ptr<Texture2> WICFileIO::Load(void* module, std::string const& rtype
     return texture;
 }
 
+std::vector<std::shared_ptr<Texture2>> WICFileIO::Load(
+    std::vector<std::string> const& filenames, bool wantMipmaps,
+    uint32_t numThreads)
+{
+    size_t const numFiles = filenames.size();
+    std::vector<std::shared_ptr<Texture2>> textures(numFiles);
+
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    numThreads = static_cast<uint32_t>(std::min(static_cast<size_t>(numThreads), numFiles));
+
+    // The files are handed out one at a time so that a thread that draws
+    // small images takes on more of them. WICFileIONative::Load initializes
+    // COM in the calling thread and creates its own imaging factory, so the
+    // decoding needs no synchronization.
+    std::atomic<size_t> next(0);
+    std::mutex failureMutex;
+    std::exception_ptr failure;
+    auto worker = [&filenames, &textures, &next, &failureMutex, &failure,
+        numFiles, wantMipmaps]()
+    {
+        for (size_t i = next++; i < numFiles; i = next++)
+        {
+            try
+            {
+                textures[i] = Load(filenames[i], wantMipmaps);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(failureMutex);
+                if (!failure)
+                {
+                    failure = std::current_exception();
+                }
+                next = numFiles;
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads);
+    for (uint32_t t = 1; t < numThreads; ++t)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+    return textures;
+}
+
 void WICFileIO::SaveToPNG(std::string const& filename,
     std::shared_ptr<Texture2> const& texture)
 {
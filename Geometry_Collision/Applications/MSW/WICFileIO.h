@@ -10,6 +10,8 @@
 #include <Applications/MSW/WICFileIONative.h>
 #include <Graphics/Texture2.h>
 #include <memory>
+#include <string>
+#include <vector>
 
 // The WICFileIO class provides simple loading and saving operations for
 // texture data. The JPEG operations use lossy compression and the PNG
@@ -66,6 +68,16 @@ namespace gte
         static std::shared_ptr<Texture2> Load(void* module, std::string const& rtype,
             int32_t resource, bool wantMipmaps);
 
+        // Load the files on a pool of threads, each thread decoding one file
+        // at a time. The returned array has the textures in the order of the
+        // filenames. Each thread initializes COM for its loads. When a load
+        // fails, the remaining files are not loaded and the exception of the
+        // failure is rethrown after the threads finish. When numThreads is 0,
+        // std::thread::hardware_concurrency() threads are used.
+        static std::vector<std::shared_ptr<Texture2>> Load(
+            std::vector<std::string> const& filenames, bool wantMipmaps,
+            uint32_t numThreads = 0);
+
         // Support for saving to PNG or JPEG.
         //
         // The supported formats for saving and the corresponding WIC GUIDs
@@ -15,19 +15,38 @@ namespace gte
     WindowSystem TheWindowSystem;
 }
 
+#ifndef CREATE_WAITABLE_TIMER_HIGH_RESOLUTION
+#define CREATE_WAITABLE_TIMER_HIGH_RESOLUTION 0x00000002
+#endif
+
 WindowSystem::~WindowSystem()
 {
     if (mHandleMap.empty() && mAtom)
     {
         UnregisterClass(mWindowClassName, nullptr);
     }
+
+    if (mFrameTimer)
+    {
+        CloseHandle(mFrameTimer);
+    }
 }
 
 WindowSystem::WindowSystem()
     :
     mWindowClassName(L"GTEngineWindow"),
-    mAtom(0)
+    mAtom(0),
+    mFrameTimer(nullptr)
 {
+    // High-resolution timers are available starting with Windows 10,
+    // version 1803. Older versions get a standard timer.
+    mFrameTimer = CreateWaitableTimerExW(nullptr, nullptr,
+        CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+    if (!mFrameTimer)
+    {
+        mFrameTimer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+
     WNDCLASS wc{};
     wc.style = CS_OWNDC;
     wc.lpfnWndProc = WindowProcedure;
@@ -42,6 +61,33 @@ WindowSystem::WindowSystem()
     mAtom = RegisterClass(&wc);
 }
 
+void WindowSystem::WaitForMessage(double waitTime)
+{
+    if (waitTime < 0.0 || !mFrameTimer)
+    {
+        if (waitTime < 0.0)
+        {
+            WaitMessage();
+        }
+        else
+        {
+            MsgWaitForMultipleObjectsEx(0, nullptr, static_cast<DWORD>(waitTime * 1000.0),
+                QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        }
+        return;
+    }
+
+    // The due time is relative when negative, in units of 100 nanoseconds.
+    LARGE_INTEGER dueTime;
+    dueTime.QuadPart = -static_cast<LONGLONG>(waitTime * 1e7);
+    if (SetWaitableTimer(mFrameTimer, &dueTime, 0, nullptr, nullptr, FALSE))
+    {
+        MsgWaitForMultipleObjectsEx(1, &mFrameTimer, INFINITE, QS_ALLINPUT,
+            MWMO_INPUTAVAILABLE);
+        CancelWaitableTimer(mFrameTimer);
+    }
+}
+
 bool WindowSystem::GetWindowRectangle(int32_t xClientSize, int32_t yClientSize,
     DWORD style, RECT& windowRectangle)
 {
@@ -11,6 +11,7 @@
 // not be included anywhere else. It depends on the compiler processing class
 // Window first.
 
+#include <Mathematics/Trace.h>
 #include <map>
 #include <memory>
 
@@ -90,15 +91,32 @@ namespace gte
 
                         TranslateMessage(&msg);
                         DispatchMessage(&msg);
+                        window->Invalidate();
                     }
                     else
                     {
                         if (!(flags & NO_IDLE_LOOP))
                         {
-                            if (!window->IsMinimized())
+                            double waitTime = 0.0;
+                            if (window->IsMinimized())
                             {
+                                // Nothing is drawn until a message restores
+                                // the window.
+                                WaitForMessage(-1.0);
+                            }
+                            else if (window->IsFrameDue(waitTime))
+                            {
+                                {
+                                    GTE_TRACE_SCOPE("FixedSteps");
+                                    window->AdvanceFixedSteps();
+                                }
+                                GTE_TRACE_SCOPE("OnIdle");
                                 window->OnIdle();
                             }
+                            else
+                            {
+                                WaitForMessage(waitTime);
+                            }
                         }
                     }
                 }
@@ -131,8 +149,15 @@ namespace gte
         // The event handler.
         static LRESULT CALLBACK WindowProcedure(HWND handle, UINT message, WPARAM wParam, LPARAM lParam);
 
+        // Wait until a message arrives or the time in seconds has elapsed,
+        // without a time limit when the time is negative. The wait uses a
+        // high-resolution waitable timer when the system supports one, so
+        // it is not rounded to the scheduler tick.
+        void WaitForMessage(double waitTime);
+
         wchar_t const* mWindowClassName;
         ATOM mAtom;
+        HANDLE mFrameTimer;
         std::map<HWND, std::shared_ptr<Window>> mHandleMap;
     };
 
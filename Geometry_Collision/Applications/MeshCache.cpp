@@ -0,0 +1,305 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Applications/GTApplicationsPCH.h>
+#include <Applications/MeshCache.h>
+#include <cstdio>
+#include <fstream>
+#include <utility>
+using namespace gte;
+
+namespace
+{
+    // Buffers whose data are in a file mapping that lives as long as the
+    // buffers do.
+    class MappedVertexBuffer : public VertexBuffer
+    {
+    public:
+        MappedVertexBuffer(VertexFormat const& vformat, uint32_t numVertices,
+            std::shared_ptr<FileMapping> const& mapping, uint64_t offset)
+            :
+            VertexBuffer(vformat, numVertices, false),
+            mMapping(mapping)
+        {
+            SetData(mMapping->GetData() + offset);
+        }
+
+    private:
+        std::shared_ptr<FileMapping> mMapping;
+    };
+
+    class MappedIndexBuffer : public IndexBuffer
+    {
+    public:
+        MappedIndexBuffer(IPType type, uint32_t numPrimitives, size_t indexSize,
+            std::shared_ptr<FileMapping> const& mapping, uint64_t offset)
+            :
+            IndexBuffer(type, numPrimitives, indexSize, false),
+            mMapping(mapping)
+        {
+            SetData(mMapping->GetData() + offset);
+        }
+
+    private:
+        std::shared_ptr<FileMapping> mMapping;
+    };
+
+    // Write zeros to the stream until its position is 'offset'.
+    void PadTo(std::ofstream& output, uint64_t offset)
+    {
+        uint64_t position = static_cast<uint64_t>(output.tellp());
+        std::vector<char> padding(static_cast<size_t>(offset - position), 0);
+        output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    }
+
+    // Round up to a multiple of the alignment.
+    uint64_t Align(uint64_t offset, uint64_t alignment)
+    {
+        return (offset + alignment - 1) / alignment * alignment;
+    }
+
+    // Test whether the section [offset, offset + numBytes) is in the file.
+    bool InFile(uint64_t offset, uint64_t numBytes, uint64_t fileSize)
+    {
+        return offset <= fileSize && numBytes <= fileSize - offset;
+    }
+}
+
+MeshCache::MeshCache(std::string const& directory)
+    :
+    mDirectory(directory)
+{
+}
+
+uint64_t MeshCache::GetHash(void const* data, size_t numBytes, uint64_t hash)
+{
+    auto const* bytes = static_cast<uint8_t const*>(data);
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= static_cast<uint64_t>(bytes[i]);
+        hash *= 0x00000100000001B3ull;
+    }
+    return hash;
+}
+
+std::string MeshCache::GetFilename(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.gtmesh",
+        static_cast<unsigned long long>(key));
+    return mDirectory + "/" + name;
+}
+
+bool MeshCache::Save(uint64_t key, Visual const& visual) const
+{
+    return Save(key, visual, nullptr, nullptr, nullptr);
+}
+
+std::shared_ptr<Visual> MeshCache::Load(uint64_t key) const
+{
+    std::unique_ptr<FileMapping> uniqueMapping;
+    Header const* header = Map(key, uniqueMapping);
+    if (!header)
+    {
+        return nullptr;
+    }
+
+    VertexFormat vformat;
+    for (uint32_t i = 0; i < header->numAttributes; ++i)
+    {
+        Attribute const& attribute = header->attributes[i];
+        vformat.Bind(static_cast<VASemantic>(attribute.semantic),
+            static_cast<DFType>(attribute.type), attribute.unit);
+    }
+    if (vformat.GetVertexSize() != header->vertexSize)
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<FileMapping> mapping(std::move(uniqueMapping));
+    std::shared_ptr<VertexBuffer> vbuffer = std::make_shared<MappedVertexBuffer>(
+        vformat, header->numVertices, mapping, header->vertexOffset);
+    vbuffer->SetUsage(static_cast<Resource::Usage>(header->vertexUsage));
+
+    std::shared_ptr<IndexBuffer> ibuffer;
+    IPType type = static_cast<IPType>(header->primitiveType);
+    if (header->indexSize > 0)
+    {
+        ibuffer = std::make_shared<MappedIndexBuffer>(type, header->numPrimitives,
+            static_cast<size_t>(header->indexSize), mapping, header->indexOffset);
+        ibuffer->SetUsage(static_cast<Resource::Usage>(header->indexUsage));
+    }
+    else
+    {
+        ibuffer = std::make_shared<IndexBuffer>(type, header->numPrimitives);
+    }
+
+    auto visual = std::make_shared<Visual>(vbuffer, ibuffer);
+    visual->modelBound.SetCenter({ header->center[0], header->center[1], header->center[2] });
+    visual->modelBound.SetRadius(header->radius);
+    return visual;
+}
+
+bool MeshCache::Save(uint64_t key, Visual const& visual, TreeInfo const* tree,
+    char const* nodes, int32_t const* triangles) const
+{
+    auto const& vbuffer = visual.GetVertexBuffer();
+    auto const& ibuffer = visual.GetIndexBuffer();
+    if (!vbuffer || !vbuffer->StandardUsage() || !vbuffer->GetData() || !ibuffer)
+    {
+        return false;
+    }
+
+    Header header{};
+    header.magic = magic;
+    header.version = version;
+    header.key = key;
+
+    VertexFormat const& vformat = vbuffer->GetFormat();
+    header.numAttributes = static_cast<uint32_t>(vformat.GetNumAttributes());
+    header.vertexSize = vformat.GetVertexSize();
+    header.numVertices = vbuffer->GetNumElements();
+    header.vertexUsage = static_cast<uint32_t>(vbuffer->GetUsage());
+    for (uint32_t i = 0; i < header.numAttributes; ++i)
+    {
+        VASemantic semantic{};
+        DFType type{};
+        uint32_t unit{}, offset{};
+        vformat.GetAttribute(static_cast<int32_t>(i), semantic, type, unit, offset);
+        header.attributes[i].semantic = static_cast<uint32_t>(semantic);
+        header.attributes[i].type = static_cast<uint32_t>(type);
+        header.attributes[i].unit = unit;
+    }
+    uint64_t const numVertexBytes = vbuffer->GetNumBytes();
+    header.vertexOffset = sectionAlignment;
+
+    header.primitiveType = static_cast<uint32_t>(ibuffer->GetPrimitiveType());
+    header.numPrimitives = ibuffer->GetNumPrimitives();
+    header.indexSize = (ibuffer->IsIndexed() ? ibuffer->GetElementSize() : 0);
+    header.indexUsage = static_cast<uint32_t>(ibuffer->GetUsage());
+    uint64_t const numIndexBytes = (ibuffer->IsIndexed() ? ibuffer->GetNumBytes() : 0);
+    header.indexOffset = Align(header.vertexOffset + numVertexBytes, sectionAlignment);
+
+    Vector3<float> center = visual.modelBound.GetCenter();
+    header.center[0] = center[0];
+    header.center[1] = center[1];
+    header.center[2] = center[2];
+    header.radius = visual.modelBound.GetRadius();
+
+    uint64_t numNodeBytes = 0, numTriangleBytes = 0;
+    if (tree)
+    {
+        header.tree = *tree;
+        numNodeBytes = static_cast<uint64_t>(tree->numNodes) * tree->nodeSize;
+        numTriangleBytes = static_cast<uint64_t>(tree->numTriangles) * sizeof(int32_t);
+        header.tree.nodeOffset = Align(header.indexOffset + numIndexBytes, sectionAlignment);
+        header.tree.triangleOffset = header.tree.nodeOffset + numNodeBytes;
+    }
+
+    std::ofstream output(GetFilename(key), std::ios::binary);
+    if (!output)
+    {
+        return false;
+    }
+
+    output.write(reinterpret_cast<char const*>(&header), sizeof(Header));
+    PadTo(output, header.vertexOffset);
+    output.write(vbuffer->GetData(), static_cast<std::streamsize>(numVertexBytes));
+    if (numIndexBytes > 0)
+    {
+        PadTo(output, header.indexOffset);
+        output.write(ibuffer->GetData(), static_cast<std::streamsize>(numIndexBytes));
+    }
+    if (tree)
+    {
+        PadTo(output, header.tree.nodeOffset);
+        output.write(nodes, static_cast<std::streamsize>(numNodeBytes));
+        output.write(reinterpret_cast<char const*>(triangles),
+            static_cast<std::streamsize>(numTriangleBytes));
+    }
+    return static_cast<bool>(output);
+}
+
+MeshCache::Header const* MeshCache::Map(uint64_t key,
+    std::unique_ptr<FileMapping>& mapping) const
+{
+    mapping = std::make_unique<FileMapping>(GetFilename(key));
+    uint64_t const size = mapping->GetSize();
+    if (!mapping->GetData() || size < sizeof(Header))
+    {
+        return nullptr;
+    }
+
+    auto const* header = reinterpret_cast<Header const*>(mapping->GetData());
+    if (header->magic != magic || header->version != version || header->key != key
+        || header->numAttributes == 0
+        || header->numAttributes > VAConstant::MAX_ATTRIBUTES
+        || header->numVertices == 0 || header->vertexSize == 0
+        || header->numPrimitives == 0)
+    {
+        return nullptr;
+    }
+
+    // The primitive type must be exactly one of the IPType bits.
+    uint32_t const primitiveType = header->primitiveType;
+    if (primitiveType == 0 || (primitiveType & (primitiveType - 1)) != 0
+        || primitiveType > static_cast<uint32_t>(IP_TRISTRIP_ADJ))
+    {
+        return nullptr;
+    }
+
+    for (uint32_t i = 0; i < header->numAttributes; ++i)
+    {
+        Attribute const& attribute = header->attributes[i];
+        if (attribute.semantic == VASemantic::NONE
+            || attribute.semantic >= VASemantic::NUM_SEMANTICS
+            || attribute.type == DF_UNKNOWN
+            || attribute.type >= DF_NUM_FORMATS)
+        {
+            return nullptr;
+        }
+    }
+
+    uint64_t const numVertexBytes =
+        static_cast<uint64_t>(header->numVertices) * header->vertexSize;
+    if (header->vertexOffset % sectionAlignment != 0
+        || !InFile(header->vertexOffset, numVertexBytes, size))
+    {
+        return nullptr;
+    }
+
+    if (header->indexSize > 0)
+    {
+        // Compute the number of bytes as the IndexBuffer constructor does,
+        // by creating a buffer without storage.
+        IPType type = static_cast<IPType>(header->primitiveType);
+        IndexBuffer ibuffer(type, header->numPrimitives,
+            static_cast<size_t>(header->indexSize), false);
+        if ((header->indexSize != sizeof(uint16_t) && header->indexSize != sizeof(uint32_t))
+            || header->indexOffset % sectionAlignment != 0
+            || !InFile(header->indexOffset, ibuffer.GetNumBytes(), size))
+        {
+            return nullptr;
+        }
+    }
+
+    TreeInfo const& tree = header->tree;
+    if (tree.numNodes > 0)
+    {
+        uint64_t const numNodeBytes = static_cast<uint64_t>(tree.numNodes) * tree.nodeSize;
+        uint64_t const numTriangleBytes =
+            static_cast<uint64_t>(tree.numTriangles) * sizeof(int32_t);
+        if (tree.nodeOffset % sectionAlignment != 0
+            || tree.triangleOffset % sizeof(int32_t) != 0
+            || !InFile(tree.nodeOffset, numNodeBytes, size)
+            || !InFile(tree.triangleOffset, numTriangleBytes, size))
+        {
+            return nullptr;
+        }
+    }
+    return header;
+}
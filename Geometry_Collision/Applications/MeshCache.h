@@ -0,0 +1,179 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Applications/FileMapping.h>
+#include <Graphics/BoundTree.h>
+#include <Graphics/Visual.h>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A cache of meshes on disk, for meshes that are expensive to create, such
+// as finely tessellated MeshFactory primitives or meshes imported from
+// other file formats. Each mesh is stored in its own file, named by a
+// 64-bit key that the application computes from whatever determines the
+// mesh, typically the creation parameters or the bytes of the source file.
+// The file contains the vertex format, the vertex and index data, the model
+// bound and optionally the nodes of a BoundTree of the mesh. The vertex and
+// index data are stored as the buffers hold them in memory and start at
+// page boundaries. Load maps the file copy-on-write and returns a Visual
+// whose buffers point into the mapping, so the operating system pages in
+// the data from disk when the graphics engine copies it to the GPU. The
+// mapping is released when both buffers are destroyed.
+//
+//   MeshCache cache("Cache");
+//   float const parameters[] = { 64.0f, 64.0f, 1.0f };
+//   uint64_t key = MeshCache::GetHash(parameters, sizeof(parameters));
+//   auto sphere = cache.Load(key);
+//   if (!sphere)
+//   {
+//       sphere = mf.CreateSphere(64, 64, 1.0f);
+//       cache.Save(key, *sphere);
+//   }
+//
+// Include a version number of the creation code in the key so that a
+// change to that code does not load stale meshes. The files store the data
+// with the byte order of the machine that saved them; files of the other
+// byte order fail to load.
+
+namespace gte
+{
+    class MeshCache
+    {
+    public:
+        // The directory must exist.
+        MeshCache(std::string const& directory);
+
+        // The 64-bit FNV-1a hash of the bytes. Pass the returned value as
+        // the input 'hash' to combine several blocks of data into one key.
+        static uint64_t GetHash(void const* data, size_t numBytes,
+            uint64_t hash = 0xCBF29CE484222325ull);
+
+        // The name of the file for the key.
+        std::string GetFilename(uint64_t key) const;
+
+        // Save the buffers and model bound of the visual. The vertex buffer
+        // must be for standard usage and have CPU data. The effect is not
+        // saved. The function returns true when successful.
+        bool Save(uint64_t key, Visual const& visual) const;
+
+        // Save the visual and a tree of the mesh that the visual draws. The
+        // Bound of the tree must be copyable as bytes, as BoundingSphere is.
+        template <typename Mesh, typename Bound>
+        bool Save(uint64_t key, Visual const& visual, BoundTree<Mesh, Bound> const& tree) const
+        {
+            auto const& triangles = tree.GetTriangles();
+            TreeInfo info{};
+            info.nodeSize = static_cast<uint32_t>(sizeof(typename BoundTree<Mesh, Bound>::Node));
+            info.numNodes = static_cast<uint32_t>(tree.GetNumNodes());
+            info.numTriangles = static_cast<uint32_t>(triangles.size());
+            info.maxTrisPerLeaf = static_cast<uint32_t>(tree.GetMaxTrisPerLeaf());
+            info.storeInteriorTris = (tree.GetStoreInteriorTris() ? 1u : 0u);
+            info.buildMethod = static_cast<uint32_t>(tree.GetBuildMethod());
+            return Save(key, visual, &info, reinterpret_cast<char const*>(&tree.GetNode(0)),
+                triangles.data());
+        }
+
+        // Load the visual of the key. If the file does not exist or is not
+        // a valid cache file, the function returns a null object. The
+        // returned visual has no effect.
+        std::shared_ptr<Visual> Load(uint64_t key) const;
+
+        // Load the tree saved with the visual of the key. The mesh must be
+        // the one that the tree was built for, typically a CollisionMesh of
+        // the visual returned by Load. If the file has no tree of this type,
+        // the function returns a null object.
+        template <typename Mesh, typename Bound>
+        std::shared_ptr<BoundTree<Mesh, Bound>> LoadTree(uint64_t key,
+            std::shared_ptr<Mesh> const& mesh, size_t numThreads = 0) const
+        {
+            typedef BoundTree<Mesh, Bound> Tree;
+
+            std::unique_ptr<FileMapping> mapping;
+            Header const* header = Map(key, mapping);
+            if (!header || header->tree.numNodes == 0
+                || header->tree.nodeSize != sizeof(typename Tree::Node)
+                || header->tree.numTriangles != mesh->GetNumTriangles())
+            {
+                return nullptr;
+            }
+
+            // The nodes are copied, which also aligns them as the tree
+            // requires.
+            TreeInfo const& info = header->tree;
+            std::vector<typename Tree::Node> nodes(info.numNodes);
+            std::memcpy(static_cast<void*>(nodes.data()),
+                mapping->GetData() + info.nodeOffset,
+                static_cast<size_t>(info.numNodes) * sizeof(typename Tree::Node));
+            auto const* triangles = reinterpret_cast<int32_t const*>(
+                mapping->GetData() + info.triangleOffset);
+            return std::make_shared<Tree>(mesh, nodes.data(), nodes.size(),
+                triangles, static_cast<int32_t>(info.maxTrisPerLeaf),
+                info.storeInteriorTris != 0,
+                static_cast<typename Tree::BuildMethod>(info.buildMethod),
+                numThreads);
+        }
+
+        // The format version, which is stored in each file. Files of other
+        // versions fail to load.
+        static uint32_t constexpr version = 1;
+
+    private:
+        struct TreeInfo
+        {
+            uint32_t nodeSize, numNodes, numTriangles, maxTrisPerLeaf;
+            uint32_t storeInteriorTris, buildMethod;
+            uint64_t nodeOffset, triangleOffset;
+        };
+
+        struct Attribute
+        {
+            uint32_t semantic, type, unit;
+        };
+
+        struct Header
+        {
+            uint32_t magic, version;
+            uint64_t key;
+
+            // The vertex buffer.
+            uint32_t numAttributes, vertexSize, numVertices, vertexUsage;
+            Attribute attributes[VAConstant::MAX_ATTRIBUTES];
+            uint64_t vertexOffset;
+
+            // The index buffer. The index size is 0 for a buffer without
+            // indices.
+            uint32_t primitiveType, numPrimitives, indexSize, indexUsage;
+            uint64_t indexOffset;
+
+            // The model bound of the visual.
+            float center[3], radius;
+
+            // The tree, where numNodes is 0 for a file without a tree.
+            TreeInfo tree;
+        };
+
+        bool Save(uint64_t key, Visual const& visual, TreeInfo const* tree,
+            char const* nodes, int32_t const* triangles) const;
+
+        // Map the file of the key and validate its header and sections. The
+        // function returns the header in the mapping or nullptr when the
+        // file is not valid.
+        Header const* Map(uint64_t key, std::unique_ptr<FileMapping>& mapping) const;
+
+        // The sections of a file start at multiples of this size, which is
+        // a multiple of the page sizes of the supported platforms.
+        static uint64_t constexpr sectionAlignment = 65536;
+        static uint32_t constexpr magic = 0x434D5447u;  // "GTMC"
+
+        std::string mDirectory;
+    };
+}
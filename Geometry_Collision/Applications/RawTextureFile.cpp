@@ -0,0 +1,104 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Applications/GTApplicationsPCH.h>
+#include <Applications/RawTextureFile.h>
+#include <Applications/FileMapping.h>
+#include <Graphics/DataFormat.h>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <utility>
+#include <vector>
+using namespace gte;
+
+namespace
+{
+    // A texture whose data is in a file mapping that lives as long as the
+    // texture does.
+    class MappedTexture2 : public Texture2
+    {
+    public:
+        MappedTexture2(std::unique_ptr<FileMapping> mapping,
+            RawTextureFile::Header const& header)
+            :
+            Texture2(header.format, header.width, header.height,
+                header.numLevels > 1, false),
+            mMapping(std::move(mapping))
+        {
+            SetData(mMapping->GetData() + header.dataOffset);
+        }
+
+    private:
+        std::unique_ptr<FileMapping> mMapping;
+    };
+}
+
+bool RawTextureFile::Save(std::string const& filename, Texture2 const& texture)
+{
+    if (!texture.GetData() || texture.GetNumItems() != 1)
+    {
+        return false;
+    }
+
+    Header header;
+    header.magic = magic;
+    header.version = version;
+    header.format = texture.GetFormat();
+    header.width = texture.GetWidth();
+    header.height = texture.GetHeight();
+    header.numLevels = texture.GetNumLevels();
+    header.dataOffset = dataAlignment;
+    header.numBytes = texture.GetNumBytes();
+
+    std::ofstream output(filename, std::ios::binary);
+    if (!output)
+    {
+        return false;
+    }
+
+    std::vector<char> padding(static_cast<size_t>(dataAlignment - sizeof(Header)), 0);
+    output.write(reinterpret_cast<char const*>(&header), sizeof(Header));
+    output.write(padding.data(), static_cast<std::streamsize>(padding.size()));
+    output.write(texture.GetData(), static_cast<std::streamsize>(header.numBytes));
+    return static_cast<bool>(output);
+}
+
+std::shared_ptr<Texture2> RawTextureFile::Load(std::string const& filename)
+{
+    auto mapping = std::make_unique<FileMapping>(filename);
+    if (!mapping->GetData() || mapping->GetSize() < sizeof(Header))
+    {
+        return nullptr;
+    }
+
+    Header header;
+    std::memcpy(&header, mapping->GetData(), sizeof(Header));
+    if (header.magic != magic
+        || header.version != version
+        || header.format == DF_UNKNOWN
+        || header.format >= DF_NUM_FORMATS
+        || header.width == 0
+        || header.height == 0
+        || header.numLevels == 0
+        || header.dataOffset % dataAlignment != 0
+        || header.dataOffset > mapping->GetSize()
+        || header.numBytes > mapping->GetSize() - header.dataOffset)
+    {
+        return nullptr;
+    }
+
+    // The texture constructor determines the number of levels from the
+    // dimensions, so the header must agree with it.
+    auto texture = std::make_shared<MappedTexture2>(std::move(mapping), header);
+    if (texture->GetNumLevels() != header.numLevels
+        || texture->GetNumBytes() != header.numBytes)
+    {
+        return nullptr;
+    }
+    return texture;
+}
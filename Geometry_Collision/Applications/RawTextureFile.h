@@ -0,0 +1,77 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Texture2.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// A container for 2D textures that stores the texel data exactly as the
+// Texture2 holds it in memory, so a file is loaded by mapping it into the
+// address space instead of decoding it. The file starts with a header that
+// stores the DataFormat type, the dimensions and the number of mipmap
+// levels of the texture, followed by the data of all the levels starting at
+// a multiple of the page size. The data of a loaded texture points into the
+// mapping, which the operating system pages in from disk when the graphics
+// engine copies the data to the GPU. The mapping is copy-on-write, so the
+// texture data may be modified without changing the file, and it is
+// unmapped when the texture is destroyed.
+//
+// A typical use is to convert the images of an application once, including
+// the mipmaps generated on the CPU,
+//
+//   auto texture = WICFileIO::Load("Rock.png", true);
+//   TextureStreamer::GenerateMipmaps(*texture);
+//   RawTextureFile::Save("Rock.gtraw", *texture);
+//
+// and then to load the converted files at startup.
+//
+//   auto texture = RawTextureFile::Load("Rock.gtraw");
+//   mEngine->Bind(texture);
+//
+// The files store the data with the byte order of the machine that saved
+// them. The load fails for files of the other byte order.
+
+namespace gte
+{
+    class RawTextureFile
+    {
+    public:
+        // Write the data of all the levels of the texture. The function
+        // returns true when successful.
+        static bool Save(std::string const& filename, Texture2 const& texture);
+
+        // Map the file into memory. If the file cannot be opened or is not
+        // a valid container, the function returns a null object.
+        static std::shared_ptr<Texture2> Load(std::string const& filename);
+
+        // The file header. The data of the levels starts at 'dataOffset'
+        // and has 'numBytes' bytes.
+        struct Header
+        {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t format;
+            uint32_t width;
+            uint32_t height;
+            uint32_t numLevels;
+            uint64_t dataOffset;
+            uint64_t numBytes;
+        };
+
+        // The magic number is the characters "GTRT" in the byte order of
+        // the machine that saved the file.
+        static uint32_t constexpr magic = 0x54525447u;
+        static uint32_t constexpr version = 1;
+
+        // The data offset is a multiple of this size, which is a multiple
+        // of the page sizes of the supported platforms.
+        static uint64_t constexpr dataAlignment = 65536;
+    };
+}
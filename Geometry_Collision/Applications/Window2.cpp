@@ -87,7 +87,7 @@ void Window2::OnDisplay()
 
     mEngine->Draw(mOverlay);
     DrawScreenOverlay();
-    mEngine->DisplayColorBuffer(0);
+    mEngine->DisplayColorBuffer(GetSyncInterval());
 }
 
 void Window2::DrawScreenOverlay()
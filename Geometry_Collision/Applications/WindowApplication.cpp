@@ -7,6 +7,7 @@
 
 #include <Applications/GTApplicationsPCH.h>
 #include <Applications/WindowApplication.h>
+#include <Mathematics/Logger.h>
 using namespace gte;
 
 WindowApplication::Parameters::Parameters()
@@ -18,7 +19,9 @@ WindowApplication::Parameters::Parameters()
     ySize(0),
     allowResize(false),
     useDepth24Stencil8(true),
-    created(false)
+    created(false),
+    framePacing(FramePacing::CONTINUOUS),
+    targetFramesPerSecond(60.0)
 {
 }
 
@@ -32,7 +35,9 @@ WindowApplication::Parameters::Parameters(std::wstring const& inTitle,
     ySize(inYSize),
     allowResize(false),
     useDepth24Stencil8(true),
-    created(false)
+    created(false),
+    framePacing(FramePacing::CONTINUOUS),
+    targetFramesPerSecond(60.0)
 {
 }
 
@@ -46,8 +51,72 @@ WindowApplication::WindowApplication(Parameters& parameters)
     mYSize(parameters.ySize),
     mAllowResize(parameters.allowResize),
     mIsMinimized(false),
-    mIsMaximized(false)
+    mIsMaximized(false),
+    mFixedStepsEnabled(false),
+    mFramePacing(FramePacing::CONTINUOUS),
+    mTargetFramesPerSecond(60.0),
+    mRedrawRequested(true),
+    mNextFrameTime(std::chrono::steady_clock::now())
 {
+    SetFramePacing(parameters.framePacing, parameters.targetFramesPerSecond);
+}
+
+void WindowApplication::SetFramePacing(FramePacing framePacing, double targetFramesPerSecond)
+{
+    LogAssert(targetFramesPerSecond > 0.0, "The target must be positive.");
+    mFramePacing = framePacing;
+    mTargetFramesPerSecond = targetFramesPerSecond;
+    mRedrawRequested = true;
+    mNextFrameTime = std::chrono::steady_clock::now();
+}
+
+bool WindowApplication::IsFrameDue(double& waitTime)
+{
+    waitTime = 0.0;
+    if (mFramePacing == FramePacing::CONTINUOUS || mFramePacing == FramePacing::VSYNC)
+    {
+        return true;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point const now = Clock::now();
+    if (mFramePacing == FramePacing::ON_DEMAND && !mRedrawRequested)
+    {
+        // Without a redraw request, only the fixed steps need frames.
+        if (!mFixedStepsEnabled || mFixedStep.IsPaused())
+        {
+            waitTime = -1.0;
+            return false;
+        }
+
+        Clock::time_point const stepTime = now +
+            std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(mFixedStep.GetTimeToNextStep()));
+        if (stepTime > mNextFrameTime)
+        {
+            waitTime = std::chrono::duration<double>(stepTime - now).count();
+            return false;
+        }
+    }
+
+    if (now < mNextFrameTime)
+    {
+        waitTime = std::chrono::duration<double>(mNextFrameTime - now).count();
+        return false;
+    }
+
+    // The next frame is one period after this one. When the frame is late
+    // by more than a period, the schedule restarts from now rather than
+    // making up for the missed frames.
+    Clock::duration const period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / mTargetFramesPerSecond));
+    mNextFrameTime += period;
+    if (mNextFrameTime <= now)
+    {
+        mNextFrameTime = now + period;
+    }
+    mRedrawRequested = false;
+    return true;
 }
 
 void WindowApplication::OnMove(int32_t x, int32_t y)
@@ -98,6 +167,30 @@ void WindowApplication::OnIdle()
     // Stub for derived classes.
 }
 
+void WindowApplication::AdvanceFixedSteps()
+{
+    if (mFixedStepsEnabled)
+    {
+        mFixedStep.Advance([this](double time, double deltaTime)
+        {
+            OnFixedStep(time, deltaTime);
+        });
+    }
+}
+
+void WindowApplication::OnFixedStep(double, double)
+{
+    // Stub for derived classes.
+}
+
+void WindowApplication::EnableFixedSteps(double stepSize, uint32_t maxStepsPerFrame)
+{
+    mFixedStep.SetStepSize(stepSize);
+    mFixedStep.SetMaxStepsPerFrame(maxStepsPerFrame);
+    mFixedStep.Reset();
+    mFixedStepsEnabled = true;
+}
+
 bool WindowApplication::OnCharPress(uint8_t key, int32_t, int32_t)
 {
     if (key == KEY_ESCAPE)
@@ -8,13 +8,36 @@
 #pragma once
 
 #include "Application.h"
+#include "FixedStepScheduler.h"
 #include "OnIdleTimer.h"
+#include <chrono>
 
 namespace Vector_GM
 {
     class WindowApplication : public Application
     {
     public:
+        // The frame pacing determines when the message pump calls OnIdle.
+        //   CONTINUOUS: OnIdle is called whenever no messages are pending,
+        //     which keeps a core busy.
+        //   VSYNC: as CONTINUOUS, but GetSyncInterval returns 1, so a
+        //     window that passes it to DisplayColorBuffer blocks in the
+        //     presentation until the vertical blank.
+        //   TARGET_FPS: OnIdle is called at most targetFramesPerSecond
+        //     times per second. Between frames the pump sleeps on a
+        //     high-resolution timer, waking up early for messages.
+        //   ON_DEMAND: OnIdle is called only after Invalidate, after a
+        //     message has been processed or when a fixed step is due; the
+        //     pump sleeps otherwise. The frames are limited to
+        //     targetFramesPerSecond.
+        enum class FramePacing
+        {
+            CONTINUOUS,
+            VSYNC,
+            TARGET_FPS,
+            ON_DEMAND
+        };
+
         struct Parameters : public Application::Parameters
         {
             Parameters();
@@ -25,6 +48,8 @@ namespace Vector_GM
             std::wstring title;
             int32_t xOrigin, yOrigin, xSize, ySize;
             bool allowResize, useDepth24Stencil8, created;
+            FramePacing framePacing;
+            double targetFramesPerSecond;
         };
 
     public:
@@ -80,6 +105,40 @@ namespace Vector_GM
             return static_cast<float>(mXSize) / static_cast<float>(mYSize);
         }
 
+        // Frame pacing. The target must be positive.
+        void SetFramePacing(FramePacing framePacing, double targetFramesPerSecond = 60.0);
+
+        inline FramePacing GetFramePacing() const
+        {
+            return mFramePacing;
+        }
+
+        inline double GetTargetFramesPerSecond() const
+        {
+            return mTargetFramesPerSecond;
+        }
+
+        // The sync interval to pass to GraphicsEngine::DisplayColorBuffer.
+        inline uint32_t GetSyncInterval() const
+        {
+            return (mFramePacing == FramePacing::VSYNC ? 1u : 0u);
+        }
+
+        // Request a call to OnIdle in ON_DEMAND mode, for example after the
+        // scene has changed. The request is ignored in the other modes.
+        inline void Invalidate()
+        {
+            mRedrawRequested = true;
+        }
+
+        // The message pump calls this function when no messages are
+        // pending. If a frame is due, the function returns 'true' and the
+        // pump calls AdvanceFixedSteps and OnIdle. Otherwise, the function
+        // returns 'false' and 'waitTime' is the time in seconds until the
+        // next frame, during which the pump waits for messages, or negative
+        // when the pump must wait for a message without a time limit.
+        bool IsFrameDue(double& waitTime);
+
         // Display callbacks.
         virtual void OnMove(int32_t x, int32_t y);
         virtual bool OnResize(int32_t xSize, int32_t ySize);
@@ -88,6 +147,15 @@ namespace Vector_GM
         virtual void OnDisplay();
         virtual void OnIdle();
 
+        // Fixed-step callbacks. The message pump calls AdvanceFixedSteps
+        // before each OnIdle call. When the window has enabled fixed steps,
+        // the function calls OnFixedStep for each step that mFixedStep
+        // schedules, with the simulation time at the beginning of the step
+        // and the step size. OnIdle then draws the state, interpolated by
+        // mFixedStep.GetAlpha() if desired.
+        void AdvanceFixedSteps();
+        virtual void OnFixedStep(double time, double deltaTime);
+
         // Keyboard callbacks. OnCharPress allows you to distinguish between
         // upper-case and lower-case letters; OnKeyDown and OnKeyUp do not.
         // For OnCharPress, pressing KEY_ESCAPE terminates the application.
@@ -182,6 +250,11 @@ namespace Vector_GM
         static int32_t const MODIFIER_SHIFT;
 
     protected:
+        // Enable the OnFixedStep callbacks. The scheduler is reset, so the
+        // function is typically called at the end of the constructor of the
+        // derived class.
+        void EnableFixedSteps(double stepSize, uint32_t maxStepsPerFrame = 4);
+
         // Standard window information.
         std::wstring mTitle;
         int32_t mXOrigin, mYOrigin, mXSize, mYSize;
@@ -190,5 +263,13 @@ namespace Vector_GM
         bool mIsMaximized;
 
         OnIdleTimer mTimer;
+        FixedStepScheduler mFixedStep;
+        bool mFixedStepsEnabled;
+
+        // The frame pacing state.
+        FramePacing mFramePacing;
+        double mTargetFramesPerSecond;
+        bool mRedrawRequested;
+        std::chrono::steady_clock::time_point mNextFrameTime;
     };
 }
@@ -1,77 +1,728 @@
-#pragma once
+#include "BouncingSpheresWindow.h"
+#include "MeshFactory.h"
+#include "Texture2Effect.h"
+#include "VertexColorEffect.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
 
-#include "Window3.h"
-#include "RigidBody.h"
-#include "Timer.h"
-#include "PhysModule.h"
-using namespace Vector_GM;
+BouncingSpheresWindow3::BouncingSpheresWindow3(Parameters& parameters)
+	:
+	Window3(parameters),
+	mNumSpheres(GetInitialNumSpheres(parameters.numSpheres)),
+	mMaxSpheres(parameters.maxSpheres > 0 ?
+		std::max(parameters.maxSpheres, mNumSpheres) : 4 * mNumSpheres),
+	mGPUPhysics(parameters.gpuPhysics),
+	mRegionSize(20.0 * std::max(1.0, std::cbrt(static_cast<double>(mNumSpheres) / 16.0))),
+	mSimulationTime(0.0),
+	mSimulationDeltaTime(1.0 / 240.0),
+	mStopSimulation(false),
+	mSingleStep(false),
+	mNumRequestedSteps(0),
+	mRequestedSphereChange(0),
+	mSphereRandom(1),
+	mRecordRequested(false),
+	mRecorder{},
+	mPlayer{},
+	mReplayStart{}
+{
+	// A replay takes the region and the spheres from the recording.
+	std::string const replay = mEnvironment.GetVariable("GTE_BOUNCING_SPHERES_REPLAY");
+	if (replay != "")
+	{
+		mPlayer = std::make_unique<PhysicsPlayer>(replay);
+		if (!mPlayer->IsOpen() || mPlayer->GetMaxBodies() == 0)
+		{
+			LogError("Cannot open recording " + replay);
+			parameters.created = false;
+			return;
+		}
+
+		mNumSpheres = mPlayer->GetNumBodies(0);
+		mMaxSpheres = mPlayer->GetMaxBodies();
+		mGPUPhysics = false;
+		mRegionSize = 0.0;
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			mRegionSize = std::max(mRegionSize, mPlayer->GetRegionMax()[d]);
+		}
+	}
+
+	if (mNumSpheres == 0 || !SetEnvironment())
+	{
+		parameters.created = false;
+		return;
+	}
+
+	mNoCullState = std::make_shared<RasterizerState>();
+	mNoCullState->cull = RasterizerState::Cull::NONE;
+	mNoCullWireState = std::make_shared<RasterizerState>();
+	mNoCullWireState->cull = RasterizerState::Cull::NONE;
+	mNoCullWireState->fill = RasterizerState::Fill::WIREFRAME;
+	mEngine->SetRasterizerState(mNoCullState);
+	mEngine->SetClearColor({ 0.6f, 0.851f, 0.918f, 1.0f });
+
+	CreateScene();
+	mGPUProfiler = mEngine->CreateGPUProfiler(4, 8);
+	mGPUProfiler->SetMaxHistory(600);
 
-// The PhysicsModule is an implementation of the collision detection and
-// impulse-based collision response described in "Game Physics, 2nd edition."
-// The code comments have relevant equation numbers from the book. However,
-// the DoCollisionResponse function uses a variation for computing impulses,
-// described in
-//   https://www.geometrictools.com/Documentation/ComputingImpulsiveForces.pdf
+	float const size = static_cast<float>(mRegionSize);
+	InitializeCamera(60.0f, GetAspectRatio(), 1.0f, 100.0f * size, 0.01f * size / 20.0f,
+		0.001f, { 2.4f * size, 0.5f * size, 0.4f * size }, { -1.0f, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, 1.0f });
 
-class BouncingSpheresWindow3 : public Window3
+	mTrackBall.Update();
+	mPVWMatrices.Update();
+
+	if (mGPUPhysics)
+	{
+		EnableFixedSteps(mSimulationDeltaTime);
+		GTE_TRACE_THREAD_NAME("render");
+		return;
+	}
+
+	if (mPlayer)
+	{
+		mReplayStart = std::chrono::steady_clock::now();
+		UpdateReplayTransforms();
+		GTE_TRACE_THREAD_NAME("render");
+		return;
+	}
+
+	// The render thread starts from the initial state, so the first frames
+	// are drawn before the simulation thread publishes its first tick.
+	PublishSnapshot();
+	mSnapshots.Acquire();
+	std::swap(mCurrentSnapshot, mSnapshots.GetReadBuffer());
+	mPreviousSnapshot = mCurrentSnapshot;
+	UpdateSphereTransforms();
+
+	GTE_TRACE_THREAD_NAME("render");
+	mSimulationThread = std::thread([this]() { SimulationLoop(); });
+}
+
+BouncingSpheresWindow3::~BouncingSpheresWindow3()
 {
-public:
-	BouncingSpheresWindow3(Parameters& parameters);
+	mStopSimulation.store(true);
+	if (mSimulationThread.joinable())
+	{
+		mSimulationThread.join();
+	}
 
-	virtual void OnIdle() override;
-	virtual bool OnCharPress(uint8_t key, int32_t x, int32_t y) override;
+	// The instance buffer must not refer to the mapping of the player
+	// after the player is destroyed.
+	if (mPlayer && mSphereEffect)
+	{
+		mSphereEffect->GetInstanceBuffer()->ResetData();
+	}
+}
 
-private:
-	struct VertexPT
+void BouncingSpheresWindow3::OnIdle()
+{
+	mTimer.Measure();
+
+	if (mCameraRig.Move())
+	{
+		mPVWMatrices.Update();
+	}
+
+	GraphicsTick();
+
+	mTimer.UpdateFrameCount();
+}
+
+void BouncingSpheresWindow3::OnFixedStep(double, double deltaTime)
+{
+	mGPUModule->DoTick(static_cast<float>(deltaTime));
+	mSimulationTime += deltaTime;
+}
+
+bool BouncingSpheresWindow3::OnCharPress(uint8_t key, int32_t x, int32_t y)
+{
+	switch (key)
 	{
-		VertexPT()
-			:
-			position(Vector3<float>::Zero()),
-			tcoord(Vector2<float>::Zero())
+	case 'w':
+	case 'W':
+		if (mNoCullState == mEngine->GetRasterizerState())
+		{
+			mEngine->SetRasterizerState(mNoCullWireState);
+		}
+		else
 		{
+			mEngine->SetRasterizerState(mNoCullState);
 		}
+		return true;
 
-		Vector3<float> position;
-		Vector2<float> tcoord;
-	};
+	case 's':
+	case 'S':
+		mSingleStep.store(!mSingleStep.load());
+		mFixedStep.SetPaused(mSingleStep.load());
+		return true;
+
+	case 'g':
+	case 'G':
+		if (mSingleStep.load())
+		{
+			mNumRequestedSteps.fetch_add(1);
+			mFixedStep.RequestSteps(1);
+		}
+		return true;
+
+	case 'p':
+	case 'P':
+		mGPUProfiler->ExportChromeTrace("BouncingSpheresGPU.json");
+		return true;
 
-	struct VertexPC
+	case 't':
+	case 'T':
+		Trace::ExportChromeTrace("BouncingSpheresCPU.json");
+		return true;
+
+	case 'c':
+	case 'C':
+		if (mModule)
+		{
+			mRecordRequested.store(!mRecordRequested.load());
+		}
+		return true;
+
+	case '+':
+	case '=':
+		if (mModule)
+		{
+			int64_t const numSpheres = static_cast<int64_t>(mCurrentSnapshot.position.size());
+			mRequestedSphereChange.fetch_add(std::max(numSpheres / 4, static_cast<int64_t>(1)));
+		}
+		return true;
+
+	case '-':
+	case '_':
+		if (mModule)
+		{
+			int64_t const numSpheres = static_cast<int64_t>(mCurrentSnapshot.position.size());
+			mRequestedSphereChange.fetch_sub(std::max(numSpheres / 4, static_cast<int64_t>(1)));
+		}
+		return true;
+	}
+
+	return Window3::OnCharPress(key, x, y);
+}
+
+size_t BouncingSpheresWindow3::GetInitialNumSpheres(size_t numSpheres) const
+{
+	std::string const value = mEnvironment.GetVariable("GTE_BOUNCING_SPHERES");
+	if (value != "")
 	{
-		VertexPC()
-			:
-			position(Vector3<float>::Zero()),
-			color(Vector4<float>::Zero())
+		size_t const number = static_cast<size_t>(std::strtoull(value.c_str(), nullptr, 10));
+		if (number > 0)
 		{
+			return number;
 		}
+	}
+	return numSpheres;
+}
+
+bool BouncingSpheresWindow3::SetEnvironment()
+{
+	std::string path = GetGTEPath();
+	if (path == "")
+	{
+		return false;
+	}
 
-		Vector3<float> position;
-		Vector4<float> color;
+	mEnvironment.Insert(path + "/Samples/Physics/BouncingSpheres/Data/");
+	std::vector<std::string> inputs =
+	{
+		"BallTexture.png",
+		"Floor.png"
 	};
 
-	bool SetEnvironment();
-	void CreateScene();
-	void CreatePhysicsObjects();
-	void CreateGraphicsObjects();
-	void CreateWall(size_t index, VertexFormat const& vformat,
-		Vector3<float> const& pos0, Vector3<float> const& pos1,
-		Vector3<float> const& pos2, Vector3<float> const& pos3,
-		Vector4<float> const& color);
-
-	void PhysicsTick();
-	void GraphicsTick();
-
-	enum { NUM_SPHERES = 16 };
-	std::unique_ptr<PhysicsModule> mModule;
-
-	std::shared_ptr<RasterizerState> mNoCullState;
-	std::shared_ptr<RasterizerState> mNoCullWireState;
-	std::shared_ptr<Node> mScene;
-	std::array<std::shared_ptr<Visual>, 4> mPlaneMesh;
-	std::array<std::shared_ptr<Visual>, NUM_SPHERES> mSphereMesh;
-
-	Timer mPhysicsTimer, mGraphicsTimer;
-	double mLastPhysicsTime, mCurrPhysicsTime;
-	double mSimulationTime, mSimulationDeltaTime;
-	double mLastGraphicsTime, mCurrGraphicsTime;
-	bool mSingleStep;
-};
+	for (auto const& input : inputs)
+	{
+		if (mEnvironment.GetPath(input) == "")
+		{
+			LogError("Cannot find file " + input);
+			return false;
+		}
+	}
+
+	return true;
+}
+
+void BouncingSpheresWindow3::CreateScene()
+{
+	mScene = std::make_shared<Node>();
+	mTrackBall.Attach(mScene);
+
+	// The graphics objects are created first so that the textures are
+	// decoded while the physics objects are created.
+	mLoader = std::make_unique<gte::AssetLoader>();
+	CreateGraphicsObjects();
+	CreatePhysicsObjects();
+}
+
+void BouncingSpheresWindow3::CreatePhysicsObjects()
+{
+	// A replay has no physics.
+	if (mPlayer)
+	{
+		return;
+	}
+
+	// The front wall at x = mRegionSize and the ceiling are not drawn so
+	// that the camera can see the spheres.
+	if (mGPUPhysics)
+	{
+		float const size = static_cast<float>(mRegionSize);
+		mGPUModule = std::make_unique<GPUPhysicsModule>(mProgramFactory,
+			[this](std::shared_ptr<Buffer> const& buffer)
+			{
+				mEngine->Update(buffer);
+			},
+			[this](std::shared_ptr<ComputeProgram> const& program,
+				uint32_t numXGroups, uint32_t numYGroups, uint32_t numZGroups)
+			{
+				mEngine->Execute(program, numXGroups, numYGroups, numZGroups);
+			},
+			mNumSpheres, 0.0f, size, 0.0f, size, 0.0f, size);
+	}
+	else
+	{
+		mModule = std::make_unique<PhysicsModule<double>>(mNumSpheres,
+			0.0, mRegionSize, 0.0, mRegionSize, 0.0, mRegionSize);
+		mModule->SetBroadphase(PhysicsModule<double>::Broadphase::UNIFORM_GRID);
+	}
+
+	std::mt19937 mte{};
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::uniform_real_distribution<double> velocity(-4.0, 4.0);
+	for (size_t i = 0; i < mNumSpheres; ++i)
+	{
+		double radius = 1.0 + unit(mte);
+		Vector3<double> center{};
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			center[d] = radius + (mRegionSize - 2.0 * radius) * unit(mte);
+		}
+		Vector3<double> linearVelocity{ velocity(mte), velocity(mte), velocity(mte) };
+		Vector3<double> angularVelocity{ velocity(mte), velocity(mte), velocity(mte) };
+		if (mGPUModule)
+		{
+			Vector3<float> fCenter, fLinearVelocity, fAngularVelocity;
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				fCenter[d] = static_cast<float>(center[d]);
+				fLinearVelocity[d] = static_cast<float>(linearVelocity[d]);
+				fAngularVelocity[d] = static_cast<float>(angularVelocity[d]);
+			}
+			mGPUModule->InitializeSphere(i, static_cast<float>(radius), 1.0f, fCenter,
+				fLinearVelocity, Quaternion<float>::Identity(), fAngularVelocity);
+		}
+		else
+		{
+			mModule->InitializeSphere(i, radius, 1.0, center, linearVelocity,
+				Quaternion<double>::Identity(), angularVelocity);
+		}
+	}
+}
+
+void BouncingSpheresWindow3::CreateGraphicsObjects()
+{
+	// The floor is textured.
+	float const size = static_cast<float>(mRegionSize);
+	VertexFormat vformat;
+	vformat.Bind(VASemantic::POSITION, DF_R32G32B32_FLOAT, 0);
+	vformat.Bind(VASemantic::TEXCOORD, DF_R32G32_FLOAT, 0);
+	auto vbuffer = std::make_shared<VertexBuffer>(vformat, 4);
+	auto vertices = vbuffer->Get<VertexPT>();
+	vertices[0].position = { 0.0f, 0.0f, 0.0f };
+	vertices[1].position = { size, 0.0f, 0.0f };
+	vertices[2].position = { 0.0f, size, 0.0f };
+	vertices[3].position = { size, size, 0.0f };
+	vertices[0].tcoord = { 0.0f, 0.0f };
+	vertices[1].tcoord = { 1.0f, 0.0f };
+	vertices[2].tcoord = { 0.0f, 1.0f };
+	vertices[3].tcoord = { 1.0f, 1.0f };
+	auto ibuffer = std::make_shared<IndexBuffer>(IP_TRISTRIP, 2);
+	mLoader->LoadTexture(mEnvironment.GetPath("Floor.png"), true,
+		[this, vbuffer, ibuffer](std::shared_ptr<Texture2> const& texture)
+		{
+			texture->AutogenerateMipmaps();
+			auto effect = std::make_shared<Texture2Effect>(mProgramFactory, texture,
+				SamplerState::Filter::MIN_L_MAG_L_MIP_L, SamplerState::Mode::WRAP,
+				SamplerState::Mode::WRAP);
+			mPlaneMesh[0] = std::make_shared<Visual>(vbuffer, ibuffer, effect);
+			mPVWMatrices.Subscribe(mPlaneMesh[0]->worldTransform, effect->GetPVWMatrixConstant());
+			mScene->AttachChild(mPlaneMesh[0]);
+		});
+
+	// The walls have vertex colors.
+	VertexFormat wallFormat;
+	wallFormat.Bind(VASemantic::POSITION, DF_R32G32B32_FLOAT, 0);
+	wallFormat.Bind(VASemantic::COLOR, DF_R32G32B32A32_FLOAT, 0);
+	CreateWall(1, wallFormat,
+		{ 0.0f, 0.0f, 0.0f }, { size, 0.0f, 0.0f },
+		{ 0.0f, 0.0f, size }, { size, 0.0f, size },
+		{ 0.5f, 0.5f, 0.75f, 1.0f });
+	CreateWall(2, wallFormat,
+		{ 0.0f, size, 0.0f }, { size, size, 0.0f },
+		{ 0.0f, size, size }, { size, size, size },
+		{ 0.5f, 0.5f, 0.75f, 1.0f });
+	CreateWall(3, wallFormat,
+		{ 0.0f, 0.0f, 0.0f }, { 0.0f, size, 0.0f },
+		{ 0.0f, 0.0f, size }, { 0.0f, size, size },
+		{ 0.75f, 0.5f, 0.5f, 1.0f });
+
+	// The spheres are instances of a unit sphere. The instance matrices
+	// are relative to mScene, so the visual has the identity transform.
+	// Its bound is that of the unit sphere, so it must not be culled. The
+	// effect is created when the texture is ready, and the instance
+	// transforms are written from then on.
+	MeshFactory mf;
+	mf.SetVertexFormat(vformat);
+	mSphereMesh = mf.CreateSphere(16, 16, 1.0f);
+	mSphereMesh->culling = CullingMode::NEVER;
+	mLoader->LoadTexture(mEnvironment.GetPath("BallTexture.png"), true,
+		[this](std::shared_ptr<Texture2> const& texture)
+		{
+			texture->AutogenerateMipmaps();
+			if (mGPUModule)
+			{
+				mSphereEffect = std::make_shared<InstancedTexture2Effect>(mProgramFactory, texture,
+					SamplerState::Filter::MIN_L_MAG_L_MIP_L, SamplerState::Mode::CLAMP,
+					SamplerState::Mode::CLAMP, mGPUModule->GetInstanceBuffer());
+			}
+			else
+			{
+				mSphereEffect = std::make_shared<InstancedTexture2Effect>(mProgramFactory, texture,
+					SamplerState::Filter::MIN_L_MAG_L_MIP_L, SamplerState::Mode::CLAMP,
+					SamplerState::Mode::CLAMP, static_cast<uint32_t>(mMaxSpheres));
+			}
+			mSphereMesh->SetEffect(mSphereEffect);
+			mSphereMesh->GetIndexBuffer()->SetNumInstances(static_cast<uint32_t>(mNumSpheres));
+			mPVWMatrices.Subscribe(mSphereMesh->worldTransform, mSphereEffect->GetPVWMatrixConstant());
+			mScene->AttachChild(mSphereMesh);
+		});
+}
+
+void BouncingSpheresWindow3::CreateWall(size_t index, VertexFormat const& vformat,
+	Vector3<float> const& pos0, Vector3<float> const& pos1,
+	Vector3<float> const& pos2, Vector3<float> const& pos3,
+	Vector4<float> const& color)
+{
+	auto vbuffer = std::make_shared<VertexBuffer>(vformat, 4);
+	auto vertices = vbuffer->Get<VertexPC>();
+	vertices[0].position = pos0;
+	vertices[1].position = pos1;
+	vertices[2].position = pos2;
+	vertices[3].position = pos3;
+	for (size_t j = 0; j < 4; ++j)
+	{
+		vertices[j].color = color;
+	}
+	auto ibuffer = std::make_shared<IndexBuffer>(IP_TRISTRIP, 2);
+
+	auto effect = std::make_shared<VertexColorEffect>(mProgramFactory);
+	mPlaneMesh[index] = std::make_shared<Visual>(vbuffer, ibuffer, effect);
+	mPVWMatrices.Subscribe(mPlaneMesh[index]->worldTransform, effect->GetPVWMatrixConstant());
+	mScene->AttachChild(mPlaneMesh[index]);
+}
+
+void BouncingSpheresWindow3::SimulationLoop()
+{
+	GTE_TRACE_THREAD_NAME("simulation");
+
+	// When the physics falls behind, at most 4 ticks are executed before
+	// the loop sleeps again, and the remaining backlog is dropped. The
+	// simulation then runs slower than real time instead of spending ever
+	// more time catching up.
+	FixedStepScheduler scheduler(mSimulationDeltaTime, 4);
+	while (!mStopSimulation.load())
+	{
+		// The single-step state is set by the render thread.
+		scheduler.SetPaused(mSingleStep.load());
+		for (; mNumRequestedSteps.load() > 0; mNumRequestedSteps.fetch_sub(1))
+		{
+			scheduler.RequestSteps(1);
+		}
+
+		ApplySphereRequests();
+		UpdateRecording();
+		scheduler.Advance([this](double, double) { PhysicsTick(); });
+
+		double const sleepTime = (scheduler.IsPaused() ? 0.001 : scheduler.GetTimeToNextStep());
+		std::this_thread::sleep_for(std::chrono::duration<double>(sleepTime));
+	}
+}
+
+void BouncingSpheresWindow3::ApplySphereRequests()
+{
+	int64_t const change = mRequestedSphereChange.exchange(0);
+	if (change == 0)
+	{
+		return;
+	}
+
+	// At least one sphere remains, and the instance buffer limits the
+	// number of spheres.
+	size_t const numSpheres = mModule->GetNumSpheres();
+	if (change > 0)
+	{
+		size_t const numAdded = std::min(static_cast<size_t>(change), mMaxSpheres - numSpheres);
+		for (size_t j = 0; j < numAdded; ++j)
+		{
+			AddRandomSphere(mSphereRandom);
+		}
+	}
+	else
+	{
+		size_t const numRemoved = std::min(static_cast<size_t>(-change), numSpheres - 1);
+		for (size_t j = 0; j < numRemoved; ++j)
+		{
+			std::uniform_int_distribution<size_t> index(0, mModule->GetNumSpheres() - 1);
+			mModule->RemoveSphere(mModule->GetSphereHandle(index(mSphereRandom)));
+		}
+	}
+
+	// The change is visible also while single stepping.
+	PublishSnapshot();
+}
+
+void BouncingSpheresWindow3::AddRandomSphere(std::mt19937& mte)
+{
+	// The distributions of CreatePhysicsObjects.
+	std::uniform_real_distribution<double> unit(0.0, 1.0);
+	std::uniform_real_distribution<double> velocity(-4.0, 4.0);
+	double radius = 1.0 + unit(mte);
+	Vector3<double> center{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		center[d] = radius + (mRegionSize - 2.0 * radius) * unit(mte);
+	}
+	Vector3<double> linearVelocity{ velocity(mte), velocity(mte), velocity(mte) };
+	Vector3<double> angularVelocity{ velocity(mte), velocity(mte), velocity(mte) };
+	mModule->AddSphere(radius, 1.0, center, linearVelocity,
+		Quaternion<double>::Identity(), angularVelocity);
+}
+
+void BouncingSpheresWindow3::PhysicsTick()
+{
+	mModule->DoTick(mSimulationTime, mSimulationDeltaTime);
+	mSimulationTime += mSimulationDeltaTime;
+	if (mRecorder)
+	{
+		mRecorder->Record(mSimulationTime, *mModule);
+	}
+	PublishSnapshot();
+}
+
+void BouncingSpheresWindow3::PublishSnapshot()
+{
+	auto const& spheres = mModule->GetSpheres();
+	size_t const numSpheres = spheres.GetNumSpheres();
+
+	// The slot may hold an old snapshot, so all of it is overwritten.
+	Snapshot& snapshot = mSnapshots.GetWriteBuffer();
+	snapshot.simulationTime = mSimulationTime;
+	snapshot.publishTime = std::chrono::steady_clock::now();
+	snapshot.position.resize(numSpheres);
+	snapshot.orientation.resize(numSpheres);
+	snapshot.radius.resize(numSpheres);
+	snapshot.handle.resize(numSpheres);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		snapshot.radius[i] = static_cast<float>(spheres.radius[i]);
+		snapshot.handle[i] = mModule->GetSphereHandle(i);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			snapshot.position[i][d] = static_cast<float>(spheres.position[i][d]);
+		}
+		for (int32_t d = 0; d < 4; ++d)
+		{
+			snapshot.orientation[i][d] = static_cast<float>(spheres.qOrientation[i][d]);
+		}
+	}
+	mSnapshots.Publish();
+}
+
+void BouncingSpheresWindow3::UpdateRecording()
+{
+	// The recording holds at most mMaxSpheres spheres, the limit of
+	// ApplySphereRequests. It is closed when the recorder is destroyed.
+	bool const record = mRecordRequested.load();
+	if (record && !mRecorder)
+	{
+		Vector3<double> const regionMin{ 0.0, 0.0, 0.0 };
+		Vector3<double> const regionMax{ mRegionSize, mRegionSize, mRegionSize };
+		mRecorder = std::make_unique<PhysicsRecorder>("BouncingSpheres.gtrec",
+			mMaxSpheres, regionMin, regionMax);
+		if (!mRecorder->IsOpen())
+		{
+			mRecorder = nullptr;
+			mRecordRequested.store(false);
+		}
+	}
+	else if (!record && mRecorder)
+	{
+		mRecorder = nullptr;
+	}
+}
+
+void BouncingSpheresWindow3::GraphicsTick()
+{
+	mLoader->Poll();
+
+	// With GPU physics, the instance buffer was written by the physics
+	// programs of the fixed steps before this call.
+	if (mPlayer)
+	{
+		UpdateReplayTransforms();
+	}
+	else if (!mGPUModule)
+	{
+		// The previous current snapshot becomes the previous snapshot. The
+		// slot given back to the simulation thread receives the old
+		// previous snapshot, which the thread overwrites.
+		if (mSnapshots.Acquire())
+		{
+			std::swap(mPreviousSnapshot, mCurrentSnapshot);
+			std::swap(mCurrentSnapshot, mSnapshots.GetReadBuffer());
+		}
+
+		UpdateSphereTransforms();
+	}
+	if (mSphereEffect && !mGPUModule)
+	{
+		mEngine->Update(mSphereEffect->GetInstanceBuffer());
+	}
+	mScene->Update();
+	mPVWMatrices.Update();
+
+	mGPUProfiler->BeginFrame();
+	mEngine->ClearBuffers();
+	{
+		GPUProfiler::ScopedTimer timer(*mGPUProfiler, "planes");
+		for (auto const& plane : mPlaneMesh)
+		{
+			if (plane)
+			{
+				mEngine->Draw(plane);
+			}
+		}
+	}
+	{
+		GPUProfiler::ScopedTimer timer(*mGPUProfiler, "spheres");
+		if (mSphereEffect)
+		{
+			mEngine->Draw(mSphereMesh);
+		}
+	}
+	{
+		GPUProfiler::ScopedTimer timer(*mGPUProfiler, "overlay");
+		std::array<float, 4> const black{ 0.0f, 0.0f, 0.0f, 1.0f };
+		mEngine->Draw(8, mYSize - 8, black, mTimer.GetFPS());
+		double const time = (mModule ? mCurrentSnapshot.simulationTime : mSimulationTime);
+		mEngine->Draw(96, mYSize - 8, black, "time = " + std::to_string(time));
+		if (mLoader->GetNumPending() > 0)
+		{
+			mEngine->Draw(320, mYSize - 8, black, "loading");
+		}
+
+		// The GPU times in milliseconds of the latest resolved frame.
+		if (mGPUProfiler->HasFrame())
+		{
+			std::string message = "gpu ms:";
+			for (auto const& scope : mGPUProfiler->GetFrame().scopes)
+			{
+				message += " " + scope.name + " = " +
+					std::to_string(1000.0 * (scope.end - scope.begin));
+			}
+			mEngine->Draw(8, 24, black, message);
+		}
+	}
+	mGPUProfiler->EndFrame();
+	mEngine->DisplayColorBuffer(1);
+}
+
+void BouncingSpheresWindow3::UpdateSphereTransforms()
+{
+	// The spheres are drawn at the simulation time one tick before the
+	// current snapshot, advanced by the wall-clock time since the snapshot
+	// was published. That time is between the previous and the current
+	// snapshot unless the simulation stalls, in which case the spheres are
+	// drawn at the current snapshot.
+	if (!mSphereEffect)
+	{
+		return;
+	}
+
+	double const elapsed = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - mCurrentSnapshot.publishTime).count();
+	double const renderTime = mCurrentSnapshot.simulationTime + elapsed - mSimulationDeltaTime;
+	double const timeInterval = mCurrentSnapshot.simulationTime - mPreviousSnapshot.simulationTime;
+	float t = 1.0f;
+	if (timeInterval > 0.0)
+	{
+		double const alpha = (renderTime - mPreviousSnapshot.simulationTime) / timeInterval;
+		t = static_cast<float>(std::min(std::max(alpha, 0.0), 1.0));
+	}
+
+	// The world matrix of an instance scales the unit sphere by the radius.
+	// A sphere that was added, or moved to another index by a removal,
+	// since the previous snapshot is drawn at the current snapshot.
+	auto const& instances = mSphereEffect->GetInstanceBuffer();
+	auto world = instances->Get<Matrix4x4<float>>();
+	size_t const numSpheres = mCurrentSnapshot.position.size();
+	size_t const numPrevious = mPreviousSnapshot.position.size();
+	Transform<float> transform{};
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		Vector3<float> const& p1 = mCurrentSnapshot.position[i];
+		Quaternion<float> const& q1 = mCurrentSnapshot.orientation[i];
+		if (i < numPrevious && mPreviousSnapshot.handle[i] == mCurrentSnapshot.handle[i])
+		{
+			Vector3<float> const& p0 = mPreviousSnapshot.position[i];
+			transform.SetTranslation(p0 + t * (p1 - p0));
+
+			// Slerp takes the shorter arc when Dot(q0,q1) < 0.
+			Quaternion<float> const& q0 = mPreviousSnapshot.orientation[i];
+			transform.SetRotation(Slerp(t, q0, q1));
+		}
+		else
+		{
+			transform.SetTranslation(p1);
+			transform.SetRotation(q1);
+		}
+		transform.SetUniformScale(mCurrentSnapshot.radius[i]);
+		world[i] = transform.GetHMatrix();
+	}
+
+	uint32_t const numInstances = static_cast<uint32_t>(numSpheres);
+	instances->SetNumActiveElements(numInstances);
+	mSphereMesh->GetIndexBuffer()->SetNumInstances(numInstances);
+}
+
+void BouncingSpheresWindow3::UpdateReplayTransforms()
+{
+	// The frames are drawn at their recorded times relative to the first
+	// frame, without interpolation, and the recording is looped.
+	if (!mSphereEffect)
+	{
+		return;
+	}
+
+	double const firstTime = mPlayer->GetTime(0);
+	double const duration = mPlayer->GetTime(mPlayer->GetNumFrames() - 1) - firstTime;
+	double elapsed = std::chrono::duration<double>(
+		std::chrono::steady_clock::now() - mReplayStart).count();
+	elapsed = (duration > 0.0 ? std::fmod(elapsed, duration) : 0.0);
+	size_t const frame = mPlayer->FindFrame(firstTime + elapsed);
+
+	// The instance buffer has mMaxSpheres elements, the maximum number of
+	// bodies of the recording, so Bind succeeds.
+	auto const& instances = mSphereEffect->GetInstanceBuffer();
+	mPlayer->Bind(frame, *instances);
+	mSphereMesh->GetIndexBuffer()->SetNumInstances(instances->GetNumActiveElements());
+	mSimulationTime = mPlayer->GetTime(frame);
+}
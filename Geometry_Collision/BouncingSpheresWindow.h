@@ -1,9 +1,18 @@
 #pragma once
 
 #include "Window3.h"
+#include "InstancedTexture2Effect.h"
+#include "AssetLoader.h"
 #include "RigidBody.h"
-#include "Timer.h"
 #include "PhysModule.h"
+#include "GPUPhysModule.h"
+#include "PhysicsRecording.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <random>
+#include <thread>
 using namespace Vector_GM;
 
 // The PhysicsModule is an implementation of the collision detection and
@@ -12,13 +21,96 @@ using namespace Vector_GM;
 // the DoCollisionResponse function uses a variation for computing impulses,
 // described in
 //   https://www.geometrictools.com/Documentation/ComputingImpulsiveForces.pdf
+//
+// The simulation runs on its own thread at the fixed rate
+// 1/mSimulationDeltaTime, independent of the frame rate. A
+// FixedStepScheduler executes at most 4 ticks per wake-up. After each tick
+// the thread publishes a snapshot of the sphere transforms through a
+// TripleBuffer. The render thread keeps the last two snapshots it acquired
+// and draws the spheres interpolated between them, one physics tick behind
+// the simulation, so the motion is smooth when the physics rate is not a
+// multiple of the display rate. The keys: 's' toggles single stepping, 'g'
+// advances one tick while single stepping, 'w' toggles wireframe, 'p'
+// writes the GPU times of the last frames to BouncingSpheresGPU.json as a
+// Chrome trace and 't' writes the latest CPU trace events of all threads
+// to BouncingSpheresCPU.json.
+//
+// All spheres are drawn by one instanced draw call of a unit sphere mesh.
+// The world matrix of each sphere, which includes its radius as a scale,
+// is written to the instance buffer of an InstancedTexture2Effect once per
+// frame. The number of spheres is a window parameter, which the
+// environment variable GTE_BOUNCING_SPHERES overrides, so stress tests can
+// vary it without recompiling.
+//
+// With CPU physics the spheres can be added and removed while the
+// simulation runs: '+' adds a quarter of the current number of spheres at
+// random positions and '-' removes a quarter of them at random, through
+// PhysicsModule::AddSphere and RemoveSphere. The render thread only
+// records the requests; the simulation thread applies them between ticks.
+// The instance buffer holds up to maxSpheres spheres, 4 times the initial
+// number when the parameter is 0, and the region keeps its initial size.
+// Each snapshot carries the sphere handles, and a sphere whose handle is
+// not at the same index in the previous snapshot is drawn without
+// interpolation.
+//
+// When the window parameter gpuPhysics is true, the spheres are simulated
+// by a GPUPhysicsModule instead, for numbers of spheres far beyond what the
+// CPU module handles. There is no simulation thread and no snapshot; the
+// window enables the fixed steps of WindowApplication, so the message loop
+// dispatches the physics programs at the fixed rate before each OnIdle
+// call, and the instance buffer of the sphere effect is the one that
+// the physics programs write, so the transforms never leave the GPU. The
+// spheres are drawn at the latest tick without interpolation.
+//
+// With CPU physics, 'c' starts and stops recording the simulation to
+// BouncingSpheres.gtrec, one frame per tick, by a PhysicsRecorder that the
+// simulation thread owns. When the environment variable
+// GTE_BOUNCING_SPHERES_REPLAY names a recording, the window replays it
+// instead of simulating. There is no simulation thread; each frame the
+// instance buffer is pointed at the matrices of the recorded frame at the
+// wall-clock time since the start, looped, so the engine copies them from
+// the mapped file to the GPU without any processing on the CPU. The region
+// and the maximum number of spheres are those of the recording.
+//
+// The textures are decoded by an AssetLoader while the physics objects are
+// created and the first frames are drawn. The floor and the spheres are
+// created and attached to the scene by the loader on the render thread when
+// their textures are ready, and the walls are drawn until then.
 
 class BouncingSpheresWindow3 : public Window3
 {
 public:
+	struct Parameters : public Window3::Parameters
+	{
+		Parameters()
+			:
+			Window3::Parameters(),
+			numSpheres(16),
+			maxSpheres(0),
+			gpuPhysics(false)
+		{
+		}
+
+		Parameters(std::wstring const& inTitle, int32_t inXOrigin, int32_t inYOrigin,
+			int32_t inXSize, int32_t inYSize, size_t inNumSpheres = 16,
+			bool inGPUPhysics = false, size_t inMaxSpheres = 0)
+			:
+			Window3::Parameters(inTitle, inXOrigin, inYOrigin, inXSize, inYSize),
+			numSpheres(inNumSpheres),
+			maxSpheres(inMaxSpheres),
+			gpuPhysics(inGPUPhysics)
+		{
+		}
+
+		size_t numSpheres, maxSpheres;
+		bool gpuPhysics;
+	};
+
 	BouncingSpheresWindow3(Parameters& parameters);
+	virtual ~BouncingSpheresWindow3();
 
 	virtual void OnIdle() override;
+	virtual void OnFixedStep(double time, double deltaTime) override;
 	virtual bool OnCharPress(uint8_t key, int32_t x, int32_t y) override;
 
 private:
@@ -48,6 +140,10 @@ private:
 		Vector4<float> color;
 	};
 
+	// The value of GTE_BOUNCING_SPHERES when it is a positive number, the
+	// parameter otherwise.
+	size_t GetInitialNumSpheres(size_t numSpheres) const;
+
 	bool SetEnvironment();
 	void CreateScene();
 	void CreatePhysicsObjects();
@@ -57,21 +153,79 @@ private:
 		Vector3<float> const& pos2, Vector3<float> const& pos3,
 		Vector4<float> const& color);
 
+	// The simulation thread executes SimulationLoop, which calls
+	// PhysicsTick at the fixed rate. PhysicsTick publishes the snapshot.
+	void SimulationLoop();
+	void ApplySphereRequests();
+	void AddRandomSphere(std::mt19937& mte);
 	void PhysicsTick();
+	void PublishSnapshot();
+	void UpdateRecording();
+
+	// GraphicsTick is called by OnIdle on the render thread.
 	void GraphicsTick();
+	void UpdateSphereTransforms();
+	void UpdateReplayTransforms();
+
+	// The simulation region is the cube [0,mRegionSize]^3. Its size grows
+	// with the initial number of spheres so that the initial density of the
+	// spheres is independent of the number.
+	size_t mNumSpheres, mMaxSpheres;
+	bool mGPUPhysics;
+	double mRegionSize;
+	std::unique_ptr<PhysicsModule<double>> mModule;
+	std::unique_ptr<GPUPhysicsModule> mGPUModule;
 
-	enum { NUM_SPHERES = 16 };
-	std::unique_ptr<PhysicsModule> mModule;
+	// The state of the spheres at a simulation time. The publish time is
+	// the wall-clock time at which the snapshot was produced.
+	struct Snapshot
+	{
+		double simulationTime;
+		std::chrono::steady_clock::time_point publishTime;
+		std::vector<Vector3<float>> position;
+		std::vector<Quaternion<float>> orientation;
+		std::vector<float> radius;
+		std::vector<size_t> handle;
+	};
 
 	std::shared_ptr<RasterizerState> mNoCullState;
 	std::shared_ptr<RasterizerState> mNoCullWireState;
 	std::shared_ptr<Node> mScene;
 	std::array<std::shared_ptr<Visual>, 4> mPlaneMesh;
-	std::array<std::shared_ptr<Visual>, NUM_SPHERES> mSphereMesh;
+	std::shared_ptr<Visual> mSphereMesh;
+	std::shared_ptr<InstancedTexture2Effect> mSphereEffect;
+	std::unique_ptr<gte::AssetLoader> mLoader;
+
+	// The GPU times of the planes, the spheres and the text overlay. The
+	// last GPU frames are kept for export as a Chrome trace ('p' key).
+	std::shared_ptr<GPUProfiler> mGPUProfiler;
 
-	Timer mPhysicsTimer, mGraphicsTimer;
-	double mLastPhysicsTime, mCurrPhysicsTime;
+	// Accessed only by the simulation thread once it is started, or by the
+	// render thread with GPU physics.
 	double mSimulationTime, mSimulationDeltaTime;
-	double mLastGraphicsTime, mCurrGraphicsTime;
-	bool mSingleStep;
+
+	// The snapshot channel and the last two snapshots acquired by the
+	// render thread.
+	TripleBuffer<Snapshot> mSnapshots;
+	Snapshot mPreviousSnapshot, mCurrentSnapshot;
+
+	std::thread mSimulationThread;
+	std::atomic<bool> mStopSimulation;
+	std::atomic<bool> mSingleStep;
+	std::atomic<size_t> mNumRequestedSteps;
+
+	// The net number of spheres to add (positive) or remove (negative),
+	// requested by the render thread. The simulation thread draws the
+	// new spheres and the removed handles from mSphereRandom.
+	std::atomic<int64_t> mRequestedSphereChange;
+	std::mt19937 mSphereRandom;
+
+	// Whether the render thread requested recording ('c' key). The
+	// simulation thread creates and destroys the recorder accordingly.
+	std::atomic<bool> mRecordRequested;
+	std::unique_ptr<PhysicsRecorder> mRecorder;
+
+	// The recording that is replayed and the wall-clock time of its start.
+	std::unique_ptr<PhysicsPlayer> mPlayer;
+	std::chrono::steady_clock::time_point mReplayStart;
 };
\ No newline at end of file
@@ -1,10 +1,20 @@
 
 #include "BoxSphereIntersectionWindow.h"
 #include "Graphics/MeshFactory.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
 
 IntersectBoxSphereWindow3::IntersectBoxSphereWindow3(Parameters& parameters)
 	:
-	Window3(parameters)
+	Window3(parameters),
+	mCrowdPath(KinematicBoxSphereScene::Path::BATCHED),
+	mNumCrowdThreads(std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+		static_cast<size_t>(1))),
+	mCrowdTime(0.0f),
+	mCrowdPaused(false),
+	mVerifyCrowd(false)
 {
 	mNoCullState = std::make_shared<RasterizerState>();
 	mNoCullState->cull = RasterizerState::Cull::NONE;
@@ -39,11 +49,31 @@ void IntersectBoxSphereWindow3::OnIdle()
 		mPVWMatrices.Update();
 	}
 
+	// The crowd moves by a fixed step per frame, so the frames are the
+	// same for every path.
+	if (!mCrowdPaused)
+	{
+		mCrowdTime += 1.0f / 60.0f;
+	}
+	TestCrowd();
+	UpdateCrowdTransforms();
+
 	mEngine->ClearBuffers();
 	mEngine->Draw(mSphereMesh);
 	mEngine->Draw(mBoxMesh);
-	mEngine->Draw(8, mYSize - 8, { 0.0f, 0.0f, 0.0f, 1.0f }, mTimer.GetFPS());
-	mEngine->DisplayColorBuffer(0);
+	for (auto const& mesh : mCrowdBoxMesh)
+	{
+		if (mesh->GetIndexBuffer()->GetNumInstances() > 0)
+		{
+			mEngine->Draw(mesh);
+		}
+	}
+	mEngine->Draw(mCrowdSphereMesh);
+
+	std::array<float, 4> const black{ 0.0f, 0.0f, 0.0f, 1.0f };
+	mEngine->Draw(8, mYSize - 8, black, mTimer.GetFPS());
+	mEngine->Draw(8, 24, black, mCrowdMessage);
+	mEngine->DisplayColorBuffer(GetSyncInterval());
 
 	mTimer.UpdateFrameCount();
 }
@@ -117,6 +147,24 @@ bool IntersectBoxSphereWindow3::OnCharPress(uint8_t key, int32_t x, int32_t y)
 	case 'H':  // rotate about axis[2]
 		Rotate(2, +delta);
 		return true;
+
+	case 'm':  // cycle the crowd paths
+	case 'M':
+		mCrowdPath = (mCrowdPath == KinematicBoxSphereScene::Path::SCALAR ?
+			KinematicBoxSphereScene::Path::BATCHED :
+			(mCrowdPath == KinematicBoxSphereScene::Path::BATCHED ?
+			KinematicBoxSphereScene::Path::THREADED : KinematicBoxSphereScene::Path::SCALAR));
+		return true;
+
+	case 'v':  // toggle the verification against the scalar path
+	case 'V':
+		mVerifyCrowd = !mVerifyCrowd;
+		return true;
+
+	case 's':  // pause the crowd
+	case 'S':
+		mCrowdPaused = !mCrowdPaused;
+		return true;
 	}
 
 	return Window3::OnCharPress(key, x, y);
@@ -157,9 +205,61 @@ void IntersectBoxSphereWindow3::CreateScene()
 
 	mTrackBall.Attach(mSphereMesh);
 	mTrackBall.Attach(mBoxMesh);
+	CreateCrowd();
 	mTrackBall.Update();
 }
 
+void IntersectBoxSphereWindow3::CreateCrowd()
+{
+	// The crowd is in the cube of half-size 24 behind the single box and
+	// sphere, as seen from the initial camera position.
+	size_t const numBoxes = 2048, numSpheres = 2048;
+	mCrowd = std::make_unique<KinematicBoxSphereScene>(numBoxes, numSpheres,
+		Vector3<float>{ 0.0f, 0.0f, 48.0f }, 24.0f);
+
+	// The boxes and the spheres are instances of the unit box and the unit
+	// sphere. The instance matrices are relative to the trackball node, so
+	// the visuals have the identity transform, and they must not be culled.
+	VertexFormat vformat;
+	vformat.Bind(VASemantic::POSITION, DF_R32G32B32_FLOAT, 0);
+	vformat.Bind(VASemantic::TEXCOORD, DF_R32G32_FLOAT, 0);
+	MeshFactory mf;
+	mf.SetVertexFormat(vformat);
+
+	std::array<uint32_t, 2> const boxColors = { 0xFF800000, 0xFF0000C0 };
+	for (size_t i = 0; i < 2; ++i)
+	{
+		mCrowdBoxMesh[i] = mf.CreateBox(1.0f, 1.0f, 1.0f);
+		mCrowdBoxEffect[i] = CreateCrowdEffect(boxColors[i], static_cast<uint32_t>(numBoxes));
+		mCrowdBoxMesh[i]->SetEffect(mCrowdBoxEffect[i]);
+		mCrowdBoxMesh[i]->culling = CullingMode::NEVER;
+		mPVWMatrices.Subscribe(mCrowdBoxMesh[i]->worldTransform,
+			mCrowdBoxEffect[i]->GetPVWMatrixConstant());
+		mTrackBall.Attach(mCrowdBoxMesh[i]);
+	}
+
+	mCrowdSphereMesh = mf.CreateSphere(8, 8, 1.0f);
+	mCrowdSphereEffect = CreateCrowdEffect(0xFF00A000, static_cast<uint32_t>(numSpheres));
+	mCrowdSphereMesh->SetEffect(mCrowdSphereEffect);
+	mCrowdSphereMesh->culling = CullingMode::NEVER;
+	mPVWMatrices.Subscribe(mCrowdSphereMesh->worldTransform,
+		mCrowdSphereEffect->GetPVWMatrixConstant());
+	mTrackBall.Attach(mCrowdSphereMesh);
+
+	TestCrowd();
+	UpdateCrowdTransforms();
+}
+
+std::shared_ptr<InstancedTexture2Effect> IntersectBoxSphereWindow3::CreateCrowdEffect(
+	uint32_t color, uint32_t maxNumInstances)
+{
+	auto texture = std::make_shared<Texture2>(DF_R8G8B8A8_UNORM, 1, 1);
+	*texture->Get<uint32_t>() = color;
+	return std::make_shared<InstancedTexture2Effect>(mProgramFactory, texture,
+		SamplerState::Filter::MIN_P_MAG_P_MIP_P, SamplerState::Mode::CLAMP,
+		SamplerState::Mode::CLAMP, maxNumInstances);
+}
+
 void IntersectBoxSphereWindow3::Translate(int32_t direction, float delta)
 {
 	mBox.center[direction] += delta;
@@ -204,3 +304,95 @@ void IntersectBoxSphereWindow3::TestIntersection()
 		mPVWMatrices.Subscribe(mBoxMesh->worldTransform, mBlueEffect->GetPVWMatrixConstant());
 	}
 }
+
+void IntersectBoxSphereWindow3::TestCrowd()
+{
+	mCrowd->Update(mCrowdTime);
+
+	// The verification runs the scalar path first, untimed, so its counts
+	// are the reference of the timed path.
+	bool const verify = (mVerifyCrowd && mCrowdPath != KinematicBoxSphereScene::Path::SCALAR);
+	if (verify)
+	{
+		mCrowd->Test(KinematicBoxSphereScene::Path::SCALAR);
+		mCrowdReference = mCrowd->GetBoxOverlaps();
+	}
+
+	auto const start = std::chrono::steady_clock::now();
+	size_t const numOverlaps = mCrowd->Test(mCrowdPath, mNumCrowdThreads);
+	double const milliseconds = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+
+	char const* pathName = (mCrowdPath == KinematicBoxSphereScene::Path::SCALAR ? "scalar" :
+		(mCrowdPath == KinematicBoxSphereScene::Path::BATCHED ? "batched" : "threaded"));
+	size_t const numThreads = (mCrowdPath == KinematicBoxSphereScene::Path::THREADED ?
+		mNumCrowdThreads : 1);
+	double const rate = (milliseconds > 0.0 ?
+		static_cast<double>(mCrowd->GetNumTests()) / milliseconds : 0.0);
+	char line[192];
+	int32_t length = std::snprintf(line, sizeof(line),
+		"%s, %zu thread(s): %zu queries in %.2f ms, %.0f queries/ms, %zu overlaps",
+		pathName, numThreads, mCrowd->GetNumTests(), milliseconds, rate, numOverlaps);
+	if (verify && length > 0 && static_cast<size_t>(length) < sizeof(line))
+	{
+		std::snprintf(line + length, sizeof(line) - length, ", %zu mismatches",
+			mCrowd->CountMismatches(mCrowdReference));
+	}
+	mCrowdMessage = line;
+}
+
+void IntersectBoxSphereWindow3::UpdateCrowdTransforms()
+{
+	// The world matrix of a box instance scales the unit box by the extents
+	// and rotates it to the box axes; that of a sphere instance scales the
+	// unit sphere by the radius.
+	std::vector<OrientedBox3<float>> const& boxes = mCrowd->GetBoxes();
+	std::vector<uint32_t> const& overlaps = mCrowd->GetBoxOverlaps();
+	std::array<Matrix4x4<float>*, 2> boxWorld =
+	{
+		mCrowdBoxEffect[0]->GetInstanceBuffer()->Get<Matrix4x4<float>>(),
+		mCrowdBoxEffect[1]->GetInstanceBuffer()->Get<Matrix4x4<float>>()
+	};
+	std::array<uint32_t, 2> numBoxInstances = { 0, 0 };
+	Transform<float> transform{};
+	Matrix3x3<float> rotate{};
+	for (size_t b = 0; b < boxes.size(); ++b)
+	{
+		OrientedBox3<float> const& box = boxes[b];
+		for (int32_t i = 0; i < 3; ++i)
+		{
+#if defined(GTE_USE_MAT_VEC)
+			rotate.SetCol(i, box.axis[i]);
+#else
+			rotate.SetRow(i, box.axis[i]);
+#endif
+		}
+		transform.SetRotation(rotate);
+		transform.SetScale(box.extent);
+		transform.SetTranslation(box.center);
+
+		size_t const hit = (overlaps[b] > 0 ? 1 : 0);
+		boxWorld[hit][numBoxInstances[hit]++] = transform.GetHMatrix();
+	}
+
+	SphereArray3<float> const& spheres = mCrowd->GetSpheres();
+	Matrix4x4<float>* sphereWorld = mCrowdSphereEffect->GetInstanceBuffer()->Get<Matrix4x4<float>>();
+	transform.MakeIdentity();
+	for (size_t s = 0; s < spheres.size(); ++s)
+	{
+		transform.SetTranslation(spheres.center[0][s], spheres.center[1][s], spheres.center[2][s]);
+		transform.SetUniformScale(spheres.radius[s]);
+		sphereWorld[s] = transform.GetHMatrix();
+	}
+
+	for (size_t i = 0; i < 2; ++i)
+	{
+		mCrowdBoxEffect[i]->GetInstanceBuffer()->SetNumActiveElements(numBoxInstances[i]);
+		mCrowdBoxMesh[i]->GetIndexBuffer()->SetNumInstances(numBoxInstances[i]);
+		mEngine->Update(mCrowdBoxEffect[i]->GetInstanceBuffer());
+	}
+	uint32_t const numSphereInstances = static_cast<uint32_t>(spheres.size());
+	mCrowdSphereEffect->GetInstanceBuffer()->SetNumActiveElements(numSphereInstances);
+	mCrowdSphereMesh->GetIndexBuffer()->SetNumInstances(numSphereInstances);
+	mEngine->Update(mCrowdSphereEffect->GetInstanceBuffer());
+}
@@ -3,9 +3,27 @@
 
 #include "Applications/Window3.h"
 #include "Graphics/ConstantColorEffect.h"
-#include "IntrOrientedBox3Sphere3.h"
+#include "Graphics/InstancedTexture2Effect.h"
+#include "IntrOrientedBoxShere.h"
+#include "KinematicBoxSphereScene.h"
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
 using namespace Vector_GM;
 
+// The window shows a single box and sphere that are moved with the keys
+// and, behind them, a crowd of oriented boxes and spheres on scripted
+// paths (KinematicBoxSphereScene). Every frame the crowd is moved and all
+// its sphere-box pairs are tested on the current path, and the overlay
+// shows the throughput in queries per millisecond. The boxes that overlap
+// a sphere are red and the others blue; the boxes and the spheres are
+// drawn by instanced draw calls.
+//
+// The keys of the crowd: 'm' cycles the scalar, batched and threaded
+// paths, 'v' toggles the verification, which also runs the scalar path
+// each frame and reports the number of boxes whose overlap counts differ,
+// and 's' pauses the motion.
 class IntersectBoxSphereWindow3 : public Window3
 {
 public:
@@ -16,9 +34,14 @@ public:
 
 private:
 	void CreateScene();
+	void CreateCrowd();
+	std::shared_ptr<InstancedTexture2Effect> CreateCrowdEffect(uint32_t color,
+		uint32_t maxNumInstances);
 	void Translate(int32_t direction, float delta);
 	void Rotate(int32_t direction, float delta);
 	void TestIntersection();
+	void TestCrowd();
+	void UpdateCrowdTransforms();
 
 	std::shared_ptr<RasterizerState> mNoCullState;
 	std::shared_ptr<RasterizerState> mNoCullWireState;
@@ -28,4 +51,18 @@ private:
 	Sphere3<float> mSphere;
 	OrientedBox3<float> mBox;
 	TIQuery<float, OrientedBox3<float>, Sphere3<float>> mQuery;
+
+	// The crowd. The box meshes are those of the boxes that overlap a
+	// sphere (index 1) and of those that do not (index 0).
+	std::unique_ptr<KinematicBoxSphereScene> mCrowd;
+	std::array<std::shared_ptr<Visual>, 2> mCrowdBoxMesh;
+	std::array<std::shared_ptr<InstancedTexture2Effect>, 2> mCrowdBoxEffect;
+	std::shared_ptr<Visual> mCrowdSphereMesh;
+	std::shared_ptr<InstancedTexture2Effect> mCrowdSphereEffect;
+	KinematicBoxSphereScene::Path mCrowdPath;
+	size_t mNumCrowdThreads;
+	float mCrowdTime;
+	bool mCrowdPaused, mVerifyCrowd;
+	std::vector<uint32_t> mCrowdReference;
+	std::string mCrowdMessage;
 };
@@ -12,7 +12,7 @@
 
 namespace Vector_GM
 {
-	template <int32_t N, typename T>
+	template <typename T, size_t N>
 	class CanonicalBox
 	{
 	public:
@@ -23,7 +23,7 @@ namespace Vector_GM
 		{
 		}
 
-		CanonicalBox(Vector<N, T> const& inExtent)
+		CanonicalBox(Vector<T, N> const& inExtent)
 			:
 			extent(inExtent)
 		{
@@ -33,13 +33,13 @@ namespace Vector_GM
 		// i = b[N-1]...b[0], then the corner at index i is
 		//   vertex[i] = center + sum_{d=0}^{N-1} sign[d]*extent[d]*axis[d]
 		// where sign[d] = 2*b[d] - 1.
-		void GetVertices(std::array<Vector<N, T>, (1 << N)>& vertex) const
+		void GetVertices(std::array<Vector<T, N>, (size_t(1) << N)>& vertex) const
 		{
-			int32_t const imax = (1 << N);
-			for (int32_t i = 0; i < imax; ++i)
+			size_t const imax = (size_t(1) << N);
+			for (size_t i = 0; i < imax; ++i)
 			{
-				vertex[i].MakeZero();
-				for (int32_t d = 0, mask = 1; d < N; ++d, mask <<= 1)
+				MakeZero(vertex[i]);
+				for (size_t d = 0, mask = 1; d < N; ++d, mask <<= 1)
 				{
 					if ((i & mask) > 0)
 					{
@@ -54,47 +54,47 @@ namespace Vector_GM
 		}
 
 		// It is required that extent[i] >= 0.
-		Vector<N, T> extent;
+		Vector<T, N> extent;
 	};
 
 	// Comparisons to support sorted containers.
 	template <typename T, size_t N>
-	bool operator==(CanonicalBox<N, T> const& box0, CanonicalBox<N, T> const& box1)
+	bool operator==(CanonicalBox<T, N> const& box0, CanonicalBox<T, N> const& box1)
 	{
 		return box0.extent == box1.extent;
 	}
 
 	template <typename T, size_t N>
-	bool operator!=(CanonicalBox<N, T> const& box0, CanonicalBox<N, T> const& box1)
+	bool operator!=(CanonicalBox<T, N> const& box0, CanonicalBox<T, N> const& box1)
 	{
 		return !operator==(box0, box1);
 	}
 
 	template <typename T, size_t N>
-	bool operator<(CanonicalBox<N, T> const& box0, CanonicalBox<N, T> const& box1)
+	bool operator<(CanonicalBox<T, N> const& box0, CanonicalBox<T, N> const& box1)
 	{
 		return box0.extent < box1.extent;
 	}
 
 	template <typename T, size_t N>
-	bool operator<=(CanonicalBox<N, T> const& box0, CanonicalBox<N, T> const& box1)
+	bool operator<=(CanonicalBox<T, N> const& box0, CanonicalBox<T, N> const& box1)
 	{
 		return !operator<(box1, box0);
 	}
 
 	template <typename T, size_t N>
-	bool operator>(CanonicalBox<N, T> const& box0, CanonicalBox<N, T> const& box1)
+	bool operator>(CanonicalBox<T, N> const& box0, CanonicalBox<T, N> const& box1)
 	{
 		return operator<(box1, box0);
 	}
 
 	template <typename T, size_t N>
-	bool operator>=(CanonicalBox<N, T> const& box0, CanonicalBox<N, T> const& box1)
+	bool operator>=(CanonicalBox<T, N> const& box0, CanonicalBox<T, N> const& box1)
 	{
 		return !operator<(box0, box1);
 	}
 
 	// Template aliases for convenience.
-	template <typename T> using CanonicalBox2 = CanonicalBox<2, T>;
-	template <typename T> using CanonicalBox3 = CanonicalBox<3, T>;
+	template <typename T> using CanonicalBox2 = CanonicalBox<T, 2>;
+	template <typename T> using CanonicalBox3 = CanonicalBox<T, 3>;
 }
@@ -3,7 +3,7 @@
 
 #include <cstdint>
 
-namespace gte
+namespace Vector_GM
 {
 	// Distance and closest-point queries.
 	template <typename Real, typename Type0, typename Type1>
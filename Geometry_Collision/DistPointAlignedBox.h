@@ -6,6 +6,7 @@
 
 
 #include "AlignedBox.h"
+#include <utility>
 
 // Compute the distance from a point to a solid aligned box in nD.
 // 
@@ -18,24 +19,23 @@
 
 namespace Vector_GM
 {
-    template <int32_t N, typename T>
-    class DCPQuery<T, Vector<N, T>,
-    AlignedBox<N, T>>
+    template <typename T, size_t N>
+    class DCPQuery<T, Vector<T, N>, AlignedBox<T, N>>
     {
     public:
-        using PCQuery = DCPQuery<T, Vector<N, T>, CanonicalBox<N, T>>;
+        using PCQuery = DCPQuery<T, Vector<T, N>, CanonicalBox<T, N>>;
         using Result = typename PCQuery::Result;
 
-        Result operator()(Vector<N, T> const& point, AlignedBox<N, T> const& box)
+        Result operator()(Vector<T, N> const& point, AlignedBox<T, N> const& box)
         {
             Result result{};
 
             // Translate the point and box so that the box has center at the
             // origin.
-            Vector<N, T> boxCenter{};
-            CanonicalBox<N, T> cbox{};
+            Vector<T, N> boxCenter{};
+            CanonicalBox<T, N> cbox{};
             box.GetCenteredForm(boxCenter, cbox.extent);
-            Vector<N, T> xfrmPoint = point - boxCenter;
+            Vector<T, N> xfrmPoint = point - boxCenter;
 
             // The query computes 'output' relative to the box with center
             // at the origin.
@@ -50,15 +50,63 @@ namespace Vector_GM
 
             return result;
         }
+
+        // Lightweight versions of the query for callers that need only the
+        // squared distance, or the squared distance and the closest box
+        // point. The centered form is computed one component at a time, so
+        // the squared distance is the same as that of operator().
+        T SqrDistance(Vector<T, N> const& point, AlignedBox<T, N> const& box)
+        {
+            return SqrDistance(point, box, std::make_index_sequence<N>{});
+        }
+
+        T SqrDistance(Vector<T, N> const& point, AlignedBox<T, N> const& box,
+            Vector<T, N>& closest)
+        {
+            return SqrDistance(point, box, closest, std::make_index_sequence<N>{});
+        }
+
+    private:
+        // The difference of the point and its closest box point in
+        // dimension i, relative to the box center.
+        static inline T Delta(Vector<T, N> const& point, AlignedBox<T, N> const& box,
+            size_t i, T& center, T& clamped)
+        {
+            T const half = static_cast<T>(0.5);
+            center = (box.max[i] + box.min[i]) * half;
+            T extent = (box.max[i] - box.min[i]) * half;
+            T xfrmPoint = point[i] - center;
+            clamped = PCQuery::Clamp(xfrmPoint, extent);
+            return xfrmPoint - clamped;
+        }
+
+        template <size_t... I>
+        static inline T SqrDistance(Vector<T, N> const& point, AlignedBox<T, N> const& box,
+            std::index_sequence<I...>)
+        {
+            T center[N], clamped[N];
+            T const delta[N] = { Delta(point, box, I, center[I], clamped[I])... };
+            return (... + (delta[I] * delta[I]));
+        }
+
+        template <size_t... I>
+        static inline T SqrDistance(Vector<T, N> const& point, AlignedBox<T, N> const& box,
+            Vector<T, N>& closest, std::index_sequence<I...>)
+        {
+            T center[N], clamped[N];
+            T const delta[N] = { Delta(point, box, I, center[I], clamped[I])... };
+            ((closest[I] = clamped[I] + center[I]), ...);
+            return (... + (delta[I] * delta[I]));
+        }
     };
 
     // Template aliases for convenience.
-    template <int32_t N, typename T>
-    using DCPPointAlignedBox = DCPQuery<T, Vector<N, T>, AlignedBox<N, T>>;
+    template <typename T, size_t N>
+    using DCPPointAlignedBox = DCPQuery<T, Vector<T, N>, AlignedBox<T, N>>;
 
     template <typename T>
-    using DCPPoint2AlignedBox2 = DCPPointAlignedBox<2, T>;
+    using DCPPoint2AlignedBox2 = DCPPointAlignedBox<T, 2>;
 
     template <typename T>
-    using DCPPoint3AlignedBox3 = DCPPointAlignedBox<3, T>;
+    using DCPPoint3AlignedBox3 = DCPPointAlignedBox<T, 3>;
 }
\ No newline at end of file
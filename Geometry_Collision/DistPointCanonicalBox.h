@@ -5,6 +5,8 @@
 
 #include "DCPQuery.h"
 #include "CanonicalBox.h"
+#include <algorithm>
+#include <utility>
 
 // Compute the distance from a point to a solid canonical box in nD.
 // 
@@ -15,11 +17,18 @@
 // The input point P is stored in closest[0]. The closest point on the box
 // is stored in closest[1]. When there are infinitely many choices for the
 // pair of closest points, only one of them is returned.
+//
+// The loops over the dimensions are expanded at compile time and each
+// component of the point is clamped to [-e[i],e[i]] with min and max
+// rather than branches, so the 2D, 3D and 4D queries compile to
+// straight-line code. The clamped difference is zero for a component
+// inside the box, so the squared distances are those of the branching
+// implementation.
 
 namespace Vector_GM
 {
-	template <int32_t N, typename T>
-	class DCPQuery<T, Vector<N, T>, CanonicalBox<N, T>>
+	template <typename T, size_t N>
+	class DCPQuery<T, Vector<T, N>, CanonicalBox<T, N>>
 	{
 	public:
 		struct Result
@@ -28,50 +37,72 @@ namespace Vector_GM
 				:
 				distance(static_cast<T>(0)),
 				sqrDistance(static_cast<T>(0)),
-				closest{ Vector<N, T>::Zero(), Vector<N, T>::Zero() }
+				closest{ Vector<T, N>::Zero(), Vector<T, N>::Zero() }
 			{
 			}
 
 			T distance, sqrDistance;
-			std::array<Vector<N, T>, 2> closest;
+			std::array<Vector<T, N>, 2> closest;
 		};
 
-		Result operator()(Vector<N, T> const& point, CanonicalBox<N, T> const& box)
+		Result operator()(Vector<T, N> const& point, CanonicalBox<T, N> const& box)
 		{
 			Result result{};
 
 			result.closest[0] = point;
-			result.closest[1] = point;
-			result.sqrDistance = static_cast<T>(0);
-			for (int32_t i = 0; i < N; ++i)
-			{
-				if (point[i] < -box.extent[i])
-				{
-					T delta = result.closest[1][i] + box.extent[i];
-					result.sqrDistance += delta * delta;
-					result.closest[1][i] = -box.extent[i];
-				}
-				else if (point[i] > box.extent[i])
-				{
-					T delta = result.closest[1][i] - box.extent[i];
-					result.sqrDistance += delta * delta;
-					result.closest[1][i] = box.extent[i];
-				}
-			}
+			result.sqrDistance = SqrDistance(point, box, result.closest[1]);
 			result.distance = std::sqrt(result.sqrDistance);
 
 			return result;
 		}
+
+		// Lightweight versions of the query for callers that need only the
+		// squared distance, or the squared distance and the closest box
+		// point. They compute no square root and no Result. The squared
+		// distance is the same as that of operator().
+		T SqrDistance(Vector<T, N> const& point, CanonicalBox<T, N> const& box)
+		{
+			return SqrDistance(point, box.extent, std::make_index_sequence<N>{});
+		}
+
+		T SqrDistance(Vector<T, N> const& point, CanonicalBox<T, N> const& box,
+			Vector<T, N>& closest)
+		{
+			return SqrDistance(point, box.extent, closest, std::make_index_sequence<N>{});
+		}
+
+		// The closest point of the interval [-extent,extent] to x.
+		static inline T Clamp(T const& x, T const& extent)
+		{
+			return std::min(std::max(x, -extent), extent);
+		}
+
+	private:
+		template <size_t... I>
+		static inline T SqrDistance(Vector<T, N> const& point, Vector<T, N> const& extent,
+			std::index_sequence<I...>)
+		{
+			T const delta[N] = { (point[I] - Clamp(point[I], extent[I]))... };
+			return (... + (delta[I] * delta[I]));
+		}
+
+		template <size_t... I>
+		static inline T SqrDistance(Vector<T, N> const& point, Vector<T, N> const& extent,
+			Vector<T, N>& closest, std::index_sequence<I...>)
+		{
+			((closest[I] = Clamp(point[I], extent[I])), ...);
+			T const delta[N] = { (point[I] - closest[I])... };
+			return (... + (delta[I] * delta[I]));
+		}
 	};
 
 	// Template aliases for convenience.
-	template <int32_t N, typename T>
-	using DCPPointCanonicalBox = DCPQuery<T, Vector<N, T>, CanonicalBox<N, T>>;
+	template <typename T, size_t N>
+	using DCPPointCanonicalBox = DCPQuery<T, Vector<T, N>, CanonicalBox<T, N>>;
 
 	template <typename T>
-	using DCPPoint2CanonicalBox2 = DCPPointCanonicalBox<2, T>;
+	using DCPPoint2CanonicalBox2 = DCPPointCanonicalBox<T, 2>;
 
 	template <typename T>
-	using DCPPoint3CanonicalBox3 = DCPPointCanonicalBox<3, T>;
+	using DCPPoint3CanonicalBox3 = DCPPointCanonicalBox<T, 3>;
 }
-
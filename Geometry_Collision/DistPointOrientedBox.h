@@ -18,26 +18,22 @@
 
 namespace Vector_GM
 {
-	template <int32_t N, typename T>
-	class DCPQuery<T, Vector<N, T>, OrientedBox<N, T>>
+	template <typename T, size_t N>
+	class DCPQuery<T, Vector<T, N>, OrientedBox<T, N>>
 	{
 	public:
-		using PCQuery = DCPQuery<T, Vector<N, T>, CanonicalBox<N, T>>;
+		using PCQuery = DCPQuery<T, Vector<T, N>, CanonicalBox<T, N>>;
 		using Result = typename PCQuery::Result;
 
-		Result operator()(Vector<N, T> const& point, OrientedBox<N, T> const& box)
+		Result operator()(Vector<T, N> const& point, OrientedBox<T, N> const& box)
 		{
 			Result result{};
 
 			// Rotate and translate the point and box so that the box is
 			// aligned and has center at the origin.
-			CanonicalBox<N, T> cbox(box.extent);
-			Vector<N, T> delta = point - box.center;
-			Vector<N, T> xfrmPoint{};
-			for (int32_t i = 0; i < N; ++i)
-			{
-				xfrmPoint[i] = Dot(box.axis[i], delta);
-			}
+			CanonicalBox<T, N> cbox(box.extent);
+			Vector<T, N> xfrmPoint{};
+			TransformToBox(point, box, xfrmPoint);
 
 			// The query computes 'result' relative to the box with center
 			// at the origin.
@@ -49,8 +45,8 @@ namespace Vector_GM
 
 			// Rotate and translate the closest box point to the original
 			// coordinates.
-			Vector<N, T> closest1 = box.center;
-			for (int32_t i = 0; i < N; ++i)
+			Vector<T, N> closest1 = box.center;
+			for (size_t i = 0; i < N; ++i)
 			{
 				closest1 += result.closest[1][i] * box.axis[i];
 			}
@@ -58,15 +54,54 @@ namespace Vector_GM
 
 			return result;
 		}
+
+		// Lightweight versions of the query for callers that need only the
+		// squared distance, or the squared distance and the closest box
+		// point. The squared distance is the same as that of operator().
+		T SqrDistance(Vector<T, N> const& point, OrientedBox<T, N> const& box)
+		{
+			Vector<T, N> xfrmPoint{};
+			TransformToBox(point, box, xfrmPoint);
+			return PCQuery{}.SqrDistance(xfrmPoint, CanonicalBox<T, N>(box.extent));
+		}
+
+		T SqrDistance(Vector<T, N> const& point, OrientedBox<T, N> const& box,
+			Vector<T, N>& closest)
+		{
+			Vector<T, N> xfrmPoint{}, xfrmClosest{};
+			TransformToBox(point, box, xfrmPoint);
+			T sqrDistance = PCQuery{}.SqrDistance(xfrmPoint,
+				CanonicalBox<T, N>(box.extent), xfrmClosest);
+
+			closest = box.center;
+			for (size_t i = 0; i < N; ++i)
+			{
+				closest += xfrmClosest[i] * box.axis[i];
+			}
+			return sqrDistance;
+		}
+
+	private:
+		// Compute the coordinates of the point relative to the box center
+		// and axes.
+		static void TransformToBox(Vector<T, N> const& point,
+			OrientedBox<T, N> const& box, Vector<T, N>& xfrmPoint)
+		{
+			Vector<T, N> delta = point - box.center;
+			for (size_t i = 0; i < N; ++i)
+			{
+				xfrmPoint[i] = Dot(box.axis[i], delta);
+			}
+		}
 	};
 
 	// Template aliases for convenience.
-	template <int32_t N, typename T>
-	using DCPPointOrientedBox = DCPQuery<T, Vector<N, T>, OrientedBox<N, T>>;
+	template <typename T, size_t N>
+	using DCPPointOrientedBox = DCPQuery<T, Vector<T, N>, OrientedBox<T, N>>;
 
 	template <typename T>
-	using DCPPoint2OrientedBox2 = DCPPointOrientedBox<2, T>;
+	using DCPPoint2OrientedBox2 = DCPPointOrientedBox<T, 2>;
 
 	template <typename T>
-	using DCPPoint3OrientedBox3 = DCPPointOrientedBox<3, T>;
+	using DCPPoint3OrientedBox3 = DCPPointOrientedBox<T, 3>;
 }
\ No newline at end of file
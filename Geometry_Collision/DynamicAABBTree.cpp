@@ -0,0 +1,552 @@
+#include "DynamicAABBTree.h"
+#include <algorithm>
+
+template <typename Real>
+DynamicAABBTree<Real>::DynamicAABBTree()
+	:
+	mNodes{},
+	mRoot(invalid),
+	mFreeList(invalid),
+	mNumLeaves(0),
+	mPairStack{}
+{
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::Clear()
+{
+	mNodes.clear();
+	mRoot = invalid;
+	mFreeList = invalid;
+	mNumLeaves = 0;
+}
+
+template <typename Real>
+size_t DynamicAABBTree<Real>::Insert(gte::AlignedBox3<Real> const& box,
+	size_t userData, Real margin)
+{
+	size_t leaf = AllocateNode();
+	Node& node = mNodes[leaf];
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		node.box.min[d] = box.min[d] - margin;
+		node.box.max[d] = box.max[d] + margin;
+	}
+	node.userData = userData;
+	node.height = 0;
+	InsertLeaf(leaf);
+	++mNumLeaves;
+	return leaf;
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::Remove(size_t proxy)
+{
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	--mNumLeaves;
+}
+
+template <typename Real>
+bool DynamicAABBTree<Real>::Move(size_t proxy, gte::AlignedBox3<Real> const& box,
+	Vector3<Real> const& displacement, Real margin)
+{
+	if (Contains(mNodes[proxy].box, box))
+	{
+		return false;
+	}
+
+	RemoveLeaf(proxy);
+	gte::AlignedBox3<Real>& fatBox = mNodes[proxy].box;
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		fatBox.min[d] = box.min[d] - margin;
+		fatBox.max[d] = box.max[d] + margin;
+		if (displacement[d] < static_cast<Real>(0))
+		{
+			fatBox.min[d] += displacement[d];
+		}
+		else
+		{
+			fatBox.max[d] += displacement[d];
+		}
+	}
+	InsertLeaf(proxy);
+	return true;
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::Refit(size_t proxy, gte::AlignedBox3<Real> const& box,
+	Real margin)
+{
+	gte::AlignedBox3<Real>& fatBox = mNodes[proxy].box;
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		fatBox.min[d] = box.min[d] - margin;
+		fatBox.max[d] = box.max[d] + margin;
+	}
+
+	for (size_t i = mNodes[proxy].parent; i != invalid; i = mNodes[i].parent)
+	{
+		UpdateNode(i);
+	}
+}
+
+template <typename Real>
+Real DynamicAABBTree<Real>::ComputeAreaRatio() const
+{
+	if (mRoot == invalid)
+	{
+		return static_cast<Real>(0);
+	}
+
+	Real rootArea = Area(mNodes[mRoot].box);
+	Real totalArea = static_cast<Real>(0);
+	for (auto const& node : mNodes)
+	{
+		if (node.height > 0)
+		{
+			totalArea += Area(node.box);
+		}
+	}
+	return (rootArea > static_cast<Real>(0) ? totalArea / rootArea : static_cast<Real>(0));
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::ComputePairs(std::vector<std::pair<size_t, size_t>>& pairs)
+{
+	// Self-intersect the tree. A stack entry (i,i) stands for the pairs
+	// within the subtree of node i and an entry (i0,i1), i0 != i1, for the
+	// pairs between the disjoint subtrees of i0 and i1, whose boxes are
+	// known to overlap. The larger of two internal nodes is descended,
+	// which keeps the boxes of a pair of similar size.
+	pairs.clear();
+	if (mRoot == invalid)
+	{
+		return;
+	}
+
+	gte::TIQuery<Real, gte::AlignedBox3<Real>, gte::AlignedBox3<Real>> query{};
+	auto push = [this, &query](size_t i0, size_t i1)
+	{
+		if (query(mNodes[i0].box, mNodes[i1].box).intersect)
+		{
+			mPairStack.emplace_back(i0, i1);
+		}
+	};
+
+	mPairStack.clear();
+	mPairStack.emplace_back(mRoot, mRoot);
+	while (!mPairStack.empty())
+	{
+		auto const entry = mPairStack.back();
+		mPairStack.pop_back();
+		Node const& node0 = mNodes[entry.first];
+		Node const& node1 = mNodes[entry.second];
+
+		if (entry.first == entry.second)
+		{
+			if (!node0.IsLeaf())
+			{
+				mPairStack.emplace_back(node0.child[0], node0.child[0]);
+				mPairStack.emplace_back(node0.child[1], node0.child[1]);
+				push(node0.child[0], node0.child[1]);
+			}
+		}
+		else if (node0.IsLeaf() && node1.IsLeaf())
+		{
+			pairs.emplace_back(std::min(node0.userData, node1.userData),
+				std::max(node0.userData, node1.userData));
+		}
+		else if (node0.IsLeaf() || (!node1.IsLeaf() && Area(node1.box) > Area(node0.box)))
+		{
+			push(entry.first, node1.child[0]);
+			push(entry.first, node1.child[1]);
+		}
+		else
+		{
+			push(node0.child[0], entry.second);
+			push(node0.child[1], entry.second);
+		}
+	}
+	std::sort(pairs.begin(), pairs.end());
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::Query(gte::AlignedBox3<Real> const& box,
+	std::vector<size_t>& userData) const
+{
+	userData.clear();
+	if (mRoot == invalid)
+	{
+		return;
+	}
+
+	gte::TIQuery<Real, gte::AlignedBox3<Real>, gte::AlignedBox3<Real>> query{};
+	std::vector<size_t> stack{};
+	stack.reserve(64);
+	stack.push_back(mRoot);
+	while (!stack.empty())
+	{
+		Node const& node = mNodes[stack.back()];
+		stack.pop_back();
+		if (query(node.box, box).intersect)
+		{
+			if (node.IsLeaf())
+			{
+				userData.push_back(node.userData);
+			}
+			else
+			{
+				stack.push_back(node.child[0]);
+				stack.push_back(node.child[1]);
+			}
+		}
+	}
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::RayCast(Vector3<Real> const& origin,
+	Vector3<Real> const& direction, Real tMax,
+	std::vector<std::pair<Real, size_t>>& hits) const
+{
+	hits.clear();
+	if (mRoot == invalid)
+	{
+		return;
+	}
+
+	std::vector<size_t> stack{};
+	stack.reserve(64);
+	stack.push_back(mRoot);
+	while (!stack.empty())
+	{
+		Node const& node = mNodes[stack.back()];
+		stack.pop_back();
+		Real t0 = static_cast<Real>(0), t1 = tMax;
+		if (ClipSegment(node.box, origin, direction, t0, t1))
+		{
+			if (node.IsLeaf())
+			{
+				hits.emplace_back(t0, node.userData);
+			}
+			else
+			{
+				stack.push_back(node.child[0]);
+				stack.push_back(node.child[1]);
+			}
+		}
+	}
+	std::sort(hits.begin(), hits.end());
+}
+
+template <typename Real>
+size_t DynamicAABBTree<Real>::AllocateNode()
+{
+	size_t i;
+	if (mFreeList != invalid)
+	{
+		i = mFreeList;
+		mFreeList = mNodes[i].parent;
+	}
+	else
+	{
+		i = mNodes.size();
+		mNodes.emplace_back();
+	}
+
+	Node& node = mNodes[i];
+	node.parent = invalid;
+	node.child[0] = invalid;
+	node.child[1] = invalid;
+	node.userData = invalid;
+	node.height = 0;
+	return i;
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::FreeNode(size_t i)
+{
+	mNodes[i].parent = mFreeList;
+	mNodes[i].height = -1;
+	mFreeList = i;
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::InsertLeaf(size_t leaf)
+{
+	if (mRoot == invalid)
+	{
+		mRoot = leaf;
+		mNodes[leaf].parent = invalid;
+		return;
+	}
+
+	// Descend to the sibling of least SAH cost. Pairing the leaf with the
+	// current node costs the area of the merged box. Descending costs the
+	// growth of the current box, which every path below it inherits, plus
+	// the cost of the best choice in the child, bounded below by the
+	// growth of the child box.
+	gte::AlignedBox3<Real> const leafBox = mNodes[leaf].box;
+	size_t index = mRoot;
+	while (!mNodes[index].IsLeaf())
+	{
+		Node const& node = mNodes[index];
+		Real area = Area(node.box);
+		Real combinedArea = Area(Merge(node.box, leafBox));
+		Real cost = static_cast<Real>(2) * combinedArea;
+		Real inheritanceCost = static_cast<Real>(2) * (combinedArea - area);
+
+		Real childCost[2];
+		for (int32_t c = 0; c < 2; ++c)
+		{
+			Node const& child = mNodes[node.child[c]];
+			Real mergedArea = Area(Merge(child.box, leafBox));
+			childCost[c] = inheritanceCost +
+				(child.IsLeaf() ? mergedArea : mergedArea - Area(child.box));
+		}
+
+		if (cost < childCost[0] && cost < childCost[1])
+		{
+			break;
+		}
+		index = (childCost[0] < childCost[1] ? node.child[0] : node.child[1]);
+	}
+
+	// Replace the sibling by a new internal node whose children are the
+	// sibling and the leaf.
+	size_t sibling = index;
+	size_t oldParent = mNodes[sibling].parent;
+	size_t newParent = AllocateNode();
+	Node& parentNode = mNodes[newParent];
+	parentNode.parent = oldParent;
+	parentNode.child[0] = sibling;
+	parentNode.child[1] = leaf;
+	mNodes[sibling].parent = newParent;
+	mNodes[leaf].parent = newParent;
+	if (oldParent != invalid)
+	{
+		Node& grandParent = mNodes[oldParent];
+		grandParent.child[grandParent.child[0] == sibling ? 0 : 1] = newParent;
+	}
+	else
+	{
+		mRoot = newParent;
+	}
+
+	UpdateAncestors(newParent);
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::RemoveLeaf(size_t leaf)
+{
+	if (leaf == mRoot)
+	{
+		mRoot = invalid;
+		return;
+	}
+
+	// The sibling takes the place of the parent, which is freed.
+	size_t parent = mNodes[leaf].parent;
+	Node const& parentNode = mNodes[parent];
+	size_t grandParent = parentNode.parent;
+	size_t sibling = (parentNode.child[0] == leaf ? parentNode.child[1] : parentNode.child[0]);
+	mNodes[sibling].parent = grandParent;
+	if (grandParent != invalid)
+	{
+		Node& grandParentNode = mNodes[grandParent];
+		grandParentNode.child[grandParentNode.child[0] == parent ? 0 : 1] = sibling;
+		FreeNode(parent);
+		UpdateAncestors(grandParent);
+	}
+	else
+	{
+		mRoot = sibling;
+		FreeNode(parent);
+	}
+	mNodes[leaf].parent = invalid;
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::UpdateNode(size_t i)
+{
+	Node& node = mNodes[i];
+	Node const& child0 = mNodes[node.child[0]];
+	Node const& child1 = mNodes[node.child[1]];
+	node.box = Merge(child0.box, child1.box);
+	node.height = 1 + std::max(child0.height, child1.height);
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::UpdateAncestors(size_t i)
+{
+	while (i != invalid)
+	{
+		UpdateNode(i);
+		Rotate(i);
+		i = mNodes[i].parent;
+	}
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::Rotate(size_t iA)
+{
+	// Node A has children B and C. B has children D and E when it is
+	// internal and C has children F and G when it is internal. A rotation
+	// swaps a child of A with a grandchild under the other child, or two
+	// grandchildren under different children. The box of A does not
+	// change, so the rotation with the largest decrease of the areas of B
+	// and C is the one that improves the SAH cost the most.
+	Node const& A = mNodes[iA];
+	if (A.height < 2)
+	{
+		return;
+	}
+
+	size_t const iB = A.child[0], iC = A.child[1];
+	Node const& B = mNodes[iB];
+	Node const& C = mNodes[iC];
+	Real const areaB = Area(B.box), areaC = Area(C.box);
+
+	struct Candidate
+	{
+		size_t i0;
+		int32_t s0;
+		size_t i1;
+		int32_t s1;
+	};
+	Candidate best{ invalid, 0, invalid, 0 };
+	Real bestDelta = static_cast<Real>(0);
+	auto consider = [&best, &bestDelta](Real delta, Candidate const& candidate)
+	{
+		if (delta < bestDelta)
+		{
+			bestDelta = delta;
+			best = candidate;
+		}
+	};
+
+	if (!C.IsLeaf())
+	{
+		auto const& boxF = mNodes[C.child[0]].box;
+		auto const& boxG = mNodes[C.child[1]].box;
+		consider(Area(Merge(B.box, boxG)) - areaC, { iA, 0, iC, 0 });
+		consider(Area(Merge(boxF, B.box)) - areaC, { iA, 0, iC, 1 });
+	}
+
+	if (!B.IsLeaf())
+	{
+		auto const& boxD = mNodes[B.child[0]].box;
+		auto const& boxE = mNodes[B.child[1]].box;
+		consider(Area(Merge(C.box, boxE)) - areaB, { iA, 1, iB, 0 });
+		consider(Area(Merge(boxD, C.box)) - areaB, { iA, 1, iB, 1 });
+
+		if (!C.IsLeaf())
+		{
+			auto const& boxF = mNodes[C.child[0]].box;
+			auto const& boxG = mNodes[C.child[1]].box;
+			consider(Area(Merge(boxF, boxE)) + Area(Merge(boxD, boxG)) - areaB - areaC,
+				{ iB, 0, iC, 0 });
+			consider(Area(Merge(boxG, boxE)) + Area(Merge(boxF, boxD)) - areaB - areaC,
+				{ iB, 0, iC, 1 });
+		}
+	}
+
+	if (best.i0 == invalid)
+	{
+		return;
+	}
+
+	SwapChildren(best.i0, best.s0, best.i1, best.s1);
+	if (best.i0 == iA)
+	{
+		UpdateNode(best.i1);
+	}
+	else
+	{
+		UpdateNode(iB);
+		UpdateNode(iC);
+	}
+	UpdateNode(iA);
+}
+
+template <typename Real>
+void DynamicAABBTree<Real>::SwapChildren(size_t i0, int32_t s0, size_t i1, int32_t s1)
+{
+	size_t child0 = mNodes[i0].child[s0];
+	size_t child1 = mNodes[i1].child[s1];
+	mNodes[i0].child[s0] = child1;
+	mNodes[i1].child[s1] = child0;
+	mNodes[child0].parent = i1;
+	mNodes[child1].parent = i0;
+}
+
+template <typename Real>
+Real DynamicAABBTree<Real>::Area(gte::AlignedBox3<Real> const& box)
+{
+	Real dx = box.max[0] - box.min[0];
+	Real dy = box.max[1] - box.min[1];
+	Real dz = box.max[2] - box.min[2];
+	return dx * dy + dy * dz + dz * dx;
+}
+
+template <typename Real>
+gte::AlignedBox3<Real> DynamicAABBTree<Real>::Merge(gte::AlignedBox3<Real> const& box0,
+	gte::AlignedBox3<Real> const& box1)
+{
+	gte::AlignedBox3<Real> merged{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		merged.min[d] = std::min(box0.min[d], box1.min[d]);
+		merged.max[d] = std::max(box0.max[d], box1.max[d]);
+	}
+	return merged;
+}
+
+template <typename Real>
+bool DynamicAABBTree<Real>::Contains(gte::AlignedBox3<Real> const& outer,
+	gte::AlignedBox3<Real> const& inner)
+{
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		if (inner.min[d] < outer.min[d] || inner.max[d] > outer.max[d])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template <typename Real>
+bool DynamicAABBTree<Real>::ClipSegment(gte::AlignedBox3<Real> const& box,
+	Vector3<Real> const& origin, Vector3<Real> const& direction,
+	Real& t0, Real& t1)
+{
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		if (direction[d] != static_cast<Real>(0))
+		{
+			Real invDirection = static_cast<Real>(1) / direction[d];
+			Real tNear = (box.min[d] - origin[d]) * invDirection;
+			Real tFar = (box.max[d] - origin[d]) * invDirection;
+			if (tNear > tFar)
+			{
+				std::swap(tNear, tFar);
+			}
+			t0 = std::max(t0, tNear);
+			t1 = std::min(t1, tFar);
+			if (t0 > t1)
+			{
+				return false;
+			}
+		}
+		else if (origin[d] < box.min[d] || origin[d] > box.max[d])
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+template class DynamicAABBTree<float>;
+template class DynamicAABBTree<double>;
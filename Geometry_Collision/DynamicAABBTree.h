@@ -0,0 +1,161 @@
+#pragma once
+
+#include "Vector.h"
+#include "IntrAlignedBox3AlignedBox3.h"
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+using namespace Vector_GM;
+
+// A dynamic bounding volume hierarchy of axis-aligned boxes, used as a
+// broadphase when the object sizes vary by orders of magnitude. A grid
+// must use cells as large as the largest object, and sort-and-sweep
+// degrades when large objects overlap many small ones along an axis; the
+// tree adapts to the sizes because each leaf has its own box.
+//
+// Each leaf stores a "fat" box, the tight box of the object enlarged by a
+// margin. An object that moves within its fat box does not change the
+// tree, so for coherent motion most updates are a containment test. The
+// leaves are inserted at the sibling that minimizes the surface-area
+// heuristic (SAH) cost of the tree, and after every insertion and removal
+// the ancestors are improved by tree rotations that swap a child with a
+// grandchild, or two grandchildren, when this reduces the surface area of
+// the internal boxes.
+//
+// The nodes are stored in a vector and reference each other by index;
+// removed nodes are recycled through a free list. A proxy is the index of
+// a leaf node and stays valid until the leaf is removed. The boxes are
+// considered to be solids, and boxes that touch overlap.
+
+template <typename Real>
+class DynamicAABBTree
+{
+public:
+	static size_t constexpr invalid = std::numeric_limits<size_t>::max();
+
+	DynamicAABBTree();
+
+	// Remove all the leaves. The node storage is kept for reuse.
+	void Clear();
+
+	// Insert a leaf for the object with the specified tight box. The fat
+	// box is the tight box enlarged by margin >= 0 on each side. The
+	// return value is the proxy of the leaf.
+	size_t Insert(gte::AlignedBox3<Real> const& box, size_t userData, Real margin);
+
+	void Remove(size_t proxy);
+
+	// The object of the proxy has moved to the tight box. If the box is
+	// still inside the fat box, the tree is not changed and the function
+	// returns false. Otherwise the leaf is reinserted with a new fat box,
+	// which is enlarged by margin and in the direction of displacement,
+	// predicting the motion of the next ticks, and the function returns
+	// true.
+	bool Move(size_t proxy, gte::AlignedBox3<Real> const& box,
+		Vector3<Real> const& displacement, Real margin);
+
+	// Replace the fat box of the leaf by the tight box enlarged by margin
+	// and refit the boxes of its ancestors. The topology is not changed,
+	// which is cheaper than Move when many leaves move by small amounts,
+	// but the tree quality degrades when the objects move far.
+	void Refit(size_t proxy, gte::AlignedBox3<Real> const& box, Real margin);
+
+	inline size_t GetNumLeaves() const
+	{
+		return mNumLeaves;
+	}
+
+	inline size_t GetUserData(size_t proxy) const
+	{
+		return mNodes[proxy].userData;
+	}
+
+	inline gte::AlignedBox3<Real> const& GetFatBox(size_t proxy) const
+	{
+		return mNodes[proxy].box;
+	}
+
+	// The height of the tree; a tree with one leaf has height 0.
+	inline int32_t GetHeight() const
+	{
+		return (mRoot != invalid ? mNodes[mRoot].height : 0);
+	}
+
+	// The sum of the surface areas of the internal boxes divided by the
+	// surface area of the root box. This is the SAH cost of the tree up to
+	// a constant and can be used to decide when to rebuild a tree whose
+	// leaves have been refitted.
+	Real ComputeAreaRatio() const;
+
+	// Compute the pairs (u0,u1) of user data, u0 < u1, whose fat boxes
+	// overlap. The pairs are sorted lexicographically.
+	void ComputePairs(std::vector<std::pair<size_t, size_t>>& pairs);
+
+	// Compute the user data of the leaves whose fat boxes overlap the box.
+	// The output is in traversal order.
+	void Query(gte::AlignedBox3<Real> const& box, std::vector<size_t>& userData) const;
+
+	// Compute the leaves whose fat boxes are intersected by the segment
+	// origin + t * direction, 0 <= t <= tMax. Each hit is (t,userData),
+	// where t is the smallest parameter of the segment in the box, and the
+	// hits are sorted by increasing t. The direction need not be unit
+	// length.
+	void RayCast(Vector3<Real> const& origin, Vector3<Real> const& direction,
+		Real tMax, std::vector<std::pair<Real, size_t>>& hits) const;
+
+private:
+	// A leaf has child[0] = child[1] = invalid. The parent of a node on the
+	// free list is the next node on the list, and its height is -1.
+	struct Node
+	{
+		gte::AlignedBox3<Real> box;
+		size_t parent;
+		size_t child[2];
+		size_t userData;
+		int32_t height;
+
+		inline bool IsLeaf() const
+		{
+			return child[0] == invalid;
+		}
+	};
+
+	size_t AllocateNode();
+	void FreeNode(size_t i);
+	void InsertLeaf(size_t leaf);
+	void RemoveLeaf(size_t leaf);
+
+	// Recompute the box and height of an internal node from its children.
+	void UpdateNode(size_t i);
+
+	// Walk from node i to the root, updating and rotating each node.
+	void UpdateAncestors(size_t i);
+
+	// Apply the rotation of node i that reduces the surface area of its
+	// children the most, if any.
+	void Rotate(size_t i);
+
+	// Swap child slot s0 of node i0 with child slot s1 of node i1.
+	void SwapChildren(size_t i0, int32_t s0, size_t i1, int32_t s1);
+
+	// Half the surface area of the box, dx*dy + dy*dz + dz*dx.
+	static Real Area(gte::AlignedBox3<Real> const& box);
+	static gte::AlignedBox3<Real> Merge(gte::AlignedBox3<Real> const& box0,
+		gte::AlignedBox3<Real> const& box1);
+	static bool Contains(gte::AlignedBox3<Real> const& outer,
+		gte::AlignedBox3<Real> const& inner);
+
+	// Clip [t0,t1] to the parameters of the segment inside the box and
+	// return true when the clipped interval is not empty.
+	static bool ClipSegment(gte::AlignedBox3<Real> const& box,
+		Vector3<Real> const& origin, Vector3<Real> const& direction,
+		Real& t0, Real& t1);
+
+	std::vector<Node> mNodes;
+	size_t mRoot, mFreeList, mNumLeaves;
+
+	// Traversal stack for ComputePairs, reused across calls.
+	std::vector<std::pair<size_t, size_t>> mPairStack;
+};
@@ -4,11 +4,15 @@
 
 
 
+#include "Logger.h"
 #include <stdexcept>
 #include <string>
 
 // The generic assertion allows you to specify any exception type you
-// prefer, including user-defined exception types.
+// prefer, including user-defined exception types. The assertions follow
+// the GTE_VALIDATION policy of Logger.h, so the conditions of the
+// Vector_GM code are tested in the same builds as those of Mathematics.
+#if GTE_VALIDATION_ENABLED
 #define GM_ASSERT(condition, exception, message) \
 if (!(condition)) \
 { \
@@ -18,6 +22,10 @@ if (!(condition)) \
     std::string report = sFile+"("+sFunc+","+sLine+"): "+message+"\n"; \
     throw exception(report); \
 }
+#else
+#define GM_ASSERT(condition, exception, message) \
+GTE_UNCHECKED_ASSERT(condition)
+#endif
 
 // The generic error allows you to specify any exception type you
 // prefer, including user-defined exception types.
@@ -0,0 +1,1168 @@
+#include "GPUPhysModule.h"
+#include "Logger.h"
+#include "Math.h"
+#include "Matrix4x4.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+	// The threads per group of the per-sphere programs and of the scan.
+	uint32_t constexpr numXThreads = 256;
+	uint32_t constexpr numScanThreads = 1024;
+
+	// The radix sort processes 4 bits per pass.
+	uint32_t constexpr radixBits = 4;
+	uint32_t constexpr radixSize = 1u << radixBits;
+}
+
+GPUPhysicsModule::GPUPhysicsModule(std::shared_ptr<ProgramFactory> const& factory,
+	BufferUpdater const& postUpdate, ProgramExecutor const& execute,
+	size_t numSpheres, float xMin, float xMax, float yMin, float yMax,
+	float zMin, float zMax)
+	:
+	mFactory(factory),
+	mPostUpdate(postUpdate),
+	mExecute(execute),
+	mNumSpheres(numSpheres),
+	mNumGroups(0),
+	mRegionMin{ xMin, yMin, zMin },
+	mRegionMax{ xMax, yMax, zMax },
+	mMaxRadius(0.0f),
+	mRestitution(0.8f),
+	mNumIterations(4),
+	mDeltaTime(0.0f),
+	mParametersDirty(true),
+	mStarted(false),
+	mNumTableBits(10),
+	mNumRadixPasses(0)
+{
+	LogAssert(
+		factory != nullptr && postUpdate && execute && numSpheres > 0 &&
+		numSpheres <= static_cast<size_t>(std::numeric_limits<int32_t>::max()),
+		"Invalid input.");
+
+	uint32_t const n = static_cast<uint32_t>(numSpheres);
+	mNumGroups = (n + numXThreads - 1) / numXThreads;
+	while ((static_cast<uint64_t>(1) << mNumTableBits) < 2 * static_cast<uint64_t>(n))
+	{
+		++mNumTableBits;
+	}
+	mNumRadixPasses = (mNumTableBits + radixBits - 1) / radixBits;
+	uint32_t const tableSize = 1u << mNumTableBits;
+
+	// The state buffers are initialized by InitializeSphere. Their CPU
+	// data is copied to the GPU when the buffers are first used.
+	auto createBuffer = [](uint32_t numElements, size_t elementSize)
+	{
+		auto buffer = std::make_shared<StructuredBuffer>(numElements, elementSize);
+		buffer->SetUsage(Resource::Usage::SHADER_OUTPUT);
+		std::fill(buffer->GetData(), buffer->GetData() + buffer->GetNumBytes(), 0);
+		return buffer;
+	};
+
+	mPosition = createBuffer(n, sizeof(Vector4<float>));
+	mOrientation = createBuffer(n, sizeof(Vector4<float>));
+	mInstance = createBuffer(n, sizeof(Matrix4x4<float>));
+	mVelocity[0] = createBuffer(n, sizeof(Vector4<float>));
+	mVelocity[1] = createBuffer(n, sizeof(Vector4<float>));
+	mAngularVelocity = createBuffer(n, sizeof(Vector4<float>));
+	mSeparation = createBuffer(n, sizeof(Vector4<float>));
+	for (size_t j = 0; j < 2; ++j)
+	{
+		mKeys[j] = createBuffer(n, sizeof(uint32_t));
+		mValues[j] = createBuffer(n, sizeof(uint32_t));
+	}
+	mDigitCounts = createBuffer(radixSize * mNumGroups, sizeof(uint32_t));
+
+	// No key is valid before the first tick.
+	mCellStart = createBuffer(tableSize, sizeof(uint32_t));
+	auto cellStart = mCellStart->Get<uint32_t>();
+	std::fill(cellStart, cellStart + tableSize, std::numeric_limits<uint32_t>::max());
+
+	auto world = mInstance->Get<Matrix4x4<float>>();
+	auto orientation = mOrientation->Get<Vector4<float>>();
+	for (uint32_t i = 0; i < n; ++i)
+	{
+		world[i] = Matrix4x4<float>::Identity();
+		orientation[i] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	}
+
+	mParameters = std::make_shared<ConstantBuffer>(sizeof(Parameters), true);
+
+	CreatePrograms();
+}
+
+void GPUPhysicsModule::InitializeSphere(size_t i, float radius, float massDensity,
+	Vector3<float> const& position, Vector3<float> const& linearVelocity,
+	Quaternion<float> const& qOrientation, Vector3<float> const& angularVelocity)
+{
+	LogAssert(
+		i < mNumSpheres && radius > 0.0f,
+		"Invalid input.");
+	LogAssert(
+		!mStarted,
+		"The spheres must be initialized before the first tick.");
+
+	float invMass = 0.0f;
+	if (massDensity > 0.0f)
+	{
+		float volume = static_cast<float>(4.0 * GTE_C_PI / 3.0) * radius * radius * radius;
+		invMass = 1.0f / (massDensity * volume);
+	}
+
+	mPosition->Get<Vector4<float>>()[i] = HLift(position, radius);
+	mVelocity[0]->Get<Vector4<float>>()[i] = HLift(linearVelocity, invMass);
+	mAngularVelocity->Get<Vector4<float>>()[i] = HLift(angularVelocity, 0.0f);
+	mOrientation->Get<Vector4<float>>()[i] =
+		{ qOrientation[0], qOrientation[1], qOrientation[2], qOrientation[3] };
+
+	if (radius > mMaxRadius)
+	{
+		mMaxRadius = radius;
+	}
+}
+
+void GPUPhysicsModule::SetRestitution(float restitution)
+{
+	mRestitution = restitution;
+	mParametersDirty = true;
+}
+
+void GPUPhysicsModule::SetNumIterations(size_t numIterations)
+{
+	mNumIterations = std::max(numIterations + (numIterations & 1), static_cast<size_t>(2));
+}
+
+void GPUPhysicsModule::DoTick(float deltaTime)
+{
+	if (!mStarted)
+	{
+		LogAssert(
+			mMaxRadius > 0.0f,
+			"The spheres must be initialized before the first tick.");
+		mStarted = true;
+	}
+
+	if (mParametersDirty || deltaTime != mDeltaTime)
+	{
+		// The cells have the diameter of the largest sphere, so
+		// overlapping spheres are in the same or in neighboring cells.
+		auto& parameters = *mParameters->Get<Parameters>();
+		parameters.regionMin = HLift(mRegionMin, mRestitution);
+		parameters.regionMax = HLift(mRegionMax, 0.5f / mMaxRadius);
+		parameters.gravityDelta = { 0.0f, 0.0f, -9.81f, deltaTime };
+		mPostUpdate(mParameters);
+		mDeltaTime = deltaTime;
+		mParametersDirty = false;
+	}
+
+	mExecute(mHashProgram, mNumGroups, 1, 1);
+	for (uint32_t pass = 0; pass < mNumRadixPasses; ++pass)
+	{
+		mExecute(mCountPrograms[pass], mNumGroups, 1, 1);
+		mExecute(mScanProgram, 1, 1, 1);
+		mExecute(mScatterPrograms[pass], mNumGroups, 1, 1);
+	}
+	mExecute(mCellStartProgram, mNumGroups, 1, 1);
+	for (size_t iteration = 0; iteration < mNumIterations; ++iteration)
+	{
+		mExecute(mSolvePrograms[iteration & 1], mNumGroups, 1, 1);
+	}
+	mExecute(mSeparateProgram, mNumGroups, 1, 1);
+	mExecute(mIntegrateProgram, mNumGroups, 1, 1);
+}
+
+void GPUPhysicsModule::CreatePrograms()
+{
+	// The sorted keys and sphere indices are in the buffers written by the
+	// last radix pass.
+	auto const& sortedKeys = mKeys[mNumRadixPasses & 1];
+	auto const& sortedValues = mValues[mNumRadixPasses & 1];
+
+	mHashProgram = CreateProgram(msHashSource, true, 0);
+	auto cshader = mHashProgram->GetComputeShader();
+	cshader->Set("Parameters", mParameters);
+	cshader->Set("position", mPosition);
+	cshader->Set("velocity", mVelocity[0]);
+	cshader->Set("keys", mKeys[0]);
+	cshader->Set("values", mValues[0]);
+
+	mCountPrograms.resize(mNumRadixPasses);
+	mScatterPrograms.resize(mNumRadixPasses);
+	for (uint32_t pass = 0; pass < mNumRadixPasses; ++pass)
+	{
+		auto const& keysIn = mKeys[pass & 1];
+		auto const& valuesIn = mValues[pass & 1];
+		auto const& keysOut = mKeys[(pass + 1) & 1];
+		auto const& valuesOut = mValues[(pass + 1) & 1];
+
+		mCountPrograms[pass] = CreateProgram(msCountSource, false, pass * radixBits);
+		cshader = mCountPrograms[pass]->GetComputeShader();
+		cshader->Set("keys", keysIn);
+		cshader->Set("digitCounts", mDigitCounts);
+
+		mScatterPrograms[pass] = CreateProgram(msScatterSource, false, pass * radixBits);
+		cshader = mScatterPrograms[pass]->GetComputeShader();
+		cshader->Set("keysIn", keysIn);
+		cshader->Set("valuesIn", valuesIn);
+		cshader->Set("keysOut", keysOut);
+		cshader->Set("valuesOut", valuesOut);
+		cshader->Set("digitCounts", mDigitCounts);
+	}
+
+	mScanProgram = CreateProgram(msScanSource, false, 0);
+	mScanProgram->GetComputeShader()->Set("digitCounts", mDigitCounts);
+
+	mCellStartProgram = CreateProgram(msCellStartSource, false, 0);
+	cshader = mCellStartProgram->GetComputeShader();
+	cshader->Set("keys", sortedKeys);
+	cshader->Set("cellStart", mCellStart);
+
+	for (size_t j = 0; j < 2; ++j)
+	{
+		mSolvePrograms[j] = CreateProgram(msSolveSource, true, 0);
+		cshader = mSolvePrograms[j]->GetComputeShader();
+		cshader->Set("Parameters", mParameters);
+		cshader->Set("position", mPosition);
+		cshader->Set("velocityIn", mVelocity[j]);
+		cshader->Set("velocityOut", mVelocity[1 - j]);
+		cshader->Set("keys", sortedKeys);
+		cshader->Set("values", sortedValues);
+		cshader->Set("cellStart", mCellStart);
+	}
+
+	mSeparateProgram = CreateProgram(msSeparateSource, true, 0);
+	cshader = mSeparateProgram->GetComputeShader();
+	cshader->Set("Parameters", mParameters);
+	cshader->Set("position", mPosition);
+	cshader->Set("velocity", mVelocity[0]);
+	cshader->Set("keys", sortedKeys);
+	cshader->Set("values", sortedValues);
+	cshader->Set("cellStart", mCellStart);
+	cshader->Set("separation", mSeparation);
+
+	mIntegrateProgram = CreateProgram(msIntegrateSource, true, 0);
+	cshader = mIntegrateProgram->GetComputeShader();
+	cshader->Set("Parameters", mParameters);
+	cshader->Set("position", mPosition);
+	cshader->Set("velocity", mVelocity[0]);
+	cshader->Set("angularVelocity", mAngularVelocity);
+	cshader->Set("separation", mSeparation);
+	cshader->Set("orientation", mOrientation);
+	cshader->Set("instance", mInstance);
+}
+
+std::shared_ptr<ComputeProgram> GPUPhysicsModule::CreateProgram(
+	ProgramSources const& source, bool useCommon, uint32_t radixShift)
+{
+	int32_t const api = mFactory->GetAPI();
+	std::string const text = (useCommon ? *msCommonSource[api] : std::string()) + *source[api];
+
+	mFactory->PushDefines();
+	mFactory->defines.Set("NUM_X_THREADS", numXThreads);
+	mFactory->defines.Set("NUM_SCAN_THREADS", numScanThreads);
+	mFactory->defines.Set("NUM_SPHERES", static_cast<uint32_t>(mNumSpheres));
+	mFactory->defines.Set("NUM_BLOCKS", mNumGroups);
+	mFactory->defines.Set("NUM_DIGIT_COUNTS", radixSize * mNumGroups);
+	mFactory->defines.Set("TABLE_MASK", (1u << mNumTableBits) - 1u);
+	mFactory->defines.Set("RADIX_SHIFT", radixShift);
+	auto program = mFactory->CreateFromSource(text);
+	mFactory->PopDefines();
+
+	LogAssert(
+		program != nullptr,
+		"Failed to compile the physics programs.");
+	return program;
+}
+
+
+std::string const GPUPhysicsModule::msGLSLCommonSource =
+R"(
+    uniform Parameters
+    {
+        vec4 regionMin;
+        vec4 regionMax;
+        vec4 gravityDelta;
+    };
+
+    ivec3 GetCell(vec3 position)
+    {
+        return ivec3(floor((position - regionMin.xyz) * regionMax.w));
+    }
+
+    uint GetKey(ivec3 cell)
+    {
+        uvec3 c = uvec3(cell);
+        return ((c.x * 73856093u) ^ (c.y * 19349663u) ^ (c.z * 83492791u)) & uint(TABLE_MASK);
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLCommonSource =
+R"(
+    cbuffer Parameters
+    {
+        float4 regionMin;
+        float4 regionMax;
+        float4 gravityDelta;
+    };
+
+    int3 GetCell(float3 position)
+    {
+        return int3(floor((position - regionMin.xyz) * regionMax.w));
+    }
+
+    uint GetKey(int3 cell)
+    {
+        uint3 c = uint3(cell);
+        return ((c.x * 73856093u) ^ (c.y * 19349663u) ^ (c.z * 83492791u)) & uint(TABLE_MASK);
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLHashSource =
+R"(
+    buffer position { vec4 data[]; } positionSB;
+    buffer velocity { vec4 data[]; } velocitySB;
+    buffer keys { uint data[]; } keysSB;
+    buffer values { uint data[]; } valuesSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            vec4 v = velocitySB.data[i];
+            if (v.w > 0.0f)
+            {
+                v.xyz += gravityDelta.w * gravityDelta.xyz;
+                velocitySB.data[i] = v;
+            }
+            keysSB.data[i] = GetKey(GetCell(positionSB.data[i].xyz));
+            valuesSB.data[i] = i;
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLHashSource =
+R"(
+    StructuredBuffer<float4> position;
+    RWStructuredBuffer<float4> velocity;
+    RWStructuredBuffer<uint> keys;
+    RWStructuredBuffer<uint> values;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            float4 v = velocity[i];
+            if (v.w > 0.0f)
+            {
+                v.xyz += gravityDelta.w * gravityDelta.xyz;
+                velocity[i] = v;
+            }
+            keys[i] = GetKey(GetCell(position[i].xyz));
+            values[i] = i;
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLCountSource =
+R"(
+    buffer keys { uint data[]; } keysSB;
+    buffer digitCounts { uint data[]; } digitCountsSB;
+
+    shared uint counts[16];
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint local = gl_LocalInvocationID.x;
+        uint i = gl_GlobalInvocationID.x;
+        if (local < 16u)
+        {
+            counts[local] = 0u;
+        }
+        memoryBarrierShared();
+        barrier();
+
+        if (i < uint(NUM_SPHERES))
+        {
+            atomicAdd(counts[(keysSB.data[i] >> RADIX_SHIFT) & 15u], 1u);
+        }
+        memoryBarrierShared();
+        barrier();
+
+        // The counts are stored digit-major, so their exclusive scan is the
+        // first target index of each (digit, group).
+        if (local < 16u)
+        {
+            digitCountsSB.data[local * uint(NUM_BLOCKS) + gl_WorkGroupID.x] = counts[local];
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLCountSource =
+R"(
+    StructuredBuffer<uint> keys;
+    RWStructuredBuffer<uint> digitCounts;
+
+    groupshared uint counts[16];
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID, uint3 group : SV_GroupID,
+        uint local : SV_GroupIndex)
+    {
+        if (local < 16)
+        {
+            counts[local] = 0;
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        if (t.x < uint(NUM_SPHERES))
+        {
+            InterlockedAdd(counts[(keys[t.x] >> RADIX_SHIFT) & 15], 1);
+        }
+        GroupMemoryBarrierWithGroupSync();
+
+        // The counts are stored digit-major, so their exclusive scan is the
+        // first target index of each (digit, group).
+        if (local < 16)
+        {
+            digitCounts[local * uint(NUM_BLOCKS) + group.x] = counts[local];
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLScanSource =
+R"(
+    buffer digitCounts { uint data[]; } digitCountsSB;
+
+    shared uint sums[2 * NUM_SCAN_THREADS];
+
+    layout (local_size_x = NUM_SCAN_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        // Each thread sums a contiguous chunk of the counts.
+        uint t = gl_LocalInvocationID.x;
+        uint chunk = (uint(NUM_DIGIT_COUNTS) + uint(NUM_SCAN_THREADS) - 1u) / uint(NUM_SCAN_THREADS);
+        uint first = min(t * chunk, uint(NUM_DIGIT_COUNTS));
+        uint last = min(first + chunk, uint(NUM_DIGIT_COUNTS));
+        uint sum = 0u;
+        for (uint k = first; k < last; ++k)
+        {
+            sum += digitCountsSB.data[k];
+        }
+        sums[t] = sum;
+        memoryBarrierShared();
+        barrier();
+
+        // Inclusive scan of the chunk sums, alternating between the halves
+        // of the shared array.
+        uint source = 0u;
+        for (uint offset = 1u; offset < uint(NUM_SCAN_THREADS); offset <<= 1u)
+        {
+            uint value = sums[source + t];
+            if (t >= offset)
+            {
+                value += sums[source + t - offset];
+            }
+            sums[uint(NUM_SCAN_THREADS) - source + t] = value;
+            source = uint(NUM_SCAN_THREADS) - source;
+            memoryBarrierShared();
+            barrier();
+        }
+
+        // Replace the counts of the chunk by their exclusive prefix sums.
+        uint prefix = sums[source + t] - sum;
+        for (uint k = first; k < last; ++k)
+        {
+            uint count = digitCountsSB.data[k];
+            digitCountsSB.data[k] = prefix;
+            prefix += count;
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLScanSource =
+R"(
+    RWStructuredBuffer<uint> digitCounts;
+
+    groupshared uint sums[2 * NUM_SCAN_THREADS];
+
+    [numthreads(NUM_SCAN_THREADS, 1, 1)]
+    void CSMain(uint t : SV_GroupIndex)
+    {
+        // Each thread sums a contiguous chunk of the counts.
+        uint chunk = (uint(NUM_DIGIT_COUNTS) + uint(NUM_SCAN_THREADS) - 1) / uint(NUM_SCAN_THREADS);
+        uint first = min(t * chunk, uint(NUM_DIGIT_COUNTS));
+        uint last = min(first + chunk, uint(NUM_DIGIT_COUNTS));
+        uint sum = 0;
+        uint k;
+        for (k = first; k < last; ++k)
+        {
+            sum += digitCounts[k];
+        }
+        sums[t] = sum;
+        GroupMemoryBarrierWithGroupSync();
+
+        // Inclusive scan of the chunk sums, alternating between the halves
+        // of the shared array.
+        uint source = 0;
+        for (uint offset = 1; offset < uint(NUM_SCAN_THREADS); offset <<= 1)
+        {
+            uint value = sums[source + t];
+            if (t >= offset)
+            {
+                value += sums[source + t - offset];
+            }
+            sums[uint(NUM_SCAN_THREADS) - source + t] = value;
+            source = uint(NUM_SCAN_THREADS) - source;
+            GroupMemoryBarrierWithGroupSync();
+        }
+
+        // Replace the counts of the chunk by their exclusive prefix sums.
+        uint prefix = sums[source + t] - sum;
+        for (k = first; k < last; ++k)
+        {
+            uint count = digitCounts[k];
+            digitCounts[k] = prefix;
+            prefix += count;
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLScatterSource =
+R"(
+    buffer keysIn { uint data[]; } keysInSB;
+    buffer valuesIn { uint data[]; } valuesInSB;
+    buffer keysOut { uint data[]; } keysOutSB;
+    buffer valuesOut { uint data[]; } valuesOutSB;
+    buffer digitCounts { uint data[]; } digitCountsSB;
+
+    shared uint digits[NUM_X_THREADS];
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint local = gl_LocalInvocationID.x;
+        uint i = gl_GlobalInvocationID.x;
+        uint key = 0u, digit = 16u;
+        if (i < uint(NUM_SPHERES))
+        {
+            key = keysInSB.data[i];
+            digit = (key >> RADIX_SHIFT) & 15u;
+        }
+        digits[local] = digit;
+        memoryBarrierShared();
+        barrier();
+
+        if (i < uint(NUM_SPHERES))
+        {
+            // Ranking the key among the keys of the group with the same
+            // digit makes the sort stable.
+            uint rank = 0u;
+            for (uint j = 0u; j < local; ++j)
+            {
+                if (digits[j] == digit)
+                {
+                    ++rank;
+                }
+            }
+            uint target = digitCountsSB.data[digit * uint(NUM_BLOCKS) + gl_WorkGroupID.x] + rank;
+            keysOutSB.data[target] = key;
+            valuesOutSB.data[target] = valuesInSB.data[i];
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLScatterSource =
+R"(
+    StructuredBuffer<uint> keysIn;
+    StructuredBuffer<uint> valuesIn;
+    RWStructuredBuffer<uint> keysOut;
+    RWStructuredBuffer<uint> valuesOut;
+    StructuredBuffer<uint> digitCounts;
+
+    groupshared uint digits[NUM_X_THREADS];
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID, uint3 group : SV_GroupID,
+        uint local : SV_GroupIndex)
+    {
+        uint i = t.x;
+        uint key = 0, digit = 16;
+        if (i < uint(NUM_SPHERES))
+        {
+            key = keysIn[i];
+            digit = (key >> RADIX_SHIFT) & 15;
+        }
+        digits[local] = digit;
+        GroupMemoryBarrierWithGroupSync();
+
+        if (i < uint(NUM_SPHERES))
+        {
+            // Ranking the key among the keys of the group with the same
+            // digit makes the sort stable.
+            uint rank = 0;
+            for (uint j = 0; j < local; ++j)
+            {
+                if (digits[j] == digit)
+                {
+                    ++rank;
+                }
+            }
+            uint target = digitCounts[digit * uint(NUM_BLOCKS) + group.x] + rank;
+            keysOut[target] = key;
+            valuesOut[target] = valuesIn[i];
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLCellStartSource =
+R"(
+    buffer keys { uint data[]; } keysSB;
+    buffer cellStart { uint data[]; } cellStartSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            uint key = keysSB.data[i];
+            if (i == 0u || keysSB.data[i - 1u] != key)
+            {
+                cellStartSB.data[key] = i;
+            }
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLCellStartSource =
+R"(
+    StructuredBuffer<uint> keys;
+    RWStructuredBuffer<uint> cellStart;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            uint key = keys[i];
+            if (i == 0 || keys[i - 1] != key)
+            {
+                cellStart[key] = i;
+            }
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLSolveSource =
+R"(
+    buffer position { vec4 data[]; } positionSB;
+    buffer velocityIn { vec4 data[]; } velocityInSB;
+    buffer velocityOut { vec4 data[]; } velocityOutSB;
+    buffer keys { uint data[]; } keysSB;
+    buffer values { uint data[]; } valuesSB;
+    buffer cellStart { uint data[]; } cellStartSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            vec4 p = positionSB.data[i];
+            vec4 v = velocityInSB.data[i];
+            if (v.w > 0.0f)
+            {
+                float factor = 1.0f + regionMin.w;
+                vec3 deltaV = vec3(0.0f);
+                float numContacts = 0.0f;
+
+                // The planes x = xMin and x = xMax, and similarly for y and
+                // z, have the inner normals +e[d] and -e[d].
+                for (int d = 0; d < 3; ++d)
+                {
+                    if ((p[d] - p.w < regionMin[d] && v[d] < 0.0f) ||
+                        (p[d] + p.w > regionMax[d] && v[d] > 0.0f))
+                    {
+                        deltaV[d] -= factor * v[d];
+                        numContacts += 1.0f;
+                    }
+                }
+
+                ivec3 cell = GetCell(p.xyz);
+                for (int dz = -1; dz <= 1; ++dz)
+                {
+                    for (int dy = -1; dy <= 1; ++dy)
+                    {
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            ivec3 neighbor = cell + ivec3(dx, dy, dz);
+                            uint key = GetKey(neighbor);
+                            for (uint k = cellStartSB.data[key];
+                                k < uint(NUM_SPHERES) && keysSB.data[k] == key; ++k)
+                            {
+                                // Skip the spheres of other cells with the
+                                // same key, which are visited with their
+                                // own cells.
+                                uint j = valuesSB.data[k];
+                                vec4 q = positionSB.data[j];
+                                if (j == i || GetCell(q.xyz) != neighbor)
+                                {
+                                    continue;
+                                }
+
+                                vec3 diff = p.xyz - q.xyz;
+                                float sqrDistance = dot(diff, diff);
+                                float sumRadii = p.w + q.w;
+                                if (sqrDistance > 0.0f && sqrDistance < sumRadii * sumRadii)
+                                {
+                                    vec4 w = velocityInSB.data[j];
+                                    vec3 normal = diff * inversesqrt(sqrDistance);
+                                    float speed = dot(v.xyz - w.xyz, normal);
+                                    if (speed < 0.0f)
+                                    {
+                                        float impulse = -factor * speed / (v.w + w.w);
+                                        deltaV += (impulse * v.w) * normal;
+                                        numContacts += 1.0f;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+
+                if (numContacts > 0.0f)
+                {
+                    v.xyz += deltaV / numContacts;
+                }
+            }
+            velocityOutSB.data[i] = v;
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLSolveSource =
+R"(
+    StructuredBuffer<float4> position;
+    StructuredBuffer<float4> velocityIn;
+    RWStructuredBuffer<float4> velocityOut;
+    StructuredBuffer<uint> keys;
+    StructuredBuffer<uint> values;
+    StructuredBuffer<uint> cellStart;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            float4 p = position[i];
+            float4 v = velocityIn[i];
+            if (v.w > 0.0f)
+            {
+                float factor = 1.0f + regionMin.w;
+                float3 deltaV = float3(0.0f, 0.0f, 0.0f);
+                float numContacts = 0.0f;
+
+                // The planes x = xMin and x = xMax, and similarly for y and
+                // z, have the inner normals +e[d] and -e[d].
+                for (int d = 0; d < 3; ++d)
+                {
+                    if ((p[d] - p.w < regionMin[d] && v[d] < 0.0f) ||
+                        (p[d] + p.w > regionMax[d] && v[d] > 0.0f))
+                    {
+                        deltaV[d] -= factor * v[d];
+                        numContacts += 1.0f;
+                    }
+                }
+
+                int3 cell = GetCell(p.xyz);
+                for (int dz = -1; dz <= 1; ++dz)
+                {
+                    for (int dy = -1; dy <= 1; ++dy)
+                    {
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            int3 neighbor = cell + int3(dx, dy, dz);
+                            uint key = GetKey(neighbor);
+                            for (uint k = cellStart[key];
+                                k < uint(NUM_SPHERES) && keys[k] == key; ++k)
+                            {
+                                // Skip the spheres of other cells with the
+                                // same key, which are visited with their
+                                // own cells.
+                                uint j = values[k];
+                                float4 q = position[j];
+                                if (j == i || any(GetCell(q.xyz) != neighbor))
+                                {
+                                    continue;
+                                }
+
+                                float3 diff = p.xyz - q.xyz;
+                                float sqrDistance = dot(diff, diff);
+                                float sumRadii = p.w + q.w;
+                                if (sqrDistance > 0.0f && sqrDistance < sumRadii * sumRadii)
+                                {
+                                    float4 w = velocityIn[j];
+                                    float3 normal = diff * rsqrt(sqrDistance);
+                                    float speed = dot(v.xyz - w.xyz, normal);
+                                    if (speed < 0.0f)
+                                    {
+                                        float impulse = -factor * speed / (v.w + w.w);
+                                        deltaV += (impulse * v.w) * normal;
+                                        numContacts += 1.0f;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                }
+
+                if (numContacts > 0.0f)
+                {
+                    v.xyz += deltaV / numContacts;
+                }
+            }
+            velocityOut[i] = v;
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLSeparateSource =
+R"(
+    buffer position { vec4 data[]; } positionSB;
+    buffer velocity { vec4 data[]; } velocitySB;
+    buffer keys { uint data[]; } keysSB;
+    buffer values { uint data[]; } valuesSB;
+    buffer cellStart { uint data[]; } cellStartSB;
+    buffer separation { vec4 data[]; } separationSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            vec4 p = positionSB.data[i];
+            float invMass = velocitySB.data[i].w;
+            vec3 displacement = vec3(0.0f);
+            float numOverlaps = 0.0f;
+            if (invMass > 0.0f)
+            {
+                for (int d = 0; d < 3; ++d)
+                {
+                    float overlap = regionMin[d] - (p[d] - p.w);
+                    if (overlap > 0.0f)
+                    {
+                        displacement[d] += overlap;
+                        numOverlaps += 1.0f;
+                    }
+                    overlap = (p[d] + p.w) - regionMax[d];
+                    if (overlap > 0.0f)
+                    {
+                        displacement[d] -= overlap;
+                        numOverlaps += 1.0f;
+                    }
+                }
+
+                ivec3 cell = GetCell(p.xyz);
+                for (int dz = -1; dz <= 1; ++dz)
+                {
+                    for (int dy = -1; dy <= 1; ++dy)
+                    {
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            ivec3 neighbor = cell + ivec3(dx, dy, dz);
+                            uint key = GetKey(neighbor);
+                            for (uint k = cellStartSB.data[key];
+                                k < uint(NUM_SPHERES) && keysSB.data[k] == key; ++k)
+                            {
+                                uint j = valuesSB.data[k];
+                                vec4 q = positionSB.data[j];
+                                if (j == i || GetCell(q.xyz) != neighbor)
+                                {
+                                    continue;
+                                }
+
+                                vec3 diff = p.xyz - q.xyz;
+                                float sqrDistance = dot(diff, diff);
+                                float sumRadii = p.w + q.w;
+                                if (sqrDistance > 0.0f && sqrDistance < sumRadii * sumRadii)
+                                {
+                                    // Sphere i moves by its share of the
+                                    // overlap, in proportion to its
+                                    // inverse mass.
+                                    float centerDistance = sqrt(sqrDistance);
+                                    float share = invMass / (invMass + velocitySB.data[j].w);
+                                    displacement += (share * (sumRadii - centerDistance) / centerDistance) * diff;
+                                    numOverlaps += 1.0f;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                if (numOverlaps > 0.0f)
+                {
+                    displacement /= numOverlaps;
+                }
+            }
+            separationSB.data[i] = vec4(displacement, 0.0f);
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLSeparateSource =
+R"(
+    StructuredBuffer<float4> position;
+    StructuredBuffer<float4> velocity;
+    StructuredBuffer<uint> keys;
+    StructuredBuffer<uint> values;
+    StructuredBuffer<uint> cellStart;
+    RWStructuredBuffer<float4> separation;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            float4 p = position[i];
+            float invMass = velocity[i].w;
+            float3 displacement = float3(0.0f, 0.0f, 0.0f);
+            float numOverlaps = 0.0f;
+            if (invMass > 0.0f)
+            {
+                for (int d = 0; d < 3; ++d)
+                {
+                    float overlap = regionMin[d] - (p[d] - p.w);
+                    if (overlap > 0.0f)
+                    {
+                        displacement[d] += overlap;
+                        numOverlaps += 1.0f;
+                    }
+                    overlap = (p[d] + p.w) - regionMax[d];
+                    if (overlap > 0.0f)
+                    {
+                        displacement[d] -= overlap;
+                        numOverlaps += 1.0f;
+                    }
+                }
+
+                int3 cell = GetCell(p.xyz);
+                for (int dz = -1; dz <= 1; ++dz)
+                {
+                    for (int dy = -1; dy <= 1; ++dy)
+                    {
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            int3 neighbor = cell + int3(dx, dy, dz);
+                            uint key = GetKey(neighbor);
+                            for (uint k = cellStart[key];
+                                k < uint(NUM_SPHERES) && keys[k] == key; ++k)
+                            {
+                                uint j = values[k];
+                                float4 q = position[j];
+                                if (j == i || any(GetCell(q.xyz) != neighbor))
+                                {
+                                    continue;
+                                }
+
+                                float3 diff = p.xyz - q.xyz;
+                                float sqrDistance = dot(diff, diff);
+                                float sumRadii = p.w + q.w;
+                                if (sqrDistance > 0.0f && sqrDistance < sumRadii * sumRadii)
+                                {
+                                    // Sphere i moves by its share of the
+                                    // overlap, in proportion to its
+                                    // inverse mass.
+                                    float centerDistance = sqrt(sqrDistance);
+                                    float share = invMass / (invMass + velocity[j].w);
+                                    displacement += (share * (sumRadii - centerDistance) / centerDistance) * diff;
+                                    numOverlaps += 1.0f;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                if (numOverlaps > 0.0f)
+                {
+                    displacement /= numOverlaps;
+                }
+            }
+            separation[i] = float4(displacement, 0.0f);
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msGLSLIntegrateSource =
+R"(
+    buffer position { vec4 data[]; } positionSB;
+    buffer velocity { vec4 data[]; } velocitySB;
+    buffer angularVelocity { vec4 data[]; } angularVelocitySB;
+    buffer separation { vec4 data[]; } separationSB;
+    buffer orientation { vec4 data[]; } orientationSB;
+    buffer instance { mat4 data[]; } instanceSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            float deltaTime = gravityDelta.w;
+            vec4 p = positionSB.data[i];
+            vec4 q = orientationSB.data[i];
+            if (velocitySB.data[i].w > 0.0f)
+            {
+                p.xyz += deltaTime * velocitySB.data[i].xyz + separationSB.data[i].xyz;
+                positionSB.data[i] = p;
+
+                // dq/dt = w*q/2 for the quaternion w = (angular velocity, 0).
+                vec3 w = angularVelocitySB.data[i].xyz;
+                vec4 dq = 0.5f * vec4(q.w * w + cross(w, q.xyz), -dot(w, q.xyz));
+                q = normalize(q + deltaTime * dq);
+                orientationSB.data[i] = q;
+            }
+
+            // The rows of the rotation matrix of q, scaled by the radius.
+            vec3 q2 = 2.0f * q.xyz;
+            vec3 qq = q.xyz * q2;
+            float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+            float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+            vec3 r0 = p.w * vec3(1.0f - qq.y - qq.z, xy - wz, xz + wy);
+            vec3 r1 = p.w * vec3(xy + wz, 1.0f - qq.x - qq.z, yz - wx);
+            vec3 r2 = p.w * vec3(xz - wy, yz + wx, 1.0f - qq.x - qq.y);
+    #if GTE_USE_MAT_VEC
+            instanceSB.data[i] = mat4(
+                vec4(r0.x, r1.x, r2.x, 0.0f),
+                vec4(r0.y, r1.y, r2.y, 0.0f),
+                vec4(r0.z, r1.z, r2.z, 0.0f),
+                vec4(p.xyz, 1.0f));
+    #else
+            instanceSB.data[i] = mat4(
+                vec4(r0, p.x),
+                vec4(r1, p.y),
+                vec4(r2, p.z),
+                vec4(0.0f, 0.0f, 0.0f, 1.0f));
+    #endif
+        }
+    }
+)";
+
+std::string const GPUPhysicsModule::msHLSLIntegrateSource =
+R"(
+    RWStructuredBuffer<float4> position;
+    StructuredBuffer<float4> velocity;
+    StructuredBuffer<float4> angularVelocity;
+    StructuredBuffer<float4> separation;
+    RWStructuredBuffer<float4> orientation;
+    RWStructuredBuffer<float4x4> instance;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i < uint(NUM_SPHERES))
+        {
+            float deltaTime = gravityDelta.w;
+            float4 p = position[i];
+            float4 q = orientation[i];
+            if (velocity[i].w > 0.0f)
+            {
+                p.xyz += deltaTime * velocity[i].xyz + separation[i].xyz;
+                position[i] = p;
+
+                // dq/dt = w*q/2 for the quaternion w = (angular velocity, 0).
+                float3 w = angularVelocity[i].xyz;
+                float4 dq = 0.5f * float4(q.w * w + cross(w, q.xyz), -dot(w, q.xyz));
+                q = normalize(q + deltaTime * dq);
+                orientation[i] = q;
+            }
+
+            // The rows of the rotation matrix of q, scaled by the radius.
+            float3 q2 = 2.0f * q.xyz;
+            float3 qq = q.xyz * q2;
+            float xy = q.x * q2.y, xz = q.x * q2.z, yz = q.y * q2.z;
+            float wx = q.w * q2.x, wy = q.w * q2.y, wz = q.w * q2.z;
+            float3 r0 = p.w * float3(1.0f - qq.y - qq.z, xy - wz, xz + wy);
+            float3 r1 = p.w * float3(xy + wz, 1.0f - qq.x - qq.z, yz - wx);
+            float3 r2 = p.w * float3(xz - wy, yz + wx, 1.0f - qq.x - qq.y);
+    #if GTE_USE_MAT_VEC
+            instance[i] = float4x4(
+                float4(r0, p.x),
+                float4(r1, p.y),
+                float4(r2, p.z),
+                float4(0.0f, 0.0f, 0.0f, 1.0f));
+    #else
+            instance[i] = float4x4(
+                float4(r0.x, r1.x, r2.x, 0.0f),
+                float4(r0.y, r1.y, r2.y, 0.0f),
+                float4(r0.z, r1.z, r2.z, 0.0f),
+                float4(p.xyz, 1.0f));
+    #endif
+        }
+    }
+)";
+
+ProgramSources const GPUPhysicsModule::msCommonSource =
+{
+	&msGLSLCommonSource,
+	&msHLSLCommonSource
+};
+
+ProgramSources const GPUPhysicsModule::msHashSource =
+{
+	&msGLSLHashSource,
+	&msHLSLHashSource
+};
+
+ProgramSources const GPUPhysicsModule::msCountSource =
+{
+	&msGLSLCountSource,
+	&msHLSLCountSource
+};
+
+ProgramSources const GPUPhysicsModule::msScanSource =
+{
+	&msGLSLScanSource,
+	&msHLSLScanSource
+};
+
+ProgramSources const GPUPhysicsModule::msScatterSource =
+{
+	&msGLSLScatterSource,
+	&msHLSLScatterSource
+};
+
+ProgramSources const GPUPhysicsModule::msCellStartSource =
+{
+	&msGLSLCellStartSource,
+	&msHLSLCellStartSource
+};
+
+ProgramSources const GPUPhysicsModule::msSolveSource =
+{
+	&msGLSLSolveSource,
+	&msHLSLSolveSource
+};
+
+ProgramSources const GPUPhysicsModule::msSeparateSource =
+{
+	&msGLSLSeparateSource,
+	&msHLSLSeparateSource
+};
+
+ProgramSources const GPUPhysicsModule::msIntegrateSource =
+{
+	&msGLSLIntegrateSource,
+	&msHLSLIntegrateSource
+};
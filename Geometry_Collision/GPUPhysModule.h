@@ -0,0 +1,180 @@
+#pragma once
+
+#include "Buffer.h"
+#include "ComputeProgram.h"
+#include "ConstantBuffer.h"
+#include "ProgramFactory.h"
+#include "StructuredBuffer.h"
+#include "Quaternion.h"
+#include "Vector3.h"
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+using namespace Vector_GM;
+
+// A version of PhysicsModule whose state lives on the GPU and that runs one
+// tick as a sequence of compute programs, for numbers of spheres that the
+// CPU cannot simulate at interactive rates. The state is never read back.
+// A tick consists of
+//   1. Gravity and hashing. The linear velocities are advanced by gravity,
+//      and each sphere gets the key hash(cell) & mask, where the cells of
+//      a uniform grid have the diameter of the largest sphere.
+//   2. Radix sort. The (key, sphere) pairs are sorted by key with 4 bits
+//      per pass: per-group digit counts, one exclusive scan of the counts
+//      and a stable scatter.
+//   3. Cell starts. The first sorted index of each key is stored in a
+//      table indexed by key. The table is not cleared between ticks; an
+//      entry is valid only when the sorted key at its index matches, which
+//      is the case for every key of the current tick.
+//   4. Jacobi iterations. Each sphere visits the 27 cells around its own,
+//      computes the impulses of its approaching contacts with spheres and
+//      planes from the velocities of the previous iteration and applies
+//      the average of its impulses. The velocities alternate between two
+//      buffers, so the number of iterations is even.
+//   5. Separation. Each sphere computes the average of the displacements
+//      that remove its overlaps, split by inverse mass as in
+//      PhysicsModule::UndoSphereOverlap.
+//   6. Integration. The positions and orientations are advanced by
+//      symplectic Euler steps, and the world matrix of each sphere, with
+//      its radius as scale, is written to the instance buffer.
+// The instance buffer can be passed to InstancedTexture2Effect, so the
+// spheres are drawn directly from the simulation state.
+//
+// Unlike PhysicsModule there is no friction, no sleeping and no continuous
+// collision detection; the angular velocities are constant. The solver is
+// order-independent, so the results do not match those of PhysicsModule.
+//
+// The module is independent of the graphics engine. The function object
+// 'postUpdate' copies a buffer to the GPU and 'execute' runs a compute
+// program, typically by calling GraphicsEngine::Update and
+// GraphicsEngine::Execute on the thread that owns the engine.
+
+class GPUPhysicsModule
+{
+public:
+	GPUPhysicsModule(std::shared_ptr<ProgramFactory> const& factory,
+		BufferUpdater const& postUpdate, ProgramExecutor const& execute,
+		size_t numSpheres, float xMin, float xMax, float yMin, float yMax,
+		float zMin, float zMax);
+
+	// This function must be called for each of the numSpheres sphere objects
+	// before the first tick. The state is copied to the GPU when the engine
+	// first uses the buffers, so it cannot be changed after the first tick.
+	void InitializeSphere(size_t i, float radius, float massDensity,
+		Vector3<float> const& position, Vector3<float> const& linearVelocity,
+		Quaternion<float> const& qOrientation, Vector3<float> const& angularVelocity);
+
+	inline size_t GetNumSpheres() const
+	{
+		return mNumSpheres;
+	}
+
+	// Execute the physics simulation for one time step.
+	void DoTick(float deltaTime);
+
+	// The coefficient of restitution of all contacts, in [0,1]. The
+	// default is 0.8.
+	void SetRestitution(float restitution);
+
+	inline float GetRestitution() const
+	{
+		return mRestitution;
+	}
+
+	// The number of Jacobi iterations of a tick, rounded up to an even
+	// number. The default is 4.
+	void SetNumIterations(size_t numIterations);
+
+	inline size_t GetNumIterations() const
+	{
+		return mNumIterations;
+	}
+
+	// The sphere state. Element i of the position buffer is (center,
+	// radius) of sphere i, element i of the orientation buffer is its
+	// quaternion and element i of the instance buffer is its world matrix
+	// as a Matrix4x4<float>.
+	inline std::shared_ptr<StructuredBuffer> const& GetPositionBuffer() const
+	{
+		return mPosition;
+	}
+
+	inline std::shared_ptr<StructuredBuffer> const& GetOrientationBuffer() const
+	{
+		return mOrientation;
+	}
+
+	inline std::shared_ptr<StructuredBuffer> const& GetInstanceBuffer() const
+	{
+		return mInstance;
+	}
+
+private:
+	// The member layout of the Parameters constant buffer of the programs.
+	struct Parameters
+	{
+		Vector4<float> regionMin;      // (xMin, yMin, zMin, restitution)
+		Vector4<float> regionMax;      // (xMax, yMax, zMax, 1/cellSize)
+		Vector4<float> gravityDelta;   // (0, 0, -9.81, deltaTime)
+	};
+
+	void CreatePrograms();
+
+	// Compile a program with the sizes of the module as defines. The radix
+	// shift selects the 4 bits of the keys that a sort pass processes.
+	std::shared_ptr<ComputeProgram> CreateProgram(ProgramSources const& source,
+		bool useCommon, uint32_t radixShift);
+
+	std::shared_ptr<ProgramFactory> mFactory;
+	BufferUpdater mPostUpdate;
+	ProgramExecutor mExecute;
+	size_t mNumSpheres;
+	uint32_t mNumGroups;
+	Vector3<float> mRegionMin, mRegionMax;
+	float mMaxRadius;
+	float mRestitution;
+	size_t mNumIterations;
+	float mDeltaTime;
+	bool mParametersDirty, mStarted;
+
+	// The hash table has 2^numTableBits entries, at least twice the number
+	// of spheres, and the keys are sorted with 4 bits per pass.
+	uint32_t mNumTableBits, mNumRadixPasses;
+
+	// The sphere state. The velocity buffers store (linear velocity,
+	// inverse mass) and alternate during the Jacobi iterations; the
+	// velocities of a tick start and end in mVelocity[0].
+	std::shared_ptr<StructuredBuffer> mPosition, mOrientation, mInstance;
+	std::array<std::shared_ptr<StructuredBuffer>, 2> mVelocity;
+	std::shared_ptr<StructuredBuffer> mAngularVelocity, mSeparation;
+
+	// The sort state. The keys and sphere indices alternate between the
+	// two buffers in the radix passes.
+	std::array<std::shared_ptr<StructuredBuffer>, 2> mKeys, mValues;
+	std::shared_ptr<StructuredBuffer> mDigitCounts, mCellStart;
+	std::shared_ptr<ConstantBuffer> mParameters;
+
+	std::shared_ptr<ComputeProgram> mHashProgram;
+	std::vector<std::shared_ptr<ComputeProgram>> mCountPrograms, mScatterPrograms;
+	std::shared_ptr<ComputeProgram> mScanProgram;
+	std::shared_ptr<ComputeProgram> mCellStartProgram;
+	std::array<std::shared_ptr<ComputeProgram>, 2> mSolvePrograms;
+	std::shared_ptr<ComputeProgram> mSeparateProgram;
+	std::shared_ptr<ComputeProgram> mIntegrateProgram;
+
+	// Shader source code as strings. The programs that use the Parameters
+	// constant buffer or the cell hashing are prefixed by msCommonSource.
+	static std::string const msGLSLCommonSource, msHLSLCommonSource;
+	static std::string const msGLSLHashSource, msHLSLHashSource;
+	static std::string const msGLSLCountSource, msHLSLCountSource;
+	static std::string const msGLSLScanSource, msHLSLScanSource;
+	static std::string const msGLSLScatterSource, msHLSLScatterSource;
+	static std::string const msGLSLCellStartSource, msHLSLCellStartSource;
+	static std::string const msGLSLSolveSource, msHLSLSolveSource;
+	static std::string const msGLSLSeparateSource, msHLSLSeparateSource;
+	static std::string const msGLSLIntegrateSource, msHLSLIntegrateSource;
+	static ProgramSources const msCommonSource, msHashSource, msCountSource, msScanSource,
+		msScatterSource, msCellStartSource, msSolveSource, msSeparateSource,
+		msIntegrateSource;
+};
@@ -1,20 +1,1091 @@
-// Geometry_Collision.cpp : This file contains the 'main' function. Program execution begins and ends there.
+// Geometry_Collision.cpp : Headless benchmark for the PhysicsModule. The
+// program builds a scene of randomly placed spheres in an axis-aligned box,
+// runs the simulation for a number of ticks and writes the timings to
+// stdout as a JSON object, so the results of different commits can be
+// compared by a script. Unlike the BouncingSpheresWindow3 demo there is no
+// rendering and no frame pacing.
 //
+// Usage: Geometry_Collision [options]
+//   --spheres n        number of spheres (default 1024)
+//   --ticks n          number of timed ticks (default 1000)
+//   --warmup n         number of untimed ticks before timing (default 0)
+//   --dt t             simulation time step in seconds (default 0.001)
+//   --radius r0 r1     sphere radii are uniform in [r0,r1] (default 0.2 0.4)
+//   --density d        mass density of the spheres (default 1.0)
+//   --restitution e    coefficient of restitution (default 0.8)
+//   --region x y z     the region is [0,x]*[0,y]*[0,z] (default 32 32 16)
+//   --speed s          initial velocity components are uniform in [-s,s]
+//                      (default 1.0)
+//   --broadphase name  brute, grid, sweep, tree, hierarchy or auto
+//                      (default grid)
+//   --integrator name  scalar or batched (default scalar)
+//   --method name      rk4, euler or verlet, the Runge-Kutta, semi-implicit
+//                      Euler or velocity Verlet integration method
+//                      (default rk4)
+//   --solver name      single or sequential (default single)
+//   --threads n        number of threads, 0 for the calling thread
+//                      (default 0)
+//   --numa n           partition the threads and the spheres into n NUMA
+//                      nodes, see PhysicsModule::SetNumaNodes; the spheres
+//                      are sorted into the chunks of the nodes once, before
+//                      the warmup ticks (default 0, no partitioning)
+//   --ccd              enable continuous collision detection
+//   --precision name   float, double or compare (default double). The
+//                      compare mode runs the same scene with both types,
+//                      reports the timings of the float module and adds
+//                      the double timing and the position drift of the
+//                      float spheres relative to the double spheres
+//   --seed n           random number seed (default 0)
+//   --containers       instead of the simulation, run the contention
+//                      benchmark of the concurrent containers. The
+//                      mutex-based ThreadSafeQueue and ThreadSafeMap are
+//                      compared with LockFreeQueue and ShardedMap at 2, 4,
+//                      8, 16 and 32 threads
+//   --operations n     number of container operations per thread
+//                      (default 1000000)
+//   --meshes           instead of the simulation, run the benchmark of the
+//                      triangle mesh construction. The triangles of an
+//                      n-by-n grid of squares, in random order, are
+//                      inserted into an ETManifoldMesh and are used to
+//                      construct and rebuild a StaticVETManifoldMesh2 on
+//                      the calling thread and on --threads threads
+//   --grid n           number of squares per side of the grid (default 256)
+//   --rebuilds n       number of timed rebuilds (default 10)
+//   --energy           instead of the timing report, run the scene with each
+//                      integration method and report the integration time
+//                      and the drift of the total energy, kinetic plus
+//                      gravitational, relative to the initial energy. Use
+//                      --restitution 1 so that the collisions do not
+//                      dissipate energy; the friction on the floor still
+//                      does
+//   --numa-scaling     instead of the timing report, run the scene on one
+//                      and on two NUMA nodes (sockets) with --threads
+//                      threads per node, 0 for the processors of a node,
+//                      and report the tick times and the speedups relative
+//                      to one node. The two-node scene is run without and
+//                      with partitioning
+//   --thread-scaling   instead of the timing report, run the scene on the
+//                      calling thread and on 1, 2, 4, 8, ... threads up to
+//                      --threads, 0 for 16, and report the tick times, the
+//                      speedups relative to 1 thread and whether the final
+//                      centers equal those of the 1-thread run
+//   --validation       instead of the timing report, time the code paths
+//                      whose assertions follow the GTE_VALIDATION policy of
+//                      Logger.h: the GMatrix element access, the
+//                      NearestNeighborQuery updates and the simulation
+//                      tick. The policy is selected at compile time, so
+//                      compare the reports of builds with -DGTE_VALIDATION
+//                      set to GTE_VALIDATION_FULL, GTE_VALIDATION_DEBUG and
+//                      GTE_VALIDATION_NONE
 
-#include <iostream>
+#include "PhysModule.h"
+#include "NumaTopology.h"
+#include "ETManifoldMesh.h"
+#include "GMatrix.h"
+#include "NearestNeighborQuery.h"
+#include "StaticVETManifoldMesh2.h"
+#include "LockFreeQueue.h"
+#include "ShardedMap.h"
+#include "ThreadSafeMap.h"
+#include "ThreadSafeQueue.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
 
-int main()
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#if defined(_MSC_VER)
+#pragma comment(lib, "psapi.lib")
+#endif
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
 {
-    std::cout << "Hello World!\n";
+	struct Options
+	{
+		size_t numSpheres = 1024;
+		size_t numTicks = 1000;
+		size_t numWarmupTicks = 0;
+		double deltaTime = 0.001;
+		double minRadius = 0.2;
+		double maxRadius = 0.4;
+		double massDensity = 1.0;
+		double restitution = 0.8;
+		double region[3] = { 32.0, 32.0, 16.0 };
+		double speed = 1.0;
+		std::string broadphase = "grid";
+		std::string integrator = "scalar";
+		std::string method = "rk4";
+		std::string solver = "single";
+		size_t numThreads = 0;
+		size_t numaNodes = 0;
+		bool continuousCollision = false;
+		std::string precision = "double";
+		uint32_t seed = 0;
+		bool containers = false;
+		size_t numOperations = 1000000;
+		bool meshes = false;
+		size_t gridSize = 256;
+		size_t numRebuilds = 10;
+		bool energy = false;
+		bool validation = false;
+		bool numaScaling = false;
+		bool threadScaling = false;
+	};
+
+	// The accumulated statistics of the timed ticks and the final sphere
+	// centers of one run.
+	struct RunResult
+	{
+		int64_t total = 0, detection = 0, response = 0, integration = 0;
+		int64_t broadphase = 0, spherePlane = 0, sphereSphere = 0, continuous = 0;
+		uint64_t numPairsTested = 0, numContacts = 0, numBodiesIntegrated = 0;
+		size_t maxContacts = 0;
+		double initialEnergy = 0.0, finalEnergy = 0.0, maxEnergyDrift = 0.0;
+		std::vector<Vector3<double>> centers;
+	};
+
+	// The peak resident memory of the process in bytes, or 0 when it is
+	// not available.
+	uint64_t GetPeakMemory()
+	{
+#if defined(_WIN32)
+		PROCESS_MEMORY_COUNTERS counters{};
+		if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		{
+			return static_cast<uint64_t>(counters.PeakWorkingSetSize);
+		}
+		return 0;
+#else
+		struct rusage usage {};
+		if (getrusage(RUSAGE_SELF, &usage) == 0)
+		{
+#if defined(__APPLE__)
+			return static_cast<uint64_t>(usage.ru_maxrss);
+#else
+			return static_cast<uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+		}
+		return 0;
+#endif
+	}
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string const arg = argv[i];
+			int const numRemaining = argc - 1 - i;
+			auto needs = [numRemaining, &arg](int numValues)
+			{
+				if (numRemaining < numValues)
+				{
+					std::fprintf(stderr, "missing value for %s\n", arg.c_str());
+					return false;
+				}
+				return true;
+			};
+
+			if (arg == "--spheres" && needs(1))
+			{
+				options.numSpheres = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--ticks" && needs(1))
+			{
+				options.numTicks = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--warmup" && needs(1))
+			{
+				options.numWarmupTicks = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--dt" && needs(1))
+			{
+				options.deltaTime = std::atof(argv[++i]);
+			}
+			else if (arg == "--radius" && needs(2))
+			{
+				options.minRadius = std::atof(argv[++i]);
+				options.maxRadius = std::atof(argv[++i]);
+			}
+			else if (arg == "--density" && needs(1))
+			{
+				options.massDensity = std::atof(argv[++i]);
+			}
+			else if (arg == "--restitution" && needs(1))
+			{
+				options.restitution = std::atof(argv[++i]);
+			}
+			else if (arg == "--region" && needs(3))
+			{
+				for (int d = 0; d < 3; ++d)
+				{
+					options.region[d] = std::atof(argv[++i]);
+				}
+			}
+			else if (arg == "--speed" && needs(1))
+			{
+				options.speed = std::atof(argv[++i]);
+			}
+			else if (arg == "--broadphase" && needs(1))
+			{
+				options.broadphase = argv[++i];
+			}
+			else if (arg == "--integrator" && needs(1))
+			{
+				options.integrator = argv[++i];
+			}
+			else if (arg == "--method" && needs(1))
+			{
+				options.method = argv[++i];
+			}
+			else if (arg == "--solver" && needs(1))
+			{
+				options.solver = argv[++i];
+			}
+			else if (arg == "--threads" && needs(1))
+			{
+				options.numThreads = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--numa" && needs(1))
+			{
+				options.numaNodes = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--numa-scaling")
+			{
+				options.numaScaling = true;
+			}
+			else if (arg == "--thread-scaling")
+			{
+				options.threadScaling = true;
+			}
+			else if (arg == "--ccd")
+			{
+				options.continuousCollision = true;
+			}
+			else if (arg == "--precision" && needs(1))
+			{
+				options.precision = argv[++i];
+			}
+			else if (arg == "--seed" && needs(1))
+			{
+				options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else if (arg == "--containers")
+			{
+				options.containers = true;
+			}
+			else if (arg == "--operations" && needs(1))
+			{
+				options.numOperations = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--meshes")
+			{
+				options.meshes = true;
+			}
+			else if (arg == "--grid" && needs(1))
+			{
+				options.gridSize = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--rebuilds" && needs(1))
+			{
+				options.numRebuilds = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--energy")
+			{
+				options.energy = true;
+			}
+			else if (arg == "--validation")
+			{
+				options.validation = true;
+			}
+			else
+			{
+				std::fprintf(stderr, "invalid option %s\n", arg.c_str());
+				return false;
+			}
+		}
+
+		bool const validNames =
+			(options.broadphase == "brute" || options.broadphase == "grid" ||
+			options.broadphase == "sweep" || options.broadphase == "tree" ||
+			options.broadphase == "hierarchy" || options.broadphase == "auto") &&
+			(options.integrator == "scalar" || options.integrator == "batched") &&
+			(options.method == "rk4" || options.method == "euler" ||
+			options.method == "verlet") &&
+			(options.solver == "single" || options.solver == "sequential") &&
+			(options.precision == "float" || options.precision == "double" ||
+			options.precision == "compare");
+		if (!validNames || options.numSpheres == 0 || options.deltaTime <= 0.0 ||
+			options.minRadius <= 0.0 || options.maxRadius < options.minRadius)
+		{
+			std::fprintf(stderr, "invalid option value\n");
+			return false;
+		}
+
+		for (int d = 0; d < 3; ++d)
+		{
+			if (options.region[d] <= 2.0 * options.maxRadius)
+			{
+				std::fprintf(stderr, "the region must be larger than the spheres\n");
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// Build the scene with spheres of type Real and run the simulation. The
+	// random numbers are drawn in double and converted, so the float and
+	// double modules start from the same scene up to rounding.
+	template <typename Real>
+	RunResult Run(Options const& options)
+	{
+		PhysicsModule<Real> module(options.numSpheres, static_cast<Real>(0),
+			static_cast<Real>(options.region[0]), static_cast<Real>(0),
+			static_cast<Real>(options.region[1]), static_cast<Real>(0),
+			static_cast<Real>(options.region[2]));
+		module.SetRestitution(static_cast<Real>(options.restitution));
+		if (options.broadphase == "grid")
+		{
+			module.SetBroadphase(PhysicsModule<Real>::Broadphase::UNIFORM_GRID);
+		}
+		else if (options.broadphase == "sweep")
+		{
+			module.SetBroadphase(PhysicsModule<Real>::Broadphase::SORT_AND_SWEEP);
+		}
+		else if (options.broadphase == "tree")
+		{
+			module.SetBroadphase(PhysicsModule<Real>::Broadphase::AABB_TREE);
+		}
+		else if (options.broadphase == "hierarchy")
+		{
+			module.SetBroadphase(PhysicsModule<Real>::Broadphase::HIERARCHICAL_GRID);
+		}
+		else if (options.broadphase == "auto")
+		{
+			module.SetBroadphase(PhysicsModule<Real>::Broadphase::AUTOMATIC);
+		}
+		if (options.integrator == "batched")
+		{
+			module.SetIntegrator(PhysicsModule<Real>::Integrator::BATCHED);
+		}
+		if (options.method == "euler")
+		{
+			module.SetIntegrationMethod(PhysicsModule<Real>::IntegrationMethod::SEMI_IMPLICIT_EULER);
+		}
+		else if (options.method == "verlet")
+		{
+			module.SetIntegrationMethod(PhysicsModule<Real>::IntegrationMethod::VELOCITY_VERLET);
+		}
+		if (options.solver == "sequential")
+		{
+			module.SetSolver(PhysicsModule<Real>::Solver::SEQUENTIAL_IMPULSE);
+		}
+		module.SetNumThreads(options.numThreads);
+		module.SetContinuousCollision(options.continuousCollision);
+
+		// The spheres are placed at random inside the region. They may
+		// overlap initially; the first ticks separate them.
+		std::mt19937 mte(options.seed);
+		std::uniform_real_distribution<double> unit(0.0, 1.0);
+		std::uniform_real_distribution<double> velocity(-options.speed, options.speed);
+		for (size_t i = 0; i < options.numSpheres; ++i)
+		{
+			double radius = options.minRadius +
+				(options.maxRadius - options.minRadius) * unit(mte);
+			Vector3<Real> center{};
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				center[d] = static_cast<Real>(radius + (options.region[d] - 2.0 * radius) * unit(mte));
+			}
+			Vector3<Real> linearVelocity{};
+			Vector3<Real> angularVelocity{};
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				linearVelocity[d] = static_cast<Real>(velocity(mte));
+			}
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				angularVelocity[d] = static_cast<Real>(velocity(mte));
+			}
+			module.InitializeSphere(i, static_cast<Real>(radius),
+				static_cast<Real>(options.massDensity), center, linearVelocity,
+				Quaternion<Real>::Identity(), angularVelocity);
+		}
+
+		if (options.numaNodes > 0)
+		{
+			module.SetNumaNodes(options.numaNodes);
+			module.PartitionSpheres();
+		}
+
+		double time = 0.0;
+		for (size_t tick = 0; tick < options.numWarmupTicks; ++tick)
+		{
+			module.DoTick(time, options.deltaTime);
+			time += options.deltaTime;
+		}
+
+		RunResult result{};
+		result.initialEnergy = module.GetEnergy();
+		result.finalEnergy = result.initialEnergy;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t tick = 0; tick < options.numTicks; ++tick)
+		{
+			module.DoTick(time, options.deltaTime);
+			time += options.deltaTime;
+			if (options.energy)
+			{
+				result.finalEnergy = module.GetEnergy();
+				result.maxEnergyDrift = std::max(result.maxEnergyDrift,
+					std::fabs(result.finalEnergy - result.initialEnergy));
+			}
+
+			auto const& statistics = module.GetTickStatistics();
+			result.detection += statistics.detectionNanoseconds;
+			result.response += statistics.responseNanoseconds;
+			result.integration += statistics.integrationNanoseconds;
+			result.broadphase += statistics.broadphaseNanoseconds;
+			result.spherePlane += statistics.spherePlaneNanoseconds;
+			result.sphereSphere += statistics.sphereSphereNanoseconds;
+			result.continuous += statistics.continuousNanoseconds;
+			result.numPairsTested += statistics.numPairsTested;
+			result.numContacts += statistics.numContacts;
+			result.numBodiesIntegrated += statistics.numBodiesIntegrated;
+			result.maxContacts = std::max(result.maxContacts, statistics.numContacts);
+		}
+		auto stop = std::chrono::steady_clock::now();
+		result.total = std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+
+		// The centers are stored by handle, because PartitionSpheres changes
+		// the indices.
+		result.centers.resize(options.numSpheres);
+		for (size_t i = 0; i < options.numSpheres; ++i)
+		{
+			auto const& center = module.GetSpheres().position[module.GetSphereIndex(i)];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				result.centers[i][d] = static_cast<double>(center[d]);
+			}
+		}
+		return result;
+	}
+
+	// Run 'function(t)' on numThreads threads that start together and
+	// return the elapsed time in nanoseconds.
+	template <typename Function>
+	int64_t TimeThreads(size_t numThreads, Function const& function)
+	{
+		std::atomic<size_t> numReady(0);
+		std::atomic<bool> go(false);
+		std::vector<std::thread> threads(numThreads);
+		for (size_t t = 0; t < numThreads; ++t)
+		{
+			threads[t] = std::thread([&numReady, &go, &function, t]()
+			{
+				numReady.fetch_add(1);
+				while (!go.load())
+				{
+					std::this_thread::yield();
+				}
+				function(t);
+			});
+		}
+		while (numReady.load() < numThreads)
+		{
+			std::this_thread::yield();
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		go.store(true);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		auto stop = std::chrono::steady_clock::now();
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+	}
+
+	// Half of the threads push numOperations elements each and the other
+	// half pop the same number. A thread that finds the queue full or empty
+	// yields and retries.
+	template <typename Queue>
+	int64_t TimeQueue(size_t numThreads, size_t numOperations)
+	{
+		size_t const maxNumElements = 1024;
+		Queue queue(maxNumElements);
+		size_t const numProducers = numThreads / 2;
+		return TimeThreads(numThreads, [&queue, numProducers, numOperations](size_t t)
+		{
+			if (t < numProducers)
+			{
+				for (size_t i = 0; i < numOperations; ++i)
+				{
+					while (!queue.Push(static_cast<uint64_t>(i)))
+					{
+						std::this_thread::yield();
+					}
+				}
+			}
+			else
+			{
+				uint64_t element = 0;
+				for (size_t i = 0; i < numOperations; ++i)
+				{
+					while (!queue.Pop(element))
+					{
+						std::this_thread::yield();
+					}
+				}
+			}
+		});
+	}
+
+	// Each thread performs numOperations operations on random keys, 80%
+	// lookups, 10% insertions and 10% removals, on a map that initially
+	// holds half of the keys.
+	template <typename Map>
+	int64_t TimeMap(size_t numThreads, size_t numOperations, uint32_t seed)
+	{
+		uint32_t const numKeys = 65536;
+		Map map;
+		for (uint32_t key = 0; key < numKeys; key += 2)
+		{
+			map.Insert(key, static_cast<uint64_t>(key));
+		}
+
+		return TimeThreads(numThreads, [&map, numOperations, numKeys, seed](size_t t)
+		{
+			std::mt19937 mte(seed + static_cast<uint32_t>(t));
+			std::uniform_int_distribution<uint32_t> keyDistribution(0, numKeys - 1);
+			std::uniform_int_distribution<uint32_t> opDistribution(0, 9);
+			uint64_t value = 0;
+			for (size_t i = 0; i < numOperations; ++i)
+			{
+				uint32_t const key = keyDistribution(mte);
+				uint32_t const op = opDistribution(mte);
+				if (op == 0)
+				{
+					map.Insert(key, static_cast<uint64_t>(key));
+				}
+				else if (op == 1)
+				{
+					map.Remove(key, value);
+				}
+				else
+				{
+					map.Get(key, value);
+				}
+			}
+		});
+	}
+
+	// The contention benchmark of the concurrent containers. The timings
+	// are reported in nanoseconds per operation of one thread.
+	void RunContainers(Options const& options)
+	{
+		size_t const numThreadsList[] = { 2, 4, 8, 16, 32 };
+		double const numOperations = static_cast<double>(
+			options.numOperations > 0 ? options.numOperations : 1);
+
+		std::printf("{\n");
+		std::printf("  \"operations\": %zu,\n", options.numOperations);
+		std::printf("  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+		std::printf("  \"ns_per_operation\": [\n");
+		for (size_t j = 0; j < 5; ++j)
+		{
+			size_t const numThreads = numThreadsList[j];
+			int64_t const mutexQueue = TimeQueue<gte::ThreadSafeQueue<uint64_t>>(
+				numThreads, options.numOperations);
+			int64_t const lockFreeQueue = TimeQueue<gte::LockFreeQueue<uint64_t>>(
+				numThreads, options.numOperations);
+			int64_t const mutexMap = TimeMap<gte::ThreadSafeMap<uint32_t, uint64_t>>(
+				numThreads, options.numOperations, options.seed);
+			int64_t const shardedMap = TimeMap<gte::ShardedMap<uint32_t, uint64_t>>(
+				numThreads, options.numOperations, options.seed);
+
+			std::printf("    {\n");
+			std::printf("      \"threads\": %zu,\n", numThreads);
+			std::printf("      \"thread_safe_queue\": %.1f,\n", static_cast<double>(mutexQueue) / numOperations);
+			std::printf("      \"lock_free_queue\": %.1f,\n", static_cast<double>(lockFreeQueue) / numOperations);
+			std::printf("      \"thread_safe_map\": %.1f,\n", static_cast<double>(mutexMap) / numOperations);
+			std::printf("      \"sharded_map\": %.1f\n", static_cast<double>(shardedMap) / numOperations);
+			std::printf("    }%s\n", j + 1 < 5 ? "," : "");
+		}
+		std::printf("  ]\n");
+		std::printf("}\n");
+	}
+
+	// The benchmark of the triangle mesh construction. The timings are
+	// reported in nanoseconds per mesh. A rebuild reuses the arrays of the
+	// mesh, so after the first rebuild it does not allocate memory.
+	void RunMeshes(Options const& options)
+	{
+		size_t const n = std::max(options.gridSize, static_cast<size_t>(1));
+		size_t const numVertices = (n + 1) * (n + 1);
+		std::vector<std::array<size_t, 3>> triangles{};
+		triangles.reserve(2 * n * n);
+		for (size_t r = 0; r < n; ++r)
+		{
+			for (size_t c = 0; c < n; ++c)
+			{
+				size_t const v = c + (n + 1) * r;
+				triangles.push_back({ v, v + 1, v + n + 2 });
+				triangles.push_back({ v, v + n + 2, v + n + 1 });
+			}
+		}
+		std::mt19937 mte(options.seed);
+		std::shuffle(triangles.begin(), triangles.end(), mte);
+
+		auto Elapsed = [](std::chrono::steady_clock::time_point const& start)
+		{
+			auto stop = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		ETManifoldMesh dynamicMesh{};
+		for (auto const& tri : triangles)
+		{
+			dynamicMesh.Insert(static_cast<int32_t>(tri[0]),
+				static_cast<int32_t>(tri[1]), static_cast<int32_t>(tri[2]));
+		}
+		int64_t const dynamicTime = Elapsed(start);
+
+		size_t const numRebuilds = std::max(options.numRebuilds, static_cast<size_t>(1));
+		size_t const numThreadsList[] = { 1, std::max(options.numThreads, static_cast<size_t>(1)) };
+		int64_t constructTime[2] = { 0, 0 }, rebuildTime[2] = { 0, 0 };
+		for (size_t j = 0; j < 2; ++j)
+		{
+			start = std::chrono::steady_clock::now();
+			StaticVETManifoldMesh2 staticMesh(numVertices, triangles, numThreadsList[j]);
+			constructTime[j] = Elapsed(start);
+
+			start = std::chrono::steady_clock::now();
+			for (size_t i = 0; i < numRebuilds; ++i)
+			{
+				staticMesh.Rebuild(numVertices, triangles, numThreadsList[j]);
+			}
+			rebuildTime[j] = Elapsed(start) / static_cast<int64_t>(numRebuilds);
+		}
+
+		std::printf("{\n");
+		std::printf("  \"grid\": %zu,\n", n);
+		std::printf("  \"vertices\": %zu,\n", numVertices);
+		std::printf("  \"triangles\": %zu,\n", triangles.size());
+		std::printf("  \"rebuilds\": %zu,\n", numRebuilds);
+		std::printf("  \"threads\": %zu,\n", numThreadsList[1]);
+		std::printf("  \"seed\": %u,\n", static_cast<unsigned>(options.seed));
+		std::printf("  \"ns_per_mesh\": {\n");
+		std::printf("    \"et_manifold_mesh\": %lld,\n", static_cast<long long>(dynamicTime));
+		std::printf("    \"static_construct\": %lld,\n", static_cast<long long>(constructTime[0]));
+		std::printf("    \"static_rebuild\": %lld,\n", static_cast<long long>(rebuildTime[0]));
+		std::printf("    \"static_construct_threaded\": %lld,\n", static_cast<long long>(constructTime[1]));
+		std::printf("    \"static_rebuild_threaded\": %lld\n", static_cast<long long>(rebuildTime[1]));
+		std::printf("  },\n");
+		std::printf("  \"peak_memory_bytes\": %llu\n",
+			static_cast<unsigned long long>(GetPeakMemory()));
+		std::printf("}\n");
+	}
+
+	// The energy drift of the integration methods. Each method runs the
+	// same scene; the drifts are relative to the initial energy.
+	void RunEnergy(Options const& options)
+	{
+		char const* methods[] = { "rk4", "euler", "verlet" };
+		double const numTicks = static_cast<double>(options.numTicks > 0 ? options.numTicks : 1);
+
+		std::printf("{\n");
+		std::printf("  \"spheres\": %zu,\n", options.numSpheres);
+		std::printf("  \"ticks\": %zu,\n", options.numTicks);
+		std::printf("  \"dt\": %.9g,\n", options.deltaTime);
+		std::printf("  \"restitution\": %.9g,\n", options.restitution);
+		std::printf("  \"seed\": %u,\n", static_cast<unsigned>(options.seed));
+		std::printf("  \"methods\": [\n");
+		for (size_t j = 0; j < 3; ++j)
+		{
+			Options methodOptions = options;
+			methodOptions.method = methods[j];
+			RunResult const result = Run<double>(methodOptions);
+			double const scale = (result.initialEnergy != 0.0 ? std::fabs(result.initialEnergy) : 1.0);
+
+			std::printf("    {\n");
+			std::printf("      \"method\": \"%s\",\n", methods[j]);
+			std::printf("      \"integration_ns_per_tick\": %.1f,\n",
+				static_cast<double>(result.integration) / numTicks);
+			std::printf("      \"initial_energy\": %.9g,\n", result.initialEnergy);
+			std::printf("      \"final_energy\": %.9g,\n", result.finalEnergy);
+			std::printf("      \"final_drift\": %.9g,\n",
+				(result.finalEnergy - result.initialEnergy) / scale);
+			std::printf("      \"max_drift\": %.9g\n", result.maxEnergyDrift / scale);
+			std::printf("    }%s\n", j + 1 < 3 ? "," : "");
+		}
+		std::printf("  ]\n");
+		std::printf("}\n");
+	}
+
+	// The name of the GTE_VALIDATION policy of the build.
+	char const* GetValidationName()
+	{
+#if GTE_VALIDATION == GTE_VALIDATION_NONE
+		return "none";
+#elif GTE_VALIDATION == GTE_VALIDATION_DEBUG
+		return "debug";
+#else
+		return "full";
+#endif
+	}
+
+	// The cost of the assertions on hot paths for the policy of the build:
+	// a GMatrix product through the checked element access, the Move of
+	// every site of a NearestNeighborQuery, which asserts the site index,
+	// and a simulation tick.
+	void RunNumaScaling(Options const& options)
+	{
+		size_t const numMachineNodes = NumaTopology().GetNumNodes();
+		size_t threadsPerNode = options.numThreads;
+		if (threadsPerNode == 0)
+		{
+			threadsPerNode = std::max(static_cast<size_t>(std::thread::hardware_concurrency()) /
+				numMachineNodes, static_cast<size_t>(1));
+		}
+
+		// One node with its threads pinned, then two nodes with twice the
+		// threads, unpinned on interleaved storage and partitioned.
+		struct Configuration
+		{
+			size_t numNodes, numaNodes;
+		};
+		std::array<Configuration, 3> const configurations{ {
+			{ 1, 1 }, { 2, 0 }, { 2, 2 } } };
+		double const numTicks = static_cast<double>(options.numTicks > 0 ? options.numTicks : 1);
+
+		std::printf("{\n");
+		std::printf("  \"spheres\": %zu,\n", options.numSpheres);
+		std::printf("  \"ticks\": %zu,\n", options.numTicks);
+		std::printf("  \"broadphase\": \"%s\",\n", options.broadphase.c_str());
+		std::printf("  \"machine_nodes\": %zu,\n", numMachineNodes);
+		std::printf("  \"threads_per_node\": %zu,\n", threadsPerNode);
+		std::printf("  \"runs\": [\n");
+		double reference = 0.0;
+		for (size_t j = 0; j < configurations.size(); ++j)
+		{
+			Options runOptions = options;
+			runOptions.numThreads = configurations[j].numNodes * threadsPerNode;
+			runOptions.numaNodes = configurations[j].numaNodes;
+			RunResult const result = Run<double>(runOptions);
+			double const total = static_cast<double>(result.total) / numTicks;
+			if (j == 0)
+			{
+				reference = total;
+			}
+
+			std::printf("    {\n");
+			std::printf("      \"nodes\": %zu,\n", configurations[j].numNodes);
+			std::printf("      \"threads\": %zu,\n", runOptions.numThreads);
+			std::printf("      \"partitioned\": %s,\n", runOptions.numaNodes > 0 ? "true" : "false");
+			std::printf("      \"total_ns_per_tick\": %.1f,\n", total);
+			std::printf("      \"detection_ns_per_tick\": %.1f,\n",
+				static_cast<double>(result.detection) / numTicks);
+			std::printf("      \"integration_ns_per_tick\": %.1f,\n",
+				static_cast<double>(result.integration) / numTicks);
+			std::printf("      \"speedup\": %.3f\n", total > 0.0 ? reference / total : 0.0);
+			std::printf("    }%s\n", j + 1 < configurations.size() ? "," : "");
+		}
+		std::printf("  ]\n");
+		std::printf("}\n");
+	}
+
+	void RunThreadScaling(Options const& options)
+	{
+		// The calling thread (0 threads) first, then powers of two up to
+		// the maximum, which is also run when it is not a power of two.
+		size_t const maxNumThreads = (options.numThreads > 0 ? options.numThreads : 16);
+		std::vector<size_t> numThreadsList{ 0 };
+		for (size_t numThreads = 1; numThreads < maxNumThreads; numThreads *= 2)
+		{
+			numThreadsList.push_back(numThreads);
+		}
+		numThreadsList.push_back(maxNumThreads);
+		double const numTicks = static_cast<double>(options.numTicks > 0 ? options.numTicks : 1);
+
+		std::printf("{\n");
+		std::printf("  \"spheres\": %zu,\n", options.numSpheres);
+		std::printf("  \"ticks\": %zu,\n", options.numTicks);
+		std::printf("  \"broadphase\": \"%s\",\n", options.broadphase.c_str());
+		std::printf("  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+		std::printf("  \"runs\": [\n");
+
+		// The speedups and the centers are compared with the 1-thread run,
+		// the second in the list. The multithreaded results do not depend
+		// on the number of threads, but they can differ slightly from those
+		// of the calling thread; see PhysicsModule::SetNumThreads.
+		double reference = 0.0;
+		std::vector<Vector3<double>> referenceCenters{};
+		for (size_t j = 0; j < numThreadsList.size(); ++j)
+		{
+			Options runOptions = options;
+			runOptions.numThreads = numThreadsList[j];
+			runOptions.numaNodes = 0;
+			RunResult const result = Run<double>(runOptions);
+			double const total = static_cast<double>(result.total) / numTicks;
+			if (j == 1)
+			{
+				reference = total;
+				referenceCenters = result.centers;
+			}
+
+			std::printf("    {\n");
+			std::printf("      \"threads\": %zu,\n", runOptions.numThreads);
+			std::printf("      \"total_ns_per_tick\": %.1f,\n", total);
+			std::printf("      \"detection_ns_per_tick\": %.1f,\n",
+				static_cast<double>(result.detection) / numTicks);
+			std::printf("      \"response_ns_per_tick\": %.1f,\n",
+				static_cast<double>(result.response) / numTicks);
+			std::printf("      \"integration_ns_per_tick\": %.1f,\n",
+				static_cast<double>(result.integration) / numTicks);
+			if (j >= 1)
+			{
+				std::printf("      \"speedup\": %.3f,\n", total > 0.0 ? reference / total : 0.0);
+				std::printf("      \"efficiency\": %.3f,\n", total > 0.0 ?
+					reference / (total * static_cast<double>(runOptions.numThreads)) : 0.0);
+				std::printf("      \"same_centers\": %s\n",
+					result.centers == referenceCenters ? "true" : "false");
+			}
+			else
+			{
+				std::printf("      \"speedup\": null\n");
+			}
+			std::printf("    }%s\n", j + 1 < numThreadsList.size() ? "," : "");
+		}
+		std::printf("  ]\n");
+		std::printf("}\n");
+	}
+
+	void RunValidation(Options const& options)
+	{
+		auto Elapsed = [](std::chrono::steady_clock::time_point const& start)
+		{
+			auto stop = std::chrono::steady_clock::now();
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(stop - start).count();
+		};
+
+		std::mt19937 mte(options.seed);
+		std::uniform_real_distribution<double> rnd(0.0, 1.0);
+
+		int32_t const size = 64;
+		size_t const numProducts = 16;
+		gte::GMatrix<double> A(size, size), B(size, size), C(size, size);
+		for (int32_t i = 0; i < size * size; ++i)
+		{
+			A[i] = rnd(mte);
+			B[i] = rnd(mte);
+		}
+		auto start = std::chrono::steady_clock::now();
+		for (size_t k = 0; k < numProducts; ++k)
+		{
+			for (int32_t r = 0; r < size; ++r)
+			{
+				for (int32_t c = 0; c < size; ++c)
+				{
+					double sum = 0.0;
+					for (int32_t j = 0; j < size; ++j)
+					{
+						sum += A(r, j) * B(j, c);
+					}
+					C(r, c) = sum;
+				}
+			}
+		}
+		int64_t const productTime = Elapsed(start) / static_cast<int64_t>(numProducts);
+
+		using Site = gte::PositionSite<3, double>;
+		size_t const numSites = options.numSpheres;
+		size_t const numMoves = 16;
+		std::vector<Site> sites{};
+		sites.reserve(numSites);
+		for (size_t i = 0; i < numSites; ++i)
+		{
+			sites.emplace_back(Vector3<double>{ options.region[0] * rnd(mte),
+				options.region[1] * rnd(mte), options.region[2] * rnd(mte) });
+		}
+		gte::NearestNeighborQuery<3, double, Site> query(sites, 8, 20);
+		double const step = 0.01;
+		start = std::chrono::steady_clock::now();
+		for (size_t k = 0; k < numMoves; ++k)
+		{
+			for (size_t i = 0; i < numSites; ++i)
+			{
+				Vector3<double>& position = sites[i].position;
+				for (int32_t d = 0; d < 3; ++d)
+				{
+					position[d] += step * (rnd(mte) - 0.5);
+				}
+				query.Move(static_cast<int32_t>(i), position);
+			}
+		}
+		int64_t const moveTime = Elapsed(start) / static_cast<int64_t>(numMoves * numSites);
+
+		RunResult const result = Run<double>(options);
+		double const numTicks = static_cast<double>(options.numTicks > 0 ? options.numTicks : 1);
+
+		std::printf("{\n");
+		std::printf("  \"validation\": \"%s\",\n", GetValidationName());
+		std::printf("  \"checks_enabled\": %s,\n", GTE_VALIDATION_ENABLED ? "true" : "false");
+		std::printf("  \"matrix_size\": %d,\n", static_cast<int>(size));
+		std::printf("  \"spheres\": %zu,\n", options.numSpheres);
+		std::printf("  \"ticks\": %zu,\n", options.numTicks);
+		std::printf("  \"seed\": %u,\n", static_cast<unsigned>(options.seed));
+		std::printf("  \"ns\": {\n");
+		std::printf("    \"gmatrix_product\": %lld,\n", static_cast<long long>(productTime));
+		std::printf("    \"nearest_neighbor_move\": %lld,\n", static_cast<long long>(moveTime));
+		std::printf("    \"simulation_tick\": %.1f\n", static_cast<double>(result.total) / numTicks);
+		std::printf("  },\n");
+		std::printf("  \"checksum\": %.9g\n", C(size - 1, size - 1));
+		std::printf("}\n");
+	}
 }
 
-// Run program: Ctrl + F5 or Debug > Start Without Debugging menu
-// Debug program: F5 or Debug > Start Debugging menu
+int main(int argc, char* argv[])
+{
+	Options options{};
+	if (!ParseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	if (options.containers)
+	{
+		RunContainers(options);
+		return 0;
+	}
+
+	if (options.meshes)
+	{
+		RunMeshes(options);
+		return 0;
+	}
 
-// Tips for Getting Started: 
-//   1. Use the Solution Explorer window to add/manage files
-//   2. Use the Team Explorer window to connect to source control
-//   3. Use the Output window to see build output and other messages
-//   4. Use the Error List window to view errors
-//   5. Go to Project > Add New Item to create new code files, or Project > Add Existing Item to add existing code files to the project
-//   6. In the future, to open this project again, go to File > Open > Project and select the .sln file
+	if (options.energy)
+	{
+		RunEnergy(options);
+		return 0;
+	}
+
+	if (options.validation)
+	{
+		RunValidation(options);
+		return 0;
+	}
+
+	if (options.numaScaling)
+	{
+		RunNumaScaling(options);
+		return 0;
+	}
+
+	if (options.threadScaling)
+	{
+		RunThreadScaling(options);
+		return 0;
+	}
+
+	RunResult result{}, reference{};
+	if (options.precision == "double")
+	{
+		result = Run<double>(options);
+	}
+	else
+	{
+		result = Run<float>(options);
+		if (options.precision == "compare")
+		{
+			reference = Run<double>(options);
+		}
+	}
+
+	double const numTicks = static_cast<double>(options.numTicks > 0 ? options.numTicks : 1);
+	std::printf("{\n");
+	std::printf("  \"spheres\": %zu,\n", options.numSpheres);
+	std::printf("  \"ticks\": %zu,\n", options.numTicks);
+	std::printf("  \"warmup\": %zu,\n", options.numWarmupTicks);
+	std::printf("  \"dt\": %.9g,\n", options.deltaTime);
+	std::printf("  \"radius\": [%.9g, %.9g],\n", options.minRadius, options.maxRadius);
+	std::printf("  \"density\": %.9g,\n", options.massDensity);
+	std::printf("  \"restitution\": %.9g,\n", options.restitution);
+	std::printf("  \"region\": [%.9g, %.9g, %.9g],\n",
+		options.region[0], options.region[1], options.region[2]);
+	std::printf("  \"broadphase\": \"%s\",\n", options.broadphase.c_str());
+	std::printf("  \"integrator\": \"%s\",\n", options.integrator.c_str());
+	std::printf("  \"method\": \"%s\",\n", options.method.c_str());
+	std::printf("  \"solver\": \"%s\",\n", options.solver.c_str());
+	std::printf("  \"threads\": %zu,\n", options.numThreads);
+	std::printf("  \"numa\": %zu,\n", options.numaNodes);
+	std::printf("  \"ccd\": %s,\n", options.continuousCollision ? "true" : "false");
+	std::printf("  \"precision\": \"%s\",\n", options.precision.c_str());
+	std::printf("  \"seed\": %u,\n", static_cast<unsigned>(options.seed));
+	std::printf("  \"ns_per_tick\": {\n");
+	std::printf("    \"total\": %.1f,\n", static_cast<double>(result.total) / numTicks);
+	std::printf("    \"detection\": %.1f,\n", static_cast<double>(result.detection) / numTicks);
+	std::printf("    \"broadphase\": %.1f,\n", static_cast<double>(result.broadphase) / numTicks);
+	std::printf("    \"sphere_plane\": %.1f,\n", static_cast<double>(result.spherePlane) / numTicks);
+	std::printf("    \"sphere_sphere\": %.1f,\n", static_cast<double>(result.sphereSphere) / numTicks);
+	std::printf("    \"response\": %.1f,\n", static_cast<double>(result.response) / numTicks);
+	std::printf("    \"integration\": %.1f,\n", static_cast<double>(result.integration) / numTicks);
+	std::printf("    \"continuous\": %.1f\n", static_cast<double>(result.continuous) / numTicks);
+	std::printf("  },\n");
+	if (options.precision == "compare")
+	{
+		// The distances between the centers of the float and the double
+		// spheres after the last tick.
+		double maxDrift = 0.0, sumSqrDrift = 0.0;
+		for (size_t i = 0; i < options.numSpheres; ++i)
+		{
+			double sqrDistance = 0.0;
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				double diff = result.centers[i][d] - reference.centers[i][d];
+				sqrDistance += diff * diff;
+			}
+			maxDrift = std::max(maxDrift, std::sqrt(sqrDistance));
+			sumSqrDrift += sqrDistance;
+		}
+		double const rmsDrift = std::sqrt(sumSqrDrift / static_cast<double>(options.numSpheres));
+
+		std::printf("  \"double_ns_per_tick\": {\n");
+		std::printf("    \"total\": %.1f,\n", static_cast<double>(reference.total) / numTicks);
+		std::printf("    \"detection\": %.1f,\n", static_cast<double>(reference.detection) / numTicks);
+		std::printf("    \"response\": %.1f,\n", static_cast<double>(reference.response) / numTicks);
+		std::printf("    \"integration\": %.1f\n", static_cast<double>(reference.integration) / numTicks);
+		std::printf("  },\n");
+		std::printf("  \"drift\": {\n");
+		std::printf("    \"max_position\": %.9g,\n", maxDrift);
+		std::printf("    \"rms_position\": %.9g\n", rmsDrift);
+		std::printf("  },\n");
+		std::printf("  \"double_contacts_per_tick\": %.3f,\n",
+			static_cast<double>(reference.numContacts) / numTicks);
+	}
+	std::printf("  \"pairs_tested_per_tick\": %.3f,\n", static_cast<double>(result.numPairsTested) / numTicks);
+	std::printf("  \"contacts_per_tick\": %.3f,\n", static_cast<double>(result.numContacts) / numTicks);
+	std::printf("  \"bodies_integrated_per_tick\": %.3f,\n",
+		static_cast<double>(result.numBodiesIntegrated) / numTicks);
+	std::printf("  \"max_contacts_per_tick\": %zu,\n", result.maxContacts);
+	std::printf("  \"peak_memory_bytes\": %llu\n",
+		static_cast<unsigned long long>(GetPeakMemory()));
+	std::printf("}\n");
+	return 0;
+}
@@ -0,0 +1,474 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/AnimationBatch.h>
+#include <Graphics/Spatial.h>
+#include <Mathematics/ChebyshevRatio.h>
+#include <Mathematics/Rotation.h>
+#include <Mathematics/SlerpEstimate.h>
+#include <algorithm>
+#include <thread>
+using namespace gte;
+
+namespace
+{
+    // The degree of the slerp estimates. The components of
+    // SLERP<float>::Estimate<16> are within 4e-7 of those of Slerp for
+    // all angles, whereas those of Estimate<8> are within 4e-5 only.
+    int32_t constexpr slerpDegree = 16;
+
+    // A thread is started only for this many controllers or more, because
+    // the evaluation of a controller is much cheaper than starting a thread.
+    size_t constexpr minPerThread = 256;
+}
+
+AnimationBatch::AnimationBatch(uint32_t numThreads)
+    :
+    mNumThreads(numThreads > 1 ? numThreads : 1)
+{
+}
+
+AnimationBatch::~AnimationBatch()
+{
+    Clear();
+}
+
+void AnimationBatch::Add(std::shared_ptr<KeyframeController> const& controller)
+{
+    LogAssert(controller != nullptr, "Invalid controller.");
+    AddKeyframe(controller, true);
+}
+
+void AnimationBatch::Add(std::shared_ptr<BlendTransformController> const& controller)
+{
+    LogAssert(controller != nullptr, "Invalid controller.");
+    if (std::find(mBlends.begin(), mBlends.end(), controller) != mBlends.end())
+    {
+        return;
+    }
+
+    std::shared_ptr<TransformController> const children[2] =
+    {
+        controller->mController0,
+        controller->mController1
+    };
+
+    for (size_t j = 0; j < 2; ++j)
+    {
+        auto keyframe = std::dynamic_pointer_cast<KeyframeController>(children[j]);
+        int32_t index = -1;
+        if (keyframe)
+        {
+            index = static_cast<int32_t>(AddKeyframe(keyframe, false));
+        }
+        mBlendChildren[j].push_back(index);
+    }
+
+    controller->mBatched = true;
+    mBlends.push_back(controller);
+}
+
+void AnimationBatch::Clear()
+{
+    for (auto const& controller : mKeyframes)
+    {
+        controller->mBatched = false;
+    }
+    for (auto const& controller : mBlends)
+    {
+        controller->mBatched = false;
+    }
+
+    mKeyframes.clear();
+    mWritesObject.clear();
+    mBlends.clear();
+    for (size_t j = 0; j < 2; ++j)
+    {
+        mBlendChildren[j].clear();
+    }
+    mChannels.clear();
+    mTranslations.clear();
+    mScales.clear();
+    mRotationTimes.clear();
+    mSigns.clear();
+    mOneMinusCos.clear();
+    mF0.clear();
+    mF1.clear();
+    for (size_t j = 0; j < 4; ++j)
+    {
+        mQ0[j].clear();
+        mQ1[j].clear();
+        mQ[j].clear();
+    }
+}
+
+void AnimationBatch::Update(double applicationTime)
+{
+    ForEachChunk(mKeyframes.size(),
+        [this, applicationTime](size_t imin, size_t imax)
+        {
+            LookupKeys(imin, imax, applicationTime);
+            EstimateSlerps(imin, imax);
+            AssembleKeyframes(imin, imax);
+        });
+
+    // The blends read the quaternions of keyframe controllers that might be
+    // in the chunk of another thread, so they start after all keyframe
+    // controllers are evaluated.
+    ForEachChunk(mBlends.size(),
+        [this, applicationTime](size_t imin, size_t imax)
+        {
+            UpdateBlends(imin, imax, applicationTime);
+        });
+}
+
+size_t AnimationBatch::AddKeyframe(std::shared_ptr<KeyframeController> const& controller,
+    bool writesObject)
+{
+    auto iter = std::find(mKeyframes.begin(), mKeyframes.end(), controller);
+    if (iter != mKeyframes.end())
+    {
+        // A child of a blend controller does not write the object, even
+        // when it was also added by itself.
+        size_t const index = static_cast<size_t>(iter - mKeyframes.begin());
+        mWritesObject[index] = static_cast<uint8_t>(mWritesObject[index] && writesObject);
+        return index;
+    }
+
+    controller->mBatched = true;
+    mKeyframes.push_back(controller);
+    mWritesObject.push_back(static_cast<uint8_t>(writesObject));
+
+    // The inactive controllers and those without a rotation channel keep
+    // the identity quaternions and a zero time, so EstimateSlerps can
+    // process all controllers without testing.
+    mChannels.push_back(0);
+    mTranslations.push_back(Vector4<float>::Zero());
+    mScales.push_back(1.0f);
+    mRotationTimes.push_back(0.0f);
+    mSigns.push_back(1.0f);
+    mOneMinusCos.push_back(0.0f);
+    mF0.push_back(1.0f);
+    mF1.push_back(0.0f);
+    for (size_t j = 0; j < 4; ++j)
+    {
+        float const identity = (j == 3 ? 1.0f : 0.0f);
+        mQ0[j].push_back(identity);
+        mQ1[j].push_back(identity);
+        mQ[j].push_back(identity);
+    }
+    return mKeyframes.size() - 1;
+}
+
+void AnimationBatch::LookupKeys(size_t imin, size_t imax, double applicationTime)
+{
+    for (size_t i = imin; i < imax; ++i)
+    {
+        KeyframeController& controller = *mKeyframes[i];
+        mRotationTimes[i] = 0.0f;
+        mChannels[i] = 0;
+        if (!controller.Controller::Update(applicationTime))
+        {
+            continue;
+        }
+
+        float ctrlTime = static_cast<float>(controller.GetControlTime(applicationTime));
+        float normTime = 0.0f;
+        int32_t i0 = 0, i1 = 0;
+        uint8_t channels = UPDATED;
+
+        // The logic is that of KeyframeController::Update, with the rotation
+        // keys copied for EstimateSlerps.
+        bool const common = (controller.mNumCommonTimes > 0);
+        if (common)
+        {
+            KeyframeController::GetKeyInfo(ctrlTime, controller.mNumCommonTimes,
+                controller.mCommonTimes.data(), controller.mCLastIndex, normTime, i0, i1);
+        }
+
+        if (controller.mNumTranslations > 0)
+        {
+            if (!common)
+            {
+                KeyframeController::GetKeyInfo(ctrlTime, controller.mNumTranslations,
+                    controller.mTranslationTimes.data(), controller.mTLastIndex,
+                    normTime, i0, i1);
+            }
+            mTranslations[i] = controller.GetTranslate(normTime, i0, i1);
+            channels |= TRANSLATION;
+        }
+
+        if (controller.mNumRotations > 0)
+        {
+            if (!common)
+            {
+                KeyframeController::GetKeyInfo(ctrlTime, controller.mNumRotations,
+                    controller.mRotationTimes.data(), controller.mRLastIndex,
+                    normTime, i0, i1);
+            }
+            Quaternion<float> const& q0 = controller.mRotations[i0];
+            Quaternion<float> const& q1 = controller.mRotations[i1];
+            mRotationTimes[i] = normTime;
+            for (size_t j = 0; j < 4; ++j)
+            {
+                mQ0[j][i] = q0[j];
+                mQ1[j][i] = q1[j];
+            }
+            channels |= ROTATION;
+        }
+
+        if (controller.mNumScales > 0)
+        {
+            if (!common)
+            {
+                KeyframeController::GetKeyInfo(ctrlTime, controller.mNumScales,
+                    controller.mScaleTimes.data(), controller.mSLastIndex,
+                    normTime, i0, i1);
+            }
+            mScales[i] = controller.GetScale(normTime, i0, i1);
+            channels |= SCALE;
+        }
+
+        mChannels[i] = channels;
+    }
+}
+
+void AnimationBatch::EstimateSlerps(size_t imin, size_t imax)
+{
+    // SLERP<float>::Estimate<slerpDegree> on the structure-of-arrays
+    // storage. The loops have no branches and each reads only a few arrays,
+    // so the compiler evaluates several controllers per instruction. The
+    // operations are those of Estimate, in the same order.
+    float* sign = mSigns.data();
+    float* oneMinusCos = mOneMinusCos.data();
+    float* f0 = mF0.data();
+    float* f1 = mF1.data();
+
+    // cos(A) = Dot(q0,q1), accumulated in oneMinusCos.
+    float const* c0 = mQ0[0].data();
+    float const* c1 = mQ1[0].data();
+    for (size_t i = imin; i < imax; ++i)
+    {
+        oneMinusCos[i] = c0[i] * c1[i];
+    }
+    for (size_t j = 1; j < 4; ++j)
+    {
+        c0 = mQ0[j].data();
+        c1 = mQ1[j].data();
+        for (size_t i = imin; i < imax; ++i)
+        {
+            oneMinusCos[i] += c0[i] * c1[i];
+        }
+    }
+
+    for (size_t i = imin; i < imax; ++i)
+    {
+        float const cs = oneMinusCos[i];
+        sign[i] = (cs >= 0.0f ? 1.0f : -1.0f);
+        oneMinusCos[i] = 1.0f - sign[i] * cs;
+    }
+
+    ChebyshevRatio<float>::GetEstimates<slerpDegree>(imax - imin,
+        mRotationTimes.data() + imin, oneMinusCos + imin, f0 + imin, f1 + imin);
+
+    for (size_t i = imin; i < imax; ++i)
+    {
+        f1[i] *= sign[i];
+    }
+
+    for (size_t j = 0; j < 4; ++j)
+    {
+        c0 = mQ0[j].data();
+        c1 = mQ1[j].data();
+        float* c = mQ[j].data();
+        for (size_t i = imin; i < imax; ++i)
+        {
+            c[i] = c0[i] * f0[i] + c1[i] * f1[i];
+        }
+    }
+}
+
+void AnimationBatch::AssembleKeyframes(size_t imin, size_t imax)
+{
+    for (size_t i = imin; i < imax; ++i)
+    {
+        uint8_t const channels = mChannels[i];
+        if ((channels & (TRANSLATION | ROTATION | SCALE)) == 0)
+        {
+            continue;
+        }
+
+        KeyframeController& controller = *mKeyframes[i];
+        Transform<float>& local = controller.mLocalTransform;
+
+        // The channels without keys keep their values.
+        bool const wasRSMatrix = local.IsRSMatrix();
+        Vector4<float> const translate = ((channels & TRANSLATION) ?
+            mTranslations[i] : local.GetTranslationW1());
+
+        Matrix4x4<float> matrix;
+        if (channels & ROTATION)
+        {
+            Quaternion<float> const q(mQ[0][i], mQ[1][i], mQ[2][i], mQ[3][i]);
+            matrix = Rotation<4, float>(q);
+        }
+        else
+        {
+            matrix = local.GetMatrix();
+        }
+
+        Vector4<float> scale;
+        bool isUniformScale;
+        if (channels & SCALE)
+        {
+            float const s = mScales[i];
+            scale = { s, s, s, 1.0f };
+            isUniformScale = true;
+        }
+        else
+        {
+            scale = (wasRSMatrix ? local.GetScaleW1() : Vector4<float>::Unit(3));
+            isUniformScale = local.IsUniformScale();
+        }
+
+        bool const isRSMatrix = (wasRSMatrix || (channels & ROTATION) != 0);
+        local.SetComponents(matrix, translate, scale, isRSMatrix, isUniformScale);
+
+        if (mWritesObject[i])
+        {
+            static_cast<Spatial*>(controller.mObject)->localTransform = local;
+        }
+    }
+}
+
+void AnimationBatch::UpdateBlends(size_t imin, size_t imax, double applicationTime)
+{
+    for (size_t b = imin; b < imax; ++b)
+    {
+        BlendTransformController& controller = *mBlends[b];
+        if (!controller.Controller::Update(applicationTime))
+        {
+            continue;
+        }
+
+        // The logic is that of BlendTransformController::Update. The
+        // children that are not in the batch are updated here. The rotation
+        // of a child in the batch is its quaternion from EstimateSlerps.
+        std::shared_ptr<TransformController> const children[2] =
+        {
+            controller.mController0,
+            controller.mController1
+        };
+
+        Quaternion<float> quat[2];
+        for (size_t j = 0; j < 2; ++j)
+        {
+            int32_t const k = mBlendChildren[j][b];
+            if (k < 0)
+            {
+                children[j]->Update(applicationTime);
+            }
+            else if ((mChannels[k] & (UPDATED | ROTATION)) == (UPDATED | ROTATION))
+            {
+                quat[j] = Quaternion<float>(mQ[0][k], mQ[1][k], mQ[2][k], mQ[3][k]);
+                continue;
+            }
+            quat[j] = Rotation<4, float>(children[j]->GetTransform().GetRotation());
+        }
+
+        Transform<float> const& xfrm0 = children[0]->GetTransform();
+        Transform<float> const& xfrm1 = children[1]->GetTransform();
+        float const weight = controller.mWeight;
+        float const oneMinusWeight = 1.0f - weight;
+
+        Vector4<float> trn0 = xfrm0.GetTranslationW1();
+        Vector4<float> trn1 = xfrm1.GetTranslationW1();
+        Vector4<float> blendTrn = oneMinusWeight * trn0 + weight * trn1;
+
+        if (Dot(quat[0], quat[1]) < 0.0f)
+        {
+            quat[1] = -quat[1];
+        }
+
+        Quaternion<float> blendQuat;
+        if (controller.mGeometricRotation)
+        {
+            blendQuat = SLERP<float>::Estimate<slerpDegree>(weight, quat[0], quat[1]);
+        }
+        else
+        {
+            blendQuat = oneMinusWeight * quat[0] + weight * quat[1];
+            Normalize(blendQuat);
+        }
+        Matrix4x4<float> blendRot = Rotation<4, float>(blendQuat);
+
+        Vector3<float> sca0 = xfrm0.GetScale();
+        Vector3<float> sca1 = xfrm1.GetScale();
+        Vector3<float> blendSca;
+        if (controller.mGeometricScale)
+        {
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                float s0 = sca0[i], s1 = sca1[i];
+                if (s0 != 0.0f && s1 != 0.0f)
+                {
+                    float sign0 = (s0 > 0.0f ? 1.0f : -1.0f);
+                    float sign1 = (s1 > 0.0f ? 1.0f : -1.0f);
+                    s0 = std::fabs(s0);
+                    s1 = std::fabs(s1);
+                    float pow0 = std::pow(s0, oneMinusWeight);
+                    float pow1 = std::pow(s1, weight);
+                    blendSca[i] = sign0 * sign1 * pow0 * pow1;
+                }
+                else
+                {
+                    blendSca[i] = 0.0f;
+                }
+            }
+        }
+        else
+        {
+            blendSca = oneMinusWeight * sca0 + weight * sca1;
+        }
+
+        controller.mLocalTransform.SetComponents(blendRot, blendTrn,
+            HLift(blendSca, 1.0f), true, false);
+        static_cast<Spatial*>(controller.mObject)->localTransform = controller.mLocalTransform;
+    }
+}
+
+template <typename Function>
+void AnimationBatch::ForEachChunk(size_t numElements, Function const& function)
+{
+    size_t const numThreads = std::min(static_cast<size_t>(mNumThreads),
+        std::max(numElements / minPerThread, static_cast<size_t>(1)));
+
+    if (numThreads > 1)
+    {
+        size_t const numPerThread = numElements / numThreads;
+        std::vector<std::thread> process(numThreads - 1);
+        for (size_t t = 0; t + 1 < numThreads; ++t)
+        {
+            size_t const imin = t * numPerThread;
+            size_t const imax = imin + numPerThread;
+            process[t] = std::thread([&function, imin, imax]() { function(imin, imax); });
+        }
+
+        // The calling thread processes the last chunk.
+        function((numThreads - 1) * numPerThread, numElements);
+
+        for (auto& thread : process)
+        {
+            thread.join();
+        }
+    }
+    else if (numElements > 0)
+    {
+        function(0, numElements);
+    }
+}
@@ -0,0 +1,121 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/BlendTransformController.h>
+#include <Graphics/KeyframeController.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Batched evaluation of KeyframeController and BlendTransformController
+// objects for scenes with many animated nodes. Update produces the local
+// transforms that the Update functions of the controllers produce, except
+// that rotations are interpolated with SLERP<float>::Estimate<16> (see
+// SlerpEstimate.h) instead of Slerp. The work is organized in passes over
+// all controllers instead of one virtual call per controller:
+//   1. the key lookup, which gathers the quaternion pairs and the
+//      interpolation times into structure-of-arrays storage,
+//   2. the slerp estimates, branch-free loops over those arrays that the
+//      compiler vectorizes (see ChebyshevRatio::GetEstimates),
+//   3. the assembly of the local transforms, each with one update of the
+//      homogeneous matrix instead of one per channel.
+// The controllers are split into at most numThreads contiguous chunks that
+// are processed in parallel. The blend controllers are evaluated after all
+// keyframe controllers.
+//
+// The controllers stay attached to their objects. Add marks a controller
+// as batched, and its Update function then only records the application
+// time, so the scene graph update still recomputes the world transforms.
+// Call AnimationBatch::Update before the scene graph update, with the same
+// application time. The destructor and Clear unmark the controllers.
+//
+// The KeyframeController children of a blend controller are evaluated by
+// the batch and do not write the local transform of the object, which the
+// blend overwrites anyway. Other children are updated by calling their
+// Update functions. The objects of the batched controllers must be
+// distinct, counting a blend and its children once, because the chunks
+// write the local transforms in parallel.
+
+namespace gte
+{
+    class AnimationBatch
+    {
+    public:
+        // Construction and destruction.
+        AnimationBatch(uint32_t numThreads = 1);
+        ~AnimationBatch();
+
+        void Add(std::shared_ptr<KeyframeController> const& controller);
+        void Add(std::shared_ptr<BlendTransformController> const& controller);
+        void Clear();
+
+        inline size_t GetNumKeyframeControllers() const
+        {
+            return mKeyframes.size();
+        }
+
+        inline size_t GetNumBlendControllers() const
+        {
+            return mBlends.size();
+        }
+
+        // The animation update. The application time is in milliseconds.
+        void Update(double applicationTime);
+
+    private:
+        enum : uint8_t
+        {
+            TRANSLATION = 0x01,
+            ROTATION = 0x02,
+            SCALE = 0x04,
+
+            // The controller was active in the current update.
+            UPDATED = 0x08
+        };
+
+        // Returns the index of the controller in mKeyframes, adding it when
+        // it is not in the batch.
+        size_t AddKeyframe(std::shared_ptr<KeyframeController> const& controller,
+            bool writesObject);
+
+        // The passes for the controllers with indices in [imin,imax).
+        void LookupKeys(size_t imin, size_t imax, double applicationTime);
+        void EstimateSlerps(size_t imin, size_t imax);
+        void AssembleKeyframes(size_t imin, size_t imax);
+        void UpdateBlends(size_t imin, size_t imax, double applicationTime);
+
+        // Call function(imin, imax) for contiguous chunks of [0,numElements),
+        // one chunk per thread.
+        template <typename Function>
+        void ForEachChunk(size_t numElements, Function const& function);
+
+        uint32_t mNumThreads;
+
+        std::vector<std::shared_ptr<KeyframeController>> mKeyframes;
+        std::vector<uint8_t> mWritesObject;
+        std::vector<std::shared_ptr<BlendTransformController>> mBlends;
+
+        // The indices in mKeyframes of the children of the blend
+        // controllers, or -1 when a child is not a KeyframeController.
+        std::array<std::vector<int32_t>, 2> mBlendChildren;
+
+        // The per-update state of the keyframe controllers in
+        // structure-of-arrays form. mQ0[j][i] is component j of the first
+        // quaternion of controller i.
+        std::vector<uint8_t> mChannels;
+        std::vector<Vector4<float>> mTranslations;
+        std::vector<float> mScales;
+        std::vector<float> mRotationTimes;
+        std::array<std::vector<float>, 4> mQ0, mQ1, mQ;
+
+        // The intermediate values of EstimateSlerps.
+        std::vector<float> mSigns, mOneMinusCos, mF0, mF1;
+    };
+}
@@ -32,6 +32,11 @@ bool BlendTransformController::Update(double applicationTime)
         return false;
     }
 
+    if (mBatched)
+    {
+        return true;
+    }
+
     mController0->Update(applicationTime);
     mController1->Update(applicationTime);
 
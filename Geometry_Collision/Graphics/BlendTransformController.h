@@ -64,6 +64,8 @@ namespace gte
         virtual bool Update(double applicationTime) override;
 
     protected:
+        friend class AnimationBatch;
+
         // Set the object for 'this' and for the managed controllers.
         virtual void SetObject(ControlledObject* object) override;
 
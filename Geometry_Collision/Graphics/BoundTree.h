@@ -11,8 +11,14 @@
 #include <Mathematics/ApprOrthogonalLine3.h>
 #include <Mathematics/Matrix4x4.h>
 #include <Mathematics/Triangle.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <numeric>
+#include <thread>
+#include <vector>
 
 // Class Mesh must have the following functions in its interface.
 //    size_t GetNumVertices() const;
@@ -36,6 +42,22 @@
 //        Vector3<float> const& velocity0,
 //        Vector3<float> const& velocity1) const;
 // A wrapper of this type for bounding spheres is Graphics/BoundingSphere.h.
+//
+// The tree is stored as an array of nodes in depth-first order. The root is
+// node 0, the left child of interior node i is node i+1 and the right child
+// is stored in the node, so a traversal follows indices rather than
+// pointers. The triangles of the leaves are stored in one array in the same
+// order, so the triangles of any subtree are contiguous.
+//
+// Two builders are available. MEDIAN_SPLIT fits a line to the vertices of
+// each submesh and splits the triangles at the median of the projections
+// of their centroids onto the line, which leads to a balanced tree.
+// BINNED_SAH projects the centroids onto the axis of largest centroid
+// extent, places them in bins and splits at the bin boundary of least
+// surface-area-heuristic cost, which leads to tighter bounds for meshes
+// with triangles of nonuniform size. Both builders split until a node has
+// at most maxTrisPerLeaf triangles. The subtrees of large nodes are built
+// on separate threads when numThreads > 0.
 
 namespace gte
 {
@@ -43,68 +65,117 @@ namespace gte
     class BoundTree
     {
     public:
+        enum class BuildMethod
+        {
+            MEDIAN_SPLIT,
+            BINNED_SAH
+        };
+
+        // A node is 32 bytes when Bound is at most 20 bytes (for example
+        // BoundingSphere<float>) and 64 bytes otherwise. For a leaf,
+        // rightChild is 0 and the triangles are
+        // GetTriangle(firstTriangle) through
+        // GetTriangle(firstTriangle + numTriangles - 1). For an interior
+        // node these are the triangles of its subtree.
+        struct alignas(32) Node
+        {
+            Bound modelBound;
+            uint32_t rightChild;
+            uint32_t firstTriangle;
+            uint32_t numTriangles;
+        };
+
         // Construction and destruction.
         BoundTree(std::shared_ptr<Mesh> const& mesh, int32_t maxTrisPerLeaf = 1,
-            bool storeInteriorTris = false)
+            bool storeInteriorTris = false,
+            BuildMethod method = BuildMethod::MEDIAN_SPLIT,
+            size_t numThreads = 0)
             :
             mMesh(mesh),
-            mModelBound{},
-            mWorldBound{},
-            mLChild{},
-            mRChild{},
-            mTriangles{}
+            mNodes{},
+            mWorldBounds{},
+            mTriangles{},
+            mStoreInteriorTris(storeInteriorTris),
+            mMaxTrisPerLeaf(0),
+            mMethod(method),
+            mNumThreads(numThreads),
+            mRebuildThreshold(0.0f),
+            mBaselineRatio(0.0f)
         {
-            if (maxTrisPerLeaf == 0)
-            {
-                // This is a signal to defer construction, a behavior needed
-                // in the BuildTree function.
-                return;
-            }
+            LogAssert(
+                mMesh != nullptr && maxTrisPerLeaf > 0,
+                "Invalid input.");
 
-            // Centroids of triangles are used for splitting a mesh. The
-            // centroids are projected onto a splitting axis and sorted. The
-            // split is based on the median of the projections, which leads
-            // to a balanced tree.
             size_t const numTriangles = mMesh->GetNumTriangles();
-            std::vector<Vector3<float>> centroids(numTriangles);
-            for (size_t t = 0; t < numTriangles; ++t)
-            {
-                Triangle3<float> triangle{};
-                mMesh->GetModelTriangle(t, triangle);
-                centroids[t] = (triangle.v[0] + triangle.v[1] + triangle.v[2]) / 3.0f;
-            }
+            LogAssert(
+                numTriangles > 0 &&
+                numTriangles <= static_cast<size_t>(std::numeric_limits<int32_t>::max()),
+                "Invalid number of triangles.");
 
-            // Initialize binary-tree arrays for storing triangle indices.
-            // These are used to store the indices when the mesh is split.
-            std::vector<int32_t> inSplit(numTriangles);
-            std::vector<int32_t> outSplit(numTriangles);
-            std::iota(inSplit.begin(), inSplit.end(), 0);
+            mMaxTrisPerLeaf = static_cast<size_t>(maxTrisPerLeaf);
+            Rebuild();
+        }
 
-            BuildTree(maxTrisPerLeaf, storeInteriorTris, centroids, 0,
-                numTriangles - 1, inSplit, outSplit);
+        // Construction from the nodes and triangles of a tree that was
+        // built earlier for the same mesh, for example a tree loaded from a
+        // cache. The array 'triangles' has mesh->GetNumTriangles() elements.
+        // The remaining parameters are those used by Rebuild.
+        BoundTree(std::shared_ptr<Mesh> const& mesh, Node const* nodes,
+            size_t numNodes, int32_t const* triangles, int32_t maxTrisPerLeaf,
+            bool storeInteriorTris, BuildMethod method, size_t numThreads = 0)
+            :
+            mMesh(mesh),
+            mNodes(nodes, nodes + numNodes),
+            mWorldBounds(numNodes),
+            mTriangles{},
+            mStoreInteriorTris(storeInteriorTris),
+            mMaxTrisPerLeaf(0),
+            mMethod(method),
+            mNumThreads(numThreads),
+            mRebuildThreshold(0.0f),
+            mBaselineRatio(0.0f)
+        {
+            LogAssert(
+                mMesh != nullptr && maxTrisPerLeaf > 0 &&
+                nodes != nullptr && numNodes > 0 && triangles != nullptr,
+                "Invalid input.");
+
+            size_t const numTriangles = mMesh->GetNumTriangles();
+            mTriangles.assign(triangles, triangles + numTriangles);
+            mMaxTrisPerLeaf = static_cast<size_t>(maxTrisPerLeaf);
         }
 
         ~BoundTree() = default;
 
-        // Tree topology.
-        inline std::shared_ptr<BoundTree> const& GetLChild() const
+        // Tree topology. The root is node 0.
+        inline size_t GetNumNodes() const
         {
-            return mLChild;
+            return mNodes.size();
         }
 
-        inline std::shared_ptr<BoundTree> const& GetRChild() const
+        inline Node const& GetNode(size_t i) const
         {
-            return mRChild;
+            return mNodes[i];
         }
 
-        inline bool IsInteriorNode() const
+        inline bool IsInteriorNode(size_t i = 0) const
         {
-            return mLChild || mRChild;
+            return mNodes[i].rightChild != 0;
         }
 
-        inline bool IsLeafNode() const
+        inline bool IsLeafNode(size_t i = 0) const
         {
-            return !mLChild && !mRChild;
+            return mNodes[i].rightChild == 0;
+        }
+
+        inline size_t GetLChild(size_t i) const
+        {
+            return i + 1;
+        }
+
+        inline size_t GetRChild(size_t i) const
+        {
+            return static_cast<size_t>(mNodes[i].rightChild);
         }
 
         // Member access.
@@ -113,135 +184,433 @@ namespace gte
             return mMesh;
         }
 
-        inline const Bound& GetWorldBound() const
+        inline Bound const& GetModelBound(size_t i = 0) const
         {
-            return mWorldBound;
+            return mNodes[i].modelBound;
         }
 
-        inline int32_t GetNumTriangles() const
+        inline Bound const& GetWorldBound(size_t i = 0) const
         {
-            return static_cast<int32_t>(mTriangles.size());
+            return mWorldBounds[i];
         }
 
-        inline int32_t GetTriangle(int32_t i) const
+        // The triangle indices of the leaves in depth-first order and the
+        // build parameters, for saving the tree.
+        inline std::vector<int32_t> const& GetTriangles() const
         {
-            return mTriangles[static_cast<size_t>(i)];
+            return mTriangles;
         }
 
-        inline std::vector<int32_t> const& GetTriangles() const
+        inline int32_t GetMaxTrisPerLeaf() const
         {
-            return mTriangles;
+            return static_cast<int32_t>(mMaxTrisPerLeaf);
+        }
+
+        inline bool GetStoreInteriorTris() const
+        {
+            return mStoreInteriorTris;
+        }
+
+        inline BuildMethod GetBuildMethod() const
+        {
+            return mMethod;
+        }
+
+        // The interior nodes have no triangles when storeInteriorTris was
+        // set to 'false' in the constructor.
+        inline int32_t GetNumTriangles(size_t i = 0) const
+        {
+            Node const& node = mNodes[i];
+            return (node.rightChild == 0 || mStoreInteriorTris ?
+                static_cast<int32_t>(node.numTriangles) : 0);
+        }
+
+        // The index into GetTriangles() of the first triangle of node i.
+        // The triangles of a node are contiguous in that array.
+        inline size_t GetFirstTriangle(size_t i = 0) const
+        {
+            return static_cast<size_t>(mNodes[i].firstTriangle);
+        }
+
+        // The triangle indices are relative to the input mesh. The input
+        // j must satisfy 0 <= j < GetNumTriangles(i).
+        inline int32_t GetTriangle(size_t i, int32_t j) const
+        {
+            return mTriangles[static_cast<size_t>(mNodes[i].firstTriangle) + static_cast<size_t>(j)];
         }
 
         // The Mesh world transform is assumed to change dynamically.
-        void UpdateWorldBound()
+        void UpdateWorldBound(size_t i = 0)
+        {
+            mNodes[i].modelBound.TransformBy(mMesh->GetWorldTransform(), mWorldBounds[i]);
+        }
+
+        // Support for meshes whose vertices are modified in place, for
+        // example by a SkinController or MorphController that writes to the
+        // vertex buffer of the Visual wrapped by CollisionMesh. The
+        // triangles must not change.
+        //
+        // Build the tree again from the current vertices, using the
+        // parameters passed to the constructor.
+        void Rebuild()
+        {
+            size_t const numTriangles = mMesh->GetNumTriangles();
+            // Centroids of triangles are used for splitting a mesh. The SAH
+            // builder also uses the axis-aligned bounding boxes of the
+            // triangles.
+            BuildData data{};
+            data.maxTrisPerLeaf = mMaxTrisPerLeaf;
+            data.method = mMethod;
+            data.centroids.resize(numTriangles);
+            if (mMethod == BuildMethod::BINNED_SAH)
+            {
+                data.boxMin.resize(numTriangles);
+                data.boxMax.resize(numTriangles);
+            }
+            for (size_t t = 0; t < numTriangles; ++t)
+            {
+                Triangle3<float> triangle{};
+                mMesh->GetModelTriangle(t, triangle);
+                data.centroids[t] = (triangle.v[0] + triangle.v[1] + triangle.v[2]) / 3.0f;
+                if (mMethod == BuildMethod::BINNED_SAH)
+                {
+                    for (int32_t j = 0; j < 3; ++j)
+                    {
+                        data.boxMin[t][j] = std::min(std::min(triangle.v[0][j], triangle.v[1][j]), triangle.v[2][j]);
+                        data.boxMax[t][j] = std::max(std::max(triangle.v[0][j], triangle.v[1][j]), triangle.v[2][j]);
+                    }
+                }
+            }
+
+            // Initialize the arrays for storing triangle indices. The
+            // median builder alternates between the two arrays; the SAH
+            // builder partitions the triangles in place. The node for the
+            // triangles in [i0,i1] of either array writes its leaves to
+            // the same range of mTriangles.
+            data.inSplit.resize(numTriangles);
+            data.outSplit.resize(numTriangles);
+            std::iota(data.inSplit.begin(), data.inSplit.end(), 0);
+            mTriangles.resize(numTriangles);
+
+            // Each thread builds up to 2^taskDepth subtrees.
+            size_t taskDepth = 0;
+            while ((static_cast<size_t>(1) << taskDepth) < mNumThreads + 1)
+            {
+                ++taskDepth;
+            }
+
+            Workspace workspace(mMesh->GetNumVertices());
+            mNodes.clear();
+            BuildTree(data, workspace, 0, numTriangles - 1,
+                data.inSplit.data(), data.outSplit.data(), mNodes, taskDepth);
+            mWorldBounds.resize(mNodes.size());
+            mBaselineRatio = 0.0f;
+        }
+
+        // Update the model bounds of the nodes from the current vertices
+        // without changing the topology. The bounds of the leaves are
+        // computed from their vertices and the bound of an interior node
+        // is the union of the bounds of its children, so the cost is
+        // linear in the number of triangles. The subtrees are refitted in
+        // parallel when numThreads > 0. This function additionally requires
+        // Bound to have
+        //    void GrowToContain(Bound const& bound);
+        //
+        // The bounds of a refitted tree are looser than those of a built
+        // tree, and they become looser as the deformation moves triangles
+        // of a subtree apart. When a rebuild threshold is set, the function
+        // compares ComputeRadiusRatio() to its value after the first refit
+        // following a build, and it calls Rebuild() when the ratio has
+        // grown by more than the threshold factor. The return value is
+        // 'true' when the tree was rebuilt.
+        bool Refit(size_t numThreads = 0)
         {
-            mModelBound.TransformBy(mMesh->GetWorldTransform(), mWorldBound);
+            size_t taskDepth = 0;
+            while ((static_cast<size_t>(1) << taskDepth) < numThreads + 1)
+            {
+                ++taskDepth;
+            }
+
+            Workspace workspace(mMesh->GetNumVertices());
+            RefitTree(workspace, 0, taskDepth);
+
+            if (mRebuildThreshold > 0.0f)
+            {
+                float ratio = ComputeRadiusRatio();
+                if (mBaselineRatio == 0.0f)
+                {
+                    mBaselineRatio = ratio;
+                }
+                else if (ratio > mRebuildThreshold * mBaselineRatio)
+                {
+                    Rebuild();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // A threshold of 0 (the default) disables the rebuilds by Refit.
+        // Otherwise the threshold must be larger than 1; for example, 1.5
+        // rebuilds the tree when the quality measure has grown by 50%.
+        void SetRebuildThreshold(float threshold)
+        {
+            LogAssert(
+                threshold == 0.0f || threshold > 1.0f,
+                "Invalid threshold.");
+
+            mRebuildThreshold = threshold;
+        }
+
+        inline float GetRebuildThreshold() const
+        {
+            return mRebuildThreshold;
+        }
+
+        // The quality measure used by Refit. It is the sum of the squared
+        // radii of the interior model bounds divided by the squared radius
+        // of the root bound, which is proportional to the expected number
+        // of interior nodes visited by a query (the surface-area heuristic)
+        // and does not change when the mesh is scaled uniformly. This
+        // function additionally requires Bound to have
+        //    float GetRadius() const;
+        float ComputeRadiusRatio() const
+        {
+            float rootRadius = mNodes[0].modelBound.GetRadius();
+            if (rootRadius == 0.0f)
+            {
+                return 0.0f;
+            }
+
+            float sum = 0.0f;
+            for (auto const& node : mNodes)
+            {
+                if (node.rightChild != 0)
+                {
+                    float radius = node.modelBound.GetRadius();
+                    sum += radius * radius;
+                }
+            }
+            return sum / (rootRadius * rootRadius);
         }
 
     private:
-        void BuildTree(size_t maxTrisPerLeaf, bool storeInteriorTris,
-            std::vector<Vector3<float>> const& centroids, size_t i0,
-            size_t i1, std::vector<int32_t>& inSplit,
-            std::vector<int32_t>& outSplit)
+        // Subtrees with fewer triangles are built on the calling thread.
+        static size_t constexpr minTrianglesPerTask = 4096;
+
+        // The number of bins of the SAH builder.
+        static size_t constexpr numBins = 16;
+
+        struct BuildData
+        {
+            size_t maxTrisPerLeaf;
+            BuildMethod method;
+            std::vector<Vector3<float>> centroids;
+            std::vector<Vector3<float>> boxMin, boxMax;
+            std::vector<int32_t> inSplit, outSplit;
+        };
+
+        // Per-thread storage for gathering the vertices of a submesh.
+        // stamp[v] is the tag of the last submesh that used vertex v, so
+        // the vertices are collected in time proportional to the number of
+        // triangles rather than the number of mesh vertices.
+        struct Workspace
+        {
+            Workspace(size_t numVertices)
+                :
+                stamp(numVertices, 0),
+                tag(0),
+                indices{},
+                vertices{}
+            {
+            }
+
+            std::vector<uint32_t> stamp;
+            uint32_t tag;
+            std::vector<size_t> indices;
+            std::vector<Vector3<float>> vertices;
+        };
+
+        // Build the subtree for the triangles inSplit[i0] through
+        // inSplit[i1] and append its nodes to 'nodes' in depth-first
+        // order. The child indices are relative to the start of 'nodes'.
+        void BuildTree(BuildData& data, Workspace& workspace, size_t i0,
+            size_t i1, int32_t* inSplit, int32_t* outSplit,
+            std::vector<Node>& nodes, size_t taskDepth)
         {
             LogAssert(
                 i0 <= i1,
                 "Invalid index ordering.");
 
+            size_t const index = nodes.size();
+            nodes.emplace_back();
+            Node node{};
+            node.rightChild = 0;
+            node.firstTriangle = static_cast<uint32_t>(i0);
+            node.numTriangles = static_cast<uint32_t>(i1 - i0 + 1);
+
+            bool const fitLine = (data.method == BuildMethod::MEDIAN_SPLIT &&
+                i1 - i0 >= data.maxTrisPerLeaf);
             Vector3<float> origin{}, direction{};
-            CreateModelBound(i0, i1, inSplit, origin, direction);
+            CreateModelBound(workspace, i0, i1, inSplit, fitLine, node.modelBound,
+                origin, direction);
 
-            if (i1 - i0 < maxTrisPerLeaf)
+            if (i1 - i0 < data.maxTrisPerLeaf)
             {
                 // At a leaf node.
-                size_t numTriangles = i1 - i0 + 1;
-                mTriangles.resize(numTriangles);
-                for (size_t t0 = 0, t1 = i0; t0 < numTriangles; ++t0, ++t1)
-                {
-                    mTriangles[t0] = inSplit[t1];
-                }
+                std::copy(inSplit + i0, inSplit + i1 + 1, mTriangles.begin() + i0);
+                nodes[index] = node;
+                return;
+            }
 
-                mLChild.reset();
-                mRChild.reset();
+            // At an interior node. The left child is [i0,j0] and the right
+            // child is [j0+1,i1]. The median split writes the partition to
+            // outSplit, which becomes the input of the children.
+            size_t j0{};
+            int32_t* childIn = inSplit;
+            int32_t* childOut = outSplit;
+            if (data.method == BuildMethod::MEDIAN_SPLIT)
+            {
+                SplitTriangles(data.centroids, i0, i1, inSplit, j0, outSplit,
+                    origin, direction);
+                std::swap(childIn, childOut);
             }
             else
             {
-                // At an interior node.
-                if (storeInteriorTris)
+                SplitTrianglesSAH(data, i0, i1, inSplit, j0);
+            }
+
+            if (taskDepth > 0 && i1 - i0 + 1 >= minTrianglesPerTask)
+            {
+                // Build the right subtree on another thread into its own
+                // node array, then append it with its indices offset.
+                std::vector<Node> rightNodes{};
+                std::thread worker([this, &data, j0, i1, childIn, childOut,
+                    &rightNodes, taskDepth]()
+                {
+                    Workspace rightWorkspace(mMesh->GetNumVertices());
+                    BuildTree(data, rightWorkspace, j0 + 1, i1, childIn, childOut,
+                        rightNodes, taskDepth - 1);
+                });
+                BuildTree(data, workspace, i0, j0, childIn, childOut, nodes, taskDepth - 1);
+                worker.join();
+
+                uint32_t const offset = static_cast<uint32_t>(nodes.size());
+                node.rightChild = offset;
+                for (auto rightNode : rightNodes)
                 {
-                    size_t numTriangles = i1 - i0 + 1;
-                    mTriangles.resize(numTriangles);
-                    for (size_t t0 = 0, t1 = i0; t0 < numTriangles; ++t0, ++t1)
+                    if (rightNode.rightChild != 0)
                     {
-                        mTriangles[t0] = inSplit[t1];
+                        rightNode.rightChild += offset;
                     }
+                    nodes.push_back(rightNode);
                 }
-                else
-                {
-                    mTriangles.clear();
-                }
-
-                size_t j0{}, j1{};
-                SplitTriangles(centroids, i0, i1, inSplit, j0, j1, outSplit,
-                    origin, direction);
+            }
+            else
+            {
+                BuildTree(data, workspace, i0, j0, childIn, childOut, nodes, 0);
+                node.rightChild = static_cast<uint32_t>(nodes.size());
+                BuildTree(data, workspace, j0 + 1, i1, childIn, childOut, nodes, 0);
+            }
+            nodes[index] = node;
+        }
 
-                mLChild = std::make_shared<BoundTree<Mesh, Bound>>(mMesh, 0, false);
-                mLChild->BuildTree(maxTrisPerLeaf, storeInteriorTris,
-                    centroids, i0, j0, outSplit, inSplit);
+        // Refit the subtree rooted at node i.
+        void RefitTree(Workspace& workspace, size_t i, size_t taskDepth)
+        {
+            Node& node = mNodes[i];
+            if (node.rightChild == 0)
+            {
+                size_t i0 = static_cast<size_t>(node.firstTriangle);
+                size_t i1 = i0 + static_cast<size_t>(node.numTriangles) - 1;
+                Vector3<float> origin{}, direction{};
+                CreateModelBound(workspace, i0, i1, mTriangles.data(), false,
+                    node.modelBound, origin, direction);
+                return;
+            }
 
-                mRChild = std::make_shared<BoundTree<Mesh, Bound>>(mMesh, 0, false);
-                mRChild->BuildTree(maxTrisPerLeaf, storeInteriorTris,
-                    centroids, j1, i1, outSplit, inSplit);
+            size_t const lChild = i + 1;
+            size_t const rChild = static_cast<size_t>(node.rightChild);
+            if (taskDepth > 0 && node.numTriangles >= minTrianglesPerTask)
+            {
+                std::thread worker([this, rChild, taskDepth]()
+                {
+                    Workspace rightWorkspace(mMesh->GetNumVertices());
+                    RefitTree(rightWorkspace, rChild, taskDepth - 1);
+                });
+                RefitTree(workspace, lChild, taskDepth - 1);
+                worker.join();
             }
+            else
+            {
+                RefitTree(workspace, lChild, 0);
+                RefitTree(workspace, rChild, 0);
+            }
+
+            node.modelBound = mNodes[lChild].modelBound;
+            node.modelBound.GrowToContain(mNodes[rChild].modelBound);
         }
 
-        // Compute the model bound for the subset of triangles.  Return a
-        // line used for splitting the projections of the triangle centroids.
-        void CreateModelBound(size_t i0, size_t i1, std::vector<int32_t>& inSplit,
+        // Compute the model bound for the subset of triangles. When
+        // requested, compute a line used for splitting the projections of
+        // the triangle centroids.
+        void CreateModelBound(Workspace& workspace, size_t i0, size_t i1,
+            int32_t const* inSplit, bool fitLine, Bound& modelBound,
             Vector3<float>& origin, Vector3<float>& direction)
         {
-            // Tag vertices that are used in the submesh.
-            size_t const numVertices = mMesh->GetNumVertices();
-            std::vector<bool> valid(numVertices, false);
+            // Collect the vertices that are used in the submesh, in
+            // increasing order of index.
+            if (++workspace.tag == 0)
+            {
+                std::fill(workspace.stamp.begin(), workspace.stamp.end(), 0);
+                workspace.tag = 1;
+            }
+            workspace.indices.clear();
             for (size_t i = i0; i <= i1; ++i)
             {
                 std::array<int32_t, 3> vertex{};
-                mMesh->GetTriangle(inSplit[i], vertex);
+                mMesh->GetTriangle(static_cast<size_t>(inSplit[i]), vertex);
                 for (size_t j = 0; j < 3; ++j)
                 {
-                    valid[vertex[j]] = true;
+                    size_t v = static_cast<size_t>(vertex[j]);
+                    if (workspace.stamp[v] != workspace.tag)
+                    {
+                        workspace.stamp[v] = workspace.tag;
+                        workspace.indices.push_back(v);
+                    }
                 }
             }
+            std::sort(workspace.indices.begin(), workspace.indices.end());
 
             // Create a contiguous set of vertices in the submesh.
-            std::vector<Vector3<float>> meshVertices{};
-            for (size_t i = 0; i < numVertices; ++i)
+            auto& meshVertices = workspace.vertices;
+            meshVertices.resize(workspace.indices.size());
+            for (size_t i = 0; i < meshVertices.size(); ++i)
             {
-                if (valid[i])
-                {
-                    meshVertices.push_back(mMesh->GetPosition(i));
-                }
+                meshVertices[i] = mMesh->GetPosition(workspace.indices[i]);
             }
 
             // Compute the bound for the submesh.
             uint32_t numSubvertices = static_cast<uint32_t>(meshVertices.size());
             uint32_t stride = static_cast<uint32_t>(sizeof(Vector3<float>));
-            mModelBound.ComputeFromData(numSubvertices, stride,
+            modelBound.ComputeFromData(numSubvertices, stride,
                 reinterpret_cast<char const*>(meshVertices.data()));
 
-            // Compute a splitting line for the submesh.
-            ApprOrthogonalLine3<float> fitter{};
-            fitter.Fit(meshVertices);
-            auto const& line = fitter.GetParameters();
-            origin = line.origin;
-            direction = line.direction;
+            if (fitLine)
+            {
+                // Compute a splitting line for the submesh.
+                ApprOrthogonalLine3<float> fitter{};
+                fitter.Fit(meshVertices);
+                auto const& line = fitter.GetParameters();
+                origin = line.origin;
+                direction = line.direction;
+            }
         }
 
         static void SplitTriangles(std::vector<Vector3<float>> const& centroids,
-            size_t i0, size_t i1, std::vector<int32_t>& inSplit,
-            size_t& j0, size_t& j1, std::vector<int32_t>& outSplit,
-            Vector3<float>& origin, Vector3<float>& direction)
+            size_t i0, size_t i1, int32_t const* inSplit, size_t& j0,
+            int32_t* outSplit, Vector3<float> const& origin,
+            Vector3<float> const& direction)
         {
             // Project onto specified line.
             size_t const quantity = i1 - i0 + 1;
@@ -260,7 +629,7 @@ namespace gte
             std::nth_element(info.begin(), info.begin() + median, info.end());
 
             // Partition the triangles by the median.
-            size_t k = 0;
+            size_t k = 0, j1{};
             for (j0 = i0 - 1; k <= median; ++k)
             {
                 outSplit[++j0] = info[k].triangle;
@@ -269,7 +638,135 @@ namespace gte
             {
                 outSplit[--j1] = info[k].triangle;
             }
+        }
+
+        // Partition inSplit[i0] through inSplit[i1] in place so that the
+        // left child is [i0,j0] and the right child is [j0+1,i1]. The cost
+        // of a split is area(left)*count(left) + area(right)*count(right),
+        // where the area is half the surface area of the bounding box of
+        // the triangles.
+        static void SplitTrianglesSAH(BuildData const& data, size_t i0,
+            size_t i1, int32_t* inSplit, size_t& j0)
+        {
+            Vector3<float> cmin = data.centroids[static_cast<size_t>(inSplit[i0])];
+            Vector3<float> cmax = cmin;
+            for (size_t i = i0 + 1; i <= i1; ++i)
+            {
+                auto const& centroid = data.centroids[static_cast<size_t>(inSplit[i])];
+                for (int32_t j = 0; j < 3; ++j)
+                {
+                    cmin[j] = std::min(cmin[j], centroid[j]);
+                    cmax[j] = std::max(cmax[j], centroid[j]);
+                }
+            }
+
+            int32_t axis = 0;
+            for (int32_t j = 1; j < 3; ++j)
+            {
+                if (cmax[j] - cmin[j] > cmax[axis] - cmin[axis])
+                {
+                    axis = j;
+                }
+            }
+
+            float const extent = cmax[axis] - cmin[axis];
+            if (extent <= 0.0f)
+            {
+                // The centroids coincide; split the range in half.
+                j0 = i0 + (i1 - i0) / 2;
+                return;
+            }
+
+            // Bin the triangles by centroid.
+            struct Bin
+            {
+                Vector3<float> bmin, bmax;
+                size_t count;
+            };
+            std::array<Bin, numBins> bins{};
+            float const fmax = std::numeric_limits<float>::max();
+            for (auto& bin : bins)
+            {
+                bin.bmin = { fmax, fmax, fmax };
+                bin.bmax = { -fmax, -fmax, -fmax };
+                bin.count = 0;
+            }
+
+            float const scale = static_cast<float>(numBins) / extent;
+            auto getBin = [&data, &cmin, axis, scale](int32_t t)
+            {
+                float b = (data.centroids[static_cast<size_t>(t)][axis] - cmin[axis]) * scale;
+                return std::min(static_cast<size_t>(b), numBins - 1);
+            };
+
+            for (size_t i = i0; i <= i1; ++i)
+            {
+                size_t t = static_cast<size_t>(inSplit[i]);
+                Bin& bin = bins[getBin(inSplit[i])];
+                for (int32_t j = 0; j < 3; ++j)
+                {
+                    bin.bmin[j] = std::min(bin.bmin[j], data.boxMin[t][j]);
+                    bin.bmax[j] = std::max(bin.bmax[j], data.boxMax[t][j]);
+                }
+                ++bin.count;
+            }
 
+            // Sweep from the right to get the costs of the right sides,
+            // then from the left to find the best boundary b, where the
+            // left side is bins[0] through bins[b-1].
+            auto area = [](Vector3<float> const& bmin, Vector3<float> const& bmax)
+            {
+                Vector3<float> d = bmax - bmin;
+                return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+            };
+
+            std::array<float, numBins> rightCost{};
+            Vector3<float> bmin = bins[numBins - 1].bmin, bmax = bins[numBins - 1].bmax;
+            size_t count = 0;
+            for (size_t b = numBins - 1; b > 0; --b)
+            {
+                for (int32_t j = 0; j < 3; ++j)
+                {
+                    bmin[j] = std::min(bmin[j], bins[b].bmin[j]);
+                    bmax[j] = std::max(bmax[j], bins[b].bmax[j]);
+                }
+                count += bins[b].count;
+                rightCost[b] = (count > 0 ? area(bmin, bmax) * static_cast<float>(count) : 0.0f);
+            }
+
+            size_t bestBoundary = 0;
+            float bestCost = fmax;
+            bmin = bins[0].bmin;
+            bmax = bins[0].bmax;
+            count = 0;
+            size_t const quantity = i1 - i0 + 1;
+            for (size_t b = 1; b < numBins; ++b)
+            {
+                for (int32_t j = 0; j < 3; ++j)
+                {
+                    bmin[j] = std::min(bmin[j], bins[b - 1].bmin[j]);
+                    bmax[j] = std::max(bmax[j], bins[b - 1].bmax[j]);
+                }
+                count += bins[b - 1].count;
+                if (count > 0 && count < quantity)
+                {
+                    float cost = area(bmin, bmax) * static_cast<float>(count) + rightCost[b];
+                    if (cost < bestCost)
+                    {
+                        bestCost = cost;
+                        bestBoundary = b;
+                    }
+                }
+            }
+
+            // The first and last bins contain the extreme centroids, so
+            // there is always a boundary with both sides nonempty.
+            int32_t* middle = std::partition(inSplit + i0, inSplit + i1 + 1,
+                [&getBin, bestBoundary](int32_t t)
+                {
+                    return getBin(t) < bestBoundary;
+                });
+            j0 = static_cast<size_t>(middle - inSplit) - 1;
         }
 
         // For sorting centroid projections on axes.
@@ -292,25 +789,26 @@ namespace gte
             float projection;
         };
 
-        // Mesh and bounds.
+        // Mesh.
         std::shared_ptr<Mesh> mMesh;
-        Bound mModelBound;
-        Bound mWorldBound;
-
-        // Binary tree representation.
-        std::shared_ptr<BoundTree> mLChild;
-        std::shared_ptr<BoundTree> mRChild;
-
-        // If storeInteriorTris is set to 'false' in the constructor, the interior
-        // nodes set the triangle quantity to zero and the array to null.  Leaf
-        // nodes set the quantity to the number of triangles at that node (1, if
-        // maxTrianglesPerLeaf was set to 1) and allocate an array of triangle
-        // indices that are relative to the input mesh of the top level
-        // constructor.
-        //
-        // If storeInteriorTris is set to 'true', the interior nodes also save
-        // the triangle quantity and array of triangle indices for the mesh that
-        // the node represents.
+
+        // The nodes in depth-first order and their world bounds. The world
+        // bounds are updated by UpdateWorldBound during the traversals.
+        std::vector<Node> mNodes;
+        std::vector<Bound> mWorldBounds;
+
+        // The triangle indices, relative to the input mesh, of the leaves
+        // in depth-first order.
         std::vector<int32_t> mTriangles;
+        bool mStoreInteriorTris;
+
+        // The build parameters, kept for Rebuild.
+        size_t mMaxTrisPerLeaf;
+        BuildMethod mMethod;
+        size_t mNumThreads;
+
+        // Automatic rebuilds by Refit.
+        float mRebuildThreshold;
+        float mBaselineRatio;
     };
 }
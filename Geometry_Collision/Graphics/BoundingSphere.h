@@ -5,8 +5,14 @@
 #include "Logger.h"
 #include "Matrix4x4.h"
 #include "CullingPlane.h"
+#include <algorithm>
 #include <cstdint>
 
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GTE_BOUNDING_SPHERE_SSE
+#include <xmmintrin.h>
+#endif
+
 namespace gte
 {
     template <typename Real>
@@ -39,6 +45,17 @@ namespace gte
             return *this;
         }
 
+        // Comparison of the centers and radii.
+        inline bool operator==(BoundingSphere const& sphere) const
+        {
+            return mTuple == sphere.mTuple;
+        }
+
+        inline bool operator!=(BoundingSphere const& sphere) const
+        {
+            return mTuple != sphere.mTuple;
+        }
+
         // Member access.  The radius must be nonnegative.  When negative,
         // it is clamped to zero.
         inline void SetCenter(Vector3<Real> const& center)
@@ -173,14 +190,7 @@ namespace gte
         {
             // The center is the average of the positions.
             Real sum[3] = { (Real)0, (Real)0, (Real)0 };
-            for (uint32_t i = 0; i < numVertices; ++i)
-            {
-                Real const* position = reinterpret_cast<Real const*>(data +
-                    static_cast<size_t>(i) * vertexSize);
-                sum[0] += position[0];
-                sum[1] += position[1];
-                sum[2] += position[2];
-            }
+            SumPositions(numVertices, vertexSize, data, sum);
             Real invNumVertices = (Real)1 / static_cast<Real>(numVertices);
             mTuple[0] = sum[0] * invNumVertices;
             mTuple[1] = sum[1] * invNumVertices;
@@ -188,24 +198,7 @@ namespace gte
 
             // The radius is the largest distance from the center to the
             // positions.
-            mTuple[3] = (Real)0;
-            for (uint32_t i = 0; i < numVertices; ++i)
-            {
-                Real const* position = reinterpret_cast<Real const*>(data + static_cast<size_t>(i) * vertexSize);
-                Real diff[3] =
-                {
-                    position[0] - mTuple[0],
-                    position[1] - mTuple[1],
-                    position[2] - mTuple[2]
-                };
-                Real radiusSqr = diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2];
-                if (radiusSqr > mTuple[3])
-                {
-                    mTuple[3] = radiusSqr;
-                }
-            }
-
-            mTuple[3] = std::sqrt(mTuple[3]);
+            mTuple[3] = std::sqrt(MaxSqrDistance(numVertices, vertexSize, data, mTuple.data()));
         }
 
         // Test for intersection of linear component and bound (points of
@@ -348,6 +341,119 @@ namespace gte
         }
 
     private:
+        // The passes of ComputeFromData.  For float data and SSE, the sum
+        // adds each position as a 4-tuple and the distances are computed 4
+        // positions at a time.  The operations of each component are those
+        // of the scalar passes and in the same order, so the results are
+        // identical.  The 4-tuple loads read the 4 bytes after (x,y,z), which
+        // belong to the next vertex except for the last one, so the last
+        // position is loaded by components.
+        template <typename T>
+        static void SumPositions(uint32_t numVertices, uint32_t vertexSize,
+            char const* data, T sum[3])
+        {
+            for (uint32_t i = 0; i < numVertices; ++i)
+            {
+                T const* position = reinterpret_cast<T const*>(data +
+                    static_cast<size_t>(i) * vertexSize);
+                sum[0] += position[0];
+                sum[1] += position[1];
+                sum[2] += position[2];
+            }
+        }
+
+        template <typename T>
+        static T MaxSqrDistance(uint32_t numVertices, uint32_t vertexSize,
+            char const* data, T const* center)
+        {
+            T maxRadiusSqr = (T)0;
+            for (uint32_t i = 0; i < numVertices; ++i)
+            {
+                T const* position = reinterpret_cast<T const*>(data +
+                    static_cast<size_t>(i) * vertexSize);
+                T diff[3] =
+                {
+                    position[0] - center[0],
+                    position[1] - center[1],
+                    position[2] - center[2]
+                };
+                T radiusSqr = diff[0] * diff[0] + diff[1] * diff[1] + diff[2] * diff[2];
+                if (radiusSqr > maxRadiusSqr)
+                {
+                    maxRadiusSqr = radiusSqr;
+                }
+            }
+            return maxRadiusSqr;
+        }
+
+#if defined(GTE_BOUNDING_SPHERE_SSE)
+        static inline __m128 LoadPosition(uint32_t i, uint32_t numVertices,
+            uint32_t vertexSize, char const* data)
+        {
+            float const* position = reinterpret_cast<float const*>(data +
+                static_cast<size_t>(i) * vertexSize);
+            if (i + 1 < numVertices || vertexSize >= 4 * sizeof(float))
+            {
+                return _mm_loadu_ps(position);
+            }
+            return _mm_setr_ps(position[0], position[1], position[2], 0.0f);
+        }
+
+        static void SumPositions(uint32_t numVertices, uint32_t vertexSize,
+            char const* data, float sum[3])
+        {
+            __m128 vsum = _mm_setzero_ps();
+            for (uint32_t i = 0; i < numVertices; ++i)
+            {
+                vsum = _mm_add_ps(vsum, LoadPosition(i, numVertices, vertexSize, data));
+            }
+
+            alignas(16) float result[4];
+            _mm_store_ps(result, vsum);
+            sum[0] += result[0];
+            sum[1] += result[1];
+            sum[2] += result[2];
+        }
+
+        static float MaxSqrDistance(uint32_t numVertices, uint32_t vertexSize,
+            char const* data, float const* center)
+        {
+            __m128 const cx = _mm_set1_ps(center[0]);
+            __m128 const cy = _mm_set1_ps(center[1]);
+            __m128 const cz = _mm_set1_ps(center[2]);
+            __m128 vmax = _mm_setzero_ps();
+            uint32_t i = 0;
+            for (; i + 4 <= numVertices; i += 4)
+            {
+                // Transpose 4 positions to the x, y, z and unused rows.
+                __m128 x = LoadPosition(i, numVertices, vertexSize, data);
+                __m128 y = LoadPosition(i + 1, numVertices, vertexSize, data);
+                __m128 z = LoadPosition(i + 2, numVertices, vertexSize, data);
+                __m128 w = LoadPosition(i + 3, numVertices, vertexSize, data);
+                _MM_TRANSPOSE4_PS(x, y, z, w);
+
+                __m128 dx = _mm_sub_ps(x, cx);
+                __m128 dy = _mm_sub_ps(y, cy);
+                __m128 dz = _mm_sub_ps(z, cz);
+                __m128 radiusSqr = _mm_add_ps(_mm_add_ps(
+                    _mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+                vmax = _mm_max_ps(vmax, radiusSqr);
+            }
+
+            alignas(16) float result[4];
+            _mm_store_ps(result, vmax);
+            float maxRadiusSqr = std::max(std::max(result[0], result[1]),
+                std::max(result[2], result[3]));
+            if (i < numVertices)
+            {
+                maxRadiusSqr = std::max(maxRadiusSqr, MaxSqrDistance<float>(
+                    numVertices - i, vertexSize,
+                    data + static_cast<size_t>(i) * vertexSize, center));
+            }
+            return maxRadiusSqr;
+        }
+#endif
+
         // (center, radius) = (c0, c1, c2, r)
         std::array<Real, 4> mTuple;
     };
@@ -20,6 +20,12 @@ namespace Vector_GM
         virtual ~Buffer() = default;
     protected:
         Buffer(uint32_t numElements, size_t elementSize, bool createStorage = true);
+
+    public:
+        // The number of copies of the data in the GPU buffer of a buffer with
+        // Resource::Usage::STREAMING.  With three regions the CPU writes one
+        // frame while the GPU may still read the two frames before it.
+        static uint32_t constexpr numStreamingRegions = 3;
     };
 
     typedef std::function<void(std::shared_ptr<Buffer> const&)> BufferUpdater;
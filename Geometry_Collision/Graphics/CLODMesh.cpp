@@ -7,13 +7,19 @@
 
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/CLODMesh.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <cmath>
 using namespace gte;
 
 CLODMesh::CLODMesh(std::vector<CLODCollapseRecord> const& records)
     :
     Visual(),
     mRecords(records),
-    mTargetRecord(0)
+    mTargetRecord(0),
+    mFirstChangedIndex(0),
+    mNumChangedIndices(0),
+    mRecordErrors{}
 {
 }
 
@@ -40,6 +46,7 @@ bool CLODMesh::SetTargetRecord(int32_t targetRecord)
                     "Inconsistent record in SetTargetRecord.");
 
                 indices[c] = record.vKeep;
+                MarkChanged(static_cast<uint32_t>(c));
             }
 
             // Reduce the vertex count; the vertices are properly ordered.
@@ -62,6 +69,7 @@ bool CLODMesh::SetTargetRecord(int32_t targetRecord)
                     "Inconsistent record in SetTargetRecord.");
 
                 indices[c] = record.vThrow;
+                MarkChanged(static_cast<uint32_t>(c));
             }
 
             --mTargetRecord;
@@ -79,3 +87,107 @@ bool CLODMesh::SetTargetRecord(int32_t targetRecord)
 
     return false;
 }
+
+bool CLODMesh::UpdateIndexBuffer(BufferUpdater const& updater)
+{
+    if (mNumChangedIndices == 0)
+    {
+        return false;
+    }
+
+    uint32_t const offset = mIBuffer->GetOffset();
+    uint32_t const numActive = mIBuffer->GetNumActiveElements();
+    mIBuffer->SetOffset(mFirstChangedIndex);
+    mIBuffer->SetNumActiveElements(mNumChangedIndices);
+    updater(mIBuffer);
+    mIBuffer->SetOffset(offset);
+    mIBuffer->SetNumActiveElements(numActive);
+
+    mFirstChangedIndex = 0;
+    mNumChangedIndices = 0;
+    return true;
+}
+
+int32_t CLODMesh::SelectTargetRecord(std::shared_ptr<Camera> const& camera,
+    float viewportHeight, float pixelTolerance)
+{
+    LogAssert(camera != nullptr && viewportHeight > 0.0f, "Invalid input.");
+    if (mRecordErrors.size() != mRecords.size())
+    {
+        ComputeRecordErrors();
+    }
+
+    // The number of pixels per world unit at the distance of the nearest
+    // point of the world bound, or at the near plane for a closer bound.
+    float const uExtent = camera->GetUMax() - camera->GetUMin();
+    float pixelsPerUnit = viewportHeight / uExtent;
+    if (camera->IsPerspective())
+    {
+        Vector4<float> diff = HLift(worldBound.GetCenter(), 1.0f) - camera->GetPosition();
+        float distance = Length(diff) - worldBound.GetRadius();
+        distance = std::max(distance, camera->GetDMin());
+        pixelsPerUnit *= camera->GetDMin() / distance;
+    }
+
+    // Convert the tolerance to model space and select the last record
+    // whose error does not exceed it.
+    float const worldScale = worldTransform.GetNorm();
+    float const pixelsPerModelUnit = pixelsPerUnit * worldScale;
+    if (pixelsPerModelUnit <= 0.0f)
+    {
+        return GetNumRecords() - 1;
+    }
+    float const tolerance = pixelTolerance / pixelsPerModelUnit;
+    auto iter = std::upper_bound(mRecordErrors.begin(), mRecordErrors.end(), tolerance);
+    return std::max(static_cast<int32_t>(iter - mRecordErrors.begin()) - 1, 0);
+}
+
+void CLODMesh::SetTargetRecords(std::vector<std::shared_ptr<CLODMesh>> const& meshes,
+    std::shared_ptr<Camera> const& camera, float viewportHeight, float pixelTolerance)
+{
+    // A few tasks per thread balance the load of meshes that change by
+    // different numbers of records.
+    TaskScheduler& scheduler = TaskScheduler::GetDefault();
+    size_t const numTasks = std::min(meshes.size(), 4 * (scheduler.GetNumWorkers() + 1));
+    scheduler.ParallelFor(numTasks, [&](size_t t)
+    {
+        size_t const imin = t * meshes.size() / numTasks;
+        size_t const imax = (t + 1) * meshes.size() / numTasks;
+        for (size_t i = imin; i < imax; ++i)
+        {
+            CLODMesh* mesh = meshes[i].get();
+            if (mesh)
+            {
+                mesh->SetTargetRecord(mesh->SelectTargetRecord(camera,
+                    viewportHeight, pixelTolerance));
+            }
+        }
+    });
+}
+
+void CLODMesh::ComputeRecordErrors()
+{
+    LogAssert(mVBuffer != nullptr, "The mesh must have a vertex buffer.");
+    VertexFormat const& vformat = mVBuffer->GetFormat();
+    int32_t const index = vformat.GetIndex(VASemantic::POSITION, 0);
+    LogAssert(index >= 0 && vformat.GetType(index) == DF_R32G32B32_FLOAT,
+        "The positions must be 3-tuples of float.");
+    char const* positions = mVBuffer->GetData() + vformat.GetOffset(index);
+    size_t const vertexSize = static_cast<size_t>(vformat.GetVertexSize());
+
+    mRecordErrors.resize(mRecords.size());
+    float maxError = 0.0f;
+    for (size_t i = 0; i < mRecords.size(); ++i)
+    {
+        auto const& record = mRecords[i];
+        if (record.vKeep >= 0 && record.vThrow >= 0)
+        {
+            auto const& keep = *reinterpret_cast<Vector3<float> const*>(
+                positions + static_cast<size_t>(record.vKeep) * vertexSize);
+            auto const& thrown = *reinterpret_cast<Vector3<float> const*>(
+                positions + static_cast<size_t>(record.vThrow) * vertexSize);
+            maxError = std::max(maxError, Length(keep - thrown));
+        }
+        mRecordErrors[i] = maxError;
+    }
+}
@@ -8,7 +8,11 @@
 #pragma once
 
 #include <Graphics/Visual.h>
+#include <Graphics/Camera.h>
 #include <Graphics/CLODCollapseRecord.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
 
 namespace gte
 {
@@ -39,11 +43,81 @@ namespace gte
         // but false when they are the same. When the return value is 'true',
         // the caller is responsible for copying the CPU memory of the index
         // buffer to the equivalent GPU memory, typically using the call
-        // 'engine->Update(clodMesh->GetIndexBuffer()'.
+        // 'engine->Update(clodMesh->GetIndexBuffer()' or, to copy only the
+        // changed indices, UpdateIndexBuffer. Each level changes only the
+        // indices of its record, so the cost is proportional to the number
+        // of triangles that change.
         bool SetTargetRecord(int32_t targetRecord);
 
+        // The indices that SetTargetRecord changed since the last call to
+        // UpdateIndexBuffer are in the range [first,first+count) of the
+        // index buffer. The count is 0 when no indices changed.
+        inline uint32_t GetFirstChangedIndex() const
+        {
+            return mNumChangedIndices > 0 ? mFirstChangedIndex : 0;
+        }
+
+        inline uint32_t GetNumChangedIndices() const
+        {
+            return mNumChangedIndices;
+        }
+
+        // Copy the changed indices to GPU memory by calling the updater,
+        // typically '[engine](auto const& b) { engine->Update(b); }', with
+        // the offset and number of active elements of the index buffer set
+        // to the changed range. The offset and number of active elements
+        // are restored afterwards. The index buffer must have usage
+        // Resource::Usage::DYNAMIC_UPDATE. OpenGL copies only the range.
+        // Direct3D 11 copies the range when the buffer is mapped without
+        // discarding and the entire buffer otherwise. The function returns
+        // 'true' when indices were copied.
+        bool UpdateIndexBuffer(BufferUpdater const& updater);
+
+        // Screen-space error selection of the level of detail. The error
+        // of record i is the maximum length of the edges collapsed by
+        // records 1 through i, measured in model space from the vertex
+        // positions, so it increases with i. The errors are computed on the
+        // first call. The selected record is the largest one whose error,
+        // scaled by the world transform and projected at the distance of
+        // the world bound from the camera, is at most pixelTolerance pixels
+        // for a viewport of the specified height. The function returns the
+        // selected record without applying it.
+        int32_t SelectTargetRecord(std::shared_ptr<Camera> const& camera,
+            float viewportHeight, float pixelTolerance);
+
+        // Select and apply the target records of many meshes in parallel
+        // using the tasks of TaskScheduler::GetDefault(). Each mesh must
+        // occur once in the array. Call UpdateIndexBuffer afterwards on the
+        // thread that owns the graphics engine for the meshes that changed.
+        static void SetTargetRecords(std::vector<std::shared_ptr<CLODMesh>> const& meshes,
+            std::shared_ptr<Camera> const& camera, float viewportHeight,
+            float pixelTolerance);
+
     protected:
+        void ComputeRecordErrors();
+
+        // Include index c in the changed range.
+        inline void MarkChanged(uint32_t c)
+        {
+            if (mNumChangedIndices == 0)
+            {
+                mFirstChangedIndex = c;
+                mNumChangedIndices = 1;
+            }
+            else if (c < mFirstChangedIndex)
+            {
+                mNumChangedIndices += mFirstChangedIndex - c;
+                mFirstChangedIndex = c;
+            }
+            else if (c >= mFirstChangedIndex + mNumChangedIndices)
+            {
+                mNumChangedIndices = c - mFirstChangedIndex + 1;
+            }
+        }
+
         std::vector<CLODCollapseRecord> mRecords;
         int32_t mTargetRecord;
+        uint32_t mFirstChangedIndex, mNumChangedIndices;
+        std::vector<float> mRecordErrors;
     };
 }
@@ -12,14 +12,36 @@
 #include <Mathematics/EdgeKey.h>
 #include <Mathematics/TriangleKey.h>
 #include <Mathematics/MinHeap.h>
+#include <Mathematics/TaskScheduler.h>
 #include <Graphics/CLODCollapseRecord.h>
+#include <algorithm>
+#include <array>
 #include <limits>
 #include <map>
 #include <set>
+#include <vector>
 
 // Given a triangle mesh, CLODMeshCreator generates an array of collapse
 // records. Each record represents an incremental change in the mesh and is
 // used for level of detail.
+//
+// By default the edges are collapsed one at a time, the edge of minimum
+// metric first, using a heap of all edges. The batched decimation collapses
+// the edges in rounds instead. A round chooses from the cheapest quarter of
+// the collapsible edges a set of collapses whose neighborhoods are
+// disjoint, so the collapses of a round do not affect each other, and the
+// next round evaluates the edges of those neighborhoods again. The
+// evaluations of a round are independent of each other. Its metric is the
+// quadric error of Garland and Heckbert. Each vertex has the sum of the
+// area-weighted quadrics of the squared distances to the planes of its
+// triangles, a collapse adds the quadric of vThrow to that of vKeep, and
+// the cost of a collapse is the sum of the quadrics of its vertices
+// evaluated at the position of vKeep, which the collapse does not move.
+// Both directions of an edge are evaluated. The quadrics and the edge
+// evaluations are computed by tasks of TaskScheduler::GetDefault() when
+// numThreads > 0 and in the main thread when numThreads is 0; the collapses
+// modify the graph and are applied in the main thread. Both decimations
+// produce collapse records of the same form for CLODMesh.
 
 namespace gte
 {
@@ -36,8 +58,12 @@ namespace gte
     class CLODMeshCreator
     {
     public:
-        CLODMeshCreator()
+        // The default is the decimation by a heap of edges. Choose batched
+        // to be true for the batched decimation described previously.
+        CLODMeshCreator(bool batched = false, size_t numThreads = 0)
             :
+            mBatched(batched),
+            mNumThreads(numThreads),
             mVertexAtoms{},
             mIndices{},
             mVertices{},
@@ -47,7 +73,8 @@ namespace gte
             mHeap{},
             mCollapses{},
             mVerticesRemaining{},
-            mTrianglesRemaining{}
+            mTrianglesRemaining{},
+            mQuadrics{}
         {
         }
 
@@ -72,7 +99,7 @@ namespace gte
             mIndices = inIndices;
             mNumTriangles = static_cast<int32_t>(mIndices.size() / 3);
             mVertices.resize(mVertexAtoms.size());
-            mHeap.Reset(static_cast<int32_t>(mIndices.size()));
+            mHeap.Reset(mBatched ? 0 : static_cast<int32_t>(mIndices.size()));
 
             // Ensure the vertex and index buffers are valid for edge
             // collapsing. If they are not, an exception is thrown.
@@ -93,44 +120,13 @@ namespace gte
             // connected compoments, cannot be allowed to collapse.
             ClassifyCollapsibleVertices();
 
-            // Update the heap of edges.
-            for (auto const& element : mEdges)
+            if (mBatched)
             {
-                LogAssert(
-                    element.second.record->index < mHeap.GetNumElements(),
-                    "Unexpected condition.");
-
-                mHeap.Update(element.second.record, ComputeMetric(element.first));
+                DecimateBatched();
             }
-
-            while (mHeap.GetNumElements() > 0)
+            else
             {
-                EdgeKey<false> eKey{};
-                float metric{};
-                mHeap.GetMinimum(eKey, metric);
-                if (metric == std::numeric_limits<float>::max())
-                {
-                    // All remaining heap elements have infinite metrics.
-                    // Validate the results and throw an exception if not
-                    // valid.
-                    ValidateResults();
-                    break;
-                }
-
-                int32_t indexThrow = CanCollapse(eKey);
-                if (indexThrow >= 0)
-                {
-                    Collapse(eKey, indexThrow);
-                }
-                else
-                {
-                    auto emIter = mEdges.find(eKey);
-                    LogAssert(
-                        emIter->second.record->index < mHeap.GetNumElements(),
-                        "Unexpected condition.");
-
-                    mHeap.Update(emIter->second.record, std::numeric_limits<float>::max());
-                }
+                DecimateHeap();
             }
 
             // Reorder the vertex buffer so that the vertices are listed in
@@ -172,6 +168,10 @@ namespace gte
             bool collapsible;
         };
 
+        // The edge heap is 4-ary, which halves the levels that the sift
+        // operations traverse for meshes with millions of edges.
+        typedef MinHeap<EdgeKey<false>, float, 4> EdgeHeap;
+
         class Edge
         {
         public:
@@ -183,7 +183,7 @@ namespace gte
             }
 
             TriangleKeySet adjTriangles;
-            MinHeap<EdgeKey<false>, float>::Record* record;
+            EdgeHeap::Record* record;
         };
 
         using Triangle = int32_t;
@@ -323,18 +323,21 @@ namespace gte
                 if (emIter->second.adjTriangles.empty())
                 {
                     // The edge is not shared by any triangles, so delete it
-                    // from the heap.
-                    LogAssert(
-                        emIter->second.record->index < mHeap.GetNumElements(),
-                        "Unexpected condition.");
+                    // from the heap. The batched decimation has no heap.
+                    if (!mBatched)
+                    {
+                        LogAssert(
+                            emIter->second.record->index < mHeap.GetNumElements(),
+                            "Unexpected condition.");
 
-                    mHeap.Update(emIter->second.record, -1.0f);
-                    EdgeKey<false> unused{};
-                    float metric{};
-                    mHeap.Remove(unused, metric);
-                    LogAssert(
-                        metric == -1.0f,
-                        "The metric should be -1.");
+                        mHeap.Update(emIter->second.record, -1.0f);
+                        EdgeKey<false> unused{};
+                        float metric{};
+                        mHeap.Remove(unused, metric);
+                        LogAssert(
+                            metric == -1.0f,
+                            "The metric should be -1.");
+                    }
 
                     // Delete the edge from its endpoints' adjacency lists.
                     mVertices[tKey.V[i0]].adjEdges.erase(eKey[i0]);
@@ -440,8 +443,19 @@ namespace gte
 
             // The collapse cannot be allowed if it leads to the mesh folding
             // over.
-            int32_t vKeep = eKey.V[indexKeep];
-            int32_t vThrow = eKey.V[indexThrow];
+            if (!PreservesOrientation(eKey.V[indexKeep], eKey.V[indexThrow]))
+            {
+                return -1;
+            }
+
+            return indexThrow;
+        }
+
+        // Test whether replacing vThrow by vKeep in the triangles sharing
+        // vThrow keeps the angles between their old and new normals at most
+        // 90 degrees.
+        bool PreservesOrientation(int32_t vKeep, int32_t vThrow) const
+        {
             Vector3<float> posKeep = mVertexAtoms[vKeep].GetPosition();
             Vector3<float> posThrow = mVertexAtoms[vThrow].GetPosition();
 
@@ -480,11 +494,11 @@ namespace gte
                 // normals is larger than 90 degrees.
                 if (Dot(normalThrow, normalKeep) < 0.0f)
                 {
-                    return -1;
+                    return false;
                 }
             }
 
-            return indexThrow;
+            return true;
         }
 
         void Collapse(EdgeKey<false> const& eKey, int32_t indexThrow)
@@ -566,7 +580,13 @@ namespace gte
                 needUpdate.insert(EdgeKey<false>(v2, v0));
             }
 
-            // Update the heap for those edges affected by the collapse.
+            // Update the heap for those edges affected by the collapse. The
+            // batched decimation evaluates all edges in its next round.
+            if (mBatched)
+            {
+                return;
+            }
+
             for (auto const& updateKey : needUpdate)
             {
                 auto emIter = mEdges.find(updateKey);
@@ -578,6 +598,336 @@ namespace gte
             }
         }
 
+        void DecimateHeap()
+        {
+            // Update the heap of edges. All edges are updated, so the heap is
+            // rebuilt once instead of sifting each edge.
+            std::vector<EdgeHeap::Record*> heapRecords;
+            std::vector<float> metrics;
+            heapRecords.reserve(mEdges.size());
+            metrics.reserve(mEdges.size());
+            for (auto const& element : mEdges)
+            {
+                LogAssert(
+                    element.second.record->index < mHeap.GetNumElements(),
+                    "Unexpected condition.");
+
+                heapRecords.push_back(element.second.record);
+                metrics.push_back(ComputeMetric(element.first));
+            }
+            mHeap.Update(heapRecords, metrics);
+
+            while (mHeap.GetNumElements() > 0)
+            {
+                EdgeKey<false> eKey{};
+                float metric{};
+                mHeap.GetMinimum(eKey, metric);
+                if (metric == std::numeric_limits<float>::max())
+                {
+                    // All remaining heap elements have infinite metrics.
+                    // Validate the results and throw an exception if not
+                    // valid.
+                    ValidateResults();
+                    break;
+                }
+
+                int32_t indexThrow = CanCollapse(eKey);
+                if (indexThrow >= 0)
+                {
+                    Collapse(eKey, indexThrow);
+                }
+                else
+                {
+                    auto emIter = mEdges.find(eKey);
+                    LogAssert(
+                        emIter->second.record->index < mHeap.GetNumElements(),
+                        "Unexpected condition.");
+
+                    mHeap.Update(emIter->second.record, std::numeric_limits<float>::max());
+                }
+            }
+        }
+
+        // The quadric of a vertex is the symmetric 4x4 matrix
+        // Q = sum_i a_i * (N_i,d_i) * (N_i,d_i)^T for the planes
+        // Dot(N_i,X) + d_i = 0 of its triangles, where the N_i are unit
+        // length and the a_i are the triangle areas. The upper triangle of
+        // Q is stored in row-major order. The error of a point X is
+        // (X,1)^T * Q * (X,1).
+        typedef std::array<double, 10> Quadric;
+
+        // The best collapse of an edge in a round of the batched decimation.
+        // The indexThrow is -1 when the edge cannot be collapsed.
+        struct Candidate
+        {
+            EdgeKey<false> eKey;
+            int32_t indexThrow;
+            float sqrLength;
+            double cost;
+        };
+
+        void DecimateBatched()
+        {
+            ComputeQuadrics();
+
+            // The candidates are evaluated once and then only when a vertex
+            // of their edge was locked by a collapse of the previous round,
+            // because the evaluation of an edge depends on the quadrics and
+            // the triangles of its vertices only.
+            std::vector<typename EdgeMap::const_iterator> dirtyEdges{};
+            std::vector<Candidate> candidates{}, dirtyCandidates{};
+            dirtyEdges.reserve(mEdges.size());
+            for (auto emIter = mEdges.begin(); emIter != mEdges.end(); ++emIter)
+            {
+                dirtyEdges.push_back(emIter);
+            }
+
+            // A vertex is locked by a collapse of the current round when it
+            // is the throw vertex or adjacent to it. The rounds are numbered
+            // from 1, so the locks need not be cleared.
+            std::vector<size_t> lockRound(mVertices.size(), 0);
+            std::vector<int32_t> locked{};
+            for (size_t round = 1; ; ++round)
+            {
+                dirtyCandidates.resize(dirtyEdges.size());
+                ExecuteInRanges(dirtyEdges.size(),
+                    [this, &dirtyEdges, &dirtyCandidates](size_t imin, size_t imax)
+                    {
+                        for (size_t i = imin; i < imax; ++i)
+                        {
+                            EvaluateEdge(*dirtyEdges[i], dirtyCandidates[i]);
+                        }
+                    });
+
+                // Discard the candidates of the previous round that are stale
+                // and add the valid new evaluations.
+                size_t const previousRound = round - 1;
+                candidates.erase(std::remove_if(candidates.begin(), candidates.end(),
+                    [&lockRound, previousRound](Candidate const& candidate)
+                    {
+                        return lockRound[candidate.eKey.V[0]] == previousRound
+                            || lockRound[candidate.eKey.V[1]] == previousRound;
+                    }),
+                    candidates.end());
+                for (auto const& candidate : dirtyCandidates)
+                {
+                    if (candidate.indexThrow >= 0)
+                    {
+                        candidates.push_back(candidate);
+                    }
+                }
+                if (candidates.empty())
+                {
+                    break;
+                }
+
+                // Ties of the cost, such as the zero costs of flat regions,
+                // are broken by collapsing the shorter edges first.
+                auto lessThan = [](Candidate const& c0, Candidate const& c1)
+                {
+                    if (c0.cost < c1.cost)
+                    {
+                        return true;
+                    }
+                    if (c0.cost > c1.cost)
+                    {
+                        return false;
+                    }
+                    return c0.sqrLength < c1.sqrLength;
+                };
+
+                auto cheapestEnd = candidates.begin() + (candidates.size() + 3) / 4;
+                std::nth_element(candidates.begin(), cheapestEnd - 1, candidates.end(), lessThan);
+                std::sort(candidates.begin(), cheapestEnd, lessThan);
+
+                locked.clear();
+                for (auto candidate = candidates.begin(); candidate != cheapestEnd; ++candidate)
+                {
+                    int32_t vKeep = candidate->eKey.V[1 - candidate->indexThrow];
+                    int32_t vThrow = candidate->eKey.V[candidate->indexThrow];
+                    auto const& adjEdges = mVertices[vThrow].adjEdges;
+
+                    // The triangles modified by the collapse are those that
+                    // share vThrow. The collapse is skipped when one of their
+                    // vertices is locked, in which case one of them was
+                    // modified by a previous collapse of the round.
+                    bool isLocked = (lockRound[vThrow] == round);
+                    for (auto eIter = adjEdges.begin(); !isLocked && eIter != adjEdges.end(); ++eIter)
+                    {
+                        isLocked = (lockRound[GetOtherVertex(*eIter, vThrow)] == round);
+                    }
+                    if (isLocked)
+                    {
+                        continue;
+                    }
+
+                    lockRound[vThrow] = round;
+                    locked.push_back(vThrow);
+                    for (auto const& eKey : adjEdges)
+                    {
+                        int32_t vAdjacent = GetOtherVertex(eKey, vThrow);
+                        lockRound[vAdjacent] = round;
+                        locked.push_back(vAdjacent);
+                    }
+
+                    Collapse(candidate->eKey, candidate->indexThrow);
+
+                    Quadric& qKeep = mQuadrics[vKeep];
+                    Quadric const& qThrow = mQuadrics[vThrow];
+                    for (size_t j = 0; j < qKeep.size(); ++j)
+                    {
+                        qKeep[j] += qThrow[j];
+                    }
+                }
+
+                // The edges of the locked vertices are evaluated in the next
+                // round. An edge between two locked vertices is listed by
+                // its first vertex.
+                dirtyEdges.clear();
+                for (auto v : locked)
+                {
+                    for (auto const& eKey : mVertices[v].adjEdges)
+                    {
+                        int32_t vAdjacent = GetOtherVertex(eKey, v);
+                        if (lockRound[vAdjacent] != round || v < vAdjacent)
+                        {
+                            dirtyEdges.push_back(mEdges.find(eKey));
+                        }
+                    }
+                }
+            }
+
+            // As in DecimateHeap, the results are validated when edges
+            // remain that cannot be collapsed.
+            if (!mEdges.empty())
+            {
+                ValidateResults();
+            }
+        }
+
+        static inline int32_t GetOtherVertex(EdgeKey<false> const& eKey, int32_t v)
+        {
+            return (eKey.V[0] != v ? eKey.V[0] : eKey.V[1]);
+        }
+
+        void ComputeQuadrics()
+        {
+            mQuadrics.resize(mVertices.size());
+            ExecuteInRanges(mVertices.size(), [this](size_t vmin, size_t vmax)
+            {
+                for (size_t v = vmin; v < vmax; ++v)
+                {
+                    Quadric& quadric = mQuadrics[v];
+                    quadric.fill(0.0);
+                    for (auto const& tKey : mVertices[v].adjTriangles)
+                    {
+                        std::array<Vector3<double>, 3> position{};
+                        for (size_t j = 0; j < 3; ++j)
+                        {
+                            Vector3<float> p = mVertexAtoms[tKey.V[j]].GetPosition();
+                            position[j] = { p[0], p[1], p[2] };
+                        }
+
+                        // The length of the cross product is twice the area.
+                        Vector3<double> normal = Cross(position[1] - position[0],
+                            position[2] - position[0]);
+                        double length = Length(normal);
+                        if (length == 0.0)
+                        {
+                            continue;
+                        }
+
+                        normal /= length;
+                        std::array<double, 4> plane =
+                        {
+                            normal[0], normal[1], normal[2], -Dot(normal, position[0])
+                        };
+                        double area = 0.5 * length;
+                        for (size_t r = 0, j = 0; r < 4; ++r)
+                        {
+                            double areaPlaneR = area * plane[r];
+                            for (size_t c = r; c < 4; ++c, ++j)
+                            {
+                                quadric[j] += areaPlaneR * plane[c];
+                            }
+                        }
+                    }
+                }
+            });
+        }
+
+        void EvaluateEdge(std::pair<EdgeKey<false> const, Edge> const& element,
+            Candidate& candidate) const
+        {
+            EdgeKey<false> const& eKey = element.first;
+            candidate.eKey = eKey;
+            candidate.indexThrow = -1;
+            candidate.sqrLength = 0.0f;
+            candidate.cost = std::numeric_limits<double>::max();
+
+            // Only manifold edges are allowed to collapse.
+            if (element.second.adjTriangles.size() != 2)
+            {
+                return;
+            }
+
+            for (int32_t indexThrow = 0; indexThrow < 2; ++indexThrow)
+            {
+                int32_t vKeep = eKey.V[1 - indexThrow];
+                int32_t vThrow = eKey.V[indexThrow];
+                if (mVertices[vThrow].collapsible)
+                {
+                    Vector3<float> posKeep = mVertexAtoms[vKeep].GetPosition();
+                    double cost = GetError(mQuadrics[vKeep], mQuadrics[vThrow], posKeep);
+                    if (cost < candidate.cost && PreservesOrientation(vKeep, vThrow))
+                    {
+                        candidate.indexThrow = indexThrow;
+                        Vector3<float> diff = mVertexAtoms[vThrow].GetPosition() - posKeep;
+                        candidate.sqrLength = Dot(diff, diff);
+                        candidate.cost = cost;
+                    }
+                }
+            }
+        }
+
+        // The error of the point X for the quadric q0 + q1.
+        static double GetError(Quadric const& q0, Quadric const& q1, Vector3<float> const& X)
+        {
+            Quadric q{};
+            for (size_t j = 0; j < q.size(); ++j)
+            {
+                q[j] = q0[j] + q1[j];
+            }
+
+            double x = X[0], y = X[1], z = X[2];
+            return x * (q[0] * x + 2.0 * (q[1] * y + q[2] * z + q[3]))
+                + y * (q[4] * y + 2.0 * (q[5] * z + q[6]))
+                + z * (q[7] * z + 2.0 * q[8])
+                + q[9];
+        }
+
+        // Call function(imin, imax) for contiguous ranges that partition
+        // [0,numElements), in tasks when mNumThreads > 0.
+        template <typename Function>
+        void ExecuteInRanges(size_t numElements, Function const& function) const
+        {
+            size_t constexpr minPerTask = 1024;
+            size_t const numTasks = std::max(std::min(mNumThreads,
+                numElements / minPerTask), static_cast<size_t>(1));
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks,
+                    [numElements, numTasks, &function](size_t k)
+                    {
+                        function(k * numElements / numTasks, (k + 1) * numElements / numTasks);
+                    });
+            }
+            else
+            {
+                function(0, numElements);
+            }
+        }
+
         void ValidateResults()
         {
             // Save the indices of the remaining triangles. These are needed
@@ -705,10 +1055,15 @@ namespace gte
             records[0].numVertices = numVertices;
             records[0].numTriangles = mNumTriangles;
 
-            // Replace throw vertices in the index buffer as we process each
-            // collapse record.
-            std::vector<int32_t> indices = mIndices;
-            std::vector<int32_t> vthrowIndices(mIndices.size());
+            // The positions in the index buffer of each vertex as the
+            // collapses are processed. The positions of a throw vertex are
+            // moved to its keep vertex, so a collapse visits only the
+            // positions of its throw vertex instead of the index buffer.
+            std::vector<std::vector<int32_t>> positions(mVertexAtoms.size());
+            for (size_t i = 0; i < mIndices.size(); ++i)
+            {
+                positions[mIndices[i]].push_back(static_cast<int32_t>(i));
+            }
 
             // Process the collapse records.
             CLODCollapseRecord* record = &records[1];
@@ -727,34 +1082,38 @@ namespace gte
                 record->numTriangles = numTriangles;
 
                 // Collapse the edge and update the indices for the
-                // post-collapse index buffer.
+                // post-collapse index buffer. The positions beyond the
+                // post-collapse triangles are discarded.
                 int32_t const numIndices = 3 * numTriangles;
-                int32_t numRecordIndices = 0;
-                for (int32_t i = 0; i < numIndices; ++i)
+                record->indices.clear();
+                for (auto i : positions[record->vThrow])
                 {
-                    if (indices[i] == record->vThrow)
+                    if (i < numIndices)
                     {
-                        vthrowIndices[numRecordIndices++] = i;
-                        indices[i] = record->vKeep;
+                        record->indices.push_back(i);
                     }
                 }
-                if (numRecordIndices > 0)
-                {
-                    record->indices.resize(numRecordIndices);
-                    for (int32_t j = 0; j < numRecordIndices; ++j)
+                std::sort(record->indices.begin(), record->indices.end());
+                positions[record->vThrow].clear();
+
+                auto& keepPositions = positions[record->vKeep];
+                keepPositions.erase(std::remove_if(keepPositions.begin(), keepPositions.end(),
+                    [numIndices](int32_t i)
                     {
-                        record->indices[j] = vthrowIndices[j];
-                    }
-                }
-                else
-                {
-                    record->indices.clear();
-                }
+                        return i >= numIndices;
+                    }),
+                    keepPositions.end());
+                keepPositions.insert(keepPositions.end(), record->indices.begin(),
+                    record->indices.end());
 
                 ++record;
             }
         }
 
+        // The decimation options.
+        bool mBatched;
+        size_t mNumThreads;
+
         // Triangle mesh to be decimated.
         std::vector<VertexAtom> mVertexAtoms;
         std::vector<int32_t> mIndices;
@@ -766,7 +1125,7 @@ namespace gte
         int32_t mNumTriangles;
 
         // The edge heap to support collapse operations.
-        MinHeap<EdgeKey<false>, float> mHeap;
+        EdgeHeap mHeap;
 
         // The sequence of edge collapses.
         std::vector<CollapseInfo> mCollapses;
@@ -774,5 +1133,8 @@ namespace gte
         // Postprocessing of the edge collapses.
         std::vector<int32_t> mVerticesRemaining;
         std::vector<Triangle> mTrianglesRemaining;
+
+        // The vertex quadrics of the batched decimation.
+        std::vector<Quadric> mQuadrics;
     };
 }
@@ -0,0 +1,353 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/ClusteredLightEffect.h>
+using namespace gte;
+
+ClusteredLightEffect::ClusteredLightEffect(std::shared_ptr<ProgramFactory> const& factory,
+    BufferUpdater const& updater, std::shared_ptr<Material> const& material,
+    std::shared_ptr<ClusteredLighting> const& lighting)
+    :
+    LightEffect(factory, updater, msVSSource, msPSSource, material, nullptr, nullptr),
+    mClusteredLighting(lighting)
+{
+    mMaterialConstant = std::make_shared<ConstantBuffer>(sizeof(InternalMaterial), true);
+    UpdateMaterialConstant();
+
+    mWMatrixConstant = std::make_shared<ConstantBuffer>(sizeof(Matrix4x4<float>), true);
+    *mWMatrixConstant->Get<Matrix4x4<float>>() = Matrix4x4<float>::Identity();
+
+    mProgram->GetVertexShader()->Set("WMatrix", mWMatrixConstant);
+    auto const& pshader = mProgram->GetPixelShader();
+    pshader->Set("Material", mMaterialConstant);
+    pshader->Set("ClusterParameters", mClusteredLighting->GetParameters());
+    pshader->Set("lights", mClusteredLighting->GetLights());
+    pshader->Set("clusterLights", mClusteredLighting->GetClusterLights());
+}
+
+void ClusteredLightEffect::SetWMatrix(Matrix4x4<float> const& wMatrix)
+{
+    *mWMatrixConstant->Get<Matrix4x4<float>>() = wMatrix;
+    mBufferUpdater(mWMatrixConstant);
+}
+
+void ClusteredLightEffect::UpdateMaterialConstant()
+{
+    InternalMaterial* internalMaterial = mMaterialConstant->Get<InternalMaterial>();
+    internalMaterial->emissive = mMaterial->emissive;
+    internalMaterial->ambient = mMaterial->ambient;
+    internalMaterial->diffuse = mMaterial->diffuse;
+    internalMaterial->specular = mMaterial->specular;
+    LightEffect::UpdateMaterialConstant();
+}
+
+
+std::string const ClusteredLightEffect::msGLSLVSSource =
+R"(
+    uniform PVWMatrix
+    {
+        mat4 pvwMatrix;
+    };
+
+    uniform WMatrix
+    {
+        mat4 wMatrix;
+    };
+
+    layout(location = 0) in vec3 modelPosition;
+    layout(location = 1) in vec3 modelNormal;
+    layout(location = 0) out vec3 vertexPosition;
+    layout(location = 1) out vec3 vertexNormal;
+
+    void main()
+    {
+    #if GTE_USE_MAT_VEC
+        vertexPosition = (wMatrix * vec4(modelPosition, 1.0f)).xyz;
+        vertexNormal = (wMatrix * vec4(modelNormal, 0.0f)).xyz;
+        gl_Position = pvwMatrix * vec4(modelPosition, 1.0f);
+    #else
+        vertexPosition = (vec4(modelPosition, 1.0f) * wMatrix).xyz;
+        vertexNormal = (vec4(modelNormal, 0.0f) * wMatrix).xyz;
+        gl_Position = vec4(modelPosition, 1.0f) * pvwMatrix;
+    #endif
+    }
+)";
+
+std::string const ClusteredLightEffect::msGLSLPSSource =
+LightEffect::GetGLSLLitFunction() +
+R"(
+    uniform Material
+    {
+        vec4 materialEmissive;
+        vec4 materialAmbient;
+        vec4 materialDiffuse;
+        vec4 materialSpecular;
+    };
+
+    uniform ClusterParameters
+    {
+        vec4 cameraPosition;
+        vec4 cameraDVector;
+        vec4 cameraUVector;
+        vec4 cameraRVector;
+        vec4 frustum;
+        vec4 slices;
+        vec4 viewport;
+        uvec4 dimensions;
+        uvec4 counts;
+    };
+
+    struct LightRecord
+    {
+        vec4 position;
+        vec4 direction;
+        vec4 ambient;
+        vec4 diffuse;
+        vec4 specular;
+        vec4 spotCutoff;
+        vec4 attenuation;
+    };
+
+    buffer lights { LightRecord data[]; } lightsSB;
+    buffer clusterLights { uint data[]; } clusterLightsSB;
+
+    layout(location = 0) in vec3 vertexPosition;
+    layout(location = 1) in vec3 vertexNormal;
+    layout(location = 0) out vec4 pixelColor;
+
+    vec3 DiffuseSpecular(LightRecord light, vec3 normal, vec3 viewVector, vec3 direction)
+    {
+        float NDotL = -dot(normal, direction);
+        vec3 halfVector = normalize(viewVector - direction);
+        float NDotH = dot(normal, halfVector);
+        vec4 lighting = lit(NDotL, NDotH, materialSpecular.a);
+        return lighting.y * materialDiffuse.rgb * light.diffuse.rgb +
+            lighting.z * materialSpecular.rgb * light.specular.rgb;
+    }
+
+    uint GetCluster(vec2 pixel, vec3 position)
+    {
+        vec2 ndc = 2.0f * (pixel - viewport.xy) / viewport.zw - 1.0f;
+        uvec2 tile = min(uvec2(clamp(0.5f * ndc + 0.5f, 0.0f, 1.0f) * vec2(dimensions.xy)),
+            dimensions.xy - 1);
+        float depth = max(dot(cameraDVector.xyz, position - cameraPosition.xyz), slices.x);
+        uint slice = min(uint(log(depth / slices.x) * slices.z), dimensions.z - 1);
+        return tile.x + dimensions.x * (tile.y + dimensions.y * slice);
+    }
+
+    void main()
+    {
+        vec3 normal = normalize(vertexNormal);
+        vec3 viewVector = normalize(cameraPosition.xyz - vertexPosition);
+        vec3 color = vec3(0.0f);
+
+        for (uint i = 0; i < counts.x; ++i)
+        {
+            LightRecord light = lightsSB.data[i];
+            color += light.attenuation.w * (materialAmbient.rgb * light.ambient.rgb +
+                DiffuseSpecular(light, normal, viewVector, light.direction.xyz));
+        }
+
+        uint base = GetCluster(gl_FragCoord.xy, vertexPosition) * (dimensions.w + 1);
+        uint count = clusterLightsSB.data[base];
+        for (uint j = 1; j <= count; ++j)
+        {
+            LightRecord light = lightsSB.data[clusterLightsSB.data[base + j]];
+            vec3 diff = vertexPosition - light.position.xyz;
+            float distance = length(diff);
+            float window = 1.0f - distance * distance / (light.position.w * light.position.w);
+            if (window > 0.0f)
+            {
+                vec3 direction = diff / distance;
+                float cosAngle = dot(light.direction.xyz, direction);
+                float spot = 0.0f;
+                if (cosAngle >= light.spotCutoff.y)
+                {
+                    spot = (light.spotCutoff.w > 0.0f ? pow(abs(cosAngle), light.spotCutoff.w) : 1.0f);
+                }
+                float attenuation = light.attenuation.w / (light.attenuation.x + distance *
+                    (light.attenuation.y + distance * light.attenuation.z));
+                color += window * window * attenuation * (materialAmbient.rgb * light.ambient.rgb +
+                    spot * DiffuseSpecular(light, normal, viewVector, direction));
+            }
+        }
+
+        pixelColor.rgb = materialEmissive.rgb + color;
+        pixelColor.a = materialDiffuse.a;
+    }
+)";
+
+std::string const ClusteredLightEffect::msHLSLVSSource =
+R"(
+    cbuffer PVWMatrix
+    {
+        float4x4 pvwMatrix;
+    };
+
+    cbuffer WMatrix
+    {
+        float4x4 wMatrix;
+    };
+
+    struct VS_INPUT
+    {
+        float3 modelPosition : POSITION;
+        float3 modelNormal : NORMAL;
+    };
+
+    struct VS_OUTPUT
+    {
+        float3 vertexPosition : TEXCOORD0;
+        float3 vertexNormal : TEXCOORD1;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    VS_OUTPUT VSMain(VS_INPUT input)
+    {
+        VS_OUTPUT output;
+    #if GTE_USE_MAT_VEC
+        output.vertexPosition = mul(wMatrix, float4(input.modelPosition, 1.0f)).xyz;
+        output.vertexNormal = mul(wMatrix, float4(input.modelNormal, 0.0f)).xyz;
+        output.clipPosition = mul(pvwMatrix, float4(input.modelPosition, 1.0f));
+    #else
+        output.vertexPosition = mul(float4(input.modelPosition, 1.0f), wMatrix).xyz;
+        output.vertexNormal = mul(float4(input.modelNormal, 0.0f), wMatrix).xyz;
+        output.clipPosition = mul(float4(input.modelPosition, 1.0f), pvwMatrix);
+    #endif
+        return output;
+    }
+)";
+
+std::string const ClusteredLightEffect::msHLSLPSSource =
+R"(
+    cbuffer Material
+    {
+        float4 materialEmissive;
+        float4 materialAmbient;
+        float4 materialDiffuse;
+        float4 materialSpecular;
+    };
+
+    cbuffer ClusterParameters
+    {
+        float4 cameraPosition;
+        float4 cameraDVector;
+        float4 cameraUVector;
+        float4 cameraRVector;
+        float4 frustum;
+        float4 slices;
+        float4 viewport;
+        uint4 dimensions;
+        uint4 counts;
+    };
+
+    struct LightRecord
+    {
+        float4 position;
+        float4 direction;
+        float4 ambient;
+        float4 diffuse;
+        float4 specular;
+        float4 spotCutoff;
+        float4 attenuation;
+    };
+
+    StructuredBuffer<LightRecord> lights;
+    StructuredBuffer<uint> clusterLights;
+
+    struct PS_INPUT
+    {
+        float3 vertexPosition : TEXCOORD0;
+        float3 vertexNormal : TEXCOORD1;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    struct PS_OUTPUT
+    {
+        float4 pixelColor : SV_TARGET0;
+    };
+
+    float3 DiffuseSpecular(LightRecord light, float3 normal, float3 viewVector, float3 direction)
+    {
+        float NDotL = -dot(normal, direction);
+        float3 halfVector = normalize(viewVector - direction);
+        float NDotH = dot(normal, halfVector);
+        float4 lighting = lit(NDotL, NDotH, materialSpecular.a);
+        return lighting.y * materialDiffuse.rgb * light.diffuse.rgb +
+            lighting.z * materialSpecular.rgb * light.specular.rgb;
+    }
+
+    // The y-axis of the pixel coordinates points down, that of the
+    // normalized coordinates up.
+    uint GetCluster(float2 pixel, float3 position)
+    {
+        float2 ndc = 2.0f * (pixel - viewport.xy) / viewport.zw - 1.0f;
+        ndc.y = -ndc.y;
+        uint2 tile = min(uint2(saturate(0.5f * ndc + 0.5f) * float2(dimensions.xy)),
+            dimensions.xy - 1);
+        float depth = max(dot(cameraDVector.xyz, position - cameraPosition.xyz), slices.x);
+        uint slice = min(uint(log(depth / slices.x) * slices.z), dimensions.z - 1);
+        return tile.x + dimensions.x * (tile.y + dimensions.y * slice);
+    }
+
+    PS_OUTPUT PSMain(PS_INPUT input)
+    {
+        PS_OUTPUT output;
+
+        float3 normal = normalize(input.vertexNormal);
+        float3 viewVector = normalize(cameraPosition.xyz - input.vertexPosition);
+        float3 color = 0.0f;
+
+        for (uint i = 0; i < counts.x; ++i)
+        {
+            LightRecord light = lights[i];
+            color += light.attenuation.w * (materialAmbient.rgb * light.ambient.rgb +
+                DiffuseSpecular(light, normal, viewVector, light.direction.xyz));
+        }
+
+        uint base = GetCluster(input.clipPosition.xy, input.vertexPosition) * (dimensions.w + 1);
+        uint count = clusterLights[base];
+        for (uint j = 1; j <= count; ++j)
+        {
+            LightRecord light = lights[clusterLights[base + j]];
+            float3 diff = input.vertexPosition - light.position.xyz;
+            float distance = length(diff);
+            float window = 1.0f - distance * distance / (light.position.w * light.position.w);
+            if (window > 0.0f)
+            {
+                float3 direction = diff / distance;
+                float cosAngle = dot(light.direction.xyz, direction);
+                float spot = 0.0f;
+                if (cosAngle >= light.spotCutoff.y)
+                {
+                    spot = (light.spotCutoff.w > 0.0f ? pow(abs(cosAngle), light.spotCutoff.w) : 1.0f);
+                }
+                float attenuation = light.attenuation.w / (light.attenuation.x + distance *
+                    (light.attenuation.y + distance * light.attenuation.z));
+                color += window * window * attenuation * (materialAmbient.rgb * light.ambient.rgb +
+                    spot * DiffuseSpecular(light, normal, viewVector, direction));
+            }
+        }
+
+        output.pixelColor.rgb = materialEmissive.rgb + color;
+        output.pixelColor.a = materialDiffuse.a;
+        return output;
+    }
+)";
+
+ProgramSources const ClusteredLightEffect::msVSSource =
+{
+    &msGLSLVSSource,
+    &msHLSLVSSource
+};
+
+ProgramSources const ClusteredLightEffect::msPSSource =
+{
+    &msGLSLPSSource,
+    &msHLSLPSSource
+};
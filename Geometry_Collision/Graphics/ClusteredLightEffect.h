@@ -0,0 +1,71 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/ClusteredLighting.h>
+#include <Graphics/LightEffect.h>
+
+namespace gte
+{
+    // Per-pixel lighting by the lights of a ClusteredLighting object. The
+    // pixel shader applies the directional lights and then the point and
+    // spot lights of the cluster that contains the pixel, with the lighting
+    // models of DirectionalLightEffect, PointLightEffect and
+    // SpotLightEffect. The lighting is computed in world coordinates, so
+    // the effect needs the world matrix of its visual, which is set by
+    // SetWMatrix when the world transform changes. The world matrix must not
+    // have nonuniform scaling. The vertex format has a POSITION and a NORMAL
+    // of type DF_R32G32B32_FLOAT. The Lighting and LightCameraGeometry of
+    // LightEffect are not used.
+    class ClusteredLightEffect : public LightEffect
+    {
+    public:
+        // Construction.
+        ClusteredLightEffect(std::shared_ptr<ProgramFactory> const& factory,
+            BufferUpdater const& updater, std::shared_ptr<Material> const& material,
+            std::shared_ptr<ClusteredLighting> const& lighting);
+
+        // Member access.
+        inline std::shared_ptr<ClusteredLighting> const& GetClusteredLighting() const
+        {
+            return mClusteredLighting;
+        }
+
+        inline std::shared_ptr<ConstantBuffer> const& GetWMatrixConstant() const
+        {
+            return mWMatrixConstant;
+        }
+
+        // Set the world matrix of the visual and update the constant buffer.
+        void SetWMatrix(Matrix4x4<float> const& wMatrix);
+
+        // After you set or modify 'material', call the update to inform any
+        // listener that the corresponding constant buffer has changed.
+        virtual void UpdateMaterialConstant() override;
+
+    private:
+        struct InternalMaterial
+        {
+            Vector4<float> emissive;
+            Vector4<float> ambient;
+            Vector4<float> diffuse;
+            Vector4<float> specular;
+        };
+
+        std::shared_ptr<ClusteredLighting> mClusteredLighting;
+        std::shared_ptr<ConstantBuffer> mWMatrixConstant;
+
+        // Shader source code as strings.
+        static std::string const msGLSLVSSource;
+        static std::string const msGLSLPSSource;
+        static std::string const msHLSLVSSource;
+        static std::string const msHLSLPSSource;
+        static ProgramSources const msVSSource;
+        static ProgramSources const msPSSource;
+    };
+}
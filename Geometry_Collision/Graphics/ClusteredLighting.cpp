@@ -0,0 +1,280 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/ClusteredLighting.h>
+#include <Mathematics/Logger.h>
+#include <Mathematics/Math.h>
+#include <algorithm>
+#include <cmath>
+using namespace gte;
+
+ClusteredLighting::ClusteredLighting(std::shared_ptr<GraphicsEngine> const& engine,
+    std::shared_ptr<ProgramFactory> const& factory, uint32_t maxLights,
+    uint32_t numXTiles, uint32_t numYTiles, uint32_t numSlices, uint32_t maxLightsPerCluster)
+    :
+    mEngine(engine),
+    mMaxLights(maxLights),
+    mNumXTiles(numXTiles),
+    mNumYTiles(numYTiles),
+    mNumSlices(numSlices),
+    mMaxLightsPerCluster(maxLightsPerCluster)
+{
+    LogAssert(engine != nullptr && factory != nullptr, "The engine and factory must exist.");
+    LogAssert(maxLights > 0 && numXTiles > 0 && numYTiles > 0 && numSlices > 0 &&
+        maxLightsPerCluster > 0, "Invalid input.");
+
+    mParameters = std::make_shared<ConstantBuffer>(sizeof(Parameters), true);
+
+    mLights = std::make_shared<StructuredBuffer>(mMaxLights, sizeof(LightRecord));
+    mLights->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+
+    mClusterLights = std::make_shared<StructuredBuffer>(
+        GetNumClusters() * (mMaxLightsPerCluster + 1), sizeof(uint32_t));
+    mClusterLights->SetUsage(Resource::Usage::SHADER_OUTPUT);
+
+    factory->PushDefines();
+    factory->defines.Set("NUM_X_THREADS", msNumBinThreads);
+    mBinProgram = factory->CreateFromSource(*msBinSource[factory->GetAPI()]);
+    factory->PopDefines();
+    LogAssert(mBinProgram != nullptr, "Failed to compile the light binning program.");
+
+    auto const& cshader = mBinProgram->GetComputeShader();
+    cshader->Set("ClusterParameters", mParameters);
+    cshader->Set("lights", mLights);
+    cshader->Set("clusterLights", mClusterLights);
+}
+
+void ClusteredLighting::Update(std::shared_ptr<Camera> const& camera,
+    std::vector<Light> const& lights)
+{
+    LogAssert(camera != nullptr && camera->IsPerspective(), "The camera must be perspective.");
+
+    // The directional lights precede the point and spot lights.
+    uint32_t const numLights = std::min(static_cast<uint32_t>(lights.size()), mMaxLights);
+    auto records = mLights->Get<LightRecord>();
+    uint32_t numDirectional = 0;
+    for (uint32_t pass = 0, i = 0; pass < 2; ++pass)
+    {
+        for (uint32_t j = 0; j < numLights; ++j)
+        {
+            Light const& light = lights[j];
+            bool const isDirectional = (light.type == LightType::DIRECTIONAL);
+            if (isDirectional != (pass == 0))
+            {
+                continue;
+            }
+
+            LightRecord& record = records[i++];
+            record.position = light.position;
+            record.position[3] = light.range;
+            record.direction = light.direction;
+            record.direction[3] = 0.0f;
+            Normalize(record.direction);
+            record.ambient = light.lighting->ambient;
+            record.diffuse = light.lighting->diffuse;
+            record.specular = light.lighting->specular;
+            record.attenuation = light.lighting->attenuation;
+            if (light.type == LightType::SPOT)
+            {
+                record.spotCutoff = light.lighting->spotCutoff;
+            }
+            else
+            {
+                // The cone of a point light contains all directions.
+                record.spotCutoff = { (float)GTE_C_PI, -2.0f, 0.0f, 0.0f };
+            }
+
+            if (isDirectional)
+            {
+                ++numDirectional;
+            }
+        }
+    }
+    if (numLights > 0)
+    {
+        mLights->SetNumActiveElements(numLights);
+        mEngine->Update(mLights);
+    }
+
+    float dMin, dMax, uMin, uMax, rMin, rMax;
+    camera->GetFrustum(dMin, dMax, uMin, uMax, rMin, rMax);
+    int32_t vx, vy, vw, vh;
+    mEngine->GetViewport(vx, vy, vw, vh);
+
+    Parameters& parameters = *mParameters->Get<Parameters>();
+    parameters.cameraPosition = camera->GetPosition();
+    parameters.cameraDVector = camera->GetDVector();
+    parameters.cameraUVector = camera->GetUVector();
+    parameters.cameraRVector = camera->GetRVector();
+    parameters.frustum = { rMin / dMin, rMax / dMin, uMin / dMin, uMax / dMin };
+    parameters.slices = { dMin, dMax,
+        static_cast<float>(mNumSlices) / std::log(dMax / dMin), 0.0f };
+    parameters.viewport = { static_cast<float>(vx), static_cast<float>(vy),
+        static_cast<float>(vw), static_cast<float>(vh) };
+    parameters.dimensions[0] = mNumXTiles;
+    parameters.dimensions[1] = mNumYTiles;
+    parameters.dimensions[2] = mNumSlices;
+    parameters.dimensions[3] = mMaxLightsPerCluster;
+    parameters.counts[0] = numDirectional;
+    parameters.counts[1] = numLights;
+    parameters.counts[2] = 0;
+    parameters.counts[3] = 0;
+    mEngine->Update(mParameters);
+
+    mEngine->Execute(mBinProgram,
+        (GetNumClusters() + msNumBinThreads - 1) / msNumBinThreads, 1, 1);
+}
+
+// A thread per cluster tests the bounding spheres of the point and spot
+// lights against the bounding box of the cluster in view coordinates
+// (r,u,d). The lateral coordinates of a point of the frustum at depth d with
+// normalized x in [-1,1] are r = d * lerp(rmin/dmin, rmax/dmin, (x+1)/2),
+// which is linear in d, so the box is spanned by the corners of the cluster.
+std::string const ClusteredLighting::msGLSLBinSource =
+R"(
+    uniform ClusterParameters
+    {
+        vec4 cameraPosition;
+        vec4 cameraDVector;
+        vec4 cameraUVector;
+        vec4 cameraRVector;
+        vec4 frustum;
+        vec4 slices;
+        vec4 viewport;
+        uvec4 dimensions;
+        uvec4 counts;
+    };
+
+    struct LightRecord
+    {
+        vec4 position;
+        vec4 direction;
+        vec4 ambient;
+        vec4 diffuse;
+        vec4 specular;
+        vec4 spotCutoff;
+        vec4 attenuation;
+    };
+
+    buffer lights { LightRecord data[]; } lightsSB;
+    buffer clusterLights { uint data[]; } clusterLightsSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint cluster = gl_GlobalInvocationID.x;
+        if (cluster >= dimensions.x * dimensions.y * dimensions.z)
+        {
+            return;
+        }
+
+        uint ix = cluster % dimensions.x;
+        uint iy = (cluster / dimensions.x) % dimensions.y;
+        uint iz = cluster / (dimensions.x * dimensions.y);
+        float r0 = mix(frustum.x, frustum.y, float(ix) / float(dimensions.x));
+        float r1 = mix(frustum.x, frustum.y, float(ix + 1) / float(dimensions.x));
+        float u0 = mix(frustum.z, frustum.w, float(iy) / float(dimensions.y));
+        float u1 = mix(frustum.z, frustum.w, float(iy + 1) / float(dimensions.y));
+        float d0 = slices.x * exp(float(iz) / slices.z);
+        float d1 = slices.x * exp(float(iz + 1) / slices.z);
+        vec3 boxMin = vec3(min(d0 * r0, d1 * r0), min(d0 * u0, d1 * u0), d0);
+        vec3 boxMax = vec3(max(d0 * r1, d1 * r1), max(d0 * u1, d1 * u1), d1);
+
+        uint base = cluster * (dimensions.w + 1);
+        uint count = 0;
+        for (uint i = counts.x; i < counts.y && count < dimensions.w; ++i)
+        {
+            vec4 position = lightsSB.data[i].position;
+            vec3 diff = position.xyz - cameraPosition.xyz;
+            vec3 V = vec3(dot(cameraRVector.xyz, diff), dot(cameraUVector.xyz, diff),
+                dot(cameraDVector.xyz, diff));
+            vec3 excess = max(boxMin - V, 0.0f) + max(V - boxMax, 0.0f);
+            if (dot(excess, excess) <= position.w * position.w)
+            {
+                ++count;
+                clusterLightsSB.data[base + count] = i;
+            }
+        }
+        clusterLightsSB.data[base] = count;
+    }
+)";
+
+std::string const ClusteredLighting::msHLSLBinSource =
+R"(
+    cbuffer ClusterParameters
+    {
+        float4 cameraPosition;
+        float4 cameraDVector;
+        float4 cameraUVector;
+        float4 cameraRVector;
+        float4 frustum;
+        float4 slices;
+        float4 viewport;
+        uint4 dimensions;
+        uint4 counts;
+    };
+
+    struct LightRecord
+    {
+        float4 position;
+        float4 direction;
+        float4 ambient;
+        float4 diffuse;
+        float4 specular;
+        float4 spotCutoff;
+        float4 attenuation;
+    };
+
+    StructuredBuffer<LightRecord> lights;
+    RWStructuredBuffer<uint> clusterLights;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint cluster = t.x;
+        if (cluster >= dimensions.x * dimensions.y * dimensions.z)
+        {
+            return;
+        }
+
+        uint ix = cluster % dimensions.x;
+        uint iy = (cluster / dimensions.x) % dimensions.y;
+        uint iz = cluster / (dimensions.x * dimensions.y);
+        float r0 = lerp(frustum.x, frustum.y, float(ix) / float(dimensions.x));
+        float r1 = lerp(frustum.x, frustum.y, float(ix + 1) / float(dimensions.x));
+        float u0 = lerp(frustum.z, frustum.w, float(iy) / float(dimensions.y));
+        float u1 = lerp(frustum.z, frustum.w, float(iy + 1) / float(dimensions.y));
+        float d0 = slices.x * exp(float(iz) / slices.z);
+        float d1 = slices.x * exp(float(iz + 1) / slices.z);
+        float3 boxMin = float3(min(d0 * r0, d1 * r0), min(d0 * u0, d1 * u0), d0);
+        float3 boxMax = float3(max(d0 * r1, d1 * r1), max(d0 * u1, d1 * u1), d1);
+
+        uint base = cluster * (dimensions.w + 1);
+        uint count = 0;
+        for (uint i = counts.x; i < counts.y && count < dimensions.w; ++i)
+        {
+            float4 position = lights[i].position;
+            float3 diff = position.xyz - cameraPosition.xyz;
+            float3 V = float3(dot(cameraRVector.xyz, diff), dot(cameraUVector.xyz, diff),
+                dot(cameraDVector.xyz, diff));
+            float3 excess = max(boxMin - V, 0.0f) + max(V - boxMax, 0.0f);
+            if (dot(excess, excess) <= position.w * position.w)
+            {
+                ++count;
+                clusterLights[base + count] = i;
+            }
+        }
+        clusterLights[base] = count;
+    }
+)";
+
+ProgramSources const ClusteredLighting::msBinSource =
+{
+    &msGLSLBinSource,
+    &msHLSLBinSource
+};
@@ -0,0 +1,178 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Camera.h>
+#include <Graphics/ComputeProgram.h>
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/GraphicsEngine.h>
+#include <Graphics/Lighting.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/StructuredBuffer.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The lights of a scene for clustered forward shading. The view frustum of
+// the camera is partitioned into numXTiles-by-numYTiles tiles of the
+// viewport and numSlices depth slices, where the depth of slice k is
+// [dmin*(dmax/dmin)^(k/numSlices), dmin*(dmax/dmin)^((k+1)/numSlices)].
+// Update() stores the lights in one structured buffer in world coordinates
+// and runs a compute program that tests the bounding sphere of each point
+// and spot light against the bounding box of each cluster in view
+// coordinates. The lights that touch a cluster are listed in a second
+// structured buffer, so ClusteredLightEffect loops over the lights of the
+// cluster of a pixel rather than over all lights, and the cost of an object
+// does not depend on the number of lights in the scene. Directional lights
+// affect all clusters and are not binned.
+//
+// The light buffer and the cluster buffer are shared by all
+// ClusteredLightEffect objects created with this object, so the lights are
+// updated once per frame for all visuals instead of per visual and per
+// light as for the LightEffect classes. A cluster stores at most
+// maxLightsPerCluster lights; the lights beyond this are ignored for the
+// cluster. The camera must be perspective.
+
+namespace gte
+{
+    class ClusteredLighting
+    {
+    public:
+        enum class LightType
+        {
+            DIRECTIONAL,
+            POINT,
+            SPOT
+        };
+
+        // The position and direction are in world coordinates. The
+        // direction is used by directional and spot lights, the position by
+        // point and spot lights. The spotCutoff of the lighting is used by
+        // spot lights. The attenuation of point and spot lights is that of
+        // PointLightEffect and SpotLightEffect multiplied by a window
+        // function that decreases smoothly to zero at the range, which is
+        // the radius of the bounding sphere of the light. The attenuation of
+        // directional lights is the intensity of the lighting.
+        struct Light
+        {
+            Light()
+                :
+                type(LightType::POINT),
+                lighting(std::make_shared<Lighting>()),
+                position{ 0.0f, 0.0f, 0.0f, 1.0f },
+                direction{ 0.0f, 0.0f, -1.0f, 0.0f },
+                range(1.0f)
+            {
+            }
+
+            LightType type;
+            std::shared_ptr<Lighting> lighting;
+            Vector4<float> position;
+            Vector4<float> direction;
+            float range;
+        };
+
+        // Construction.
+        ClusteredLighting(std::shared_ptr<GraphicsEngine> const& engine,
+            std::shared_ptr<ProgramFactory> const& factory,
+            uint32_t maxLights = 1024, uint32_t numXTiles = 16, uint32_t numYTiles = 9,
+            uint32_t numSlices = 24, uint32_t maxLightsPerCluster = 64);
+
+        // Upload the lights and the camera and viewport parameters and bin
+        // the lights into the clusters. Call this once per frame after the
+        // camera and the lights have moved and before the visuals with a
+        // ClusteredLightEffect are drawn. The lights beyond maxLights are
+        // ignored.
+        void Update(std::shared_ptr<Camera> const& camera, std::vector<Light> const& lights);
+
+        // Member access.
+        inline uint32_t GetMaxLights() const
+        {
+            return mMaxLights;
+        }
+
+        inline uint32_t GetNumClusters() const
+        {
+            return mNumXTiles * mNumYTiles * mNumSlices;
+        }
+
+        inline uint32_t GetMaxLightsPerCluster() const
+        {
+            return mMaxLightsPerCluster;
+        }
+
+        // The resources of the pixel shader of ClusteredLightEffect.
+        inline std::shared_ptr<ConstantBuffer> const& GetParameters() const
+        {
+            return mParameters;
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetLights() const
+        {
+            return mLights;
+        }
+
+        // Cluster c has the lights clusterLights[c * (maxLightsPerCluster + 1) + 1 + i]
+        // for 0 <= i < clusterLights[c * (maxLightsPerCluster + 1)].
+        inline std::shared_ptr<StructuredBuffer> const& GetClusterLights() const
+        {
+            return mClusterLights;
+        }
+
+    private:
+        // The light in world coordinates. The w-component of the position
+        // is the range. Point lights are stored as spot lights whose cone
+        // contains all directions.
+        struct LightRecord
+        {
+            Vector4<float> position;
+            Vector4<float> direction;
+            Vector4<float> ambient;
+            Vector4<float> diffuse;
+            Vector4<float> specular;
+            Vector4<float> spotCutoff;
+            Vector4<float> attenuation;
+        };
+
+        // The camera frame is in world coordinates. The frustum is
+        // (rmin/dmin, rmax/dmin, umin/dmin, umax/dmin), the slices are
+        // (dmin, dmax, numSlices/log(dmax/dmin), 0), the viewport is
+        // (x, y, width, height), the dimensions are (numXTiles, numYTiles,
+        // numSlices, maxLightsPerCluster) and the counts are (number of
+        // directional lights, number of lights, 0, 0). The directional
+        // lights are the first ones of the light buffer.
+        struct Parameters
+        {
+            Vector4<float> cameraPosition;
+            Vector4<float> cameraDVector;
+            Vector4<float> cameraUVector;
+            Vector4<float> cameraRVector;
+            Vector4<float> frustum;
+            Vector4<float> slices;
+            Vector4<float> viewport;
+            uint32_t dimensions[4];
+            uint32_t counts[4];
+        };
+
+        std::shared_ptr<GraphicsEngine> mEngine;
+        uint32_t mMaxLights;
+        uint32_t mNumXTiles, mNumYTiles, mNumSlices;
+        uint32_t mMaxLightsPerCluster;
+        std::shared_ptr<ConstantBuffer> mParameters;
+        std::shared_ptr<StructuredBuffer> mLights;
+        std::shared_ptr<StructuredBuffer> mClusterLights;
+        std::shared_ptr<ComputeProgram> mBinProgram;
+
+        static uint32_t constexpr msNumBinThreads = 64;
+
+        static std::string const msGLSLBinSource;
+        static std::string const msHLSLBinSource;
+        static ProgramSources const msBinSource;
+    };
+}
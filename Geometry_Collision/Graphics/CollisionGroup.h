@@ -7,7 +7,10 @@
 
 #pragma once
 
+#include <Mathematics/BoxManager.h>
 #include <Graphics/CollisionRecord.h>
+#include <algorithm>
+#include <memory>
 
 // Class Mesh must have the following functions in its interface.
 //    size_t GetNumVertices() const;
@@ -30,7 +33,21 @@
 //    bool TestIntersection(Bound const& bound, float tmax,
 //        Vector3<float> const& velocity0,
 //        Vector3<float> const& velocity1) const;
+//    Vector3<float> GetCenter() const;
+//    float GetRadius() const;
 // A wrapper of this type for bounding spheres is Graphics/BoundingSphere.h.
+//
+// The intersection queries have a broadphase that compares only the pairs
+// of records whose world bounds overlap. Each record is enclosed by an
+// axis-aligned box of the center and radius of its world bound, swept by
+// its velocity for the moving-object queries, and the overlapping boxes
+// are found by the sort-and-sweep of BoxManager. The boxes are recomputed
+// at each query, so a record whose mesh has moved needs no notification.
+// The overlap set is updated incrementally by an insertion sort, which is
+// nearly linear in the number of records when they have moved little since
+// the previous query. Inserting or removing a record causes the next query
+// to sort the boxes from scratch. The callbacks of the records must not
+// insert or remove records of the group during a query.
 
 namespace gte
 {
@@ -40,7 +57,9 @@ namespace gte
     public:
         CollisionGroup()
             :
-            mRecords{}
+            mRecords{},
+            mBoxes{},
+            mBoxManager{}
         {
         }
 
@@ -59,6 +78,7 @@ namespace gte
             }
 
             mRecords.push_back(record);
+            mBoxManager = nullptr;
             return true;
         }
 
@@ -69,6 +89,7 @@ namespace gte
                 if (record.get() == mRecords[i].get())
                 {
                     mRecords.erase(mRecords.begin() + i);
+                    mBoxManager = nullptr;
                     return true;
                 }
             }
@@ -77,67 +98,94 @@ namespace gte
         }
 
         // The objects are assumed to be stationary (the velocities are
-        // ignored) and all pairs of objects are compared.
+        // ignored) and the pairs of objects whose world bounds overlap are
+        // compared.
         void TestIntersection()
         {
-            size_t const numRecords = mRecords.size();
-            for (size_t i0 = 0; i0 < numRecords; ++i0)
+            UpdateBroadphase(0.0f);
+            for (auto const& key : mBoxManager->GetOverlap())
             {
-                auto const& record0 = mRecords[i0];
-                for (size_t i1 = i0 + 1; i1 < numRecords; ++i1)
-                {
-                    auto const& record1 = mRecords[i1];
-                    record0->TestIntersection(*record1);
-                }
+                mRecords[key.V[0]]->TestIntersection(*mRecords[key.V[1]]);
             }
         }
 
         void FindIntersection()
         {
-            size_t const numRecords = mRecords.size();
-            for (size_t i0 = 0; i0 < numRecords; ++i0)
+            UpdateBroadphase(0.0f);
+            for (auto const& key : mBoxManager->GetOverlap())
             {
-                auto const& record0 = mRecords[i0];
-                for (size_t i1 = i0 + 1; i1 < numRecords; ++i1)
-                {
-                    auto const& record1 = mRecords[i1];
-                    record0->FindIntersection(*record1);
-                }
+                mRecords[key.V[0]]->FindIntersection(*mRecords[key.V[1]]);
             }
         }
 
-        // The objects are assumed to be moving. Objects are compared when at
-        // least one of them has a velocity vector associated with it. A
-        // velocity vector is allowed to be the zero.
+        // The objects are assumed to be moving. Objects are compared when
+        // their world bounds, swept by their velocities over [0,tMax],
+        // overlap. A velocity vector is allowed to be the zero.
         void TestIntersection(float tMax)
         {
-            size_t const numRecords = mRecords.size();
-            for (size_t i0 = 0; i0 < numRecords; ++i0)
+            UpdateBroadphase(tMax);
+            for (auto const& key : mBoxManager->GetOverlap())
             {
-                auto const& record0 = mRecords[i0];
-                for (size_t i1 = i0 + 1; i1 < numRecords; ++i1)
-                {
-                    auto const& record1 = mRecords[i1];
-                    record0->TestIntersection(tMax, *record1);
-                }
+                mRecords[key.V[0]]->TestIntersection(tMax, *mRecords[key.V[1]]);
             }
         }
 
         void FindIntersection(float tMax)
+        {
+            UpdateBroadphase(tMax);
+            for (auto const& key : mBoxManager->GetOverlap())
+            {
+                mRecords[key.V[0]]->FindIntersection(tMax, *mRecords[key.V[1]]);
+            }
+        }
+
+    private:
+        // Enclose the records in their boxes and update the overlap set.
+        // The overlap set is ordered lexicographically with V[0] < V[1], so
+        // the pairs are compared in the same order as by a double loop over
+        // the records.
+        void UpdateBroadphase(float tMax)
         {
             size_t const numRecords = mRecords.size();
-            for (size_t i0 = 0; i0 < numRecords; ++i0)
+            if (!mBoxManager)
             {
-                auto const& record0 = mRecords[i0];
-                for (size_t i1 = i0 + 1; i1 < numRecords; ++i1)
+                mBoxes.resize(numRecords);
+                for (size_t i = 0; i < numRecords; ++i)
                 {
-                    auto const& record1 = mRecords[i1];
-                    record0->FindIntersection(tMax, *record1);
+                    ComputeBox(*mRecords[i], tMax, mBoxes[i]);
                 }
+                mBoxManager = std::make_unique<BoxManager<float>>(mBoxes);
+            }
+            else
+            {
+                AlignedBox3<float> box{};
+                for (size_t i = 0; i < numRecords; ++i)
+                {
+                    ComputeBox(*mRecords[i], tMax, box);
+                    mBoxManager->SetBox(static_cast<int32_t>(i), box);
+                }
+                mBoxManager->Update();
+            }
+        }
+
+        static void ComputeBox(Record& record, float tMax, AlignedBox3<float>& box)
+        {
+            Bound const& worldBound = record.GetWorldBound();
+            Vector3<float> const center = worldBound.GetCenter();
+            float const radius = worldBound.GetRadius();
+            Vector3<float> const sweep = tMax * record.GetVelocity();
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                box.min[d] = center[d] - radius + std::min(sweep[d], 0.0f);
+                box.max[d] = center[d] + radius + std::max(sweep[d], 0.0f);
             }
         }
 
-    private:
         std::vector<std::shared_ptr<Record>> mRecords;
+
+        // The broadphase. The manager stores a reference to mBoxes and is
+        // destroyed and re-created when records are inserted or removed.
+        std::vector<AlignedBox3<float>> mBoxes;
+        std::unique_ptr<BoxManager<float>> mBoxManager;
     };
 }
@@ -7,6 +7,7 @@
 
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/CollisionMesh.h>
+#include <Graphics/StructuredBuffer.h>
 using namespace gte;
 
 CollisionMesh::CollisionMesh(std::shared_ptr<Visual> const& mesh)
@@ -61,7 +62,12 @@ size_t CollisionMesh::GetNumVertices() const
 
 Vector3<float> CollisionMesh::GetPosition(size_t i) const
 {
-    char const* vertex = mVBuffer->GetData() + i * mVertexSize;
+    // A vertex buffer for vertex-id-based drawing stores its vertices in
+    // its structured buffer; for example, the skinned vertices that
+    // SkinController writes on the GPU and that are read back on demand.
+    auto const& sbuffer = mVBuffer->GetSBuffer();
+    char const* data = (sbuffer ? sbuffer->GetData() : mVBuffer->GetData());
+    char const* vertex = data + i * mVertexSize;
     return *reinterpret_cast<Vector3<float> const*>(vertex);
 }
 
@@ -10,6 +10,8 @@
 #include <Mathematics/IntrTriangle3Triangle3.h>
 #include <Graphics/BoundTree.h>
 #include <functional>
+#include <utility>
+#include <vector>
 
 // Class Mesh must have the following functions in its interface.
 //    size_t GetNumVertices() const;
@@ -71,7 +73,8 @@ namespace gte
             mTree(tree),
             mVelocity(velocity),
             mTICallback(tiCallback),
-            mFICallback(fiCallback)
+            mFICallback(fiCallback),
+            mStack{}
         {
         }
 
@@ -88,6 +91,14 @@ namespace gte
             return mVelocity;
         }
 
+        // The bound of the entire mesh for the current world transform of
+        // the mesh. CollisionGroup uses it for its broadphase.
+        Bound const& GetWorldBound()
+        {
+            mTree->UpdateWorldBound(0);
+            return mTree->GetWorldBound(0);
+        }
+
         inline std::shared_ptr<TICallback> const& GetTICallback() const
         {
             return mTICallback;
@@ -103,362 +114,217 @@ namespace gte
         // the callback function.
         void TestIntersection(CollisionRecord& record)
         {
-            // Convenience variables.
-            auto& tree0 = mTree;
-            auto& tree1 = record.mTree;
-            auto const& mesh0 = tree0->GetMesh();
-            auto const& mesh1 = tree1->GetMesh();
-            auto const& worldBound0 = tree0->GetWorldBound();
-            auto const& worldBound1 = tree1->GetWorldBound();
-
-            tree0->UpdateWorldBound();
-            tree1->UpdateWorldBound();
-
-            if (worldBound0.TestIntersection(worldBound1))
-            {
-                std::shared_ptr<BoundTree<Mesh, Bound>> root{};
-
-                if (tree0->IsInteriorNode())
+            Traverse(record,
+                [](Bound const& worldBound0, Bound const& worldBound1)
                 {
-                    root = mTree;
-
-                    // Compare Tree0.L to Tree1.
-                    mTree = root->GetLChild();
-                    TestIntersection(record);
-
-                    // Compare Tree0.R to Tree1.
-                    mTree = root->GetRChild();
-                    TestIntersection(record);
-
-                    mTree = root;
-                }
-                else if (tree1->IsInteriorNode())
+                    return worldBound0.TestIntersection(worldBound1);
+                },
+                [this, &record](int32_t t0, Triangle3<float> const& tri0,
+                    int32_t t1, Triangle3<float> const& tri1)
                 {
-                    root = record.mTree;
-
-                    // Compare Tree0 to Tree1.L.
-                    record.mTree = root->GetLChild();
-                    TestIntersection(record);
-
-                    // Compare Tree0 to Tree1.R.
-                    record.mTree = root->GetRChild();
-                    TestIntersection(record);
-
-                    record.mTree = root;
-                }
-                else
-                {
-                    // The traversal is at a leaf in each tree.
-                    int32_t numTriangles0 = tree0->GetNumTriangles();
-                    for (int32_t i0 = 0; i0 < numTriangles0; ++i0)
+                    TIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
+                    auto const& result = calc(tri0, tri1);
+                    if (result.intersect)
                     {
-                        // Get the world space triangle.
-                        int32_t t0 = tree0->GetTriangle(i0);
-                        Triangle3<float> tri0{};
-                        mesh0->GetWorldTriangle(t0, tri0);
-
-                        int32_t numTriangles1 = tree1->GetNumTriangles();
-                        for (int32_t i1 = 0; i1 < numTriangles1; ++i1)
+                        if (mTICallback)
                         {
-                            // Get the world space triangle.
-                            int32_t t1 = tree1->GetTriangle(i1);
-                            Triangle3<float> tri1{};
-                            mesh1->GetWorldTriangle(t1, tri1);
-
-                            TIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
-                            auto const& result = calc(tri0, tri1);
-                            if (result.intersect)
-                            {
-                                if (mTICallback)
-                                {
-                                    (*mTICallback)(
-                                        *this, t0, record, t1, 0.0f);
-                                }
+                            (*mTICallback)(
+                                *this, t0, record, t1, 0.0f);
+                        }
 
-                                if (record.mTICallback)
-                                {
-                                    (*record.mTICallback)(
-                                        record, t1, *this, t0, 0.0f);
-                                }
-                            }
+                        if (record.mTICallback)
+                        {
+                            (*record.mTICallback)(
+                                record, t1, *this, t0, 0.0f);
                         }
                     }
-                }
-            }
+                });
         }
 
         void FindIntersection(CollisionRecord& record)
         {
-            // Convenience variables.
-            auto& tree0 = mTree;
-            auto& tree1 = record.mTree;
-            auto const& mesh0 = tree0->GetMesh();
-            auto const& mesh1 = tree1->GetMesh();
-            auto const& worldBound0 = tree0->GetWorldBound();
-            auto const& worldBound1 = tree1->GetWorldBound();
-
-            tree0->UpdateWorldBound();
-            tree1->UpdateWorldBound();
-
-            if (worldBound0.TestIntersection(worldBound1))
-            {
-                std::shared_ptr<BoundTree<Mesh, Bound>> root{};
-
-                if (tree0->IsInteriorNode())
+            Traverse(record,
+                [](Bound const& worldBound0, Bound const& worldBound1)
                 {
-                    root = mTree;
-
-                    // Compare Tree0.L to Tree1.
-                    mTree = root->GetLChild();
-                    FindIntersection(record);
-
-                    // Compare Tree0.R to Tree1.
-                    mTree = root->GetRChild();
-                    FindIntersection(record);
-
-                    mTree = root;
-                }
-                else if (tree1->IsInteriorNode())
+                    return worldBound0.TestIntersection(worldBound1);
+                },
+                [this, &record](int32_t t0, Triangle3<float> const& tri0,
+                    int32_t t1, Triangle3<float> const& tri1)
                 {
-                    root = record.mTree;
-
-                    // Compare Tree0 to Tree1.L.
-                    record.mTree = root->GetLChild();
-                    FindIntersection(record);
-
-                    // Compare Tree0 to Tree1.R.
-                    record.mTree = root->GetRChild();
-                    FindIntersection(record);
-
-                    record.mTree = root;
-                }
-                else
-                {
-                    // The traversal is at a leaf in each tree.
-                    int32_t numTriangles0 = tree0->GetNumTriangles();
-                    for (int32_t i0 = 0; i0 < numTriangles0; ++i0)
+                    FIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
+                    auto const& result = calc(tri0, tri1);
+                    if (result.intersect)
                     {
-                        // Get the world space triangle.
-                        int32_t t0 = tree0->GetTriangle(i0);
-                        Triangle3<float> tri0{};
-                        mesh0->GetWorldTriangle(t0, tri0);
-
-                        int32_t numTriangles1 = tree1->GetNumTriangles();
-                        for (int32_t i1 = 0; i1 < numTriangles1; ++i1)
+                        if (mFICallback)
                         {
-                            // Get the world space triangle.
-                            int32_t t1 = tree1->GetTriangle(i1);
-                            Triangle3<float> tri1{};
-                            mesh1->GetWorldTriangle(t1, tri1);
-
-                            FIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
-                            auto const& result = calc(tri0, tri1);
-                            if (result.intersect)
-                            {
-                                if (mFICallback)
-                                {
-                                    (*mFICallback)(
-                                        *this, t0, record, t1,
-                                        0.0f, result.intersection);
-                                }
+                            (*mFICallback)(
+                                *this, t0, record, t1,
+                                0.0f, result.intersection);
+                        }
 
-                                if (record.mFICallback)
-                                {
-                                    (*record.mFICallback)(
-                                        record, t1, *this, t0,
-                                        0.0f, result.intersection);
-                                }
-                            }
+                        if (record.mFICallback)
+                        {
+                            (*record.mFICallback)(
+                                record, t1, *this, t0,
+                                0.0f, result.intersection);
                         }
                     }
-                }
-            }
+                });
         }
 
         void TestIntersection(float tMax, CollisionRecord& record)
         {
-            // Convenience variables.
-            auto& tree0 = mTree;
-            auto& tree1 = record.mTree;
-            auto const& mesh0 = tree0->GetMesh();
-            auto const& mesh1 = tree1->GetMesh();
-            auto const& worldBound0 = tree0->GetWorldBound();
-            auto const& worldBound1 = tree1->GetWorldBound();
             auto const& velocity0 = mVelocity;
             auto const& velocity1 = record.mVelocity;
 
-            tree0->UpdateWorldBound();
-            tree1->UpdateWorldBound();
-
-            if (worldBound0.TestIntersection(worldBound1, tMax, velocity0, velocity1))
-            {
-                std::shared_ptr<BoundTree<Mesh, Bound>> root{};
-
-                if (tree0->IsInteriorNode())
+            Traverse(record,
+                [tMax, &velocity0, &velocity1](Bound const& worldBound0,
+                    Bound const& worldBound1)
                 {
-                    root = mTree;
-
-                    // Compare Tree0.L to Tree1.
-                    mTree = root->GetLChild();
-                    TestIntersection(tMax, record);
-
-                    // Compare Tree0.R to Tree1.
-                    mTree = root->GetRChild();
-                    TestIntersection(tMax, record);
-
-                    mTree = root;
-                }
-                else if (tree1->IsInteriorNode())
+                    return worldBound0.TestIntersection(worldBound1, tMax,
+                        velocity0, velocity1);
+                },
+                [this, &record, tMax, &velocity0, &velocity1](int32_t t0,
+                    Triangle3<float> const& tri0, int32_t t1,
+                    Triangle3<float> const& tri1)
                 {
-                    root = record.mTree;
-
-                    // Compare Tree0 to Tree1.L.
-                    record.mTree = root->GetLChild();
-                    TestIntersection(tMax, record);
-
-                    // Compare Tree0 to Tree1.R.
-                    record.mTree = root->GetRChild();
-                    TestIntersection(tMax, record);
-
-                    record.mTree = root;
-                }
-                else
-                {
-                    // The traversal is at a leaf in each tree.
-                    int32_t numTriangles0 = tree0->GetNumTriangles();
-                    for (int32_t i0 = 0; i0 < numTriangles0; ++i0)
+                    TIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
+                    auto const& result = calc(tMax, tri0, velocity0, tri1, velocity1);
+                    if (result.intersect)
                     {
-                        // Get the world space triangle.
-                        int32_t t0 = tree0->GetTriangle(i0);
-                        Triangle3<float> tri0{};
-                        mesh0->GetWorldTriangle(t0, tri0);
-
-                        int32_t numTriangles1 = tree1->GetNumTriangles();
-                        for (int32_t i1 = 0; i1 < numTriangles1; ++i1)
+                        if (mTICallback)
                         {
-                            // Get the world space triangle.
-                            int32_t t1 = tree1->GetTriangle(i1);
-                            Triangle3<float> tri1{};
-                            mesh1->GetWorldTriangle(t1, tri1);
-
-                            TIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
-                            auto const& result = calc(tMax, tri0, velocity0, tri1, velocity1);
-                            if (result.intersect)
-                            {
-                                if (mTICallback)
-                                {
-                                    (*mTICallback)(
-                                        *this, t0, record, t1,
-                                        result.contactTime);
-                                }
+                            (*mTICallback)(
+                                *this, t0, record, t1,
+                                result.contactTime);
+                        }
 
-                                if (record.mTICallback)
-                                {
-                                    (*record.mTICallback)(
-                                        record, t1, *this, t0,
-                                        result.contactTime);
-                                }
-                            }
+                        if (record.mTICallback)
+                        {
+                            (*record.mTICallback)(
+                                record, t1, *this, t0,
+                                result.contactTime);
                         }
                     }
-                }
-            }
+                });
         }
 
         void FindIntersection(float tMax, CollisionRecord& record)
         {
-            // Convenience variables.
-            auto& tree0 = mTree;
-            auto& tree1 = record.mTree;
-            auto const& mesh0 = tree0->GetMesh();
-            auto const& mesh1 = tree1->GetMesh();
-            auto const& worldBound0 = tree0->GetWorldBound();
-            auto const& worldBound1 = tree1->GetWorldBound();
             auto const& velocity0 = mVelocity;
             auto const& velocity1 = record.mVelocity;
 
-            tree0->UpdateWorldBound();
-            tree1->UpdateWorldBound();
+            Traverse(record,
+                [tMax, &velocity0, &velocity1](Bound const& worldBound0,
+                    Bound const& worldBound1)
+                {
+                    return worldBound0.TestIntersection(worldBound1, tMax,
+                        velocity0, velocity1);
+                },
+                [this, &record, tMax, &velocity0, &velocity1](int32_t t0,
+                    Triangle3<float> const& tri0, int32_t t1,
+                    Triangle3<float> const& tri1)
+                {
+                    FIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
+                    auto const& result = calc(tMax, tri0, velocity0, tri1, velocity1);
+                    if (result.intersect)
+                    {
+                        if (mFICallback)
+                        {
+                            (*mFICallback)(
+                                *this, t0, record, t1,
+                                result.contactTime, result.intersection);
+                        }
 
-            if (worldBound0.TestIntersection(worldBound1, tMax, velocity0, velocity1))
+                        if (record.mFICallback)
+                        {
+                            (*record.mFICallback)(
+                                record, t1, *this, t0,
+                                result.contactTime, result.intersection);
+                        }
+                    }
+                });
+        }
+
+    private:
+        // Traverse the pairs of nodes of the two trees whose world bounds
+        // pass boundTest and call triangleTest for the pairs of triangles
+        // of the leaf pairs. The pairs of nodes are kept on an explicit
+        // stack instead of the call stack. The right children are pushed
+        // before the left children, so the callbacks are called in the
+        // same order as by a recursive traversal that visits the left
+        // child first. The stack is a member to avoid an allocation per
+        // query, so a callback must not start a query on this record.
+        template <typename BoundTest, typename TriangleTest>
+        void Traverse(CollisionRecord& record, BoundTest const& boundTest,
+            TriangleTest const& triangleTest)
+        {
+            // Convenience variables.
+            auto& tree0 = *mTree;
+            auto& tree1 = *record.mTree;
+            auto const& mesh0 = tree0.GetMesh();
+            auto const& mesh1 = tree1.GetMesh();
+
+            mStack.clear();
+            mStack.emplace_back(0, 0);
+            while (mStack.size() > 0)
             {
-                std::shared_ptr<BoundTree<Mesh, Bound>> root{};
+                size_t n0 = mStack.back().first;
+                size_t n1 = mStack.back().second;
+                mStack.pop_back();
 
-                if (tree0->IsInteriorNode())
+                tree0.UpdateWorldBound(n0);
+                tree1.UpdateWorldBound(n1);
+                if (!boundTest(tree0.GetWorldBound(n0), tree1.GetWorldBound(n1)))
                 {
-                    root = mTree;
-
-                    // Compare Tree0.L to Tree1.
-                    mTree = root->GetLChild();
-                    FindIntersection(tMax, record);
-
-                    // Compare Tree0.R to Tree1.
-                    mTree = root->GetRChild();
-                    FindIntersection(tMax, record);
+                    continue;
+                }
 
-                    mTree = root;
+                if (tree0.IsInteriorNode(n0))
+                {
+                    // Compare Tree0.L to Tree1, then Tree0.R to Tree1.
+                    mStack.emplace_back(tree0.GetRChild(n0), n1);
+                    mStack.emplace_back(tree0.GetLChild(n0), n1);
                 }
-                else if (tree1->IsInteriorNode())
+                else if (tree1.IsInteriorNode(n1))
                 {
-                    root = record.mTree;
-
-                    // Compare Tree0 to Tree1.L.
-                    record.mTree = root->GetLChild();
-                    FindIntersection(tMax, record);
-
-                    // compare Tree0 to Tree1.R
-                    record.mTree = root->GetRChild();
-                    FindIntersection(tMax, record);
-
-                    record.mTree = root;
+                    // Compare Tree0 to Tree1.L, then Tree0 to Tree1.R.
+                    mStack.emplace_back(n0, tree1.GetRChild(n1));
+                    mStack.emplace_back(n0, tree1.GetLChild(n1));
                 }
                 else
                 {
                     // The traversal is at a leaf in each tree.
-                    int32_t numTriangles0 = tree0->GetNumTriangles();
+                    int32_t numTriangles0 = tree0.GetNumTriangles(n0);
                     for (int32_t i0 = 0; i0 < numTriangles0; ++i0)
                     {
                         // Get the world space triangle.
-                        int32_t t0 = tree0->GetTriangle(i0);
+                        int32_t t0 = tree0.GetTriangle(n0, i0);
                         Triangle3<float> tri0{};
                         mesh0->GetWorldTriangle(t0, tri0);
 
-                        int32_t numTriangles1 = tree1->GetNumTriangles();
+                        int32_t numTriangles1 = tree1.GetNumTriangles(n1);
                         for (int32_t i1 = 0; i1 < numTriangles1; ++i1)
                         {
                             // Get the world space triangle.
-                            int32_t t1 = tree1->GetTriangle(i1);
+                            int32_t t1 = tree1.GetTriangle(n1, i1);
                             Triangle3<float> tri1{};
                             mesh1->GetWorldTriangle(t1, tri1);
 
-                            FIQuery<float, Triangle3<float>, Triangle3<float>> calc{};
-                            auto const& result = calc(tMax, tri0, velocity0, tri1, velocity1);
-                            if (result.intersect)
-                            {
-                                if (mFICallback)
-                                {
-                                    (*mFICallback)(
-                                        *this, t0, record, t1,
-                                        result.contactTime, result.intersection);
-                                }
-
-                                if (record.mFICallback)
-                                {
-                                    (*record.mFICallback)(
-                                        record, t1, *this, t0,
-                                        result.contactTime, result.intersection);
-                                }
-                            }
+                            triangleTest(t0, tri0, t1, tri1);
                         }
                     }
                 }
             }
         }
 
-    private:
         std::shared_ptr<BoundTree<Mesh, Bound>> mTree;
         Vector3<float> mVelocity;
         std::shared_ptr<TICallback> mTICallback;
         std::shared_ptr<FICallback> mFICallback;
+
+        // The pairs of node indices (tree0 node, tree1 node) still to be
+        // visited by Traverse.
+        std::vector<std::pair<size_t, size_t>> mStack;
     };
 }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include "Shader.h"
+#include <functional>
 
 namespace Vector_GM
 {
@@ -37,4 +38,10 @@ namespace Vector_GM
     private:
         std::shared_ptr<Shader> mCShader;
     };
+
+    // Run a compute program with the specified numbers of thread groups,
+    // typically by calling GraphicsEngine::Execute.  Controllers that update
+    // their objects on the GPU use this to stay independent of the engine.
+    typedef std::function<void(std::shared_ptr<ComputeProgram> const&,
+        uint32_t, uint32_t, uint32_t)> ProgramExecutor;
 }
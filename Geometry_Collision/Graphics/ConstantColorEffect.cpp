@@ -11,6 +11,8 @@ using namespace gte;
 
 ConstantColorEffect::ConstantColorEffect(std::shared_ptr<ProgramFactory> const& factory,
     Vector4<float> const& color)
+    :
+    mPVWIndex(0)
 {
     int32_t api = factory->GetAPI();
     mProgram = factory->CreateFromSources(*msVSSource[api], *msPSSource[api], "");
@@ -24,10 +26,43 @@ ConstantColorEffect::ConstantColorEffect(std::shared_ptr<ProgramFactory> const&
     }
 }
 
+ConstantColorEffect::ConstantColorEffect(std::shared_ptr<ProgramFactory> const& factory,
+    Vector4<float> const& color, std::shared_ptr<StructuredBuffer> const& pvwBuffer,
+    uint32_t index)
+    :
+    mPVWBuffer(pvwBuffer),
+    mPVWIndex(index)
+{
+    LogAssert(pvwBuffer != nullptr &&
+        pvwBuffer->GetElementSize() == sizeof(Matrix4x4<float>) &&
+        index < pvwBuffer->GetNumElements(),
+        "Invalid PVW buffer or index.");
+
+    int32_t api = factory->GetAPI();
+    mProgram = factory->CreateFromSources(*msBatchedVSSource[api], *msPSSource[api], "");
+    if (mProgram)
+    {
+        mColorConstant = std::make_shared<ConstantBuffer>(sizeof(Vector4<float>), true);
+        *mColorConstant->Get<Vector4<float>>() = color;
+
+        // The index does not change, so the constant buffer is copied to
+        // GPU memory only once.
+        mPVWIndexConstant = std::make_shared<ConstantBuffer>(sizeof(uint32_t), false);
+        *mPVWIndexConstant->Get<uint32_t>() = index;
+
+        mProgram->GetVertexShader()->Set("pvwMatrices", mPVWBuffer);
+        mProgram->GetVertexShader()->Set("PVWIndex", mPVWIndexConstant);
+        mProgram->GetVertexShader()->Set("ConstantColor", mColorConstant);
+    }
+}
+
 void ConstantColorEffect::SetPVWMatrixConstant(std::shared_ptr<ConstantBuffer> const& buffer)
 {
     VisualEffect::SetPVWMatrixConstant(buffer);
-    mProgram->GetVertexShader()->Set("PVWMatrix", mPVWMatrixConstant);
+    if (!mPVWBuffer)
+    {
+        mProgram->GetVertexShader()->Set("PVWMatrix", mPVWMatrixConstant);
+    }
 }
 
 
@@ -124,6 +159,77 @@ R"(
     }
 )";
 
+std::string const ConstantColorEffect::msGLSLBatchedVSSource =
+R"(
+    buffer pvwMatrices
+    {
+        mat4 data[];
+    } pvwMatricesSB;
+
+    uniform PVWIndex
+    {
+        uint pvwIndex;
+    };
+
+    uniform ConstantColor
+    {
+        vec4 constantColor;
+    };
+
+    layout(location = 0) in vec3 modelPosition;
+    layout(location = 0) out vec4 vertexColor;
+
+    void main()
+    {
+        mat4 pvwMatrix = pvwMatricesSB.data[pvwIndex];
+    #if GTE_USE_MAT_VEC
+        gl_Position = pvwMatrix * vec4(modelPosition, 1.0f);
+    #else
+        gl_Position = vec4(modelPosition, 1.0f) * pvwMatrix;
+    #endif
+        vertexColor = constantColor;
+    }
+)";
+
+std::string const ConstantColorEffect::msHLSLBatchedVSSource =
+R"(
+    StructuredBuffer<float4x4> pvwMatrices;
+
+    cbuffer PVWIndex
+    {
+        uint pvwIndex;
+    };
+
+    cbuffer ConstantColor
+    {
+        float4 constantColor;
+    };
+
+    struct VS_INPUT
+    {
+        float3 modelPosition : POSITION;
+    };
+
+    struct VS_OUTPUT
+    {
+        float4 vertexColor : COLOR0;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    VS_OUTPUT VSMain(VS_INPUT input)
+    {
+        VS_OUTPUT output;
+        float4x4 pvwMatrix = pvwMatrices[pvwIndex];
+    #if GTE_USE_MAT_VEC
+        output.clipPosition = mul(pvwMatrix, float4(input.modelPosition, 1.0f));
+    #else
+        output.clipPosition = mul(float4(input.modelPosition, 1.0f), pvwMatrix);
+    #endif
+        output.vertexColor = constantColor;
+        return output;
+    }
+)";
+
 ProgramSources const ConstantColorEffect::msVSSource =
 {
     &msGLSLVSSource,
@@ -135,3 +241,9 @@ ProgramSources const ConstantColorEffect::msPSSource =
     &msGLSLPSSource,
     &msHLSLPSSource
 };
+
+ProgramSources const ConstantColorEffect::msBatchedVSSource =
+{
+    &msGLSLBatchedVSSource,
+    &msHLSLBatchedVSSource
+};
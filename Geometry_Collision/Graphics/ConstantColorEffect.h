@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "StructuredBuffer.h"
 #include "VisualEffect.h"
 
 namespace Vector_GM
@@ -12,6 +13,14 @@ namespace Vector_GM
         // Construction.
         ConstantColorEffect(std::shared_ptr<ProgramFactory> const& factory, Vector4<float> const& color);
 
+        // Construction for batched PVW matrices. The vertex shader reads
+        // its PVW matrix from element 'index' of 'pvwBuffer' instead of
+        // from the PVWMatrix constant buffer. Many effects share the buffer,
+        // which PVWUpdater::Subscribe(worldMatrix, pvwBuffer, index) keeps
+        // current with one copy to GPU memory for all of them.
+        ConstantColorEffect(std::shared_ptr<ProgramFactory> const& factory, Vector4<float> const& color,
+            std::shared_ptr<StructuredBuffer> const& pvwBuffer, uint32_t index);
+
         // Member access.
         virtual void SetPVWMatrixConstant(std::shared_ptr<ConstantBuffer> const& pvwMatrix) override;
 
@@ -20,16 +29,36 @@ namespace Vector_GM
             return mColorConstant;
         }
 
+        // The buffer is null when the effect uses the PVWMatrix constant
+        // buffer.
+        inline std::shared_ptr<StructuredBuffer> const& GetPVWBuffer() const
+        {
+            return mPVWBuffer;
+        }
+
+        inline uint32_t GetPVWIndex() const
+        {
+            return mPVWIndex;
+        }
+
     private:
         // Vertex shader parameter.
         std::shared_ptr<ConstantBuffer> mColorConstant;
 
+        // Vertex shader parameters for batched PVW matrices.
+        std::shared_ptr<StructuredBuffer> mPVWBuffer;
+        std::shared_ptr<ConstantBuffer> mPVWIndexConstant;
+        uint32_t mPVWIndex;
+
         // Shader source code as strings.
         static std::string const msGLSLVSSource;
         static std::string const msGLSLPSSource;
         static std::string const msHLSLVSSource;
         static std::string const msHLSLPSSource;
+        static std::string const msGLSLBatchedVSSource;
+        static std::string const msHLSLBatchedVSSource;
         static ProgramSources const msVSSource;
         static ProgramSources const msPSSource;
+        static ProgramSources const msBatchedVSSource;
     };
 }
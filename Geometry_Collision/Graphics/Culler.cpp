@@ -8,8 +8,20 @@
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/Culler.h>
 #include <Graphics/Camera.h>
-#include <Graphics/Spatial.h>
+#include <Graphics/Node.h>
 #include <Mathematics/Logger.h>
+#include <Mathematics/Trace.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <typeinfo>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GTE_CULLER_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GTE_CULLER_NEON
+#include <arm_neon.h>
+#endif
 using namespace gte;
 
 Culler::~Culler()
@@ -21,7 +33,12 @@ Culler::Culler()
     mPlaneQuantity(6),
     mPlane{},
     mPlaneState(0),
-    mVisibleSet{}
+    mNormalX{},
+    mNormalY{},
+    mNormalZ{},
+    mConstant{},
+    mVisibleSet{},
+    mParallel(false)
 {
     // The data members mFrustum, mPlane, and mPlaneState are
     // uninitialized.  They are initialized in the GetVisibleSet call.
@@ -34,6 +51,7 @@ bool Culler::PushPlane(CullingPlane<float> const& plane)
     {
         // The number of user-defined planes is limited.
         mPlane[mPlaneQuantity] = plane;
+        StorePlane(mPlaneQuantity);
         ++mPlaneQuantity;
         return true;
     }
@@ -54,48 +72,101 @@ bool Culler::PopPlane()
 void Culler::ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
     std::shared_ptr<Spatial> const& scene)
 {
+    GTE_TRACE_SCOPE("Culler::ComputeVisibleSet");
     LogAssert(scene != nullptr, "A scene is required for culling.");
     PushViewFrustumPlanes(camera);
     mVisibleSet.clear();
+
+    if (mParallel && typeid(*scene) == typeid(Node))
+    {
+        Node& node = static_cast<Node&>(*scene);
+        if (node.GetNumChildren() >= MIN_PARALLEL_CHILDREN)
+        {
+            TraverseInParallel(camera, node);
+            return;
+        }
+    }
+
     scene->OnGetVisibleSet(*this, camera, false);
 }
 
 bool Culler::IsVisible(BoundingSphere<float> const& sphere)
 {
-    if (sphere.GetRadius() == 0.0f)
+    float const radius = sphere.GetRadius();
+    if (radius == 0.0f)
     {
         // The node is a dummy node and cannot be visible.
         return false;
     }
 
-    // Start with the last pushed plane, which is potentially the most
-    // restrictive plane.
-    int32_t index = mPlaneQuantity - 1;
-    uint32_t mask = (1u << index);
-
-    for (int32_t i = 0; i < mPlaneQuantity; ++i, --index, mask >>= 1)
+    // Compute the signed distances from the center to all planes, 4 at a
+    // time, and record in bit masks the planes whose negative side contains
+    // the sphere and the planes whose positive side contains it.  The
+    // distances are computed in the order of CullingPlane::DistanceTo, so
+    // the results are those of BoundingSphere::WhichSide.  The unused
+    // entries of the plane arrays are zero and are masked out below.
+    Vector3<float> const center = sphere.GetCenter();
+    uint32_t negative = 0, positive = 0;
+#if defined(GTE_CULLER_SSE)
+    __m128 const cx = _mm_set1_ps(center[0]);
+    __m128 const cy = _mm_set1_ps(center[1]);
+    __m128 const cz = _mm_set1_ps(center[2]);
+    __m128 const r = _mm_set1_ps(radius);
+    __m128 const negR = _mm_set1_ps(-radius);
+    for (int32_t i = 0; i < mPlaneQuantity; i += 4)
+    {
+        __m128 d = _mm_mul_ps(_mm_loadu_ps(&mNormalX[i]), cx);
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(&mNormalY[i]), cy));
+        d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(&mNormalZ[i]), cz));
+        d = _mm_add_ps(d, _mm_loadu_ps(&mConstant[i]));
+        negative |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(d, negR))) << i;
+        positive |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmpge_ps(d, r))) << i;
+    }
+#elif defined(GTE_CULLER_NEON)
+    float32x4_t const r = vdupq_n_f32(radius);
+    float32x4_t const negR = vdupq_n_f32(-radius);
+    uint32x4_t const bits = { 1u, 2u, 4u, 8u };
+    for (int32_t i = 0; i < mPlaneQuantity; i += 4)
     {
-        if (mPlaneState & mask)
+        float32x4_t d = vmulq_n_f32(vld1q_f32(&mNormalX[i]), center[0]);
+        d = vaddq_f32(d, vmulq_n_f32(vld1q_f32(&mNormalY[i]), center[1]));
+        d = vaddq_f32(d, vmulq_n_f32(vld1q_f32(&mNormalZ[i]), center[2]));
+        d = vaddq_f32(d, vld1q_f32(&mConstant[i]));
+        negative |= vaddvq_u32(vandq_u32(vcleq_f32(d, negR), bits)) << i;
+        positive |= vaddvq_u32(vandq_u32(vcgeq_f32(d, r), bits)) << i;
+    }
+#else
+    for (int32_t i = 0; i < mPlaneQuantity; ++i)
+    {
+        float d = mNormalX[i] * center[0];
+        d += mNormalY[i] * center[1];
+        d += mNormalZ[i] * center[2];
+        d += mConstant[i];
+        if (d <= -radius)
+        {
+            negative |= (1u << i);
+        }
+        else if (d >= radius)
         {
-            int32_t side = sphere.WhichSide(mPlane[index]);
+            positive |= (1u << i);
+        }
+    }
+#endif
 
-            if (side < 0)
-            {
-                // The object is on the negative side of the plane, so
-                // cull it.
-                return false;
-            }
+    uint32_t const numPlanesMask = (mPlaneQuantity < 32 ?
+        (1u << mPlaneQuantity) - 1u : 0xFFFFFFFFu);
+    uint32_t const active = mPlaneState & numPlanesMask;
 
-            if (side > 0)
-            {
-                // The object is on the positive side of plane.  There is
-                // no need to compare subobjects against this plane, so
-                // mark it as inactive.
-                mPlaneState &= ~mask;
-            }
-        }
+    if (negative & active)
+    {
+        // The object is on the negative side of an active plane, so cull
+        // it.
+        return false;
     }
 
+    // The object is on the positive side of these planes.  There is no
+    // need to compare subobjects against them, so mark them as inactive.
+    mPlaneState &= ~(positive & active);
     return true;
 }
 
@@ -104,7 +175,8 @@ void Culler::Insert(Visual* visible)
     mVisibleSet.push_back(visible);
 }
 
-void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
+void Culler::GetViewFrustumPlanes(std::shared_ptr<Camera> const& camera,
+    std::array<CullingPlane<float>, Camera::VF_QUANTITY>& planes)
 {
     // Get the frustum values.
     float dMax = camera->GetDMax();
@@ -127,11 +199,11 @@ void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
 
     // Compute the near plane, N = D.
     c = -(dirDotEye + dMin);
-    mPlane[Camera::VF_DMIN].Set(D, c);
+    planes[Camera::VF_DMIN].Set(D, c);
 
     // Compute the far plane, N = -D.
     c = dirDotEye + dMax;
-    mPlane[Camera::VF_DMAX].Set(-D, c);
+    planes[Camera::VF_DMAX].Set(-D, c);
 
     // Compute the bottom plane
     invLength = 1.0f / std::sqrt(dMin2 + uMin2);
@@ -139,7 +211,7 @@ void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
     a1 = +dMin*invLength;  // U component
     N = a0*D + a1*U;
     c = -Dot(N, P);
-    mPlane[Camera::VF_UMIN].Set(N, c);
+    planes[Camera::VF_UMIN].Set(N, c);
 
     // Compute the top plane.
     invLength = 1.0f / std::sqrt(dMin2 + uMax2);
@@ -147,7 +219,7 @@ void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
     a1 = -dMin*invLength;  // U component
     N = a0*D + a1*U;
     c = -Dot(N, P);
-    mPlane[Camera::VF_UMAX].Set(N, c);
+    planes[Camera::VF_UMAX].Set(N, c);
 
     // Compute the left plane.
     invLength = 1.0f / std::sqrt(dMin2 + rMin2);
@@ -155,7 +227,7 @@ void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
     a1 = +dMin*invLength;  // R component
     N = a0*D + a1*R;
     c = -Dot(N, P);
-    mPlane[Camera::VF_RMIN].Set(N, c);
+    planes[Camera::VF_RMIN].Set(N, c);
 
     // Compute the right plane.
     invLength = 1.0f / std::sqrt(dMin2 + rMax2);
@@ -163,8 +235,84 @@ void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
     a1 = -dMin*invLength;  // R component
     N = a0*D + a1*R;
     c = -Dot(N, P);
-    mPlane[Camera::VF_RMAX].Set(N, c);
+    planes[Camera::VF_RMAX].Set(N, c);
+}
+
+void Culler::PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera)
+{
+    std::array<CullingPlane<float>, Camera::VF_QUANTITY> planes;
+    GetViewFrustumPlanes(camera, planes);
+    for (int32_t i = 0; i < Camera::VF_QUANTITY; ++i)
+    {
+        mPlane[i] = planes[i];
+        StorePlane(i);
+    }
 
     // All planes are active initially.
     mPlaneState = 0xFFFFFFFFu;
 }
+
+void Culler::StorePlane(int32_t i)
+{
+    Vector4<float> normal = mPlane[i].GetNormal();
+    mNormalX[i] = normal[0];
+    mNormalY[i] = normal[1];
+    mNormalZ[i] = normal[2];
+    mConstant[i] = mPlane[i].GetConstant();
+}
+
+void Culler::TraverseInParallel(std::shared_ptr<Camera> const& camera, Node& scene)
+{
+    // This is Spatial::OnGetVisibleSet for the root.
+    if (scene.culling == CullingMode::ALWAYS)
+    {
+        return;
+    }
+
+    bool const noCull = (scene.culling == CullingMode::NEVER);
+    uint32_t const savePlaneState = mPlaneState;
+    if (noCull || IsVisible(scene.worldBound))
+    {
+        // Node::GetVisibleSet for the root.  The children are partitioned
+        // into contiguous ranges, a few per thread for load balancing.  The
+        // task cullers are copies of the base-class part of this culler, so
+        // they have its planes and plane state.
+        std::vector<Spatial*> children;
+        int32_t const numChildren = scene.GetNumChildren();
+        children.reserve(static_cast<size_t>(numChildren));
+        for (int32_t i = 0; i < numChildren; ++i)
+        {
+            Spatial* child = scene.GetChild(i).get();
+            if (child)
+            {
+                children.push_back(child);
+            }
+        }
+
+        TaskScheduler& scheduler = TaskScheduler::GetDefault();
+        size_t const numTasks = std::min(children.size(),
+            4 * (scheduler.GetNumWorkers() + 1));
+        std::vector<Culler> cullers(numTasks, static_cast<Culler const&>(*this));
+        scheduler.ParallelFor(numTasks, [&](size_t t)
+        {
+            Culler& culler = cullers[t];
+            culler.mVisibleSet.clear();
+            culler.mParallel = false;
+            size_t const imin = t * children.size() / numTasks;
+            size_t const imax = (t + 1) * children.size() / numTasks;
+            for (size_t i = imin; i < imax; ++i)
+            {
+                children[i]->OnGetVisibleSet(culler, camera, noCull);
+            }
+        });
+
+        for (auto const& culler : cullers)
+        {
+            for (auto const& visual : culler.mVisibleSet)
+            {
+                Insert(visual);
+            }
+        }
+    }
+    mPlaneState = savePlaneState;
+}
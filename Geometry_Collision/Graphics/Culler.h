@@ -9,6 +9,7 @@
 
 #include "BoundingSphere.h"
 #include "Camera.h"
+#include <array>
 #include <memory>
 #include <vector>
 
@@ -23,6 +24,7 @@
 
 namespace gte
 {
+    class Node;
     class Spatial;
     class Visual;
 
@@ -69,12 +71,38 @@ namespace gte
         void ComputeVisibleSet(std::shared_ptr<Camera> const& camera,
             std::shared_ptr<Spatial> const& scene);
 
+        // When parallel traversal is enabled and the scene is a Node (not a
+        // derived class such as SwitchNode) with at least
+        // minParallelChildren children, the subtrees of the children are
+        // traversed by the tasks of TaskScheduler::GetDefault().  Each task
+        // collects its own visible set, and the sets are passed to Insert
+        // in the order of the children, so the potentially visible set is
+        // the same as that of the serial traversal.  The GetVisibleSet
+        // overrides of the subtrees must then be safe to call concurrently,
+        // which they are for the scene graph classes of this library.
+        enum { MIN_PARALLEL_CHILDREN = 16 };
+
+        inline void SetParallelTraversal(bool parallel)
+        {
+            mParallel = parallel;
+        }
+
+        inline bool GetParallelTraversal() const
+        {
+            return mParallel;
+        }
+
         // Access to the camera and potentially visible set.
         inline VisibleSet& GetVisibleSet()
         {
             return mVisibleSet;
         }
 
+        // The world planes of the camera's view frustum, indexed by the
+        // Camera::VF_* values.  The normals point into the frustum.
+        static void GetViewFrustumPlanes(std::shared_ptr<Camera> const& camera,
+            std::array<CullingPlane<float>, Camera::VF_QUANTITY>& planes);
+
     protected:
         enum { INITIALLY_VISIBLE = 128 };
 
@@ -110,6 +138,12 @@ namespace gte
 
         void PushViewFrustumPlanes(std::shared_ptr<Camera> const& camera);
 
+        // Copy plane i to the structure-of-arrays storage used by IsVisible.
+        void StorePlane(int32_t i);
+
+        // The parallel counterpart of scene->OnGetVisibleSet(...).
+        void TraverseInParallel(std::shared_ptr<Camera> const& camera, Node& scene);
+
         // The world culling planes corresponding to the view frustum plus any
         // additional user-defined culling planes.  The member mPlaneState
         // represents bit flags to store whether or not a plane is active in
@@ -124,7 +158,13 @@ namespace gte
         std::array<CullingPlane<float>, MAX_PLANE_QUANTITY> mPlane;
         uint32_t mPlaneState;
 
+        // The plane normals and constants in structure-of-arrays form, so
+        // that IsVisible compares a sphere with 4 planes at a time.
+        std::array<float, MAX_PLANE_QUANTITY> mNormalX, mNormalY, mNormalZ, mConstant;
+
         // The potentially visible set generated by ComputeVisibleSet(scene).
         VisibleSet mVisibleSet;
+
+        bool mParallel;
     };
 }
@@ -0,0 +1,228 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/DLODBatch.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cmath>
+#include <thread>
+using namespace gte;
+
+namespace
+{
+    // A thread is started only for this many nodes or more, because the
+    // selection for a node is much cheaper than starting a thread.
+    size_t constexpr minPerThread = 1024;
+}
+
+DLODBatch::DLODBatch(uint32_t numThreads)
+    :
+    mNumThreads(numThreads > 1 ? numThreads : 1),
+    mFirstLevel(1, 0)
+{
+}
+
+DLODBatch::~DLODBatch()
+{
+    Clear();
+}
+
+void DLODBatch::Add(std::shared_ptr<DLODNode> const& node)
+{
+    LogAssert(node != nullptr, "Invalid node.");
+
+    // The requirements of DLODNode::SelectLevelOfDetail.
+    LogAssert(
+        node->mChild.size() == static_cast<size_t>(node->mNumLevelsOfDetail),
+        "Invalid DLODNode detected by DLODBatch::Add.");
+
+    for (auto const& child : node->mChild)
+    {
+        LogAssert(
+            child != nullptr,
+            "Invalid DLODNode child detected by DLODBatch::Add.");
+    }
+
+    // A node that is already in the batch has its data copied again. Its
+    // number of levels is constant, so its level range does not move.
+    size_t i = std::find(mNodes.begin(), mNodes.end(), node) - mNodes.begin();
+    if (i == mNodes.size())
+    {
+        mNodes.push_back(node);
+        for (size_t j = 0; j < 3; ++j)
+        {
+            mModelCenter[j].push_back(0.0f);
+            mWorldCenter[j].push_back(0.0f);
+        }
+        mScreenError.push_back(0);
+        mMaxScreenError.push_back(0.0f);
+        mScale.push_back(1.0f);
+        mDistance.push_back(0.0f);
+
+        size_t const numLevels = static_cast<size_t>(node->mNumLevelsOfDetail);
+        mFirstLevel.push_back(mFirstLevel.back() + numLevels);
+        mModelMinDistance.resize(mFirstLevel.back());
+        mModelMaxDistance.resize(mFirstLevel.back());
+        mModelGeometricError.resize(mFirstLevel.back());
+        node->mBatched = true;
+    }
+
+    for (size_t j = 0; j < 3; ++j)
+    {
+        mModelCenter[j][i] = node->mModelLODCenter[static_cast<int32_t>(j)];
+    }
+    mScreenError[i] = (node->mMetric == DLODNode::Metric::SCREEN_ERROR ? 1 : 0);
+    mMaxScreenError[i] = node->mMaxScreenError;
+    std::copy(node->mModelMinDistance.begin(), node->mModelMinDistance.end(),
+        mModelMinDistance.begin() + mFirstLevel[i]);
+    std::copy(node->mModelMaxDistance.begin(), node->mModelMaxDistance.end(),
+        mModelMaxDistance.begin() + mFirstLevel[i]);
+    std::copy(node->mModelGeometricError.begin(), node->mModelGeometricError.end(),
+        mModelGeometricError.begin() + mFirstLevel[i]);
+}
+
+void DLODBatch::Clear()
+{
+    for (auto const& node : mNodes)
+    {
+        node->mBatched = false;
+    }
+    mNodes.clear();
+
+    for (size_t j = 0; j < 3; ++j)
+    {
+        mModelCenter[j].clear();
+        mWorldCenter[j].clear();
+    }
+    mScreenError.clear();
+    mMaxScreenError.clear();
+    mFirstLevel.assign(1, 0);
+    mModelMinDistance.clear();
+    mModelMaxDistance.clear();
+    mModelGeometricError.clear();
+    mScale.clear();
+    mDistance.clear();
+}
+
+void DLODBatch::Select(std::shared_ptr<Camera> const& camera)
+{
+    LogAssert(camera != nullptr, "Invalid camera.");
+
+    Vector4<float> const cameraPosition = camera->GetPosition();
+    float const frustumHeight = (camera->GetUMax() - camera->GetUMin()) / camera->GetDMin();
+    ForEachChunk(mNodes.size(), [this, &cameraPosition, frustumHeight](size_t imin, size_t imax)
+    {
+        GatherCenters(imin, imax);
+        ComputeDistances(imin, imax, cameraPosition);
+        SelectChildren(imin, imax, frustumHeight);
+    });
+}
+
+void DLODBatch::GatherCenters(size_t imin, size_t imax)
+{
+    for (size_t i = imin; i < imax; ++i)
+    {
+        DLODNode& node = *mNodes[i];
+        Transform<float> const& worldTransform = node.worldTransform;
+        Vector4<float> modelCenter{ mModelCenter[0][i], mModelCenter[1][i], mModelCenter[2][i], 1.0f };
+        node.mWorldLODCenter = DoTransform(worldTransform.GetHMatrix(), modelCenter);
+        mWorldCenter[0][i] = node.mWorldLODCenter[0];
+        mWorldCenter[1][i] = node.mWorldLODCenter[1];
+        mWorldCenter[2][i] = node.mWorldLODCenter[2];
+        mScale[i] = worldTransform.GetUniformScale();
+    }
+}
+
+void DLODBatch::ComputeDistances(size_t imin, size_t imax, Vector4<float> const& cameraPosition)
+{
+    float const px = cameraPosition[0];
+    float const py = cameraPosition[1];
+    float const pz = cameraPosition[2];
+    float const* cx = mWorldCenter[0].data();
+    float const* cy = mWorldCenter[1].data();
+    float const* cz = mWorldCenter[2].data();
+    float* distance = mDistance.data();
+    for (size_t i = imin; i < imax; ++i)
+    {
+        float const dx = cx[i] - px;
+        float const dy = cy[i] - py;
+        float const dz = cz[i] - pz;
+        distance[i] = std::sqrt(dx * dx + dy * dy + dz * dz);
+    }
+}
+
+void DLODBatch::SelectChildren(size_t imin, size_t imax, float frustumHeight)
+{
+    for (size_t i = imin; i < imax; ++i)
+    {
+        size_t const first = mFirstLevel[i];
+        int32_t const numLevels = static_cast<int32_t>(mFirstLevel[i + 1] - first);
+        float const scale = mScale[i];
+        float const distance = mDistance[i];
+        int32_t active = SwitchNode::invalidChild;
+        if (mScreenError[i])
+        {
+            float const maxWorldError = mMaxScreenError[i] * frustumHeight * distance;
+            float const* error = &mModelGeometricError[first];
+            active = 0;
+            for (int32_t j = 1; j < numLevels; ++j)
+            {
+                if (scale * error[j] > maxWorldError)
+                {
+                    break;
+                }
+                active = j;
+            }
+        }
+        else
+        {
+            float const* minDistance = &mModelMinDistance[first];
+            float const* maxDistance = &mModelMaxDistance[first];
+            for (int32_t j = 0; j < numLevels; ++j)
+            {
+                if (scale * minDistance[j] <= distance && distance < scale * maxDistance[j])
+                {
+                    active = j;
+                    break;
+                }
+            }
+        }
+        mNodes[i]->SetActiveChild(active);
+    }
+}
+
+template <typename Function>
+void DLODBatch::ForEachChunk(size_t numElements, Function const& function)
+{
+    size_t const numThreads = std::min(static_cast<size_t>(mNumThreads),
+        std::max(numElements / minPerThread, static_cast<size_t>(1)));
+
+    if (numThreads > 1)
+    {
+        size_t const numPerThread = numElements / numThreads;
+        std::vector<std::thread> process(numThreads - 1);
+        for (size_t t = 0; t + 1 < numThreads; ++t)
+        {
+            size_t const imin = t * numPerThread;
+            size_t const imax = imin + numPerThread;
+            process[t] = std::thread([&function, imin, imax]() { function(imin, imax); });
+        }
+
+        // The calling thread processes the last chunk.
+        function((numThreads - 1) * numPerThread, numElements);
+
+        for (auto& thread : process)
+        {
+            thread.join();
+        }
+    }
+    else if (numElements > 0)
+    {
+        function(0, numElements);
+    }
+}
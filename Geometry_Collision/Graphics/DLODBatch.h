@@ -0,0 +1,87 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Camera.h>
+#include <Graphics/DLODNode.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Batched level-of-detail selection for scenes with many DLODNode objects,
+// for example the trees of a forest. Add copies the model LOD centers, the
+// distance intervals, the geometric errors and the metrics of the nodes into
+// structure-of-arrays storage. Select then chooses the active children of
+// all nodes in passes over those arrays instead of one call per node during
+// culling:
+//   1. the gathering of the world LOD centers and uniform scales from the
+//      world transforms of the nodes,
+//   2. the distances from the LOD centers to the camera, a branch-free loop
+//      that the compiler vectorizes,
+//   3. the selection of the children by the metric of each node, which is
+//      that of DLODNode::SelectLevelOfDetail.
+// The nodes are split into at most numThreads contiguous chunks that are
+// processed in parallel.
+//
+// Add marks a node as batched, and its GetVisibleSet then uses the active
+// child that Select chose. Call Select after the scene graph update, which
+// computes the world transforms, and before culling. The world LOD centers
+// of the nodes are updated but the world distance intervals are not. After
+// changing the LOD data of a node, call Add again to copy it. The
+// destructor and Clear unmark the nodes. The nodes must be distinct.
+
+namespace gte
+{
+    class DLODBatch
+    {
+    public:
+        // Construction and destruction.
+        DLODBatch(uint32_t numThreads = 1);
+        ~DLODBatch();
+
+        void Add(std::shared_ptr<DLODNode> const& node);
+        void Clear();
+
+        inline size_t GetNumNodes() const
+        {
+            return mNodes.size();
+        }
+
+        // Select the levels of detail of all nodes for the camera.
+        void Select(std::shared_ptr<Camera> const& camera);
+
+    private:
+        // The passes for the nodes with indices in [imin,imax).
+        void GatherCenters(size_t imin, size_t imax);
+        void ComputeDistances(size_t imin, size_t imax, Vector4<float> const& cameraPosition);
+        void SelectChildren(size_t imin, size_t imax, float frustumHeight);
+
+        // Call function(imin, imax) for contiguous chunks of [0,numElements),
+        // one chunk per thread.
+        template <typename Function>
+        void ForEachChunk(size_t numElements, Function const& function);
+
+        uint32_t mNumThreads;
+        std::vector<std::shared_ptr<DLODNode>> mNodes;
+
+        // The LOD data of the nodes. The levels of node i are
+        // [mFirstLevel[i], mFirstLevel[i + 1]) of the level arrays.
+        std::vector<float> mModelCenter[3];
+        std::vector<uint8_t> mScreenError;
+        std::vector<float> mMaxScreenError;
+        std::vector<size_t> mFirstLevel;
+        std::vector<float> mModelMinDistance;
+        std::vector<float> mModelMaxDistance;
+        std::vector<float> mModelGeometricError;
+
+        // The per-selection state of the nodes.
+        std::vector<float> mWorldCenter[3];
+        std::vector<float> mScale;
+        std::vector<float> mDistance;
+    };
+}
@@ -18,7 +18,11 @@ DLODNode::DLODNode(int32_t numLevelsOfDetail)
     mModelMinDistance{},
     mModelMaxDistance{},
     mWorldMinDistance{},
-    mWorldMaxDistance{}
+    mWorldMaxDistance{},
+    mMetric(Metric::DISTANCE),
+    mMaxScreenError(0.0f),
+    mModelGeometricError{},
+    mBatched(false)
 {
     LogAssert(
         mNumLevelsOfDetail > 0,
@@ -28,6 +32,7 @@ DLODNode::DLODNode(int32_t numLevelsOfDetail)
     mModelMaxDistance.resize(mNumLevelsOfDetail, 0.0f);
     mWorldMinDistance.resize(mNumLevelsOfDetail, 0.0f);
     mWorldMaxDistance.resize(mNumLevelsOfDetail, 0.0f);
+    mModelGeometricError.resize(mNumLevelsOfDetail, 0.0f);
 }
 
 float DLODNode::GetModelMinDistance(int32_t i) const
@@ -82,6 +87,43 @@ void DLODNode::SetModelDistance(int32_t i, float minDistance, float maxDistance)
     mWorldMaxDistance[i] = maxDistance;
 }
 
+void DLODNode::SetDistanceMetric()
+{
+    mMetric = Metric::DISTANCE;
+}
+
+void DLODNode::SetScreenErrorMetric(float maxScreenError)
+{
+    LogAssert(
+        maxScreenError > 0.0f,
+        "Invalid screen error in SetScreenErrorMetric.");
+
+    mMetric = Metric::SCREEN_ERROR;
+    mMaxScreenError = maxScreenError;
+}
+
+float DLODNode::GetModelGeometricError(int32_t i) const
+{
+    LogAssert(
+        0 <= i && i < mNumLevelsOfDetail,
+        "Invalid index in GetModelGeometricError.");
+
+    return mModelGeometricError[i];
+}
+
+void DLODNode::SetModelGeometricError(int32_t i, float error)
+{
+    LogAssert(
+        0 <= i && i < mNumLevelsOfDetail,
+        "Invalid index in SetModelGeometricError.");
+
+    LogAssert(
+        error >= 0.0f,
+        "Invalid error in SetModelGeometricError.");
+
+    mModelGeometricError[i] = error;
+}
+
 void DLODNode::SelectLevelOfDetail(std::shared_ptr<Camera> const& camera)
 {
     // The child array of a DLODNode is compact; that is, there are no empty
@@ -110,9 +152,29 @@ void DLODNode::SelectLevelOfDetail(std::shared_ptr<Camera> const& camera)
     }
 
     // Select the LOD child.
-    SetActiveChild(SwitchNode::invalidChild);
     Vector4<float> diff = mWorldLODCenter - camera->GetPosition();
     float distance = Length(diff);
+    if (mMetric == Metric::SCREEN_ERROR)
+    {
+        // The coarsest child whose world error is at most the tolerance
+        // times the height of the view frustum at the distance.
+        float frustumHeight = (camera->GetUMax() - camera->GetUMin()) / camera->GetDMin();
+        float maxWorldError = mMaxScreenError * frustumHeight * distance;
+        float scale = worldTransform.GetUniformScale();
+        int32_t active = 0;
+        for (int32_t i = 1; i < mNumLevelsOfDetail; ++i)
+        {
+            if (scale * mModelGeometricError[i] > maxWorldError)
+            {
+                break;
+            }
+            active = i;
+        }
+        SetActiveChild(active);
+        return;
+    }
+
+    SetActiveChild(SwitchNode::invalidChild);
     for (int32_t i = 0; i < mNumLevelsOfDetail; ++i)
     {
         if (mWorldMinDistance[i] <= distance && distance < mWorldMaxDistance[i])
@@ -126,6 +188,9 @@ void DLODNode::SelectLevelOfDetail(std::shared_ptr<Camera> const& camera)
 void DLODNode::GetVisibleSet(Culler& culler, std::shared_ptr<Camera> const& camera,
     bool noCull)
 {
-    SelectLevelOfDetail(camera);
+    if (!mBatched)
+    {
+        SelectLevelOfDetail(camera);
+    }
     SwitchNode::GetVisibleSet(culler, camera, noCull);
 }
@@ -51,6 +51,39 @@ namespace gte
         float GetWorldMaxDistance(int32_t i) const;
         void SetModelDistance(int32_t i, float minDistance, float maxDistance);
 
+        // The level of detail is selected by the distance intervals or by
+        // the projected geometric error of the children. For the latter,
+        // child i is ordered from finest (i = 0) to coarsest and has a
+        // geometric error in model units, for example the maximum distance
+        // from its surface to that of the finest child, with errors that do
+        // not decrease with i. The projected error of a child is its world
+        // error divided by the distance from the world LOD center to the
+        // camera, as a fraction of the height of the view frustum at that
+        // distance, and the coarsest child whose projected error is at most
+        // maxScreenError is active. For a tolerance of p pixels in a
+        // viewport of height h, maxScreenError is p/h.
+        enum class Metric
+        {
+            DISTANCE,
+            SCREEN_ERROR
+        };
+
+        inline Metric GetMetric() const
+        {
+            return mMetric;
+        }
+
+        inline float GetMaxScreenError() const
+        {
+            return mMaxScreenError;
+        }
+
+        void SetDistanceMetric();
+        void SetScreenErrorMetric(float maxScreenError);
+
+        float GetModelGeometricError(int32_t i) const;
+        void SetModelGeometricError(int32_t i, float error);
+
     protected:
         // Switch the child based on distance from world LOD center to camera.
         void SelectLevelOfDetail(std::shared_ptr<Camera> const& camera);
@@ -71,5 +104,15 @@ namespace gte
         std::vector<float> mModelMaxDistance;
         std::vector<float> mWorldMinDistance;
         std::vector<float> mWorldMaxDistance;
+
+        // Support for the screen-space error metric.
+        Metric mMetric;
+        float mMaxScreenError;
+        std::vector<float> mModelGeometricError;
+
+        // The level of detail is selected by a DLODBatch rather than in
+        // GetVisibleSet.
+        friend class DLODBatch;
+        bool mBatched;
     };
 }
@@ -12,13 +12,30 @@ using namespace gte;
 DX11Buffer::DX11Buffer(Buffer const* buffer)
     :
     DX11Resource(buffer),
-    mUpdateMapMode(D3D11_MAP_WRITE_DISCARD)
+    mUpdateMapMode(D3D11_MAP_WRITE_DISCARD),
+    mStreamRegion(0),
+    mNumStreamRegions(1)
 {
 }
 
 bool DX11Buffer::Update(ID3D11DeviceContext* context)
 {
     Buffer* buffer = GetBuffer();
+    if (buffer->GetUsage() == Resource::Usage::STREAMING)
+    {
+        mStreamRegion = (mStreamRegion + 1) % mNumStreamRegions;
+        D3D11_MAP mapMode = (mStreamRegion == 0 ?
+            D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE);
+
+        ID3D11Buffer* dxBuffer = GetDXBuffer();
+        D3D11_MAPPED_SUBRESOURCE sub;
+        DX11Log(context->Map(dxBuffer, 0, mapMode, 0, &sub));
+        char* target = static_cast<char*>(sub.pData) + GetStreamOffset();
+        std::memcpy(target, buffer->GetData(), buffer->GetNumBytes());
+        context->Unmap(dxBuffer, 0);
+        return true;
+    }
+
     LogAssert(buffer->GetUsage() == Resource::Usage::DYNAMIC_UPDATE, "Buffer must be dynamic-update.");
 
     UINT numActiveBytes = buffer->GetNumActiveBytes();
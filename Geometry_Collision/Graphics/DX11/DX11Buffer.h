@@ -35,6 +35,14 @@ namespace gte
         // subresource.  The second function copies all subresources.
         virtual void CopyGpuToGpu(ID3D11DeviceContext* context, ID3D11Resource* target) override;
 
+        // Support for Resource::Usage::STREAMING.  The offset is that of the
+        // region written by the last Update call; it is 0 for the other
+        // usages.
+        inline UINT GetStreamOffset() const
+        {
+            return mStreamRegion * GetBuffer()->GetNumBytes();
+        }
+
     private:
         // Buffers use only subresource 0, so these overrides are stubbed out.
         virtual bool Update(ID3D11DeviceContext* context, uint32_t sri) override;
@@ -65,6 +73,15 @@ namespace gte
         // when the feature level is found to be D3D_FEATURE_LEVEL_11_1 or
         // later.
         D3D11_MAP mUpdateMapMode;
+
+        // A streaming buffer has mNumStreamRegions copies of the data.  Each
+        // Update writes the next region with D3D11_MAP_WRITE_NO_OVERWRITE,
+        // which does not wait for the GPU, and the wrap to region 0 uses
+        // D3D11_MAP_WRITE_DISCARD so that the driver renames the storage
+        // still in use.  A derived class that cannot bind at an offset sets
+        // mNumStreamRegions to 1, in which case every update discards.
+        uint32_t mStreamRegion;
+        uint32_t mNumStreamRegions;
     };
 
     inline Buffer* DX11Buffer::GetBuffer() const
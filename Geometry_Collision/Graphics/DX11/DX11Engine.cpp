@@ -12,6 +12,8 @@
 #include <Graphics/DX11/DX11ConstantBuffer.h>
 #include <Graphics/DX11/DX11DepthStencilState.h>
 #include <Graphics/DX11/DX11DrawTarget.h>
+#include <Graphics/DX11/DX11GPUProfiler.h>
+#include <Graphics/DX11/DX11GPUReadback.h>
 #include <Graphics/DX11/DX11GeometryShader.h>
 #include <Graphics/DX11/DX11IndexBuffer.h>
 #include <Graphics/DX11/DX11IndirectArgumentsBuffer.h>
@@ -32,11 +34,15 @@
 #include <Graphics/DX11/DX11VertexShader.h>
 #include <Graphics/DX11/HLSLProgramFactory.h>
 #include <Graphics/DX11/HLSLComputeProgram.h>
+#include <Mathematics/TaskScheduler.h>
+#include <Mathematics/Trace.h>
+#include <algorithm>
 using namespace gte;
 
 DX11Engine::~DX11Engine()
 {
     DX11::FinalRelease(mWaitQuery);
+    DestroyDeferredContexts();
 
     // The render state objects (and fonts) are destroyed first so that the
     // render state objects are removed from the bridges before they are
@@ -49,14 +55,9 @@ DX11Engine::~DX11Engine()
     DrawTarget::UnsubscribeForDestruction(mDTListener);
     mDTListener = nullptr;
 
-    mGOMapMutex.lock();
-    if (mGOMap.size() > 0)
-    {
-        // Bridge map is nonempty on destruction.
-        // TODO: In GTL, handle differently. The condition should not occur.
-        mGOMap.clear();
-    }
-    mGOMapMutex.unlock();
+    // The bridge may be nonempty on destruction.
+    // TODO: In GTL, handle differently. The condition should not occur.
+    ClearGEObjects();
 
     mDTMapMutex.lock();
     if (mDTMap.size() > 0)
@@ -174,9 +175,7 @@ DX11GraphicsObject* DX11Engine::Share(std::shared_ptr<Texture2> const& texture,
         {
             dxShared = std::make_shared<DX11TextureDS>(mDevice, static_cast<DX11TextureDS const*>(dxTexture));
         }
-        mGOMapMutex.lock();
-        mGOMap.insert(std::make_pair(texture.get(), dxShared));
-        mGOMapMutex.unlock();
+        InsertGEObject(texture.get(), dxShared);
         return dxTexture;
     }
 
@@ -327,6 +326,40 @@ void DX11Engine::EndTimer(DX11PerformanceCounter& counter)
     }
 }
 
+bool DX11Engine::EnableDeferredContexts(uint32_t numContexts, size_t minVisualsPerContext)
+{
+    DestroyDeferredContexts();
+    mMinVisualsPerContext = std::max(minVisualsPerContext, static_cast<size_t>(1));
+    if (!mDevice)
+    {
+        return numContexts == 0;
+    }
+
+    for (uint32_t i = 0; i < numContexts; ++i)
+    {
+        ID3D11DeviceContext* context = nullptr;
+        HRESULT hr = mDevice->CreateDeferredContext(0, &context);
+        if (FAILED(hr))
+        {
+            DestroyDeferredContexts();
+            return false;
+        }
+        mDeferredContexts.push_back(context);
+    }
+    return true;
+}
+
+bool DX11Engine::HasDriverCommandLists() const
+{
+    D3D11_FEATURE_DATA_THREADING threading{};
+    if (mDevice && SUCCEEDED(mDevice->CheckFeatureSupport(D3D11_FEATURE_THREADING,
+        &threading, sizeof(threading))))
+    {
+        return threading.DriverCommandLists == TRUE;
+    }
+    return false;
+}
+
 void DX11Engine::Initialize(IDXGIAdapter* adapter, D3D_DRIVER_TYPE driverType,
     HMODULE softwareModule, UINT flags, bool useDepth24Stencil8)
 {
@@ -364,6 +397,8 @@ void DX11Engine::Initialize(IDXGIAdapter* adapter, D3D_DRIVER_TYPE driverType,
 
     mBackBufferStaging = nullptr;
 
+    mMinVisualsPerContext = 64;
+
     // Initialization of GraphicsEngine members that depend on DX11.
     mILMap = std::make_unique<DX11InputLayoutManager>();
 
@@ -747,43 +782,44 @@ bool DX11Engine::DestroyBackBuffer()
         && DX11::FinalRelease(mDepthStencilBuffer) == 0;
 }
 
-uint64_t DX11Engine::DrawPrimitive(VertexBuffer const* vbuffer, IndexBuffer const* ibuffer)
+uint64_t DX11Engine::DrawPrimitive(ID3D11DeviceContext* context, VertexBuffer const* vbuffer, IndexBuffer const* ibuffer)
 {
     UINT numActiveVertices = vbuffer->GetNumActiveElements();
     UINT vertexOffset = vbuffer->GetOffset();
 
     UINT numActiveIndices = ibuffer->GetNumActiveIndices();
     UINT firstIndex = ibuffer->GetFirstIndex();
+    UINT numInstances = ibuffer->GetNumInstances();
     uint32_t type = ibuffer->GetPrimitiveType();
 
     switch (type)
     {
     case IP_POLYPOINT:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
         break;
     case IP_POLYSEGMENT_DISJOINT:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST);
         break;
     case IP_POLYSEGMENT_CONTIGUOUS:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP);
         break;
     case IP_TRIMESH:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
         break;
     case IP_TRISTRIP:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP);
         break;
     case IP_POLYSEGMENT_DISJOINT_ADJ:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINELIST_ADJ);
         break;
     case IP_POLYSEGMENT_CONTIGUOUS_ADJ:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_LINESTRIP_ADJ);
         break;
     case IP_TRIMESH_ADJ:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST_ADJ);
         break;
     case IP_TRISTRIP_ADJ:
-        mImmediate->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ);
+        context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP_ADJ);
         break;
     default:
         LogError("Unknown primitive topology = " + std::to_string(type));
@@ -800,14 +836,29 @@ uint64_t DX11Engine::DrawPrimitive(VertexBuffer const* vbuffer, IndexBuffer cons
     {
         if (numActiveIndices > 0)
         {
-            mImmediate->DrawIndexed(numActiveIndices, firstIndex, vertexOffset);
+            if (numInstances > 1)
+            {
+                context->DrawIndexedInstanced(numActiveIndices, numInstances,
+                    firstIndex, vertexOffset, 0);
+            }
+            else
+            {
+                context->DrawIndexed(numActiveIndices, firstIndex, vertexOffset);
+            }
         }
     }
     else
     {
         if (numActiveVertices > 0)
         {
-            mImmediate->Draw(numActiveVertices, vertexOffset);
+            if (numInstances > 1)
+            {
+                context->DrawInstanced(numActiveVertices, numInstances, vertexOffset, 0);
+            }
+            else
+            {
+                context->Draw(numActiveVertices, vertexOffset);
+            }
         }
     }
 
@@ -854,7 +905,8 @@ uint64_t DX11Engine::EndOcclusionQuery(ID3D11Query* occlusionQuery)
     LogError("No query provided.");
 }
 
-bool DX11Engine::EnableShaders(std::shared_ptr<VisualEffect> const& effect,
+bool DX11Engine::EnableShaders(ID3D11DeviceContext* context,
+    std::shared_ptr<VisualEffect> const& effect,
     DX11VertexShader*& dxVShader, DX11GeometryShader*& dxGShader, DX11PixelShader*& dxPShader)
 {
     dxVShader = nullptr;
@@ -876,52 +928,58 @@ bool DX11Engine::EnableShaders(std::shared_ptr<VisualEffect> const& effect,
     dxPShader = static_cast<DX11PixelShader*>(Bind(effect->GetPixelShader()));
 
     // Enable the shaders and resources.
-    Enable(effect->GetVertexShader().get(), dxVShader);
-    Enable(effect->GetPixelShader().get(), dxPShader);
+    Enable(context, effect->GetVertexShader().get(), dxVShader);
+    Enable(context, effect->GetPixelShader().get(), dxPShader);
     if (dxGShader)
     {
-        Enable(effect->GetGeometryShader().get(), dxGShader);
+        Enable(context, effect->GetGeometryShader().get(), dxGShader);
     }
 
     return true;
 }
 
-void DX11Engine::DisableShaders(std::shared_ptr<VisualEffect> const& effect,
+void DX11Engine::DisableShaders(ID3D11DeviceContext* context,
+    std::shared_ptr<VisualEffect> const& effect,
     DX11VertexShader* dxVShader, DX11GeometryShader* dxGShader, DX11PixelShader* dxPShader)
 {
     if (dxGShader)
     {
-        Disable(effect->GetGeometryShader().get(), dxGShader);
+        Disable(context, effect->GetGeometryShader().get(), dxGShader);
     }
-    Disable(effect->GetPixelShader().get(), dxPShader);
-    Disable(effect->GetVertexShader().get(), dxVShader);
+    Disable(context, effect->GetPixelShader().get(), dxPShader);
+    Disable(context, effect->GetVertexShader().get(), dxVShader);
+}
+
+void DX11Engine::Enable(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
+{
+    dxShader->Enable(context);
+    EnableResources(context, shader, dxShader);
 }
 
-void DX11Engine::Enable(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::Disable(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
-    dxShader->Enable(mImmediate);
-    EnableCBuffers(shader, dxShader);
-    EnableTBuffers(shader, dxShader);
-    EnableSBuffers(shader, dxShader);
-    EnableRBuffers(shader, dxShader);
-    EnableTextures(shader, dxShader);
-    EnableTextureArrays(shader, dxShader);
-    EnableSamplers(shader, dxShader);
+    DisableSamplers(context, shader, dxShader);
+    DisableTextureArrays(context, shader, dxShader);
+    DisableTextures(context, shader, dxShader);
+    DisableRBuffers(context, shader, dxShader);
+    DisableSBuffers(context, shader, dxShader);
+    DisableTBuffers(context, shader, dxShader);
+    DisableCBuffers(context, shader, dxShader);
+    dxShader->Disable(context);
 }
 
-void DX11Engine::Disable(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableResources(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
-    DisableSamplers(shader, dxShader);
-    DisableTextureArrays(shader, dxShader);
-    DisableTextures(shader, dxShader);
-    DisableRBuffers(shader, dxShader);
-    DisableSBuffers(shader, dxShader);
-    DisableTBuffers(shader, dxShader);
-    DisableCBuffers(shader, dxShader);
-    dxShader->Disable(mImmediate);
+    EnableCBuffers(context, shader, dxShader);
+    EnableTBuffers(context, shader, dxShader);
+    EnableSBuffers(context, shader, dxShader);
+    EnableRBuffers(context, shader, dxShader);
+    EnableTextures(context, shader, dxShader);
+    EnableTextureArrays(context, shader, dxShader);
+    EnableSamplers(context, shader, dxShader);
 }
 
-void DX11Engine::EnableCBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableCBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = ConstantBuffer::shaderDataLookup;
     for (auto const& cb : shader->GetData(index))
@@ -931,7 +989,7 @@ void DX11Engine::EnableCBuffers(Shader const* shader, DX11Shader* dxShader)
             DX11ConstantBuffer* dxCB = static_cast<DX11ConstantBuffer*>(Bind(cb.object));
             if (dxCB)
             {
-                dxShader->EnableCBuffer(mImmediate, cb.bindPoint, dxCB->GetDXBuffer());
+                dxShader->EnableCBuffer(context, cb.bindPoint, dxCB->GetDXBuffer());
             }
             else
             {
@@ -945,16 +1003,16 @@ void DX11Engine::EnableCBuffers(Shader const* shader, DX11Shader* dxShader)
     }
 }
 
-void DX11Engine::DisableCBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::DisableCBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = ConstantBuffer::shaderDataLookup;
     for (auto const& cb : shader->GetData(index))
     {
-        dxShader->DisableCBuffer(mImmediate, cb.bindPoint);
+        dxShader->DisableCBuffer(context, cb.bindPoint);
     }
 }
 
-void DX11Engine::EnableTBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableTBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = TextureBuffer::shaderDataLookup;
     for (auto const& tb : shader->GetData(index))
@@ -964,7 +1022,7 @@ void DX11Engine::EnableTBuffers(Shader const* shader, DX11Shader* dxShader)
             DX11TextureBuffer* dxTB = static_cast<DX11TextureBuffer*>(Bind(tb.object));
             if (dxTB)
             {
-                dxShader->EnableSRView(mImmediate, tb.bindPoint, dxTB->GetSRView());
+                dxShader->EnableSRView(context, tb.bindPoint, dxTB->GetSRView());
             }
             else
             {
@@ -978,16 +1036,16 @@ void DX11Engine::EnableTBuffers(Shader const* shader, DX11Shader* dxShader)
     }
 }
 
-void DX11Engine::DisableTBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::DisableTBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = TextureBuffer::shaderDataLookup;
     for (auto const& tb : shader->GetData(index))
     {
-        dxShader->DisableSRView(mImmediate, tb.bindPoint);
+        dxShader->DisableSRView(context, tb.bindPoint);
     }
 }
 
-void DX11Engine::EnableSBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableSBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = StructuredBuffer::shaderDataLookup;
     for (auto const& sb : shader->GetData(index))
@@ -1003,11 +1061,11 @@ void DX11Engine::EnableSBuffers(Shader const* shader, DX11Shader* dxShader)
 
                     uint32_t numActive = (gtSB->GetKeepInternalCount() ?
                         0xFFFFFFFFu : gtSB->GetNumActiveElements());
-                    dxShader->EnableUAView(mImmediate, sb.bindPoint, dxSB->GetUAView(), numActive);
+                    dxShader->EnableUAView(context, sb.bindPoint, dxSB->GetUAView(), numActive);
                 }
                 else
                 {
-                    dxShader->EnableSRView(mImmediate, sb.bindPoint, dxSB->GetSRView());
+                    dxShader->EnableSRView(context, sb.bindPoint, dxSB->GetSRView());
                 }
             }
             else
@@ -1022,23 +1080,23 @@ void DX11Engine::EnableSBuffers(Shader const* shader, DX11Shader* dxShader)
     }
 }
 
-void DX11Engine::DisableSBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::DisableSBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = StructuredBuffer::shaderDataLookup;
     for (auto const& sb : shader->GetData(index))
     {
         if (sb.isGpuWritable)
         {
-            dxShader->DisableUAView(mImmediate, sb.bindPoint);
+            dxShader->DisableUAView(context, sb.bindPoint);
         }
         else
         {
-            dxShader->DisableSRView(mImmediate, sb.bindPoint);
+            dxShader->DisableSRView(context, sb.bindPoint);
         }
     }
 }
 
-void DX11Engine::EnableRBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableRBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = RawBuffer::shaderDataLookup;
     for (auto const& rb : shader->GetData(index))
@@ -1050,11 +1108,11 @@ void DX11Engine::EnableRBuffers(Shader const* shader, DX11Shader* dxShader)
             {
                 if (rb.isGpuWritable)
                 {
-                    dxShader->EnableUAView(mImmediate, rb.bindPoint, dxRB->GetUAView(), 0xFFFFFFFFu);
+                    dxShader->EnableUAView(context, rb.bindPoint, dxRB->GetUAView(), 0xFFFFFFFFu);
                 }
                 else
                 {
-                    dxShader->EnableSRView(mImmediate, rb.bindPoint, dxRB->GetSRView());
+                    dxShader->EnableSRView(context, rb.bindPoint, dxRB->GetSRView());
                 }
             }
             else
@@ -1069,23 +1127,23 @@ void DX11Engine::EnableRBuffers(Shader const* shader, DX11Shader* dxShader)
     }
 }
 
-void DX11Engine::DisableRBuffers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::DisableRBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = RawBuffer::shaderDataLookup;
     for (auto const& rb : shader->GetData(index))
     {
         if (rb.isGpuWritable)
         {
-            dxShader->DisableUAView(mImmediate, rb.bindPoint);
+            dxShader->DisableUAView(context, rb.bindPoint);
         }
         else
         {
-            dxShader->DisableSRView(mImmediate, rb.bindPoint);
+            dxShader->DisableSRView(context, rb.bindPoint);
         }
     }
 }
 
-void DX11Engine::EnableTextures(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableTextures(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     // According to the Remarks section in the documentation for
     // OMSetRenderTargetsAndUnorderedAccessViews
@@ -1155,12 +1213,12 @@ void DX11Engine::EnableTextures(Shader const* shader, DX11Shader* dxShader)
                     }
                     else
                     {
-                        dxShader->EnableUAView(mImmediate, tx.bindPoint, dxTX->GetUAView(), 0xFFFFFFFFu);
+                        dxShader->EnableUAView(context, tx.bindPoint, dxTX->GetUAView(), 0xFFFFFFFFu);
                     }
                 }
                 else
                 {
-                    dxShader->EnableSRView(mImmediate, tx.bindPoint, dxTX->GetSRView());
+                    dxShader->EnableSRView(context, tx.bindPoint, dxTX->GetSRView());
                 }
             }
             else
@@ -1186,30 +1244,30 @@ void DX11Engine::EnableTextures(Shader const* shader, DX11Shader* dxShader)
                 LogAssert(bindPoints[i] == bindPoints[i - 1] + 1, "Bind points must be consecutive.");
             }
 
-            mImmediate->OMSetRenderTargetsAndUnorderedAccessViews(
+            context->OMSetRenderTargetsAndUnorderedAccessViews(
                 D3D11_KEEP_RENDER_TARGETS_AND_DEPTH_STENCIL, nullptr, nullptr,
                 bindPoints[0], numBindPoints, uavs.data(), initialCounts.data());
         }
     }
 }
 
-void DX11Engine::DisableTextures(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::DisableTextures(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = TextureSingle::shaderDataLookup;
     for (auto const& tx : shader->GetData(index))
     {
         if (tx.isGpuWritable)
         {
-            dxShader->DisableUAView(mImmediate, tx.bindPoint);
+            dxShader->DisableUAView(context, tx.bindPoint);
         }
         else
         {
-            dxShader->DisableSRView(mImmediate, tx.bindPoint);
+            dxShader->DisableSRView(context, tx.bindPoint);
         }
     }
 }
 
-void DX11Engine::EnableTextureArrays(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableTextureArrays(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = TextureArray::shaderDataLookup;
     for (auto const& ta : shader->GetData(index))
@@ -1221,11 +1279,11 @@ void DX11Engine::EnableTextureArrays(Shader const* shader, DX11Shader* dxShader)
             {
                 if (ta.isGpuWritable)
                 {
-                    dxShader->EnableUAView(mImmediate, ta.bindPoint, dxTA->GetUAView(), 0xFFFFFFFFu);
+                    dxShader->EnableUAView(context, ta.bindPoint, dxTA->GetUAView(), 0xFFFFFFFFu);
                 }
                 else
                 {
-                    dxShader->EnableSRView(mImmediate, ta.bindPoint, dxTA->GetSRView());
+                    dxShader->EnableSRView(context, ta.bindPoint, dxTA->GetSRView());
                 }
             }
             else
@@ -1240,7 +1298,7 @@ void DX11Engine::EnableTextureArrays(Shader const* shader, DX11Shader* dxShader)
     }
 }
 
-void DX11Engine::DisableTextureArrays(Shader const* shader,
+void DX11Engine::DisableTextureArrays(ID3D11DeviceContext* context, Shader const* shader,
     DX11Shader* dxShader)
 {
     int32_t const index = TextureArray::shaderDataLookup;
@@ -1248,16 +1306,16 @@ void DX11Engine::DisableTextureArrays(Shader const* shader,
     {
         if (ta.isGpuWritable)
         {
-            dxShader->DisableUAView(mImmediate, ta.bindPoint);
+            dxShader->DisableUAView(context, ta.bindPoint);
         }
         else
         {
-            dxShader->DisableSRView(mImmediate, ta.bindPoint);
+            dxShader->DisableSRView(context, ta.bindPoint);
         }
     }
 }
 
-void DX11Engine::EnableSamplers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::EnableSamplers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = SamplerState::shaderDataLookup;
     for (auto const& ss : shader->GetData(index))
@@ -1267,7 +1325,7 @@ void DX11Engine::EnableSamplers(Shader const* shader, DX11Shader* dxShader)
             DX11SamplerState* dxSS = static_cast<DX11SamplerState*>(Bind(ss.object));
             if (dxSS)
             {
-                dxShader->EnableSampler(mImmediate, ss.bindPoint, dxSS->GetDXSamplerState());
+                dxShader->EnableSampler(context, ss.bindPoint, dxSS->GetDXSamplerState());
             }
             else
             {
@@ -1281,12 +1339,12 @@ void DX11Engine::EnableSamplers(Shader const* shader, DX11Shader* dxShader)
     }
 }
 
-void DX11Engine::DisableSamplers(Shader const* shader, DX11Shader* dxShader)
+void DX11Engine::DisableSamplers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader)
 {
     int32_t const index = SamplerState::shaderDataLookup;
     for (auto const& ss : shader->GetData(index))
     {
-        dxShader->DisableSampler(mImmediate, ss.bindPoint);
+        dxShader->DisableSampler(context, ss.bindPoint);
     }
 }
 
@@ -1441,6 +1499,8 @@ void DX11Engine::ClearBuffers()
 
 void DX11Engine::DisplayColorBuffer(uint32_t syncInterval)
 {
+    GTE_TRACE_SCOPE("DisplayColorBuffer");
+
     // The swap must occur on the thread in which the device was created.
     mSwapChain->Present(syncInterval, 0);
 }
@@ -1560,18 +1620,18 @@ DX11Texture2* DX11Engine::BindTexture(std::shared_ptr<Texture2> const& texture,
 
     mGOMapMutex.lock();
     GraphicsObject const* gtObject = texture.get();
-    auto iter = mGOMap.find(gtObject);
-    if (iter == mGOMap.end())
+    GEObject* geObjectPtr = FindGEObjectLocked(gtObject);
+    if (!geObjectPtr)
     {
         auto geObject = std::make_shared<DX11Texture2>(texture.get(), dxTexture, dxSRView);
         LogAssert(geObject, "Null object.  Out of memory?");
 
-        iter = mGOMap.insert(std::make_pair(gtObject, geObject)).first;
+        geObjectPtr = InsertGEObjectLocked(gtObject, geObject);
 #if defined(GTE_GRAPHICS_USE_NAMED_OBJECTS)
         geObject->SetName(texture->GetName());
 #endif
     }
-    DX11Texture2* dx11Texture2 = static_cast<DX11Texture2*>(iter->second.get());
+    DX11Texture2* dx11Texture2 = static_cast<DX11Texture2*>(geObjectPtr);
     mGOMapMutex.unlock();
     return dx11Texture2;
 }
@@ -1838,9 +1898,9 @@ void DX11Engine::Execute(std::shared_ptr<ComputeProgram> const& program,
         if (cshader)
         {
             DX11ComputeShader* dxCShader = static_cast<DX11ComputeShader*>(Bind(cshader));
-            Enable(cshader.get(), dxCShader);
+            Enable(mImmediate, cshader.get(), dxCShader);
             mImmediate->Dispatch(numXGroups, numYGroups, numZGroups);
-            Disable(cshader.get(), dxCShader);
+            Disable(mImmediate, cshader.get(), dxCShader);
         }
         else
         {
@@ -1874,6 +1934,20 @@ void DX11Engine::Flush()
     mImmediate->Flush();
 }
 
+std::shared_ptr<GPUProfiler> DX11Engine::CreateGPUProfiler(size_t numFrames, size_t maxScopes)
+{
+    return std::make_shared<DX11GPUProfiler>(mDevice, mImmediate, numFrames, maxScopes);
+}
+
+std::shared_ptr<GPUReadback> DX11Engine::CreateGPUReadback(std::shared_ptr<Buffer> const& buffer,
+    size_t numSlots)
+{
+    LogAssert(buffer != nullptr, "Input buffer is null.");
+    DX11Buffer* dxBuffer = static_cast<DX11Buffer*>(Bind(buffer));
+    return std::make_shared<DX11GPUReadback>(mDevice, mImmediate, buffer,
+        dxBuffer->GetDXBuffer(), numSlots);
+}
+
 void DX11Engine::CopyBackBuffer(std::shared_ptr<Texture2>& texture)
 {
     if (!mColorBuffer)
@@ -1919,7 +1993,7 @@ uint64_t DX11Engine::DrawPrimitive(std::shared_ptr<VertexBuffer> const& vbuffer,
     DX11VertexShader* dxVShader;
     DX11GeometryShader* dxGShader;
     DX11PixelShader* dxPShader;
-    if (EnableShaders(effect, dxVShader, dxGShader, dxPShader))
+    if (EnableShaders(mImmediate, effect, dxVShader, dxGShader, dxPShader))
     {
         // Enable the vertex buffer and input layout.
         DX11VertexBuffer* dxVBuffer = nullptr;
@@ -1945,7 +2019,7 @@ uint64_t DX11Engine::DrawPrimitive(std::shared_ptr<VertexBuffer> const& vbuffer,
             dxIBuffer->Enable(mImmediate);
         }
 
-        numPixelsDrawn = DrawPrimitive(vbuffer.get(), ibuffer.get());
+        numPixelsDrawn = DrawPrimitive(mImmediate, vbuffer.get(), ibuffer.get());
 
         // Disable the vertex buffer and input layout.
         if (vbuffer->StandardUsage())
@@ -1960,7 +2034,316 @@ uint64_t DX11Engine::DrawPrimitive(std::shared_ptr<VertexBuffer> const& vbuffer,
             dxIBuffer->Disable(mImmediate);
         }
 
-        DisableShaders(effect, dxVShader, dxGShader, dxPShader);
+        DisableShaders(mImmediate, effect, dxVShader, dxGShader, dxPShader);
     }
     return numPixelsDrawn;
 }
+
+uint64_t DX11Engine::DrawPrimitives(std::vector<Visual*> const& visuals)
+{
+    if (mDeferredContexts.size() > 0 && !mAllowOcclusionQuery &&
+        visuals.size() >= 2 * mMinVisualsPerContext)
+    {
+        return DrawPrimitivesDeferred(visuals);
+    }
+    return RecordPrimitives(mImmediate, visuals.data(), visuals.size());
+}
+
+uint64_t DX11Engine::RecordPrimitives(ID3D11DeviceContext* context,
+    Visual* const* visuals, size_t numVisuals)
+{
+    // A run is a sequence of consecutive visuals whose effects share a
+    // program.  The shaders are set once per run.  The effects of a run have
+    // the same shaders and therefore the same bind points, so the resources
+    // of the next effect replace those of the previous one without first
+    // being disabled.  The input-assembler buffers do not depend on the
+    // shaders and stay bound across runs, but the input layout depends on
+    // the vertex shader and is enabled again in each run.
+    uint64_t numPixelsDrawn = 0;
+    VisualProgram const* activeProgram = nullptr;
+    VisualEffect const* activeEffect = nullptr;
+    std::shared_ptr<VisualEffect> runEffect{};
+    DX11VertexShader* dxVShader = nullptr;
+    DX11GeometryShader* dxGShader = nullptr;
+    DX11PixelShader* dxPShader = nullptr;
+    VertexBuffer const* activeVBuffer = nullptr;
+    IndexBuffer const* activeIBuffer = nullptr;
+    DX11VertexBuffer* dxVBuffer = nullptr;
+    DX11InputLayout* dxLayout = nullptr;
+    DX11IndexBuffer* dxIBuffer = nullptr;
+
+    for (size_t i = 0; i < numVisuals; ++i)
+    {
+        Visual const* visual = visuals[i];
+        auto const& vbuffer = visual->GetVertexBuffer();
+        auto const& ibuffer = visual->GetIndexBuffer();
+        auto const& effect = visual->GetEffect();
+        if (!vbuffer || !ibuffer || !effect)
+        {
+            continue;
+        }
+
+        bool newLayout = (vbuffer.get() != activeVBuffer);
+        if (effect->GetProgram().get() != activeProgram)
+        {
+            if (runEffect)
+            {
+                DisableShaders(context, runEffect, dxVShader, dxGShader, dxPShader);
+            }
+            EnableShaders(context, effect, dxVShader, dxGShader, dxPShader);
+            activeProgram = effect->GetProgram().get();
+            newLayout = true;
+        }
+        else if (effect.get() != activeEffect)
+        {
+            EnableResources(context, effect->GetVertexShader().get(), dxVShader);
+            EnableResources(context, effect->GetPixelShader().get(), dxPShader);
+            if (dxGShader)
+            {
+                EnableResources(context, effect->GetGeometryShader().get(), dxGShader);
+            }
+        }
+        activeEffect = effect.get();
+        runEffect = effect;
+
+        if (vbuffer.get() != activeVBuffer)
+        {
+            if (vbuffer->StandardUsage())
+            {
+                dxVBuffer = static_cast<DX11VertexBuffer*>(Bind(vbuffer));
+                dxVBuffer->Enable(context);
+            }
+            else if (dxVBuffer)
+            {
+                dxVBuffer->Disable(context);
+                dxVBuffer = nullptr;
+            }
+            activeVBuffer = vbuffer.get();
+        }
+
+        if (newLayout)
+        {
+            if (vbuffer->StandardUsage())
+            {
+                DX11InputLayoutManager* manager = static_cast<DX11InputLayoutManager*>(mILMap.get());
+                dxLayout = manager->Bind(mDevice, vbuffer.get(), effect->GetVertexShader().get());
+                dxLayout->Enable(context);
+            }
+            else
+            {
+                dxLayout = nullptr;
+                context->IASetInputLayout(nullptr);
+            }
+        }
+
+        if (ibuffer->IsIndexed() && ibuffer.get() != activeIBuffer)
+        {
+            dxIBuffer = static_cast<DX11IndexBuffer*>(Bind(ibuffer));
+            dxIBuffer->Enable(context);
+            activeIBuffer = ibuffer.get();
+        }
+
+        numPixelsDrawn += DrawPrimitive(context, vbuffer.get(), ibuffer.get());
+    }
+
+    // Restore the state that DrawPrimitive leaves after each draw.
+    if (dxVBuffer)
+    {
+        dxVBuffer->Disable(context);
+    }
+    if (dxLayout)
+    {
+        dxLayout->Disable(context);
+    }
+    if (dxIBuffer)
+    {
+        dxIBuffer->Disable(context);
+    }
+    if (runEffect)
+    {
+        DisableShaders(context, runEffect, dxVShader, dxGShader, dxPShader);
+    }
+    return numPixelsDrawn;
+}
+
+uint64_t DX11Engine::DrawPrimitivesDeferred(std::vector<Visual*> const& visuals)
+{
+    // Create the graphics objects on this thread. The recording tasks then
+    // only look up the objects in the bridge map.
+    for (auto const& visual : visuals)
+    {
+        BindDrawResources(visual);
+    }
+
+    // The state of the immediate context that is inherited by the deferred
+    // contexts. The Get functions increment the reference counts of the
+    // interfaces.
+    std::array<ID3D11RenderTargetView*, D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT> rtViews{};
+    ID3D11DepthStencilView* dsView = nullptr;
+    mImmediate->OMGetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtViews.data(), &dsView);
+
+    std::array<D3D11_VIEWPORT, D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE> viewports{};
+    UINT numViewports = static_cast<UINT>(viewports.size());
+    mImmediate->RSGetViewports(&numViewports, viewports.data());
+
+    std::array<D3D11_RECT, D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE> scissorRects{};
+    UINT numScissorRects = static_cast<UINT>(scissorRects.size());
+    mImmediate->RSGetScissorRects(&numScissorRects, scissorRects.data());
+
+    ID3D11BlendState* blendState = nullptr;
+    std::array<FLOAT, 4> blendFactor{};
+    UINT sampleMask = 0;
+    mImmediate->OMGetBlendState(&blendState, blendFactor.data(), &sampleMask);
+
+    ID3D11DepthStencilState* depthStencilState = nullptr;
+    UINT stencilRef = 0;
+    mImmediate->OMGetDepthStencilState(&depthStencilState, &stencilRef);
+
+    ID3D11RasterizerState* rasterizerState = nullptr;
+    mImmediate->RSGetState(&rasterizerState);
+
+    // Partition the visuals into contiguous subsets of nearly equal size.
+    size_t const numVisuals = visuals.size();
+    size_t const numSubsets = std::min(mDeferredContexts.size(),
+        numVisuals / mMinVisualsPerContext);
+    std::vector<ID3D11CommandList*> commandLists(numSubsets, nullptr);
+    std::exception_ptr exception{};
+    try
+    {
+        TaskScheduler::TaskGroup group;
+        for (size_t j = 0; j < numSubsets; ++j)
+        {
+            group.Run([&, j]()
+            {
+                ID3D11DeviceContext* context = mDeferredContexts[j];
+                context->OMSetRenderTargets(D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT, rtViews.data(), dsView);
+                context->RSSetViewports(numViewports, viewports.data());
+                context->RSSetScissorRects(numScissorRects, scissorRects.data());
+                context->OMSetBlendState(blendState, blendFactor.data(), sampleMask);
+                context->OMSetDepthStencilState(depthStencilState, stencilRef);
+                context->RSSetState(rasterizerState);
+
+                size_t const first = j * numVisuals / numSubsets;
+                size_t const last = (j + 1) * numVisuals / numSubsets;
+                RecordPrimitives(context, visuals.data() + first, last - first);
+                DX11Log(context->FinishCommandList(FALSE, &commandLists[j]));
+            });
+        }
+        group.Wait();
+    }
+    catch (...)
+    {
+        exception = std::current_exception();
+    }
+
+    for (auto& rtView : rtViews)
+    {
+        DX11::SafeRelease(rtView);
+    }
+    DX11::SafeRelease(dsView);
+    DX11::SafeRelease(blendState);
+    DX11::SafeRelease(depthStencilState);
+    DX11::SafeRelease(rasterizerState);
+
+    // Execute the command lists in the order of the visuals. The state of
+    // the immediate context is restored after each command list.
+    for (auto& commandList : commandLists)
+    {
+        if (commandList)
+        {
+            if (!exception)
+            {
+                mImmediate->ExecuteCommandList(commandList, TRUE);
+            }
+            DX11::SafeRelease(commandList);
+        }
+    }
+
+    if (exception)
+    {
+        // A failed recording leaves its deferred context in an unknown
+        // state. Discard the recorded commands so that the context can be
+        // used again.
+        for (auto const& context : mDeferredContexts)
+        {
+            context->ClearState();
+            ID3D11CommandList* commandList = nullptr;
+            if (SUCCEEDED(context->FinishCommandList(FALSE, &commandList)))
+            {
+                DX11::SafeRelease(commandList);
+            }
+        }
+        std::rethrow_exception(exception);
+    }
+
+    // Occlusion queries are not issued on deferred contexts.
+    return 0;
+}
+
+void DX11Engine::BindDrawResources(Visual const* visual)
+{
+    auto const& vbuffer = visual->GetVertexBuffer();
+    auto const& ibuffer = visual->GetIndexBuffer();
+    auto const& effect = visual->GetEffect();
+    if (!vbuffer || !ibuffer || !effect)
+    {
+        return;
+    }
+
+    if (vbuffer->StandardUsage())
+    {
+        Bind(vbuffer);
+    }
+    if (ibuffer->IsIndexed())
+    {
+        Bind(ibuffer);
+    }
+
+    std::array<std::shared_ptr<Shader> const*, 3> shaders =
+    {
+        &effect->GetVertexShader(),
+        &effect->GetGeometryShader(),
+        &effect->GetPixelShader()
+    };
+    for (auto const& shader : shaders)
+    {
+        if (*shader)
+        {
+            Bind(*shader);
+            BindDrawResources(shader->get());
+        }
+    }
+}
+
+void DX11Engine::BindDrawResources(Shader const* shader)
+{
+    std::array<int32_t, 7> const lookups =
+    {
+        ConstantBuffer::shaderDataLookup,
+        TextureBuffer::shaderDataLookup,
+        StructuredBuffer::shaderDataLookup,
+        RawBuffer::shaderDataLookup,
+        TextureSingle::shaderDataLookup,
+        TextureArray::shaderDataLookup,
+        SamplerState::shaderDataLookup
+    };
+    for (auto const& lookup : lookups)
+    {
+        for (auto const& data : shader->GetData(lookup))
+        {
+            if (data.object)
+            {
+                Bind(data.object);
+            }
+        }
+    }
+}
+
+void DX11Engine::DestroyDeferredContexts()
+{
+    for (auto& context : mDeferredContexts)
+    {
+        DX11::FinalRelease(context);
+    }
+    mDeferredContexts.clear();
+}
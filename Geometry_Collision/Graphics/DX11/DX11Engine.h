@@ -113,6 +113,38 @@ namespace Vector_GM
         void BeginTimer(DX11PerformanceCounter& counter);
         void EndTimer(DX11PerformanceCounter& counter);
 
+        // Support for recording draw commands on multiple threads.  When
+        // numContexts is positive, Draw(visuals) and Draw(queue) split an
+        // array into contiguous subsets of at least minVisualsPerContext
+        // visuals, at most one subset per deferred context.  Tasks of
+        // TaskScheduler::GetDefault() record the subsets on the deferred
+        // contexts, and the command lists are executed on the immediate
+        // context in the order of the array, so the results are those of
+        // drawing on the immediate context.  Each deferred context starts
+        // with the render targets, viewports, scissor rectangles and global
+        // state of the immediate context.  The graphics objects of the
+        // visuals are bound on the calling thread before the recording,
+        // because the creation of some of them uses the immediate context.
+        // The visuals must not be modified during the Draw call.  Arrays
+        // that are too small to be split, and all arrays drawn while
+        // occlusion queries are allowed, are drawn on the immediate
+        // context.  Pass numContexts = 0 to disable the recording.  The
+        // function returns 'false' when the deferred contexts cannot be
+        // created, for example for a device created with the flag
+        // D3D11_CREATE_DEVICE_SINGLETHREADED.
+        bool EnableDeferredContexts(uint32_t numContexts, size_t minVisualsPerContext = 64);
+
+        inline uint32_t GetNumDeferredContexts() const
+        {
+            return static_cast<uint32_t>(mDeferredContexts.size());
+        }
+
+        // The return value is 'true' when the driver supports command lists.
+        // Otherwise the runtime emulates them, the recording is still done
+        // on multiple threads, but the execution of the command lists costs
+        // more than that of commands issued on the immediate context.
+        bool HasDriverCommandLists() const;
+
     private:
         // Helpers for construction and destruction.
         void Initialize(IDXGIAdapter* adapter, D3D_DRIVER_TYPE driverType,
@@ -127,30 +159,45 @@ namespace Vector_GM
         bool DestroySwapChain();
         bool DestroyBackBuffer();
 
-        // Support for drawing.
-        uint64_t DrawPrimitive(VertexBuffer const* vbuffer, IndexBuffer const* ibuffer);
+        // Support for drawing.  The draw commands are recorded on 'context',
+        // which is the immediate context or a deferred context.  Occlusion
+        // queries are issued only on the immediate context.
+        uint64_t DrawPrimitive(ID3D11DeviceContext* context, VertexBuffer const* vbuffer, IndexBuffer const* ibuffer);
         ID3D11Query* BeginOcclusionQuery();
         uint64_t EndOcclusionQuery(ID3D11Query* occlusionQuery);
 
         // Support for enabling and disabling resources used by shaders.
-        bool EnableShaders(std::shared_ptr<VisualEffect> const& effect, DX11VertexShader*& dxVShader, DX11GeometryShader*& dxGShader, DX11PixelShader*& dxPShader);
-        void DisableShaders(std::shared_ptr<VisualEffect> const& effect, DX11VertexShader* dxVShader, DX11GeometryShader* dxGShader, DX11PixelShader* dxPShader);
-        void Enable(Shader const* shader, DX11Shader* dxShader);
-        void Disable(Shader const* shader, DX11Shader* dxShader);
-        void EnableCBuffers(Shader const* shader, DX11Shader* dxShader);
-        void DisableCBuffers(Shader const* shader, DX11Shader* dxShader);
-        void EnableTBuffers(Shader const* shader, DX11Shader* dxShader);
-        void DisableTBuffers(Shader const* shader, DX11Shader* dxShader);
-        void EnableSBuffers(Shader const* shader, DX11Shader* dxShader);
-        void DisableSBuffers(Shader const* shader, DX11Shader* dxShader);
-        void EnableRBuffers(Shader const* shader, DX11Shader* dxShader);
-        void DisableRBuffers(Shader const* shader, DX11Shader* dxShader);
-        void EnableTextures(Shader const* shader, DX11Shader* dxShader);
-        void DisableTextures(Shader const* shader, DX11Shader* dxShader);
-        void EnableTextureArrays(Shader const* shader, DX11Shader* dxShader);
-        void DisableTextureArrays(Shader const* shader, DX11Shader* dxShader);
-        void EnableSamplers(Shader const* shader, DX11Shader* dxShader);
-        void DisableSamplers(Shader const* shader, DX11Shader* dxShader);
+        bool EnableShaders(ID3D11DeviceContext* context, std::shared_ptr<VisualEffect> const& effect, DX11VertexShader*& dxVShader, DX11GeometryShader*& dxGShader, DX11PixelShader*& dxPShader);
+        void DisableShaders(ID3D11DeviceContext* context, std::shared_ptr<VisualEffect> const& effect, DX11VertexShader* dxVShader, DX11GeometryShader* dxGShader, DX11PixelShader* dxPShader);
+        void Enable(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void Disable(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableResources(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableCBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableCBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableTBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableTBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableSBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableSBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableRBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableRBuffers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableTextures(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableTextures(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableTextureArrays(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableTextureArrays(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void EnableSamplers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+        void DisableSamplers(ID3D11DeviceContext* context, Shader const* shader, DX11Shader* dxShader);
+
+        // Support for recording draw commands on deferred contexts.
+        // RecordPrimitives draws the visuals as DrawPrimitives does, on the
+        // specified context.  DrawPrimitivesDeferred records subsets of the
+        // array on the deferred contexts and executes the command lists.
+        // BindDrawResources creates the graphics objects of a visual on the
+        // calling thread.
+        uint64_t RecordPrimitives(ID3D11DeviceContext* context, Visual* const* visuals, size_t numVisuals);
+        uint64_t DrawPrimitivesDeferred(std::vector<Visual*> const& visuals);
+        void BindDrawResources(Visual const* visual);
+        void BindDrawResources(Shader const* shader);
+        void DestroyDeferredContexts();
 
         // Inputs to the constructors.  If mUseDepth24Stencil8 is 'true', the
         // back buffer has a 24-bit depth and 8-bit stencil buffer.  If the
@@ -199,6 +246,10 @@ namespace Vector_GM
         // SetFullscreenState to toggle between windowed and fullscreen.
         std::map<std::wstring, bool> mFullscreenState;
 
+        // Support for multithreaded recording of draw commands.
+        std::vector<ID3D11DeviceContext*> mDeferredContexts;
+        size_t mMinVisualsPerContext;
+
 
         // Overrides from BaseEngine.
     public:
@@ -308,6 +359,14 @@ namespace Vector_GM
         // Flush the command buffer.
         virtual void Flush() override;
 
+        // Create a GPU timestamp profiler.
+        virtual std::shared_ptr<GPUProfiler> CreateGPUProfiler(size_t numFrames,
+            size_t maxScopes) override;
+
+        // Create an asynchronous readback of a buffer.
+        virtual std::shared_ptr<GPUReadback> CreateGPUReadback(
+            std::shared_ptr<Buffer> const& buffer, size_t numSlots) override;
+
     private:
         // Support for drawing.  If occlusion queries are enabled, the return
         // value is the number of samples that passed the depth and stencil
@@ -318,6 +377,8 @@ namespace Vector_GM
             std::shared_ptr<IndexBuffer> const& ibuffer,
             std::shared_ptr<VisualEffect> const& effect) override;
 
+        virtual uint64_t DrawPrimitives(std::vector<Visual*> const& visuals) override;
+
     public:
         // If the input texture does not match the back-buffer format and
         // dimensions, it will be recreated.
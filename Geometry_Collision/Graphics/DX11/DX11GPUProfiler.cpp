@@ -0,0 +1,91 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/DX11/GTGraphicsDX11PCH.h>
+#include <Graphics/DX11/DX11GPUProfiler.h>
+using namespace gte;
+
+DX11GPUProfiler::~DX11GPUProfiler()
+{
+    for (auto& query : mDisjointQueries)
+    {
+        DX11::FinalRelease(query);
+    }
+    for (auto& query : mTimestampQueries)
+    {
+        DX11::FinalRelease(query);
+    }
+}
+
+DX11GPUProfiler::DX11GPUProfiler(ID3D11Device* device, ID3D11DeviceContext* context,
+    size_t numFrames, size_t maxScopes)
+    :
+    GPUProfiler(numFrames, maxScopes),
+    mContext(context),
+    mDisjointQueries(numFrames, nullptr),
+    mTimestampQueries(numFrames * GetMaxTimestamps(), nullptr)
+{
+    LogAssert(device != nullptr && context != nullptr, "Input device or context is null.");
+
+    D3D11_QUERY_DESC desc{};
+    desc.Query = D3D11_QUERY_TIMESTAMP_DISJOINT;
+    desc.MiscFlags = D3D11_QUERY_MISC_NONE;
+    for (auto& query : mDisjointQueries)
+    {
+        DX11Log(device->CreateQuery(&desc, &query));
+    }
+
+    desc.Query = D3D11_QUERY_TIMESTAMP;
+    for (auto& query : mTimestampQueries)
+    {
+        DX11Log(device->CreateQuery(&desc, &query));
+    }
+}
+
+void DX11GPUProfiler::BeginQueries(size_t slot)
+{
+    mContext->Begin(mDisjointQueries[slot]);
+}
+
+void DX11GPUProfiler::WriteTimestamp(size_t slot, size_t t)
+{
+    mContext->End(mTimestampQueries[slot * GetMaxTimestamps() + t]);
+}
+
+void DX11GPUProfiler::EndQueries(size_t slot)
+{
+    mContext->End(mDisjointQueries[slot]);
+}
+
+bool DX11GPUProfiler::ReadTimestamps(size_t slot, size_t numTimestamps,
+    std::vector<uint64_t>& ticks, double& frequency, bool& valid)
+{
+    // The disjoint query ends after the last timestamp of the slot, so its
+    // results are available only when those of the timestamps are.
+    D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint{};
+    if (S_OK != mContext->GetData(mDisjointQueries[slot], &disjoint,
+        sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH))
+    {
+        return false;
+    }
+
+    ID3D11Query* const* queries = &mTimestampQueries[slot * GetMaxTimestamps()];
+    for (size_t t = 0; t < numTimestamps; ++t)
+    {
+        UINT64 value = 0;
+        if (S_OK != mContext->GetData(queries[t], &value, sizeof(value),
+            D3D11_ASYNC_GETDATA_DONOTFLUSH))
+        {
+            return false;
+        }
+        ticks[t] = static_cast<uint64_t>(value);
+    }
+
+    frequency = static_cast<double>(disjoint.Frequency);
+    valid = (FALSE == disjoint.Disjoint);
+    return true;
+}
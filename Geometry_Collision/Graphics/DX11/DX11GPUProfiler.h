@@ -0,0 +1,42 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/GPUProfiler.h>
+#include <Graphics/DX11/DX11.h>
+#include <vector>
+
+// The GPUProfiler for D3D11. Each frame slot has a timestamp-disjoint query
+// that brackets its timestamp queries and provides the frequency of the GPU
+// clock. The results are read with D3D11_ASYNC_GETDATA_DONOTFLUSH.
+
+namespace gte
+{
+    class DX11GPUProfiler : public GPUProfiler
+    {
+    public:
+        // Construction and destruction.
+        virtual ~DX11GPUProfiler();
+        DX11GPUProfiler(ID3D11Device* device, ID3D11DeviceContext* context,
+            size_t numFrames, size_t maxScopes);
+
+    protected:
+        virtual void BeginQueries(size_t slot) override;
+        virtual void WriteTimestamp(size_t slot, size_t t) override;
+        virtual void EndQueries(size_t slot) override;
+        virtual bool ReadTimestamps(size_t slot, size_t numTimestamps,
+            std::vector<uint64_t>& ticks, double& frequency, bool& valid) override;
+
+    private:
+        ID3D11DeviceContext* mContext;
+
+        // mDisjointQueries[slot] and mTimestampQueries[slot * maxTimestamps + t].
+        std::vector<ID3D11Query*> mDisjointQueries;
+        std::vector<ID3D11Query*> mTimestampQueries;
+    };
+}
@@ -0,0 +1,89 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/DX11/GTGraphicsDX11PCH.h>
+#include <Graphics/DX11/DX11GPUReadback.h>
+#include <cstring>
+using namespace gte;
+
+DX11GPUReadback::~DX11GPUReadback()
+{
+    for (auto& staging : mStaging)
+    {
+        DX11::FinalRelease(staging);
+    }
+    for (auto& query : mQueries)
+    {
+        DX11::FinalRelease(query);
+    }
+}
+
+DX11GPUReadback::DX11GPUReadback(ID3D11Device* device, ID3D11DeviceContext* context,
+    std::shared_ptr<Buffer> const& buffer, ID3D11Buffer* dxBuffer, size_t numSlots)
+    :
+    GPUReadback(buffer, numSlots),
+    mContext(context),
+    mDXBuffer(dxBuffer),
+    mStaging(numSlots, nullptr),
+    mQueries(numSlots, nullptr)
+{
+    LogAssert(device != nullptr && context != nullptr && dxBuffer != nullptr,
+        "Input device, context or buffer is null.");
+
+    D3D11_BUFFER_DESC desc{};
+    desc.ByteWidth = buffer->GetNumBytes();
+    desc.Usage = D3D11_USAGE_STAGING;
+    desc.BindFlags = D3D11_BIND_NONE;
+    desc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+    desc.MiscFlags = D3D11_RESOURCE_MISC_NONE;
+    desc.StructureByteStride = 0;
+    for (auto& staging : mStaging)
+    {
+        DX11Log(device->CreateBuffer(&desc, nullptr, &staging));
+    }
+
+    D3D11_QUERY_DESC queryDesc{};
+    queryDesc.Query = D3D11_QUERY_EVENT;
+    queryDesc.MiscFlags = D3D11_QUERY_MISC_NONE;
+    for (auto& query : mQueries)
+    {
+        DX11Log(device->CreateQuery(&queryDesc, &query));
+    }
+}
+
+void DX11GPUReadback::CopyToSlot(size_t slot, size_t offset, size_t numBytes)
+{
+    if (numBytes > 0)
+    {
+        UINT const first = static_cast<UINT>(offset);
+        D3D11_BOX box = { first, 0, 0, first + static_cast<UINT>(numBytes), 1, 1 };
+        mContext->CopySubresourceRegion(mStaging[slot], 0, 0, 0, 0, mDXBuffer, 0, &box);
+    }
+    mContext->End(mQueries[slot]);
+}
+
+bool DX11GPUReadback::ReadSlot(size_t slot, size_t numBytes, bool wait, char* data)
+{
+    BOOL done = FALSE;
+    UINT const flags = (wait ? 0 : D3D11_ASYNC_GETDATA_DONOTFLUSH);
+    while (S_OK != mContext->GetData(mQueries[slot], &done, sizeof(done), flags))
+    {
+        if (!wait)
+        {
+            return false;
+        }
+    }
+
+    if (numBytes > 0)
+    {
+        D3D11_MAPPED_SUBRESOURCE sub{};
+        DX11Log(mContext->Map(mStaging[slot], 0, D3D11_MAP_READ, 0, &sub));
+        std::memcpy(data, sub.pData, numBytes);
+        mContext->Unmap(mStaging[slot], 0);
+    }
+    return true;
+}
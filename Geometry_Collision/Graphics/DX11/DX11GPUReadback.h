@@ -0,0 +1,42 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/GPUReadback.h>
+#include <Graphics/DX11/DX11.h>
+#include <vector>
+
+// The GPUReadback for D3D11. Each slot has a staging buffer with CPU read
+// access and an event query that ends after the copy into it. The query
+// results are read with D3D11_ASYNC_GETDATA_DONOTFLUSH, so Map never waits
+// for the GPU when Poll reads a slot.
+
+namespace gte
+{
+    class DX11GPUReadback : public GPUReadback
+    {
+    public:
+        // Construction and destruction. The input dxBuffer is the GPU
+        // buffer of 'buffer'; keep the buffer bound to the engine while the
+        // readback exists.
+        virtual ~DX11GPUReadback();
+        DX11GPUReadback(ID3D11Device* device, ID3D11DeviceContext* context,
+            std::shared_ptr<Buffer> const& buffer, ID3D11Buffer* dxBuffer,
+            size_t numSlots);
+
+    protected:
+        virtual void CopyToSlot(size_t slot, size_t offset, size_t numBytes) override;
+        virtual bool ReadSlot(size_t slot, size_t numBytes, bool wait, char* data) override;
+
+    private:
+        ID3D11DeviceContext* mContext;
+        ID3D11Buffer* mDXBuffer;
+        std::vector<ID3D11Buffer*> mStaging;
+        std::vector<ID3D11Query*> mQueries;
+    };
+}
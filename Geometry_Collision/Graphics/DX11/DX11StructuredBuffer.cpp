@@ -40,6 +40,14 @@ DX11StructuredBuffer::DX11StructuredBuffer(ID3D11Device* device, StructuredBuffe
         desc.Usage = D3D11_USAGE_DYNAMIC;
         desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     }
+    else if (usage == Resource::Usage::STREAMING)
+    {
+        // The shader resource view covers the whole buffer, so a streaming
+        // structured buffer has one region and every update discards.  The
+        // driver renames the storage instead of waiting for the GPU.
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    }
     else  // usage == Resource::Usage::SHADER_OUTPUT
     {
         desc.Usage = D3D11_USAGE_DEFAULT;
@@ -7,6 +7,8 @@
 
 #include <Graphics/DX11/GTGraphicsDX11PCH.h>
 #include <Graphics/DX11/DX11VertexBuffer.h>
+#include <cstring>
+#include <vector>
 using namespace gte;
 
 DX11VertexBuffer::DX11VertexBuffer(ID3D11Device* device, VertexBuffer const* vbuffer)
@@ -30,6 +32,13 @@ DX11VertexBuffer::DX11VertexBuffer(ID3D11Device* device, VertexBuffer const* vbu
         desc.Usage = D3D11_USAGE_DYNAMIC;
         desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
     }
+    else if (usage == Resource::Usage::STREAMING)
+    {
+        mNumStreamRegions = Buffer::numStreamingRegions;
+        desc.ByteWidth *= mNumStreamRegions;
+        desc.Usage = D3D11_USAGE_DYNAMIC;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+    }
     else  // usage == Resource::Usage::SHADER_OUTPUT
     {
         LogError("Vertex output streams are not yet tested.");
@@ -43,8 +52,18 @@ DX11VertexBuffer::DX11VertexBuffer(ID3D11Device* device, VertexBuffer const* vbu
     ID3D11Buffer* buffer = nullptr;
     if (vbuffer->GetData())
     {
+        // The initial data of a streaming buffer is in region 0.
+        std::vector<char> initial;
+        char const* source = vbuffer->GetData();
+        if (mNumStreamRegions > 1)
+        {
+            initial.resize(desc.ByteWidth);
+            std::memcpy(initial.data(), source, vbuffer->GetNumBytes());
+            source = initial.data();
+        }
+
         D3D11_SUBRESOURCE_DATA data;
-        data.pSysMem = vbuffer->GetData();
+        data.pSysMem = source;
         data.SysMemPitch = 0;
         data.SysMemSlicePitch = 0;
         DX11Log(device->CreateBuffer(&desc, &data, &buffer));
@@ -86,11 +105,12 @@ void DX11VertexBuffer::Enable(ID3D11DeviceContext* context)
         // to 0.  The latter choice is made for GTEngine.  TODO:  Is there a
         // performance issue by setting offsets[0] to zero?  This depends on
         // what the input assembly stage does with the buffers when you
-        // enable them using IASetVertexBuffers.
+        // enable them using IASetVertexBuffers.  A streaming buffer is
+        // bound at the region written by the last update.
         ID3D11Buffer* buffers[1] = { GetDXBuffer() };
         VertexBuffer* vbuffer = GetVertexBuffer();
         UINT strides[1] = { vbuffer->GetElementSize() };
-        UINT offsets[1] = { 0 };
+        UINT offsets[1] = { GetStreamOffset() };
         context->IASetVertexBuffers(0, 1, buffers, strides, offsets);
     }
 }
@@ -15,6 +15,8 @@
 #include <Graphics/DX11/DX11.h>
 #include <Graphics/DX11/DX11Engine.h>
 #include <Graphics/DX11/DX11GraphicsObject.h>
+#include <Graphics/DX11/DX11GPUProfiler.h>
+#include <Graphics/DX11/DX11GPUReadback.h>
 #include <Graphics/DX11/DX11PerformanceCounter.h>
 
 // DX11/Engine/InputLayout
@@ -91,8 +91,8 @@ std::shared_ptr<ComputeProgram> HLSLProgramFactory::CreateFromNamedSource(
 {
     LogAssert(csSource != "", "A program must have a compute shader.");
 
-    HLSLReflection hlslCShader = HLSLShaderFactory::CreateFromString(csName,
-        csSource, csEntry, std::string("cs_") + version, defines, flags);
+    HLSLReflection hlslCShader = CreateShader(csName, csSource, csEntry,
+        std::string("cs_") + version);
     if (hlslCShader.IsValid())
     {
         auto cshader = std::make_shared<HLSLShader>(hlslCShader, GT_COMPUTE_SHADER);
@@ -118,8 +118,8 @@ std::shared_ptr<VisualProgram> HLSLProgramFactory::CreateFromNamedSources(
     std::shared_ptr<HLSLShader> pshader;
     std::shared_ptr<HLSLShader> gshader;
 
-    HLSLReflection hlslVShader = HLSLShaderFactory::CreateFromString(vsName,
-        vsSource, vsEntry, std::string("vs_") + version, defines, flags);
+    HLSLReflection hlslVShader = CreateShader(vsName, vsSource, vsEntry,
+        std::string("vs_") + version);
     if (hlslVShader.IsValid())
     {
         vshader = std::make_shared<HLSLShader>(hlslVShader, GT_VERTEX_SHADER);
@@ -129,8 +129,8 @@ std::shared_ptr<VisualProgram> HLSLProgramFactory::CreateFromNamedSources(
         return nullptr;
     }
 
-    HLSLReflection hlslPShader = HLSLShaderFactory::CreateFromString(psName,
-        psSource, psEntry, std::string("ps_") + version, defines, flags);
+    HLSLReflection hlslPShader = CreateShader(psName, psSource, psEntry,
+        std::string("ps_") + version);
     if (hlslPShader.IsValid())
     {
         pshader = std::make_shared<HLSLShader>(hlslPShader, GT_PIXEL_SHADER);
@@ -143,8 +143,8 @@ std::shared_ptr<VisualProgram> HLSLProgramFactory::CreateFromNamedSources(
     HLSLReflection hlslGShader;
     if (gsSource != "")
     {
-        hlslGShader = HLSLShaderFactory::CreateFromString(gsName,
-            gsSource, gsEntry, std::string("gs_") + version, defines, flags);
+        hlslGShader = CreateShader(gsName, gsSource, gsEntry,
+            std::string("gs_") + version);
         if (hlslGShader.IsValid())
         {
             gshader = std::make_shared<HLSLShader>(hlslGShader, GT_GEOMETRY_SHADER);
@@ -183,6 +183,38 @@ std::shared_ptr<ComputeProgram> HLSLProgramFactory::CreateFromBytecode(
     }
 }
 
+HLSLReflection HLSLProgramFactory::CreateShader(std::string const& name,
+    std::string const& source, std::string const& entry, std::string const& target)
+{
+    if (!cache)
+    {
+        return HLSLShaderFactory::CreateFromString(name, source, entry, target,
+            defines, flags);
+    }
+
+    uint64_t const key = GetCacheKey({ &source, &entry, &target });
+    std::vector<uint8_t> bytecode;
+    if (cache->Load(key, bytecode))
+    {
+        // The reflection data are obtained from the bytecode without
+        // invoking the compiler.
+        HLSLReflection shader = HLSLShaderFactory::CreateFromBytecode(name,
+            entry, target, bytecode.size(), bytecode.data());
+        if (shader.IsValid())
+        {
+            return shader;
+        }
+    }
+
+    HLSLReflection shader = HLSLShaderFactory::CreateFromString(name, source,
+        entry, target, defines, flags);
+    if (shader.IsValid())
+    {
+        auto const& compiledCode = shader.GetCompiledCode();
+        cache->Save(key, compiledCode.data(), compiledCode.size());
+    }
+    return shader;
+}
 
 std::string HLSLProgramFactory::defaultVersion = "5_0";
 std::string HLSLProgramFactory::defaultVSEntry = "VSMain";
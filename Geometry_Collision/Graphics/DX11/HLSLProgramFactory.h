@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Graphics/ProgramFactory.h>
+#include <Graphics/DX11/HLSLReflection.h>
 
 namespace gte
 {
@@ -60,5 +61,11 @@ namespace gte
         // this for #include path searches.
         virtual std::shared_ptr<ComputeProgram> CreateFromNamedSource(
             std::string const& csName, std::string const& csSource);
+
+        // Compile a shader with the current defines and flags. When the
+        // factory has a cache, the bytecode is loaded from the cache if
+        // possible and stored in the cache otherwise.
+        HLSLReflection CreateShader(std::string const& name, std::string const& source,
+            std::string const& entry, std::string const& target);
     };
 }
@@ -0,0 +1,128 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/DrawTargetPool.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+using namespace gte;
+
+DrawTargetPool::DrawTargetPool(uint32_t numIdleFrames)
+    :
+    mNumIdleFrames(numIdleFrames),
+    mFrame(0),
+    mNumCreated(0),
+    mEntries{}
+{
+    LogAssert(numIdleFrames > 0, "A target must survive the frame of its use.");
+}
+
+std::shared_ptr<DrawTarget> DrawTargetPool::Acquire(uint32_t numRenderTargets,
+    uint32_t rtFormat, uint32_t width, uint32_t height, bool hasRTMipmaps,
+    uint32_t dsFormat)
+{
+    for (auto& entry : mEntries)
+    {
+        if (!entry.acquired
+            && entry.numRenderTargets == numRenderTargets
+            && entry.rtFormat == rtFormat
+            && entry.width == width
+            && entry.height == height
+            && entry.hasRTMipmaps == hasRTMipmaps
+            && entry.dsFormat == dsFormat)
+        {
+            entry.acquired = true;
+            entry.lastFrame = mFrame;
+            return entry.target;
+        }
+    }
+
+    Entry entry{};
+    entry.target = std::make_shared<DrawTarget>(numRenderTargets, rtFormat,
+        width, height, hasRTMipmaps, false, dsFormat, false);
+    entry.numRenderTargets = numRenderTargets;
+    entry.rtFormat = rtFormat;
+    entry.width = width;
+    entry.height = height;
+    entry.dsFormat = dsFormat;
+    entry.hasRTMipmaps = hasRTMipmaps;
+    entry.acquired = true;
+    entry.lastFrame = mFrame;
+    mEntries.push_back(entry);
+    ++mNumCreated;
+    return entry.target;
+}
+
+void DrawTargetPool::Release(std::shared_ptr<DrawTarget> const& target)
+{
+    for (auto& entry : mEntries)
+    {
+        if (entry.target == target)
+        {
+            LogAssert(entry.acquired, "The target was released twice.");
+            entry.acquired = false;
+            return;
+        }
+    }
+    LogError("The target is not in the pool.");
+}
+
+void DrawTargetPool::EndFrame()
+{
+    // Destroying a target notifies the engines, which destroy the
+    // graphics-API objects of the target.
+    uint64_t const frame = mFrame;
+    uint64_t const numIdleFrames = mNumIdleFrames;
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+        [frame, numIdleFrames](Entry const& entry)
+        {
+            return frame - entry.lastFrame >= numIdleFrames;
+        }),
+        mEntries.end());
+
+    for (auto& entry : mEntries)
+    {
+        entry.acquired = false;
+    }
+    ++mFrame;
+}
+
+void DrawTargetPool::Clear()
+{
+    mEntries.clear();
+}
+
+size_t DrawTargetPool::GetNumAcquired() const
+{
+    size_t numAcquired = 0;
+    for (auto const& entry : mEntries)
+    {
+        if (entry.acquired)
+        {
+            ++numAcquired;
+        }
+    }
+    return numAcquired;
+}
+
+size_t DrawTargetPool::GetNumBytes() const
+{
+    size_t numBytes = 0;
+    for (auto const& entry : mEntries)
+    {
+        DrawTarget const& target = *entry.target;
+        for (uint32_t i = 0; i < target.GetNumTargets(); ++i)
+        {
+            numBytes += target.GetRTTexture(i)->GetNumBytes();
+        }
+        if (target.GetDSTexture())
+        {
+            numBytes += target.GetDSTexture()->GetNumBytes();
+        }
+    }
+    return numBytes;
+}
@@ -0,0 +1,98 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/DrawTarget.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A pool of draw targets that are needed only while a pass is drawn, for
+// example the intermediate targets of reflection, shadow or post-processing
+// passes. Acquire returns a pooled target of the requested description that
+// is not in use and creates one only when there is none. Release returns the
+// target to the pool, so passes whose targets are not in use at the same
+// time share one target and its video memory, and no target is created in
+// the frames after the first. EndFrame releases the targets that are still
+// acquired and destroys the targets that were not acquired during the last
+// numIdleFrames frames, which also destroys their graphics-API objects.
+//
+// The resources of the engine own their video memory, so targets of
+// different descriptions cannot alias each other's memory; the sharing is of
+// whole targets. The contents of an acquired target are those of its
+// previous pass, so clear the target after enabling it. The targets have no
+// CPU storage.
+//
+//   // Every frame:
+//   auto target = pool.Acquire(1, DF_R8G8B8A8_UNORM, width, height,
+//       false, DF_D24_UNORM_S8_UINT);
+//   engine->Enable(target);
+//   engine->ClearBuffers();
+//   <draw the pass>
+//   engine->Disable(target);
+//   <draw with target->GetRTTexture(0)>
+//   pool.Release(target);
+//   ...
+//   pool.EndFrame();
+
+namespace gte
+{
+    class DrawTargetPool
+    {
+    public:
+        DrawTargetPool(uint32_t numIdleFrames = 2);
+        ~DrawTargetPool() = default;
+
+        // The parameters are those of the DrawTarget constructor without the
+        // storage flags.
+        std::shared_ptr<DrawTarget> Acquire(uint32_t numRenderTargets,
+            uint32_t rtFormat, uint32_t width, uint32_t height,
+            bool hasRTMipmaps = false, uint32_t dsFormat = DF_UNKNOWN);
+
+        // Return a target obtained by Acquire to the pool. The caller must
+        // not use the target after the call.
+        void Release(std::shared_ptr<DrawTarget> const& target);
+
+        // Release all acquired targets, advance the frame counter and
+        // destroy the targets that were idle too long.
+        void EndFrame();
+
+        // Destroy all targets, for example when the window is resized.
+        void Clear();
+
+        // Statistics. The bytes are those of the textures of the targets in
+        // the pool, which approximate the video memory of the targets.
+        inline size_t GetNumTargets() const
+        {
+            return mEntries.size();
+        }
+
+        size_t GetNumAcquired() const;
+        size_t GetNumBytes() const;
+
+        inline uint64_t GetNumCreated() const
+        {
+            return mNumCreated;
+        }
+
+    private:
+        struct Entry
+        {
+            std::shared_ptr<DrawTarget> target;
+            uint32_t numRenderTargets, rtFormat, width, height, dsFormat;
+            bool hasRTMipmaps, acquired;
+            uint64_t lastFrame;
+        };
+
+        uint32_t mNumIdleFrames;
+        uint64_t mFrame;
+        uint64_t mNumCreated;
+        std::vector<Entry> mEntries;
+    };
+}
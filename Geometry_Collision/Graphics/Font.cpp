@@ -89,8 +89,9 @@ Font::Font(std::shared_ptr<ProgramFactory> const& factory,
     std::memcpy(mTexture->GetData(), texels, mTexture->GetNumBytes());
     std::memcpy(mCharacterData, characterData, 257 * sizeof(float));
 
-    // Create an effect for drawing text.
+    // Create the effects for drawing text.
     mTextEffect = std::make_shared<TextEffect>(factory, mTexture);
+    mTextBatchEffect = std::make_shared<TextBatchEffect>(factory, mTexture);
 }
 
 int32_t Font::GetHeight() const
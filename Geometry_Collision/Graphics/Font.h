@@ -7,6 +7,7 @@
 
 #pragma once
 
+#include <Graphics/TextBatchEffect.h>
 #include <Graphics/TextEffect.h>
 #include <Graphics/VertexBuffer.h>
 #include <Graphics/IndexBuffer.h>
@@ -31,6 +32,24 @@ namespace gte
             return mTextEffect;
         }
 
+        // The effect of TextBatch, which shares the font texture.
+        inline std::shared_ptr<TextBatchEffect> const& GetTextBatchEffect() const
+        {
+            return mTextBatchEffect;
+        }
+
+        inline std::shared_ptr<Texture2> const& GetTexture() const
+        {
+            return mTexture;
+        }
+
+        // The texture x-coordinates of the left edges of the characters;
+        // character c spans [data[c], data[c+1]].
+        inline float const* GetCharacterData() const
+        {
+            return mCharacterData;
+        }
+
         inline std::shared_ptr<VertexBuffer> const& GetVertexBuffer() const
         {
             return mVertexBuffer;
@@ -54,6 +73,7 @@ namespace gte
         std::shared_ptr<IndexBuffer> mIndexBuffer;
         std::shared_ptr<Texture2> mTexture;
         std::shared_ptr<TextEffect> mTextEffect;
+        std::shared_ptr<TextBatchEffect> mTextBatchEffect;
         float mCharacterData[257];
     };
 }
@@ -0,0 +1,203 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GL45/GTGraphicsGL45PCH.h>
+#include <Graphics/GL45/EGL/EGLEngine.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+using namespace gte;
+
+// Defined in GLXExtensions.cpp. The OpenGL function pointers of an EGL
+// context must be queried with eglGetProcAddress.
+extern bool gUseEGLGetProcAddress;
+
+namespace
+{
+    bool HasExtension(char const* extensions, char const* name)
+    {
+        if (!extensions)
+        {
+            return false;
+        }
+
+        size_t const length = std::strlen(name);
+        for (char const* found = std::strstr(extensions, name); found;
+            found = std::strstr(found + length, name))
+        {
+            bool const atStart = (found == extensions || found[-1] == ' ');
+            bool const atEnd = (found[length] == ' ' || found[length] == '\0');
+            if (atStart && atEnd)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    EGLDisplay GetHeadlessDisplay()
+    {
+        // Prefer a GPU device, which does not require a window system.
+        char const* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        if (HasExtension(clientExtensions, "EGL_EXT_device_enumeration") &&
+            HasExtension(clientExtensions, "EGL_EXT_platform_device"))
+        {
+            auto queryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(
+                eglGetProcAddress("eglQueryDevicesEXT"));
+            auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+                eglGetProcAddress("eglGetPlatformDisplayEXT"));
+            EGLDeviceEXT device = nullptr;
+            EGLint numDevices = 0;
+            if (queryDevices && getPlatformDisplay &&
+                queryDevices(1, &device, &numDevices) && numDevices > 0)
+            {
+                EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, device, nullptr);
+                if (display != EGL_NO_DISPLAY)
+                {
+                    return display;
+                }
+            }
+        }
+        return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    }
+}
+
+EGLEngine::~EGLEngine()
+{
+    Terminate();
+}
+
+EGLEngine::EGLEngine(bool saveDriverInfo, int32_t requiredMajor, int32_t requiredMinor)
+    :
+    GL45Engine(),
+    mDisplay(nullptr),
+    mSurface(nullptr),
+    mImmediate(nullptr)
+{
+    EGLDisplay display = GetHeadlessDisplay();
+    EGLint major = 0, minor = 0;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+    {
+        LogError("eglInitialize failed.");
+        return;
+    }
+    mDisplay = display;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+    {
+        LogError("eglBindAPI failed.");
+        return;
+    }
+
+    // The configuration is needed only for the context; compute programs
+    // do not use the color, depth or stencil buffers.
+    EGLint const configAttributes[] =
+    {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE, 8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttributes, &config, 1, &numConfigs) || numConfigs == 0)
+    {
+        LogError("eglChooseConfig failed.");
+        return;
+    }
+
+    EGLint const contextAttributes[] =
+    {
+        EGL_CONTEXT_MAJOR_VERSION, requiredMajor,
+        EGL_CONTEXT_MINOR_VERSION, requiredMinor,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    mImmediate = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (mImmediate == EGL_NO_CONTEXT)
+    {
+        mImmediate = nullptr;
+        LogError("eglCreateContext failed.");
+        return;
+    }
+
+    mXSize = 16;
+    mYSize = 16;
+    if (!HasExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context"))
+    {
+        EGLint const surfaceAttributes[] =
+        {
+            EGL_WIDTH, static_cast<EGLint>(mXSize),
+            EGL_HEIGHT, static_cast<EGLint>(mYSize),
+            EGL_NONE
+        };
+        mSurface = eglCreatePbufferSurface(display, config, surfaceAttributes);
+        if (mSurface == EGL_NO_SURFACE)
+        {
+            mSurface = nullptr;
+            LogError("eglCreatePbufferSurface failed.");
+            return;
+        }
+    }
+
+    Initialize(requiredMajor, requiredMinor, false, saveDriverInfo);
+}
+
+bool EGLEngine::IsActive() const
+{
+    return mImmediate == eglGetCurrentContext();
+}
+
+void EGLEngine::MakeActive()
+{
+    if (mImmediate != eglGetCurrentContext())
+    {
+        EGLSurface surface = (mSurface ? mSurface : EGL_NO_SURFACE);
+        eglMakeCurrent(mDisplay, surface, surface, mImmediate);
+    }
+}
+
+void EGLEngine::DisplayColorBuffer(uint32_t)
+{
+}
+
+bool EGLEngine::Initialize(int32_t requiredMajor, int32_t requiredMinor, bool useDepth24Stencil8, bool saveDriverInfo)
+{
+    EGLSurface surface = (mSurface ? mSurface : EGL_NO_SURFACE);
+    if (!eglMakeCurrent(mDisplay, surface, surface, mImmediate))
+    {
+        LogError("eglMakeCurrent failed.");
+        return false;
+    }
+
+    // Get the function pointers for OpenGL; initialize the viewport,
+    // default global state, and default font.
+    gUseEGLGetProcAddress = true;
+    return GL45Engine::Initialize(requiredMajor, requiredMinor, useDepth24Stencil8, saveDriverInfo);
+}
+
+void EGLEngine::Terminate()
+{
+    GL45Engine::Terminate();
+
+    if (mDisplay)
+    {
+        eglMakeCurrent(mDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (mSurface)
+        {
+            eglDestroySurface(mDisplay, mSurface);
+        }
+        if (mImmediate)
+        {
+            eglDestroyContext(mDisplay, mImmediate);
+        }
+        eglTerminate(mDisplay);
+    }
+}
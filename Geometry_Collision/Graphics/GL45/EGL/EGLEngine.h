@@ -0,0 +1,59 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/GL45/GL45Engine.h>
+
+namespace gte
+{
+    class EGLEngine : public GL45Engine
+    {
+    public:
+        // Construction and destruction. The engine is for windowless
+        // compute-program applications on machines without an X server,
+        // such as render-farm nodes. The OpenGL context is created through
+        // EGL on the first GPU reported by EGL_EXT_device_enumeration, or
+        // on the default EGL display when that extension is not available.
+        // The context has no surface when EGL_KHR_surfaceless_context is
+        // supported; otherwise it uses a 16x16 pbuffer. Drawing to the
+        // back buffer is not supported, but draw targets can be used.
+        virtual ~EGLEngine();
+        EGLEngine(bool saveDriverInfo = false, int32_t requiredMajor = 4, int32_t requiredMinor = 3);
+
+        // Member access. The display is nullptr when the construction
+        // failed.
+        inline void* GetDisplay() const
+        {
+            return mDisplay;
+        }
+
+        inline void* GetImmediate() const
+        {
+            return mImmediate;
+        }
+
+        // Allow the user to switch between OpenGL contexts when there are
+        // multiple instances of GL4Engine in an application.
+        virtual bool IsActive() const override;
+        virtual void MakeActive() override;
+
+        // There is no color buffer to display; the function does nothing.
+        virtual void DisplayColorBuffer(uint32_t syncInterval) override;
+
+    private:
+        // Helpers for construction and destruction.
+        virtual bool Initialize(int32_t requiredMajor, int32_t requiredMinor, bool useDepth24Stencil8, bool saveDriverInfo) override;
+        void Terminate();
+
+        // The EGLDisplay, EGLSurface and EGLContext handles, stored as
+        // void* to avoid exposing EGL/egl.h to the clients.
+        void* mDisplay;
+        void* mSurface;
+        void* mImmediate;
+    };
+}
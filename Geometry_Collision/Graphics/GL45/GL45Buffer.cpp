@@ -7,17 +7,32 @@
 
 #include <Graphics/GL45/GTGraphicsGL45PCH.h>
 #include <Graphics/GL45/GL45Buffer.h>
+#include <algorithm>
+#include <cstring>
 using namespace gte;
 
 GL45Buffer::~GL45Buffer()
 {
+    for (auto& fence : mStreamFences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+
+    // Deleting a buffer unmaps it.
     glDeleteBuffers(1, &mGLHandle);
 }
 
 GL45Buffer::GL45Buffer(Buffer const* buffer, GLenum type)
     :
     GL45Resource(buffer),
-    mType(type)
+    mType(type),
+    mStreamRegion(0),
+    mStreamRegionBytes(0),
+    mStreamData(nullptr),
+    mStreamFences{}
 {
     glGenBuffers(1, &mGLHandle);
 
@@ -30,6 +45,11 @@ GL45Buffer::GL45Buffer(Buffer const* buffer, GLenum type)
     {
         mUsage = GL_DYNAMIC_DRAW;
     }
+    else if (usage == Resource::Usage::STREAMING)
+    {
+        // The hint is not used; Initialize() allocates immutable storage.
+        mUsage = GL_STREAM_DRAW;
+    }
     else  // usage == Resource::Usage::SHADER_OUTPUT
     {
         // TODO: In GLSL, is it possible to write to a buffer other than a
@@ -57,8 +77,36 @@ void GL45Buffer::Initialize()
     // Access the buffer.
     auto buffer = GetBuffer();
 
-    // Create and initialize a buffer.
-    glBufferData(mType, buffer->GetNumBytes(), buffer->GetData(), mUsage);
+    if (buffer->GetUsage() == Resource::Usage::STREAMING)
+    {
+        // The regions start at multiples of the shader storage offset
+        // alignment so that each one can be bound by glBindBufferRange.
+        GLint alignment = 256;
+        GLint storageAlignment = 0;
+        glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageAlignment);
+        alignment = std::max(alignment, storageAlignment);
+        GLintptr numBytes = static_cast<GLintptr>(buffer->GetNumBytes());
+        mStreamRegionBytes = ((numBytes + alignment - 1) / alignment) * alignment;
+
+        // Create immutable storage and map it for the lifetime of the
+        // buffer.  The coherent mapping makes CPU writes visible to the GPU
+        // without explicit flushes.
+        GLsizeiptr const totalBytes = static_cast<GLsizeiptr>(
+            mStreamRegionBytes * Buffer::numStreamingRegions);
+        GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(mType, totalBytes, nullptr, flags);
+        mStreamData = static_cast<char*>(glMapBufferRange(mType, 0, totalBytes, flags));
+        LogAssert(mStreamData != nullptr, "Failed to map the streaming buffer.");
+        if (buffer->GetData())
+        {
+            std::memcpy(mStreamData, buffer->GetData(), buffer->GetNumBytes());
+        }
+    }
+    else
+    {
+        // Create and initialize a buffer.
+        glBufferData(mType, buffer->GetNumBytes(), buffer->GetData(), mUsage);
+    }
 
     glBindBuffer(mType, 0);
 }
@@ -66,6 +114,11 @@ void GL45Buffer::Initialize()
 bool GL45Buffer::Update()
 {
     Buffer* buffer = GetBuffer();
+    if (buffer->GetUsage() == Resource::Usage::STREAMING)
+    {
+        return UpdateStream();
+    }
+
     LogAssert(buffer->GetUsage() == Resource::Usage::DYNAMIC_UPDATE,
         "Buffer usage is not DYNAMIC_UPDATE.");
 
@@ -129,3 +182,36 @@ bool GL45Buffer::CopyGpuToCpu()
     }
     return true;
 }
+
+bool GL45Buffer::UpdateStream()
+{
+    // The commands issued so far read the current region.  The fence is
+    // signaled when they complete.
+    mStreamFences[mStreamRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    // Wait until the GPU has finished reading the next region.  The wait is
+    // immediate unless the CPU is numStreamingRegions - 1 frames ahead.
+    mStreamRegion = (mStreamRegion + 1) % Buffer::numStreamingRegions;
+    GLsync& fence = mStreamFences[mStreamRegion];
+    if (fence)
+    {
+        GLuint64 const timeoutNanoseconds = 1000000;
+        GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNanoseconds);
+        while (result == GL_TIMEOUT_EXPIRED)
+        {
+            result = glClientWaitSync(fence, 0, timeoutNanoseconds);
+        }
+        glDeleteSync(fence);
+        fence = nullptr;
+        if (result == GL_WAIT_FAILED)
+        {
+            LogError("Failed to wait for the streaming buffer fence.");
+        }
+    }
+
+    // The region holds the data of numStreamingRegions updates ago, so all
+    // of the data is written.
+    Buffer* buffer = GetBuffer();
+    std::memcpy(mStreamData + GetStreamOffset(), buffer->GetData(), buffer->GetNumBytes());
+    return true;
+}
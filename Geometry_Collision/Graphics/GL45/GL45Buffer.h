@@ -9,6 +9,7 @@
 
 #include <Graphics/Buffer.h>
 #include <Graphics/GL45/GL45Resource.h>
+#include <array>
 
 namespace gte
 {
@@ -47,8 +48,26 @@ namespace gte
         virtual bool CopyCpuToGpu();
         virtual bool CopyGpuToCpu();
 
+        // Support for Resource::Usage::STREAMING.  The offset is that of the
+        // region written by the last Update call; it is 0 for the other
+        // usages.  Vertex and shader storage bindings must add it.
+        inline GLintptr GetStreamOffset() const
+        {
+            return static_cast<GLintptr>(mStreamRegion) * mStreamRegionBytes;
+        }
+
     protected:
+        bool UpdateStream();
+
         GLenum mType;
         GLenum mUsage;
+
+        // The storage of a streaming buffer is mapped persistently for its
+        // lifetime.  A region's fence is signaled when the GPU has executed
+        // the commands issued while the region was current.
+        uint32_t mStreamRegion;
+        GLintptr mStreamRegionBytes;
+        char* mStreamData;
+        std::array<GLsync, Buffer::numStreamingRegions> mStreamFences;
     };
 }
@@ -13,7 +13,10 @@
 #include <Graphics/GL45/GL45ConstantBuffer.h>
 #include <Graphics/GL45/GL45DepthStencilState.h>
 #include <Graphics/GL45/GL45DrawTarget.h>
+#include <Graphics/GL45/GL45GPUProfiler.h>
+#include <Graphics/GL45/GL45GPUReadback.h>
 #include <Graphics/GL45/GL45IndexBuffer.h>
+#include <Graphics/GL45/GL45IndirectArgumentsBuffer.h>
 #include <Graphics/GL45/GL45RasterizerState.h>
 #include <Graphics/GL45/GL45SamplerState.h>
 #include <Graphics/GL45/GL45StructuredBuffer.h>
@@ -34,7 +37,9 @@ GL45Engine::GL45Engine()
     :
     mMajor(0),
     mMinor(0),
-    mMeetsRequirements(false)
+    mMeetsRequirements(false),
+    mActiveProgram(0),
+    mNumElidedProgramBinds(0)
 {
     // Initialization of GraphicsEngine members that depend on GL45.
     mILMap = std::make_unique<GL45InputLayoutManager>();
@@ -51,7 +56,7 @@ GL45Engine::GL45Engine()
         &GL45StructuredBuffer::Create,
         nullptr, // TODO:  Implement TypedBuffer
         nullptr, // &DX11RawBuffer::Create,
-        nullptr, // &DX11IndirectArgumentsBuffer::Create,
+        &GL45IndirectArgumentsBuffer::Create,
         nullptr, // GT_TEXTURE (abstract base)
         nullptr, // GT_TEXTURE_SINGLE (abstract base)
         &GL45Texture1::Create,
@@ -79,6 +84,94 @@ GL45Engine::GL45Engine()
     mCreateGEDrawTarget = &GL45DrawTarget::Create;
 }
 
+void GL45Engine::DrawIndirect(std::shared_ptr<VertexBuffer> const& vbuffer,
+    std::shared_ptr<IndexBuffer> const& ibuffer, std::shared_ptr<VisualEffect> const& effect,
+    std::shared_ptr<Buffer> const& commands, uint32_t numDraws)
+{
+    LogAssert(vbuffer != nullptr && ibuffer != nullptr && effect != nullptr
+        && commands != nullptr, "Invalid input.");
+    LogAssert(ibuffer->IsIndexed(), "The index buffer must store indices.");
+
+    size_t const commandSize = 5 * sizeof(uint32_t);
+    bool const isStructured = (commands->GetType() == GT_STRUCTURED_BUFFER);
+    if (isStructured)
+    {
+        LogAssert(commands->GetElementSize() == commandSize &&
+            commands->GetNumElements() >= numDraws, "Invalid command buffer.");
+    }
+    else
+    {
+        LogAssert(commands->GetType() == GT_INDIRECT_ARGUMENTS_BUFFER &&
+            commands->GetNumBytes() >= commandSize * numDraws, "Invalid command buffer.");
+    }
+
+    if (numDraws == 0)
+    {
+        return;
+    }
+
+    GLSLVisualProgram* gl4program = dynamic_cast<GLSLVisualProgram*>(effect->GetProgram().get());
+    if (!gl4program)
+    {
+        LogError("A visual program must exist.");
+    }
+
+    auto programHandle = gl4program->GetProgramHandle();
+    UseProgram(programHandle);
+
+    if (EnableShaders(effect, programHandle))
+    {
+        // Enable the vertex buffer and input layout.
+        GL45InputLayoutManager* manager = GetInputLayoutManager();
+        if (vbuffer->StandardUsage())
+        {
+            auto gl4VBuffer = static_cast<GL45VertexBuffer*>(Bind(vbuffer));
+            GL45InputLayout* gl4Layout = manager->Bind(programHandle, gl4VBuffer->GetGLHandle(), vbuffer.get());
+            manager->Enable(gl4Layout, gl4VBuffer->GetStreamOffset());
+        }
+        else
+        {
+            manager->Disable();
+        }
+
+        // Enable the index buffer.
+        auto gl4IBuffer = static_cast<GL45IndexBuffer*>(Bind(ibuffer));
+        gl4IBuffer->Enable();
+
+        // Commands written by a compute program must be visible to the
+        // command fetch.
+        if (isStructured)
+        {
+            glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+        }
+
+        auto gl4Commands = static_cast<GL45Buffer*>(Bind(commands));
+        GLenum indexType = (ibuffer->GetElementSize() == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT);
+        void const* indirect = reinterpret_cast<void const*>(gl4Commands->GetStreamOffset());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, gl4Commands->GetGLHandle());
+        glMultiDrawElementsIndirect(GetTopology(ibuffer.get()), indexType, indirect,
+            static_cast<GLsizei>(numDraws), static_cast<GLsizei>(commandSize));
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+        // Disable the index buffer. The vertex array object stays current.
+        gl4IBuffer->Disable();
+
+        DisableShaders(effect, programHandle);
+    }
+}
+
+uint64_t GL45Engine::GetNumElidedBinds() const
+{
+    return mNumElidedProgramBinds + GetInputLayoutManager()->GetNumElidedBinds();
+}
+
+void GL45Engine::InvalidateBindings()
+{
+    glUseProgram(0);
+    mActiveProgram = 0;
+    GetInputLayoutManager()->Invalidate();
+}
+
 void GL45Engine::CreateDefaultFont()
 {
     std::shared_ptr<GLSLProgramFactory> factory = std::make_shared<GLSLProgramFactory>();
@@ -143,14 +236,9 @@ void GL45Engine::Terminate()
     DrawTarget::UnsubscribeForDestruction(mDTListener);
     mDTListener = nullptr;
 
-    mGOMapMutex.lock();
-    if (mGOMap.size() > 0)
-    {
-        // Bridge map is nonempty on destruction.
-        // TODO: In GTL, handle differently. The condition should not occur.
-        mGOMap.clear();
-    }
-    mGOMapMutex.unlock();
+    // The bridge may be nonempty on destruction.
+    // TODO: In GTL, handle differently. The condition should not occur.
+    ClearGEObjects();
 
     mDTMapMutex.lock();
     if (mDTMap.size() > 0)
@@ -176,9 +264,52 @@ uint64_t GL45Engine::DrawPrimitive(VertexBuffer const* vbuffer, IndexBuffer cons
     uint32_t vertexOffset = vbuffer->GetOffset();
 
     uint32_t numActiveIndices = ibuffer->GetNumActiveIndices();
+    uint32_t numInstances = ibuffer->GetNumInstances();
     uint32_t indexSize = ibuffer->GetElementSize();
     GLenum indexType = (indexSize == 4 ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT);
 
+    GLenum topology = GetTopology(ibuffer);
+
+    uint32_t offset = ibuffer->GetOffset();
+    if (ibuffer->IsIndexed())
+    {
+        void const* data = reinterpret_cast<void const*>(static_cast<size_t>(indexSize) * static_cast<size_t>(offset));
+        if (numInstances > 1)
+        {
+            glDrawElementsInstanced(topology, static_cast<GLsizei>(numActiveIndices),
+                indexType, data, static_cast<GLsizei>(numInstances));
+        }
+        else
+        {
+            glDrawRangeElements(topology, 0, numActiveVertices - 1,
+                static_cast<GLsizei>(numActiveIndices), indexType, data);
+        }
+    }
+    else
+    {
+        // From the OpenGL documentation on gl_VertexID vertex shader
+        // variable:  "gl_VertexID is a vertex language input variable that
+        // holds an integer index for the vertex. The index is implicitly
+        // generated by glDrawArrays and other commands that do not reference
+        // the content of the GL_ELEMENT_ARRAY_BUFFER, or explicitly generated
+        // from the content of the GL_ELEMENT_ARRAY_BUFFER by commands such as
+        // glDrawElements."
+        if (numInstances > 1)
+        {
+            glDrawArraysInstanced(topology, static_cast<GLint>(vertexOffset),
+                static_cast<GLsizei>(numActiveVertices), static_cast<GLsizei>(numInstances));
+        }
+        else
+        {
+            glDrawArrays(topology, static_cast<GLint>(vertexOffset),
+                static_cast<GLint>(numActiveVertices));
+        }
+    }
+    return 0;
+}
+
+GLenum GL45Engine::GetTopology(IndexBuffer const* ibuffer)
+{
     GLenum topology = 0;
     uint32_t type = ibuffer->GetPrimitiveType();
     switch (type)
@@ -213,27 +344,25 @@ uint64_t GL45Engine::DrawPrimitive(VertexBuffer const* vbuffer, IndexBuffer cons
     default:
         LogError("Unknown primitive topology = " + std::to_string(type));
     }
+    return topology;
+}
 
-    uint32_t offset = ibuffer->GetOffset();
-    if (ibuffer->IsIndexed())
+void GL45Engine::UseProgram(GLuint program)
+{
+    if (program != mActiveProgram)
     {
-        void const* data = reinterpret_cast<void const*>(static_cast<size_t>(indexSize) * static_cast<size_t>(offset));
-        glDrawRangeElements(topology, 0, numActiveVertices - 1,
-            static_cast<GLsizei>(numActiveIndices), indexType, data);
+        glUseProgram(program);
+        mActiveProgram = program;
     }
     else
     {
-        // From the OpenGL documentation on gl_VertexID vertex shader
-        // variable:  "gl_VertexID is a vertex language input variable that
-        // holds an integer index for the vertex. The index is implicitly
-        // generated by glDrawArrays and other commands that do not reference
-        // the content of the GL_ELEMENT_ARRAY_BUFFER, or explicitly generated
-        // from the content of the GL_ELEMENT_ARRAY_BUFFER by commands such as
-        // glDrawElements."
-        glDrawArrays(topology, static_cast<GLint>(vertexOffset),
-            static_cast<GLint>(numActiveVertices));
+        ++mNumElidedProgramBinds;
     }
-    return 0;
+}
+
+GL45InputLayoutManager* GL45Engine::GetInputLayoutManager() const
+{
+    return static_cast<GL45InputLayoutManager*>(mILMap.get());
 }
 
 bool GL45Engine::EnableShaders(std::shared_ptr<VisualEffect> const& effect, GLuint program)
@@ -398,9 +527,7 @@ void GL45Engine::EnableSBuffers(Shader const* shader, GLuint program)
             // Do a manual Bind operation because this is a special mapping
             // from RawBuffer to GL4AtomicCounterBuffer.
             auto temp = GL45AtomicCounterBuffer::Create(mGEObjectCreator, rawBuffer.get());
-            mGOMapMutex.lock();
-            mGOMap.insert(std::make_pair(rawBuffer.get(), temp));
-            mGOMapMutex.unlock();
+            InsertGEObject(rawBuffer.get(), temp);
             gl4ACB = static_cast<GL45AtomicCounterBuffer*>(temp.get());
         }
 
@@ -1233,11 +1360,15 @@ void GL45Engine::Execute(std::shared_ptr<ComputeProgram> const& program,
         auto programHandle = glslProgram->GetProgramHandle();
         if (cshader && programHandle > 0)
         {
-            glUseProgram(programHandle);
+            UseProgram(programHandle);
             Enable(cshader.get(), programHandle);
             glDispatchCompute(numXGroups, numYGroups, numZGroups);
+
+            // Make the writes to shader storage buffers visible to the next
+            // compute program and to CopyGpuToCpu, as Direct3D does for
+            // successive dispatches.
+            glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
             Disable(cshader.get(), programHandle);
-            glUseProgram(0);
         }
     }
     else
@@ -1259,6 +1390,19 @@ void GL45Engine::Flush()
     glFlush();
 }
 
+std::shared_ptr<GPUProfiler> GL45Engine::CreateGPUProfiler(size_t numFrames, size_t maxScopes)
+{
+    return std::make_shared<GL45GPUProfiler>(numFrames, maxScopes);
+}
+
+std::shared_ptr<GPUReadback> GL45Engine::CreateGPUReadback(std::shared_ptr<Buffer> const& buffer,
+    size_t numSlots)
+{
+    LogAssert(buffer != nullptr, "Input buffer is null.");
+    auto glBuffer = static_cast<GL45Buffer*>(Bind(buffer));
+    return std::make_shared<GL45GPUReadback>(buffer, glBuffer->GetGLHandle(), numSlots);
+}
+
 uint64_t GL45Engine::DrawPrimitive(std::shared_ptr<VertexBuffer> const& vbuffer,
     std::shared_ptr<IndexBuffer> const& ibuffer, std::shared_ptr<VisualEffect> const& effect)
 {
@@ -1270,19 +1414,21 @@ uint64_t GL45Engine::DrawPrimitive(std::shared_ptr<VertexBuffer> const& vbuffer,
 
     uint64_t numPixelsDrawn = 0;
     auto programHandle = gl4program->GetProgramHandle();
-    glUseProgram(programHandle);
+    UseProgram(programHandle);
 
     if (EnableShaders(effect, programHandle))
     {
         // Enable the vertex buffer and input layout.
-        GL45VertexBuffer* gl4VBuffer = nullptr;
-        GL45InputLayout* gl4Layout = nullptr;
+        GL45InputLayoutManager* manager = GetInputLayoutManager();
         if (vbuffer->StandardUsage())
         {
-            gl4VBuffer = static_cast<GL45VertexBuffer*>(Bind(vbuffer));
-            GL45InputLayoutManager* manager = static_cast<GL45InputLayoutManager*>(mILMap.get());
-            gl4Layout = manager->Bind(programHandle, gl4VBuffer->GetGLHandle(), vbuffer.get());
-            gl4Layout->Enable();
+            auto gl4VBuffer = static_cast<GL45VertexBuffer*>(Bind(vbuffer));
+            GL45InputLayout* gl4Layout = manager->Bind(programHandle, gl4VBuffer->GetGLHandle(), vbuffer.get());
+            manager->Enable(gl4Layout, gl4VBuffer->GetStreamOffset());
+        }
+        else
+        {
+            manager->Disable();
         }
 
         // Enable the index buffer.
@@ -1295,22 +1441,117 @@ uint64_t GL45Engine::DrawPrimitive(std::shared_ptr<VertexBuffer> const& vbuffer,
 
         numPixelsDrawn = DrawPrimitive(vbuffer.get(), ibuffer.get());
 
-        // Disable the vertex buffer and input layout.
-        if (vbuffer->StandardUsage())
+        // Disable the index buffer. The vertex array object stays current.
+        if (gl4IBuffer)
         {
-            gl4Layout->Disable();
+            gl4IBuffer->Disable();
         }
 
-        // Disable the index buffer.
+        DisableShaders(effect, programHandle);
+    }
+
+    return numPixelsDrawn;
+}
+
+uint64_t GL45Engine::DrawPrimitives(std::vector<Visual*> const& visuals)
+{
+    // A run is a sequence of consecutive visuals whose effects share a
+    // program.  The program is made current once per run.  The texture,
+    // uniform and storage units are assigned per program and index, so the
+    // resources of an effect are disabled before those of the next effect
+    // are enabled to keep the unit link counts balanced.  The vertex array
+    // object depends on the program, so it is looked up again in each run;
+    // the bind is skipped when the object is still current.
+    uint64_t numPixelsDrawn = 0;
+    GLuint activeProgram = 0;
+    VisualEffect const* activeEffect = nullptr;
+    std::shared_ptr<VisualEffect> runEffect{};
+    VertexBuffer const* activeVBuffer = nullptr;
+    IndexBuffer const* activeIBuffer = nullptr;
+    GL45InputLayoutManager* manager = GetInputLayoutManager();
+    GL45IndexBuffer* gl4IBuffer = nullptr;
+
+    auto endRun = [&]()
+    {
         if (gl4IBuffer)
         {
             gl4IBuffer->Disable();
+            gl4IBuffer = nullptr;
         }
+        if (runEffect)
+        {
+            DisableShaders(runEffect, activeProgram);
+            runEffect = nullptr;
+        }
+        activeProgram = 0;
+        activeEffect = nullptr;
+        activeVBuffer = nullptr;
+        activeIBuffer = nullptr;
+    };
 
-        DisableShaders(effect, programHandle);
-    }
+    for (auto const& visual : visuals)
+    {
+        auto const& vbuffer = visual->GetVertexBuffer();
+        auto const& ibuffer = visual->GetIndexBuffer();
+        auto const& effect = visual->GetEffect();
+        if (!vbuffer || !ibuffer || !effect)
+        {
+            continue;
+        }
 
-    glUseProgram(0);
+        GLSLVisualProgram* gl4program = dynamic_cast<GLSLVisualProgram*>(effect->GetProgram().get());
+        if (!gl4program)
+        {
+            LogError("A visual program must exist.");
+        }
+
+        auto programHandle = gl4program->GetProgramHandle();
+        if (programHandle != activeProgram)
+        {
+            endRun();
+            UseProgram(programHandle);
+            activeProgram = programHandle;
+        }
+
+        if (effect.get() != activeEffect)
+        {
+            if (runEffect)
+            {
+                DisableShaders(runEffect, activeProgram);
+            }
+            EnableShaders(effect, activeProgram);
+            activeEffect = effect.get();
+            runEffect = effect;
+        }
+
+        if (vbuffer.get() != activeVBuffer)
+        {
+            if (vbuffer->StandardUsage())
+            {
+                auto gl4VBuffer = static_cast<GL45VertexBuffer*>(Bind(vbuffer));
+                GL45InputLayout* gl4Layout = manager->Bind(activeProgram, gl4VBuffer->GetGLHandle(), vbuffer.get());
+                manager->Enable(gl4Layout, gl4VBuffer->GetStreamOffset());
+            }
+            else
+            {
+                manager->Disable();
+            }
+            activeVBuffer = vbuffer.get();
+
+            // The index buffer binding is part of the vertex array state.
+            activeIBuffer = nullptr;
+        }
+
+        if (ibuffer->IsIndexed() && ibuffer.get() != activeIBuffer)
+        {
+            gl4IBuffer = static_cast<GL45IndexBuffer*>(Bind(ibuffer));
+            gl4IBuffer->Enable();
+            activeIBuffer = ibuffer.get();
+        }
+
+        numPixelsDrawn += DrawPrimitive(vbuffer.get(), ibuffer.get());
+    }
 
+    endRun();
     return numPixelsDrawn;
 }
@@ -39,6 +39,36 @@ namespace gte
         virtual bool IsActive() const = 0;
         virtual void MakeActive() = 0;
 
+        // Draw indexed primitives for numDraws commands with one call to
+        // glMultiDrawElementsIndirect.  The draws share the effect, the
+        // vertex buffer and the index buffer.  Command i consists of the 5
+        // 32-bit values of DrawElementsIndirectCommand,
+        //   count, instanceCount, firstIndex, baseVertex, baseInstance,
+        // which is the layout of the DrawIndexedInstancedIndirect arguments
+        // of IndirectArgumentsBuffer.  The commands are stored in an
+        // IndirectArgumentsBuffer with at least 5*numDraws elements or in a
+        // StructuredBuffer with at least numDraws 20-byte elements.  The
+        // latter may be written by a compute program; a command barrier is
+        // issued before the draw so that the writes are visible to it.  A
+        // vertex shader can obtain the index of its draw from gl_DrawIDARB
+        // (GL_ARB_shader_draw_parameters) to look up per-draw data in a
+        // shader storage buffer.
+        void DrawIndirect(std::shared_ptr<VertexBuffer> const& vbuffer,
+            std::shared_ptr<IndexBuffer> const& ibuffer,
+            std::shared_ptr<VisualEffect> const& effect,
+            std::shared_ptr<Buffer> const& commands, uint32_t numDraws);
+
+        // The engine tracks the current program and vertex array object and
+        // skips glUseProgram and glBindVertexArray when the object is already
+        // current, so consecutive draws that share a program or a vertex
+        // buffer make fewer GL calls. Both stay current after a draw or a
+        // compute dispatch. GetNumElidedBinds returns the number of skipped
+        // calls since the engine was created. If an application makes GL
+        // calls that change these bindings, it must call InvalidateBindings
+        // before the next draw.
+        uint64_t GetNumElidedBinds() const;
+        void InvalidateBindings();
+
     protected:
         // Helpers for construction and destruction.
         virtual bool Initialize(int32_t requiredMajor, int32_t requiredMinor, bool useDepth24Stencil8, bool saveDriverInfo);
@@ -54,6 +84,9 @@ namespace gte
     private:
         // Support for drawing.
         uint64_t DrawPrimitive(VertexBuffer const* vbuffer, IndexBuffer const* ibuffer);
+        static GLenum GetTopology(IndexBuffer const* ibuffer);
+        void UseProgram(GLuint program);
+        GL45InputLayoutManager* GetInputLayoutManager() const;
 
         // Support for enabling and disabling resources used by shaders.
         bool EnableShaders(std::shared_ptr<VisualEffect> const& effect, GLuint program);
@@ -117,6 +150,10 @@ namespace gte
         ProgramIndexUnitMap mUniformUnitMap;
         ProgramIndexUnitMap mShaderStorageUnitMap;
 
+        // The program that is current in the context of the engine.
+        GLuint mActiveProgram;
+        uint64_t mNumElidedProgramBinds;
+
 
         // Overrides from GraphicsEngine.
     public:
@@ -238,6 +275,14 @@ namespace gte
         // Flush the command buffer.
         virtual void Flush() override;
 
+        // Create a GPU timestamp profiler.
+        virtual std::shared_ptr<GPUProfiler> CreateGPUProfiler(size_t numFrames,
+            size_t maxScopes) override;
+
+        // Create an asynchronous readback of a buffer.
+        virtual std::shared_ptr<GPUReadback> CreateGPUReadback(
+            std::shared_ptr<Buffer> const& buffer, size_t numSlots) override;
+
     private:
         // Support for drawing.  If occlusion queries are enabled, the return
         // value is the number of samples that passed the depth and stencil
@@ -247,5 +292,7 @@ namespace gte
             std::shared_ptr<VertexBuffer> const& vbuffer,
             std::shared_ptr<IndexBuffer> const& ibuffer,
             std::shared_ptr<VisualEffect> const& effect) override;
+
+        virtual uint64_t DrawPrimitives(std::vector<Visual*> const& visuals) override;
     };
 }
@@ -0,0 +1,63 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GL45/GTGraphicsGL45PCH.h>
+#include <Graphics/GL45/GL45GPUProfiler.h>
+using namespace gte;
+
+GL45GPUProfiler::~GL45GPUProfiler()
+{
+    glDeleteQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+}
+
+GL45GPUProfiler::GL45GPUProfiler(size_t numFrames, size_t maxScopes)
+    :
+    GPUProfiler(numFrames, maxScopes),
+    mQueries(numFrames * GetMaxTimestamps(), 0)
+{
+    glGenQueries(static_cast<GLsizei>(mQueries.size()), mQueries.data());
+}
+
+void GL45GPUProfiler::BeginQueries(size_t)
+{
+    // The GL_TIMESTAMP results are in nanoseconds and there is no
+    // disjoint query.
+}
+
+void GL45GPUProfiler::WriteTimestamp(size_t slot, size_t t)
+{
+    glQueryCounter(mQueries[slot * GetMaxTimestamps() + t], GL_TIMESTAMP);
+}
+
+void GL45GPUProfiler::EndQueries(size_t)
+{
+}
+
+bool GL45GPUProfiler::ReadTimestamps(size_t slot, size_t numTimestamps,
+    std::vector<uint64_t>& ticks, double& frequency, bool& valid)
+{
+    // The timestamps complete in order, so the results of the slot are
+    // available when those of its last timestamp are.
+    GLuint const* queries = &mQueries[slot * GetMaxTimestamps()];
+    GLint available = 0;
+    glGetQueryObjectiv(queries[numTimestamps - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (available == 0)
+    {
+        return false;
+    }
+
+    for (size_t t = 0; t < numTimestamps; ++t)
+    {
+        GLuint64 value = 0;
+        glGetQueryObjectui64v(queries[t], GL_QUERY_RESULT, &value);
+        ticks[t] = static_cast<uint64_t>(value);
+    }
+
+    frequency = 1e9;
+    valid = true;
+    return true;
+}
@@ -0,0 +1,39 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/GPUProfiler.h>
+#include <Graphics/GL45/GL45.h>
+#include <vector>
+
+// The GPUProfiler for OpenGL 4.5. The timestamps are glQueryCounter queries
+// of GL_TIMESTAMP, whose results are in nanoseconds. The OpenGL context of
+// the engine must be active when the profiler is created, used and
+// destroyed.
+
+namespace gte
+{
+    class GL45GPUProfiler : public GPUProfiler
+    {
+    public:
+        // Construction and destruction.
+        virtual ~GL45GPUProfiler();
+        GL45GPUProfiler(size_t numFrames, size_t maxScopes);
+
+    protected:
+        virtual void BeginQueries(size_t slot) override;
+        virtual void WriteTimestamp(size_t slot, size_t t) override;
+        virtual void EndQueries(size_t slot) override;
+        virtual bool ReadTimestamps(size_t slot, size_t numTimestamps,
+            std::vector<uint64_t>& ticks, double& frequency, bool& valid) override;
+
+    private:
+        // mQueries[slot * maxTimestamps + t].
+        std::vector<GLuint> mQueries;
+    };
+}
@@ -0,0 +1,82 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GL45/GTGraphicsGL45PCH.h>
+#include <Graphics/GL45/GL45GPUReadback.h>
+using namespace gte;
+
+GL45GPUReadback::~GL45GPUReadback()
+{
+    for (auto& fence : mFences)
+    {
+        if (fence)
+        {
+            glDeleteSync(fence);
+        }
+    }
+    glDeleteBuffers(static_cast<GLsizei>(mStaging.size()), mStaging.data());
+}
+
+GL45GPUReadback::GL45GPUReadback(std::shared_ptr<Buffer> const& buffer,
+    GLuint glBuffer, size_t numSlots)
+    :
+    GPUReadback(buffer, numSlots),
+    mGLBuffer(glBuffer),
+    mStaging(numSlots, 0),
+    mFences(numSlots, nullptr)
+{
+    LogAssert(glBuffer != 0, "Input buffer is not bound.");
+
+    glGenBuffers(static_cast<GLsizei>(mStaging.size()), mStaging.data());
+    for (auto staging : mStaging)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, staging);
+        glBufferData(GL_COPY_WRITE_BUFFER, buffer->GetNumBytes(), nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+void GL45GPUReadback::CopyToSlot(size_t slot, size_t offset, size_t numBytes)
+{
+    if (numBytes > 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, mGLBuffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mStaging[slot]);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+            static_cast<GLintptr>(offset), 0, static_cast<GLsizeiptr>(numBytes));
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+    mFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+bool GL45GPUReadback::ReadSlot(size_t slot, size_t numBytes, bool wait, char* data)
+{
+    // The first test flushes the fence so that it signals even when the
+    // application does not swap buffers. A wait tests it every millisecond.
+    GLenum status = glClientWaitSync(mFences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+    while (status == GL_TIMEOUT_EXPIRED && wait)
+    {
+        status = glClientWaitSync(mFences[slot], 0, 1000000);
+    }
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        return false;
+    }
+    LogAssert(status != GL_WAIT_FAILED, "glClientWaitSync failed.");
+
+    glDeleteSync(mFences[slot]);
+    mFences[slot] = nullptr;
+
+    if (numBytes > 0)
+    {
+        glBindBuffer(GL_COPY_WRITE_BUFFER, mStaging[slot]);
+        glGetBufferSubData(GL_COPY_WRITE_BUFFER, 0, static_cast<GLsizeiptr>(numBytes), data);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    return true;
+}
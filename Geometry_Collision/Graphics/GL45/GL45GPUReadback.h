@@ -0,0 +1,41 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/GPUReadback.h>
+#include <Graphics/GL45/GL45.h>
+#include <vector>
+
+// The GPUReadback for OpenGL 4.5. Each slot has a staging buffer created
+// with GL_STREAM_READ, the copy into it is glCopyBufferSubData and its fence
+// is a glFenceSync object that Poll tests with a zero timeout. The OpenGL
+// context of the engine must be active when the readback is created, used
+// and destroyed.
+
+namespace gte
+{
+    class GL45GPUReadback : public GPUReadback
+    {
+    public:
+        // Construction and destruction. The input glBuffer is the OpenGL
+        // buffer of 'buffer'; keep the buffer bound to the engine while the
+        // readback exists.
+        virtual ~GL45GPUReadback();
+        GL45GPUReadback(std::shared_ptr<Buffer> const& buffer, GLuint glBuffer,
+            size_t numSlots);
+
+    protected:
+        virtual void CopyToSlot(size_t slot, size_t offset, size_t numBytes) override;
+        virtual bool ReadSlot(size_t slot, size_t numBytes, bool wait, char* data) override;
+
+    private:
+        GLuint mGLBuffer;
+        std::vector<GLuint> mStaging;
+        std::vector<GLsync> mFences;
+    };
+}
@@ -0,0 +1,28 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GL45/GTGraphicsGL45PCH.h>
+#include <Graphics/GL45/GL45IndirectArgumentsBuffer.h>
+using namespace gte;
+
+GL45IndirectArgumentsBuffer::GL45IndirectArgumentsBuffer(IndirectArgumentsBuffer const* iabuffer)
+    :
+    GL45Buffer(iabuffer, GL_DRAW_INDIRECT_BUFFER)
+{
+    Initialize();
+}
+
+std::shared_ptr<GEObject> GL45IndirectArgumentsBuffer::Create(void*, GraphicsObject const* object)
+{
+    if (object->GetType() == GT_INDIRECT_ARGUMENTS_BUFFER)
+    {
+        return std::make_shared<GL45IndirectArgumentsBuffer>(
+            static_cast<IndirectArgumentsBuffer const*>(object));
+    }
+
+    LogError("Invalid object type.");
+}
@@ -0,0 +1,372 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/GL45/GL45IndirectDrawBatch.h>
+#include <Graphics/Culler.h>
+#include <cstring>
+#include <unordered_map>
+using namespace gte;
+
+GL45IndirectDrawBatch::GL45IndirectDrawBatch(std::shared_ptr<GL45Engine> const& engine,
+    std::shared_ptr<ProgramFactory> const& factory,
+    std::vector<std::shared_ptr<Visual>> const& visuals)
+    :
+    mEngine(engine),
+    mVisuals(visuals)
+{
+    LogAssert(engine != nullptr && factory != nullptr && !visuals.empty(),
+        "Invalid input.");
+    LogAssert(factory->GetAPI() == ProgramFactory::PF_GLSL,
+        "The factory must be a GLSLProgramFactory.");
+
+    CreatePool();
+
+    uint32_t const numDraws = static_cast<uint32_t>(mVisuals.size());
+    mDrawData = std::make_shared<StructuredBuffer>(numDraws, sizeof(DrawData));
+    mDrawData->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+    auto drawData = mDrawData->Get<DrawData>();
+    for (uint32_t i = 0; i < numDraws; ++i)
+    {
+        drawData[i].worldMatrix = Matrix4x4<float>::Identity();
+        drawData[i].worldBound = { 0.0f, 0.0f, 0.0f, 0.0f };
+        drawData[i].color = { 1.0f, 1.0f, 1.0f, 1.0f };
+    }
+
+    mCommands = std::make_shared<StructuredBuffer>(numDraws, sizeof(DrawCommand));
+    mCommands->SetUsage(Resource::Usage::SHADER_OUTPUT);
+
+    mPVMatrixConstant = std::make_shared<ConstantBuffer>(sizeof(Matrix4x4<float>), true);
+    mCullingConstants = std::make_shared<ConstantBuffer>(sizeof(CullingConstants), true);
+    auto constants = mCullingConstants->Get<CullingConstants>();
+    std::memset(constants, 0, sizeof(CullingConstants));
+    constants->numDraws = numDraws;
+
+    CreatePrograms(factory);
+    Update();
+}
+
+void GL45IndirectDrawBatch::SetColor(size_t i, Vector4<float> const& color)
+{
+    LogAssert(i < mVisuals.size(), "Invalid index.");
+    mDrawData->Get<DrawData>()[i].color = color;
+}
+
+Vector4<float> const& GL45IndirectDrawBatch::GetColor(size_t i) const
+{
+    LogAssert(i < mVisuals.size(), "Invalid index.");
+    return mDrawData->Get<DrawData>()[i].color;
+}
+
+void GL45IndirectDrawBatch::Update()
+{
+    auto drawData = mDrawData->Get<DrawData>();
+    for (size_t i = 0; i < mVisuals.size(); ++i)
+    {
+        Visual const* visual = mVisuals[i].get();
+        DrawData& data = drawData[i];
+        data.worldMatrix = visual->worldTransform.GetHMatrix();
+
+        // Encode the culling mode in the radius, which the culling program
+        // interprets as Culler::IsVisible does: a radius of 0 is culled and
+        // a negative radius is never culled.
+        Vector3<float> const center = visual->worldBound.GetCenter();
+        float radius = visual->worldBound.GetRadius();
+        if (visual->culling == CullingMode::ALWAYS)
+        {
+            radius = 0.0f;
+        }
+        else if (visual->culling == CullingMode::NEVER)
+        {
+            radius = -1.0f;
+        }
+        data.worldBound = { center[0], center[1], center[2], radius };
+    }
+    mEngine->Update(mDrawData);
+}
+
+void GL45IndirectDrawBatch::Draw(std::shared_ptr<Camera> const& camera, bool cull)
+{
+    LogAssert(camera != nullptr, "Invalid camera.");
+
+    *mPVMatrixConstant->Get<Matrix4x4<float>>() = camera->GetProjectionViewMatrix();
+    mEngine->Update(mPVMatrixConstant);
+
+    uint32_t const numDraws = static_cast<uint32_t>(mVisuals.size());
+    if (cull)
+    {
+        std::array<CullingPlane<float>, Camera::VF_QUANTITY> planes;
+        Culler::GetViewFrustumPlanes(camera, planes);
+        auto constants = mCullingConstants->Get<CullingConstants>();
+        for (size_t i = 0; i < planes.size(); ++i)
+        {
+            Vector4<float> normal = planes[i].GetNormal();
+            normal[3] = planes[i].GetConstant();
+            constants->planes[i] = normal;
+        }
+        mEngine->Update(mCullingConstants);
+
+        uint32_t const numXGroups = (numDraws + msNumXThreads - 1) / msNumXThreads;
+        mEngine->Execute(mCullingProgram, numXGroups, 1, 1);
+        mEngine->DrawIndirect(mVBuffer, mIBuffer, mEffect, mCommands, numDraws);
+    }
+    else
+    {
+        mEngine->DrawIndirect(mVBuffer, mIBuffer, mEffect, mSourceCommands, numDraws);
+    }
+}
+
+void GL45IndirectDrawBatch::CreatePool()
+{
+    // Validate the visuals against the first one.
+    Visual const* first = mVisuals[0].get();
+    LogAssert(first != nullptr && first->GetVertexBuffer() && first->GetIndexBuffer(),
+        "Each visual must have a vertex buffer and an index buffer.");
+    VertexFormat const& vformat = first->GetVertexBuffer()->GetFormat();
+    IPType const type = first->GetIndexBuffer()->GetPrimitiveType();
+    LogAssert(type == IP_POLYPOINT || type == IP_POLYSEGMENT_DISJOINT || type == IP_TRIMESH,
+        "The primitives must be points, disjoint segments or triangles.");
+
+    VASemantic semantic{};
+    DFType dftype{};
+    uint32_t unit{}, offset{};
+    vformat.GetAttribute(0, semantic, dftype, unit, offset);
+    LogAssert(semantic == VASemantic::POSITION && dftype == DF_R32G32B32_FLOAT && offset == 0,
+        "The first attribute must be the 3-tuple float position.");
+
+    uint32_t numVertices = 0, numIndices = 0;
+    std::unordered_map<VertexBuffer const*, uint32_t> vertexStarts;
+    std::unordered_map<IndexBuffer const*, uint32_t> indexStarts;
+    std::vector<DrawCommand> commands(mVisuals.size());
+    for (size_t i = 0; i < mVisuals.size(); ++i)
+    {
+        Visual const* visual = mVisuals[i].get();
+        LogAssert(visual != nullptr && visual->GetVertexBuffer() && visual->GetIndexBuffer(),
+            "Each visual must have a vertex buffer and an index buffer.");
+        VertexBuffer const* vbuffer = visual->GetVertexBuffer().get();
+        IndexBuffer const* ibuffer = visual->GetIndexBuffer().get();
+        LogAssert(vbuffer->GetData() != nullptr,
+            "The vertex buffers must have CPU storage.");
+        LogAssert(ibuffer->GetPrimitiveType() == type,
+            "The visuals must have the same primitive type.");
+
+        VertexFormat const& other = vbuffer->GetFormat();
+        LogAssert(other.GetVertexSize() == vformat.GetVertexSize()
+            && other.GetNumAttributes() == vformat.GetNumAttributes(),
+            "The visuals must have the same vertex format.");
+        for (int32_t j = 0; j < vformat.GetNumAttributes(); ++j)
+        {
+            VASemantic semantic0{}, semantic1{};
+            DFType type0{}, type1{};
+            uint32_t unit0{}, unit1{}, offset0{}, offset1{};
+            vformat.GetAttribute(j, semantic0, type0, unit0, offset0);
+            other.GetAttribute(j, semantic1, type1, unit1, offset1);
+            LogAssert(semantic0 == semantic1 && type0 == type1
+                && unit0 == unit1 && offset0 == offset1,
+                "The visuals must have the same vertex format.");
+        }
+
+        auto viter = vertexStarts.find(vbuffer);
+        if (viter == vertexStarts.end())
+        {
+            viter = vertexStarts.insert(std::make_pair(vbuffer, numVertices)).first;
+            numVertices += vbuffer->GetNumElements();
+        }
+
+        auto iiter = indexStarts.find(ibuffer);
+        if (iiter == indexStarts.end())
+        {
+            LogAssert(!ibuffer->IsIndexed() || ibuffer->GetData() != nullptr,
+                "The index buffers must have CPU storage.");
+            iiter = indexStarts.insert(std::make_pair(ibuffer, numIndices)).first;
+            numIndices += ibuffer->GetNumActiveIndices();
+        }
+
+        // The active indices are copied to the start of the range of the
+        // index buffer in the pool. For an index buffer without indices,
+        // the first vertex is folded into the base vertex.
+        DrawCommand& command = commands[i];
+        command.count = ibuffer->GetNumActiveIndices();
+        command.instanceCount = 1;
+        command.firstIndex = iiter->second;
+        command.baseVertex = static_cast<int32_t>(viter->second + vbuffer->GetOffset()
+            + (ibuffer->IsIndexed() ? 0 : ibuffer->GetOffset()));
+        command.baseInstance = 0;
+    }
+
+    // Copy the vertices.
+    uint32_t const vertexSize = vformat.GetVertexSize();
+    mVBuffer = std::make_shared<VertexBuffer>(vformat, numVertices);
+    char* vertices = mVBuffer->GetData();
+    for (auto const& element : vertexStarts)
+    {
+        std::memcpy(vertices + static_cast<size_t>(element.second) * vertexSize,
+            element.first->GetData(), element.first->GetNumBytes());
+    }
+
+    // Copy the indices as 32-bit values.
+    uint32_t indicesPerPrimitive = (type == IP_TRIMESH ? 3 : (type == IP_POLYSEGMENT_DISJOINT ? 2 : 1));
+    mIBuffer = std::make_shared<IndexBuffer>(type, numIndices / indicesPerPrimitive,
+        sizeof(uint32_t));
+    uint32_t* indices = mIBuffer->Get<uint32_t>();
+    for (auto const& element : indexStarts)
+    {
+        IndexBuffer const* ibuffer = element.first;
+        uint32_t* target = indices + element.second;
+        uint32_t const numActive = ibuffer->GetNumActiveIndices();
+        if (ibuffer->IsIndexed())
+        {
+            uint32_t const first = ibuffer->GetOffset();
+            if (ibuffer->GetElementSize() == sizeof(uint32_t))
+            {
+                uint32_t const* source = ibuffer->Get<uint32_t>() + first;
+                std::memcpy(target, source, numActive * sizeof(uint32_t));
+            }
+            else
+            {
+                uint16_t const* source = ibuffer->Get<uint16_t>() + first;
+                for (uint32_t j = 0; j < numActive; ++j)
+                {
+                    target[j] = source[j];
+                }
+            }
+        }
+        else
+        {
+            for (uint32_t j = 0; j < numActive; ++j)
+            {
+                target[j] = j;
+            }
+        }
+    }
+
+    mSourceCommands = std::make_shared<StructuredBuffer>(
+        static_cast<uint32_t>(commands.size()), sizeof(DrawCommand));
+    std::memcpy(mSourceCommands->GetData(), commands.data(), mSourceCommands->GetNumBytes());
+}
+
+void GL45IndirectDrawBatch::CreatePrograms(std::shared_ptr<ProgramFactory> const& factory)
+{
+    // gl_DrawIDARB requires the extension, which must follow the version
+    // directive and precede the other lines that the factory prepends.
+    std::string const version = factory->version;
+    factory->version = version + "\n#extension GL_ARB_shader_draw_parameters : require";
+    auto program = factory->CreateFromSources(msGLSLVSSource, msGLSLPSSource, "");
+    factory->version = version;
+    LogAssert(program != nullptr, "Failed to compile the drawing program.");
+    program->GetVertexShader()->Set("PVMatrix", mPVMatrixConstant);
+    program->GetVertexShader()->Set("drawData", mDrawData);
+    mEffect = std::make_shared<VisualEffect>(program);
+
+    factory->PushDefines();
+    factory->defines.Set("NUM_X_THREADS", msNumXThreads);
+    mCullingProgram = factory->CreateFromSource(msGLSLCSSource);
+    factory->PopDefines();
+    LogAssert(mCullingProgram != nullptr, "Failed to compile the culling program.");
+    auto const& cshader = mCullingProgram->GetComputeShader();
+    cshader->Set("Frustum", mCullingConstants);
+    cshader->Set("drawData", mDrawData);
+    cshader->Set("sourceCommands", mSourceCommands);
+    cshader->Set("commands", mCommands);
+}
+
+std::string const GL45IndirectDrawBatch::msGLSLVSSource =
+R"(
+    uniform PVMatrix
+    {
+        mat4 pvMatrix;
+    };
+
+    struct DrawData
+    {
+        mat4 worldMatrix;
+        vec4 worldBound;
+        vec4 color;
+    };
+
+    buffer drawData { DrawData data[]; } drawDataSB;
+
+    layout(location = 0) in vec3 modelPosition;
+    layout(location = 0) flat out vec4 vertexColor;
+
+    void main()
+    {
+        DrawData draw = drawDataSB.data[gl_DrawIDARB];
+        vertexColor = draw.color;
+    #if GTE_USE_MAT_VEC
+        gl_Position = pvMatrix * (draw.worldMatrix * vec4(modelPosition, 1.0f));
+    #else
+        gl_Position = (vec4(modelPosition, 1.0f) * draw.worldMatrix) * pvMatrix;
+    #endif
+    }
+)";
+
+std::string const GL45IndirectDrawBatch::msGLSLPSSource =
+R"(
+    layout(location = 0) flat in vec4 vertexColor;
+    layout(location = 0) out vec4 pixelColor;
+
+    void main()
+    {
+        pixelColor = vertexColor;
+    }
+)";
+
+std::string const GL45IndirectDrawBatch::msGLSLCSSource =
+R"(
+    uniform Frustum
+    {
+        vec4 planes[6];
+        uint numDraws;
+    };
+
+    struct DrawData
+    {
+        mat4 worldMatrix;
+        vec4 worldBound;
+        vec4 color;
+    };
+
+    struct DrawCommand
+    {
+        uint count;
+        uint instanceCount;
+        uint firstIndex;
+        int baseVertex;
+        uint baseInstance;
+    };
+
+    buffer drawData { DrawData data[]; } drawDataSB;
+    buffer sourceCommands { DrawCommand data[]; } sourceCommandsSB;
+    buffer commands { DrawCommand data[]; } commandsSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < numDraws)
+        {
+            vec4 bound = drawDataSB.data[i].worldBound;
+            uint visible = (bound.w != 0.0f ? 1u : 0u);
+            if (bound.w > 0.0f)
+            {
+                for (int j = 0; j < 6; ++j)
+                {
+                    if (dot(planes[j].xyz, bound.xyz) + planes[j].w <= -bound.w)
+                    {
+                        visible = 0u;
+                        break;
+                    }
+                }
+            }
+
+            DrawCommand command = sourceCommandsSB.data[i];
+            command.instanceCount = visible;
+            commandsSB.data[i] = command;
+        }
+    }
+)";
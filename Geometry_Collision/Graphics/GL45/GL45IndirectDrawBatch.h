@@ -0,0 +1,162 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Camera.h>
+#include <Graphics/ComputeProgram.h>
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/StructuredBuffer.h>
+#include <Graphics/Visual.h>
+#include <Graphics/VisualEffect.h>
+#include <Graphics/GL45/GL45Engine.h>
+#include <Mathematics/Matrix4x4.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Draw many Visual objects with one call to glMultiDrawElementsIndirect.
+// The vertices and indices of the visuals are copied to one vertex buffer
+// and one index buffer (the pool). Vertex and index buffers shared by
+// several visuals are copied once. Each visual has a draw command and an
+// element of per-draw data in a shader storage buffer: the world matrix,
+// the world bounding sphere and a color. Each frame,
+//   1. Update() copies the world transforms and world bounds of the
+//      visuals to the per-draw data, so call it after the scene update,
+//   2. Draw(camera) executes a compute program that culls the bounding
+//      spheres against the view frustum and writes the draw commands,
+//      setting the instance count to 0 for culled visuals, and then draws
+//      all commands with one call. The culling matches that of Culler: a
+//      visual with CullingMode::ALWAYS or a bound of radius 0 is culled, and
+//      one with CullingMode::NEVER is drawn.
+// The CPU never reads the visibility results, so the number of draw calls
+// is 1 regardless of the number of visuals.
+//
+// The visuals must have the same vertex format, whose first attribute is the
+// 3-tuple float position, and the same primitive type, which must be
+// IP_POLYPOINT, IP_POLYSEGMENT_DISJOINT or IP_TRIMESH. The effects of the
+// visuals are not used. The batch draws with its own effect, which
+// transforms the positions by the projection-view matrix of the camera and
+// the world matrix of the draw and assigns the draw's color to the pixels.
+// The vertex shader obtains the index of the draw from gl_DrawIDARB, so the
+// driver must support GL_ARB_shader_draw_parameters (core in OpenGL 4.6).
+// The pool is created at construction; create a new batch after the
+// vertices or indices of the visuals change.
+
+namespace gte
+{
+    class GL45IndirectDrawBatch
+    {
+    public:
+        // The per-draw data in std430 layout.
+        struct DrawData
+        {
+            Matrix4x4<float> worldMatrix;
+
+            // The center is (x,y,z) and the radius is w. The radius is -1
+            // for visuals that are never culled.
+            Vector4<float> worldBound;
+
+            Vector4<float> color;
+        };
+
+        // The DrawElementsIndirectCommand of glMultiDrawElementsIndirect.
+        struct DrawCommand
+        {
+            uint32_t count;
+            uint32_t instanceCount;
+            uint32_t firstIndex;
+            int32_t baseVertex;
+            uint32_t baseInstance;
+        };
+
+        // Construction. The factory must be a GLSLProgramFactory.
+        GL45IndirectDrawBatch(std::shared_ptr<GL45Engine> const& engine,
+            std::shared_ptr<ProgramFactory> const& factory,
+            std::vector<std::shared_ptr<Visual>> const& visuals);
+
+        // Member access. The color of all draws is initially white.
+        inline size_t GetNumDraws() const
+        {
+            return mVisuals.size();
+        }
+
+        void SetColor(size_t i, Vector4<float> const& color);
+        Vector4<float> const& GetColor(size_t i) const;
+
+        inline std::shared_ptr<VertexBuffer> const& GetVertexBuffer() const
+        {
+            return mVBuffer;
+        }
+
+        inline std::shared_ptr<IndexBuffer> const& GetIndexBuffer() const
+        {
+            return mIBuffer;
+        }
+
+        inline std::shared_ptr<VisualEffect> const& GetEffect() const
+        {
+            return mEffect;
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetDrawData() const
+        {
+            return mDrawData;
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetCommands() const
+        {
+            return mCommands;
+        }
+
+        // Copy the world transforms and world bounds of the visuals to the
+        // per-draw data and upload it to GPU memory.
+        void Update();
+
+        // Cull and draw the visuals. When 'cull' is 'false', the compute
+        // program is not executed and all visuals are drawn.
+        void Draw(std::shared_ptr<Camera> const& camera, bool cull = true);
+
+    private:
+        // The inputs to the culling program in std140 layout.
+        struct CullingConstants
+        {
+            std::array<Vector4<float>, Camera::VF_QUANTITY> planes;
+            uint32_t numDraws;
+            uint32_t padding[3];
+        };
+
+        void CreatePool();
+        void CreatePrograms(std::shared_ptr<ProgramFactory> const& factory);
+
+        std::shared_ptr<GL45Engine> mEngine;
+        std::vector<std::shared_ptr<Visual>> mVisuals;
+
+        // The pool of vertices and indices.
+        std::shared_ptr<VertexBuffer> mVBuffer;
+        std::shared_ptr<IndexBuffer> mIBuffer;
+
+        // The draw commands of all visuals (mSourceCommands) and of the
+        // visible visuals (mCommands, written by the culling program).
+        std::shared_ptr<StructuredBuffer> mDrawData;
+        std::shared_ptr<StructuredBuffer> mSourceCommands;
+        std::shared_ptr<StructuredBuffer> mCommands;
+
+        std::shared_ptr<ConstantBuffer> mPVMatrixConstant;
+        std::shared_ptr<ConstantBuffer> mCullingConstants;
+        std::shared_ptr<VisualEffect> mEffect;
+        std::shared_ptr<ComputeProgram> mCullingProgram;
+
+        static uint32_t constexpr msNumXThreads = 64;
+        static std::string const msGLSLVSSource;
+        static std::string const msGLSLPSSource;
+        static std::string const msGLSLCSSource;
+    };
+}
@@ -20,6 +20,7 @@ GL45InputLayout::GL45InputLayout(GLuint, GLuint vbufferHandle, VertexBuffer cons
     :
     mVBufferHandle(vbufferHandle),
     mVArrayHandle(0),
+    mVBufferOffset(0),
     mNumAttributes(0),
     mAttributes{}
 {
@@ -63,9 +64,10 @@ GL45InputLayout::GL45InputLayout(GLuint, GLuint vbufferHandle, VertexBuffer cons
     }
 }
 
-void GL45InputLayout::Enable()
+void GL45InputLayout::Enable(GLintptr vbufferOffset)
 {
     glBindVertexArray(mVArrayHandle);
+    SetVBufferOffset(vbufferOffset);
 }
 
 void GL45InputLayout::Disable()
@@ -73,6 +75,22 @@ void GL45InputLayout::Disable()
     glBindVertexArray(0);
 }
 
+void GL45InputLayout::SetVBufferOffset(GLintptr vbufferOffset)
+{
+    if (vbufferOffset != mVBufferOffset)
+    {
+        // The vertex array object stores the bindings, so they change only
+        // when the region of a streaming vertex buffer changes.
+        for (int32_t i = 0; i < mNumAttributes; ++i)
+        {
+            Attribute const& attribute = mAttributes[i];
+            glBindVertexBuffer(i, mVBufferHandle, vbufferOffset + attribute.offset,
+                attribute.stride);
+        }
+        mVBufferOffset = vbufferOffset;
+    }
+}
+
 
 GLenum const GL45InputLayout::msChannelType[] =
 {
@@ -21,10 +21,21 @@ namespace gte
         ~GL45InputLayout();
         GL45InputLayout(GLuint programHandle, GLuint vbufferHandle, VertexBuffer const* vbuffer);
 
-        // Support for drawing geometric primitives.
-        void Enable();
+        // Support for drawing geometric primitives.  The offset is that of
+        // the region of a streaming vertex buffer to draw from.
+        void Enable(GLintptr vbufferOffset = 0);
         void Disable();
 
+        // Support for GL45InputLayoutManager, which binds the vertex array
+        // object only when it is not current. SetVBufferOffset requires the
+        // vertex array object to be current.
+        inline GLuint GetVArrayHandle() const
+        {
+            return mVArrayHandle;
+        }
+
+        void SetVBufferOffset(GLintptr vbufferOffset);
+
     private:
         struct Attribute
         {
@@ -51,6 +62,7 @@ namespace gte
 
         GLuint mVBufferHandle;
         GLuint mVArrayHandle;
+        GLintptr mVBufferOffset;
         int32_t mNumAttributes;
         std::array<Attribute, VAConstant::MAX_ATTRIBUTES> mAttributes;
 
@@ -26,13 +26,25 @@ GL45InputLayout* GL45InputLayoutManager::Bind(GLuint programHandle,
     {
         mMutex.lock();
         VBPPair vbp(vbuffer, programHandle);
+        if (mLastLayout && vbp == mLastKey)
+        {
+            GL45InputLayout* inputLayout = mLastLayout;
+            mMutex.unlock();
+            return inputLayout;
+        }
+
         auto iter = mMap.find(vbp);
         if (iter == mMap.end())
         {
             auto layout = std::make_shared<GL45InputLayout>(programHandle, vbufferHandle, vbuffer);
             iter = mMap.insert(std::make_pair(vbp, layout)).first;
+
+            // The constructor leaves no vertex array object current.
+            mActiveVArray = 0;
         }
         GL45InputLayout* inputLayout = iter->second.get();
+        mLastKey = vbp;
+        mLastLayout = inputLayout;
         mMutex.unlock();
         return inputLayout;
     }
@@ -48,24 +60,7 @@ bool GL45InputLayoutManager::Unbind(VertexBuffer const* vbuffer)
 {
     LogAssert(vbuffer != nullptr, "Invalid input.");
 
-    mMutex.lock();
-    if (mMap.size() > 0)
-    {
-        std::vector<VBPPair> matches{};
-        for (auto const& element : mMap)
-        {
-            if (vbuffer == element.first.first)
-            {
-                matches.push_back(element.first);
-            }
-        }
-
-        for (auto const& match : matches)
-        {
-            mMap.erase(match);
-        }
-    }
-    mMutex.unlock();
+    Erase([vbuffer](VBPPair const& vbp) { return vbp.first == vbuffer; });
     return true;
 }
 
@@ -76,9 +71,7 @@ bool GL45InputLayoutManager::Unbind(Shader const*)
 
 void GL45InputLayoutManager::UnbindAll()
 {
-    mMutex.lock();
-    mMap.clear();
-    mMutex.unlock();
+    Erase([](VBPPair const&) { return true; });
 }
 
 bool GL45InputLayoutManager::HasElements() const
@@ -88,3 +81,59 @@ bool GL45InputLayoutManager::HasElements() const
     mMutex.unlock();
     return hasElements;
 }
+
+void GL45InputLayoutManager::Enable(GL45InputLayout* layout, GLintptr vbufferOffset)
+{
+    GLuint vArrayHandle = layout->GetVArrayHandle();
+    if (vArrayHandle != mActiveVArray)
+    {
+        glBindVertexArray(vArrayHandle);
+        mActiveVArray = vArrayHandle;
+    }
+    else
+    {
+        ++mNumElidedBinds;
+    }
+    layout->SetVBufferOffset(vbufferOffset);
+}
+
+void GL45InputLayoutManager::Disable()
+{
+    if (mActiveVArray != 0)
+    {
+        glBindVertexArray(0);
+        mActiveVArray = 0;
+    }
+    else
+    {
+        ++mNumElidedBinds;
+    }
+}
+
+void GL45InputLayoutManager::Invalidate()
+{
+    glBindVertexArray(0);
+    mActiveVArray = 0;
+}
+
+void GL45InputLayoutManager::Erase(std::function<bool(VBPPair const&)> const& match)
+{
+    mMutex.lock();
+    for (auto iter = mMap.begin(); iter != mMap.end(); )
+    {
+        if (match(iter->first))
+        {
+            if (iter->second->GetVArrayHandle() == mActiveVArray)
+            {
+                mActiveVArray = 0;
+            }
+            iter = mMap.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+    mLastLayout = nullptr;
+    mMutex.unlock();
+}
@@ -9,8 +9,10 @@
 
 #include <Graphics/GEInputLayoutManager.h>
 #include <Graphics/GL45/GL45InputLayout.h>
-#include <map>
+#include <cstdint>
+#include <functional>
 #include <mutex>
+#include <unordered_map>
 
 namespace gte
 {
@@ -21,6 +23,10 @@ namespace gte
         GL45InputLayoutManager()
             :
             mMap{},
+            mLastKey(nullptr, 0),
+            mLastLayout(nullptr),
+            mActiveVArray(0),
+            mNumElidedBinds(0),
             mMutex{}
         {
         }
@@ -38,9 +44,50 @@ namespace gte
         virtual void UnbindAll() override;
         virtual bool HasElements() const override;
 
+        // Make the vertex array object of the layout current and set the
+        // offset of its vertex buffer. The manager tracks the current vertex
+        // array object, so the glBindVertexArray call is skipped when the
+        // layout's object is already current, for example for consecutive
+        // draws of the same vertex buffer and program. The vertex array
+        // object stays current after the draw. Disable makes no vertex array
+        // object current. Invalidate must be called when code outside the
+        // engine binds a vertex array object.
+        void Enable(GL45InputLayout* layout, GLintptr vbufferOffset);
+        void Disable();
+        void Invalidate();
+
+        // The number of glBindVertexArray calls that were skipped.
+        inline uint64_t GetNumElidedBinds() const
+        {
+            return mNumElidedBinds;
+        }
+
     private:
         typedef std::pair<VertexBuffer const*, GLuint> VBPPair;
-        std::map<VBPPair, std::shared_ptr<GL45InputLayout>> mMap;
+
+        struct VBPPairHash
+        {
+            inline size_t operator()(VBPPair const& vbp) const
+            {
+                size_t h0 = std::hash<VertexBuffer const*>()(vbp.first);
+                size_t h1 = std::hash<GLuint>()(vbp.second);
+                return h0 ^ (h1 + 0x9e3779b9 + (h0 << 6) + (h0 >> 2));
+            }
+        };
+
+        // Delete the layouts of the matching elements. A vertex array object
+        // that is deleted while current is replaced by object 0.
+        void Erase(std::function<bool(VBPPair const&)> const& match);
+
+        std::unordered_map<VBPPair, std::shared_ptr<GL45InputLayout>, VBPPairHash> mMap;
+
+        // The most recent lookup of Bind, which is the layout of the next
+        // draw of a visual that is drawn several times in a row.
+        VBPPair mLastKey;
+        GL45InputLayout* mLastLayout;
+
+        GLuint mActiveVArray;
+        uint64_t mNumElidedBinds;
         mutable std::mutex mMutex;
     };
 }
@@ -37,8 +37,10 @@ void GL45StructuredBuffer::AttachToUnit(GLint shaderStorageBufferUnit)
     // associated with it, then there are extra bytes allocated in the buffer
     // to store the counter value.  The structured buffer data does start
     // at offset=0, so all that is needed is the actual number of data bytes
-    // in the StructuredBuffer object.
-    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, shaderStorageBufferUnit, mGLHandle, 0, buffer->GetNumBytes());
+    // in the StructuredBuffer object.  A streaming buffer is bound at the
+    // region written by the last update.
+    glBindBufferRange(GL_SHADER_STORAGE_BUFFER, shaderStorageBufferUnit, mGLHandle,
+        GetStreamOffset(), buffer->GetNumBytes());
 }
 
 bool GL45StructuredBuffer::CopyCounterValueToBuffer(GL45Buffer* targetBuffer, GLint offset)
@@ -10,6 +10,7 @@
 #include <Graphics/GL45/GLSLProgramFactory.h>
 #include <Graphics/GL45/GLSLVisualProgram.h>
 #include <Graphics/GL45/GLSLShader.h>
+#include <cstring>
 using namespace gte;
 
 std::string GLSLProgramFactory::defaultVersion = "#version 430";
@@ -39,54 +40,75 @@ std::shared_ptr<VisualProgram> GLSLProgramFactory::CreateFromNamedSources(
         LogError("A program must have a vertex shader and a pixel shader.");
     }
 
-    GLuint vsHandle = Compile(GL_VERTEX_SHADER, vsSource);
-    if (vsHandle == 0)
+    // A program loaded from the cache has no shader objects.
+    GLuint programHandle = 0, vsHandle = 0, psHandle = 0, gsHandle = 0;
+    uint64_t key = 0;
+    if (cache)
     {
-        return nullptr;
+        key = GetCacheKey({ &vsSource, &psSource, &gsSource, &GetDriverIdentity() });
+        programHandle = LoadBinary(key);
     }
 
-    GLuint psHandle = Compile(GL_FRAGMENT_SHADER, psSource);
-    if (psHandle == 0)
+    if (programHandle == 0)
     {
-        return nullptr;
-    }
+        vsHandle = Compile(GL_VERTEX_SHADER, vsSource);
+        if (vsHandle == 0)
+        {
+            return nullptr;
+        }
 
-    GLuint gsHandle = 0;
-    if (gsSource != "")
-    {
-        gsHandle = Compile(GL_GEOMETRY_SHADER, gsSource);
-        if (gsHandle == 0)
+        psHandle = Compile(GL_FRAGMENT_SHADER, psSource);
+        if (psHandle == 0)
         {
             return nullptr;
         }
-    }
 
-    GLuint programHandle = glCreateProgram();
-    if (programHandle == 0)
-    {
-        LogError("Program creation failed.");
-    }
+        if (gsSource != "")
+        {
+            gsHandle = Compile(GL_GEOMETRY_SHADER, gsSource);
+            if (gsHandle == 0)
+            {
+                return nullptr;
+            }
+        }
 
-    glAttachShader(programHandle, vsHandle);
-    glAttachShader(programHandle, psHandle);
-    if (gsHandle > 0)
-    {
-        glAttachShader(programHandle, gsHandle);
-    }
+        programHandle = glCreateProgram();
+        if (programHandle == 0)
+        {
+            LogError("Program creation failed.");
+        }
 
-    if (!Link(programHandle))
-    {
-        glDetachShader(programHandle, vsHandle);
-        glDeleteShader(vsHandle);
-        glDetachShader(programHandle, psHandle);
-        glDeleteShader(psHandle);
-        if (gsHandle)
+        glAttachShader(programHandle, vsHandle);
+        glAttachShader(programHandle, psHandle);
+        if (gsHandle > 0)
         {
-            glDetachShader(programHandle, gsHandle);
-            glDeleteShader(gsHandle);
+            glAttachShader(programHandle, gsHandle);
+        }
+
+        if (cache)
+        {
+            glProgramParameteri(programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        if (!Link(programHandle))
+        {
+            glDetachShader(programHandle, vsHandle);
+            glDeleteShader(vsHandle);
+            glDetachShader(programHandle, psHandle);
+            glDeleteShader(psHandle);
+            if (gsHandle)
+            {
+                glDetachShader(programHandle, gsHandle);
+                glDeleteShader(gsHandle);
+            }
+            glDeleteProgram(programHandle);
+            return nullptr;
+        }
+
+        if (cache)
+        {
+            SaveBinary(key, programHandle);
         }
-        glDeleteProgram(programHandle);
-        return nullptr;
     }
 
     std::shared_ptr<GLSLVisualProgram> program =
@@ -98,7 +120,7 @@ std::shared_ptr<VisualProgram> GLSLProgramFactory::CreateFromNamedSources(
     auto pshader = std::make_shared<GLSLShader>(reflector, GT_PIXEL_SHADER, GLSLReflection::ReferenceType::PIXEL);
     program->SetVertexShader(vshader);
     program->SetPixelShader(pshader);
-    if (gsHandle > 0)
+    if (gsSource != "")
     {
         auto gshader = std::make_shared<GLSLShader>(reflector, GT_GEOMETRY_SHADER, GLSLReflection::ReferenceType::GEOMETRY);
         program->SetGeometryShader(gshader);
@@ -114,26 +136,48 @@ std::shared_ptr<ComputeProgram> GLSLProgramFactory::CreateFromNamedSource(
         LogError("A program must have a compute shader.");
     }
 
-    GLuint csHandle = Compile(GL_COMPUTE_SHADER, csSource);
-    if (csHandle == 0)
+    // A program loaded from the cache has no shader object.
+    GLuint programHandle = 0, csHandle = 0;
+    uint64_t key = 0;
+    if (cache)
     {
-        return nullptr;
+        key = GetCacheKey({ &csSource, &GetDriverIdentity() });
+        programHandle = LoadBinary(key);
     }
 
-    GLuint programHandle = glCreateProgram();
     if (programHandle == 0)
     {
-        LogError("Program creation failed.");
-    }
+        csHandle = Compile(GL_COMPUTE_SHADER, csSource);
+        if (csHandle == 0)
+        {
+            return nullptr;
+        }
 
-    glAttachShader(programHandle, csHandle);
+        programHandle = glCreateProgram();
+        if (programHandle == 0)
+        {
+            LogError("Program creation failed.");
+        }
 
-    if (!Link(programHandle))
-    {
-        glDetachShader(programHandle, csHandle);
-        glDeleteShader(csHandle);
-        glDeleteProgram(programHandle);
-        return nullptr;
+        glAttachShader(programHandle, csHandle);
+
+        if (cache)
+        {
+            glProgramParameteri(programHandle, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+
+        if (!Link(programHandle))
+        {
+            glDetachShader(programHandle, csHandle);
+            glDeleteShader(csHandle);
+            glDeleteProgram(programHandle);
+            return nullptr;
+        }
+
+        if (cache)
+        {
+            SaveBinary(key, programHandle);
+        }
     }
 
     auto program = std::make_shared<GLSLComputeProgram>(programHandle, csHandle);
@@ -143,6 +187,78 @@ std::shared_ptr<ComputeProgram> GLSLProgramFactory::CreateFromNamedSource(
     return program;
 }
 
+std::string const& GLSLProgramFactory::GetDriverIdentity()
+{
+    // The strings do not change while the application runs, so they are
+    // queried once.
+    static std::string const identity = []()
+    {
+        std::string text;
+        for (GLenum name : { GL_VENDOR, GL_RENDERER, GL_VERSION })
+        {
+            auto const* value = reinterpret_cast<char const*>(glGetString(name));
+            text += (value ? value : "");
+            text += "\n";
+        }
+        return text;
+    }();
+    return identity;
+}
+
+GLuint GLSLProgramFactory::LoadBinary(uint64_t key)
+{
+    // The blob is the binary format followed by the program binary.
+    std::vector<uint8_t> blob;
+    if (!cache->Load(key, blob) || blob.size() <= sizeof(GLenum))
+    {
+        return 0;
+    }
+
+    GLenum binaryFormat;
+    std::memcpy(&binaryFormat, blob.data(), sizeof(GLenum));
+    GLuint programHandle = glCreateProgram();
+    if (programHandle == 0)
+    {
+        return 0;
+    }
+
+    glProgramBinary(programHandle, binaryFormat, blob.data() + sizeof(GLenum),
+        static_cast<GLsizei>(blob.size() - sizeof(GLenum)));
+    GLint status = GL_FALSE;
+    glGetProgramiv(programHandle, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE)
+    {
+        // The driver rejected the binary, for example after an update that
+        // did not change the version string. The caller compiles the
+        // sources and replaces the entry.
+        glDeleteProgram(programHandle);
+        return 0;
+    }
+    return programHandle;
+}
+
+void GLSLProgramFactory::SaveBinary(uint64_t key, GLuint programHandle)
+{
+    GLint length = 0;
+    glGetProgramiv(programHandle, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+    {
+        // The driver does not support program binaries.
+        return;
+    }
+
+    std::vector<uint8_t> blob(sizeof(GLenum) + static_cast<size_t>(length));
+    GLenum binaryFormat = 0;
+    GLsizei numWritten = 0;
+    glGetProgramBinary(programHandle, length, &numWritten, &binaryFormat,
+        blob.data() + sizeof(GLenum));
+    if (numWritten > 0)
+    {
+        std::memcpy(blob.data(), &binaryFormat, sizeof(GLenum));
+        cache->Save(key, blob.data(), sizeof(GLenum) + static_cast<size_t>(numWritten));
+    }
+}
+
 GLuint GLSLProgramFactory::Compile(GLenum shaderType, std::string const& source)
 {
     GLuint handle = glCreateShader(shaderType);
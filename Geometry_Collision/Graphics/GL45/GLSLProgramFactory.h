@@ -67,5 +67,14 @@ namespace gte
 
         GLuint Compile(GLenum shaderType, std::string const& source);
         bool Link(GLuint programHandle);
+
+        // Support for the program cache. A program binary is valid only for
+        // the driver that created it, so the keys include the vendor,
+        // renderer and version strings of the driver. LoadBinary returns
+        // the handle of a linked program or 0 when the key has no entry or
+        // the driver rejects the binary.
+        static std::string const& GetDriverIdentity();
+        GLuint LoadBinary(uint64_t key);
+        void SaveBinary(uint64_t key, GLuint programHandle);
     };
 }
@@ -7,6 +7,7 @@
 
 #include <Graphics/GL45/GTGraphicsGL45PCH.h>
 #include <Graphics/GL45/GLX/GLXEngine.h>
+#include <Mathematics/Trace.h>
 #include <X11/Xlib.h>
 #include <GL/glx.h>
 using namespace gte;
@@ -185,6 +186,8 @@ void GLXEngine::MakeActive()
 
 void GLXEngine::DisplayColorBuffer(uint32_t syncInterval)
 {
+    GTE_TRACE_SCOPE("DisplayColorBuffer");
+
     // TODO: Disable vertical sync if possible.
     (void)syncInterval;
 
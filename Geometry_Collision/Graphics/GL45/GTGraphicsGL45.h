@@ -10,7 +10,10 @@
 // GL45/Engine
 #include <Graphics/GL45/GL45.h>
 #include <Graphics/GL45/GL45Engine.h>
+#include <Graphics/GL45/GL45GPUProfiler.h>
+#include <Graphics/GL45/GL45GPUReadback.h>
 #include <Graphics/GL45/GL45GraphicsObject.h>
+#include <Graphics/GL45/GL45IndirectDrawBatch.h>
 
 // GL45/Engine/InputLayout
 #include <Graphics/GL45/GL45InputLayout.h>
@@ -24,6 +27,7 @@
 #include <Graphics/GL45/GL45Buffer.h>
 #include <Graphics/GL45/GL45ConstantBuffer.h>
 #include <Graphics/GL45/GL45IndexBuffer.h>
+#include <Graphics/GL45/GL45IndirectArgumentsBuffer.h>
 #include <Graphics/GL45/GL45StructuredBuffer.h>
 #include <Graphics/GL45/GL45VertexBuffer.h>
 
@@ -62,4 +66,5 @@
 
 #if defined(GTE_USE_LINUX)
 #include <Graphics/GL45/GLX/GLXEngine.h>
+#include <Graphics/GL45/EGL/EGLEngine.h>
 #endif
@@ -7,6 +7,7 @@
 
 #include <Graphics/GL45/GTGraphicsGL45PCH.h>
 #include <Graphics/GL45/WGL/WGLEngine.h>
+#include <Mathematics/Trace.h>
 using namespace gte;
 
 extern "C"
@@ -88,6 +89,7 @@ void WGLEngine::MakeActive()
 
 void WGLEngine::DisplayColorBuffer(uint32_t syncInterval)
 {
+    GTE_TRACE_SCOPE("DisplayColorBuffer");
     wglSwapIntervalEXT(syncInterval > 0 ? 1 : 0);
     SwapBuffers(mDevice);
 }
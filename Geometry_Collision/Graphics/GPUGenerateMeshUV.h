@@ -0,0 +1,321 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/GenerateMeshUV.h>
+#include <Graphics/ComputeProgram.h>
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/GraphicsEngine.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/StructuredBuffer.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+
+// GenerateMeshUV with the relaxation of the texture coordinates executed by
+// a compute program. The preprocessing (the manifold mesh, the topological
+// distance transform, the boundary coordinates, the mean value weights and
+// the initial guess) is that of GenerateMeshUV on the CPU. Each iteration
+// is a dispatch of one thread per interior vertex that averages the
+// coordinates of the adjacent vertices of the previous iterate, the same
+// update as the CPU solvers, with the iterates in a pair of structured
+// buffers used in ping-pong fashion. The GPU computes in 32-bit floating
+// point, so for Real = double the coordinates are rounded to float before
+// the iterations.
+
+namespace gte
+{
+    template <typename Real>
+    class GPUGenerateMeshUV : public GenerateMeshUV<Real>
+    {
+    public:
+        enum class Device
+        {
+            CPU,
+            GPU
+        };
+
+        // The engine and the factory may be null, in which case only the
+        // CPU device is available. The number of threads is used by the
+        // CPU device. The device is GPU when it is available.
+        GPUGenerateMeshUV(std::shared_ptr<GraphicsEngine> const& engine,
+            std::shared_ptr<ProgramFactory> const& factory,
+            uint32_t numThreads = 0,
+            std::function<void(uint32_t)> const* progress = nullptr)
+            :
+            GenerateMeshUV<Real>(numThreads, progress),
+            mEngine(engine),
+            mDevice(Device::CPU)
+        {
+            if (!engine || !factory)
+            {
+                return;
+            }
+
+            factory->PushDefines();
+            factory->defines.Set("NUM_X_THREADS", msNumThreads);
+            mSolveProgram = factory->CreateFromSource(*GetSources()[factory->GetAPI()]);
+            factory->PopDefines();
+            LogAssert(mSolveProgram != nullptr, "Failed to compile the uv-solver program.");
+
+            mBounds = std::make_shared<ConstantBuffer>(sizeof(Bounds), true);
+            mSolveProgram->GetComputeShader()->Set("Bounds", mBounds);
+            mDevice = Device::GPU;
+        }
+
+        virtual ~GPUGenerateMeshUV() = default;
+
+        inline bool IsGPUAvailable() const
+        {
+            return mSolveProgram != nullptr;
+        }
+
+        // Select the device for the next calls of operator().
+        void SetDevice(Device device)
+        {
+            LogAssert(device == Device::CPU || IsGPUAvailable(),
+                "The GPU solver was created without a graphics engine.");
+            mDevice = device;
+        }
+
+        inline Device GetDevice() const
+        {
+            return mDevice;
+        }
+
+    protected:
+        virtual void SolveSystemInternal(uint32_t numIterations) override
+        {
+            if (mDevice == Device::CPU)
+            {
+                GenerateMeshUV<Real>::SolveSystemInternal(numIterations);
+                return;
+            }
+
+            int32_t const numVertices = this->mNumVertices;
+            int32_t const numInterior = numVertices - this->mNumBoundaryEdges;
+            if (numInterior <= 0)
+            {
+                return;
+            }
+
+            uint32_t const numGroups =
+                (static_cast<uint32_t>(numInterior) + msNumThreads - 1) / msNumThreads;
+            LogAssert(numGroups <= 65535u, "Too many vertices for one dispatch.");
+
+            // The vertex graph, its adjacency data and the ordered vertices
+            // are inputs of the program. The buffers are members, because
+            // the shader keeps references to them until the next call.
+            mVertexGraphBuffer = std::make_shared<StructuredBuffer>(
+                static_cast<uint32_t>(this->mVertexGraph.size()),
+                static_cast<uint32_t>(sizeof(typename GenerateMeshUV<Real>::Vertex)));
+            std::memcpy(mVertexGraphBuffer->GetData(), this->mVertexGraph.data(),
+                mVertexGraphBuffer->GetNumBytes());
+
+            uint32_t const numGraphData = static_cast<uint32_t>(
+                std::max(this->mVertexGraphData.size(), static_cast<size_t>(1)));
+            mVertexGraphDataBuffer = std::make_shared<StructuredBuffer>(
+                numGraphData, static_cast<uint32_t>(sizeof(GraphData)));
+            auto graphData = mVertexGraphDataBuffer->Get<GraphData>();
+            for (size_t i = 0; i < this->mVertexGraphData.size(); ++i)
+            {
+                graphData[i].adjacent = this->mVertexGraphData[i].first;
+                graphData[i].weight = static_cast<float>(this->mVertexGraphData[i].second);
+            }
+
+            mOrderedVerticesBuffer = std::make_shared<StructuredBuffer>(
+                static_cast<uint32_t>(numVertices), static_cast<uint32_t>(sizeof(int32_t)));
+            std::memcpy(mOrderedVerticesBuffer->GetData(), this->mOrderedVertices.data(),
+                mOrderedVerticesBuffer->GetNumBytes());
+
+            // Both iterates start as the initial guess, so the boundary
+            // coordinates are in both.
+            auto& tcoords = mTCoordsBuffers;
+            for (auto& buffer : tcoords)
+            {
+                buffer = std::make_shared<StructuredBuffer>(
+                    static_cast<uint32_t>(numVertices), static_cast<uint32_t>(2 * sizeof(float)));
+                buffer->SetUsage(Resource::Usage::SHADER_OUTPUT);
+                auto data = buffer->Get<float>();
+                for (int32_t i = 0; i < numVertices; ++i)
+                {
+                    data[2 * i + 0] = static_cast<float>(this->mTCoords[i][0]);
+                    data[2 * i + 1] = static_cast<float>(this->mTCoords[i][1]);
+                }
+            }
+            tcoords[0]->SetCopy(Resource::Copy::STAGING_TO_CPU);
+
+            auto bounds = mBounds->Get<Bounds>();
+            bounds->numBoundaryEdges = this->mNumBoundaryEdges;
+            bounds->numInterior = numInterior;
+            bounds->padding[0] = 0;
+            bounds->padding[1] = 0;
+            mEngine->Update(mBounds);
+
+            auto const& cshader = mSolveProgram->GetComputeShader();
+            cshader->Set("vertexGraph", mVertexGraphBuffer);
+            cshader->Set("vertexGraphData", mVertexGraphDataBuffer);
+            cshader->Set("orderedVertices", mOrderedVerticesBuffer);
+
+            // The value numIterations is even, so the last iteration writes
+            // tcoords[0].
+            for (uint32_t i = 1; i <= numIterations; ++i)
+            {
+                if (this->mProgress)
+                {
+                    (*this->mProgress)(i);
+                }
+
+                cshader->Set("inTCoords", tcoords[(i + 1) & 1]);
+                cshader->Set("outTCoords", tcoords[i & 1]);
+                mEngine->Execute(mSolveProgram, numGroups, 1, 1);
+            }
+
+            mEngine->CopyGpuToCpu(tcoords[0]);
+            auto data = tcoords[0]->Get<float>();
+            for (int32_t i = 0; i < numVertices; ++i)
+            {
+                this->mTCoords[i][0] = static_cast<Real>(data[2 * i + 0]);
+                this->mTCoords[i][1] = static_cast<Real>(data[2 * i + 1]);
+            }
+        }
+
+    private:
+        struct Bounds
+        {
+            int32_t numBoundaryEdges;
+            int32_t numInterior;
+            int32_t padding[2];
+        };
+
+        struct GraphData
+        {
+            int32_t adjacent;
+            float weight;
+        };
+
+        static ProgramSources const& GetSources()
+        {
+            static std::string const glslSource =
+R"(
+    uniform Bounds
+    {
+        ivec4 bounds;  // (numBoundaryEdges, numInterior, 0, 0)
+    };
+
+    struct Vertex
+    {
+        int distance;
+        int range0;
+        int range1;
+        int padding;
+    };
+
+    struct GraphData
+    {
+        int adjacent;
+        float weight;
+    };
+
+    buffer vertexGraph { Vertex data[]; } vertexGraphSB;
+    buffer vertexGraphData { GraphData data[]; } vertexGraphDataSB;
+    buffer orderedVertices { int data[]; } orderedVerticesSB;
+    buffer inTCoords { vec2 data[]; } inTCoordsSB;
+    buffer outTCoords { vec2 data[]; } outTCoordsSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        int t = int(gl_GlobalInvocationID.x);
+        if (t < bounds.y)
+        {
+            int v0 = orderedVerticesSB.data[bounds.x + t];
+            int range0 = vertexGraphSB.data[v0].range0;
+            int range1 = vertexGraphSB.data[v0].range1;
+            vec2 tcoord = vec2(0.0f);
+            float weightSum = 0.0f;
+            for (int k = 0; k < range1; ++k)
+            {
+                GraphData data = vertexGraphDataSB.data[range0 + k];
+                weightSum += data.weight;
+                tcoord += data.weight * inTCoordsSB.data[data.adjacent];
+            }
+            outTCoordsSB.data[v0] = tcoord / weightSum;
+        }
+    }
+)";
+
+            static std::string const hlslSource =
+R"(
+    cbuffer Bounds
+    {
+        int4 bounds;  // (numBoundaryEdges, numInterior, 0, 0)
+    };
+
+    struct Vertex
+    {
+        int distance;
+        int range0;
+        int range1;
+        int padding;
+    };
+
+    struct GraphData
+    {
+        int adjacent;
+        float weight;
+    };
+
+    StructuredBuffer<Vertex> vertexGraph;
+    StructuredBuffer<GraphData> vertexGraphData;
+    StructuredBuffer<int> orderedVertices;
+    StructuredBuffer<float2> inTCoords;
+    RWStructuredBuffer<float2> outTCoords;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 dt : SV_DispatchThreadID)
+    {
+        int t = (int)dt.x;
+        if (t < bounds.y)
+        {
+            int v0 = orderedVertices[bounds.x + t];
+            int range0 = vertexGraph[v0].range0;
+            int range1 = vertexGraph[v0].range1;
+            float2 tcoord = float2(0.0f, 0.0f);
+            float weightSum = 0.0f;
+            for (int k = 0; k < range1; ++k)
+            {
+                GraphData data = vertexGraphData[range0 + k];
+                weightSum += data.weight;
+                tcoord += data.weight * inTCoords[data.adjacent];
+            }
+            outTCoords[v0] = tcoord / weightSum;
+        }
+    }
+)";
+
+            static ProgramSources const sources = { &glslSource, &hlslSource };
+            return sources;
+        }
+
+        static uint32_t constexpr msNumThreads = 256;
+
+        std::shared_ptr<GraphicsEngine> mEngine;
+        std::shared_ptr<ComputeProgram> mSolveProgram;
+        std::shared_ptr<ConstantBuffer> mBounds;
+        std::shared_ptr<StructuredBuffer> mVertexGraphBuffer;
+        std::shared_ptr<StructuredBuffer> mVertexGraphDataBuffer;
+        std::shared_ptr<StructuredBuffer> mOrderedVerticesBuffer;
+        std::array<std::shared_ptr<StructuredBuffer>, 2> mTCoordsBuffers;
+        Device mDevice;
+    };
+}
@@ -0,0 +1,287 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/GPUProfiler.h>
+#include <Mathematics/Logger.h>
+#include <fstream>
+#include <iomanip>
+using namespace gte;
+
+GPUProfiler::GPUProfiler(size_t numFrames, size_t maxScopes)
+    :
+    mSlots(numFrames),
+    mMaxScopes(maxScopes),
+    mNumBeginFrames(0),
+    mInFrame(false),
+    mCurrent(-1),
+    mOpenScopes{},
+    mTicks{},
+    mHasFrame(false),
+    mFrame{},
+    mMaxHistory(0),
+    mHistory{},
+    mNumDroppedFrames(0),
+    mNumDisjointFrames(0)
+{
+    LogAssert(numFrames > 0, "The profiler needs at least one frame slot.");
+
+    for (auto& slot : mSlots)
+    {
+        slot.pending = false;
+        slot.frame = 0;
+        slot.numTimestamps = 0;
+        slot.scopes.reserve(mMaxScopes);
+    }
+    mFrame.index = 0;
+    mFrame.start = 0.0;
+    mFrame.duration = 0.0;
+}
+
+void GPUProfiler::BeginFrame()
+{
+    LogAssert(!mInFrame, "BeginFrame called inside a frame.");
+
+    Resolve();
+
+    size_t const s = static_cast<size_t>(mNumBeginFrames % mSlots.size());
+    Slot& slot = mSlots[s];
+    if (slot.pending)
+    {
+        // The GPU has not finished the frame that used the slot, and the
+        // profiler does not wait for it.
+        ++mNumDroppedFrames;
+        mCurrent = -1;
+    }
+    else
+    {
+        slot.frame = mNumBeginFrames;
+        slot.numTimestamps = 0;
+        slot.scopes.clear();
+        mCurrent = static_cast<int32_t>(s);
+        BeginQueries(s);
+        WriteTimestamp(s, slot.numTimestamps++);
+    }
+
+    ++mNumBeginFrames;
+    mInFrame = true;
+    mOpenScopes.clear();
+}
+
+void GPUProfiler::EndFrame()
+{
+    LogAssert(mInFrame, "EndFrame called outside a frame.");
+
+    while (!mOpenScopes.empty())
+    {
+        EndScope();
+    }
+
+    if (mCurrent >= 0)
+    {
+        size_t const s = static_cast<size_t>(mCurrent);
+        Slot& slot = mSlots[s];
+        WriteTimestamp(s, slot.numTimestamps++);
+        EndQueries(s);
+        slot.pending = true;
+        mCurrent = -1;
+    }
+    mInFrame = false;
+}
+
+void GPUProfiler::BeginScope(std::string const& name)
+{
+    LogAssert(mInFrame, "BeginScope called outside a frame.");
+    LogAssert(name.size() > 0, "The scope name must be nonempty.");
+
+    int32_t index = -1;
+    if (mCurrent >= 0)
+    {
+        size_t const s = static_cast<size_t>(mCurrent);
+        Slot& slot = mSlots[s];
+        if (slot.scopes.size() < mMaxScopes)
+        {
+            PendingScope scope{};
+            scope.name = name;
+            scope.parent = (mOpenScopes.size() > 0 ? mOpenScopes.back() : -1);
+            scope.depth = static_cast<int32_t>(mOpenScopes.size());
+            scope.begin = slot.numTimestamps;
+            scope.end = slot.numTimestamps;
+            WriteTimestamp(s, slot.numTimestamps++);
+
+            index = static_cast<int32_t>(slot.scopes.size());
+            slot.scopes.push_back(scope);
+        }
+    }
+    mOpenScopes.push_back(index);
+}
+
+void GPUProfiler::EndScope()
+{
+    LogAssert(mOpenScopes.size() > 0, "EndScope called without an open scope.");
+
+    int32_t const index = mOpenScopes.back();
+    mOpenScopes.pop_back();
+    if (mCurrent >= 0 && index >= 0)
+    {
+        size_t const s = static_cast<size_t>(mCurrent);
+        Slot& slot = mSlots[s];
+        slot.scopes[index].end = slot.numTimestamps;
+        WriteTimestamp(s, slot.numTimestamps++);
+    }
+}
+
+void GPUProfiler::SetMaxHistory(size_t maxHistory)
+{
+    mMaxHistory = maxHistory;
+    if (mHistory.size() > mMaxHistory)
+    {
+        mHistory.erase(mHistory.begin(), mHistory.end() - mMaxHistory);
+    }
+}
+
+void GPUProfiler::WriteChromeTrace(std::ostream& output, std::vector<Frame> const& frames)
+{
+    auto writeName = [&output](std::string const& name)
+    {
+        output << '"';
+        for (auto c : name)
+        {
+            if (c == '"' || c == '\\')
+            {
+                output << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                output << ' ';
+            }
+            else
+            {
+                output << c;
+            }
+        }
+        output << '"';
+    };
+
+    // The times of a trace are in microseconds.
+    auto writeEvent = [&output, &writeName](std::string const& name,
+        double begin, double duration, uint64_t frame, bool isFirst)
+    {
+        output << (isFirst ? "\n" : ",\n") << "{\"name\":";
+        writeName(name);
+        output << ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":0,\"tid\":0"
+            << ",\"ts\":" << 1e6 * begin << ",\"dur\":" << 1e6 * duration
+            << ",\"args\":{\"frame\":" << frame << "}}";
+    };
+
+    std::ios_base::fmtflags const flags = output.flags();
+    std::streamsize const precision = output.precision();
+    output << std::fixed << std::setprecision(3) << "[";
+    bool isFirst = true;
+    for (auto const& frame : frames)
+    {
+        writeEvent("frame", frame.start, frame.duration, frame.index, isFirst);
+        isFirst = false;
+        for (auto const& scope : frame.scopes)
+        {
+            writeEvent(scope.name, frame.start + scope.begin,
+                scope.end - scope.begin, frame.index, false);
+        }
+    }
+    output << "\n]\n";
+    output.flags(flags);
+    output.precision(precision);
+}
+
+bool GPUProfiler::ExportChromeTrace(std::string const& filename) const
+{
+    std::ofstream output(filename);
+    if (!output)
+    {
+        return false;
+    }
+
+    WriteChromeTrace(output, mHistory);
+    return static_cast<bool>(output);
+}
+
+void GPUProfiler::Resolve()
+{
+    // The pending slots are resolved in frame order so that the history
+    // is sorted by frame index.
+    size_t const numFrames = mSlots.size();
+    for (size_t k = 0; k < numFrames; ++k)
+    {
+        size_t oldest = numFrames;
+        for (size_t s = 0; s < numFrames; ++s)
+        {
+            if (mSlots[s].pending &&
+                (oldest == numFrames || mSlots[s].frame < mSlots[oldest].frame))
+            {
+                oldest = s;
+            }
+        }
+
+        if (oldest == numFrames || !Resolve(mSlots[oldest], oldest))
+        {
+            return;
+        }
+    }
+}
+
+bool GPUProfiler::Resolve(Slot& slot, size_t s)
+{
+    mTicks.resize(slot.numTimestamps);
+    double frequency = 0.0;
+    bool valid = false;
+    if (!ReadTimestamps(s, slot.numTimestamps, mTicks, frequency, valid))
+    {
+        return false;
+    }
+    slot.pending = false;
+
+    if (!valid || frequency <= 0.0)
+    {
+        ++mNumDisjointFrames;
+        return true;
+    }
+
+    // The differences are signed so that a timestamp that precedes the
+    // beginning of the frame does not wrap around.
+    double const invFrequency = 1.0 / frequency;
+    uint64_t const origin = mTicks[0];
+    auto getTime = [this, origin, invFrequency](size_t t)
+    {
+        return invFrequency * static_cast<double>(static_cast<int64_t>(mTicks[t] - origin));
+    };
+
+    mFrame.index = slot.frame;
+    mFrame.start = invFrequency * static_cast<double>(origin);
+    mFrame.duration = getTime(slot.numTimestamps - 1);
+    mFrame.scopes.resize(slot.scopes.size());
+    for (size_t i = 0; i < slot.scopes.size(); ++i)
+    {
+        PendingScope const& pending = slot.scopes[i];
+        Scope& scope = mFrame.scopes[i];
+        scope.name = pending.name;
+        scope.parent = pending.parent;
+        scope.depth = pending.depth;
+        scope.begin = getTime(pending.begin);
+        scope.end = getTime(pending.end);
+    }
+    mHasFrame = true;
+
+    if (mMaxHistory > 0)
+    {
+        if (mHistory.size() == mMaxHistory)
+        {
+            mHistory.erase(mHistory.begin());
+        }
+        mHistory.push_back(mFrame);
+    }
+    return true;
+}
@@ -0,0 +1,226 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// GPU timing of named, nested scopes. A frame is bracketed by BeginFrame and
+// EndFrame, and each scope by BeginScope and EndScope, or by a ScopedTimer.
+// Every begin and end writes a timestamp query into the command stream. The
+// queries of a frame are stored in one of numFrames slots of a ring, and the
+// results of a slot are read without waiting when the slot is reused, so the
+// CPU never stalls on the GPU; the frame results lag by up to numFrames - 1
+// frames. When the GPU is so far behind that the slot of a new frame still
+// has pending results, the new frame is not measured and is counted as
+// dropped. A frame has at most maxScopes scopes; the scopes beyond the limit
+// are not measured.
+//
+// Create the profiler with GraphicsEngine::CreateGPUProfiler. The profiler
+// must be used on the thread that draws with the engine.
+//
+//   auto profiler = engine->CreateGPUProfiler(4, 64);
+//   profiler->BeginFrame();
+//   {
+//       GPUProfiler::ScopedTimer timer(*profiler, "spheres");
+//       engine->Draw(spheres);
+//   }
+//   profiler->EndFrame();
+//   engine->DisplayColorBuffer(1);
+
+namespace gte
+{
+    class GPUProfiler
+    {
+    public:
+        // Abstract base class.
+        virtual ~GPUProfiler() = default;
+
+        // A scope of a resolved frame. The scopes are stored in the order in
+        // which they began, so a parent precedes its children. The parent of
+        // a top-level scope is -1 and its depth is 0. The times are in
+        // seconds relative to the beginning of the frame.
+        struct Scope
+        {
+            std::string name;
+            int32_t parent;
+            int32_t depth;
+            double begin, end;
+        };
+
+        // A resolved frame. The frame index is the number of calls to
+        // BeginFrame that preceded the frame. The start time is in seconds
+        // on the GPU clock, which is comparable across the frames of one
+        // disjoint-free interval and is used to place the frames on the
+        // timeline of a trace. The duration is from BeginFrame to EndFrame.
+        struct Frame
+        {
+            uint64_t index;
+            double start, duration;
+            std::vector<Scope> scopes;
+        };
+
+        // Frame and scope markers. The scope names must be nonempty. Scopes
+        // must be properly nested inside a frame; the scopes that are still
+        // open at EndFrame are ended there.
+        void BeginFrame();
+        void EndFrame();
+        void BeginScope(std::string const& name);
+        void EndScope();
+
+        class ScopedTimer
+        {
+        public:
+            ScopedTimer(GPUProfiler& profiler, std::string const& name)
+                :
+                mProfiler(profiler)
+            {
+                mProfiler.BeginScope(name);
+            }
+
+            ~ScopedTimer()
+            {
+                mProfiler.EndScope();
+            }
+
+        private:
+            GPUProfiler& mProfiler;
+        };
+
+        // The most recently resolved frame. HasFrame() is false until the
+        // results of the first frame are available.
+        inline bool HasFrame() const
+        {
+            return mHasFrame;
+        }
+
+        inline Frame const& GetFrame() const
+        {
+            return mFrame;
+        }
+
+        // Resolved frames are appended to the history, which keeps the
+        // latest maxHistory frames. The default is 0, in which case only
+        // GetFrame() is available.
+        void SetMaxHistory(size_t maxHistory);
+
+        inline size_t GetMaxHistory() const
+        {
+            return mMaxHistory;
+        }
+
+        inline std::vector<Frame> const& GetHistory() const
+        {
+            return mHistory;
+        }
+
+        inline void ClearHistory()
+        {
+            mHistory.clear();
+        }
+
+        // The number of frames that were not measured because their slot
+        // was still pending, and the number of frames whose timestamps were
+        // discarded because the GPU clock was disjoint.
+        inline uint64_t GetNumDroppedFrames() const
+        {
+            return mNumDroppedFrames;
+        }
+
+        inline uint64_t GetNumDisjointFrames() const
+        {
+            return mNumDisjointFrames;
+        }
+
+        // Write the frames as a Chrome trace, a JSON array of complete
+        // events that chrome://tracing and Perfetto display as a timeline.
+        // Each frame is an event named "frame" and each scope is an event
+        // nested in it.
+        static void WriteChromeTrace(std::ostream& output, std::vector<Frame> const& frames);
+
+        // Write the history as a Chrome trace. The function returns false
+        // when the file cannot be opened.
+        bool ExportChromeTrace(std::string const& filename) const;
+
+    protected:
+        GPUProfiler(size_t numFrames, size_t maxScopes);
+
+        // The number of timestamps of a slot: one at each end of the frame
+        // and one at each end of a scope.
+        inline size_t GetMaxTimestamps() const
+        {
+            return 2 * mMaxScopes + 2;
+        }
+
+        inline size_t GetNumFrames() const
+        {
+            return mSlots.size();
+        }
+
+        // The graphics API-specific queries. BeginQueries and EndQueries
+        // bracket the timestamps of a slot. WriteTimestamp writes timestamp
+        // t of the slot into the command stream. ReadTimestamps must not
+        // wait for the GPU: it returns false when the results of the slot
+        // are not yet available. Otherwise it stores the first numTimestamps
+        // timestamps of the slot in ticks, the number of ticks per second in
+        // frequency and whether the timestamps are valid, which they are not
+        // when the GPU clock was disjoint.
+        virtual void BeginQueries(size_t slot) = 0;
+        virtual void WriteTimestamp(size_t slot, size_t t) = 0;
+        virtual void EndQueries(size_t slot) = 0;
+        virtual bool ReadTimestamps(size_t slot, size_t numTimestamps,
+            std::vector<uint64_t>& ticks, double& frequency, bool& valid) = 0;
+
+    private:
+        // A scope of a pending frame. The timestamp indices of a scope are
+        // assigned in the order of the begin and end calls.
+        struct PendingScope
+        {
+            std::string name;
+            int32_t parent;
+            int32_t depth;
+            size_t begin, end;
+        };
+
+        struct Slot
+        {
+            bool pending;
+            uint64_t frame;
+            size_t numTimestamps;
+            std::vector<PendingScope> scopes;
+        };
+
+        // Read the results of the pending slots, oldest first, stopping at
+        // the first slot whose results are not available.
+        void Resolve();
+        bool Resolve(Slot& slot, size_t s);
+
+        std::vector<Slot> mSlots;
+        size_t mMaxScopes;
+        uint64_t mNumBeginFrames;
+
+        // The state of the frame being recorded. mCurrent is the slot or
+        // -1 when no frame is being recorded or the frame is not measured.
+        // The stack holds the indices into the slot scopes of the open
+        // scopes, or -1 for the scopes beyond the limit.
+        bool mInFrame;
+        int32_t mCurrent;
+        std::vector<int32_t> mOpenScopes;
+
+        std::vector<uint64_t> mTicks;
+        bool mHasFrame;
+        Frame mFrame;
+        size_t mMaxHistory;
+        std::vector<Frame> mHistory;
+        uint64_t mNumDroppedFrames;
+        uint64_t mNumDisjointFrames;
+    };
+}
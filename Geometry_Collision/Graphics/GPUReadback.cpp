@@ -0,0 +1,117 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/GPUReadback.h>
+#include <Mathematics/Logger.h>
+#include <cstring>
+using namespace gte;
+
+GPUReadback::GPUReadback(std::shared_ptr<Buffer> const& buffer, size_t numSlots)
+    :
+    mBuffer(buffer),
+    mSlots(numSlots),
+    mNext(0),
+    mNumPending(0),
+    mNumRequests(0),
+    mTicket(0),
+    mData{},
+    mNumDroppedRequests(0)
+{
+    LogAssert(buffer != nullptr, "Input buffer is null.");
+    LogAssert(numSlots > 0, "The readback needs at least one staging slot.");
+
+    for (auto& slot : mSlots)
+    {
+        slot.ticket = 0;
+        slot.offset = 0;
+        slot.numBytes = 0;
+    }
+}
+
+uint64_t GPUReadback::Request()
+{
+    if (mNumPending == mSlots.size())
+    {
+        ++mNumDroppedRequests;
+        return 0;
+    }
+
+    Slot& slot = mSlots[mNext];
+    slot.ticket = ++mNumRequests;
+    slot.offset = static_cast<size_t>(mBuffer->GetOffset()) *
+        static_cast<size_t>(mBuffer->GetElementSize());
+    slot.numBytes = static_cast<size_t>(mBuffer->GetNumActiveBytes());
+    CopyToSlot(mNext, slot.offset, slot.numBytes);
+
+    mNext = (mNext + 1) % mSlots.size();
+    ++mNumPending;
+    return slot.ticket;
+}
+
+bool GPUReadback::Poll()
+{
+    bool completed = false;
+    while (mNumPending > 0 && ReadOldest(false))
+    {
+        completed = true;
+    }
+    return completed;
+}
+
+bool GPUReadback::Wait(uint64_t ticket)
+{
+    if (ticket == 0 || ticket > mNumRequests)
+    {
+        return false;
+    }
+
+    while (mTicket < ticket)
+    {
+        ReadOldest(true);
+    }
+    return true;
+}
+
+bool GPUReadback::CopyToBuffer() const
+{
+    if (mTicket == 0)
+    {
+        return false;
+    }
+
+    // The slot of the newest completed copy is the one before the oldest
+    // pending slot.
+    size_t const numSlots = mSlots.size();
+    Slot const& slot = mSlots[(mNext + numSlots - mNumPending - 1) % numSlots];
+    if (slot.offset + mData.size() > static_cast<size_t>(mBuffer->GetNumBytes()))
+    {
+        return false;
+    }
+    if (!mBuffer->GetData())
+    {
+        mBuffer->CreateStorage();
+    }
+    std::memcpy(mBuffer->GetData() + slot.offset, mData.data(), mData.size());
+    return true;
+}
+
+bool GPUReadback::ReadOldest(bool wait)
+{
+    size_t const numSlots = mSlots.size();
+    size_t const s = (mNext + numSlots - mNumPending) % numSlots;
+    Slot const& slot = mSlots[s];
+    mData.resize(slot.numBytes);
+    if (!ReadSlot(s, slot.numBytes, wait, mData.data()))
+    {
+        return false;
+    }
+
+    mTicket = slot.ticket;
+    --mNumPending;
+    return true;
+}
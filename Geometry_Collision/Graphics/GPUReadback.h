@@ -0,0 +1,127 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Buffer.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Asynchronous copies of a Buffer from GPU memory to CPU memory. Request
+// writes a copy of the active elements of the buffer into one of numSlots
+// staging buffers, followed by a fence, into the command stream and returns
+// the ticket of the copy. Poll reads the staging buffers whose fences have
+// signaled, oldest first, without waiting for the GPU; a copy usually
+// completes one to three frames after its request. Unlike CopyGpuToCpu
+// followed by WaitForFinish, the CPU never stalls. When the GPU is so far
+// behind that all slots are pending, Request does not record a copy,
+// returns 0 and counts the request as dropped.
+//
+// Create the readback with GraphicsEngine::CreateGPUReadback. The readback
+// must be used on the thread that draws with the engine.
+//
+//   auto readback = engine->CreateGPUReadback(contacts, 3);
+//   // Every frame:
+//   engine->Execute(physicsProgram, numXGroups, 1, 1);
+//   readback->Request();
+//   if (readback->Poll())
+//   {
+//       // readback->GetData() holds the contacts of the copy with ticket
+//       // readback->GetTicket().
+//   }
+
+namespace gte
+{
+    class GPUReadback
+    {
+    public:
+        // Abstract base class.
+        virtual ~GPUReadback() = default;
+
+        // Record a copy of the current GPU contents of the buffer. The
+        // tickets of the recorded copies are 1, 2, 3 and so on.
+        uint64_t Request();
+
+        // Read the completed copies without waiting. The function returns
+        // true when a copy newer than the previous GetTicket() completed.
+        bool Poll();
+
+        // Wait until the copy with the specified ticket has completed, for
+        // example before shutdown. The function returns false when the
+        // ticket was not issued.
+        bool Wait(uint64_t ticket);
+
+        // The ticket of the newest completed copy, or 0 when no copy has
+        // completed, and its bytes, which are the active bytes of the
+        // buffer when the copy was requested.
+        inline uint64_t GetTicket() const
+        {
+            return mTicket;
+        }
+
+        inline std::vector<char> const& GetData() const
+        {
+            return mData;
+        }
+
+        // Copy GetData() to the CPU storage of the buffer, as CopyGpuToCpu
+        // would have. The function returns false when no copy has
+        // completed.
+        bool CopyToBuffer() const;
+
+        inline std::shared_ptr<Buffer> const& GetBuffer() const
+        {
+            return mBuffer;
+        }
+
+        inline size_t GetNumSlots() const
+        {
+            return mSlots.size();
+        }
+
+        inline uint64_t GetNumDroppedRequests() const
+        {
+            return mNumDroppedRequests;
+        }
+
+    protected:
+        GPUReadback(std::shared_ptr<Buffer> const& buffer, size_t numSlots);
+
+        // The graphics API-specific copies. CopyToSlot writes into the
+        // command stream a copy of numBytes bytes of the buffer, starting at
+        // byte offset, to staging buffer 'slot', followed by a fence.
+        // ReadSlot copies the first numBytes bytes of the staging buffer to
+        // 'data' once the fence has signaled. When 'wait' is false it must
+        // not wait for the GPU and returns false when the fence has not
+        // signaled.
+        virtual void CopyToSlot(size_t slot, size_t offset, size_t numBytes) = 0;
+        virtual bool ReadSlot(size_t slot, size_t numBytes, bool wait, char* data) = 0;
+
+        std::shared_ptr<Buffer> mBuffer;
+
+    private:
+        struct Slot
+        {
+            uint64_t ticket;
+            size_t offset, numBytes;
+        };
+
+        // Read the oldest pending slot, which completes first.
+        bool ReadOldest(bool wait);
+
+        // The pending slots are mSlots[(mNext - mNumPending) % numSlots]
+        // through mSlots[(mNext - 1) % numSlots], oldest first.
+        std::vector<Slot> mSlots;
+        size_t mNext, mNumPending;
+        uint64_t mNumRequests;
+        uint64_t mTicket;
+        std::vector<char> mData;
+        uint64_t mNumDroppedRequests;
+    };
+}
@@ -12,6 +12,8 @@
 #include <Graphics/GEDrawTarget.h>
 #include <Graphics/GEInputLayoutManager.h>
 #include <Graphics/GEObject.h>
+#include <Graphics/GPUProfiler.h>
+#include <Graphics/GPUReadback.h>
 #include <Graphics/Graphics.h>
 #include <Graphics/GraphicsEngine.h>
 #include <Graphics/GraphicsObject.h>
@@ -20,6 +22,8 @@
 #include <Graphics/AmbientLightEffect.h>
 #include <Graphics/AreaLightEffect.h>
 #include <Graphics/BumpMapEffect.h>
+#include <Graphics/ClusteredLightEffect.h>
+#include <Graphics/ClusteredLighting.h>
 #include <Graphics/ConstantColorEffect.h>
 #include <Graphics/CubeMapEffect.h>
 #include <Graphics/DirectionalLightEffect.h>
@@ -34,11 +38,13 @@
 #include <Graphics/FontArialW700H16.h>
 #include <Graphics/FontArialW700H18.h>
 #include <Graphics/GlossMapEffect.h>
+#include <Graphics/InstancedTexture2Effect.h>
 #include <Graphics/LightCameraGeometry.h>
 #include <Graphics/LightEffect.h>
 #include <Graphics/Lighting.h>
 #include <Graphics/Material.h>
 #include <Graphics/OverlayEffect.h>
+#include <Graphics/ParticleBillboardEffect.h>
 #include <Graphics/PlanarShadowEffect.h>
 #include <Graphics/PlanarReflectionEffect.h>
 #include <Graphics/PointLightEffect.h>
@@ -46,6 +52,8 @@
 #include <Graphics/ProjectedTextureEffect.h>
 #include <Graphics/SphereMapEffect.h>
 #include <Graphics/SpotLightEffect.h>
+#include <Graphics/TextBatch.h>
+#include <Graphics/TextBatchEffect.h>
 #include <Graphics/TextEffect.h>
 #include <Graphics/Texture2Effect.h>
 #include <Graphics/Texture3Effect.h>
@@ -69,10 +77,12 @@
 #include <Graphics/TextureBuffer.h>
 #include <Graphics/TypedBuffer.h>
 #include <Graphics/VertexBuffer.h>
+#include <Graphics/VertexCompression.h>
 #include <Graphics/VertexFormat.h>
 
 // Resources/Textures
 #include <Graphics/DrawTarget.h>
+#include <Graphics/DrawTargetPool.h>
 #include <Graphics/Texture.h>
 #include <Graphics/Texture1.h>
 #include <Graphics/Texture1Array.h>
@@ -85,19 +95,25 @@
 #include <Graphics/TextureDS.h>
 #include <Graphics/TextureRT.h>
 #include <Graphics/TextureSingle.h>
+#include <Graphics/TextureStreamer.h>
 
 // SceneGraph
 #include <Graphics/MeshFactory.h>
+#include <Graphics/MeshOptimizer.h>
 
 // SceneGraph/CollisionDetection
 #include <Graphics/CollisionGroup.h>
 #include <Graphics/CollisionRecord.h>
 #include <Graphics/CollisionMesh.h>
+#include <Graphics/GPUGenerateMeshUV.h>
+#include <Graphics/TetrahedraVoxelizer.h>
 
 // SceneGraph/Controllers
+#include <Graphics/AnimationBatch.h>
 #include <Graphics/BlendTransformController.h>
 #include <Graphics/Controller.h>
 #include <Graphics/ControlledObject.h>
+#include <Graphics/IKBatchSolver.h>
 #include <Graphics/IKController.h>
 #include <Graphics/KeyframeController.h>
 #include <Graphics/MorphController.h>
@@ -111,6 +127,7 @@
 #include <Graphics/CLODCollapseRecord.h>
 #include <Graphics/CLODMesh.h>
 #include <Graphics/CLODMeshCreator.h>
+#include <Graphics/DLODBatch.h>
 #include <Graphics/DLODNode.h>
 #include <Graphics/SwitchNode.h>
 
@@ -122,6 +139,7 @@
 #include <Graphics/Particles.h>
 #include <Graphics/PVWUpdater.h>
 #include <Graphics/Spatial.h>
+#include <Graphics/TransformHierarchy.h>
 #include <Graphics/ViewVolume.h>
 #include <Graphics/ViewVolumeNode.h>
 #include <Graphics/Visual.h>
@@ -135,13 +153,17 @@
 
 // SceneGraph/Terrain
 #include <Graphics/Terrain.h>
+#include <Graphics/TerrainStreamer.h>
 
 // SceneGraph/Visibility
 #include <Graphics/CullingPlane.h>
 #include <Graphics/Culler.h>
+#include <Graphics/HiZCuller.h>
+#include <Graphics/RenderQueue.h>
 
 // Shaders
 #include <Graphics/ComputeProgram.h>
+#include <Graphics/ProgramCache.h>
 #include <Graphics/ProgramDefines.h>
 #include <Graphics/ProgramFactory.h>
 #include <Graphics/Shader.h>
@@ -8,10 +8,18 @@
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/GraphicsEngine.h>
 #include <Mathematics/Logger.h>
+#include <Mathematics/Trace.h>
 using namespace gte;
 
+std::atomic<uint32_t> GraphicsEngine::msNextEngineID(1);
+
 GraphicsEngine::GraphicsEngine()
     :
+    mEngineID(msNextEngineID.fetch_add(1)),
+    mGOSlots{},
+    mNumGOSlots(0),
+    mFreeGOSlots{},
+    mBatchingText(false),
     mCreateGEDrawTarget(nullptr),
     mGEObjectCreator(nullptr),
     mAllowOcclusionQuery(false),
@@ -31,6 +39,9 @@ void GraphicsEngine::SetFont(std::shared_ptr<Font> const& font)
     LogAssert(font != nullptr, "Input font is null.");
     if (font != mActiveFont)
     {
+        // The strings of a batch are drawn with one font.
+        LogAssert(!mBatchingText, "The font cannot change between BeginText and EndText.");
+
         // Destroy font resources in GPU memory.  The mActiveFont should
         // be null once, only when the mDefaultFont is created.
         if (mActiveFont)
@@ -41,6 +52,12 @@ void GraphicsEngine::SetFont(std::shared_ptr<Font> const& font)
             Unbind(mActiveFont->GetTextEffect()->GetColor());
             Unbind(mActiveFont->GetTextEffect()->GetVertexShader());
             Unbind(mActiveFont->GetTextEffect()->GetPixelShader());
+            if (mTextBatch)
+            {
+                Unbind(mTextBatch->GetVertexBuffer());
+                Unbind(mTextBatch->GetIndexBuffer());
+                mTextBatch = nullptr;
+            }
         }
 
         mActiveFont = font;
@@ -57,6 +74,7 @@ void GraphicsEngine::SetFont(std::shared_ptr<Font> const& font)
 
 uint64_t GraphicsEngine::Draw(Visual* visual)
 {
+    GTE_TRACE_SCOPE("GraphicsEngine::Draw");
     LogAssert(visual != nullptr, "Input visual is null.");
     auto const& vbuffer = visual->GetVertexBuffer();
     auto const& ibuffer = visual->GetIndexBuffer();
@@ -70,12 +88,11 @@ uint64_t GraphicsEngine::Draw(Visual* visual)
 
 uint64_t GraphicsEngine::Draw(std::vector<Visual*> const& visuals)
 {
-    uint64_t numPixelsDrawn = 0;
     for (auto const& visual : visuals)
     {
-        numPixelsDrawn += Draw(visual);
+        LogAssert(visual != nullptr, "Input visual is null.");
     }
-    return numPixelsDrawn;
+    return DrawPrimitives(visuals);
 }
 
 uint64_t GraphicsEngine::Draw(std::shared_ptr<Visual> const& visual)
@@ -85,19 +102,34 @@ uint64_t GraphicsEngine::Draw(std::shared_ptr<Visual> const& visual)
 
 uint64_t GraphicsEngine::Draw(std::vector<std::shared_ptr<Visual>> const& visuals)
 {
-    uint64_t numPixelsDrawn = 0;
-    for (auto const& visual : visuals)
+    std::vector<Visual*> rawVisuals(visuals.size());
+    for (size_t i = 0; i < visuals.size(); ++i)
     {
-        numPixelsDrawn += Draw(visual);
+        rawVisuals[i] = visuals[i].get();
     }
-    return numPixelsDrawn;
+    return Draw(rawVisuals);
+}
+
+uint64_t GraphicsEngine::Draw(RenderQueue& queue)
+{
+    if (!queue.IsSorted())
+    {
+        queue.Sort();
+    }
+    return DrawPrimitives(queue.GetVisuals());
 }
 
 uint64_t GraphicsEngine::Draw(int32_t x, int32_t y, std::array<float, 4> const& color, std::string const& message)
 {
+    GTE_TRACE_SCOPE("GraphicsEngine::DrawText");
     uint64_t numPixelsDrawn;
 
-    if (message.length() > 0)
+    if (mBatchingText)
+    {
+        mTextBatch->Add(x, y, color, message);
+        numPixelsDrawn = 0;
+    }
+    else if (message.length() > 0)
     {
         int32_t vx, vy, vw, vh;
         GetViewport(vx, vy, vw, vh);
@@ -131,8 +163,59 @@ uint64_t GraphicsEngine::Draw(int32_t x, int32_t y, std::array<float, 4> const&
     return numPixelsDrawn;
 }
 
+void GraphicsEngine::BeginText()
+{
+    LogAssert(!mBatchingText, "BeginText was already called.");
+    if (!mTextBatch)
+    {
+        mTextBatch = std::make_shared<TextBatch>(mActiveFont);
+    }
+    mTextBatch->Clear();
+    mBatchingText = true;
+}
+
+uint64_t GraphicsEngine::EndText()
+{
+    LogAssert(mBatchingText, "BeginText was not called.");
+    mBatchingText = false;
+    return Draw(*mTextBatch);
+}
+
+uint64_t GraphicsEngine::Draw(TextBatch& batch)
+{
+    GTE_TRACE_SCOPE("GraphicsEngine::DrawTextBatch");
+    int32_t vx, vy, vw, vh;
+    GetViewport(vx, vy, vw, vh);
+    if (batch.Typeset(vw, vh))
+    {
+        Update(batch.GetVertexBuffer());
+    }
+    if (batch.GetNumCharacters() == 0)
+    {
+        return 0;
+    }
+
+    // We need to restore default state for text drawing.  Remember the
+    // current state so that we can reset it after drawing.
+    std::shared_ptr<BlendState> bState = GetBlendState();
+    std::shared_ptr<DepthStencilState> dState = GetDepthStencilState();
+    std::shared_ptr<RasterizerState> rState = GetRasterizerState();
+    SetDefaultBlendState();
+    SetDefaultDepthStencilState();
+    SetDefaultRasterizerState();
+
+    uint64_t numPixelsDrawn = DrawPrimitive(batch.GetVertexBuffer(),
+        batch.GetIndexBuffer(), batch.GetFont()->GetTextBatchEffect());
+
+    SetBlendState(bState);
+    SetDepthStencilState(dState);
+    SetRasterizerState(rState);
+    return numPixelsDrawn;
+}
+
 uint64_t GraphicsEngine::Draw(std::shared_ptr<OverlayEffect> const& overlay)
 {
+    GTE_TRACE_SCOPE("GraphicsEngine::DrawOverlay");
     LogAssert(overlay != nullptr, "Input overlay is null.");
     auto const& vbuffer = overlay->GetVertexBuffer();
     auto const& ibuffer = overlay->GetIndexBuffer();
@@ -144,15 +227,31 @@ uint64_t GraphicsEngine::Draw(std::shared_ptr<OverlayEffect> const& overlay)
     return 0;
 }
 
+uint64_t GraphicsEngine::DrawPrimitives(std::vector<Visual*> const& visuals)
+{
+    GTE_TRACE_SCOPE("GraphicsEngine::DrawPrimitives");
+    uint64_t numPixelsDrawn = 0;
+    for (auto const& visual : visuals)
+    {
+        numPixelsDrawn += Draw(visual);
+    }
+    return numPixelsDrawn;
+}
+
 GEObject* GraphicsEngine::Bind(std::shared_ptr<GraphicsObject> const& object)
 {
     LogAssert(object != nullptr, "Attempt to bind a null object.");
 
-    mGOMapMutex.lock();
     GraphicsObject const* gtObject = object.get();
-    GEObject* geObjectPtr = nullptr;
-    auto iter = mGOMap.find(gtObject);
-    if (iter == mGOMap.end())
+    GEObject* geObjectPtr = FindGEObject(gtObject);
+    if (geObjectPtr)
+    {
+        return geObjectPtr;
+    }
+
+    mGOMapMutex.lock();
+    geObjectPtr = FindGEObjectLocked(gtObject);
+    if (!geObjectPtr)
     {
         // The 'create' function is not null with the current engine design.
         // If the assertion is triggered, someone changed the hierarchy of
@@ -163,19 +262,14 @@ GEObject* GraphicsEngine::Bind(std::shared_ptr<GraphicsObject> const& object)
             auto geObject = create(mGEObjectCreator, gtObject);
             LogAssert(geObject != nullptr, "Unexpected condition.");
 
-            iter = mGOMap.insert(std::make_pair(gtObject, geObject)).first;
+            geObjectPtr = InsertGEObjectLocked(gtObject, geObject);
 #if defined(GTE_GRAPHICS_USE_NAMED_OBJECTS)
             geObject->SetName(object->GetName());
 #endif
-            geObjectPtr = iter->second.get();
         }
         // else: No logger message is generated here because GL4 does not have
         // shader creation functions.
     }
-    else
-    {
-        geObjectPtr = iter->second.get();
-    }
     mGOMapMutex.unlock();
     return geObjectPtr;
 }
@@ -217,16 +311,7 @@ GEDrawTarget* GraphicsEngine::Bind(std::shared_ptr<DrawTarget> const& target)
 
 GEObject* GraphicsEngine::Get(std::shared_ptr<GraphicsObject> const& object) const
 {
-    mGOMapMutex.lock();
-    GraphicsObject const* gtObject = object.get();
-    GEObject* geObject = nullptr;
-    auto iter = mGOMap.find(gtObject);
-    if (iter != mGOMap.end())
-    {
-        geObject = iter->second.get();
-    }
-    mGOMapMutex.unlock();
-    return geObject;
+    return FindGEObject(object.get());
 }
 
 GEDrawTarget* GraphicsEngine::Get(std::shared_ptr<DrawTarget> const& target) const
@@ -248,9 +333,8 @@ void GraphicsEngine::GetTotalAllocation(size_t& numBytes, size_t& numObjects) co
     mGOMapMutex.lock();
     numBytes = 0;
     numObjects = 0;
-    for (auto const& element : mGOMap)
+    auto accumulate = [&numBytes, &numObjects](std::shared_ptr<GEObject> const& object)
     {
-        auto const& object = element.second;
         if (object)
         {
             auto resource = dynamic_cast<Resource*>(object->GetGraphicsObject());
@@ -260,6 +344,14 @@ void GraphicsEngine::GetTotalAllocation(size_t& numBytes, size_t& numObjects) co
                 numBytes += resource->GetNumBytes();
             }
         }
+    };
+    for (uint32_t slot = 0; slot < mNumGOSlots; ++slot)
+    {
+        accumulate((*mGOSlots[slot / GOSlotChunkSize])[slot % GOSlotChunkSize]);
+    }
+    for (auto const& element : mGOMap)
+    {
+        accumulate(element.second);
     }
     mGOMapMutex.unlock();
 }
@@ -288,8 +380,7 @@ bool GraphicsEngine::Unbind(GraphicsObject const* object)
 {
     mGOMapMutex.lock();
     bool success = false;
-    auto iter = mGOMap.find(object);
-    if (iter != mGOMap.end())
+    if (FindGEObjectLocked(object))
     {
         uint32_t type = object->GetType();
         if (type == GT_VERTEX_BUFFER)
@@ -301,8 +392,7 @@ bool GraphicsEngine::Unbind(GraphicsObject const* object)
             mILMap->Unbind(static_cast<Shader const*>(object));
         }
 
-        mGOMap.erase(iter);
-        success = true;
+        success = EraseGEObjectLocked(object);
     }
     mGOMapMutex.unlock();
     return success;
@@ -322,6 +412,133 @@ bool GraphicsEngine::Unbind(DrawTarget const* target)
     return success;
 }
 
+GEObject* GraphicsEngine::FindGEObject(GraphicsObject const* object) const
+{
+    // The handle of a bound object changes only in Unbind, which must not
+    // run concurrently with the use of the object, so a handle of this
+    // engine refers to a valid slot.
+    uint64_t const handle = object->GetBridgeHandle();
+    if (static_cast<uint32_t>(handle >> 32) == mEngineID)
+    {
+        uint32_t const slot = static_cast<uint32_t>(handle);
+        return (*mGOSlots[slot / GOSlotChunkSize])[slot % GOSlotChunkSize].get();
+    }
+
+    mGOMapMutex.lock();
+    GEObject* geObject = FindGEObjectLocked(object);
+    mGOMapMutex.unlock();
+    return geObject;
+}
+
+GEObject* GraphicsEngine::InsertGEObject(GraphicsObject const* object,
+    std::shared_ptr<GEObject> const& geObject)
+{
+    mGOMapMutex.lock();
+    GEObject* geObjectPtr = InsertGEObjectLocked(object, geObject);
+    mGOMapMutex.unlock();
+    return geObjectPtr;
+}
+
+void GraphicsEngine::ClearGEObjects()
+{
+    mGOMapMutex.lock();
+    uint64_t const engineBits = static_cast<uint64_t>(mEngineID) << 32;
+    for (uint32_t slot = 0; slot < mNumGOSlots; ++slot)
+    {
+        auto& geObject = (*mGOSlots[slot / GOSlotChunkSize])[slot % GOSlotChunkSize];
+        if (geObject)
+        {
+            // The GraphicsObject is alive, because its destruction would
+            // have unbound it.  Release its handle so that another engine
+            // can give it a slot.
+            GraphicsObject* gtObject = geObject->GetGraphicsObject();
+            if (gtObject)
+            {
+                gtObject->ExchangeBridgeHandle(engineBits | slot, 0);
+            }
+            geObject = nullptr;
+        }
+    }
+    mNumGOSlots = 0;
+    mFreeGOSlots.clear();
+    mGOMap.clear();
+    mGOMapMutex.unlock();
+}
+
+GEObject* GraphicsEngine::FindGEObjectLocked(GraphicsObject const* object) const
+{
+    uint64_t const handle = object->GetBridgeHandle();
+    if (static_cast<uint32_t>(handle >> 32) == mEngineID)
+    {
+        uint32_t const slot = static_cast<uint32_t>(handle);
+        return (*mGOSlots[slot / GOSlotChunkSize])[slot % GOSlotChunkSize].get();
+    }
+
+    auto iter = mGOMap.find(object);
+    return (iter != mGOMap.end() ? iter->second.get() : nullptr);
+}
+
+GEObject* GraphicsEngine::InsertGEObjectLocked(GraphicsObject const* object,
+    std::shared_ptr<GEObject> const& geObject)
+{
+    GEObject* geObjectPtr = FindGEObjectLocked(object);
+    if (geObjectPtr)
+    {
+        return geObjectPtr;
+    }
+
+    if (object->GetBridgeHandle() == 0 &&
+        (!mFreeGOSlots.empty() || mNumGOSlots < GOSlotChunkSize * MaxGOSlotChunks))
+    {
+        uint32_t slot;
+        if (!mFreeGOSlots.empty())
+        {
+            slot = mFreeGOSlots.back();
+            mFreeGOSlots.pop_back();
+        }
+        else
+        {
+            slot = mNumGOSlots++;
+            auto& chunk = mGOSlots[slot / GOSlotChunkSize];
+            if (!chunk)
+            {
+                chunk = std::make_unique<GOSlotChunk>();
+            }
+        }
+
+        // The slot is filled before the handle is published, so a lookup
+        // that reads the handle finds the GEObject.
+        auto& element = (*mGOSlots[slot / GOSlotChunkSize])[slot % GOSlotChunkSize];
+        element = geObject;
+        uint64_t const handle = (static_cast<uint64_t>(mEngineID) << 32) | slot;
+        if (object->ExchangeBridgeHandle(0, handle))
+        {
+            return geObject.get();
+        }
+
+        // Another engine gave the object a slot first.
+        element = nullptr;
+        mFreeGOSlots.push_back(slot);
+    }
+
+    return mGOMap.insert(std::make_pair(object, geObject)).first->second.get();
+}
+
+bool GraphicsEngine::EraseGEObjectLocked(GraphicsObject const* object)
+{
+    uint64_t const handle = object->GetBridgeHandle();
+    if (static_cast<uint32_t>(handle >> 32) == mEngineID)
+    {
+        uint32_t const slot = static_cast<uint32_t>(handle);
+        object->ExchangeBridgeHandle(handle, 0);
+        (*mGOSlots[slot / GOSlotChunkSize])[slot % GOSlotChunkSize] = nullptr;
+        mFreeGOSlots.push_back(slot);
+        return true;
+    }
+
+    return mGOMap.erase(object) > 0;
+}
+
 GraphicsEngine::GOListener::GOListener(GraphicsEngine* engine)
     :
     mEngine(engine)
@@ -13,9 +13,15 @@
 #include "GEObject.h"
 #include "DrawTarget.h"
 #include "FontArialW400H18.h"
+#include "GPUProfiler.h"
+#include "GPUReadback.h"
+#include "RenderQueue.h"
+#include "TextBatch.h"
 #include "Visual.h"
 #include <array>
+#include <atomic>
 #include <map>
+#include <memory>
 #include <mutex>
 
 // TODO: It appears that BaseEngine was separated out from GraphicsEngine
@@ -53,14 +59,25 @@ namespace gte
         // tests, effectively the number of pixels drawn.  If occlusion
         // queries are disabled, the functions return 0.
 
-        // Draw geometric primitives.
+        // Draw geometric primitives.  The visuals of an array are drawn in
+        // order, but state that consecutive visuals share is bound only
+        // once.  The queue is sorted by state before it is drawn.
         uint64_t Draw(Visual* visual);
         uint64_t Draw(std::vector<Visual*> const& visuals);
         uint64_t Draw(std::shared_ptr<Visual> const& visual);
         uint64_t Draw(std::vector<std::shared_ptr<Visual>> const& visuals);
+        uint64_t Draw(RenderQueue& queue);
 
-        // Draw 2D text.
+        // Draw 2D text. Between BeginText() and EndText(), the strings are
+        // appended to a TextBatch of the active font and are drawn with one
+        // draw call by EndText(), which returns the number of pixels drawn;
+        // the Draw calls then return 0.
         uint64_t Draw(int32_t x, int32_t y, std::array<float, 4> const& color, std::string const& message);
+        void BeginText();
+        uint64_t EndText();
+
+        // Draw the strings of a batch with one draw call.
+        uint64_t Draw(TextBatch& batch);
 
         // Draw a 2D rectangular overlay.  This is useful for adding buttons,
         // controls, thumbnails, and other GUI objects to an application
@@ -173,6 +190,21 @@ namespace gte
         // Flush the command buffer.
         virtual void Flush() = 0;
 
+        // Create a GPU timestamp profiler that keeps the queries of
+        // numFrames frames of at most maxScopes scopes each. Three or four
+        // frames are enough for the results to be read without stalling.
+        // See GPUProfiler.h for the usage.
+        virtual std::shared_ptr<GPUProfiler> CreateGPUProfiler(size_t numFrames,
+            size_t maxScopes) = 0;
+
+        // Create an asynchronous readback of the buffer with numSlots
+        // staging buffers, an alternative to CopyGpuToCpu and WaitForFinish
+        // that does not stall the CPU. Three slots are enough for a request
+        // per frame. The buffer is bound to the engine if it is not already.
+        // See GPUReadback.h for the usage.
+        virtual std::shared_ptr<GPUReadback> CreateGPUReadback(
+            std::shared_ptr<Buffer> const& buffer, size_t numSlots) = 0;
+
         // Set the warning to 'true' if you want the DX11Engine destructor to
         // report that the bridge maps are nonempty.  If they are, the
         // application did not destroy GraphicsObject items before the engine
@@ -196,6 +228,11 @@ namespace gte
             std::shared_ptr<IndexBuffer> const& ibuffer,
             std::shared_ptr<VisualEffect> const& effect) = 0;
 
+        // Draw an array of visuals, skipping the binds of the state that a
+        // visual shares with its predecessor.  The default implementation
+        // calls DrawPrimitive for each visual.
+        virtual uint64_t DrawPrimitives(std::vector<Visual*> const& visuals);
+
         // Support for GOListener::OnDestroy and DTListener::OnDestroy,
         // because they are passed raw pointers from resource destructors.
         // These are also used by the Unbind calls whose inputs are
@@ -203,16 +240,49 @@ namespace gte
         bool Unbind(GraphicsObject const* object);
         bool Unbind(DrawTarget const* target);
 
+        // Bridge access for GraphicsObject items.  FindGEObject returns
+        // null when the object is not bound.  InsertGEObject adds the
+        // GEObject unless the object is already bound, in which case the
+        // input is discarded, and returns the bound GEObject.
+        // ClearGEObjects removes all objects on engine destruction.  The
+        // Locked variants require the caller to hold mGOMapMutex.
+        GEObject* FindGEObject(GraphicsObject const* object) const;
+        GEObject* InsertGEObject(GraphicsObject const* object,
+            std::shared_ptr<GEObject> const& geObject);
+        void ClearGEObjects();
+        GEObject* FindGEObjectLocked(GraphicsObject const* object) const;
+        GEObject* InsertGEObjectLocked(GraphicsObject const* object,
+            std::shared_ptr<GEObject> const& geObject);
+        bool EraseGEObjectLocked(GraphicsObject const* object);
+
 
         // Bridge pattern to create graphics API-specific objects that
         // correspond to front-end objects.  The Bind, Get, and Unbind
-        // operations act on these maps.
+        // operations act on these containers.  A GraphicsObject bound to
+        // this engine normally owns a slot of mGOSlots, and its bridge
+        // handle stores mEngineID and the slot index, so the lookup of a
+        // bound object during drawing is an array access without a lock.
+        // The slots are in chunks that never move, so a lookup may read a
+        // slot while another thread adds one.  mGOMap holds the objects
+        // whose bridge handle belongs to another engine.  mGOMapMutex
+        // serializes the modifications of the slots and of mGOMap.
+        static uint32_t constexpr GOSlotChunkSize = 1024;
+        static uint32_t constexpr MaxGOSlotChunks = 1024;
+        using GOSlotChunk = std::array<std::shared_ptr<GEObject>, GOSlotChunkSize>;
+        uint32_t mEngineID;
+        std::array<std::unique_ptr<GOSlotChunk>, MaxGOSlotChunks> mGOSlots;
+        uint32_t mNumGOSlots;
+        std::vector<uint32_t> mFreeGOSlots;
         std::map<GraphicsObject const*, std::shared_ptr<GEObject>> mGOMap;
         mutable std::mutex mGOMapMutex;
         std::map<DrawTarget const*, std::shared_ptr<GEDrawTarget>> mDTMap;
         mutable std::mutex mDTMapMutex;
         std::unique_ptr<GEInputLayoutManager> mILMap;
 
+        // The batch of BeginText() and EndText() for the active font.
+        std::shared_ptr<TextBatch> mTextBatch;
+        bool mBatchingText;
+
         // Creation functions for adding objects to the bridges.  The
         // function pointers are assigned during construction.
         typedef std::shared_ptr<GEObject>(*CreateGEObject)(void*, GraphicsObject const*);
@@ -252,5 +322,9 @@ namespace gte
 
         bool mAllowOcclusionQuery;
         bool mWarnOnNonemptyBridges;
+
+        // The engine identifiers start at 1 and are not reused, so a bridge
+        // handle never refers to a slot of a destroyed engine.
+        static std::atomic<uint32_t> msNextEngineID;
     };
 }
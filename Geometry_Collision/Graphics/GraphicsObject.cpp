@@ -24,14 +24,16 @@ GraphicsObject::~GraphicsObject()
 GraphicsObject::GraphicsObject()
     :
     mType(GT_NONE),
-    mName("")
+    mName(""),
+    mBridgeHandle(0)
 {
 }
 
 GraphicsObject::GraphicsObject(GraphicsObjectType type)
     :
     mType(type),
-    mName("")
+    mName(""),
+    mBridgeHandle(0)
 {
 }
 
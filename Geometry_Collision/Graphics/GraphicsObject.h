@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
 #include <mutex>
 #include <set>
@@ -159,9 +161,26 @@ namespace gte
         static void SubscribeForDestruction(std::shared_ptr<ListenerForDestruction> const& listener);
         static void UnsubscribeForDestruction(std::shared_ptr<ListenerForDestruction> const& listener);
 
+        // Support for the bridge lookup of GraphicsEngine.  The handle is
+        // (engineID << 32) | slot for the engine that owns a bridge slot
+        // for this object, or 0 when no engine does.  An object bound to
+        // several engines has a slot in the first of them; the others find
+        // it in their bridge maps.
+        inline uint64_t GetBridgeHandle() const
+        {
+            return mBridgeHandle.load(std::memory_order_acquire);
+        }
+
+        inline bool ExchangeBridgeHandle(uint64_t expected, uint64_t handle) const
+        {
+            return mBridgeHandle.compare_exchange_strong(expected, handle,
+                std::memory_order_acq_rel);
+        }
+
     protected:
         GraphicsObjectType mType;
         std::string mName;
+        mutable std::atomic<uint64_t> mBridgeHandle;
 
     private:
         // Support for listeners for destruction (LFD).
@@ -0,0 +1,500 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/HiZCuller.h>
+#include <Graphics/Visual.h>
+#include <algorithm>
+using namespace gte;
+
+HiZCuller::HiZCuller(std::shared_ptr<GraphicsEngine> const& engine,
+    std::shared_ptr<ProgramFactory> const& factory,
+    uint32_t width, uint32_t height, uint32_t maxCandidates)
+    :
+    mEngine(engine),
+    mWidth(width),
+    mHeight(height),
+    mMaxCandidates(maxCandidates),
+    mHasPyramid(false)
+{
+    LogAssert(engine != nullptr && factory != nullptr, "Invalid input.");
+    LogAssert(width > 0 && height > 0 && maxCandidates > 0, "Invalid input.");
+
+    // Level i has ceil(width/2^i) by ceil(height/2^i) texels. The last
+    // level has 1 texel.
+    std::vector<uint32_t> levelOffsets;
+    uint32_t levelWidth = width, levelHeight = height, numTexels = 0;
+    for (;;)
+    {
+        levelOffsets.push_back(numTexels);
+        numTexels += levelWidth * levelHeight;
+        if (levelWidth == 1 && levelHeight == 1)
+        {
+            break;
+        }
+        levelWidth = (levelWidth + 1) / 2;
+        levelHeight = (levelHeight + 1) / 2;
+    }
+    uint32_t const numLevels = static_cast<uint32_t>(levelOffsets.size());
+    LogAssert(numLevels <= 4 * MAX_LEVEL_VECTORS, "The depth texture is too large.");
+
+    mPyramid = std::make_shared<StructuredBuffer>(numTexels, sizeof(float), false);
+    mPyramid->SetUsage(Resource::Usage::SHADER_OUTPUT);
+
+    // The copy program writes level 0 with the dimensions of the depth
+    // texture. The downsample program for level i reads level i-1.
+    levelWidth = width;
+    levelHeight = height;
+    mLevelConstants.resize(numLevels);
+    for (uint32_t i = 0; i < numLevels; ++i)
+    {
+        mLevelConstants[i] = std::make_shared<ConstantBuffer>(sizeof(LevelConstants), false);
+        auto& levelInfo = mLevelConstants[i]->Get<LevelConstants>()->levelInfo;
+        levelInfo[0] = (i > 0 ? levelOffsets[i - 1] : 0);
+        levelInfo[1] = levelWidth;
+        levelInfo[2] = levelHeight;
+        levelInfo[3] = levelOffsets[i];
+        if (i > 0)
+        {
+            levelWidth = (levelWidth + 1) / 2;
+            levelHeight = (levelHeight + 1) / 2;
+        }
+    }
+
+    mCandidates = std::make_shared<StructuredBuffer>(maxCandidates, sizeof(Vector4<float>));
+    mCandidates->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+    mVisibility = std::make_shared<StructuredBuffer>(maxCandidates, sizeof(uint32_t));
+    mVisibility->SetUsage(Resource::Usage::SHADER_OUTPUT);
+    mVisibility->SetCopy(Resource::Copy::STAGING_TO_CPU);
+
+    mTestConstants = std::make_shared<ConstantBuffer>(sizeof(TestConstants), true);
+    auto constants = mTestConstants->Get<TestConstants>();
+    *constants = TestConstants();
+    constants->pvMatrix = Matrix4x4<float>::Identity();
+    constants->pyramidInfo[0] = width;
+    constants->pyramidInfo[1] = height;
+    constants->pyramidInfo[2] = numLevels;
+    std::copy(levelOffsets.begin(), levelOffsets.end(), constants->levelOffsets);
+
+    mDepthSampler = std::make_shared<SamplerState>();
+    mDepthSampler->filter = SamplerState::Filter::MIN_P_MAG_P_MIP_P;
+    mDepthSampler->mode[0] = SamplerState::Mode::CLAMP;
+    mDepthSampler->mode[1] = SamplerState::Mode::CLAMP;
+
+    mCopyProgram = CreateProgram(factory, msCopySource, msNumLevelThreads, msNumLevelThreads);
+    mCopyProgram->GetComputeShader()->Set("pyramid", mPyramid);
+
+    mDownsampleProgram = CreateProgram(factory, msDownsampleSource, msNumLevelThreads, msNumLevelThreads);
+    mDownsampleProgram->GetComputeShader()->Set("pyramid", mPyramid);
+
+    mTestProgram = CreateProgram(factory, msTestSource, msNumTestThreads, 1);
+    auto const& cshader = mTestProgram->GetComputeShader();
+    cshader->Set("Occlusion", mTestConstants);
+    cshader->Set("pyramid", mPyramid);
+    cshader->Set("candidates", mCandidates);
+    cshader->Set("visibility", mVisibility);
+}
+
+void HiZCuller::BuildPyramid(std::shared_ptr<TextureDS> const& depthTexture,
+    std::shared_ptr<Camera> const& camera)
+{
+    LogAssert(depthTexture != nullptr && camera != nullptr, "Invalid input.");
+    LogAssert(depthTexture->IsShaderInput(), "The depth texture must be a shader input.");
+    LogAssert(depthTexture->GetWidth() == mWidth && depthTexture->GetHeight() == mHeight,
+        "The depth texture has the wrong dimensions.");
+
+    auto const& copyShader = mCopyProgram->GetComputeShader();
+    copyShader->Set("depthTexture", depthTexture, "depthSampler", mDepthSampler);
+    copyShader->Set("Level", mLevelConstants[0]);
+    mEngine->Execute(mCopyProgram,
+        (mWidth + msNumLevelThreads - 1) / msNumLevelThreads,
+        (mHeight + msNumLevelThreads - 1) / msNumLevelThreads, 1);
+
+    auto const& downsampleShader = mDownsampleProgram->GetComputeShader();
+    for (size_t i = 1; i < mLevelConstants.size(); ++i)
+    {
+        auto const& levelInfo = mLevelConstants[i]->Get<LevelConstants>()->levelInfo;
+        uint32_t const dstWidth = (levelInfo[1] + 1) / 2;
+        uint32_t const dstHeight = (levelInfo[2] + 1) / 2;
+        downsampleShader->Set("Level", mLevelConstants[i]);
+        mEngine->Execute(mDownsampleProgram,
+            (dstWidth + msNumLevelThreads - 1) / msNumLevelThreads,
+            (dstHeight + msNumLevelThreads - 1) / msNumLevelThreads, 1);
+    }
+
+    // The spheres are tested in the frame of the pyramid.
+    mTestConstants->Get<TestConstants>()->pvMatrix = camera->GetProjectionViewMatrix();
+    mHasPyramid = true;
+}
+
+void HiZCuller::Test(uint32_t numCandidates)
+{
+    LogAssert(mHasPyramid, "BuildPyramid must be called first.");
+    LogAssert(numCandidates <= mMaxCandidates, "Too many candidates.");
+    if (numCandidates == 0)
+    {
+        return;
+    }
+
+    mTestConstants->Get<TestConstants>()->pyramidInfo[3] = numCandidates;
+    mEngine->Update(mTestConstants);
+    mEngine->Execute(mTestProgram,
+        (numCandidates + msNumTestThreads - 1) / msNumTestThreads, 1, 1);
+}
+
+size_t HiZCuller::Cull(VisibleSet& visibleSet)
+{
+    if (!mHasPyramid)
+    {
+        return 0;
+    }
+
+    // Test the set in chunks of at most mMaxCandidates spheres, compacting
+    // the set in place.
+    size_t const numVisuals = visibleSet.size();
+    size_t numKept = 0;
+    for (size_t first = 0; first < numVisuals; first += mMaxCandidates)
+    {
+        uint32_t const numCandidates = static_cast<uint32_t>(
+            std::min(numVisuals - first, static_cast<size_t>(mMaxCandidates)));
+
+        auto candidates = mCandidates->Get<Vector4<float>>();
+        for (uint32_t i = 0; i < numCandidates; ++i)
+        {
+            Visual const* visual = visibleSet[first + i];
+            BoundingSphere<float> const& bound = visual->worldBound;
+            Vector3<float> const center = bound.GetCenter();
+            float const radius = (visual->culling == CullingMode::NEVER ?
+                0.0f : bound.GetRadius());
+            candidates[i] = { center[0], center[1], center[2], radius };
+        }
+        mCandidates->SetNumActiveElements(numCandidates);
+        mEngine->Update(mCandidates);
+
+        Test(numCandidates);
+        mEngine->CopyGpuToCpu(mVisibility);
+
+        auto visibility = mVisibility->Get<uint32_t>();
+        for (uint32_t i = 0; i < numCandidates; ++i)
+        {
+            if (visibility[i] != 0)
+            {
+                visibleSet[numKept++] = visibleSet[first + i];
+            }
+        }
+    }
+
+    visibleSet.resize(numKept);
+    return numVisuals - numKept;
+}
+
+std::shared_ptr<ComputeProgram> HiZCuller::CreateProgram(
+    std::shared_ptr<ProgramFactory> const& factory, ProgramSources const& sources,
+    uint32_t numXThreads, uint32_t numYThreads)
+{
+    factory->PushDefines();
+    factory->defines.Set("NUM_X_THREADS", numXThreads);
+    factory->defines.Set("NUM_Y_THREADS", numYThreads);
+    factory->defines.Set("MAX_LEVEL_VECTORS", static_cast<int32_t>(MAX_LEVEL_VECTORS));
+    auto program = factory->CreateFromSource(*sources[factory->GetAPI()]);
+    factory->PopDefines();
+    LogAssert(program != nullptr, "Failed to compile the Hi-Z programs.");
+    return program;
+}
+
+// The OpenGL depth texture has row 0 at the bottom of the viewport. The
+// copy program flips the rows so that the levels have the same layout for
+// both graphics APIs.
+std::string const HiZCuller::msGLSLCopySource =
+R"(
+    uniform Level
+    {
+        uvec4 levelInfo;
+    };
+
+    uniform sampler2D depthSampler;
+    buffer pyramid { float data[]; } pyramidSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = NUM_Y_THREADS, local_size_z = 1) in;
+    void main()
+    {
+        uvec2 t = gl_GlobalInvocationID.xy;
+        if (t.x < levelInfo.y && t.y < levelInfo.z)
+        {
+            ivec2 texel = ivec2(t.x, levelInfo.z - 1u - t.y);
+            pyramidSB.data[levelInfo.w + t.y * levelInfo.y + t.x] =
+                texelFetch(depthSampler, texel, 0).r;
+        }
+    }
+)";
+
+std::string const HiZCuller::msHLSLCopySource =
+R"(
+    cbuffer Level
+    {
+        uint4 levelInfo;
+    };
+
+    Texture2D<float> depthTexture;
+    SamplerState depthSampler;
+    RWStructuredBuffer<float> pyramid;
+
+    [numthreads(NUM_X_THREADS, NUM_Y_THREADS, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        if (t.x < levelInfo.y && t.y < levelInfo.z)
+        {
+            float2 tcoord = (float2(t.xy) + 0.5f) / float2(levelInfo.yz);
+            pyramid[levelInfo.w + t.y * levelInfo.y + t.x] =
+                depthTexture.SampleLevel(depthSampler, tcoord, 0);
+        }
+    }
+)";
+
+ProgramSources const HiZCuller::msCopySource =
+{
+    &msGLSLCopySource,
+    &msHLSLCopySource
+};
+
+// A texel of the destination level covers the 2x2 texels of the source
+// level at (2x,2y); the last row and column of a source level with odd
+// dimensions are covered by a single row or column.
+std::string const HiZCuller::msGLSLDownsampleSource =
+R"(
+    uniform Level
+    {
+        uvec4 levelInfo;
+    };
+
+    buffer pyramid { float data[]; } pyramidSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = NUM_Y_THREADS, local_size_z = 1) in;
+    void main()
+    {
+        uvec2 t = gl_GlobalInvocationID.xy;
+        uvec2 dstSize = (levelInfo.yz + 1u) / 2u;
+        if (t.x < dstSize.x && t.y < dstSize.y)
+        {
+            uvec2 s0 = 2u * t;
+            uvec2 s1 = min(s0 + 1u, levelInfo.yz - 1u);
+            uint src = levelInfo.x;
+            uint width = levelInfo.y;
+            float d00 = pyramidSB.data[src + s0.y * width + s0.x];
+            float d10 = pyramidSB.data[src + s0.y * width + s1.x];
+            float d01 = pyramidSB.data[src + s1.y * width + s0.x];
+            float d11 = pyramidSB.data[src + s1.y * width + s1.x];
+            pyramidSB.data[levelInfo.w + t.y * dstSize.x + t.x] =
+                max(max(d00, d10), max(d01, d11));
+        }
+    }
+)";
+
+std::string const HiZCuller::msHLSLDownsampleSource =
+R"(
+    cbuffer Level
+    {
+        uint4 levelInfo;
+    };
+
+    RWStructuredBuffer<float> pyramid;
+
+    [numthreads(NUM_X_THREADS, NUM_Y_THREADS, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint2 dstSize = (levelInfo.yz + 1) / 2;
+        if (t.x < dstSize.x && t.y < dstSize.y)
+        {
+            uint2 s0 = 2 * t.xy;
+            uint2 s1 = min(s0 + 1, levelInfo.yz - 1);
+            uint src = levelInfo.x;
+            uint width = levelInfo.y;
+            float d00 = pyramid[src + s0.y * width + s0.x];
+            float d10 = pyramid[src + s0.y * width + s1.x];
+            float d01 = pyramid[src + s1.y * width + s0.x];
+            float d11 = pyramid[src + s1.y * width + s1.x];
+            pyramid[levelInfo.w + t.y * dstSize.x + t.x] =
+                max(max(d00, d10), max(d01, d11));
+        }
+    }
+)";
+
+ProgramSources const HiZCuller::msDownsampleSource =
+{
+    &msGLSLDownsampleSource,
+    &msHLSLDownsampleSource
+};
+
+// The window coordinates have (0,0) at the upper-left corner of the
+// viewport and depth in [0,1]. The OpenGL normalized depth is in [-1,1].
+std::string const HiZCuller::msGLSLTestSource =
+R"(
+    uniform Occlusion
+    {
+        mat4 pvMatrix;
+        uvec4 pyramidInfo;
+        uvec4 levelOffsets[MAX_LEVEL_VECTORS];
+    };
+
+    buffer pyramid { float data[]; } pyramidSB;
+    buffer candidates { vec4 data[]; } candidatesSB;
+    buffer visibility { uint data[]; } visibilitySB;
+
+    float GetDepth(uint level, uvec2 texel)
+    {
+        uint width = (pyramidInfo.x + (1u << level) - 1u) >> level;
+        uint offset = levelOffsets[level / 4u][level % 4u];
+        return pyramidSB.data[offset + texel.y * width + texel.x];
+    }
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = NUM_Y_THREADS, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= pyramidInfo.w)
+        {
+            return;
+        }
+
+        vec4 sphere = candidatesSB.data[i];
+        uint visible = 1u;
+        if (sphere.w > 0.0f)
+        {
+            vec2 rectMin = vec2(1e30f), rectMax = vec2(-1e30f);
+            float nearest = 1.0f;
+            bool crossesNear = false;
+            for (int c = 0; c < 8; ++c)
+            {
+                vec3 dir = vec3((c & 1) != 0 ? 1.0f : -1.0f,
+                    (c & 2) != 0 ? 1.0f : -1.0f, (c & 4) != 0 ? 1.0f : -1.0f);
+                vec4 corner = vec4(sphere.xyz + sphere.w * dir, 1.0f);
+    #if GTE_USE_MAT_VEC
+                vec4 clip = pvMatrix * corner;
+    #else
+                vec4 clip = corner * pvMatrix;
+    #endif
+                if (clip.w <= 0.0f || clip.z < -clip.w)
+                {
+                    crossesNear = true;
+                    break;
+                }
+                vec3 ndc = clip.xyz / clip.w;
+                vec2 window = vec2(0.5f + 0.5f * ndc.x, 0.5f - 0.5f * ndc.y);
+                rectMin = min(rectMin, window);
+                rectMax = max(rectMax, window);
+                nearest = min(nearest, 0.5f + 0.5f * ndc.z);
+            }
+
+            vec2 size = vec2(pyramidInfo.xy);
+            if (!crossesNear && all(lessThan(rectMin, vec2(1.0f))) && all(greaterThan(rectMax, vec2(0.0f))))
+            {
+                rectMin = clamp(rectMin * size, vec2(0.0f), size - 1.0f);
+                rectMax = clamp(rectMax * size, vec2(0.0f), size - 1.0f);
+                vec2 extent = rectMax - rectMin;
+                float level = ceil(log2(max(max(extent.x, extent.y), 1.0f)));
+                uint L = min(uint(level), pyramidInfo.z - 1u);
+                uvec2 t0 = uvec2(rectMin) >> L;
+                uvec2 t1 = uvec2(rectMax) >> L;
+                float farthest = max(
+                    max(GetDepth(L, t0), GetDepth(L, uvec2(t1.x, t0.y))),
+                    max(GetDepth(L, uvec2(t0.x, t1.y)), GetDepth(L, t1)));
+                if (nearest > farthest)
+                {
+                    visible = 0u;
+                }
+            }
+        }
+        visibilitySB.data[i] = visible;
+    }
+)";
+
+std::string const HiZCuller::msHLSLTestSource =
+R"(
+    cbuffer Occlusion
+    {
+        float4x4 pvMatrix;
+        uint4 pyramidInfo;
+        uint4 levelOffsets[MAX_LEVEL_VECTORS];
+    };
+
+    StructuredBuffer<float> pyramid;
+    StructuredBuffer<float4> candidates;
+    RWStructuredBuffer<uint> visibility;
+
+    float GetDepth(uint level, uint2 texel)
+    {
+        uint width = (pyramidInfo.x + (1u << level) - 1u) >> level;
+        uint offset = levelOffsets[level / 4][level % 4];
+        return pyramid[offset + texel.y * width + texel.x];
+    }
+
+    [numthreads(NUM_X_THREADS, NUM_Y_THREADS, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i >= pyramidInfo.w)
+        {
+            return;
+        }
+
+        float4 sphere = candidates[i];
+        uint visible = 1;
+        if (sphere.w > 0.0f)
+        {
+            float2 rectMin = 1e30f, rectMax = -1e30f;
+            float nearest = 1.0f;
+            bool crossesNear = false;
+            for (int c = 0; c < 8; ++c)
+            {
+                float3 dir = float3((c & 1) != 0 ? 1.0f : -1.0f,
+                    (c & 2) != 0 ? 1.0f : -1.0f, (c & 4) != 0 ? 1.0f : -1.0f);
+                float4 corner = float4(sphere.xyz + sphere.w * dir, 1.0f);
+    #if GTE_USE_MAT_VEC
+                float4 clip = mul(pvMatrix, corner);
+    #else
+                float4 clip = mul(corner, pvMatrix);
+    #endif
+                if (clip.w <= 0.0f || clip.z < 0.0f)
+                {
+                    crossesNear = true;
+                    break;
+                }
+                float3 ndc = clip.xyz / clip.w;
+                float2 window = float2(0.5f + 0.5f * ndc.x, 0.5f - 0.5f * ndc.y);
+                rectMin = min(rectMin, window);
+                rectMax = max(rectMax, window);
+                nearest = min(nearest, ndc.z);
+            }
+
+            float2 size = float2(pyramidInfo.xy);
+            if (!crossesNear && all(rectMin < 1.0f) && all(rectMax > 0.0f))
+            {
+                rectMin = clamp(rectMin * size, 0.0f, size - 1.0f);
+                rectMax = clamp(rectMax * size, 0.0f, size - 1.0f);
+                float2 extent = rectMax - rectMin;
+                float level = ceil(log2(max(max(extent.x, extent.y), 1.0f)));
+                uint L = min(uint(level), pyramidInfo.z - 1);
+                uint2 t0 = uint2(rectMin) >> L;
+                uint2 t1 = uint2(rectMax) >> L;
+                float farthest = max(
+                    max(GetDepth(L, t0), GetDepth(L, uint2(t1.x, t0.y))),
+                    max(GetDepth(L, uint2(t0.x, t1.y)), GetDepth(L, t1)));
+                if (nearest > farthest)
+                {
+                    visible = 0;
+                }
+            }
+        }
+        visibility[i] = visible;
+    }
+)";
+
+ProgramSources const HiZCuller::msTestSource =
+{
+    &msGLSLTestSource,
+    &msHLSLTestSource
+};
@@ -0,0 +1,169 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Camera.h>
+#include <Graphics/ComputeProgram.h>
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/Culler.h>
+#include <Graphics/GraphicsEngine.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/SamplerState.h>
+#include <Graphics/StructuredBuffer.h>
+#include <Graphics/TextureDS.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Occlusion culling against a hierarchical depth buffer (Hi-Z), a stage that
+// follows the frustum culling of Culler. After a frame is drawn,
+// BuildPyramid reads its depth texture in a compute program and stores a
+// pyramid of depth levels, each texel of a level containing the maximum
+// (farthest) depth of the 2x2 texels of the previous level. The next frame,
+// Cull tests the world bounding spheres of the potentially visible set
+// against the pyramid and removes the visuals that are behind the depth
+// already drawn:
+//
+//   culler.ComputeVisibleSet(camera, scene);
+//   hiZCuller.Cull(culler.GetVisibleSet());
+//   <draw the visible set>
+//   hiZCuller.BuildPyramid(depthTexture, camera);
+//
+// A sphere is tested by projecting the 8 corners of its bounding box with
+// the projection-view matrix of the pyramid's frame and choosing the level
+// at which the screen rectangle of the corners covers at most 2x2 texels.
+// The visual is occluded when the nearest depth of the corners is larger
+// than the depths of those texels. The test is conservative for the
+// pyramid's frame. Because the pyramid is that of the previous frame, a
+// visual that was hidden and becomes visible in the current frame, either
+// by its motion or by that of the camera or of the occluders, is culled for
+// one frame; applications for which this matters can draw the culled
+// visuals after building the pyramid of the current frame and test them
+// again. Spheres that cross the near plane and visuals with
+// CullingMode::NEVER are never culled.
+//
+// The depth texture must be created with MakeShaderInput() and must have
+// the width and height passed to the constructor. The depth convention is
+// the standard one, with the far plane at depth 1 and a depth test of
+// LESS or LESS_EQUAL, and the cameras must use the depth range of the
+// graphics API.
+//
+// Cull copies the visibility results to the CPU, which waits for the GPU
+// to finish the test. Compute programs that generate draw commands can
+// instead read the visibility buffer directly after Test.
+
+namespace gte
+{
+    class HiZCuller
+    {
+    public:
+        // Construction. The 'maxCandidates' is the number of spheres tested
+        // per dispatch; larger sets are tested in several dispatches.
+        HiZCuller(std::shared_ptr<GraphicsEngine> const& engine,
+            std::shared_ptr<ProgramFactory> const& factory,
+            uint32_t width, uint32_t height, uint32_t maxCandidates = 4096);
+
+        // Build the pyramid from the depth texture of a frame that was drawn
+        // with the camera.
+        void BuildPyramid(std::shared_ptr<TextureDS> const& depthTexture,
+            std::shared_ptr<Camera> const& camera);
+
+        // Remove the occluded visuals from the set, preserving the order of
+        // the others. The function returns the number of removed visuals.
+        // When BuildPyramid has not been called, the set is not modified.
+        size_t Cull(VisibleSet& visibleSet);
+
+        // Test the first numCandidates spheres of the candidate buffer,
+        // each stored as (center, radius), and write 1 (visible) or 0
+        // (occluded) to the elements of the visibility buffer. A radius of
+        // 0 or less is never culled.
+        void Test(uint32_t numCandidates);
+
+        inline bool HasPyramid() const
+        {
+            return mHasPyramid;
+        }
+
+        inline uint32_t GetNumLevels() const
+        {
+            return static_cast<uint32_t>(mLevelConstants.size());
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetPyramid() const
+        {
+            return mPyramid;
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetCandidates() const
+        {
+            return mCandidates;
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetVisibility() const
+        {
+            return mVisibility;
+        }
+
+    private:
+        // The maximum number of levels is 4 * MAX_LEVEL_VECTORS, which
+        // supports depth textures of up to 32768 texels per dimension.
+        enum { MAX_LEVEL_VECTORS = 4 };
+
+        // The constants of the copy and downsample programs, where
+        // levelInfo is (srcOffset, srcWidth, srcHeight, dstOffset).
+        struct LevelConstants
+        {
+            uint32_t levelInfo[4];
+        };
+
+        // The constants of the test program, where pyramidInfo is
+        // (width, height, numLevels, numCandidates).
+        struct TestConstants
+        {
+            Matrix4x4<float> pvMatrix;
+            uint32_t pyramidInfo[4];
+            uint32_t levelOffsets[4 * MAX_LEVEL_VECTORS];
+        };
+
+        std::shared_ptr<ComputeProgram> CreateProgram(
+            std::shared_ptr<ProgramFactory> const& factory,
+            ProgramSources const& sources, uint32_t numXThreads,
+            uint32_t numYThreads);
+
+        std::shared_ptr<GraphicsEngine> mEngine;
+        uint32_t mWidth, mHeight, mMaxCandidates;
+        bool mHasPyramid;
+
+        // The levels of the pyramid are stored contiguously, level 0 first,
+        // each in row-major order with row 0 at the top of the viewport.
+        std::shared_ptr<StructuredBuffer> mPyramid;
+        std::vector<std::shared_ptr<ConstantBuffer>> mLevelConstants;
+        std::shared_ptr<SamplerState> mDepthSampler;
+        std::shared_ptr<ComputeProgram> mCopyProgram;
+        std::shared_ptr<ComputeProgram> mDownsampleProgram;
+
+        std::shared_ptr<StructuredBuffer> mCandidates;
+        std::shared_ptr<StructuredBuffer> mVisibility;
+        std::shared_ptr<ConstantBuffer> mTestConstants;
+        std::shared_ptr<ComputeProgram> mTestProgram;
+
+        static uint32_t constexpr msNumLevelThreads = 8;
+        static uint32_t constexpr msNumTestThreads = 64;
+
+        static std::string const msGLSLCopySource;
+        static std::string const msHLSLCopySource;
+        static ProgramSources const msCopySource;
+        static std::string const msGLSLDownsampleSource;
+        static std::string const msHLSLDownsampleSource;
+        static ProgramSources const msDownsampleSource;
+        static std::string const msGLSLTestSource;
+        static std::string const msHLSLTestSource;
+        static ProgramSources const msTestSource;
+    };
+}
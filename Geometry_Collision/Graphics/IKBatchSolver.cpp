@@ -0,0 +1,429 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/IKBatchSolver.h>
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+using namespace gte;
+
+IKBatchSolver::IKBatchSolver(size_t numThreads)
+    :
+    mNumThreads(numThreads)
+{
+}
+
+void IKBatchSolver::Insert(std::shared_ptr<IKController> const& controller)
+{
+    LogAssert(controller != nullptr, "Invalid controller.");
+    mControllers.push_back(controller);
+}
+
+bool IKBatchSolver::Remove(std::shared_ptr<IKController> const& controller)
+{
+    auto iter = std::find(mControllers.begin(), mControllers.end(), controller);
+    if (iter != mControllers.end())
+    {
+        mControllers.erase(iter);
+        return true;
+    }
+    return false;
+}
+
+void IKBatchSolver::Clear()
+{
+    mControllers.clear();
+    Compile();
+}
+
+void IKBatchSolver::Compile()
+{
+    mChains.clear();
+    mObjects.clear();
+    mParents.clear();
+    mJointGoalBegin.clear();
+    mJointGoals.clear();
+    mTargets.clear();
+    mEffectors.clear();
+    mEffectorJoints.clear();
+
+    for (auto const& controller : mControllers)
+    {
+        Chain chain{};
+        chain.controller = controller.get();
+        chain.jointBegin = mObjects.size();
+        chain.numJoints = controller->mJoints.size();
+        chain.goalBegin = mTargets.size();
+        chain.numGoals = controller->mGoals.size();
+
+        for (auto const& joint : controller->mJoints)
+        {
+            LogAssert(joint.object != nullptr, "The joint is not initialized.");
+
+            // The parent is used from the arrays when it is an earlier
+            // joint of the chain.
+            int32_t parent = -1;
+            Spatial const* parentObject = joint.object->GetParent();
+            for (size_t j = chain.jointBegin; j < mObjects.size(); ++j)
+            {
+                if (mObjects[j] == parentObject)
+                {
+                    parent = static_cast<int32_t>(j);
+                    break;
+                }
+            }
+
+            for (auto g : joint.goalIndices)
+            {
+                LogAssert(g < chain.numGoals, "Invalid goal index.");
+            }
+
+            mJointGoalBegin.push_back(mJointGoals.size());
+            mJointGoals.insert(mJointGoals.end(), joint.goalIndices.begin(),
+                joint.goalIndices.end());
+            mObjects.push_back(joint.object);
+            mParents.push_back(parent);
+        }
+
+        for (auto const& goal : controller->mGoals)
+        {
+            LogAssert(goal.target != nullptr && goal.effector != nullptr,
+                "The goal is not initialized.");
+
+            int32_t effectorJoint = -1;
+            for (size_t j = chain.jointBegin; j < mObjects.size(); ++j)
+            {
+                if (mObjects[j] == goal.effector)
+                {
+                    effectorJoint = static_cast<int32_t>(j);
+                    break;
+                }
+            }
+
+            mTargets.push_back(goal.target);
+            mEffectors.push_back(goal.effector);
+            mEffectorJoints.push_back(effectorJoint);
+        }
+
+        mChains.push_back(chain);
+    }
+    mJointGoalBegin.push_back(mJointGoals.size());
+
+    mLocal.resize(mObjects.size());
+    mWorld.resize(mObjects.size());
+    mParentWorld.resize(mObjects.size());
+    mTargetPositions.resize(mTargets.size());
+    mEffectorPositions.resize(mTargets.size());
+}
+
+void IKBatchSolver::Update(double applicationTime)
+{
+    size_t const numChains = mChains.size();
+    size_t const numTasks = std::max(std::min(mNumThreads, numChains),
+        static_cast<size_t>(1));
+
+    auto solveChains = [this, applicationTime, numChains, numTasks](size_t k)
+    {
+        size_t const cmin = k * numChains / numTasks;
+        size_t const cmax = (k + 1) * numChains / numTasks;
+        for (size_t c = cmin; c < cmax; ++c)
+        {
+            Chain const& chain = mChains[c];
+            if (chain.controller->Controller::Update(applicationTime))
+            {
+                Solve(chain);
+            }
+        }
+    };
+
+    if (numTasks > 1)
+    {
+        TaskScheduler::GetDefault().ParallelFor(numTasks, solveChains);
+    }
+    else
+    {
+        solveChains(0);
+    }
+}
+
+void IKBatchSolver::Solve(Chain const& chain)
+{
+    size_t const jmin = chain.jointBegin;
+    size_t const jmax = chain.jointBegin + chain.numJoints;
+    size_t const gmin = chain.goalBegin;
+    size_t const gmax = chain.goalBegin + chain.numGoals;
+
+    // Copy the transforms and make the world transforms current, as the
+    // first loop of IKController::Update does.
+    for (size_t j = jmin; j < jmax; ++j)
+    {
+        Spatial* object = mObjects[j];
+        mLocal[j] = object->localTransform;
+        if (mParents[j] >= 0)
+        {
+            mWorld[j] = mWorld[mParents[j]] * mLocal[j];
+        }
+        else
+        {
+            Spatial const* parent = object->GetParent();
+            if (parent)
+            {
+                mParentWorld[j] = parent->worldTransform;
+                mWorld[j] = mParentWorld[j] * mLocal[j];
+            }
+            else
+            {
+                mWorld[j] = mLocal[j];
+            }
+        }
+    }
+
+    for (size_t g = gmin; g < gmax; ++g)
+    {
+        mTargetPositions[g] = mTargets[g]->worldTransform.GetTranslation();
+        if (mEffectorJoints[g] < 0)
+        {
+            mEffectorPositions[g] = mEffectors[g]->worldTransform.GetTranslation();
+        }
+    }
+
+    // The cyclic coordinate descent of IKController::Update.
+    auto const& joints = chain.controller->mJoints;
+    size_t const numIterations = chain.controller->mNumIterations;
+    bool const orderEndToRoot = chain.controller->mOrderEndToRoot;
+    for (size_t iter = 0; iter < numIterations; ++iter)
+    {
+        for (size_t k = 0; k < chain.numJoints; ++k)
+        {
+            size_t const r = (orderEndToRoot ? chain.numJoints - 1 - k : k);
+            size_t const jr = jmin + r;
+            auto const& joint = joints[r];
+
+            for (int32_t axis = 0; axis < 3; ++axis)
+            {
+                if (joint.allowTranslation[axis])
+                {
+                    if (UpdateLocalT(chain, jr, axis))
+                    {
+                        for (size_t j = jr; j < jmax; ++j)
+                        {
+                            UpdateWorldRT(j);
+                        }
+                    }
+                }
+            }
+
+            for (int32_t axis = 0; axis < 3; ++axis)
+            {
+                if (joint.allowRotation[axis])
+                {
+                    if (UpdateLocalR(chain, jr, axis))
+                    {
+                        for (size_t j = jr; j < jmax; ++j)
+                        {
+                            UpdateWorldRT(j);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Write the results to the scene graph.
+    for (size_t j = jmin; j < jmax; ++j)
+    {
+        mObjects[j]->localTransform = mLocal[j];
+        mObjects[j]->worldTransform = mWorld[j];
+    }
+}
+
+void IKBatchSolver::UpdateWorldRT(size_t j)
+{
+    Transform<float> const& olxfrm = mLocal[j];
+    Transform<float>& owxfrm = mWorld[j];
+
+    if (mParents[j] >= 0 || mObjects[j]->GetParent())
+    {
+        Transform<float> const& pwxfrm =
+            (mParents[j] >= 0 ? mWorld[mParents[j]] : mParentWorld[j]);
+        owxfrm.SetRotation(pwxfrm.GetRotation() * olxfrm.GetRotation());
+        owxfrm.SetTranslation(pwxfrm * olxfrm.GetTranslationW1());
+    }
+    else
+    {
+        owxfrm.SetRotation(olxfrm.GetRotation());
+        owxfrm.SetTranslation(olxfrm.GetTranslation());
+    }
+}
+
+Vector3<float> IKBatchSolver::GetAxis(size_t j, int32_t axis) const
+{
+    if (mParents[j] >= 0)
+    {
+        return HProject(mWorld[mParents[j]].GetRotation().GetCol(axis));
+    }
+    else if (mObjects[j]->GetParent())
+    {
+        return HProject(mParentWorld[j].GetRotation().GetCol(axis));
+    }
+    else
+    {
+        return Vector3<float>::Unit(axis);
+    }
+}
+
+bool IKBatchSolver::UpdateLocalT(Chain const& chain, size_t j, int32_t axis)
+{
+    auto const& joint = chain.controller->mJoints[j - chain.jointBegin];
+    auto const& goals = chain.controller->mGoals;
+    size_t const gBegin = mJointGoalBegin[j], gEnd = mJointGoalBegin[j + 1];
+
+    Vector3<float> U = GetAxis(j, axis);
+    float numer = 0.0f;
+    float denom = 0.0f;
+    float oldNorm = 0.0f;
+    for (size_t i = gBegin; i < gEnd; ++i)
+    {
+        size_t g = chain.goalBegin + mJointGoals[i];
+        Vector3<float> GmE = mTargetPositions[g] - GetEffectorPosition(g);
+        oldNorm += Dot(GmE, GmE);
+        numer += goals[mJointGoals[i]].weight * Dot(U, GmE);
+        denom += goals[mJointGoals[i]].weight;
+    }
+
+    if (denom == 0.0f)
+    {
+        return false;
+    }
+
+    // Desired distance to translate along axis(i).
+    float t = numer / denom;
+
+    // Clamp to range.
+    Vector3<float> trn = mLocal[j].GetTranslation();
+    float desired = trn[axis] + t;
+    if (desired > joint.minTranslation[axis])
+    {
+        if (desired < joint.maxTranslation[axis])
+        {
+            trn[axis] = desired;
+        }
+        else
+        {
+            t = joint.maxTranslation[axis] - trn[axis];
+            trn[axis] = joint.maxTranslation[axis];
+        }
+    }
+    else
+    {
+        t = joint.minTranslation[axis] - trn[axis];
+        trn[axis] = joint.minTranslation[axis];
+    }
+
+    // Test whether step should be taken.
+    float newNorm = 0.0f;
+    Vector3<float> step = t * U;
+    for (size_t i = gBegin; i < gEnd; ++i)
+    {
+        size_t g = chain.goalBegin + mJointGoals[i];
+        Vector3<float> newE = GetEffectorPosition(g) + step;
+        Vector3<float> diff = mTargetPositions[g] - newE;
+        newNorm += Dot(diff, diff);
+    }
+    if (newNorm >= oldNorm)
+    {
+        // Translation does not get effector closer to goal.
+        return false;
+    }
+
+    // Update the local translation.
+    mLocal[j].SetTranslation(trn);
+    return true;
+}
+
+bool IKBatchSolver::UpdateLocalR(Chain const& chain, size_t j, int32_t axis)
+{
+    auto const& joint = chain.controller->mJoints[j - chain.jointBegin];
+    auto const& goals = chain.controller->mGoals;
+    size_t const gBegin = mJointGoalBegin[j], gEnd = mJointGoalBegin[j + 1];
+    Vector3<float> P = mWorld[j].GetTranslation();
+
+    Vector3<float> U = GetAxis(j, axis);
+    float numer = 0.0f;
+    float denom = 0.0f;
+
+    float oldNorm = 0.0f;
+    for (size_t i = gBegin; i < gEnd; ++i)
+    {
+        size_t g = chain.goalBegin + mJointGoals[i];
+        float weight = goals[mJointGoals[i]].weight;
+        Vector3<float> EmP = GetEffectorPosition(g) - P;
+        Vector3<float> GmP = mTargetPositions[g] - P;
+        Vector3<float> GmE = mTargetPositions[g] - GetEffectorPosition(g);
+        oldNorm += Dot(GmE, GmE);
+        Vector3<float> UxEmP = Cross(U, EmP);
+        Vector3<float> UxUxEmP = Cross(U, UxEmP);
+        numer += weight * Dot(GmP, UxEmP);
+        denom -= weight * Dot(GmP, UxUxEmP);
+    }
+
+    if (numer * numer + denom * denom == 0.0f)
+    {
+        return false;
+    }
+
+    // Desired angle to rotate about axis(i).
+    float theta = std::atan2(numer, denom);
+
+    // Factor local rotation into Euler angles.
+    EulerAngles<float> euler =
+        Rotation<4, float>(mLocal[j].GetRotation())(0, 1, 2);
+
+    // Clamp to range.
+    float desired = euler.angle[axis] + theta;
+    if (desired > joint.minRotation[axis])
+    {
+        if (desired < joint.maxRotation[axis])
+        {
+            euler.angle[axis] = desired;
+        }
+        else
+        {
+            theta = joint.maxRotation[axis] - euler.angle[axis];
+            euler.angle[axis] = joint.maxRotation[axis];
+        }
+    }
+    else
+    {
+        theta = joint.minRotation[axis] - euler.angle[axis];
+        euler.angle[axis] = joint.minRotation[axis];
+    }
+
+    // Test whether step should be taken.
+    float newNorm = 0.0f;
+    Matrix3x3<float> rotate = Rotation<3, float>(AxisAngle<3, float>(U, theta));
+    for (size_t i = gBegin; i < gEnd; ++i)
+    {
+        size_t g = chain.goalBegin + mJointGoals[i];
+        Vector3<float> EmP = GetEffectorPosition(g) - P;
+        Vector3<float> newE = P + rotate * EmP;
+        Vector3<float> GmE = mTargetPositions[g] - newE;
+        newNorm += Dot(GmE, GmE);
+    }
+
+    if (newNorm >= oldNorm)
+    {
+        // Rotation does not get effector closer to goal.
+        return false;
+    }
+
+    // Update the local rotation.
+    rotate = Rotation<3, float>(euler);
+    mLocal[j].SetRotation(rotate);
+    return true;
+}
@@ -0,0 +1,112 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/IKController.h>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Solve the chains of many IKController objects, for example those of the
+// characters of a crowd. IKController::Update recomputes the world
+// transforms of the joint objects in the scene graph after every joint step,
+// reading and writing Spatial objects scattered in memory. The batch solver
+// copies the joint transforms of all chains into contiguous arrays, runs the
+// cyclic coordinate descent of IKController::Update on the copies and writes
+// the local and world transforms of the joints back once per update. The
+// results are the same as those of IKController::Update.
+//
+// The joints of a controller are the objects of its Joint array in chain
+// order. A joint whose parent is an earlier joint of the same controller
+// uses the copy of the parent transform; the other parents, and the targets
+// and effectors that are not joints of the controller, are read once at the
+// beginning of the update. The chains must not share objects, and no object
+// of a chain may be an ancestor of another chain, so with numThreads > 0 the
+// chains are solved concurrently by tasks of TaskScheduler::GetDefault().
+// With numThreads = 0 the chains are solved in the main thread.
+//
+// The controllers should not also be attached to their objects, because
+// the scene graph update would then solve the chains a second time. Call
+// Compile after inserting or removing controllers and after the deferred
+// construction of their joints and goals; the joint limits and goal weights
+// are read at each update.
+
+namespace gte
+{
+    class IKBatchSolver
+    {
+    public:
+        IKBatchSolver(size_t numThreads = 0);
+        ~IKBatchSolver() = default;
+
+        void Insert(std::shared_ptr<IKController> const& controller);
+        bool Remove(std::shared_ptr<IKController> const& controller);
+        void Clear();
+
+        inline size_t GetNumControllers() const
+        {
+            return mControllers.size();
+        }
+
+        // Build the arrays of the joints and goals of the controllers.
+        void Compile();
+
+        // The equivalent of calling Update(applicationTime) for each
+        // controller. The inactive controllers are skipped.
+        void Update(double applicationTime);
+
+    private:
+        struct Chain
+        {
+            IKController* controller;
+            size_t jointBegin, numJoints;
+            size_t goalBegin, numGoals;
+        };
+
+        void Solve(Chain const& chain);
+
+        // Copies of Joint::UpdateWorldRT, Joint::GetAxis,
+        // Joint::UpdateLocalT and Joint::UpdateLocalR on the arrays. The
+        // indices j are those of the arrays.
+        void UpdateWorldRT(size_t j);
+        Vector3<float> GetAxis(size_t j, int32_t axis) const;
+        bool UpdateLocalT(Chain const& chain, size_t j, int32_t axis);
+        bool UpdateLocalR(Chain const& chain, size_t j, int32_t axis);
+
+        inline Vector3<float> GetEffectorPosition(size_t g) const
+        {
+            int32_t j = mEffectorJoints[g];
+            return (j >= 0 ? mWorld[j].GetTranslation() : mEffectorPositions[g]);
+        }
+
+        size_t mNumThreads;
+        std::vector<std::shared_ptr<IKController>> mControllers;
+        std::vector<Chain> mChains;
+
+        // The joints of all chains. The parent is an index into the arrays
+        // or -1 when the parent is not a joint of the chain, in which case
+        // its world transform is copied into mParentWorld.
+        std::vector<Spatial*> mObjects;
+        std::vector<int32_t> mParents;
+        std::vector<Transform<float>> mLocal, mWorld, mParentWorld;
+
+        // The goal indices of joint j are those of the chain in
+        // mJointGoals[mJointGoalBegin[j]] through
+        // mJointGoals[mJointGoalBegin[j + 1] - 1], offset by the first goal
+        // of the chain.
+        std::vector<size_t> mJointGoalBegin, mJointGoals;
+
+        // The goals of all chains. The effector joint is an index into the
+        // joint arrays or -1 when the effector is not a joint of the chain,
+        // in which case its position is copied into mEffectorPositions.
+        std::vector<Spatial*> mTargets, mEffectors;
+        std::vector<int32_t> mEffectorJoints;
+        std::vector<Vector3<float>> mTargetPositions, mEffectorPositions;
+    };
+}
@@ -45,6 +45,9 @@ namespace gte
         virtual bool Update(double applicationTime) override;
 
     protected:
+        // IKBatchSolver solves the chains of many controllers.
+        friend class IKBatchSolver;
+
         struct Goal
         {
             Goal();
@@ -16,7 +16,8 @@ IndexBuffer::IndexBuffer(IPType type, uint32_t numPrimitives, size_t indexSize,
     mPrimitiveType(type),
     mNumPrimitives(numPrimitives),
     mNumActivePrimitives(numPrimitives),
-    mFirstPrimitive(0)
+    mFirstPrimitive(0),
+    mNumInstances(1)
 {
     LogAssert(mNumPrimitives > 0, "Invalid number of primitives.");
     mType = GT_INDEX_BUFFER;
@@ -28,7 +29,8 @@ IndexBuffer::IndexBuffer(IPType type, uint32_t numPrimitives)
     mPrimitiveType(type),
     mNumPrimitives(numPrimitives),
     mNumActivePrimitives(numPrimitives),
-    mFirstPrimitive(0)
+    mFirstPrimitive(0),
+    mNumInstances(1)
 {
     LogAssert(mNumPrimitives > 0, "Invalid number of primitives.");
     mType = GT_INDEX_BUFFER;
@@ -40,6 +42,12 @@ void IndexBuffer::SetNumActivePrimitives(uint32_t numActive)
     mNumActivePrimitives = numActive;
 }
 
+void IndexBuffer::SetNumInstances(uint32_t numInstances)
+{
+    LogAssert(numInstances > 0, "Invalid number of instances.");
+    mNumInstances = numInstances;
+}
+
 uint32_t IndexBuffer::GetNumActiveIndices() const
 {
     uint32_t i = BitHacks::Log2OfPowerOfTwo(mPrimitiveType);
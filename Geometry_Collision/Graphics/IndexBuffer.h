@@ -77,6 +77,19 @@ namespace gte
 
         uint32_t GetFirstIndex() const;
 
+        // Specify how many instances of the active primitives are to be
+        // drawn.  The default value is 1.  For a larger value the graphics
+        // engine issues one instanced draw call, and the shaders distinguish
+        // the instances by SV_InstanceID (HLSL) or gl_InstanceID (GLSL),
+        // typically to index a structured buffer of per-instance data.  See
+        // InstancedTexture2Effect for an example.
+        void SetNumInstances(uint32_t numInstances);
+
+        inline uint32_t GetNumInstances() const
+        {
+            return mNumInstances;
+        }
+
         // Support for set/get of primitive indices.  The functions return
         // 'true' when the index i is within range for the primitive.  The
         // caller is responsible for using the correct functions for the
@@ -121,6 +134,7 @@ namespace gte
         uint32_t mNumPrimitives;
         uint32_t mNumActivePrimitives;
         uint32_t mFirstPrimitive;
+        uint32_t mNumInstances;
 
         typedef uint32_t(*ICFunction)(uint32_t);
         static ICFunction msIndexCounter[IP_NUM_TYPES];
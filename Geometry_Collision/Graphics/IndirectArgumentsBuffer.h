@@ -10,8 +10,8 @@
 #include <Graphics/Buffer.h>
 #include <cstdint>
 
-// IndirectArgumentsBuffer is currently supported only in the DirectX graphics
-// engine.
+// IndirectArgumentsBuffer is supported by the DirectX graphics engine and,
+// for indexed draws, by GL45Engine::DrawIndirect.
 
 namespace gte
 {
@@ -36,6 +36,9 @@ namespace gte
         //   INT  BaseVertexLocation;
         //   UINT StartInstanceLocation;
         //
+        // The OpenGL DrawElementsIndirectCommand of glMultiDrawElementsIndirect
+        // has the same layout as DrawIndexedInstancedIndirect.
+        //
         // DispatchIndirect:
         //   UINT ThreadsGroupCountX;
         //   UINT ThreadsGroupCountY;
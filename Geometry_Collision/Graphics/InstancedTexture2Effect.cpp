@@ -0,0 +1,186 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/InstancedTexture2Effect.h>
+using namespace gte;
+
+InstancedTexture2Effect::InstancedTexture2Effect(std::shared_ptr<ProgramFactory> const& factory,
+    std::shared_ptr<Texture2> const& texture,
+    SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1,
+    uint32_t maxNumInstances)
+    :
+    mTexture(texture)
+{
+    LogAssert(maxNumInstances > 0, "Invalid number of instances.");
+
+    mInstanceBuffer = std::make_shared<StructuredBuffer>(maxNumInstances,
+        sizeof(Matrix4x4<float>));
+    mInstanceBuffer->SetUsage(Resource::Usage::STREAMING);
+    auto world = mInstanceBuffer->Get<Matrix4x4<float>>();
+    for (uint32_t i = 0; i < maxNumInstances; ++i)
+    {
+        world[i] = Matrix4x4<float>::Identity();
+    }
+
+    CreateProgram(factory, filter, mode0, mode1);
+}
+
+InstancedTexture2Effect::InstancedTexture2Effect(std::shared_ptr<ProgramFactory> const& factory,
+    std::shared_ptr<Texture2> const& texture,
+    SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1,
+    std::shared_ptr<StructuredBuffer> const& instanceBuffer)
+    :
+    mInstanceBuffer(instanceBuffer),
+    mTexture(texture)
+{
+    LogAssert(instanceBuffer != nullptr &&
+        instanceBuffer->GetElementSize() == sizeof(Matrix4x4<float>),
+        "Invalid instance buffer.");
+
+    CreateProgram(factory, filter, mode0, mode1);
+}
+
+void InstancedTexture2Effect::SetPVWMatrixConstant(std::shared_ptr<ConstantBuffer> const& buffer)
+{
+    VisualEffect::SetPVWMatrixConstant(buffer);
+    mProgram->GetVertexShader()->Set("PVWMatrix", mPVWMatrixConstant);
+}
+
+void InstancedTexture2Effect::CreateProgram(std::shared_ptr<ProgramFactory> const& factory,
+    SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1)
+{
+    int32_t api = factory->GetAPI();
+    mProgram = factory->CreateFromSources(*msVSSource[api], *msPSSource[api], "");
+    if (mProgram)
+    {
+        mSampler = std::make_shared<SamplerState>();
+        mSampler->filter = filter;
+        mSampler->mode[0] = mode0;
+        mSampler->mode[1] = mode1;
+
+        mProgram->GetVertexShader()->Set("PVWMatrix", mPVWMatrixConstant);
+        mProgram->GetVertexShader()->Set("instanceWorld", mInstanceBuffer);
+        mProgram->GetPixelShader()->Set("baseTexture", mTexture, "baseSampler", mSampler);
+    }
+    else
+    {
+        LogError("Failed to compile shader programs.");
+    }
+}
+
+std::string const InstancedTexture2Effect::msGLSLVSSource =
+R"(
+    uniform PVWMatrix
+    {
+        mat4 pvwMatrix;
+    };
+
+    buffer instanceWorld
+    {
+        mat4 data[];
+    } instanceWorldSB;
+
+    layout(location = 0) in vec3 modelPosition;
+    layout(location = 1) in vec2 modelTCoord;
+    layout(location = 0) out vec2 vertexTCoord;
+
+    void main()
+    {
+        mat4 worldMatrix = instanceWorldSB.data[gl_InstanceID];
+        vertexTCoord = modelTCoord;
+    #if GTE_USE_MAT_VEC
+        gl_Position = pvwMatrix * (worldMatrix * vec4(modelPosition, 1.0f));
+    #else
+        gl_Position = (vec4(modelPosition, 1.0f) * worldMatrix) * pvwMatrix;
+    #endif
+    }
+)";
+
+std::string const InstancedTexture2Effect::msGLSLPSSource =
+R"(
+    uniform sampler2D baseSampler;
+
+    layout(location = 0) in vec2 vertexTCoord;
+    layout(location = 0) out vec4 pixelColor;
+
+    void main()
+    {
+        pixelColor = texture(baseSampler, vertexTCoord);
+    }
+)";
+
+std::string const InstancedTexture2Effect::msHLSLVSSource =
+R"(
+    cbuffer PVWMatrix
+    {
+        float4x4 pvwMatrix;
+    };
+
+    StructuredBuffer<float4x4> instanceWorld;
+
+    struct VS_INPUT
+    {
+        float3 modelPosition : POSITION;
+        float2 modelTCoord : TEXCOORD0;
+        uint instance : SV_InstanceID;
+    };
+
+    struct VS_OUTPUT
+    {
+        float2 vertexTCoord : TEXCOORD0;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    VS_OUTPUT VSMain(VS_INPUT input)
+    {
+        VS_OUTPUT output;
+        float4x4 worldMatrix = instanceWorld[input.instance];
+    #if GTE_USE_MAT_VEC
+        output.clipPosition = mul(pvwMatrix, mul(worldMatrix, float4(input.modelPosition, 1.0f)));
+    #else
+        output.clipPosition = mul(mul(float4(input.modelPosition, 1.0f), worldMatrix), pvwMatrix);
+    #endif
+        output.vertexTCoord = input.modelTCoord;
+        return output;
+    }
+)";
+
+std::string const InstancedTexture2Effect::msHLSLPSSource =
+R"(
+    Texture2D baseTexture;
+    SamplerState baseSampler;
+
+    struct PS_INPUT
+    {
+        float2 vertexTCoord : TEXCOORD0;
+    };
+
+    struct PS_OUTPUT
+    {
+        float4 pixelColor : SV_TARGET0;
+    };
+
+    PS_OUTPUT PSMain(PS_INPUT input)
+    {
+        PS_OUTPUT output;
+        output.pixelColor = baseTexture.Sample(baseSampler, input.vertexTCoord);
+        return output;
+    }
+)";
+
+ProgramSources const InstancedTexture2Effect::msVSSource =
+{
+    &msGLSLVSSource,
+    &msHLSLVSSource
+};
+
+ProgramSources const InstancedTexture2Effect::msPSSource =
+{
+    &msGLSLPSSource,
+    &msHLSLPSSource
+};
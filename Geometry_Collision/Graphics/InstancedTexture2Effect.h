@@ -0,0 +1,92 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/VisualEffect.h>
+#include <Graphics/StructuredBuffer.h>
+#include <Graphics/Texture2.h>
+#include <Mathematics/Matrix4x4.h>
+
+// The effect of Texture2Effect for drawing many copies of one mesh with a
+// single draw call. The instance buffer is a structured buffer with one
+// world matrix per instance, read by the vertex shader at the instance
+// index. The clip position of a vertex is
+//   pvwMatrix * instanceWorld[instance] * modelPosition
+// (or the transposed products when GTE_USE_VEC_MAT), so the PVW matrix of
+// the Visual is the transform from the space of the instance matrices to
+// clip space. Typically the Visual has the identity local transform and the
+// instance matrices are relative to the parent node.
+//
+//   auto effect = std::make_shared<InstancedTexture2Effect>(..., maxNumInstances);
+//   auto visual = std::make_shared<Visual>(vbuffer, ibuffer, effect);
+//   auto world = effect->GetInstanceBuffer()->Get<Matrix4x4<float>>();
+//   <set world[i] for 0 <= i < numInstances>
+//   engine->Update(effect->GetInstanceBuffer());
+//   ibuffer->SetNumInstances(numInstances);
+//   engine->Draw(visual);
+
+namespace gte
+{
+    class InstancedTexture2Effect : public VisualEffect
+    {
+    public:
+        // Construction. The instance buffer has STREAMING usage, because it
+        // is typically updated every frame, and storage for maxNumInstances
+        // matrices.
+        InstancedTexture2Effect(std::shared_ptr<ProgramFactory> const& factory,
+            std::shared_ptr<Texture2> const& texture,
+            SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1,
+            uint32_t maxNumInstances);
+
+        // Construction with an instance buffer that is created and written
+        // elsewhere, typically a SHADER_OUTPUT buffer whose matrices are
+        // computed on the GPU. Its elements must be Matrix4x4<float>, and
+        // its number of elements is the maximum number of instances.
+        InstancedTexture2Effect(std::shared_ptr<ProgramFactory> const& factory,
+            std::shared_ptr<Texture2> const& texture,
+            SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1,
+            std::shared_ptr<StructuredBuffer> const& instanceBuffer);
+
+        // Member access.
+        virtual void SetPVWMatrixConstant(std::shared_ptr<ConstantBuffer> const& buffer) override;
+
+        inline std::shared_ptr<StructuredBuffer> const& GetInstanceBuffer() const
+        {
+            return mInstanceBuffer;
+        }
+
+        inline std::shared_ptr<Texture2> const& GetTexture() const
+        {
+            return mTexture;
+        }
+
+        inline std::shared_ptr<SamplerState> const& GetSampler() const
+        {
+            return mSampler;
+        }
+
+    private:
+        void CreateProgram(std::shared_ptr<ProgramFactory> const& factory,
+            SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1);
+
+        // Vertex shader parameters.
+        std::shared_ptr<StructuredBuffer> mInstanceBuffer;
+
+        // Pixel shader parameters.
+        std::shared_ptr<Texture2> mTexture;
+        std::shared_ptr<SamplerState> mSampler;
+
+        // Shader source code as strings.
+        static std::string const msGLSLVSSource;
+        static std::string const msGLSLPSSource;
+        static std::string const msHLSLVSSource;
+        static std::string const msHLSLPSSource;
+        static ProgramSources const msVSSource;
+        static ProgramSources const msPSSource;
+    };
+}
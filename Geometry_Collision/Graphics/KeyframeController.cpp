@@ -82,6 +82,11 @@ bool KeyframeController::Update(double applicationTime)
         return false;
     }
 
+    if (mBatched)
+    {
+        return true;
+    }
+
     float ctrlTime = static_cast<float>(GetControlTime(applicationTime));
     float normTime = 0.0f;
     int32_t i0 = 0, i1 = 0;
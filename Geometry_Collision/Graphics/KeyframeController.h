@@ -94,6 +94,8 @@ namespace gte
         virtual bool Update(double applicationTime) override;
 
     protected:
+        friend class AnimationBatch;
+
         // Support for looking up keyframes given the specified time.
         static void GetKeyInfo(float ctrlTime, int32_t numTimes, float* times,
             int32_t& lastIndex, float& normTime, int32_t& i0, int32_t& i1);
@@ -7,15 +7,18 @@
 
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/MeshFactory.h>
+#include <Graphics/VertexCompression.h>
 using namespace gte;
 
 MeshFactory::MeshFactory()
     :
     mVFormat{},
+    mStagingFormat{},
     mIndexSize(sizeof(uint32_t)),
     mVBUsage(Resource::Usage::IMMUTABLE),
     mIBUsage(Resource::Usage::IMMUTABLE),
     mOutside(true),
+    mDeferPacking(false),
     mAssignTCoords{},
     mPositions(nullptr),
     mNormals(nullptr),
@@ -24,6 +27,7 @@ MeshFactory::MeshFactory()
     mTCoords{}
 {
     mVFormat.Bind(VASemantic::POSITION, DF_R32G32B32_FLOAT, 0);
+    mStagingFormat = mVFormat;
     for (int32_t i = 0; i < VAConstant::MAX_TCOORD_UNITS; ++i)
     {
         mAssignTCoords[i] = false;
@@ -34,10 +38,12 @@ MeshFactory::MeshFactory()
 MeshFactory::MeshFactory(VertexFormat const& vbFormat)
     :
     mVFormat(vbFormat),
+    mStagingFormat(VertexCompression::GetStagingFormat(vbFormat)),
     mIndexSize(sizeof(uint32_t)),
     mVBUsage(Resource::Usage::IMMUTABLE),
     mIBUsage(Resource::Usage::IMMUTABLE),
     mOutside(true),
+    mDeferPacking(false),
     mAssignTCoords{},
     mPositions(nullptr),
     mNormals(nullptr),
@@ -55,10 +61,12 @@ MeshFactory::MeshFactory(VertexFormat const& vbFormat)
 MeshFactory::MeshFactory(VertexFormat const& vbFormat, Resource::Usage vbUsage)
     :
     mVFormat(vbFormat),
+    mStagingFormat(VertexCompression::GetStagingFormat(vbFormat)),
     mIndexSize(sizeof(uint32_t)),
     mVBUsage(vbUsage),
     mIBUsage(Resource::Usage::IMMUTABLE),
     mOutside(true),
+    mDeferPacking(false),
     mAssignTCoords{},
     mPositions(nullptr),
     mNormals(nullptr),
@@ -138,7 +146,7 @@ std::shared_ptr<Visual> MeshFactory::CreateRectangle(uint32_t numXSamples,
     {
         visual->UpdateModelBound();
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateTriangle(uint32_t numSamples,
@@ -210,7 +218,7 @@ std::shared_ptr<Visual> MeshFactory::CreateTriangle(uint32_t numSamples,
     {
         visual->UpdateModelBound();
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateDisk(uint32_t numShellSamples,
@@ -298,7 +306,7 @@ std::shared_ptr<Visual> MeshFactory::CreateDisk(uint32_t numShellSamples,
     {
         visual->UpdateModelBound();
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateBox(float xExtent, float yExtent, float zExtent)
@@ -388,7 +396,7 @@ std::shared_ptr<Visual> MeshFactory::CreateBox(float xExtent, float yExtent, flo
     {
         visual->UpdateModelBound();
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateCylinderOpen(uint32_t numAxisSamples,
@@ -495,14 +503,18 @@ std::shared_ptr<Visual> MeshFactory::CreateCylinderOpen(uint32_t numAxisSamples,
         visual->modelBound.SetRadius(maxDist);
     }
 
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateCylinderClosed(uint32_t numAxisSamples,
     uint32_t numRadialSamples, float radius, float height)
 {
-    // Create a sphere and then deform it into a closed cylinder.
+    // Create a sphere and then deform it into a closed cylinder.  The
+    // sphere vertices stay in the staging format until the deformation is
+    // complete.
+    mDeferPacking = true;
     auto visual = CreateSphere(numAxisSamples, numRadialSamples, radius);
+    mDeferPacking = false;
     if (!visual)
     {
         return nullptr;
@@ -558,7 +570,7 @@ std::shared_ptr<Visual> MeshFactory::CreateCylinderClosed(uint32_t numAxisSample
     float maxDist = std::sqrt(radius * radius + height * height);
     visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
     visual->modelBound.SetRadius(maxDist);
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateSphere(uint32_t numZSamples,
@@ -726,7 +738,7 @@ std::shared_ptr<Visual> MeshFactory::CreateSphere(uint32_t numZSamples,
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(radius);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateTorus(
@@ -851,7 +863,7 @@ std::shared_ptr<Visual> MeshFactory::CreateTorus(
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(outerRadius);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateTetrahedron()
@@ -912,7 +924,7 @@ std::shared_ptr<Visual> MeshFactory::CreateTetrahedron()
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(1.0f);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateHexahedron()
@@ -983,7 +995,7 @@ std::shared_ptr<Visual> MeshFactory::CreateHexahedron()
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(1.0f);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateOctahedron()
@@ -1047,7 +1059,7 @@ std::shared_ptr<Visual> MeshFactory::CreateOctahedron()
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(1.0f);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateDodecahedron()
@@ -1156,7 +1168,7 @@ std::shared_ptr<Visual> MeshFactory::CreateDodecahedron()
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(1.0f);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<Visual> MeshFactory::CreateIcosahedron()
@@ -1242,12 +1254,12 @@ std::shared_ptr<Visual> MeshFactory::CreateIcosahedron()
         visual->modelBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         visual->modelBound.SetRadius(1.0f);
     }
-    return visual;
+    return PackVertices(visual);
 }
 
 std::shared_ptr<VertexBuffer> MeshFactory::CreateVBuffer(uint32_t numVertices)
 {
-    auto vbuffer = std::make_shared<VertexBuffer>(mVFormat, numVertices);
+    auto vbuffer = std::make_shared<VertexBuffer>(mStagingFormat, numVertices);
     if (vbuffer)
     {
         // Get the position channel.
@@ -1296,19 +1308,19 @@ char* MeshFactory::GetGeometricChannel(std::shared_ptr<VertexBuffer> const& vbuf
     VASemantic semantic, float w)
 {
     char* channel = nullptr;
-    int32_t index = mVFormat.GetIndex(semantic, 0);
+    int32_t index = mStagingFormat.GetIndex(semantic, 0);
     if (index >= 0)
     {
         channel = vbuffer->GetChannel(semantic, 0, std::set<uint32_t>());
         LogAssert(channel != nullptr, "Unexpected condition.");
-        if (mVFormat.GetType(index) == DF_R32G32B32A32_FLOAT)
+        if (mStagingFormat.GetType(index) == DF_R32G32B32A32_FLOAT)
         {
             // Fill in the w-components.
             int32_t const numVertices = vbuffer->GetNumElements();
             for (int32_t i = 0; i < numVertices; ++i)
             {
                 auto tuple4 = reinterpret_cast<float*>(channel +
-                    static_cast<size_t>(i) * mVFormat.GetVertexSize());
+                    static_cast<size_t>(i) * mStagingFormat.GetVertexSize());
                 tuple4[3] = w;
             }
         }
@@ -1316,6 +1328,16 @@ char* MeshFactory::GetGeometricChannel(std::shared_ptr<VertexBuffer> const& vbuf
     return channel;
 }
 
+std::shared_ptr<Visual> MeshFactory::PackVertices(std::shared_ptr<Visual> const& visual)
+{
+    // Every compressed attribute is smaller than its staging attribute.
+    if (visual && !mDeferPacking && mStagingFormat.GetVertexSize() != mVFormat.GetVertexSize())
+    {
+        visual->SetVertexBuffer(VertexCompression::Pack(*visual->GetVertexBuffer(), mVFormat));
+    }
+    return visual;
+}
+
 void MeshFactory::SetPlatonicTCoord(uint32_t i, Vector3<float> const& pos)
 {
     Vector2<float> tcd{};
@@ -4,6 +4,7 @@
 
 #include "Visual.h"
 #include "Mesh.h"
+#include "VertexCompression.h"
 #include <cstdint>
 
 // This class is a factory for Visual objects corresponding to common
@@ -17,6 +18,13 @@
 // positions, w = 0 for the others).  The factory also generates 2-tuple
 // texture coordinates.  These are stored in the vertex buffer for 2-tuple
 // units.  All other attribute types are unassigned by the factory.
+//
+// The vertex format may also use the compact encodings of
+// VertexCompression: half-float positions, normals, tangents, binormals and
+// texture coordinates, octahedral SNORM normals, tangents and binormals, and
+// UNORM8 colors.  The mesh is then generated in the staging format of
+// VertexCompression, its bound and normals are computed from the float
+// data, and the vertex buffer of the returned Visual is the packed one.
 
 namespace Vector_GM
 {
@@ -36,6 +44,7 @@ namespace Vector_GM
         inline void SetVertexFormat(VertexFormat const& format)
         {
             mVFormat = format;
+            mStagingFormat = VertexCompression::GetStagingFormat(format);
         }
 
         // Specify the usage for the vertex buffer data.  The default is
@@ -158,29 +167,33 @@ namespace Vector_GM
         char* GetGeometricChannel(std::shared_ptr<VertexBuffer> const& vbuffer,
             VASemantic semantic, float w);
 
+        // Replace the staging vertex buffer of the visual by the vertex
+        // buffer of format mVFormat when the formats differ.
+        std::shared_ptr<Visual> PackVertices(std::shared_ptr<Visual> const& visual);
+
         inline Vector3<float>& Position(uint32_t i)
         {
-            return *reinterpret_cast<Vector3<float>*>(mPositions + static_cast<size_t>(i) * mVFormat.GetVertexSize());
+            return *reinterpret_cast<Vector3<float>*>(mPositions + static_cast<size_t>(i) * mStagingFormat.GetVertexSize());
         }
 
         inline Vector3<float>& Normal(uint32_t i)
         {
-            return *reinterpret_cast<Vector3<float>*>(mNormals + static_cast<size_t>(i) * mVFormat.GetVertexSize());
+            return *reinterpret_cast<Vector3<float>*>(mNormals + static_cast<size_t>(i) * mStagingFormat.GetVertexSize());
         }
 
         inline Vector3<float>& Tangent(uint32_t i)
         {
-            return *reinterpret_cast<Vector3<float>*>(mTangents + static_cast<size_t>(i) * mVFormat.GetVertexSize());
+            return *reinterpret_cast<Vector3<float>*>(mTangents + static_cast<size_t>(i) * mStagingFormat.GetVertexSize());
         }
 
         inline Vector3<float>& Bitangent(uint32_t i)
         {
-            return *reinterpret_cast<Vector3<float>*>(mBitangents + static_cast<size_t>(i) * mVFormat.GetVertexSize());
+            return *reinterpret_cast<Vector3<float>*>(mBitangents + static_cast<size_t>(i) * mStagingFormat.GetVertexSize());
         }
 
         inline Vector2<float>& TCoord(uint32_t unit, uint32_t i)
         {
-            return *reinterpret_cast<Vector2<float>*>(mTCoords[unit] + static_cast<size_t>(i) * mVFormat.GetVertexSize());
+            return *reinterpret_cast<Vector2<float>*>(mTCoords[unit] + static_cast<size_t>(i) * mStagingFormat.GetVertexSize());
         }
 
         inline void SetPosition(uint32_t i, Vector3<float> const& pos)
@@ -228,10 +241,13 @@ namespace Vector_GM
         // Support for index buffers.
         void ReverseTriangleOrder(IndexBuffer* ibuffer);
 
-        VertexFormat mVFormat;
+        // The vertices are generated in mStagingFormat, which is mVFormat
+        // when the format has no compressed attributes.
+        VertexFormat mVFormat, mStagingFormat;
         size_t mIndexSize;
         Resource::Usage mVBUsage, mIBUsage;
         bool mOutside;
+        bool mDeferPacking;
         std::array<bool, VAConstant::MAX_TCOORD_UNITS> mAssignTCoords;
 
         char* mPositions;
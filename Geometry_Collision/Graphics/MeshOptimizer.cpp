@@ -0,0 +1,468 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/MeshOptimizer.h>
+#include <Mathematics/Logger.h>
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <thread>
+using namespace gte;
+
+namespace
+{
+    // The vertex score of Forsyth's algorithm. The three most recent
+    // vertices have a fixed score so that the next triangle does not simply
+    // continue a strip. Vertices with few remaining triangles are boosted
+    // so that they are removed from the mesh early.
+    float GetVertexScore(int32_t cachePosition, uint32_t numLiveTriangles,
+        uint32_t cacheSize)
+    {
+        if (numLiveTriangles == 0)
+        {
+            return -1.0f;
+        }
+
+        float score = 0.0f;
+        if (cachePosition >= 0)
+        {
+            if (cachePosition < 3)
+            {
+                score = 0.75f;
+            }
+            else
+            {
+                float const scale = 1.0f / static_cast<float>(cacheSize - 3);
+                float const ratio = 1.0f - static_cast<float>(cachePosition - 3) * scale;
+                score = ratio * std::sqrt(ratio);
+            }
+        }
+        score += 2.0f / std::sqrt(static_cast<float>(numLiveTriangles));
+        return score;
+    }
+}
+
+MeshOptimizer::MeshOptimizer(uint32_t numThreads, uint32_t cacheSize,
+    float overdrawThreshold)
+    :
+    mNumThreads(numThreads),
+    mCacheSize(cacheSize),
+    mOverdrawThreshold(overdrawThreshold)
+{
+    LogAssert(mCacheSize > 3, "The cache size must be larger than 3.");
+}
+
+void MeshOptimizer::Optimize(std::vector<std::shared_ptr<Visual>> const& visuals) const
+{
+    // The meshes have very different sizes, so the threads take the next
+    // unprocessed visual instead of a fixed block of visuals.
+    std::atomic<size_t> next(0);
+    auto process = [this, &visuals, &next]()
+    {
+        for (size_t i = next++; i < visuals.size(); i = next++)
+        {
+            auto const& visual = visuals[i];
+            if (visual && visual->GetVertexBuffer() && visual->GetIndexBuffer())
+            {
+                Optimize(*visual->GetVertexBuffer(), *visual->GetIndexBuffer());
+            }
+        }
+    };
+
+    size_t const numThreads = std::min(visuals.size(), static_cast<size_t>(mNumThreads));
+    if (numThreads > 1)
+    {
+        std::vector<std::thread> threads(numThreads);
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            threads[t] = std::thread(process);
+        }
+
+        for (size_t t = 0; t < numThreads; ++t)
+        {
+            threads[t].join();
+        }
+    }
+    else
+    {
+        process();
+    }
+}
+
+void MeshOptimizer::Optimize(VertexBuffer& vbuffer, IndexBuffer& ibuffer) const
+{
+    if (ibuffer.GetPrimitiveType() != IP_TRIMESH || !ibuffer.IsIndexed()
+        || !vbuffer.StandardUsage() || vbuffer.GetData() == nullptr)
+    {
+        return;
+    }
+
+    // Copy the indices to 32-bit storage.
+    uint32_t const numVertices = vbuffer.GetNumElements();
+    size_t const numIndices = 3 * static_cast<size_t>(ibuffer.GetNumPrimitives());
+    bool const use32Bit = (ibuffer.GetElementSize() == sizeof(uint32_t));
+    std::vector<uint32_t> indices(numIndices);
+    if (use32Bit)
+    {
+        std::copy(ibuffer.Get<uint32_t>(), ibuffer.Get<uint32_t>() + numIndices, indices.begin());
+    }
+    else
+    {
+        std::copy(ibuffer.Get<uint16_t>(), ibuffer.Get<uint16_t>() + numIndices, indices.begin());
+    }
+
+    OptimizeVertexCache(indices, numVertices, mCacheSize);
+
+    VertexFormat const& vformat = vbuffer.GetFormat();
+    size_t const stride = vformat.GetVertexSize();
+    if (mOverdrawThreshold > 0.0f)
+    {
+        int32_t const index = vformat.GetIndex(VASemantic::POSITION, 0);
+        if (index >= 0 && (vformat.GetType(index) == DF_R32G32B32_FLOAT
+            || vformat.GetType(index) == DF_R32G32B32A32_FLOAT))
+        {
+            char const* positions = vbuffer.GetData() + vformat.GetOffset(index);
+            OptimizeOverdraw(indices, numVertices, positions, stride, mCacheSize,
+                mOverdrawThreshold);
+        }
+    }
+
+    // Reorder the vertices.
+    std::vector<uint32_t> newIndices = OptimizeVertexFetch(indices, numVertices);
+    std::vector<char> vertices(vbuffer.GetData(), vbuffer.GetData() + numVertices * stride);
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        std::memcpy(vbuffer.GetData() + newIndices[v] * stride, &vertices[v * stride], stride);
+    }
+
+    // Copy the indices back to the buffer.
+    if (use32Bit)
+    {
+        std::copy(indices.begin(), indices.end(), ibuffer.Get<uint32_t>());
+    }
+    else
+    {
+        std::transform(indices.begin(), indices.end(), ibuffer.Get<uint16_t>(),
+            [](uint32_t i) { return static_cast<uint16_t>(i); });
+    }
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices,
+    uint32_t numVertices, uint32_t cacheSize)
+{
+    size_t const numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // The triangles adjacent to each vertex. The live triangles of vertex
+    // v, those not yet emitted, are adjacency[offsets[v]] through
+    // adjacency[offsets[v] + numLive[v] - 1].
+    std::vector<uint32_t> numLive(numVertices, 0);
+    for (auto v : indices)
+    {
+        ++numLive[v];
+    }
+
+    std::vector<uint32_t> offsets(static_cast<size_t>(numVertices) + 1, 0);
+    std::partial_sum(numLive.begin(), numLive.end(), offsets.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); ++i)
+    {
+        adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int32_t> cachePosition(numVertices, -1);
+    std::vector<float> vertexScore(numVertices);
+    for (uint32_t v = 0; v < numVertices; ++v)
+    {
+        vertexScore[v] = GetVertexScore(-1, numLive[v], cacheSize);
+    }
+
+    std::vector<float> triangleScore(numTriangles);
+    std::vector<uint8_t> emitted(numTriangles, 0);
+    size_t best = 0;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        uint32_t const* tri = &indices[3 * t];
+        triangleScore[t] = vertexScore[tri[0]] + vertexScore[tri[1]] + vertexScore[tri[2]];
+        if (triangleScore[t] > triangleScore[best])
+        {
+            best = t;
+        }
+    }
+
+    // The LRU cache holds up to cacheSize vertices; the extra 3 slots hold
+    // the vertices that are evicted by the emitted triangle.
+    std::vector<uint32_t> cache, newCache;
+    cache.reserve(static_cast<size_t>(cacheSize) + 3);
+    newCache.reserve(static_cast<size_t>(cacheSize) + 3);
+
+    std::vector<uint32_t> output(indices.size());
+    size_t scan = 0;
+    for (size_t k = 0; k < numTriangles; ++k)
+    {
+        if (best == numTriangles)
+        {
+            // No vertex in the cache has a live triangle. Continue with the
+            // next triangle in the input order.
+            while (emitted[scan])
+            {
+                ++scan;
+            }
+            best = scan;
+        }
+
+        // Emit the triangle and remove it from the adjacency lists.
+        uint32_t const* tri = &indices[3 * best];
+        emitted[best] = 1;
+        newCache.clear();
+        for (int32_t j = 0; j < 3; ++j)
+        {
+            uint32_t const v = tri[j];
+            output[3 * k + j] = v;
+            if (std::find(newCache.begin(), newCache.end(), v) == newCache.end())
+            {
+                newCache.push_back(v);
+            }
+
+            uint32_t* live = &adjacency[offsets[v]];
+            uint32_t* last = live + --numLive[v];
+            *std::find(live, last + 1, static_cast<uint32_t>(best)) = *last;
+        }
+        for (auto v : cache)
+        {
+            if (v != tri[0] && v != tri[1] && v != tri[2])
+            {
+                newCache.push_back(v);
+            }
+        }
+        std::swap(cache, newCache);
+
+        // Update the scores of the vertices in the cache and of the evicted
+        // vertices, and then those of their live triangles.
+        for (size_t i = 0; i < cache.size(); ++i)
+        {
+            uint32_t const v = cache[i];
+            cachePosition[v] = (i < cacheSize ? static_cast<int32_t>(i) : -1);
+            float const score = GetVertexScore(cachePosition[v], numLive[v], cacheSize);
+            float const delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            for (uint32_t a = offsets[v]; a < offsets[v] + numLive[v]; ++a)
+            {
+                triangleScore[adjacency[a]] += delta;
+            }
+        }
+        if (cache.size() > cacheSize)
+        {
+            cache.resize(cacheSize);
+        }
+
+        // The next triangle is the best one adjacent to the cache.
+        best = numTriangles;
+        float bestScore = -1.0f;
+        for (auto v : cache)
+        {
+            for (uint32_t a = offsets[v]; a < offsets[v] + numLive[v]; ++a)
+            {
+                uint32_t const t = adjacency[a];
+                if (triangleScore[t] > bestScore)
+                {
+                    bestScore = triangleScore[t];
+                    best = t;
+                }
+            }
+        }
+    }
+
+    indices = std::move(output);
+}
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices,
+    uint32_t numVertices, char const* positions, size_t stride,
+    uint32_t cacheSize, float threshold)
+{
+    size_t const numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    auto position = [positions, stride](uint32_t v)
+    {
+        return *reinterpret_cast<Vector3<float> const*>(positions + v * stride);
+    };
+
+    // Simulate a FIFO cache. A vertex is in the cache when fewer than
+    // cacheSize misses occurred since it was loaded.
+    std::vector<size_t> loadTime(numVertices, 0);
+    size_t time = static_cast<size_t>(cacheSize) + 1;
+    auto countMisses = [&indices, &loadTime, &time, cacheSize](size_t t)
+    {
+        uint32_t misses = 0;
+        for (size_t j = 3 * t; j < 3 * t + 3; ++j)
+        {
+            if (time - loadTime[indices[j]] > cacheSize)
+            {
+                loadTime[indices[j]] = time++;
+                ++misses;
+            }
+        }
+        return misses;
+    };
+
+    // The hard boundaries are the triangles whose 3 vertices all miss the
+    // cache; the clusters between them may be drawn in any order without
+    // increasing the number of misses much.
+    float const meshACMR = GetACMR(indices, numVertices, cacheSize);
+    std::vector<size_t> clusters(1, 0);
+    time += cacheSize + 1;
+    for (size_t t = 0; t < numTriangles; ++t)
+    {
+        if (countMisses(t) == 3 && t > 0)
+        {
+            clusters.push_back(t);
+        }
+    }
+    clusters.push_back(numTriangles);
+
+    // The soft boundaries split the hard clusters. A cluster ends as soon
+    // as its miss ratio, starting with an empty cache, is within the
+    // threshold of that of the mesh.
+    std::vector<size_t> softClusters;
+    float const maxACMR = threshold * meshACMR;
+    for (size_t c = 0; c + 1 < clusters.size(); ++c)
+    {
+        time += cacheSize + 1;
+        uint32_t misses = 0, count = 0;
+        softClusters.push_back(clusters[c]);
+        for (size_t t = clusters[c]; t < clusters[c + 1]; ++t)
+        {
+            misses += countMisses(t);
+            ++count;
+            if (t + 1 < clusters[c + 1] &&
+                static_cast<float>(misses) <= maxACMR * static_cast<float>(count))
+            {
+                time += cacheSize + 1;
+                misses = 0;
+                count = 0;
+                softClusters.push_back(t + 1);
+            }
+        }
+    }
+    softClusters.push_back(numTriangles);
+
+    // The area-weighted centroids and normals of the clusters and the
+    // centroid of the mesh.
+    size_t const numClusters = softClusters.size() - 1;
+    std::vector<Vector3<float>> centroids(numClusters), normals(numClusters);
+    Vector3<float> meshCentroid{ 0.0f, 0.0f, 0.0f };
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        Vector3<float> centroid{ 0.0f, 0.0f, 0.0f };
+        Vector3<float> normal{ 0.0f, 0.0f, 0.0f };
+        float area = 0.0f;
+        for (size_t t = softClusters[c]; t < softClusters[c + 1]; ++t)
+        {
+            Vector3<float> p0 = position(indices[3 * t]);
+            Vector3<float> p1 = position(indices[3 * t + 1]);
+            Vector3<float> p2 = position(indices[3 * t + 2]);
+            Vector3<float> cross = Cross(p1 - p0, p2 - p0);
+            float const twiceArea = Length(cross);
+            centroid += (twiceArea / 3.0f) * (p0 + p1 + p2);
+            normal += cross;
+            area += twiceArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = (area > 0.0f ? centroid / area : centroid);
+        normals[c] = normal;
+        Normalize(normals[c]);
+    }
+    if (meshArea > 0.0f)
+    {
+        meshCentroid /= meshArea;
+    }
+
+    // Draw the clusters in decreasing order of the signed distance of their
+    // centroids along their normals from the mesh centroid. For a convex
+    // mesh these occlude the later ones.
+    std::vector<float> sortKeys(numClusters);
+    std::vector<size_t> order(numClusters);
+    for (size_t c = 0; c < numClusters; ++c)
+    {
+        sortKeys[c] = Dot(centroids[c] - meshCentroid, normals[c]);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(),
+        [&sortKeys](size_t c0, size_t c1) { return sortKeys[c0] > sortKeys[c1]; });
+
+    std::vector<uint32_t> output;
+    output.reserve(indices.size());
+    for (auto c : order)
+    {
+        output.insert(output.end(), indices.begin() + 3 * softClusters[c],
+            indices.begin() + 3 * softClusters[c + 1]);
+    }
+    indices = std::move(output);
+}
+
+std::vector<uint32_t> MeshOptimizer::OptimizeVertexFetch(
+    std::vector<uint32_t>& indices, uint32_t numVertices)
+{
+    uint32_t const invalid = std::numeric_limits<uint32_t>::max();
+    std::vector<uint32_t> newIndices(numVertices, invalid);
+    uint32_t numUsed = 0;
+    for (auto& v : indices)
+    {
+        if (newIndices[v] == invalid)
+        {
+            newIndices[v] = numUsed++;
+        }
+        v = newIndices[v];
+    }
+
+    for (auto& v : newIndices)
+    {
+        if (v == invalid)
+        {
+            v = numUsed++;
+        }
+    }
+    return newIndices;
+}
+
+float MeshOptimizer::GetACMR(std::vector<uint32_t> const& indices,
+    uint32_t numVertices, uint32_t cacheSize)
+{
+    size_t const numTriangles = indices.size() / 3;
+    if (numTriangles == 0)
+    {
+        return 0.0f;
+    }
+
+    std::vector<size_t> loadTime(numVertices, 0);
+    size_t time = static_cast<size_t>(cacheSize) + 1;
+    size_t misses = 0;
+    for (auto v : indices)
+    {
+        if (time - loadTime[v] > cacheSize)
+        {
+            loadTime[v] = time++;
+            ++misses;
+        }
+    }
+    return static_cast<float>(misses) / static_cast<float>(numTriangles);
+}
@@ -0,0 +1,86 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/IndexBuffer.h>
+#include <Graphics/VertexBuffer.h>
+#include <Graphics/Visual.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Reordering of indexed triangle meshes for the GPU, intended for meshes
+// that are created once, for example by MeshFactory or by an importer. The
+// stages of Optimize are
+//   1. vertex cache optimization, the greedy algorithm of Tom Forsyth,
+//      "Linear-Speed Vertex Cache Optimisation", 2006, which emits the
+//      triangle of largest score among those with a vertex in a simulated
+//      LRU cache;
+//   2. overdraw optimization (optional), which splits the triangle order
+//      into clusters with a good cache miss ratio and sorts the clusters so
+//      that outward-facing clusters far from the center are drawn first,
+//      following Sander, Nehab and Barczak, "Fast Triangle Reordering for
+//      Vertex Locality and Reduced Overdraw", 2007;
+//   3. vertex fetch optimization, which stores the vertices in the order of
+//      their first use by the index buffer; vertices that are not
+//      referenced are moved to the end.
+// The rendered triangles are the same, with the same winding order. Only
+// index buffers of type IP_TRIMESH with index storage are reordered, and
+// the overdraw stage requires DF_R32G32B32_FLOAT or DF_R32G32B32A32_FLOAT
+// positions.
+//
+// The meshes of CLODMesh must not be optimized, because the collapse
+// records refer to the positions of the indices in the index buffer.
+
+namespace gte
+{
+    class MeshOptimizer
+    {
+    public:
+        // Construction and destruction. The cache size is that of the
+        // simulated post-transform cache; 32 is a good choice for current
+        // GPUs, which do not have a FIFO cache of a fixed size. An overdraw
+        // threshold of 0 disables the overdraw stage. A threshold t >= 1
+        // allows the clusters to have a cache miss ratio up to t times that
+        // of the vertex-cache-optimized mesh; 1.05 is a typical choice.
+        MeshOptimizer(uint32_t numThreads = 1, uint32_t cacheSize = 32,
+            float overdrawThreshold = 0.0f);
+        ~MeshOptimizer() = default;
+
+        // Optimize the meshes of the visuals, one mesh at a time per thread.
+        // The visuals must not share vertex or index buffers.
+        void Optimize(std::vector<std::shared_ptr<Visual>> const& visuals) const;
+
+        // Optimize a single mesh.
+        void Optimize(VertexBuffer& vbuffer, IndexBuffer& ibuffer) const;
+
+        // The stages, for index arrays of triangle lists. Each vertex index
+        // must be smaller than numVertices. OptimizeVertexFetch returns the
+        // map from the old vertex indices to the new ones.
+        static void OptimizeVertexCache(std::vector<uint32_t>& indices,
+            uint32_t numVertices, uint32_t cacheSize);
+
+        static void OptimizeOverdraw(std::vector<uint32_t>& indices,
+            uint32_t numVertices, char const* positions, size_t stride,
+            uint32_t cacheSize, float threshold);
+
+        static std::vector<uint32_t> OptimizeVertexFetch(
+            std::vector<uint32_t>& indices, uint32_t numVertices);
+
+        // The average cache miss ratio, the number of vertex shader
+        // invocations per triangle for a FIFO cache of the specified size.
+        // The value is between 0.5 (for large regular meshes) and 3.
+        static float GetACMR(std::vector<uint32_t> const& indices,
+            uint32_t numVertices, uint32_t cacheSize);
+
+    private:
+        uint32_t mNumThreads;
+        uint32_t mCacheSize;
+        float mOverdrawThreshold;
+    };
+}
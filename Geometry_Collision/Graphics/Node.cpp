@@ -8,6 +8,8 @@
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/Node.h>
 #include <Mathematics/Logger.h>
+#include <algorithm>
+#include <limits>
 using namespace gte;
 
 Node::~Node()
@@ -22,6 +24,12 @@ Node::~Node()
     }
 }
 
+Node::Node()
+    :
+    boundPolicy(BoundPolicy::MERGE_SPHERES)
+{
+}
+
 int32_t Node::GetNumChildren() const
 {
     return static_cast<int32_t>(mChild.size());
@@ -167,17 +175,59 @@ void Node::UpdateWorldBound()
         worldBound.SetCenter({ 0.0f, 0.0f, 0.0f });
         worldBound.SetRadius(0.0f);
 
+        if (boundPolicy == BoundPolicy::MERGE_SPHERES)
+        {
+            for (auto& child : mChild)
+            {
+                if (child)
+                {
+                    // GrowToContain ignores invalid child bounds.  If the
+                    // world bound is invalid and a child bound is valid, the
+                    // child bound is copied to the world bound.  If the world
+                    // bound and child bound are valid, the smallest bound
+                    // containing both bounds is assigned to the world bound.
+                    worldBound.GrowToContain(child->worldBound);
+                }
+            }
+            return;
+        }
+
+        // Compute the axis-aligned box containing the valid child bounds.
+        float const maxFloat = std::numeric_limits<float>::max();
+        Vector3<float> boxMin{ maxFloat, maxFloat, maxFloat };
+        Vector3<float> boxMax{ -maxFloat, -maxFloat, -maxFloat };
+        bool hasValidChild = false;
         for (auto& child : mChild)
         {
-            if (child)
+            if (child && child->worldBound.GetRadius() > 0.0f)
+            {
+                Vector3<float> center = child->worldBound.GetCenter();
+                float radius = child->worldBound.GetRadius();
+                for (int32_t i = 0; i < 3; ++i)
+                {
+                    boxMin[i] = std::min(boxMin[i], center[i] - radius);
+                    boxMax[i] = std::max(boxMax[i], center[i] + radius);
+                }
+                hasValidChild = true;
+            }
+        }
+
+        if (hasValidChild)
+        {
+            // The sphere centered at the box center must reach the farthest
+            // point of every child sphere.
+            Vector3<float> center = 0.5f * (boxMin + boxMax);
+            float radius = 0.0f;
+            for (auto& child : mChild)
             {
-                // GrowToContain ignores invalid child bounds.  If the world
-                // bound is invalid and a child bound is valid, the child
-                // bound is copied to the world bound.  If the world bound and
-                // child bound are valid, the smallest bound containing both
-                // bounds is assigned to the world bound.
-                worldBound.GrowToContain(child->worldBound);
+                if (child && child->worldBound.GetRadius() > 0.0f)
+                {
+                    Vector3<float> diff = child->worldBound.GetCenter() - center;
+                    radius = std::max(radius, Length(diff) + child->worldBound.GetRadius());
+                }
             }
+            worldBound.SetCenter(center);
+            worldBound.SetRadius(radius);
         }
     }
 }
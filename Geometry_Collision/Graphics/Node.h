@@ -18,7 +18,24 @@ namespace Vector_GM
     public:
         // Construction and destruction.
         virtual ~Node();
-        Node() = default;
+        Node();
+
+        // The world bound of a node contains the world bounds of its
+        // children.  With MERGE_SPHERES, the default, the child spheres are
+        // merged one at a time by BoundingSphere::GrowToContain.  The result
+        // depends on the order of the children and is loose when there are
+        // many of them.  With BOX_CENTERED, the center is that of the
+        // axis-aligned box containing the child spheres and the radius is
+        // the smallest one for which the sphere contains all child spheres.
+        // This costs a second pass over the children but is usually much
+        // tighter, which reduces the false positives of Culler and Picker.
+        enum class BoundPolicy
+        {
+            MERGE_SPHERES,
+            BOX_CENTERED
+        };
+
+        BoundPolicy boundPolicy;
 
         // This is the current number of elements in the child array.  These
         // elements are not all guaranteed to be non-null.  Thus, when you
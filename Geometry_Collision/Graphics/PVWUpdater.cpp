@@ -35,7 +35,8 @@ bool PVWUpdater::Subscribe(Matrix4x4<float> const& worldMatrix,
 {
     if (cbuffer && cbuffer->HasMember(pvwMatrixName))
     {
-        if (mSubscribers.find(&worldMatrix) == mSubscribers.end())
+        if (mSubscribers.find(&worldMatrix) == mSubscribers.end() &&
+            mBatchedSubscribers.find(&worldMatrix) == mBatchedSubscribers.end())
         {
             mSubscribers.insert(std::make_pair(&worldMatrix,
                 std::make_pair(cbuffer, pvwMatrixName)));
@@ -61,9 +62,72 @@ bool PVWUpdater::Subscribe(std::shared_ptr<Visual> const& visual,
     return false;
 }
 
+bool PVWUpdater::Subscribe(Matrix4x4<float> const& worldMatrix,
+    std::shared_ptr<StructuredBuffer> const& pvwBuffer, uint32_t index)
+{
+    if (pvwBuffer &&
+        pvwBuffer->GetElementSize() == sizeof(Matrix4x4<float>) &&
+        index < pvwBuffer->GetNumElements())
+    {
+        if (mSubscribers.find(&worldMatrix) == mSubscribers.end() &&
+            mBatchedSubscribers.find(&worldMatrix) == mBatchedSubscribers.end())
+        {
+            mBatchedSubscribers.insert(std::make_pair(&worldMatrix, pvwBuffer));
+            auto& batch = mBatches[pvwBuffer];
+            batch.worldMatrices.push_back(&worldMatrix);
+            batch.indices.push_back(index);
+            return true;
+        }
+    }
+    return false;
+}
+
+std::shared_ptr<StructuredBuffer> PVWUpdater::CreatePVWBuffer(uint32_t numMatrices)
+{
+    auto pvwBuffer = std::make_shared<StructuredBuffer>(numMatrices,
+        sizeof(Matrix4x4<float>));
+    pvwBuffer->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+    auto pvwMatrices = pvwBuffer->Get<Matrix4x4<float>>();
+    for (uint32_t i = 0; i < numMatrices; ++i)
+    {
+        pvwMatrices[i] = Matrix4x4<float>::Identity();
+    }
+    return pvwBuffer;
+}
+
 bool PVWUpdater::Unsubscribe(Matrix4x4<float> const& worldMatrix)
 {
-    return mSubscribers.erase(&worldMatrix) > 0;
+    if (mSubscribers.erase(&worldMatrix) > 0)
+    {
+        return true;
+    }
+
+    auto iter = mBatchedSubscribers.find(&worldMatrix);
+    if (iter != mBatchedSubscribers.end())
+    {
+        // The order of the matrices in a batch does not matter, so the
+        // last matrix is moved to the position of the removed one.
+        auto batchIter = mBatches.find(iter->second);
+        auto& batch = batchIter->second;
+        for (size_t i = 0; i < batch.worldMatrices.size(); ++i)
+        {
+            if (batch.worldMatrices[i] == &worldMatrix)
+            {
+                batch.worldMatrices[i] = batch.worldMatrices.back();
+                batch.indices[i] = batch.indices.back();
+                batch.worldMatrices.pop_back();
+                batch.indices.pop_back();
+                break;
+            }
+        }
+        if (batch.worldMatrices.size() == 0)
+        {
+            mBatches.erase(batchIter);
+        }
+        mBatchedSubscribers.erase(iter);
+        return true;
+    }
+    return false;
 }
 
 bool PVWUpdater::Unsubscribe(std::shared_ptr<Visual> const& visual)
@@ -79,6 +143,8 @@ bool PVWUpdater::Unsubscribe(std::shared_ptr<Visual> const& visual)
 void PVWUpdater::UnsubscribeAll()
 {
     mSubscribers.clear();
+    mBatches.clear();
+    mBatchedSubscribers.clear();
 }
 
 void PVWUpdater::Update()
@@ -106,6 +172,25 @@ void PVWUpdater::Update()
             // Allow the caller to update GPU memory as desired.
             mUpdater(cbuffer);
         }
+
+        for (auto& element : mBatches)
+        {
+            auto const& pvwBuffer = element.first;
+            auto const& batch = element.second;
+            auto pvwMatrices = pvwBuffer->Get<Matrix4x4<float>>();
+            for (size_t i = 0; i < batch.worldMatrices.size(); ++i)
+            {
+                auto const& wMatrix = *batch.worldMatrices[i];
+#if defined(GTE_USE_MAT_VEC)
+                pvwMatrices[batch.indices[i]] = pvMatrix * wMatrix;
+#else
+                pvwMatrices[batch.indices[i]] = wMatrix * pvMatrix;
+#endif
+            }
+
+            // One copy to GPU memory for all the matrices of the buffer.
+            mUpdater(pvwBuffer);
+        }
     }
 }
 
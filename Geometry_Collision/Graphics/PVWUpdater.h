@@ -4,8 +4,10 @@
 
 #include "Camera.h"
 #include "ConstantBuffer.h"
+#include "StructuredBuffer.h"
 #include "Visual.h"
 #include <map>
+#include <vector>
 
 // The PVWUpdater class is responsible for managing memory associated with
 // projection-view-world matrices stored in ConstantBuffer objects that are
@@ -42,6 +44,14 @@
 //      of a static set of matrix-buffer pairs (for example, the stationary
 //      background objects in the world) and a dynamic set of matrix-buffer
 //      pairs (for example, the moving objects in the world).
+//
+//   4. The matrices of scenario 1 can be batched. Instead of one constant
+//      buffer per world matrix, the PVW matrices are stored in consecutive
+//      elements of one structured buffer, and each shader reads its matrix
+//      at an index, for example ConstantColorEffect constructed with a PVW
+//      buffer and index. The matrices of a buffer are computed together and
+//      the BufferUpdater is called once for the buffer, so N objects require
+//      one CPU-to-GPU copy per Update() call instead of N.
 
 namespace gte
 {
@@ -98,6 +108,17 @@ namespace gte
         bool Subscribe(std::shared_ptr<Visual> const& visual,
             std::string const& pvwMatrixName = "pvwMatrix");
 
+        // Batched subscription. The PVW matrix is written to element 'index'
+        // of 'pvwBuffer', whose elements are Matrix4x4<float>. The buffer
+        // must allow dynamic updates; CreatePVWBuffer creates such a buffer.
+        // Several world matrices may share a buffer, each with its own
+        // index.
+        bool Subscribe(Matrix4x4<float> const& worldMatrix,
+            std::shared_ptr<StructuredBuffer> const& pvwBuffer, uint32_t index);
+
+        static std::shared_ptr<StructuredBuffer> CreatePVWBuffer(uint32_t numMatrices);
+
+        // The Unsubscribe functions apply to both kinds of subscriptions.
         bool Unsubscribe(Matrix4x4<float> const& worldMatrix);
         bool Unsubscribe(std::shared_ptr<Visual> const& visual);
         void UnsubscribeAll();
@@ -122,5 +143,16 @@ namespace gte
         typedef Matrix4x4<float> const* PVWKey;
         typedef std::pair<std::shared_ptr<ConstantBuffer>, std::string> PVWValue;
         std::map<PVWKey, PVWValue> mSubscribers;
+
+        // The batched subscribers grouped by buffer, so that a buffer is
+        // copied to GPU memory once per Update() call.
+        struct PVWBatch
+        {
+            std::vector<PVWKey> worldMatrices;
+            std::vector<uint32_t> indices;
+        };
+
+        std::map<std::shared_ptr<StructuredBuffer>, PVWBatch> mBatches;
+        std::map<PVWKey, std::shared_ptr<StructuredBuffer>> mBatchedSubscribers;
     };
 }
@@ -0,0 +1,192 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/ParticleBillboardEffect.h>
+using namespace gte;
+
+ParticleBillboardEffect::ParticleBillboardEffect(std::shared_ptr<ProgramFactory> const& factory,
+    std::shared_ptr<Particles> const& particles,
+    std::shared_ptr<Texture2> const& texture,
+    SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1)
+    :
+    mTexture(texture)
+{
+    LogAssert(particles != nullptr && particles->UsesGPU(),
+        "The particles must be created for the GPU.");
+
+    int32_t api = factory->GetAPI();
+    mProgram = factory->CreateFromSources(*msVSSource[api], *msPSSource[api], "");
+    if (mProgram)
+    {
+        mSampler = std::make_shared<SamplerState>();
+        mSampler->filter = filter;
+        mSampler->mode[0] = mode0;
+        mSampler->mode[1] = mode1;
+
+        auto const& vshader = mProgram->GetVertexShader();
+        vshader->Set("PVWMatrix", mPVWMatrixConstant);
+        vshader->Set("Billboard", particles->GetBillboardBuffer());
+        vshader->Set("positionSize", particles->GetPositionSizeBuffer());
+        mProgram->GetPixelShader()->Set("baseTexture", texture, "baseSampler", mSampler);
+    }
+    else
+    {
+        LogError("Failed to compile shader programs.");
+    }
+}
+
+void ParticleBillboardEffect::SetPVWMatrixConstant(std::shared_ptr<ConstantBuffer> const& buffer)
+{
+    VisualEffect::SetPVWMatrixConstant(buffer);
+    mProgram->GetVertexShader()->Set("PVWMatrix", mPVWMatrixConstant);
+}
+
+
+std::string const ParticleBillboardEffect::msGLSLVSSource =
+R"(
+    uniform PVWMatrix
+    {
+        mat4 pvwMatrix;
+    };
+
+    uniform Billboard
+    {
+        vec4 upPlusRight;
+        vec4 upMinusRight;
+        vec4 sizeAdjust;
+    };
+
+    buffer positionSize
+    {
+        vec4 data[];
+    } positionSizeSB;
+
+    layout(location = 0) out vec2 vertexTCoord;
+
+    const int cornerIndex[6] = int[6](0, 1, 2, 0, 2, 3);
+    const vec2 cornerTCoord[4] = vec2[4](
+        vec2(0.0f, 0.0f), vec2(1.0f, 0.0f), vec2(1.0f, 1.0f), vec2(0.0f, 1.0f));
+    const vec2 cornerCoeff[4] = vec2[4](
+        vec2(-1.0f, 0.0f), vec2(0.0f, -1.0f), vec2(1.0f, 0.0f), vec2(0.0f, 1.0f));
+
+    void main()
+    {
+        int corner = cornerIndex[gl_VertexID % 6];
+        vec4 posSize = positionSizeSB.data[gl_VertexID / 6];
+        vec2 coeff = (sizeAdjust.x * posSize.w) * cornerCoeff[corner];
+        vec3 modelPosition = posSize.xyz + coeff.x * upPlusRight.xyz + coeff.y * upMinusRight.xyz;
+        vertexTCoord = cornerTCoord[corner];
+    #if GTE_USE_MAT_VEC
+        gl_Position = pvwMatrix * vec4(modelPosition, 1.0f);
+    #else
+        gl_Position = vec4(modelPosition, 1.0f) * pvwMatrix;
+    #endif
+    }
+)";
+
+std::string const ParticleBillboardEffect::msGLSLPSSource =
+R"(
+    uniform sampler2D baseSampler;
+
+    layout(location = 0) in vec2 vertexTCoord;
+    layout(location = 0) out vec4 pixelColor;
+
+    void main()
+    {
+        pixelColor = texture(baseSampler, vertexTCoord);
+    }
+)";
+
+std::string const ParticleBillboardEffect::msHLSLVSSource =
+R"(
+    cbuffer PVWMatrix
+    {
+        float4x4 pvwMatrix;
+    };
+
+    cbuffer Billboard
+    {
+        float4 upPlusRight;
+        float4 upMinusRight;
+        float4 sizeAdjust;
+    };
+
+    StructuredBuffer<float4> positionSize;
+
+    struct VS_INPUT
+    {
+        uint id : SV_VertexID;
+    };
+
+    struct VS_OUTPUT
+    {
+        float2 vertexTCoord : TEXCOORD0;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    static const uint cornerIndex[6] = { 0, 1, 2, 0, 2, 3 };
+    static const float2 cornerTCoord[4] =
+    {
+        float2(0.0f, 0.0f), float2(1.0f, 0.0f), float2(1.0f, 1.0f), float2(0.0f, 1.0f)
+    };
+    static const float2 cornerCoeff[4] =
+    {
+        float2(-1.0f, 0.0f), float2(0.0f, -1.0f), float2(1.0f, 0.0f), float2(0.0f, 1.0f)
+    };
+
+    VS_OUTPUT VSMain(VS_INPUT input)
+    {
+        VS_OUTPUT output;
+        uint corner = cornerIndex[input.id % 6];
+        float4 posSize = positionSize[input.id / 6];
+        float2 coeff = (sizeAdjust.x * posSize.w) * cornerCoeff[corner];
+        float3 modelPosition = posSize.xyz + coeff.x * upPlusRight.xyz + coeff.y * upMinusRight.xyz;
+    #if GTE_USE_MAT_VEC
+        output.clipPosition = mul(pvwMatrix, float4(modelPosition, 1.0f));
+    #else
+        output.clipPosition = mul(float4(modelPosition, 1.0f), pvwMatrix);
+    #endif
+        output.vertexTCoord = cornerTCoord[corner];
+        return output;
+    }
+)";
+
+std::string const ParticleBillboardEffect::msHLSLPSSource =
+R"(
+    Texture2D baseTexture;
+    SamplerState baseSampler;
+
+    struct PS_INPUT
+    {
+        float2 vertexTCoord : TEXCOORD0;
+    };
+
+    struct PS_OUTPUT
+    {
+        float4 pixelColor : SV_TARGET0;
+    };
+
+    PS_OUTPUT PSMain(PS_INPUT input)
+    {
+        PS_OUTPUT output;
+        output.pixelColor = baseTexture.Sample(baseSampler, input.vertexTCoord);
+        return output;
+    }
+)";
+
+ProgramSources const ParticleBillboardEffect::msVSSource =
+{
+    &msGLSLVSSource,
+    &msHLSLVSSource
+};
+
+ProgramSources const ParticleBillboardEffect::msPSSource =
+{
+    &msGLSLPSSource,
+    &msHLSLPSSource
+};
@@ -0,0 +1,62 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/VisualEffect.h>
+#include <Graphics/Particles.h>
+#include <Graphics/Texture2.h>
+
+// The effect for drawing Particles whose state lives on the GPU. The vertex
+// shader reads the position and size of particle id/6 from the structured
+// buffer of the particles and generates corner (0,1,2,0,2,3)[id%6] of its
+// camera-facing square, with the texture coordinates that the CPU path of
+// Particles::GenerateParticles assigns to the corners.
+//
+//   auto particles = std::make_shared<Particles>(positionSize, sizeAdjust);
+//   auto effect = std::make_shared<ParticleBillboardEffect>(factory,
+//       particles, texture, filter, mode0, mode1);
+//   particles->SetEffect(effect);
+
+namespace gte
+{
+    class ParticleBillboardEffect : public VisualEffect
+    {
+    public:
+        // Construction. The particles must be created for the GPU.
+        ParticleBillboardEffect(std::shared_ptr<ProgramFactory> const& factory,
+            std::shared_ptr<Particles> const& particles,
+            std::shared_ptr<Texture2> const& texture,
+            SamplerState::Filter filter, SamplerState::Mode mode0, SamplerState::Mode mode1);
+
+        // Member access.
+        virtual void SetPVWMatrixConstant(std::shared_ptr<ConstantBuffer> const& buffer) override;
+
+        inline std::shared_ptr<Texture2> const& GetTexture() const
+        {
+            return mTexture;
+        }
+
+        inline std::shared_ptr<SamplerState> const& GetSampler() const
+        {
+            return mSampler;
+        }
+
+    private:
+        // Pixel shader parameters.
+        std::shared_ptr<Texture2> mTexture;
+        std::shared_ptr<SamplerState> mSampler;
+
+        // Shader source code as strings.
+        static std::string const msGLSLVSSource;
+        static std::string const msGLSLPSSource;
+        static std::string const msHLSLVSSource;
+        static std::string const msHLSLPSSource;
+        static ProgramSources const msVSSource;
+        static ProgramSources const msPSSource;
+    };
+}
@@ -19,10 +19,23 @@ ParticleController::ParticleController(std::shared_ptr<Camera> const& camera,
     systemAngularAxis(Vector3<float>::Unit(2)),
     systemSizeChange(0.0f),
     mCamera(camera),
-    mPostUpdate(postUpdate)
+    mPostUpdate(postUpdate),
+    mMotionChanged(false)
 {
 }
 
+ParticleController::ParticleController(std::shared_ptr<Camera> const& camera,
+    BufferUpdater const& postUpdate,
+    std::shared_ptr<ProgramFactory> const& factory,
+    ProgramExecutor const& execute)
+    :
+    ParticleController(camera, postUpdate)
+{
+    LogAssert(factory != nullptr && execute, "Invalid input.");
+    mFactory = factory;
+    mExecute = execute;
+}
+
 bool ParticleController::Update(double applicationTime)
 {
     if (!Controller::Update(applicationTime))
@@ -49,8 +62,7 @@ void ParticleController::SetObject(ControlledObject* object)
     auto visual = dynamic_cast<Particles*>(object);
     LogAssert(visual != nullptr, "Object is not of type Particles.");
 
-    auto const& vbuffer = visual->GetVertexBuffer();
-    size_t numParticles = static_cast<size_t>(vbuffer->GetNumElements() / 4);
+    size_t numParticles = visual->GetNumParticles();
     mParticleLinearSpeed.resize(numParticles);
     mParticleLinearAxis.resize(numParticles);
     mParticleSizeChange.resize(numParticles);
@@ -61,6 +73,32 @@ void ParticleController::SetObject(ControlledObject* object)
         mParticleSizeChange[i] = 0.0f;
     }
 
+    if (mFactory)
+    {
+        LogAssert(visual->UsesGPU(), "The particles must be created for the GPU.");
+
+        uint32_t const numThreads = msNumXThreads;
+        mFactory->PushDefines();
+        mFactory->defines.Set("NUM_X_THREADS", numThreads);
+        mProgram = mFactory->CreateFromSource(*msCSSource[mFactory->GetAPI()]);
+        mFactory->PopDefines();
+        if (!mProgram)
+        {
+            LogError("Failed to compile the particle program.");
+        }
+
+        mMotionBuffer = std::make_shared<StructuredBuffer>(
+            static_cast<uint32_t>(numParticles), sizeof(Vector4<float>));
+        mMotionBuffer->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+        mIntegrationBuffer = std::make_shared<ConstantBuffer>(sizeof(IntegrationConstants), true);
+        mMotionChanged = true;
+
+        auto const& cshader = mProgram->GetComputeShader();
+        cshader->Set("Integration", mIntegrationBuffer);
+        cshader->Set("positionSize", visual->GetPositionSizeBuffer());
+        cshader->Set("motion", mMotionBuffer);
+    }
+
     Controller::SetObject(object);
 }
 
@@ -90,6 +128,12 @@ void ParticleController::UpdateSystemMotion(float ctrlTime)
 
 void ParticleController::UpdatePointMotion(float ctrlTime)
 {
+    if (mProgram)
+    {
+        UpdatePointMotionGPU(ctrlTime);
+        return;
+    }
+
     auto particles = static_cast<Particles*>(mObject);
     auto& posSize = particles->GetPositionSize();
     uint32_t numActive = particles->GetNumActive();
@@ -107,3 +151,82 @@ void ParticleController::UpdatePointMotion(float ctrlTime)
     particles->GenerateParticles(mCamera);
     mPostUpdate(particles->GetVertexBuffer());
 }
+
+void ParticleController::UpdatePointMotionGPU(float ctrlTime)
+{
+    auto particles = static_cast<Particles*>(mObject);
+    uint32_t numActive = particles->GetNumActive();
+
+    if (mMotionChanged)
+    {
+        mMotionChanged = false;
+        auto motion = mMotionBuffer->Get<Vector4<float>>();
+        for (size_t i = 0; i < mParticleLinearSpeed.size(); ++i)
+        {
+            Vector3<float> velocity = mParticleLinearSpeed[i] * mParticleLinearAxis[i];
+            motion[i] = { velocity[0], velocity[1], velocity[2], mParticleSizeChange[i] };
+        }
+        mPostUpdate(mMotionBuffer);
+    }
+
+    auto constants = mIntegrationBuffer->Get<IntegrationConstants>();
+    constants->ctrlTime = ctrlTime;
+    constants->numActive = numActive;
+    mPostUpdate(mIntegrationBuffer);
+
+    uint32_t const numThreads = msNumXThreads;
+    mExecute(mProgram, (numActive + numThreads - 1) / numThreads, 1, 1);
+
+    particles->GenerateParticles(mCamera);
+    mPostUpdate(particles->GetBillboardBuffer());
+}
+
+std::string const ParticleController::msGLSLCSSource =
+R"(
+    uniform Integration
+    {
+        float ctrlTime;
+        uint numActive;
+    };
+
+    buffer positionSize { vec4 data[]; } positionSizeSB;
+    buffer motion { vec4 data[]; } motionSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i < numActive)
+        {
+            positionSizeSB.data[i] += ctrlTime * motionSB.data[i];
+        }
+    }
+)";
+
+std::string const ParticleController::msHLSLCSSource =
+R"(
+    cbuffer Integration
+    {
+        float ctrlTime;
+        uint numActive;
+    };
+
+    RWStructuredBuffer<float4> positionSize;
+    StructuredBuffer<float4> motion;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i < numActive)
+        {
+            positionSize[i] += ctrlTime * motion[i];
+        }
+    }
+)";
+
+ProgramSources const ParticleController::msCSSource =
+{
+    &msGLSLCSSource,
+    &msHLSLCSSource
+};
@@ -11,6 +11,7 @@
 #include <Graphics/Camera.h>
 #include <Graphics/Controller.h>
 #include <Graphics/Particles.h>
+#include <Graphics/ProgramFactory.h>
 
 namespace gte
 {
@@ -24,6 +25,17 @@ namespace gte
         ParticleController(std::shared_ptr<Camera> const& camera,
             BufferUpdater const& postUpdate);
 
+        // Construction for Particles whose state lives on the GPU.  The
+        // point motion is integrated by a compute program run by 'execute'
+        // and the billboards are generated by a ParticleBillboardEffect, so
+        // the CPU work per update is independent of the number of
+        // particles.  The 'postUpdate' function object copies the motion,
+        // the integration constants and the billboard buffer to the GPU.
+        ParticleController(std::shared_ptr<Camera> const& camera,
+            BufferUpdater const& postUpdate,
+            std::shared_ptr<ProgramFactory> const& factory,
+            ProgramExecutor const& execute);
+
     public:
         // The system motion, in local coordinates.  The velocity vectors
         // must be unit length.
@@ -60,6 +72,14 @@ namespace gte
             return mParticleSizeChange;
         }
 
+        // For particles on the GPU, the particle motion is copied to the GPU
+        // on the first update and on the first update after a call to this
+        // function.  Call it after modifying the particle motion.
+        inline void MotionChanged()
+        {
+            mMotionChanged = true;
+        }
+
         inline void SetCamera(std::shared_ptr<Camera> const& camera)
         {
             mCamera = camera;
@@ -83,8 +103,11 @@ namespace gte
         // motion parameters.  Derived classes should update the motion
         // parameters and then either call the base class update methods or
         // provide its own update methods for position and orientation.
+        // For particles on the GPU, UpdatePointMotion executes the compute
+        // program instead of moving the particles on the CPU.
         virtual void UpdateSystemMotion(float ctrlTime);
         virtual void UpdatePointMotion(float ctrlTime);
+        void UpdatePointMotionGPU(float ctrlTime);
 
         std::vector<float> mParticleLinearSpeed;
         std::vector<Vector3<float>> mParticleLinearAxis;
@@ -92,5 +115,28 @@ namespace gte
 
         std::shared_ptr<Camera> mCamera;
         BufferUpdater mPostUpdate;
+
+        // Particles on the GPU.  The motion of a particle is stored as
+        // (linearSpeed * linearAxis, sizeChange), so the integration of its
+        // (position, size) is a single multiply-add.
+        struct IntegrationConstants
+        {
+            float ctrlTime;
+            uint32_t numActive;
+            uint32_t padding[2];
+        };
+
+        std::shared_ptr<ProgramFactory> mFactory;
+        ProgramExecutor mExecute;
+        std::shared_ptr<ComputeProgram> mProgram;
+        std::shared_ptr<StructuredBuffer> mMotionBuffer;
+        std::shared_ptr<ConstantBuffer> mIntegrationBuffer;
+        bool mMotionChanged;
+
+        // Shader source code as strings.
+        static uint32_t const msNumXThreads = 64;
+        static std::string const msGLSLCSSource;
+        static std::string const msHLSLCSSource;
+        static ProgramSources const msCSSource;
     };
 }
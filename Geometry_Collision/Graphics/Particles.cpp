@@ -9,6 +9,8 @@
 #include <Graphics/Particles.h>
 #include <Mathematics/Logger.h>
 #include <Mathematics/Vector2.h>
+#include <algorithm>
+#include <cmath>
 using namespace gte;
 
 Particles::Particles(std::vector<Vector4<float>> const& positionSize,
@@ -70,6 +72,37 @@ Particles::Particles(std::vector<Vector4<float>> const& positionSize,
     UpdateModelBound();
 }
 
+Particles::Particles(std::vector<Vector4<float>> const& positionSize, float sizeAdjust)
+    :
+    mPositionSize(positionSize),
+    mSizeAdjust(sizeAdjust),
+    mNumActive(static_cast<uint32_t>(positionSize.size()))
+{
+    LogAssert(positionSize.size() > 0, "The particles must exist.");
+
+    uint32_t numParticles = mNumActive;
+    mPositionSizeBuffer = std::make_shared<StructuredBuffer>(numParticles, sizeof(Vector4<float>));
+    mPositionSizeBuffer->SetUsage(Resource::Usage::SHADER_OUTPUT);
+    std::copy(positionSize.begin(), positionSize.end(),
+        mPositionSizeBuffer->Get<Vector4<float>>());
+
+    mBillboardBuffer = std::make_shared<ConstantBuffer>(3 * sizeof(Vector4<float>), true);
+
+    mVBuffer = std::make_shared<VertexBuffer>(6 * numParticles);
+    mIBuffer = std::make_shared<IndexBuffer>(IP_TRIMESH, 2 * numParticles);
+
+    // The bound of the particle centers, enlarged by the largest billboard.
+    float maxSize = 0.0f;
+    for (auto const& posSize : positionSize)
+    {
+        maxSize = std::max(maxSize, std::fabs(posSize[3]));
+    }
+    modelBound.ComputeFromData(numParticles,
+        static_cast<uint32_t>(sizeof(Vector4<float>)),
+        reinterpret_cast<char const*>(positionSize.data()));
+    modelBound.SetRadius(modelBound.GetRadius() + std::sqrt(2.0f) * mSizeAdjust * maxSize);
+}
+
 void Particles::SetSizeAdjust(float sizeAdjust)
 {
     LogAssert(sizeAdjust > 0.0f, "Invalid size-adjust parameter.");
@@ -88,22 +121,40 @@ void Particles::SetNumActive(uint32_t numActive)
         mNumActive = numParticles;
     }
 
-    mVBuffer->SetNumActiveElements(4 * mNumActive);
-    mIBuffer->SetNumActiveElements(6 * mNumActive);
+    if (UsesGPU())
+    {
+        mVBuffer->SetNumActiveElements(6 * mNumActive);
+        mIBuffer->SetNumActivePrimitives(2 * mNumActive);
+    }
+    else
+    {
+        mVBuffer->SetNumActiveElements(4 * mNumActive);
+        mIBuffer->SetNumActiveElements(6 * mNumActive);
+    }
 }
 
 void Particles::GenerateParticles(std::shared_ptr<Camera> const& camera)
 {
-    // Get access to the positions.
-    VertexFormat vformat = mVBuffer->GetFormat();
-    uint32_t vertexSize = vformat.GetVertexSize();
-    char* vertices = mVBuffer->GetData();
-
     // Get camera axis directions in model space of particles.
     Matrix4x4<float> inverse = worldTransform.GetHInverse();
     Vector4<float> UpR = inverse * (camera->GetUVector() + camera->GetRVector());
     Vector4<float> UmR = inverse * (camera->GetUVector() - camera->GetRVector());
 
+    if (UsesGPU())
+    {
+        // The vertex shader generates the quadrilaterals.
+        auto billboard = mBillboardBuffer->Get<Vector4<float>>();
+        billboard[0] = UpR;
+        billboard[1] = UmR;
+        billboard[2] = { mSizeAdjust, 0.0f, 0.0f, 0.0f };
+        return;
+    }
+
+    // Get access to the positions.
+    VertexFormat vformat = mVBuffer->GetFormat();
+    uint32_t vertexSize = vformat.GetVertexSize();
+    char* vertices = mVBuffer->GetData();
+
     // Generate quadrilaterals as pairs of triangles.
     for (uint32_t i = 0; i < mNumActive; ++i)
     {
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/StructuredBuffer.h>
 #include <Graphics/Visual.h>
 #include <cstdint>
 
@@ -35,6 +37,19 @@ namespace gte
         Particles(std::vector<Vector4<float>> const& positionSize, float sizeAdjust,
             VertexFormat const& vformat);
 
+        // Construction for particles whose state lives on the GPU.  The
+        // positionSize elements are copied to a structured buffer with
+        // SHADER_OUTPUT usage, which the compute program of a
+        // ParticleController updates in place.  Each particle is drawn as 6
+        // vertices that a ParticleBillboardEffect expands from the position
+        // and size by vertex identifier, so the vertex buffer has no vertex
+        // data and the index buffer is not indexed.  The model bound is
+        // computed from the initial particles and is not updated, because
+        // the particles are never read back; set modelBound to a bound of
+        // the region that the particles can reach or set the culling mode
+        // to CULL_NEVER.  GetPositionSize() returns the initial particles.
+        Particles(std::vector<Vector4<float>> const& positionSize, float sizeAdjust);
+
         virtual ~Particles() = default;
 
         // Member access.
@@ -53,6 +68,25 @@ namespace gte
             return mPositionSize;
         }
 
+        // Member access for particles on the GPU.  The billboard buffer
+        // stores the camera up+right and up-right vectors in the model space
+        // of the particles and the size adjustment, in this order as
+        // 4-tuples.
+        inline bool UsesGPU() const
+        {
+            return mPositionSizeBuffer != nullptr;
+        }
+
+        inline std::shared_ptr<StructuredBuffer> const& GetPositionSizeBuffer() const
+        {
+            return mPositionSizeBuffer;
+        }
+
+        inline std::shared_ptr<ConstantBuffer> const& GetBillboardBuffer() const
+        {
+            return mBillboardBuffer;
+        }
+
         void SetSizeAdjust(float sizeAdjust);
 
         inline float GetSizeAdjust() const
@@ -74,7 +108,8 @@ namespace gte
         // this function.  Afterwards, it will update the GPU copy of the
         // particles vertex buffer from the CPU copy.  If you call this
         // function explicitly, you are responsible for updating the GPU
-        // copy from the CPU copy.
+        // copy from the CPU copy.  For particles on the GPU, the function
+        // only writes the billboard buffer, which you must then update.
         void GenerateParticles(std::shared_ptr<Camera> const& camera);
 
     protected:
@@ -83,5 +118,9 @@ namespace gte
         std::vector<Vector4<float>> mPositionSize;
         float mSizeAdjust;
         uint32_t mNumActive;
+
+        // Particles on the GPU.
+        std::shared_ptr<StructuredBuffer> mPositionSizeBuffer;
+        std::shared_ptr<ConstantBuffer> mBillboardBuffer;
     };
 }
@@ -8,9 +8,10 @@
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/Picker.h>
 #include <Mathematics/Logger.h>
-#include <Mathematics/IntrLine3Triangle3.h>
 #include <Mathematics/DistLineSegment.h>
 #include <Mathematics/DistPointLine.h>
+#include <algorithm>
+#include <cmath>
 #include <thread>
 using namespace gte;
 
@@ -18,6 +19,10 @@ Picker::Picker(uint32_t numThreads)
     :
     mNumThreads(numThreads > 1 ? numThreads : 1),
     mMaxDistance(0.0f),
+    mTrees{},
+    mTreeThreshold(0),
+    mClosestHitOnly(false),
+    mClosestDistance(0.0f),
     mOrigin{ 0.0f, 0.0f, 0.0f, 1.0f },
     mDirection{ 0.0f, 0.0f, 0.0f, 0.0f },
     mTMin(0.0f),
@@ -35,6 +40,36 @@ float Picker::GetMaxDistance() const
     return mMaxDistance;
 }
 
+void Picker::SetTreeThreshold(uint32_t minTriangles)
+{
+    mTreeThreshold = minTriangles;
+}
+
+uint32_t Picker::GetTreeThreshold() const
+{
+    return mTreeThreshold;
+}
+
+void Picker::InvalidateTree(std::shared_ptr<Visual> const& visual)
+{
+    mTrees.erase(visual.get());
+}
+
+void Picker::InvalidateTrees()
+{
+    mTrees.clear();
+}
+
+void Picker::SetClosestHitOnly(bool closestHitOnly)
+{
+    mClosestHitOnly = closestHitOnly;
+}
+
+bool Picker::GetClosestHitOnly() const
+{
+    return mClosestHitOnly;
+}
+
 void Picker::operator()(std::shared_ptr<Spatial> const& scene,
     Vector4<float> const& origin, Vector4<float> const& direction, float tmin, float tmax)
 {
@@ -57,6 +92,21 @@ void Picker::operator()(std::shared_ptr<Spatial> const& scene,
     mTMax = tmax;
 
     records.clear();
+    mClosestDistance = std::numeric_limits<float>::max();
+
+    // Discard the trees of destroyed visuals.
+    for (auto iter = mTrees.begin(); iter != mTrees.end(); )
+    {
+        if (iter->second.visual.expired())
+        {
+            iter = mTrees.erase(iter);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+
     ExecuteRecursive(scene);
 }
 
@@ -177,6 +227,14 @@ void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
     auto visual = std::dynamic_pointer_cast<Visual>(object);
     if (visual)
     {
+        IndexBuffer* ibuffer = visual->GetIndexBuffer().get();
+        uint32_t primitiveType = ibuffer->GetPrimitiveType();
+        if (mClosestHitOnly && IsFartherThanClosest(visual->worldBound,
+            (primitiveType & IP_HAS_TRIANGLES) ? 0.0f : mMaxDistance))
+        {
+            return;
+        }
+
         if (visual->worldBound.TestIntersection(HProject(mOrigin), HProject(mDirection), mTMin, mTMax))
         {
             // Convert the linear component to model-space coordinates.
@@ -196,7 +254,7 @@ void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
 #endif
             // The world transformation might have non-unit scales, in which case the
             // model-space line direction is not unit length.
-            Normalize(line.direction);
+            float const modelScale = Normalize(line.direction);
 
             // Get the position data.
             VertexBuffer* vbuffer = visual->GetVertexBuffer().get();
@@ -208,11 +266,17 @@ void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
 
             // The picking algorithm depends on the primitive type.
             uint32_t vstride = vbuffer->GetElementSize();
-            IndexBuffer* ibuffer = visual->GetIndexBuffer().get();
-            uint32_t primitiveType = ibuffer->GetPrimitiveType();
             if (primitiveType & IP_HAS_TRIANGLES)
             {
-                PickTriangles(visual, positions, vstride, ibuffer, line);
+                CachedTree const* cached = GetTree(visual, positions, vstride, ibuffer);
+                if (cached)
+                {
+                    PickTriangles(visual, ibuffer, line, *cached, modelScale);
+                }
+                else
+                {
+                    PickTriangles(visual, positions, vstride, ibuffer, line);
+                }
             }
             else if (primitiveType & IP_HAS_SEGMENTS)
             {
@@ -222,6 +286,11 @@ void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
             {
                 PickPoints(visual, positions, vstride, ibuffer, line);
             }
+
+            if (mClosestHitOnly)
+            {
+                KeepClosestRecord();
+            }
         }
         return;
     }
@@ -229,6 +298,11 @@ void Picker::ExecuteRecursive(std::shared_ptr<Spatial> const& object)
     auto node = std::dynamic_pointer_cast<Node>(object);
     if (node)
     {
+        if (mClosestHitOnly && IsFartherThanClosest(node->worldBound, mMaxDistance))
+        {
+            return;
+        }
+
         if (node->worldBound.TestIntersection(HProject(mOrigin), HProject(mDirection), mTMin, mTMax))
         {
             int32_t const numChildren = node->GetNumChildren();
@@ -303,73 +377,302 @@ void Picker::PickTriangles(std::shared_ptr<Visual> const& visual, char const* po
     uint32_t vstride, IndexBuffer* ibuffer, Line3<float> const& line,
     uint32_t i0, uint32_t i1, std::vector<PickRecord>& output) const
 {
-    // Compute intersections with the model-space triangles.
-    bool isIndexed = ibuffer->IsIndexed();
-    IPType primitiveType = ibuffer->GetPrimitiveType();
-    for (uint32_t i = i0; i <= i1; ++i)
+    // Compute intersections with the model-space triangles, copying blocks
+    // of triangles to a batch for the query.
+    uint32_t const blockSize = 256;
+    uint32_t const numTriangles = i1 - i0 + 1;
+    TriangleBatch3<float> batch;
+    batch.Reserve(blockSize);
+    TriangleQuery query;
+    TriangleQuery::Result result;
+    PickRecord record;
+    for (uint32_t block = 0; block < numTriangles; block += blockSize)
     {
-        // Get the vertex indices for the triangle.
-        uint32_t v0, v1, v2;
-        if (isIndexed)
+        uint32_t const numBlock = std::min(blockSize, numTriangles - block);
+        batch.Clear();
+        for (uint32_t j = 0; j < numBlock; ++j)
         {
-            ibuffer->GetTriangle(i, v0, v1, v2);
+            uint32_t v0, v1, v2;
+            GetTriangleVertices(ibuffer, i0 + block + j, v0, v1, v2);
+            batch.Push(
+                *(Vector3<float> const*)(positions + static_cast<size_t>(v0) * vstride),
+                *(Vector3<float> const*)(positions + static_cast<size_t>(v1) * vstride),
+                *(Vector3<float> const*)(positions + static_cast<size_t>(v2) * vstride));
         }
-        else if (primitiveType == IP_TRIMESH)
+
+        result.intersections.clear();
+        query(line, mTMin, mTMax, batch, 0, numBlock, result);
+        for (auto const& intersection : result.intersections)
         {
-            v0 = 3 * i;
-            v1 = v0 + 1;
-            v2 = v0 + 2;
+            uint32_t const i = i0 + block + static_cast<uint32_t>(intersection.triangle);
+            SetTriangleRecord(visual, ibuffer, line, i, intersection, record);
+            output.push_back(record);
         }
-        else  // primitiveType == IP_TRISTRIP
+    }
+}
+
+void Picker::GetTriangleVertices(IndexBuffer const* ibuffer, uint32_t i,
+    uint32_t& v0, uint32_t& v1, uint32_t& v2)
+{
+    if (ibuffer->IsIndexed())
+    {
+        ibuffer->GetTriangle(i, v0, v1, v2);
+    }
+    else if (ibuffer->GetPrimitiveType() == IP_TRIMESH)
+    {
+        v0 = 3 * i;
+        v1 = v0 + 1;
+        v2 = v0 + 2;
+    }
+    else  // primitiveType == IP_TRISTRIP
+    {
+        uint32_t offset = (i & 1);
+        v0 = i + offset;
+        v1 = i + 1 + offset;
+        v2 = i + 2 - offset;
+    }
+}
+
+void Picker::SetTriangleRecord(std::shared_ptr<Visual> const& visual,
+    IndexBuffer const* ibuffer, Line3<float> const& line, uint32_t i,
+    TriangleQuery::Intersection const& intersection, PickRecord& record) const
+{
+    uint32_t v0, v1, v2;
+    GetTriangleVertices(ibuffer, i, v0, v1, v2);
+
+    record.visual = visual;
+    record.primitiveType = ibuffer->GetPrimitiveType();
+    record.primitiveIndex = i;
+    record.vertexIndex[0] = static_cast<int32_t>(v0);
+    record.vertexIndex[1] = static_cast<int32_t>(v1);
+    record.vertexIndex[2] = static_cast<int32_t>(v2);
+    record.t = intersection.parameter;
+    record.bary[0] = intersection.triangleBary[0];
+    record.bary[1] = intersection.triangleBary[1];
+    record.bary[2] = intersection.triangleBary[2];
+    record.linePoint = HLift(line.origin + intersection.parameter * line.direction, 1.0f);
+
+#if defined (GTE_USE_MAT_VEC)
+    record.linePoint = visual->worldTransform * record.linePoint;
+#else
+    record.linePoint = record.linePoint * visual->worldTransform;
+#endif
+    record.primitivePoint = record.linePoint;
+
+    record.distanceToLinePoint =
+        Length(record.linePoint - mOrigin);
+    record.distanceToPrimitivePoint =
+        Length(record.primitivePoint - mOrigin);
+    record.distanceBetweenLinePrimitive =
+        Length(record.linePoint - record.primitivePoint);
+}
+
+Picker::CachedTree const* Picker::GetTree(std::shared_ptr<Visual> const& visual,
+    char const* positions, uint32_t vstride, IndexBuffer* ibuffer)
+{
+    if (mTreeThreshold == 0 ||
+        ibuffer->GetPrimitiveType() != IP_TRIMESH ||
+        !ibuffer->IsIndexed() ||
+        ibuffer->GetNumPrimitives() < mTreeThreshold ||
+        ibuffer->GetFirstPrimitive() != 0 ||
+        ibuffer->GetNumActivePrimitives() != ibuffer->GetNumPrimitives())
+    {
+        return nullptr;
+    }
+
+    // CollisionMesh requires the positions to be the first attribute.
+    VASemantic semantic{};
+    DFType type{};
+    uint32_t unit{}, offset{};
+    visual->GetVertexBuffer()->GetFormat().GetAttribute(0, semantic, type, unit, offset);
+    if (semantic != VASemantic::POSITION || unit != 0 || offset != 0)
+    {
+        return nullptr;
+    }
+
+    auto iter = mTrees.find(visual.get());
+    if (iter != mTrees.end() && iter->second.visual.lock() == visual)
+    {
+        return &iter->second;
+    }
+
+    // The surface-area heuristic gives tighter bounds than the median split
+    // for meshes with triangles of nonuniform size, which is typical of CAD
+    // meshes.  A leaf has as many triangles as the batch query tests in
+    // one AVX iteration.
+    int32_t const maxTrisPerLeaf = 8;
+    auto mesh = std::make_shared<CollisionMesh>(visual);
+    CachedTree& cached = mTrees[visual.get()];
+    cached.visual = visual;
+    cached.tree = std::make_unique<PickTree>(mesh, maxTrisPerLeaf, false,
+        PickTree::BuildMethod::BINNED_SAH, static_cast<size_t>(mNumThreads - 1));
+
+    std::vector<int32_t> const& triangles = cached.tree->GetTriangles();
+    cached.triangles.Clear();
+    cached.triangles.Reserve(triangles.size());
+    for (auto t : triangles)
+    {
+        uint32_t v0, v1, v2;
+        GetTriangleVertices(ibuffer, static_cast<uint32_t>(t), v0, v1, v2);
+        cached.triangles.Push(
+            *(Vector3<float> const*)(positions + static_cast<size_t>(v0) * vstride),
+            *(Vector3<float> const*)(positions + static_cast<size_t>(v1) * vstride),
+            *(Vector3<float> const*)(positions + static_cast<size_t>(v2) * vstride));
+    }
+    return &cached;
+}
+
+void Picker::PickTriangles(std::shared_ptr<Visual> const& visual, IndexBuffer* ibuffer,
+    Line3<float> const& line, CachedTree const& cached, float modelScale)
+{
+    PickTree const& tree = *cached.tree;
+    std::vector<int32_t> const& treeTriangles = tree.GetTriangles();
+    TriangleQuery query;
+    TriangleQuery::Result result;
+
+    // Traverse the tree with a stack of nodes and the nearest parameters of
+    // their bounds.  The child whose bound is nearer to the origin is
+    // visited first, so for closest-hit-only picking the closest triangle
+    // tends to be found early and the remaining nodes are skipped.
+    std::vector<std::pair<size_t, float>> stack;
+    float tNearest = 0.0f;
+    BoundingSphere<float> const& rootBound = tree.GetModelBound(0);
+    if (!GetNearestParameter(rootBound.GetCenter(), rootBound.GetRadius(),
+        line.origin, line.direction, tNearest))
+    {
+        return;
+    }
+    stack.push_back(std::make_pair(static_cast<size_t>(0), tNearest));
+
+    PickRecord record;
+    while (stack.size() > 0)
+    {
+        size_t const i = stack.back().first;
+        float const tNode = stack.back().second;
+        stack.pop_back();
+        if (mClosestHitOnly && tNode > mClosestDistance * modelScale)
         {
-            uint32_t offset = (i & 1);
-            v0 = i + offset;
-            v1 = i + 1 + offset;
-            v2 = i + 2 - offset;
+            continue;
         }
 
-        // Get the vertex positions.
-        Vector3<float> const& p0 = *(Vector3<float> const*)(positions + static_cast<size_t>(v0) * vstride);
-        Vector3<float> const& p1 = *(Vector3<float> const*)(positions + static_cast<size_t>(v1) * vstride);
-        Vector3<float> const& p2 = *(Vector3<float> const*)(positions + static_cast<size_t>(v2) * vstride);
+        if (tree.IsLeafNode(i))
+        {
+            result.intersections.clear();
+            query(line, mTMin, mTMax, cached.triangles, tree.GetFirstTriangle(i),
+                static_cast<size_t>(tree.GetNumTriangles(i)), result);
+            for (auto const& intersection : result.intersections)
+            {
+                uint32_t const triangle = static_cast<uint32_t>(treeTriangles[intersection.triangle]);
+                SetTriangleRecord(visual, ibuffer, line, triangle, intersection, record);
+                if (mClosestHitOnly)
+                {
+                    if (record.distanceToLinePoint < mClosestDistance)
+                    {
+                        mClosestDistance = record.distanceToLinePoint;
+                        records.push_back(record);
+                    }
+                }
+                else
+                {
+                    records.push_back(record);
+                }
+            }
+            continue;
+        }
 
-        // Create the query triangle in model space.
-        Triangle3<float> triangle(p0, p1, p2);
+        std::array<std::pair<size_t, float>, 2> children{};
+        size_t numChildren = 0;
+        for (auto c : { tree.GetLChild(i), tree.GetRChild(i) })
+        {
+            BoundingSphere<float> const& bound = tree.GetModelBound(c);
+            if (GetNearestParameter(bound.GetCenter(), bound.GetRadius(),
+                line.origin, line.direction, tNearest))
+            {
+                children[numChildren++] = std::make_pair(c, tNearest);
+            }
+        }
 
-        // Compute line-triangle intersection.
-        FIQuery<float, Line3<float>, Triangle3<float>> query;
-        auto result = query(line, triangle);
-        if (result.intersect && mTMin <= result.parameter && result.parameter <= mTMax)
+        // Push the farther child first so that the nearer one is popped
+        // first.
+        if (numChildren == 2 && children[0].second < children[1].second)
         {
-            PickRecord record;
-            record.visual = visual;
-            record.primitiveType = primitiveType;
-            record.primitiveIndex = i;
-            record.vertexIndex[0] = static_cast<int32_t>(v0);
-            record.vertexIndex[1] = static_cast<int32_t>(v1);
-            record.vertexIndex[2] = static_cast<int32_t>(v2);
-            record.t = result.parameter;
-            record.bary[0] = result.triangleBary[0];
-            record.bary[1] = result.triangleBary[1];
-            record.bary[2] = result.triangleBary[2];
-            record.linePoint = HLift(result.point, 1.0f);
+            std::swap(children[0], children[1]);
+        }
+        for (size_t k = 0; k < numChildren; ++k)
+        {
+            stack.push_back(children[k]);
+        }
+    }
+}
 
-#if defined (GTE_USE_MAT_VEC)
-            record.linePoint = visual->worldTransform * record.linePoint;
-#else
-            record.linePoint = record.linePoint * visual->worldTransform;
-#endif
-            record.primitivePoint = record.linePoint;
+bool Picker::GetNearestParameter(Vector3<float> const& center, float radius,
+    Vector3<float> const& origin, Vector3<float> const& direction,
+    float& tNearest) const
+{
+    // Solve |origin + t * direction - center| = radius for the unit-length
+    // direction.
+    Vector3<float> diff = origin - center;
+    float a1 = Dot(direction, diff);
+    float a0 = Dot(diff, diff) - radius * radius;
+    float discr = a1 * a1 - a0;
+    if (discr < 0.0f)
+    {
+        return false;
+    }
 
-            record.distanceToLinePoint =
-                Length(record.linePoint - mOrigin);
-            record.distanceToPrimitivePoint =
-                Length(record.primitivePoint - mOrigin);
-            record.distanceBetweenLinePrimitive =
-                Length(record.linePoint - record.primitivePoint);
+    float root = std::sqrt(discr);
+    float t0 = std::max(-a1 - root, mTMin);
+    float t1 = std::min(-a1 + root, mTMax);
+    if (t0 > t1)
+    {
+        return false;
+    }
 
-            output.push_back(record);
+    tNearest = (t0 > 0.0f ? t0 : (t1 < 0.0f ? -t1 : 0.0f));
+    return true;
+}
+
+bool Picker::IsFartherThanClosest(BoundingSphere<float> const& worldBound,
+    float inflation) const
+{
+    if (mClosestDistance == std::numeric_limits<float>::max() ||
+        worldBound.GetRadius() == 0.0f)
+    {
+        return false;
+    }
+
+    float tNearest = 0.0f;
+    if (GetNearestParameter(worldBound.GetCenter(), worldBound.GetRadius() + inflation,
+        HProject(mOrigin), HProject(mDirection), tNearest))
+    {
+        return tNearest > mClosestDistance;
+    }
+    return true;
+}
+
+void Picker::KeepClosestRecord()
+{
+    // The records of the previously picked visuals have been reduced to at
+    // most one, so this is the closest record of all visuals so far.
+    size_t closest = records.size();
+    float closestDistance = std::numeric_limits<float>::max();
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        if (records[i].distanceToLinePoint < closestDistance)
+        {
+            closestDistance = records[i].distanceToLinePoint;
+            closest = i;
+        }
+    }
+
+    if (closest < records.size())
+    {
+        if (closest > 0)
+        {
+            records[0] = records[closest];
         }
+        records.resize(1);
+        mClosestDistance = closestDistance;
     }
 }
 
@@ -8,10 +8,16 @@
 #pragma once
 
 #include <Graphics/PickRecord.h>
+#include <Graphics/BoundingSphere.h>
+#include <Graphics/BoundTree.h>
+#include <Graphics/CollisionMesh.h>
 #include <Graphics/Node.h>
 #include <Graphics/Visual.h>
+#include <Mathematics/IntrLine3TriangleBatch3.h>
 #include <Mathematics/Line.h>
 #include <cstdint>
+#include <map>
+#include <memory>
 
 namespace gte
 {
@@ -30,6 +36,29 @@ namespace gte
         void SetMaxDistance(float maxDistance);
         float GetMaxDistance() const;
 
+        // Support for large triangle meshes.  A visual whose index buffer
+        // has primitive type IP_TRIMESH, all of whose primitives are
+        // active and which has at least 'minTriangles' triangles is picked
+        // through a bounding-sphere hierarchy of its model-space triangles
+        // (a BoundTree).  The tree is built the first time the visual is
+        // picked and is cached by the picker until the visual is destroyed.
+        // The cached tree does not see changes to the vertices; call
+        // InvalidateTree after modifying them.  The default threshold is 0,
+        // which disables the trees.
+        void SetTreeThreshold(uint32_t minTriangles);
+        uint32_t GetTreeThreshold() const;
+        void InvalidateTree(std::shared_ptr<Visual> const& visual);
+        void InvalidateTrees();
+
+        // When closest-hit-only is enabled, 'records' has at most one
+        // element after a pick, the one GetClosestToZero() would return.
+        // Nodes, visuals and tree nodes whose bounds are farther from the
+        // origin of the linear component than the closest record found so
+        // far are skipped.  For point and segment primitives the bounds are
+        // enlarged by the maximum distance.  The default is 'false'.
+        void SetClosestHitOnly(bool closestHitOnly);
+        bool GetClosestHitOnly() const;
+
         // The linear component is parameterized by P + t*D, where P is a
         // point on the component (the origin) and D is a unit-length
         // direction vector.  Both P and D must be in world coordinates.
@@ -71,6 +100,49 @@ namespace gte
             uint32_t vstride, IndexBuffer* ibuffer, Line3<float> const& line,
             uint32_t i0, uint32_t i1, std::vector<PickRecord>& output) const;
 
+        // The triangles are tested in batches by a query whose loops the
+        // compiler vectorizes.
+        typedef FIQuery<float, Line3<float>, TriangleBatch3<float>> TriangleQuery;
+
+        static void GetTriangleVertices(IndexBuffer const* ibuffer, uint32_t i,
+            uint32_t& v0, uint32_t& v1, uint32_t& v2);
+
+        void SetTriangleRecord(std::shared_ptr<Visual> const& visual,
+            IndexBuffer const* ibuffer, Line3<float> const& line, uint32_t i,
+            TriangleQuery::Intersection const& intersection, PickRecord& record) const;
+
+        // Support for picking through a BoundTree.  The model-space line
+        // direction is normalized, so a world distance d along the line is
+        // the model-space distance d * modelScale.  The triangles are copied
+        // into a batch in the order of tree.GetTriangles(), so the triangles
+        // of a leaf are contiguous in the batch.
+        typedef BoundTree<CollisionMesh, BoundingSphere<float>> PickTree;
+
+        struct CachedTree
+        {
+            std::weak_ptr<Visual> visual;
+            std::unique_ptr<PickTree> tree;
+            TriangleBatch3<float> triangles;
+        };
+
+        CachedTree const* GetTree(std::shared_ptr<Visual> const& visual,
+            char const* positions, uint32_t vstride, IndexBuffer* ibuffer);
+
+        void PickTriangles(std::shared_ptr<Visual> const& visual, IndexBuffer* ibuffer,
+            Line3<float> const& line, CachedTree const& cached, float modelScale);
+
+        // Support for closest-hit-only picking.  The function computes the
+        // smallest |t| for the points P + t * D of the sphere with t in
+        // [mTMin,mTMax].  It returns 'false' when there are no such points.
+        bool GetNearestParameter(Vector3<float> const& center, float radius,
+            Vector3<float> const& origin, Vector3<float> const& direction,
+            float& tNearest) const;
+
+        bool IsFartherThanClosest(BoundingSphere<float> const& worldBound,
+            float inflation) const;
+
+        void KeepClosestRecord();
+
         void PickSegments(std::shared_ptr<Visual> const& visual, char const* positions,
             uint32_t vstride, IndexBuffer* ibuffer, Line3<float> const& line);
 
@@ -85,6 +157,16 @@ namespace gte
         // segment primitives.
         float mMaxDistance;
 
+        // The trees are keyed by visual.  The weak pointer detects a
+        // destroyed visual whose address has been reused.
+        std::map<Visual const*, CachedTree> mTrees;
+        uint32_t mTreeThreshold;
+
+        // The distanceToLinePoint of the closest record when mClosestHitOnly
+        // is 'true'.
+        bool mClosestHitOnly;
+        float mClosestDistance;
+
         // The parameters for the linear component used to pick.
         Vector4<float> mOrigin;
         Vector4<float> mDirection;
@@ -7,6 +7,7 @@
 
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/PlanarShadowEffect.h>
+#include <algorithm>
 using namespace gte;
 
 PlanarShadowEffect::PlanarShadowEffect(
@@ -24,9 +25,17 @@ PlanarShadowEffect::PlanarShadowEffect(
     mCasterEffects{},
     mSaveVisualEffects{},
     mModelSpaceTriangles{planeVisuals.size()},
+    mModelSpaceBoxes{planeVisuals.size()},
     mShadowBlend{},
     mDSPass0{},
     mDSPass1{},
+    mInstancedEffect{},
+    mProjectionView{},
+    mCasterWorld{},
+    mPlaneData{},
+    mInstancedVisuals{},
+    mDSInstanced{},
+    mRSInstanced{},
     mAPI(factory->GetAPI())
 {
     // Recursively traverse the shadow caster hierarchy and gather all the
@@ -94,6 +103,59 @@ PlanarShadowEffect::PlanarShadowEffect(
     mDSPass1->backFace.depthFail = DepthStencilState::Operation::OP_KEEP;
     mDSPass1->backFace.pass = DepthStencilState::Operation::OP_ZERO;
     mDSPass1->backFace.comparison = DepthStencilState::Comparison::EQUAL;
+
+    // Support for DrawInstanced. The depth is read but not written. The
+    // stencil comparison is NOT_EQUAL with reference 0 so that shadows are
+    // drawn only on visible plane pixels, and the face.pass value is ZERO so
+    // that a pixel is blended at most once.
+    mDSInstanced = std::make_shared<DepthStencilState>();
+    mDSInstanced->depthEnable = true;
+    mDSInstanced->writeMask = DepthStencilState::WriteMask::ZERO;
+    mDSInstanced->comparison = DepthStencilState::Comparison::LESS_EQUAL;
+    mDSInstanced->stencilEnable = true;
+    mDSInstanced->stencilReadMask = 0xFF;
+    mDSInstanced->stencilWriteMask = 0xFF;
+    mDSInstanced->frontFace.fail = DepthStencilState::Operation::OP_KEEP;
+    mDSInstanced->frontFace.depthFail = DepthStencilState::Operation::OP_KEEP;
+    mDSInstanced->frontFace.pass = DepthStencilState::Operation::OP_ZERO;
+    mDSInstanced->frontFace.comparison = DepthStencilState::Comparison::NOT_EQUAL;
+    mDSInstanced->backFace.fail = DepthStencilState::Operation::OP_KEEP;
+    mDSInstanced->backFace.depthFail = DepthStencilState::Operation::OP_KEEP;
+    mDSInstanced->backFace.pass = DepthStencilState::Operation::OP_ZERO;
+    mDSInstanced->backFace.comparison = DepthStencilState::Comparison::NOT_EQUAL;
+    mDSInstanced->reference = 0;
+
+    // The projection can reverse the orientation of the caster triangles,
+    // so there is no culling. The depth bias moves the shadows in front of
+    // their planes.
+    mRSInstanced = std::make_shared<RasterizerState>();
+    mRSInstanced->cull = RasterizerState::Cull::NONE;
+    mRSInstanced->depthBias = -2;
+    mRSInstanced->slopeScaledDepthBias = -1.0f;
+
+    int32_t api = factory->GetAPI();
+    auto program = factory->CreateFromSources(*msVSSource[api], *msPSSource[api], "");
+    LogAssert(program != nullptr, "Failed to compile shader programs.");
+
+    mProjectionView = std::make_shared<ConstantBuffer>(sizeof(Matrix4x4<float>), true);
+    mCasterWorld = std::make_shared<ConstantBuffer>(sizeof(Matrix4x4<float>), true);
+    mPlaneData = std::make_shared<StructuredBuffer>(
+        static_cast<uint32_t>(std::max(mPlaneVisuals.size(), static_cast<size_t>(1))),
+        static_cast<uint32_t>(sizeof(PlaneData)));
+    mPlaneData->SetUsage(Resource::Usage::STREAMING);
+    program->GetVertexShader()->Set("ProjectionView", mProjectionView);
+    program->GetVertexShader()->Set("CasterWorld", mCasterWorld);
+    program->GetVertexShader()->Set("planeData", mPlaneData);
+    program->GetPixelShader()->Set("planeData", mPlaneData);
+    mInstancedEffect = std::make_shared<VisualEffect>(program);
+
+    mInstancedVisuals.resize(mCasterVisuals.size());
+    for (size_t j = 0; j < mCasterVisuals.size(); ++j)
+    {
+        auto const& caster = mCasterVisuals[j];
+        mInstancedVisuals[j] = std::make_shared<Visual>(caster->GetVertexBuffer(),
+            caster->GetIndexBuffer(), mInstancedEffect);
+    }
 }
 
 void PlanarShadowEffect::Draw(std::shared_ptr<GraphicsEngine> const& engine,
@@ -200,6 +262,77 @@ void PlanarShadowEffect::Draw(std::shared_ptr<GraphicsEngine> const& engine,
     engine->SetDepthStencilState(saveDSState);
 }
 
+void PlanarShadowEffect::DrawInstanced(std::shared_ptr<GraphicsEngine> const& engine,
+    std::shared_ptr<Camera> const& camera)
+{
+    // Save the global state, to be restored later.
+    std::shared_ptr<BlendState> saveBState = engine->GetBlendState();
+    std::shared_ptr<DepthStencilState> saveDSState = engine->GetDepthStencilState();
+    std::shared_ptr<RasterizerState> saveRState = engine->GetRasterizerState();
+
+    // Draw the the shadow caster.
+    engine->Draw(mCasterVisuals);
+
+    // Draw the planes, each setting the stencil values of its visible
+    // pixels to i+1, and gather the data of the planes that receive
+    // shadows.
+    auto planeData = mPlaneData->Get<PlaneData>();
+    uint32_t numInstances = 0;
+    engine->SetBlendState(saveBState);
+    for (size_t i = 0; i < mPlaneVisuals.size(); ++i)
+    {
+        auto const& plane = mPlaneVisuals[i];
+        mDSPass0->reference = static_cast<uint32_t>(i + 1);
+        engine->SetDepthStencilState(mDSPass0);
+        engine->Draw(plane);
+
+        Matrix4x4<float> projectionMatrix{};
+        if (GetProjectionMatrix(i, projectionMatrix))
+        {
+            PlaneData& data = planeData[numInstances++];
+            data.shadowMatrix = projectionMatrix;
+            data.planeInverseWorld = plane->worldTransform.GetHInverse();
+            data.color = mShadowColors[i];
+            data.boxMin = mModelSpaceBoxes[i][0];
+            data.boxMax = mModelSpaceBoxes[i][1];
+        }
+    }
+
+    if (numInstances > 0)
+    {
+        mPlaneData->SetNumActiveElements(numInstances);
+        engine->Update(mPlaneData);
+        *mProjectionView->Get<Matrix4x4<float>>() = camera->GetProjectionViewMatrix();
+        engine->Update(mProjectionView);
+
+        engine->SetDepthStencilState(mDSInstanced);
+        engine->SetBlendState(mShadowBlend);
+        engine->SetRasterizerState(mRSInstanced);
+        for (size_t j = 0; j < mCasterVisuals.size(); ++j)
+        {
+            *mCasterWorld->Get<Matrix4x4<float>>() = mCasterVisuals[j]->worldTransform;
+            engine->Update(mCasterWorld);
+
+            // The index buffer is shared with the caster visual, so its
+            // number of instances is restored after the draw.
+            auto const& ibuffer = mInstancedVisuals[j]->GetIndexBuffer();
+            uint32_t const saveNumInstances = ibuffer->GetNumInstances();
+            ibuffer->SetNumInstances(numInstances);
+            engine->Draw(mInstancedVisuals[j]);
+            ibuffer->SetNumInstances(saveNumInstances);
+        }
+    }
+
+    // Remove the plane values from the stencil buffer for the drawing that
+    // follows. One clear replaces the per-plane clears of Draw for GL45.
+    engine->ClearStencilBuffer();
+
+    // Restore the global state that existed before this function call.
+    engine->SetBlendState(saveBState);
+    engine->SetDepthStencilState(saveDSState);
+    engine->SetRasterizerState(saveRState);
+}
+
 void PlanarShadowEffect::GatherVisuals(
     std::shared_ptr<ProgramFactory> const& factory,
     std::shared_ptr<Spatial> const& spatial)
@@ -272,6 +405,26 @@ void PlanarShadowEffect::GetModelSpaceTriangles()
             triangle[j] = HLift(*vertices, 1.0f);
         }
 
+        // Compute the model-space bounding box of the plane for
+        // DrawInstanced, enlarged by a small fraction of its diagonal.
+        uint32_t const numVertices = vbuffer->GetNumElements();
+        Vector3<float> boxMin = *reinterpret_cast<Vector3<float> const*>(rawData);
+        Vector3<float> boxMax = boxMin;
+        for (uint32_t k = 1; k < numVertices; ++k)
+        {
+            auto const& position = *reinterpret_cast<Vector3<float> const*>(
+                rawData + k * stride);
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                boxMin[d] = std::min(boxMin[d], position[d]);
+                boxMax[d] = std::max(boxMax[d], position[d]);
+            }
+        }
+        float const epsilon = 1e-3f * Length(boxMax - boxMin);
+        Vector3<float> const expand{ epsilon, epsilon, epsilon };
+        mModelSpaceBoxes[i][0] = HLift(boxMin - expand, 1.0f);
+        mModelSpaceBoxes[i][1] = HLift(boxMax + expand, 1.0f);
+
         // The planar shadow effect is responsible for drawing the planes.
         visual->culling = CullingMode::ALWAYS;
     }
@@ -333,3 +486,176 @@ bool PlanarShadowEffect::GetProjectionMatrix(size_t i, Matrix4x4<float>& project
 
     return true;
 }
+
+std::string const PlanarShadowEffect::msGLSLVSSource =
+R"(
+    uniform ProjectionView
+    {
+        mat4 pvMatrix;
+    };
+
+    uniform CasterWorld
+    {
+        mat4 casterWorld;
+    };
+
+    struct PlaneData
+    {
+        mat4 shadowMatrix;
+        mat4 planeInverseWorld;
+        vec4 color, boxMin, boxMax;
+    };
+
+    buffer planeData { PlaneData data[]; } planeDataSB;
+
+    layout(location = 0) in vec3 modelPosition;
+    layout(location = 0) out vec3 planePosition;
+    layout(location = 1) flat out int planeIndex;
+
+    void main()
+    {
+        PlaneData plane = planeDataSB.data[gl_InstanceID];
+    #if GTE_USE_MAT_VEC
+        vec4 shadowPosition = plane.shadowMatrix * (casterWorld * vec4(modelPosition, 1.0f));
+        shadowPosition /= shadowPosition.w;
+        planePosition = (plane.planeInverseWorld * shadowPosition).xyz;
+        gl_Position = pvMatrix * shadowPosition;
+    #else
+        vec4 shadowPosition = (vec4(modelPosition, 1.0f) * casterWorld) * plane.shadowMatrix;
+        shadowPosition /= shadowPosition.w;
+        planePosition = (shadowPosition * plane.planeInverseWorld).xyz;
+        gl_Position = shadowPosition * pvMatrix;
+    #endif
+        planeIndex = gl_InstanceID;
+    }
+)";
+
+std::string const PlanarShadowEffect::msGLSLPSSource =
+R"(
+    struct PlaneData
+    {
+        mat4 shadowMatrix;
+        mat4 planeInverseWorld;
+        vec4 color, boxMin, boxMax;
+    };
+
+    buffer planeData { PlaneData data[]; } planeDataSB;
+
+    layout(location = 0) in vec3 planePosition;
+    layout(location = 1) flat in int planeIndex;
+    layout(location = 0) out vec4 pixelColor;
+
+    void main()
+    {
+        PlaneData plane = planeDataSB.data[planeIndex];
+        if (any(lessThan(planePosition, plane.boxMin.xyz)) ||
+            any(greaterThan(planePosition, plane.boxMax.xyz)))
+        {
+            discard;
+        }
+        pixelColor = plane.color;
+    }
+)";
+
+std::string const PlanarShadowEffect::msHLSLVSSource =
+R"(
+    cbuffer ProjectionView
+    {
+        float4x4 pvMatrix;
+    };
+
+    cbuffer CasterWorld
+    {
+        float4x4 casterWorld;
+    };
+
+    struct PlaneData
+    {
+        float4x4 shadowMatrix;
+        float4x4 planeInverseWorld;
+        float4 color, boxMin, boxMax;
+    };
+
+    StructuredBuffer<PlaneData> planeData;
+
+    struct VS_INPUT
+    {
+        float3 modelPosition : POSITION;
+        uint instance : SV_InstanceID;
+    };
+
+    struct VS_OUTPUT
+    {
+        float3 planePosition : TEXCOORD0;
+        nointerpolation uint planeIndex : TEXCOORD1;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    VS_OUTPUT VSMain(VS_INPUT input)
+    {
+        VS_OUTPUT output;
+        PlaneData plane = planeData[input.instance];
+    #if GTE_USE_MAT_VEC
+        float4 shadowPosition = mul(plane.shadowMatrix, mul(casterWorld, float4(input.modelPosition, 1.0f)));
+        shadowPosition /= shadowPosition.w;
+        output.planePosition = mul(plane.planeInverseWorld, shadowPosition).xyz;
+        output.clipPosition = mul(pvMatrix, shadowPosition);
+    #else
+        float4 shadowPosition = mul(mul(float4(input.modelPosition, 1.0f), casterWorld), plane.shadowMatrix);
+        shadowPosition /= shadowPosition.w;
+        output.planePosition = mul(shadowPosition, plane.planeInverseWorld).xyz;
+        output.clipPosition = mul(shadowPosition, pvMatrix);
+    #endif
+        output.planeIndex = input.instance;
+        return output;
+    }
+)";
+
+std::string const PlanarShadowEffect::msHLSLPSSource =
+R"(
+    struct PlaneData
+    {
+        float4x4 shadowMatrix;
+        float4x4 planeInverseWorld;
+        float4 color, boxMin, boxMax;
+    };
+
+    StructuredBuffer<PlaneData> planeData;
+
+    struct PS_INPUT
+    {
+        float3 planePosition : TEXCOORD0;
+        nointerpolation uint planeIndex : TEXCOORD1;
+    };
+
+    struct PS_OUTPUT
+    {
+        float4 pixelColor : SV_TARGET0;
+    };
+
+    PS_OUTPUT PSMain(PS_INPUT input)
+    {
+        PlaneData plane = planeData[input.planeIndex];
+        if (any(input.planePosition < plane.boxMin.xyz) ||
+            any(input.planePosition > plane.boxMax.xyz))
+        {
+            discard;
+        }
+
+        PS_OUTPUT output;
+        output.pixelColor = plane.color;
+        return output;
+    }
+)";
+
+ProgramSources const PlanarShadowEffect::msVSSource =
+{
+    &msGLSLVSSource,
+    &msHLSLVSSource
+};
+
+ProgramSources const PlanarShadowEffect::msPSSource =
+{
+    &msGLSLPSSource,
+    &msHLSLPSSource
+};
@@ -12,6 +12,7 @@
 #include <Graphics/Node.h>
 #include <Graphics/ProgramFactory.h>
 #include <Graphics/PVWUpdater.h>
+#include <Graphics/StructuredBuffer.h>
 #include <Graphics/Visual.h>
 #include <cstdint>
 
@@ -57,6 +58,24 @@ namespace gte
         void Draw(std::shared_ptr<GraphicsEngine> const& engine,
             PVWUpdater& pvwMatrices);
 
+        // Draw the shadows on all planes with one instanced draw per caster
+        // Visual, instance k projecting the caster onto the k-th plane that
+        // receives a shadow. The planes are drawn first, each writing its
+        // stencil value i+1 at its visible pixels. The per-instance shadow
+        // matrices and colors are in a structured buffer. An instance draws
+        // only at pixels with a nonzero stencil value whose depth is that of
+        // its plane (the shadows are drawn with a depth bias toward the
+        // camera), and its pixel shader discards the pixels outside the
+        // model-space bounding box of its plane, so a shadow is clipped to
+        // its plane as in Draw when the planes are rectangles; for other
+        // plane shapes, a shadow might be drawn on a visible plane where the
+        // box of its own plane is in front of that plane. The stencil
+        // buffer is cleared at the end. The caster effects are not swapped
+        // and the PVW matrices are not updated, so the cost per plane is the
+        // drawing of its pixels.
+        void DrawInstanced(std::shared_ptr<GraphicsEngine> const& engine,
+            std::shared_ptr<Camera> const& camera);
+
     protected:
         void GatherVisuals(std::shared_ptr<ProgramFactory> const& factory,
             std::shared_ptr<Spatial> const& spatial);
@@ -82,10 +101,39 @@ namespace gte
         // light.
         std::vector<std::array<Vector4<float>, 3>> mModelSpaceTriangles;
 
+        // Model-space bounding boxes of the planes, enlarged slightly so
+        // that points on a plane are inside its box despite rounding errors.
+        std::vector<std::array<Vector4<float>, 2>> mModelSpaceBoxes;
+
         // Global state for the drawing passes.
         std::shared_ptr<BlendState> mShadowBlend;
         std::shared_ptr<DepthStencilState> mDSPass0, mDSPass1;
 
+        // Support for DrawInstanced. The per-instance data of the planes
+        // that receive shadows is in mPlaneData. The instanced visuals
+        // share the vertex and index buffers of the caster visuals and one
+        // effect, whose caster world matrix is updated before each draw.
+        struct PlaneData
+        {
+            Matrix4x4<float> shadowMatrix;
+            Matrix4x4<float> planeInverseWorld;
+            Vector4<float> color, boxMin, boxMax;
+        };
+
+        std::shared_ptr<VisualEffect> mInstancedEffect;
+        std::shared_ptr<ConstantBuffer> mProjectionView, mCasterWorld;
+        std::shared_ptr<StructuredBuffer> mPlaneData;
+        std::vector<std::shared_ptr<Visual>> mInstancedVisuals;
+        std::shared_ptr<DepthStencilState> mDSInstanced;
+        std::shared_ptr<RasterizerState> mRSInstanced;
+
+        static std::string const msGLSLVSSource;
+        static std::string const msGLSLPSSource;
+        static std::string const msHLSLVSSource;
+        static std::string const msHLSLPSSource;
+        static ProgramSources const msVSSource;
+        static ProgramSources const msPSSource;
+
         // TODO: The stencil buffer reference values for the planes during
         // the mDSPass1 drawing are not being set to zero in the GL45
         // version of this sample. This leads to shadowed pixels that should
@@ -0,0 +1,118 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/ProgramCache.h>
+#include <cstdio>
+#include <fstream>
+using namespace gte;
+
+ProgramCache::ProgramCache(std::string const& directory)
+    :
+    mDirectory(directory)
+{
+}
+
+uint64_t ProgramCache::GetHash(void const* data, size_t numBytes, uint64_t hash)
+{
+    auto const* bytes = static_cast<uint8_t const*>(data);
+    for (size_t i = 0; i < numBytes; ++i)
+    {
+        hash ^= static_cast<uint64_t>(bytes[i]);
+        hash *= 0x00000100000001B3ull;
+    }
+    return hash;
+}
+
+uint64_t ProgramCache::GetHash(std::string const& text, uint64_t hash)
+{
+    uint64_t const length = static_cast<uint64_t>(text.size());
+    hash = GetHash(&length, sizeof(length), hash);
+    return GetHash(text.data(), text.size(), hash);
+}
+
+std::string ProgramCache::GetFilename(uint64_t key) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.gtprogram",
+        static_cast<unsigned long long>(key));
+    return mDirectory + "/" + name;
+}
+
+bool ProgramCache::Load(uint64_t key, std::vector<uint8_t>& data) const
+{
+    std::ifstream input(GetFilename(key), std::ios::in | std::ios::binary);
+    if (!input)
+    {
+        return false;
+    }
+
+    Header header{};
+    input.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!input || header.magic != magic || header.version != version
+        || header.key != key)
+    {
+        return false;
+    }
+
+    // Compare the size to that of the file before allocating, in case the
+    // header is corrupt.
+    std::streamoff const dataOffset = static_cast<std::streamoff>(sizeof(header));
+    input.seekg(0, std::ios::end);
+    uint64_t const numFileBytes = static_cast<uint64_t>(input.tellg() - dataOffset);
+    if (header.numBytes != numFileBytes)
+    {
+        return false;
+    }
+    input.seekg(dataOffset, std::ios::beg);
+
+    data.resize(static_cast<size_t>(header.numBytes));
+    input.read(reinterpret_cast<char*>(data.data()),
+        static_cast<std::streamsize>(data.size()));
+    if (!input || GetHash(data.data(), data.size()) != header.checksum)
+    {
+        data.clear();
+        return false;
+    }
+    return true;
+}
+
+bool ProgramCache::Save(uint64_t key, void const* data, size_t numBytes) const
+{
+    std::string const filename = GetFilename(key);
+    std::string const tempFilename = filename + ".tmp";
+
+    std::ofstream output(tempFilename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output)
+    {
+        return false;
+    }
+
+    Header header{};
+    header.magic = magic;
+    header.version = version;
+    header.key = key;
+    header.numBytes = static_cast<uint64_t>(numBytes);
+    header.checksum = GetHash(data, numBytes);
+    output.write(reinterpret_cast<char const*>(&header), sizeof(header));
+    output.write(static_cast<char const*>(data), static_cast<std::streamsize>(numBytes));
+    output.close();
+    if (!output)
+    {
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+
+    // The rename fails on some platforms when the target exists.
+    std::remove(filename.c_str());
+    if (std::rename(tempFilename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tempFilename.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,86 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// An on-disk cache of compiled shader code, so that later runs of an
+// application do not invoke the shader compiler. Assign a cache to the
+// 'cache' member of a ProgramFactory:
+//
+//   mProgramFactory->cache = std::make_shared<ProgramCache>("ShaderCache");
+//
+// Each entry is a blob stored in its own file, named by a 64-bit key. The
+// program factories compute the keys from everything that determines the
+// compiled code: the source strings, the defines, the entry points, the
+// version or target profile, the compiler flags and the matrix conventions.
+// Files included by #include directives are not part of the keys; clear
+// the cache after changing them.
+//
+// HLSLProgramFactory stores the bytecode of each shader. A cached shader is
+// created with HLSLShaderFactory::CreateFromBytecode, which obtains the
+// reflection data from the bytecode without compiling. GLSLProgramFactory
+// stores the program binaries of glGetProgramBinary, and its keys also
+// contain the vendor, renderer and version strings of the driver, because a
+// binary is valid only for the driver that created it. A driver may still
+// reject a binary, in which case the factory compiles the sources and
+// replaces the entry. The reflection data of a GLSL program are queried
+// from the linked program, which does not invoke the compiler.
+//
+// The directory must exist. Entries are never removed; delete the files to
+// clear the cache.
+
+namespace gte
+{
+    class ProgramCache
+    {
+    public:
+        ProgramCache(std::string const& directory);
+
+        // The 64-bit FNV-1a hash of the bytes. Pass the returned value as
+        // the input 'hash' to combine several blocks of data into one key.
+        static uint64_t GetHash(void const* data, size_t numBytes,
+            uint64_t hash = 0xCBF29CE484222325ull);
+
+        // The hash of the length and the characters of the string, so that
+        // a sequence of strings has a different key than their
+        // concatenation.
+        static uint64_t GetHash(std::string const& text,
+            uint64_t hash = 0xCBF29CE484222325ull);
+
+        // The name of the file for the key.
+        std::string GetFilename(uint64_t key) const;
+
+        // Load the blob of the key. The function returns false when the
+        // entry does not exist or its file is not valid.
+        bool Load(uint64_t key, std::vector<uint8_t>& data) const;
+
+        // Store the blob of the key, replacing an existing entry. The file
+        // is written under a temporary name and then renamed, so other
+        // processes never load a partially written entry. The function
+        // returns true when successful.
+        bool Save(uint64_t key, void const* data, size_t numBytes) const;
+
+        // The format version, which is stored in each file. Files of other
+        // versions fail to load.
+        static uint32_t constexpr version = 1;
+
+    private:
+        struct Header
+        {
+            uint32_t magic, version;
+            uint64_t key, numBytes, checksum;
+        };
+
+        static uint32_t constexpr magic = 0x43505447u;  // "GTPC"
+
+        std::string mDirectory;
+    };
+}
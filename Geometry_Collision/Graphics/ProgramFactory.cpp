@@ -18,7 +18,8 @@ ProgramFactory::ProgramFactory()
     gsEntry(""),
     csEntry(""),
     defines(),
-    flags(0)
+    flags(0),
+    cache{}
 {
 }
 
@@ -112,3 +113,37 @@ void ProgramFactory::PopFlags()
         mFlagsStack.pop();
     }
 }
+
+uint64_t ProgramFactory::GetCacheKey(std::initializer_list<std::string const*> strings) const
+{
+    int32_t const api = GetAPI();
+    uint64_t key = ProgramCache::GetHash(&api, sizeof(api));
+    key = ProgramCache::GetHash(version, key);
+    key = ProgramCache::GetHash(&flags, sizeof(flags), key);
+
+    auto const& definitions = defines.Get();
+    uint64_t const numDefinitions = static_cast<uint64_t>(definitions.size());
+    key = ProgramCache::GetHash(&numDefinitions, sizeof(numDefinitions), key);
+    for (auto const& definition : definitions)
+    {
+        key = ProgramCache::GetHash(definition.first, key);
+        key = ProgramCache::GetHash(definition.second, key);
+    }
+
+    // The factories compile the sources with defines and layouts that
+    // depend on these conventions.
+    uint8_t conventions[2] = { 0, 0 };
+#if defined(GTE_USE_MAT_VEC)
+    conventions[0] = 1;
+#endif
+#if defined(GTE_USE_ROW_MAJOR)
+    conventions[1] = 1;
+#endif
+    key = ProgramCache::GetHash(conventions, sizeof(conventions), key);
+
+    for (auto const* text : strings)
+    {
+        key = ProgramCache::GetHash(text ? *text : std::string(), key);
+    }
+    return key;
+}
@@ -7,10 +7,13 @@
 
 #pragma once
 
+#include "ProgramCache.h"
 #include "ProgramDefines.h"
 #include "VisualProgram.h"
 #include "ComputeProgram.h"
 #include <fstream>
+#include <initializer_list>
+#include <memory>
 #include <stack>
 
 namespace gte
@@ -34,6 +37,12 @@ namespace gte
         ProgramDefines defines;
         uint32_t flags;
 
+        // An optional cache of compiled code. When it is not null, the
+        // Create(...) functions load the compiled code of the sources from
+        // the cache and store the code of sources that are not yet cached.
+        // See ProgramCache for details.
+        std::shared_ptr<ProgramCache> cache;
+
         // The returned value is used as a lookup index into arrays of strings
         // corresponding to shader programs.  Currently, GLSLProgramFactory
         // returns PF_GLSL and HLSLProgramFactory returns PF_HLSL.
@@ -82,6 +91,12 @@ namespace gte
         void PopFlags();
 
     protected:
+        // The key of a cache entry. The key combines the strings with the
+        // API, 'version', 'flags', 'defines' and the matrix conventions of
+        // the engine. The strings are the sources and any other data that
+        // determine the compiled code, such as entry points.
+        uint64_t GetCacheKey(std::initializer_list<std::string const*> strings) const;
+
         virtual std::shared_ptr<VisualProgram> CreateFromNamedSources(
             std::string const& vsName, std::string const& vsSource,
             std::string const& psName, std::string const& psSource,
@@ -0,0 +1,59 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/RenderQueue.h>
+#include <algorithm>
+#include <functional>
+using namespace gte;
+
+RenderQueue::RenderQueue()
+    :
+    mVisuals{},
+    mSorted(true)
+{
+}
+
+void RenderQueue::Submit(Visual* visual)
+{
+    if (visual && visual->GetVertexBuffer() && visual->GetIndexBuffer() && visual->GetEffect())
+    {
+        mVisuals.push_back(visual);
+        mSorted = false;
+    }
+}
+
+void RenderQueue::Clear()
+{
+    mVisuals.clear();
+    mSorted = true;
+}
+
+void RenderQueue::Sort()
+{
+    // The keys are pointers, so the order of the runs is arbitrary but the
+    // visuals of a run are adjacent.
+    std::less<void const*> const less{};
+    std::stable_sort(mVisuals.begin(), mVisuals.end(),
+        [&less](Visual const* v0, Visual const* v1)
+        {
+            auto const& effect0 = v0->GetEffect();
+            auto const& effect1 = v1->GetEffect();
+            void const* program0 = effect0->GetProgram().get();
+            void const* program1 = effect1->GetProgram().get();
+            if (program0 != program1)
+            {
+                return less(program0, program1);
+            }
+            if (effect0 != effect1)
+            {
+                return less(effect0.get(), effect1.get());
+            }
+            return less(v0->GetVertexBuffer().get(), v1->GetVertexBuffer().get());
+        });
+    mSorted = true;
+}
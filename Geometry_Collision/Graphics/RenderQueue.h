@@ -0,0 +1,81 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Visual.h>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A list of Visual objects to be drawn in an order that minimizes the state
+// changes between draw calls. GraphicsEngine::Draw(std::vector<Visual*>)
+// binds a program once for a run of consecutive visuals that share it, the
+// resources of an effect once for a run that shares the effect, and a
+// vertex buffer once for a run that shares the buffer. Sort() orders the
+// visuals by program, then by effect, then by vertex buffer, so that these
+// runs are as long as possible.
+//
+//   queue.Clear();
+//   for (auto const& visual : culler.GetVisibleSet())
+//   {
+//       queue.Submit(visual);
+//   }
+//   engine->Draw(queue);
+//
+// Sorting discards the submission order, so submit only visuals whose
+// drawing order does not matter, typically the opaque ones. Blending,
+// depth-stencil and rasterizer states are set on the engine rather than
+// per visual, so visuals that need different global states belong in
+// different queues. The queue does not own the visuals; they must exist
+// until they are drawn.
+
+namespace gte
+{
+    class RenderQueue
+    {
+    public:
+        // Construction and destruction.
+        RenderQueue();
+        virtual ~RenderQueue() = default;
+
+        // Visuals without a vertex buffer, index buffer or effect are
+        // ignored, as they are by GraphicsEngine::Draw.
+        void Submit(Visual* visual);
+
+        inline void Submit(std::shared_ptr<Visual> const& visual)
+        {
+            Submit(visual.get());
+        }
+
+        void Clear();
+
+        // Sort the visuals by state. The sort is stable, so visuals with the
+        // same state keep their submission order. GraphicsEngine::Draw
+        // calls Sort() when the queue has changed since the last sort.
+        void Sort();
+
+        inline bool IsSorted() const
+        {
+            return mSorted;
+        }
+
+        inline std::vector<Visual*> const& GetVisuals() const
+        {
+            return mVisuals;
+        }
+
+        inline size_t GetNumVisuals() const
+        {
+            return mVisuals.size();
+        }
+
+    private:
+        std::vector<Visual*> mVisuals;
+        bool mSorted;
+    };
+}
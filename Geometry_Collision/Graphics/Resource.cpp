@@ -8,8 +8,117 @@
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/Resource.h>
 #include <Mathematics/Logger.h>
+#include <array>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <vector>
 using namespace gte;
 
+namespace
+{
+    // The pool of system-memory storage. The size classes are the powers of
+    // two 2^minLogSize through 2^maxLogSize. Each class has a list of free
+    // blocks. The pool is never destroyed so that resources destroyed
+    // during static destruction can still return their storage.
+    class StoragePool
+    {
+    public:
+        static int32_t constexpr minLogSize = 8;
+        static int32_t constexpr maxLogSize = 26;
+        static int32_t constexpr numClasses = maxLogSize - minLogSize + 1;
+
+        static StoragePool& Get()
+        {
+            static StoragePool* pool = new StoragePool();
+            return *pool;
+        }
+
+        // The size class for the number of bytes, or -1 when the storage
+        // is not pooled.
+        int32_t GetSizeClass(size_t numBytes) const
+        {
+            if (enabled.load(std::memory_order_relaxed))
+            {
+                for (int32_t sizeClass = 0; sizeClass < numClasses; ++sizeClass)
+                {
+                    if (numBytes <= GetClassSize(sizeClass))
+                    {
+                        return sizeClass;
+                    }
+                }
+            }
+            return -1;
+        }
+
+        static inline size_t GetClassSize(int32_t sizeClass)
+        {
+            return static_cast<size_t>(1) << (sizeClass + minLogSize);
+        }
+
+        char* Allocate(int32_t sizeClass)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                std::vector<char*>& blocks = freeBlocks[sizeClass];
+                if (blocks.size() > 0)
+                {
+                    char* block = blocks.back();
+                    blocks.pop_back();
+                    return block;
+                }
+            }
+            return new char[GetClassSize(sizeClass)];
+        }
+
+        void Deallocate(char* block, int32_t sizeClass)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            freeBlocks[sizeClass].push_back(block);
+        }
+
+        void Release()
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& blocks : freeBlocks)
+            {
+                for (auto block : blocks)
+                {
+                    delete[] block;
+                }
+                blocks.clear();
+                blocks.shrink_to_fit();
+            }
+        }
+
+        std::atomic<bool> enabled;
+
+    private:
+        StoragePool()
+            :
+            enabled(false),
+            mutex{},
+            freeBlocks{}
+        {
+        }
+
+        std::mutex mutex;
+        std::array<std::vector<char*>, numClasses> freeBlocks;
+    };
+}
+
+void Resource::StorageDeleter::operator()(char* storage) const
+{
+    if (sizeClass >= 0)
+    {
+        StoragePool::Get().Deallocate(storage, sizeClass);
+    }
+    else
+    {
+        delete[] storage;
+    }
+}
+
 Resource::~Resource()
 {
     DestroyStorage();
@@ -22,6 +131,7 @@ Resource::Resource(uint32_t numElements, size_t elementSize, bool createStorage)
     mUsage(Usage::IMMUTABLE),
     mCopy(Copy::NONE),
     mOffset(0),
+    mStorage(nullptr, StorageDeleter{ -1 }),
     mData(nullptr)
 {
     mType = GT_RESOURCE;
@@ -60,12 +170,16 @@ Resource::Resource(uint32_t numElements, size_t elementSize, bool createStorage)
 
 void Resource::CreateStorage()
 {
-    if (mStorage.size() == 0)
+    if (!mStorage && mNumBytes > 0)
     {
-        mStorage.resize(mNumBytes);
+        StoragePool& pool = StoragePool::Get();
+        int32_t const sizeClass = pool.GetSizeClass(mNumBytes);
+        char* storage = (sizeClass >= 0 ? pool.Allocate(sizeClass) : new char[mNumBytes]);
+        std::memset(storage, 0, mNumBytes);
+        mStorage = std::unique_ptr<char[], StorageDeleter>(storage, StorageDeleter{ sizeClass });
         if (!mData)
         {
-            mData = mStorage.data();
+            mData = mStorage.get();
         }
     }
 }
@@ -74,17 +188,35 @@ void Resource::DestroyStorage()
 {
     // The intent of DestroyStorage is to free up CPU memory that is not
     // required when the resource GPU memory is all that is required.
-    // The 'clear' call sets the size to 0, but the capacity remains the
-    // same; that is, the memory is not freed.  The 'shrink_to_fit' call
-    // is required to free the memory.
-    if (mStorage.size() > 0 && mData == mStorage.data())
+    // Pooled storage is returned to the pool.
+    if (mStorage && mData == mStorage.get())
     {
         mData = nullptr;
-        mStorage.clear();
-        mStorage.shrink_to_fit();
+        mStorage.reset();
     }
 }
 
+void Resource::SetStoragePooling(bool enable)
+{
+    StoragePool::Get().enabled.store(enable, std::memory_order_relaxed);
+}
+
+bool Resource::GetStoragePooling()
+{
+    return StoragePool::Get().enabled.load(std::memory_order_relaxed);
+}
+
+void Resource::ReleaseStoragePool()
+{
+    StoragePool::Get().Release();
+}
+
+void Resource::WrapData(char* data)
+{
+    mStorage.reset();
+    mData = data;
+}
+
 void Resource::SetOffset(uint32_t offset)
 {
     if (offset < mNumElements)
@@ -8,7 +8,9 @@
 #pragma once
 
 #include "GraphicsObject.h"
+#include <Mathematics/Logger.h>
 #include <cstdint>
+#include <memory>
 #include <vector>
 
 namespace Vector_GM
@@ -30,6 +32,28 @@ namespace Vector_GM
         void CreateStorage();
         void DestroyStorage();
 
+        // Pooling of the system-memory storage, which is disabled by
+        // default.  When enabled, CreateStorage takes the storage from a
+        // process-wide pool of size classes, the powers of two from 256
+        // bytes to 64 MB, and DestroyStorage and the destructor return it
+        // to the pool instead of freeing it.  Resources that are created
+        // and destroyed every frame, for example the buffers of dynamic
+        // geometry, then reuse the memory of the previous ones.  The storage
+        // is zero-initialized whether or not it is pooled.  The setting
+        // applies to storage created after the call.  ReleaseStoragePool
+        // frees the storage held by the pool.
+        static void SetStoragePooling(bool enable);
+        static bool GetStoragePooling();
+        static void ReleaseStoragePool();
+
+        // Use caller-owned memory of at least GetNumBytes() bytes as the
+        // data of the resource, for example an array of a physics
+        // simulation that is uploaded without copying it first.  The storage
+        // of the resource, if any, is destroyed.  The caller must keep the
+        // memory alive while the resource uses it.  ResetData and Reset set
+        // the data to nullptr until CreateStorage is called.
+        void WrapData(char* data);
+
         // Basic member access.
         inline uint32_t GetNumElements() const
         {
@@ -49,15 +73,31 @@ namespace Vector_GM
         // The resource usage.  These control how the GPU versions are
         // created.  You must set the usage type before binding the resource
         // to an engine.
+        //
+        // STREAMING is DYNAMIC_UPDATE for buffers that are updated every
+        // frame.  It is supported by vertex buffers and structured buffers.
+        // The GPU buffer holds Buffer::numStreamingRegions copies of the
+        // data, and each engine Update(buffer) writes the entire CPU data to
+        // the next region while the GPU may still read the previous ones.
+        // Draw calls bind the most recently written region.  GL45 maps the
+        // buffer persistently and waits on a fence only when it reuses a
+        // region the GPU has not finished reading.  DX11 maps with
+        // D3D11_MAP_WRITE_NO_OVERWRITE and with D3D11_MAP_WRITE_DISCARD
+        // when it wraps around to the first region; its structured buffers
+        // have a single region that is discarded on every update.
         enum Usage
         {
             IMMUTABLE,
             DYNAMIC_UPDATE,
-            SHADER_OUTPUT
+            SHADER_OUTPUT,
+            STREAMING
         };
 
         inline void SetUsage(Usage usage)
         {
+            LogAssert(usage != Usage::STREAMING || mType == GT_VERTEX_BUFFER ||
+                mType == GT_STRUCTURED_BUFFER,
+                "STREAMING usage requires a vertex buffer or structured buffer.");
             mUsage = usage;
         }
 
@@ -95,7 +135,7 @@ namespace Vector_GM
         // a convenience for accessing the raw data as a specified type.
         inline void ResetData()
         {
-            mData = (mStorage.size() > 0 ? mStorage.data() : nullptr);
+            mData = mStorage.get();
         }
 
         inline void SetData(char* data)
@@ -133,7 +173,7 @@ namespace Vector_GM
 
         inline void Reset()
         {
-            mData = (mStorage.size() > 0 ? mStorage.data() : nullptr);
+            mData = mStorage.get();
         }
 
         // Specify a contiguous block of active elements in the resource.  An
@@ -169,6 +209,15 @@ namespace Vector_GM
         }
 
     protected:
+        // The deleter of the storage, which returns pooled storage to its
+        // size class of the pool and frees the other storage.
+        struct StorageDeleter
+        {
+            void operator()(char* storage) const;
+
+            int32_t sizeClass;
+        };
+
         uint32_t mNumElements;          // default: 0
         uint32_t mElementSize;          // default: 0
         uint32_t mNumBytes;             // default: 0
@@ -176,7 +225,7 @@ namespace Vector_GM
         Copy mCopy;                     // default: NONE
         uint32_t mOffset;               // default: 0
         uint32_t mNumActiveElements;    // default: 0
-        std::vector<char> mStorage;     // default: empty
+        std::unique_ptr<char[], StorageDeleter> mStorage;  // default: nullptr
         char* mData;                    // default: nullptr
     };
 }
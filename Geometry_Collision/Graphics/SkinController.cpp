@@ -9,6 +9,7 @@
 #include <Graphics/SkinController.h>
 #include <Graphics/Node.h>
 #include <Graphics/Visual.h>
+#include <algorithm>
 using namespace gte;
 
 SkinController::SkinController(int32_t numVertices, int32_t numBones, BufferUpdater const& postUpdate)
@@ -22,10 +23,34 @@ SkinController::SkinController(int32_t numVertices, int32_t numBones, BufferUpda
     mPosition(nullptr),
     mStride(0),
     mFirstUpdate(true),
-    mCanUpdate(false)
+    mCanUpdate(false),
+    mNumXGroups(0)
 {
 }
 
+SkinController::SkinController(std::shared_ptr<ProgramFactory> const& factory,
+    int32_t numVertices, int32_t numBones, BufferUpdater const& postUpdate,
+    ProgramExecutor const& execute)
+    :
+    SkinController(numVertices, numBones, postUpdate)
+{
+    LogAssert(factory != nullptr && execute, "Invalid input.");
+    mFactory = factory;
+    mExecute = execute;
+}
+
+std::shared_ptr<VertexBuffer> SkinController::CreateSkinnedVertexBuffer(
+    VertexFormat const& vformat, uint32_t numVertices, bool readback)
+{
+    auto sbuffer = std::make_shared<StructuredBuffer>(numVertices, vformat.GetVertexSize());
+    sbuffer->SetUsage(Resource::Usage::SHADER_OUTPUT);
+    if (readback)
+    {
+        sbuffer->SetCopy(Resource::Copy::STAGING_TO_CPU);
+    }
+    return std::make_shared<VertexBuffer>(vformat, sbuffer);
+}
+
 bool SkinController::Update(double applicationTime)
 {
     if (!Controller::Update(applicationTime))
@@ -47,6 +72,12 @@ bool SkinController::Update(double applicationTime)
         visual->worldTransform = Transform<float>::Identity();
         visual->worldTransformIsCurrent = true;
 
+        if (mProgram)
+        {
+            UpdateGPU(visual);
+            return true;
+        }
+
         // Package the bone transformations into a std::vector to avoid the
         // expensive lock() calls in the inner loop of the position updates.
         std::vector<Matrix4x4<float>> worldTransforms(mNumBones);
@@ -128,6 +159,13 @@ void SkinController::OnFirstUpdate()
             if (semantic == VASemantic::POSITION &&
                 (type == DF_R32G32B32_FLOAT || type == DF_R32G32B32A32_FLOAT))
             {
+                if (SkinsOnGPU())
+                {
+                    OnFirstUpdateGPU(vbuffer, offset);
+                    mCanUpdate = (mProgram != nullptr);
+                    return;
+                }
+
                 mPosition = vbuffer->GetData() + offset;
                 mStride = vformat.GetVertexSize();
                 mCanUpdate = true;
@@ -138,3 +176,200 @@ void SkinController::OnFirstUpdate()
 
     mCanUpdate = (mPosition != nullptr);
 }
+
+void SkinController::OnFirstUpdateGPU(VertexBuffer* vbuffer, uint32_t positionOffset)
+{
+    auto const& sbuffer = vbuffer->GetSBuffer();
+    uint32_t const vertexSize = vbuffer->GetFormat().GetVertexSize();
+    if (!sbuffer || sbuffer->GetUsage() != Resource::Usage::SHADER_OUTPUT ||
+        sbuffer->GetElementSize() != vertexSize || vertexSize % sizeof(float) != 0)
+    {
+        LogError("The vertex buffer must be created by CreateSkinnedVertexBuffer.");
+    }
+
+    // Store the nonzero weights of each vertex contiguously.
+    size_t const numBones = static_cast<size_t>(mNumBones);
+    std::vector<std::array<uint32_t, 2>> ranges(static_cast<size_t>(mNumVertices));
+    std::vector<Influence> influences{};
+    influences.reserve(ranges.size());
+    mBoneRadii.assign(numBones, -1.0f);
+    for (size_t vertex = 0, i = 0; vertex < ranges.size(); ++vertex)
+    {
+        ranges[vertex][0] = static_cast<uint32_t>(influences.size());
+        for (size_t bone = 0; bone < numBones; ++bone, ++i)
+        {
+            if (mWeights[i] != 0.0f)
+            {
+                Influence influence{};
+                influence.offset[0] = mOffsets[i][0];
+                influence.offset[1] = mOffsets[i][1];
+                influence.offset[2] = mOffsets[i][2];
+                influence.weight = mWeights[i];
+                influence.bone = static_cast<uint32_t>(bone);
+                influences.push_back(influence);
+
+                float const radius = Length(HProject(mOffsets[i]));
+                mBoneRadii[bone] = std::max(mBoneRadii[bone], radius);
+            }
+        }
+        ranges[vertex][1] = static_cast<uint32_t>(influences.size()) - ranges[vertex][0];
+    }
+    if (influences.size() == 0)
+    {
+        // A structured buffer must have at least one element.
+        influences.push_back(Influence{});
+    }
+
+    mBoneBuffer = std::make_shared<StructuredBuffer>(mNumBones, sizeof(Matrix4x4<float>));
+    mBoneBuffer->SetUsage(Resource::Usage::STREAMING);
+
+    mRangeBuffer = std::make_shared<StructuredBuffer>(mNumVertices, sizeof(ranges[0]));
+    std::copy(ranges.begin(), ranges.end(), mRangeBuffer->Get<std::array<uint32_t, 2>>());
+
+    mInfluenceBuffer = std::make_shared<StructuredBuffer>(
+        static_cast<uint32_t>(influences.size()), sizeof(Influence));
+    std::copy(influences.begin(), influences.end(), mInfluenceBuffer->Get<Influence>());
+
+    // The vertex layout is passed to the shader as macros, so the shader
+    // writes the positions in place and leaves the other attributes alone.
+    uint32_t const numThreads = msNumXThreads;
+    mFactory->PushDefines();
+    mFactory->defines.Set("NUM_X_THREADS", numThreads);
+    mFactory->defines.Set("NUM_VERTICES", mNumVertices);
+    mFactory->defines.Set("VERTEX_NUM_FLOATS", vertexSize / sizeof(float));
+    mFactory->defines.Set("POSITION_OFFSET", positionOffset / sizeof(float));
+    mProgram = mFactory->CreateFromSource(*msCSSource[mFactory->GetAPI()]);
+    mFactory->PopDefines();
+    if (!mProgram)
+    {
+        LogError("Failed to compile the skinning program.");
+    }
+
+    auto const& cshader = mProgram->GetComputeShader();
+    cshader->Set("boneTransforms", mBoneBuffer);
+    cshader->Set("influenceRanges", mRangeBuffer);
+    cshader->Set("influences", mInfluenceBuffer);
+    cshader->Set("skinnedVertices", sbuffer);
+    mNumXGroups = (static_cast<uint32_t>(mNumVertices) + numThreads - 1) / numThreads;
+}
+
+void SkinController::UpdateGPU(Visual* visual)
+{
+    // A skinned position is a convex combination of the bone-transformed
+    // offsets, each of which is inside the sphere centered at the bone
+    // origin whose radius is the scaled bone radius.  The bound of these
+    // spheres therefore contains the skin without reading it back.
+    auto boneTransforms = mBoneBuffer->Get<Matrix4x4<float>>();
+    BoundingSphere<float> bound{};
+    for (int32_t bone = 0; bone < mNumBones; ++bone)
+    {
+        Transform<float> const& worldTransform = mBones[bone].lock()->worldTransform;
+        boneTransforms[bone] = worldTransform;
+
+        if (mBoneRadii[bone] >= 0.0f)
+        {
+            BoundingSphere<float> sphere{};
+            sphere.SetCenter(worldTransform.GetTranslation());
+            sphere.SetRadius(std::max(worldTransform.GetNorm() * mBoneRadii[bone],
+                std::numeric_limits<float>::min()));
+            bound.GrowToContain(sphere);
+        }
+    }
+    visual->modelBound = bound;
+
+    mPostUpdate(mBoneBuffer);
+    mExecute(mProgram, mNumXGroups, 1, 1);
+}
+
+std::string const SkinController::msGLSLCSSource =
+R"(
+    buffer boneTransforms { mat4 data[]; } boneTransformsSB;
+    buffer influenceRanges { uvec2 data[]; } influenceRangesSB;
+
+    struct Influence
+    {
+        vec4 offsetWeight;
+        uvec4 bone;
+    };
+
+    buffer influences { Influence data[]; } influencesSB;
+    buffer skinnedVertices { float data[]; } skinnedVerticesSB;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = 1, local_size_z = 1) in;
+    void main()
+    {
+        uint vertex = gl_GlobalInvocationID.x;
+        if (vertex < NUM_VERTICES)
+        {
+            uvec2 range = influenceRangesSB.data[vertex];
+            vec3 position = vec3(0.0f);
+            for (uint i = range.x; i < range.x + range.y; ++i)
+            {
+                Influence influence = influencesSB.data[i];
+                mat4 boneTransform = boneTransformsSB.data[influence.bone.x];
+                vec4 offset = vec4(influence.offsetWeight.xyz, 1.0f);
+    #if GTE_USE_MAT_VEC
+                position += influence.offsetWeight.w * (boneTransform * offset).xyz;
+    #else
+                position += influence.offsetWeight.w * (offset * boneTransform).xyz;
+    #endif
+            }
+
+            uint target = vertex * VERTEX_NUM_FLOATS + POSITION_OFFSET;
+            skinnedVerticesSB.data[target] = position.x;
+            skinnedVerticesSB.data[target + 1] = position.y;
+            skinnedVerticesSB.data[target + 2] = position.z;
+        }
+    }
+)";
+
+std::string const SkinController::msHLSLCSSource =
+R"(
+    struct Influence
+    {
+        float4 offsetWeight;
+        uint4 bone;
+    };
+
+    struct Vertex
+    {
+        float data[VERTEX_NUM_FLOATS];
+    };
+
+    StructuredBuffer<float4x4> boneTransforms;
+    StructuredBuffer<uint2> influenceRanges;
+    StructuredBuffer<Influence> influences;
+    RWStructuredBuffer<Vertex> skinnedVertices;
+
+    [numthreads(NUM_X_THREADS, 1, 1)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint vertex = t.x;
+        if (vertex < NUM_VERTICES)
+        {
+            uint2 range = influenceRanges[vertex];
+            float3 position = float3(0.0f, 0.0f, 0.0f);
+            for (uint i = range.x; i < range.x + range.y; ++i)
+            {
+                Influence influence = influences[i];
+                float4x4 boneTransform = boneTransforms[influence.bone.x];
+                float4 offset = float4(influence.offsetWeight.xyz, 1.0f);
+    #if GTE_USE_MAT_VEC
+                position += influence.offsetWeight.w * mul(boneTransform, offset).xyz;
+    #else
+                position += influence.offsetWeight.w * mul(offset, boneTransform).xyz;
+    #endif
+            }
+
+            skinnedVertices[vertex].data[POSITION_OFFSET] = position.x;
+            skinnedVertices[vertex].data[POSITION_OFFSET + 1] = position.y;
+            skinnedVertices[vertex].data[POSITION_OFFSET + 2] = position.z;
+        }
+    }
+)";
+
+ProgramSources const SkinController::msCSSource =
+{
+    &msGLSLCSSource,
+    &msHLSLCSSource
+};
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <Graphics/Controller.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/StructuredBuffer.h>
 #include <Graphics/VertexBuffer.h>
 #include <Mathematics/Vector4.h>
 #include <cstdint>
@@ -15,6 +17,7 @@
 namespace gte
 {
     class Node;
+    class Visual;
 
     class SkinController : public Controller
     {
@@ -28,6 +31,29 @@ namespace gte
         virtual ~SkinController() = default;
         SkinController(int32_t numVertices, int32_t numBones, BufferUpdater const& postUpdate);
 
+        // Construction for skinning on the GPU.  A compute shader blends the
+        // positions and writes them directly into the vertex buffer, so the
+        // CPU work per update is the copy of the bone matrices, which are
+        // sent to the GPU by 'postUpdate'.  The 'execute' function object
+        // runs the compute program.  The controlled object must have a vertex
+        // buffer created by CreateSkinnedVertexBuffer, which the vertex
+        // shader of its effect reads by vertex identifier.  The normals are
+        // not updated, and the model bound is computed from the bone
+        // transforms and the lengths of the offsets, not from the vertices.
+        SkinController(std::shared_ptr<ProgramFactory> const& factory,
+            int32_t numVertices, int32_t numBones, BufferUpdater const& postUpdate,
+            ProgramExecutor const& execute);
+
+        // Create a vertex buffer for skinning on the GPU.  Its vertices are
+        // stored in a structured buffer with SHADER_OUTPUT usage, returned
+        // by GetSBuffer().  The positions must be 3-tuples or 4-tuples of
+        // float.  When 'readback' is true, the structured buffer has a
+        // staging buffer so that the skinned vertices can be read on demand
+        // with GraphicsEngine::CopyGpuToCpu(vbuffer->GetSBuffer()), for
+        // example before refitting a BoundTree of a CollisionMesh.
+        static std::shared_ptr<VertexBuffer> CreateSkinnedVertexBuffer(
+            VertexFormat const& vformat, uint32_t numVertices, bool readback);
+
         // Member access.  After calling the constructor, you must set the
         // data using these functions.  The bone array uses weak pointers to
         // avoid reference-count cycles in the scene graph.
@@ -56,6 +82,11 @@ namespace gte
             return mOffsets;
         }
 
+        inline bool SkinsOnGPU() const
+        {
+            return mFactory != nullptr;
+        }
+
         // The animation update.  The application time is in milliseconds.
         virtual bool Update(double applicationTime) override;
 
@@ -65,6 +96,8 @@ namespace gte
         // construction, because we do not know mObject when SkinController
         // is constructed.
         void OnFirstUpdate();
+        void OnFirstUpdateGPU(VertexBuffer* vbuffer, uint32_t positionOffset);
+        void UpdateGPU(Visual* visual);
 
         int32_t mNumVertices;
         int32_t mNumBones;
@@ -82,5 +115,33 @@ namespace gte
         char* mPosition;
         uint32_t mStride;
         bool mFirstUpdate, mCanUpdate;
+
+        // Skinning on the GPU.  The nonzero weights of a vertex are stored
+        // contiguously in the influence buffer, and the range buffer has the
+        // first influence and the number of influences of each vertex.  The
+        // bone radius is the maximum length of the offsets of the bone, or
+        // -1 when the bone has no influences.
+        struct Influence
+        {
+            float offset[3];
+            float weight;
+            uint32_t bone;
+            uint32_t padding[3];
+        };
+
+        std::shared_ptr<ProgramFactory> mFactory;
+        ProgramExecutor mExecute;
+        std::shared_ptr<ComputeProgram> mProgram;
+        std::shared_ptr<StructuredBuffer> mBoneBuffer;
+        std::shared_ptr<StructuredBuffer> mRangeBuffer;
+        std::shared_ptr<StructuredBuffer> mInfluenceBuffer;
+        std::vector<float> mBoneRadii;
+        uint32_t mNumXGroups;
+
+        // Shader source code as strings.
+        static uint32_t const msNumXThreads = 64;
+        static std::string const msGLSLCSSource;
+        static std::string const msHLSLCSSource;
+        static ProgramSources const msCSSource;
     };
 }
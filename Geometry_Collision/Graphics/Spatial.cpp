@@ -81,9 +81,16 @@ void Spatial::UpdateWorldData(double applicationTime)
 
 void Spatial::PropagateBoundToRoot ()
 {
-    if (mParent)
+    // The world bound of an ancestor depends only on the world bounds of
+    // its children, so the propagation stops at the first ancestor whose
+    // bound does not change.
+    for (Spatial* parent = mParent; parent; parent = parent->mParent)
     {
-        mParent->UpdateWorldBound();
-        mParent->PropagateBoundToRoot();
+        BoundingSphere<float> const oldBound = parent->worldBound;
+        parent->UpdateWorldBound();
+        if (parent->worldBound == oldBound)
+        {
+            break;
+        }
     }
 }
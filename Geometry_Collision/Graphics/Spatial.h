@@ -72,6 +72,9 @@ namespace Vector_GM
         }
 
     protected:
+        // TransformHierarchy performs the update of a compiled subtree.
+        friend class TransformHierarchy;
+
         // Constructor accessible by Node, Visual, and Audial.
         Spatial();
 
@@ -8,6 +8,8 @@
 #include <Graphics/GTGraphicsPCH.h>
 #include <Graphics/Terrain.h>
 #include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cstring>
 using namespace gte;
 
 Terrain::Terrain(size_t numRows, size_t numCols, size_t size, float minElevation,
@@ -55,6 +57,7 @@ Terrain::Terrain(size_t numRows, size_t numCols, size_t size, float minElevation
             Vector2<float> origin{ col * mLength, row * mLength };
             auto page = std::make_shared<Page>(mSize, mMinElevation,
                 mMaxElevation, mSpacing, mLength, origin, vformat);
+            page->SetWorldLocation(static_cast<int32_t>(row), static_cast<int32_t>(col));
             AttachChild(page);
         }
     }
@@ -163,6 +166,7 @@ void Terrain::OnCameraMotion()
                     page->localTransform.GetTranslation()[2]
                 };
                 page->localTransform.SetTranslation(pageTrn);
+                page->SetWorldLocation(rO, cO);
 
                 ++cO;
                 if (++cP == static_cast<int32_t>(mNumCols))
@@ -189,7 +193,9 @@ Terrain::Page::Page(size_t size, float minElevation, float maxElevation,
     mMaxElevation(maxElevation),
     mSpacing(spacing),
     mOrigin(origin),
-    mHeights(mSize * mSize, 0)
+    mHeights(mSize * mSize, 0),
+    mWorldRow(0),
+    mWorldCol(0)
 {
     // Create a mesh for the page.  The vertices are initialized using the
     // SetHeights(...) function.
@@ -203,24 +209,59 @@ Terrain::Page::Page(size_t size, float minElevation, float maxElevation,
 
 void Terrain::Page::SetHeights(std::vector<uint16_t> const& heights)
 {
-    char* vertices = mVBuffer->GetData();
-    size_t vertexSize = static_cast<size_t>(mVBuffer->GetFormat().GetVertexSize());
+    std::copy(heights.begin(), heights.begin() + mHeights.size(), mHeights.begin());
+    SetPositions(mHeights, mVBuffer->GetFormat().GetVertexSize(), mVBuffer->GetData());
+    UpdateModelBound();
+    UpdateModelNormals();
+}
+
+std::shared_ptr<VertexBuffer> Terrain::Page::CreateVertices(VertexBuffer const& source,
+    std::vector<uint16_t> const& heights, BoundingSphere<float>& bound) const
+{
+    LogAssert(heights.size() >= mSize * mSize, "Invalid number of heights.");
+
+    auto vbuffer = std::make_shared<VertexBuffer>(source.GetFormat(), source.GetNumElements());
+    vbuffer->SetUsage(source.GetUsage());
+    std::memcpy(vbuffer->GetData(), source.GetData(), source.GetNumBytes());
+    SetPositions(heights, source.GetFormat().GetVertexSize(), vbuffer->GetData());
+
+    // The normals and bound are computed by a temporary Visual that shares
+    // the index buffer, which is not modified.
+    Visual visual(vbuffer, mIBuffer);
+    visual.UpdateModelBound();
+    visual.UpdateModelNormals();
+    bound = visual.modelBound;
+    return vbuffer;
+}
+
+void Terrain::Page::SetVertices(std::vector<uint16_t>&& heights,
+    std::shared_ptr<VertexBuffer> const& vbuffer, BoundingSphere<float> const& bound)
+{
+    LogAssert(heights.size() >= mHeights.size() && vbuffer != nullptr
+        && vbuffer->GetNumElements() == mVBuffer->GetNumElements(),
+        "Invalid input to SetVertices.");
+
+    heights.resize(mHeights.size());
+    mHeights = std::move(heights);
+    mVBuffer = vbuffer;
+    modelBound = bound;
+}
+
+void Terrain::Page::SetPositions(std::vector<uint16_t> const& heights,
+    uint32_t vertexSize, char* vertices) const
+{
     for (size_t row = 0, i = 0; row < mSize; ++row)
     {
         float y = mOrigin[1] + mSpacing * static_cast<float>(row);
         for (size_t col = 0; col < mSize; ++col, ++i)
         {
-            mHeights[i] = heights[i];
             Vector3<float>& vertex = *reinterpret_cast<Vector3<float>*>(vertices);
             vertex[0] = mOrigin[0] + mSpacing * static_cast<float>(col);
             vertex[1] = y;
-            vertex[2] = GetHeight(i);
+            vertex[2] = GetElevation(heights[i]);
             vertices += vertexSize;
         }
     }
-
-    UpdateModelBound();
-    UpdateModelNormals();
 }
 
 float Terrain::Page::GetHeight(float x, float y) const
@@ -285,9 +326,14 @@ float Terrain::Page::GetHeight(float x, float y) const
 }
 
 float Terrain::Page::GetHeight(size_t i) const
+{
+    return GetElevation(mHeights[i]);
+}
+
+float Terrain::Page::GetElevation(uint16_t height) const
 {
     // The t-value is in [0,1].
-    float t = static_cast<float>(mHeights[i]) / 65535.0f;
+    float t = static_cast<float>(height) / 65535.0f;
     return (1.0f - t) * mMinElevation + t * mMaxElevation;
 }
 
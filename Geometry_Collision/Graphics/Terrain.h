@@ -122,17 +122,60 @@ namespace gte
             // the return value is std::numeric_limits<float>::max().
             float GetHeight(float x, float y) const;
 
+            // The page of the unbounded grid of pages, in units of the page
+            // length, that this page currently represents.  The location is
+            // (row,col) of the page at construction and is changed by
+            // Terrain::OnCameraMotion.
+            inline void SetWorldLocation(int32_t row, int32_t col)
+            {
+                mWorldRow = row;
+                mWorldCol = col;
+            }
+
+            inline int32_t GetWorldRow() const
+            {
+                return mWorldRow;
+            }
+
+            inline int32_t GetWorldCol() const
+            {
+                return mWorldCol;
+            }
+
+            // Support for streaming.  CreateVertices copies the source, which
+            // must have the vertex format and number of vertices of the
+            // page, sets the positions and normals for the heights and
+            // computes the model bound.  It does not modify the page, so it
+            // may be called on any thread while the page is drawn.
+            // SetVertices replaces the heights, the vertex buffer and the
+            // model bound of the page.
+            std::shared_ptr<VertexBuffer> CreateVertices(VertexBuffer const& source,
+                std::vector<uint16_t> const& heights, BoundingSphere<float>& bound) const;
+
+            void SetVertices(std::vector<uint16_t>&& heights,
+                std::shared_ptr<VertexBuffer> const& vbuffer,
+                BoundingSphere<float> const& bound);
+
         private:
             float GetHeight(size_t i) const;
             float GetHeight(size_t row, size_t col) const;
+            float GetElevation(uint16_t height) const;
+
+            // Set the positions of the vertices from the heights.
+            void SetPositions(std::vector<uint16_t> const& heights,
+                uint32_t vertexSize, char* vertices) const;
 
             // Height field parameters.
             size_t mSize;
             float mMinElevation, mMaxElevation, mSpacing;
             Vector2<float> mOrigin;
             std::vector<uint16_t> mHeights;
+            int32_t mWorldRow, mWorldCol;
         };
 
+        // TerrainStreamer replaces the vertices of the pages.
+        friend class TerrainStreamer;
+
         std::shared_ptr<Page> GetPage(float x, float y) const;
 
         // Terrain information.
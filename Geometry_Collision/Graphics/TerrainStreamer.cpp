@@ -0,0 +1,332 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/TerrainStreamer.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <exception>
+using namespace gte;
+
+TerrainStreamer::TerrainStreamer(std::shared_ptr<Terrain> const& terrain,
+    HeightLoader const& loader, BufferUpdater const& upload,
+    size_t uploadBudget, float prefetchTime)
+    :
+    mTerrain(terrain),
+    mLoader(loader),
+    mUpload(upload),
+    mUploadBudget(uploadBudget),
+    mPrefetchTime(prefetchTime),
+    mSlots{},
+    mPreviousEye{ 0.0f, 0.0f },
+    mHasPreviousEye(false),
+    mCache{},
+    mRequested{},
+    mCacheCapacity(0),
+    mMutex{},
+    mCondition{},
+    mQueue{},
+    mGenerated{},
+    mNumPending(0),
+    mStop(false)
+{
+    LogAssert(mTerrain != nullptr && mLoader && mUpload, "Invalid input.");
+
+    // The pages do not have the heights of their world locations until
+    // they are generated by the streamer.
+    size_t const numSlots = mTerrain->mNumRows * mTerrain->mNumCols;
+    mSlots.resize(numSlots);
+    for (size_t i = 0; i < numSlots; ++i)
+    {
+        Slot& slot = mSlots[i];
+        slot.page = std::dynamic_pointer_cast<Terrain::Page>(mTerrain->mChild[i]);
+        LogAssert(slot.page != nullptr, "The terrain children must be pages.");
+
+        auto const& vbuffer = slot.page->GetVertexBuffer();
+        slot.source = std::make_shared<VertexBuffer>(vbuffer->GetFormat(),
+            vbuffer->GetNumElements());
+        slot.source->SetUsage(vbuffer->GetUsage());
+        std::memcpy(slot.source->GetData(), vbuffer->GetData(), vbuffer->GetNumBytes());
+
+        slot.culling = slot.page->culling;
+        slot.current = 0;
+        slot.hasCurrent = false;
+        slot.page->culling = CullingMode::ALWAYS;
+    }
+
+    // The current and prefetched windows each have numSlots pages.
+    mCacheCapacity = 2 * numSlots;
+
+    mThread = std::thread([this]() { GenerateLoop(); });
+}
+
+TerrainStreamer::~TerrainStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+void TerrainStreamer::Update()
+{
+    // Get the camera location in the model space of the terrain, as
+    // Terrain::OnCameraMotion does.
+    Vector4<float> worldEye = mTerrain->mCamera->GetPosition();
+#if defined(GTE_USE_MAT_VEC)
+    Vector4<float> modelEye = mTerrain->worldTransform.Inverse() * worldEye;
+#else
+    Vector4<float> modelEye = worldEye * mTerrain->worldTransform.Inverse();
+#endif
+    Vector2<float> eye{ modelEye[0], modelEye[1] };
+    Vector2<float> velocity{ 0.0f, 0.0f };
+    if (mHasPreviousEye)
+    {
+        velocity = eye - mPreviousEye;
+    }
+    mPreviousEye = eye;
+    mHasPreviousEye = true;
+
+    float const length = mTerrain->mLength;
+    Vector2<float> predicted = eye + mPrefetchTime * velocity;
+    int32_t const cameraRow = static_cast<int32_t>(std::floor(eye[1] / length));
+    int32_t const cameraCol = static_cast<int32_t>(std::floor(eye[0] / length));
+    int32_t const predictedRow = static_cast<int32_t>(std::floor(predicted[1] / length));
+    int32_t const predictedCol = static_cast<int32_t>(std::floor(predicted[0] / length));
+
+    // Move the generated pages to the cache.
+    std::vector<std::pair<Key, Generated>> generated{};
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        generated.swap(mGenerated);
+    }
+    for (auto& element : generated)
+    {
+        mRequested.erase(element.first);
+        mCache[element.first] = std::move(element.second);
+    }
+
+    // Replace the vertices of the pages whose world locations changed,
+    // nearest to the camera first.
+    std::vector<std::pair<int32_t, size_t>> stale{};
+    for (size_t i = 0; i < mSlots.size(); ++i)
+    {
+        Slot& slot = mSlots[i];
+        int32_t const row = slot.page->GetWorldRow();
+        int32_t const col = slot.page->GetWorldCol();
+        if (!slot.hasCurrent || slot.current != GetKey(row, col))
+        {
+            slot.hasCurrent = false;
+            slot.page->culling = CullingMode::ALWAYS;
+            int32_t distance = std::max(std::abs(row - cameraRow), std::abs(col - cameraCol));
+            stale.push_back(std::make_pair(distance, i));
+        }
+    }
+    std::sort(stale.begin(), stale.end());
+
+    size_t numUploaded = 0, numBytes = 0;
+    for (auto const& element : stale)
+    {
+        Slot& slot = mSlots[element.second];
+        Key const key = GetKey(slot.page->GetWorldRow(), slot.page->GetWorldCol());
+        auto iter = mCache.find(key);
+        if (iter == mCache.end() || !iter->second.succeeded)
+        {
+            continue;
+        }
+
+        size_t const bytes = iter->second.vbuffer->GetNumBytes();
+        if (numUploaded > 0 && numBytes + bytes > mUploadBudget)
+        {
+            break;
+        }
+
+        mUpload(iter->second.vbuffer);
+        slot.page->SetVertices(std::move(iter->second.heights),
+            iter->second.vbuffer, iter->second.bound);
+        slot.page->culling = slot.culling;
+        slot.current = key;
+        slot.hasCurrent = true;
+        mCache.erase(iter);
+        ++numUploaded;
+        numBytes += bytes;
+    }
+    if (numUploaded > 0)
+    {
+        mTerrain->Update();
+    }
+
+    // Replace the queue by the locations of the current pages followed by
+    // those of the prefetched pages. Requests that the background thread
+    // has already taken are not repeated.
+    std::vector<Request> requests{};
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        for (auto const& request : mQueue)
+        {
+            mRequested.erase(request.key);
+        }
+        mNumPending -= mQueue.size();
+        mQueue.clear();
+    }
+    RequestWindow(cameraRow, cameraCol, requests);
+    RequestWindow(predictedRow, predictedCol, requests);
+    if (!requests.empty())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mQueue.insert(mQueue.end(), requests.begin(), requests.end());
+            mNumPending += requests.size();
+        }
+        mCondition.notify_one();
+    }
+
+    // Evict generated pages outside both windows when the cache is full.
+    if (mCache.size() > mCacheCapacity)
+    {
+        int32_t const numRows = static_cast<int32_t>(mTerrain->mNumRows);
+        int32_t const numCols = static_cast<int32_t>(mTerrain->mNumCols);
+        auto InWindow = [numRows, numCols](int32_t row, int32_t col,
+            int32_t centerRow, int32_t centerCol)
+        {
+            int32_t const rmin = centerRow - numRows / 2;
+            int32_t const cmin = centerCol - numCols / 2;
+            return rmin <= row && row < rmin + numRows && cmin <= col && col < cmin + numCols;
+        };
+
+        for (auto iter = mCache.begin(); iter != mCache.end() && mCache.size() > mCacheCapacity; )
+        {
+            int32_t const row = static_cast<int32_t>(static_cast<uint32_t>(iter->first >> 32));
+            int32_t const col = static_cast<int32_t>(static_cast<uint32_t>(iter->first));
+            if (InWindow(row, col, cameraRow, cameraCol)
+                || InWindow(row, col, predictedRow, predictedCol))
+            {
+                ++iter;
+            }
+            else
+            {
+                iter = mCache.erase(iter);
+            }
+        }
+    }
+}
+
+bool TerrainStreamer::IsCurrent(size_t row, size_t col) const
+{
+    LogAssert(row < mTerrain->mNumRows && col < mTerrain->mNumCols, "Invalid page.");
+    Slot const& slot = mSlots[col + mTerrain->mNumCols * row];
+    return slot.hasCurrent
+        && slot.current == GetKey(slot.page->GetWorldRow(), slot.page->GetWorldCol());
+}
+
+size_t TerrainStreamer::GetNumPending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumPending;
+}
+
+size_t TerrainStreamer::GetSlot(int32_t row, int32_t col) const
+{
+    int32_t const numRows = static_cast<int32_t>(mTerrain->mNumRows);
+    int32_t const numCols = static_cast<int32_t>(mTerrain->mNumCols);
+    int32_t r = row % numRows, c = col % numCols;
+    r += (r < 0 ? numRows : 0);
+    c += (c < 0 ? numCols : 0);
+    return static_cast<size_t>(c) + mTerrain->mNumCols * static_cast<size_t>(r);
+}
+
+void TerrainStreamer::RequestWindow(int32_t centerRow, int32_t centerCol,
+    std::vector<Request>& requests)
+{
+    // The window is that of Terrain::OnCameraMotion for a camera in the
+    // center page.
+    int32_t const numRows = static_cast<int32_t>(mTerrain->mNumRows);
+    int32_t const numCols = static_cast<int32_t>(mTerrain->mNumCols);
+    int32_t const rmin = centerRow - numRows / 2;
+    int32_t const cmin = centerCol - numCols / 2;
+
+    std::vector<std::pair<int32_t, Request>> window{};
+    for (int32_t row = rmin; row < rmin + numRows; ++row)
+    {
+        for (int32_t col = cmin; col < cmin + numCols; ++col)
+        {
+            Request request{};
+            request.key = GetKey(row, col);
+            request.row = row;
+            request.col = col;
+            request.slot = GetSlot(row, col);
+
+            Slot const& slot = mSlots[request.slot];
+            bool const isCurrent = (slot.hasCurrent && slot.current == request.key);
+            if (!isCurrent && mCache.find(request.key) == mCache.end()
+                && mRequested.insert(request.key).second)
+            {
+                int32_t distance = std::max(std::abs(row - centerRow), std::abs(col - centerCol));
+                window.push_back(std::make_pair(distance, request));
+            }
+        }
+    }
+
+    std::stable_sort(window.begin(), window.end(),
+        [](std::pair<int32_t, Request> const& element0,
+            std::pair<int32_t, Request> const& element1)
+        {
+            return element0.first < element1.first;
+        });
+
+    for (auto const& element : window)
+    {
+        requests.push_back(element.second);
+    }
+}
+
+void TerrainStreamer::GenerateLoop()
+{
+    for (;;)
+    {
+        Request request{};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+            if (mStop)
+            {
+                return;
+            }
+            request = mQueue.front();
+            mQueue.pop_front();
+        }
+
+        // The pages and their source vertices are not modified by the
+        // thread that draws while the streamer exists, except for the
+        // members that CreateVertices does not access. The loader reports
+        // errors by exceptions, which must not escape the thread.
+        Slot const& slot = mSlots[request.slot];
+        Generated result{};
+        result.succeeded = false;
+        try
+        {
+            if (mLoader(request.row, request.col, result.heights))
+            {
+                result.vbuffer = slot.page->CreateVertices(*slot.source,
+                    result.heights, result.bound);
+                result.succeeded = true;
+            }
+        }
+        catch (std::exception const&)
+        {
+            result.succeeded = false;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mGenerated.push_back(std::make_pair(request.key, std::move(result)));
+        --mNumPending;
+    }
+}
@@ -0,0 +1,208 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Terrain.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Streaming of the heights of a Terrain from an unbounded grid of pages.
+// Terrain::OnCameraMotion moves the pages with toroidal wraparound so that
+// they surround the camera, and each page then represents a page of the
+// grid, its world location. The streamer loads the heights of the world
+// locations and generates the vertices, normals and model bounds on a
+// background thread. Each call to Update replaces the vertex buffers of the
+// pages whose world locations changed, as long as the bytes of the new
+// buffers stay within the upload budget; the nearest pages are replaced
+// first. A page whose vertices are not yet generated for its world
+// location is culled, so stale heights are never drawn.
+//
+// The pages that the camera will need are prefetched: the position of the
+// camera is extrapolated by its motion since the previous Update, and the
+// world locations of the pages around the extrapolated position are
+// generated when the background thread has no pages to generate for the
+// current locations. Generated pages that are not used stay in a cache of
+// limited size.
+//
+// The loader is called on the background thread. It receives the world
+// location, which is unbounded, and the application chooses how locations
+// map to its data. For example, heights stored page after page in a file
+// of numRows-by-numCols pages can be memory-mapped with FileMapping, so
+// only the pages that are read become resident:
+//
+//   auto mapping = std::make_shared<FileMapping>("Heights.raw");
+//   size_t const pageSize = size * size;
+//   TerrainStreamer streamer(terrain,
+//       [mapping, pageSize, numRows, numCols](int32_t row, int32_t col,
+//           std::vector<uint16_t>& heights)
+//       {
+//           int64_t r = row % numRows, c = col % numCols;
+//           r += (r < 0 ? numRows : 0);
+//           c += (c < 0 ? numCols : 0);
+//           auto source = reinterpret_cast<uint16_t const*>(mapping->GetData())
+//               + (c + numCols * r) * pageSize;
+//           heights.assign(source, source + pageSize);
+//           return true;
+//       },
+//       [this](std::shared_ptr<Buffer> const& buffer) { mEngine->Bind(buffer); },
+//       4 << 20);
+//
+//   // Each frame, on the thread that draws.
+//   terrain->OnCameraMotion();
+//   streamer.Update();
+//
+// The 'upload' function object creates the GPU resource of a new vertex
+// buffer, typically by calling GraphicsEngine::Bind. The old vertex buffer
+// of a page is released, and with it its GPU resource. While the streamer
+// exists, the application must not call Terrain::SetHeights, and all member
+// functions must be called on the thread that draws the terrain.
+
+namespace gte
+{
+    class TerrainStreamer
+    {
+    public:
+        // The loader returns false when the heights of the location are not
+        // available, in which case the page remains culled. It must store
+        // at least size*size heights in row-major order.
+        typedef std::function<bool(int32_t, int32_t, std::vector<uint16_t>&)> HeightLoader;
+
+        // The upload budget is in bytes per call to Update, but at least one
+        // page is replaced per call. The prefetch time is the number of
+        // calls to Update over which the camera motion is extrapolated.
+        TerrainStreamer(std::shared_ptr<Terrain> const& terrain,
+            HeightLoader const& loader, BufferUpdater const& upload,
+            size_t uploadBudget, float prefetchTime = 30.0f);
+
+        ~TerrainStreamer();
+
+        // Disallow copy and assignment.
+        TerrainStreamer(TerrainStreamer const&) = delete;
+        TerrainStreamer& operator=(TerrainStreamer const&) = delete;
+
+        // Request the pages of the current and prefetched world locations
+        // and replace the vertices of the pages whose vertices are
+        // generated. Call this once per frame after Terrain::OnCameraMotion.
+        void Update();
+
+        // Member access.
+        inline void SetUploadBudget(size_t uploadBudget)
+        {
+            mUploadBudget = uploadBudget;
+        }
+
+        inline size_t GetUploadBudget() const
+        {
+            return mUploadBudget;
+        }
+
+        inline void SetPrefetchTime(float prefetchTime)
+        {
+            mPrefetchTime = prefetchTime;
+        }
+
+        inline float GetPrefetchTime() const
+        {
+            return mPrefetchTime;
+        }
+
+        // Whether the page (row,col) of the terrain has the vertices of its
+        // current world location.
+        bool IsCurrent(size_t row, size_t col) const;
+
+        // The number of requests that are not yet generated.
+        size_t GetNumPending() const;
+
+    private:
+        // A world location packed into 64 bits.
+        typedef uint64_t Key;
+
+        static inline Key GetKey(int32_t row, int32_t col)
+        {
+            return (static_cast<Key>(static_cast<uint32_t>(row)) << 32)
+                | static_cast<Key>(static_cast<uint32_t>(col));
+        }
+
+        struct Request
+        {
+            Key key;
+            int32_t row, col;
+            size_t slot;
+        };
+
+        struct Generated
+        {
+            std::vector<uint16_t> heights;
+            std::shared_ptr<VertexBuffer> vbuffer;
+            BoundingSphere<float> bound;
+            bool succeeded;
+        };
+
+        struct Slot
+        {
+            std::shared_ptr<Terrain::Page> page;
+
+            // A copy of the vertices of the page at construction, which
+            // provides the attributes other than the positions and normals.
+            std::shared_ptr<VertexBuffer> source;
+
+            // The culling mode of the page at construction, which is
+            // restored when the page becomes current.
+            CullingMode culling;
+
+            Key current;
+            bool hasCurrent;
+        };
+
+        // The index of the page of the terrain that represents the world
+        // location.
+        size_t GetSlot(int32_t row, int32_t col) const;
+
+        // Append to the requests the locations of the pages around the
+        // center page that are not generated or requested, nearest first.
+        void RequestWindow(int32_t centerRow, int32_t centerCol,
+            std::vector<Request>& requests);
+
+        void GenerateLoop();
+
+        std::shared_ptr<Terrain> mTerrain;
+        HeightLoader mLoader;
+        BufferUpdater mUpload;
+        size_t mUploadBudget;
+        float mPrefetchTime;
+        std::vector<Slot> mSlots;
+
+        // The camera position in the model space of the terrain at the
+        // previous Update.
+        Vector2<float> mPreviousEye;
+        bool mHasPreviousEye;
+
+        // The generated pages that are not yet applied, and the keys that
+        // are queued or being generated.
+        std::unordered_map<Key, Generated> mCache;
+        std::unordered_set<Key> mRequested;
+        size_t mCacheCapacity;
+
+        // Shared with the background thread.
+        mutable std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::deque<Request> mQueue;
+        std::vector<std::pair<Key, Generated>> mGenerated;
+        size_t mNumPending;
+        bool mStop;
+        std::thread mThread;
+    };
+}
@@ -0,0 +1,395 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/TetrahedraVoxelizer.h>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+using namespace gte;
+
+TetrahedraVoxelizer::TetrahedraVoxelizer(std::shared_ptr<GraphicsEngine> const& engine,
+    std::shared_ptr<ProgramFactory> const& factory)
+    :
+    mEngine(engine)
+{
+    if (!engine || !factory)
+    {
+        return;
+    }
+
+    mConstants = std::make_shared<ConstantBuffer>(sizeof(GridConstants), true);
+
+    mClearProgram = CreateProgram(factory, msClearSource,
+        msNumClearThreads, msNumClearThreads, msNumClearThreads);
+    mClearProgram->GetComputeShader()->Set("Grid", mConstants);
+
+    mRasterizeProgram = CreateProgram(factory, msRasterizeSource,
+        msNumRasterizeThreads, 1, 1);
+    mRasterizeProgram->GetComputeShader()->Set("Grid", mConstants);
+}
+
+void TetrahedraVoxelizer::operator()(Device device, size_t numThreads,
+    size_t numVertices, std::array<float, 3> const* vertices,
+    size_t numTetrahedra, std::array<size_t, 4> const* tetrahedra,
+    std::array<float, 3> const& regionMin, std::array<float, 3> const& regionMax,
+    std::array<size_t, 3> const& bound, std::vector<int32_t>& grid)
+{
+    if (device == Device::CPU)
+    {
+        TetrahedraRasterizer<float> rasterizer(numVertices, vertices, numTetrahedra, tetrahedra);
+        rasterizer(numThreads, regionMin, regionMax, bound, grid);
+        return;
+    }
+
+    Rasterize(numVertices, vertices, numTetrahedra, tetrahedra, regionMin, regionMax, bound);
+    mEngine->CopyGpuToCpu(mGrid);
+    grid.resize(bound[0] * bound[1] * bound[2]);
+    std::memcpy(grid.data(), mGrid->GetData(), grid.size() * sizeof(int32_t));
+}
+
+void TetrahedraVoxelizer::Rasterize(size_t numVertices, std::array<float, 3> const* vertices,
+    size_t numTetrahedra, std::array<size_t, 4> const* tetrahedra,
+    std::array<float, 3> const& regionMin, std::array<float, 3> const& regionMax,
+    std::array<size_t, 3> const& bound)
+{
+    LogAssert(IsGPUAvailable(), "The voxelizer was created without a graphics engine.");
+    LogAssert(numTetrahedra <= static_cast<size_t>(std::numeric_limits<int32_t>::max()),
+        "Too many tetrahedra.");
+
+    // The bounding boxes and the grid coordinates of the vertices are those
+    // of the CPU rasterizer, which also validates the arguments.
+    TetrahedraRasterizer<float> rasterizer(numVertices, vertices, numTetrahedra, tetrahedra);
+    rasterizer.Prepare(regionMin, regionMax, bound);
+    auto const& gridVertices = rasterizer.GetGridVertices();
+    auto const& gridTetraMin = rasterizer.GetGridTetraMin();
+    auto const& gridTetraMax = rasterizer.GetGridTetraMax();
+
+    // Only the tetrahedra that intersect the region are passed to the
+    // GPU, each with its index.
+    uint32_t numValid = 0;
+    for (size_t t = 0; t < numTetrahedra; ++t)
+    {
+        if (rasterizer.IsValid(t))
+        {
+            ++numValid;
+        }
+    }
+
+    if (!mTetrahedra || mTetrahedra->GetNumElements() < numValid)
+    {
+        uint32_t const capacity = std::max(numValid, 1u);
+        mTetrahedra = std::make_shared<StructuredBuffer>(capacity, sizeof(Tetrahedron));
+        mTetrahedra->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+        mRasterizeProgram->GetComputeShader()->Set("tetrahedra", mTetrahedra);
+    }
+
+    auto records = mTetrahedra->Get<Tetrahedron>();
+    for (size_t t = 0, i = 0; t < numTetrahedra; ++t)
+    {
+        if (rasterizer.IsValid(t))
+        {
+            auto& record = records[i++];
+            for (size_t j = 0; j < 4; ++j)
+            {
+                auto const& V = gridVertices[tetrahedra[t][j]];
+                record.vertex[j] = { V[0], V[1], V[2], 0.0f };
+            }
+            for (size_t j = 0; j < 3; ++j)
+            {
+                record.imin[j] = static_cast<uint32_t>(gridTetraMin[t][j]);
+                record.imax[j] = static_cast<uint32_t>(gridTetraMax[t][j]);
+            }
+            record.imin[3] = static_cast<uint32_t>(t);
+            record.imax[3] = 0;
+        }
+    }
+    if (numValid > 0)
+    {
+        mTetrahedra->SetNumActiveElements(numValid);
+        mEngine->Update(mTetrahedra);
+    }
+
+    // The grid texture is created again when the bound changes.
+    if (!mGrid || mGrid->GetWidth() != bound[0] || mGrid->GetHeight() != bound[1] ||
+        mGrid->GetThickness() != bound[2])
+    {
+        mGrid = std::make_shared<Texture3>(DF_R32_SINT, static_cast<uint32_t>(bound[0]),
+            static_cast<uint32_t>(bound[1]), static_cast<uint32_t>(bound[2]));
+        mGrid->SetUsage(Resource::Usage::SHADER_OUTPUT);
+        mGrid->SetCopy(Resource::Copy::STAGING_TO_CPU);
+        mClearProgram->GetComputeShader()->Set("grid", mGrid);
+        mRasterizeProgram->GetComputeShader()->Set("grid", mGrid);
+    }
+
+    auto& gridInfo = mConstants->Get<GridConstants>()->gridInfo;
+    gridInfo[0] = static_cast<uint32_t>(bound[0]);
+    gridInfo[1] = static_cast<uint32_t>(bound[1]);
+    gridInfo[2] = static_cast<uint32_t>(bound[2]);
+    gridInfo[3] = numValid;
+    mEngine->Update(mConstants);
+
+    mEngine->Execute(mClearProgram,
+        (gridInfo[0] + msNumClearThreads - 1) / msNumClearThreads,
+        (gridInfo[1] + msNumClearThreads - 1) / msNumClearThreads,
+        (gridInfo[2] + msNumClearThreads - 1) / msNumClearThreads);
+
+    if (numValid > 0)
+    {
+        mEngine->Execute(mRasterizeProgram,
+            (numValid + msNumRasterizeThreads - 1) / msNumRasterizeThreads, 1, 1);
+    }
+}
+
+std::shared_ptr<ComputeProgram> TetrahedraVoxelizer::CreateProgram(
+    std::shared_ptr<ProgramFactory> const& factory, ProgramSources const& sources,
+    uint32_t numXThreads, uint32_t numYThreads, uint32_t numZThreads)
+{
+    factory->PushDefines();
+    factory->defines.Set("NUM_X_THREADS", numXThreads);
+    factory->defines.Set("NUM_Y_THREADS", numYThreads);
+    factory->defines.Set("NUM_Z_THREADS", numZThreads);
+    auto program = factory->CreateFromSource(*sources[factory->GetAPI()]);
+    factory->PopDefines();
+    LogAssert(program != nullptr, "Failed to compile the voxelizer programs.");
+    return program;
+}
+
+std::string const TetrahedraVoxelizer::msGLSLClearSource =
+R"(
+    uniform Grid
+    {
+        uvec4 gridInfo;
+    };
+
+    layout(r32i) uniform iimage3D grid;
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = NUM_Y_THREADS, local_size_z = NUM_Z_THREADS) in;
+    void main()
+    {
+        uvec3 t = gl_GlobalInvocationID;
+        if (all(lessThan(t, gridInfo.xyz)))
+        {
+            imageStore(grid, ivec3(t), ivec4(-1));
+        }
+    }
+)";
+
+std::string const TetrahedraVoxelizer::msHLSLClearSource =
+R"(
+    cbuffer Grid
+    {
+        uint4 gridInfo;
+    };
+
+    RWTexture3D<int> grid;
+
+    [numthreads(NUM_X_THREADS, NUM_Y_THREADS, NUM_Z_THREADS)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        if (all(t < gridInfo.xyz))
+        {
+            grid[t] = -1;
+        }
+    }
+)";
+
+ProgramSources const TetrahedraVoxelizer::msClearSource =
+{
+    &msGLSLClearSource,
+    &msHLSLClearSource
+};
+
+// The point test is that of TetrahedraRasterizer::PointInTetrahedron, with
+// Dot(U, Cross(V, W)) evaluated in the same order.
+std::string const TetrahedraVoxelizer::msGLSLRasterizeSource =
+R"(
+    uniform Grid
+    {
+        uvec4 gridInfo;
+    };
+
+    struct Tetrahedron
+    {
+        vec4 vertex[4];
+        uvec4 imin;
+        uvec4 imax;
+    };
+
+    buffer tetrahedra { Tetrahedron data[]; } tetrahedraSB;
+    layout(r32i) uniform iimage3D grid;
+
+    float DotCross(vec3 U, vec3 V, vec3 W)
+    {
+        precise float c0 = V.y * W.z - V.z * W.y;
+        precise float c1 = V.z * W.x - V.x * W.z;
+        precise float c2 = V.x * W.y - V.y * W.x;
+        precise float dot = U.x * c0 + U.y * c1 + U.z * c2;
+        return dot;
+    }
+
+    bool PointInTetrahedron(vec3 P, vec3 V0, vec3 V1, vec3 V2, vec3 V3)
+    {
+        precise vec3 PmV0 = P - V0;
+        precise vec3 V1mV0 = V1 - V0;
+        precise vec3 V2mV0 = V2 - V0;
+        precise vec3 V3mV0 = V3 - V0;
+        precise vec3 PmV1 = P - V1;
+        precise vec3 V2mV1 = V2 - V1;
+        precise vec3 V3mV1 = V3 - V1;
+        return !(DotCross(PmV0, V2mV0, V1mV0) > 0.0f)
+            && !(DotCross(PmV0, V1mV0, V3mV0) > 0.0f)
+            && !(DotCross(PmV0, V3mV0, V2mV0) > 0.0f)
+            && !(DotCross(PmV1, V2mV1, V3mV1) > 0.0f);
+    }
+
+    layout (local_size_x = NUM_X_THREADS, local_size_y = NUM_Y_THREADS, local_size_z = NUM_Z_THREADS) in;
+    void main()
+    {
+        uint i = gl_GlobalInvocationID.x;
+        if (i >= gridInfo.w)
+        {
+            return;
+        }
+
+        Tetrahedron tetra = tetrahedraSB.data[i];
+        vec3 V0 = tetra.vertex[0].xyz;
+        vec3 V1 = tetra.vertex[1].xyz;
+        vec3 V2 = tetra.vertex[2].xyz;
+        vec3 V3 = tetra.vertex[3].xyz;
+        int index = int(tetra.imin.w);
+        for (uint i2 = tetra.imin.z; i2 <= tetra.imax.z; ++i2)
+        {
+            for (uint i1 = tetra.imin.y; i1 <= tetra.imax.y; ++i1)
+            {
+                uint i0min;
+                for (i0min = tetra.imin.x; i0min <= tetra.imax.x; ++i0min)
+                {
+                    if (PointInTetrahedron(vec3(float(i0min), float(i1), float(i2)), V0, V1, V2, V3))
+                    {
+                        break;
+                    }
+                }
+                if (i0min > tetra.imax.x)
+                {
+                    continue;
+                }
+
+                uint i0max;
+                for (i0max = tetra.imax.x; i0max > i0min; --i0max)
+                {
+                    if (PointInTetrahedron(vec3(float(i0max), float(i1), float(i2)), V0, V1, V2, V3))
+                    {
+                        break;
+                    }
+                }
+
+                for (uint i0 = i0min; i0 <= i0max; ++i0)
+                {
+                    imageAtomicMax(grid, ivec3(i0, i1, i2), index);
+                }
+            }
+        }
+    }
+)";
+
+std::string const TetrahedraVoxelizer::msHLSLRasterizeSource =
+R"(
+    cbuffer Grid
+    {
+        uint4 gridInfo;
+    };
+
+    struct Tetrahedron
+    {
+        float4 vertex[4];
+        uint4 imin;
+        uint4 imax;
+    };
+
+    StructuredBuffer<Tetrahedron> tetrahedra;
+    RWTexture3D<int> grid;
+
+    float DotCross(float3 U, float3 V, float3 W)
+    {
+        precise float c0 = V.y * W.z - V.z * W.y;
+        precise float c1 = V.z * W.x - V.x * W.z;
+        precise float c2 = V.x * W.y - V.y * W.x;
+        precise float dot = U.x * c0 + U.y * c1 + U.z * c2;
+        return dot;
+    }
+
+    bool PointInTetrahedron(float3 P, float3 V0, float3 V1, float3 V2, float3 V3)
+    {
+        precise float3 PmV0 = P - V0;
+        precise float3 V1mV0 = V1 - V0;
+        precise float3 V2mV0 = V2 - V0;
+        precise float3 V3mV0 = V3 - V0;
+        precise float3 PmV1 = P - V1;
+        precise float3 V2mV1 = V2 - V1;
+        precise float3 V3mV1 = V3 - V1;
+        return !(DotCross(PmV0, V2mV0, V1mV0) > 0.0f)
+            && !(DotCross(PmV0, V1mV0, V3mV0) > 0.0f)
+            && !(DotCross(PmV0, V3mV0, V2mV0) > 0.0f)
+            && !(DotCross(PmV1, V2mV1, V3mV1) > 0.0f);
+    }
+
+    [numthreads(NUM_X_THREADS, NUM_Y_THREADS, NUM_Z_THREADS)]
+    void CSMain(uint3 t : SV_DispatchThreadID)
+    {
+        uint i = t.x;
+        if (i >= gridInfo.w)
+        {
+            return;
+        }
+
+        Tetrahedron tetra = tetrahedra[i];
+        float3 V0 = tetra.vertex[0].xyz;
+        float3 V1 = tetra.vertex[1].xyz;
+        float3 V2 = tetra.vertex[2].xyz;
+        float3 V3 = tetra.vertex[3].xyz;
+        int index = int(tetra.imin.w);
+        for (uint i2 = tetra.imin.z; i2 <= tetra.imax.z; ++i2)
+        {
+            for (uint i1 = tetra.imin.y; i1 <= tetra.imax.y; ++i1)
+            {
+                uint i0min;
+                for (i0min = tetra.imin.x; i0min <= tetra.imax.x; ++i0min)
+                {
+                    if (PointInTetrahedron(float3(i0min, i1, i2), V0, V1, V2, V3))
+                    {
+                        break;
+                    }
+                }
+                if (i0min > tetra.imax.x)
+                {
+                    continue;
+                }
+
+                uint i0max;
+                for (i0max = tetra.imax.x; i0max > i0min; --i0max)
+                {
+                    if (PointInTetrahedron(float3(i0max, i1, i2), V0, V1, V2, V3))
+                    {
+                        break;
+                    }
+                }
+
+                for (uint i0 = i0min; i0 <= i0max; ++i0)
+                {
+                    InterlockedMax(grid[uint3(i0, i1, i2)], index);
+                }
+            }
+        }
+    }
+)";
+
+ProgramSources const TetrahedraVoxelizer::msRasterizeSource =
+{
+    &msGLSLRasterizeSource,
+    &msHLSLRasterizeSource
+};
@@ -0,0 +1,131 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/TetrahedraRasterizer.h>
+#include <Graphics/ComputeProgram.h>
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/GraphicsEngine.h>
+#include <Graphics/ProgramFactory.h>
+#include <Graphics/StructuredBuffer.h>
+#include <Graphics/Texture3.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Rasterization of tetrahedra into a 3D grid, for example the occupancy
+// grid from which a signed distance field of a collision mesh is computed,
+// either on CPU threads by TetrahedraRasterizer<float> or by a compute
+// program. The grid is that of TetrahedraRasterizer: grid[i] for the point
+// (x,y,z) with i = x + bound[0] * (y + bound[1] * z) is -1 when the point is
+// not contained by a tetrahedron and otherwise the largest index of the
+// tetrahedra that contain it.
+//
+// The compute program runs one thread per tetrahedron. A thread visits the
+// rows of the grid points in the bounding box of its tetrahedron, finds the
+// first and last points of a row that are contained by the tetrahedron and
+// stores its index in the points between them with an atomic maximum. The
+// bounding boxes and grid coordinates are computed by
+// TetrahedraRasterizer<float>::Prepare, and the shader evaluates the point
+// test of TetrahedraRasterizer::PointInTetrahedron with the same float
+// operations in the same order, marked 'precise' so that they are not
+// contracted into fused multiply-adds, so the two devices produce the same
+// grid. This requires the CPU code to be compiled without contractions
+// (MSVC /fp:precise, or -ffp-contract=off for GCC and Clang).
+//
+// The grid of the compute program is a Texture3 with format DF_R32_SINT,
+// which GetGridTexture() returns for compute programs that process the grid
+// further; operator() also copies it to the CPU. The dimensions of a 3D
+// texture are limited to 2048 by Direct3D 11.
+
+namespace gte
+{
+    class TetrahedraVoxelizer
+    {
+    public:
+        enum class Device
+        {
+            CPU,
+            GPU
+        };
+
+        // The engine and the factory may be null, in which case only the
+        // CPU device is available.
+        TetrahedraVoxelizer(std::shared_ptr<GraphicsEngine> const& engine,
+            std::shared_ptr<ProgramFactory> const& factory);
+
+        inline bool IsGPUAvailable() const
+        {
+            return mRasterizeProgram != nullptr;
+        }
+
+        // Rasterize the tetrahedra with the arguments of the constructor
+        // and operator() of TetrahedraRasterizer. The numThreads argument
+        // is used by the CPU device only.
+        void operator()(Device device, size_t numThreads,
+            size_t numVertices, std::array<float, 3> const* vertices,
+            size_t numTetrahedra, std::array<size_t, 4> const* tetrahedra,
+            std::array<float, 3> const& regionMin, std::array<float, 3> const& regionMax,
+            std::array<size_t, 3> const& bound, std::vector<int32_t>& grid);
+
+        // Rasterize the tetrahedra into the grid texture without copying
+        // it to the CPU.
+        void Rasterize(size_t numVertices, std::array<float, 3> const* vertices,
+            size_t numTetrahedra, std::array<size_t, 4> const* tetrahedra,
+            std::array<float, 3> const& regionMin, std::array<float, 3> const& regionMax,
+            std::array<size_t, 3> const& bound);
+
+        // The grid of the last call of Rasterize, or null before the first
+        // call.
+        inline std::shared_ptr<Texture3> const& GetGridTexture() const
+        {
+            return mGrid;
+        }
+
+    private:
+        // The tetrahedron in grid coordinates. The fourth components of
+        // imin and imax are the index of the tetrahedron and 0.
+        struct Tetrahedron
+        {
+            std::array<float, 4> vertex[4];
+            uint32_t imin[4];
+            uint32_t imax[4];
+        };
+
+        // The constants of the programs, where gridInfo is
+        // (bound[0], bound[1], bound[2], numTetrahedra).
+        struct GridConstants
+        {
+            uint32_t gridInfo[4];
+        };
+
+        std::shared_ptr<ComputeProgram> CreateProgram(
+            std::shared_ptr<ProgramFactory> const& factory,
+            ProgramSources const& sources, uint32_t numXThreads,
+            uint32_t numYThreads, uint32_t numZThreads);
+
+        std::shared_ptr<GraphicsEngine> mEngine;
+        std::shared_ptr<ConstantBuffer> mConstants;
+        std::shared_ptr<StructuredBuffer> mTetrahedra;
+        std::shared_ptr<Texture3> mGrid;
+        std::shared_ptr<ComputeProgram> mClearProgram;
+        std::shared_ptr<ComputeProgram> mRasterizeProgram;
+
+        static uint32_t constexpr msNumClearThreads = 4;
+        static uint32_t constexpr msNumRasterizeThreads = 64;
+
+        static std::string const msGLSLClearSource;
+        static std::string const msHLSLClearSource;
+        static ProgramSources const msClearSource;
+        static std::string const msGLSLRasterizeSource;
+        static std::string const msHLSLRasterizeSource;
+        static ProgramSources const msRasterizeSource;
+    };
+}
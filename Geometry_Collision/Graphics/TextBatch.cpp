@@ -0,0 +1,156 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/TextBatch.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+using namespace gte;
+
+TextBatch::TextBatch(std::shared_ptr<Font> const& font, uint32_t maxCharacters)
+    :
+    mFont(font),
+    mMaxCharacters(maxCharacters),
+    mNumEntries(0),
+    mNumCharacters(0),
+    mNumTypesetCharacters(0),
+    mViewportWidth(0),
+    mViewportHeight(0)
+{
+    LogAssert(mFont != nullptr && mMaxCharacters > 0, "Invalid input.");
+
+    VertexFormat vformat;
+    vformat.Bind(VASemantic::POSITION, DF_R32G32_FLOAT, 0);
+    vformat.Bind(VASemantic::TEXCOORD, DF_R32G32_FLOAT, 0);
+    vformat.Bind(VASemantic::COLOR, DF_R32G32B32A32_FLOAT, 0);
+    mVertexBuffer = std::make_shared<VertexBuffer>(vformat, 4 * mMaxCharacters);
+    mVertexBuffer->SetUsage(Resource::Usage::DYNAMIC_UPDATE);
+    mVertexBuffer->SetNumActiveElements(0);
+
+    // The quads use the vertex and index ordering of Font.
+    // 0 -- 2   4 -- 6  ...
+    // | \  |   | \  |
+    // |  \ |   |  \ |
+    // 1 -- 3   5 -- 7  ...
+    mIndexBuffer = std::make_shared<IndexBuffer>(IP_TRIMESH, 2 * mMaxCharacters, sizeof(uint32_t));
+    auto indices = mIndexBuffer->Get<uint32_t>();
+    for (uint32_t i = 0; i < mMaxCharacters; ++i)
+    {
+        indices[6 * i + 0] = 4 * i;
+        indices[6 * i + 1] = 4 * i + 3;
+        indices[6 * i + 2] = 4 * i + 1;
+        indices[6 * i + 3] = 4 * i;
+        indices[6 * i + 4] = 4 * i + 2;
+        indices[6 * i + 5] = 4 * i + 3;
+    }
+    mIndexBuffer->SetNumActivePrimitives(0);
+}
+
+void TextBatch::Clear()
+{
+    mNumEntries = 0;
+    mNumCharacters = 0;
+}
+
+void TextBatch::Add(int32_t x, int32_t y, std::array<float, 4> const& color,
+    std::string const& message)
+{
+    uint32_t const length = std::min(static_cast<uint32_t>(message.length()),
+        mMaxCharacters - mNumCharacters);
+    if (length == 0)
+    {
+        return;
+    }
+
+    if (mNumEntries == mEntries.size())
+    {
+        mEntries.push_back(Entry{ x, y, color, message, mNumCharacters, length, true });
+    }
+    else
+    {
+        // Compare with the string added at this position in the previous
+        // frame.
+        Entry& entry = mEntries[mNumEntries];
+        if (entry.x != x || entry.y != y || entry.color != color
+            || entry.first != mNumCharacters || entry.length != length
+            || entry.message.compare(0, length, message, 0, length) != 0)
+        {
+            entry.x = x;
+            entry.y = y;
+            entry.color = color;
+            entry.message.assign(message, 0, length);
+            entry.first = mNumCharacters;
+            entry.length = length;
+            entry.modified = true;
+        }
+    }
+
+    ++mNumEntries;
+    mNumCharacters += length;
+}
+
+bool TextBatch::Typeset(int32_t viewportWidth, int32_t viewportHeight)
+{
+    bool typesetAll = (viewportWidth != mViewportWidth || viewportHeight != mViewportHeight);
+    mViewportWidth = viewportWidth;
+    mViewportHeight = viewportHeight;
+
+    bool modified = (mNumCharacters != mNumTypesetCharacters);
+    auto vertices = mVertexBuffer->Get<Vertex>();
+    for (size_t i = 0; i < mNumEntries; ++i)
+    {
+        Entry& entry = mEntries[i];
+        if (entry.modified || typesetAll)
+        {
+            Typeset(entry, vertices);
+            entry.modified = false;
+            modified = true;
+        }
+    }
+
+    // The entries of the previous frame that were not added again no
+    // longer describe the contents of the vertex buffer.
+    mEntries.resize(mNumEntries);
+
+    mNumTypesetCharacters = mNumCharacters;
+    mVertexBuffer->SetNumActiveElements(4 * mNumCharacters);
+    mIndexBuffer->SetNumActivePrimitives(2 * mNumCharacters);
+    return modified;
+}
+
+void TextBatch::Typeset(Entry const& entry, Vertex* vertices) const
+{
+    // The positions are those of Font::Typeset after the translation of
+    // TextEffect, so the vertex shader only maps [0,1]^2 to clip space.
+    float const vdx = 1.0f / static_cast<float>(mViewportWidth);
+    float const vdy = 1.0f / static_cast<float>(mViewportHeight);
+    auto const& texture = mFont->GetTexture();
+    float const tw = static_cast<float>(texture->GetWidth());
+    float const th = static_cast<float>(texture->GetHeight());
+    float const* characterData = mFont->GetCharacterData();
+
+    Vector4<float> const color{ entry.color[0], entry.color[1], entry.color[2], entry.color[3] };
+    float const y0 = 1.0f - vdy * static_cast<float>(entry.y);
+    float const y1 = y0 + vdy * th;
+    float x0 = vdx * static_cast<float>(entry.x);
+    Vertex* v = vertices + 4 * static_cast<size_t>(entry.first);
+    for (uint32_t i = 0; i < entry.length; ++i, v += 4)
+    {
+        int32_t const c = static_cast<int32_t>(entry.message[i]);
+        float const tx0 = characterData[c];
+        float const tx1 = characterData[c + 1];
+        float const charWidthM1 = (tx1 - tx0) * tw - 1.0f;  // in pixels
+        float const x1 = x0 + charWidthM1 * vdx;
+
+        v[0] = { { x0, y0 }, { tx0, 0.0f }, color };
+        v[1] = { { x0, y1 }, { tx0, 1.0f }, color };
+        v[2] = { { x1, y0 }, { tx1, 0.0f }, color };
+        v[3] = { { x1, y1 }, { tx1, 1.0f }, color };
+
+        x0 = x1;
+    }
+}
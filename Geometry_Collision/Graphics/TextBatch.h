@@ -0,0 +1,110 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Font.h>
+#include <Mathematics/Vector2.h>
+#include <Mathematics/Vector4.h>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// The strings drawn in a frame, typeset into one vertex buffer so that
+// GraphicsEngine::Draw(TextBatch&) draws them with one draw call through the
+// TextBatchEffect of the font. Each frame, call Clear() and then Add() for
+// the strings in the same order as in the previous frame. The quads of a
+// string are typeset again only when the string, its position or color, its
+// offset in the vertex buffer or the viewport changed, so a frame of static
+// labels only updates the vertex buffer when one of them changes. Strings
+// beyond the capacity of the batch are truncated.
+
+namespace gte
+{
+    class TextBatch
+    {
+    public:
+        // Construction. The batch is drawn with the TextBatchEffect of the
+        // font.
+        TextBatch(std::shared_ptr<Font> const& font, uint32_t maxCharacters = 16384);
+
+        // Member access.
+        inline std::shared_ptr<Font> const& GetFont() const
+        {
+            return mFont;
+        }
+
+        inline std::shared_ptr<VertexBuffer> const& GetVertexBuffer() const
+        {
+            return mVertexBuffer;
+        }
+
+        inline std::shared_ptr<IndexBuffer> const& GetIndexBuffer() const
+        {
+            return mIndexBuffer;
+        }
+
+        inline uint32_t GetMaxCharacters() const
+        {
+            return mMaxCharacters;
+        }
+
+        inline uint32_t GetNumCharacters() const
+        {
+            return mNumCharacters;
+        }
+
+        // Remove the strings of the batch. The strings of the previous
+        // frame are remembered for the comparisons of Add.
+        void Clear();
+
+        // Append a string at window position (x,y) with the same meaning
+        // as for GraphicsEngine::Draw(x, y, color, message).
+        void Add(int32_t x, int32_t y, std::array<float, 4> const& color,
+            std::string const& message);
+
+        // Typeset the strings that changed since the previous call and set
+        // the numbers of active vertices and triangles. The return value is
+        // true when the vertex buffer was modified and must be updated in
+        // GPU memory.
+        bool Typeset(int32_t viewportWidth, int32_t viewportHeight);
+
+    private:
+        struct Vertex
+        {
+            Vector2<float> position, tcoord;
+            Vector4<float> color;
+        };
+
+        struct Entry
+        {
+            int32_t x, y;
+            std::array<float, 4> color;
+            std::string message;
+            uint32_t first, length;
+            bool modified;
+        };
+
+        void Typeset(Entry const& entry, Vertex* vertices) const;
+
+        std::shared_ptr<Font> mFont;
+        uint32_t mMaxCharacters;
+        std::shared_ptr<VertexBuffer> mVertexBuffer;
+        std::shared_ptr<IndexBuffer> mIndexBuffer;
+
+        // The entries [0,mNumEntries) are those of the current frame; the
+        // remaining ones are those of the previous frame that were not yet
+        // added again.
+        std::vector<Entry> mEntries;
+        size_t mNumEntries;
+        uint32_t mNumCharacters;
+        uint32_t mNumTypesetCharacters;
+        int32_t mViewportWidth, mViewportHeight;
+    };
+}
@@ -0,0 +1,151 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/TextBatchEffect.h>
+#include <Mathematics/Vector4.h>
+using namespace gte;
+
+TextBatchEffect::TextBatchEffect(std::shared_ptr<ProgramFactory> const& factory,
+    std::shared_ptr<Texture2> const& texture)
+{
+    int32_t api = factory->GetAPI();
+    mProgram = factory->CreateFromSources(*msVSSource[api], *msPSSource[api], "");
+    if (mProgram)
+    {
+        mNormalizedZ = std::make_shared<ConstantBuffer>(sizeof(Vector4<float>), false);
+        *mNormalizedZ->Get<Vector4<float>>() = { msDefaultNormalizedZ[api], 0.0f, 0.0f, 0.0f };
+        mSamplerState = std::make_shared<SamplerState>();
+
+        mProgram->GetVertexShader()->Set("NormalizedZ", mNormalizedZ);
+        mProgram->GetPixelShader()->Set("baseTexture", texture, "baseSampler", mSamplerState);
+    }
+}
+
+std::string const TextBatchEffect::msGLSLVSSource =
+R"(
+    uniform NormalizedZ
+    {
+        vec4 normalizedZ;
+    };
+
+    layout(location = 0) in vec2 modelPosition;
+    layout(location = 1) in vec2 modelTCoord;
+    layout(location = 2) in vec4 modelColor;
+    layout(location = 0) out vec2 vertexTCoord;
+    layout(location = 1) out vec4 vertexColor;
+
+    void main()
+    {
+        vertexTCoord = modelTCoord;
+        vertexColor = modelColor;
+        gl_Position.x = 2.0f * modelPosition.x - 1.0f;
+        gl_Position.y = 2.0f * modelPosition.y - 1.0f;
+        gl_Position.z = normalizedZ.x;
+        gl_Position.w = 1.0f;
+    }
+)";
+
+std::string const TextBatchEffect::msGLSLPSSource =
+R"(
+    layout(location = 0) in vec2 vertexTCoord;
+    layout(location = 1) in vec4 vertexColor;
+    layout(location = 0) out vec4 pixelColor;
+
+    uniform sampler2D baseSampler;
+
+    void main()
+    {
+        float bitmapAlpha = texture(baseSampler, vertexTCoord).r;
+        if (bitmapAlpha > 0.5f)
+        {
+            discard;
+        }
+        pixelColor = vertexColor;
+    }
+)";
+
+std::string const TextBatchEffect::msHLSLVSSource =
+R"(
+    cbuffer NormalizedZ
+    {
+        float4 normalizedZ;
+    };
+
+    struct VS_INPUT
+    {
+        float2 modelPosition : POSITION;
+        float2 modelTCoord : TEXCOORD0;
+        float4 modelColor : COLOR0;
+    };
+
+    struct VS_OUTPUT
+    {
+        float2 vertexTCoord : TEXCOORD0;
+        float4 vertexColor : COLOR0;
+        float4 clipPosition : SV_POSITION;
+    };
+
+    VS_OUTPUT VSMain (VS_INPUT input)
+    {
+        VS_OUTPUT output;
+        output.vertexTCoord = input.modelTCoord;
+        output.vertexColor = input.modelColor;
+        output.clipPosition.x = 2.0f * input.modelPosition.x - 1.0f;
+        output.clipPosition.y = 2.0f * input.modelPosition.y - 1.0f;
+        output.clipPosition.z = normalizedZ.x;
+        output.clipPosition.w = 1.0f;
+        return output;
+    }
+)";
+
+std::string const TextBatchEffect::msHLSLPSSource =
+R"(
+    Texture2D baseTexture;
+    SamplerState baseSampler;
+
+    struct PS_INPUT
+    {
+        float2 vertexTCoord : TEXCOORD0;
+        float4 vertexColor : COLOR0;
+    };
+
+    struct PS_OUTPUT
+    {
+        float4 pixelColor : SV_TARGET0;
+    };
+
+    PS_OUTPUT PSMain(PS_INPUT input)
+    {
+        PS_OUTPUT output;
+        float bitmapAlpha = baseTexture.Sample(baseSampler, input.vertexTCoord).r;
+        if (bitmapAlpha > 0.5f)
+        {
+            discard;
+        }
+        output.pixelColor = input.vertexColor;
+        return output;
+    }
+)";
+
+std::array<float, ProgramFactory::PF_NUM_API> const TextBatchEffect::msDefaultNormalizedZ =
+{
+    -1.0f,
+    0.0f
+};
+
+ProgramSources const TextBatchEffect::msVSSource =
+{
+    &msGLSLVSSource,
+    &msHLSLVSSource
+};
+
+ProgramSources const TextBatchEffect::msPSSource =
+{
+    &msGLSLPSSource,
+    &msHLSLPSSource
+};
@@ -0,0 +1,52 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/VisualEffect.h>
+#include <Graphics/ConstantBuffer.h>
+#include <Graphics/SamplerState.h>
+#include <Graphics/Texture2.h>
+
+namespace gte
+{
+    // The effect of TextBatch. It draws the glyphs of the font texture like
+    // TextEffect, but the vertices store their window position and their
+    // color, so strings at different positions and with different colors
+    // are drawn by one draw call. The vertex format is
+    //   vformat.Bind(VASemantic::POSITION, DF_R32G32_FLOAT, 0);
+    //   vformat.Bind(VASemantic::TEXCOORD, DF_R32G32_FLOAT, 0);
+    //   vformat.Bind(VASemantic::COLOR, DF_R32G32B32A32_FLOAT, 0);
+    // where the position is in normalized window coordinates [0,1]^2.
+    class TextBatchEffect : public VisualEffect
+    {
+    public:
+        // Construction.
+        TextBatchEffect(std::shared_ptr<ProgramFactory> const& factory,
+            std::shared_ptr<Texture2> const& texture);
+
+        inline std::shared_ptr<ConstantBuffer> const& GetNormalizedZ() const
+        {
+            return mNormalizedZ;
+        }
+
+    private:
+        std::shared_ptr<ConstantBuffer> mNormalizedZ;
+        std::shared_ptr<SamplerState> mSamplerState;
+
+        // Default normalized Z coordinate for rendered text.
+        static std::array<float, ProgramFactory::PF_NUM_API> const msDefaultNormalizedZ;
+
+        // Shader source code as strings.
+        static std::string const msGLSLVSSource;
+        static std::string const msGLSLPSSource;
+        static std::string const msHLSLVSSource;
+        static std::string const msHLSLPSSource;
+        static ProgramSources const msVSSource;
+        static ProgramSources const msPSSource;
+    };
+}
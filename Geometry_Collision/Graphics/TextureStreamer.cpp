@@ -0,0 +1,428 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/TextureStreamer.h>
+#include <Graphics/DataFormat.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+using namespace gte;
+
+namespace
+{
+    // The average of four texels of a channel, rounded to nearest for
+    // integer channels.
+    template <typename T>
+    T Average(T v0, T v1, T v2, T v3)
+    {
+        int64_t const sum = static_cast<int64_t>(v0) + static_cast<int64_t>(v1) +
+            static_cast<int64_t>(v2) + static_cast<int64_t>(v3);
+        return static_cast<T>(sum >= 0 ? (sum + 2) / 4 : (sum - 2) / 4);
+    }
+
+    template <>
+    float Average(float v0, float v1, float v2, float v3)
+    {
+        return 0.25f * ((v0 + v1) + (v2 + v3));
+    }
+
+    // Downsample level 'level' of the texture to level 'level' + 1. A
+    // texel of the smaller level is the average of the 2x2 block of texels
+    // above it; at an odd dimension the last row or column is repeated.
+    template <typename T>
+    void Downsample(Texture2& texture, uint32_t level, uint32_t numChannels)
+    {
+        uint32_t const w0 = texture.GetDimensionFor(level, 0);
+        uint32_t const h0 = texture.GetDimensionFor(level, 1);
+        uint32_t const w1 = texture.GetDimensionFor(level + 1, 0);
+        uint32_t const h1 = texture.GetDimensionFor(level + 1, 1);
+        T const* src = texture.GetFor<T>(level);
+        T* dst = texture.GetFor<T>(level + 1);
+
+        for (uint32_t y = 0; y < h1; ++y)
+        {
+            uint32_t const y0 = std::min(2 * y, h0 - 1);
+            uint32_t const y1 = std::min(2 * y + 1, h0 - 1);
+            for (uint32_t x = 0; x < w1; ++x)
+            {
+                uint32_t const x0 = std::min(2 * x, w0 - 1);
+                uint32_t const x1 = std::min(2 * x + 1, w0 - 1);
+                T const* t00 = src + numChannels * (x0 + w0 * y0);
+                T const* t10 = src + numChannels * (x1 + w0 * y0);
+                T const* t01 = src + numChannels * (x0 + w0 * y1);
+                T const* t11 = src + numChannels * (x1 + w0 * y1);
+                for (uint32_t c = 0; c < numChannels; ++c)
+                {
+                    *dst++ = Average(t00[c], t10[c], t01[c], t11[c]);
+                }
+            }
+        }
+    }
+}
+
+TextureStreamer::TextureStreamer(Loader const& loader, TextureUpdater const& upload,
+    size_t memoryBudget, size_t uploadBudget, uint32_t tailSize)
+    :
+    mLoader(loader),
+    mUpload(upload),
+    mMemoryBudget(memoryBudget),
+    mUploadBudget(uploadBudget),
+    mTailSize(std::max(tailSize, 1u)),
+    mResidentBytes(0),
+    mEntries{},
+    mMutex{},
+    mCondition{},
+    mQueue{},
+    mDecoded{},
+    mNumPending(0),
+    mStop(false)
+{
+    LogAssert(mLoader && mUpload, "Invalid function objects.");
+    mThread = std::thread([this]() { DecodeLoop(); });
+}
+
+TextureStreamer::~TextureStreamer()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mCondition.notify_one();
+    mThread.join();
+
+    // The textures might outlive the streamer, so they must not point to
+    // its CPU data.
+    for (auto& entry : mEntries)
+    {
+        if (entry.texture)
+        {
+            entry.texture->SetData(nullptr);
+        }
+    }
+}
+
+size_t TextureStreamer::Request(std::string const& filename, TextureSetter const& setter)
+{
+    Entry entry{};
+    entry.filename = filename;
+    entry.setter = setter;
+    entry.distance = 0.0f;
+    entry.state = State::PENDING;
+    entry.level = 0;
+    entry.tailLevel = 0;
+
+    size_t const handle = mEntries.size();
+    mEntries.push_back(entry);
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(std::make_pair(handle, filename));
+        ++mNumPending;
+    }
+    mCondition.notify_one();
+    return handle;
+}
+
+void TextureStreamer::Release(size_t handle)
+{
+    LogAssert(handle < mEntries.size(), "Invalid handle.");
+    Entry& entry = mEntries[handle];
+    if (entry.texture)
+    {
+        mResidentBytes -= entry.texture->GetNumBytes();
+        entry.texture->SetData(nullptr);
+    }
+    entry.state = State::RELEASED;
+    entry.decoded = nullptr;
+    entry.texture = nullptr;
+    entry.setter = nullptr;
+}
+
+void TextureStreamer::SetDistance(size_t handle, float distance)
+{
+    LogAssert(handle < mEntries.size(), "Invalid handle.");
+    mEntries[handle].distance = distance;
+}
+
+void TextureStreamer::Update()
+{
+    std::vector<std::pair<size_t, std::shared_ptr<Texture2>>> decoded{};
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        std::swap(decoded, mDecoded);
+    }
+
+    // The mip tails of the decoded textures are made resident regardless
+    // of the budgets, so that every requested texture can be drawn.
+    for (auto& item : decoded)
+    {
+        Entry& entry = mEntries[item.first];
+        if (entry.state != State::PENDING)
+        {
+            continue;
+        }
+
+        if (!item.second)
+        {
+            entry.state = State::FAILED;
+            continue;
+        }
+
+        entry.decoded = item.second;
+        uint32_t const numLevels = entry.decoded->GetNumLevels();
+        entry.level = numLevels;
+        entry.tailLevel = numLevels - 1;
+        while (entry.tailLevel > 0 &&
+            entry.decoded->GetDimensionFor(entry.tailLevel - 1, 0) <= mTailSize &&
+            entry.decoded->GetDimensionFor(entry.tailLevel - 1, 1) <= mTailSize)
+        {
+            --entry.tailLevel;
+        }
+        entry.state = State::RESIDENT;
+        MakeResident(entry, entry.tailLevel);
+    }
+
+    std::vector<Entry*> resident{};
+    for (auto& entry : mEntries)
+    {
+        if (entry.state == State::RESIDENT)
+        {
+            resident.push_back(&entry);
+        }
+    }
+    std::sort(resident.begin(), resident.end(),
+        [](Entry const* entry0, Entry const* entry1)
+        {
+            return entry0->distance < entry1->distance;
+        });
+
+    // Evict levels of the farthest textures until the resident bytes are
+    // within the budget.
+    for (auto iter = resident.rbegin(); iter != resident.rend(); ++iter)
+    {
+        Entry& entry = **iter;
+        if (mResidentBytes <= mMemoryBudget)
+        {
+            break;
+        }
+
+        // Evict the fewest levels that suffice, with a single replacement.
+        size_t const otherBytes = mResidentBytes - entry.texture->GetNumBytes();
+        uint32_t level = entry.level;
+        while (level < entry.tailLevel &&
+            otherBytes + GetNumBytesFrom(*entry.decoded, level) > mMemoryBudget)
+        {
+            ++level;
+        }
+        if (level > entry.level)
+        {
+            MakeResident(entry, level);
+        }
+    }
+
+    // Load one more level of the nearest textures. The first upload of the
+    // call is allowed to exceed the upload budget, so that levels larger
+    // than the budget are loaded eventually.
+    size_t uploadBytes = 0;
+    for (auto* entry : resident)
+    {
+        if (entry->level == 0)
+        {
+            continue;
+        }
+
+        size_t const currentBytes = entry->texture->GetNumBytes();
+        size_t const nextBytes = GetNumBytesFrom(*entry->decoded, entry->level - 1);
+        if (mResidentBytes - currentBytes + nextBytes > mMemoryBudget)
+        {
+            continue;
+        }
+
+        if (uploadBytes > 0 && uploadBytes + nextBytes > mUploadBudget)
+        {
+            break;
+        }
+
+        MakeResident(*entry, entry->level - 1);
+        uploadBytes += nextBytes;
+    }
+}
+
+std::shared_ptr<Texture2> const& TextureStreamer::GetTexture(size_t handle) const
+{
+    LogAssert(handle < mEntries.size(), "Invalid handle.");
+    return mEntries[handle].texture;
+}
+
+uint32_t TextureStreamer::GetResidentLevel(size_t handle) const
+{
+    LogAssert(handle < mEntries.size(), "Invalid handle.");
+    return mEntries[handle].level;
+}
+
+bool TextureStreamer::HasFailed(size_t handle) const
+{
+    LogAssert(handle < mEntries.size(), "Invalid handle.");
+    return mEntries[handle].state == State::FAILED;
+}
+
+void TextureStreamer::SetMemoryBudget(size_t memoryBudget)
+{
+    mMemoryBudget = memoryBudget;
+}
+
+void TextureStreamer::SetUploadBudget(size_t uploadBudget)
+{
+    mUploadBudget = uploadBudget;
+}
+
+size_t TextureStreamer::GetNumPending() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mNumPending;
+}
+
+bool TextureStreamer::GenerateMipmaps(Texture2& texture)
+{
+    uint32_t const format = texture.GetFormat();
+    uint32_t const numChannels = DataFormat::GetNumChannels(format);
+    uint32_t const channelType = DataFormat::GetChannelType(format);
+    uint32_t const numBytes = DataFormat::GetNumBytesPerStruct(format);
+    if (!texture.HasMipmaps() || texture.GetData() == nullptr || numChannels == 0)
+    {
+        return false;
+    }
+
+    void (*downsample)(Texture2&, uint32_t, uint32_t) = nullptr;
+    uint32_t channelSize = 0;
+    switch (channelType)
+    {
+    case DF_BYTE:
+        downsample = &Downsample<int8_t>;
+        channelSize = 1;
+        break;
+    case DF_UBYTE:
+        downsample = &Downsample<uint8_t>;
+        channelSize = 1;
+        break;
+    case DF_SHORT:
+        downsample = &Downsample<int16_t>;
+        channelSize = 2;
+        break;
+    case DF_USHORT:
+        downsample = &Downsample<uint16_t>;
+        channelSize = 2;
+        break;
+    case DF_INT:
+        downsample = &Downsample<int32_t>;
+        channelSize = 4;
+        break;
+    case DF_UINT:
+        downsample = &Downsample<uint32_t>;
+        channelSize = 4;
+        break;
+    case DF_FLOAT:
+        downsample = &Downsample<float>;
+        channelSize = 4;
+        break;
+    default:
+        return false;
+    }
+
+    // Packed formats such as R10G10B10A2 have a channel type but not
+    // separate channels.
+    if (numChannels * channelSize != numBytes)
+    {
+        return false;
+    }
+
+    for (uint32_t level = 0; level + 1 < texture.GetNumLevels(); ++level)
+    {
+        downsample(texture, level, numChannels);
+    }
+    return true;
+}
+
+void TextureStreamer::MakeResident(Entry& entry, uint32_t level)
+{
+    // The levels of the full chain are stored contiguously, so the levels
+    // from 'level' on are the storage of the smaller texture.
+    Texture2& decoded = *entry.decoded;
+    auto texture = std::make_shared<Texture2>(decoded.GetFormat(),
+        decoded.GetDimensionFor(level, 0), decoded.GetDimensionFor(level, 1),
+        true, false);
+    texture->SetName(entry.filename);
+    texture->SetData(decoded.GetDataFor(level));
+    mUpload(texture);
+    entry.setter(texture);
+
+    if (entry.texture)
+    {
+        mResidentBytes -= entry.texture->GetNumBytes();
+        entry.texture->SetData(nullptr);
+    }
+    mResidentBytes += texture->GetNumBytes();
+    entry.texture = texture;
+    entry.level = level;
+}
+
+size_t TextureStreamer::GetNumBytesFrom(Texture2 const& texture, uint32_t level)
+{
+    size_t numBytes = 0;
+    for (uint32_t i = level; i < texture.GetNumLevels(); ++i)
+    {
+        numBytes += texture.GetNumBytesFor(i);
+    }
+    return numBytes;
+}
+
+void TextureStreamer::DecodeLoop()
+{
+    for (;;)
+    {
+        std::pair<size_t, std::string> request{};
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStop || !mQueue.empty(); });
+            if (mStop)
+            {
+                return;
+            }
+            request = std::move(mQueue.front());
+            mQueue.pop_front();
+        }
+
+        // Copy the first level of the loaded texture into a texture with
+        // mipmaps and generate the other levels. The loader reports errors
+        // by exceptions, which must not escape the thread.
+        std::shared_ptr<Texture2> texture{};
+        try
+        {
+            auto loaded = mLoader(request.second);
+            if (loaded && loaded->GetData())
+            {
+                texture = std::make_shared<Texture2>(loaded->GetFormat(),
+                    loaded->GetWidth(), loaded->GetHeight(), true);
+                std::memcpy(texture->GetData(), loaded->GetDataFor(0),
+                    loaded->GetNumBytesFor(0));
+                if (!GenerateMipmaps(*texture))
+                {
+                    texture = nullptr;
+                }
+            }
+        }
+        catch (std::exception const&)
+        {
+            texture = nullptr;
+        }
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mDecoded.push_back(std::make_pair(request.first, texture));
+        --mNumPending;
+    }
+}
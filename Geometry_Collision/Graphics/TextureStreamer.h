@@ -0,0 +1,186 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/Texture2.h>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Asynchronous streaming of 2D textures with a budget for their GPU memory.
+// A requested file is loaded on a background thread and its mipmaps are
+// generated there. The texture on the GPU of a streamed file is a Texture2
+// whose first level is some level L of the full mipmap chain, called the
+// resident level, and whose other levels are those after L; its data is in
+// the CPU copy of the full chain. Once the file is decoded, the mip tail
+// (the levels of dimensions at most tailSize) becomes resident immediately.
+// Each call to Update then lowers the resident level of the nearest
+// textures by one, replacing their Texture2 objects, as long as the
+// resident bytes stay within the memory budget and the bytes created in
+// the call within the upload budget. When the resident bytes exceed the
+// memory budget, for example after a budget change or new tails, the
+// farthest textures are raised toward their tails. The replaced Texture2
+// objects are released, and with them their GPU resources.
+//
+// The streamer does not know the graphics engine or the effects. The
+// 'upload' function object creates the GPU resource of a new Texture2,
+// typically by calling GraphicsEngine::Bind, which initializes the resource
+// from the CPU data through the staging memory of the driver. The 'setter'
+// of a request attaches a new Texture2 to the effects that draw with it.
+//
+//   TextureStreamer streamer(
+//       [](std::string const& name) { return WICFileIO::Load(name, false); },
+//       [this](std::shared_ptr<Texture> const& texture) { mEngine->Bind(texture); },
+//       256 << 20, 16 << 20);
+//
+//   auto handle = streamer.Request("Rock.png",
+//       [effect](std::shared_ptr<Texture2> const& texture)
+//       {
+//           effect->GetPixelShader()->Set("baseTexture", texture,
+//               "baseSampler", effect->GetSampler());
+//       });
+//
+//   // Each frame, on the thread that draws.
+//   streamer.SetDistance(handle, Length(cameraPosition - rockPosition));
+//   streamer.Update();
+//
+// The mipmaps are generated with a box filter for formats whose channels
+// are all 8-bit, 16-bit or 32-bit integers or 32-bit floats, such as the
+// formats that WICFileIO loads; other formats fail to stream. All member
+// functions except the constructor's loader must be called on one thread.
+
+namespace gte
+{
+    class TextureStreamer
+    {
+    public:
+        // The loader is called on the background thread and returns the
+        // texture of a file, of which only the first level is used, or
+        // nullptr when the file cannot be loaded.
+        typedef std::function<std::shared_ptr<Texture2>(std::string const&)> Loader;
+        typedef std::function<void(std::shared_ptr<Texture2> const&)> TextureSetter;
+
+        // The budgets are in bytes. The mip tail of a texture consists of
+        // the levels whose width and height are at most tailSize.
+        TextureStreamer(Loader const& loader, TextureUpdater const& upload,
+            size_t memoryBudget, size_t uploadBudget, uint32_t tailSize = 64);
+
+        ~TextureStreamer();
+
+        // Disallow copy and assignment.
+        TextureStreamer(TextureStreamer const&) = delete;
+        TextureStreamer& operator=(TextureStreamer const&) = delete;
+
+        // Queue a file for loading. The returned handle identifies the
+        // request in the other member functions.
+        size_t Request(std::string const& filename, TextureSetter const& setter);
+
+        // Stop streaming the file. The last Texture2 passed to the setter
+        // remains valid for drawing, but the streamer no longer owns its
+        // CPU data.
+        void Release(size_t handle);
+
+        // The distance of the texture from the viewer, which orders the
+        // textures for loading higher levels and for eviction. The default
+        // is 0.
+        void SetDistance(size_t handle, float distance);
+
+        // Make decoded textures resident and change resident levels within
+        // the budgets. Call this once per frame.
+        void Update();
+
+        // Member access. GetTexture returns nullptr until the mip tail is
+        // resident. The resident level is the number of levels of the full
+        // chain when no level is resident.
+        std::shared_ptr<Texture2> const& GetTexture(size_t handle) const;
+        uint32_t GetResidentLevel(size_t handle) const;
+        bool HasFailed(size_t handle) const;
+
+        void SetMemoryBudget(size_t memoryBudget);
+
+        inline size_t GetMemoryBudget() const
+        {
+            return mMemoryBudget;
+        }
+
+        void SetUploadBudget(size_t uploadBudget);
+
+        inline size_t GetUploadBudget() const
+        {
+            return mUploadBudget;
+        }
+
+        inline size_t GetResidentBytes() const
+        {
+            return mResidentBytes;
+        }
+
+        // The number of requests that are not yet decoded.
+        size_t GetNumPending() const;
+
+        // Generate levels 1 and later of a texture with mipmaps from level
+        // 0 using a box filter. The function returns false when the format
+        // is not supported. It is called on the background thread.
+        static bool GenerateMipmaps(Texture2& texture);
+
+    private:
+        enum class State
+        {
+            PENDING,
+            RESIDENT,
+            FAILED,
+            RELEASED
+        };
+
+        struct Entry
+        {
+            std::string filename;
+            TextureSetter setter;
+            float distance;
+            State state;
+
+            // The full mipmap chain in CPU memory and the resident texture.
+            std::shared_ptr<Texture2> decoded;
+            std::shared_ptr<Texture2> texture;
+            uint32_t level, tailLevel;
+        };
+
+        // Replace the resident texture of an entry by one whose first level
+        // is the specified level of the full chain.
+        void MakeResident(Entry& entry, uint32_t level);
+
+        // The number of bytes of the levels of the full chain that start at
+        // the specified level.
+        static size_t GetNumBytesFrom(Texture2 const& texture, uint32_t level);
+
+        void DecodeLoop();
+
+        Loader mLoader;
+        TextureUpdater mUpload;
+        size_t mMemoryBudget, mUploadBudget;
+        uint32_t mTailSize;
+        size_t mResidentBytes;
+        std::vector<Entry> mEntries;
+
+        // Shared with the background thread.
+        mutable std::mutex mMutex;
+        std::condition_variable mCondition;
+        std::deque<std::pair<size_t, std::string>> mQueue;
+        std::vector<std::pair<size_t, std::shared_ptr<Texture2>>> mDecoded;
+        size_t mNumPending;
+        bool mStop;
+        std::thread mThread;
+    };
+}
@@ -12,7 +12,8 @@ using namespace gte;
 
 TransformController::TransformController(Transform<float> const& localTransform)
     :
-    mLocalTransform(localTransform)
+    mLocalTransform(localTransform),
+    mBatched(false)
 {
 }
 
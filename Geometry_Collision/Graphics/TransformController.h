@@ -35,6 +35,13 @@ namespace gte
         virtual bool Update(double applicationTime) override;
 
     protected:
+        friend class AnimationBatch;
+
         Transform<float> mLocalTransform;
+
+        // The controller was added to an AnimationBatch, whose Update
+        // computes mLocalTransform and copies it to the object. The Update
+        // function of the controller then only records the time.
+        bool mBatched;
     };
 }
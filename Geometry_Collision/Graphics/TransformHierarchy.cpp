@@ -0,0 +1,462 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/TransformHierarchy.h>
+#include <Graphics/Node.h>
+#include <Graphics/Visual.h>
+#include <Mathematics/Logger.h>
+#include <Mathematics/Trace.h>
+#include <cstring>
+#include <typeinfo>
+#include <utility>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#define GTE_TRANSFORM_HIERARCHY_SSE
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GTE_TRANSFORM_HIERARCHY_NEON
+#include <arm_neon.h>
+#endif
+using namespace gte;
+
+namespace
+{
+    // Compute C = A*B for 4x4 matrices stored in row-major order. Each row
+    // of C is a sum of the rows of B weighted by the elements of the row of
+    // A. The sums start at zero and add the terms in the order of
+    // MultiplyAB, so the results are bitwise identical to those of the
+    // Matrix operator*.
+    void MultiplyRowMajor(float const* A, float const* B, float* C)
+    {
+#if defined(GTE_TRANSFORM_HIERARCHY_SSE)
+        __m128 const row0 = _mm_loadu_ps(B);
+        __m128 const row1 = _mm_loadu_ps(B + 4);
+        __m128 const row2 = _mm_loadu_ps(B + 8);
+        __m128 const row3 = _mm_loadu_ps(B + 12);
+        for (int32_t r = 0; r < 4; ++r, A += 4, C += 4)
+        {
+            __m128 sum = _mm_setzero_ps();
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[0]), row0));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[1]), row1));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[2]), row2));
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(A[3]), row3));
+            _mm_storeu_ps(C, sum);
+        }
+#elif defined(GTE_TRANSFORM_HIERARCHY_NEON)
+        // The multiplications and additions are separate instructions;
+        // fused multiply-add would change the rounding.
+        float32x4_t const row0 = vld1q_f32(B);
+        float32x4_t const row1 = vld1q_f32(B + 4);
+        float32x4_t const row2 = vld1q_f32(B + 8);
+        float32x4_t const row3 = vld1q_f32(B + 12);
+        for (int32_t r = 0; r < 4; ++r, A += 4, C += 4)
+        {
+            float32x4_t sum = vdupq_n_f32(0.0f);
+            sum = vaddq_f32(sum, vmulq_n_f32(row0, A[0]));
+            sum = vaddq_f32(sum, vmulq_n_f32(row1, A[1]));
+            sum = vaddq_f32(sum, vmulq_n_f32(row2, A[2]));
+            sum = vaddq_f32(sum, vmulq_n_f32(row3, A[3]));
+            vst1q_f32(C, sum);
+        }
+#else
+        for (int32_t r = 0; r < 4; ++r, A += 4, C += 4)
+        {
+            for (int32_t c = 0; c < 4; ++c)
+            {
+                float sum = 0.0f;
+                for (int32_t i = 0; i < 4; ++i)
+                {
+                    sum += A[i] * B[4 * i + c];
+                }
+                C[c] = sum;
+            }
+        }
+#endif
+    }
+
+    Matrix4x4<float> Multiply(Matrix4x4<float> const& A, Matrix4x4<float> const& B)
+    {
+        Matrix4x4<float> C;
+#if defined(GTE_USE_ROW_MAJOR)
+        MultiplyRowMajor(&A[0], &B[0], &C[0]);
+#else
+        // The column-major storage of a matrix is the row-major storage of
+        // its transpose, and transpose(A*B) = transpose(B)*transpose(A).
+        MultiplyRowMajor(&B[0], &A[0], &C[0]);
+#endif
+        return C;
+    }
+}
+
+TransformHierarchy::TransformHierarchy(std::shared_ptr<Spatial> const& root)
+    :
+    mRoot(root),
+    mNumUpdatedTransforms(0),
+    mNumUpdatedBounds(0)
+{
+    LogAssert(mRoot != nullptr, "The root must exist.");
+    Compile();
+}
+
+void TransformHierarchy::Compile()
+{
+    mObjects.clear();
+    mParents.clear();
+    mVisuals.clear();
+    mFlags.clear();
+    mSourceTransforms.clear();
+    mSourceBounds.clear();
+    mIndices.clear();
+
+    // A depth-first traversal with the children pushed in reverse order
+    // visits the objects in the order of the recursive Spatial::Update.
+    std::vector<std::pair<Spatial*, int32_t>> stack;
+    stack.push_back(std::make_pair(mRoot.get(), -1));
+    while (stack.size() > 0)
+    {
+        Spatial* object = stack.back().first;
+        int32_t parent = stack.back().second;
+        stack.pop_back();
+
+        int32_t const index = static_cast<int32_t>(mObjects.size());
+        Visual* visual = dynamic_cast<Visual*>(object);
+        Node* node = (typeid(*object) == typeid(Node) ? static_cast<Node*>(object) : nullptr);
+
+        uint8_t flags = FORCE_UPDATE;
+        if (!visual && !node)
+        {
+            flags |= SELF_UPDATING;
+        }
+        else if (object->GetControllers().size() > 0)
+        {
+            flags |= CONTROLLED;
+        }
+
+        mObjects.push_back(object);
+        mParents.push_back(parent);
+        mVisuals.push_back(visual);
+        mFlags.push_back(flags);
+        mSourceTransforms.push_back(Transform<float>{});
+        mSourceBounds.push_back(BoundingSphere<float>{});
+        mIndices.insert(std::make_pair(object, index));
+
+        if (node)
+        {
+            for (int32_t i = node->GetNumChildren() - 1; i >= 0; --i)
+            {
+                Spatial* child = node->GetChildPtr(i);
+                if (child)
+                {
+                    stack.push_back(std::make_pair(child, index));
+                }
+            }
+        }
+    }
+}
+
+int32_t TransformHierarchy::GetIndex(Spatial const* object) const
+{
+    auto iter = mIndices.find(object);
+    return (iter != mIndices.end() ? iter->second : -1);
+}
+
+void TransformHierarchy::Invalidate(Spatial const* object)
+{
+    int32_t const index = GetIndex(object);
+    if (index >= 0)
+    {
+        mFlags[index] |= FORCE_UPDATE;
+    }
+}
+
+void TransformHierarchy::Update(double applicationTime)
+{
+    GTE_TRACE_SCOPE("TransformHierarchy::Update");
+
+    mNumUpdatedTransforms = 0;
+    mNumUpdatedBounds = 0;
+
+    // The parent of the root is not in the arrays, so its world transform
+    // is compared to the copy of the previous update.
+    Spatial* rootParent = mRoot->GetParent();
+    if (rootParent && !IsEqual(rootParent->worldTransform, mRootParentWorld))
+    {
+        mRootParentWorld = rootParent->worldTransform;
+        mFlags[0] |= FORCE_UPDATE;
+    }
+
+    // Compute the world transforms in parent-before-child order.
+    bool propagateToRoot = false;
+    size_t const numObjects = mObjects.size();
+    for (size_t i = 0; i < numObjects; ++i)
+    {
+        Spatial* object = mObjects[i];
+        int32_t const parent = mParents[i];
+        uint8_t& flags = mFlags[i];
+
+        if (flags & SELF_UPDATING)
+        {
+            // The object computes its world data and that of its subtree
+            // every update. Only a change of its world bound affects the
+            // ancestors.
+            object->Update(applicationTime, false);
+            flags |= TRANSFORM_CHANGED;
+            ++mNumUpdatedTransforms;
+            ++mNumUpdatedBounds;
+            if (!IsEqual(object->worldBound, mSourceBounds[i]) || (flags & FORCE_UPDATE))
+            {
+                mSourceBounds[i] = object->worldBound;
+                if (parent >= 0)
+                {
+                    mFlags[parent] |= BOUND_DIRTY;
+                }
+                else
+                {
+                    propagateToRoot = true;
+                }
+            }
+            continue;
+        }
+
+        if (flags & CONTROLLED)
+        {
+            // The return value is not needed, because the changes that the
+            // controllers make are detected by the comparisons.
+            (void)object->UpdateControllers(applicationTime);
+        }
+
+        uint8_t currentFlags = 0;
+        if (object->worldTransformIsCurrent)
+        {
+            currentFlags |= WORLD_TRANSFORM_IS_CURRENT;
+        }
+        if (object->worldBoundIsCurrent)
+        {
+            currentFlags |= WORLD_BOUND_IS_CURRENT;
+        }
+        if ((flags & (WORLD_TRANSFORM_IS_CURRENT | WORLD_BOUND_IS_CURRENT)) != currentFlags)
+        {
+            flags = static_cast<uint8_t>((flags & ~(WORLD_TRANSFORM_IS_CURRENT |
+                WORLD_BOUND_IS_CURRENT)) | currentFlags | FORCE_UPDATE);
+        }
+
+        bool const forced = (flags & FORCE_UPDATE) != 0;
+        if (object->worldTransformIsCurrent)
+        {
+            // The world transform is set by the application, so it changes
+            // only when the application changes it.
+            if (forced || !IsEqual(object->worldTransform, mSourceTransforms[i]))
+            {
+                mSourceTransforms[i] = object->worldTransform;
+                flags |= TRANSFORM_CHANGED | BOUND_DIRTY;
+                ++mNumUpdatedTransforms;
+            }
+        }
+        else
+        {
+            bool changed = forced || (parent >= 0 && (mFlags[parent] & TRANSFORM_CHANGED));
+            if (!IsEqual(object->localTransform, mSourceTransforms[i]))
+            {
+                mSourceTransforms[i] = object->localTransform;
+                changed = true;
+            }
+
+            if (changed)
+            {
+                Spatial* parentObject = (parent >= 0 ? mObjects[parent] : rootParent);
+                if (parentObject)
+                {
+#if defined(GTE_USE_MAT_VEC)
+                    Compose(parentObject->worldTransform, object->localTransform,
+                        object->worldTransform);
+#else
+                    Compose(object->localTransform, parentObject->worldTransform,
+                        object->worldTransform);
+#endif
+                }
+                else
+                {
+                    object->worldTransform = object->localTransform;
+                }
+                flags |= TRANSFORM_CHANGED | BOUND_DIRTY;
+                ++mNumUpdatedTransforms;
+            }
+        }
+
+        Visual* visual = mVisuals[i];
+        if (visual)
+        {
+            if (!IsEqual(visual->modelBound, mSourceBounds[i]))
+            {
+                mSourceBounds[i] = visual->modelBound;
+                flags |= BOUND_DIRTY;
+            }
+        }
+        else if (object->worldBoundIsCurrent)
+        {
+            if (!IsEqual(object->worldBound, mSourceBounds[i]))
+            {
+                mSourceBounds[i] = object->worldBound;
+                flags |= BOUND_DIRTY;
+            }
+        }
+
+        if (forced)
+        {
+            flags |= BOUND_DIRTY;
+        }
+    }
+
+    // Compute the world bounds in child-before-parent order.
+    for (size_t i = numObjects; i-- > 0; )
+    {
+        uint8_t& flags = mFlags[i];
+        if ((flags & BOUND_DIRTY) && !(flags & SELF_UPDATING))
+        {
+            mObjects[i]->UpdateWorldBound();
+            ++mNumUpdatedBounds;
+
+            int32_t const parent = mParents[i];
+            if (parent >= 0)
+            {
+                mFlags[parent] |= BOUND_DIRTY;
+            }
+            else
+            {
+                propagateToRoot = true;
+            }
+        }
+        flags &= static_cast<uint8_t>(~UPDATE_FLAGS);
+    }
+
+    if (propagateToRoot)
+    {
+        mRoot->PropagateBoundToRoot();
+    }
+}
+
+void TransformHierarchy::Compose(Transform<float> const& A, Transform<float> const& B,
+    Transform<float>& product)
+{
+    if (A.IsIdentity())
+    {
+        product = B;
+        return;
+    }
+
+    if (B.IsIdentity())
+    {
+        product = A;
+        return;
+    }
+
+    if (A.IsRSMatrix() && B.IsRSMatrix())
+    {
+#if defined(GTE_USE_MAT_VEC)
+        if (A.IsUniformScale())
+        {
+            float const scale = A.GetUniformScale();
+            Vector4<float> const translate = scale * (A.GetRotation() *
+                B.GetTranslationW0()) + A.GetTranslationW1();
+            product.SetComponents(Multiply(A.GetRotation(), B.GetRotation()),
+                translate, scale * B.GetScaleW1(), true, B.IsUniformScale());
+            return;
+        }
+#else
+        if (B.IsUniformScale())
+        {
+            float const scale = B.GetUniformScale();
+            Vector4<float> const translate = scale * (A.GetTranslationW0() *
+                B.GetRotation()) + B.GetTranslationW1();
+            product.SetComponents(Multiply(A.GetRotation(), B.GetRotation()),
+                translate, A.GetScaleW1() * scale, true, A.IsUniformScale());
+            return;
+        }
+#endif
+    }
+
+    // In all remaining cases, the matrix cannot be written as R*S*X+T.
+    Matrix4x4<float> matMA;
+    if (A.IsRSMatrix())
+    {
+#if defined(GTE_USE_MAT_VEC)
+        matMA = MultiplyMD(A.GetRotation(), A.GetScaleW1());
+#else
+        matMA = MultiplyDM(A.GetScaleW1(), A.GetRotation());
+#endif
+    }
+    else
+    {
+        matMA = A.GetMatrix();
+    }
+
+    Matrix4x4<float> matMB;
+    if (B.IsRSMatrix())
+    {
+#if defined(GTE_USE_MAT_VEC)
+        matMB = MultiplyMD(B.GetRotation(), B.GetScaleW1());
+#else
+        matMB = MultiplyDM(B.GetScaleW1(), B.GetRotation());
+#endif
+    }
+    else
+    {
+        matMB = B.GetMatrix();
+    }
+
+#if defined(GTE_USE_MAT_VEC)
+    Vector4<float> const translate = matMA * B.GetTranslationW0() + A.GetTranslationW1();
+#else
+    Vector4<float> const translate = A.GetTranslationW0() * matMB + B.GetTranslationW1();
+#endif
+    product.SetComponents(Multiply(matMA, matMB), translate, Vector4<float>::Unit(3),
+        false, false);
+}
+
+bool TransformHierarchy::IsEqual(Transform<float> const& T0, Transform<float> const& T1)
+{
+    if (T0.IsIdentity() != T1.IsIdentity()
+        || T0.IsRSMatrix() != T1.IsRSMatrix()
+        || T0.IsUniformScale() != T1.IsUniformScale())
+    {
+        return false;
+    }
+
+    if (std::memcmp(&T0.GetMatrix()[0], &T1.GetMatrix()[0], 16 * sizeof(float)) != 0)
+    {
+        return false;
+    }
+
+    Vector4<float> const translate0 = T0.GetTranslationW1();
+    Vector4<float> const translate1 = T1.GetTranslationW1();
+    if (std::memcmp(&translate0[0], &translate1[0], 3 * sizeof(float)) != 0)
+    {
+        return false;
+    }
+
+    if (T0.IsRSMatrix())
+    {
+        Vector4<float> const scale0 = T0.GetScaleW1();
+        Vector4<float> const scale1 = T1.GetScaleW1();
+        if (std::memcmp(&scale0[0], &scale1[0], 3 * sizeof(float)) != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool TransformHierarchy::IsEqual(BoundingSphere<float> const& B0, BoundingSphere<float> const& B1)
+{
+    Vector3<float> const center0 = B0.GetCenter();
+    Vector3<float> const center1 = B1.GetCenter();
+    float const radius0 = B0.GetRadius();
+    float const radius1 = B1.GetRadius();
+    return std::memcmp(&center0[0], &center1[0], 3 * sizeof(float)) == 0
+        && std::memcmp(&radius0, &radius1, sizeof(float)) == 0;
+}
@@ -0,0 +1,155 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include "Spatial.h"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// A compiled form of a scene graph for the per-frame geometric update. The
+// Spatial and Node objects remain the authoring interface; Compile stores
+// pointers to the objects of the subtree at the root in parent-before-child
+// order in contiguous arrays, together with the parent indices and copies of
+// the inputs to the world transforms and bounds. Update then produces the
+// same worldTransform and worldBound members as root->Update(), but
+//   1. the world transforms are computed by one forward pass over the
+//      arrays instead of a recursive traversal with virtual calls,
+//   2. an object's world transform is recomputed only when its local
+//      transform or an ancestor's world transform has changed, which is
+//      detected by comparing the transforms with the copies of the
+//      previous update,
+//   3. a world bound is recomputed only when the object's world transform,
+//      its model bound or a child's world bound has changed, by one
+//      backward pass over the arrays,
+//   4. the 4x4 matrix products of the world transforms use SSE or NEON
+//      instructions when available.
+// The results are bitwise identical to those of Spatial::Update, and the
+// controllers are updated in the same order.
+//
+// Objects of class Node and of classes derived from Visual are flattened.
+// Other classes, such as BillboardNode and BspNode, override the update
+// functions; these objects are updated by calling their Update function,
+// and their subtrees are not flattened.
+//
+// Compile must be called again after children or controllers are attached
+// or detached in the subtree, because the arrays are not updated
+// automatically. Changes to localTransform, to worldTransform when
+// worldTransformIsCurrent is 'true', to the model bound of a Visual and to
+// worldBound when worldBoundIsCurrent is 'true' are detected.
+
+namespace gte
+{
+    class Visual;
+
+    class TransformHierarchy
+    {
+    public:
+        // Construction. The constructor calls Compile.
+        TransformHierarchy(std::shared_ptr<Spatial> const& root);
+
+        // Flatten the subtree at the root into the arrays and mark all
+        // objects to be updated.
+        void Compile();
+
+        inline std::shared_ptr<Spatial> const& GetRoot() const
+        {
+            return mRoot;
+        }
+
+        inline size_t GetNumObjects() const
+        {
+            return mObjects.size();
+        }
+
+        // The index of an object in the arrays, or -1 when the object was
+        // not in the subtree at the last call to Compile.
+        int32_t GetIndex(Spatial const* object) const;
+
+        // Force the world transform and world bound of the object to be
+        // recomputed at the next update, for example after code that
+        // bypasses the Transform and BoundingSphere interfaces.
+        void Invalidate(Spatial const* object);
+
+        // The equivalent of root->Update(applicationTime). The application
+        // time is passed to the controllers.
+        void Update(double applicationTime = 0.0);
+
+        // Statistics of the last update.
+        inline size_t GetNumUpdatedTransforms() const
+        {
+            return mNumUpdatedTransforms;
+        }
+
+        inline size_t GetNumUpdatedBounds() const
+        {
+            return mNumUpdatedBounds;
+        }
+
+    private:
+        enum : uint8_t
+        {
+            // The object is updated by its Update function.
+            SELF_UPDATING = 0x01,
+
+            // The object has controllers.
+            CONTROLLED = 0x02,
+
+            // The values of worldTransformIsCurrent and worldBoundIsCurrent
+            // at the previous update.
+            WORLD_TRANSFORM_IS_CURRENT = 0x04,
+            WORLD_BOUND_IS_CURRENT = 0x08,
+
+            // Recompute the world transform and world bound.
+            FORCE_UPDATE = 0x10,
+
+            // The world transform changed during the current update.
+            TRANSFORM_CHANGED = 0x20,
+
+            // Recompute the world bound during the current update.
+            BOUND_DIRTY = 0x40,
+
+            UPDATE_FLAGS = FORCE_UPDATE | TRANSFORM_CHANGED | BOUND_DIRTY
+        };
+
+        // Compute product = A*B as operator*(Transform, Transform) does,
+        // with the 4x4 matrix products in SIMD registers when available.
+        static void Compose(Transform<float> const& A, Transform<float> const& B,
+            Transform<float>& product);
+
+        // Bitwise comparisons of all the members that affect the results,
+        // including the hints of the transforms.
+        static bool IsEqual(Transform<float> const& T0, Transform<float> const& T1);
+
+        static bool IsEqual(BoundingSphere<float> const& B0, BoundingSphere<float> const& B1);
+
+        std::shared_ptr<Spatial> mRoot;
+
+        // The objects in parent-before-child order. Element 0 is the root.
+        // The parent of the root is -1.
+        std::vector<Spatial*> mObjects;
+        std::vector<int32_t> mParents;
+        std::vector<Visual*> mVisuals;
+        std::vector<uint8_t> mFlags;
+
+        // Copies of the inputs of the previous update. The source transform
+        // is localTransform, or worldTransform when worldTransformIsCurrent
+        // is 'true'. The source bound is the model bound of a Visual, or
+        // worldBound when worldBoundIsCurrent is 'true'.
+        std::vector<Transform<float>> mSourceTransforms;
+        std::vector<BoundingSphere<float>> mSourceBounds;
+
+        // The world transform of the parent of the root, when the root is
+        // not the root of the entire scene.
+        Transform<float> mRootParentWorld;
+
+        std::unordered_map<Spatial const*, int32_t> mIndices;
+        size_t mNumUpdatedTransforms, mNumUpdatedBounds;
+    };
+}
@@ -0,0 +1,226 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#include <Graphics/GTGraphicsPCH.h>
+#include <Graphics/VertexCompression.h>
+#include <Mathematics/IEEEBinary16.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+using namespace gte;
+
+bool VertexCompression::IsCompressed(VASemantic semantic, DFType type)
+{
+    switch (semantic)
+    {
+    case VASemantic::POSITION:
+        return type == DF_R16G16B16A16_FLOAT;
+    case VASemantic::NORMAL:
+    case VASemantic::TANGENT:
+    case VASemantic::BINORMAL:
+        return type == DF_R16G16B16A16_FLOAT
+            || type == DF_R16G16_SNORM
+            || type == DF_R8G8_SNORM;
+    case VASemantic::TEXCOORD:
+        return type == DF_R16G16_FLOAT;
+    case VASemantic::COLOR:
+        return type == DF_R8G8B8A8_UNORM;
+    default:
+        return false;
+    }
+}
+
+VertexFormat VertexCompression::GetStagingFormat(VertexFormat const& format)
+{
+    VertexFormat staging{};
+    for (int32_t i = 0; i < format.GetNumAttributes(); ++i)
+    {
+        VASemantic semantic{};
+        DFType type{};
+        uint32_t unit{}, offset{};
+        format.GetAttribute(i, semantic, type, unit, offset);
+        if (IsCompressed(semantic, type))
+        {
+            if (semantic == VASemantic::TEXCOORD)
+            {
+                type = DF_R32G32_FLOAT;
+            }
+            else if (semantic == VASemantic::COLOR)
+            {
+                type = DF_R32G32B32A32_FLOAT;
+            }
+            else
+            {
+                type = DF_R32G32B32_FLOAT;
+            }
+        }
+        staging.Bind(semantic, type, unit);
+    }
+    return staging;
+}
+
+std::shared_ptr<VertexBuffer> VertexCompression::Pack(VertexBuffer const& source,
+    VertexFormat const& format)
+{
+    VertexFormat const& sformat = source.GetFormat();
+    LogAssert(source.StandardUsage() && source.GetData() != nullptr,
+        "The source must have vertex storage.");
+    LogAssert(sformat.GetNumAttributes() == format.GetNumAttributes(),
+        "The source format must be the staging format.");
+
+    uint32_t const numVertices = source.GetNumElements();
+    auto target = std::make_shared<VertexBuffer>(format, numVertices);
+    target->SetUsage(source.GetUsage());
+
+    size_t const sstride = sformat.GetVertexSize();
+    size_t const tstride = format.GetVertexSize();
+    char const* sdata = source.GetData();
+    char* tdata = target->GetData();
+    std::vector<float> numbers{};
+    std::vector<uint16_t> halfs{};
+
+    for (int32_t i = 0; i < format.GetNumAttributes(); ++i)
+    {
+        VASemantic semantic{}, ssemantic{};
+        DFType type{}, stype{};
+        uint32_t unit{}, offset{}, sunit{}, soffset{};
+        format.GetAttribute(i, semantic, type, unit, offset);
+        sformat.GetAttribute(i, ssemantic, stype, sunit, soffset);
+        LogAssert(semantic == ssemantic && unit == sunit,
+            "The source format must be the staging format.");
+
+        if (!IsCompressed(semantic, type))
+        {
+            LogAssert(type == stype, "The source format must be the staging format.");
+            size_t const numBytes = DataFormat::GetNumBytesPerStruct(type);
+            for (uint32_t v = 0; v < numVertices; ++v)
+            {
+                std::memcpy(tdata + v * tstride + offset,
+                    sdata + v * sstride + soffset, numBytes);
+            }
+            continue;
+        }
+
+        if (type == DF_R16G16B16A16_FLOAT || type == DF_R16G16_FLOAT)
+        {
+            // The components are gathered into a contiguous array so that
+            // the half-float conversion is a single bulk operation.
+            uint32_t const numComponents = DataFormat::GetNumChannels(type);
+            size_t const numValues = static_cast<size_t>(numVertices) * numComponents;
+            float const w = (semantic == VASemantic::POSITION ? 1.0f : 0.0f);
+            numbers.resize(numValues);
+            halfs.resize(numValues);
+            Gather(source, soffset, DataFormat::GetNumChannels(stype),
+                numComponents, w, numbers.data());
+            IEEEBinary16::Convert(numValues, numbers.data(), halfs.data());
+            Scatter(halfs.data(), numComponents, offset, *target);
+        }
+        else if (type == DF_R16G16_SNORM || type == DF_R8G8_SNORM)
+        {
+            bool const use16 = (type == DF_R16G16_SNORM);
+            float const scale = (use16 ? 32767.0f : 127.0f);
+            for (uint32_t v = 0; v < numVertices; ++v)
+            {
+                Vector3<float> n{};
+                std::memcpy(&n[0], sdata + v * sstride + soffset, sizeof(n));
+                Vector2<float> e = EncodeOctahedral(n);
+                char* output = tdata + v * tstride + offset;
+                for (int32_t j = 0; j < 2; ++j)
+                {
+                    float q = std::round(scale * std::min(std::max(e[j], -1.0f), 1.0f));
+                    if (use16)
+                    {
+                        reinterpret_cast<int16_t*>(output)[j] = static_cast<int16_t>(q);
+                    }
+                    else
+                    {
+                        reinterpret_cast<int8_t*>(output)[j] = static_cast<int8_t>(q);
+                    }
+                }
+            }
+        }
+        else  // type == DF_R8G8B8A8_UNORM
+        {
+            for (uint32_t v = 0; v < numVertices; ++v)
+            {
+                float const* color = reinterpret_cast<float const*>(
+                    sdata + v * sstride + soffset);
+                uint8_t* output = reinterpret_cast<uint8_t*>(
+                    tdata + v * tstride + offset);
+                for (int32_t j = 0; j < 4; ++j)
+                {
+                    output[j] = static_cast<uint8_t>(std::round(
+                        255.0f * std::min(std::max(color[j], 0.0f), 1.0f)));
+                }
+            }
+        }
+    }
+    return target;
+}
+
+Vector2<float> VertexCompression::EncodeOctahedral(Vector3<float> const& n)
+{
+    float const sumAbs = std::fabs(n[0]) + std::fabs(n[1]) + std::fabs(n[2]);
+    if (sumAbs == 0.0f)
+    {
+        return Vector2<float>{ 0.0f, 0.0f };
+    }
+
+    Vector2<float> e{ n[0] / sumAbs, n[1] / sumAbs };
+    if (n[2] < 0.0f)
+    {
+        Vector2<float> folded
+        {
+            (1.0f - std::fabs(e[1])) * (e[0] >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::fabs(e[0])) * (e[1] >= 0.0f ? 1.0f : -1.0f)
+        };
+        e = folded;
+    }
+    return e;
+}
+
+Vector3<float> VertexCompression::DecodeOctahedral(Vector2<float> const& e)
+{
+    Vector3<float> n{ e[0], e[1], 1.0f - std::fabs(e[0]) - std::fabs(e[1]) };
+    float const t = std::max(-n[2], 0.0f);
+    n[0] += (n[0] >= 0.0f ? -t : t);
+    n[1] += (n[1] >= 0.0f ? -t : t);
+    Normalize(n);
+    return n;
+}
+
+void VertexCompression::Gather(VertexBuffer const& source, uint32_t offset,
+    uint32_t numSourceComponents, uint32_t numComponents, float fill,
+    float* output)
+{
+    uint32_t const numVertices = source.GetNumElements();
+    size_t const stride = source.GetFormat().GetVertexSize();
+    char const* data = source.GetData() + offset;
+    uint32_t const numCopied = std::min(numSourceComponents, numComponents);
+    for (uint32_t v = 0; v < numVertices; ++v, output += numComponents)
+    {
+        std::memcpy(output, data + v * stride, numCopied * sizeof(float));
+        for (uint32_t j = numCopied; j < numComponents; ++j)
+        {
+            output[j] = fill;
+        }
+    }
+}
+
+void VertexCompression::Scatter(uint16_t const* input, uint32_t numComponents,
+    uint32_t offset, VertexBuffer& target)
+{
+    uint32_t const numVertices = target.GetNumElements();
+    size_t const stride = target.GetFormat().GetVertexSize();
+    char* data = target.GetData() + offset;
+    for (uint32_t v = 0; v < numVertices; ++v, input += numComponents)
+    {
+        std::memcpy(data + v * stride, input, numComponents * sizeof(uint16_t));
+    }
+}
@@ -0,0 +1,80 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Graphics/VertexBuffer.h>
+#include <Mathematics/Vector2.h>
+#include <Mathematics/Vector3.h>
+#include <cstdint>
+#include <memory>
+
+// Support for vertex buffers with compact attribute encodings. A vertex
+// buffer is filled in a staging format whose attributes are 32-bit floats
+// and is then packed into the compact format. The compressed attributes
+// are
+//   POSITION, NORMAL, TANGENT, BINORMAL:
+//     DF_R16G16B16A16_FLOAT, half-float 4-tuples from 3-tuples (w = 1 for
+//       positions, w = 0 for the others);
+//   NORMAL, TANGENT, BINORMAL:
+//     DF_R16G16_SNORM, DF_R8G8_SNORM, octahedral encodings of unit-length
+//       3-tuples (see EncodeOctahedral);
+//   TEXCOORD:
+//     DF_R16G16_FLOAT, half-float 2-tuples;
+//   COLOR:
+//     DF_R8G8B8A8_UNORM, 4-tuples with components clamped to [0,1].
+// The staging type is DF_R32G32B32_FLOAT for the 3-tuples, DF_R32G32_FLOAT
+// for the texture coordinates and DF_R32G32B32A32_FLOAT for the colors.
+// Other attributes have the same type in both formats and are copied. The
+// half-float conversions are done in bulk by IEEEBinary16::Convert, which
+// uses the F16C instructions when GTE_USE_F16C is defined.
+//
+// The vertex shaders must decode the octahedral normals; the SNORM values
+// are in [-1,1] when read by the input assembler.
+//   float3 n = float3(e.x, e.y, 1.0f - abs(e.x) - abs(e.y));
+//   float t = max(-n.z, 0.0f);
+//   n.xy += (n.xy >= 0.0f ? -t : t);
+//   n = normalize(n);
+
+namespace gte
+{
+    class VertexCompression
+    {
+    public:
+        // Returns 'true' when the attribute type is one of the compact
+        // encodings listed previously for the semantic.
+        static bool IsCompressed(VASemantic semantic, DFType type);
+
+        // The format with every compressed attribute replaced by its
+        // staging type, in the order of the Bind calls of 'format'.
+        static VertexFormat GetStagingFormat(VertexFormat const& format);
+
+        // Create a vertex buffer with the specified format from a vertex
+        // buffer whose format is GetStagingFormat(format). The usage of
+        // the source buffer is copied.
+        static std::shared_ptr<VertexBuffer> Pack(VertexBuffer const& source,
+            VertexFormat const& format);
+
+        // Map a unit-length vector to the square [-1,1]^2. The upper
+        // hemisphere is projected onto the octahedron |x|+|y|+|z| = 1 and
+        // then onto the plane z = 0; the lower hemisphere is folded over
+        // the diagonals of the square.
+        static Vector2<float> EncodeOctahedral(Vector3<float> const& n);
+        static Vector3<float> DecodeOctahedral(Vector2<float> const& e);
+
+    private:
+        // Copy the components of the attribute at 'offset' of each vertex
+        // into a contiguous array, and the reverse. Gather appends 'fill'
+        // to the source components to obtain numComponents per vertex.
+        static void Gather(VertexBuffer const& source, uint32_t offset,
+            uint32_t numSourceComponents, uint32_t numComponents, float fill,
+            float* output);
+
+        static void Scatter(uint16_t const* input, uint32_t numComponents,
+            uint32_t offset, VertexBuffer& target);
+    };
+}
@@ -0,0 +1,454 @@
+#include "HierarchicalGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace
+{
+	// Floor division by 2^shift. For a negative numerator n, ~n = -n - 1
+	// is nonnegative and floor(n / 2^shift) = ~(~n >> shift).
+	inline int64_t FloorShift(int64_t numerator, int32_t shift)
+	{
+		return (numerator >= 0 ? numerator >> shift : ~(~numerator >> shift));
+	}
+}
+
+template <typename Real>
+bool HierarchicalGrid<Real>::CellKey::operator==(CellKey const& other) const
+{
+	return level == other.level && coord == other.coord;
+}
+
+template <typename Real>
+bool HierarchicalGrid<Real>::CellKey::operator<(CellKey const& other) const
+{
+	if (level != other.level)
+	{
+		return level < other.level;
+	}
+
+	// Morton order: the coordinates are compared in the dimension whose
+	// coordinates differ in the most significant bit. The xor of signed
+	// coordinates is that of coordinates biased by 2^63, whose unsigned
+	// order is the signed order.
+	int32_t dimension = 0;
+	uint64_t maxDifference = static_cast<uint64_t>(coord[0] ^ other.coord[0]);
+	for (int32_t d = 1; d < 3; ++d)
+	{
+		uint64_t difference = static_cast<uint64_t>(coord[d] ^ other.coord[d]);
+		if (maxDifference < difference && maxDifference < (maxDifference ^ difference))
+		{
+			dimension = d;
+			maxDifference = difference;
+		}
+	}
+	return coord[dimension] < other.coord[dimension];
+}
+
+template <typename Real>
+HierarchicalGrid<Real>::HierarchicalGrid()
+	:
+	mMaxLevels(16),
+	mBaseCellSize(static_cast<Real>(1)),
+	mCenters(nullptr),
+	mRadii(nullptr),
+	mCellSize{},
+	mEntries{},
+	mSorted{},
+	mCells{},
+	mLevelStart{},
+	mTableStart{},
+	mTable{},
+	mThreadPairs{}
+{
+}
+
+template <typename Real>
+void HierarchicalGrid<Real>::SetMaxLevels(size_t maxLevels)
+{
+	mMaxLevels = std::min(std::max(maxLevels, static_cast<size_t>(1)), static_cast<size_t>(32));
+}
+
+template <typename Real>
+void HierarchicalGrid<Real>::ComputeLevels(std::vector<Real> const& radii)
+{
+	Real const zero = static_cast<Real>(0);
+	Real minRadius = std::numeric_limits<Real>::max(), maxRadius = zero;
+	for (auto radius : radii)
+	{
+		if (radius > zero)
+		{
+			minRadius = std::min(minRadius, radius);
+			maxRadius = std::max(maxRadius, radius);
+		}
+	}
+
+	mCellSize.clear();
+	if (maxRadius == zero)
+	{
+		// Spheres of radius zero overlap only when their centers are
+		// equal, so any cell size is correct.
+		mBaseCellSize = static_cast<Real>(1);
+		mCellSize.push_back(mBaseCellSize);
+		return;
+	}
+
+	// The coarsest level must contain the largest sphere.
+	int32_t const maxLevel = static_cast<int32_t>(mMaxLevels) - 1;
+	mBaseCellSize = static_cast<Real>(2) * minRadius;
+	if (std::ldexp(mBaseCellSize, maxLevel) < static_cast<Real>(2) * maxRadius)
+	{
+		mBaseCellSize = std::ldexp(static_cast<Real>(2) * maxRadius, -maxLevel);
+	}
+
+	int32_t const numLevels = std::min(GetLevel(maxRadius), maxLevel) + 1;
+	for (int32_t level = 0; level < numLevels; ++level)
+	{
+		mCellSize.push_back(std::ldexp(mBaseCellSize, level));
+	}
+}
+
+template <typename Real>
+int32_t HierarchicalGrid<Real>::GetLevel(Real radius) const
+{
+	// The smallest level whose cell size is at least the diameter. The
+	// exponent of frexp is a guess that is off by at most one.
+	Real const diameter = static_cast<Real>(2) * radius;
+	int32_t level = 0;
+	if (diameter > mBaseCellSize)
+	{
+		int exponent = 0;
+		(void)std::frexp(diameter / mBaseCellSize, &exponent);
+		level = static_cast<int32_t>(exponent);
+		while (level > 0 && std::ldexp(mBaseCellSize, level - 1) >= diameter)
+		{
+			--level;
+		}
+		while (std::ldexp(mBaseCellSize, level) < diameter)
+		{
+			++level;
+		}
+	}
+	return level;
+}
+
+template <typename Real>
+uint64_t HierarchicalGrid<Real>::GetHash(CellKey const& key)
+{
+	// The coordinates are combined with odd multipliers and the result is
+	// mixed by the finalizer of MurmurHash3, so that the low bits that
+	// select the slot depend on all the bits of the key.
+	uint64_t hash = static_cast<uint64_t>(key.level);
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		hash = hash * 0x9E3779B97F4A7C15ull + static_cast<uint64_t>(key.coord[d]);
+	}
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	return hash ^ (hash >> 33);
+}
+
+template <typename Real>
+size_t HierarchicalGrid<Real>::FindCell(CellKey const& key) const
+{
+	Slot const* table = mTable.data() + mTableStart[key.level];
+	uint64_t const mask = mTableStart[key.level + 1] - mTableStart[key.level] - 1;
+	uint64_t const hash = GetHash(key);
+	uint64_t slot = hash & mask;
+	while (table[slot].cell != 0)
+	{
+		if (table[slot].hash == hash)
+		{
+			size_t c = table[slot].cell - 1;
+			if (mCells[c].key == key)
+			{
+				return c;
+			}
+		}
+		slot = (slot + 1) & mask;
+	}
+	return mCells.size();
+}
+
+template <typename Real>
+void HierarchicalGrid<Real>::ComputePairs(std::vector<Vector3<Real>> const& centers,
+	std::vector<Real> const& radii,
+	std::vector<std::pair<size_t, size_t>>& pairs, WorkerTeam* team)
+{
+	pairs.clear();
+	mCells.clear();
+	mCenters = centers.data();
+	mRadii = radii.data();
+	ComputeLevels(radii);
+
+	// Compute the cell of each sphere. The coordinates are clamped so that
+	// the arithmetic of AppendPairs cannot overflow; clamping is monotonic,
+	// so no overlapping pair is missed.
+	Real const limit = static_cast<Real>(int64_t(1) << 40);
+	int32_t const maxLevel = static_cast<int32_t>(mCellSize.size()) - 1;
+	size_t const numSpheres = centers.size();
+	mEntries.resize(numSpheres);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		CellKey key{};
+		key.level = std::min(GetLevel(radii[i]), maxLevel);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			Real t = std::floor(centers[i][d] / mCellSize[key.level]);
+			key.coord[d] = static_cast<int64_t>(std::min(std::max(t, -limit), limit));
+		}
+		mEntries[i] = std::make_pair(key, i);
+	}
+
+	// Sort the spheres by cell and, within a cell, by index, and collect
+	// the occupied cells.
+	std::sort(mEntries.begin(), mEntries.end());
+	mSorted.resize(numSpheres);
+	for (size_t j = 0; j < numSpheres; ++j)
+	{
+		mSorted[j] = mEntries[j].second;
+		if (j == 0 || !(mEntries[j].first == mEntries[j - 1].first))
+		{
+			mCells.push_back(Cell{ mEntries[j].first, j, j });
+		}
+		mCells.back().end = j + 1;
+	}
+
+	// The cells are sorted by level. A level without cells starts where
+	// the next level starts.
+	mLevelStart.assign(mCellSize.size() + 1, mCells.size());
+	for (size_t c = mCells.size(); c > 0; --c)
+	{
+		mLevelStart[mCells[c - 1].key.level] = c - 1;
+	}
+	for (size_t level = mCellSize.size(); level > 0; --level)
+	{
+		mLevelStart[level - 1] = std::min(mLevelStart[level - 1], mLevelStart[level]);
+	}
+
+	// Each level has a hash table that is at most one-eighth full, so most
+	// lookups of empty cells, which are the majority, end at the first
+	// slot. The tables of the coarse levels, which are looked up by the
+	// cells of all the finer levels, are small when the large spheres are
+	// few.
+	size_t const numLevels = mCellSize.size();
+	mTableStart.resize(numLevels + 1);
+	mTableStart[0] = 0;
+	for (size_t level = 0; level < numLevels; ++level)
+	{
+		size_t tableSize = 1;
+		while (tableSize < 8 * (mLevelStart[level + 1] - mLevelStart[level]))
+		{
+			tableSize <<= 1;
+		}
+		mTableStart[level + 1] = mTableStart[level] + tableSize;
+	}
+	mTable.assign(mTableStart[numLevels], Slot{ 0, 0 });
+	for (size_t c = 0; c < mCells.size(); ++c)
+	{
+		int32_t const level = mCells[c].key.level;
+		Slot* table = mTable.data() + mTableStart[level];
+		uint64_t const mask = mTableStart[level + 1] - mTableStart[level] - 1;
+		uint64_t const hash = GetHash(mCells[c].key);
+		uint64_t slot = hash & mask;
+		while (table[slot].cell != 0)
+		{
+			slot = (slot + 1) & mask;
+		}
+		table[slot] = Slot{ hash, c + 1 };
+	}
+
+	size_t const numCells = mCells.size();
+	if (team == nullptr || team->GetNumWorkers() == 0)
+	{
+		AppendPairs(0, numCells, pairs);
+		std::sort(pairs.begin(), pairs.end());
+		return;
+	}
+
+	// The cells are read-only during the pairing, so the workers share
+	// them. Each worker appends to its own array, and the arrays are
+	// concatenated in cell order.
+	size_t const numThreads = team->GetNumWorkers();
+	mThreadPairs.resize(numThreads);
+	team->Run([this, numCells, numThreads](size_t t)
+	{
+		size_t cBegin = numCells * t / numThreads;
+		size_t cEnd = numCells * (t + 1) / numThreads;
+		mThreadPairs[t].clear();
+		AppendPairs(cBegin, cEnd, mThreadPairs[t]);
+	});
+
+	for (size_t t = 0; t < numThreads; ++t)
+	{
+		pairs.insert(pairs.end(), mThreadPairs[t].begin(), mThreadPairs[t].end());
+	}
+}
+
+template <typename Real>
+void HierarchicalGrid<Real>::AppendPairs(size_t cBegin, size_t cEnd,
+	std::vector<std::pair<size_t, size_t>>& pairs) const
+{
+	// The forward half of the 3x3x3 neighborhood, excluding the cell itself.
+	// The offsets (dx,dy,dz) are those that are lexicographically positive
+	// when compared in (dz,dy,dx) order.
+	static std::array<std::array<int32_t, 3>, 13> const neighbor =
+	{ {
+		{ +1,  0,  0 },
+		{ -1, +1,  0 }, {  0, +1,  0 }, { +1, +1,  0 },
+		{ -1, -1, +1 }, {  0, -1, +1 }, { +1, -1, +1 },
+		{ -1,  0, +1 }, {  0,  0, +1 }, { +1,  0, +1 },
+		{ -1, +1, +1 }, {  0, +1, +1 }, { +1, +1, +1 }
+	} };
+
+	int32_t const numLevels = static_cast<int32_t>(mCellSize.size());
+	std::vector<RangeCells> caches(mCellSize.size());
+	for (size_t c0 = cBegin; c0 < cEnd; ++c0)
+	{
+		Cell const& cell0 = mCells[c0];
+
+		// Pairs within the cell.
+		for (size_t j0 = cell0.begin; j0 + 1 < cell0.end; ++j0)
+		{
+			for (size_t j1 = j0 + 1; j1 < cell0.end; ++j1)
+			{
+				AppendPair(mSorted[j0], mSorted[j1], pairs);
+			}
+		}
+
+		// Pairs with the forward neighbors at the same level.
+		CellKey key = cell0.key;
+		for (auto const& offset : neighbor)
+		{
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				key.coord[d] = cell0.key.coord[d] + offset[d];
+			}
+			size_t c1 = FindCell(key);
+			if (c1 < mCells.size())
+			{
+				AppendCellPairs(cell0, mCells[c1], pairs);
+			}
+		}
+
+		// Pairs with the cells of the coarser levels that overlap the cell
+		// enlarged by (s0 + s1) / 2, where s0 and s1 are the cell sizes,
+		// because a sphere of the coarser level is at most s1 / 2 from the
+		// cell when it overlaps a sphere of the cell. The coordinates are
+		// in units of s0 / 4, so the cell is [4x,4x+4] and the enlargement
+		// is 2 + 2 * s1 / s0; one more unit allows for the rounding errors
+		// of the cell coordinates. The cells are in Morton order, so
+		// consecutive cells often have the same range, and the occupied
+		// cells of the last range of each level are reused. A level with
+		// fewer cells than the range is scanned instead of looked up.
+		for (int32_t level1 = cell0.key.level + 1; level1 < numLevels; ++level1)
+		{
+			size_t const first = mLevelStart[level1], last = mLevelStart[level1 + 1];
+			if (first == last)
+			{
+				continue;
+			}
+
+			int32_t const shift = level1 - cell0.key.level;
+			int64_t const enlarge = 3 + (int64_t(2) << shift);
+			std::array<int64_t, 3> lower{}, upper{};
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				lower[d] = FloorShift(4 * cell0.key.coord[d] - enlarge, shift + 2);
+				upper[d] = FloorShift(4 * cell0.key.coord[d] + 4 + enlarge, shift + 2);
+			}
+
+			auto& cache = caches[level1];
+			if (!cache.valid || cache.lower != lower || cache.upper != upper)
+			{
+				cache.valid = true;
+				cache.lower = lower;
+				cache.upper = upper;
+				cache.cells.clear();
+				int64_t const numRange = (upper[0] - lower[0] + 1) *
+					(upper[1] - lower[1] + 1) * (upper[2] - lower[2] + 1);
+				if (static_cast<int64_t>(last - first) <= numRange)
+				{
+					for (size_t c1 = first; c1 < last; ++c1)
+					{
+						auto const& coord = mCells[c1].key.coord;
+						if (lower[0] <= coord[0] && coord[0] <= upper[0] &&
+							lower[1] <= coord[1] && coord[1] <= upper[1] &&
+							lower[2] <= coord[2] && coord[2] <= upper[2])
+						{
+							cache.cells.push_back(c1);
+						}
+					}
+				}
+				else
+				{
+					key.level = level1;
+					for (key.coord[2] = lower[2]; key.coord[2] <= upper[2]; ++key.coord[2])
+					{
+						for (key.coord[1] = lower[1]; key.coord[1] <= upper[1]; ++key.coord[1])
+						{
+							for (key.coord[0] = lower[0]; key.coord[0] <= upper[0]; ++key.coord[0])
+							{
+								size_t c1 = FindCell(key);
+								if (c1 < mCells.size())
+								{
+									cache.cells.push_back(c1);
+								}
+							}
+						}
+					}
+				}
+			}
+
+			for (auto c1 : cache.cells)
+			{
+				AppendCellPairs(cell0, mCells[c1], pairs);
+			}
+		}
+	}
+}
+
+template <typename Real>
+void HierarchicalGrid<Real>::AppendCellPairs(Cell const& cell0, Cell const& cell1,
+	std::vector<std::pair<size_t, size_t>>& pairs) const
+{
+	for (size_t j0 = cell0.begin; j0 < cell0.end; ++j0)
+	{
+		size_t i0 = mSorted[j0];
+		for (size_t j1 = cell1.begin; j1 < cell1.end; ++j1)
+		{
+			size_t i1 = mSorted[j1];
+			if (i0 < i1)
+			{
+				AppendPair(i0, i1, pairs);
+			}
+			else
+			{
+				AppendPair(i1, i0, pairs);
+			}
+		}
+	}
+}
+
+template <typename Real>
+void HierarchicalGrid<Real>::AppendPair(size_t i0, size_t i1,
+	std::vector<std::pair<size_t, size_t>>& pairs) const
+{
+	// The cells of a coarse level contain many small spheres of the finer
+	// levels' neighborhoods, so the pairs are filtered by their bounding
+	// boxes before they are sorted.
+	Real const sumRadii = mRadii[i0] + mRadii[i1];
+	Vector3<Real> const& center0 = mCenters[i0];
+	Vector3<Real> const& center1 = mCenters[i1];
+	if (std::fabs(center0[0] - center1[0]) <= sumRadii &&
+		std::fabs(center0[1] - center1[1]) <= sumRadii &&
+		std::fabs(center0[2] - center1[2]) <= sumRadii)
+	{
+		pairs.emplace_back(i0, i1);
+	}
+}
+
+template class HierarchicalGrid<float>;
+template class HierarchicalGrid<double>;
@@ -0,0 +1,173 @@
+#pragma once
+
+#include "Vector.h"
+#include "WorkerTeam.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+using namespace Vector_GM;
+
+// A hierarchical spatial-hash broadphase for spheres whose radii differ by
+// orders of magnitude. Level k has cubic cells of size baseCellSize * 2^k,
+// and each sphere is inserted at the smallest level whose cells are at
+// least its diameter, so a sphere is stored in one cell regardless of its
+// size. The cells are unbounded and only the occupied ones are stored, in a
+// hash table keyed by the level and the integer cell coordinates.
+//
+// Two spheres at the same level can overlap only when their cells are the
+// same or neighbors, and each cell is paired with itself and with the 13
+// neighbors in its forward half of the 3x3x3 neighborhood, as in
+// UniformGrid. For two spheres at levels L < M, the center of the larger
+// sphere is within (s_L + s_M) / 2 of the cell of the smaller one, where
+// s_k is the cell size of level k. Each occupied cell at level L is paired
+// with the cells at each occupied coarser level M that overlap its box
+// enlarged by that distance, 2 or 3 cells in each dimension. The cell sizes
+// are nested powers of two, so the ranges are computed from the integer
+// coordinates. Each level has its own hash table, so the tables of the
+// coarse levels, which every finer cell looks up, stay small when the large
+// spheres are few. The cells are sorted in Morton order, so consecutive
+// cells often share their ranges and the lookups. Every pair of spheres in
+// neighboring cells is visited exactly once, and the pairs whose bounding
+// boxes overlap are the candidates.
+//
+// The base cell size is the diameter of the smallest positive radius. When
+// the radii span more than the maximum number of levels, the base cell
+// size is increased so that the largest sphere fits the coarsest level.
+
+template <typename Real>
+class HierarchicalGrid
+{
+public:
+	HierarchicalGrid();
+
+	// The maximum number of levels must be in [1,32]. The default is 16,
+	// which allows a ratio of 2^15 between the largest and the smallest
+	// radius without coarsening the base level.
+	void SetMaxLevels(size_t maxLevels);
+
+	inline size_t GetMaxLevels() const
+	{
+		return mMaxLevels;
+	}
+
+	// The levels and the cells of the last call to ComputePairs.
+	inline size_t GetNumLevels() const
+	{
+		return mCellSize.size();
+	}
+
+	inline Real GetCellSize(size_t level) const
+	{
+		return mCellSize[level];
+	}
+
+	inline size_t GetNumCells() const
+	{
+		return mCells.size();
+	}
+
+	// Bin the spheres and compute the candidate pairs (i0,i1) with i0 < i1,
+	// which are the pairs of spheres in neighboring cells whose bounding
+	// boxes overlap.
+	// Without a team the pairs are sorted lexicographically so that the
+	// narrowphase processes them in the same order as an all-pairs loop.
+	// With a team the cells are partitioned into ranges that are paired by
+	// the workers. The pairs are then in cell order, not sorted, but the
+	// order does not depend on the number of workers.
+	void ComputePairs(std::vector<Vector3<Real>> const& centers,
+		std::vector<Real> const& radii,
+		std::vector<std::pair<size_t, size_t>>& pairs, WorkerTeam* team = nullptr);
+
+private:
+	// The cells are ordered by level and then in Morton order, so that the
+	// cells of a level are contiguous and the cells with the same parent at
+	// a coarser level are contiguous.
+	struct CellKey
+	{
+		bool operator==(CellKey const& other) const;
+		bool operator<(CellKey const& other) const;
+
+		int32_t level;
+		std::array<int64_t, 3> coord;
+	};
+
+	struct Cell
+	{
+		CellKey key;
+		size_t begin, end;
+	};
+
+	// The occupied cells of a coarser level in the coordinate range
+	// [lower,upper].
+	struct RangeCells
+	{
+		RangeCells()
+			:
+			valid(false),
+			lower{ 0, 0, 0 },
+			upper{ 0, 0, 0 },
+			cells{}
+		{
+		}
+
+		bool valid;
+		std::array<int64_t, 3> lower, upper;
+		std::vector<size_t> cells;
+	};
+
+	// A slot of the hash table. The hash of the key is stored so that most
+	// probes of other cells do not read the cells.
+	struct Slot
+	{
+		uint64_t hash;
+		size_t cell;
+	};
+
+	// Compute the levels and the cell sizes from the radii.
+	void ComputeLevels(std::vector<Real> const& radii);
+	int32_t GetLevel(Real radius) const;
+
+	// The index of the cell in mCells, or mCells.size() when the cell is
+	// empty.
+	size_t FindCell(CellKey const& key) const;
+	static uint64_t GetHash(CellKey const& key);
+
+	// Append the pairs of the cells c0 with cBegin <= c0 < cEnd.
+	void AppendPairs(size_t cBegin, size_t cEnd,
+		std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+	void AppendCellPairs(Cell const& cell0, Cell const& cell1,
+		std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+	// Append (i0,i1) when the bounding boxes of the spheres overlap.
+	void AppendPair(size_t i0, size_t i1,
+		std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+	size_t mMaxLevels;
+	Real mBaseCellSize;
+
+	// The spheres of the current call to ComputePairs.
+	Vector3<Real> const* mCenters;
+	Real const* mRadii;
+	std::vector<Real> mCellSize;
+
+	// The sphere indices sorted by cell and, within a cell, by index. The
+	// spheres of mCells[c] are mSorted[begin] through mSorted[end - 1], and
+	// the cells of level k are mCells[mLevelStart[k]] through
+	// mCells[mLevelStart[k + 1] - 1].
+	// The hash table of level k is mTable[mTableStart[k]] through
+	// mTable[mTableStart[k + 1] - 1], whose size is a power of two. It
+	// stores the cell indices plus 1 with linear probing; 0 marks an empty
+	// slot. The storage is reused across calls.
+	std::vector<std::pair<CellKey, size_t>> mEntries;
+	std::vector<size_t> mSorted;
+	std::vector<Cell> mCells;
+	std::vector<size_t> mLevelStart;
+	std::vector<size_t> mTableStart;
+	std::vector<Slot> mTable;
+
+	// Per-worker pairs for a team.
+	std::vector<std::vector<std::pair<size_t, size_t>>> mThreadPairs;
+};
@@ -34,9 +34,9 @@ namespace gte
         Result operator()(AlignedBox3<T> const& box, Sphere3<T> const& sphere)
         {
             DCPQuery<T, Vector3<T>, AlignedBox3<T>> pbQuery;
-            auto pbResult = pbQuery(sphere.center, box);
+            T sqrDistance = pbQuery.SqrDistance(sphere.center, box);
             Result result{};
-            result.intersect = (pbResult.sqrDistance <= sphere.radius * sphere.radius);
+            result.intersect = (sqrDistance <= sphere.radius * sphere.radius);
             return result;
         }
     };
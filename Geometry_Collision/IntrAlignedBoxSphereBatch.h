@@ -0,0 +1,318 @@
+#pragma once
+
+#include "AlignedBoxArray3.h"
+#include "IntrAlignedBoxSphere.h"
+#include "IntrRayAlignedBoxBatch.h"
+#include "SphereArray3.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Batched test-intersection queries for solid aligned boxes and solid
+// spheres, for example trigger volumes tested against many bodies per
+// frame. TIQuery<T, AlignedBox3<T>, Sphere3<T>> computes the full
+// point-box distance query, including the closest points and a square
+// root, and then compares the squared distance to the squared radius. The
+// queries here compute only the squared distance from the sphere center to
+// the box,
+//   sum_d (c[d] - clamp(c[d], min[d], max[d]))^2,
+// with selects rather than branches and without a square root.
+// The results are written as a bit mask: bit j of mask[j / 64] is set iff
+// test j finds an overlap. The return value is the number of overlaps.
+//
+//   TIQuery<T, AlignedBoxArray3<T>, SphereArray3<T>>
+//       box j against sphere j; the arrays must have the same size
+//   TIQuery<T, AlignedBoxArray3<T>, Sphere3<T>>
+//       every box against one sphere
+//   TIQuery<T, AlignedBox3<T>, SphereArray3<T>>
+//       one box against every sphere
+//
+// The squared distance is computed from the box corners instead of the
+// centered form, so for a sphere that exactly touches the box the result
+// can differ from the single query by rounding.
+//
+// The batched find-intersection query for moving spheres and a moving box,
+//   FIQuery<T, AlignedBox3<T>, SphereArray3<T>>
+//       one box against every sphere, each with its own velocity,
+// produces the results of FIQuery<T, AlignedBox3<T>, Sphere3<T>> for each
+// sphere. The single query rejects a sphere that misses the box with a
+// ray-box test against the box enlarged by the sphere radius. The batched
+// query performs that test with the branch-free slab loops of
+// IntrRayAlignedBoxBatch.h, 64 spheres at a time, and runs the rest of the
+// single query only for the spheres that pass. The enlarged box of the slab
+// test is grown by a relative 2^{-10} so that rounding never rejects a
+// sphere that the single query accepts. The results are those of the single
+// query, except that a sphere whose path grazes the enlarged box can be
+// reported as a contact by the batched query only.
+
+namespace Vector_GM
+{
+    // The kernel shared by the batched box-sphere queries.
+    template <typename T>
+    class AlignedBoxSphereBatchKernel
+    {
+    public:
+        // The squared distance along one axis from c to [bmin,bmax]. The
+        // selects have the operand order of the min and max instructions,
+        // so that the compiler does not generate branches for them.
+        static inline T SqrDistance(T c, T bmin, T bmax)
+        {
+            T closest = (bmin < c ? c : bmin);
+            closest = (closest < bmax ? closest : bmax);
+            T delta = c - closest;
+            return delta * delta;
+        }
+
+        // Sphere j has center (c[0][j],c[1][j],c[2][j]) and radius r[j], and
+        // box j is [bmin[0][j],bmax[0][j]]*...; the stride of an array is 0
+        // when one sphere or one box is tested against all the others. The
+        // strides are template parameters so that the loops vectorize. The
+        // tests are processed in blocks of 64 so that each block produces
+        // one mask word. The squared distances of a block are computed in a
+        // loop without branches and then compared and packed.
+        template <size_t sphereStride, size_t boxStride>
+        static size_t Run(size_t numTests,
+            std::array<T const*, 3> const& c, T const* r,
+            std::array<T const*, 3> const& bmin, std::array<T const*, 3> const& bmax,
+            std::vector<uint64_t>& mask)
+        {
+            mask.assign((numTests + 63) / 64, 0);
+            size_t numOverlaps = 0;
+            std::array<T, 64> sqrDistance{}, sqrRadius{};
+            for (size_t begin = 0, w = 0; begin < numTests; begin += 64, ++w)
+            {
+                size_t const count = (numTests - begin < 64 ? numTests - begin : 64);
+                size_t const s = begin * sphereStride, b = begin * boxStride;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    sqrDistance[j] = static_cast<T>(0);
+                }
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    T const* cd = c[d] + s;
+                    T const* mind = bmin[d] + b;
+                    T const* maxd = bmax[d] + b;
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        sqrDistance[j] += SqrDistance(cd[j * sphereStride],
+                            mind[j * boxStride], maxd[j * boxStride]);
+                    }
+                }
+                T const* rj = r + s;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    sqrRadius[j] = rj[j * sphereStride] * rj[j * sphereStride];
+                }
+
+                uint64_t word = 0;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    uint64_t const overlap = static_cast<uint64_t>(sqrDistance[j] <= sqrRadius[j]);
+                    word |= overlap << j;
+                    numOverlaps += static_cast<size_t>(overlap);
+                }
+                mask[w] = word;
+            }
+            return numOverlaps;
+        }
+    };
+
+    template <typename T>
+    class TIQuery<T, AlignedBoxArray3<T>, SphereArray3<T>>
+    {
+    public:
+        size_t operator()(AlignedBoxArray3<T> const& boxes, SphereArray3<T> const& spheres,
+            std::vector<uint64_t>& mask)
+        {
+            GTL_ARGUMENT_ASSERT(
+                boxes.size() == spheres.size(),
+                "The arrays must have the same size.");
+
+            return AlignedBoxSphereBatchKernel<T>::template Run<1, 1>(boxes.size(),
+                { spheres.center[0].data(), spheres.center[1].data(), spheres.center[2].data() },
+                spheres.radius.data(),
+                { boxes.min[0].data(), boxes.min[1].data(), boxes.min[2].data() },
+                { boxes.max[0].data(), boxes.max[1].data(), boxes.max[2].data() },
+                mask);
+        }
+    };
+
+    template <typename T>
+    class TIQuery<T, AlignedBoxArray3<T>, Sphere3<T>>
+    {
+    public:
+        size_t operator()(AlignedBoxArray3<T> const& boxes, Sphere3<T> const& sphere,
+            std::vector<uint64_t>& mask)
+        {
+            std::array<T, 3> const center{ sphere.center[0], sphere.center[1], sphere.center[2] };
+            return AlignedBoxSphereBatchKernel<T>::template Run<0, 1>(boxes.size(),
+                { &center[0], &center[1], &center[2] }, &sphere.radius,
+                { boxes.min[0].data(), boxes.min[1].data(), boxes.min[2].data() },
+                { boxes.max[0].data(), boxes.max[1].data(), boxes.max[2].data() },
+                mask);
+        }
+    };
+
+    template <typename T>
+    class TIQuery<T, AlignedBox3<T>, SphereArray3<T>>
+    {
+    public:
+        size_t operator()(AlignedBox3<T> const& box, SphereArray3<T> const& spheres,
+            std::vector<uint64_t>& mask)
+        {
+            std::array<T, 3> const bmin{ box.min[0], box.min[1], box.min[2] };
+            std::array<T, 3> const bmax{ box.max[0], box.max[1], box.max[2] };
+            return AlignedBoxSphereBatchKernel<T>::template Run<1, 0>(spheres.size(),
+                { spheres.center[0].data(), spheres.center[1].data(), spheres.center[2].data() },
+                spheres.radius.data(),
+                { &bmin[0], &bmin[1], &bmin[2] }, { &bmax[0], &bmax[1], &bmax[2] },
+                mask);
+        }
+    };
+
+    template <typename T>
+    class FIQuery<T, AlignedBox3<T>, SphereArray3<T>>
+        :
+        protected FIQuery<T, AlignedBox3<T>, Sphere3<T>>
+    {
+    public:
+        // Structure-of-arrays form of the results of the single query; see
+        // FIQuery<T, AlignedBox3<T>, Sphere3<T>>::Result for the meaning of
+        // the members.
+        struct Result
+        {
+            Result()
+                :
+                numIntersections(0)
+            {
+            }
+
+            void Resize(size_t numSpheres)
+            {
+                intersectionType.resize(numSpheres);
+                contactTime.resize(numSpheres);
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    contactPoint[d].resize(numSpheres);
+                }
+            }
+
+            // The number of spheres whose intersectionType is not 0.
+            size_t numIntersections;
+            std::vector<int32_t> intersectionType;
+            std::vector<T> contactTime;
+            std::array<std::vector<T>, 3> contactPoint;
+        };
+
+        // Sphere j moves with velocity (velocity[0][j], velocity[1][j],
+        // velocity[2][j]).
+        Result operator()(AlignedBox3<T> const& box, Vector3<T> const& boxVelocity,
+            SphereArray3<T> const& spheres, std::array<std::vector<T>, 3> const& velocity)
+        {
+            Result result{};
+            result.Resize(spheres.size());
+            result.numIntersections = (*this)(box, boxVelocity, spheres, velocity,
+                0, spheres.size(), result);
+            return result;
+        }
+
+        // Query the spheres j in [begin,end) and store their results in
+        // 'result', which must have been resized to at least 'end' spheres.
+        // The return value is the number of intersections in the range.
+        // Threads can query disjoint ranges with the same 'result'.
+        size_t operator()(AlignedBox3<T> const& box, Vector3<T> const& boxVelocity,
+            SphereArray3<T> const& spheres, std::array<std::vector<T>, 3> const& velocity,
+            size_t begin, size_t end, Result& result)
+        {
+            GTL_ARGUMENT_ASSERT(
+                end <= spheres.size() && velocity[0].size() == spheres.size() &&
+                velocity[1].size() == spheres.size() && velocity[2].size() == spheres.size() &&
+                end <= result.intersectionType.size(),
+                "Invalid range or array sizes.");
+
+            T const zero = static_cast<T>(0);
+            T const one = static_cast<T>(1);
+            T const half = static_cast<T>(0.5);
+            T const slack = one + one / static_cast<T>(1024);
+            std::array<T, 3> boxCenter{}, extent{};
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                boxCenter[d] = (box.max[d] + box.min[d]) * half;
+                extent[d] = (box.max[d] - box.min[d]) * half;
+            }
+
+            size_t numIntersections = 0;
+            std::array<T, blockSize> tEnter{}, tExit{};
+            for (size_t first = begin; first < end; first += blockSize)
+            {
+                size_t const count = (end - first < blockSize ? end - first : blockSize);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    tEnter[j] = zero;
+                    tExit[j] = std::numeric_limits<T>::max();
+                }
+
+                // The ray C+t*V, with C the sphere center and V the sphere
+                // velocity relative to the box, against the box enlarged by
+                // the sphere radius.
+                T const* r = spheres.radius.data() + first;
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    T const* c = spheres.center[d].data() + first;
+                    T const* v = velocity[d].data() + first;
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        T const C = c[j] - boxCenter[d];
+                        T const invV = one / (v[j] - boxVelocity[d]);
+                        T const e = (extent[d] + r[j]) * slack;
+                        T const t0 = (-e - C) * invV;
+                        T const t1 = (e - C) * invV;
+                        SlabQuery::UpdateInterval(t0, t1, tEnter[j], tExit[j]);
+                    }
+                }
+
+                for (size_t j = 0; j < count; ++j)
+                {
+                    size_t const i = first + j;
+                    if (tEnter[j] <= tExit[j])
+                    {
+                        Vector3<T> K{}, C{}, V{};
+                        for (int32_t d = 0; d < 3; ++d)
+                        {
+                            K[d] = extent[d];
+                            C[d] = spheres.center[d][i] - boxCenter[d];
+                            V[d] = velocity[d][i] - boxVelocity[d];
+                        }
+                        SingleResult single{};
+                        this->DoQuery(K, C, spheres.radius[i], V, single);
+                        result.intersectionType[i] = single.intersectionType;
+                        result.contactTime[i] = single.contactTime;
+                        for (int32_t d = 0; d < 3; ++d)
+                        {
+                            result.contactPoint[d][i] = single.contactPoint[d] + boxCenter[d];
+                        }
+                        numIntersections += static_cast<size_t>(single.intersectionType != 0);
+                    }
+                    else
+                    {
+                        result.intersectionType[i] = 0;
+                        result.contactTime[i] = zero;
+                        for (int32_t d = 0; d < 3; ++d)
+                        {
+                            result.contactPoint[d][i] = zero;
+                        }
+                    }
+                }
+            }
+            return numIntersections;
+        }
+
+    private:
+        using SingleResult = typename FIQuery<T, AlignedBox3<T>, Sphere3<T>>::Result;
+        using SlabQuery = TIQuery<T, RayPacket3<T, 1>, AlignedBox3<T>>;
+
+        static size_t constexpr blockSize = 64;
+    };
+}
@@ -6,6 +6,8 @@
 #include "AlignedBox.h"
 #include "Line.h"
 #include "Vector.h"
+#include "typeTraits_GM.h"
+#include <limits>
 
 // The test-intersection queries use the method of separating axes.
 // https://www.geometrictools.com/Documentation/MethodOfSeparatingAxes.pdf
@@ -14,9 +16,30 @@
 // clipping. The queries consider the box to be a solid. The algorithms
 // are described in
 // https://www.geometrictools.com/Documentation/IntersectionLineBox.pdf
+//
+// The queries support float, double and the arbitrary-precision types for
+// which gtl::is_arbitrary_precision<T>::value is true. The differences are
+// selected with 'if constexpr', so the floating-point instantiations
+// compile to the same code as before and do not pay for the exact
+// arithmetic paths.
 
 namespace Vector_GM
 {
+    // The absolute value for the line-box and ray-box queries. The
+    // arbitrary-precision types do not overload std::fabs.
+    template <typename T>
+    inline T LineBoxAbs(T const& x)
+    {
+        if constexpr (gtl::is_arbitrary_precision<T>::value)
+        {
+            return (x < static_cast<T>(0) ? -x : x);
+        }
+        else
+        {
+            return std::fabs(x);
+        }
+    }
+
     template <typename T>
     class TIQuery<T, Line3<T>, AlignedBox3<T>>
     {
@@ -57,22 +80,22 @@ namespace Vector_GM
             Vector3<T> WxD = Cross(lineDirection, lineOrigin);
             std::array<T, 3> absWdU
             {
-                std::fabs(lineDirection[0]),
-                    std::fabs(lineDirection[1]),
-                    std::fabs(lineDirection[2])
+                LineBoxAbs(lineDirection[0]),
+                LineBoxAbs(lineDirection[1]),
+                LineBoxAbs(lineDirection[2])
             };
 
-            if (std::fabs(WxD[0]) > boxExtent[1] * absWdU[2] + boxExtent[2] * absWdU[1])
+            if (LineBoxAbs(WxD[0]) > boxExtent[1] * absWdU[2] + boxExtent[2] * absWdU[1])
             {
                 return;
             }
 
-            if (std::fabs(WxD[1]) > boxExtent[0] * absWdU[2] + boxExtent[2] * absWdU[0])
+            if (LineBoxAbs(WxD[1]) > boxExtent[0] * absWdU[2] + boxExtent[2] * absWdU[0])
             {
                 return;
             }
 
-            if (std::fabs(WxD[2]) > boxExtent[0] * absWdU[1] + boxExtent[1] * absWdU[0])
+            if (LineBoxAbs(WxD[2]) > boxExtent[0] * absWdU[1] + boxExtent[1] * absWdU[0])
             {
                 return;
             }
@@ -137,8 +160,29 @@ namespace Vector_GM
             //   0, no intersection
             //   1, intersect in a single point (t0 is line parameter of point)
             //   2, intersect in a segment (line parameter interval is [t0,t1])
-            T t0 = -std::numeric_limits<T>::max();
-            T t1 = std::numeric_limits<T>::max();
+            T t0{}, t1{};
+            if constexpr (gtl::is_arbitrary_precision<T>::value)
+            {
+                // There is no largest number, so start with an interval
+                // that contains the parameters of all box points. For such
+                // a point X, |t|*|D| = |X-P| <= |X|_1 + |P|_1 and
+                // |D| >= Dot(D,D)/|D|_1, where |*|_1 is the sum of the
+                // absolute values of the components. The direction is
+                // nonzero.
+                T sumP{}, sumD{};
+                for (int32_t i = 0; i < 3; ++i)
+                {
+                    sumP += LineBoxAbs(lineOrigin[i]) + boxExtent[i];
+                    sumD += LineBoxAbs(lineDirection[i]);
+                }
+                t1 = sumP * sumD / Dot(lineDirection, lineDirection);
+                t0 = -t1;
+            }
+            else
+            {
+                t0 = -std::numeric_limits<T>::max();
+                t1 = std::numeric_limits<T>::max();
+            }
             if (Clip(+lineDirection[0], -lineOrigin[0] - boxExtent[0], t0, t1) &&
                 Clip(-lineDirection[0], +lineOrigin[0] - boxExtent[0], t0, t1) &&
                 Clip(+lineDirection[1], -lineOrigin[1] - boxExtent[1], t0, t1) &&
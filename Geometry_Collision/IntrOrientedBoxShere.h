@@ -2,6 +2,9 @@
 
 #include "DistPointOrientedBox.h"
 #include "IntrAlignedBoxSphere.h"
+#include <array>
+#include <cstddef>
+#include <vector>
 
 namespace Vector_GM
 {
@@ -30,9 +33,9 @@ namespace Vector_GM
 		Result operator()(OrientedBox3<Real> const& box, Sphere3<Real> const& sphere)
 		{
 			DCPQuery<Real, Vector3<Real>, OrientedBox3<Real>> pbQuery;
-			auto pbResult = pbQuery(sphere.center, box);
+			Real sqrDistance = pbQuery.SqrDistance(sphere.center, box);
 			Result result{};
-			result.intersect = (pbResult.sqrDistance <= sphere.radius * sphere.radius);
+			result.intersect = (sqrDistance <= sphere.radius * sphere.radius);
 			return result;
 		}
 	};
@@ -95,5 +98,127 @@ namespace Vector_GM
 			}
 			return result;
 		}
+
+		// A box prepared for repeated queries, for example static level
+		// geometry that is tested against many moving spheres. The axes
+		// are stored as the rows of a packed 3x3 rotation, so the transform
+		// of a sphere reads 9 contiguous numbers.
+		struct PreparedBox
+		{
+			PreparedBox()
+				:
+				rotation{},
+				center(Vector3<Real>::Zero()),
+				extent(Vector3<Real>::Zero())
+			{
+			}
+
+			PreparedBox(OrientedBox3<Real> const& box)
+				:
+				rotation{},
+				center(box.center),
+				extent(box.extent)
+			{
+				for (int32_t r = 0, i = 0; r < 3; ++r)
+				{
+					for (int32_t c = 0; c < 3; ++c, ++i)
+					{
+						rotation[i] = box.axis[r][c];
+					}
+				}
+			}
+
+			// rotation[3 * r + c] is component c of box axis r.
+			std::array<Real, 9> rotation;
+			Vector3<Real> center, extent;
+		};
+
+		// The query for a prepared box. The results are the same as those
+		// of the query for the original box.
+		Result operator()(PreparedBox const& box, Vector3<Real> const& boxVelocity,
+			Sphere3<Real> const& sphere, Vector3<Real> const& sphereVelocity)
+		{
+			Vector3<Real> C = Rotate(box, sphere.center - box.center);
+			Vector3<Real> V = Rotate(box, sphereVelocity - boxVelocity);
+			Result result{};
+			DoPreparedQuery(box, C, sphere.radius, V, result);
+			return result;
+		}
+
+		// The query for many spheres moving relative to a prepared box. The
+		// sphere centers and velocities are transformed to the box
+		// coordinate system in one pass before the queries are run, and
+		// results[i] is the result for spheres[i] and sphereVelocities[i].
+		void operator()(PreparedBox const& box, Vector3<Real> const& boxVelocity,
+			std::vector<Sphere3<Real>> const& spheres,
+			std::vector<Vector3<Real>> const& sphereVelocities,
+			std::vector<Result>& results)
+		{
+			GTL_ARGUMENT_ASSERT(
+				spheres.size() == sphereVelocities.size(),
+				"The number of spheres and velocities must be the same.");
+
+			size_t const numSpheres = spheres.size();
+			mCenters.resize(numSpheres);
+			mVelocities.resize(numSpheres);
+			for (size_t i = 0; i < numSpheres; ++i)
+			{
+				mCenters[i] = Rotate(box, spheres[i].center - box.center);
+				mVelocities[i] = Rotate(box, sphereVelocities[i] - boxVelocity);
+			}
+
+			results.resize(numSpheres);
+			for (size_t i = 0; i < numSpheres; ++i)
+			{
+				DoPreparedQuery(box, mCenters[i], spheres[i].radius, mVelocities[i],
+					results[i]);
+			}
+		}
+
+	private:
+		// Compute the coordinates of v relative to the box axes. The sums
+		// are accumulated in the order of Dot, so the results are the same
+		// as those of Dot(v, box.axis[r]).
+		static Vector3<Real> Rotate(PreparedBox const& box, Vector3<Real> const& v)
+		{
+			Real const* R = box.rotation.data();
+			Vector3<Real> result{};
+			for (int32_t r = 0; r < 3; ++r, R += 3)
+			{
+				Real dot = (Real)0;
+				dot += v[0] * R[0];
+				dot += v[1] * R[1];
+				dot += v[2] * R[2];
+				result[r] = dot;
+			}
+			return result;
+		}
+
+		void DoPreparedQuery(PreparedBox const& box, Vector3<Real> const& C,
+			Real radius, Vector3<Real> const& V, Result& result)
+		{
+			result.intersectionType = 0;
+			result.contactTime = (Real)0;
+			result.contactPoint = { (Real)0, (Real)0, (Real)0 };
+
+			this->DoQuery(box.extent, C, radius, V, result);
+
+			// Transform back to the original coordinate system.
+			if (result.intersectionType != 0)
+			{
+				auto& P = result.contactPoint;
+				Real const* R = box.rotation.data();
+				Vector3<Real> contactPoint{};
+				for (int32_t c = 0; c < 3; ++c)
+				{
+					contactPoint[c] = box.center[c] + P[0] * R[c] + P[1] * R[3 + c] + P[2] * R[6 + c];
+				}
+				P = contactPoint;
+			}
+		}
+
+		// Scratch storage for the batch query, kept to avoid allocations
+		// when the query object is reused.
+		std::vector<Vector3<Real>> mCenters, mVelocities;
 	};
 }
@@ -11,6 +11,11 @@
 // clipping. The queries consider the box to be a solid. The algorithms
 // are described in
 // https://www.geometrictools.com/Documentation/IntersectionLineBox.pdf
+//
+// This is the only implementation of the ray-box queries. The moving
+// sphere-box query of IntrAlignedBoxSphere.h and the batched queries of
+// IntrRayAlignedBoxBatch.h are built on it. See IntrLineAlignedBox.h for
+// the floating-point and arbitrary-precision paths.
 
 namespace Vector_GM
 {
@@ -58,7 +63,7 @@ namespace Vector_GM
             T const zero = static_cast<T>(0);
             for (int32_t i = 0; i < 3; ++i)
             {
-                if (std::fabs(rayOrigin[i]) > boxExtent[i] &&
+                if (LineBoxAbs(rayOrigin[i]) > boxExtent[i] &&
                     rayOrigin[i] * rayDirection[i] >= zero)
                 {
                     result.intersect = false;
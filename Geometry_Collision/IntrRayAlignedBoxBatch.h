@@ -0,0 +1,257 @@
+#pragma once
+
+#include "AlignedBoxArray3.h"
+#include "IntrRayAlignedBox.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Batched test-intersection queries for rays and aligned boxes. The queries
+// in IntrRayAlignedBox.h handle one ray and one box per call; they compute
+// the centered form of the box and branch on each axis. The queries here
+// use the slab method instead. The ray origins and the reciprocals of the
+// ray directions are stored once in structure-of-arrays form, and the slab
+// intervals are combined with selects rather than early exits, so that the
+// inner loops are branch free and the compiler can vectorize them.
+//
+//   TIQuery<T, RayPacket3<T, N>, AlignedBox3<T>>
+//       N rays against one box, for example a block of picking or
+//       visibility rays against a bounding box.
+//   TIQuery<T, Ray3<T>, AlignedBoxArray3<T>>
+//       One ray against many boxes, for example a ray against the bounding
+//       boxes of a scene.
+//
+// For ray P+t*D, t >= 0, the slab of axis d is crossed for t between
+// (min[d]-P[d])/D[d] and (max[d]-P[d])/D[d]. The ray intersects the box
+// when the intersection of the three slab t-intervals and [0,+infinity) is
+// not empty. The box is considered to be a solid, and the boundary is part
+// of the box. When D[d] = 0, the reciprocal is +infinity or -infinity and
+// the slab interval is (-infinity,+infinity) or empty, depending on whether
+// P[d] is inside the slab. The 0*infinity that occurs when P[d] is exactly
+// on a slab boundary produces a NaN; such a slab is ignored, so the ray is
+// treated as inside the slab.
+// The directions need not be unit length.
+
+namespace Vector_GM
+{
+    // A packet of N rays in structure-of-arrays form. The reciprocal of
+    // the direction is computed when a ray is set.
+    template <typename T, size_t N>
+    class RayPacket3
+    {
+    public:
+        static_assert(N > 0 && N <= 32, "The packet size must be in [1,32].");
+
+        // The default constructor creates an empty packet.
+        RayPacket3()
+            :
+            numRays(0),
+            origin{},
+            inverseDirection{}
+        {
+        }
+
+        void Clear()
+        {
+            numRays = 0;
+        }
+
+        // Append a ray. The caller must ensure that numRays < N.
+        void Push(Ray3<T> const& ray)
+        {
+            Set(numRays++, ray);
+        }
+
+        // Set the ray at lane i < numRays.
+        void Set(size_t i, Ray3<T> const& ray)
+        {
+            T const one = static_cast<T>(1);
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                origin[d][i] = ray.origin[d];
+                inverseDirection[d][i] = one / ray.direction[d];
+            }
+        }
+
+        // Lanes numRays through N-1 are unused. Their contents are still
+        // processed by the queries, but their results are masked off.
+        size_t numRays;
+        std::array<std::array<T, N>, 3> origin;
+        std::array<std::array<T, N>, 3> inverseDirection;
+    };
+
+    template <typename T, size_t N>
+    class TIQuery<T, RayPacket3<T, N>, AlignedBox3<T>>
+    {
+    public:
+        struct Result
+        {
+            Result()
+                :
+                intersect(0),
+                parameter{}
+            {
+            }
+
+            // Bit i is set iff ray i intersects the box. For such a ray,
+            // parameter[i] is the smallest t >= 0 at which the ray is in the
+            // box; it is 0 when the ray origin is inside the box.
+            uint32_t intersect;
+            std::array<T, N> parameter;
+        };
+
+        Result operator()(RayPacket3<T, N> const& packet, AlignedBox3<T> const& box)
+        {
+            T const zero = static_cast<T>(0);
+            std::array<T, N> tEnter{}, tExit{};
+            for (size_t i = 0; i < N; ++i)
+            {
+                tEnter[i] = zero;
+                tExit[i] = std::numeric_limits<T>::max();
+            }
+
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                T const bmin = box.min[d], bmax = box.max[d];
+                auto const& origin = packet.origin[d];
+                auto const& invDirection = packet.inverseDirection[d];
+                for (size_t i = 0; i < N; ++i)
+                {
+                    T t0 = (bmin - origin[i]) * invDirection[i];
+                    T t1 = (bmax - origin[i]) * invDirection[i];
+                    UpdateInterval(t0, t1, tEnter[i], tExit[i]);
+                }
+            }
+
+            Result result{};
+            for (size_t i = 0; i < N; ++i)
+            {
+                result.intersect |= static_cast<uint32_t>(tEnter[i] <= tExit[i]) << i;
+                result.parameter[i] = tEnter[i];
+            }
+            uint32_t const activeMask = (packet.numRays >= 32 ? 0xFFFFFFFFu :
+                (1u << packet.numRays) - 1u);
+            result.intersect &= activeMask;
+            return result;
+        }
+
+        // Intersect [tEnter,tExit] with the slab interval bounded by t0 and
+        // t1. A NaN occurs only for a ray parallel to the slab with origin
+        // on its boundary; the slab then does not constrain the ray and the
+        // interval is unchanged. The interval starts as [0,tmax] with tmax
+        // the largest finite number, so that the interval [+inf,+inf] of a
+        // parallel ray outside the slab makes it empty.
+        static inline void UpdateInterval(T t0, T t1, T& tEnter, T& tExit)
+        {
+            bool const valid = (t0 == t0) && (t1 == t1);
+            T tNear = (t1 < t0 ? t1 : t0);
+            T tFar = (t1 < t0 ? t0 : t1);
+            tEnter = (valid && tNear > tEnter ? tNear : tEnter);
+            tExit = (valid && tFar < tExit ? tFar : tExit);
+        }
+    };
+
+    template <typename T>
+    class TIQuery<T, Ray3<T>, AlignedBoxArray3<T>>
+    {
+    public:
+        struct Result
+        {
+            Result()
+                :
+                numIntersections(0),
+                nearest(std::numeric_limits<size_t>::max()),
+                parameter(std::numeric_limits<T>::infinity())
+            {
+            }
+
+            // The number of boxes intersected by the ray. When it is
+            // positive, 'nearest' is the index of a box with the smallest
+            // entry parameter, and 'parameter' is that entry parameter. Ties
+            // are resolved in favor of the smaller index.
+            size_t numIntersections;
+            size_t nearest;
+            T parameter;
+        };
+
+        Result operator()(Ray3<T> const& ray, AlignedBoxArray3<T> const& boxes)
+        {
+            return DoQuery(ray, boxes, nullptr);
+        }
+
+        // The same query, but the indices of all intersected boxes are also
+        // stored, in increasing order, in 'intersecting'.
+        Result operator()(Ray3<T> const& ray, AlignedBoxArray3<T> const& boxes,
+            std::vector<size_t>& intersecting)
+        {
+            intersecting.clear();
+            return DoQuery(ray, boxes, &intersecting);
+        }
+
+    protected:
+        using PacketQuery = TIQuery<T, RayPacket3<T, 1>, AlignedBox3<T>>;
+
+        // The boxes are processed in blocks so that the per-box intervals
+        // live on the stack and the slab loops have a fixed trip count.
+        static size_t constexpr blockSize = 64;
+
+        Result DoQuery(Ray3<T> const& ray, AlignedBoxArray3<T> const& boxes,
+            std::vector<size_t>* intersecting)
+        {
+            T const zero = static_cast<T>(0);
+            T const one = static_cast<T>(1);
+            std::array<T, 3> origin{}, invDirection{};
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                origin[d] = ray.origin[d];
+                invDirection[d] = one / ray.direction[d];
+            }
+
+            Result result{};
+            size_t const numBoxes = boxes.size();
+            std::array<T, blockSize> tEnter{}, tExit{};
+            for (size_t begin = 0; begin < numBoxes; begin += blockSize)
+            {
+                size_t const count = (numBoxes - begin < blockSize ?
+                    numBoxes - begin : blockSize);
+                for (size_t j = 0; j < count; ++j)
+                {
+                    tEnter[j] = zero;
+                    tExit[j] = std::numeric_limits<T>::max();
+                }
+
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    T const* bmin = boxes.min[d].data() + begin;
+                    T const* bmax = boxes.max[d].data() + begin;
+                    for (size_t j = 0; j < count; ++j)
+                    {
+                        T t0 = (bmin[j] - origin[d]) * invDirection[d];
+                        T t1 = (bmax[j] - origin[d]) * invDirection[d];
+                        PacketQuery::UpdateInterval(t0, t1, tEnter[j], tExit[j]);
+                    }
+                }
+
+                for (size_t j = 0; j < count; ++j)
+                {
+                    if (tEnter[j] <= tExit[j])
+                    {
+                        ++result.numIntersections;
+                        if (tEnter[j] < result.parameter)
+                        {
+                            result.nearest = begin + j;
+                            result.parameter = tEnter[j];
+                        }
+                        if (intersecting)
+                        {
+                            intersecting->push_back(begin + j);
+                        }
+                    }
+                }
+            }
+            return result;
+        }
+    };
+}
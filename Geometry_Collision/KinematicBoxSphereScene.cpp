@@ -0,0 +1,225 @@
+#include "KinematicBoxSphereScene.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <thread>
+
+KinematicBoxSphereScene::KinematicBoxSphereScene(size_t numBoxes, size_t numSpheres,
+	Vector3<float> const& center, float halfSize, uint32_t seed)
+{
+	std::mt19937 generator(seed);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::uniform_real_distribution<float> frequency(0.2f, 1.0f);
+	std::uniform_real_distribution<float> phase(0.0f, 6.2831853f);
+
+	// The anchors leave room for the amplitudes, which are at most 1/8 of
+	// the half-size, so the objects stay in the cube.
+	float const anchorSize = 0.875f * halfSize;
+	float const maxAmplitude = 0.125f * halfSize;
+	auto createMotion = [&]()
+	{
+		Motion motion{};
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			motion.anchor[d] = center[d] + anchorSize * unit(generator);
+			motion.amplitude[d] = maxAmplitude * unit(generator);
+			motion.frequency[d] = frequency(generator);
+			motion.phase[d] = phase(generator);
+			motion.spinAxis[d] = unit(generator);
+		}
+		Normalize(motion.spinAxis);
+		motion.spinSpeed = unit(generator);
+		return motion;
+	};
+
+	// The box extents are in [1/64,1/16] of the half-size and the sphere
+	// radii in [1/128,1/32] of it, so a box overlaps a few spheres.
+	std::uniform_real_distribution<float> extent(halfSize / 64.0f, halfSize / 16.0f);
+	std::uniform_real_distribution<float> radius(halfSize / 128.0f, halfSize / 32.0f);
+
+	mBoxMotions.resize(numBoxes);
+	mBoxes.resize(numBoxes);
+	for (size_t b = 0; b < numBoxes; ++b)
+	{
+		mBoxMotions[b] = createMotion();
+		mBoxes[b].extent = { extent(generator), extent(generator), extent(generator) };
+	}
+
+	mSphereMotions.resize(numSpheres);
+	mSpheres.Reserve(numSpheres);
+	for (size_t s = 0; s < numSpheres; ++s)
+	{
+		mSphereMotions[s] = createMotion();
+		Sphere3<float> sphere{};
+		sphere.radius = radius(generator);
+		mSpheres.Push(sphere);
+	}
+
+	mPrepared.resize(numBoxes);
+	mBoxOverlaps.resize(numBoxes);
+	Update(0.0f);
+}
+
+void KinematicBoxSphereScene::Update(float time)
+{
+	for (size_t b = 0; b < mBoxes.size(); ++b)
+	{
+		Motion const& motion = mBoxMotions[b];
+		OrientedBox3<float>& box = mBoxes[b];
+		box.center = GetPosition(motion, time);
+
+		// The axes are the standard basis rotated about the spin axis by
+		// the Rodrigues formula
+		//   R*e = cs*e + sn*Cross(u,e) + (1-cs)*Dot(u,e)*u
+		Vector3<float> const& u = motion.spinAxis;
+		float const angle = motion.spinSpeed * time;
+		float const cs = std::cos(angle), sn = std::sin(angle);
+		for (int32_t i = 0; i < 3; ++i)
+		{
+			Vector3<float> e{ 0.0f, 0.0f, 0.0f };
+			e[i] = 1.0f;
+			box.axis[i] = cs * e + sn * Cross(u, e) + ((1.0f - cs) * u[i]) * u;
+		}
+
+		mPrepared[b] = PreparedBox(box);
+	}
+
+	for (size_t s = 0; s < mSphereMotions.size(); ++s)
+	{
+		Vector3<float> const position = GetPosition(mSphereMotions[s], time);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			mSpheres.center[d][s] = position[d];
+		}
+	}
+}
+
+size_t KinematicBoxSphereScene::Test(Path path, size_t numThreads)
+{
+	size_t const numBoxes = mBoxes.size();
+	size_t const numSpheres = mSpheres.size();
+
+	if (path == Path::SCALAR)
+	{
+		size_t numOverlaps = 0;
+		for (size_t b = 0; b < numBoxes; ++b)
+		{
+			uint32_t count = 0;
+			for (size_t s = 0; s < numSpheres; ++s)
+			{
+				if (mQuery(mBoxes[b], mSpheres.Get(s)).intersect)
+				{
+					++count;
+				}
+			}
+			mBoxOverlaps[b] = count;
+			numOverlaps += count;
+		}
+		return numOverlaps;
+	}
+
+	size_t const numTasks = (path == Path::THREADED ?
+		std::max(std::min(numThreads, numBoxes), static_cast<size_t>(1)) : 1);
+	if (mScratch.size() < numTasks)
+	{
+		mScratch.resize(numTasks);
+	}
+	for (size_t t = 0; t < numTasks; ++t)
+	{
+		SphereArray3<float>& local = mScratch[t].local;
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			local.center[d].resize(numSpheres);
+		}
+		local.radius = mSpheres.radius;
+	}
+
+	if (numTasks == 1)
+	{
+		TestPrepared(0, numBoxes, mScratch[0]);
+	}
+	else
+	{
+		std::vector<std::thread> process(numTasks);
+		for (size_t t = 0; t < numTasks; ++t)
+		{
+			size_t bBegin = numBoxes * t / numTasks;
+			size_t bEnd = numBoxes * (t + 1) / numTasks;
+			process[t] = std::thread([this, t, bBegin, bEnd]()
+			{
+				TestPrepared(bBegin, bEnd, mScratch[t]);
+			});
+		}
+
+		for (size_t t = 0; t < numTasks; ++t)
+		{
+			process[t].join();
+		}
+	}
+
+	size_t numOverlaps = 0;
+	for (auto count : mBoxOverlaps)
+	{
+		numOverlaps += count;
+	}
+	return numOverlaps;
+}
+
+size_t KinematicBoxSphereScene::CountMismatches(std::vector<uint32_t> const& reference) const
+{
+	size_t numMismatches = 0;
+	size_t const numBoxes = std::min(reference.size(), mBoxOverlaps.size());
+	for (size_t b = 0; b < numBoxes; ++b)
+	{
+		if (reference[b] != mBoxOverlaps[b])
+		{
+			++numMismatches;
+		}
+	}
+	return numMismatches + std::max(reference.size(), mBoxOverlaps.size()) - numBoxes;
+}
+
+Vector3<float> KinematicBoxSphereScene::GetPosition(Motion const& motion, float time)
+{
+	Vector3<float> position{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		position[d] = motion.anchor[d] +
+			motion.amplitude[d] * std::sin(motion.frequency[d] * time + motion.phase[d]);
+	}
+	return position;
+}
+
+void KinematicBoxSphereScene::TestPrepared(size_t bBegin, size_t bEnd, Scratch& scratch)
+{
+	TIQuery<float, AlignedBox3<float>, SphereArray3<float>> query;
+	size_t const numSpheres = mSpheres.size();
+	float const* x = mSpheres.center[0].data();
+	float const* y = mSpheres.center[1].data();
+	float const* z = mSpheres.center[2].data();
+
+	for (size_t b = bBegin; b < bEnd; ++b)
+	{
+		// The coordinates of the sphere centers relative to the box axes.
+		// The sums are accumulated in the order of the PreparedBox rotation
+		// of the single queries, one coordinate at a time so that the loops
+		// vectorize.
+		PreparedBox const& box = mPrepared[b];
+		for (int32_t r = 0; r < 3; ++r)
+		{
+			float const* R = &box.rotation[3 * r];
+			float* local = scratch.local.center[r].data();
+			for (size_t s = 0; s < numSpheres; ++s)
+			{
+				float dot = (x[s] - box.center[0]) * R[0];
+				dot += (y[s] - box.center[1]) * R[1];
+				dot += (z[s] - box.center[2]) * R[2];
+				local[s] = dot;
+			}
+		}
+
+		// In box coordinates the box is the aligned box [-extent,extent].
+		AlignedBox3<float> const aligned(-box.extent, box.extent);
+		mBoxOverlaps[b] = static_cast<uint32_t>(query(aligned, scratch.local, scratch.mask));
+	}
+}
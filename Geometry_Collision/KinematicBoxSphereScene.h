@@ -0,0 +1,113 @@
+#pragma once
+
+#include "IntrAlignedBoxSphereBatch.h"
+#include "IntrOrientedBoxShere.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace Vector_GM;
+
+// A kinematic stress scene for the box-sphere test-intersection queries:
+// oriented boxes that drift and spin and spheres that drift, all on
+// scripted paths, with every sphere tested against every box. The test
+// can be run on three paths that must agree.
+//
+//   SCALAR    TIQuery<float, OrientedBox3<float>, Sphere3<float>> for each
+//             pair, the reference.
+//   BATCHED   for each box, the sphere centers are transformed to the box
+//             coordinates with the cached PreparedBox of the box in one
+//             pass over the SoA centers, and the centered aligned box is
+//             tested against all of them with the branch-free kernel of
+//             TIQuery<float, AlignedBox3<float>, SphereArray3<float>>.
+//   THREADED  the batched path with the boxes partitioned into ranges
+//             that are tested on separate threads.
+//
+// The batched kernel computes the squared distance from the box corners,
+// so a sphere that exactly touches a box can be classified differently
+// from the scalar query by rounding; CountMismatches reports the number of
+// boxes whose overlap counts differ. The scene has no graphics
+// dependencies; IntersectBoxSphereWindow3 draws it.
+
+class KinematicBoxSphereScene
+{
+public:
+	enum class Path
+	{
+		SCALAR,
+		BATCHED,
+		THREADED
+	};
+
+	// The box centers and sphere centers are in the cube with the specified
+	// center and half-size. The paths and sizes are drawn from a generator
+	// with the specified seed.
+	KinematicBoxSphereScene(size_t numBoxes, size_t numSpheres,
+		Vector3<float> const& center, float halfSize, uint32_t seed = 0);
+
+	// Move the boxes and the spheres to their positions at the specified
+	// time in seconds and update the prepared boxes.
+	void Update(float time);
+
+	// Test every sphere against every box. The number of spheres that
+	// overlap box b is GetBoxOverlaps()[b]. The return value is the total
+	// number of overlapping pairs. The THREADED path uses numThreads
+	// threads; for numThreads = 0 it runs on the calling thread.
+	size_t Test(Path path, size_t numThreads = 0);
+
+	// The number of boxes whose overlap counts differ from those of the
+	// reference counts of another Test call.
+	size_t CountMismatches(std::vector<uint32_t> const& reference) const;
+
+	inline size_t GetNumTests() const
+	{
+		return mBoxes.size() * mSpheres.size();
+	}
+
+	inline std::vector<OrientedBox3<float>> const& GetBoxes() const
+	{
+		return mBoxes;
+	}
+
+	inline SphereArray3<float> const& GetSpheres() const
+	{
+		return mSpheres;
+	}
+
+	inline std::vector<uint32_t> const& GetBoxOverlaps() const
+	{
+		return mBoxOverlaps;
+	}
+
+private:
+	typedef FIQuery<float, OrientedBox3<float>, Sphere3<float>>::PreparedBox PreparedBox;
+
+	// The scripted path of an object. The position at time t has
+	// components anchor[d] + amplitude[d] * sin(frequency[d] * t + phase[d]).
+	// A box also rotates about spinAxis with angular speed spinSpeed.
+	struct Motion
+	{
+		Vector3<float> anchor, amplitude, frequency, phase;
+		Vector3<float> spinAxis;
+		float spinSpeed;
+	};
+
+	// The per-thread storage of the batched path: the sphere centers in
+	// the coordinates of one box and the overlap mask of the sphere tests.
+	struct Scratch
+	{
+		SphereArray3<float> local;
+		std::vector<uint64_t> mask;
+	};
+
+	static Vector3<float> GetPosition(Motion const& motion, float time);
+	void TestPrepared(size_t bBegin, size_t bEnd, Scratch& scratch);
+
+	std::vector<Motion> mBoxMotions, mSphereMotions;
+	std::vector<OrientedBox3<float>> mBoxes;
+	std::vector<PreparedBox> mPrepared;
+	SphereArray3<float> mSpheres;
+	std::vector<uint32_t> mBoxOverlaps;
+	std::vector<Scratch> mScratch;
+	TIQuery<float, OrientedBox3<float>, Sphere3<float>> mQuery;
+};
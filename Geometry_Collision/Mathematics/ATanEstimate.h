@@ -52,6 +52,40 @@ namespace gte
             }
         }
 
+        // Degree<D> and DegreeRR<D> for the numValues inputs x[], stored in
+        // result[]. DegreeRR evaluates the polynomial at x or 1/x, selected
+        // without branches, so the compiler evaluates several inputs per
+        // instruction. The results are those of the single-input functions.
+        template <int32_t D>
+        static void Degree(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                result[i] = Evaluate(degree<D>(), x[i]);
+            }
+        }
+
+        template <int32_t D>
+        static void DegreeRR(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                // The polynomial argument is (0*x+1)/(1*x-0) = 1/x when
+                // |x| > 1 and (1*x-0)/(0*x+1) = x otherwise, and the result
+                // is (+-pi/2) - poly or (+-0) + poly. Only the sign is
+                // selected, and the results are those of DegreeRR(x[i]) for
+                // finite x[i].
+                Real const value = x[i];
+                Real const sign = (std::fabs(value) > (Real)1 ? (Real)-1 : (Real)1);
+                Real const inverted = ((Real)1 - sign) * (Real)0.5;
+                Real const numer = value * ((Real)1 - inverted) + std::copysign(inverted, inverted - (Real)0.5);
+                Real const denom = value * inverted + std::copysign((Real)1 - inverted, (Real)0.5 - inverted);
+                Real const poly = Evaluate(degree<D>(), numer / denom);
+                Real const offset = inverted * std::copysign((Real)GTE_C_HALF_PI, value);
+                result[i] = offset + sign * poly;
+            }
+        }
+
     private:
         // Metaprogramming and private implementation to allow specialization
         // of a template member function.
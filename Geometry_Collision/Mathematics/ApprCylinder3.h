@@ -11,9 +11,9 @@
 #include <Mathematics/Matrix3x3.h>
 #include <Mathematics/SymmetricEigensolver3x3.h>
 #include <Mathematics/ApprCircle2.h>
+#include <Mathematics/TaskScheduler.h>
 #include <cstdint>
 #include <vector>
-#include <thread>
 
 // The algorithm for least-squares fitting of a point set by a cylinder is
 // described in
@@ -452,10 +452,10 @@ namespace gte
             }
             local[mNumThreads - 1].jmax = mNumPhiSamples + 1;
 
-            std::vector<std::thread> process(mNumThreads);
+            TaskScheduler::TaskGroup group;
             for (size_t t = 0; t < mNumThreads; ++t)
             {
-                process[t] = std::thread
+                group.Run
                 (
                     [this, t, iMultiplier, jMultiplier, &local]()
                 {
@@ -488,10 +488,9 @@ namespace gte
                 );
             }
 
+            group.Wait();
             for (size_t t = 0; t < mNumThreads; ++t)
             {
-                process[t].join();
-
                 if (local[t].error < minError)
                 {
                     minError = local[t].error;
@@ -618,10 +617,10 @@ namespace gte
             }
             local[mNumThreads - 1].jmax = mNumPhiSamples + 1;
 
-            std::vector<std::thread> process(mNumThreads);
+            TaskScheduler::TaskGroup group;
             for (size_t t = 0; t < mNumThreads; ++t)
             {
-                process[t] = std::thread
+                group.Run
                 (
                     [this, t, iMultiplier, jMultiplier, &local,
                         numPoints, points, numTriangles, indices]()
@@ -658,10 +657,9 @@ namespace gte
                 );
             }
 
+            group.Wait();
             for (size_t t = 0; t < mNumThreads; ++t)
             {
-                process[t].join();
-
                 if (local[t].measure < minMeasure)
                 {
                     minMeasure = local[t].measure;
@@ -8,15 +8,24 @@
 #pragma once
 
 #include <Mathematics/ApprQuery.h>
+#include <Mathematics/Moments3.h>
 #include <Mathematics/OrientedBox.h>
 #include <Mathematics/SymmetricEigensolver3x3.h>
+#include <Mathematics/SymmetricEigensolver3x3Batch.h>
 #include <Mathematics/Vector3.h>
+#include <vector>
 
 // Fit points with a Gaussian distribution. The center is the mean of the
 // points, the axes are the eigenvectors of the covariance matrix and the
 // extents are the eigenvalues of the covariance matrix and are returned in
 // increasing order. An oriented box is used to store the mean, axes and
 // extents.
+//
+// FitMoments fits the distribution to the moments of Moments3, which are
+// accumulated in chunks or on several threads without storing the points.
+// The batch FitMoments fits many distributions, for example the boxes of
+// the nodes of a bounding volume tree, and solves their eigensystems with
+// NISymmetricEigensolver3x3Batch.
 
 namespace gte
 {
@@ -98,6 +107,78 @@ namespace gte
             return false;
         }
 
+        // Fit the distribution to the moments of the points. The return
+        // value is the same as that of FitIndexed for the points.
+        bool FitMoments(Moments3<Real> const& moments)
+        {
+            if (IsValid(moments))
+            {
+                std::array<Real, 6> const covar = moments.GetCovariance();
+                SymmetricEigensolver3x3<Real> es;
+                std::array<Real, 3> eval;
+                std::array<std::array<Real, 3>, 3> evec;
+                es(covar[0], covar[1], covar[2], covar[3], covar[4], covar[5],
+                    false, +1, eval, evec);
+                mParameters.center = moments.GetMean();
+                mParameters.axis[0] = evec[0];
+                mParameters.axis[1] = evec[1];
+                mParameters.axis[2] = evec[2];
+                mParameters.extent = eval;
+                return true;
+            }
+
+            mParameters.center = Vector3<Real>::Zero();
+            mParameters.axis[0] = Vector3<Real>::Zero();
+            mParameters.axis[1] = Vector3<Real>::Zero();
+            mParameters.axis[2] = Vector3<Real>::Zero();
+            mParameters.extent = Vector3<Real>::Zero();
+            return false;
+        }
+
+        // Fit a distribution to each of the moments. The eigensystems are
+        // solved by the noniterative solver, so the axes can differ from
+        // those of FitMoments by the accuracy of that solver. The box of
+        // moments for which FitMoments returns false has all members zero.
+        // The function returns the number of valid boxes.
+        static size_t FitMoments(size_t numMoments, Moments3<Real> const* moments,
+            OrientedBox3<Real>* boxes)
+        {
+            std::vector<std::array<Real, 6>> covars(numMoments);
+            for (size_t i = 0; i < numMoments; ++i)
+            {
+                covars[i] = moments[i].GetCovariance();
+            }
+
+            std::vector<std::array<Real, 3>> eval;
+            std::vector<std::array<std::array<Real, 3>, 3>> evec;
+            NISymmetricEigensolver3x3Batch<Real> es;
+            es(covars, +1, eval, evec);
+
+            size_t numValid = 0;
+            for (size_t i = 0; i < numMoments; ++i)
+            {
+                OrientedBox3<Real>& box = boxes[i];
+                if (IsValid(moments[i]))
+                {
+                    box.center = moments[i].GetMean();
+                    box.axis[0] = evec[i][0];
+                    box.axis[1] = evec[i][1];
+                    box.axis[2] = evec[i][2];
+                    box.extent = eval[i];
+                    ++numValid;
+                }
+                else
+                {
+                    box.center = Vector3<Real>::Zero();
+                    box.axis[0] = Vector3<Real>::Zero();
+                    box.axis[1] = Vector3<Real>::Zero();
+                    box.axis[2] = Vector3<Real>::Zero();
+                    box.extent = Vector3<Real>::Zero();
+                }
+            }
+            return numValid;
+        }
+
         // Get the parameters for the best fit.
         OrientedBox3<Real> const& GetParameters() const
         {
@@ -134,6 +215,14 @@ namespace gte
         }
 
     private:
+        // The conditions of FitIndexed on the points.
+        static bool IsValid(Moments3<Real> const& moments)
+        {
+            Vector3<Real> const& mean = moments.GetMean();
+            return moments.GetNumPoints() >= 2 &&
+                std::isfinite(mean[0]) && std::isfinite(mean[1]);
+        }
+
         OrientedBox3<Real> mParameters;
     };
 }
@@ -8,14 +8,23 @@
 #pragma once
 
 #include <Mathematics/ApprQuery.h>
+#include <Mathematics/Moments3.h>
 #include <Mathematics/SymmetricEigensolver3x3.h>
+#include <Mathematics/SymmetricEigensolver3x3Batch.h>
 #include <Mathematics/Vector3.h>
+#include <vector>
 
 // Least-squares fit of a plane to (x,y,z) data by using distance measurements
 // orthogonal to the proposed plane. The return value is 'true' if and only if
 // the fit is unique (always successful, 'true' when a minimum eigenvalue is
 // unique). The mParameters value is (P,N) = (origin,normal). The error for
 // S = (x0,y0,z0) is |Dot(N,S-P)|.
+//
+// FitMoments fits the plane to the moments of Moments3, which are
+// accumulated in chunks or on several threads without storing the points.
+// The batch FitMoments fits many planes, for example one per tile of a
+// terrain scan, and solves their eigensystems with
+// NISymmetricEigensolver3x3Batch.
 
 namespace gte
 {
@@ -96,6 +105,68 @@ namespace gte
             return false;
         }
 
+        // Fit the plane to the moments of the points. The return value is
+        // the same as that of FitIndexed for the points.
+        bool FitMoments(Moments3<Real> const& moments)
+        {
+            if (IsValid(moments))
+            {
+                std::array<Real, 6> const covar = moments.GetCovariance();
+                SymmetricEigensolver3x3<Real> es;
+                std::array<Real, 3> eval;
+                std::array<std::array<Real, 3>, 3> evec;
+                es(covar[0], covar[1], covar[2], covar[3], covar[4], covar[5],
+                    false, +1, eval, evec);
+                mParameters.first = moments.GetMean();
+                mParameters.second = evec[0];
+                return eval[0] < eval[1];
+            }
+
+            mParameters.first = Vector3<Real>::Zero();
+            mParameters.second = Vector3<Real>::Zero();
+            return false;
+        }
+
+        // Fit a plane to each of the moments. The eigensystems are solved by
+        // the noniterative solver, so the normals can differ from those of
+        // FitMoments by the accuracy of that solver. On return, unique[i] is
+        // the return value of FitMoments for moments[i]; the plane is zero
+        // when the moments are not valid. The function returns the number of
+        // unique planes.
+        static size_t FitMoments(size_t numMoments, Moments3<Real> const* moments,
+            std::pair<Vector3<Real>, Vector3<Real>>* planes, bool* unique)
+        {
+            std::vector<std::array<Real, 6>> covars(numMoments);
+            for (size_t i = 0; i < numMoments; ++i)
+            {
+                covars[i] = moments[i].GetCovariance();
+            }
+
+            std::vector<std::array<Real, 3>> eval;
+            std::vector<std::array<std::array<Real, 3>, 3>> evec;
+            NISymmetricEigensolver3x3Batch<Real> es;
+            es(covars, +1, eval, evec);
+
+            size_t numUnique = 0;
+            for (size_t i = 0; i < numMoments; ++i)
+            {
+                if (IsValid(moments[i]))
+                {
+                    planes[i].first = moments[i].GetMean();
+                    planes[i].second = evec[i][0];
+                    unique[i] = (eval[i][0] < eval[i][1]);
+                }
+                else
+                {
+                    planes[i].first = Vector3<Real>::Zero();
+                    planes[i].second = Vector3<Real>::Zero();
+                    unique[i] = false;
+                }
+                numUnique += (unique[i] ? 1 : 0);
+            }
+            return numUnique;
+        }
+
         // Get the parameters for the best fit.
         std::pair<Vector3<Real>, Vector3<Real>> const& GetParameters() const
         {
@@ -122,6 +193,16 @@ namespace gte
         }
 
     private:
+        // The conditions of FitIndexed on the points.
+        static bool IsValid(Moments3<Real> const& moments)
+        {
+            Vector3<Real> const& mean = moments.GetMean();
+            return moments.GetNumPoints() >= 3 &&
+                std::isfinite(mean[0]) &&
+                std::isfinite(mean[1]) &&
+                std::isfinite(mean[2]);
+        }
+
         std::pair<Vector3<Real>, Vector3<Real>> mParameters;
     };
 }
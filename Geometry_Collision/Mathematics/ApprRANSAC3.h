@@ -0,0 +1,592 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/ApprCylinder3.h>
+#include <Mathematics/ApprOrthogonalPlane3.h>
+#include <Mathematics/ApprSphere3.h>
+#include <Mathematics/SymmetricEigensolver3x3Batch.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// RANSAC fitting of a plane, a sphere or a cylinder to a point set with
+// outliers, for example to generate collision primitives from scanned
+// geometry. ApprQuery::RANSAC tests one hypothesis at a time; this driver
+// tests the hypotheses in batches. The hypotheses of a batch are split into
+// contiguous ranges that are processed on separate threads. A thread fits
+// each hypothesis of its range to a minimal sample and then scores all of
+// them in one pass over the points, so a tile of points is loaded once per
+// range instead of once per hypothesis. The distances of the points to a
+// hypothesis are computed by a SIMD kernel, one point per lane, with the
+// lane operations of NISymmetricEigensolver3x3Batch.
+//
+// Each hypothesis draws its sample from a random engine seeded by the seed
+// and the index of the hypothesis, and the best hypothesis of a batch is the
+// one with the most inliers and the smallest index, so the result depends
+// on the seed but not on the number of threads. After each batch the number
+// of iterations is reduced to the number needed to draw an outlier-free
+// sample with the requested confidence,
+//     k = log(1 - confidence) / log(1 - w^m)
+// where w is the inlier fraction of the best hypothesis and m the sample
+// size. The inliers of the best hypothesis are finally passed to the
+// least-squares fitter of the primitive, and the refined model is kept when
+// it has at least as many inliers.
+//
+// A primitive class provides
+//   using Model = <the parameters of the primitive>;
+//   static size_t constexpr numSamples = <the minimal sample size>;
+//   bool FitSample(Vector3<Real> const* sample, Model& model) const;
+//   bool Refine(size_t numPoints, Vector3<Real> const* points, Model& model) const;
+//   Real Error(Model const& model, Vector3<Real> const& point) const;
+//   template <typename Lanes> struct Kernel
+//   {
+//       Kernel(Model const& model);
+//       typename Lanes::Register operator()(typename Lanes::Register x,
+//           typename Lanes::Register y, typename Lanes::Register z) const;
+//   };
+// FitSample is called concurrently and must not modify shared state. The
+// kernel returns the same distances as Error, up to rounding errors.
+
+namespace gte
+{
+    template <typename Real, typename Primitive>
+    class ApprRANSAC3
+    {
+    public:
+        using Model = typename Primitive::Model;
+
+        // The hypotheses are processed on numThreads threads, or on the
+        // hardware concurrency when numThreads is 0, in batches of
+        // numHypothesesPerBatch.
+        ApprRANSAC3(Primitive const& primitive = Primitive(), size_t numThreads = 0,
+            size_t numHypothesesPerBatch = 256)
+            :
+            mPrimitive(primitive),
+            mNumThreads(numThreads > 0 ? numThreads :
+                std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+                    static_cast<size_t>(1))),
+            mNumHypothesesPerBatch(std::max(numHypothesesPerBatch, static_cast<size_t>(1)))
+        {
+        }
+
+        // A point is an inlier of a model when its distance is at most
+        // maxErrorForGoodFit. At most maxIterations hypotheses are tested,
+        // fewer when the inlier fraction found so far reaches the
+        // confidence, a number in (0,1) such as 0.99. The function returns
+        // true when the best model has at least numRequiredForGoodFit
+        // inliers, whose indices are returned in bestConsensus in
+        // increasing order.
+        bool operator()(size_t numPoints, Vector3<Real> const* points,
+            Real maxErrorForGoodFit, size_t numRequiredForGoodFit,
+            size_t maxIterations, Real confidence, Model& bestModel,
+            std::vector<int32_t>& bestConsensus, uint32_t seed = 0) const
+        {
+            bestConsensus.clear();
+            if (numPoints < Primitive::numSamples || maxIterations == 0)
+            {
+                return false;
+            }
+
+            // Store the points as arrays of coordinates. The padding of the
+            // last block is NaN, which is never an inlier.
+            size_t const numBlocks = (numPoints + numLanes - 1) / numLanes;
+            std::array<std::vector<Real>, 3> coordinates;
+            for (auto& values : coordinates)
+            {
+                values.assign(numBlocks * numLanes, std::numeric_limits<Real>::quiet_NaN());
+            }
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                coordinates[0][i] = points[i][0];
+                coordinates[1][i] = points[i][1];
+                coordinates[2][i] = points[i][2];
+            }
+
+            std::vector<Model> models(mNumHypothesesPerBatch);
+            std::vector<size_t> counts(mNumHypothesesPerBatch);
+            size_t bestCount = 0, numIterations = maxIterations;
+            for (size_t first = 0; first < numIterations; )
+            {
+                size_t const numHypotheses = std::min(mNumHypothesesPerBatch, numIterations - first);
+                size_t const numThreads = std::min(mNumThreads, numHypotheses);
+                auto evaluate = [this, numPoints, points, numBlocks, maxErrorForGoodFit,
+                    seed, first, numHypotheses, numThreads, &coordinates, &models, &counts](size_t t)
+                {
+                    size_t const begin = t * numHypotheses / numThreads;
+                    size_t const end = (t + 1) * numHypotheses / numThreads;
+                    EvaluateHypotheses(numPoints, points, numBlocks, coordinates,
+                        maxErrorForGoodFit, seed, first, begin, end, models, counts);
+                };
+
+                std::vector<std::thread> threads;
+                threads.reserve(numThreads);
+                for (size_t t = 1; t < numThreads; ++t)
+                {
+                    threads.emplace_back(evaluate, t);
+                }
+                evaluate(0);
+                for (auto& thread : threads)
+                {
+                    thread.join();
+                }
+
+                for (size_t h = 0; h < numHypotheses; ++h)
+                {
+                    if (counts[h] > bestCount)
+                    {
+                        bestCount = counts[h];
+                        bestModel = models[h];
+                    }
+                }
+
+                first += numHypotheses;
+                numIterations = std::min(maxIterations,
+                    std::max(first, GetNumRequiredIterations(bestCount, numPoints, confidence)));
+            }
+
+            if (bestCount == 0)
+            {
+                return false;
+            }
+
+            // Refine the best model by a least-squares fit to its inliers.
+            GetConsensus(numPoints, points, bestModel, maxErrorForGoodFit, bestConsensus);
+            std::vector<Vector3<Real>> inliers(bestConsensus.size());
+            for (size_t i = 0; i < bestConsensus.size(); ++i)
+            {
+                inliers[i] = points[bestConsensus[i]];
+            }
+
+            Model refined = bestModel;
+            if (mPrimitive.Refine(inliers.size(), inliers.data(), refined))
+            {
+                std::vector<int32_t> consensus;
+                GetConsensus(numPoints, points, refined, maxErrorForGoodFit, consensus);
+                if (consensus.size() >= bestConsensus.size())
+                {
+                    bestModel = refined;
+                    bestConsensus = std::move(consensus);
+                }
+            }
+            return bestConsensus.size() >= numRequiredForGoodFit;
+        }
+
+        inline Primitive const& GetPrimitive() const
+        {
+            return mPrimitive;
+        }
+
+        inline size_t GetNumThreads() const
+        {
+            return mNumThreads;
+        }
+
+        inline size_t GetNumHypothesesPerBatch() const
+        {
+            return mNumHypothesesPerBatch;
+        }
+
+    private:
+        using Lanes = NISymmetricEigensolver3x3Lanes<Real>;
+        using Register = typename Lanes::Register;
+        using Kernel = typename Primitive::template Kernel<Lanes>;
+        static size_t constexpr numLanes = Lanes::numLanes;
+
+        // The number of blocks of points scored for all hypotheses of a
+        // range before moving to the next tile. A tile of 3 arrays fits in
+        // the L1 cache, and the lane counts of a tile are exact in float.
+        static size_t constexpr blocksPerTile = 1024 / numLanes;
+
+        void EvaluateHypotheses(size_t numPoints, Vector3<Real> const* points,
+            size_t numBlocks, std::array<std::vector<Real>, 3> const& coordinates,
+            Real maxErrorForGoodFit, uint32_t seed, size_t first, size_t begin, size_t end,
+            std::vector<Model>& models, std::vector<size_t>& counts) const
+        {
+            // Fit the hypotheses to their samples. A degenerate sample has
+            // no inliers.
+            std::vector<Kernel> kernels;
+            std::vector<size_t> valid;
+            kernels.reserve(end - begin);
+            valid.reserve(end - begin);
+            for (size_t h = begin; h < end; ++h)
+            {
+                counts[h] = 0;
+                if (FitHypothesis(numPoints, points, seed, first + h, models[h]))
+                {
+                    kernels.emplace_back(models[h]);
+                    valid.push_back(h);
+                }
+            }
+
+            // Score the hypotheses tile by tile.
+            Register const rMaxError = Lanes::Set(maxErrorForGoodFit);
+            Register const rZero = Lanes::Set((Real)0);
+            Register const rOne = Lanes::Set((Real)1);
+            std::array<Real, numLanes> laneCounts{};
+            for (size_t tile = 0; tile < numBlocks; tile += blocksPerTile)
+            {
+                size_t const tileEnd = std::min(tile + blocksPerTile, numBlocks);
+                for (size_t k = 0; k < kernels.size(); ++k)
+                {
+                    Register rCount = rZero;
+                    for (size_t b = tile; b < tileEnd; ++b)
+                    {
+                        Register const x = Lanes::Load(&coordinates[0][b * numLanes]);
+                        Register const y = Lanes::Load(&coordinates[1][b * numLanes]);
+                        Register const z = Lanes::Load(&coordinates[2][b * numLanes]);
+                        Register const error = kernels[k](x, y, z);
+                        rCount = Lanes::Add(rCount, Lanes::Select(
+                            Lanes::GreaterEqual(rMaxError, error), rOne, rZero));
+                    }
+
+                    Lanes::Store(rCount, laneCounts.data());
+                    for (auto laneCount : laneCounts)
+                    {
+                        counts[valid[k]] += static_cast<size_t>(laneCount);
+                    }
+                }
+            }
+        }
+
+        bool FitHypothesis(size_t numPoints, Vector3<Real> const* points,
+            uint32_t seed, size_t hypothesis, Model& model) const
+        {
+            std::seed_seq seeds{ seed, static_cast<uint32_t>(hypothesis),
+                static_cast<uint32_t>(static_cast<uint64_t>(hypothesis) >> 32) };
+            std::mt19937 dre(seeds);
+            std::uniform_int_distribution<size_t> urd(0, numPoints - 1);
+
+            std::array<size_t, Primitive::numSamples> indices{};
+            std::array<Vector3<Real>, Primitive::numSamples> sample{};
+            for (size_t j = 0; j < Primitive::numSamples; ++j)
+            {
+                bool unique;
+                do
+                {
+                    indices[j] = urd(dre);
+                    unique = (std::find(indices.begin(), indices.begin() + j, indices[j])
+                        == indices.begin() + j);
+                } while (!unique);
+                sample[j] = points[indices[j]];
+            }
+            return mPrimitive.FitSample(sample.data(), model);
+        }
+
+        void GetConsensus(size_t numPoints, Vector3<Real> const* points, Model const& model,
+            Real maxErrorForGoodFit, std::vector<int32_t>& consensus) const
+        {
+            consensus.clear();
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                if (mPrimitive.Error(model, points[i]) <= maxErrorForGoodFit)
+                {
+                    consensus.push_back(static_cast<int32_t>(i));
+                }
+            }
+        }
+
+        static size_t GetNumRequiredIterations(size_t numInliers, size_t numPoints, Real confidence)
+        {
+            size_t const maxSize = std::numeric_limits<size_t>::max();
+            double const fraction = static_cast<double>(numInliers) / static_cast<double>(numPoints);
+            double const probability = std::pow(fraction, static_cast<double>(Primitive::numSamples));
+            double const failure = 1.0 - static_cast<double>(confidence);
+            if (probability <= 0.0 || failure >= 1.0)
+            {
+                return maxSize;
+            }
+            if (probability >= 1.0 || failure <= 0.0)
+            {
+                return (failure <= 0.0 ? maxSize : 1);
+            }
+
+            double const required = std::ceil(std::log(failure) / std::log1p(-probability));
+            return (required < static_cast<double>(maxSize) ?
+                std::max(static_cast<size_t>(required), static_cast<size_t>(1)) : maxSize);
+        }
+
+        Primitive mPrimitive;
+        size_t mNumThreads, mNumHypothesesPerBatch;
+    };
+
+    // A plane with origin P and unit-length normal N, the parameters of
+    // ApprOrthogonalPlane3. The sample is 3 points and the error is the
+    // distance |Dot(N, X - P)|.
+    template <typename Real>
+    class RANSACPlane3
+    {
+    public:
+        using Model = std::pair<Vector3<Real>, Vector3<Real>>;
+        static size_t constexpr numSamples = 3;
+
+        bool FitSample(Vector3<Real> const* sample, Model& model) const
+        {
+            Vector3<Real> normal = Cross(sample[1] - sample[0], sample[2] - sample[0]);
+            if (Normalize(normal) == (Real)0)
+            {
+                return false;
+            }
+            model = std::make_pair(sample[0], normal);
+            return true;
+        }
+
+        bool Refine(size_t numPoints, Vector3<Real> const* points, Model& model) const
+        {
+            ApprOrthogonalPlane3<Real> fitter;
+            fitter.Fit(numPoints, points);
+            Vector3<Real> const& normal = fitter.GetParameters().second;
+            if (normal == Vector3<Real>::Zero())
+            {
+                return false;
+            }
+            model = fitter.GetParameters();
+            return true;
+        }
+
+        inline Real Error(Model const& model, Vector3<Real> const& point) const
+        {
+            return std::fabs(Dot(model.second, point - model.first));
+        }
+
+        template <typename Lanes>
+        struct Kernel
+        {
+            using Register = typename Lanes::Register;
+
+            Kernel(Model const& model)
+                :
+                N0(Lanes::Set(model.second[0])),
+                N1(Lanes::Set(model.second[1])),
+                N2(Lanes::Set(model.second[2])),
+                d(Lanes::Set(Dot(model.second, model.first)))
+            {
+            }
+
+            inline Register operator()(Register x, Register y, Register z) const
+            {
+                Register const dot = Lanes::Add(Lanes::Add(Lanes::Mul(N0, x),
+                    Lanes::Mul(N1, y)), Lanes::Mul(N2, z));
+                return Lanes::Abs(Lanes::Sub(dot, d));
+            }
+
+            Register N0, N1, N2;
+            Register d;
+        };
+    };
+
+    // A sphere. The sample is 4 points fitted by
+    // ApprSphere3::FitUsingSquaredLengths, which interpolates them, and the
+    // refinement is ApprSphere3::FitUsingLengths starting at the center of
+    // the hypothesis. The error is the distance ||X - C| - r|.
+    template <typename Real>
+    class RANSACSphere3
+    {
+    public:
+        using Model = Sphere3<Real>;
+        static size_t constexpr numSamples = 4;
+
+        RANSACSphere3(uint32_t maxRefineIterations = 64)
+            :
+            mMaxRefineIterations(maxRefineIterations)
+        {
+        }
+
+        bool FitSample(Vector3<Real> const* sample, Model& model) const
+        {
+            ApprSphere3<Real> fitter;
+            return fitter.FitUsingSquaredLengths(static_cast<int32_t>(numSamples), sample, model)
+                && std::isfinite(model.radius) && model.radius > (Real)0;
+        }
+
+        bool Refine(size_t numPoints, Vector3<Real> const* points, Model& model) const
+        {
+            ApprSphere3<Real> fitter;
+            fitter.FitUsingLengths(static_cast<int32_t>(numPoints), points,
+                mMaxRefineIterations, false, model);
+            return std::isfinite(model.radius) && model.radius > (Real)0;
+        }
+
+        inline Real Error(Model const& model, Vector3<Real> const& point) const
+        {
+            return std::fabs(Length(point - model.center) - model.radius);
+        }
+
+        template <typename Lanes>
+        struct Kernel
+        {
+            using Register = typename Lanes::Register;
+
+            Kernel(Model const& model)
+                :
+                C0(Lanes::Set(model.center[0])),
+                C1(Lanes::Set(model.center[1])),
+                C2(Lanes::Set(model.center[2])),
+                r(Lanes::Set(model.radius))
+            {
+            }
+
+            inline Register operator()(Register x, Register y, Register z) const
+            {
+                Register const dx = Lanes::Sub(x, C0);
+                Register const dy = Lanes::Sub(y, C1);
+                Register const dz = Lanes::Sub(z, C2);
+                Register const sqrLength = Lanes::Add(Lanes::Add(Lanes::Mul(dx, dx),
+                    Lanes::Mul(dy, dy)), Lanes::Mul(dz, dz));
+                return Lanes::Abs(Lanes::Sub(Lanes::Sqrt(sqrLength), r));
+            }
+
+            Register C0, C1, C2;
+            Register r;
+        };
+
+    private:
+        uint32_t mMaxRefineIterations;
+    };
+
+    // A cylinder. A cylinder has 5 parameters, but ApprCylinder3 requires 6
+    // points, so the sample is 6 points fitted by a single-threaded
+    // hemisphere search of ApprCylinder3 followed by a pattern search of
+    // numPolishSteps steps over the axis direction. The refinement is a hemisphere
+    // search with more samples on refineThreads threads (0 for the calling
+    // thread, as in ApprCylinder3). The error is the distance to the
+    // infinite cylinder, | |(I - W W^T)(X - C)| - r |; the height of the
+    // refined cylinder is that of the inliers.
+    template <typename Real>
+    class RANSACCylinder3
+    {
+    public:
+        using Model = Cylinder3<Real>;
+        static size_t constexpr numSamples = 6;
+
+        RANSACCylinder3(size_t numThetaSamples = 8, size_t numPhiSamples = 16,
+            size_t numPolishSteps = 16, size_t numRefineThetaSamples = 32,
+            size_t numRefinePhiSamples = 64, size_t refineThreads = 0)
+            :
+            mNumThetaSamples(numThetaSamples),
+            mNumPhiSamples(numPhiSamples),
+            mNumPolishSteps(numPolishSteps),
+            mNumRefineThetaSamples(numRefineThetaSamples),
+            mNumRefinePhiSamples(numRefinePhiSamples),
+            mRefineThreads(refineThreads)
+        {
+        }
+
+        bool FitSample(Vector3<Real> const* sample, Model& model) const
+        {
+            ApprCylinder3<Real> fitter(0, mNumThetaSamples, mNumPhiSamples);
+            Real error = fitter(numSamples, sample, model);
+            if (!std::isfinite(error))
+            {
+                return false;
+            }
+
+            // The direction of the hemisphere search is accurate to the
+            // spacing of the grid, which for a long cylinder leaves many
+            // inliers outside the hypothesis. A pattern search around the
+            // direction, halving the step when no neighbor reduces the
+            // error, fits the sample more closely.
+            Real step = static_cast<Real>(GTE_C_HALF_PI) / static_cast<Real>(mNumThetaSamples);
+            for (size_t i = 0; i < mNumPolishSteps; ++i)
+            {
+                std::array<Vector3<Real>, 3> basis{};
+                basis[0] = model.axis.direction;
+                ComputeOrthogonalComplement(1, basis.data());
+
+                bool improved = false;
+                Vector3<Real> const W = model.axis.direction;
+                for (size_t j = 0; j < 4; ++j)
+                {
+                    Vector3<Real> direction = W + ((j & 1) ? -step : step) * basis[1 + j / 2];
+                    ApprCylinder3<Real> axisFitter(direction);
+                    Cylinder3<Real> candidate;
+                    Real const candidateError = axisFitter(numSamples, sample, candidate);
+                    if (candidateError < error)
+                    {
+                        error = candidateError;
+                        model = candidate;
+                        improved = true;
+                    }
+                }
+
+                if (!improved)
+                {
+                    step *= (Real)0.5;
+                }
+            }
+            return std::isfinite(model.radius) && model.radius > (Real)0;
+        }
+
+        bool Refine(size_t numPoints, Vector3<Real> const* points, Model& model) const
+        {
+            if (numPoints < numSamples)
+            {
+                return false;
+            }
+
+            ApprCylinder3<Real> fitter(mRefineThreads, mNumRefineThetaSamples, mNumRefinePhiSamples);
+            Real const error = fitter(numPoints, points, model);
+            return std::isfinite(error) && std::isfinite(model.radius) && model.radius > (Real)0;
+        }
+
+        inline Real Error(Model const& model, Vector3<Real> const& point) const
+        {
+            Vector3<Real> const diff = point - model.axis.origin;
+            Real const h = Dot(model.axis.direction, diff);
+            Real const sqrDistance = std::max(Dot(diff, diff) - h * h, (Real)0);
+            return std::fabs(std::sqrt(sqrDistance) - model.radius);
+        }
+
+        template <typename Lanes>
+        struct Kernel
+        {
+            using Register = typename Lanes::Register;
+
+            Kernel(Model const& model)
+                :
+                C0(Lanes::Set(model.axis.origin[0])),
+                C1(Lanes::Set(model.axis.origin[1])),
+                C2(Lanes::Set(model.axis.origin[2])),
+                W0(Lanes::Set(model.axis.direction[0])),
+                W1(Lanes::Set(model.axis.direction[1])),
+                W2(Lanes::Set(model.axis.direction[2])),
+                r(Lanes::Set(model.radius)),
+                zero(Lanes::Set((Real)0))
+            {
+            }
+
+            inline Register operator()(Register x, Register y, Register z) const
+            {
+                Register const dx = Lanes::Sub(x, C0);
+                Register const dy = Lanes::Sub(y, C1);
+                Register const dz = Lanes::Sub(z, C2);
+                Register const h = Lanes::Add(Lanes::Add(Lanes::Mul(W0, dx),
+                    Lanes::Mul(W1, dy)), Lanes::Mul(W2, dz));
+                Register const sqrLength = Lanes::Add(Lanes::Add(Lanes::Mul(dx, dx),
+                    Lanes::Mul(dy, dy)), Lanes::Mul(dz, dz));
+                Register const sqrDistance = Lanes::Max(Lanes::Sub(sqrLength, Lanes::Mul(h, h)), zero);
+                return Lanes::Abs(Lanes::Sub(Lanes::Sqrt(sqrDistance), r));
+            }
+
+            Register C0, C1, C2, W0, W1, W2;
+            Register r, zero;
+        };
+
+    private:
+        size_t mNumThetaSamples, mNumPhiSamples, mNumPolishSteps;
+        size_t mNumRefineThetaSamples, mNumRefinePhiSamples;
+        size_t mRefineThreads;
+    };
+}
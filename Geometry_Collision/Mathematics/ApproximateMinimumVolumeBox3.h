@@ -0,0 +1,677 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/ConvexHull3.h>
+#include <Mathematics/OrientedBox.h>
+#include <Mathematics/SymmetricEigensolver3x3.h>
+#include <Mathematics/TaskScheduler.h>
+#include <Mathematics/Vector2.h>
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+// Compute an approximation to the minimum-volume oriented box containing
+// the specified points. MinimumVolumeBox3 processes all pairs of hull edges
+// and can take seconds for hulls with thousands of edges. This class is
+// intended for building collision proxies, where a box slightly larger than
+// the minimum is acceptable when it is computed in milliseconds.
+//
+// The box is searched for among the boxes that have one face perpendicular
+// to a candidate normal N. For such a normal, the hull vertices are
+// projected onto the plane perpendicular to N and the minimum-area
+// rectangle of the projection is computed by rotating calipers. The box is
+// that rectangle extruded over the extent of the hull in the N direction.
+// The candidate normals are
+//   1. the eigenvectors of the covariance matrix of the hull vertices,
+//   2. the normals of the hull faces, taken in order of decreasing face
+//      area and skipping those within an angle of a normal already taken,
+//      up to a maximum number of normals.
+// The best box is refined by tilting its normal toward its other axes with
+// decreasing angles while the volume decreases. When the minimum-volume box
+// has a face flush with a hull face whose normal is sampled, which is the
+// common case, the result is that box up to rounding errors.
+//
+// The volume of any box containing the hull is at least the volume of the
+// hull, so GetVolumeRatioBound() = boxVolume / hullVolume is a guaranteed
+// upper bound on boxVolume / minimumVolume. The bound is conservative; for
+// example, it is 3 for a regular tetrahedron whose approximate box is
+// minimal. The computations use floating-point arithmetic, so the box
+// contains the points only up to rounding errors.
+
+namespace gte
+{
+    template <typename Real>
+    class ApproximateMinimumVolumeBox3
+    {
+    public:
+        // Construction and destruction. To execute in the main thread, set
+        // numThreads to 0. To run multithreaded on the CPU, set numThreads
+        // to a positive number.
+        ApproximateMinimumVolumeBox3(size_t numThreads = 0)
+            :
+            mNumThreads(numThreads),
+            mConvexHull3{},
+            mVertices{},
+            mVolumeRatioBound(static_cast<Real>(0))
+        {
+            static_assert(std::is_floating_point<Real>::value,
+                "The input type must be 'float' or 'double'.");
+        }
+
+        virtual ~ApproximateMinimumVolumeBox3() = default;
+
+        // The class is a wrapper for operator()(*), so there is no need for
+        // copy semantics.
+        ApproximateMinimumVolumeBox3(ApproximateMinimumVolumeBox3 const&) = delete;
+        ApproximateMinimumVolumeBox3& operator=(ApproximateMinimumVolumeBox3 const&) = delete;
+
+        // The convex hull of the input points is computed. The output box
+        // for hull dimensions 0, 1 and 2 is the same as that described for
+        // MinimumVolumeBox3, except that the 2D minimum-area box is computed
+        // with floating-point arithmetic. For dimension 3, the other
+        // operator()(*) function is called. The function returns the hull
+        // dimension. The maximum number of sampled face normals must be
+        // positive; 64 to 256 samples are typical.
+        int32_t operator()(
+            int32_t numPoints,
+            Vector3<Real> const* points,
+            size_t maxNormals,
+            OrientedBox3<Real>& box,
+            Real& volume)
+        {
+            LogAssert(numPoints > 0 && points != nullptr && maxNormals > 0,
+                "Invalid argument.");
+
+            Real const zero = static_cast<Real>(0);
+            Real const one = static_cast<Real>(1);
+            Real const half = static_cast<Real>(0.5);
+
+            mConvexHull3(static_cast<size_t>(numPoints), points, 0);
+            size_t dimension = mConvexHull3.GetDimension();
+            auto const& hull = mConvexHull3.GetHull();
+            mVolumeRatioBound = one;
+
+            if (dimension == 0)
+            {
+                // The points are all the same.
+                box.center = points[hull[0]];
+                box.axis[0] = { one, zero, zero };
+                box.axis[1] = { zero, one, zero };
+                box.axis[2] = { zero, zero, one };
+                box.extent[0] = zero;
+                box.extent[1] = zero;
+                box.extent[2] = zero;
+                volume = zero;
+                return 0;
+            }
+
+            if (dimension == 1)
+            {
+                // The points lie on a line.
+                Vector3<Real> direction = points[hull[1]] - points[hull[0]];
+                box.center = half * (points[hull[0]] + points[hull[1]]);
+                box.extent[0] = half * Normalize(direction);
+                box.extent[1] = zero;
+                box.extent[2] = zero;
+                box.axis[0] = direction;
+                ComputeOrthogonalComplement(1, &box.axis[0]);
+                volume = zero;
+                return 1;
+            }
+
+            if (dimension == 2)
+            {
+                // The points lie on a plane. The hull is an ordered convex
+                // polygon, so the minimum-area rectangle is computed
+                // directly from its vertices.
+                Vector3<Real> normal = Vector3<Real>::Zero();
+                size_t const numHull = hull.size();
+                for (size_t i0 = numHull - 1, i1 = 0; i1 < numHull; i0 = i1++)
+                {
+                    normal += Cross(points[hull[i0]], points[hull[i1]]);
+                }
+
+                mVertices.resize(numHull);
+                for (size_t i = 0; i < numHull; ++i)
+                {
+                    mVertices[i] = points[hull[i]];
+                }
+
+                Candidate candidate{};
+                std::vector<Vector2<Real>> projection, polygon;
+                Evaluate(normal, candidate, projection, polygon);
+                GetBox(candidate, box, volume);
+                return 2;
+            }
+
+            std::vector<int32_t> indices(hull.size());
+            for (size_t i = 0; i < hull.size(); ++i)
+            {
+                indices[i] = static_cast<int32_t>(hull[i]);
+            }
+
+            operator()(numPoints, points, static_cast<int32_t>(indices.size()),
+                indices.data(), maxNormals, box, volume);
+            return 3;
+        }
+
+        // The points form a nondegenerate convex polyhedron. The triangle
+        // faces are triples of the indices; there are indices.size()/3
+        // triangles, and 0 <= indices[i] < numVertices for all i. Vertices
+        // not referenced by the indices are ignored, so the hull indices of
+        // ConvexHull3 may be passed together with the points given to it.
+        void operator()(
+            int32_t numVertices,
+            Vector3<Real> const* vertices,
+            int32_t numIndices,
+            int32_t const* indices,
+            size_t maxNormals,
+            OrientedBox3<Real>& box,
+            Real& volume)
+        {
+            LogAssert(
+                numVertices > 0 && vertices != nullptr &&
+                numIndices > 0 && indices != nullptr &&
+                (numIndices % 3) == 0 && maxNormals > 0,
+                "Invalid argument.");
+
+            // Gather the referenced vertices relative to their average to
+            // reduce the rounding errors in the projections.
+            std::vector<int32_t> used(static_cast<size_t>(numVertices), 0);
+            for (int32_t i = 0; i < numIndices; ++i)
+            {
+                LogAssert(0 <= indices[i] && indices[i] < numVertices,
+                    "Invalid index.");
+                used[indices[i]] = 1;
+            }
+
+            mVertices.clear();
+            Vector3<Real> origin = Vector3<Real>::Zero();
+            for (int32_t i = 0; i < numVertices; ++i)
+            {
+                if (used[i])
+                {
+                    mVertices.push_back(vertices[i]);
+                    origin += vertices[i];
+                }
+            }
+            origin /= static_cast<Real>(mVertices.size());
+            for (auto& vertex : mVertices)
+            {
+                vertex -= origin;
+            }
+
+            std::vector<Vector3<Real>> normals{};
+            Real const hullVolume = GetCandidateNormals(vertices, origin,
+                numIndices, indices, maxNormals, normals);
+
+            Candidate minimum = GetMinimumCandidate(normals);
+            Refine(maxNormals, minimum);
+
+            GetBox(minimum, box, volume);
+            box.center += origin;
+            mVolumeRatioBound = (hullVolume > static_cast<Real>(0) ?
+                volume / hullVolume : std::numeric_limits<Real>::max());
+        }
+
+        // An upper bound on the ratio of the volume of the computed box to
+        // the volume of the minimum-volume box. It is 1 when the hull has
+        // dimension smaller than 3.
+        inline Real GetVolumeRatioBound() const
+        {
+            return mVolumeRatioBound;
+        }
+
+        // Returns the convex hull that was computed by the operator()(*)
+        // for points. The hull is not computed by the operator()(*) for a
+        // polyhedron.
+        inline ConvexHull3<Real> const& GetConvexHull3() const
+        {
+            return mConvexHull3;
+        }
+
+    protected:
+        // A box with axis[2] equal to the candidate normal. The center is
+        // relative to the origin of mVertices.
+        struct Candidate
+        {
+            Candidate()
+                :
+                center(Vector3<Real>::Zero()),
+                axis{ Vector3<Real>::Unit(0), Vector3<Real>::Unit(1), Vector3<Real>::Unit(2) },
+                extent(Vector3<Real>::Zero()),
+                volume(std::numeric_limits<Real>::max())
+            {
+            }
+
+            Vector3<Real> center;
+            std::array<Vector3<Real>, 3> axis;
+            Vector3<Real> extent;
+            Real volume;
+        };
+
+        // Compute the candidate normals and return the volume of the hull.
+        Real GetCandidateNormals(Vector3<Real> const* vertices, Vector3<Real> const& origin,
+            int32_t numIndices, int32_t const* indices, size_t maxNormals,
+            std::vector<Vector3<Real>>& normals) const
+        {
+            // The eigenvectors of the covariance matrix of the vertices.
+            Real const numVertices = static_cast<Real>(mVertices.size());
+            Real c00 = static_cast<Real>(0), c01 = c00, c02 = c00;
+            Real c11 = c00, c12 = c00, c22 = c00;
+            for (auto const& v : mVertices)
+            {
+                c00 += v[0] * v[0];
+                c01 += v[0] * v[1];
+                c02 += v[0] * v[2];
+                c11 += v[1] * v[1];
+                c12 += v[1] * v[2];
+                c22 += v[2] * v[2];
+            }
+
+            SymmetricEigensolver3x3<Real> es;
+            std::array<Real, 3> eval{};
+            std::array<std::array<Real, 3>, 3> evec{};
+            es(c00 / numVertices, c01 / numVertices, c02 / numVertices,
+                c11 / numVertices, c12 / numVertices, c22 / numVertices,
+                false, +1, eval, evec);
+            for (size_t j = 0; j < 3; ++j)
+            {
+                normals.push_back(Vector3<Real>{ evec[j][0], evec[j][1], evec[j][2] });
+            }
+
+            // The face normals sorted by decreasing area. The hull volume
+            // is the sum of the signed volumes of the tetrahedra formed by
+            // the origin and the faces.
+            size_t const numTriangles = static_cast<size_t>(numIndices) / 3;
+            std::vector<std::pair<Real, Vector3<Real>>> faces(numTriangles);
+            Real hullVolume = static_cast<Real>(0);
+            for (size_t t = 0; t < numTriangles; ++t)
+            {
+                Vector3<Real> const v0 = vertices[indices[3 * t + 0]] - origin;
+                Vector3<Real> const v1 = vertices[indices[3 * t + 1]] - origin;
+                Vector3<Real> const v2 = vertices[indices[3 * t + 2]] - origin;
+                Vector3<Real> normal = Cross(v1 - v0, v2 - v0);
+                hullVolume += Dot(v0, Cross(v1, v2));
+                Real const length = Normalize(normal);
+                faces[t] = std::make_pair(length, normal);
+            }
+            hullVolume /= static_cast<Real>(6);
+
+            std::sort(faces.begin(), faces.end(),
+                [](std::pair<Real, Vector3<Real>> const& f0, std::pair<Real, Vector3<Real>> const& f1)
+                {
+                    return f0.first > f1.first;
+                });
+
+            // Skip the normals within an angle of those already taken. The
+            // angle is that of a spherical cap with area 2*pi/maxNormals, so
+            // maxNormals such caps cover a hemisphere of axis directions.
+            Real const angle = std::sqrt(static_cast<Real>(2) / static_cast<Real>(maxNormals));
+            Real const cosAngle = std::cos(std::min(angle, static_cast<Real>(1)));
+            size_t const numFaceNormals = std::min(maxNormals, numTriangles);
+            size_t const first = normals.size();
+            for (auto const& face : faces)
+            {
+                if (normals.size() - first == numFaceNormals)
+                {
+                    break;
+                }
+
+                if (face.first > static_cast<Real>(0))
+                {
+                    bool isNew = true;
+                    for (size_t i = first; i < normals.size(); ++i)
+                    {
+                        if (std::fabs(Dot(face.second, normals[i])) >= cosAngle)
+                        {
+                            isNew = false;
+                            break;
+                        }
+                    }
+
+                    if (isNew)
+                    {
+                        normals.push_back(face.second);
+                    }
+                }
+            }
+            return hullVolume;
+        }
+
+        Candidate GetMinimumCandidate(std::vector<Vector3<Real>> const& normals) const
+        {
+            size_t const numThreads = std::min(mNumThreads, normals.size());
+            if (numThreads > 1)
+            {
+                std::vector<Candidate> candidates(numThreads);
+                TaskScheduler::GetDefault().ParallelFor(numThreads,
+                    [this, numThreads, &normals, &candidates](size_t t)
+                    {
+                        std::vector<Vector2<Real>> projection, polygon;
+                        for (size_t i = t; i < normals.size(); i += numThreads)
+                        {
+                            Candidate candidate{};
+                            Evaluate(normals[i], candidate, projection, polygon);
+                            if (candidate.volume < candidates[t].volume)
+                            {
+                                candidates[t] = candidate;
+                            }
+                        }
+                    });
+
+                Candidate minimum = candidates[0];
+                for (size_t t = 1; t < numThreads; ++t)
+                {
+                    if (candidates[t].volume < minimum.volume)
+                    {
+                        minimum = candidates[t];
+                    }
+                }
+                return minimum;
+            }
+            else
+            {
+                Candidate minimum{};
+                std::vector<Vector2<Real>> projection, polygon;
+                for (auto const& normal : normals)
+                {
+                    Candidate candidate{};
+                    Evaluate(normal, candidate, projection, polygon);
+                    if (candidate.volume < minimum.volume)
+                    {
+                        minimum = candidate;
+                    }
+                }
+                return minimum;
+            }
+        }
+
+        // The other axes of the box are candidate normals whose boxes have
+        // at most the same volume. After they are tried, the normal is
+        // tilted toward the other axes, halving the angle each time no tilt
+        // reduces the volume.
+        void Refine(size_t maxNormals, Candidate& minimum) const
+        {
+            std::vector<Vector2<Real>> projection, polygon;
+            Candidate candidate{};
+            for (int32_t j = 0; j < 2; ++j)
+            {
+                Evaluate(minimum.axis[j], candidate, projection, polygon);
+                if (candidate.volume < minimum.volume)
+                {
+                    minimum = candidate;
+                }
+            }
+
+            Real angle = static_cast<Real>(0.5) *
+                std::sqrt(static_cast<Real>(2) / static_cast<Real>(maxNormals));
+            Real const minAngle = angle / static_cast<Real>(1024);
+            for (int32_t iteration = 0; iteration < maxRefinements && angle >= minAngle; ++iteration)
+            {
+                Real const cs = std::cos(angle), sn = std::sin(angle);
+                bool improved = false;
+                for (int32_t k = 0; k < 4; ++k)
+                {
+                    Real const sign = ((k & 1) == 0 ? sn : -sn);
+                    Vector3<Real> normal = cs * minimum.axis[2] + sign * minimum.axis[k >> 1];
+                    Evaluate(normal, candidate, projection, polygon);
+                    if (candidate.volume < minimum.volume)
+                    {
+                        minimum = candidate;
+                        improved = true;
+                    }
+                }
+
+                if (!improved)
+                {
+                    angle *= static_cast<Real>(0.5);
+                }
+            }
+        }
+
+        // Compute the box with axis[2] parallel to the normal whose
+        // rectangle perpendicular to the normal has minimum area.
+        void Evaluate(Vector3<Real> const& normal, Candidate& candidate,
+            std::vector<Vector2<Real>>& projection, std::vector<Vector2<Real>>& polygon) const
+        {
+            std::array<Vector3<Real>, 3> basis{};
+            basis[0] = normal;
+            ComputeOrthogonalComplement(1, basis.data());
+
+            Real hmin = std::numeric_limits<Real>::max();
+            Real hmax = -hmin;
+            projection.resize(mVertices.size());
+            for (size_t i = 0; i < mVertices.size(); ++i)
+            {
+                Real const h = Dot(basis[0], mVertices[i]);
+                hmin = std::min(hmin, h);
+                hmax = std::max(hmax, h);
+                projection[i] = { Dot(basis[1], mVertices[i]), Dot(basis[2], mVertices[i]) };
+            }
+
+            Vector2<Real> center{}, axis{};
+            std::array<Real, 2> extent{};
+            DiscardInteriorPoints(projection);
+            ComputeConvexPolygon(projection, polygon);
+            Real const area = ComputeMinimumAreaRectangle(polygon, center, axis, extent);
+
+            Real const half = static_cast<Real>(0.5);
+            candidate.center = center[0] * basis[1] + center[1] * basis[2] +
+                (half * (hmin + hmax)) * basis[0];
+            candidate.axis[0] = axis[0] * basis[1] + axis[1] * basis[2];
+            candidate.axis[1] = -axis[1] * basis[1] + axis[0] * basis[2];
+            candidate.axis[2] = basis[0];
+            candidate.extent = { extent[0], extent[1], half * (hmax - hmin) };
+            candidate.volume = area * (hmax - hmin);
+        }
+
+        // The projection of a polyhedron with many vertices has most of
+        // them inside its convex polygon. Discard the points strictly inside
+        // the octagon of the points that are extreme in the directions
+        // (0,-1), (1,-1), (1,0), (1,1), (0,1), (-1,1), (-1,0) and (-1,-1),
+        // so that only the remaining points are sorted. This is the
+        // Akl-Toussaint heuristic.
+        static void DiscardInteriorPoints(std::vector<Vector2<Real>>& points)
+        {
+            std::array<size_t, 8> extreme{};
+            std::array<Real, 8> value{};
+            for (size_t j = 0; j < 8; ++j)
+            {
+                value[j] = -std::numeric_limits<Real>::max();
+            }
+
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                Real const x = points[i][0], y = points[i][1];
+                std::array<Real, 8> const v = { -y, x - y, x, x + y, y, y - x, -x, -x - y };
+                for (size_t j = 0; j < 8; ++j)
+                {
+                    if (v[j] > value[j])
+                    {
+                        value[j] = v[j];
+                        extreme[j] = i;
+                    }
+                }
+            }
+
+            std::array<Vector2<Real>, 8> octagon{};
+            for (size_t j = 0; j < 8; ++j)
+            {
+                octagon[j] = points[extreme[j]];
+            }
+
+            size_t numKept = 0;
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                Vector2<Real> const& point = points[i];
+                bool inside = true;
+                for (size_t j0 = 7, j1 = 0; j1 < 8; j0 = j1++)
+                {
+                    if (DotPerp(octagon[j1] - octagon[j0], point - octagon[j0]) <= static_cast<Real>(0))
+                    {
+                        inside = false;
+                        break;
+                    }
+                }
+
+                if (!inside)
+                {
+                    points[numKept++] = point;
+                }
+            }
+            points.resize(numKept);
+        }
+
+        // Compute the counterclockwise convex polygon of the points using
+        // the monotone chain algorithm. Collinear points are discarded.
+        static void ComputeConvexPolygon(std::vector<Vector2<Real>>& points,
+            std::vector<Vector2<Real>>& polygon)
+        {
+            std::sort(points.begin(), points.end());
+
+            size_t const numPoints = points.size();
+            polygon.resize(2 * numPoints);
+            size_t k = 0;
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                while (k >= 2 && DotPerp(polygon[k - 1] - polygon[k - 2],
+                    points[i] - polygon[k - 2]) <= static_cast<Real>(0))
+                {
+                    --k;
+                }
+                polygon[k++] = points[i];
+            }
+
+            for (size_t i = numPoints - 1, lower = k + 1; i > 0; --i)
+            {
+                while (k >= lower && DotPerp(polygon[k - 1] - polygon[k - 2],
+                    points[i - 1] - polygon[k - 2]) <= static_cast<Real>(0))
+                {
+                    --k;
+                }
+                polygon[k++] = points[i - 1];
+            }
+
+            polygon.resize(k > 1 ? k - 1 : k);
+        }
+
+        // Compute the minimum-area rectangle of a counterclockwise convex
+        // polygon by rotating calipers. The rectangle has an edge flush
+        // with a polygon edge. The axis is the unit-length direction of
+        // that edge and the other rectangle axis is Perp(axis).
+        static Real ComputeMinimumAreaRectangle(std::vector<Vector2<Real>> const& polygon,
+            Vector2<Real>& center, Vector2<Real>& axis, std::array<Real, 2>& extent)
+        {
+            Real const zero = static_cast<Real>(0);
+            Real const half = static_cast<Real>(0.5);
+            size_t const n = polygon.size();
+            if (n < 3)
+            {
+                // The projection is a point or a segment.
+                center = (n == 2 ? half * (polygon[0] + polygon[1]) : polygon[0]);
+                axis = (n == 2 ? polygon[1] - polygon[0] : Vector2<Real>::Unit(0));
+                extent[0] = half * Normalize(axis);
+                extent[1] = zero;
+                if (extent[0] == zero)
+                {
+                    axis = Vector2<Real>::Unit(0);
+                }
+                return zero;
+            }
+
+            // The indices of the vertices with maximum projection onto the
+            // edge direction, maximum projection onto the inner normal and
+            // minimum projection onto the edge direction. They advance
+            // monotonically as the edge index increases.
+            size_t iMax = 1, iFar = 1, iMin = 1;
+            Real minArea = std::numeric_limits<Real>::max();
+            for (size_t i0 = 0; i0 < n; ++i0)
+            {
+                size_t const i1 = (i0 + 1 < n ? i0 + 1 : 0);
+                Vector2<Real> const& origin = polygon[i0];
+                Vector2<Real> U = polygon[i1] - origin;
+                Normalize(U);
+                Vector2<Real> const V = -Perp(U);
+
+                for (size_t count = 0; count < n; ++count)
+                {
+                    size_t const next = (iMax + 1 < n ? iMax + 1 : 0);
+                    if (Dot(U, polygon[next] - origin) <= Dot(U, polygon[iMax] - origin))
+                    {
+                        break;
+                    }
+                    iMax = next;
+                }
+
+                if (i0 == 0)
+                {
+                    iFar = iMax;
+                }
+                for (size_t count = 0; count < n; ++count)
+                {
+                    size_t const next = (iFar + 1 < n ? iFar + 1 : 0);
+                    if (Dot(V, polygon[next] - origin) <= Dot(V, polygon[iFar] - origin))
+                    {
+                        break;
+                    }
+                    iFar = next;
+                }
+
+                if (i0 == 0)
+                {
+                    iMin = iFar;
+                }
+                for (size_t count = 0; count < n; ++count)
+                {
+                    size_t const next = (iMin + 1 < n ? iMin + 1 : 0);
+                    if (Dot(U, polygon[next] - origin) >= Dot(U, polygon[iMin] - origin))
+                    {
+                        break;
+                    }
+                    iMin = next;
+                }
+
+                Real const uMax = Dot(U, polygon[iMax] - origin);
+                Real const uMin = Dot(U, polygon[iMin] - origin);
+                Real const vMax = Dot(V, polygon[iFar] - origin);
+                Real const area = (uMax - uMin) * vMax;
+                if (area < minArea)
+                {
+                    minArea = area;
+                    center = origin + (half * (uMin + uMax)) * U + (half * vMax) * V;
+                    axis = U;
+                    extent[0] = half * (uMax - uMin);
+                    extent[1] = half * vMax;
+                }
+            }
+            return minArea;
+        }
+
+        void GetBox(Candidate const& candidate, OrientedBox3<Real>& box, Real& volume) const
+        {
+            box.center = candidate.center;
+            box.axis = candidate.axis;
+            box.extent = candidate.extent;
+            volume = candidate.volume;
+        }
+
+        static int32_t constexpr maxRefinements = 64;
+
+        size_t mNumThreads;
+        ConvexHull3<Real> mConvexHull3;
+
+        // The hull vertices relative to their average.
+        std::vector<Vector3<Real>> mVertices;
+        Real mVolumeRatioBound;
+    };
+}
@@ -0,0 +1,432 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// An asynchronous logger for the warnings and information messages that
+// worker threads report in bulk, for example the degenerate triangles of a
+// mesh import. The assertions and errors of Logger.h throw exceptions and
+// are not affected.
+//
+// LogWarning(message) and LogInformation(message) post to the logger that
+// is installed by AsyncLogger::Install; without one, the messages are
+// discarded. The message is a 'char const*' or a std::string. A thread
+// copies the message into a ring buffer of its own, truncated to
+// maxTextLength characters. A ring has one producer and one consumer, so
+// posting takes no lock and allocates only for the first message of the
+// thread. A post never waits; a message that does not fit in the ring is
+// suppressed. A background thread drains the rings every drainInterval and
+// passes the messages to the listeners. The messages of a thread are
+// delivered in the order they were posted.
+//
+// Rate limiting and deduplication are per call site. Each expansion of the
+// macros has a static AsyncLogger::Site. At most maxPendingPerSite messages
+// of a site can be waiting in the rings; the further messages of the site
+// are counted but not copied. The drain thread merges consecutive messages
+// of a site that have the same text. A listener receives such a message
+// once, with the number of occurrences, including the suppressed ones. A
+// suppression that races with the drain of the last waiting message of its
+// site is counted with the next message of that site.
+//
+// Uninstall the logger and stop posting before it is destroyed. The
+// destructor delivers the waiting messages.
+
+namespace gte
+{
+    class AsyncLogger
+    {
+    public:
+        enum class Level
+        {
+            Information,
+            Warning
+        };
+
+        // The state of a call site; see the LogWarning macro.
+        struct Site
+        {
+            Site(char const* inFile, char const* inFunction, int32_t inLine)
+                :
+                file(inFile),
+                function(inFunction),
+                line(inLine),
+                pending(0),
+                suppressed(0)
+            {
+            }
+
+            char const* file;
+            char const* function;
+            int32_t line;
+            std::atomic<uint32_t> pending;
+            std::atomic<uint64_t> suppressed;
+        };
+
+        struct Message
+        {
+            Level level;
+            char const* file;
+            char const* function;
+            int32_t line;
+            std::string text;
+            uint64_t count;
+        };
+
+        using Listener = std::function<void(Message const&)>;
+
+        static size_t constexpr maxTextLength = 110;
+
+        // Construction and destruction. The drain thread starts in the
+        // constructor. The ring capacity is rounded up to a power of two.
+        AsyncLogger(size_t ringCapacity = 1024, uint32_t maxPendingPerSite = 64,
+            std::chrono::microseconds drainInterval = std::chrono::microseconds(1000))
+            :
+            mId(NextId()),
+            mRingMask(0),
+            mMaxPendingPerSite(maxPendingPerSite),
+            mDrainInterval(drainInterval),
+            mRingsMutex{},
+            mRings{},
+            mListenersMutex{},
+            mListeners{},
+            mNextListenerId(1),
+            mControlMutex{},
+            mControl{},
+            mStop(false),
+            mFlushRequests(0),
+            mFlushesDone(0),
+            mDrainThread{}
+        {
+            LogAssert(ringCapacity > 0 && maxPendingPerSite > 0, "Invalid argument.");
+
+            size_t capacity = 1;
+            while (capacity < ringCapacity)
+            {
+                capacity <<= 1;
+            }
+            mRingMask = capacity - 1;
+
+            mDrainThread = std::thread([this]() { DrainLoop(); });
+        }
+
+        ~AsyncLogger()
+        {
+            AsyncLogger* self = this;
+            Installed().compare_exchange_strong(self, nullptr);
+
+            {
+                std::lock_guard<std::mutex> lock(mControlMutex);
+                mStop = true;
+            }
+            mControl.notify_all();
+            mDrainThread.join();
+        }
+
+        AsyncLogger(AsyncLogger const&) = delete;
+        AsyncLogger& operator=(AsyncLogger const&) = delete;
+
+        // The logger used by the LogWarning and LogInformation macros. Pass
+        // nullptr to uninstall.
+        static void Install(AsyncLogger* logger)
+        {
+            Installed().store(logger, std::memory_order_release);
+        }
+
+        static AsyncLogger* GetInstalled()
+        {
+            return Installed().load(std::memory_order_acquire);
+        }
+
+        // The listeners are called on the drain thread. Subscribe returns
+        // an identifier for Unsubscribe.
+        size_t Subscribe(Listener const& listener)
+        {
+            std::lock_guard<std::mutex> lock(mListenersMutex);
+            size_t const id = mNextListenerId++;
+            mListeners.emplace_back(id, listener);
+            return id;
+        }
+
+        void Unsubscribe(size_t id)
+        {
+            std::lock_guard<std::mutex> lock(mListenersMutex);
+            mListeners.erase(std::remove_if(mListeners.begin(), mListeners.end(),
+                [id](std::pair<size_t, Listener> const& item) { return item.first == id; }),
+                mListeners.end());
+        }
+
+        // Post to the installed logger.
+        static inline void Post(Site& site, Level level, char const* text)
+        {
+            AsyncLogger* logger = GetInstalled();
+            if (logger)
+            {
+                logger->Enqueue(site, level, text, std::strlen(text));
+            }
+        }
+
+        static inline void Post(Site& site, Level level, std::string const& text)
+        {
+            AsyncLogger* logger = GetInstalled();
+            if (logger)
+            {
+                logger->Enqueue(site, level, text.c_str(), text.length());
+            }
+        }
+
+        // Post to this logger.
+        void Enqueue(Site& site, Level level, char const* text, size_t length)
+        {
+            if (site.pending.fetch_add(1, std::memory_order_relaxed) >= mMaxPendingPerSite)
+            {
+                Suppress(site);
+                return;
+            }
+
+            Ring& ring = GetRing();
+            size_t const tail = ring.tail.load(std::memory_order_relaxed);
+            if (tail - ring.head.load(std::memory_order_acquire) > mRingMask)
+            {
+                Suppress(site);
+                return;
+            }
+
+            Record& record = ring.records[tail & mRingMask];
+            record.site = &site;
+            record.level = level;
+            record.length = static_cast<uint8_t>(std::min(length, maxTextLength));
+            std::memcpy(record.text, text, record.length);
+            ring.tail.store(tail + 1, std::memory_order_release);
+        }
+
+        // Wait until the messages posted before the call are delivered.
+        void Flush()
+        {
+            uint64_t ticket = 0;
+            {
+                std::lock_guard<std::mutex> lock(mControlMutex);
+                ticket = ++mFlushRequests;
+            }
+            mControl.notify_all();
+
+            std::unique_lock<std::mutex> lock(mControlMutex);
+            mControl.wait(lock, [this, ticket]() { return mFlushesDone >= ticket; });
+        }
+
+    private:
+        static size_t constexpr cacheLineSize = 64;
+
+        struct Record
+        {
+            Site* site;
+            Level level;
+            uint8_t length;
+            char text[maxTextLength];
+        };
+
+        // The head is written by the drain thread and the tail by the
+        // posting thread, so they are on separate cache lines.
+        struct Ring
+        {
+            Ring(size_t capacity)
+                :
+                records(capacity),
+                head(0),
+                tail(0)
+            {
+            }
+
+            std::vector<Record> records;
+            alignas(cacheLineSize) std::atomic<size_t> head;
+            alignas(cacheLineSize) std::atomic<size_t> tail;
+        };
+
+        // The ring of the calling thread. The thread and the logger share
+        // ownership; the drain thread discards a ring whose thread has
+        // exited once the ring is empty.
+        struct RingHandle
+        {
+            uint64_t loggerId = 0;
+            std::shared_ptr<Ring> ring;
+        };
+
+        static std::atomic<AsyncLogger*>& Installed()
+        {
+            static std::atomic<AsyncLogger*> installed(nullptr);
+            return installed;
+        }
+
+        static uint64_t NextId()
+        {
+            static std::atomic<uint64_t> nextId(1);
+            return nextId.fetch_add(1);
+        }
+
+        inline void Suppress(Site& site)
+        {
+            site.pending.fetch_sub(1, std::memory_order_relaxed);
+            site.suppressed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        Ring& GetRing()
+        {
+            thread_local RingHandle handle{};
+            if (handle.loggerId != mId)
+            {
+                handle.ring = std::make_shared<Ring>(mRingMask + 1);
+                handle.loggerId = mId;
+                std::lock_guard<std::mutex> lock(mRingsMutex);
+                mRings.push_back(handle.ring);
+            }
+            return *handle.ring;
+        }
+
+        void DrainLoop()
+        {
+            for (;;)
+            {
+                bool stop = false;
+                uint64_t flushRequests = 0;
+                {
+                    std::unique_lock<std::mutex> lock(mControlMutex);
+                    mControl.wait_for(lock, mDrainInterval,
+                        [this]() { return mStop || mFlushRequests > mFlushesDone; });
+                    stop = mStop;
+                    flushRequests = mFlushRequests;
+                }
+
+                Drain();
+
+                {
+                    std::lock_guard<std::mutex> lock(mControlMutex);
+                    mFlushesDone = flushRequests;
+                }
+                mControl.notify_all();
+
+                if (stop)
+                {
+                    return;
+                }
+            }
+        }
+
+        void Drain()
+        {
+            std::vector<std::shared_ptr<Ring>> rings{};
+            {
+                std::lock_guard<std::mutex> lock(mRingsMutex);
+                rings = mRings;
+            }
+
+            std::lock_guard<std::mutex> lock(mListenersMutex);
+            Message message{};
+            for (auto const& ring : rings)
+            {
+                Site* site = nullptr;
+                size_t head = ring->head.load(std::memory_order_relaxed);
+                size_t const tail = ring->tail.load(std::memory_order_acquire);
+                for (; head != tail; ++head)
+                {
+                    Record const& record = ring->records[head & mRingMask];
+                    uint64_t const count = 1 + record.site->suppressed.exchange(0, std::memory_order_relaxed);
+                    record.site->pending.fetch_sub(1, std::memory_order_relaxed);
+
+                    if (site == record.site && message.level == record.level &&
+                        message.text.compare(0, std::string::npos, record.text, record.length) == 0)
+                    {
+                        message.count += count;
+                        continue;
+                    }
+
+                    if (site)
+                    {
+                        Deliver(message);
+                    }
+                    site = record.site;
+                    message.level = record.level;
+                    message.file = site->file;
+                    message.function = site->function;
+                    message.line = site->line;
+                    message.text.assign(record.text, record.length);
+                    message.count = count;
+                }
+                ring->head.store(head, std::memory_order_release);
+
+                if (site)
+                {
+                    Deliver(message);
+                }
+            }
+
+            // The rings that only the logger owns belong to exited threads.
+            // Such a ring is empty after the drain above, because its
+            // thread cannot post any more.
+            std::lock_guard<std::mutex> ringsLock(mRingsMutex);
+            rings.clear();
+            mRings.erase(std::remove_if(mRings.begin(), mRings.end(),
+                [](std::shared_ptr<Ring> const& ring)
+                {
+                    return ring.use_count() == 1 &&
+                        ring->head.load(std::memory_order_relaxed) ==
+                        ring->tail.load(std::memory_order_acquire);
+                }),
+                mRings.end());
+        }
+
+        void Deliver(Message const& message)
+        {
+            for (auto const& item : mListeners)
+            {
+                item.second(message);
+            }
+        }
+
+        uint64_t mId;
+        size_t mRingMask;
+        uint32_t mMaxPendingPerSite;
+        std::chrono::microseconds mDrainInterval;
+
+        std::mutex mRingsMutex;
+        std::vector<std::shared_ptr<Ring>> mRings;
+
+        std::mutex mListenersMutex;
+        std::vector<std::pair<size_t, Listener>> mListeners;
+        size_t mNextListenerId;
+
+        // The control state of the drain thread.
+        std::mutex mControlMutex;
+        std::condition_variable mControl;
+        bool mStop;
+        uint64_t mFlushRequests, mFlushesDone;
+        std::thread mDrainThread;
+    };
+}
+
+#define GTE_ASYNC_LOG(level, message) \
+{ static gte::AsyncLogger::Site gteLogSite(__FILE__, __FUNCTION__, __LINE__); gte::AsyncLogger::Post(gteLogSite, level, message); }
+
+#define LogWarning(message) \
+GTE_ASYNC_LOG(gte::AsyncLogger::Level::Warning, message)
+
+#define LogInformation(message) \
+GTE_ASYNC_LOG(gte::AsyncLogger::Level::Information, message)
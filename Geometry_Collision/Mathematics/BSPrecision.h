@@ -10,9 +10,18 @@
 #include <algorithm>
 #include <cstdint>
 #include <limits>
+#include <type_traits>
 
 // Support for determining the number of bits of precision required to compute
-// an expression using BSNumber or BSRational.
+// an expression using BSNumber or BSRational. The class and its operators are
+// constexpr, so the number of words N of UIntegerFP32<N> for an expression
+// can be computed at compile time by evaluating the expression tree on
+// BSPrecision objects, for example
+//   BSPrecision constexpr x(BSPrecision::GetType<float>());
+//   BSPrecision constexpr d = x - x;
+//   int32_t constexpr N = (d * d - d * d).bsn.maxWords;
+// The exact predicates then use BSNumber<UIntegerFP32<N>>, which has no
+// dynamic allocations.
 
 namespace gte
 {
@@ -31,7 +40,7 @@ namespace gte
 
         struct Parameters
         {
-            Parameters()
+            constexpr Parameters()
                 :
                 minExponent(0),
                 maxExponent(0),
@@ -40,7 +49,7 @@ namespace gte
             {
             }
 
-            Parameters(int32_t inMinExponent, int32_t inMaxExponent, int32_t inMaxBits)
+            constexpr Parameters(int32_t inMinExponent, int32_t inMaxExponent, int32_t inMaxBits)
                 :
                 minExponent(inMinExponent),
                 maxExponent(inMaxExponent),
@@ -49,7 +58,7 @@ namespace gte
             {
             }
 
-            inline int32_t GetMaxWords() const
+            constexpr int32_t GetMaxWords() const
             {
                 return maxBits / 32 + ((maxBits % 32) > 0 ? 1 : 0);
             }
@@ -59,9 +68,14 @@ namespace gte
 
         Parameters bsn, bsr;
 
-        BSPrecision() = default;
+        constexpr BSPrecision()
+            :
+            bsn{},
+            bsr{}
+        {
+        }
 
-        BSPrecision(Type type)
+        constexpr BSPrecision(Type type)
             :
             bsn{},
             bsr{}
@@ -90,15 +104,37 @@ namespace gte
             bsr = bsn;
         }
 
-        BSPrecision(int32_t minExponent, int32_t maxExponent, int32_t maxBits)
+        constexpr BSPrecision(int32_t minExponent, int32_t maxExponent, int32_t maxBits)
             :
             bsn(minExponent, maxExponent, maxBits),
             bsr(minExponent, maxExponent, maxBits)
         {
         }
+
+        // The Type for the input type T.
+        template <typename T>
+        static constexpr Type GetType()
+        {
+            static_assert(
+                std::is_same<T, float>::value ||
+                std::is_same<T, double>::value ||
+                std::is_same<T, int32_t>::value ||
+                std::is_same<T, int64_t>::value ||
+                std::is_same<T, uint32_t>::value ||
+                std::is_same<T, uint64_t>::value,
+                "Unsupported input type.");
+
+            return
+                std::is_same<T, float>::value ? Type::IS_FLOAT :
+                std::is_same<T, double>::value ? Type::IS_DOUBLE :
+                std::is_same<T, int32_t>::value ? Type::IS_INT32 :
+                std::is_same<T, int64_t>::value ? Type::IS_INT64 :
+                std::is_same<T, uint32_t>::value ? Type::IS_UINT32 :
+                Type::IS_UINT64;
+        }
     };
 
-    inline BSPrecision operator+(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator+(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         BSPrecision result{};
 
@@ -157,12 +193,12 @@ namespace gte
         return result;
     }
 
-    inline BSPrecision operator-(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator-(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         return bsp0 + bsp1;
     }
 
-    inline BSPrecision operator*(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator*(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         BSPrecision result{};
 
@@ -181,7 +217,7 @@ namespace gte
         return result;
     }
 
-    inline BSPrecision operator/(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator/(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         BSPrecision result{};
 
@@ -201,7 +237,7 @@ namespace gte
     // Comparisons for BSNumber do not involve dynamic allocations, so
     // the results are the extremes of the inputs. Comparisons for BSRational
     // involve multiplications of numerators and denominators.
-    inline BSPrecision operator==(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator==(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         BSPrecision result{};
 
@@ -218,27 +254,27 @@ namespace gte
         return result;
     }
 
-    inline BSPrecision operator!=(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator!=(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         return operator==(bsp0, bsp1);
     }
 
-    inline BSPrecision operator<(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator<(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         return operator==(bsp0, bsp1);
     }
 
-    inline BSPrecision operator<=(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator<=(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         return operator==(bsp0, bsp1);
     }
 
-    inline BSPrecision operator>(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator>(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         return operator==(bsp0, bsp1);
     }
 
-    inline BSPrecision operator>=(BSPrecision const& bsp0, BSPrecision const& bsp1)
+    inline constexpr BSPrecision operator>=(BSPrecision const& bsp0, BSPrecision const& bsp1)
     {
         return operator==(bsp0, bsp1);
     }
@@ -9,6 +9,8 @@
 
 #include <Mathematics/BasisFunction.h>
 #include <Mathematics/ParametricCurve.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 
 namespace gte
 {
@@ -129,7 +131,82 @@ namespace gte
             }
         }
 
+        // Batch evaluation of the curve at the parameters t[0] through
+        // t[numSamples-1].  The jets are stored consecutively; that is,
+        // jets[s * (order + 1) + k] is jet[k] of Evaluate(t[s], order, jet).
+        // The basis functions are evaluated by the batch function of
+        // BasisFunction, which is fastest when the parameters are sorted.
+        // Set numThreads to 2 or larger to evaluate blocks of samples as
+        // tasks of TaskScheduler::GetDefault().
+        void Evaluate(size_t numSamples, Real const* t, uint32_t order,
+            Vector<N, Real>* jets, size_t numThreads = 0) const
+        {
+            LogAssert(order <= 3, "Invalid order.");
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+            if (!this->mConstructed)
+            {
+                // Return zero-valued jets for invalid state.
+                for (size_t i = 0; i < numSamples * numOrders; ++i)
+                {
+                    jets[i].MakeZero();
+                }
+                return;
+            }
+
+            size_t const numTasks = std::max(std::min(numThreads,
+                numSamples / 1024), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                EvaluateBlock(0, numSamples, t, order, jets);
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [this, numSamples, numTasks, t, order, jets](size_t k)
+                {
+                    EvaluateBlock(k * numSamples / numTasks,
+                        (k + 1) * numSamples / numTasks, t, order, jets);
+                });
+        }
+
     private:
+        // Support for the batch Evaluate(...).  The basis values are
+        // computed for chunks of samples to bound the scratch memory.
+        void EvaluateBlock(size_t smin, size_t smax, Real const* t,
+            uint32_t order, Vector<N, Real>* jets) const
+        {
+            size_t const chunkSize = 256;
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+            size_t const numBasis = static_cast<size_t>(mBasisFunction.GetDegree()) + 1;
+            int32_t const numControls = GetNumControls();
+            std::vector<int32_t> minIndices(chunkSize);
+            std::vector<Real> values(chunkSize * numOrders * numBasis);
+            for (size_t s0 = smin; s0 < smax; s0 += chunkSize)
+            {
+                size_t const numChunkSamples = std::min(chunkSize, smax - s0);
+                mBasisFunction.Evaluate(numChunkSamples, t + s0, order,
+                    minIndices.data(), values.data());
+
+                for (size_t c = 0; c < numChunkSamples; ++c)
+                {
+                    Real const* basis = &values[c * numOrders * numBasis];
+                    Vector<N, Real>* jet = &jets[(s0 + c) * numOrders];
+                    for (size_t k = 0; k < numOrders; ++k, basis += numBasis)
+                    {
+                        Vector<N, Real> result;
+                        result.MakeZero();
+                        for (size_t m = 0; m < numBasis; ++m)
+                        {
+                            int32_t i = minIndices[c] + static_cast<int32_t>(m);
+                            int32_t j = (i >= numControls ? i - numControls : i);
+                            result += basis[m] * mControls[j];
+                        }
+                        jet[k] = result;
+                    }
+                }
+            }
+        }
+
         // Support for Evaluate(...).
         Vector<N, Real> Compute(uint32_t order, int32_t imin, int32_t imax) const
         {
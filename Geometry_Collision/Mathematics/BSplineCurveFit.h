@@ -9,34 +9,42 @@
 
 #include <Mathematics/BasisFunction.h>
 #include <Mathematics/BandedMatrix.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 
 // The algorithm implemented here is based on the document
 // https://www.geometrictools.com/Documentation/BSplineCurveLeastSquaresFit.pdf
 
 namespace gte
 {
+    // The least-squares fit of an open B-spline curve with uniform knots to
+    // numSamples samples at uniformly spaced parameters in [0,1].  The
+    // fitted control points are Q = (A^T*A)^{-1}*A^T*P, where P contains
+    // the samples and A is the numSamples-by-numControls matrix of basis
+    // values.  A^T*A is a banded matrix that depends only on the sizes, so
+    // the constructor computes its Cholesky factorization once, and each
+    // Fit call computes A^T*P from the sparse basis values and solves the
+    // banded triangular systems.  This is the fast path for fitting many
+    // datasets of the same size, for example a sequence of scan lines.
     template <typename Real>
-    class BSplineCurveFit
+    class BSplineCurveFitter
     {
     public:
         // Construction.  The preconditions for calling the constructor are
-        // 1 <= degree && degree < numControls <= numSamples - degree - 1.
-        // The samples points are contiguous blocks of 'dimension' real values
-        // stored in sampleData.
-        BSplineCurveFit(int32_t dimension, int32_t numSamples, Real const* sampleData,
-            int32_t degree, int32_t numControls)
+        // 1 <= degree && degree < numControls <= numSamples.  BSplineCurveFit
+        // requires numControls <= numSamples - degree - 1.
+        BSplineCurveFitter(int32_t numSamples, int32_t degree, int32_t numControls)
             :
-            mDimension(dimension),
             mNumSamples(numSamples),
-            mSampleData(sampleData),
             mDegree(degree),
             mNumControls(numControls),
-            mControlData(static_cast<size_t>(dimension) * static_cast<size_t>(numControls))
+            mSampleMinIndices(numSamples),
+            mSampleBasis(static_cast<size_t>(numSamples) * (static_cast<size_t>(degree) + 1)),
+            mATA(numControls, (numControls > degree + 1 ? degree + 1 : degree),
+                (numControls > degree + 1 ? degree + 1 : degree))
         {
-            LogAssert(dimension >= 1, "Invalid dimension.");
             LogAssert(1 <= degree && degree < numControls, "Invalid degree.");
-            LogAssert(sampleData, "Invalid sample data.");
-            LogAssert(numControls <= numSamples - degree - 1, "Invalid number of controls.");
+            LogAssert(numControls <= numSamples, "Invalid number of controls.");
 
             BasisFunctionInput<Real> input;
             input.numControls = numControls;
@@ -58,101 +66,193 @@ namespace gte
             input.uniqueKnots[last].multiplicity = degree + 1;
             mBasis.Create(input);
 
-            // Fit the data points with a B-spline curve using a least-squares
-            // error metric.  The problem is of the form A^T*A*Q = A^T*P,
-            // where A^T*A is a banded matrix, P contains the sample data, and
-            // Q is the unknown vector of control points.
+            // Compute the nonzero basis values of the samples, which are the
+            // nonzero elements of A.
             Real tMultiplier = (Real)1 / ((Real)mNumSamples - (Real)1);
-            Real t;
-            int32_t i0, i1, i2, imin, imax, j;
-
-            // Construct the matrix A^T*A.
-            int32_t degp1 = mDegree + 1;
-            int32_t numBands = (mNumControls > degp1 ? degp1 : mDegree);
-            BandedMatrix<Real> ATAMat(mNumControls, numBands, numBands);
-            for (i0 = 0; i0 < mNumControls; ++i0)
+            std::vector<Real> t(mNumSamples);
+            for (int32_t i = 0; i < mNumSamples; ++i)
             {
-                for (i1 = 0; i1 < i0; ++i1)
-                {
-                    ATAMat(i0, i1) = ATAMat(i1, i0);
-                }
-
-                int32_t i1Max = i0 + mDegree;
-                if (i1Max >= mNumControls)
-                {
-                    i1Max = mNumControls - 1;
-                }
+                t[i] = tMultiplier * (Real)i;
+            }
+            mBasis.Evaluate(static_cast<size_t>(mNumSamples), t.data(), 0,
+                mSampleMinIndices.data(), mSampleBasis.data());
 
-                for (i1 = i0; i1 <= i1Max; ++i1)
+            // Construct the matrix A^T*A.  The sums over the samples are in
+            // increasing sample order.
+            size_t const numBasis = static_cast<size_t>(mDegree) + 1;
+            for (int32_t i = 0; i < mNumSamples; ++i)
+            {
+                Real const* basis = &mSampleBasis[static_cast<size_t>(i) * numBasis];
+                int32_t imin = mSampleMinIndices[i];
+                for (size_t m0 = 0; m0 < numBasis; ++m0)
                 {
-                    Real value = (Real)0;
-                    for (i2 = 0; i2 < mNumSamples; ++i2)
+                    for (size_t m1 = m0; m1 < numBasis; ++m1)
                     {
-                        t = tMultiplier * (Real)i2;
-                        mBasis.Evaluate(t, 0, imin, imax);
-                        if (imin <= i0 && i0 <= imax && imin <= i1 && i1 <= imax)
-                        {
-                            Real b0 = mBasis.GetValue(0, i0);
-                            Real b1 = mBasis.GetValue(0, i1);
-                            value += b0 * b1;
-                        }
+                        mATA(imin + static_cast<int32_t>(m0), imin + static_cast<int32_t>(m1)) +=
+                            basis[m0] * basis[m1];
                     }
-                    ATAMat(i0, i1) = value;
+                }
+            }
+            for (int32_t i0 = 1; i0 < mNumControls; ++i0)
+            {
+                int32_t i1Min = (i0 > mDegree ? i0 - mDegree : 0);
+                for (int32_t i1 = i1Min; i1 < i0; ++i1)
+                {
+                    mATA(i0, i1) = mATA(i1, i0);
                 }
             }
 
-            // Construct the matrix A^T.
-            Array2<Real> ATMat(mNumSamples, mNumControls);
-            std::memset(ATMat[0], 0, static_cast<size_t>(mNumControls) * static_cast<size_t>(mNumSamples) * sizeof(Real));
-            for (i0 = 0; i0 < mNumControls; ++i0)
+            bool factored = mATA.CholeskyFactor();
+            LogAssert(factored, "Failed to factor the normal equations.");
+        }
+
+        // Fit a dataset of 'dimension' channels.  The samples are contiguous
+        // blocks of 'dimension' real values in sampleData and the control
+        // points are written the same way to controlData, which must have
+        // numControls * dimension elements.  When matchEndpoints is true,
+        // the first and last control points are set to the first and last
+        // samples, as BSplineCurveFit does, so that the curve passes through
+        // the end samples.
+        void Fit(int32_t dimension, Real const* sampleData, Real* controlData,
+            bool matchEndpoints = true) const
+        {
+            LogAssert(dimension >= 1 && sampleData && controlData, "Invalid input.");
+
+            // Compute A^T*P.
+            size_t const numBasis = static_cast<size_t>(mDegree) + 1;
+            size_t const dim = static_cast<size_t>(dimension);
+            std::fill(controlData, controlData + static_cast<size_t>(mNumControls) * dim, (Real)0);
+            for (int32_t i = 0; i < mNumSamples; ++i)
             {
-                for (i1 = 0; i1 < mNumSamples; ++i1)
+                Real const* basis = &mSampleBasis[static_cast<size_t>(i) * numBasis];
+                Real const* P = &sampleData[static_cast<size_t>(i) * dim];
+                Real* Q = &controlData[static_cast<size_t>(mSampleMinIndices[i]) * dim];
+                for (size_t m = 0; m < numBasis; ++m, Q += dim)
                 {
-                    t = tMultiplier * (Real)i1;
-                    mBasis.Evaluate(t, 0, imin, imax);
-                    if (imin <= i0 && i0 <= imax)
+                    for (size_t j = 0; j < dim; ++j)
                     {
-                        ATMat[i0][i1] = mBasis.GetValue(0, i0);
+                        Q[j] += basis[m] * P[j];
                     }
                 }
             }
 
-            // Compute X0 = (A^T*A)^{-1}*A^T by solving the linear system
-            // A^T*A*X = A^T.
-            bool solved = ATAMat.template SolveSystem<true>(ATMat[0], mNumSamples);
+            // Solve A^T*A*Q = A^T*P.
+            bool solved = mATA.template SolveFactored<true>(controlData, dimension);
             LogAssert(solved, "Failed to solve linear system.");
 
-            // The control points for the fitted curve are stored in the
-            // vector Q = X0*P, where P is the vector of sample data.
-            std::fill(mControlData.begin(), mControlData.end(), (Real)0);
-            for (i0 = 0; i0 < mNumControls; ++i0)
+            if (matchEndpoints)
+            {
+                Real const* sEnd1 = &sampleData[dim * (static_cast<size_t>(mNumSamples) - 1)];
+                Real* cEnd1 = &controlData[dim * (static_cast<size_t>(mNumControls) - 1)];
+                std::copy(sampleData, sampleData + dim, controlData);
+                std::copy(sEnd1, sEnd1 + dim, cEnd1);
+            }
+        }
+
+        // Fit numDatasets datasets of the same size.  Dataset k has samples
+        // sampleData[k * numSamples * dimension] and control points
+        // controlData[k * numControls * dimension].  Set numThreads to 2 or
+        // larger to fit blocks of datasets as tasks of
+        // TaskScheduler::GetDefault().
+        void Fit(int32_t dimension, size_t numDatasets, Real const* sampleData,
+            Real* controlData, bool matchEndpoints = true, size_t numThreads = 0) const
+        {
+            size_t const sampleStride = static_cast<size_t>(mNumSamples) * static_cast<size_t>(dimension);
+            size_t const controlStride = static_cast<size_t>(mNumControls) * static_cast<size_t>(dimension);
+            auto fitDatasets = [this, dimension, sampleData, controlData, matchEndpoints,
+                sampleStride, controlStride](size_t kmin, size_t kmax)
             {
-                Real* Q = &mControlData[i0 * static_cast<size_t>(mDimension)];
-                for (i1 = 0; i1 < mNumSamples; ++i1)
+                for (size_t k = kmin; k < kmax; ++k)
                 {
-                    Real const* P = mSampleData + i1 * static_cast<size_t>(mDimension);
-                    Real xValue = ATMat[i0][i1];
-                    for (j = 0; j < mDimension; ++j)
-                    {
-                        Q[j] += xValue * P[j];
-                    }
+                    Fit(dimension, sampleData + k * sampleStride,
+                        controlData + k * controlStride, matchEndpoints);
                 }
-            }
+            };
 
-            // Set the first and last output control points to match the first
-            // and last input samples.  This supports the application of
-            // fitting keyframe data with B-spline curves.  The user expects
-            // that the curve passes through the first and last positions in
-            // order to support matching two consecutive keyframe sequences.
-            Real* cEnd0 = &mControlData[0];
-            Real const* sEnd0 = mSampleData;
-            Real* cEnd1 = &mControlData[static_cast<size_t>(mDimension) * (static_cast<size_t>(mNumControls) - 1)];
-            Real const* sEnd1 = &mSampleData[static_cast<size_t>(mDimension) * (static_cast<size_t>(mNumSamples) - 1)];
-            for (j = 0; j < mDimension; ++j)
+            size_t const numTasks = std::max(std::min(numThreads, numDatasets), static_cast<size_t>(1));
+            if (numTasks == 1)
             {
-                *cEnd0++ = *sEnd0++;
-                *cEnd1++ = *sEnd1++;
+                fitDatasets(0, numDatasets);
+                return;
             }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [numDatasets, numTasks, &fitDatasets](size_t k)
+                {
+                    fitDatasets(k * numDatasets / numTasks, (k + 1) * numDatasets / numTasks);
+                });
+        }
+
+        // Member access.
+        inline int32_t GetNumSamples() const
+        {
+            return mNumSamples;
+        }
+
+        inline int32_t GetDegree() const
+        {
+            return mDegree;
+        }
+
+        inline int32_t GetNumControls() const
+        {
+            return mNumControls;
+        }
+
+        inline BasisFunction<Real> const& GetBasis() const
+        {
+            return mBasis;
+        }
+
+    private:
+        int32_t mNumSamples;
+        int32_t mDegree;
+        int32_t mNumControls;
+        BasisFunction<Real> mBasis;
+
+        // The nonzero basis values of sample i are mSampleBasis[i*(degree+1)
+        // + m] for the control points mSampleMinIndices[i] + m.
+        std::vector<int32_t> mSampleMinIndices;
+        std::vector<Real> mSampleBasis;
+
+        // The Cholesky factorization of A^T*A.
+        BandedMatrix<Real> mATA;
+    };
+
+    template <typename Real>
+    class BSplineCurveFit
+    {
+    public:
+        // Construction.  The preconditions for calling the constructor are
+        // 1 <= degree && degree < numControls <= numSamples - degree - 1.
+        // The samples points are contiguous blocks of 'dimension' real values
+        // stored in sampleData.  To fit many datasets of the same size, use
+        // BSplineCurveFitter directly.
+        BSplineCurveFit(int32_t dimension, int32_t numSamples, Real const* sampleData,
+            int32_t degree, int32_t numControls)
+            :
+            mDimension(dimension),
+            mNumSamples(numSamples),
+            mSampleData(sampleData),
+            mDegree(degree),
+            mNumControls(numControls),
+            mControlData(static_cast<size_t>(dimension) * static_cast<size_t>(numControls)),
+            mFitter(numSamples, degree, numControls)
+        {
+            LogAssert(dimension >= 1, "Invalid dimension.");
+            LogAssert(numControls <= numSamples - degree - 1, "Invalid number of controls.");
+            LogAssert(sampleData, "Invalid sample data.");
+
+            // Fit the data points with a B-spline curve using a least-squares
+            // error metric.  The problem is of the form A^T*A*Q = A^T*P,
+            // where A^T*A is a banded matrix, P contains the sample data, and
+            // Q is the unknown vector of control points.  The first and last
+            // output control points are set to match the first and last
+            // input samples.  This supports the application of fitting
+            // keyframe data with B-spline curves.  The user expects that the
+            // curve passes through the first and last positions in order to
+            // support matching two consecutive keyframe sequences.
+            mFitter.Fit(mDimension, mSampleData, mControlData.data(), true);
         }
 
         // Access to input sample information.
@@ -189,7 +289,7 @@ namespace gte
 
         inline BasisFunction<Real> const& GetBasis() const
         {
-            return mBasis;
+            return mFitter.GetBasis();
         }
 
         // Evaluation of the B-spline curve.  It is defined for 0 <= t <= 1.
@@ -198,11 +298,12 @@ namespace gte
         // elements.
         void Evaluate(Real t, uint32_t order, Real* value) const
         {
+            BasisFunction<Real> const& basis = mFitter.GetBasis();
             int32_t imin, imax;
-            mBasis.Evaluate(t, order, imin, imax);
+            basis.Evaluate(t, order, imin, imax);
 
             Real const* source = &mControlData[static_cast<size_t>(mDimension) * imin];
-            Real basisValue = mBasis.GetValue(order, imin);
+            Real basisValue = basis.GetValue(order, imin);
             for (int32_t j = 0; j < mDimension; ++j)
             {
                 value[j] = basisValue * (*source++);
@@ -210,7 +311,7 @@ namespace gte
 
             for (int32_t i = imin + 1; i <= imax; ++i)
             {
-                basisValue = mBasis.GetValue(order, i);
+                basisValue = basis.GetValue(order, i);
                 for (int32_t j = 0; j < mDimension; ++j)
                 {
                     value[j] += basisValue * (*source++);
@@ -233,6 +334,6 @@ namespace gte
         int32_t mDegree;
         int32_t mNumControls;
         std::vector<Real> mControlData;
-        BasisFunction<Real> mBasis;
+        BSplineCurveFitter<Real> mFitter;
     };
 }
@@ -9,6 +9,8 @@
 
 #include <Mathematics/BasisFunction.h>
 #include <Mathematics/ParametricSurface.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 
 namespace gte
 {
@@ -139,7 +141,112 @@ namespace gte
             }
         }
 
+        // Batch evaluation of the surface at the grid of parameters (u[iu],
+        // v[iv]) for 0 <= iu < numU and 0 <= iv < numV, for example the
+        // vertices of a tessellation.  Let numJets be 1, 3 or 6 for order 0,
+        // 1 or 2.  The jets are stored consecutively with u varying fastest;
+        // that is, jets[(iv * numU + iu) * numJets + k] is jet[k] of
+        // Evaluate(u[iu], v[iv], order, jet).  The basis functions of each
+        // direction are evaluated once per parameter by the batch function
+        // of BasisFunction, which is fastest when the parameters are sorted.
+        // Set numThreads to 2 or larger to evaluate blocks of rows (constant
+        // v) as tasks of TaskScheduler::GetDefault().
+        void Evaluate(size_t numU, Real const* u, size_t numV, Real const* v,
+            uint32_t order, Vector<N, Real>* jets, size_t numThreads = 0) const
+        {
+            LogAssert(order <= 2, "Invalid order.");
+            size_t const numJets = (static_cast<size_t>(order) + 1) * (static_cast<size_t>(order) + 2) / 2;
+            if (!this->mConstructed)
+            {
+                // Return zero-valued jets for invalid state.
+                for (size_t i = 0; i < numU * numV * numJets; ++i)
+                {
+                    jets[i].MakeZero();
+                }
+                return;
+            }
+
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+            std::array<std::vector<int32_t>, 2> minIndices{};
+            std::array<std::vector<Real>, 2> values{};
+            std::array<size_t, 2> const numSamples = { numU, numV };
+            std::array<Real const*, 2> const parameters = { u, v };
+            for (size_t dim = 0; dim < 2; ++dim)
+            {
+                size_t const numBasis = static_cast<size_t>(mBasisFunction[dim].GetDegree()) + 1;
+                minIndices[dim].resize(numSamples[dim]);
+                values[dim].resize(numSamples[dim] * numOrders * numBasis);
+                mBasisFunction[dim].Evaluate(numSamples[dim], parameters[dim],
+                    order, minIndices[dim].data(), values[dim].data());
+            }
+
+            size_t const numTasks = std::max(std::min(numThreads,
+                numU * numV / 4096), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                EvaluateRows(0, numV, numU, order, minIndices, values, jets);
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [this, numU, numV, numTasks, order, &minIndices, &values, jets](size_t k)
+                {
+                    EvaluateRows(k * numV / numTasks, (k + 1) * numV / numTasks,
+                        numU, order, minIndices, values, jets);
+                });
+        }
+
     private:
+        // Support for the batch Evaluate(...).  The basis values of the
+        // parameters are stored as described for the batch function of
+        // BasisFunction, values[0] for u and values[1] for v.
+        void EvaluateRows(size_t ivmin, size_t ivmax, size_t numU, uint32_t order,
+            std::array<std::vector<int32_t>, 2> const& minIndices,
+            std::array<std::vector<Real>, 2> const& values,
+            Vector<N, Real>* jets) const
+        {
+            // The (u,v) derivative orders of the jet elements.
+            std::array<std::array<uint32_t, 2>, 6> const jetOrders =
+            { {
+                { 0, 0 }, { 1, 0 }, { 0, 1 }, { 2, 0 }, { 1, 1 }, { 0, 2 }
+            } };
+
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+            size_t const numJets = numOrders * (numOrders + 1) / 2;
+            size_t const numBasisU = static_cast<size_t>(mBasisFunction[0].GetDegree()) + 1;
+            size_t const numBasisV = static_cast<size_t>(mBasisFunction[1].GetDegree()) + 1;
+            int32_t const numControls0 = mNumControls[0];
+            int32_t const numControls1 = mNumControls[1];
+            for (size_t iv = ivmin; iv < ivmax; ++iv)
+            {
+                Real const* basisV = &values[1][iv * numOrders * numBasisV];
+                for (size_t iu = 0; iu < numU; ++iu)
+                {
+                    Real const* basisU = &values[0][iu * numOrders * numBasisU];
+                    Vector<N, Real>* jet = &jets[(iv * numU + iu) * numJets];
+                    for (size_t k = 0; k < numJets; ++k)
+                    {
+                        Real const* tmpU = basisU + jetOrders[k][0] * numBasisU;
+                        Real const* tmpV = basisV + jetOrders[k][1] * numBasisV;
+                        Vector<N, Real> result;
+                        result.MakeZero();
+                        for (size_t mv = 0; mv < numBasisV; ++mv)
+                        {
+                            int32_t i1 = minIndices[1][iv] + static_cast<int32_t>(mv);
+                            int32_t jv = (i1 >= numControls1 ? i1 - numControls1 : i1);
+                            for (size_t mu = 0; mu < numBasisU; ++mu)
+                            {
+                                int32_t i0 = minIndices[0][iu] + static_cast<int32_t>(mu);
+                                int32_t ju = (i0 >= numControls0 ? i0 - numControls0 : i0);
+                                result += (tmpU[mu] * tmpV[mv]) * mControls[ju + static_cast<size_t>(numControls0) * jv];
+                            }
+                        }
+                        jet[k] = result;
+                    }
+                }
+            }
+        }
+
         // Support for Evaluate(...).
         Vector<N, Real> Compute(uint32_t uOrder, uint32_t vOrder,
             int32_t iumin, int32_t iumax, int32_t ivmin, int32_t ivmax) const
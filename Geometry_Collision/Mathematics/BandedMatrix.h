@@ -276,6 +276,24 @@ namespace gte
                 && SolveUpper<RowMajor>(bMatrix, numBColumns);
         }
 
+        // Solve the linear system A*X = B after a successful call to
+        // CholeskyFactor().  The matrix is not modified, so the factorization
+        // can be reused for any number of right-hand sides.  The input to
+        // this function is B.  The output X is computed and stored in B.
+        bool SolveFactored(Real* bVector) const
+        {
+            return SolveLower(bVector) && SolveUpper(bVector);
+        }
+
+        // The same as SolveFactored(Real*), but B is an NxM matrix with the
+        // storage order specified by the template parameter.
+        template <bool RowMajor>
+        bool SolveFactored(Real* bMatrix, int32_t numBColumns) const
+        {
+            return SolveLower<RowMajor>(bMatrix, numBColumns)
+                && SolveUpper<RowMajor>(bMatrix, numBColumns);
+        }
+
         // Compute the inverse of the banded matrix.  The return value is
         // 'true' when the matrix is invertible, in which case the 'inverse'
         // output is valid.  The return value is 'false' when the matrix is
@@ -385,6 +403,20 @@ namespace gte
         }
 
     private:
+        // The columns of row r that are in the bands, so the triangular
+        // solves skip the zero elements outside the bands.
+        inline int32_t GetMinLowerColumn(int32_t r) const
+        {
+            int32_t c = r - static_cast<int32_t>(mLBands.size());
+            return (c > 0 ? c : 0);
+        }
+
+        inline int32_t GetSupUpperColumn(int32_t r) const
+        {
+            int32_t c = r + 1 + static_cast<int32_t>(mUBands.size());
+            return (c < mSize ? c : mSize);
+        }
+
         // The linear system is L*U*X = B, where A = L*U and U = L^T,  Reduce
         // this to U*X = L^{-1}*B.  The return value is 'true' iff the
         // operation is successful.
@@ -396,7 +428,7 @@ namespace gte
                 Real lowerRR = operator()(r, r);
                 if (lowerRR > (Real)0)
                 {
-                    for (int32_t c = 0; c < r; ++c)
+                    for (int32_t c = GetMinLowerColumn(r); c < r; ++c)
                     {
                         Real lowerRC = operator()(r, c);
                         dataVector[r] -= lowerRC * dataVector[c];
@@ -422,7 +454,7 @@ namespace gte
                 Real upperRR = operator()(r, r);
                 if (upperRR > (Real)0)
                 {
-                    for (int32_t c = r + 1; c < size; ++c)
+                    for (int32_t c = r + 1; c < GetSupUpperColumn(r); ++c)
                     {
                         Real upperRC = operator()(r, c);
                         dataVector[r] -= upperRC * dataVector[c];
@@ -452,7 +484,7 @@ namespace gte
                 Real lowerRR = operator()(r, r);
                 if (lowerRR > (Real)0)
                 {
-                    for (int32_t c = 0; c < r; ++c)
+                    for (int32_t c = GetMinLowerColumn(r); c < r; ++c)
                     {
                         Real lowerRC = operator()(r, c);
                         for (int32_t bCol = 0; bCol < numColumns; ++bCol)
@@ -489,7 +521,7 @@ namespace gte
                 Real upperRR = operator()(r, r);
                 if (upperRR > (Real)0)
                 {
-                    for (int32_t c = r + 1; c < mSize; ++c)
+                    for (int32_t c = r + 1; c < GetSupUpperColumn(r); ++c)
                     {
                         Real upperRC = operator()(r, c);
                         for (int32_t bCol = 0; bCol < numColumns; ++bCol)
@@ -10,8 +10,10 @@
 #include <Mathematics/Logger.h>
 #include <Mathematics/Math.h>
 #include <Mathematics/Array2.h>
+#include <algorithm>
 #include <array>
 #include <cstring>
+#include <vector>
 
 namespace gte
 {
@@ -415,13 +417,124 @@ namespace gte
             LogError("Invalid order.");
         }
 
+        // Batch evaluation of the basis functions and their derivatives
+        // through 'order' at the parameters t[0] through t[numSamples-1],
+        // for example the samples of a tessellation.  For sample s,
+        // minIndices[s] is the minIndex of Evaluate(t[s], order, minIndex,
+        // maxIndex), maxIndex is minIndices[s] + degree, and the value that
+        // GetValue(k, minIndices[s] + m) returns after that call is
+        //   values[(s * (order + 1) + k) * (degree + 1) + m]
+        // for 0 <= k <= order and 0 <= m <= degree.  The knot span of a
+        // sample is found by walking from the span of the previous sample,
+        // and the reciprocals of the knot differences are computed once per
+        // span, so sorted parameters cost O(degree^2) per sample regardless
+        // of the number of knots.  Unlike the single-parameter Evaluate, this
+        // function does not modify the object, so threads may call it
+        // concurrently.
+        void Evaluate(size_t numSamples, Real const* t, uint32_t order,
+            int32_t* minIndices, Real* values) const
+        {
+            LogAssert(order <= 3, "Invalid order.");
+
+            size_t const numBasis = static_cast<size_t>(mDegree) + 1;
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+
+            // jet[(o * numBasis + j) * numBasis + m] stores the value
+            // mJet[o][j][i - degree + m] of the single-parameter Evaluate,
+            // and invD0 and invD1 store the reciprocals of the knot
+            // differences of span i at index j * numBasis + m.
+            std::vector<Real> jet(numOrders * numBasis * numBasis);
+            std::vector<Real> invD0(numBasis * numBasis), invD1(numBasis * numBasis);
+            int32_t span = -1, i = mDegree;
+            for (size_t s = 0; s < numSamples; ++s)
+            {
+                Real tValue = t[s];
+                i = GetIndex(tValue, i);
+                if (i != span)
+                {
+                    for (int32_t j = 1; j <= mDegree; ++j)
+                    {
+                        for (int32_t m = mDegree - j; m <= mDegree; ++m)
+                        {
+                            size_t const k = static_cast<size_t>(i) - static_cast<size_t>(mDegree) + static_cast<size_t>(m);
+                            Real d0 = mKnots[k + static_cast<size_t>(j)] - mKnots[k];
+                            Real d1 = mKnots[k + static_cast<size_t>(j) + 1] - mKnots[k + 1];
+                            size_t const index = static_cast<size_t>(j) * numBasis + static_cast<size_t>(m);
+                            invD0[index] = (d0 > (Real)0 ? (Real)1 / d0 : (Real)0);
+                            invD1[index] = (d1 > (Real)0 ? (Real)1 / d1 : (Real)0);
+                        }
+                    }
+                    span = i;
+                }
+
+                for (size_t o = 0; o < numOrders; ++o)
+                {
+                    jet[o * numBasis * numBasis + static_cast<size_t>(mDegree)] = (o == 0 ? (Real)1 : (Real)0);
+                }
+
+                for (int32_t j = 1; j <= mDegree; ++j)
+                {
+                    for (int32_t m = mDegree - j; m <= mDegree; ++m)
+                    {
+                        size_t const k = static_cast<size_t>(i) - static_cast<size_t>(mDegree) + static_cast<size_t>(m);
+                        Real n0 = tValue - mKnots[k];
+                        Real n1 = mKnots[k + static_cast<size_t>(j) + 1] - tValue;
+                        size_t const index = static_cast<size_t>(j) * numBasis + static_cast<size_t>(m);
+                        for (size_t o = 0; o < numOrders; ++o)
+                        {
+                            Real* current = &jet[(o * numBasis + static_cast<size_t>(j)) * numBasis];
+                            Real const* previous = current - numBasis;
+                            Real const* lower = previous - numBasis * numBasis;
+                            Real e0, e1;
+                            if (m == mDegree)
+                            {
+                                e0 = n0 * previous[m];
+                                if (o > 0)
+                                {
+                                    e0 += static_cast<Real>(o) * lower[m];
+                                }
+                                current[m] = e0 * invD0[index];
+                            }
+                            else if (m == mDegree - j)
+                            {
+                                e1 = n1 * previous[m + 1];
+                                if (o > 0)
+                                {
+                                    e1 -= static_cast<Real>(o) * lower[m + 1];
+                                }
+                                current[m] = e1 * invD1[index];
+                            }
+                            else
+                            {
+                                e0 = n0 * previous[m];
+                                e1 = n1 * previous[m + 1];
+                                if (o > 0)
+                                {
+                                    e0 += static_cast<Real>(o) * lower[m];
+                                    e1 -= static_cast<Real>(o) * lower[m + 1];
+                                }
+                                current[m] = e0 * invD0[index] + e1 * invD1[index];
+                            }
+                        }
+                    }
+                }
+
+                minIndices[s] = i - mDegree;
+                Real* output = &values[s * numOrders * numBasis];
+                for (size_t o = 0; o < numOrders; ++o)
+                {
+                    Real const* source = &jet[(o * numBasis + static_cast<size_t>(mDegree)) * numBasis];
+                    std::copy(source, source + numBasis, output + o * numBasis);
+                }
+            }
+        }
+
     private:
-        // Determine the index i for which knot[i] <= t < knot[i+1].  The
-        // t-value is modified (wrapped for periodic splines, clamped for
-        // nonperiodic splines).
-        int32_t GetIndex(Real& t) const
+        // Wrap the t-value for periodic splines and clamp it to [tmin,tmax].
+        // The function returns the index i for which knot[i] <= t <
+        // knot[i+1] when t is at an end of the domain, -1 otherwise.
+        int32_t ReduceParameter(Real& t) const
         {
-            // Find the index i for which knot[i] <= t < knot[i+1].
             if (mPeriodic)
             {
                 // Wrap to [tmin,tmax].
@@ -445,6 +558,20 @@ namespace gte
                 t = mTMax;
                 return mNumControls - 1;
             }
+            return -1;
+        }
+
+        // Determine the index i for which knot[i] <= t < knot[i+1].  The
+        // t-value is modified (wrapped for periodic splines, clamped for
+        // nonperiodic splines).
+        int32_t GetIndex(Real& t) const
+        {
+            // Find the index i for which knot[i] <= t < knot[i+1].
+            int32_t i = ReduceParameter(t);
+            if (i >= 0)
+            {
+                return i;
+            }
 
             // At this point, tmin < t < tmax.
             for (auto const& key : mKeys)
@@ -459,6 +586,29 @@ namespace gte
             LogError("Unexpected condition.");
         }
 
+        // The same as GetIndex(t), but the search walks the knots from the
+        // index i of a nearby t-value, degree <= i <= numControls-1.
+        int32_t GetIndex(Real& t, int32_t i) const
+        {
+            int32_t iEnd = ReduceParameter(t);
+            if (iEnd >= 0)
+            {
+                return iEnd;
+            }
+
+            // At this point, tmin < t < tmax, so knot[degree] <= t <
+            // knot[numControls] and the walks stop in that range.
+            while (t < mKnots[i])
+            {
+                --i;
+            }
+            while (t >= mKnots[static_cast<size_t>(i) + 1])
+            {
+                ++i;
+            }
+            return i;
+        }
+
         // Constructor inputs and values derived from them.
         int32_t mNumControls;
         int32_t mDegree;
@@ -0,0 +1,196 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/GMatrix.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+// Support for GaussNewtonMinimizer and LevenbergMarquardtMinimizer when the
+// number n of components of F(p) is large. The caller provides a batch
+// function that evaluates the components F_{r}(p) and, when requested, the
+// rows of the Jacobian J(p) for a range of indices r. The rows are processed
+// in blocks, so the n-by-m Jacobian is never stored, and the blocks are
+// accumulated into J^T*J, -J^T*F and |F|^2. To run in the main thread only,
+// choose numThreads to be 0. For multithreading, choose numThreads > 0. The
+// rows are then partitioned into numThreads contiguous ranges that are
+// processed by tasks of TaskScheduler::GetDefault(), each with its own
+// partial sums and block storage, and the partial sums are added in the
+// order of the ranges. The batch function is then called concurrently for
+// disjoint ranges and must be thread-safe. The block storage is allocated
+// by the first call and reused by the later calls.
+
+namespace gte
+{
+    template <typename T>
+    class BatchedNormalEquations
+    {
+    public:
+        // Evaluate F_{r}(p) for rmin <= r < rmax and store it in
+        // residual[r - rmin]. When jacobian is not null, also store
+        // dF_{r}/dp_{c} in jacobian[(r - rmin) * numPDimensions + c].
+        typedef std::function<void(GVector<T> const& p, int32_t rmin, int32_t rmax,
+            T* residual, T* jacobian)> BatchFunction;
+
+        BatchedNormalEquations(int32_t numPDimensions, int32_t numFDimensions,
+            BatchFunction const& batchFunction, size_t numThreads)
+            :
+            mNumPDimensions(numPDimensions),
+            mNumFDimensions(numFDimensions),
+            mBatchFunction(batchFunction),
+            mWorkspaces(std::max(std::min(numThreads,
+                static_cast<size_t>(numFDimensions) / minPerTask), static_cast<size_t>(1)))
+        {
+            LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
+            LogAssert(mBatchFunction != nullptr, "A batch function is required.");
+        }
+
+        // Compute E(p) = |F(p)|^2.
+        T ComputeError(GVector<T> const& p)
+        {
+            Execute(p, false);
+
+            T error = static_cast<T>(0);
+            for (auto const& workspace : mWorkspaces)
+            {
+                error += workspace.error;
+            }
+            return error;
+        }
+
+        // Compute J^T(p)*J(p) and -J^T(p)*F(p). The function returns
+        // E(p) = |F(p)|^2.
+        T Compute(GVector<T> const& p, GMatrix<T>& jTJ, GVector<T>& negJTF)
+        {
+            Execute(p, true);
+
+            size_t const m = static_cast<size_t>(mNumPDimensions);
+            T error = static_cast<T>(0);
+            jTJ.MakeZero();
+            negJTF.MakeZero();
+            for (auto const& workspace : mWorkspaces)
+            {
+                error += workspace.error;
+                for (size_t r = 0; r < m; ++r)
+                {
+                    int32_t const ir = static_cast<int32_t>(r);
+                    negJTF[ir] -= workspace.jTF[r];
+                    for (size_t c = r; c < m; ++c)
+                    {
+                        jTJ(ir, static_cast<int32_t>(c)) += workspace.jTJ[r * m + c];
+                    }
+                }
+            }
+
+            for (int32_t r = 1; r < mNumPDimensions; ++r)
+            {
+                for (int32_t c = 0; c < r; ++c)
+                {
+                    jTJ(r, c) = jTJ(c, r);
+                }
+            }
+            return error;
+        }
+
+    private:
+        struct Workspace
+        {
+            Workspace()
+                :
+                residual{},
+                jacobian{},
+                jTJ{},
+                jTF{},
+                error(static_cast<T>(0))
+            {
+            }
+
+            // The outputs of the batch function for a block of rows.
+            std::vector<T> residual, jacobian;
+
+            // The partial sums of the task. Only the upper triangle of jTJ
+            // is accumulated.
+            std::vector<T> jTJ, jTF;
+            T error;
+        };
+
+        void Execute(GVector<T> const& p, bool computeJacobian)
+        {
+            size_t const numTasks = mWorkspaces.size();
+            auto processRange = [this, &p, computeJacobian, numTasks](size_t k)
+            {
+                size_t const m = static_cast<size_t>(mNumPDimensions);
+                size_t const n = static_cast<size_t>(mNumFDimensions);
+                Workspace& workspace = mWorkspaces[k];
+                workspace.residual.resize(blockSize);
+                workspace.error = static_cast<T>(0);
+                if (computeJacobian)
+                {
+                    workspace.jacobian.resize(blockSize * m);
+                    workspace.jTJ.assign(m * m, static_cast<T>(0));
+                    workspace.jTF.assign(m, static_cast<T>(0));
+                }
+
+                T* residual = workspace.residual.data();
+                T* jacobian = (computeJacobian ? workspace.jacobian.data() : nullptr);
+                T* jTJ = workspace.jTJ.data();
+                T* jTF = workspace.jTF.data();
+                size_t const rmin = k * n / numTasks;
+                size_t const rmax = (k + 1) * n / numTasks;
+                for (size_t r0 = rmin; r0 < rmax; r0 += blockSize)
+                {
+                    size_t const r1 = std::min(r0 + blockSize, rmax);
+                    mBatchFunction(p, static_cast<int32_t>(r0), static_cast<int32_t>(r1),
+                        residual, jacobian);
+
+                    for (size_t i = 0; i < r1 - r0; ++i)
+                    {
+                        T const f = residual[i];
+                        workspace.error += f * f;
+                        if (computeJacobian)
+                        {
+                            T const* row = jacobian + i * m;
+                            for (size_t c0 = 0; c0 < m; ++c0)
+                            {
+                                T const j0 = row[c0];
+                                jTF[c0] += j0 * f;
+                                T* jTJRow = jTJ + c0 * m;
+                                for (size_t c1 = c0; c1 < m; ++c1)
+                                {
+                                    jTJRow[c1] += j0 * row[c1];
+                                }
+                            }
+                        }
+                    }
+                }
+            };
+
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, processRange);
+            }
+            else
+            {
+                processRange(0);
+            }
+        }
+
+        // The number of rows passed to one call of the batch function and
+        // the minimum number of rows of a task.
+        static size_t constexpr blockSize = 256;
+        static size_t constexpr minPerTask = 4096;
+
+        int32_t mNumPDimensions, mNumFDimensions;
+        BatchFunction mBatchFunction;
+        std::vector<Workspace> mWorkspaces;
+    };
+}
@@ -0,0 +1,551 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Cache-blocked kernels for dense matrix multiplication, LU factorization
+// with partial pivoting and Cholesky factorization. The matrices are arrays
+// in row-major order with a leading dimension: element (r,c) of a matrix M
+// with leading dimension ldm is M[c + ldm * r]. A column-major matrix is
+// the row-major array of its transpose. GMatrix and CholeskyDecomposition
+// use these kernels for their products and factorizations.
+//
+// The products are computed on panels of the inputs that are copied into
+// contiguous buffers sized for the caches. The innermost loops update a
+// block of MR-by-NR elements held in a local array, with the NR columns
+// contiguous, which compilers vectorize for float and double without
+// intrinsics, so the kernels also work for exact types such as BSRational.
+//
+// The order of the floating-point operations is that of the textbook
+// triple loops: each element of a product is the sum of the terms in the
+// order of increasing common index, added one at a time to zero, and each
+// element updated by a factorization has the terms subtracted one at a
+// time in the order of the pivots. The results are therefore the same as
+// those of the unblocked loops, bit for bit, unless the compiler contracts
+// multiplications and additions into fused multiply-adds differently for
+// the two forms. The number of threads does not change the results.
+//
+// Set numThreads to 2 or larger to split the products into blocks of rows
+// that are tasks of TaskScheduler::GetDefault(). Products with fewer than
+// about 2^18 multiply-adds always run on the calling thread.
+
+namespace gte
+{
+    template <typename Real>
+    class BlockedMatrixKernels
+    {
+    public:
+        // Compute C = op(A) * op(B), where op(A) is numRows-by-numCommon,
+        // op(B) is numCommon-by-numCols and C is numRows-by-numCols. The
+        // op(M) is the transpose of M when transposeM is true, M otherwise.
+        // C must not overlap A or B.
+        static void Multiply(int32_t numRows, int32_t numCols, int32_t numCommon,
+            Real const* A, int32_t lda, bool transposeA,
+            Real const* B, int32_t ldb, bool transposeB,
+            Real* C, int32_t ldc, size_t numThreads = 0)
+        {
+            Real const zero = static_cast<Real>(0);
+            for (int32_t r = 0; r < numRows; ++r)
+            {
+                std::fill(C + static_cast<size_t>(ldc) * r,
+                    C + static_cast<size_t>(ldc) * r + numCols, zero);
+            }
+            Update<true>(numRows, numCols, numCommon, A, lda, transposeA,
+                B, ldb, transposeB, C, ldc, numThreads);
+        }
+
+        // Compute C = C - op(A) * op(B) with the same conventions as
+        // Multiply. The terms are subtracted from C one at a time.
+        static void MultiplySubtract(int32_t numRows, int32_t numCols, int32_t numCommon,
+            Real const* A, int32_t lda, bool transposeA,
+            Real const* B, int32_t ldb, bool transposeB,
+            Real* C, int32_t ldc, size_t numThreads = 0)
+        {
+            Update<false>(numRows, numCols, numCommon, A, lda, transposeA,
+                B, ldb, transposeB, C, ldc, numThreads);
+        }
+
+        // Factor the n-by-n matrix A as P * A = L * U, where L is lower
+        // triangular with unit diagonal and U is upper triangular. On
+        // output, the strictly lower-triangular part of A is L and the
+        // upper-triangular part of A is U. Row i was swapped with row
+        // pivots[i] >= i before the elimination of column i; pivots must
+        // have n elements. The return value is false when a pivot is zero,
+        // in which case A is singular and the factorization is incomplete.
+        static bool FactorLU(int32_t n, Real* A, int32_t lda, int32_t* pivots,
+            size_t numThreads = 0)
+        {
+            Real const zero = static_cast<Real>(0);
+            for (int32_t j0 = 0; j0 < n; j0 += NB)
+            {
+                int32_t const j1 = std::min(j0 + NB, n);
+
+                // Factor the panel of columns [j0,j1) of rows [j0,n),
+                // updating only the panel columns. The row swaps are
+                // applied to the full rows.
+                for (int32_t c = j0; c < j1; ++c)
+                {
+                    int32_t pivot = c;
+                    Real maxValue = Abs(A[c + static_cast<size_t>(lda) * c]);
+                    for (int32_t r = c + 1; r < n; ++r)
+                    {
+                        Real value = Abs(A[c + static_cast<size_t>(lda) * r]);
+                        if (value > maxValue)
+                        {
+                            maxValue = value;
+                            pivot = r;
+                        }
+                    }
+                    pivots[c] = pivot;
+                    if (maxValue == zero)
+                    {
+                        return false;
+                    }
+
+                    if (pivot != c)
+                    {
+                        std::swap_ranges(A + static_cast<size_t>(lda) * c,
+                            A + static_cast<size_t>(lda) * c + n,
+                            A + static_cast<size_t>(lda) * pivot);
+                    }
+
+                    Real const* rowC = A + static_cast<size_t>(lda) * c;
+                    Real const diagonal = rowC[c];
+                    for (int32_t r = c + 1; r < n; ++r)
+                    {
+                        Real* rowR = A + static_cast<size_t>(lda) * r;
+                        rowR[c] /= diagonal;
+                        Real const multiplier = rowR[c];
+                        for (int32_t k = c + 1; k < j1; ++k)
+                        {
+                            rowR[k] -= multiplier * rowC[k];
+                        }
+                    }
+                }
+
+                if (j1 < n)
+                {
+                    // U12 = L11^{-1} * A12, where L11 has unit diagonal.
+                    for (int32_t i = j0 + 1; i < j1; ++i)
+                    {
+                        Real* rowI = A + static_cast<size_t>(lda) * i;
+                        for (int32_t c = j0; c < i; ++c)
+                        {
+                            Real const multiplier = rowI[c];
+                            Real const* rowC = A + static_cast<size_t>(lda) * c;
+                            for (int32_t k = j1; k < n; ++k)
+                            {
+                                rowI[k] -= multiplier * rowC[k];
+                            }
+                        }
+                    }
+
+                    // A22 = A22 - L21 * U12.
+                    MultiplySubtract(n - j1, n - j1, j1 - j0,
+                        A + j0 + static_cast<size_t>(lda) * j1, lda, false,
+                        A + j1 + static_cast<size_t>(lda) * j0, lda, false,
+                        A + j1 + static_cast<size_t>(lda) * j1, lda, numThreads);
+                }
+            }
+            return true;
+        }
+
+        // Solve A * X = B using the output of FactorLU. B is n-by-numCols
+        // with leading dimension ldb, and on output it is X.
+        static void SolveLU(int32_t n, Real const* LU, int32_t lda,
+            int32_t const* pivots, int32_t numCols, Real* B, int32_t ldb)
+        {
+            for (int32_t i = 0; i < n; ++i)
+            {
+                if (pivots[i] != i)
+                {
+                    std::swap_ranges(B + static_cast<size_t>(ldb) * i,
+                        B + static_cast<size_t>(ldb) * i + numCols,
+                        B + static_cast<size_t>(ldb) * pivots[i]);
+                }
+            }
+
+            // Solve L * Y = P * B.
+            for (int32_t r = 1; r < n; ++r)
+            {
+                Real* rowR = B + static_cast<size_t>(ldb) * r;
+                for (int32_t c = 0; c < r; ++c)
+                {
+                    Real const multiplier = LU[c + static_cast<size_t>(lda) * r];
+                    Real const* rowC = B + static_cast<size_t>(ldb) * c;
+                    for (int32_t k = 0; k < numCols; ++k)
+                    {
+                        rowR[k] -= multiplier * rowC[k];
+                    }
+                }
+            }
+
+            // Solve U * X = Y.
+            for (int32_t r = n - 1; r >= 0; --r)
+            {
+                Real* rowR = B + static_cast<size_t>(ldb) * r;
+                for (int32_t c = r + 1; c < n; ++c)
+                {
+                    Real const multiplier = LU[c + static_cast<size_t>(lda) * r];
+                    Real const* rowC = B + static_cast<size_t>(ldb) * c;
+                    for (int32_t k = 0; k < numCols; ++k)
+                    {
+                        rowR[k] -= multiplier * rowC[k];
+                    }
+                }
+
+                Real const diagonal = LU[r + static_cast<size_t>(lda) * r];
+                for (int32_t k = 0; k < numCols; ++k)
+                {
+                    rowR[k] /= diagonal;
+                }
+            }
+        }
+
+        // Factor the symmetric n-by-n matrix A as A = L * L^T, where L is
+        // lower triangular. Only the lower-triangular part of A is read
+        // and modified; on output it is L. The return value is false when
+        // A is not positive definite, in which case the factorization is
+        // incomplete.
+        static bool FactorCholesky(int32_t n, Real* A, int32_t lda, size_t numThreads = 0)
+        {
+            Real const zero = static_cast<Real>(0);
+            for (int32_t j0 = 0; j0 < n; j0 += NB)
+            {
+                int32_t const j1 = std::min(j0 + NB, n);
+
+                // Factor the panel of columns [j0,j1) of rows [j0,n),
+                // updating only the panel columns.
+                for (int32_t c = j0; c < j1; ++c)
+                {
+                    Real* rowC = A + static_cast<size_t>(lda) * c;
+                    if (rowC[c] <= zero)
+                    {
+                        return false;
+                    }
+                    rowC[c] = std::sqrt(rowC[c]);
+
+                    for (int32_t r = c + 1; r < n; ++r)
+                    {
+                        A[c + static_cast<size_t>(lda) * r] /= rowC[c];
+                    }
+
+                    for (int32_t r = c + 1; r < n; ++r)
+                    {
+                        Real* rowR = A + static_cast<size_t>(lda) * r;
+                        int32_t const kmax = std::min(r + 1, j1);
+                        for (int32_t k = c + 1; k < kmax; ++k)
+                        {
+                            rowR[k] -= rowR[c] * A[c + static_cast<size_t>(lda) * k];
+                        }
+                    }
+                }
+
+                // A22 = A22 - L21 * L21^T for the lower triangle of A22,
+                // one block of NB rows per task. The blocks left of the
+                // diagonal are products and the diagonal blocks are
+                // updated by loops.
+                if (j1 < n)
+                {
+                    int32_t const numBlocks = (n - j1 + NB - 1) / NB;
+                    auto updateBlock = [A, lda, n, j0, j1](size_t b)
+                    {
+                        int32_t const i0 = j1 + static_cast<int32_t>(b) * NB;
+                        int32_t const i1 = std::min(i0 + NB, n);
+                        if (i0 > j1)
+                        {
+                            MultiplySubtract(i1 - i0, i0 - j1, j1 - j0,
+                                A + j0 + static_cast<size_t>(lda) * i0, lda, false,
+                                A + j0 + static_cast<size_t>(lda) * j1, lda, true,
+                                A + j1 + static_cast<size_t>(lda) * i0, lda);
+                        }
+
+                        for (int32_t r = i0; r < i1; ++r)
+                        {
+                            Real* rowR = A + static_cast<size_t>(lda) * r;
+                            for (int32_t c = j0; c < j1; ++c)
+                            {
+                                Real const multiplier = rowR[c];
+                                for (int32_t k = i0; k <= r; ++k)
+                                {
+                                    rowR[k] -= multiplier * A[c + static_cast<size_t>(lda) * k];
+                                }
+                            }
+                        }
+                    };
+
+                    size_t const numTasks = std::min(numThreads, static_cast<size_t>(numBlocks));
+                    if (numTasks > 1 && IsLarge(n - j1, n - j1, j1 - j0))
+                    {
+                        TaskScheduler::GetDefault().ParallelFor(static_cast<size_t>(numBlocks), updateBlock);
+                    }
+                    else
+                    {
+                        for (int32_t b = 0; b < numBlocks; ++b)
+                        {
+                            updateBlock(static_cast<size_t>(b));
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Solve A * X = B using the output L of FactorCholesky. B is
+        // n-by-numCols with leading dimension ldb, and on output it is X.
+        static void SolveCholesky(int32_t n, Real const* L, int32_t lda,
+            int32_t numCols, Real* B, int32_t ldb)
+        {
+            // Solve L * Y = B.
+            for (int32_t r = 0; r < n; ++r)
+            {
+                Real* rowR = B + static_cast<size_t>(ldb) * r;
+                for (int32_t c = 0; c < r; ++c)
+                {
+                    Real const multiplier = L[c + static_cast<size_t>(lda) * r];
+                    Real const* rowC = B + static_cast<size_t>(ldb) * c;
+                    for (int32_t k = 0; k < numCols; ++k)
+                    {
+                        rowR[k] -= multiplier * rowC[k];
+                    }
+                }
+
+                Real const diagonal = L[r + static_cast<size_t>(lda) * r];
+                for (int32_t k = 0; k < numCols; ++k)
+                {
+                    rowR[k] /= diagonal;
+                }
+            }
+
+            // Solve L^T * X = Y.
+            for (int32_t r = n - 1; r >= 0; --r)
+            {
+                Real* rowR = B + static_cast<size_t>(ldb) * r;
+                for (int32_t c = r + 1; c < n; ++c)
+                {
+                    Real const multiplier = L[r + static_cast<size_t>(lda) * c];
+                    Real const* rowC = B + static_cast<size_t>(ldb) * c;
+                    for (int32_t k = 0; k < numCols; ++k)
+                    {
+                        rowR[k] -= multiplier * rowC[k];
+                    }
+                }
+
+                Real const diagonal = L[r + static_cast<size_t>(lda) * r];
+                for (int32_t k = 0; k < numCols; ++k)
+                {
+                    rowR[k] /= diagonal;
+                }
+            }
+        }
+
+    private:
+        // The register block of the product is MR-by-NR. The packed panel
+        // of op(B) is KC-by-NC and the packed panel of op(A) is MC-by-KC.
+        // The factorizations use panels of NB columns.
+        static int32_t constexpr MR = 4;
+        static int32_t constexpr NR = 8;
+        static int32_t constexpr MC = 64;
+        static int32_t constexpr KC = 256;
+        static int32_t constexpr NC = 512;
+        static int32_t constexpr NB = 64;
+
+        static Real Abs(Real const& value)
+        {
+            return (value >= static_cast<Real>(0) ? value : -value);
+        }
+
+        static bool IsLarge(int32_t numRows, int32_t numCols, int32_t numCommon)
+        {
+            return static_cast<double>(numRows) * static_cast<double>(numCols)
+                * static_cast<double>(numCommon) >= 262144.0;
+        }
+
+        // Compute C = C + op(A) * op(B) when Add is true and C = C -
+        // op(A) * op(B) otherwise, one term at a time in the order of
+        // increasing common index.
+        template <bool Add>
+        static void Update(int32_t numRows, int32_t numCols, int32_t numCommon,
+            Real const* A, int32_t lda, bool transposeA,
+            Real const* B, int32_t ldb, bool transposeB,
+            Real* C, int32_t ldc, size_t numThreads)
+        {
+            if (numRows <= 0 || numCols <= 0 || numCommon <= 0)
+            {
+                return;
+            }
+
+            int32_t const numRowBlocks = (numRows + MC - 1) / MC;
+            size_t numTasks = 1;
+            if (numThreads > 1 && IsLarge(numRows, numCols, numCommon))
+            {
+                numTasks = std::min(numThreads, static_cast<size_t>(numRowBlocks));
+            }
+
+            std::vector<Real> packedB(static_cast<size_t>(KC) * (NC + NR));
+            for (int32_t j0 = 0; j0 < numCols; j0 += NC)
+            {
+                int32_t const nc = std::min(static_cast<int32_t>(NC), numCols - j0);
+                for (int32_t p0 = 0; p0 < numCommon; p0 += KC)
+                {
+                    // The blocks of common indices are processed in
+                    // increasing order for all elements of C.
+                    int32_t const kc = std::min(static_cast<int32_t>(KC), numCommon - p0);
+                    PackB(kc, nc, B, ldb, transposeB, p0, j0, packedB.data());
+
+                    auto updateRows = [&, j0, nc, p0, kc](size_t task)
+                    {
+                        std::vector<Real> packedA(static_cast<size_t>(MC + MR) * KC);
+                        for (int32_t b = static_cast<int32_t>(task); b < numRowBlocks;
+                            b += static_cast<int32_t>(numTasks))
+                        {
+                            int32_t const i0 = b * MC;
+                            int32_t const mc = std::min(static_cast<int32_t>(MC), numRows - i0);
+                            PackA(mc, kc, A, lda, transposeA, i0, p0, packedA.data());
+                            for (int32_t i = 0; i < mc; i += MR)
+                            {
+                                for (int32_t j = 0; j < nc; j += NR)
+                                {
+                                    MicroKernel<Add>(std::min(static_cast<int32_t>(MR), mc - i),
+                                        std::min(static_cast<int32_t>(NR), nc - j), kc,
+                                        packedA.data() + static_cast<size_t>(i) * KC,
+                                        packedB.data() + static_cast<size_t>(j) * KC,
+                                        C + (j0 + j) + static_cast<size_t>(ldc) * (i0 + i), ldc);
+                                }
+                            }
+                        }
+                    };
+
+                    if (numTasks > 1)
+                    {
+                        TaskScheduler::GetDefault().ParallelFor(numTasks, updateRows);
+                    }
+                    else
+                    {
+                        updateRows(0);
+                    }
+                }
+            }
+        }
+
+        // Copy rows [i0,i0+mc) and columns [p0,p0+kc) of op(A) to strips
+        // of MR rows. Element (i,p) of a strip is at packed[p * MR + i].
+        // The rows of the last strip beyond mc are zero.
+        static void PackA(int32_t mc, int32_t kc, Real const* A, int32_t lda,
+            bool transposeA, int32_t i0, int32_t p0, Real* packed)
+        {
+            Real const zero = static_cast<Real>(0);
+            for (int32_t i = 0; i < mc; i += MR)
+            {
+                Real* strip = packed + static_cast<size_t>(i) * KC;
+                int32_t const mr = std::min(static_cast<int32_t>(MR), mc - i);
+                for (int32_t p = 0; p < kc; ++p)
+                {
+                    for (int32_t ii = 0; ii < MR; ++ii)
+                    {
+                        if (ii < mr)
+                        {
+                            int32_t const r = i0 + i + ii, c = p0 + p;
+                            strip[p * MR + ii] = (transposeA ?
+                                A[r + static_cast<size_t>(lda) * c] :
+                                A[c + static_cast<size_t>(lda) * r]);
+                        }
+                        else
+                        {
+                            strip[p * MR + ii] = zero;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Copy rows [p0,p0+kc) and columns [j0,j0+nc) of op(B) to strips
+        // of NR columns. Element (p,j) of a strip is at packed[p * NR + j].
+        // The columns of the last strip beyond nc are zero.
+        static void PackB(int32_t kc, int32_t nc, Real const* B, int32_t ldb,
+            bool transposeB, int32_t p0, int32_t j0, Real* packed)
+        {
+            Real const zero = static_cast<Real>(0);
+            for (int32_t j = 0; j < nc; j += NR)
+            {
+                Real* strip = packed + static_cast<size_t>(j) * KC;
+                int32_t const nr = std::min(static_cast<int32_t>(NR), nc - j);
+                for (int32_t p = 0; p < kc; ++p)
+                {
+                    for (int32_t jj = 0; jj < NR; ++jj)
+                    {
+                        if (jj < nr)
+                        {
+                            int32_t const r = p0 + p, c = j0 + j + jj;
+                            strip[p * NR + jj] = (transposeB ?
+                                B[r + static_cast<size_t>(ldb) * c] :
+                                B[c + static_cast<size_t>(ldb) * r]);
+                        }
+                        else
+                        {
+                            strip[p * NR + jj] = zero;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Update the mr-by-nr block of C at C[0], mr <= MR and nr <= NR,
+        // by kc terms of the packed strips.
+        template <bool Add>
+        static void MicroKernel(int32_t mr, int32_t nr, int32_t kc,
+            Real const* packedA, Real const* packedB, Real* C, int32_t ldc)
+        {
+            Real block[MR][NR];
+            for (int32_t i = 0; i < MR; ++i)
+            {
+                for (int32_t j = 0; j < NR; ++j)
+                {
+                    block[i][j] = (i < mr && j < nr ?
+                        C[j + static_cast<size_t>(ldc) * i] : static_cast<Real>(0));
+                }
+            }
+
+            for (int32_t p = 0; p < kc; ++p)
+            {
+                Real const* a = packedA + p * MR;
+                Real const* b = packedB + p * NR;
+                for (int32_t i = 0; i < MR; ++i)
+                {
+                    for (int32_t j = 0; j < NR; ++j)
+                    {
+                        if (Add)
+                        {
+                            block[i][j] += a[i] * b[j];
+                        }
+                        else
+                        {
+                            block[i][j] -= a[i] * b[j];
+                        }
+                    }
+                }
+            }
+
+            for (int32_t i = 0; i < mr; ++i)
+            {
+                for (int32_t j = 0; j < nr; ++j)
+                {
+                    C[j + static_cast<size_t>(ldc) * i] = block[i][j];
+                }
+            }
+        }
+    };
+}
@@ -8,8 +8,13 @@
 #pragma once
 
 #include <Mathematics/IntrAlignedBox3AlignedBox3.h>
-#include <Mathematics/EdgeKey.h>
-#include <set>
+#include <Mathematics/IndexPairSet.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 #include <vector>
 
 namespace gte
@@ -21,7 +26,10 @@ namespace gte
         // Construction.
         BoxManager(std::vector<AlignedBox3<Real>>& boxes)
             :
-            mBoxes(boxes)
+            mBoxes(boxes),
+            mMaxSwapsPerEndpoint(4),
+            mNumRebuilds(0),
+            mSwapped{}
         {
             Initialize();
         }
@@ -69,67 +77,12 @@ namespace gte
                 ++j;
             }
 
-            // Sort the box endpoints.
-            std::sort(mXEndpoints.begin(), mXEndpoints.end());
-            std::sort(mYEndpoints.begin(), mYEndpoints.end());
-            std::sort(mZEndpoints.begin(), mZEndpoints.end());
-
-            // Create the interval-to-endpoint lookup tables.
-            mXLookup.resize(endpSize);
-            mYLookup.resize(endpSize);
-            mZLookup.resize(endpSize);
-            for (int32_t j = 0; j < endpSize; ++j)
-            {
-                mXLookup[2 * static_cast<size_t>(mXEndpoints[j].index) + static_cast<size_t>(mXEndpoints[j].type)] = j;
-                mYLookup[2 * static_cast<size_t>(mYEndpoints[j].index) + static_cast<size_t>(mYEndpoints[j].type)] = j;
-                mZLookup[2 * static_cast<size_t>(mZEndpoints[j].index) + static_cast<size_t>(mZEndpoints[j].type)] = j;
-            }
-
-            // Active set of boxes (stored by index in array).
-            std::set<int32_t> active;
-
             // Set of overlapping boxes (stored by pairs of indices in
-            // array).
-            mOverlap.clear();
-
-            // Sweep through the endpoints to determine overlapping
-            // x-intervals.
-            for (int32_t i = 0; i < endpSize; ++i)
-            {
-                Endpoint const& endpoint = mXEndpoints[i];
-                int32_t index = endpoint.index;
-                if (endpoint.type == 0)  // an interval 'begin' value
-                {
-                    // In the 1D problem, the current interval overlaps with
-                    // all the active intervals.  In 3D we also need to check
-                    // for y-overlap and z-overlap.
-                    for (auto activeIndex : active)
-                    {
-                        // Rectangles activeIndex and index overlap in the
-                        // x-dimension.  Test for overlap in the y-dimension
-                        // and z-dimension.
-                        AlignedBox3<Real> const& b0 = mBoxes[activeIndex];
-                        AlignedBox3<Real> const& b1 = mBoxes[index];
-                        if (b0.max[1] >= b1.min[1] && b0.min[1] <= b1.max[1]
-                            && b0.max[2] >= b1.min[2] && b0.min[2] <= b1.max[2])
-                        {
-                            if (activeIndex < index)
-                            {
-                                mOverlap.insert(EdgeKey<false>(activeIndex, index));
-                            }
-                            else
-                            {
-                                mOverlap.insert(EdgeKey<false>(index, activeIndex));
-                            }
-                        }
-                    }
-                    active.insert(index);
-                }
-                else  // an interval 'end' value
-                {
-                    active.erase(index);
-                }
-            }
+            // array). The previous set is replaced, and the changes are
+            // reported by GetAddedOverlaps() and GetRemovedOverlaps().
+            mOverlap.BeginChanges();
+            Rebuild(0);
+            mOverlap.EndChanges();
         }
 
         // After the system is initialized, you can move the boxes using this
@@ -154,24 +107,163 @@ namespace gte
             box = mBoxes[i];
         }
 
+        // Move the boxes first <= i < first + numBoxes, where the extremes
+        // of box i are stored in the arrays at index i - first. This is
+        // equivalent to calling SetBox for each box, but the coordinates
+        // are read from separate arrays, which is convenient when the
+        // caller stores positions and radii as structures of arrays.
+        void SetBoxes(int32_t first, int32_t numBoxes,
+            Real const* xMin, Real const* yMin, Real const* zMin,
+            Real const* xMax, Real const* yMax, Real const* zMax)
+        {
+            LogAssert(first >= 0 && numBoxes >= 0 &&
+                static_cast<size_t>(first) + static_cast<size_t>(numBoxes) <= mBoxes.size(),
+                "Invalid range of boxes.");
+
+            for (int32_t k = 0; k < numBoxes; ++k)
+            {
+                size_t const i = static_cast<size_t>(first) + static_cast<size_t>(k);
+                AlignedBox3<Real>& box = mBoxes[i];
+                box.min = { xMin[k], yMin[k], zMin[k] };
+                box.max = { xMax[k], yMax[k], zMax[k] };
+                mXEndpoints[mXLookup[2 * i]].value = xMin[k];
+                mXEndpoints[mXLookup[2 * i + 1]].value = xMax[k];
+                mYEndpoints[mYLookup[2 * i]].value = yMin[k];
+                mYEndpoints[mYLookup[2 * i + 1]].value = yMax[k];
+                mZEndpoints[mZLookup[2 * i]].value = zMin[k];
+                mZEndpoints[mZLookup[2 * i + 1]].value = zMax[k];
+            }
+        }
+
         // When you are finished moving boxes, call this function to determine
         // the overlapping boxes.  An incremental update is applied to
         // determine the new set of overlapping boxes.
-        void Update()
+        //
+        // Set numThreads to 2 or larger to sort the three axes concurrently
+        // as tasks of TaskScheduler::GetDefault().  Each task records the
+        // pairs of boxes whose endpoints it swaps, and afterwards these pairs
+        // are tested for overlap and inserted into or erased from the overlap
+        // set.  The overlap set does not depend on numThreads.
+        //
+        // When the boxes have moved so far that the insertion sort of an axis
+        // exceeds GetMaxSwapsPerEndpoint() swaps per endpoint, the
+        // incremental update is abandoned and the endpoints are re-sorted
+        // with a radix sort and swept as in Initialize.  This bounds the cost
+        // of an update after a loss of coherence, for example when an
+        // explosion scatters the boxes.
+        void Update(size_t numThreads = 0)
+        {
+            size_t const maxSwaps = mMaxSwapsPerEndpoint * mXEndpoints.size();
+            bool sorted = true;
+            mOverlap.BeginChanges();
+            if (numThreads < 2)
+            {
+                sorted = InsertionSort(mXEndpoints, mXLookup, maxSwaps, nullptr)
+                    && InsertionSort(mYEndpoints, mYLookup, maxSwaps, nullptr)
+                    && InsertionSort(mZEndpoints, mZLookup, maxSwaps, nullptr);
+            }
+            else
+            {
+                std::array<std::vector<Endpoint>*, 3> const endpoints
+                {
+                    &mXEndpoints, &mYEndpoints, &mZEndpoints
+                };
+                std::array<std::vector<int32_t>*, 3> const lookups
+                {
+                    &mXLookup, &mYLookup, &mZLookup
+                };
+                std::array<bool, 3> axisSorted{};
+                TaskScheduler::GetDefault().ParallelFor(3,
+                    [this, &endpoints, &lookups, &axisSorted, maxSwaps](size_t d)
+                    {
+                        axisSorted[d] = InsertionSort(*endpoints[d], *lookups[d],
+                            maxSwaps, &mSwapped[d]);
+                    });
+
+                sorted = axisSorted[0] && axisSorted[1] && axisSorted[2];
+                if (sorted)
+                {
+                    // A pair can be recorded by several axes, but the
+                    // insertions and removals do not depend on the order or
+                    // on repetitions.
+                    TIQuery<Real, AlignedBox3<Real>, AlignedBox3<Real>> query;
+                    for (auto const& swapped : mSwapped)
+                    {
+                        for (auto const& key : swapped)
+                        {
+                            if (query(mBoxes[key.V[0]], mBoxes[key.V[1]]).intersect)
+                            {
+                                mOverlap.Insert(key.V[0], key.V[1]);
+                            }
+                            else
+                            {
+                                mOverlap.Erase(key.V[0], key.V[1]);
+                            }
+                        }
+                    }
+                }
+            }
+
+            if (!sorted)
+            {
+                Rebuild(numThreads);
+                ++mNumRebuilds;
+            }
+            mOverlap.EndChanges();
+        }
+
+        // The limit on the number of swaps of the insertion sort of an axis,
+        // as a multiple of the number of endpoints, beyond which Update
+        // re-sorts the endpoints.  The default is 4.
+        inline void SetMaxSwapsPerEndpoint(size_t maxSwapsPerEndpoint)
         {
-            InsertionSort(mXEndpoints, mXLookup);
-            InsertionSort(mYEndpoints, mYLookup);
-            InsertionSort(mZEndpoints, mZLookup);
+            mMaxSwapsPerEndpoint = maxSwapsPerEndpoint;
+        }
+
+        inline size_t GetMaxSwapsPerEndpoint() const
+        {
+            return mMaxSwapsPerEndpoint;
+        }
+
+        // The number of calls to Update that re-sorted the endpoints.
+        inline size_t GetNumRebuilds() const
+        {
+            return mNumRebuilds;
         }
 
         // If (i,j) is in the overlap set, then box i and box j are
         // overlapping.  The indices are those for the the input array.  The
-        // set elements (i,j) are stored so that i < j.
-        inline std::set<EdgeKey<false>> const& GetOverlap() const
+        // set elements (i,j) are stored so that i < j and are sorted
+        // lexicographically.  The sorted array is updated by Initialize and
+        // Update, by merging the previous array with the changes, so
+        // GetOverlap does not modify the manager and can be called
+        // concurrently between updates.
+        inline std::vector<EdgeKey<false>> const& GetOverlap() const
+        {
+            return mOverlap.GetSorted();
+        }
+
+        // The overlap set itself, for queries by Contains(i,j) and for
+        // visiting the pairs in an unspecified order by ForEach.
+        inline IndexPairSet const& GetOverlapSet() const
         {
             return mOverlap;
         }
 
+        // The pairs that started or stopped overlapping during the last call
+        // to Initialize or Update, sorted lexicographically.  A consumer that
+        // maintains its own state per pair can process these instead of
+        // rescanning the overlap set.
+        inline std::vector<EdgeKey<false>> const& GetAddedOverlaps() const
+        {
+            return mOverlap.GetAdded();
+        }
+
+        inline std::vector<EdgeKey<false>> const& GetRemovedOverlaps() const
+        {
+            return mOverlap.GetRemoved();
+        }
+
     private:
         class Endpoint
         {
@@ -195,15 +287,186 @@ namespace gte
             }
         };
 
-        void InsertionSort(std::vector<Endpoint>& endpoint, std::vector<int32_t>& lookup)
+        // Sort the endpoints of each axis, create the lookup tables and
+        // sweep through the x-endpoints to replace the overlap set.
+        void Rebuild(size_t numThreads)
         {
-            // Apply an insertion sort.  Under the assumption that the
-            // boxes have not changed much since the last call, the
-            // endpoints are nearly sorted.  The insertion sort should be very
-            // fast in this case.
+            std::array<std::vector<Endpoint>*, 3> const endpoints
+            {
+                &mXEndpoints, &mYEndpoints, &mZEndpoints
+            };
+            std::array<std::vector<int32_t>*, 3> const lookups
+            {
+                &mXLookup, &mYLookup, &mZLookup
+            };
+            auto sortAxis = [&endpoints, &lookups](size_t d)
+            {
+                std::vector<Endpoint>& endpoint = *endpoints[d];
+                std::vector<int32_t>& lookup = *lookups[d];
+                SortEndpoints(endpoint);
+
+                // Create the interval-to-endpoint lookup table.
+                int32_t const endpSize = static_cast<int32_t>(endpoint.size());
+                lookup.resize(endpoint.size());
+                for (int32_t j = 0; j < endpSize; ++j)
+                {
+                    lookup[2 * static_cast<size_t>(endpoint[j].index) + static_cast<size_t>(endpoint[j].type)] = j;
+                }
+            };
+
+            if (numThreads < 2)
+            {
+                for (size_t d = 0; d < 3; ++d)
+                {
+                    sortAxis(d);
+                }
+            }
+            else
+            {
+                TaskScheduler::GetDefault().ParallelFor(3, sortAxis);
+            }
+
+            int32_t const endpSize = static_cast<int32_t>(mXEndpoints.size());
+            // Active set of boxes (stored by index in array). The position
+            // of each active box in the array supports constant-time
+            // removal by moving the last active box to its position.
+            std::vector<int32_t> active{}, position(mBoxes.size());
+            active.reserve(mBoxes.size());
+
+            // Replace the set of overlapping boxes.
+            mOverlap.Clear();
+
+            // Sweep through the endpoints to determine overlapping
+            // x-intervals.
+            for (int32_t i = 0; i < endpSize; ++i)
+            {
+                Endpoint const& endpoint = mXEndpoints[i];
+                int32_t index = endpoint.index;
+                if (endpoint.type == 0)  // an interval 'begin' value
+                {
+                    // In the 1D problem, the current interval overlaps with
+                    // all the active intervals.  In 3D we also need to check
+                    // for y-overlap and z-overlap.
+                    for (auto activeIndex : active)
+                    {
+                        // Rectangles activeIndex and index overlap in the
+                        // x-dimension.  Test for overlap in the y-dimension
+                        // and z-dimension.
+                        AlignedBox3<Real> const& b0 = mBoxes[activeIndex];
+                        AlignedBox3<Real> const& b1 = mBoxes[index];
+                        if (b0.max[1] >= b1.min[1] && b0.min[1] <= b1.max[1]
+                            && b0.max[2] >= b1.min[2] && b0.min[2] <= b1.max[2])
+                        {
+                            mOverlap.Insert(activeIndex, index);
+                        }
+                    }
+                    position[index] = static_cast<int32_t>(active.size());
+                    active.push_back(index);
+                }
+                else  // an interval 'end' value
+                {
+                    int32_t const last = active.back();
+                    active[position[index]] = last;
+                    position[last] = position[index];
+                    active.pop_back();
+                }
+            }
+        }
+
+        // Sort the endpoints by value and, for equal values, with the
+        // interval minimum first.  The float and double values are sorted
+        // by a least-significant-digit radix sort of their bit patterns, 8
+        // bits per pass, after a stable partition by type.  The patterns
+        // are mapped so that their unsigned order is the order of the
+        // values: the sign bit is set for nonnegative values and all bits
+        // are flipped for negative values.  Other types use std::sort.
+        template <typename Dummy = Real>
+        static typename std::enable_if<!std::is_same<Dummy, float>::value
+            && !std::is_same<Dummy, double>::value, void>::type
+        SortEndpoints(std::vector<Endpoint>& endpoint)
+        {
+            std::sort(endpoint.begin(), endpoint.end());
+        }
+
+        template <typename Dummy = Real>
+        static typename std::enable_if<std::is_same<Dummy, float>::value
+            || std::is_same<Dummy, double>::value, void>::type
+        SortEndpoints(std::vector<Endpoint>& endpoint)
+        {
+            using UInt = typename std::conditional<sizeof(Real) == sizeof(uint32_t),
+                uint32_t, uint64_t>::type;
+            using Item = std::pair<UInt, Endpoint>;
+            UInt const signBit = static_cast<UInt>(1) << (8 * sizeof(UInt) - 1);
+            size_t const numEndpoints = endpoint.size();
+
+            size_t numMinima = 0;
+            for (auto const& e : endpoint)
+            {
+                numMinima += static_cast<size_t>(e.type == 0);
+            }
+
+            std::vector<Item> items(numEndpoints), buffer(numEndpoints);
+            std::array<size_t, 2> next{ 0, numMinima };
+            for (auto const& e : endpoint)
+            {
+                // Adding zero maps -0 to +0, which compare equal.
+                Real const value = e.value + static_cast<Real>(0);
+                UInt bits;
+                std::memcpy(&bits, &value, sizeof(UInt));
+                bits = ((bits & signBit) != 0 ? ~bits : (bits | signBit));
+                items[next[e.type]++] = std::make_pair(bits, e);
+            }
+
+            for (size_t shift = 0; shift < 8 * sizeof(UInt); shift += 8)
+            {
+                std::array<size_t, 257> offsets{};
+                for (auto const& item : items)
+                {
+                    ++offsets[((item.first >> shift) & 0xFF) + 1];
+                }
+                if (std::find(offsets.begin(), offsets.end(), numEndpoints) != offsets.end())
+                {
+                    // All the digits are equal, so the pass is skipped.
+                    continue;
+                }
+
+                for (size_t k = 1; k < offsets.size(); ++k)
+                {
+                    offsets[k] += offsets[k - 1];
+                }
+                for (auto const& item : items)
+                {
+                    buffer[offsets[(item.first >> shift) & 0xFF]++] = item;
+                }
+                std::swap(items, buffer);
+            }
+
+            for (size_t j = 0; j < numEndpoints; ++j)
+            {
+                endpoint[j] = items[j].second;
+            }
+        }
+
+        // Apply an insertion sort.  Under the assumption that the boxes have
+        // not changed much since the last call, the endpoints are nearly
+        // sorted.  The insertion sort should be very fast in this case.  The
+        // overlap set is updated at each swap when swapped is null;
+        // otherwise, the swapped pairs are stored in it and the overlap set
+        // is not accessed, so the axes can be sorted concurrently.  The
+        // return value is false when the sort was stopped after more than
+        // maxSwaps swaps, in which case the endpoints are not sorted but the
+        // lookup table is consistent with them.
+        bool InsertionSort(std::vector<Endpoint>& endpoint, std::vector<int32_t>& lookup,
+            size_t maxSwaps, std::vector<EdgeKey<false>>* swapped)
+        {
+            if (swapped)
+            {
+                swapped->clear();
+            }
 
             TIQuery<Real, AlignedBox3<Real>, AlignedBox3<Real>> query;
             int32_t endpSize = static_cast<int32_t>(endpoint.size());
+            size_t numSwaps = 0;
             for (int32_t j = 1; j < endpSize; ++j)
             {
                 Endpoint key = endpoint[j];
@@ -214,7 +477,14 @@ namespace gte
                     Endpoint e1 = endpoint[static_cast<size_t>(i) + 1];
 
                     // Update the overlap status.
-                    if (e0.type == 0)
+                    if (swapped)
+                    {
+                        if (e0.type != e1.type)
+                        {
+                            swapped->push_back(EdgeKey<false>(e0.index, e1.index));
+                        }
+                    }
+                    else if (e0.type == 0)
                     {
                         if (e1.type == 1)
                         {
@@ -229,7 +499,7 @@ namespace gte
                             // operation, so there is no real time savings in
                             // testing for existence first, then deleting if
                             // it does.
-                            mOverlap.erase(EdgeKey<false>(e0.index, e1.index));
+                            mOverlap.Erase(e0.index, e1.index);
                         }
                     }
                     else
@@ -244,7 +514,7 @@ namespace gte
                             // and then insert.
                             if (query(mBoxes[e0.index], mBoxes[e1.index]).intersect)
                             {
-                                mOverlap.insert(EdgeKey<false>(e0.index, e1.index));
+                                mOverlap.Insert(e0.index, e1.index);
                             }
                         }
                     }
@@ -255,15 +525,22 @@ namespace gte
                     lookup[2 * static_cast<size_t>(e1.index) + static_cast<size_t>(e1.type)] = i;
                     lookup[2 * static_cast<size_t>(e0.index) + static_cast<size_t>(e0.type)] = i + 1;
                     --i;
+                    ++numSwaps;
                 }
                 endpoint[static_cast<size_t>(i) + 1] = key;
                 lookup[2 * static_cast<size_t>(key.index) + static_cast<size_t>(key.type)] = i + 1;
+
+                if (numSwaps > maxSwaps)
+                {
+                    return false;
+                }
             }
+            return true;
         }
 
         std::vector<AlignedBox3<Real>>& mBoxes;
         std::vector<Endpoint> mXEndpoints, mYEndpoints, mZEndpoints;
-        std::set<EdgeKey<false>> mOverlap;
+        IndexPairSet mOverlap;
 
         // The intervals are indexed 0 <= i < n.  The endpoint array has 2*n
         // entries.  The original 2*n interval values are ordered as
@@ -276,5 +553,11 @@ namespace gte
         // endpoint array.  The value mLookup[2*i+1] is the index of e[i]
         // in the endpoint array.
         std::vector<int32_t> mXLookup, mYLookup, mZLookup;
+
+        // Support for Update.  The swapped pairs of each axis are stored
+        // when the axes are sorted concurrently.
+        size_t mMaxSwapsPerEndpoint;
+        size_t mNumRebuilds;
+        std::array<std::vector<EdgeKey<false>>, 3> mSwapped;
     };
 }
@@ -0,0 +1,244 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A sparse matrix in compressed sparse row (CSR) format. The nonzero
+// elements of row r are values[k] at columns[k] for rowOffsets[r] <= k <
+// rowOffsets[r+1], with the columns of a row in increasing order. The
+// matrix is created from a list of (row,column,value) triplets in any order;
+// the values of repeated locations are added. For a symmetric matrix used
+// by LinearSystem::SolveSymmetricCG, both (r,c) and (c,r) must be stored.
+//
+// Compared to LinearSystem::SparseMatrix, a std::map with one node per
+// element, the storage is 1 index and 1 value per element plus 1 offset per
+// row, and the product with a vector reads the elements sequentially.
+
+namespace gte
+{
+    template <typename Real>
+    class CSRMatrix
+    {
+    public:
+        struct Triplet
+        {
+            int32_t row, column;
+            Real value;
+        };
+
+        CSRMatrix()
+            :
+            mNumRows(0),
+            mNumCols(0),
+            mRowOffsets(1, 0),
+            mColumns{},
+            mValues{}
+        {
+        }
+
+        CSRMatrix(int32_t numRows, int32_t numCols, std::vector<Triplet> const& triplets)
+            :
+            mNumRows(0),
+            mNumCols(0),
+            mRowOffsets(1, 0),
+            mColumns{},
+            mValues{}
+        {
+            Create(numRows, numCols, triplets);
+        }
+
+        // Replace the matrix. The arrays keep their capacity, so a matrix
+        // with the same sparsity pattern can be recreated each time step
+        // without allocations.
+        void Create(int32_t numRows, int32_t numCols, std::vector<Triplet> const& triplets)
+        {
+            LogAssert(numRows >= 0 && numCols >= 0, "Invalid size.");
+            mNumRows = numRows;
+            mNumCols = numCols;
+
+            // Sort the triplets by rows with a counting sort.
+            mRowOffsets.assign(static_cast<size_t>(numRows) + 1, 0);
+            for (auto const& triplet : triplets)
+            {
+                LogAssert(0 <= triplet.row && triplet.row < numRows
+                    && 0 <= triplet.column && triplet.column < numCols,
+                    "Invalid location.");
+                ++mRowOffsets[static_cast<size_t>(triplet.row) + 1];
+            }
+            for (int32_t r = 0; r < numRows; ++r)
+            {
+                mRowOffsets[static_cast<size_t>(r) + 1] += mRowOffsets[r];
+            }
+
+            mColumns.resize(triplets.size());
+            mValues.resize(triplets.size());
+            std::vector<size_t> next(mRowOffsets.begin(), mRowOffsets.end() - 1);
+            for (auto const& triplet : triplets)
+            {
+                size_t const k = next[triplet.row]++;
+                mColumns[k] = triplet.column;
+                mValues[k] = triplet.value;
+            }
+
+            // Sort each row by columns and add the values of repeated
+            // columns, compacting the rows in place.
+            std::vector<std::pair<int32_t, Real>> row{};
+            size_t numElements = 0;
+            for (int32_t r = 0; r < numRows; ++r)
+            {
+                size_t const kmin = mRowOffsets[r], kmax = mRowOffsets[static_cast<size_t>(r) + 1];
+                row.clear();
+                for (size_t k = kmin; k < kmax; ++k)
+                {
+                    row.push_back(std::make_pair(mColumns[k], mValues[k]));
+                }
+                std::stable_sort(row.begin(), row.end(),
+                    [](std::pair<int32_t, Real> const& element0,
+                        std::pair<int32_t, Real> const& element1)
+                    {
+                        return element0.first < element1.first;
+                    });
+
+                mRowOffsets[r] = numElements;
+                for (size_t i = 0; i < row.size(); ++i)
+                {
+                    if (i > 0 && row[i].first == row[i - 1].first)
+                    {
+                        mValues[numElements - 1] += row[i].second;
+                    }
+                    else
+                    {
+                        mColumns[numElements] = row[i].first;
+                        mValues[numElements] = row[i].second;
+                        ++numElements;
+                    }
+                }
+            }
+            mRowOffsets[numRows] = numElements;
+            mColumns.resize(numElements);
+            mValues.resize(numElements);
+        }
+
+        // Member access.
+        inline int32_t GetNumRows() const
+        {
+            return mNumRows;
+        }
+
+        inline int32_t GetNumCols() const
+        {
+            return mNumCols;
+        }
+
+        inline size_t GetNumElements() const
+        {
+            return mValues.size();
+        }
+
+        inline std::vector<size_t> const& GetRowOffsets() const
+        {
+            return mRowOffsets;
+        }
+
+        inline std::vector<int32_t> const& GetColumns() const
+        {
+            return mColumns;
+        }
+
+        inline std::vector<Real> const& GetValues() const
+        {
+            return mValues;
+        }
+
+        // The values can be modified when the sparsity pattern does not
+        // change, for example to update the matrix of an implicit solver.
+        inline std::vector<Real>& GetValues()
+        {
+            return mValues;
+        }
+
+        // The element at (r,c), which is zero when it is not stored.
+        Real operator()(int32_t r, int32_t c) const
+        {
+            auto first = mColumns.begin() + mRowOffsets[r];
+            auto last = mColumns.begin() + mRowOffsets[static_cast<size_t>(r) + 1];
+            auto iter = std::lower_bound(first, last, c);
+            if (iter != last && *iter == c)
+            {
+                return mValues[static_cast<size_t>(iter - mColumns.begin())];
+            }
+            return static_cast<Real>(0);
+        }
+
+        // Compute Y = A*X, where X has numCols elements and Y has numRows
+        // elements. Set numThreads to 2 or larger to compute blocks of rows
+        // as tasks of TaskScheduler::GetDefault(). The result does not
+        // depend on numThreads.
+        void Multiply(Real const* X, Real* Y, size_t numThreads = 0) const
+        {
+            ForRows(numThreads, [this, X, Y](int32_t rmin, int32_t rsup)
+            {
+                for (int32_t r = rmin; r < rsup; ++r)
+                {
+                    Real sum = static_cast<Real>(0);
+                    for (size_t k = mRowOffsets[r]; k < mRowOffsets[static_cast<size_t>(r) + 1]; ++k)
+                    {
+                        sum += mValues[k] * X[mColumns[k]];
+                    }
+                    Y[r] = sum;
+                }
+            });
+        }
+
+        // Execute function(rmin, rsup) for consecutive blocks of rows that
+        // partition [0,numRows), as tasks when numThreads is 2 or larger.
+        // The blocks have about the same numbers of elements.
+        template <typename Function>
+        void ForRows(size_t numThreads, Function const& function) const
+        {
+            size_t const numTasks = std::max(std::min(numThreads,
+                static_cast<size_t>(mNumRows)), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                function(0, mNumRows);
+                return;
+            }
+
+            std::vector<int32_t> bounds(numTasks + 1);
+            for (size_t i = 0; i <= numTasks; ++i)
+            {
+                size_t const target = i * mValues.size() / numTasks;
+                bounds[i] = static_cast<int32_t>(std::lower_bound(mRowOffsets.begin(),
+                    mRowOffsets.end(), target) - mRowOffsets.begin());
+            }
+            bounds[0] = 0;
+            bounds[numTasks] = mNumRows;
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [&function, &bounds](size_t i)
+                {
+                    if (bounds[i] < bounds[i + 1])
+                    {
+                        function(bounds[i], bounds[i + 1]);
+                    }
+                });
+        }
+
+    private:
+        int32_t mNumRows, mNumCols;
+        std::vector<size_t> mRowOffsets;
+        std::vector<int32_t> mColumns;
+        std::vector<Real> mValues;
+    };
+}
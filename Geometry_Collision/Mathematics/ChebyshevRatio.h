@@ -3,6 +3,8 @@
 #pragma once
 
 #include "Math.h"
+#include <algorithm>
+#include <cstddef>
 
 // Let f(t,A) = sin(t*A)/sin(A).  The slerp of quaternions q0 and q1 is
 //   slerp(t,q0,q1) = f(1-t,A)*q0 + f(t,A)*q1.
@@ -69,6 +71,73 @@ namespace Vector_GM
         {
             static_assert(1 <= N && N <= 16, "Invalid degree.");
 
+            Real a[16], b[16];
+            GetCoefficients<N>(a, b);
+
+            Real term0 = (Real)1 - t, term1 = t;
+            Real sqr0 = term0 * term0, sqr1 = term1 * term1;
+            f0 = term0;
+            f1 = term1;
+            for (int32_t i = 0; i < N; ++i)
+            {
+                term0 *= (b[i] - a[i] * sqr0) * y;
+                term1 *= (b[i] - a[i] * sqr1) * y;
+                f0 += term0;
+                f1 += term1;
+            }
+        }
+
+        // GetEstimate for numValues pairs (t[j],y[j]). The loop over the
+        // degree is outside the loop over the pairs, so the compiler
+        // evaluates several pairs per instruction. The results are those of
+        // GetEstimate.
+        template <int32_t N>
+        static void GetEstimates(size_t numValues, Real const* t, Real const* y,
+            Real* f0, Real* f1)
+        {
+            static_assert(1 <= N && N <= 16, "Invalid degree.");
+
+            Real a[16], b[16];
+            GetCoefficients<N>(a, b);
+
+            size_t constexpr blockSize = 64;
+            Real term0[blockSize], term1[blockSize], sqr0[blockSize], sqr1[blockSize];
+            for (size_t jmin = 0; jmin < numValues; jmin += blockSize)
+            {
+                size_t const numBlock = std::min(blockSize, numValues - jmin);
+                Real const* tBlock = t + jmin;
+                Real const* yBlock = y + jmin;
+                Real* f0Block = f0 + jmin;
+                Real* f1Block = f1 + jmin;
+
+                for (size_t j = 0; j < numBlock; ++j)
+                {
+                    term0[j] = (Real)1 - tBlock[j];
+                    term1[j] = tBlock[j];
+                    sqr0[j] = term0[j] * term0[j];
+                    sqr1[j] = term1[j] * term1[j];
+                    f0Block[j] = term0[j];
+                    f1Block[j] = term1[j];
+                }
+
+                for (int32_t i = 0; i < N; ++i)
+                {
+                    for (size_t j = 0; j < numBlock; ++j)
+                    {
+                        term0[j] *= (b[i] - a[i] * sqr0[j]) * yBlock[j];
+                        term1[j] *= (b[i] - a[i] * sqr1[j]) * yBlock[j];
+                        f0Block[j] += term0[j];
+                        f1Block[j] += term1[j];
+                    }
+                }
+            }
+        }
+
+    private:
+        // The coefficients a[0..N-1] and b[0..N-1] of GetEstimate.
+        template <int32_t N>
+        static void GetCoefficients(Real* a, Real* b)
+        {
             // The ASM output shows that the constants/ in these arrays are
             // loaded to XMM registers as literal values, and only those
             // constants required for the specified degree D are loaded.
@@ -94,7 +163,7 @@ namespace Vector_GM
                 (Real)1.94508125972497303
             };
 
-            Real const a[16] =
+            Real const aValues[16] =
             {
                 (N != 1 ? (Real)1 : onePlusMu[0]) / ((Real)1 * (Real)3),
                 (N != 2 ? (Real)1 : onePlusMu[1]) / ((Real)2 * (Real)5),
@@ -114,7 +183,7 @@ namespace Vector_GM
                 (N != 16 ? (Real)1 : onePlusMu[15]) / ((Real)16 * (Real)33)
             };
 
-            Real const b[16] =
+            Real const bValues[16] =
             {
                 (N != 1 ? (Real)1 : onePlusMu[0]) * (Real)1 / (Real)3,
                 (N != 2 ? (Real)1 : onePlusMu[1]) * (Real)2 / (Real)5,
@@ -134,16 +203,10 @@ namespace Vector_GM
                 (N != 16 ? (Real)1 : onePlusMu[15]) * (Real)16 / (Real)33
             };
 
-            Real term0 = (Real)1 - t, term1 = t;
-            Real sqr0 = term0 * term0, sqr1 = term1 * term1;
-            f0 = term0;
-            f1 = term1;
             for (int32_t i = 0; i < N; ++i)
             {
-                term0 *= (b[i] - a[i] * sqr0) * y;
-                term1 *= (b[i] - a[i] * sqr1) * y;
-                f0 += term0;
-                f1 += term1;
+                a[i] = aValues[i];
+                b[i] = bValues[i];
             }
         }
     };
@@ -9,6 +9,7 @@
 
 #include <Mathematics/Matrix.h>
 #include <Mathematics/GMatrix.h>
+#include <vector>
 
 namespace gte
 {
@@ -112,32 +113,44 @@ namespace gte
         // On input, A is symmetric.  Only the lower-triangular portion is
         // modified.  On output, the lower-triangular portion is L where
         // A = L * L^T.
-        bool Factor(GMatrix<Real>& A)
+        //
+        // The factorization is that of BlockedMatrixKernels::FactorCholesky,
+        // which has the same floating-point operations as the unblocked
+        // loops
+        //   A(c,c) = sqrt(A(c,c)); A(r,c) /= A(c,c), r > c;
+        //   A(r,k) -= A(r,c) * A(k,c), r >= k > c; c = 0,1,...
+        // Set numThreads to 2 or larger to update the trailing blocks of
+        // large matrices as tasks of TaskScheduler::GetDefault().
+        bool Factor(GMatrix<Real>& A, size_t numThreads = 0)
         {
             if (A.GetNumRows() == N && A.GetNumCols() == N)
             {
-                for (int32_t c = 0; c < N; ++c)
+#if defined(GTE_USE_ROW_MAJOR)
+                return BlockedMatrixKernels<Real>::FactorCholesky(N, &A[0], N, numThreads);
+#else
+                // The lower triangle of column-major storage is the upper
+                // triangle of the row-major kernel, so factor a row-major
+                // copy of the lower triangle.
+                std::vector<Real> lower(static_cast<size_t>(N) * static_cast<size_t>(N));
+                for (int32_t r = 0; r < N; ++r)
                 {
-                    if (A(c, c) <= (Real)0)
+                    for (int32_t c = 0; c <= r; ++c)
                     {
-                        return false;
-                    }
-                    A(c, c) = std::sqrt(A(c, c));
-
-                    for (int32_t r = c + 1; r < N; ++r)
-                    {
-                        A(r, c) /= A(c, c);
+                        lower[c + static_cast<size_t>(N) * r] = A(r, c);
                     }
+                }
 
-                    for (int32_t k = c + 1; k < N; ++k)
+                bool const factored = BlockedMatrixKernels<Real>::FactorCholesky(
+                    N, lower.data(), N, numThreads);
+                for (int32_t r = 0; r < N; ++r)
+                {
+                    for (int32_t c = 0; c <= r; ++c)
                     {
-                        for (int32_t r = k; r < N; ++r)
-                        {
-                            A(r, k) -= A(r, c) * A(k, c);
-                        }
+                        A(r, c) = lower[c + static_cast<size_t>(N) * r];
                     }
                 }
-                return true;
+                return factored;
+#endif
             }
             LogError("Matrix must be square.");
         }
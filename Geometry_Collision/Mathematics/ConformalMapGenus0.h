@@ -47,9 +47,14 @@ namespace gte
 
         // The returned 'bool' value is 'true' whenever the conjugate gradient
         // algorithm converged.  Even if it did not, the results might still
-        // be acceptable.
+        // be acceptable.  The sparse system is stored in a CSRMatrix and
+        // solved with the incomplete Cholesky preconditioner, which is what
+        // makes meshes with millions of vertices practical.  Set numThreads
+        // to 2 or larger to compute the vector operations of the solver as
+        // tasks of TaskScheduler::GetDefault().
         bool operator()(int32_t numPositions, Vector3<Real> const* positions,
-            int32_t numTriangles, int32_t const* indices, int32_t punctureTriangle)
+            int32_t numTriangles, int32_t const* indices, int32_t punctureTriangle,
+            size_t numThreads = 0)
         {
             bool converged = true;
             mPlaneCoordinates.resize(numPositions);
@@ -68,8 +73,11 @@ namespace gte
             }
             auto const& emap = graph.GetEdges();
 
-            // Construct the nondiagonal entries of the sparse matrix A.
-            typename LinearSystem<Real>::SparseMatrix A;
+            // Construct the nondiagonal entries of the sparse matrix A, both
+            // (v0,v1) and (v1,v0), and accumulate the diagonal entries.
+            std::vector<typename CSRMatrix<Real>::Triplet> triplets{};
+            triplets.reserve(2 * emap.size() + static_cast<size_t>(numPositions));
+            std::vector<Real> tmp(numPositions, (Real)0);
             int32_t v0, v1, v2, i;
             Vector3<Real> E0, E1;
             Real value;
@@ -95,24 +103,21 @@ namespace gte
                 }
 
                 value *= -(Real)0.5;
-
-                std::array<int32_t, 2> lookup = { v0, v1 };
-                A[lookup] = value;
+                triplets.push_back({ v0, v1, value });
+                triplets.push_back({ v1, v0, value });
+                tmp[v0] -= value;
+                tmp[v1] -= value;
             }
 
             // Construct the diagonal entries of the sparse matrix A.
-            std::vector<Real> tmp(numPositions, (Real)0);
-            for (auto const& element : A)
-            {
-                tmp[element.first[0]] -= element.second;
-                tmp[element.first[1]] -= element.second;
-            }
             for (i = 0; i < numPositions; ++i)
             {
-                std::array<int32_t, 2> lookup = { i, i };
-                A[lookup] = tmp[i];
+                triplets.push_back({ i, i, tmp[i] });
             }
-            LogAssert(static_cast<size_t>(numPositions) + emap.size() == A.size(), "Mismatched sizes.");
+            CSRMatrix<Real> A(numPositions, numPositions, triplets);
+            LogAssert(static_cast<size_t>(numPositions) + 2 * emap.size() == A.GetNumElements(), "Mismatched sizes.");
+            triplets.clear();
+            triplets.shrink_to_fit();
 
             // Construct the sparse column vector B.
             currentIndex = &indices[3 * punctureTriangle];
@@ -139,15 +144,20 @@ namespace gte
             Real im2 = -len10 * invLenNormal;
 
             // Solve the sparse system for the real parts.
-            uint32_t const maxIterations = 1024;
+            // The number of iterations of the preconditioned solver grows
+            // like the square root of the number of vertices.
+            uint32_t const maxIterations = std::max(1024u, static_cast<uint32_t>(
+                8.0 * std::sqrt(static_cast<double>(numPositions))));
             Real const tolerance = 1e-06f;
             std::fill(tmp.begin(), tmp.end(), (Real)0);
             tmp[v0] = re0;
             tmp[v1] = re1;
             tmp[v2] = re2;
             std::vector<Real> result(numPositions);
-            uint32_t iterations = LinearSystem<Real>().SolveSymmetricCG(
-                numPositions, A, tmp.data(), result.data(), maxIterations, tolerance);
+            auto const preconditioner = LinearSystem<Real>::Preconditioner::IC0;
+            uint32_t iterations = LinearSystem<Real>().SolveSymmetricCG(A,
+                tmp.data(), result.data(), maxIterations, tolerance,
+                preconditioner, false, numThreads);
             if (iterations >= maxIterations)
             {
                 converged = false;
@@ -162,8 +172,9 @@ namespace gte
             tmp[v0] = -im0;
             tmp[v1] = -im1;
             tmp[v2] = -im2;
-            iterations = LinearSystem<Real>().SolveSymmetricCG(numPositions, A,
-                tmp.data(), result.data(), maxIterations, tolerance);
+            iterations = LinearSystem<Real>().SolveSymmetricCG(A,
+                tmp.data(), result.data(), maxIterations, tolerance,
+                preconditioner, false, numThreads);
             if (iterations >= maxIterations)
             {
                 converged = false;
@@ -697,6 +697,21 @@ namespace gte
             partitionedEdge.back() = partition.back()[1];
         }
 
+        // Insert a batch of constrained edges, such as the breaklines of a
+        // terrain chunk. The edges are inserted in the input order, because
+        // the retriangulation for an edge can change the partition of an
+        // edge that overlaps it. On return, partitionedEdges[i] is the
+        // partition of edges[i].
+        void Insert(std::vector<std::array<int32_t, 2>> const& edges,
+            std::vector<std::vector<int32_t>>& partitionedEdges)
+        {
+            partitionedEdges.resize(edges.size());
+            for (size_t i = 0; i < edges.size(); ++i)
+            {
+                Insert(edges[i], partitionedEdges[i]);
+            }
+        }
+
         // All edges inserted via the Insert(...) call are stored for use
         // by the caller. If any edge passed to Insert(...) is partitioned
         // into subedges, the subedges are stored but not the original edge.
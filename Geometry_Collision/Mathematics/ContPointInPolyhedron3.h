@@ -29,6 +29,11 @@
 // Whichever result occurs N+1 or more times is the "winner".  The input
 // rayQuantity is 2*N+1.  The input array Direction must have rayQuantity
 // elements.  If you are feeling lucky, choose rayQuantity to be 1.
+//
+// Each query tests the ray against every face.  For many queries against a
+// closed triangle mesh, for example to voxelize it, use PointInTriangleMesh3
+// in ContPointInTriangleMesh3.h, which stores the triangles in a bounding
+// volume hierarchy and needs only one ray per query.
 
 namespace gte
 {
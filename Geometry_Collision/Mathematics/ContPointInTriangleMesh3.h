@@ -0,0 +1,515 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Point-in-polyhedron queries for a closed triangle mesh, prepared for many
+// queries. The triangles are stored in a bounding volume hierarchy (BVH) of
+// axis-aligned boxes that is built once by the constructor. A query casts a
+// ray from the point in the +x direction and counts the triangles that it
+// crosses; the point is inside when the count is odd. The BVH limits the
+// triangles tested to those whose boxes contain the ray.
+//
+// The crossings are computed from the projections of the triangles onto
+// the yz-plane. The ray is treated as if its origin were moved by the
+// infinitesimal (0,e,e^2), so it never passes exactly through a vertex or
+// an edge of a projected triangle, and a ray that hits a shared edge in
+// floating-point arithmetic is counted for exactly one of the triangles
+// sharing it. This is why a single ray suffices, unlike PointInPolyhedron3
+// that votes over several random rays. The mesh must be closed (every edge
+// shared by an even number of triangles, with the same vertex indices in
+// each), but the triangles need not be consistently oriented. A point on
+// the surface is classified as inside or outside arbitrarily.
+//
+// The batch Contains processes the points in packets of 8 that traverse the
+// BVH together, which pays off when consecutive points are close to each
+// other and most when they share their rays, as along the rows of a grid. Voxelize classifies the points of a regular grid by casting one
+// ray per row of the grid and filling the row between the crossings, which
+// is the fastest way to classify a grid.
+
+namespace gte
+{
+    template <typename Real>
+    class PointInTriangleMesh3
+    {
+    public:
+        // The triangles are triples of indices into the points[] array.
+        // The points are copied, so the arrays need not persist.
+        PointInTriangleMesh3(int32_t numPoints, Vector3<Real> const* points,
+            int32_t numTriangles, std::array<int32_t, 3> const* triangles)
+            :
+            mTriangles{},
+            mNodes{}
+        {
+            LogAssert(numPoints > 0 && points != nullptr && numTriangles > 0
+                && triangles != nullptr, "Invalid input.");
+
+            mTriangles.resize(static_cast<size_t>(numTriangles));
+            for (size_t t = 0; t < mTriangles.size(); ++t)
+            {
+                Triangle& triangle = mTriangles[t];
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    int32_t const index = triangles[t][j];
+                    LogAssert(0 <= index && index < numPoints, "Invalid index.");
+                    triangle.index[j] = index;
+                    triangle.vertex[j] = points[index];
+                }
+            }
+
+            mNodes.reserve(2 * mTriangles.size() / msMaxLeafSize + 1);
+            BuildNode(0, static_cast<int32_t>(mTriangles.size()));
+        }
+
+        // Test whether a point is inside the mesh.
+        bool Contains(Vector3<Real> const& p) const
+        {
+            std::array<int32_t, msMaxStackSize> stack{};
+            int32_t numStack = 0;
+            stack[numStack++] = 0;
+            bool odd = false;
+            while (numStack > 0)
+            {
+                int32_t const nodeIndex = stack[--numStack];
+                Node const& node = mNodes[nodeIndex];
+                if (node.max[0] < p[0]
+                    || p[1] < node.min[1] || p[1] > node.max[1]
+                    || p[2] < node.min[2] || p[2] > node.max[2])
+                {
+                    continue;
+                }
+
+                if (node.count > 0)
+                {
+                    for (int32_t t = node.offset; t < node.offset + node.count; ++t)
+                    {
+                        Real x;
+                        if (Crosses(mTriangles[t], p[1], p[2], x) && x > p[0])
+                        {
+                            odd = !odd;
+                        }
+                    }
+                }
+                else
+                {
+                    stack[numStack++] = node.offset;
+                    stack[numStack++] = nodeIndex + 1;
+                }
+            }
+            return odd;
+        }
+
+        // Test numQueries points, storing 1 in inside[i] when points[i] is
+        // inside the mesh and 0 otherwise. The results are the same as those
+        // of the single-point Contains. Set numThreads to 2 or larger to
+        // process blocks of points as tasks of TaskScheduler::GetDefault().
+        void Contains(size_t numQueries, Vector3<Real> const* points,
+            uint8_t* inside, size_t numThreads = 0) const
+        {
+            size_t const packetSize = msPacketSize;
+            size_t const numPackets = (numQueries + packetSize - 1) / packetSize;
+            ForBlocks(numPackets, numThreads, [this, numQueries, points, inside, packetSize](size_t pmin, size_t psup)
+            {
+                for (size_t packet = pmin; packet < psup; ++packet)
+                {
+                    size_t const first = packet * packetSize;
+                    size_t const numRays = std::min(packetSize, numQueries - first);
+                    ContainsPacket(numRays, points + first, inside + first);
+                }
+            });
+        }
+
+        // Classify the points of a regular grid. The grid points are
+        // regionMin + (regionMax - regionMin) * (x, y, z) / (bound - 1),
+        // componentwise, for 0 <= x < bound[0] and similarly for y and z,
+        // and each bound must be at least 2. The classification of point
+        // (x,y,z) is stored in grid[x + bound[0] * (y + bound[1] * z)], 1
+        // when inside and 0 when outside, the same as by Contains. Set
+        // numThreads to 2 or larger to process blocks of rows as tasks of
+        // TaskScheduler::GetDefault().
+        void Voxelize(size_t numThreads, std::array<Real, 3> const& regionMin,
+            std::array<Real, 3> const& regionMax, std::array<size_t, 3> const& bound,
+            std::vector<uint8_t>& grid) const
+        {
+            LogAssert(bound[0] >= 2 && bound[1] >= 2 && bound[2] >= 2, "Invalid bound.");
+
+            std::array<Real, 3> spacing{};
+            for (size_t d = 0; d < 3; ++d)
+            {
+                spacing[d] = (regionMax[d] - regionMin[d]) / static_cast<Real>(bound[d] - 1);
+            }
+
+            grid.resize(bound[0] * bound[1] * bound[2]);
+            size_t const numRows = bound[1] * bound[2];
+            ForBlocks(numRows, numThreads, [this, &regionMin, &bound, &spacing, &grid](size_t rmin, size_t rsup)
+            {
+                std::vector<Real> crossings{};
+                for (size_t row = rmin; row < rsup; ++row)
+                {
+                    size_t const y = row % bound[1], z = row / bound[1];
+                    Real const py = regionMin[1] + spacing[1] * static_cast<Real>(y);
+                    Real const pz = regionMin[2] + spacing[2] * static_cast<Real>(z);
+
+                    // A crossing to the left of the region is not to the
+                    // right of any grid point, so it is ignored.
+                    crossings.clear();
+                    GetCrossings(py, pz, regionMin[0], crossings);
+                    std::sort(crossings.begin(), crossings.end());
+
+                    // A grid point is inside when the number of crossings
+                    // strictly to its right is odd.
+                    uint8_t* output = &grid[bound[0] * row];
+                    size_t numLeft = 0;
+                    for (size_t x = 0; x < bound[0]; ++x)
+                    {
+                        Real const px = regionMin[0] + spacing[0] * static_cast<Real>(x);
+                        while (numLeft < crossings.size() && crossings[numLeft] <= px)
+                        {
+                            ++numLeft;
+                        }
+                        output[x] = static_cast<uint8_t>((crossings.size() - numLeft) & 1);
+                    }
+                }
+            });
+        }
+
+        inline size_t GetNumTriangles() const
+        {
+            return mTriangles.size();
+        }
+
+        inline size_t GetNumNodes() const
+        {
+            return mNodes.size();
+        }
+
+    private:
+        struct Triangle
+        {
+            std::array<Vector3<Real>, 3> vertex;
+            std::array<int32_t, 3> index;
+        };
+
+        // A leaf has count > 0 and stores the triangles offset <= t <
+        // offset + count. An interior node has count = 0, its first child
+        // immediately follows it and its second child is at offset.
+        struct Node
+        {
+            std::array<Real, 3> min, max;
+            int32_t offset, count;
+        };
+
+        static size_t constexpr msPacketSize = 8;
+        static int32_t constexpr msMaxLeafSize = 4;
+        static size_t constexpr msMaxStackSize = 64;
+
+        // Build the subtree for the triangles [tmin,tsup) by splitting them
+        // at the median of their centroids along the longest axis of the
+        // bounding box of the centroids. The depth is at most
+        // log2(numTriangles), which bounds the traversal stacks.
+        void BuildNode(int32_t tmin, int32_t tsup)
+        {
+            size_t const nodeIndex = mNodes.size();
+            mNodes.emplace_back();
+            Node node{};
+            Real const maxReal = std::numeric_limits<Real>::max();
+            node.min = { maxReal, maxReal, maxReal };
+            node.max = { -maxReal, -maxReal, -maxReal };
+            std::array<Real, 3> cmin = node.min, cmax = node.max;
+            for (int32_t t = tmin; t < tsup; ++t)
+            {
+                Triangle const& triangle = mTriangles[t];
+                for (size_t d = 0; d < 3; ++d)
+                {
+                    Real const c = GetCentroid(triangle, d);
+                    cmin[d] = std::min(cmin[d], c);
+                    cmax[d] = std::max(cmax[d], c);
+                    for (size_t j = 0; j < 3; ++j)
+                    {
+                        node.min[d] = std::min(node.min[d], triangle.vertex[j][d]);
+                        node.max[d] = std::max(node.max[d], triangle.vertex[j][d]);
+                    }
+                }
+            }
+
+            if (tsup - tmin <= msMaxLeafSize)
+            {
+                node.offset = tmin;
+                node.count = tsup - tmin;
+                mNodes[nodeIndex] = node;
+                return;
+            }
+
+            size_t axis = 0;
+            for (size_t d = 1; d < 3; ++d)
+            {
+                if (cmax[d] - cmin[d] > cmax[axis] - cmin[axis])
+                {
+                    axis = d;
+                }
+            }
+
+            int32_t const tmid = tmin + (tsup - tmin) / 2;
+            std::nth_element(mTriangles.begin() + tmin, mTriangles.begin() + tmid,
+                mTriangles.begin() + tsup,
+                [axis](Triangle const& triangle0, Triangle const& triangle1)
+                {
+                    return GetCentroid(triangle0, axis) < GetCentroid(triangle1, axis);
+                });
+
+            BuildNode(tmin, tmid);
+            node.offset = static_cast<int32_t>(mNodes.size());
+            node.count = 0;
+            BuildNode(tmid, tsup);
+            mNodes[nodeIndex] = node;
+        }
+
+        static inline Real GetCentroid(Triangle const& triangle, size_t d)
+        {
+            return triangle.vertex[0][d] + triangle.vertex[1][d] + triangle.vertex[2][d];
+        }
+
+        // The sign of the edge function of the edge <v0,v1> of a triangle at
+        // the yz-point (py,pz) moved by the infinitesimal (e,e^2). The
+        // function is evaluated with the edge directed from its smaller to
+        // its larger vertex index, so the triangles sharing the edge compute
+        // the same value, and the sign is adjusted for the direction of the
+        // edge in the triangle. The value itself is returned in edge.
+        static int32_t EdgeSign(Triangle const& triangle, size_t i0, size_t i1,
+            Real py, Real pz, Real& edge)
+        {
+            bool const reversed = (triangle.index[i0] > triangle.index[i1]);
+            Vector3<Real> const& a = triangle.vertex[reversed ? i1 : i0];
+            Vector3<Real> const& b = triangle.vertex[reversed ? i0 : i1];
+            Real const dy = b[1] - a[1], dz = b[2] - a[2];
+            edge = dy * (pz - a[2]) - dz * (py - a[1]);
+
+            int32_t sign;
+            if (edge != static_cast<Real>(0))
+            {
+                sign = (edge > static_cast<Real>(0) ? 1 : -1);
+            }
+            else if (dz != static_cast<Real>(0))
+            {
+                sign = (dz < static_cast<Real>(0) ? 1 : -1);
+            }
+            else
+            {
+                sign = (dy > static_cast<Real>(0) ? 1 : (dy < static_cast<Real>(0) ? -1 : 0));
+            }
+
+            if (reversed)
+            {
+                edge = -edge;
+                sign = -sign;
+            }
+            return sign;
+        }
+
+        // Test whether the line through (py,pz) parallel to the x-axis
+        // crosses the triangle and, if it does, compute the x-coordinate of
+        // the crossing.
+        static bool Crosses(Triangle const& triangle, Real py, Real pz, Real& x)
+        {
+            Real e01, e12, e20;
+            int32_t const s01 = EdgeSign(triangle, 0, 1, py, pz, e01);
+            int32_t const s12 = EdgeSign(triangle, 1, 2, py, pz, e12);
+            int32_t const s20 = EdgeSign(triangle, 2, 0, py, pz, e20);
+            if (s01 == 0 || s01 != s12 || s01 != s20)
+            {
+                return false;
+            }
+
+            // The barycentric coordinates of the crossing are proportional
+            // to the edge functions of the opposite edges.
+            Real const sum = e01 + e12 + e20;
+            if (sum != static_cast<Real>(0))
+            {
+                x = (e12 * triangle.vertex[0][0] + e20 * triangle.vertex[1][0]
+                    + e01 * triangle.vertex[2][0]) / sum;
+            }
+            else
+            {
+                x = triangle.vertex[0][0];
+            }
+            return true;
+        }
+
+        // Append the x-coordinates of the crossings of the line through
+        // (py,pz) parallel to the x-axis that are larger than xmin.
+        void GetCrossings(Real py, Real pz, Real xmin, std::vector<Real>& crossings) const
+        {
+            std::array<int32_t, msMaxStackSize> stack{};
+            int32_t numStack = 0;
+            stack[numStack++] = 0;
+            while (numStack > 0)
+            {
+                int32_t const nodeIndex = stack[--numStack];
+                Node const& node = mNodes[nodeIndex];
+                if (node.max[0] < xmin
+                    || py < node.min[1] || py > node.max[1]
+                    || pz < node.min[2] || pz > node.max[2])
+                {
+                    continue;
+                }
+
+                if (node.count > 0)
+                {
+                    for (int32_t t = node.offset; t < node.offset + node.count; ++t)
+                    {
+                        Real x;
+                        if (Crosses(mTriangles[t], py, pz, x) && x > xmin)
+                        {
+                            crossings.push_back(x);
+                        }
+                    }
+                }
+                else
+                {
+                    stack[numStack++] = node.offset;
+                    stack[numStack++] = nodeIndex + 1;
+                }
+            }
+        }
+
+        // Trace the rays of up to msPacketSize points through the BVH
+        // together. Bit i of a mask is set when ray i is active for the
+        // node.
+        void ContainsPacket(size_t numRays, Vector3<Real> const* points, uint8_t* inside) const
+        {
+            std::array<int32_t, msMaxStackSize> stack{};
+            std::array<uint32_t, msMaxStackSize> stackMask{};
+            int32_t numStack = 0;
+            stack[numStack] = 0;
+            stackMask[numStack++] = (1u << numRays) - 1u;
+            uint32_t odd = 0;
+
+            // The bounding box of the origins rejects most nodes with one
+            // test for the packet.
+            Vector3<Real> pmin = points[0], pmax = points[0];
+            for (size_t i = 1; i < numRays; ++i)
+            {
+                for (size_t d = 0; d < 3; ++d)
+                {
+                    pmin[d] = std::min(pmin[d], points[i][d]);
+                    pmax[d] = std::max(pmax[d], points[i][d]);
+                }
+            }
+
+            while (numStack > 0)
+            {
+                --numStack;
+                int32_t const nodeIndex = stack[numStack];
+                Node const& node = mNodes[nodeIndex];
+                if (node.max[0] < pmin[0]
+                    || pmax[1] < node.min[1] || pmin[1] > node.max[1]
+                    || pmax[2] < node.min[2] || pmin[2] > node.max[2])
+                {
+                    continue;
+                }
+
+                uint32_t mask = 0;
+                for (uint32_t bits = stackMask[numStack]; bits != 0; bits &= bits - 1)
+                {
+                    size_t const i = LowestBit(bits);
+                    Vector3<Real> const& p = points[i];
+                    if (node.max[0] >= p[0]
+                        && p[1] >= node.min[1] && p[1] <= node.max[1]
+                        && p[2] >= node.min[2] && p[2] <= node.max[2])
+                    {
+                        mask |= (1u << i);
+                    }
+                }
+                if (mask == 0)
+                {
+                    continue;
+                }
+
+                if (node.count > 0)
+                {
+                    // The rays of consecutive points of a grid row share
+                    // their lines, so the crossing of a line is reused by
+                    // the following rays on the same line.
+                    for (int32_t t = node.offset; t < node.offset + node.count; ++t)
+                    {
+                        Vector3<Real> const* line = nullptr;
+                        bool crosses = false;
+                        Real x = static_cast<Real>(0);
+                        for (uint32_t bits = mask; bits != 0; bits &= bits - 1)
+                        {
+                            size_t const i = LowestBit(bits);
+                            Vector3<Real> const& p = points[i];
+                            if (!line || p[1] != (*line)[1] || p[2] != (*line)[2])
+                            {
+                                line = &p;
+                                crosses = Crosses(mTriangles[t], p[1], p[2], x);
+                            }
+                            if (crosses && x > p[0])
+                            {
+                                odd ^= (1u << i);
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    stack[numStack] = node.offset;
+                    stackMask[numStack++] = mask;
+                    stack[numStack] = nodeIndex + 1;
+                    stackMask[numStack++] = mask;
+                }
+            }
+
+            for (size_t i = 0; i < numRays; ++i)
+            {
+                inside[i] = static_cast<uint8_t>((odd >> i) & 1u);
+            }
+        }
+
+        static inline size_t LowestBit(uint32_t bits)
+        {
+            size_t i = 0;
+            while ((bits & 1u) == 0)
+            {
+                bits >>= 1;
+                ++i;
+            }
+            return i;
+        }
+
+        // Execute function(imin, isup) for consecutive blocks that partition
+        // [0,numItems), as tasks when numThreads is 2 or larger.
+        template <typename Function>
+        static void ForBlocks(size_t numItems, size_t numThreads, Function const& function)
+        {
+            size_t const numTasks = std::max(std::min(numThreads, numItems), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                function(0, numItems);
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [numItems, numTasks, &function](size_t k)
+                {
+                    function(k * numItems / numTasks, (k + 1) * numItems / numTasks);
+                });
+        }
+
+        std::vector<Triangle> mTriangles;
+        std::vector<Node> mNodes;
+    };
+}
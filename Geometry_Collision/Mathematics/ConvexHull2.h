@@ -12,11 +12,39 @@
 // a correct result for the input vertices is to use an exact predicate for
 // computing signs of various expressions. The implementation uses interval
 // arithmetic and rational arithmetic for the predicate.
+//
+// Before the points are sorted, the Akl-Toussaint heuristic discards the
+// points that are strictly inside the octagon whose vertices are the
+// extreme points in the directions of the axes and the diagonals. For
+// typical point clouds most of the points are discarded, so the sort and
+// the divide-and-conquer are applied to a small subset. The octagon test
+// of a point is a loop over the 8 edges without branches, and its sign is
+// accepted only when it exceeds a bound on the rounding errors of the
+// floating-point determinant (Shewchuk's error bound for orient2d), so no
+// hull point is discarded. The octagon is built from input points in
+// counterclockwise order, so a point that is strictly to the left of all
+// its edges is in the interior of the hull even when rounding errors lead
+// to nonextreme points being chosen as its vertices.
+//
+// The subhulls of the divide-and-conquer algorithm are computed by tasks of
+// TaskScheduler::GetDefault() when lgNumThreads > 0. The top lgNumThreads
+// levels of the recursion run their halves concurrently. The subhulls
+// occupy disjoint ranges of the index arrays, and the memoized rational
+// points are indexed by the input points, which belong to one subhull each,
+// so the tasks do not share data. To compute the hull of points that are
+// not all available at once, see IncrementalConvexHull2.
 
 #include <Mathematics/ArbitraryPrecision.h>
 #include <Mathematics/SWInterval.h>
 #include <Mathematics/Line.h>
+#include <Mathematics/TaskScheduler.h>
 #include <Mathematics/Vector2.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
 
 // Uncomment this to assert when an infinite loop is encountered in
 // ConvexHull2::GetTangent.
@@ -44,9 +72,13 @@ namespace gte
             mLine(Vector2<Real>::Zero(), Vector2<Real>::Zero()),
             mRationalPoints{},
             mConverted{},
+            mRationalSlot{},
             mNumPoints(0),
             mNumUniquePoints(0),
-            mPoints(nullptr)
+            mPoints(nullptr),
+            mMerged{},
+            mHull{},
+            mInside{}
         {
             static_assert(std::is_floating_point<Real>::value,
                 "The input type must be 'float' or 'double'.");
@@ -57,8 +89,11 @@ namespace gte
         // the vertices (d = 0, 1, or 2).  When epsilon is positive, the
         // determination is fuzzy: points approximately the same point,
         // approximately on a line, or planar.  The return value is 'true' if
-        // and only if the hull construction is successful.
-        bool operator()(int32_t numPoints, Vector2<Real> const* points, Real epsilon)
+        // and only if the hull construction is successful. The code runs
+        // single-threaded when lgNumThreads = 0 and otherwise uses up to
+        // 2^{lgNumThreads} tasks of TaskScheduler::GetDefault().
+        bool operator()(int32_t numPoints, Vector2<Real> const* points, Real epsilon,
+            size_t lgNumThreads = 0)
         {
             mEpsilon = std::max(epsilon, static_cast<Real>(0));
             mDimension = 0;
@@ -93,18 +128,22 @@ namespace gte
 
             mDimension = 2;
 
+            // Discard the points strictly inside the Akl-Toussaint octagon.
+            Prefilter(lgNumThreads);
+
             // Allocate storage for any rational points that must be
-            // computed in the exact predicate.
-            mRationalPoints.resize(mNumPoints);
-            mConverted.resize(mNumPoints);
+            // computed in the exact predicate. Only the points that were
+            // not discarded have storage.
+            mRationalPoints.resize(mHull.size());
+            mConverted.resize(mHull.size());
             std::fill(mConverted.begin(), mConverted.end(), 0u);
-
-            // Sort the points.
-            mHull.resize(mNumPoints);
-            for (int32_t i = 0; i < mNumPoints; ++i)
+            mRationalSlot.resize(mNumPoints);
+            for (size_t slot = 0; slot < mHull.size(); ++slot)
             {
-                mHull[i] = i;
+                mRationalSlot[mHull[slot]] = static_cast<int32_t>(slot);
             }
+
+            // Sort the points.
             std::sort(mHull.begin(), mHull.end(),
                 [points](int32_t i0, int32_t i1)
                 {
@@ -134,7 +173,7 @@ namespace gte
             // the convex hull of two convex polygons.
             mMerged.resize(mNumUniquePoints);
             int32_t i0 = 0, i1 = mNumUniquePoints - 1;
-            GetHull(i0, i1);
+            GetHull(i0, i1, lgNumThreads);
             int32_t hullSize = i1 - i0 + 1;
             mHull.resize(hullSize);
             return true;
@@ -165,6 +204,9 @@ namespace gte
             return mNumPoints;
         }
 
+        // The number of unique points that were not discarded by the
+        // Akl-Toussaint prefilter. These are the points to which the
+        // divide-and-conquer algorithm was applied.
         inline int32_t GetNumUniquePoints() const
         {
             return mNumUniquePoints;
@@ -183,8 +225,109 @@ namespace gte
         }
 
     private:
-        // Support for divide-and-conquer.
-        void GetHull(int32_t& i0, int32_t& i1)
+        // Store in mHull the indices of the points that are not strictly
+        // inside the octagon of the extreme points.
+        void Prefilter(size_t lgNumThreads)
+        {
+            // The extreme points in the directions (1,0), (1,1), (0,1),
+            // (-1,1), (-1,0), (-1,-1), (0,-1) and (1,-1), which are in
+            // counterclockwise order.
+            std::array<int32_t, 8> extreme{};
+            std::array<Real, 8> extremeValue{};
+            extreme.fill(0);
+            GetOctagonValues(mPoints[0], extremeValue);
+            for (int32_t i = 1; i < mNumPoints; ++i)
+            {
+                std::array<Real, 8> value{};
+                GetOctagonValues(mPoints[i], value);
+                for (size_t k = 0; k < 8; ++k)
+                {
+                    if (value[k] > extremeValue[k])
+                    {
+                        extremeValue[k] = value[k];
+                        extreme[k] = i;
+                    }
+                }
+            }
+
+            std::array<Vector2<Real>, 8> origin{}, edge{};
+            for (size_t k0 = 7, k1 = 0; k1 < 8; k0 = k1++)
+            {
+                origin[k0] = mPoints[extreme[k0]];
+                edge[k0] = mPoints[extreme[k1]] - origin[k0];
+            }
+
+            // The determinant d = x0*y1 - x1*y0 of the edge (x0,y0) and
+            // the difference (x1,y1) from the edge origin to the point is
+            // positive when |d| > errorBound * (|x0*y1| + |x1*y0|) and
+            // d > 0. The term min() covers the products that underflow.
+            Real const halfEpsilon = static_cast<Real>(0.5) * std::numeric_limits<Real>::epsilon();
+            Real const errorBound = (static_cast<Real>(3) + static_cast<Real>(16) * halfEpsilon) * halfEpsilon;
+            Real const minNormal = std::numeric_limits<Real>::min();
+            mInside.resize(mNumPoints);
+            auto classify = [this, &origin, &edge, errorBound, minNormal](int32_t imin, int32_t imax)
+            {
+                for (int32_t i = imin; i < imax; ++i)
+                {
+                    Vector2<Real> const& point = mPoints[i];
+                    bool inside = true;
+                    for (size_t k = 0; k < 8; ++k)
+                    {
+                        Real const x1 = point[0] - origin[k][0];
+                        Real const y1 = point[1] - origin[k][1];
+                        Real const x0y1 = edge[k][0] * y1;
+                        Real const x1y0 = x1 * edge[k][1];
+                        Real const det = x0y1 - x1y0;
+                        Real const bound = errorBound * (std::fabs(x0y1) + std::fabs(x1y0)) + minNormal;
+                        inside = inside & (det > bound);
+                    }
+                    mInside[i] = static_cast<uint8_t>(inside);
+                }
+            };
+
+            size_t const numThreads = (static_cast<size_t>(1) << lgNumThreads);
+            if (numThreads > 1)
+            {
+                int32_t const numBlocks = static_cast<int32_t>(numThreads);
+                TaskScheduler::GetDefault().ParallelFor(numThreads,
+                    [this, &classify, numBlocks](size_t block)
+                    {
+                        int32_t const b = static_cast<int32_t>(block);
+                        int32_t const imin = static_cast<int32_t>(static_cast<int64_t>(mNumPoints) * b / numBlocks);
+                        int32_t const imax = static_cast<int32_t>(static_cast<int64_t>(mNumPoints) * (b + 1) / numBlocks);
+                        classify(imin, imax);
+                    });
+            }
+            else
+            {
+                classify(0, mNumPoints);
+            }
+
+            mHull.clear();
+            for (int32_t i = 0; i < mNumPoints; ++i)
+            {
+                if (mInside[i] == 0)
+                {
+                    mHull.push_back(i);
+                }
+            }
+        }
+
+        static void GetOctagonValues(Vector2<Real> const& point, std::array<Real, 8>& value)
+        {
+            value[0] = point[0];
+            value[1] = point[0] + point[1];
+            value[2] = point[1];
+            value[3] = point[1] - point[0];
+            value[4] = -point[0];
+            value[5] = -point[0] - point[1];
+            value[6] = -point[1];
+            value[7] = point[0] - point[1];
+        }
+
+        // Support for divide-and-conquer. The halves of the top
+        // lgNumThreads levels are computed concurrently.
+        void GetHull(int32_t& i0, int32_t& i1, size_t lgNumThreads)
         {
             int32_t numVertices = i1 - i0 + 1;
             if (numVertices > 1)
@@ -194,8 +337,21 @@ namespace gte
 
                 // Compute the hull of subsets (mid-i0+1 >= i1-mid).
                 int32_t j0 = i0, j1 = mid, j2 = mid + 1, j3 = i1;
-                GetHull(j0, j1);
-                GetHull(j2, j3);
+                if (lgNumThreads > 0 && numVertices >= msMinParallelSize)
+                {
+                    TaskScheduler::TaskGroup group;
+                    group.Run([this, &j0, &j1, lgNumThreads]()
+                    {
+                        GetHull(j0, j1, lgNumThreads - 1);
+                    });
+                    GetHull(j2, j3, lgNumThreads - 1);
+                    group.Wait();
+                }
+                else
+                {
+                    GetHull(j0, j1, 0);
+                    GetHull(j2, j3, 0);
+                }
 
                 // Merge the convex hulls into a single convex hull.
                 Merge(j0, j1, j2, j3, i0, i1);
@@ -255,10 +411,13 @@ namespace gte
             int32_t k;
             int32_t numMerged = 0;
 
+            // The merged vertices are stored in mMerged[j0..], which is
+            // not used by the subhulls of other ranges.
+            int32_t* merged = &mMerged[j0];
             i = iUL;
             for (k = 0; k < size0; ++k)
             {
-                mMerged[numMerged++] = mHull[i];
+                merged[numMerged++] = mHull[i];
                 if (i == iLL)
                 {
                     break;
@@ -270,7 +429,7 @@ namespace gte
             i = iLR;
             for (k = 0; k < size1; ++k)
             {
-                mMerged[numMerged++] = mHull[i];
+                merged[numMerged++] = mHull[i];
                 if (i == iUR)
                 {
                     break;
@@ -282,7 +441,7 @@ namespace gte
             int32_t next = j0;
             for (k = 0; k < numMerged; ++k)
             {
-                mHull[next] = mMerged[k];
+                mHull[next] = merged[k];
                 ++next;
             }
 
@@ -349,15 +508,16 @@ namespace gte
         // Memoized access to the rational representation of the points.
         Vector2<Rational> const& GetRationalPoint(int32_t index) const
         {
-            if (mConverted[index] == 0)
+            int32_t const slot = mRationalSlot[index];
+            if (mConverted[slot] == 0)
             {
-                mConverted[index] = 1;
+                mConverted[slot] = 1;
                 for (int32_t i = 0; i < 2; ++i)
                 {
-                    mRationalPoints[index][i] = mPoints[index][i];
+                    mRationalPoints[slot][i] = mPoints[index][i];
                 }
             }
-            return mRationalPoints[index];
+            return mRationalPoints[slot];
         }
 
         // An extended classification of the relationship of a point to a line
@@ -557,13 +717,23 @@ namespace gte
         // mConverted[i] is 0. The floating-point vector is converted to
         // a rational number, after which mConverted[1] is set to 1 to
         // avoid converting again if the floating-point vector is
-        // encountered in another predicate computation.
+        // encountered in another predicate computation. The rational
+        // points are stored only for the points that are not discarded by
+        // the prefilter; point i uses mRationalPoints[s] and mConverted[s]
+        // with s = mRationalSlot[i].
         mutable std::vector<Vector2<Rational>> mRationalPoints;
         mutable std::vector<uint32_t> mConverted;
+        std::vector<int32_t> mRationalSlot;
 
         int32_t mNumPoints;
         int32_t mNumUniquePoints;
         Vector2<Real> const* mPoints;
         std::vector<int32_t> mMerged, mHull;
+
+        // The results of the octagon test, 1 for the discarded points.
+        std::vector<uint8_t> mInside;
+
+        // Subsets with fewer points are not split into tasks.
+        static int32_t constexpr msMinParallelSize = 4096;
     };
 }
@@ -32,14 +32,15 @@
 // datasets, the indeterminate sign from interval arithmetic happens rarely.
 
 #include <Mathematics/ConvexHull2.h>
+#include <Mathematics/PrimalQuery3.h>
 #include <Mathematics/SWInterval.h>
+#include <Mathematics/TaskScheduler.h>
 #include <Mathematics/Vector3.h>
 #include <Mathematics/VETManifoldMesh.h>
 #include <algorithm>
 #include <numeric>
 #include <queue>
 #include <set>
-#include <thread>
 
 namespace gte
 {
@@ -48,8 +49,11 @@ namespace gte
     {
     public:
         // Supporting constants and types for rational arithmetic used in
-        // the exact predicate for sign computations.
-        static int32_t constexpr NumWords = std::is_same<Real, float>::value ? 27 : 197;
+        // the exact predicate for sign computations. The number of words is
+        // that of the ToPlane expression tree, 27 for float and 197 for
+        // double, so the rational arithmetic has no dynamic allocations.
+        static int32_t constexpr NumWords = PrimalQuery3<Real>::GetToPlanePrecision(
+            BSPrecision::GetType<Real>()).bsn.maxWords;
         using Rational = BSNumber<UIntegerFP32<NumWords>>;
 
         // The class is a functor to support computing the convex hull of
@@ -62,14 +66,18 @@ namespace gte
             mDimension(0),
             mVertices{},
             mHull{},
-            mHullMesh{}
+            mHullMesh{},
+            mCenter(Vector3<Real>::Zero()),
+            mRCenter{},
+            mWalkVertex{}
         {
         }
 
         // Compute the exact convex hull using a blend of interval arithmetic
         // and rational arithmetic. The code runs single-threaded when
         // lgNumThreads = 0. It runs multithreaded when lgNumThreads > 0,
-        // where the number of threads is 2^{lgNumThreads} > 1.
+        // where the subhulls are computed by 2^{lgNumThreads} > 1 tasks of
+        // TaskScheduler::GetDefault().
         void operator()(size_t numPoints, Vector3<Real> const* points,
             size_t lgNumThreads)
         {
@@ -106,7 +114,6 @@ namespace gte
                 std::vector<size_t> inNumSorted(numThreads);
                 std::vector<size_t*> inSorted(numThreads);
                 std::vector<std::vector<size_t>> outVertices(numThreads);
-                std::vector<std::thread> process(numThreads);
                 inNumSorted.back() = sorted.size();
                 inSorted.front() = sorted.data();
                 for (size_t i0 = 0, i1 = 1; i1 < numThreads; i0 = i1++)
@@ -118,9 +125,10 @@ namespace gte
 
                 while (numThreads > 1)
                 {
+                    TaskScheduler::TaskGroup group;
                     for (size_t i = 0; i < numThreads; ++i)
                     {
-                        process[i] = std::thread(
+                        group.Run(
                             [this, i, &inNumSorted, &inSorted, &outVertices]()
                             {
                                 size_t dimension = 0;
@@ -130,6 +138,7 @@ namespace gte
                                     outVertices[i], hull, hullMesh);
                             });
                     }
+                    group.Wait();
 
                     numThreads /= 2;
 
@@ -137,9 +146,6 @@ namespace gte
                     inSorted[0] = sorted.data();
                     for (size_t i = 0, k = 0; i < numThreads; ++i)
                     {
-                        process[2 * i].join();
-                        process[2 * i + 1].join();
-
                         inNumSorted[i] = 0;
                         auto begin = target;
                         for (size_t j = 0; j < 2; ++j, ++k)
@@ -169,6 +175,58 @@ namespace gte
             operator()(points.size(), points.data(), lgNumThreads);
         }
 
+        // Update the hull of a set of points that have moved since the
+        // previous call to operator() or Update, for example the vertices
+        // of a deforming convex collider. The number of points and their
+        // order must be the same as in the previous call. The triangles of
+        // the previous hull are the starting guess. The guess is accepted
+        // when the average C of its vertices is strictly inside each
+        // triangle and the mesh is locally convex at each edge, which makes
+        // it a convex polyhedron. Each other point is then located in a
+        // tetrahedron formed by C and a hull triangle by walking over the
+        // triangles, starting at the triangle in which it was found in the
+        // previous update. If the point is outside the triangle, it is
+        // inserted into the hull as in the incremental algorithm, which
+        // repairs only the triangles it sees. The classifications use the
+        // exact predicates, so the result is a convex hull of the points.
+        // The hull is recomputed by operator() when the previous hull was
+        // not 3-dimensional, the number of points changed or the guess is
+        // not convex, for example when a hull vertex moved inside. The
+        // function returns true when the previous hull was reused and false
+        // when it was recomputed.
+        //
+        // The reused hull can differ from the one computed by operator():
+        // a vertex that moved onto the plane of its neighbors is kept, so
+        // the hull can have more coplanar triangles.
+        bool Update(size_t numPoints, Vector3<Real> const* points, size_t lgNumThreads)
+        {
+            LogAssert(numPoints > 0 && points != nullptr, "Invalid argument.");
+
+            if (mDimension == 3 && numPoints == mRPoints.size())
+            {
+                mPoints = points;
+                std::fill(mConverted.begin(), mConverted.end(), 0);
+                if (mWalkVertex.size() != numPoints)
+                {
+                    mWalkVertex.assign(numPoints, -1);
+                }
+
+                if (RepairHull())
+                {
+                    GetHullFromMesh(mHullMesh, mVertices, mHull);
+                    return true;
+                }
+            }
+
+            operator()(numPoints, points, lgNumThreads);
+            return false;
+        }
+
+        bool Update(std::vector<Vector3<Real>> const& points, size_t lgNumThreads)
+        {
+            return Update(points.size(), points.data(), lgNumThreads);
+        }
+
         // The dimension is 0 (hull is a single point), 1 (hull is a line
         // segment), 2 (hull is a convex polygon in 3D) or 3 (hull is a convex
         // polyhedron).
@@ -258,7 +316,12 @@ namespace gte
             }
 
             Hull3(hull, numSorted, sorted, hullMesh, current);
+            GetHullFromMesh(hullMesh, vertices, hull);
+        }
 
+        static void GetHullFromMesh(VETManifoldMesh const& hullMesh,
+            std::vector<size_t>& vertices, std::vector<size_t>& hull)
+        {
             auto const& vMap = hullMesh.GetVertices();
             vertices.resize(vMap.size());
             size_t index = 0;
@@ -499,71 +562,382 @@ namespace gte
                 h1 = static_cast<int32_t>(sorted[current]);
 
                 // The sorting guarantees that the point at h0 is visible to
-                // the point at h1. Find the triangles that share h0 and are
-                // visible to h1
-                std::queue<TrianglePtr> visible;
-                std::set<TrianglePtr> visited;
+                // the point at h1. Find a triangle that shares h0 and is
+                // visible to h1.
+                TrianglePtr visibleTri = nullptr;
                 for (auto const& tri : vIter->second->TAdjacent)
                 {
                     sign = ToPlane(tri->V[0], tri->V[1], tri->V[2], h1);
                     if (sign > 0)
                     {
-                        visible.push(tri);
-                        visited.insert(tri);
+                        visibleTri = tri;
                         break;
                     }
                 }
-                LogAssert(visible.size() > 0, "Unexpected condition.");
+                LogAssert(visibleTri != nullptr, "Unexpected condition.");
+                InsertPoint(hullMesh, visibleTri, h1, terminator);
 
-                // Remove the connected component of visible triangles. Save
-                // the terminator edges for insertion of the new visible set
-                // of triangles.
-                terminator.clear();
-                while (visible.size() > 0)
+                // The current index h1 becomes the previous index h0 for the
+                // next pass of the 'current' loop.
+                h0 = h1;
+            }
+        }
+
+        // Insert point h1, which is outside the convex hull stored in
+        // hullMesh, where the triangle visibleTri is visible to h1.
+        void InsertPoint(VETManifoldMesh& hullMesh, VETManifoldMesh::Triangle* visibleTri,
+            int32_t h1, std::vector<std::array<int32_t, 2>>& terminator)
+        {
+            using TrianglePtr = VETManifoldMesh::Triangle*;
+            std::queue<TrianglePtr> visible;
+            std::set<TrianglePtr> visited;
+            visible.push(visibleTri);
+            visited.insert(visibleTri);
+
+            // Remove the connected component of visible triangles. Save
+            // the terminator edges for insertion of the new visible set
+            // of triangles.
+            terminator.clear();
+            while (visible.size() > 0)
+            {
+                TrianglePtr tri = visible.front();
+                visible.pop();
+                for (size_t i = 0; i < 3; ++i)
                 {
-                    TrianglePtr tri = visible.front();
-                    visible.pop();
-                    for (size_t i = 0; i < 3; ++i)
+                    auto adj = tri->T[i];
+                    if (adj)
                     {
-                        auto adj = tri->T[i];
-                        if (adj)
+                        if (ToPlane(adj->V[0], adj->V[1], adj->V[2], h1) <= 0)
                         {
-                            if (ToPlane(adj->V[0], adj->V[1], adj->V[2], h1) <= 0)
-                            {
-                                // The shared edge of tri and adj is a
-                                // terminator.
-                                terminator.push_back({ tri->V[i], tri->V[(i + 1) % 3] });
-                            }
-                            else
+                            // The shared edge of tri and adj is a
+                            // terminator.
+                            terminator.push_back({ tri->V[i], tri->V[(i + 1) % 3] });
+                        }
+                        else
+                        {
+                            if (visited.find(adj) == visited.end())
                             {
-                                if (visited.find(adj) == visited.end())
-                                {
-                                    visible.push(adj);
-                                    visited.insert(adj);
-                                }
+                                visible.push(adj);
+                                visited.insert(adj);
                             }
                         }
                     }
-                    visited.erase(tri);
-                    bool removed = hullMesh.Remove(tri->V[0], tri->V[1], tri->V[2]);
-                    LogAssert(
-                        removed,
-                        "Unexpected removal failure.");
                 }
+                visited.erase(tri);
+                bool removed = hullMesh.Remove(tri->V[0], tri->V[1], tri->V[2]);
+                LogAssert(
+                    removed,
+                    "Unexpected removal failure.");
+            }
 
-                // Insert the new hull triangles.
-                for (auto const& edge : terminator)
+            // Insert the new hull triangles.
+            for (auto const& edge : terminator)
+            {
+                auto inserted = hullMesh.Insert(edge[0], edge[1], h1);
+                LogAssert(
+                    inserted != nullptr,
+                    "Unexpected insertion failure.");
+            }
+        }
+
+        // Support for Update. The return value is false when the hull must
+        // be recomputed.
+        bool RepairHull()
+        {
+            using TrianglePtr = VETManifoldMesh::Triangle*;
+            auto const& vMap = mHullMesh.GetVertices();
+            auto const& tMap = mHullMesh.GetTriangles();
+
+            // The center is the average of the hull vertices. It must be
+            // strictly inside each triangle, which also rejects degenerate
+            // triangles.
+            mCenter = Vector3<Real>::Zero();
+            for (auto const& element : vMap)
+            {
+                mCenter += mPoints[element.first];
+            }
+            mCenter /= static_cast<Real>(vMap.size());
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                mRCenter[i] = mCenter[i];
+            }
+
+            for (auto const& element : tMap)
+            {
+                auto const& V = element.first.V;
+                if (ToCenter(V[0], V[1], V[2]) <= 0)
                 {
-                    auto inserted = hullMesh.Insert(edge[0], edge[1], h1);
-                    LogAssert(
-                        inserted != nullptr,
-                        "Unexpected insertion failure.");
+                    return false;
                 }
+            }
 
-                // The current index h1 becomes the previous index h0 for the
-                // next pass of the 'current' loop.
-                h0 = h1;
+            if (!ConvexifyHull())
+            {
+                return false;
+            }
+
+            // Locate the other points. Those outside the hull are inserted.
+            std::vector<std::array<int32_t, 2>> terminator;
+            size_t const numPoints = mRPoints.size();
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                if (vMap.find(static_cast<int32_t>(i)) != vMap.end())
+                {
+                    continue;
+                }
+
+                TrianglePtr visibleTri = nullptr;
+                TrianglePtr tri = Locate(i);
+                if (tri != nullptr)
+                {
+                    if (ToPlane(tri->V[0], tri->V[1], tri->V[2], i) > 0)
+                    {
+                        visibleTri = tri;
+                    }
+                }
+                else
+                {
+                    // The walk did not find the tetrahedron containing the
+                    // point, so test the point against all triangles.
+                    for (auto const& element : tMap)
+                    {
+                        auto const& V = element.first.V;
+                        if (ToPlane(V[0], V[1], V[2], i) > 0)
+                        {
+                            visibleTri = element.second.get();
+                            break;
+                        }
+                    }
+                }
+
+                if (visibleTri != nullptr)
+                {
+                    int32_t const h1 = static_cast<int32_t>(i);
+                    InsertPoint(mHullMesh, visibleTri, h1, terminator);
+                    mWalkVertex[i] = h1;
+                }
+            }
+            return true;
+        }
+
+        // Make the hull guess locally convex at each edge. For an edge <a,b>
+        // shared by the triangles <a,b,c> and <b,a,d>, the edge is reflex
+        // when d is above the plane of <a,b,c>. The edge is flipped to <c,d>
+        // when the new triangles <c,a,d> and <d,b,c> are on the positive
+        // sides of the planes through C and their edges. When the edge <c,d>
+        // already exists, a or b has 3 triangles, and that vertex is removed
+        // by replacing its triangles with the triangle of its neighbors.
+        // Each operation adds the tetrahedron <a,b,c,d> to the polyhedron,
+        // so the process terminates. A reflex edge that cannot be flipped
+        // can become convex by the operations on its neighbors. The return
+        // value is false when a reflex edge remains.
+        bool ConvexifyHull()
+        {
+            using TrianglePtr = VETManifoldMesh::Triangle*;
+            auto const& vMap = mHullMesh.GetVertices();
+            auto const& eMap = mHullMesh.GetEdges();
+
+            std::vector<std::array<int32_t, 2>> edges;
+            edges.reserve(eMap.size());
+            for (auto const& element : eMap)
+            {
+                edges.push_back({ element.first.V[0], element.first.V[1] });
+            }
+
+            size_t numBlocked = 0;
+            while (edges.size() > 0)
+            {
+                auto eIter = eMap.find(EdgeKey<false>(edges.back()[0], edges.back()[1]));
+                edges.pop_back();
+                if (eIter == eMap.end())
+                {
+                    // The edge was removed by a previous operation.
+                    continue;
+                }
+
+                TrianglePtr tri = eIter->second->T[0];
+                size_t i;
+                for (i = 0; i < 3; ++i)
+                {
+                    if (tri->E[i] == eIter->second.get())
+                    {
+                        break;
+                    }
+                }
+                LogAssert(i < 3, "Unexpected condition.");
+                TrianglePtr adj = tri->T[i];
+                int32_t const a = tri->V[i];
+                int32_t const b = tri->V[(i + 1) % 3];
+                int32_t const c = tri->V[(i + 2) % 3];
+                int32_t const d = GetOppositeVertex(adj, a, b);
+                if (ToPlane(a, b, c, d) <= 0)
+                {
+                    continue;
+                }
+
+                if (eMap.find(EdgeKey<false>(c, d)) == eMap.end())
+                {
+                    if (ToCenter(c, a, d) <= 0 || ToCenter(d, b, c) <= 0)
+                    {
+                        // The edge is tested again when a neighboring
+                        // operation changes one of its triangles.
+                        ++numBlocked;
+                        continue;
+                    }
+
+                    mHullMesh.Remove(a, b, c);
+                    mHullMesh.Remove(b, a, d);
+                    mHullMesh.Insert(c, a, d);
+                    mHullMesh.Insert(d, b, c);
+                    edges.push_back({ b, c });
+                    edges.push_back({ c, a });
+                    edges.push_back({ a, d });
+                    edges.push_back({ d, b });
+                    continue;
+                }
+
+                // The tetrahedron <a,b,c,d> has the triangles <a,b,c> and
+                // <b,a,d>, and a or b has 3 triangles. The hull must keep at
+                // least 4 vertices.
+                int32_t removed = -1;
+                if (vMap.size() > 4)
+                {
+                    if (vMap.find(a)->second->TAdjacent.size() == 3)
+                    {
+                        removed = a;
+                    }
+                    else if (vMap.find(b)->second->TAdjacent.size() == 3)
+                    {
+                        removed = b;
+                    }
+                }
+                if (removed == -1 || !RemoveVertex(removed, edges))
+                {
+                    return false;
+                }
             }
+
+            if (numBlocked > 0)
+            {
+                // Verify that the blocked edges were made convex by later
+                // operations.
+                for (auto const& element : eMap)
+                {
+                    TrianglePtr tri = element.second->T[0];
+                    TrianglePtr adj = element.second->T[1];
+                    int32_t const d = GetOppositeVertex(adj, element.first.V[0], element.first.V[1]);
+                    if (ToPlane(tri->V[0], tri->V[1], tri->V[2], d) > 0)
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Replace the 3 triangles <v,x[k],y[k]> sharing v by the triangle
+        // of the neighbors of v, where y[k] = x[k+1].
+        bool RemoveVertex(int32_t v, std::vector<std::array<int32_t, 2>>& edges)
+        {
+            auto const& tAdjacent = mHullMesh.GetVertices().find(v)->second->TAdjacent;
+            std::array<std::array<int32_t, 2>, 3> link{};
+            size_t k = 0;
+            for (auto const& tri : tAdjacent)
+            {
+                size_t i = 0;
+                while (tri->V[i] != v)
+                {
+                    ++i;
+                }
+                link[k++] = { tri->V[(i + 1) % 3], tri->V[(i + 2) % 3] };
+            }
+
+            std::array<int32_t, 3> newTri{ link[0][0], link[0][1], 0 };
+            newTri[2] = (link[1][0] == newTri[1] ? link[1][1] : link[2][1]);
+            if (ToCenter(newTri[0], newTri[1], newTri[2]) <= 0
+                || ToPlane(newTri[0], newTri[1], newTri[2], v) >= 0
+                || mHullMesh.GetTriangles().find(TriangleKey<true>(newTri[0], newTri[1], newTri[2]))
+                != mHullMesh.GetTriangles().end())
+            {
+                return false;
+            }
+
+            for (auto const& edge : link)
+            {
+                mHullMesh.Remove(v, edge[0], edge[1]);
+            }
+            mHullMesh.Insert(newTri[0], newTri[1], newTri[2]);
+            edges.push_back({ newTri[0], newTri[1] });
+            edges.push_back({ newTri[1], newTri[2] });
+            edges.push_back({ newTri[2], newTri[0] });
+            return true;
+        }
+
+        static int32_t GetOppositeVertex(VETManifoldMesh::Triangle const* tri, int32_t a, int32_t b)
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                if (tri->V[j] != a && tri->V[j] != b)
+                {
+                    return tri->V[j];
+                }
+            }
+            LogError("Unexpected condition.");
+        }
+
+        // Return the triangle <V0,V1,V2> for which the point is in the
+        // tetrahedron <C,V0,V1,V2>, or null when the walk does not find it.
+        // The walk uses floating-point arithmetic, and the containment in
+        // the cone of the triangle is verified with the exact predicate.
+        VETManifoldMesh::Triangle* Locate(size_t i)
+        {
+            using TrianglePtr = VETManifoldMesh::Triangle*;
+            auto const& vMap = mHullMesh.GetVertices();
+            auto const& tMap = mHullMesh.GetTriangles();
+
+            TrianglePtr tri = nullptr;
+            auto vIter = vMap.find(mWalkVertex[i]);
+            if (vIter != vMap.end())
+            {
+                tri = *vIter->second->TAdjacent.begin();
+            }
+            else
+            {
+                tri = tMap.begin()->second.get();
+            }
+
+            Vector3<Real> const diff = mPoints[i] - mCenter;
+            for (size_t step = 0; step < tMap.size(); ++step)
+            {
+                // Cross the first edge whose plane through C has the point
+                // on the side opposite the triangle.
+                size_t k;
+                for (k = 0; k < 3; ++k)
+                {
+                    Vector3<Real> const diff0 = mPoints[tri->V[k]] - mCenter;
+                    Vector3<Real> const diff1 = mPoints[tri->V[(k + 1) % 3]] - mCenter;
+                    if (DotCross(diff0, diff1, diff) < static_cast<Real>(0))
+                    {
+                        break;
+                    }
+                }
+
+                if (k == 3)
+                {
+                    int32_t const v = static_cast<int32_t>(i);
+                    if (ToCenter(tri->V[0], tri->V[1], v) >= 0
+                        && ToCenter(tri->V[1], tri->V[2], v) >= 0
+                        && ToCenter(tri->V[2], tri->V[0], v) >= 0)
+                    {
+                        mWalkVertex[i] = tri->V[0];
+                        return tri;
+                    }
+                    return nullptr;
+                }
+
+                tri = tri->T[k];
+            }
+            return nullptr;
         }
 
         // Memoized access to the rational representation of the points.
@@ -640,6 +1014,35 @@ namespace gte
             return rDet.GetSign();
         }
 
+        // The sign of DotCross(V1-C,V2-C,V3-C) for the center C of Update,
+        // which is positive when V3 is on the side of the plane <C,V1,V2>
+        // to which Cross(V1-C,V2-C) points.
+        int32_t ToCenter(size_t v1, size_t v2, size_t v3)
+        {
+            using SInterval = SWInterval<Real>;
+            using SVector3 = Vector3<SInterval>;
+
+            SVector3 const s0{ mCenter[0], mCenter[1], mCenter[2] };
+            SVector3 const s1{ mPoints[v1][0], mPoints[v1][1], mPoints[v1][2] };
+            SVector3 const s2{ mPoints[v2][0], mPoints[v2][1], mPoints[v2][2] };
+            SVector3 const s3{ mPoints[v3][0], mPoints[v3][1], mPoints[v3][2] };
+            auto const sDet = DotCross(s1 - s0, s2 - s0, s3 - s0);
+            if (sDet[0] > 0)
+            {
+                return +1;
+            }
+            if (sDet[1] < 0)
+            {
+                return -1;
+            }
+
+            auto const rDiff1 = GetRationalPoint(v1) - mRCenter;
+            auto const rDiff2 = GetRationalPoint(v2) - mRCenter;
+            auto const rDiff3 = GetRationalPoint(v3) - mRCenter;
+            auto const rDet = DotCross(rDiff1, rDiff2, rDiff3);
+            return rDet.GetSign();
+        }
+
     private:
         // A blend of interval arithmetic and exact arithmetic is used to
         // ensure correctness.
@@ -652,5 +1055,13 @@ namespace gte
         std::vector<size_t> mVertices;
         std::vector<size_t> mHull;
         VETManifoldMesh mHullMesh;
+
+        // Support for Update. The center is the average of the vertices of
+        // the hull guess. The walk for point i starts at a triangle sharing
+        // vertex mWalkVertex[i], the first vertex of the triangle in which
+        // the point was located by the previous update.
+        Vector3<Real> mCenter;
+        Vector3<Rational> mRCenter;
+        std::vector<int32_t> mWalkVertex;
     };
 }
@@ -44,6 +44,30 @@ namespace gte
             return poly;
         }
 
+        // Degree<D> and DegreeRR<D> for the numValues inputs x[], stored in
+        // result[]. The range reduction has no branches, so the compiler
+        // evaluates several inputs per instruction. The results are those
+        // of the single-input functions.
+        template <int32_t D>
+        static void Degree(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                result[i] = Evaluate(degree<D>(), x[i]);
+            }
+        }
+
+        template <int32_t D>
+        static void DegreeRR(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                Real y, sign;
+                Reduce(x[i], y, sign);
+                result[i] = sign * Evaluate(degree<D>(), y);
+            }
+        }
+
     private:
         // Metaprogramming and private implementation to allow specialization
         // of a template member function.
@@ -109,31 +133,16 @@ namespace gte
         {
             // Map x to y in [-pi,pi], x = 2*pi*quotient + remainder.
             Real quotient = (Real)GTE_C_INV_TWO_PI * x;
-            if (x >= (Real)0)
-            {
-                quotient = (Real)((int32_t)(quotient + (Real)0.5));
-            }
-            else
-            {
-                quotient = (Real)((int32_t)(quotient - (Real)0.5));
-            }
+            quotient = (Real)((int32_t)(quotient + (x >= (Real)0 ? (Real)0.5 : (Real)-0.5)));
             y = x - (Real)GTE_C_TWO_PI * quotient;
 
-            // Map y to [-pi/2,pi/2] with cos(y) = sign*cos(x).
-            if (y > (Real)GTE_C_HALF_PI)
-            {
-                y = (Real)GTE_C_PI - y;
-                sign = (Real)-1;
-            }
-            else if (y < (Real)-GTE_C_HALF_PI)
-            {
-                y = (Real)-GTE_C_PI - y;
-                sign = (Real)-1;
-            }
-            else
-            {
-                sign = (Real)1;
-            }
+            // Map y to [-pi/2,pi/2] with cos(y) = sign*cos(x). The reflection
+            // is y' = offset + sign * y, where y' = (+-pi) - y for |y| > pi/2
+            // and y' = (+-0) + y otherwise. It selects only a constant, so
+            // the array functions have no branches.
+            sign = (std::fabs(y) > (Real)GTE_C_HALF_PI ? (Real)-1 : (Real)1);
+            Real const offset = (((Real)1 - sign) * (Real)0.5) * std::copysign((Real)GTE_C_PI, y);
+            y = offset + sign * y;
         }
     };
 }
@@ -31,30 +31,63 @@ namespace gte
     protected:
         virtual void OnUpdateSingle(int32_t x, int32_t y, int32_t z) override
         {
-            this->LookUp27(x, y, z);
-
-            Real ux = this->mHalfInvDx * (this->mUpzz - this->mUmzz);
-            Real uy = this->mHalfInvDy * (this->mUzpz - this->mUzmz);
-            Real uz = this->mHalfInvDz * (this->mUzzp - this->mUzzm);
-            Real uxx = this->mInvDxDx * (this->mUpzz - (Real)2 * this->mUzzz + this->mUmzz);
-            Real uxy = this->mFourthInvDxDy * (this->mUmmz + this->mUppz - this->mUpmz - this->mUmpz);
-            Real uxz = this->mFourthInvDxDz * (this->mUmzm + this->mUpzp - this->mUpzm - this->mUmzp);
-            Real uyy = this->mInvDyDy * (this->mUzpz - (Real)2 * this->mUzzz + this->mUzmz);
-            Real uyz = this->mFourthInvDyDz * (this->mUzmm + this->mUzpp - this->mUzpm - this->mUzmp);
-            Real uzz = this->mInvDzDz * (this->mUzzp - (Real)2 * this->mUzzz + this->mUzzm);
-
-            Real denom = ux * ux + uy * uy + uz * uz;
-            if (denom > (Real)0)
-            {
-                Real numer0 = uy * (uxx*uy - uxy * ux) + ux * (uyy*ux - uxy * uy);
-                Real numer1 = uz * (uxx*uz - uxz * ux) + ux * (uzz*ux - uxz * uz);
-                Real numer2 = uz * (uyy*uz - uyz * uy) + uy * (uzz*uy - uyz * uz);
-                Real numer = numer0 + numer1 + numer2;
-                this->mBuffer[this->mDst][z][y][x] = this->mUzzz + this->mTimeStep * numer / denom;
-            }
-            else
+            OnUpdateRow(x, x + 1, y, z);
+        }
+
+        virtual void OnUpdateRow(int32_t xmin, int32_t xsup, int32_t y, int32_t z) override
+        {
+            // The row pointers are named by their y and z offsets in {m,z,p}
+            // as in the member neighborhood mUxyz, so mUxyz is Ryz[x + dx].
+            auto const& F = this->mBuffer[this->mSrc];
+            Real const* Rmm = F[z - 1][y - 1];
+            Real const* Rzm = F[z - 1][y];
+            Real const* Rpm = F[z - 1][y + 1];
+            Real const* Rmz = F[z][y - 1];
+            Real const* Rzz = F[z][y];
+            Real const* Rpz = F[z][y + 1];
+            Real const* Rmp = F[z + 1][y - 1];
+            Real const* Rzp = F[z + 1][y];
+            Real const* Rpp = F[z + 1][y + 1];
+            Real* output = this->mBuffer[this->mDst][z][y];
+
+            Real const halfInvDx = this->mHalfInvDx;
+            Real const halfInvDy = this->mHalfInvDy;
+            Real const halfInvDz = this->mHalfInvDz;
+            Real const invDxDx = this->mInvDxDx;
+            Real const invDyDy = this->mInvDyDy;
+            Real const invDzDz = this->mInvDzDz;
+            Real const fourthInvDxDy = this->mFourthInvDxDy;
+            Real const fourthInvDxDz = this->mFourthInvDxDz;
+            Real const fourthInvDyDz = this->mFourthInvDyDz;
+            Real const timeStep = this->mTimeStep;
+
+            for (int32_t x = xmin; x < xsup; ++x)
             {
-                this->mBuffer[this->mDst][z][y][x] = this->mUzzz;
+                int32_t const xm = x - 1, xp = x + 1;
+                Real const uzzz = Rzz[x];
+                Real ux = halfInvDx * (Rzz[xp] - Rzz[xm]);
+                Real uy = halfInvDy * (Rpz[x] - Rmz[x]);
+                Real uz = halfInvDz * (Rzp[x] - Rzm[x]);
+                Real uxx = invDxDx * (Rzz[xp] - (Real)2 * uzzz + Rzz[xm]);
+                Real uxy = fourthInvDxDy * (Rmz[xm] + Rpz[xp] - Rmz[xp] - Rpz[xm]);
+                Real uxz = fourthInvDxDz * (Rzm[xm] + Rzp[xp] - Rzm[xp] - Rzp[xm]);
+                Real uyy = invDyDy * (Rpz[x] - (Real)2 * uzzz + Rmz[x]);
+                Real uyz = fourthInvDyDz * (Rmm[x] + Rpp[x] - Rpm[x] - Rmp[x]);
+                Real uzz = invDzDz * (Rzp[x] - (Real)2 * uzzz + Rzm[x]);
+
+                Real denom = ux * ux + uy * uy + uz * uz;
+                if (denom > (Real)0)
+                {
+                    Real numer0 = uy * (uxx*uy - uxy * ux) + ux * (uyy*ux - uxy * uy);
+                    Real numer1 = uz * (uxx*uz - uxz * ux) + ux * (uzz*ux - uxz * uz);
+                    Real numer2 = uz * (uyy*uz - uyz * uy) + uy * (uzz*uy - uyz * uz);
+                    Real numer = numer0 + numer1 + numer2;
+                    output[x] = uzzz + timeStep * numer / denom;
+                }
+                else
+                {
+                    output[x] = uzzz;
+                }
             }
         }
     };
@@ -0,0 +1,298 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Timing for hot paths, where a clock read must cost a few nanoseconds;
+// Timer.h measures intervals with std::chrono. CycleClock reads the
+// time-stamp counter (x86, which must be invariant, as it is on all current
+// processors) or the virtual counter (ARM64), and falls back to
+// std::chrono::steady_clock elsewhere. ScopedCycleTimer<Slot> adds the ticks
+// and calls of its scope to a CycleProfiler slot of the calling thread,
+// without locks or atomic read-modify-write operations, so it can be used
+// per broadphase cell or per narrowphase batch.
+//
+//   enum : size_t { BROADPHASE_SLOT, NARROWPHASE_SLOT };
+//   CycleProfiler::SetName(BROADPHASE_SLOT, "broadphase");
+//   ...
+//   {
+//       GTE_CYCLE_SCOPE(BROADPHASE_SLOT);
+//       ...
+//   }
+//   CycleProfiler::WriteSummary(std::cout);
+//
+// Define GTE_DISABLE_CYCLE_PROFILER to compile out the GTE_CYCLE_SCOPE
+// macro. HardwareCounters.h reads the cache misses and branch
+// mispredictions of the calling thread.
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define GTE_CYCLE_CLOCK_RDTSC
+#include <intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define GTE_CYCLE_CLOCK_RDTSC
+#include <x86intrin.h>
+#elif (defined(__GNUC__) || defined(__clang__)) && defined(__aarch64__)
+#define GTE_CYCLE_CLOCK_CNTVCT
+#endif
+
+#if defined(GTE_DISABLE_CYCLE_PROFILER)
+#define GTE_CYCLE_SCOPE(slot)
+#else
+#define GTE_CYCLE_CONCATENATE_INDIRECT(x, y) x##y
+#define GTE_CYCLE_CONCATENATE(x, y) GTE_CYCLE_CONCATENATE_INDIRECT(x, y)
+#define GTE_CYCLE_SCOPE(slot) \
+Vector_GM::ScopedCycleTimer<slot> GTE_CYCLE_CONCATENATE(gteCycleScope, __LINE__)
+#endif
+
+namespace Vector_GM
+{
+    class CycleClock
+    {
+    public:
+        // The current tick count. The origin is unspecified, so only
+        // differences of tick counts are meaningful.
+        static inline uint64_t Now()
+        {
+#if defined(GTE_CYCLE_CLOCK_RDTSC)
+            return __rdtsc();
+#elif defined(GTE_CYCLE_CLOCK_CNTVCT)
+            uint64_t ticks;
+            asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+            return ticks;
+#else
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+        }
+
+        // The duration of a tick. The time-stamp counter is calibrated
+        // against std::chrono::steady_clock over 5 milliseconds at the first
+        // call. The frequency of the virtual counter is read from
+        // cntfrq_el0.
+        static double GetNanosecondsPerTick()
+        {
+            static double const nanosecondsPerTick = Calibrate();
+            return nanosecondsPerTick;
+        }
+
+        static inline int64_t ToNanoseconds(uint64_t ticks)
+        {
+            return static_cast<int64_t>(static_cast<double>(ticks) * GetNanosecondsPerTick() + 0.5);
+        }
+
+    private:
+        static double Calibrate()
+        {
+#if defined(GTE_CYCLE_CLOCK_RDTSC)
+            auto const time0 = std::chrono::steady_clock::now();
+            uint64_t const ticks0 = Now();
+            auto time1 = time0;
+            uint64_t ticks1 = ticks0;
+            do
+            {
+                time1 = std::chrono::steady_clock::now();
+                ticks1 = Now();
+            }
+            while (time1 - time0 < std::chrono::milliseconds(5));
+
+            double const nanoseconds = static_cast<double>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(time1 - time0).count());
+            return (ticks1 > ticks0 ? nanoseconds / static_cast<double>(ticks1 - ticks0) : 1.0);
+#elif defined(GTE_CYCLE_CLOCK_CNTVCT)
+            uint64_t frequency;
+            asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+            return 1e9 / static_cast<double>(frequency);
+#else
+            return 1.0;
+#endif
+        }
+    };
+
+    class CycleProfiler
+    {
+    public:
+        // The slots are identified by compile-time IDs in [0,numSlots).
+        static size_t constexpr numSlots = 64;
+
+        // The totals of a slot over all threads.
+        struct Total
+        {
+            int64_t nanoseconds;
+            uint64_t calls;
+        };
+
+        // Add the ticks of one call to a slot of the calling thread. Only
+        // the thread writes its slots, so relaxed loads and stores suffice
+        // and the totals can be read concurrently.
+        static inline void Add(size_t slot, uint64_t ticks)
+        {
+            Slots& slots = GetSlots();
+            slots.ticks[slot].store(slots.ticks[slot].load(std::memory_order_relaxed) + ticks,
+                std::memory_order_relaxed);
+            slots.calls[slot].store(slots.calls[slot].load(std::memory_order_relaxed) + 1,
+                std::memory_order_relaxed);
+        }
+
+        // The name of a slot in WriteSummary. The name must be a string
+        // literal or otherwise outlive the profiler.
+        static void SetName(size_t slot, char const* name)
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.names[slot] = name;
+        }
+
+        static Total GetTotal(size_t slot)
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            uint64_t ticks = 0, calls = 0;
+            for (auto const& slots : registry.slots)
+            {
+                ticks += slots->ticks[slot].load(std::memory_order_relaxed);
+                calls += slots->calls[slot].load(std::memory_order_relaxed);
+            }
+            return Total{ CycleClock::ToNanoseconds(ticks), calls };
+        }
+
+        // Set the slots of all threads to zero. The calls being recorded
+        // during the reset might be lost or kept.
+        static void Reset()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (auto const& slots : registry.slots)
+            {
+                for (size_t slot = 0; slot < numSlots; ++slot)
+                {
+                    slots->ticks[slot].store(0, std::memory_order_relaxed);
+                    slots->calls[slot].store(0, std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // Write one line "name calls nanoseconds" for each slot that has
+        // calls. A slot without a name is written as "slot <ID>".
+        static void WriteSummary(std::ostream& output)
+        {
+            Registry& registry = GetRegistry();
+            std::array<char const*, numSlots> names{};
+            {
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                names = registry.names;
+            }
+
+            for (size_t slot = 0; slot < numSlots; ++slot)
+            {
+                Total const total = GetTotal(slot);
+                if (total.calls > 0)
+                {
+                    char const* name = names[slot];
+                    if (name)
+                    {
+                        output << name;
+                    }
+                    else
+                    {
+                        output << "slot " << slot;
+                    }
+                    output << " " << total.calls << " " << total.nanoseconds << "\n";
+                }
+            }
+        }
+
+    private:
+        // The slots of a thread. They are shared by the registry so that
+        // their totals outlive the thread.
+        struct Slots
+        {
+            Slots()
+            {
+                for (size_t slot = 0; slot < numSlots; ++slot)
+                {
+                    ticks[slot].store(0, std::memory_order_relaxed);
+                    calls[slot].store(0, std::memory_order_relaxed);
+                }
+            }
+
+            std::array<std::atomic<uint64_t>, numSlots> ticks;
+            std::array<std::atomic<uint64_t>, numSlots> calls;
+        };
+
+        struct Registry
+        {
+            Registry()
+                :
+                mutex{},
+                slots{},
+                names{}
+            {
+            }
+
+            std::mutex mutex;
+            std::vector<std::shared_ptr<Slots>> slots;
+            std::array<char const*, numSlots> names;
+        };
+
+        static Registry& GetRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        static Slots& GetSlots()
+        {
+            thread_local std::shared_ptr<Slots> slots = CreateSlots();
+            return *slots;
+        }
+
+        static std::shared_ptr<Slots> CreateSlots()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto slots = std::make_shared<Slots>();
+            registry.slots.push_back(slots);
+            return slots;
+        }
+    };
+
+    // Add the ticks of the scope of the object to a CycleProfiler slot.
+    template <size_t Slot>
+    class ScopedCycleTimer
+    {
+    public:
+        static_assert(Slot < CycleProfiler::numSlots, "Invalid slot.");
+
+        ScopedCycleTimer()
+            :
+            mStart(CycleClock::Now())
+        {
+        }
+
+        ~ScopedCycleTimer()
+        {
+            CycleProfiler::Add(Slot, CycleClock::Now() - mStart);
+        }
+
+        // Object copies are not allowed.
+        ScopedCycleTimer(ScopedCycleTimer const&) = delete;
+        ScopedCycleTimer& operator=(ScopedCycleTimer const&) = delete;
+
+    private:
+        uint64_t mStart;
+    };
+}
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Mathematics/Delaunay2.h>
+#include <Mathematics/DelaunayLocator.h>
 
 namespace gte
 {
@@ -30,7 +31,8 @@ namespace gte
         // Construction.
         Delaunay2Mesh(Delaunay2<InputType, ComputeType> const& delaunay)
             :
-            mDelaunay(&delaunay)
+            mDelaunay(&delaunay),
+            mLocator{}
         {
         }
 
@@ -65,14 +67,89 @@ namespace gte
             return mDelaunay->negOne;
         }
 
-        // Containment queries.
+        // Containment queries. The search walks from a start triangle to
+        // the triangle that contains P, as Delaunay2::GetContainingTriangle
+        // does, but does not record the path. The start triangle is the
+        // seed of the grid of BuildSeedGrid, or triangle 0 without the grid.
+        // See DelaunayLocator for the details. The function returns -1 when
+        // P is outside the triangulation. The searches can be executed
+        // concurrently.
         int32_t GetContainingTriangle(Vector2<InputType> const& P) const
         {
-            // VS 2019 16.8.1 generates LNT1006 "Local variable is not
-            // initialized." Incorrect, because the default constructor
-            // initializes all the members.
-            typename Delaunay2<InputType, ComputeType>::SearchInfo info;
-            return mDelaunay->GetContainingTriangle(P, info);
+            int32_t last = 0;
+            return GetContainingTriangle(P, static_cast<int32_t>(mLocator.GetSeed(P)), last);
+        }
+
+        // Start the search at the specified triangle, which for spatially
+        // coherent queries is the 'last' triangle of the previous query. On
+        // return 'last' is the last triangle visited by the search.
+        int32_t GetContainingTriangle(Vector2<InputType> const& P, int32_t start, int32_t& last) const
+        {
+            if (mDelaunay->GetDimension() != 2)
+            {
+                LogError("The dimension must be 2.");
+            }
+
+            PrimalQuery2<ComputeType> const& query = mDelaunay->GetQuery();
+            Vector2<ComputeType> test{ P[0], P[1] };
+            std::vector<int32_t> const& indices = mDelaunay->GetIndices();
+            std::vector<int32_t> const& adjacencies = mDelaunay->GetAdjacencies();
+            int32_t const numTriangles = static_cast<int32_t>(indices.size() / 3);
+            int32_t triangle = (0 <= start && start < numTriangles ? start : 0);
+
+            // Use triangle edges as binary separating lines.
+            for (int32_t i = 0; i < numTriangles; ++i)
+            {
+                last = triangle;
+                size_t const ibase = 3 * static_cast<size_t>(triangle);
+                int32_t const* v = &indices[ibase];
+                int32_t j = 0;
+                while (j < 3 && query.ToLine(test, v[j], v[(j + 1) % 3]) <= 0)
+                {
+                    ++j;
+                }
+                if (j == 3)
+                {
+                    return triangle;
+                }
+
+                triangle = adjacencies[ibase + j];
+                if (triangle == -1)
+                {
+                    return -1;
+                }
+            }
+            return -1;
+        }
+
+        // Create the seed grid for the searches, with about trianglesPerCell
+        // triangles per cell. Call this once before the queries of a large
+        // number of points.
+        void BuildSeedGrid(size_t trianglesPerCell = 2)
+        {
+            if (mDelaunay->GetDimension() == 2)
+            {
+                mLocator.Build(mDelaunay->GetVertices(),
+                    static_cast<size_t>(mDelaunay->GetNumVertices()),
+                    mDelaunay->GetIndices().data(),
+                    static_cast<size_t>(mDelaunay->GetNumTriangles()), trianglesPerCell);
+            }
+        }
+
+        // Locate a batch of points on numThreads threads, or on the hardware
+        // concurrency when numThreads is 0. The points are searched in
+        // Hilbert order, each search starting where the previous one ended,
+        // so the searches are short for dense batches such as the points of
+        // a resampling grid. The output triangles[i] is the triangle that
+        // contains points[i], or -1.
+        void GetContainingTriangles(size_t numPoints, Vector2<InputType> const* points,
+            int32_t* triangles, size_t numThreads = 1) const
+        {
+            mLocator.Locate(numPoints, points, triangles, numThreads,
+                [this](Vector2<InputType> const& P, int32_t start, int32_t& last)
+                {
+                    return GetContainingTriangle(P, start, last);
+                });
         }
 
         bool GetVertices(int32_t t, std::array<Vector2<InputType>, 3>& vertices) const
@@ -141,6 +218,7 @@ namespace gte
 
     private:
         Delaunay2<InputType, ComputeType> const* mDelaunay;
+        DelaunayLocator<2, InputType> mLocator;
     };
 }
 
@@ -155,7 +233,8 @@ namespace gte
         // Construction.
         Delaunay2Mesh(Delaunay2<T> const& delaunay)
             :
-            mDelaunay(&delaunay)
+            mDelaunay(&delaunay),
+            mLocator{}
         {
         }
 
@@ -170,7 +249,7 @@ namespace gte
             return mDelaunay->GetNumTriangles();
         }
 
-        inline std::vector<Vector2<T>> const* GetVertices() const
+        inline Vector2<T> const* GetVertices() const
         {
             return mDelaunay->GetVertices();
         }
@@ -185,14 +264,86 @@ namespace gte
             return mDelaunay->GetAdjacencies();
         }
 
-        // Containment queries.
+        // Containment queries. The search walks from a start triangle to
+        // the triangle that contains P, as Delaunay2::GetContainingTriangle
+        // does, but does not record the path. The start triangle is the
+        // seed of the grid of BuildSeedGrid, or triangle 0 without the grid.
+        // See DelaunayLocator for the details. The function returns
+        // GetInvalidIndex() when P is outside the triangulation. The
+        // searches use their own predicates instead of those of Delaunay2,
+        // which store the query point in the Delaunay2 object, so they can
+        // be executed concurrently.
         size_t GetContainingTriangle(Vector2<T> const& P) const
         {
-            // VS 2019 16.8.1 generates LNT1006 "Local variable is not
-            // initialized." Incorrect, because the default constructor
-            // initializes all the members.
-            typename Delaunay2<T>::SearchInfo info;
-            return mDelaunay->GetContainingTriangle(P, info);
+            size_t last = 0;
+            return GetContainingTriangle(P, mLocator.GetSeed(P), last);
+        }
+
+        // Start the search at the specified triangle, which for spatially
+        // coherent queries is the 'last' triangle of the previous query. On
+        // return 'last' is the last triangle visited by the search.
+        size_t GetContainingTriangle(Vector2<T> const& P, size_t start, size_t& last) const
+        {
+            LogAssert(mDelaunay->GetDimension() == 2, "Invalid dimension for triangle search.");
+
+            std::vector<int32_t> const& indices = mDelaunay->GetIndices();
+            std::vector<int32_t> const& adjacencies = mDelaunay->GetAdjacencies();
+            size_t const numTriangles = indices.size() / 3;
+            size_t triangle = (start < numTriangles ? start : 0);
+
+            // Use triangle edges as binary separating lines.
+            for (size_t i = 0; i < numTriangles; ++i)
+            {
+                last = triangle;
+                size_t const ibase = 3 * triangle;
+                int32_t const* v = &indices[ibase];
+                size_t j = 0;
+                while (j < 3 && ToLine(P, v[j], v[(j + 1) % 3]) <= 0)
+                {
+                    ++j;
+                }
+                if (j == 3)
+                {
+                    return triangle;
+                }
+
+                int32_t const adjacent = adjacencies[ibase + j];
+                if (adjacent == -1)
+                {
+                    return mDelaunay->negOne;
+                }
+                triangle = static_cast<size_t>(adjacent);
+            }
+            return mDelaunay->negOne;
+        }
+
+        // Create the seed grid for the searches, with about trianglesPerCell
+        // triangles per cell. Call this once before the queries of a large
+        // number of points.
+        void BuildSeedGrid(size_t trianglesPerCell = 2)
+        {
+            if (mDelaunay->GetDimension() == 2)
+            {
+                mLocator.Build(mDelaunay->GetVertices(), mDelaunay->GetNumVertices(),
+                    mDelaunay->GetIndices().data(), mDelaunay->GetNumTriangles(),
+                    trianglesPerCell);
+            }
+        }
+
+        // Locate a batch of points on numThreads threads, or on the hardware
+        // concurrency when numThreads is 0. The points are searched in
+        // Hilbert order, each search starting where the previous one ended,
+        // so the searches are short for dense batches such as the points of
+        // a resampling grid. The output triangles[i] is the triangle that
+        // contains points[i], or GetInvalidIndex().
+        void GetContainingTriangles(size_t numPoints, Vector2<T> const* points,
+            size_t* triangles, size_t numThreads = 1) const
+        {
+            mLocator.Locate(numPoints, points, triangles, numThreads,
+                [this](Vector2<T> const& P, size_t start, size_t& last)
+                {
+                    return GetContainingTriangle(P, start, last);
+                });
         }
 
         inline size_t GetInvalidIndex() const
@@ -207,7 +358,7 @@ namespace gte
                 std::array<int32_t, 3> indices = { 0, 0, 0 };
                 if (mDelaunay->GetIndices(t, indices))
                 {
-                    auto const& delaunayVertices = *mDelaunay->GetVertices();
+                    Vector2<T> const* delaunayVertices = mDelaunay->GetVertices();
                     for (size_t i = 0; i < 3; ++i)
                     {
                         vertices[i] = delaunayVertices[indices[i]];
@@ -233,7 +384,10 @@ namespace gte
             std::array<int32_t, 3> indices = { 0, 0, 0 };
             if (mDelaunay->GetIndices(t, indices))
             {
-                auto const& delaunayVertices = *mDelaunay->GetVertices();
+                // The rational temporaries are allocated from the
+                // thread-local arena.
+                UIntegerAP32Arena::Scope scope;
+                Vector2<T> const* delaunayVertices = mDelaunay->GetVertices();
 
                 std::array<Vector2<Rational>, 3> rtV;
                 for (size_t i = 0; i < 3; ++i)
@@ -260,7 +414,52 @@ namespace gte
         }
 
     private:
+        // ToLine of Delaunay2, which returns +1 when P is on the right of
+        // the directed line <V0,V1>, -1 when it is on the left and 0 when
+        // it is on the line. A floating-point filter determines the sign of
+        // the determinant when its rounding error bound allows, otherwise
+        // the determinant is computed exactly. The relative error bound is
+        // 2*epsilon per operation of the 3 levels of the expression.
+        int32_t ToLine(Vector2<T> const& P, int32_t v0, int32_t v1) const
+        {
+            Vector2<T> const* vertices = mDelaunay->GetVertices();
+            Vector2<T> const& V0 = vertices[v0];
+            Vector2<T> const& V1 = vertices[v1];
+
+            double const x0 = static_cast<double>(P[0]) - static_cast<double>(V0[0]);
+            double const y0 = static_cast<double>(P[1]) - static_cast<double>(V0[1]);
+            double const x1 = static_cast<double>(V1[0]) - static_cast<double>(V0[0]);
+            double const y1 = static_cast<double>(V1[1]) - static_cast<double>(V0[1]);
+            double const x0y1 = x0 * y1, x1y0 = x1 * y0;
+            double const det = x0y1 - x1y0;
+            double const permanent = std::fabs(x0y1) + std::fabs(x1y0);
+            double constexpr errorBound = 6.0 * std::numeric_limits<double>::epsilon();
+            double constexpr minPermanent =
+                std::numeric_limits<double>::min() / std::numeric_limits<double>::epsilon();
+            if (permanent >= minPermanent)
+            {
+                if (det > errorBound * permanent)
+                {
+                    return +1;
+                }
+                if (det < -errorBound * permanent)
+                {
+                    return -1;
+                }
+            }
+
+            UIntegerAP32Arena::Scope scope;
+            Number const rx0 = Number(P[0]) - Number(V0[0]);
+            Number const ry0 = Number(P[1]) - Number(V0[1]);
+            Number const rx1 = Number(V1[0]) - Number(V0[0]);
+            Number const ry1 = Number(V1[1]) - Number(V0[1]);
+            Number const rdet = rx0 * ry1 - rx1 * ry0;
+            return rdet.GetSign();
+        }
+
+        using Number = BSNumber<UIntegerAP32>;
         using Rational = BSRational<UIntegerAP32>;
         Delaunay2<T> const* mDelaunay;
+        DelaunayLocator<2, T> mLocator;
     };
 }
@@ -13,7 +13,15 @@
 #include <Mathematics/Line.h>
 #include <Mathematics/Hyperplane.h>
 #include <Mathematics/SWInterval.h>
+#include <Mathematics/ArbitraryPrecision.h>
+#include <Mathematics/HashCombine.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
 #include <numeric>
+#include <random>
 #include <set>
 #include <unordered_set>
 #include <vector>
@@ -922,7 +930,8 @@ namespace gte
             mAdjacencies{},
             mQueryPoint(Vector3<T>::Zero()),
             mIRQueryPoint(Vector3<InputRational>::Zero()),
-            mCRPool(maxNumCRPool)
+            mCRPool(maxNumCRPool),
+            mLastTetra(nullptr)
         {
             static_assert(
                 std::is_floating_point<T>::value,
@@ -966,6 +975,7 @@ namespace gte
             mAdjacencies.clear();
             mQueryPoint = Vector3<T>::Zero();
             mIRQueryPoint = Vector3<InputRational>::Zero();
+            mLastTetra = nullptr;
 
             // Compute the intrinsic dimension and return early if that
             // dimension is 0, 1 or 2.
@@ -1025,9 +1035,11 @@ namespace gte
             LogAssert(
                 inserted != nullptr,
                 "The tetrahedron should not be degenerate.");
+            mLastTetra = inserted;
 
-            // Incrementally update the tetrahedralization. The set of
-            // processed points is maintained to eliminate duplicates.
+            // The set of processed points is maintained to eliminate
+            // duplicates. The duplicates are identified in the input order,
+            // which is independent of the insertion order.
             ProcessedVertexSet processed{};
             for (size_t i = 0; i < 4; ++i)
             {
@@ -1035,13 +1047,15 @@ namespace gte
                 processed.insert(ProcessedVertex(mVertices[j], j));
                 mDuplicates[j] = j;
             }
+            std::vector<size_t> insertions{};
+            insertions.reserve(mNumVertices);
             for (size_t i = 0; i < mNumVertices; ++i)
             {
                 ProcessedVertex v(mVertices[i], i);
                 auto iter = processed.find(v);
                 if (iter == processed.end())
                 {
-                    Update(i);
+                    insertions.push_back(i);
                     processed.insert(v);
                 }
                 else
@@ -1051,6 +1065,17 @@ namespace gte
             }
             mNumUniqueVertices = processed.size();
 
+            // Incrementally update the tetrahedralization. The points are
+            // inserted in a biased randomized insertion order (BRIO) where
+            // each round is sorted along a Hilbert curve. The point location
+            // starts at a tetrahedron created by the previous insertion, so
+            // the walks are short.
+            SortInsertions(insertions);
+            for (auto i : insertions)
+            {
+                Update(i);
+            }
+
             // Assign integer values to the tetrahedra for use by the caller
             // and copy the tetrahedra information to compact arrays mIndices
             // and mAdjacencies.
@@ -1329,7 +1354,7 @@ namespace gte
                 "Invalid dimension for tetrahedron search.");
 
             mQueryPoint = inP;
-            mIRQueryPoint = { inP[0], inP[1] };
+            mIRQueryPoint = { inP[0], inP[1], inP[2] };
 
             size_t const numTetrahedra = mIndices.size() / 4;
             info.path.resize(numTetrahedra);
@@ -1450,8 +1475,12 @@ namespace gte
         TSManifoldMesh mGraph;
 
     private:
-        // The compute type used for exact sign classification.
-        static int32_t constexpr ComputeNumWords = std::is_same<T, float>::value ? 44 : 330;
+        // The compute type used for exact sign classification. The number
+        // of words is that of the ToCircumsphere expression tree, which
+        // dominates that of ToPlane: 44 for float and 329 for double.
+        static int32_t constexpr ComputeNumWords = std::max(
+            PrimalQuery3<T>::GetToPlanePrecision(BSPrecision::GetType<T>()).bsn.maxWords,
+            PrimalQuery3<T>::GetToCircumspherePrecision(BSPrecision::GetType<T>()).bsn.maxWords);
         using ComputeRational = BSNumber<UIntegerFP32<ComputeNumWords>>;
 
         // Convenient renaming.
@@ -1507,6 +1536,208 @@ namespace gte
             return target;
         }
 
+        // Reorder the insertions for the BRIO. The insertions are shuffled
+        // with a fixed seed and partitioned into rounds whose sizes double,
+        // the last round containing about half the points. Each round is
+        // sorted by the Hilbert index of its points in the bounding box of
+        // the input.
+        void SortInsertions(std::vector<size_t>& insertions) const
+        {
+            if (insertions.size() < 2)
+            {
+                return;
+            }
+
+            Vector3<T> vmin = mVertices[0], vmax = mVertices[0];
+            for (size_t i = 1; i < mNumVertices; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    vmin[d] = std::min(vmin[d], mVertices[i][d]);
+                    vmax[d] = std::max(vmax[d], mVertices[i][d]);
+                }
+            }
+
+            // Quantize each coordinate to hilbertBits bits.
+            std::array<double, 3> scale{};
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                double const extent = static_cast<double>(vmax[d]) - static_cast<double>(vmin[d]);
+                scale[d] = (extent > 0.0 ? static_cast<double>((1u << hilbertBits) - 1) / extent : 0.0);
+            }
+
+            std::vector<std::pair<uint64_t, size_t>> keys(insertions.size());
+            for (size_t k = 0; k < insertions.size(); ++k)
+            {
+                Vector3<T> const& vertex = mVertices[insertions[k]];
+                std::array<uint32_t, 3> x{};
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    double const diff = static_cast<double>(vertex[d]) - static_cast<double>(vmin[d]);
+                    x[d] = static_cast<uint32_t>(diff * scale[d]);
+                }
+                keys[k] = std::make_pair(HilbertIndex(x), insertions[k]);
+            }
+
+            std::mt19937 mte{};
+            std::shuffle(keys.begin(), keys.end(), mte);
+            size_t end = keys.size();
+            while (end > 0)
+            {
+                size_t const begin = (end >= brioMinRound ? end / 2 : 0);
+                std::sort(keys.begin() + begin, keys.begin() + end);
+                end = begin;
+            }
+
+            for (size_t k = 0; k < keys.size(); ++k)
+            {
+                insertions[k] = keys[k].second;
+            }
+        }
+
+        // The Hilbert index of a point with hilbertBits-bit coordinates. The
+        // coordinates are transformed to the transpose of the index using
+        // J. Skilling, "Programming the Hilbert curve", AIP Conference
+        // Proceedings 707, 2004.
+        static uint64_t HilbertIndex(std::array<uint32_t, 3> x)
+        {
+            uint32_t const m = 1u << (hilbertBits - 1);
+
+            // Inverse undo.
+            for (uint32_t q = m; q > 1; q >>= 1)
+            {
+                uint32_t const p = q - 1;
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    if (x[i] & q)
+                    {
+                        x[0] ^= p;
+                    }
+                    else
+                    {
+                        uint32_t const t = (x[0] ^ x[i]) & p;
+                        x[0] ^= t;
+                        x[i] ^= t;
+                    }
+                }
+            }
+
+            // Gray encode.
+            x[1] ^= x[0];
+            x[2] ^= x[1];
+            uint32_t t = 0;
+            for (uint32_t q = m; q > 1; q >>= 1)
+            {
+                if (x[2] & q)
+                {
+                    t ^= q - 1;
+                }
+            }
+            x[0] ^= t;
+            x[1] ^= t;
+            x[2] ^= t;
+
+            // Interleave the bits of the transpose, most significant first.
+            uint64_t index = 0;
+            for (int32_t b = hilbertBits - 1; b >= 0; --b)
+            {
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    index = (index << 1) | static_cast<uint64_t>((x[i] >> b) & 1u);
+                }
+            }
+            return index;
+        }
+
+        // Floating-point filters for ToPlane and ToCircumsphere. The
+        // determinants are computed in double precision together with a
+        // bound on their rounding errors that is proportional to the
+        // permanent, the determinant expression evaluated with absolute
+        // values. The returned sign is +1 or -1 when the bound certifies it
+        // and 0 when it does not, in which case the caller uses interval and
+        // then rational arithmetic. A permanent that is too small for
+        // the bound to hold in the presence of underflow also returns 0.
+        static int32_t ToPlaneFilter(Vector3<T> const& inP, Vector3<T> const& inV0,
+            Vector3<T> const& inV1, Vector3<T> const& inV2)
+        {
+            double const x0 = static_cast<double>(inP[0]) - static_cast<double>(inV0[0]);
+            double const y0 = static_cast<double>(inP[1]) - static_cast<double>(inV0[1]);
+            double const z0 = static_cast<double>(inP[2]) - static_cast<double>(inV0[2]);
+            double const x1 = static_cast<double>(inV1[0]) - static_cast<double>(inV0[0]);
+            double const y1 = static_cast<double>(inV1[1]) - static_cast<double>(inV0[1]);
+            double const z1 = static_cast<double>(inV1[2]) - static_cast<double>(inV0[2]);
+            double const x2 = static_cast<double>(inV2[0]) - static_cast<double>(inV0[0]);
+            double const y2 = static_cast<double>(inV2[1]) - static_cast<double>(inV0[1]);
+            double const z2 = static_cast<double>(inV2[2]) - static_cast<double>(inV0[2]);
+            double const y0z1 = y0 * z1, y0z2 = y0 * z2;
+            double const y1z0 = y1 * z0, y1z2 = y1 * z2;
+            double const y2z0 = y2 * z0, y2z1 = y2 * z1;
+            double const det = x0 * (y1z2 - y2z1) + x1 * (y2z0 - y0z2) + x2 * (y0z1 - y1z0);
+            double const permanent =
+                std::fabs(x0) * (std::fabs(y1z2) + std::fabs(y2z1)) +
+                std::fabs(x1) * (std::fabs(y2z0) + std::fabs(y0z2)) +
+                std::fabs(x2) * (std::fabs(y0z1) + std::fabs(y1z0));
+            return FilterSign(det, permanent, planeErrorBound);
+        }
+
+        // The determinant of ToCircumsphere is unchanged when the lifted
+        // coordinates |V|^2-|P|^2 are replaced by |V-P|^2, which is the
+        // better-conditioned form used here.
+        static int32_t ToCircumsphereFilter(Vector3<T> const& inP, Vector3<T> const& inV0,
+            Vector3<T> const& inV1, Vector3<T> const& inV2, Vector3<T> const& inV3)
+        {
+            std::array<Vector3<T> const*, 4> const inV{ &inV0, &inV1, &inV2, &inV3 };
+            std::array<double, 4> x{}, y{}, z{}, w{};
+            for (size_t i = 0; i < 4; ++i)
+            {
+                x[i] = static_cast<double>((*inV[i])[0]) - static_cast<double>(inP[0]);
+                y[i] = static_cast<double>((*inV[i])[1]) - static_cast<double>(inP[1]);
+                z[i] = static_cast<double>((*inV[i])[2]) - static_cast<double>(inP[2]);
+                w[i] = x[i] * x[i] + y[i] * y[i] + z[i] * z[i];
+            }
+
+            // The determinant is the sum over the pairs (i,j) of the
+            // signed products of the 2x2 minors of the (x,y) and (z,w)
+            // columns, with (i,j) paired with the complementary (k,l).
+            static std::array<std::array<size_t, 4>, 6> constexpr pairs =
+            { {
+                { 0, 1, 2, 3 }, { 0, 2, 1, 3 }, { 0, 3, 1, 2 },
+                { 1, 2, 0, 3 }, { 1, 3, 0, 2 }, { 2, 3, 0, 1 }
+            } };
+            static std::array<double, 6> constexpr signs = { +1.0, -1.0, +1.0, +1.0, -1.0, +1.0 };
+
+            double det = 0.0, permanent = 0.0;
+            for (size_t n = 0; n < 6; ++n)
+            {
+                size_t const i = pairs[n][0], j = pairs[n][1];
+                size_t const k = pairs[n][2], l = pairs[n][3];
+                double const xiyj = x[i] * y[j], xjyi = x[j] * y[i];
+                double const zkwl = z[k] * w[l], zlwk = z[l] * w[k];
+                det += signs[n] * ((xiyj - xjyi) * (zkwl - zlwk));
+                permanent += (std::fabs(xiyj) + std::fabs(xjyi)) * (std::fabs(zkwl) + std::fabs(zlwk));
+            }
+            return FilterSign(det, permanent, sphereErrorBound);
+        }
+
+        static int32_t FilterSign(double det, double permanent, double errorBound)
+        {
+            double constexpr minPermanent =
+                std::numeric_limits<double>::min() / std::numeric_limits<double>::epsilon();
+            if (permanent >= minPermanent)
+            {
+                double const bound = errorBound * permanent;
+                if (det > bound)
+                {
+                    return +1;
+                }
+                if (det < -bound)
+                {
+                    return -1;
+                }
+            }
+            return 0;
+        }
+
         // Given a plane with origin V0 and normal N = Cross(V1-V0,V2-V0)
         // and given a query point P, ToPlane returns
         //   +1, P on positive side of plane (side to which N points)
@@ -1517,12 +1748,20 @@ namespace gte
             // The expression tree has 34 nodes consisting of 12 input
             // leaves and 22 compute nodes.
 
-            // Use interval arithmetic to determine the sign if possible.
             auto const& inP = (pIndex != negOne ? mVertices[pIndex] : mQueryPoint);
             Vector3<T> const& inV0 = mVertices[v0Index];
             Vector3<T> const& inV1 = mVertices[v1Index];
             Vector3<T> const& inV2 = mVertices[v2Index];
 
+            // Use a floating-point filter to determine the sign if possible.
+            int32_t sign = ToPlaneFilter(inP, inV0, inV1, inV2);
+            if (sign != 0)
+            {
+                return sign;
+            }
+
+            // Use interval arithmetic to determine the sign if possible.
+
             // Evaluate the expression tree of intervals.
             auto x0 = SWInterval<T>::Sub(inP[0], inV0[0]);
             auto y0 = SWInterval<T>::Sub(inP[1], inV0[1]);
@@ -1641,13 +1880,21 @@ namespace gte
             // The expression tree has 98 nodes consisting of 15 input
             // leaves and 83 compute nodes.
 
-            // Use interval arithmetic to determine the sign if possible.
             auto const& inP = (pIndex != negOne ? mVertices[pIndex] : mQueryPoint);
             Vector3<T> const& inV0 = mVertices[v0Index];
             Vector3<T> const& inV1 = mVertices[v1Index];
             Vector3<T> const& inV2 = mVertices[v2Index];
             Vector3<T> const& inV3 = mVertices[v3Index];
 
+            // Use a floating-point filter to determine the sign if possible.
+            int32_t sign = ToCircumsphereFilter(inP, inV0, inV1, inV2, inV3);
+            if (sign != 0)
+            {
+                return sign;
+            }
+
+            // Use interval arithmetic to determine the sign if possible.
+
             // Evaluate the expression tree of intervals.
             auto x0 = SWInterval<T>::Sub(inV0[0], inP[0]);
             auto y0 = SWInterval<T>::Sub(inV0[1], inP[1]);
@@ -2045,10 +2292,95 @@ namespace gte
             }
         }
 
+        // The hull faces visible to a point outside the hull form a
+        // connected set, so they are found by a search over the hull faces
+        // that share edges, starting at a visible face of 'tetra'. This
+        // avoids a traversal of all the tetrahedra for each point outside
+        // the hull.
+        void GetVisibleHull(size_t pIndex, Tetrahedron* tetra, DirectedTriangleKeySet& hull) const
+        {
+            auto const& opposite = TetrahedronKey<true>::GetOppositeFace();
+            std::vector<std::pair<Tetrahedron*, size_t>> stack{};
+            for (size_t j = 0; j < 4; ++j)
+            {
+                if (!tetra->S[j] && ToPlane(pIndex,
+                    static_cast<size_t>(tetra->V[opposite[j][0]]),
+                    static_cast<size_t>(tetra->V[opposite[j][1]]),
+                    static_cast<size_t>(tetra->V[opposite[j][2]])) > 0)
+                {
+                    hull.insert(TriangleKey<true>(tetra->V[opposite[j][0]],
+                        tetra->V[opposite[j][1]], tetra->V[opposite[j][2]]));
+                    stack.push_back(std::make_pair(tetra, j));
+                    break;
+                }
+            }
+            LogAssert(
+                stack.size() > 0,
+                "The search should terminate at a visible hull face.");
+
+            while (stack.size() > 0)
+            {
+                auto const face = stack.back();
+                stack.pop_back();
+                for (size_t e = 0; e < 3; ++e)
+                {
+                    // Pivot about the edge <a,b> of the face, whose third
+                    // vertex is c, through the tetrahedra sharing the edge
+                    // until reaching the other hull face containing it. The
+                    // apex d is the vertex of the current tetrahedron that
+                    // is not on the current face.
+                    Tetrahedron* current = face.first;
+                    int32_t a = current->V[opposite[face.second][e]];
+                    int32_t b = current->V[opposite[face.second][(e + 1) % 3]];
+                    int32_t c = current->V[opposite[face.second][(e + 2) % 3]];
+                    int32_t d = current->V[face.second];
+                    size_t k = 0;
+                    for (;;)
+                    {
+                        for (k = 0; k < 4; ++k)
+                        {
+                            if (current->V[k] == c)
+                            {
+                                break;
+                            }
+                        }
+                        Tetrahedron* next = current->S[k];
+                        if (!next)
+                        {
+                            break;
+                        }
+
+                        int32_t apex = -1;
+                        for (size_t m = 0; m < 4; ++m)
+                        {
+                            int32_t v = next->V[m];
+                            if (v != a && v != b && v != d)
+                            {
+                                apex = v;
+                                break;
+                            }
+                        }
+                        current = next;
+                        c = d;
+                        d = apex;
+                    }
+
+                    TriangleKey<true> key(current->V[opposite[k][0]],
+                        current->V[opposite[k][1]], current->V[opposite[k][2]]);
+                    if (hull.find(key) == hull.end() && ToPlane(pIndex,
+                        static_cast<size_t>(key.V[0]), static_cast<size_t>(key.V[1]),
+                        static_cast<size_t>(key.V[2])) > 0)
+                    {
+                        hull.insert(key);
+                        stack.push_back(std::make_pair(current, k));
+                    }
+                }
+            }
+        }
+
         void Update(size_t pIndex)
         {
-            auto const& smap = mGraph.GetTetrahedra();
-            Tetrahedron* tetra = smap.begin()->second.get();
+            Tetrahedron* tetra = mLastTetra;
             if (GetContainingTetrahedron(pIndex, tetra))
             {
                 // The point is inside the convex hull. The insertion
@@ -2080,6 +2412,7 @@ namespace gte
                         LogAssert(
                             inserted != nullptr,
                             "Unexpected insertion failure.");
+                        mLastTetra = inserted;
                     }
                 }
             }
@@ -2090,21 +2423,10 @@ namespace gte
                 // current tetrahedralization whose circumspheres contain
                 // point P.
 
-                // Locate the convex hull of the tetrahedra.
+                // Locate the hull faces visible to point i. The search for
+                // the containing tetrahedron terminated at one of them.
                 DirectedTriangleKeySet hull{};
-                for (auto const& element : smap)
-                {
-                    Tetrahedron* t = element.second.get();
-                    for (size_t j = 0; j < 4; ++j)
-                    {
-                        if (!t->S[j])
-                        {
-                            auto const& opposite = TetrahedronKey<true>::GetOppositeFace();
-                            hull.insert(TriangleKey<true>(t->V[opposite[j][0]],
-                                t->V[opposite[j][1]], t->V[opposite[j][2]]));
-                        }
-                    }
-                }
+                GetVisibleHull(pIndex, tetra, hull);
 
                 // Iterate over all the hull faces and use the ones visible to
                 // point i to locate the insertion polyhedron.
@@ -2172,6 +2494,7 @@ namespace gte
                         LogAssert(
                             inserted != nullptr,
                             "Unexpected insertion failure.");
+                        mLastTetra = inserted;
                     }
                 }
                 for (auto const& key : visible)
@@ -2181,6 +2504,7 @@ namespace gte
                     LogAssert(
                         inserted != nullptr,
                         "Unexpected insertion failure.");
+                    mLastTetra = inserted;
                 }
             }
         }
@@ -2225,5 +2549,23 @@ namespace gte
         // the exact signs in ToPlane(...) and ToCircumsphere(...).
         static size_t constexpr maxNumCRPool = 98;
         mutable std::vector<ComputeRational> mCRPool;
+
+        // The relative error bounds of the floating-point filters. The
+        // longest chains of rounded operations in the ToPlane and
+        // ToCircumsphere determinants have 6 and 12 operations, and the
+        // bounds are 2*epsilon per operation, which also covers the
+        // rounding errors of the permanents.
+        static double constexpr planeErrorBound = 12.0 * std::numeric_limits<double>::epsilon();
+        static double constexpr sphereErrorBound = 24.0 * std::numeric_limits<double>::epsilon();
+
+        // Parameters of the insertion order. The Hilbert indices use
+        // 21 bits per coordinate and the rounds of the BRIO have at least
+        // brioMinRound points, except for the first.
+        static int32_t constexpr hilbertBits = 21;
+        static size_t constexpr brioMinRound = 64;
+
+        // A tetrahedron created by the most recent insertion, which is the
+        // start of the point location for the next insertion.
+        Tetrahedron* mLastTetra;
     };
 }
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Mathematics/Delaunay3.h>
+#include <Mathematics/DelaunayLocator.h>
 
 namespace gte
 {
@@ -18,7 +19,8 @@ namespace gte
         // Construction.
         Delaunay3Mesh(Delaunay3<InputType, ComputeType> const& delaunay)
             :
-            mDelaunay(&delaunay)
+            mDelaunay(&delaunay),
+            mLocator{}
         {
         }
 
@@ -48,12 +50,104 @@ namespace gte
             return &mDelaunay->GetAdjacencies()[0];
         }
 
-        // Containment queries.
-
+        // Containment queries. The search walks from a start tetrahedron
+        // to the tetrahedron that contains P, as
+        // Delaunay3::GetContainingTetrahedron does, but does not record the
+        // path. The start tetrahedron is the seed of the grid of
+        // BuildSeedGrid, or tetrahedron 0 without the grid. See
+        // DelaunayLocator for the details. The function returns -1 when P is
+        // outside the tetrahedralization. The searches can be executed
+        // concurrently.
         int32_t GetContainingTetrahedron(Vector3<InputType> const& P) const
         {
-            typename Delaunay3<InputType, ComputeType>::SearchInfo info;
-            return mDelaunay->GetContainingTetrahedron(P, info);
+            int32_t last = 0;
+            return GetContainingTetrahedron(P, static_cast<int32_t>(mLocator.GetSeed(P)), last);
+        }
+
+        // Start the search at the specified tetrahedron, which for spatially
+        // coherent queries is the 'last' tetrahedron of the previous query.
+        // On return 'last' is the last tetrahedron visited by the search.
+        int32_t GetContainingTetrahedron(Vector3<InputType> const& P, int32_t start, int32_t& last) const
+        {
+            if (mDelaunay->GetDimension() != 3)
+            {
+                LogError("The dimension must be 3.");
+            }
+
+            PrimalQuery3<ComputeType> const& query = mDelaunay->GetQuery();
+            Vector3<ComputeType> test{ P[0], P[1], P[2] };
+            std::vector<int32_t> const& indices = mDelaunay->GetIndices();
+            std::vector<int32_t> const& adjacencies = mDelaunay->GetAdjacencies();
+            int32_t const numTetrahedra = static_cast<int32_t>(indices.size() / 4);
+            int32_t tetrahedron = (0 <= start && start < numTetrahedra ? start : 0);
+
+            // Use tetrahedron faces as binary separating planes. Face j is
+            // opposite vertex j, and the faces are tested in the order of
+            // Delaunay3::GetContainingTetrahedron.
+            for (int32_t i = 0; i < numTetrahedra; ++i)
+            {
+                last = tetrahedron;
+                size_t const ibase = 4 * static_cast<size_t>(tetrahedron);
+                int32_t const* v = &indices[ibase];
+                size_t j;
+                if (query.ToPlane(test, v[1], v[2], v[3]) > 0)
+                {
+                    j = 0;
+                }
+                else if (query.ToPlane(test, v[0], v[2], v[3]) < 0)
+                {
+                    j = 1;
+                }
+                else if (query.ToPlane(test, v[0], v[1], v[3]) > 0)
+                {
+                    j = 2;
+                }
+                else if (query.ToPlane(test, v[0], v[1], v[2]) < 0)
+                {
+                    j = 3;
+                }
+                else
+                {
+                    return tetrahedron;
+                }
+
+                tetrahedron = adjacencies[ibase + j];
+                if (tetrahedron == -1)
+                {
+                    return -1;
+                }
+            }
+            return -1;
+        }
+
+        // Create the seed grid for the searches, with about
+        // tetrahedraPerCell tetrahedra per cell. Call this once before the
+        // queries of a large number of points.
+        void BuildSeedGrid(size_t tetrahedraPerCell = 2)
+        {
+            if (mDelaunay->GetDimension() == 3)
+            {
+                mLocator.Build(mDelaunay->GetVertices(),
+                    static_cast<size_t>(mDelaunay->GetNumVertices()),
+                    mDelaunay->GetIndices().data(),
+                    static_cast<size_t>(mDelaunay->GetNumTetrahedra()), tetrahedraPerCell);
+            }
+        }
+
+        // Locate a batch of points on numThreads threads, or on the hardware
+        // concurrency when numThreads is 0. The points are searched in
+        // Hilbert order, each search starting where the previous one ended,
+        // so the searches are short for dense batches such as the points of
+        // a resampling grid. The output tetrahedra[i] is the tetrahedron
+        // that contains points[i], or -1.
+        void GetContainingTetrahedra(size_t numPoints, Vector3<InputType> const* points,
+            int32_t* tetrahedra, size_t numThreads = 1) const
+        {
+            mLocator.Locate(numPoints, points, tetrahedra, numThreads,
+                [this](Vector3<InputType> const& P, int32_t start, int32_t& last)
+                {
+                    return GetContainingTetrahedron(P, start, last);
+                });
         }
 
         bool GetVertices(int32_t t, std::array<Vector3<InputType>, 4>& vertices) const
@@ -122,5 +216,6 @@ namespace gte
 
     private:
         Delaunay3<InputType, ComputeType> const* mDelaunay;
+        DelaunayLocator<3, InputType> mLocator;
     };
 }
@@ -0,0 +1,360 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Vector.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <limits>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Support for point location in Delaunay2Mesh and Delaunay3Mesh. The meshes
+// locate a point by a walk through adjacent simplices, crossing a face
+// whose plane separates the simplex from the point. The walk is cheap per
+// step but its length grows with the distance from the start simplex to
+// the point, about the square root (2D) or cube root (3D) of the number of
+// simplices for a fixed start.
+//
+// The seed grid (jump-and-walk) is a uniform grid over the vertices whose
+// cells store a simplex near the cell, so a walk starts at the simplex of
+// the cell containing the point and takes a constant expected number of
+// steps. Each cell stores a simplex whose centroid is in the cell; empty
+// cells store the simplex of the nearest nonempty cell in the grid metric.
+//
+// The batch location sorts the points along a Hilbert curve and starts the
+// walk of each point at the simplex where the walk of the previous point
+// ended, so the walks of nearby points are short also without the grid.
+// The sorted points are split into contiguous ranges that are located on
+// separate threads. The walk function must be safe to call concurrently.
+
+namespace gte
+{
+    template <int32_t N, typename T>
+    class DelaunayLocator
+    {
+    public:
+        DelaunayLocator()
+            :
+            mMin{},
+            mInvCellSize{},
+            mNumCells{},
+            mSeeds{}
+        {
+        }
+
+        // Create the grid for the simplices with N+1 vertex indices each.
+        // The number of cells is about numSimplices/simplicesPerCell.
+        void Build(Vector<N, T> const* vertices, size_t numVertices,
+            int32_t const* indices, size_t numSimplices, size_t simplicesPerCell = 2)
+        {
+            mSeeds.clear();
+            if (numVertices == 0 || numSimplices == 0)
+            {
+                return;
+            }
+
+            std::array<double, N> vmin{}, vmax{};
+            GetBounds(vertices, numVertices, vmin, vmax);
+
+            // The cells are about cubes. An axis with no extent has one cell.
+            double const numTarget = std::max(1.0, static_cast<double>(numSimplices) /
+                static_cast<double>(std::max(simplicesPerCell, static_cast<size_t>(1))));
+            double measure = 1.0;
+            int32_t numFull = 0;
+            for (int32_t d = 0; d < N; ++d)
+            {
+                if (vmax[d] > vmin[d])
+                {
+                    measure *= vmax[d] - vmin[d];
+                    ++numFull;
+                }
+            }
+            double const cellSize = (numFull > 0 ?
+                std::pow(measure / numTarget, 1.0 / static_cast<double>(numFull)) : 1.0);
+
+            size_t numCells = 1;
+            for (int32_t d = 0; d < N; ++d)
+            {
+                double const extent = vmax[d] - vmin[d];
+                double const count = (extent > 0.0 ? std::ceil(extent / cellSize) : 1.0);
+                mNumCells[d] = static_cast<size_t>(std::min(std::max(count, 1.0), maxCellsPerAxis));
+                mMin[d] = vmin[d];
+                mInvCellSize[d] = (extent > 0.0 ? static_cast<double>(mNumCells[d]) / extent : 0.0);
+                numCells *= mNumCells[d];
+            }
+
+            // Each cell stores the first simplex whose centroid it contains.
+            size_t const invalid = std::numeric_limits<size_t>::max();
+            mSeeds.assign(numCells, invalid);
+            std::deque<size_t> filled;
+            double const weight = 1.0 / static_cast<double>(N + 1);
+            for (size_t s = 0; s < numSimplices; ++s)
+            {
+                std::array<double, N> centroid{};
+                for (int32_t j = 0; j <= N; ++j)
+                {
+                    Vector<N, T> const& V = vertices[indices[(N + 1) * s + j]];
+                    for (int32_t d = 0; d < N; ++d)
+                    {
+                        centroid[d] += weight * static_cast<double>(V[d]);
+                    }
+                }
+
+                size_t const cell = GetCell(centroid);
+                if (mSeeds[cell] == invalid)
+                {
+                    mSeeds[cell] = s;
+                    filled.push_back(cell);
+                }
+            }
+
+            // A breadth-first search from the nonempty cells gives each
+            // empty cell the simplex of a nearest nonempty cell.
+            while (!filled.empty())
+            {
+                size_t const cell = filled.front();
+                filled.pop_front();
+                size_t stride = 1;
+                for (int32_t d = 0; d < N; ++d)
+                {
+                    size_t const coordinate = (cell / stride) % mNumCells[d];
+                    if (coordinate > 0 && mSeeds[cell - stride] == invalid)
+                    {
+                        mSeeds[cell - stride] = mSeeds[cell];
+                        filled.push_back(cell - stride);
+                    }
+                    if (coordinate + 1 < mNumCells[d] && mSeeds[cell + stride] == invalid)
+                    {
+                        mSeeds[cell + stride] = mSeeds[cell];
+                        filled.push_back(cell + stride);
+                    }
+                    stride *= mNumCells[d];
+                }
+            }
+        }
+
+        inline bool IsBuilt() const
+        {
+            return mSeeds.size() > 0;
+        }
+
+        // The simplex stored in the cell that contains the point, or in the
+        // nearest cell for a point outside the grid. The function returns 0
+        // when the grid is not built.
+        size_t GetSeed(Vector<N, T> const& P) const
+        {
+            if (mSeeds.size() == 0)
+            {
+                return 0;
+            }
+
+            std::array<double, N> point{};
+            for (int32_t d = 0; d < N; ++d)
+            {
+                point[d] = static_cast<double>(P[d]);
+            }
+            return mSeeds[GetCell(point)];
+        }
+
+        // Locate the points with walk(P, start, last), which returns the
+        // simplex that contains P or 'invalid' and sets 'last' to the last
+        // simplex of the walk. The points are located in Hilbert order on
+        // numThreads threads, or on the hardware concurrency when numThreads
+        // is 0.
+        template <typename Index, typename Walk>
+        void Locate(size_t numPoints, Vector<N, T> const* points, Index* simplices,
+            size_t numThreads, Walk const& walk) const
+        {
+            if (numPoints == 0)
+            {
+                return;
+            }
+
+            std::vector<size_t> order;
+            SortHilbert(points, numPoints, order);
+
+            if (numThreads == 0)
+            {
+                numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            numThreads = std::min(numThreads, (numPoints + minPointsPerThread - 1) / minPointsPerThread);
+
+            auto locate = [this, points, simplices, &order, &walk](size_t begin, size_t end)
+            {
+                Index start = static_cast<Index>(GetSeed(points[order[begin]]));
+                for (size_t k = begin; k < end; ++k)
+                {
+                    size_t const i = order[k];
+                    Index last = start;
+                    simplices[i] = walk(points[i], start, last);
+                    start = last;
+                }
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+            for (size_t t = 1; t < numThreads; ++t)
+            {
+                threads.emplace_back(locate, t * numPoints / numThreads,
+                    (t + 1) * numPoints / numThreads);
+            }
+            locate(0, numPoints / numThreads);
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+        }
+
+        // The indices of the points sorted along a Hilbert curve over the
+        // bounding box of the points.
+        static void SortHilbert(Vector<N, T> const* points, size_t numPoints,
+            std::vector<size_t>& order)
+        {
+            order.resize(numPoints);
+            if (numPoints == 0)
+            {
+                return;
+            }
+
+            std::array<double, N> vmin{}, vmax{}, scale{};
+            GetBounds(points, numPoints, vmin, vmax);
+            double const maxCoordinate = static_cast<double>((uint64_t(1) << hilbertBits) - 1);
+            for (int32_t d = 0; d < N; ++d)
+            {
+                double const extent = vmax[d] - vmin[d];
+                scale[d] = (extent > 0.0 ? maxCoordinate / extent : 0.0);
+            }
+
+            std::vector<std::pair<uint64_t, size_t>> keys(numPoints);
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                std::array<uint32_t, N> x{};
+                for (int32_t d = 0; d < N; ++d)
+                {
+                    double const diff = static_cast<double>(points[i][d]) - vmin[d];
+                    x[d] = static_cast<uint32_t>(std::min(diff * scale[d], maxCoordinate));
+                }
+                keys[i] = std::make_pair(HilbertIndex(x), i);
+            }
+
+            std::sort(keys.begin(), keys.end());
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                order[i] = keys[i].second;
+            }
+        }
+
+        // The Hilbert index of a point with hilbertBits-bit coordinates, by
+        // the transpose algorithm of J. Skilling, "Programming the Hilbert
+        // curve", AIP Conference Proceedings 707, 2004.
+        static uint64_t HilbertIndex(std::array<uint32_t, N> x)
+        {
+            uint32_t const m = 1u << (hilbertBits - 1);
+
+            // Inverse undo.
+            for (uint32_t q = m; q > 1; q >>= 1)
+            {
+                uint32_t const p = q - 1;
+                for (int32_t i = 0; i < N; ++i)
+                {
+                    if (x[i] & q)
+                    {
+                        x[0] ^= p;
+                    }
+                    else
+                    {
+                        uint32_t const t = (x[0] ^ x[i]) & p;
+                        x[0] ^= t;
+                        x[i] ^= t;
+                    }
+                }
+            }
+
+            // Gray encode.
+            for (int32_t i = 1; i < N; ++i)
+            {
+                x[i] ^= x[i - 1];
+            }
+            uint32_t t = 0;
+            for (uint32_t q = m; q > 1; q >>= 1)
+            {
+                if (x[N - 1] & q)
+                {
+                    t ^= q - 1;
+                }
+            }
+            for (int32_t i = 0; i < N; ++i)
+            {
+                x[i] ^= t;
+            }
+
+            // Interleave the bits of the transpose, most significant first.
+            uint64_t index = 0;
+            for (int32_t b = hilbertBits - 1; b >= 0; --b)
+            {
+                for (int32_t i = 0; i < N; ++i)
+                {
+                    index = (index << 1) | static_cast<uint64_t>((x[i] >> b) & 1u);
+                }
+            }
+            return index;
+        }
+
+    private:
+        static void GetBounds(Vector<N, T> const* points, size_t numPoints,
+            std::array<double, N>& vmin, std::array<double, N>& vmax)
+        {
+            for (int32_t d = 0; d < N; ++d)
+            {
+                vmin[d] = static_cast<double>(points[0][d]);
+                vmax[d] = vmin[d];
+            }
+            for (size_t i = 1; i < numPoints; ++i)
+            {
+                for (int32_t d = 0; d < N; ++d)
+                {
+                    double const value = static_cast<double>(points[i][d]);
+                    vmin[d] = std::min(vmin[d], value);
+                    vmax[d] = std::max(vmax[d], value);
+                }
+            }
+        }
+
+        size_t GetCell(std::array<double, N> const& point) const
+        {
+            size_t cell = 0, stride = 1;
+            for (int32_t d = 0; d < N; ++d)
+            {
+                double const coordinate = std::floor((point[d] - mMin[d]) * mInvCellSize[d]);
+                double const maxCoordinate = static_cast<double>(mNumCells[d] - 1);
+                cell += stride * static_cast<size_t>(std::min(std::max(coordinate, 0.0), maxCoordinate));
+                stride *= mNumCells[d];
+            }
+            return cell;
+        }
+
+        // The number of bits per coordinate of the Hilbert indices, so that
+        // an index fits in 64 bits.
+        static int32_t constexpr hilbertBits = (N == 2 ? 31 : 21);
+
+        // A thread locates at least this many points, so that small batches
+        // are not slowed down by the creation of threads.
+        static size_t constexpr minPointsPerThread = 1024;
+
+        static double constexpr maxCellsPerAxis = (N == 2 ? 4096.0 : 256.0);
+
+        std::array<double, N> mMin, mInvCellSize;
+        std::array<size_t, N> mNumCells;
+        std::vector<size_t> mSeeds;
+    };
+}
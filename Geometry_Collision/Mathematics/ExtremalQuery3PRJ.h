@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Mathematics/ExtremalQuery3.h>
+#include <limits>
 
 namespace gte
 {
@@ -32,26 +33,28 @@ namespace gte
         virtual void GetExtremeVertices(Vector3<Real> const& direction,
             int32_t& positiveDirection, int32_t& negativeDirection) override
         {
+            // The vertices are projected onto the direction relative to
+            // their average, using the component arrays of the base class.
+            Real const dx = direction[0], dy = direction[1], dz = direction[2];
+            Real const cx = mCentroid[0], cy = mCentroid[1], cz = mCentroid[2];
             Real minValue = std::numeric_limits<Real>::max(), maxValue = -minValue;
-            negativeDirection = -1;
-            positiveDirection = -1;
-
-            auto vertexPool = this->mPolytope.GetVertexPool();
-            for (auto i : this->mPolytope.GetUniqueIndices())
+            int32_t minLocal = -1, maxLocal = -1;
+            for (int32_t i = 0; i < this->mNumLocal; ++i)
             {
-                Vector3<Real> diff = vertexPool.get()->at(i) - mCentroid;
-                Real dot = Dot(direction, diff);
+                Real dot = dx * (this->mX[i] - cx) + dy * (this->mY[i] - cy) + dz * (this->mZ[i] - cz);
                 if (dot < minValue)
                 {
-                    negativeDirection = i;
+                    minLocal = i;
                     minValue = dot;
                 }
                 if (dot > maxValue)
                 {
-                    positiveDirection = i;
+                    maxLocal = i;
                     maxValue = dot;
                 }
             }
+            negativeDirection = (minLocal >= 0 ? this->mPoolOf[minLocal] : -1);
+            positiveDirection = (maxLocal >= 0 ? this->mPoolOf[maxLocal] : -1);
         }
 
     private:
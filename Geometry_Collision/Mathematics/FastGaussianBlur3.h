@@ -7,7 +7,13 @@
 
 #pragma once
 
+#include <Mathematics/Image3.h>
 #include <Mathematics/Math.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <vector>
 
 // The algorithms here are based on solving the linear heat equation using
 // finite differences in scale, not in time.  The following document has
@@ -51,139 +57,244 @@ namespace gte
     // computations are performed using double.  The input and output images
     // must both have xBound*yBound*zBound elements and be stored in
     // lexicographical order.  The indexing is i = x+xBound*(y+yBound*z).
+    //
+    // The sample positions x+s and x-s of the second central differences and
+    // their interpolation weights depend only on the coordinates, so they
+    // are computed once per axis and stored in tables that are reused by
+    // later calls with the same bounds and scale. The output is computed a
+    // row at a time from the input rows of the y and z samples, so all the
+    // reads of the inner x-loop are sequential. To run in the main thread
+    // only, choose numThreads to be 0. For multithreading, choose
+    // numThreads > 0. The z-values are then partitioned into numThreads
+    // slabs that are processed by tasks of TaskScheduler::GetDefault().
+
+    template <typename PixelType> class TiledImage3;
 
     template <typename T>
     class FastGaussianBlur3
     {
     public:
+        FastGaussianBlur3()
+            :
+            mXBound(0),
+            mYBound(0),
+            mZBound(0),
+            mInput(nullptr),
+            mOutput(nullptr),
+            mScale(0.0),
+            mXTable{},
+            mYTable{},
+            mZTable{}
+        {
+        }
+
         void Execute(int32_t xBound, int32_t yBound, int32_t zBound, T const* input, T* output,
-            double scale, double logBase)
+            double scale, double logBase, size_t numThreads = 0)
         {
-            mXBound = xBound;
-            mYBound = yBound;
-            mZBound = zBound;
+            if (xBound != mXBound || yBound != mYBound || zBound != mZBound || scale != mScale)
+            {
+                mXBound = xBound;
+                mYBound = yBound;
+                mZBound = zBound;
+                mScale = scale;
+                mXTable.Create(xBound, scale);
+                mYTable.Create(yBound, scale);
+                mZTable.Create(zBound, scale);
+            }
             mInput = input;
             mOutput = output;
 
-            int32_t xBoundM1 = xBound - 1, yBoundM1 = yBound - 1, zBoundM1 = zBound - 1;
-            for (int32_t z = 0; z < zBound; ++z)
+            size_t const numSlices = static_cast<size_t>(zBound);
+            size_t const numTasks = (numThreads > 0 ? std::min(numThreads, numSlices) : 1);
+            auto blurSlab = [this, logBase, numSlices, numTasks](size_t k)
             {
-                double rzps = static_cast<double>(z) + scale;
-                double rzms = static_cast<double>(z) - scale;
-                int32_t zp1 = static_cast<int32_t>(std::floor(rzps));
-                int32_t zm1 = static_cast<int32_t>(std::ceil(rzms));
-
-                for (int32_t y = 0; y < yBound; ++y)
+                int32_t const zmin = static_cast<int32_t>(k * numSlices / numTasks);
+                int32_t const zsup = static_cast<int32_t>((k + 1) * numSlices / numTasks);
+                for (int32_t z = zmin; z < zsup; ++z)
                 {
-                    double ryps = static_cast<double>(y) + scale;
-                    double ryms = static_cast<double>(y) - scale;
-                    int32_t yp1 = static_cast<int32_t>(std::floor(ryps));
-                    int32_t ym1 = static_cast<int32_t>(std::ceil(ryms));
-
-                    for (int32_t x = 0; x < xBound; ++x)
+                    for (int32_t y = 0; y < mYBound; ++y)
                     {
-                        double rxps = static_cast<double>(x) + scale;
-                        double rxms = static_cast<double>(x) - scale;
-                        int32_t xp1 = static_cast<int32_t>(std::floor(rxps));
-                        int32_t xm1 = static_cast<int32_t>(std::ceil(rxms));
-
-                        double center = Input(x, y, z);
-                        double xsum = -2.0 * center, ysum = xsum, zsum = xsum;
-
-                        // x portion of second central difference
-                        if (xp1 >= xBoundM1)  // use boundary value
-                        {
-                            xsum += Input(xBoundM1, y, z);
-                        }
-                        else  // linearly interpolate
-                        {
-                            double imgXp1 = Input(xp1, y, z);
-                            double imgXp2 = Input(xp1 + 1, y, z);
-                            double delta = rxps - static_cast<double>(xp1);
-                            xsum += imgXp1 + delta * (imgXp2 - imgXp1);
-                        }
-
-                        if (xm1 <= 0)  // use boundary value
-                        {
-                            xsum += Input(0, y, z);
-                        }
-                        else  // linearly interpolate
-                        {
-                            double imgXm1 = Input(xm1, y, z);
-                            double imgXm2 = Input(xm1 - 1, y, z);
-                            double delta = rxms - static_cast<double>(xm1);
-                            xsum += imgXm1 + delta * (imgXm1 - imgXm2);
-                        }
-
-                        // y portion of second central difference
-                        if (yp1 >= yBoundM1)  // use boundary value
-                        {
-                            ysum += Input(x, yBoundM1, z);
-                        }
-                        else  // linearly interpolate
-                        {
-                            double imgYp1 = Input(x, yp1, z);
-                            double imgYp2 = Input(x, yp1 + 1, z);
-                            double delta = ryps - static_cast<double>(yp1);
-                            ysum += imgYp1 + delta * (imgYp2 - imgYp1);
-                        }
-
-                        if (ym1 <= 0)  // use boundary value
-                        {
-                            ysum += Input(x, 0, z);
-                        }
-                        else  // linearly interpolate
-                        {
-                            double imgYm1 = Input(x, ym1, z);
-                            double imgYm2 = Input(x, ym1 - 1, z);
-                            double delta = ryms - static_cast<double>(ym1);
-                            ysum += imgYm1 + delta * (imgYm1 - imgYm2);
-                        }
-
-                        // z portion of second central difference
-                        if (zp1 >= zBoundM1)  // use boundary value
-                        {
-                            zsum += Input(x, y, zBoundM1);
-                        }
-                        else  // linearly interpolate
-                        {
-                            double imgZp1 = Input(x, y, zp1);
-                            double imgZp2 = Input(x, y, zp1 + 1);
-                            double delta = rzps - static_cast<double>(zp1);
-                            zsum += imgZp1 + delta * (imgZp2 - imgZp1);
-                        }
-
-                        if (zm1 <= 0)  // use boundary value
-                        {
-                            zsum += Input(x, y, 0);
-                        }
-                        else  // linearly interpolate
-                        {
-                            double imgZm1 = Input(x, y, zm1);
-                            double imgZm2 = Input(x, y, zm1 - 1);
-                            double delta = rzms - static_cast<double>(zm1);
-                            zsum += imgZm1 + delta * (imgZm1 - imgZm2);
-                        }
-
-                        Output(x, y, z) = static_cast<T>(center + logBase * (xsum + ysum + zsum));
+                        BlurRow(y, z, logBase);
                     }
                 }
+            };
+
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, blurSlab);
+            }
+            else
+            {
+                blurSlab(0);
             }
         }
 
+        // Blur an out-of-core image a block at a time, which requires
+        // including TiledImage3.h. A block of at most blockSize^3 voxels is
+        // blurred with a halo of floor(scale)+1 voxels clipped to the image,
+        // which contains the samples at c+s and c-s of its voxels, so the
+        // output is that of the dense Execute up to rounding errors of the
+        // interpolation weights. The numThreads parameter is that of the
+        // dense Execute for each block. The input and output must be
+        // different images with the same dimensions.
+        void Execute(TiledImage3<T> const& input, TiledImage3<T>& output,
+            double scale, double logBase, int32_t blockSize, size_t numThreads = 0)
+        {
+            LogAssert(static_cast<void const*>(&input) != static_cast<void const*>(&output)
+                && input.GetDimensions() == output.GetDimensions(),
+                "The input and output must be different images of the same size.");
+
+            int32_t const halo = static_cast<int32_t>(std::floor(scale)) + 1;
+            Image3<T> source, target;
+            std::array<int32_t, 3> rmin{}, rmax{}, smin{}, smax{};
+            input.ForEachBlock(blockSize,
+                [&](std::array<int32_t, 3> const& bmin, std::array<int32_t, 3> const& bmax)
+                {
+                    input.GetHaloRegion(bmin, bmax, halo, rmin, rmax);
+                    input.GetRegion(rmin, rmax, source);
+                    target.Reconstruct(source.GetDimension(0), source.GetDimension(1),
+                        source.GetDimension(2));
+                    Execute(source.GetDimension(0), source.GetDimension(1),
+                        source.GetDimension(2), source.GetPixels().data(),
+                        target.GetPixels().data(), scale, logBase, numThreads);
+
+                    for (int32_t d = 0; d < 3; ++d)
+                    {
+                        smin[d] = bmin[d] - rmin[d];
+                        smax[d] = bmax[d] - rmin[d];
+                    }
+                    output.SetRegion(bmin, target, smin, smax);
+                });
+        }
+
     private:
-        inline double Input(int32_t x, int32_t y, int32_t z) const
+        // The interpolated samples at c+s and c-s for each coordinate c of
+        // an axis, where s is the scale. The sample at c+s is f[plus0] +
+        // plusWeight*(f[plus1]-f[plus0]) and the sample at c-s is f[minus0]
+        // + minusWeight*(f[minus0]-f[minus1]), the same expressions as the
+        // linear interpolations of the per-voxel formulation. The weight is
+        // 0 and the indices are those of the boundary value when c+s or c-s
+        // is outside the image.
+        class AxisTable
         {
-            return static_cast<double>(mInput[x + mXBound * (y + mYBound * z)]);
+        public:
+            void Create(int32_t bound, double scale)
+            {
+                size_t const size = static_cast<size_t>(bound);
+                plus0.resize(size);
+                plus1.resize(size);
+                plusWeight.resize(size);
+                minus0.resize(size);
+                minus1.resize(size);
+                minusWeight.resize(size);
+
+                int32_t const boundM1 = bound - 1;
+                for (int32_t c = 0; c < bound; ++c)
+                {
+                    double rcps = static_cast<double>(c) + scale;
+                    double rcms = static_cast<double>(c) - scale;
+                    int32_t cp1 = static_cast<int32_t>(std::floor(rcps));
+                    int32_t cm1 = static_cast<int32_t>(std::ceil(rcms));
+
+                    if (cp1 >= boundM1)  // use boundary value
+                    {
+                        plus0[c] = boundM1;
+                        plus1[c] = boundM1;
+                        plusWeight[c] = 0.0;
+                    }
+                    else  // linearly interpolate
+                    {
+                        plus0[c] = cp1;
+                        plus1[c] = cp1 + 1;
+                        plusWeight[c] = rcps - static_cast<double>(cp1);
+                    }
+
+                    if (cm1 <= 0)  // use boundary value
+                    {
+                        minus0[c] = 0;
+                        minus1[c] = 0;
+                        minusWeight[c] = 0.0;
+                    }
+                    else  // linearly interpolate
+                    {
+                        minus0[c] = cm1;
+                        minus1[c] = cm1 - 1;
+                        minusWeight[c] = rcms - static_cast<double>(cm1);
+                    }
+                }
+            }
+
+            std::vector<int32_t> plus0, plus1, minus0, minus1;
+            std::vector<double> plusWeight, minusWeight;
+        };
+
+        void BlurRow(int32_t y, int32_t z, double logBase)
+        {
+            T const* center = Row(y, z);
+            T const* yp0 = Row(mYTable.plus0[y], z);
+            T const* yp1 = Row(mYTable.plus1[y], z);
+            T const* ym0 = Row(mYTable.minus0[y], z);
+            T const* ym1 = Row(mYTable.minus1[y], z);
+            T const* zp0 = Row(y, mZTable.plus0[z]);
+            T const* zp1 = Row(y, mZTable.plus1[z]);
+            T const* zm0 = Row(y, mZTable.minus0[z]);
+            T const* zm1 = Row(y, mZTable.minus1[z]);
+            double const ypWeight = mYTable.plusWeight[y];
+            double const ymWeight = mYTable.minusWeight[y];
+            double const zpWeight = mZTable.plusWeight[z];
+            double const zmWeight = mZTable.minusWeight[z];
+            int32_t const* xp0 = mXTable.plus0.data();
+            int32_t const* xp1 = mXTable.plus1.data();
+            int32_t const* xm0 = mXTable.minus0.data();
+            int32_t const* xm1 = mXTable.minus1.data();
+            double const* xpWeight = mXTable.plusWeight.data();
+            double const* xmWeight = mXTable.minusWeight.data();
+            T* output = mOutput + static_cast<size_t>(mXBound) *
+                (static_cast<size_t>(y) + static_cast<size_t>(mYBound) * static_cast<size_t>(z));
+
+            for (int32_t x = 0; x < mXBound; ++x)
+            {
+                double const value = static_cast<double>(center[x]);
+                double xsum = -2.0 * value, ysum = xsum, zsum = xsum;
+
+                // x portion of second central difference
+                double f0 = static_cast<double>(center[xp0[x]]);
+                double f1 = static_cast<double>(center[xp1[x]]);
+                xsum += f0 + xpWeight[x] * (f1 - f0);
+                f0 = static_cast<double>(center[xm0[x]]);
+                f1 = static_cast<double>(center[xm1[x]]);
+                xsum += f0 + xmWeight[x] * (f0 - f1);
+
+                // y portion of second central difference
+                f0 = static_cast<double>(yp0[x]);
+                f1 = static_cast<double>(yp1[x]);
+                ysum += f0 + ypWeight * (f1 - f0);
+                f0 = static_cast<double>(ym0[x]);
+                f1 = static_cast<double>(ym1[x]);
+                ysum += f0 + ymWeight * (f0 - f1);
+
+                // z portion of second central difference
+                f0 = static_cast<double>(zp0[x]);
+                f1 = static_cast<double>(zp1[x]);
+                zsum += f0 + zpWeight * (f1 - f0);
+                f0 = static_cast<double>(zm0[x]);
+                f1 = static_cast<double>(zm1[x]);
+                zsum += f0 + zmWeight * (f0 - f1);
+
+                output[x] = static_cast<T>(value + logBase * (xsum + ysum + zsum));
+            }
         }
 
-        inline T& Output(int32_t x, int32_t y, int32_t z)
+        inline T const* Row(int32_t y, int32_t z) const
         {
-            return mOutput[x + mXBound * (y + mYBound * z)];
+            return mInput + static_cast<size_t>(mXBound) *
+                (static_cast<size_t>(y) + static_cast<size_t>(mYBound) * static_cast<size_t>(z));
         }
 
         int32_t mXBound, mYBound, mZBound;
         T const* mInput;
         T* mOutput;
+        double mScale;
+        AxisTable mXTable, mYTable, mZTable;
     };
 }
@@ -8,7 +8,13 @@
 #pragma once
 
 #include <Mathematics/FastMarch.h>
+#include <Mathematics/Logger.h>
 #include <Mathematics/Math.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
 
 // The topic of fast marching methods are discussed in the book
 //   Level Set Methods and Fast Marching Methods:
@@ -207,6 +213,210 @@ namespace gte
             }
         }
 
+        // Iterate until the heap of trial voxels is empty. For a narrow
+        // band, choose maxTime to stop when the smallest trial time is
+        // larger than maxTime; the voxels beyond maxTime remain trial or
+        // far voxels, and Iterate can be called later to continue. The
+        // return value is the number of iterations.
+        size_t March(Real maxTime = std::numeric_limits<Real>::max())
+        {
+            size_t numIterations = 0;
+            size_t i = 0;
+            Real value{};
+            while (this->mHeap.GetMinimum(i, value) && value <= maxTime)
+            {
+                Iterate();
+                ++numIterations;
+            }
+            return numIterations;
+        }
+
+        // The same as March, but the trial voxels are stored in an untidy
+        // priority queue instead of the min-heap; see
+        //   Liron Yatziv, Alberto Bartesaghi and Guillermo Sapiro,
+        //   O(N) implementation of the fast marching algorithm,
+        //   Journal of Computational Physics 212, 2006.
+        // The times are quantized into buckets of width bucketWidth, which
+        // are processed in increasing order, and the voxels of a bucket are
+        // processed in first-in first-out order. Each insertion and removal
+        // is O(1) rather than O(log n), but a voxel can be accepted before a
+        // voxel of the same bucket with a smaller time, which adds an error
+        // of the order of bucketWidth. A bucket width of a fraction of the
+        // smallest inverse speed, for example 0.5 for unit speeds, makes the
+        // error small relative to the discretization error. On return the
+        // heap is empty; the voxels whose tentative times are larger than
+        // maxTime keep those times and the unreached voxels remain far. The
+        // return value is the number of accepted voxels.
+        size_t MarchBucketed(Real bucketWidth, Real maxTime = std::numeric_limits<Real>::max())
+        {
+            LogAssert(bucketWidth > (Real)0, "Invalid bucket width.");
+
+            // The valid voxels that are not trial voxels are known.
+            std::vector<uint8_t> known(this->mQuantity);
+            for (size_t i = 0; i < this->mQuantity; ++i)
+            {
+                known[i] = (this->IsValid(i) && !this->IsTrial(i) ? 1 : 0);
+            }
+
+            std::vector<std::vector<size_t>> buckets;
+            Real const invBucketWidth = (Real)1 / bucketWidth;
+            size_t current = 0;
+            auto insert = [this, &buckets, &current, invBucketWidth, maxTime](size_t i)
+            {
+                if (this->mTimes[i] <= maxTime)
+                {
+                    size_t bucket = static_cast<size_t>(this->mTimes[i] * invBucketWidth);
+                    bucket = std::max(bucket, current);
+                    if (bucket >= buckets.size())
+                    {
+                        buckets.resize(bucket + 1);
+                    }
+                    buckets[bucket].push_back(i);
+                }
+            };
+
+            // Move the trial voxels from the heap to the buckets.
+            size_t key = 0;
+            Real value{};
+            while (this->mHeap.Remove(key, value))
+            {
+                this->mTrials[key] = nullptr;
+                insert(key);
+            }
+
+            // A voxel whose time decreases is inserted again. Its older
+            // entries are skipped because the voxel is known when they are
+            // removed.
+            size_t numAccepted = 0;
+            for (current = 0; current < buckets.size(); ++current)
+            {
+                // The bucket can grow while it is processed.
+                for (size_t k = 0; k < buckets[current].size(); ++k)
+                {
+                    size_t const i = buckets[current][k];
+                    if (known[i] != 0)
+                    {
+                        continue;
+                    }
+                    known[i] = 1;
+                    ++numAccepted;
+
+                    std::array<size_t, 6> const neighbors{ i - 1, i + 1,
+                        i - mXBound, i + mXBound, i - mXYBound, i + mXYBound };
+                    for (auto j : neighbors)
+                    {
+                        if (known[j] == 0 && !this->IsZeroSpeed(j))
+                        {
+                            ComputeTime(j);
+                            insert(j);
+                        }
+                    }
+                }
+                std::vector<size_t>().swap(buckets[current]);
+            }
+            return numAccepted;
+        }
+
+        // Compute the times with the fast sweeping method instead of
+        // marching; see
+        //   Hongkai Zhao,
+        //   A fast sweeping method for Eikonal equations,
+        //   Mathematics of Computation 74, 2005.
+        // A round sweeps the interior voxels in the 8 orders of increasing
+        // or decreasing x, y and z, updating each voxel from the upwind
+        // solution for its neighbors. The rounds stop when no time has
+        // decreased by more than tolerance or after maxRounds rounds, and
+        // the return value is the number of rounds. The seeds keep time 0,
+        // and times larger than maxTime are not assigned, so for a narrow
+        // band the voxels beyond maxTime remain far. On return the heap is
+        // empty.
+        //
+        // Set numThreads to 0 or 1 to run the sweeps of a round one after
+        // the other, each starting from the times of the previous one. Set
+        // numThreads to 2 or larger to run the 8 sweeps of a round on copies
+        // of the times as tasks of TaskScheduler::GetDefault() and combine
+        // them by the minimum in z-slabs on numThreads tasks; see
+        //   Hongkai Zhao,
+        //   Parallel implementations of the fast sweeping method,
+        //   Journal of Computational Mathematics 25, 2007.
+        // The parallel rounds propagate information more slowly, so they
+        // can require more rounds, and they use 8 copies of the times.
+        size_t Sweep(size_t maxRounds, Real tolerance,
+            Real maxTime = std::numeric_limits<Real>::max(), size_t numThreads = 0)
+        {
+            size_t key = 0;
+            Real value{};
+            while (this->mHeap.Remove(key, value))
+            {
+                this->mTrials[key] = nullptr;
+            }
+
+            // The seeds have time 0 and are not updated.
+            std::vector<uint8_t> fixed(this->mQuantity);
+            for (size_t i = 0; i < this->mQuantity; ++i)
+            {
+                fixed[i] = (this->mTimes[i] == (Real)0 ? 1 : 0);
+            }
+
+            if (numThreads <= 1)
+            {
+                for (size_t round = 1; round <= maxRounds; ++round)
+                {
+                    Real change = (Real)0;
+                    for (size_t order = 0; order < 8; ++order)
+                    {
+                        change = std::max(change, SweepOrder(order, fixed, maxTime,
+                            this->mTimes));
+                    }
+                    if (change <= tolerance)
+                    {
+                        return round;
+                    }
+                }
+                return maxRounds;
+            }
+
+            std::array<std::vector<Real>, 8> times;
+            std::vector<Real> slabChange(numThreads);
+            for (size_t round = 1; round <= maxRounds; ++round)
+            {
+                TaskScheduler::GetDefault().ParallelFor(8,
+                    [this, &times, &fixed, maxTime](size_t order)
+                    {
+                        times[order] = this->mTimes;
+                        SweepOrder(order, fixed, maxTime, times[order]);
+                    });
+
+                TaskScheduler::GetDefault().ParallelFor(numThreads,
+                    [this, &times, &slabChange, numThreads](size_t t)
+                    {
+                        size_t const imin = t * mZBound / numThreads * mXYBound;
+                        size_t const isup = (t + 1) * mZBound / numThreads * mXYBound;
+                        Real change = (Real)0;
+                        for (size_t i = imin; i < isup; ++i)
+                        {
+                            Real minTime = this->mTimes[i];
+                            for (auto const& orderTimes : times)
+                            {
+                                minTime = std::min(minTime, orderTimes[i]);
+                            }
+                            if (minTime < this->mTimes[i])
+                            {
+                                change = std::max(change, this->mTimes[i] - minTime);
+                                this->mTimes[i] = minTime;
+                            }
+                        }
+                        slabChange[t] = change;
+                    });
+
+                if (*std::max_element(slabChange.begin(), slabChange.end()) <= tolerance)
+                {
+                    return round;
+                }
+            }
+            return maxRounds;
+        }
+
     protected:
         // Called by the constructors.
         void Initialize(size_t xBound, size_t yBound, size_t zBound,
@@ -337,6 +547,48 @@ namespace gte
                 this->mTimes[i] = -std::numeric_limits<Real>::max();
             }
 
+            // faces (x,y,0) and (x,y,zmax)
+            for (y = 1; y < mYBoundM1; ++y)
+            {
+                for (x = 1; x < mXBoundM1; ++x)
+                {
+                    i = Index(x, y, 0);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                    i = Index(x, y, mZBoundM1);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+
+            // faces (x,0,z) and (x,ymax,z)
+            for (z = 1; z < mZBoundM1; ++z)
+            {
+                for (x = 1; x < mXBoundM1; ++x)
+                {
+                    i = Index(x, 0, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                    i = Index(x, mYBoundM1, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+
+            // faces (0,y,z) and (xmax,y,z)
+            for (z = 1; z < mZBoundM1; ++z)
+            {
+                for (y = 1; y < mYBoundM1; ++y)
+                {
+                    i = Index(0, y, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                    i = Index(mXBoundM1, y, z);
+                    this->mInvSpeeds[i] = std::numeric_limits<Real>::max();
+                    this->mTimes[i] = -std::numeric_limits<Real>::max();
+                }
+            }
+
             // Compute the first batch of trial pixels.  These are pixels a grid
             // distance of one away from the seed pixels.
             for (z = 1; z < mZBoundM1; ++z)
@@ -601,6 +853,88 @@ namespace gte
             }
         }
 
+        // Called by Sweep(). Sweep the interior voxels in the order whose
+        // bits 0, 1 and 2 select decreasing x, y and z, and return the
+        // largest decrease of a time.
+        Real SweepOrder(size_t order, std::vector<uint8_t> const& fixed,
+            Real maxTime, std::vector<Real>& times) const
+        {
+            Real const maxReal = std::numeric_limits<Real>::max();
+            auto getTime = [&times, maxReal](size_t j)
+            {
+                // Zero-speed voxels have time -maxReal and far voxels have
+                // time maxReal, so both are excluded.
+                return (times[j] >= (Real)0 ? times[j] : maxReal);
+            };
+
+            Real change = (Real)0;
+            for (size_t zc = 1; zc < mZBoundM1; ++zc)
+            {
+                size_t const z = ((order & 4) != 0 ? mZBoundM1 - zc : zc);
+                for (size_t yc = 1; yc < mYBoundM1; ++yc)
+                {
+                    size_t const y = ((order & 2) != 0 ? mYBoundM1 - yc : yc);
+                    for (size_t xc = 1; xc < mXBoundM1; ++xc)
+                    {
+                        size_t const x = ((order & 1) != 0 ? mXBoundM1 - xc : xc);
+                        size_t const i = Index(x, y, z);
+                        if (fixed[i] != 0 || times[i] < (Real)0)
+                        {
+                            continue;
+                        }
+
+                        // Solve the upwind discretization with the neighbor
+                        // times sorted as a <= b <= c, using as many of them
+                        // as are smaller than the solution.
+                        std::array<Real, 3> t =
+                        {
+                            std::min(getTime(i - 1), getTime(i + 1)),
+                            std::min(getTime(i - mXBound), getTime(i + mXBound)),
+                            std::min(getTime(i - mXYBound), getTime(i + mXYBound))
+                        };
+                        if (t[0] > t[1])
+                        {
+                            std::swap(t[0], t[1]);
+                        }
+                        if (t[1] > t[2])
+                        {
+                            std::swap(t[1], t[2]);
+                            if (t[0] > t[1])
+                            {
+                                std::swap(t[0], t[1]);
+                            }
+                        }
+                        if (t[0] == maxReal)
+                        {
+                            continue;
+                        }
+
+                        Real const f = this->mInvSpeeds[i];
+                        Real u = t[0] + f;
+                        if (u > t[1])
+                        {
+                            Real diff = t[0] - t[1];
+                            u = (Real)0.5 * (t[0] + t[1] + std::sqrt((Real)2 * f * f - diff * diff));
+                            if (u > t[2])
+                            {
+                                Real const sum = t[0] + t[1] + t[2];
+                                Real const discr = sum * sum - (Real)3 * (t[0] * t[0] +
+                                    t[1] * t[1] + t[2] * t[2] - f * f);
+                                u = (sum + std::sqrt(std::max(discr, (Real)0))) / (Real)3;
+                            }
+                        }
+
+                        if (u < times[i] && u <= maxTime)
+                        {
+                            change = std::max(change, times[i] - u);
+                            times[i] = u;
+                        }
+                    }
+                }
+            }
+            return change;
+        }
+
         size_t mXBound, mYBound, mZBound, mXYBound;
         size_t mXBoundM1, mYBoundM1, mZBoundM1;
         Real mXSpacing, mYSpacing, mZSpacing;
@@ -0,0 +1,902 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Capsule.h>
+#include <Mathematics/ConvexMesh3.h>
+#include <Mathematics/ConvexPolyhedron3.h>
+#include <Mathematics/Cylinder3.h>
+#include <Mathematics/Hypersphere.h>
+#include <Mathematics/OrientedBox.h>
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Distance and penetration queries for pairs of convex shapes using the
+// Gilbert-Johnson-Keerthi (GJK) algorithm and the Expanding Polytope
+// Algorithm (EPA). A shape is accessed only through its support mapping,
+// so one query handles all pairs of the supported shapes instead of one
+// header per pair. A shape is a core convex set, accessed by
+// ConvexSupport3<T, Shape>::GetPoint, inflated by the radius returned by
+// ConvexSupport3<T, Shape>::GetMargin. A sphere is its center inflated by
+// its radius and a capsule is its segment inflated by its radius, which
+// makes the queries for them exact up to the GJK tolerance. To support
+// another shape, specialize ConvexSupport3 for it.
+//
+// GJK computes the distance between the cores. When the cores are
+// separated by more than the sum of the margins, the shapes are separated.
+// When the core distance is smaller, the shapes overlap only in their
+// margins and the penetration follows from the distance. When the cores
+// intersect, EPA expands the final GJK simplex into a polytope in the
+// Minkowski difference of the cores until it finds the face nearest the
+// origin, which gives the penetration depth and normal.
+//
+// The query can be warm started by passing a Cache that persists for the
+// pair across calls. The cache stores the search directions of the final
+// GJK simplex. The next query evaluates the support points of the shapes
+// for those directions, which gives a simplex that is near the closest
+// features when the shapes move coherently, so GJK typically terminates
+// after one or two iterations.
+
+namespace gte
+{
+    // The support mapping of a convex shape. GetPoint returns a point of
+    // the core of the shape that is extreme in the specified direction,
+    // which need not be unit length. GetMargin returns the radius by which
+    // the core is inflated.
+    template <typename T, typename Shape>
+    struct ConvexSupport3;
+
+    template <typename T>
+    struct ConvexSupport3<T, Sphere3<T>>
+    {
+        static Vector3<T> GetPoint(Sphere3<T> const& sphere, Vector3<T> const&)
+        {
+            return sphere.center;
+        }
+
+        static T GetMargin(Sphere3<T> const& sphere)
+        {
+            return sphere.radius;
+        }
+    };
+
+    template <typename T>
+    struct ConvexSupport3<T, Capsule3<T>>
+    {
+        static Vector3<T> GetPoint(Capsule3<T> const& capsule, Vector3<T> const& direction)
+        {
+            auto const& p = capsule.segment.p;
+            return (Dot(direction, p[1] - p[0]) > static_cast<T>(0) ? p[1] : p[0]);
+        }
+
+        static T GetMargin(Capsule3<T> const& capsule)
+        {
+            return capsule.radius;
+        }
+    };
+
+    template <typename T>
+    struct ConvexSupport3<T, OrientedBox3<T>>
+    {
+        static Vector3<T> GetPoint(OrientedBox3<T> const& box, Vector3<T> const& direction)
+        {
+            Vector3<T> point = box.center;
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                T const extent = (Dot(direction, box.axis[i]) >= static_cast<T>(0) ?
+                    box.extent[i] : -box.extent[i]);
+                point += extent * box.axis[i];
+            }
+            return point;
+        }
+
+        static T GetMargin(OrientedBox3<T> const&)
+        {
+            return static_cast<T>(0);
+        }
+    };
+
+    // The cylinder must be finite. The axis direction must be unit length.
+    template <typename T>
+    struct ConvexSupport3<T, Cylinder3<T>>
+    {
+        static Vector3<T> GetPoint(Cylinder3<T> const& cylinder, Vector3<T> const& direction)
+        {
+            Vector3<T> const& U = cylinder.axis.direction;
+            T const dot = Dot(direction, U);
+            T const halfHeight = static_cast<T>(0.5) * cylinder.height;
+            Vector3<T> point = cylinder.axis.origin +
+                (dot >= static_cast<T>(0) ? halfHeight : -halfHeight) * U;
+            Vector3<T> radial = direction - dot * U;
+            T const length = Length(radial);
+            if (length > static_cast<T>(0))
+            {
+                point += (cylinder.radius / length) * radial;
+            }
+            return point;
+        }
+
+        static T GetMargin(Cylinder3<T> const&)
+        {
+            return static_cast<T>(0);
+        }
+    };
+
+    // The support point of a polytope given by its vertices.
+    template <typename T>
+    Vector3<T> GetExtremeVertex(std::vector<Vector3<T>> const& vertices, Vector3<T> const& direction)
+    {
+        size_t extreme = 0;
+        T maxDot = Dot(direction, vertices[0]);
+        for (size_t i = 1; i < vertices.size(); ++i)
+        {
+            T const dot = Dot(direction, vertices[i]);
+            if (dot > maxDot)
+            {
+                maxDot = dot;
+                extreme = i;
+            }
+        }
+        return vertices[extreme];
+    }
+
+    template <typename T>
+    struct ConvexSupport3<T, ConvexPolyhedron3<T>>
+    {
+        static Vector3<T> GetPoint(ConvexPolyhedron3<T> const& polyhedron, Vector3<T> const& direction)
+        {
+            return GetExtremeVertex(polyhedron.vertices, direction);
+        }
+
+        static T GetMargin(ConvexPolyhedron3<T> const&)
+        {
+            return static_cast<T>(0);
+        }
+    };
+
+    template <typename T>
+    struct ConvexSupport3<T, ConvexMesh3<T>>
+    {
+        static Vector3<T> GetPoint(ConvexMesh3<T> const& mesh, Vector3<T> const& direction)
+        {
+            return GetExtremeVertex(mesh.vertices, direction);
+        }
+
+        static T GetMargin(ConvexMesh3<T> const&)
+        {
+            return static_cast<T>(0);
+        }
+    };
+
+    template <typename T>
+    class GJKQuery3
+    {
+    public:
+        // The search directions of the final simplex of the previous query
+        // for a pair of shapes. A default-constructed cache is empty.
+        struct Cache
+        {
+            Cache()
+                :
+                numVertices(0),
+                direction{}
+            {
+            }
+
+            size_t numVertices;
+            std::array<Vector3<T>, 4> direction;
+        };
+
+        // When the shapes are separated, 'intersect' is false, 'distance'
+        // is positive and 'normal' is the unit-length direction from
+        // closest[0] on shape0 to closest[1] on shape1. When they overlap
+        // or touch, 'intersect' is true, 'depth' is nonnegative and
+        // translating shape1 by depth*normal separates the shapes; the
+        // points closest[0] on shape0 and closest[1] on shape1 are the
+        // deepest points, closest[1] = closest[0] - depth*normal.
+        struct Result
+        {
+            Result()
+                :
+                intersect(false),
+                distance(static_cast<T>(0)),
+                depth(static_cast<T>(0)),
+                normal(Vector3<T>::Zero()),
+                closest{ Vector3<T>::Zero(), Vector3<T>::Zero() },
+                numIterations(0)
+            {
+            }
+
+            bool intersect;
+            T distance, depth;
+            Vector3<T> normal;
+            std::array<Vector3<T>, 2> closest;
+            size_t numIterations;
+        };
+
+        // GJK terminates when the squared distance estimate is within a
+        // relative 'tolerance' of its lower bound and EPA terminates when
+        // the depth estimate is within a relative 'tolerance' of its upper
+        // bound. The iteration counts bound the work for degenerate input.
+        GJKQuery3(
+            T tolerance = std::sqrt(std::numeric_limits<T>::epsilon()),
+            size_t maxGJKIterations = 64,
+            size_t maxEPAIterations = 128)
+            :
+            mTolerance(tolerance),
+            mMaxGJKIterations(maxGJKIterations),
+            mMaxEPAIterations(maxEPAIterations)
+        {
+            static_assert(std::is_floating_point<T>::value,
+                "The input type must be 'float' or 'double'.");
+        }
+
+        template <typename Shape0, typename Shape1>
+        Result operator()(Shape0 const& shape0, Shape1 const& shape1, Cache* cache = nullptr) const
+        {
+            auto support = [&shape0, &shape1](Vector3<T> const& direction, Vertex& vertex)
+            {
+                vertex.direction = direction;
+                vertex.a = ConvexSupport3<T, Shape0>::GetPoint(shape0, direction);
+                vertex.b = ConvexSupport3<T, Shape1>::GetPoint(shape1, -direction);
+                vertex.w = vertex.a - vertex.b;
+            };
+
+            Result result{};
+            T const margin0 = ConvexSupport3<T, Shape0>::GetMargin(shape0);
+            T const margin1 = ConvexSupport3<T, Shape1>::GetMargin(shape1);
+
+            // Initialize the simplex from the cache or from an arbitrary
+            // support point of the Minkowski difference of the cores.
+            Simplex simplex{};
+            if (cache && cache->numVertices > 0)
+            {
+                simplex.numVertices = cache->numVertices;
+                for (size_t i = 0; i < simplex.numVertices; ++i)
+                {
+                    support(cache->direction[i], simplex.vertex[i]);
+                }
+            }
+            else
+            {
+                simplex.numVertices = 1;
+                support(Vector3<T>::Unit(0), simplex.vertex[0]);
+            }
+
+            Vector3<T> v = GetClosestPoint(simplex);
+            T sqrLength = Dot(v, v);
+            bool coresIntersect = (simplex.numVertices == 4);
+            Vertex w{};
+            while (!coresIntersect && result.numIterations < mMaxGJKIterations)
+            {
+                ++result.numIterations;
+
+                // The support point of the Minkowski difference in the
+                // direction -v. The distance is at least Dot(v,w)/|v|, so
+                // the iterations stop when |v|^2 - Dot(v,w) is small.
+                support(-v, w);
+                T const reduction = sqrLength - Dot(v, w.w);
+                if (reduction <= mTolerance * sqrLength)
+                {
+                    break;
+                }
+
+                bool isDuplicate = false;
+                for (size_t i = 0; i < simplex.numVertices; ++i)
+                {
+                    if (simplex.vertex[i].w == w.w)
+                    {
+                        isDuplicate = true;
+                        break;
+                    }
+                }
+                if (isDuplicate)
+                {
+                    break;
+                }
+
+                // The origin is on the simplex when the closest point is
+                // zero relative to the size of the simplex.
+                simplex.vertex[simplex.numVertices++] = w;
+                T maxSqrLength = static_cast<T>(0);
+                for (size_t i = 0; i < simplex.numVertices; ++i)
+                {
+                    maxSqrLength = std::max(maxSqrLength, Dot(simplex.vertex[i].w, simplex.vertex[i].w));
+                }
+
+                Vector3<T> const vNext = GetClosestPoint(simplex);
+                T const sqrLengthNext = Dot(vNext, vNext);
+                if (simplex.numVertices == 4 || sqrLengthNext <= mTolerance * mTolerance * maxSqrLength)
+                {
+                    v = vNext;
+                    sqrLength = sqrLengthNext;
+                    coresIntersect = true;
+                    break;
+                }
+
+                if (sqrLengthNext >= sqrLength)
+                {
+                    // Rounding errors prevent progress.
+                    break;
+                }
+                v = vNext;
+                sqrLength = sqrLengthNext;
+            }
+
+            if (cache)
+            {
+                cache->numVertices = simplex.numVertices;
+                for (size_t i = 0; i < simplex.numVertices; ++i)
+                {
+                    cache->direction[i] = simplex.vertex[i].direction;
+                }
+            }
+
+            T const margin = margin0 + margin1;
+            if (!coresIntersect && sqrLength > static_cast<T>(0))
+            {
+                // The closest points of the cores and the unit-length
+                // direction from core0 to core1.
+                Vector3<T> core0 = Vector3<T>::Zero(), core1 = Vector3<T>::Zero();
+                for (size_t i = 0; i < simplex.numVertices; ++i)
+                {
+                    core0 += simplex.lambda[i] * simplex.vertex[i].a;
+                    core1 += simplex.lambda[i] * simplex.vertex[i].b;
+                }
+                T const length = std::sqrt(sqrLength);
+                result.normal = -v / length;
+                result.closest[0] = core0 + margin0 * result.normal;
+                result.closest[1] = core1 - margin1 * result.normal;
+                if (length > margin)
+                {
+                    result.intersect = false;
+                    result.distance = length - margin;
+                }
+                else
+                {
+                    result.intersect = true;
+                    result.depth = margin - length;
+                }
+                return result;
+            }
+
+            // The cores intersect or touch.
+            result.intersect = true;
+            ComputePenetration(support, simplex, result);
+            result.closest[0] += margin0 * result.normal;
+            result.closest[1] -= margin1 * result.normal;
+            result.depth += margin;
+            return result;
+        }
+
+    private:
+        // A vertex of the Minkowski difference of the cores, w = a - b,
+        // where a is the support point of core0 for 'direction' and b is the
+        // support point of core1 for -direction.
+        struct Vertex
+        {
+            Vertex()
+                :
+                direction(Vector3<T>::Zero()),
+                a(Vector3<T>::Zero()),
+                b(Vector3<T>::Zero()),
+                w(Vector3<T>::Zero())
+            {
+            }
+
+            Vector3<T> direction, a, b, w;
+        };
+
+        struct Simplex
+        {
+            Simplex()
+                :
+                numVertices(0),
+                vertex{},
+                lambda{}
+            {
+            }
+
+            size_t numVertices;
+            std::array<Vertex, 4> vertex;
+            std::array<T, 4> lambda;
+        };
+
+        // Compute the point of the simplex closest to the origin. The
+        // simplex is reduced to the smallest subsimplex that contains the
+        // point and lambda[] is set to its barycentric coordinates. A
+        // tetrahedron containing the origin is not reduced.
+        static Vector3<T> GetClosestPoint(Simplex& simplex)
+        {
+            T const zero = static_cast<T>(0), one = static_cast<T>(1);
+            std::array<size_t, 3> keep{};
+            std::array<T, 3> bary{};
+            size_t numKeep = 0;
+
+            switch (simplex.numVertices)
+            {
+            case 1:
+                simplex.lambda[0] = one;
+                return simplex.vertex[0].w;
+
+            case 2:
+                numKeep = GetClosestOnSegment(simplex, 0, 1, keep, bary);
+                break;
+
+            case 3:
+                numKeep = GetClosestOnTriangle(simplex, 0, 1, 2, keep, bary);
+                break;
+
+            default:
+            {
+                // The origin is inside the tetrahedron unless it is strictly
+                // outside a face plane, in which case the closest point is on
+                // one of those faces.
+                static std::array<std::array<size_t, 4>, 4> const face =
+                { {
+                    { 1, 2, 3, 0 }, { 0, 3, 2, 1 }, { 0, 1, 3, 2 }, { 0, 2, 1, 3 }
+                } };
+
+                auto const& W = simplex.vertex;
+                T const volume = Dot(W[1].w - W[0].w, Cross(W[2].w - W[0].w, W[3].w - W[0].w));
+                bool const degenerate = (volume == zero);
+
+                T minSqrLength = std::numeric_limits<T>::max();
+                bool outside = degenerate;
+                for (size_t f = 0; f < 4; ++f)
+                {
+                    auto const& F = face[f];
+                    Vector3<T> const normal = Cross(W[F[1]].w - W[F[0]].w, W[F[2]].w - W[F[0]].w);
+                    T const sOrigin = -Dot(normal, W[F[0]].w);
+                    T const sOpposite = Dot(normal, W[F[3]].w - W[F[0]].w);
+                    if (degenerate || sOrigin * sOpposite < zero)
+                    {
+                        outside = true;
+                        std::array<size_t, 3> faceKeep{};
+                        std::array<T, 3> faceBary{};
+                        size_t const numFaceKeep = GetClosestOnTriangle(simplex,
+                            F[0], F[1], F[2], faceKeep, faceBary);
+                        Vector3<T> point = Vector3<T>::Zero();
+                        for (size_t i = 0; i < numFaceKeep; ++i)
+                        {
+                            point += faceBary[i] * W[faceKeep[i]].w;
+                        }
+
+                        T const sqrLength = Dot(point, point);
+                        if (sqrLength < minSqrLength)
+                        {
+                            minSqrLength = sqrLength;
+                            numKeep = numFaceKeep;
+                            keep = faceKeep;
+                            bary = faceBary;
+                        }
+                    }
+                }
+
+                if (!outside)
+                {
+                    return Vector3<T>::Zero();
+                }
+                break;
+            }
+            }
+
+            Simplex reduced{};
+            reduced.numVertices = numKeep;
+            Vector3<T> point = Vector3<T>::Zero();
+            for (size_t i = 0; i < numKeep; ++i)
+            {
+                reduced.vertex[i] = simplex.vertex[keep[i]];
+                reduced.lambda[i] = bary[i];
+                point += bary[i] * reduced.vertex[i].w;
+            }
+            simplex = reduced;
+            return point;
+        }
+
+        static size_t GetClosestOnSegment(Simplex const& simplex, size_t i0, size_t i1,
+            std::array<size_t, 3>& keep, std::array<T, 3>& bary)
+        {
+            T const zero = static_cast<T>(0), one = static_cast<T>(1);
+            Vector3<T> const& A = simplex.vertex[i0].w;
+            Vector3<T> const& B = simplex.vertex[i1].w;
+            Vector3<T> const AB = B - A;
+            T const numer = -Dot(A, AB);
+            T const denom = Dot(AB, AB);
+            if (numer <= zero || denom == zero)
+            {
+                keep[0] = i0;
+                bary[0] = one;
+                return 1;
+            }
+            if (numer >= denom)
+            {
+                keep[0] = i1;
+                bary[0] = one;
+                return 1;
+            }
+            T const t = numer / denom;
+            keep[0] = i0;
+            keep[1] = i1;
+            bary[0] = one - t;
+            bary[1] = t;
+            return 2;
+        }
+
+        // The Voronoi region tests of Ericson, "Real-Time Collision
+        // Detection", Section 5.1.5, for the point at the origin.
+        static size_t GetClosestOnTriangle(Simplex const& simplex, size_t i0, size_t i1, size_t i2,
+            std::array<size_t, 3>& keep, std::array<T, 3>& bary)
+        {
+            T const zero = static_cast<T>(0), one = static_cast<T>(1);
+            Vector3<T> const& A = simplex.vertex[i0].w;
+            Vector3<T> const& B = simplex.vertex[i1].w;
+            Vector3<T> const& C = simplex.vertex[i2].w;
+            Vector3<T> const AB = B - A, AC = C - A;
+
+            T const d1 = -Dot(AB, A), d2 = -Dot(AC, A);
+            if (d1 <= zero && d2 <= zero)
+            {
+                keep[0] = i0;
+                bary[0] = one;
+                return 1;
+            }
+
+            T const d3 = -Dot(AB, B), d4 = -Dot(AC, B);
+            if (d3 >= zero && d4 <= d3)
+            {
+                keep[0] = i1;
+                bary[0] = one;
+                return 1;
+            }
+
+            T const vc = d1 * d4 - d3 * d2;
+            if (vc <= zero && d1 >= zero && d3 <= zero)
+            {
+                T const t = d1 / (d1 - d3);
+                keep[0] = i0;
+                keep[1] = i1;
+                bary[0] = one - t;
+                bary[1] = t;
+                return 2;
+            }
+
+            T const d5 = -Dot(AB, C), d6 = -Dot(AC, C);
+            if (d6 >= zero && d5 <= d6)
+            {
+                keep[0] = i2;
+                bary[0] = one;
+                return 1;
+            }
+
+            T const vb = d5 * d2 - d1 * d6;
+            if (vb <= zero && d2 >= zero && d6 <= zero)
+            {
+                T const t = d2 / (d2 - d6);
+                keep[0] = i0;
+                keep[1] = i2;
+                bary[0] = one - t;
+                bary[1] = t;
+                return 2;
+            }
+
+            T const va = d3 * d6 - d5 * d4;
+            if (va <= zero && (d4 - d3) >= zero && (d5 - d6) >= zero)
+            {
+                T const t = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+                keep[0] = i1;
+                keep[1] = i2;
+                bary[0] = one - t;
+                bary[1] = t;
+                return 2;
+            }
+
+            T const sum = va + vb + vc;
+            if (sum <= zero)
+            {
+                // The triangle is degenerate, so the closest point is on
+                // its longest edge.
+                size_t numKeep = GetClosestOnSegment(simplex, i0, i1, keep, bary);
+                std::array<size_t, 3> edgeKeep{};
+                std::array<T, 3> edgeBary{};
+                T minSqrLength = GetSqrLength(simplex, numKeep, keep, bary);
+                for (auto const& edge : { std::make_pair(i0, i2), std::make_pair(i1, i2) })
+                {
+                    size_t const numEdgeKeep = GetClosestOnSegment(simplex,
+                        edge.first, edge.second, edgeKeep, edgeBary);
+                    T const sqrLength = GetSqrLength(simplex, numEdgeKeep, edgeKeep, edgeBary);
+                    if (sqrLength < minSqrLength)
+                    {
+                        minSqrLength = sqrLength;
+                        numKeep = numEdgeKeep;
+                        keep = edgeKeep;
+                        bary = edgeBary;
+                    }
+                }
+                return numKeep;
+            }
+
+            T const v = vb / sum, w = vc / sum;
+            keep[0] = i0;
+            keep[1] = i1;
+            keep[2] = i2;
+            bary[0] = one - v - w;
+            bary[1] = v;
+            bary[2] = w;
+            return 3;
+        }
+
+        static T GetSqrLength(Simplex const& simplex, size_t numKeep,
+            std::array<size_t, 3> const& keep, std::array<T, 3> const& bary)
+        {
+            Vector3<T> point = Vector3<T>::Zero();
+            for (size_t i = 0; i < numKeep; ++i)
+            {
+                point += bary[i] * simplex.vertex[keep[i]].w;
+            }
+            return Dot(point, point);
+        }
+
+        // A triangle face of the EPA polytope. The vertices are
+        // counterclockwise when viewed from outside the polytope, 'normal'
+        // is the unit-length outer normal and 'distance' is the signed
+        // distance from the origin to the plane of the face.
+        struct Face
+        {
+            std::array<size_t, 3> v;
+            Vector3<T> normal;
+            T distance;
+            bool removed;
+        };
+
+        template <typename Support>
+        void ComputePenetration(Support const& support, Simplex const& simplex, Result& result) const
+        {
+            T const zero = static_cast<T>(0);
+            std::vector<Vertex> vertices(simplex.vertex.begin(),
+                simplex.vertex.begin() + simplex.numVertices);
+
+            // Grow the simplex to a tetrahedron. The cores touch or
+            // intersect, so for a degenerate Minkowski difference the depth
+            // is zero.
+            if (!CompleteTetrahedron(support, vertices))
+            {
+                SetContact(vertices, nullptr, result);
+                return;
+            }
+
+            std::vector<Face> faces{};
+            faces.reserve(64);
+            std::array<std::array<size_t, 3>, 4> const tetrahedron =
+            { {
+                { 0, 1, 2 }, { 0, 3, 1 }, { 0, 2, 3 }, { 1, 3, 2 }
+            } };
+            bool const flip = (Dot(vertices[1].w - vertices[0].w, Cross(
+                vertices[2].w - vertices[0].w, vertices[3].w - vertices[0].w)) > zero);
+            for (auto const& tri : tetrahedron)
+            {
+                faces.push_back(MakeFace(vertices, tri[0], flip ? tri[2] : tri[1],
+                    flip ? tri[1] : tri[2]));
+            }
+
+            std::vector<std::array<size_t, 2>> horizon{};
+            Face const* nearest = nullptr;
+            for (size_t iteration = 0; iteration < mMaxEPAIterations; ++iteration)
+            {
+                nearest = nullptr;
+                for (auto const& face : faces)
+                {
+                    if (!face.removed && (!nearest || face.distance < nearest->distance))
+                    {
+                        nearest = &face;
+                    }
+                }
+                if (!nearest || nearest->distance == std::numeric_limits<T>::max())
+                {
+                    break;
+                }
+
+                // The depth is at most the support distance in the direction
+                // of the nearest face normal.
+                Vertex w{};
+                support(nearest->normal, w);
+                T const upper = Dot(nearest->normal, w.w);
+                if (upper - nearest->distance <= mTolerance * std::max(upper, static_cast<T>(1)))
+                {
+                    break;
+                }
+
+                // Remove the faces visible from w and connect w to the
+                // horizon, the boundary of the removed faces.
+                size_t const index = vertices.size();
+                vertices.push_back(w);
+                horizon.clear();
+                for (auto& face : faces)
+                {
+                    if (!face.removed && Dot(face.normal, w.w - vertices[face.v[0]].w) > zero)
+                    {
+                        face.removed = true;
+                        for (size_t j0 = 2, j1 = 0; j1 < 3; j0 = j1++)
+                        {
+                            std::array<size_t, 2> const edge = { face.v[j0], face.v[j1] };
+                            auto iter = std::find(horizon.begin(), horizon.end(),
+                                std::array<size_t, 2>{ edge[1], edge[0] });
+                            if (iter != horizon.end())
+                            {
+                                *iter = horizon.back();
+                                horizon.pop_back();
+                            }
+                            else
+                            {
+                                horizon.push_back(edge);
+                            }
+                        }
+                    }
+                }
+
+                if (horizon.empty())
+                {
+                    break;
+                }
+
+                faces.erase(std::remove_if(faces.begin(), faces.end(),
+                    [](Face const& face) { return face.removed; }), faces.end());
+                for (auto const& edge : horizon)
+                {
+                    faces.push_back(MakeFace(vertices, edge[0], edge[1], index));
+                }
+                nearest = nullptr;
+            }
+
+            if (!nearest)
+            {
+                for (auto const& face : faces)
+                {
+                    if (!face.removed && (!nearest || face.distance < nearest->distance))
+                    {
+                        nearest = &face;
+                    }
+                }
+            }
+            SetContact(vertices, nearest, result);
+        }
+
+        template <typename Support>
+        static bool CompleteTetrahedron(Support const& support, std::vector<Vertex>& vertices)
+        {
+            T const zero = static_cast<T>(0);
+            Vertex w{};
+
+            if (vertices.size() == 1)
+            {
+                for (int32_t i = 0; i < 6 && vertices.size() == 1; ++i)
+                {
+                    Vector3<T> direction = Vector3<T>::Unit(i >> 1);
+                    support((i & 1) ? -direction : direction, w);
+                    if (w.w != vertices[0].w)
+                    {
+                        vertices.push_back(w);
+                    }
+                }
+                if (vertices.size() == 1)
+                {
+                    return false;
+                }
+            }
+
+            if (vertices.size() == 2)
+            {
+                std::array<Vector3<T>, 3> basis{};
+                basis[0] = vertices[1].w - vertices[0].w;
+                ComputeOrthogonalComplement(1, basis.data());
+                for (int32_t i = 0; i < 4 && vertices.size() == 2; ++i)
+                {
+                    Vector3<T> direction = basis[1 + (i >> 1)];
+                    support((i & 1) ? -direction : direction, w);
+                    if (Cross(vertices[1].w - vertices[0].w, w.w - vertices[0].w) != Vector3<T>::Zero())
+                    {
+                        vertices.push_back(w);
+                    }
+                }
+                if (vertices.size() == 2)
+                {
+                    return false;
+                }
+            }
+
+            if (vertices.size() == 3)
+            {
+                Vector3<T> const normal = Cross(vertices[1].w - vertices[0].w,
+                    vertices[2].w - vertices[0].w);
+                for (int32_t i = 0; i < 2 && vertices.size() == 3; ++i)
+                {
+                    support(i == 0 ? normal : -normal, w);
+                    if (Dot(normal, w.w - vertices[0].w) != zero)
+                    {
+                        vertices.push_back(w);
+                    }
+                }
+                if (vertices.size() == 3)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        static Face MakeFace(std::vector<Vertex> const& vertices, size_t v0, size_t v1, size_t v2)
+        {
+            Face face{};
+            face.v = { v0, v1, v2 };
+            face.normal = Cross(vertices[v1].w - vertices[v0].w, vertices[v2].w - vertices[v0].w);
+            face.removed = false;
+            if (Normalize(face.normal) > static_cast<T>(0))
+            {
+                face.distance = Dot(face.normal, vertices[v0].w);
+            }
+            else
+            {
+                face.distance = std::numeric_limits<T>::max();
+            }
+            return face;
+        }
+
+        // The contact points are the combinations of the support points of
+        // the cores with the barycentric coordinates of the projection of
+        // the origin onto the nearest face. For a degenerate polytope the
+        // depth is zero and the first vertex is used.
+        static void SetContact(std::vector<Vertex> const& vertices, Face const* face, Result& result)
+        {
+            T const zero = static_cast<T>(0), one = static_cast<T>(1);
+            if (!face || face->distance == std::numeric_limits<T>::max())
+            {
+                result.depth = zero;
+                result.normal = Vector3<T>::Unit(0);
+                result.closest[0] = vertices[0].a;
+                result.closest[1] = vertices[0].b;
+                return;
+            }
+
+            Vector3<T> const& A = vertices[face->v[0]].w;
+            Vector3<T> const& B = vertices[face->v[1]].w;
+            Vector3<T> const& C = vertices[face->v[2]].w;
+            Vector3<T> const P = face->distance * face->normal;
+            T const area = Dot(face->normal, Cross(B - A, C - A));
+            std::array<T, 3> bary{};
+            if (area > zero)
+            {
+                bary[1] = Dot(face->normal, Cross(C - A, P - A)) / area;
+                bary[2] = Dot(face->normal, Cross(P - A, B - A)) / area;
+                bary[0] = one - bary[1] - bary[2];
+            }
+            else
+            {
+                bary = { one, zero, zero };
+            }
+
+            result.depth = std::max(face->distance, zero);
+            result.normal = face->normal;
+            result.closest[0] = Vector3<T>::Zero();
+            result.closest[1] = Vector3<T>::Zero();
+            for (size_t i = 0; i < 3; ++i)
+            {
+                result.closest[0] += bary[i] * vertices[face->v[i]].a;
+                result.closest[1] += bary[i] * vertices[face->v[i]].b;
+            }
+        }
+
+        T mTolerance;
+        size_t mMaxGJKIterations, mMaxEPAIterations;
+    };
+}
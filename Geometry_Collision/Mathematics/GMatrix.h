@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Mathematics/GVector.h>
+#include <Mathematics/BlockedMatrixKernels.h>
 #include <Mathematics/GaussianElimination.h>
 #include <algorithm>
 
@@ -98,30 +99,25 @@ namespace gte
             return static_cast<int32_t>(mElements.size());
         }
 
+        // The index checks follow the GTE_VALIDATION policy of Logger.h.
         inline Real const& operator()(int32_t r, int32_t c) const
         {
-            if (0 <= r && r < GetNumRows() && 0 <= c && c < GetNumCols())
-            {
+            LogAssert(0 <= r && r < GetNumRows() && 0 <= c && c < GetNumCols(), "Invalid index.");
 #if defined(GTE_USE_ROW_MAJOR)
-                return mElements[c + static_cast<size_t>(mNumCols) * r];
+            return mElements[c + static_cast<size_t>(mNumCols) * r];
 #else
-                return mElements[r + static_cast<size_t>(mNumRows) * c];
+            return mElements[r + static_cast<size_t>(mNumRows) * c];
 #endif
-            }
-            LogError("Invalid index.");
         }
 
         inline Real& operator()(int32_t r, int32_t c)
         {
-            if (0 <= r && r < GetNumRows() && 0 <= c && c < GetNumCols())
-            {
+            LogAssert(0 <= r && r < GetNumRows() && 0 <= c && c < GetNumCols(), "Invalid index.");
 #if defined(GTE_USE_ROW_MAJOR)
-                return mElements[c + static_cast<size_t>(mNumCols) * r];
+            return mElements[c + static_cast<size_t>(mNumCols) * r];
 #else
-                return mElements[r + static_cast<size_t>(mNumRows) * c];
+            return mElements[r + static_cast<size_t>(mNumRows) * c];
 #endif
-            }
-            LogError("Invalid index.");
         }
 
         // Member access by rows or by columns.  The input vectors must have
@@ -530,6 +526,35 @@ namespace gte
         LogError("Mismatched sizes.");
     }
 
+    // Compute result = op(A)*op(B), where op(M) is M^T when transposeM is
+    // true, M otherwise, and result has the size of the product. The
+    // product is computed by BlockedMatrixKernels on the storage of the
+    // matrices, with the same floating-point operations as the loops
+    //   result(r,c) = 0; result(r,c) += op(A)(r,i) * op(B)(i,c), i = 0,1,...
+    // For column-major storage, the storage of a matrix is the row-major
+    // storage of its transpose, and the storage of the result is that of
+    // op(B)^T*op(A)^T.
+    template <typename Real>
+    void MultiplyStorage(GMatrix<Real> const& A, bool transposeA,
+        GMatrix<Real> const& B, bool transposeB, int32_t numCommon,
+        GMatrix<Real>& result)
+    {
+        if (result.GetNumElements() == 0 || numCommon == 0)
+        {
+            return;
+        }
+
+#if defined(GTE_USE_ROW_MAJOR)
+        BlockedMatrixKernels<Real>::Multiply(result.GetNumRows(), result.GetNumCols(),
+            numCommon, &A[0], A.GetNumCols(), transposeA, &B[0], B.GetNumCols(),
+            transposeB, &result[0], result.GetNumCols());
+#else
+        BlockedMatrixKernels<Real>::Multiply(result.GetNumCols(), result.GetNumRows(),
+            numCommon, &B[0], B.GetNumRows(), transposeB, &A[0], A.GetNumRows(),
+            transposeA, &result[0], result.GetNumRows());
+#endif
+    }
+
     // A*B
     template <typename Real>
     GMatrix<Real> operator*(GMatrix<Real> const& A, GMatrix<Real> const& B)
@@ -543,18 +568,7 @@ namespace gte
         if (A.GetNumCols() == B.GetNumRows())
         {
             GMatrix<Real> result(A.GetNumRows(), B.GetNumCols());
-            int32_t const numCommon = A.GetNumCols();
-            for (int32_t r = 0; r < result.GetNumRows(); ++r)
-            {
-                for (int32_t c = 0; c < result.GetNumCols(); ++c)
-                {
-                    result(r, c) = (Real)0;
-                    for (int32_t i = 0; i < numCommon; ++i)
-                    {
-                        result(r, c) += A(r, i) * B(i, c);
-                    }
-                }
-            }
+            MultiplyStorage(A, false, B, false, A.GetNumCols(), result);
             return result;
         }
         LogError("Mismatched sizes.");
@@ -567,18 +581,7 @@ namespace gte
         if (A.GetNumCols() == B.GetNumCols())
         {
             GMatrix<Real> result(A.GetNumRows(), B.GetNumRows());
-            int32_t const numCommon = A.GetNumCols();
-            for (int32_t r = 0; r < result.GetNumRows(); ++r)
-            {
-                for (int32_t c = 0; c < result.GetNumCols(); ++c)
-                {
-                    result(r, c) = (Real)0;
-                    for (int32_t i = 0; i < numCommon; ++i)
-                    {
-                        result(r, c) += A(r, i) * B(c, i);
-                    }
-                }
-            }
+            MultiplyStorage(A, false, B, true, A.GetNumCols(), result);
             return result;
         }
         LogError("Mismatched sizes.");
@@ -591,18 +594,7 @@ namespace gte
         if (A.GetNumRows() == B.GetNumRows())
         {
             GMatrix<Real> result(A.GetNumCols(), B.GetNumCols());
-            int32_t const numCommon = A.GetNumRows();
-            for (int32_t r = 0; r < result.GetNumRows(); ++r)
-            {
-                for (int32_t c = 0; c < result.GetNumCols(); ++c)
-                {
-                    result(r, c) = (Real)0;
-                    for (int32_t i = 0; i < numCommon; ++i)
-                    {
-                        result(r, c) += A(i, r) * B(i, c);
-                    }
-                }
-            }
+            MultiplyStorage(A, true, B, false, A.GetNumRows(), result);
             return result;
         }
         LogError("Mismatched sizes.");
@@ -615,18 +607,7 @@ namespace gte
         if (A.GetNumRows() == B.GetNumCols())
         {
             GMatrix<Real> result(A.GetNumCols(), B.GetNumRows());
-            int32_t const numCommon = A.GetNumRows();
-            for (int32_t r = 0; r < result.GetNumRows(); ++r)
-            {
-                for (int32_t c = 0; c < result.GetNumCols(); ++c)
-                {
-                    result(r, c) = (Real)0;
-                    for (int32_t i = 0; i < numCommon; ++i)
-                    {
-                        result(r, c) += A(i, r) * B(c, i);
-                    }
-                }
-            }
+            MultiplyStorage(A, true, B, true, A.GetNumRows(), result);
             return result;
         }
         LogError("Mismatched sizes.");
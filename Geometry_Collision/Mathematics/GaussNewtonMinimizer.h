@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <Mathematics/BatchedNormalEquations.h>
 #include <Mathematics/CholeskyDecomposition.h>
 #include <functional>
+#include <memory>
 
 // Let F(p) = (F_{0}(p), F_{1}(p), ..., F_{n-1}(p)) be a vector-valued
 // function of the parameters p = (p_{0}, p_{1}, ..., p_{m-1}).  The
@@ -66,6 +68,7 @@ namespace gte
         typedef std::function<void(DVector const&, RVector&)> FFunction;
         typedef std::function<void(DVector const&, JMatrix&)> JFunction;
         typedef std::function<void(DVector const&, JTJMatrix&, JTFVector&)> JPlusFunction;
+        typedef typename BatchedNormalEquations<T>::BatchFunction BatchFunction;
 
         // Create the minimizer that computes F(p) and J(p) directly.
         GaussNewtonMinimizer(int32_t numPDimensions, int32_t numFDimensions,
@@ -80,6 +83,7 @@ namespace gte
             mJTJ(mNumPDimensions, mNumPDimensions),
             mNegJTF(mNumPDimensions),
             mDecomposer(mNumPDimensions),
+            mBatch{},
             mUseJFunction(true)
         {
             LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
@@ -98,11 +102,33 @@ namespace gte
             mJTJ(mNumPDimensions, mNumPDimensions),
             mNegJTF(mNumPDimensions),
             mDecomposer(mNumPDimensions),
+            mBatch{},
             mUseJFunction(false)
         {
             LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
         }
 
+        // Create the minimizer that evaluates blocks of components of F(p)
+        // and rows of J(p) by a batch function and accumulates J^T(p)*J(p)
+        // and -J^T(p)*F(p) from them; see BatchedNormalEquations.h. The
+        // Jacobian is not stored, and for numThreads > 0 the blocks are
+        // processed by multiple threads.
+        GaussNewtonMinimizer(int32_t numPDimensions, int32_t numFDimensions,
+            BatchFunction const& inBatchFunction, size_t numThreads = 0)
+            :
+            mNumPDimensions(numPDimensions),
+            mNumFDimensions(numFDimensions),
+            mF{},
+            mJ{},
+            mJTJ(mNumPDimensions, mNumPDimensions),
+            mNegJTF(mNumPDimensions),
+            mDecomposer(mNumPDimensions),
+            mBatch(std::make_unique<BatchedNormalEquations<T>>(numPDimensions,
+                numFDimensions, inBatchFunction, numThreads)),
+            mUseJFunction(false)
+        {
+        }
+
         // Disallow copy, assignment and move semantics.
         GaussNewtonMinimizer(GaussNewtonMinimizer const&) = delete;
         GaussNewtonMinimizer& operator=(GaussNewtonMinimizer const&) = delete;
@@ -157,8 +183,7 @@ namespace gte
             errorDifferenceTolerance = std::max(errorDifferenceTolerance, (T)0);
 
             // Compute the initial error.
-            mFFunction(p0, mF);
-            result.minError = Dot(mF, mF);
+            result.minError = ComputeError(p0);
 
             // Do the Gauss-Newton iterations.
             auto pCurrent = p0;
@@ -177,8 +202,7 @@ namespace gte
                 mDecomposer.SolveUpper(mJTJ, mNegJTF);
 
                 auto pNext = pCurrent + mNegJTF;
-                mFFunction(pNext, mF);
-                T error = Dot(mF, mF);
+                T error = ComputeError(pNext);
                 if (error < result.minError)
                 {
                     result.minErrorDifference = result.minError - error;
@@ -200,9 +224,26 @@ namespace gte
         }
 
     private:
+        T ComputeError(DVector const& p)
+        {
+            if (mBatch)
+            {
+                return mBatch->ComputeError(p);
+            }
+            else
+            {
+                mFFunction(p, mF);
+                return Dot(mF, mF);
+            }
+        }
+
         void ComputeLinearSystemInputs(DVector const& pCurrent)
         {
-            if (mUseJFunction)
+            if (mBatch)
+            {
+                mBatch->Compute(pCurrent, mJTJ, mNegJTF);
+            }
+            else if (mUseJFunction)
             {
                 mJFunction(pCurrent, mJ);
                 mJTJ = MultiplyATB(mJ, mJ);
@@ -226,6 +267,7 @@ namespace gte
         JTFVector mNegJTF;
 
         CholeskyDecomposition<T> mDecomposer;
+        std::unique_ptr<BatchedNormalEquations<T>> mBatch;
 
         bool mUseJFunction;
     };
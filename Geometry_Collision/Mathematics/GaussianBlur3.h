@@ -37,13 +37,34 @@ namespace gte
     protected:
         virtual void OnUpdateSingle(int32_t x, int32_t y, int32_t z) override
         {
-            this->LookUp7(x, y, z);
+            OnUpdateRow(x, x + 1, y, z);
+        }
+
+        virtual void OnUpdateRow(int32_t xmin, int32_t xsup, int32_t y, int32_t z) override
+        {
+            // The row pointers are named by their y and z offsets in {m,z,p}
+            // as in the member neighborhood mUxyz, so mUxyz is Ryz[x + dx].
+            auto const& F = this->mBuffer[this->mSrc];
+            Real const* Rzm = F[z - 1][y];
+            Real const* Rmz = F[z][y - 1];
+            Real const* Rzz = F[z][y];
+            Real const* Rpz = F[z][y + 1];
+            Real const* Rzp = F[z + 1][y];
+            Real* output = this->mBuffer[this->mDst][z][y];
 
-            Real uxx = this->mInvDxDx * (this->mUpzz - (Real)2 * this->mUzzz + this->mUmzz);
-            Real uyy = this->mInvDyDy * (this->mUzpz - (Real)2 * this->mUzzz + this->mUzmz);
-            Real uzz = this->mInvDzDz * (this->mUzzp - (Real)2 * this->mUzzz + this->mUzzm);
+            Real const invDxDx = this->mInvDxDx;
+            Real const invDyDy = this->mInvDyDy;
+            Real const invDzDz = this->mInvDzDz;
+            Real const timeStep = this->mTimeStep;
 
-            this->mBuffer[this->mDst][z][y][x] = this->mUzzz + this->mTimeStep * (uxx + uyy + uzz);
+            for (int32_t x = xmin; x < xsup; ++x)
+            {
+                Real const uzzz = Rzz[x];
+                Real uxx = invDxDx * (Rzz[x + 1] - (Real)2 * uzzz + Rzz[x - 1]);
+                Real uyy = invDyDy * (Rpz[x] - (Real)2 * uzzz + Rmz[x]);
+                Real uzz = invDzDz * (Rzp[x] - (Real)2 * uzzz + Rzm[x]);
+                output[x] = uzzz + timeStep * (uxx + uyy + uzz);
+            }
         }
 
         Real mMaximumTimeStep;
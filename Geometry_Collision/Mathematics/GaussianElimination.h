@@ -21,6 +21,11 @@
 // and X.  If you want to solve M*Y = C for Y, where X and C are NxK, pass
 // nonnull pointers for C and Y and pass K to numCols.  In all cases, pass
 // N to numRows.
+//
+// The elimination uses full pivoting and visits the entire matrix for each
+// pivot.  For large systems, BlockedMatrixKernels::FactorLU and SolveLU
+// solve with partial pivoting by cache-blocked updates, optionally on
+// multiple threads.
 
 namespace Vector_GM
 {
@@ -10,11 +10,11 @@
 #include <Mathematics/Vector2.h>
 #include <Mathematics/Vector3.h>
 #include <Mathematics/ETManifoldMesh.h>
+#include <Mathematics/TaskScheduler.h>
 #include <cstdint>
 #include <cstring>
 #include <functional>
 #include <set>
-#include <thread>
 
 // This class is an implementation of the barycentric mapping algorithm
 // described in Section 5.3 of the book
@@ -43,13 +43,13 @@ namespace gte
         // Construction and destruction.  Set the number of threads to 0 when
         // you want the code to run in the main thread of the applications.
         // Set the number of threads to a positive number when you want the
-        // code to run multithreaded on the CPU.  Derived classes that use the
-        // GPU ignore the number of threads, setting the constructor input to
-        // std::numeric_limits<uint32_t>::max().  Provide a callback when you
-        // want to monitor each iteration of the uv-solver.  The input to the
-        // progress callback is the current iteration; it starts at 1 and
-        // increases to the numIterations input to the operator() member
-        // function.
+        // code to run multithreaded on the CPU.  The derived class
+        // GPUGenerateMeshUV in Graphics/GPUGenerateMeshUV.h runs the solver
+        // on the GPU and uses the number of threads when its device is set
+        // to the CPU.  Provide a callback when you want to monitor each
+        // iteration of the uv-solver.  The input to the progress callback is
+        // the current iteration; it starts at 1 and increases to the
+        // numIterations input to the operator() member function.
         GenerateMeshUV(uint32_t numThreads,
             std::function<void(uint32_t)> const* progress = nullptr)
             :
@@ -125,7 +125,7 @@ namespace gte
 
     protected:
         // A CPU-based implementation is provided by this class.  The derived
-        // classes using the GPU override this function.
+        // class GPUGenerateMeshUV overrides this function.
         virtual void SolveSystemInternal(uint32_t numIterations)
         {
             if (mNumThreads > 1)
@@ -172,7 +172,7 @@ namespace gte
             int32_t range0, range1;
 
             // Unused on the CPU. The padding is necessary for the HLSL and
-            // GLSL programs in GPUGenerateMeshUV.h.
+            // GLSL programs in Graphics/GPUGenerateMeshUV.h.
             int32_t padding;
         };
 
@@ -620,11 +620,11 @@ namespace gte
                     (*mProgress)(i);
                 }
 
-                // Execute Gauss-Seidel iterations in multiple threads.
-                std::vector<std::thread> process(mNumThreads);
+                // Execute Gauss-Seidel iterations in multiple tasks.
+                TaskScheduler::TaskGroup group;
                 for (uint32_t t = 0; t < mNumThreads; ++t)
                 {
-                    process[t] = std::thread([this, t, &vmin, &vmax, inTCoords,
+                    group.Run([this, t, &vmin, &vmax, inTCoords,
                         outTCoords]()
                         {
                             for (int32_t j = vmin[t]; j <= vmax[t]; ++j)
@@ -648,11 +648,8 @@ namespace gte
                         });
                 }
 
-                // Wait for all threads to finish.
-                for (uint32_t t = 0; t < mNumThreads; ++t)
-                {
-                    process[t].join();
-                }
+                // Wait for all tasks to finish.
+                group.Wait();
 
                 std::swap(inTCoords, outTCoords);
             }
@@ -61,81 +61,113 @@ namespace gte
 
         virtual void OnUpdateSingle(int32_t x, int32_t y, int32_t z) override
         {
-            this->LookUp27(x, y, z);
-
-            // one-sided U-derivative estimates
-            Real uxFwd = this->mInvDx * (this->mUpzz - this->mUzzz);
-            Real uxBwd = this->mInvDx * (this->mUzzz - this->mUmzz);
-            Real uyFwd = this->mInvDy * (this->mUzpz - this->mUzzz);
-            Real uyBwd = this->mInvDy * (this->mUzzz - this->mUzmz);
-            Real uzFwd = this->mInvDz * (this->mUzzp - this->mUzzz);
-            Real uzBwd = this->mInvDz * (this->mUzzz - this->mUzzm);
-
-            // centered U-derivative estimates
-            Real duvzz = this->mHalfInvDx * (this->mUpzz - this->mUmzz);
-            Real duvpz = this->mHalfInvDx * (this->mUppz - this->mUmpz);
-            Real duvmz = this->mHalfInvDx * (this->mUpmz - this->mUmmz);
-            Real duvzp = this->mHalfInvDx * (this->mUpzp - this->mUmzp);
-            Real duvzm = this->mHalfInvDx * (this->mUpzm - this->mUmzm);
-
-            Real duzvz = this->mHalfInvDy * (this->mUzpz - this->mUzmz);
-            Real dupvz = this->mHalfInvDy * (this->mUppz - this->mUpmz);
-            Real dumvz = this->mHalfInvDy * (this->mUmpz - this->mUmmz);
-            Real duzvp = this->mHalfInvDy * (this->mUzpp - this->mUzmp);
-            Real duzvm = this->mHalfInvDy * (this->mUzpm - this->mUzmm);
-
-            Real duzzv = this->mHalfInvDz * (this->mUzzp - this->mUzzm);
-            Real dupzv = this->mHalfInvDz * (this->mUpzp - this->mUpzm);
-            Real dumzv = this->mHalfInvDz * (this->mUmzp - this->mUmzm);
-            Real duzpv = this->mHalfInvDz * (this->mUzpp - this->mUzpm);
-            Real duzmv = this->mHalfInvDz * (this->mUzmp - this->mUzmm);
-
-            Real uxCenSqr = duvzz * duvzz;
-            Real uyCenSqr = duzvz * duzvz;
-            Real uzCenSqr = duzzv * duzzv;
-
-            Real uxEst, uyEst, uzEst, gradMagSqr;
-
-            // estimate for C(x+1,y,z)
-            uyEst = (Real)0.5 *(duzvz + dupvz);
-            uzEst = (Real)0.5 *(duzzv + dupzv);
-            gradMagSqr = uxCenSqr + uyEst * uyEst + uzEst * uzEst;
-            Real cxp = std::exp(mMHalfParameter * gradMagSqr);
-
-            // estimate for C(x-1,y,z)
-            uyEst = (Real)0.5 *(duzvz + dumvz);
-            uzEst = (Real)0.5 *(duzzv + dumzv);
-            gradMagSqr = uxCenSqr + uyEst * uyEst + uzEst * uzEst;
-            Real cxm = std::exp(mMHalfParameter * gradMagSqr);
-
-            // estimate for C(x,y+1,z)
-            uxEst = (Real)0.5 *(duvzz + duvpz);
-            uzEst = (Real)0.5 *(duzzv + duzpv);
-            gradMagSqr = uxEst * uxEst + uyCenSqr + uzEst * uzEst;
-            Real cyp = std::exp(mMHalfParameter * gradMagSqr);
-
-            // estimate for C(x,y-1,z)
-            uxEst = (Real)0.5 *(duvzz + duvmz);
-            uzEst = (Real)0.5 *(duzzv + duzmv);
-            gradMagSqr = uxEst * uxEst + uyCenSqr + uzEst * uzEst;
-            Real cym = std::exp(mMHalfParameter * gradMagSqr);
-
-            // estimate for C(x,y,z+1)
-            uxEst = (Real)0.5 *(duvzz + duvzp);
-            uyEst = (Real)0.5 *(duzvz + duzvp);
-            gradMagSqr = uxEst * uxEst + uyEst * uyEst + uzCenSqr;
-            Real czp = std::exp(mMHalfParameter * gradMagSqr);
-
-            // estimate for C(x,y,z-1)
-            uxEst = (Real)0.5 *(duvzz + duvzm);
-            uyEst = (Real)0.5 *(duzvz + duzvm);
-            gradMagSqr = uxEst * uxEst + uyEst * uyEst + uzCenSqr;
-            Real czm = std::exp(mMHalfParameter * gradMagSqr);
-
-            this->mBuffer[this->mDst][z][y][x] = this->mUzzz + this->mTimeStep * (
-                cxp * uxFwd - cxm * uxBwd +
-                cyp * uyFwd - cym * uyBwd +
-                czp * uzFwd - czm * uzBwd);
+            OnUpdateRow(x, x + 1, y, z);
+        }
+
+        virtual void OnUpdateRow(int32_t xmin, int32_t xsup, int32_t y, int32_t z) override
+        {
+            // The row pointers are named by their y and z offsets in {m,z,p}
+            // as in the member neighborhood mUxyz, so mUxyz is Ryz[x + dx].
+            auto const& F = this->mBuffer[this->mSrc];
+            Real const* Rmm = F[z - 1][y - 1];
+            Real const* Rzm = F[z - 1][y];
+            Real const* Rpm = F[z - 1][y + 1];
+            Real const* Rmz = F[z][y - 1];
+            Real const* Rzz = F[z][y];
+            Real const* Rpz = F[z][y + 1];
+            Real const* Rmp = F[z + 1][y - 1];
+            Real const* Rzp = F[z + 1][y];
+            Real const* Rpp = F[z + 1][y + 1];
+            Real* output = this->mBuffer[this->mDst][z][y];
+
+            Real const invDx = this->mInvDx;
+            Real const invDy = this->mInvDy;
+            Real const invDz = this->mInvDz;
+            Real const halfInvDx = this->mHalfInvDx;
+            Real const halfInvDy = this->mHalfInvDy;
+            Real const halfInvDz = this->mHalfInvDz;
+            Real const minusHalfParameter = mMHalfParameter;
+            Real const timeStep = this->mTimeStep;
+
+            for (int32_t x = xmin; x < xsup; ++x)
+            {
+                int32_t const xm = x - 1, xp = x + 1;
+                Real const uzzz = Rzz[x];
+
+                // one-sided U-derivative estimates
+                Real uxFwd = invDx * (Rzz[xp] - uzzz);
+                Real uxBwd = invDx * (uzzz - Rzz[xm]);
+                Real uyFwd = invDy * (Rpz[x] - uzzz);
+                Real uyBwd = invDy * (uzzz - Rmz[x]);
+                Real uzFwd = invDz * (Rzp[x] - uzzz);
+                Real uzBwd = invDz * (uzzz - Rzm[x]);
+
+                // centered U-derivative estimates
+                Real duvzz = halfInvDx * (Rzz[xp] - Rzz[xm]);
+                Real duvpz = halfInvDx * (Rpz[xp] - Rpz[xm]);
+                Real duvmz = halfInvDx * (Rmz[xp] - Rmz[xm]);
+                Real duvzp = halfInvDx * (Rzp[xp] - Rzp[xm]);
+                Real duvzm = halfInvDx * (Rzm[xp] - Rzm[xm]);
+
+                Real duzvz = halfInvDy * (Rpz[x] - Rmz[x]);
+                Real dupvz = halfInvDy * (Rpz[xp] - Rmz[xp]);
+                Real dumvz = halfInvDy * (Rpz[xm] - Rmz[xm]);
+                Real duzvp = halfInvDy * (Rpp[x] - Rmp[x]);
+                Real duzvm = halfInvDy * (Rpm[x] - Rmm[x]);
+
+                Real duzzv = halfInvDz * (Rzp[x] - Rzm[x]);
+                Real dupzv = halfInvDz * (Rzp[xp] - Rzm[xp]);
+                Real dumzv = halfInvDz * (Rzp[xm] - Rzm[xm]);
+                Real duzpv = halfInvDz * (Rpp[x] - Rpm[x]);
+                Real duzmv = halfInvDz * (Rmp[x] - Rmm[x]);
+
+                Real uxCenSqr = duvzz * duvzz;
+                Real uyCenSqr = duzvz * duzvz;
+                Real uzCenSqr = duzzv * duzzv;
+
+                Real uxEst, uyEst, uzEst, gradMagSqr;
+
+                // estimate for C(x+1,y,z)
+                uyEst = (Real)0.5 *(duzvz + dupvz);
+                uzEst = (Real)0.5 *(duzzv + dupzv);
+                gradMagSqr = uxCenSqr + uyEst * uyEst + uzEst * uzEst;
+                Real cxp = std::exp(minusHalfParameter * gradMagSqr);
+
+                // estimate for C(x-1,y,z)
+                uyEst = (Real)0.5 *(duzvz + dumvz);
+                uzEst = (Real)0.5 *(duzzv + dumzv);
+                gradMagSqr = uxCenSqr + uyEst * uyEst + uzEst * uzEst;
+                Real cxm = std::exp(minusHalfParameter * gradMagSqr);
+
+                // estimate for C(x,y+1,z)
+                uxEst = (Real)0.5 *(duvzz + duvpz);
+                uzEst = (Real)0.5 *(duzzv + duzpv);
+                gradMagSqr = uxEst * uxEst + uyCenSqr + uzEst * uzEst;
+                Real cyp = std::exp(minusHalfParameter * gradMagSqr);
+
+                // estimate for C(x,y-1,z)
+                uxEst = (Real)0.5 *(duvzz + duvmz);
+                uzEst = (Real)0.5 *(duzzv + duzmv);
+                gradMagSqr = uxEst * uxEst + uyCenSqr + uzEst * uzEst;
+                Real cym = std::exp(minusHalfParameter * gradMagSqr);
+
+                // estimate for C(x,y,z+1)
+                uxEst = (Real)0.5 *(duvzz + duvzp);
+                uyEst = (Real)0.5 *(duzvz + duzvp);
+                gradMagSqr = uxEst * uxEst + uyEst * uyEst + uzCenSqr;
+                Real czp = std::exp(minusHalfParameter * gradMagSqr);
+
+                // estimate for C(x,y,z-1)
+                uxEst = (Real)0.5 *(duvzz + duvzm);
+                uyEst = (Real)0.5 *(duzvz + duzvm);
+                gradMagSqr = uxEst * uxEst + uyEst * uyEst + uzCenSqr;
+                Real czm = std::exp(minusHalfParameter * gradMagSqr);
+
+                output[x] = uzzz + timeStep * (
+                    cxp * uxFwd - cxm * uxBwd +
+                    cyp * uyFwd - cym * uyBwd +
+                    czp * uzFwd - czm * uzBwd);
+            }
         }
 
         // These are updated on each iteration, since they depend on the
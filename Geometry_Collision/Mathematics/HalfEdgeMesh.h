@@ -0,0 +1,585 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/ETManifoldMesh.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// The HalfEdgeMesh class represents an edge-triangle manifold mesh with
+// flat arrays indexed by integers, an alternative to ETManifoldMesh and
+// VETManifoldMesh for large meshes that are built once. Those classes store
+// each edge, triangle and vertex in its own heap allocation owned by a hash
+// map, which costs hundreds of bytes per triangle plus a hash lookup per
+// query. This class stores about 80 bytes per triangle and answers the
+// adjacency queries by array indexing.
+//
+// Triangle t has half-edges h = 3*t+i for 0 <= i < 3, where half-edge h is
+// directed from vertex V[i] to vertex V[(i+1)%3] of the triangle. The twin
+// of a half-edge is the other half-edge of the same undirected edge, or
+// 'invalid' for a boundary edge. The twin has the opposite direction when
+// the two triangles are consistently ordered; the mesh does not require
+// it, as ETManifoldMesh does not. The undirected edges are numbered in the
+// order of their sorted vertex pairs, and each vertex has the list of the
+// triangles that share it.
+//
+// The mesh is built in bulk: the 3*numTriangles half-edges are sorted by
+// their undirected vertex pairs, in parallel when numThreads is 2 or
+// larger, and the runs of equal pairs are the edges. The construction fails
+// when an edge is shared by more than two triangles. The mesh can be
+// created from an ETManifoldMesh or a VETManifoldMesh and converted back to
+// either of them.
+
+namespace gte
+{
+    class HalfEdgeMesh
+    {
+    public:
+        // Use -1 to denote an invalid index, as ETManifoldMesh and
+        // EdgeKey do.
+        static int32_t constexpr invalid = -1;
+
+        HalfEdgeMesh()
+            :
+            mNumVertices(0),
+            mTriangles{},
+            mTwin{},
+            mHalfEdgeToEdge{},
+            mEdges{},
+            mEdgeHalfEdges{},
+            mVertexOffsets{},
+            mVertexTriangles{}
+        {
+        }
+
+        // Create the mesh of the triangles, whose vertex indices must be in
+        // [0,numVertices). The function returns false and leaves the mesh
+        // empty when an index is out of range, when a triangle has a
+        // repeated vertex or when an edge is shared by more than two
+        // triangles. Set numThreads to 2 or larger to sort the half-edges
+        // on multiple threads. The result does not depend on numThreads.
+        bool Create(int32_t numVertices,
+            std::vector<std::array<int32_t, 3>> const& triangles,
+            size_t numThreads = 1)
+        {
+            Clear();
+            if (numVertices < 0)
+            {
+                return false;
+            }
+
+            for (auto const& tri : triangles)
+            {
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    if (tri[i] < 0 || tri[i] >= numVertices)
+                    {
+                        return false;
+                    }
+                }
+                if (tri[0] == tri[1] || tri[1] == tri[2] || tri[2] == tri[0])
+                {
+                    return false;
+                }
+            }
+
+            mNumVertices = numVertices;
+            mTriangles = triangles;
+            if (!CreateEdges(numThreads))
+            {
+                Clear();
+                return false;
+            }
+            CreateVertexTriangles();
+            return true;
+        }
+
+        // Create the mesh of the triangles of an ETManifoldMesh or a
+        // VETManifoldMesh. The number of vertices is 1 plus the largest
+        // vertex index. The triangles are ordered by their TriangleKey
+        // values, so the result does not depend on the hash map order.
+        bool Create(ETManifoldMesh const& mesh, size_t numThreads = 1)
+        {
+            std::vector<std::array<int32_t, 3>> triangles{};
+            triangles.reserve(mesh.GetTriangles().size());
+            int32_t numVertices = 0;
+            for (auto const& element : mesh.GetTriangles())
+            {
+                auto const& V = element.second->V;
+                triangles.push_back(V);
+                numVertices = std::max(numVertices, 1 + std::max(V[0], std::max(V[1], V[2])));
+            }
+            std::sort(triangles.begin(), triangles.end(),
+                [](std::array<int32_t, 3> const& tri0, std::array<int32_t, 3> const& tri1)
+                {
+                    return TriangleKey<true>(tri0[0], tri0[1], tri0[2])
+                        < TriangleKey<true>(tri1[0], tri1[1], tri1[2]);
+                });
+            return Create(numVertices, triangles, numThreads);
+        }
+
+        // Insert the triangles into an ETManifoldMesh or a VETManifoldMesh,
+        // which is cleared first. The insertion is virtual, so the vertex
+        // adjacency of a VETManifoldMesh is created as well.
+        void Convert(ETManifoldMesh& mesh) const
+        {
+            mesh.Clear();
+            for (auto const& tri : mTriangles)
+            {
+                mesh.Insert(tri[0], tri[1], tri[2]);
+            }
+        }
+
+        void Clear()
+        {
+            mNumVertices = 0;
+            mTriangles.clear();
+            mTwin.clear();
+            mHalfEdgeToEdge.clear();
+            mEdges.clear();
+            mEdgeHalfEdges.clear();
+            mVertexOffsets.clear();
+            mVertexTriangles.clear();
+        }
+
+        // Member access.
+        inline int32_t GetNumVertices() const
+        {
+            return mNumVertices;
+        }
+
+        inline int32_t GetNumTriangles() const
+        {
+            return static_cast<int32_t>(mTriangles.size());
+        }
+
+        inline int32_t GetNumEdges() const
+        {
+            return static_cast<int32_t>(mEdges.size());
+        }
+
+        inline int32_t GetNumHalfEdges() const
+        {
+            return static_cast<int32_t>(mTwin.size());
+        }
+
+        inline std::vector<std::array<int32_t, 3>> const& GetTriangles() const
+        {
+            return mTriangles;
+        }
+
+        // Half-edge queries. The input must satisfy
+        // 0 <= h < GetNumHalfEdges().
+        inline static int32_t GetTriangleOf(int32_t h)
+        {
+            return h / 3;
+        }
+
+        inline static int32_t GetNext(int32_t h)
+        {
+            return (h % 3 == 2 ? h - 2 : h + 1);
+        }
+
+        inline static int32_t GetPrevious(int32_t h)
+        {
+            return (h % 3 == 0 ? h + 2 : h - 1);
+        }
+
+        inline int32_t GetOrigin(int32_t h) const
+        {
+            return mTriangles[static_cast<size_t>(h / 3)][static_cast<size_t>(h % 3)];
+        }
+
+        inline int32_t GetDestination(int32_t h) const
+        {
+            return GetOrigin(GetNext(h));
+        }
+
+        inline int32_t GetTwin(int32_t h) const
+        {
+            return mTwin[static_cast<size_t>(h)];
+        }
+
+        inline int32_t GetEdgeOf(int32_t h) const
+        {
+            return mHalfEdgeToEdge[static_cast<size_t>(h)];
+        }
+
+        // Triangle queries, those of ETManifoldMesh::Triangle. Edge i and
+        // adjacent triangle i of triangle t are those of the edge
+        // <V[i],V[(i+1)%3]>. The adjacent triangle is 'invalid' for a
+        // boundary edge. The inputs must satisfy 0 <= t < GetNumTriangles()
+        // and 0 <= i < 3.
+        inline std::array<int32_t, 3> const& GetTriangle(int32_t t) const
+        {
+            return mTriangles[static_cast<size_t>(t)];
+        }
+
+        inline int32_t GetTriangleEdge(int32_t t, int32_t i) const
+        {
+            return GetEdgeOf(3 * t + i);
+        }
+
+        inline int32_t GetTriangleAdjacent(int32_t t, int32_t i) const
+        {
+            int32_t const twin = GetTwin(3 * t + i);
+            return (twin != invalid ? twin / 3 : invalid);
+        }
+
+        // The triangle adjacent to triangle t across the edge <u0,u1> in
+        // either direction, or 'invalid' when t has no such edge or the edge
+        // is a boundary edge.
+        int32_t GetAdjacentOfEdge(int32_t t, int32_t u0, int32_t u1) const
+        {
+            auto const& V = GetTriangle(t);
+            for (int32_t i0 = 2, i1 = 0; i1 < 3; i0 = i1++)
+            {
+                if ((V[i0] == u0 && V[i1] == u1) || (V[i0] == u1 && V[i1] == u0))
+                {
+                    return GetTriangleAdjacent(t, i0);
+                }
+            }
+            return invalid;
+        }
+
+        // Edge queries, those of ETManifoldMesh::Edge. The vertices are
+        // ordered as in EdgeKey<false>, the smaller index first. The second
+        // triangle is 'invalid' for a boundary edge. The input must satisfy
+        // 0 <= e < GetNumEdges().
+        inline std::array<int32_t, 2> const& GetEdge(int32_t e) const
+        {
+            return mEdges[static_cast<size_t>(e)];
+        }
+
+        inline std::array<int32_t, 2> GetEdgeTriangles(int32_t e) const
+        {
+            auto const& H = mEdgeHalfEdges[static_cast<size_t>(e)];
+            return { H[0] / 3, (H[1] != invalid ? H[1] / 3 : invalid) };
+        }
+
+        inline std::array<int32_t, 2> const& GetEdgeHalfEdges(int32_t e) const
+        {
+            return mEdgeHalfEdges[static_cast<size_t>(e)];
+        }
+
+        // The edge with vertices u0 and u1 in either order, or 'invalid'.
+        // The cost is proportional to the number of triangles sharing u0.
+        int32_t FindEdge(int32_t u0, int32_t u1) const
+        {
+            if (u0 < 0 || u0 >= mNumVertices)
+            {
+                return invalid;
+            }
+
+            int32_t const* tri = GetVertexTriangles(u0);
+            int32_t const* end = tri + GetNumVertexTriangles(u0);
+            for (; tri < end; ++tri)
+            {
+                for (int32_t i = 0; i < 3; ++i)
+                {
+                    int32_t const h = 3 * (*tri) + i;
+                    int32_t const v0 = GetOrigin(h), v1 = GetDestination(h);
+                    if ((v0 == u0 && v1 == u1) || (v0 == u1 && v1 == u0))
+                    {
+                        return GetEdgeOf(h);
+                    }
+                }
+            }
+            return invalid;
+        }
+
+        // Vertex queries, those of VETManifoldMesh::Vertex. The triangles
+        // sharing vertex v are stored contiguously in increasing order. The
+        // input must satisfy 0 <= v < GetNumVertices().
+        inline int32_t GetNumVertexTriangles(int32_t v) const
+        {
+            size_t const sv = static_cast<size_t>(v);
+            return mVertexOffsets[sv + 1] - mVertexOffsets[sv];
+        }
+
+        inline int32_t const* GetVertexTriangles(int32_t v) const
+        {
+            return mVertexTriangles.data() + mVertexOffsets[static_cast<size_t>(v)];
+        }
+
+        // The vertices and the edges adjacent to vertex v, in increasing
+        // order without duplicates.
+        void GetVertexAdjacents(int32_t v, std::vector<int32_t>& adjacents) const
+        {
+            adjacents.clear();
+            int32_t const* tri = GetVertexTriangles(v);
+            int32_t const* end = tri + GetNumVertexTriangles(v);
+            for (; tri < end; ++tri)
+            {
+                for (auto w : GetTriangle(*tri))
+                {
+                    if (w != v)
+                    {
+                        adjacents.push_back(w);
+                    }
+                }
+            }
+            std::sort(adjacents.begin(), adjacents.end());
+            adjacents.erase(std::unique(adjacents.begin(), adjacents.end()), adjacents.end());
+        }
+
+        void GetVertexEdges(int32_t v, std::vector<int32_t>& edges) const
+        {
+            edges.clear();
+            int32_t const* tri = GetVertexTriangles(v);
+            int32_t const* end = tri + GetNumVertexTriangles(v);
+            for (; tri < end; ++tri)
+            {
+                for (int32_t i = 0; i < 3; ++i)
+                {
+                    int32_t const h = 3 * (*tri) + i;
+                    if (GetOrigin(h) == v || GetDestination(h) == v)
+                    {
+                        edges.push_back(GetEdgeOf(h));
+                    }
+                }
+            }
+            std::sort(edges.begin(), edges.end());
+            edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+        }
+
+        // Global queries, those of ETManifoldMesh.
+        bool IsClosed() const
+        {
+            for (auto twin : mTwin)
+            {
+                if (twin == invalid)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        // The mesh is oriented when every interior edge is traversed in
+        // opposite directions by its triangles and the vertices opposite
+        // the edge are different.
+        bool IsOriented() const
+        {
+            for (auto const& H : mEdgeHalfEdges)
+            {
+                if (H[1] != invalid)
+                {
+                    if (GetOrigin(H[0]) == GetOrigin(H[1])
+                        || GetOrigin(GetPrevious(H[0])) == GetOrigin(GetPrevious(H[1])))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        // The connected components of the edge-triangle graph, each a list
+        // of triangle indices in the order of a depth-first search.
+        void GetComponents(std::vector<std::vector<int32_t>>& components) const
+        {
+            components.clear();
+            std::vector<uint8_t> visited(mTriangles.size(), 0);
+            std::vector<int32_t> stack{};
+            for (int32_t t = 0; t < GetNumTriangles(); ++t)
+            {
+                if (visited[static_cast<size_t>(t)] == 0)
+                {
+                    std::vector<int32_t> component{};
+                    visited[static_cast<size_t>(t)] = 1;
+                    stack.push_back(t);
+                    while (stack.size() > 0)
+                    {
+                        int32_t const current = stack.back();
+                        stack.pop_back();
+                        component.push_back(current);
+                        for (int32_t i = 0; i < 3; ++i)
+                        {
+                            int32_t const adjacent = GetTriangleAdjacent(current, i);
+                            if (adjacent != invalid && visited[static_cast<size_t>(adjacent)] == 0)
+                            {
+                                visited[static_cast<size_t>(adjacent)] = 1;
+                                stack.push_back(adjacent);
+                            }
+                        }
+                    }
+                    components.push_back(std::move(component));
+                }
+            }
+        }
+
+    private:
+        // A half-edge sorted by its undirected vertex pair, packed with the
+        // smaller index in the high bits. Ties are broken by the half-edge
+        // index so that the order does not depend on the sort.
+        struct SortKey
+        {
+            uint64_t edge;
+            int32_t h;
+
+            inline bool operator<(SortKey const& other) const
+            {
+                return edge < other.edge || (edge == other.edge && h < other.h);
+            }
+        };
+
+        bool CreateEdges(size_t numThreads)
+        {
+            size_t const numHalfEdges = 3 * mTriangles.size();
+            std::vector<SortKey> keys(numHalfEdges);
+            for (size_t h = 0; h < numHalfEdges; ++h)
+            {
+                int32_t const v0 = mTriangles[h / 3][h % 3];
+                int32_t const v1 = mTriangles[h / 3][(h + 1) % 3];
+                uint64_t const vmin = static_cast<uint64_t>(std::min(v0, v1));
+                uint64_t const vmax = static_cast<uint64_t>(std::max(v0, v1));
+                keys[h].edge = (vmin << 32) | vmax;
+                keys[h].h = static_cast<int32_t>(h);
+            }
+            SortKeys(keys, numThreads);
+
+            // The runs of equal vertex pairs are the edges.
+            mTwin.assign(numHalfEdges, static_cast<int32_t>(invalid));
+            mHalfEdgeToEdge.assign(numHalfEdges, static_cast<int32_t>(invalid));
+            mEdges.reserve(numHalfEdges / 2 + 1);
+            mEdgeHalfEdges.reserve(numHalfEdges / 2 + 1);
+            for (size_t first = 0; first < numHalfEdges; )
+            {
+                size_t last = first + 1;
+                while (last < numHalfEdges && keys[last].edge == keys[first].edge)
+                {
+                    ++last;
+                }
+                if (last - first > 2)
+                {
+                    // The edge is shared by three or more triangles.
+                    return false;
+                }
+
+                int32_t const e = static_cast<int32_t>(mEdges.size());
+                int32_t const h0 = keys[first].h;
+                int32_t const h1 = (last - first == 2 ? keys[first + 1].h : invalid);
+                mEdges.push_back({ static_cast<int32_t>(keys[first].edge >> 32),
+                    static_cast<int32_t>(keys[first].edge & 0xFFFFFFFFull) });
+                mEdgeHalfEdges.push_back({ h0, h1 });
+                mHalfEdgeToEdge[static_cast<size_t>(h0)] = e;
+                if (h1 != invalid)
+                {
+                    mHalfEdgeToEdge[static_cast<size_t>(h1)] = e;
+                    mTwin[static_cast<size_t>(h0)] = h1;
+                    mTwin[static_cast<size_t>(h1)] = h0;
+                }
+                first = last;
+            }
+            return true;
+        }
+
+        // Sort numThreads blocks of the keys on their own threads and merge
+        // the sorted blocks pairwise, also in parallel.
+        static void SortKeys(std::vector<SortKey>& keys, size_t numThreads)
+        {
+            size_t const numKeys = keys.size();
+            size_t const numBlocks = std::max(std::min(numThreads, numKeys / 4096), static_cast<size_t>(1));
+            if (numBlocks == 1)
+            {
+                std::sort(keys.begin(), keys.end());
+                return;
+            }
+
+            std::vector<size_t> bounds(numBlocks + 1);
+            for (size_t i = 0; i <= numBlocks; ++i)
+            {
+                bounds[i] = numKeys * i / numBlocks;
+            }
+
+            std::vector<std::thread> process(numBlocks);
+            for (size_t i = 0; i < numBlocks; ++i)
+            {
+                process[i] = std::thread([&keys, &bounds, i]()
+                {
+                    std::sort(keys.begin() + bounds[i], keys.begin() + bounds[i + 1]);
+                });
+            }
+            for (size_t i = 0; i < numBlocks; ++i)
+            {
+                process[i].join();
+            }
+
+            for (size_t width = 1; width < numBlocks; width *= 2)
+            {
+                std::vector<std::thread> merge{};
+                for (size_t i = 0; i + width < numBlocks; i += 2 * width)
+                {
+                    size_t const first = bounds[i];
+                    size_t const middle = bounds[i + width];
+                    size_t const last = bounds[std::min(i + 2 * width, numBlocks)];
+                    merge.emplace_back([&keys, first, middle, last]()
+                    {
+                        std::inplace_merge(keys.begin() + first, keys.begin() + middle,
+                            keys.begin() + last);
+                    });
+                }
+                for (auto& thread : merge)
+                {
+                    thread.join();
+                }
+            }
+        }
+
+        // Count the triangles of each vertex and store them contiguously.
+        void CreateVertexTriangles()
+        {
+            size_t const numVertices = static_cast<size_t>(mNumVertices);
+            mVertexOffsets.assign(numVertices + 1, 0);
+            for (auto const& tri : mTriangles)
+            {
+                for (auto v : tri)
+                {
+                    ++mVertexOffsets[static_cast<size_t>(v) + 1];
+                }
+            }
+            for (size_t v = 0; v < numVertices; ++v)
+            {
+                mVertexOffsets[v + 1] += mVertexOffsets[v];
+            }
+
+            std::vector<int32_t> next(mVertexOffsets.begin(), mVertexOffsets.end() - 1);
+            mVertexTriangles.resize(3 * mTriangles.size());
+            for (size_t t = 0; t < mTriangles.size(); ++t)
+            {
+                for (auto v : mTriangles[t])
+                {
+                    mVertexTriangles[static_cast<size_t>(next[static_cast<size_t>(v)]++)] =
+                        static_cast<int32_t>(t);
+                }
+            }
+        }
+
+        int32_t mNumVertices;
+        std::vector<std::array<int32_t, 3>> mTriangles;
+
+        // Per half-edge: the twin and the undirected edge.
+        std::vector<int32_t> mTwin;
+        std::vector<int32_t> mHalfEdgeToEdge;
+
+        // Per edge: the vertices and the half-edges, the second one
+        // 'invalid' for a boundary edge.
+        std::vector<std::array<int32_t, 2>> mEdges;
+        std::vector<std::array<int32_t, 2>> mEdgeHalfEdges;
+
+        // The triangles of vertex v are mVertexTriangles[i] for
+        // mVertexOffsets[v] <= i < mVertexOffsets[v + 1].
+        std::vector<int32_t> mVertexOffsets;
+        std::vector<int32_t> mVertexTriangles;
+    };
+}
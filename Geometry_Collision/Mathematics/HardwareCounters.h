@@ -0,0 +1,112 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <cstdint>
+
+// HardwareCounters reads the cache misses and branch mispredictions of the
+// calling thread from perf_event on Linux. On other platforms the class
+// compiles, IsAvailable() is false and the counts are zero, so it can be
+// used unconditionally next to the CycleProfiler.h timers.
+
+#if defined(__linux__)
+#define GTE_HARDWARE_COUNTERS_PERF_EVENT
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstring>
+#endif
+
+namespace Vector_GM
+{
+    // The cache misses and branch mispredictions of the calling thread,
+    // counted in user mode since the construction. The counters are not
+    // available on other platforms or when perf_event_paranoid does not
+    // allow them, in which case IsAvailable() is false and the counts are
+    // zero. The counters belong to the thread that constructed the object.
+    class HardwareCounters
+    {
+    public:
+        struct Counts
+        {
+            uint64_t cacheMisses;
+            uint64_t branchMisses;
+        };
+
+        HardwareCounters()
+            :
+            mCacheMisses(-1),
+            mBranchMisses(-1)
+        {
+#if defined(GTE_HARDWARE_COUNTERS_PERF_EVENT)
+            mCacheMisses = Open(PERF_COUNT_HW_CACHE_MISSES);
+            mBranchMisses = Open(PERF_COUNT_HW_BRANCH_MISSES);
+#endif
+        }
+
+        ~HardwareCounters()
+        {
+#if defined(GTE_HARDWARE_COUNTERS_PERF_EVENT)
+            if (mCacheMisses >= 0)
+            {
+                close(mCacheMisses);
+            }
+            if (mBranchMisses >= 0)
+            {
+                close(mBranchMisses);
+            }
+#endif
+        }
+
+        // Object copies are not allowed.
+        HardwareCounters(HardwareCounters const&) = delete;
+        HardwareCounters& operator=(HardwareCounters const&) = delete;
+
+        inline bool IsAvailable() const
+        {
+            return mCacheMisses >= 0 && mBranchMisses >= 0;
+        }
+
+        // Differences of two reads are the counts of the code between them.
+        Counts Read() const
+        {
+            return Counts{ Read(mCacheMisses), Read(mBranchMisses) };
+        }
+
+    private:
+#if defined(GTE_HARDWARE_COUNTERS_PERF_EVENT)
+        static int Open(uint64_t config)
+        {
+            perf_event_attr attributes;
+            std::memset(&attributes, 0, sizeof(attributes));
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.size = sizeof(attributes);
+            attributes.config = config;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            return static_cast<int>(syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0));
+        }
+#endif
+
+        static uint64_t Read(int descriptor)
+        {
+            uint64_t value = 0;
+#if defined(GTE_HARDWARE_COUNTERS_PERF_EVENT)
+            if (descriptor >= 0 && read(descriptor, &value, sizeof(value)) != sizeof(value))
+            {
+                value = 0;
+            }
+#else
+            (void)descriptor;
+#endif
+            return value;
+        }
+
+        int mCacheMisses, mBranchMisses;
+    };
+}
@@ -8,7 +8,11 @@
 #pragma once
 
 #include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
 #include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 
 namespace gte
@@ -226,6 +230,72 @@ namespace gte
             }
         }
 
+        // The InsertCheck of an array of samples. To run in the main thread
+        // only, choose numThreads to be 0. For multithreading, choose
+        // numThreads > 0. The samples are then partitioned into numThreads
+        // contiguous ranges that are counted by tasks of
+        // TaskScheduler::GetDefault() in private buckets, which are added
+        // to the buckets of the histogram at the end.
+        void InsertCheck(int32_t numSamples, int32_t const* samples, size_t numThreads = 0)
+        {
+            LogAssert(numSamples >= 0 && (numSamples == 0 || samples != nullptr), "Invalid input.");
+
+            size_t const numBuckets = mBuckets.size();
+            size_t const numTasks = std::max(std::min(numThreads,
+                static_cast<size_t>(numSamples) / minPerTask), static_cast<size_t>(1));
+
+            // The counts of a task are (less, buckets..., greater).
+            std::vector<std::vector<int32_t>> counts(numTasks);
+            auto countRange = [numSamples, samples, numBuckets, numTasks, &counts](size_t k)
+            {
+                std::vector<int32_t>& count = counts[k];
+                count.assign(numBuckets + 2, 0);
+                size_t const imin = k * static_cast<size_t>(numSamples) / numTasks;
+                size_t const imax = (k + 1) * static_cast<size_t>(numSamples) / numTasks;
+                int32_t const upper = static_cast<int32_t>(numBuckets);
+                for (size_t i = imin; i < imax; ++i)
+                {
+                    int32_t const value = samples[i];
+                    ++count[static_cast<size_t>((value < 0 ? -1 : std::min(value, upper)) + 1)];
+                }
+            };
+
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, countRange);
+            }
+            else
+            {
+                countRange(0);
+            }
+
+            for (auto const& count : counts)
+            {
+                mExcessLess += count[0];
+                for (size_t i = 0; i < numBuckets; ++i)
+                {
+                    mBuckets[i] += count[i + 1];
+                }
+                mExcessGreater += count[numBuckets + 1];
+            }
+        }
+
+        // Add the counts of a histogram with the same number of buckets,
+        // for example the histogram of another part of the samples.
+        Histogram& operator+=(Histogram const& other)
+        {
+            LogAssert(other.mBuckets.size() == mBuckets.size(),
+                "The histograms must have the same number of buckets.");
+
+            for (size_t i = 0; i < mBuckets.size(); ++i)
+            {
+                mBuckets[i] += other.mBuckets[i];
+            }
+            mExcessLess += other.mExcessLess;
+            mExcessGreater += other.mExcessGreater;
+            return *this;
+        }
+
         // Member access.
         inline std::vector<int32_t> const& GetBuckets() const
         {
@@ -332,7 +402,220 @@ namespace gte
         }
 
     private:
+        // A task is created only for this many samples or more, because
+        // the work per sample is small compared to merging the buckets.
+        static size_t constexpr minPerTask = 65536;
+
         std::vector<int32_t> mBuckets;
         int32_t mExcessLess, mExcessGreater;
     };
+
+    // A histogram of real-valued samples with numBuckets buckets of equal
+    // width on a fixed range [minValue,maxValue). Bucket i counts the samples
+    // in [minValue + i*w, minValue + (i+1)*w), where w = (maxValue -
+    // minValue) / numBuckets, and the samples outside the range are counted
+    // as excess, up to rounding errors at the bucket edges. NaN samples are
+    // counted as less than the range. Because the range does not depend on
+    // the samples, histograms of the same range and number of buckets are
+    // added by operator+=, for example to combine the histograms of frames
+    // or of the parts of a data set counted by different processes. The
+    // counts are 64-bit.
+    //
+    // The samples of Insert(numSamples, samples, numThreads) are processed
+    // in blocks. The bucket indices of a block are computed by a loop
+    // without branches that the compiler vectorizes, and the counts are
+    // then incremented.
+    template <typename Real>
+    class UniformHistogram
+    {
+    public:
+        UniformHistogram(Real minValue, Real maxValue, int32_t numBuckets)
+            :
+            mMinValue(minValue),
+            mMaxValue(maxValue),
+            mMultiplier(static_cast<Real>(numBuckets) / (maxValue - minValue)),
+            mBuckets(static_cast<size_t>(numBuckets), 0),
+            mExcessLess(0),
+            mExcessGreater(0)
+        {
+            LogAssert(numBuckets > 0 && minValue < maxValue, "Invalid input.");
+        }
+
+        // Construction from counts, for example of a histogram that was
+        // received from another process.
+        UniformHistogram(Real minValue, Real maxValue, std::vector<uint64_t> const& buckets,
+            uint64_t excessLess, uint64_t excessGreater)
+            :
+            mMinValue(minValue),
+            mMaxValue(maxValue),
+            mMultiplier(static_cast<Real>(buckets.size()) / (maxValue - minValue)),
+            mBuckets(buckets),
+            mExcessLess(excessLess),
+            mExcessGreater(excessGreater)
+        {
+            LogAssert(buckets.size() > 0 && minValue < maxValue, "Invalid input.");
+        }
+
+        // Member access.
+        inline Real GetMinValue() const
+        {
+            return mMinValue;
+        }
+
+        inline Real GetMaxValue() const
+        {
+            return mMaxValue;
+        }
+
+        inline int32_t GetNumBuckets() const
+        {
+            return static_cast<int32_t>(mBuckets.size());
+        }
+
+        inline std::vector<uint64_t> const& GetBuckets() const
+        {
+            return mBuckets;
+        }
+
+        inline uint64_t GetExcessLess() const
+        {
+            return mExcessLess;
+        }
+
+        inline uint64_t GetExcessGreater() const
+        {
+            return mExcessGreater;
+        }
+
+        // The number of samples counted, including the excess.
+        uint64_t GetNumSamples() const
+        {
+            uint64_t numSamples = mExcessLess + mExcessGreater;
+            for (auto count : mBuckets)
+            {
+                numSamples += count;
+            }
+            return numSamples;
+        }
+
+        void Clear()
+        {
+            std::fill(mBuckets.begin(), mBuckets.end(), 0);
+            mExcessLess = 0;
+            mExcessGreater = 0;
+        }
+
+        // Count one sample.
+        void Insert(Real value)
+        {
+            int32_t const index = GetIndex(value);
+            if (index < 0)
+            {
+                ++mExcessLess;
+            }
+            else if (index < GetNumBuckets())
+            {
+                ++mBuckets[static_cast<size_t>(index)];
+            }
+            else
+            {
+                ++mExcessGreater;
+            }
+        }
+
+        // Count an array of samples. To run in the main thread only, choose
+        // numThreads to be 0. For multithreading, choose numThreads > 0.
+        // The samples are then partitioned into numThreads contiguous
+        // ranges that are counted by tasks of TaskScheduler::GetDefault()
+        // in private buckets, which are added at the end, so the result
+        // does not depend on numThreads.
+        void Insert(size_t numSamples, Real const* samples, size_t numThreads = 0)
+        {
+            LogAssert(numSamples == 0 || samples != nullptr, "Invalid input.");
+
+            size_t const numBuckets = mBuckets.size();
+            size_t const numTasks = std::max(std::min(numThreads,
+                numSamples / minPerTask), static_cast<size_t>(1));
+
+            // The counts of a task are (less, buckets..., greater).
+            std::vector<std::vector<uint64_t>> counts(numTasks);
+            auto countRange = [this, numSamples, samples, numBuckets, numTasks, &counts](size_t k)
+            {
+                std::vector<uint64_t>& count = counts[k];
+                count.assign(numBuckets + 2, 0);
+                size_t const imin = k * numSamples / numTasks;
+                size_t const imax = (k + 1) * numSamples / numTasks;
+                std::array<int32_t, blockSize> indices{};
+                for (size_t i0 = imin; i0 < imax; i0 += blockSize)
+                {
+                    size_t const n = std::min(imax - i0, blockSize);
+                    Real const* block = samples + i0;
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        indices[j] = GetIndex(block[j]) + 1;
+                    }
+                    for (size_t j = 0; j < n; ++j)
+                    {
+                        ++count[static_cast<size_t>(indices[j])];
+                    }
+                }
+            };
+
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, countRange);
+            }
+            else
+            {
+                countRange(0);
+            }
+
+            for (auto const& count : counts)
+            {
+                mExcessLess += count[0];
+                for (size_t i = 0; i < numBuckets; ++i)
+                {
+                    mBuckets[i] += count[i + 1];
+                }
+                mExcessGreater += count[numBuckets + 1];
+            }
+        }
+
+        // Add the counts of a histogram with the same range and number of
+        // buckets.
+        UniformHistogram& operator+=(UniformHistogram const& other)
+        {
+            LogAssert(other.mMinValue == mMinValue && other.mMaxValue == mMaxValue
+                && other.mBuckets.size() == mBuckets.size(),
+                "The histograms must have the same buckets.");
+
+            for (size_t i = 0; i < mBuckets.size(); ++i)
+            {
+                mBuckets[i] += other.mBuckets[i];
+            }
+            mExcessLess += other.mExcessLess;
+            mExcessGreater += other.mExcessGreater;
+            return *this;
+        }
+
+    private:
+        static size_t constexpr blockSize = 256;
+        static size_t constexpr minPerTask = 65536;
+
+        // The bucket index of a sample, -1 for a sample less than minValue
+        // or NaN and numBuckets for a sample not less than maxValue. The
+        // selections compile to SIMD compares and blends.
+        inline int32_t GetIndex(Real value) const
+        {
+            Real const numBuckets = static_cast<Real>(mBuckets.size());
+            Real t = mMultiplier * (value - mMinValue);
+            t = (t >= static_cast<Real>(0) ? t : static_cast<Real>(-1));
+            t = (t < numBuckets ? t : numBuckets);
+            return static_cast<int32_t>(t);
+        }
+
+        Real mMinValue, mMaxValue, mMultiplier;
+        std::vector<uint64_t> mBuckets;
+        uint64_t mExcessLess, mExcessGreater;
+    };
 }
@@ -10,6 +10,14 @@
 #include <Mathematics/BitHacks.h>
 #include <Mathematics/Math.h>
 #include <Mathematics/IEEEBinary.h>
+#include <cstddef>
+
+// Define GTE_USE_F16C to convert arrays with the F16C instructions of x86
+// processors (Intel Ivy Bridge, AMD Piledriver and later). The code must be
+// compiled for such a processor, for example with -mf16c.
+#if defined(GTE_USE_F16C)
+#include <immintrin.h>
+#endif
 
 namespace gte
 {
@@ -111,6 +119,46 @@ namespace gte
             return static_cast<float>(*this) >= static_cast<float>(object);
         }
 
+        // Conversions of arrays, for example of vertex attributes. The
+        // encodings are those of the constructor and the numbers are those
+        // of operator float(). With GTE_USE_F16C, 8 numbers are converted
+        // per instruction; the rounding is to nearest with ties to even, as
+        // in Convert32To16, but signaling NaNs are converted to quiet NaNs.
+        static void Convert(size_t numValues, float const* input, uint16_t* output)
+        {
+            size_t i = 0;
+#if defined(GTE_USE_F16C)
+            for (; i + 8 <= numValues; i += 8)
+            {
+                __m256 const numbers = _mm256_loadu_ps(input + i);
+                __m128i const encodings = _mm256_cvtps_ph(numbers, _MM_FROUND_TO_NEAREST_INT);
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(output + i), encodings);
+            }
+#endif
+            for (; i < numValues; ++i)
+            {
+                union { float n; uint32_t e; } temp = { input[i] };
+                output[i] = Convert32To16(temp.e);
+            }
+        }
+
+        static void Convert(size_t numValues, uint16_t const* input, float* output)
+        {
+            size_t i = 0;
+#if defined(GTE_USE_F16C)
+            for (; i + 8 <= numValues; i += 8)
+            {
+                __m128i const encodings = _mm_loadu_si128(reinterpret_cast<__m128i const*>(input + i));
+                _mm256_storeu_ps(output + i, _mm256_cvtph_ps(encodings));
+            }
+#endif
+            for (; i < numValues; ++i)
+            {
+                union { uint32_t e; float n; } temp = { Convert16To32(input[i]) };
+                output[i] = temp.n;
+            }
+        }
+
     private:
         // Members from the base class IEEEBinary<int16_t, uint16_t, 16, 11>.
         //
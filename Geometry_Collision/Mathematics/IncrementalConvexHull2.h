@@ -0,0 +1,168 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+// Compute the convex hull of 2D points that are inserted in chunks, for
+// example while a point cloud is streamed from a file. The object stores
+// only the vertices of the current hull. Each call to Insert computes with
+// ConvexHull2 the hull of the current vertices and the new points, so the
+// memory usage is the size of the hull plus the size of a chunk, and the
+// Akl-Toussaint prefilter of ConvexHull2 discards most of the new points
+// before they are sorted. The hull vertices are copied, so the caller can
+// reuse the memory of a chunk after Insert returns.
+//
+// The epsilon value is passed to ConvexHull2 for the determination of the
+// intrinsic dimension. While the points inserted so far are (nearly)
+// collinear, only the endpoints of their segment are stored, and while they
+// are (nearly) the same point, only the first point is stored. When epsilon
+// is positive, the points that are within epsilon of the line are therefore
+// not part of the hull computed after later insertions.
+
+#include <Mathematics/ConvexHull2.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gte
+{
+    // The Real must be 'float' or 'double'.
+    template <typename Real>
+    class IncrementalConvexHull2
+    {
+    public:
+        // The points are processed single-threaded when lgNumThreads = 0
+        // and otherwise ConvexHull2 uses up to 2^{lgNumThreads} tasks of
+        // TaskScheduler::GetDefault().
+        IncrementalConvexHull2(Real epsilon = static_cast<Real>(0), size_t lgNumThreads = 0)
+            :
+            mEpsilon(std::max(epsilon, static_cast<Real>(0))),
+            mLgNumThreads(lgNumThreads),
+            mNumInserted(0),
+            mDimension(0),
+            mHullPoints{},
+            mHullIndices{},
+            mPoints{},
+            mIndices{}
+        {
+        }
+
+        // Remove all points.
+        void Clear()
+        {
+            mNumInserted = 0;
+            mDimension = 0;
+            mHullPoints.clear();
+            mHullIndices.clear();
+        }
+
+        // Insert a chunk of points. The index of a point is its position in
+        // the sequence of all the inserted points.
+        void Insert(size_t numPoints, Vector2<Real> const* points)
+        {
+            if (numPoints == 0)
+            {
+                return;
+            }
+            LogAssert(points != nullptr, "Invalid argument.");
+
+            mPoints.resize(mHullPoints.size() + numPoints);
+            mIndices.resize(mPoints.size());
+            std::copy(mHullPoints.begin(), mHullPoints.end(), mPoints.begin());
+            std::copy(mHullIndices.begin(), mHullIndices.end(), mIndices.begin());
+            std::copy(points, points + numPoints, mPoints.begin() + mHullPoints.size());
+            for (size_t i = 0, j = mHullPoints.size(); i < numPoints; ++i, ++j)
+            {
+                mIndices[j] = mNumInserted + i;
+            }
+            mNumInserted += numPoints;
+
+            ConvexHull2<Real> hull;
+            int32_t const numCombined = static_cast<int32_t>(mPoints.size());
+            mHullPoints.clear();
+            mHullIndices.clear();
+            if (numCombined >= 3 && hull(numCombined, mPoints.data(), mEpsilon, mLgNumThreads))
+            {
+                mDimension = 2;
+                for (auto i : hull.GetHull())
+                {
+                    mHullPoints.push_back(mPoints[i]);
+                    mHullIndices.push_back(mIndices[i]);
+                }
+                return;
+            }
+
+            // The points are (nearly) the same point or (nearly) collinear.
+            // ConvexHull2 does not determine the dimension of fewer than 3
+            // points, and the rounding errors of IntrinsicsVector2 can
+            // classify 2 points as planar.
+            IntrinsicsVector2<Real> info(numCombined, mPoints.data(), mEpsilon);
+            mDimension = std::min(info.dimension, 1);
+            KeepPoint(info.extreme[0]);
+            if (mDimension == 1)
+            {
+                KeepPoint(info.extreme[1]);
+            }
+        }
+
+        inline void Insert(std::vector<Vector2<Real>> const& points)
+        {
+            Insert(points.size(), points.data());
+        }
+
+        // Member access.
+        inline Real GetEpsilon() const
+        {
+            return mEpsilon;
+        }
+
+        inline size_t GetNumInserted() const
+        {
+            return mNumInserted;
+        }
+
+        // The dimension is 0 (the points are a single point), 1 (the points
+        // are on a segment) or 2 (the hull is a convex polygon). The hull
+        // points are the point, the segment endpoints or the polygon
+        // vertices in counterclockwise order, and the hull indices are their
+        // indices in the sequence of the inserted points.
+        inline int32_t GetDimension() const
+        {
+            return mDimension;
+        }
+
+        inline std::vector<Vector2<Real>> const& GetHullPoints() const
+        {
+            return mHullPoints;
+        }
+
+        inline std::vector<size_t> const& GetHullIndices() const
+        {
+            return mHullIndices;
+        }
+
+    private:
+        void KeepPoint(int32_t i)
+        {
+            mHullPoints.push_back(mPoints[i]);
+            mHullIndices.push_back(mIndices[i]);
+        }
+
+        Real mEpsilon;
+        size_t mLgNumThreads;
+        size_t mNumInserted;
+        int32_t mDimension;
+        std::vector<Vector2<Real>> mHullPoints;
+        std::vector<size_t> mHullIndices;
+
+        // The current hull points followed by the chunk of new points, which
+        // are the input to ConvexHull2, and their indices.
+        std::vector<Vector2<Real>> mPoints;
+        std::vector<size_t> mIndices;
+    };
+}
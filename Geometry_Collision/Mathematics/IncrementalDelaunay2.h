@@ -51,15 +51,32 @@
 //
 // The details of the algorithms and implementation are provided in
 // https://www.geometrictools.com/Documentation/IncrementalDelaunayTriangulation.pdf
+//
+// The batch insertion inserts the points in a biased randomized insertion
+// order (BRIO) of
+//     Nina Amenta, Sunghee Choi and Gunter Rote,
+//     "Incremental Constructions con BRIO",
+//     Proceedings of the 19th Annual Symposium on Computational Geometry,
+//     2003, pp. 211-219.
+// The points are shuffled and split into rounds, each round twice the size
+// of the previous one, and the points of a round are sorted along a Hilbert
+// curve. The point location of an insertion starts at the vertex inserted
+// before it, so the walks are short and the triangulation stays balanced
+// for spatially sorted input such as LiDAR scan lines.
 
 #include <Mathematics/ArbitraryPrecision.h>
+#include <Mathematics/DelaunayLocator.h>
 #include <Mathematics/MinHeap.h>
 #include <Mathematics/SWInterval.h>
 #include <Mathematics/Vector2.h>
 #include <Mathematics/VETManifoldMesh.h>
+#include <algorithm>
 #include <functional>
 #include <map>
+#include <numeric>
+#include <random>
 #include <set>
+#include <vector>
 
 namespace gte
     // The input type must be 'float' or 'double'. The compute type is defined
@@ -90,7 +107,8 @@ namespace gte
             mAdjacencies{},
             mTrianglesAndAdjacenciesNeedUpdate(true),
             mQueryPoint{},
-            mIRQueryPoint{}
+            mIRQueryPoint{},
+            mLastVertex(-1)
         {
             static_assert(
                 std::is_floating_point<T>::value,
@@ -285,10 +303,45 @@ namespace gte
                 RetriangulateInteriorRemovalPolygon(vRemovalIndex, polygon);
             }
 
+            // The next point location starts near the removed vertex.
+            mLastVertex = polygon[0];
+
             mVertexIndexMap.erase(iter);
             return static_cast<size_t>(vRemovalIndex);
         }
 
+        // Insert a batch of points, such as a chunk of a streamed point
+        // cloud, in the biased randomized insertion order described at the
+        // beginning of this file. On return, indices[i] is the value that
+        // Insert(positions[i]) returns. The triangulation is the same as for
+        // the insertion of the points one at a time, except that the
+        // triangulation of cocircular points depends on the order.
+        void Insert(std::vector<Vector2<T>> const& positions, std::vector<size_t>& indices)
+        {
+            std::vector<size_t> order;
+            GetInsertionOrder(positions, order);
+
+            indices.resize(positions.size());
+            for (auto i : order)
+            {
+                indices[i] = Insert(positions[i]);
+            }
+        }
+
+        // Remove a batch of points, such as the points that leave a sliding
+        // window. On return, indices[i] is the value that
+        // Remove(positions[i]) returns. The removal of a vertex modifies
+        // only the triangles of the vertex, so the points are removed in
+        // the input order.
+        void Remove(std::vector<Vector2<T>> const& positions, std::vector<size_t>& indices)
+        {
+            indices.resize(positions.size());
+            for (size_t i = 0; i < positions.size(); ++i)
+            {
+                indices[i] = Remove(positions[i]);
+            }
+        }
+
         // Call this only after you are finished inserting points into or
         // removing points from the triangulation.
         bool FinalizeTriangulation()
@@ -669,6 +722,61 @@ namespace gte
             return vIndex < 3;
         }
 
+        // The walk of GetContainingTriangle starts at a triangle of the
+        // most recently inserted or removed vertex, so the walks are short
+        // when consecutive points are near each other.
+        Triangle* GetStartTriangle() const
+        {
+            auto const& vmap = mGraph.GetVertices();
+            auto iter = vmap.find(mLastVertex);
+            if (iter != vmap.end() && iter->second->TAdjacent.size() > 0)
+            {
+                return *iter->second->TAdjacent.begin();
+            }
+            return mGraph.GetTriangles().begin()->second.get();
+        }
+
+        // The biased randomized insertion order of the points. The last
+        // round contains half of the points, the round before it half of
+        // the others, and so on down to a round of at most minRoundSize
+        // points.
+        static void GetInsertionOrder(std::vector<Vector2<T>> const& positions,
+            std::vector<size_t>& order)
+        {
+            size_t const numPositions = positions.size();
+            order.resize(numPositions);
+            std::iota(order.begin(), order.end(), 0);
+
+            // A fixed seed makes the triangulation reproducible.
+            std::default_random_engine dre(0x5eed);
+            std::shuffle(order.begin(), order.end(), dre);
+
+            std::vector<Vector2<T>> roundPositions;
+            std::vector<size_t> roundOrder, sorted;
+            size_t end = numPositions;
+            while (end > 0)
+            {
+                size_t const begin = (end > minRoundSize ? end / 2 : 0);
+                roundPositions.resize(end - begin);
+                for (size_t i = begin; i < end; ++i)
+                {
+                    roundPositions[i - begin] = positions[order[i]];
+                }
+                DelaunayLocator<2, T>::SortHilbert(roundPositions.data(),
+                    roundPositions.size(), roundOrder);
+
+                sorted.resize(end - begin);
+                for (size_t i = 0; i < sorted.size(); ++i)
+                {
+                    sorted[i] = order[begin + roundOrder[i]];
+                }
+                std::copy(sorted.begin(), sorted.end(), order.begin() + begin);
+                end = begin;
+            }
+        }
+
+        static size_t constexpr minRoundSize = 64;
+
         bool GetContainingTriangle(size_t pIndex, Triangle*& tri) const
         {
             size_t const numTriangles = mGraph.GetTriangles().size();
@@ -767,7 +875,7 @@ namespace gte
         void Update(size_t pIndex)
         {
             auto const& tmap = mGraph.GetTriangles();
-            Triangle* tri = tmap.begin()->second.get();
+            Triangle* tri = GetStartTriangle();
             if (GetContainingTriangle(pIndex, tri))
             {
                 // The point is inside the convex hull. The insertion polygon
@@ -893,6 +1001,8 @@ namespace gte
                         "Unexpected insertion failure.");
                 }
             }
+
+            mLastVertex = static_cast<int32_t>(pIndex);
         }
 
         static ComputeRational const& Copy(InputRational const& source,
@@ -1829,6 +1939,11 @@ namespace gte
         mutable Vector2<T> mQueryPoint;
         mutable IRVector mIRQueryPoint;
 
+        // The most recently inserted vertex, or a vertex of the polygon of
+        // the most recently removed vertex, where the next point location
+        // starts.
+        int32_t mLastVertex;
+
         void UpdateTrianglesAndAdjacencies() const
         {
             // Assign integer values to the triangles.
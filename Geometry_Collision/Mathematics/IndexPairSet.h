@@ -0,0 +1,455 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/EdgeKey.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// A set of unordered pairs (i,j) of nonnegative indices, stored as
+// EdgeKey<false> with V[0] < V[1]. The pairs are packed into 64-bit keys
+// in an open-addressing hash table with linear probing, so insertions and
+// removals do not allocate once the table has grown to its working size,
+// and the table is a single contiguous array. The set is designed for the
+// overlap sets of the sort-and-sweep managers, which insert and erase a
+// pair at each swap of endpoints.
+//
+// The changes to the set between BeginChanges() and EndChanges() are
+// recorded. After EndChanges(), GetAdded() and GetRemoved() are the pairs
+// that are in the set and were not before BeginChanges(), and the pairs
+// that were in the set and are not anymore, both sorted lexicographically.
+// A pair that is inserted and erased again in the same interval is in
+// neither list. GetSorted() is the whole set sorted lexicographically. It
+// is updated by EndChanges(), by merging it with the lists of changes when
+// it was up to date at BeginChanges(), so the const member functions do not
+// modify the set and can be called concurrently. After changes that are
+// not recorded, call Sort() before GetSorted().
+
+namespace gte
+{
+    class IndexPairSet
+    {
+    public:
+        IndexPairSet()
+            :
+            mElements{},
+            mTouched{},
+            mChanges{},
+            mAdded{},
+            mRemoved{},
+            mRecording(false),
+            mSorted{},
+            mSortedCurrent(true),
+            mSortedCurrentAtBegin(true)
+        {
+        }
+
+        // Grow the table to store numElements pairs without rehashing.
+        void Reserve(size_t numElements)
+        {
+            mElements.Reserve(numElements);
+        }
+
+        // Erase all pairs. The table keeps its capacity.
+        void Clear()
+        {
+            if (mElements.GetNumElements() == 0)
+            {
+                return;
+            }
+
+            if (mRecording)
+            {
+                mElements.ForEach([this](uint64_t key)
+                {
+                    Touch(key, true);
+                });
+            }
+            mElements.Clear();
+            Modified();
+        }
+
+        // Insert the pair (v0,v1), where v0 != v1 in any order. The return
+        // value is true when the pair was not already in the set.
+        bool Insert(int32_t v0, int32_t v1)
+        {
+            uint64_t const key = GetKey(v0, v1);
+            if (mElements.Insert(key))
+            {
+                if (mRecording)
+                {
+                    Touch(key, false);
+                }
+                Modified();
+                return true;
+            }
+            return false;
+        }
+
+        // Erase the pair (v0,v1). The return value is true when the pair was
+        // in the set.
+        bool Erase(int32_t v0, int32_t v1)
+        {
+            uint64_t const key = GetKey(v0, v1);
+            if (mElements.Erase(key))
+            {
+                if (mRecording)
+                {
+                    Touch(key, true);
+                }
+                Modified();
+                return true;
+            }
+            return false;
+        }
+
+        inline bool Contains(int32_t v0, int32_t v1) const
+        {
+            return mElements.Contains(GetKey(v0, v1));
+        }
+
+        inline size_t GetNumElements() const
+        {
+            return mElements.GetNumElements();
+        }
+
+        // Execute function(EdgeKey<false> const&) for each pair in the
+        // order of the hash table, which is faster than GetSorted() when
+        // the order does not matter.
+        template <typename Function>
+        void ForEach(Function const& function) const
+        {
+            mElements.ForEach([&function](uint64_t key)
+            {
+                function(GetEdgeKey(key));
+            });
+        }
+
+        // Record the changes to the set until EndChanges() is called.
+        void BeginChanges()
+        {
+            LogAssert(!mRecording, "EndChanges must be called first.");
+            mRecording = true;
+            mChanges.clear();
+            mAdded.clear();
+            mRemoved.clear();
+            mSortedCurrentAtBegin = mSortedCurrent;
+        }
+
+        void EndChanges()
+        {
+            LogAssert(mRecording, "BeginChanges must be called first.");
+            mRecording = false;
+
+            std::vector<uint64_t> added{}, removed{};
+            for (auto const& change : mChanges)
+            {
+                bool const present = mElements.Contains(change.first);
+                if (present && !change.second)
+                {
+                    added.push_back(change.first);
+                }
+                else if (!present && change.second)
+                {
+                    removed.push_back(change.first);
+                }
+                mTouched.Erase(change.first);
+            }
+
+            std::sort(added.begin(), added.end());
+            std::sort(removed.begin(), removed.end());
+            mAdded.resize(added.size());
+            std::transform(added.begin(), added.end(), mAdded.begin(), GetEdgeKey);
+            mRemoved.resize(removed.size());
+            std::transform(removed.begin(), removed.end(), mRemoved.begin(), GetEdgeKey);
+
+            if (mSortedCurrentAtBegin)
+            {
+                MergeChanges();
+                mSortedCurrent = true;
+            }
+            else
+            {
+                Sort();
+            }
+        }
+
+        inline std::vector<EdgeKey<false>> const& GetAdded() const
+        {
+            return mAdded;
+        }
+
+        inline std::vector<EdgeKey<false>> const& GetRemoved() const
+        {
+            return mRemoved;
+        }
+
+        // The sorted set is up to date after EndChanges() and Sort().
+        inline std::vector<EdgeKey<false>> const& GetSorted() const
+        {
+            LogAssert(mSortedCurrent, "Sort or EndChanges must be called first.");
+            return mSorted;
+        }
+
+        // Sort the whole set, which is needed only after changes that were
+        // not recorded between BeginChanges() and EndChanges().
+        void Sort()
+        {
+            LogAssert(!mRecording, "EndChanges must be called first.");
+            if (mSortedCurrent)
+            {
+                return;
+            }
+
+            std::vector<uint64_t> keys{};
+            keys.reserve(mElements.GetNumElements());
+            mElements.ForEach([&keys](uint64_t key)
+            {
+                keys.push_back(key);
+            });
+            std::sort(keys.begin(), keys.end());
+            mSorted.resize(keys.size());
+            std::transform(keys.begin(), keys.end(), mSorted.begin(), GetEdgeKey);
+            mSortedCurrent = true;
+        }
+
+    private:
+        // The smaller index is in the high 32 bits, so the order of the keys
+        // is the lexicographic order of the pairs.
+        static inline uint64_t GetKey(int32_t v0, int32_t v1)
+        {
+            if (v0 > v1)
+            {
+                std::swap(v0, v1);
+            }
+            return (static_cast<uint64_t>(static_cast<uint32_t>(v0)) << 32)
+                | static_cast<uint64_t>(static_cast<uint32_t>(v1));
+        }
+
+        static inline EdgeKey<false> GetEdgeKey(uint64_t key)
+        {
+            return EdgeKey<false>(static_cast<int32_t>(key >> 32),
+                static_cast<int32_t>(key & 0xFFFFFFFFull));
+        }
+
+        void Touch(uint64_t key, bool present)
+        {
+            if (mTouched.Insert(key))
+            {
+                mChanges.push_back(std::make_pair(key, present));
+            }
+        }
+
+        void Modified()
+        {
+            mSortedCurrent = false;
+        }
+
+        // Remove the pairs of mRemoved, which are in mSorted, and merge the
+        // remaining pairs with those of mAdded.
+        void MergeChanges()
+        {
+            size_t numKept = 0;
+            auto removed = mRemoved.begin();
+            for (auto const& key : mSorted)
+            {
+                if (removed != mRemoved.end() && *removed == key)
+                {
+                    ++removed;
+                }
+                else
+                {
+                    mSorted[numKept++] = key;
+                }
+            }
+            mSorted.resize(numKept);
+            mSorted.insert(mSorted.end(), mAdded.begin(), mAdded.end());
+            std::inplace_merge(mSorted.begin(), mSorted.begin() + numKept, mSorted.end());
+        }
+
+        // The open-addressing table. The capacity is a power of two and at
+        // least twice the number of keys, and removals shift the following
+        // keys of the probe sequence back, so there are no tombstones.
+        class Table
+        {
+        public:
+            Table()
+                :
+                mSlots{},
+                mMask(0),
+                mNumElements(0)
+            {
+            }
+
+            void Reserve(size_t numElements)
+            {
+                if (2 * numElements > mSlots.size())
+                {
+                    size_t capacity = std::max(mSlots.size(), static_cast<size_t>(16));
+                    while (capacity < 2 * numElements)
+                    {
+                        capacity *= 2;
+                    }
+                    Rehash(capacity);
+                }
+            }
+
+            void Clear()
+            {
+                std::fill(mSlots.begin(), mSlots.end(), EmptyKey());
+                mNumElements = 0;
+            }
+
+            bool Insert(uint64_t key)
+            {
+                Reserve(mNumElements + 1);
+                size_t slot = GetSlot(key);
+                while (mSlots[slot] != EmptyKey())
+                {
+                    if (mSlots[slot] == key)
+                    {
+                        return false;
+                    }
+                    slot = (slot + 1) & mMask;
+                }
+                mSlots[slot] = key;
+                ++mNumElements;
+                return true;
+            }
+
+            bool Erase(uint64_t key)
+            {
+                if (mNumElements == 0)
+                {
+                    return false;
+                }
+
+                size_t slot = GetSlot(key);
+                while (mSlots[slot] != key)
+                {
+                    if (mSlots[slot] == EmptyKey())
+                    {
+                        return false;
+                    }
+                    slot = (slot + 1) & mMask;
+                }
+
+                // Move back each following key of the cluster whose home
+                // slot is not cyclically in (slot,next].
+                size_t next = slot;
+                for (;;)
+                {
+                    next = (next + 1) & mMask;
+                    uint64_t const nextKey = mSlots[next];
+                    if (nextKey == EmptyKey())
+                    {
+                        break;
+                    }
+                    size_t const home = GetSlot(nextKey);
+                    if (((next - home) & mMask) >= ((next - slot) & mMask))
+                    {
+                        mSlots[slot] = nextKey;
+                        slot = next;
+                    }
+                }
+                mSlots[slot] = EmptyKey();
+                --mNumElements;
+                return true;
+            }
+
+            bool Contains(uint64_t key) const
+            {
+                if (mNumElements == 0)
+                {
+                    return false;
+                }
+
+                size_t slot = GetSlot(key);
+                while (mSlots[slot] != EmptyKey())
+                {
+                    if (mSlots[slot] == key)
+                    {
+                        return true;
+                    }
+                    slot = (slot + 1) & mMask;
+                }
+                return false;
+            }
+
+            inline size_t GetNumElements() const
+            {
+                return mNumElements;
+            }
+
+            template <typename Function>
+            void ForEach(Function const& function) const
+            {
+                for (auto key : mSlots)
+                {
+                    if (key != EmptyKey())
+                    {
+                        function(key);
+                    }
+                }
+            }
+
+        private:
+            // The pair (-1,-1) marks the empty slots.
+            static inline uint64_t EmptyKey()
+            {
+                return std::numeric_limits<uint64_t>::max();
+            }
+
+            // Fibonacci hashing of the key, which mixes the two indices into
+            // the high bits of the product.
+            inline size_t GetSlot(uint64_t key) const
+            {
+                uint64_t const product = key * 0x9E3779B97F4A7C15ull;
+                return static_cast<size_t>(product >> 32) & mMask;
+            }
+
+            void Rehash(size_t capacity)
+            {
+                std::vector<uint64_t> slots(capacity, EmptyKey());
+                std::swap(slots, mSlots);
+                mMask = capacity - 1;
+                for (auto key : slots)
+                {
+                    if (key != EmptyKey())
+                    {
+                        size_t slot = GetSlot(key);
+                        while (mSlots[slot] != EmptyKey())
+                        {
+                            slot = (slot + 1) & mMask;
+                        }
+                        mSlots[slot] = key;
+                    }
+                }
+            }
+
+            std::vector<uint64_t> mSlots;
+            size_t mMask;
+            size_t mNumElements;
+        };
+
+        Table mElements, mTouched;
+        std::vector<std::pair<uint64_t, bool>> mChanges;
+        std::vector<EdgeKey<false>> mAdded, mRemoved;
+        bool mRecording;
+
+        // The sorted set, updated by EndChanges() and Sort().
+        std::vector<EdgeKey<false>> mSorted;
+        bool mSortedCurrent;
+        bool mSortedCurrentAtBegin;
+    };
+}
@@ -0,0 +1,575 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/LinearSystem.h>
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <Mathematics/Vector.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+// Scattered data interpolation with compactly supported radial basis
+// functions, for point sets that are too large for IntpThinPlateSpline2 and
+// IntpThinPlateSpline3. Those build a dense numPoints-by-numPoints matrix
+// and invert it, which is O(n^3) time and O(n^2) memory. The interpolator
+// here is
+//   f(p) = b[0] + sum_{d} b[d+1]*(p[d]-c[d]) + sum_{i} a[i]*phi(|p-p[i]|/r)
+// where c is the average of the points, r is the support radius and phi is
+// the Wendland function phi(t) = (1-t)^4*(4*t+1) for 0 <= t < 1 and
+// phi(t) = 0 for t >= 1, which is positive definite in dimensions 1, 2 and
+// 3. The affine term is the least-squares fit to the data. The coefficients
+// a[i] interpolate the residuals of the fit and are the solution to the
+// sparse symmetric positive definite system (Phi + lambda*I)*a = residuals,
+// where Phi[i][j] = phi(|p[i]-p[j]|/r) and lambda is the smoothing parameter
+// as in the thin-plate splines. The system is solved by the conjugate
+// gradient method; the diagonal of the matrix is the constant 1 + lambda,
+// so Jacobi preconditioning would not change the iterates. The points are
+// sorted into a grid of cells of size r, so the matrix and an evaluation
+// visit only the points of the 3^N cells around a point.
+//
+// The support radius trades accuracy for speed. The number k of points
+// within distance r of a point is the number of nonzeros per row of the
+// matrix, and the number of iterations grows with it. For n points spread
+// uniformly in the unit cube, r = (3*k/(4*pi*n))^(1/3). For a smooth
+// function sampled at 20000 points, k = 30 gives a root-mean-square error
+// near 4e-2 relative to the function range and k = 300 near 1e-3, at about
+// 300 and 1600 iterations. The interpolator reverts to the affine term in
+// regions without points whose size is larger than r.
+//
+// Set numThreads to 2 or larger to run the matrix construction, the
+// solver and the batch evaluation as tasks of TaskScheduler::GetDefault().
+// The results depend on numThreads only through the order of the
+// summations of the dot products.
+
+namespace gte
+{
+    template <int32_t N, typename Real>
+    class IntpCompactRBF
+    {
+    public:
+        static_assert(1 <= N && N <= 3, "The Wendland function is positive definite only for N <= 3.");
+
+        // Construction. Data points are (points[i],F[i]) for 0 <= i <
+        // numPoints. The support radius must be positive and the smoothing
+        // parameter must be nonnegative. The solver stops when the norm of
+        // the residual is at most tolerance times the norm of the F values
+        // or after maxIterations iterations.
+        IntpCompactRBF(size_t numPoints, Vector<N, Real> const* points,
+            Real const* F, Real supportRadius, Real smooth, size_t numThreads = 0,
+            Real tolerance = static_cast<Real>(1e-8), size_t maxIterations = 1000)
+            :
+            mNumPoints(numPoints),
+            mPoints(numPoints),
+            mA(numPoints, static_cast<Real>(0)),
+            mB{},
+            mCenter{},
+            mSupportRadius(supportRadius),
+            mInvSupportRadius(static_cast<Real>(1) / supportRadius),
+            mSmooth(smooth),
+            mMin{},
+            mDimensions{},
+            mCells{},
+            mCellOffsets{},
+            mNumIterations(0),
+            mResidual(static_cast<Real>(0)),
+            mInitialized(false)
+        {
+            LogAssert(numPoints >= static_cast<size_t>(N + 1) && points != nullptr
+                && F != nullptr && supportRadius > static_cast<Real>(0)
+                && smooth >= static_cast<Real>(0), "Invalid input.");
+
+            // Sort the points into the cells. The coefficients a[i] are
+            // stored in the same order as the sorted points.
+            std::vector<size_t> order{};
+            CreateGrid(points, order);
+            std::vector<Real> values(mNumPoints);
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                mPoints[i] = points[order[i]];
+                values[i] = F[order[i]];
+            }
+
+            Real dataSqrLength = static_cast<Real>(0);
+            for (auto const& value : values)
+            {
+                dataSqrLength += value * value;
+            }
+
+            FitAffine(values);
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                values[i] -= EvaluateAffine(mPoints[i]);
+            }
+
+            SparseMatrix matrix{};
+            CreateMatrix(numThreads, matrix);
+            mInitialized = SolveCG(numThreads, matrix, values, dataSqrLength,
+                tolerance, maxIterations);
+        }
+
+        // Check this after the constructor call to see whether the solver
+        // converged. The coefficients are those of the last iteration
+        // otherwise, and the interpolator can still be evaluated.
+        inline bool IsInitialized() const
+        {
+            return mInitialized;
+        }
+
+        inline size_t GetNumIterations() const
+        {
+            return mNumIterations;
+        }
+
+        // The norm of the residual of the solver relative to the norm of
+        // the F values.
+        inline Real GetResidual() const
+        {
+            return mResidual;
+        }
+
+        inline Real GetSupportRadius() const
+        {
+            return mSupportRadius;
+        }
+
+        // Evaluate the interpolator.
+        Real operator()(Vector<N, Real> const& p) const
+        {
+            Real result = EvaluateAffine(p);
+            ForEachNeighbor(p, [this, &p, &result](size_t j)
+            {
+                result += mA[j] * Kernel(Length(p - mPoints[j]) * mInvSupportRadius);
+            });
+            return result;
+        }
+
+        // Evaluate the interpolator at numQueries points. The output must
+        // have numQueries elements.
+        void operator()(size_t numQueries, Vector<N, Real> const* queries,
+            Real* output, size_t numThreads = 0) const
+        {
+            ForBlocks(numThreads, numQueries, [this, queries, output](size_t, size_t imin, size_t isup)
+            {
+                for (size_t i = imin; i < isup; ++i)
+                {
+                    output[i] = (*this)(queries[i]);
+                }
+            });
+        }
+
+    private:
+        // The matrix Phi + lambda*I in compressed sparse row format.
+        struct SparseMatrix
+        {
+            std::vector<size_t> rowOffsets, columns;
+            std::vector<Real> values;
+        };
+
+        // Kernel(t) = (1-t)^4*(4*t+1) for t < 1, 0 otherwise.
+        static Real Kernel(Real t)
+        {
+            if (t < static_cast<Real>(1))
+            {
+                Real oneMinusT = static_cast<Real>(1) - t;
+                Real sqr = oneMinusT * oneMinusT;
+                return sqr * sqr * (static_cast<Real>(4) * t + static_cast<Real>(1));
+            }
+            return static_cast<Real>(0);
+        }
+
+        // Execute function(k, begin, end) for consecutive ranges k that
+        // partition [0,numItems), as tasks when numThreads is 2 or larger.
+        // The range of task k is the same for all calls with the same
+        // numItems.
+        template <typename Function>
+        static void ForBlocks(size_t numThreads, size_t numItems, Function const& function)
+        {
+            size_t const numTasks = std::max(std::min(numThreads, numItems), static_cast<size_t>(1));
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks,
+                    [&function, numItems, numTasks](size_t k)
+                    {
+                        function(k, k * numItems / numTasks, (k + 1) * numItems / numTasks);
+                    });
+            }
+            else
+            {
+                function(0, 0, numItems);
+            }
+        }
+
+        // Compute the bounding box of the points and the cells of size r
+        // that cover it. On return, the points order[0], order[1], ... are
+        // sorted by their cells, mCells stores the keys of the nonempty
+        // cells in increasing order and the points of cell mCells[k] are
+        // order[mCellOffsets[k]] through order[mCellOffsets[k+1]-1].
+        void CreateGrid(Vector<N, Real> const* points, std::vector<size_t>& order)
+        {
+            Vector<N, Real> pmax = points[0];
+            mMin = points[0];
+            for (size_t i = 1; i < mNumPoints; ++i)
+            {
+                for (int32_t d = 0; d < N; ++d)
+                {
+                    mMin[d] = std::min(mMin[d], points[i][d]);
+                    pmax[d] = std::max(pmax[d], points[i][d]);
+                }
+            }
+
+            double numCells = 1.0;
+            for (int32_t d = 0; d < N; ++d)
+            {
+                mDimensions[d] = static_cast<uint64_t>(
+                    std::floor((pmax[d] - mMin[d]) * mInvSupportRadius)) + 1;
+                numCells *= static_cast<double>(mDimensions[d]);
+            }
+            LogAssert(numCells < static_cast<double>(std::numeric_limits<uint64_t>::max()),
+                "The support radius is too small for the extent of the points.");
+
+            std::vector<std::pair<uint64_t, size_t>> keys(mNumPoints);
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                std::array<uint64_t, N> cell = GetCell(points[i]);
+                keys[i] = std::make_pair(GetKey(cell), i);
+            }
+            std::sort(keys.begin(), keys.end());
+
+            order.resize(mNumPoints);
+            mCells.clear();
+            mCellOffsets.clear();
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                if (i == 0 || keys[i].first != keys[i - 1].first)
+                {
+                    mCells.push_back(keys[i].first);
+                    mCellOffsets.push_back(i);
+                }
+                order[i] = keys[i].second;
+            }
+            mCellOffsets.push_back(mNumPoints);
+        }
+
+        // The cell containing p, clamped to the grid.
+        std::array<uint64_t, N> GetCell(Vector<N, Real> const& p) const
+        {
+            std::array<uint64_t, N> cell{};
+            for (int32_t d = 0; d < N; ++d)
+            {
+                Real t = std::floor((p[d] - mMin[d]) * mInvSupportRadius);
+                if (t <= static_cast<Real>(0))
+                {
+                    cell[d] = 0;
+                }
+                else if (t >= static_cast<Real>(mDimensions[d] - 1))
+                {
+                    cell[d] = mDimensions[d] - 1;
+                }
+                else
+                {
+                    cell[d] = static_cast<uint64_t>(t);
+                }
+            }
+            return cell;
+        }
+
+        uint64_t GetKey(std::array<uint64_t, N> const& cell) const
+        {
+            uint64_t key = cell[N - 1];
+            for (int32_t d = N - 2; d >= 0; --d)
+            {
+                key = key * mDimensions[d] + cell[d];
+            }
+            return key;
+        }
+
+        // Execute function(j) for the indices j of the sorted points in the
+        // 3^N cells around the cell of p, which include all the points
+        // within distance r of p. The points within the grid are in the
+        // clamped cells, so the points are found also for p outside the
+        // bounding box.
+        template <typename Function>
+        void ForEachNeighbor(Vector<N, Real> const& p, Function const& function) const
+        {
+            // A point farther than r from the box has no neighbors.
+            for (int32_t d = 0; d < N; ++d)
+            {
+                Real const pmax = mMin[d] + static_cast<Real>(mDimensions[d]) * mSupportRadius;
+                if (p[d] < mMin[d] - mSupportRadius || p[d] > pmax + mSupportRadius)
+                {
+                    return;
+                }
+            }
+
+            std::array<uint64_t, N> const center = GetCell(p);
+            std::array<uint64_t, N> cmin{}, cmax{};
+            for (int32_t d = 0; d < N; ++d)
+            {
+                cmin[d] = (center[d] > 0 ? center[d] - 1 : 0);
+                cmax[d] = std::min(center[d] + 1, mDimensions[d] - 1);
+            }
+
+            std::array<uint64_t, N> cell = cmin;
+            for (;;)
+            {
+                uint64_t const key = GetKey(cell);
+                auto iter = std::lower_bound(mCells.begin(), mCells.end(), key);
+                if (iter != mCells.end() && *iter == key)
+                {
+                    size_t const k = static_cast<size_t>(iter - mCells.begin());
+                    for (size_t j = mCellOffsets[k]; j < mCellOffsets[k + 1]; ++j)
+                    {
+                        function(j);
+                    }
+                }
+
+                // Advance to the next cell of the block.
+                int32_t d = 0;
+                for (; d < N; ++d)
+                {
+                    if (cell[d] < cmax[d])
+                    {
+                        ++cell[d];
+                        break;
+                    }
+                    cell[d] = cmin[d];
+                }
+                if (d == N)
+                {
+                    return;
+                }
+            }
+        }
+
+        // The least-squares fit of b[0] + sum_{d} b[d+1]*(p[d]-c[d]) to the
+        // values. When the points lie in a lower-dimensional affine space,
+        // the fit is the constant average of the values.
+        void FitAffine(std::vector<Real> const& values)
+        {
+            mCenter.MakeZero();
+            Real average = static_cast<Real>(0);
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                mCenter += mPoints[i];
+                average += values[i];
+            }
+            Real const invNumPoints = static_cast<Real>(1) / static_cast<Real>(mNumPoints);
+            mCenter *= invNumPoints;
+            average *= invNumPoints;
+
+            std::array<Real, (N + 1) * (N + 1)> A{};
+            std::array<Real, N + 1> B{}, X{};
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                std::array<Real, N + 1> basis{};
+                basis[0] = static_cast<Real>(1);
+                for (int32_t d = 0; d < N; ++d)
+                {
+                    basis[d + 1] = mPoints[i][d] - mCenter[d];
+                }
+
+                for (int32_t row = 0; row <= N; ++row)
+                {
+                    for (int32_t col = 0; col <= N; ++col)
+                    {
+                        A[row * (N + 1) + col] += basis[row] * basis[col];
+                    }
+                    B[row] += basis[row] * values[i];
+                }
+            }
+
+            if (LinearSystem<Real>::Solve(N + 1, A.data(), B.data(), X.data()))
+            {
+                mB = X;
+            }
+            else
+            {
+                mB.fill(static_cast<Real>(0));
+                mB[0] = average;
+            }
+        }
+
+        Real EvaluateAffine(Vector<N, Real> const& p) const
+        {
+            Real result = mB[0];
+            for (int32_t d = 0; d < N; ++d)
+            {
+                result += mB[d + 1] * (p[d] - mCenter[d]);
+            }
+            return result;
+        }
+
+        // Compute the rows of Phi + lambda*I. The rows are counted and then
+        // filled, both in parallel.
+        void CreateMatrix(size_t numThreads, SparseMatrix& matrix) const
+        {
+            matrix.rowOffsets.assign(mNumPoints + 1, 0);
+            ForBlocks(numThreads, mNumPoints, [this, &matrix](size_t, size_t imin, size_t isup)
+            {
+                for (size_t i = imin; i < isup; ++i)
+                {
+                    size_t numNonzeros = 0;
+                    ForEachNeighbor(mPoints[i], [this, i, &numNonzeros](size_t j)
+                    {
+                        if (j == i || Length(mPoints[i] - mPoints[j]) < mSupportRadius)
+                        {
+                            ++numNonzeros;
+                        }
+                    });
+                    matrix.rowOffsets[i + 1] = numNonzeros;
+                }
+            });
+
+            for (size_t i = 0; i < mNumPoints; ++i)
+            {
+                matrix.rowOffsets[i + 1] += matrix.rowOffsets[i];
+            }
+            matrix.columns.resize(matrix.rowOffsets.back());
+            matrix.values.resize(matrix.rowOffsets.back());
+
+            ForBlocks(numThreads, mNumPoints, [this, &matrix](size_t, size_t imin, size_t isup)
+            {
+                for (size_t i = imin; i < isup; ++i)
+                {
+                    size_t k = matrix.rowOffsets[i];
+                    ForEachNeighbor(mPoints[i], [this, i, &matrix, &k](size_t j)
+                    {
+                        if (j == i)
+                        {
+                            matrix.columns[k] = j;
+                            matrix.values[k] = static_cast<Real>(1) + mSmooth;
+                            ++k;
+                        }
+                        else
+                        {
+                            Real const t = Length(mPoints[i] - mPoints[j]) * mInvSupportRadius;
+                            if (t < static_cast<Real>(1))
+                            {
+                                matrix.columns[k] = j;
+                                matrix.values[k] = Kernel(t);
+                                ++k;
+                            }
+                        }
+                    });
+                }
+            });
+        }
+
+        // The conjugate gradient method for matrix*mA = rhs, starting at
+        // mA = 0. The tolerance is relative to the norm of the data rather
+        // than that of rhs, which is small when the affine term fits well.
+        bool SolveCG(size_t numThreads, SparseMatrix const& matrix,
+            std::vector<Real> const& rhs, Real dataSqrLength, Real tolerance,
+            size_t maxIterations)
+        {
+            size_t const numTasks = std::max(std::min(numThreads, mNumPoints), static_cast<size_t>(1));
+            std::vector<Real> partial(numTasks);
+            auto Dot = [this, numThreads, &partial](
+                std::vector<Real> const& u, std::vector<Real> const& v)
+            {
+                ForBlocks(numThreads, mNumPoints, [&partial, &u, &v](size_t k, size_t imin, size_t isup)
+                {
+                    Real sum = static_cast<Real>(0);
+                    for (size_t i = imin; i < isup; ++i)
+                    {
+                        sum += u[i] * v[i];
+                    }
+                    partial[k] = sum;
+                });
+
+                Real sum = static_cast<Real>(0);
+                for (auto const& value : partial)
+                {
+                    sum += value;
+                }
+                return sum;
+            };
+
+            std::vector<Real> r = rhs, p = rhs, Ap(mNumPoints);
+            Real rSqrLength = Dot(rhs, rhs);
+            if (dataSqrLength == static_cast<Real>(0))
+            {
+                dataSqrLength = static_cast<Real>(1);
+            }
+
+            Real const threshold = tolerance * tolerance * dataSqrLength;
+            for (mNumIterations = 0; mNumIterations < maxIterations; ++mNumIterations)
+            {
+                if (rSqrLength <= threshold)
+                {
+                    break;
+                }
+
+                ForBlocks(numThreads, mNumPoints, [&matrix, &p, &Ap](size_t, size_t imin, size_t isup)
+                {
+                    for (size_t i = imin; i < isup; ++i)
+                    {
+                        Real sum = static_cast<Real>(0);
+                        for (size_t k = matrix.rowOffsets[i]; k < matrix.rowOffsets[i + 1]; ++k)
+                        {
+                            sum += matrix.values[k] * p[matrix.columns[k]];
+                        }
+                        Ap[i] = sum;
+                    }
+                });
+
+                Real const alpha = rSqrLength / Dot(p, Ap);
+                ForBlocks(numThreads, mNumPoints, [this, alpha, &p, &Ap, &r](size_t, size_t imin, size_t isup)
+                {
+                    for (size_t i = imin; i < isup; ++i)
+                    {
+                        mA[i] += alpha * p[i];
+                        r[i] -= alpha * Ap[i];
+                    }
+                });
+
+                Real const nextSqrLength = Dot(r, r);
+                Real const beta = nextSqrLength / rSqrLength;
+                rSqrLength = nextSqrLength;
+                ForBlocks(numThreads, mNumPoints, [beta, &p, &r](size_t, size_t imin, size_t isup)
+                {
+                    for (size_t i = imin; i < isup; ++i)
+                    {
+                        p[i] = r[i] + beta * p[i];
+                    }
+                });
+            }
+
+            mResidual = std::sqrt(rSqrLength / dataSqrLength);
+            return rSqrLength <= threshold;
+        }
+
+        // Input data, sorted by cells.
+        size_t mNumPoints;
+        std::vector<Vector<N, Real>> mPoints;
+
+        // The coefficients a[i] of the sorted points and the coefficients
+        // b[] of the affine term, which is relative to the center c.
+        std::vector<Real> mA;
+        std::array<Real, N + 1> mB;
+        Vector<N, Real> mCenter;
+        Real mSupportRadius, mInvSupportRadius, mSmooth;
+
+        // The grid of cells of size r with minimum corner mMin.
+        Vector<N, Real> mMin;
+        std::array<uint64_t, N> mDimensions;
+        std::vector<uint64_t> mCells;
+        std::vector<size_t> mCellOffsets;
+
+        size_t mNumIterations;
+        Real mResidual;
+        bool mInitialized;
+    };
+}
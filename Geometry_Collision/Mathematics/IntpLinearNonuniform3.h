@@ -9,6 +9,10 @@
 
 #include <Mathematics/Logger.h>
 #include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <vector>
 
 // Linear interpolation of a network of triangles whose vertices are of the
 // form (x,y,z,f(x,y,z)).  The function samples are F[i] and represent
@@ -19,6 +23,11 @@
 //   int32_t GetContainingTetrahedron(Vector3<Real> const&) const;
 //   bool GetIndices(int32_t, std::array<int32_t, 4>&) const;
 //   bool GetBarycentrics(int32_t, Vector3<Real> const&, Real[4]) const;
+//
+// The batch interpolation requires also
+//   void GetContainingTetrahedra(size_t, Vector3<Real> const*, int32_t*,
+//       size_t) const;
+// Delaunay3Mesh supports both.
 
 namespace gte
 {
@@ -40,8 +49,66 @@ namespace gte
         // which case the interpolation is valid.
         bool operator()(Vector3<Real> const& P, Real& F) const
         {
-            int32_t t = mMesh->GetContainingTetrahedron(P);
-            if (t == -1)
+            return Evaluate(mMesh->GetContainingTetrahedron(P), P, F);
+        }
+
+        // Linear interpolation of a batch of points, such as the points of
+        // a resampling grid. The points are located by the batch search of
+        // the mesh, and the searches and the interpolation are distributed
+        // over numThreads threads, or the hardware concurrency when
+        // numThreads is 0. On return valid[i] is the return value of
+        // operator()(points[i], F[i]). The function returns the number of
+        // valid points.
+        size_t operator()(size_t numPoints, Vector3<Real> const* points, Real* F, bool* valid,
+            size_t numThreads = 1) const
+        {
+            using Index = decltype(mMesh->GetContainingTetrahedron(points[0]));
+            std::vector<Index> simplices(numPoints);
+            mMesh->GetContainingTetrahedra(numPoints, points, simplices.data(), numThreads);
+
+            if (numThreads == 0)
+            {
+                numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            numThreads = std::max(std::min(numThreads, numPoints), static_cast<size_t>(1));
+
+            std::vector<size_t> numValid(numThreads, 0);
+            auto interpolate = [this, points, F, valid, &simplices, &numValid](
+                size_t thread, size_t begin, size_t end)
+            {
+                for (size_t i = begin; i < end; ++i)
+                {
+                    valid[i] = Evaluate(simplices[i], points[i], F[i]);
+                    numValid[thread] += (valid[i] ? 1 : 0);
+                }
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+            for (size_t t = 1; t < numThreads; ++t)
+            {
+                threads.emplace_back(interpolate, t, t * numPoints / numThreads,
+                    (t + 1) * numPoints / numThreads);
+            }
+            interpolate(0, 0, numPoints / numThreads);
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            size_t total = 0;
+            for (auto number : numValid)
+            {
+                total += number;
+            }
+            return total;
+        }
+
+    private:
+        template <typename Index>
+        bool Evaluate(Index t, Vector3<Real> const& P, Real& F) const
+        {
+            if (t == static_cast<Index>(-1))
             {
                 // The point is outside the tetrahedralization.
                 return false;
@@ -65,7 +132,6 @@ namespace gte
             return true;
         }
 
-    private:
         TetrahedronMesh const* mMesh;
         Real const* mF;
     };
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <Mathematics/GMatrix.h>
+#include <Mathematics/TaskScheduler.h>
 #include <array>
 
 // WARNING.  The implementation allows you to transform the inputs (x,y) to
@@ -18,6 +19,10 @@
 // rotations of (x,y) but not to scaling.  The following document is about
 // thin plate splines.
 //   https://www.geometrictools.com/Documentation/ThinPlateSplines.pdf
+//
+// The construction inverts a dense numPoints-by-numPoints matrix, which is
+// O(n^3) time and O(n^2) memory. For large point sets, see the sparse
+// interpolator IntpCompactRBF.
 
 namespace gte
 {
@@ -209,6 +214,34 @@ namespace gte
             return std::numeric_limits<Real>::max();
         }
 
+        // Evaluate the interpolator at the numQueries points (X[i],Y[i]). The
+        // output must have numQueries elements. Set numThreads to 2 or
+        // larger to evaluate the points in blocks that are tasks of
+        // TaskScheduler::GetDefault().
+        void operator()(size_t numQueries, Real const* X, Real const* Y,
+            Real* output, size_t numThreads = 0) const
+        {
+            size_t const numTasks = std::max(std::min(numThreads, numQueries), static_cast<size_t>(1));
+            auto evaluateBlock = [this, X, Y, output, numQueries, numTasks](size_t k)
+            {
+                size_t const imin = k * numQueries / numTasks;
+                size_t const isup = (k + 1) * numQueries / numTasks;
+                for (size_t i = imin; i < isup; ++i)
+                {
+                    output[i] = (*this)(X[i], Y[i]);
+                }
+            };
+
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, evaluateBlock);
+            }
+            else
+            {
+                evaluateBlock(0);
+            }
+        }
+
         // Compute the functional value a^T*M*a when lambda is zero or
         // lambda*w^T*(M+lambda*I)*w when lambda is positive.  See the thin
         // plate splines PDF for a description of these quantities.
@@ -8,6 +8,8 @@
 #pragma once
 
 #include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 #include <array>
 
 // The interpolator is for uniformly spaced(x,y z)-values.  The input samples
@@ -387,7 +389,170 @@ namespace gte
             return result;
         }
 
+        // Evaluate the function at the numQueries points (X[i],Y[i],Z[i]),
+        // whose coordinates are stored in separate arrays.  The output
+        // output[i] is (*this)(X[i], Y[i], Z[i]).  Set numThreads to 2 or
+        // larger to evaluate blocks of points as tasks of
+        // TaskScheduler::GetDefault().
+        void operator()(size_t numQueries, Real const* X, Real const* Y,
+            Real const* Z, Real* output, size_t numThreads = 0) const
+        {
+            Evaluate(numQueries, X, Y, Z, output, nullptr, nullptr, nullptr, numThreads);
+        }
+
+        // The same as the previous function, but it also computes the
+        // gradient when gradX, gradY and gradZ are not null, for example the
+        // normal of a signed distance field.  The output gradX[i] is
+        // (*this)(1, 0, 0, X[i], Y[i], Z[i]), and similarly for gradY and
+        // gradZ.  The 2x2x2 block of samples of a point is fetched once for
+        // the function and the gradient, and it is reused by the next point
+        // when that point is in the same cell, so spatially coherent queries
+        // read the samples once per cell.
+        void Evaluate(size_t numQueries, Real const* X, Real const* Y,
+            Real const* Z, Real* output, Real* gradX, Real* gradY, Real* gradZ,
+            size_t numThreads = 0) const
+        {
+            LogAssert((gradX && gradY && gradZ) || (!gradX && !gradY && !gradZ),
+                "The gradient outputs must all be null or all be non-null.");
+
+            size_t const numTasks = std::max(std::min(numThreads, numQueries / 1024),
+                static_cast<size_t>(1));
+            auto evaluateBlock = [this, numQueries, numTasks, X, Y, Z, output,
+                gradX, gradY, gradZ](size_t k)
+            {
+                EvaluateBlock(k * numQueries / numTasks, (k + 1) * numQueries / numTasks,
+                    X, Y, Z, output, gradX, gradY, gradZ);
+            };
+
+            if (numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, evaluateBlock);
+            }
+            else
+            {
+                evaluateBlock(0);
+            }
+        }
+
     private:
+        // Support for the batch evaluations.  The arithmetic is that of the
+        // single-point operators, so the results are the same.
+        void EvaluateBlock(size_t imin, size_t isup, Real const* X, Real const* Y,
+            Real const* Z, Real* output, Real* gradX, Real* gradY, Real* gradZ) const
+        {
+            // The 2x2x2 samples of the current cell, D[col + 2*(row + 2*slice)].
+            std::array<Real, 8> D{};
+            int32_t ixCurrent = -1, iyCurrent = -1, izCurrent = -1;
+            std::array<Real, 2> P{}, Q{}, R{}, PDer{}, QDer{}, RDer{};
+            for (size_t i = imin; i < isup; ++i)
+            {
+                // Compute the indices and clamp to the image.
+                Real xIndex = (X[i] - mXMin) * mInvXSpacing;
+                int32_t ix = ClampIndex(static_cast<int32_t>(xIndex), mXBound);
+                Real yIndex = (Y[i] - mYMin) * mInvYSpacing;
+                int32_t iy = ClampIndex(static_cast<int32_t>(yIndex), mYBound);
+                Real zIndex = (Z[i] - mZMin) * mInvZSpacing;
+                int32_t iz = ClampIndex(static_cast<int32_t>(zIndex), mZBound);
+
+                if (ix != ixCurrent || iy != iyCurrent || iz != izCurrent)
+                {
+                    for (int32_t slice = 0; slice < 2; ++slice)
+                    {
+                        int32_t zClamp = iz + slice;
+                        if (zClamp >= mZBound)
+                        {
+                            zClamp = mZBound - 1;
+                        }
+
+                        for (int32_t row = 0; row < 2; ++row)
+                        {
+                            int32_t yClamp = iy + row;
+                            if (yClamp >= mYBound)
+                            {
+                                yClamp = mYBound - 1;
+                            }
+
+                            for (int32_t col = 0; col < 2; ++col)
+                            {
+                                int32_t xClamp = ix + col;
+                                if (xClamp >= mXBound)
+                                {
+                                    xClamp = mXBound - 1;
+                                }
+
+                                D[col + 2 * (row + 2 * slice)] =
+                                    mF[xClamp + mXBound * (yClamp + mYBound * zClamp)];
+                            }
+                        }
+                    }
+                    ixCurrent = ix;
+                    iyCurrent = iy;
+                    izCurrent = iz;
+                }
+
+                Real dx = xIndex - ix;
+                Real dy = yIndex - iy;
+                Real dz = zIndex - iz;
+                std::array<Real, 2> U{ (Real)1, dx };
+                std::array<Real, 2> V{ (Real)1, dy };
+                std::array<Real, 2> W{ (Real)1, dz };
+                MultiplyBlend(U, P);
+                MultiplyBlend(V, Q);
+                MultiplyBlend(W, R);
+                output[i] = TensorProduct(P, Q, R, D);
+
+                if (gradX)
+                {
+                    std::array<Real, 2> UDer{ (Real)0, (Real)1 };
+                    std::array<Real, 2> VDer{ (Real)0, (Real)1 };
+                    std::array<Real, 2> WDer{ (Real)0, (Real)1 };
+                    MultiplyBlend(UDer, PDer);
+                    MultiplyBlend(VDer, QDer);
+                    MultiplyBlend(WDer, RDer);
+                    gradX[i] = TensorProduct(PDer, Q, R, D) * mInvXSpacing;
+                    gradY[i] = TensorProduct(P, QDer, R, D) * mInvYSpacing;
+                    gradZ[i] = TensorProduct(P, Q, RDer, D) * mInvZSpacing;
+                }
+            }
+        }
+
+        static inline int32_t ClampIndex(int32_t index, int32_t bound)
+        {
+            return (index < 0 ? 0 : (index >= bound ? bound - 1 : index));
+        }
+
+        // Compute P = M*U.
+        inline void MultiplyBlend(std::array<Real, 2> const& U, std::array<Real, 2>& P) const
+        {
+            for (int32_t row = 0; row < 2; ++row)
+            {
+                P[row] = (Real)0;
+                for (int32_t col = 0; col < 2; ++col)
+                {
+                    P[row] += mBlend[row][col] * U[col];
+                }
+            }
+        }
+
+        // Compute the tensor product (M*U)(M*V)(M*W)*D.
+        static inline Real TensorProduct(std::array<Real, 2> const& P,
+            std::array<Real, 2> const& Q, std::array<Real, 2> const& R,
+            std::array<Real, 8> const& D)
+        {
+            Real result = (Real)0;
+            for (int32_t slice = 0; slice < 2; ++slice)
+            {
+                for (int32_t row = 0; row < 2; ++row)
+                {
+                    for (int32_t col = 0; col < 2; ++col)
+                    {
+                        result += P[col] * Q[row] * R[slice] * D[col + 2 * (row + 2 * slice)];
+                    }
+                }
+            }
+            return result;
+        }
+
         int32_t mXBound, mYBound, mZBound, mQuantity;
         Real mXMin, mXMax, mXSpacing, mInvXSpacing;
         Real mYMin, mYMax, mYSpacing, mInvYSpacing;
@@ -42,6 +42,11 @@
 // of edges, Cross(N[i0],box1.Axis[i1]), then (i0,i1) is returned. If
 // 'intersect' is true, the separating[] values are invalid because there is
 // no separation.
+//
+// For pairs of boxes that are queried repeatedly as they move, pass a Cache
+// that persists for the pair. The axis that separated the boxes on the last
+// query is tested first, and for coherent motion it usually still separates
+// them, so the query ends after one axis test instead of up to 15.
 
 namespace gte
 {
@@ -62,6 +67,78 @@ namespace gte
             std::array<int32_t, 2> separating;
         };
 
+        // The separating axis of the last query of a pair, valid when that
+        // query reported separation.
+        struct Cache
+        {
+            Cache()
+                :
+                valid(false),
+                separating{ 0, 0 }
+            {
+            }
+
+            bool valid;
+            std::array<int32_t, 2> separating;
+        };
+
+        Result operator()(AlignedBox3<T> const& box0, OrientedBox3<T> const& box1,
+            Cache& cache, T epsilon = static_cast<T>(0))
+        {
+            Result result{};
+            if (cache.valid && IsSeparating(box0, box1, cache.separating, epsilon))
+            {
+                result.intersect = false;
+                result.separating = cache.separating;
+                return result;
+            }
+
+            result = operator()(box0, box1, epsilon);
+            cache.valid = !result.intersect;
+            cache.separating = result.separating;
+            return result;
+        }
+
+        // Test whether the axis identified by 'separating', with the same
+        // meaning as in Result, separates the boxes. An edge-edge axis whose
+        // face normals are parallel according to epsilon is not tested and
+        // the function returns false.
+        static bool IsSeparating(AlignedBox3<T> const& box0, OrientedBox3<T> const& box1,
+            std::array<int32_t, 2> const& separating, T epsilon = static_cast<T>(0))
+        {
+            Vector3<T> C0{}, E0{};
+            box0.GetCenteredForm(C0, E0);
+
+            Vector3<T> axis{};
+            if (separating[1] < 0)
+            {
+                axis = Vector3<T>::Unit(separating[0]);
+            }
+            else if (separating[0] < 0)
+            {
+                axis = box1.axis[separating[1]];
+            }
+            else
+            {
+                Vector3<T> const& N1 = box1.axis[separating[1]];
+                T const cutoff = static_cast<T>(1) - std::max(epsilon, static_cast<T>(0));
+                if (std::fabs(N1[separating[0]]) >= cutoff)
+                {
+                    return false;
+                }
+                axis = Cross(Vector3<T>::Unit(separating[0]), N1);
+            }
+
+            T const r = std::fabs(Dot(box1.center - C0, axis));
+            T r01 = static_cast<T>(0);
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                r01 += E0[i] * std::fabs(axis[i]);
+                r01 += box1.extent[i] * std::fabs(Dot(box1.axis[i], axis));
+            }
+            return r > r01;
+        }
+
         Result operator()(AlignedBox3<T> const& box0, OrientedBox3<T> const& box1,
             T epsilon = static_cast<T>(0))
         {
@@ -12,7 +12,10 @@
 #include <Mathematics/ConvexMesh3.h>
 #include <Mathematics/EdgeKey.h>
 #include <Mathematics/Hyperplane.h>
+#include <Mathematics/TaskScheduler.h>
 #include <Mathematics/UniqueVerticesSimplices.h>
+#include <map>
+#include <set>
 
 namespace gte
 {
@@ -213,6 +216,42 @@ namespace gte
             return result;
         }
 
+        // Intersect the convex polyhedron with each of the planes, for
+        // example to compute cross sections or to cut the polyhedron into
+        // fragments. The queries are independent and are processed as
+        // tasks of TaskScheduler::GetDefault() when numThreads is 2 or
+        // larger; results[p] is the result for planes[p].
+        std::vector<Result> operator() (ConvexMesh3<Real> const& polyhedron,
+            std::vector<Plane3<Real>> const& planes, int32_t requested,
+            size_t numThreads)
+        {
+            size_t const numPlanes = planes.size();
+            std::vector<Result> results(numPlanes);
+            size_t const numTasks = std::max(std::min(numThreads, numPlanes),
+                static_cast<size_t>(1));
+
+            auto process = [this, &polyhedron, &planes, requested, numPlanes,
+                numTasks, &results](size_t k)
+            {
+                size_t const pmin = k * numPlanes / numTasks;
+                size_t const pmax = (k + 1) * numPlanes / numTasks;
+                for (size_t p = pmin; p < pmax; ++p)
+                {
+                    results[p] = operator()(polyhedron, planes[p], requested);
+                }
+            };
+
+            if (numTasks == 1)
+            {
+                process(0);
+            }
+            else
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, process);
+            }
+            return results;
+        }
+
     private:
         static void GetIntersection(CM const& polyhedron, int32_t numZero,
             std::vector<int32_t> const& sign, Result& result)
@@ -0,0 +1,188 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/FIQuery.h>
+#include <Mathematics/Line.h>
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Find-intersection queries of a linear component with many triangles, for
+// example the triangles of a mesh that is picked. The triangles are stored
+// in structure-of-arrays form with the edge vectors precomputed, and the
+// query is the algorithm of Tomas Moller and Ben Trumbore, "Fast, Minimum
+// Storage Ray/Triangle Intersection", 1997. The loops over the triangles
+// have no branches, so the compiler vectorizes them, testing 4 (SSE2) or 8
+// (AVX) triangles per iteration for T = float.
+//
+// The linear component is origin + t * direction for t in [tmin,tmax], so
+// the query applies to lines, rays and segments. A triangle is intersected
+// when the barycentric coordinates of the point are nonnegative, as in
+// FIQuery<T, Line3<T>, Triangle3<T>>. The linear component is not
+// intersected when it is parallel to the plane of the triangle. The
+// results can differ from those of the single-triangle queries by rounding
+// errors for points on the edges of the triangles.
+
+namespace gte
+{
+    template <typename T>
+    class TriangleBatch3
+    {
+    public:
+        TriangleBatch3() = default;
+
+        void Reserve(size_t numTriangles)
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                vertex0[j].reserve(numTriangles);
+                edge1[j].reserve(numTriangles);
+                edge2[j].reserve(numTriangles);
+            }
+        }
+
+        void Clear()
+        {
+            for (size_t j = 0; j < 3; ++j)
+            {
+                vertex0[j].clear();
+                edge1[j].clear();
+                edge2[j].clear();
+            }
+        }
+
+        void Push(Vector3<T> const& v0, Vector3<T> const& v1, Vector3<T> const& v2)
+        {
+            for (int32_t j = 0; j < 3; ++j)
+            {
+                vertex0[j].push_back(v0[j]);
+                edge1[j].push_back(v1[j] - v0[j]);
+                edge2[j].push_back(v2[j] - v0[j]);
+            }
+        }
+
+        inline size_t GetNumTriangles() const
+        {
+            return vertex0[0].size();
+        }
+
+        // Triangle i has vertices V0, V0 + E1 and V0 + E2, where component
+        // j of V0 is vertex0[j][i] and similarly for E1 and E2.
+        std::array<std::vector<T>, 3> vertex0, edge1, edge2;
+    };
+
+    template <typename T>
+    class FIQuery<T, Line3<T>, TriangleBatch3<T>>
+    {
+    public:
+        struct Intersection
+        {
+            Intersection()
+                :
+                triangle(0),
+                parameter(static_cast<T>(0)),
+                triangleBary{ static_cast<T>(0), static_cast<T>(0), static_cast<T>(0) }
+            {
+            }
+
+            size_t triangle;
+            T parameter;
+            std::array<T, 3> triangleBary;
+        };
+
+        struct Result
+        {
+            Result()
+                :
+                intersections{}
+            {
+            }
+
+            // The intersected triangles in increasing order of index. The
+            // intersection point is origin + parameter * direction and
+            // triangleBary[] are its barycentric coordinates.
+            std::vector<Intersection> intersections;
+        };
+
+        // Append to 'result' the intersections of the linear component with
+        // triangles first through first + numTriangles - 1 of the batch.
+        void operator()(Line3<T> const& line, T tmin, T tmax,
+            TriangleBatch3<T> const& batch, size_t first, size_t numTriangles,
+            Result& result)
+        {
+            T const zero = static_cast<T>(0), one = static_cast<T>(1);
+            T const ox = line.origin[0], oy = line.origin[1], oz = line.origin[2];
+            T const dx = line.direction[0], dy = line.direction[1], dz = line.direction[2];
+
+            std::array<T, blockSize> parameter{}, bary1{}, bary2{}, isHit{};
+            for (size_t block = 0; block < numTriangles; block += blockSize)
+            {
+                size_t const i0 = first + block;
+                size_t const numBlock = std::min(blockSize, numTriangles - block);
+                T const* v0x = batch.vertex0[0].data() + i0;
+                T const* v0y = batch.vertex0[1].data() + i0;
+                T const* v0z = batch.vertex0[2].data() + i0;
+                T const* e1x = batch.edge1[0].data() + i0;
+                T const* e1y = batch.edge1[1].data() + i0;
+                T const* e1z = batch.edge1[2].data() + i0;
+                T const* e2x = batch.edge2[0].data() + i0;
+                T const* e2y = batch.edge2[1].data() + i0;
+                T const* e2z = batch.edge2[2].data() + i0;
+
+                for (size_t k = 0; k < numBlock; ++k)
+                {
+                    // P = Cross(D,E2), det = Dot(E1,P). For det = 0 the
+                    // line is parallel to the triangle, and the products
+                    // with the infinite inverse make the tests fail.
+                    T const px = dy * e2z[k] - dz * e2y[k];
+                    T const py = dz * e2x[k] - dx * e2z[k];
+                    T const pz = dx * e2y[k] - dy * e2x[k];
+                    T const invDet = one / (e1x[k] * px + e1y[k] * py + e1z[k] * pz);
+
+                    // S = O - V0, Q = Cross(S,E1).
+                    T const sx = ox - v0x[k];
+                    T const sy = oy - v0y[k];
+                    T const sz = oz - v0z[k];
+                    T const qx = sy * e1z[k] - sz * e1y[k];
+                    T const qy = sz * e1x[k] - sx * e1z[k];
+                    T const qz = sx * e1y[k] - sy * e1x[k];
+
+                    T const b1 = (sx * px + sy * py + sz * pz) * invDet;
+                    T const b2 = (dx * qx + dy * qy + dz * qz) * invDet;
+                    T const t = (e2x[k] * qx + e2y[k] * qy + e2z[k] * qz) * invDet;
+                    parameter[k] = t;
+                    bary1[k] = b1;
+                    bary2[k] = b2;
+                    isHit[k] = ((b1 >= zero) & (b2 >= zero) & (b1 + b2 <= one)
+                        & (t >= tmin) & (t <= tmax)) ? one : zero;
+                }
+
+                for (size_t k = 0; k < numBlock; ++k)
+                {
+                    if (isHit[k] != zero)
+                    {
+                        Intersection intersection{};
+                        intersection.triangle = i0 + k;
+                        intersection.parameter = parameter[k];
+                        intersection.triangleBary[0] = one - bary1[k] - bary2[k];
+                        intersection.triangleBary[1] = bary1[k];
+                        intersection.triangleBary[2] = bary2[k];
+                        result.intersections.push_back(intersection);
+                    }
+                }
+            }
+        }
+
+    private:
+        static size_t constexpr blockSize = 64;
+    };
+}
@@ -0,0 +1,294 @@
+#pragma once
+
+#include <Mathematics/IntrTriangle3Triangle3.h>
+#include <Mathematics/TriangleArray3.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Batched test-intersection queries for solid triangles, for example the
+// leaf pairs of a bounding volume hierarchy traversal. The interval-overlap
+// test of Moller is evaluated for a block of triangle pairs at a time. The
+// loop over the block uses selects rather than branches, so the compiler
+// vectorizes it for float and double.
+//
+//   1. The vertices of triangle1 are classified by their signed distances
+//      to the plane of triangle0, and vice versa. If all the vertices of a
+//      triangle are strictly on one side of the plane of the other, the
+//      triangles do not intersect.
+//   2. Otherwise the planes intersect in a line with direction
+//      D = Cross(N0, N1). Each triangle intersects the line in an interval
+//      whose endpoints are the crossings of the triangle edges whose
+//      vertices have distances of opposite signs. The triangles intersect
+//      when the intervals overlap.
+//
+// The test is decided in floating-point arithmetic only when its outcome
+// is not sensitive to rounding. A pair is passed to the separating-axis
+// query TIQuery<T, Triangle3<T>, Triangle3<T>> when a signed distance of
+// step 1 is within a tolerance of zero (a vertex touches a plane, or the
+// triangles are coplanar or degenerate) or the gap between the intervals
+// of step 2 is within a tolerance of zero (the triangles touch). The
+// tolerances are relative: epsilon times the magnitude of the vectors
+// involved, so they do not depend on the scale of the input.
+//
+// The results are written as a bit mask: bit j of mask[j / 64] is set iff
+// test j finds an intersection. The return value is the number of
+// intersections.
+//
+//   TIQuery<T, TriangleArray3<T>, TriangleArray3<T>>
+//       triangle j of the first array against triangle j of the second;
+//       the arrays must have the same size
+//   TIQuery<T, Triangle3<T>, TriangleArray3<T>>
+//       one triangle against every triangle of the array
+
+namespace gte
+{
+    // The kernel shared by the batched triangle-triangle queries.
+    template <typename T>
+    class Triangle3Triangle3BatchKernel
+    {
+    public:
+        // The default relative tolerance of the floating-point test.
+        static T constexpr defaultEpsilon = static_cast<T>(64) * std::numeric_limits<T>::epsilon();
+
+        // Triangle0 j has vertices (v0[i][0][j],v0[i][1][j],v0[i][2][j])
+        // for i = 0,1,2 and likewise for triangle1 j. The stride of an
+        // array is 0 when one triangle is tested against all the others.
+        template <size_t stride0, size_t stride1>
+        static size_t Run(size_t numTests,
+            std::array<std::array<T const*, 3>, 3> const& v0,
+            std::array<std::array<T const*, 3>, 3> const& v1,
+            T epsilon, std::vector<uint64_t>& mask)
+        {
+            mask.assign((numTests + 63) / 64, 0);
+            size_t numIntersections = 0;
+            std::array<uint32_t, 64> overlap{}, uncertain{};
+            TIQuery<T, Triangle3<T>, Triangle3<T>> fallback{};
+            for (size_t begin = 0, w = 0; begin < numTests; begin += 64, ++w)
+            {
+                size_t const count = (numTests - begin < 64 ? numTests - begin : 64);
+                TestBlock<stride0, stride1>(count, begin * stride0, begin * stride1,
+                    v0, v1, epsilon, overlap, uncertain);
+
+                uint64_t word = 0;
+                for (size_t j = 0; j < count; ++j)
+                {
+                    uint64_t intersect = static_cast<uint64_t>(overlap[j]);
+                    if (uncertain[j] != 0)
+                    {
+                        size_t const t0 = (begin + j) * stride0;
+                        size_t const t1 = (begin + j) * stride1;
+                        Triangle3<T> triangle0{}, triangle1{};
+                        for (int32_t i = 0; i < 3; ++i)
+                        {
+                            for (int32_t d = 0; d < 3; ++d)
+                            {
+                                triangle0.v[i][d] = v0[i][d][t0];
+                                triangle1.v[i][d] = v1[i][d][t1];
+                            }
+                        }
+                        intersect = static_cast<uint64_t>(fallback(triangle0, triangle1).intersect);
+                    }
+                    word |= intersect << j;
+                    numIntersections += static_cast<size_t>(intersect);
+                }
+                mask[w] = word;
+            }
+            return numIntersections;
+        }
+
+    private:
+        // The selects have the operand order of the min and max
+        // instructions, so that the compiler does not generate branches
+        // for them.
+        static inline T Min(T a, T b)
+        {
+            return (a < b ? a : b);
+        }
+
+        static inline T Max(T a, T b)
+        {
+            return (b < a ? a : b);
+        }
+
+        static inline T Abs(T a)
+        {
+            return Max(a, -a);
+        }
+
+        struct Vec
+        {
+            T x, y, z;
+        };
+
+        static inline Vec Sub(Vec const& a, Vec const& b)
+        {
+            return Vec{ a.x - b.x, a.y - b.y, a.z - b.z };
+        }
+
+        static inline Vec Cross(Vec const& a, Vec const& b)
+        {
+            return Vec{ a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+        }
+
+        static inline T Dot(Vec const& a, Vec const& b)
+        {
+            return a.x * b.x + a.y * b.y + a.z * b.z;
+        }
+
+        static inline T AbsSum(Vec const& a)
+        {
+            return Abs(a.x) + Abs(a.y) + Abs(a.z);
+        }
+
+        static inline T AbsMax(Vec const& a)
+        {
+            return Max(Max(Abs(a.x), Abs(a.y)), Abs(a.z));
+        }
+
+        // The crossing of the line by the edge (pa,da)-(pb,db), where p is
+        // the projection onto the line and d is the signed distance to the
+        // plane of the other triangle. The crossing is replaced by
+        // +infinity for the minimum and -infinity for the maximum of the
+        // interval when the edge does not cross the plane.
+        static inline void Crossing(T pa, T da, T pb, T db, T& tmin, T& tmax)
+        {
+            T const infinity = std::numeric_limits<T>::infinity();
+            bool const crosses = (da * db < static_cast<T>(0));
+            T const denom = (crosses ? da - db : static_cast<T>(1));
+            T const t = pa + (pb - pa) * (da / denom);
+            tmin = Min(tmin, crosses ? t : infinity);
+            tmax = Max(tmax, crosses ? t : -infinity);
+        }
+
+        template <size_t stride0, size_t stride1>
+        static void TestBlock(size_t count, size_t s0, size_t s1,
+            std::array<std::array<T const*, 3>, 3> const& v0,
+            std::array<std::array<T const*, 3>, 3> const& v1,
+            T epsilon, std::array<uint32_t, 64>& overlap,
+            std::array<uint32_t, 64>& uncertain)
+        {
+            // The pointers are copied to local variables and the flags are
+            // not bytes, so the compiler can prove that the stores of the
+            // flags do not modify the inputs, which is required to
+            // vectorize the loop.
+            std::array<std::array<T const*, 3>, 3> const p0 = v0, p1 = v1;
+            T const zero = static_cast<T>(0);
+            T const infinity = std::numeric_limits<T>::infinity();
+            for (size_t j = 0; j < count; ++j)
+            {
+                size_t const k0 = s0 + j * stride0, k1 = s1 + j * stride1;
+
+                // Translate the triangles so that triangle0.v[0] is the
+                // origin, which reduces the rounding errors.
+                Vec const origin{ p0[0][0][k0], p0[0][1][k0], p0[0][2][k0] };
+                Vec const a1 = Sub(Vec{ p0[1][0][k0], p0[1][1][k0], p0[1][2][k0] }, origin);
+                Vec const a2 = Sub(Vec{ p0[2][0][k0], p0[2][1][k0], p0[2][2][k0] }, origin);
+                Vec const b0 = Sub(Vec{ p1[0][0][k1], p1[0][1][k1], p1[0][2][k1] }, origin);
+                Vec const b1 = Sub(Vec{ p1[1][0][k1], p1[1][1][k1], p1[1][2][k1] }, origin);
+                Vec const b2 = Sub(Vec{ p1[2][0][k1], p1[2][1][k1], p1[2][2][k1] }, origin);
+                T const extent = Max(Max(Max(AbsMax(a1), AbsMax(a2)),
+                    Max(AbsMax(b0), AbsMax(b1))), AbsMax(b2));
+
+                // Signed distances of the vertices of triangle1 to the
+                // plane of triangle0, which contains the origin.
+                Vec const N0 = Cross(a1, a2);
+                T const dB0 = Dot(N0, b0), dB1 = Dot(N0, b1), dB2 = Dot(N0, b2);
+                T const tolB = epsilon * AbsSum(N0) * extent;
+
+                // Signed distances of the vertices of triangle0 to the
+                // plane of triangle1.
+                Vec const N1 = Cross(Sub(b1, b0), Sub(b2, b0));
+                T const dA0 = -Dot(N1, b0);
+                T const dA1 = Dot(N1, Sub(a1, b0)), dA2 = Dot(N1, Sub(a2, b0));
+                T const tolA = epsilon * AbsSum(N1) * extent;
+
+                // The logical operators are bitwise so that they do not
+                // generate branches.
+                bool const separated =
+                    (Min(Min(dB0, dB1), dB2) > tolB) | (Max(Max(dB0, dB1), dB2) < -tolB) |
+                    (Min(Min(dA0, dA1), dA2) > tolA) | (Max(Max(dA0, dA1), dA2) < -tolA);
+                bool const nearPlane =
+                    (Min(Min(Abs(dB0), Abs(dB1)), Abs(dB2)) <= tolB) |
+                    (Min(Min(Abs(dA0), Abs(dA1)), Abs(dA2)) <= tolA);
+
+                // Project onto the line of intersection of the planes and
+                // compute the intervals of the triangles on the line.
+                Vec const D = Cross(N0, N1);
+                T const pA0 = zero, pA1 = Dot(D, a1), pA2 = Dot(D, a2);
+                T const pB0 = Dot(D, b0), pB1 = Dot(D, b1), pB2 = Dot(D, b2);
+                T minA = infinity, maxA = -infinity;
+                Crossing(pA0, dA0, pA1, dA1, minA, maxA);
+                Crossing(pA1, dA1, pA2, dA2, minA, maxA);
+                Crossing(pA2, dA2, pA0, dA0, minA, maxA);
+                T minB = infinity, maxB = -infinity;
+                Crossing(pB0, dB0, pB1, dB1, minB, maxB);
+                Crossing(pB1, dB1, pB2, dB2, minB, maxB);
+                Crossing(pB2, dB2, pB0, dB0, minB, maxB);
+
+                // The intervals overlap when gap <= 0.
+                T const gap = Max(minA, minB) - Min(maxA, maxB);
+                T const tolD = epsilon * AbsSum(D) * extent;
+                bool const nearTouch = (Abs(gap) <= tolD);
+
+                overlap[j] = static_cast<uint32_t>(!separated & (gap <= zero));
+                uncertain[j] = static_cast<uint32_t>(!separated & (nearPlane | nearTouch));
+            }
+        }
+    };
+
+    template <typename T>
+    class TIQuery<T, TriangleArray3<T>, TriangleArray3<T>>
+    {
+    public:
+        size_t operator()(TriangleArray3<T> const& triangles0,
+            TriangleArray3<T> const& triangles1, std::vector<uint64_t>& mask,
+            T epsilon = Triangle3Triangle3BatchKernel<T>::defaultEpsilon)
+        {
+            LogAssert(
+                triangles0.size() == triangles1.size(),
+                "The arrays must have the same size.");
+
+            return Triangle3Triangle3BatchKernel<T>::template Run<1, 1>(triangles0.size(),
+                GetPointers(triangles0), GetPointers(triangles1), epsilon, mask);
+        }
+
+    private:
+        static std::array<std::array<T const*, 3>, 3> GetPointers(TriangleArray3<T> const& triangles)
+        {
+            std::array<std::array<T const*, 3>, 3> pointers{};
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    pointers[i][d] = triangles.v[i][d].data();
+                }
+            }
+            return pointers;
+        }
+    };
+
+    template <typename T>
+    class TIQuery<T, Triangle3<T>, TriangleArray3<T>>
+    {
+    public:
+        size_t operator()(Triangle3<T> const& triangle0,
+            TriangleArray3<T> const& triangles1, std::vector<uint64_t>& mask,
+            T epsilon = Triangle3Triangle3BatchKernel<T>::defaultEpsilon)
+        {
+            std::array<std::array<T const*, 3>, 3> pointers0{}, pointers1{};
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    pointers0[i][d] = &triangle0.v[i][d];
+                    pointers1[i][d] = triangles1.v[i][d].data();
+                }
+            }
+            return Triangle3Triangle3BatchKernel<T>::template Run<0, 1>(triangles1.size(),
+                pointers0, pointers1, epsilon, mask);
+        }
+    };
+}
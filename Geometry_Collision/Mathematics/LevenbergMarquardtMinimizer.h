@@ -7,8 +7,10 @@
 
 #pragma once
 
+#include <Mathematics/BatchedNormalEquations.h>
 #include <Mathematics/CholeskyDecomposition.h>
 #include <functional>
+#include <memory>
 
 // See GaussNewtonMinimizer.h for a formulation of the minimization
 // problem and how Levenberg-Marquardt relates to Gauss-Newton.
@@ -29,6 +31,7 @@ namespace gte
         typedef std::function<void(DVector const&, RVector&)> FFunction;
         typedef std::function<void(DVector const&, JMatrix&)> JFunction;
         typedef std::function<void(DVector const&, JTJMatrix&, JTFVector&)> JPlusFunction;
+        typedef typename BatchedNormalEquations<T>::BatchFunction BatchFunction;
 
         // Create the minimizer that computes F(p) and J(p) directly.
         LevenbergMarquardtMinimizer(int32_t numPDimensions, int32_t numFDimensions,
@@ -42,7 +45,10 @@ namespace gte
             mJ(mNumFDimensions, mNumPDimensions),
             mJTJ(mNumPDimensions, mNumPDimensions),
             mNegJTF(mNumPDimensions),
+            mJTJBase(mNumPDimensions, mNumPDimensions),
+            mNegJTFBase(mNumPDimensions),
             mDecomposer(mNumPDimensions),
+            mBatch{},
             mUseJFunction(true)
         {
             LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
@@ -60,12 +66,38 @@ namespace gte
             mJ(mNumFDimensions, mNumPDimensions),
             mJTJ(mNumPDimensions, mNumPDimensions),
             mNegJTF(mNumPDimensions),
+            mJTJBase(mNumPDimensions, mNumPDimensions),
+            mNegJTFBase(mNumPDimensions),
             mDecomposer(mNumPDimensions),
+            mBatch{},
             mUseJFunction(false)
         {
             LogAssert(mNumPDimensions > 0 && mNumFDimensions > 0, "Invalid dimensions.");
         }
 
+        // Create the minimizer that evaluates blocks of components of F(p)
+        // and rows of J(p) by a batch function and accumulates J^T(p)*J(p)
+        // and -J^T(p)*F(p) from them; see BatchedNormalEquations.h. The
+        // Jacobian is not stored, and for numThreads > 0 the blocks are
+        // processed by multiple threads.
+        LevenbergMarquardtMinimizer(int32_t numPDimensions, int32_t numFDimensions,
+            BatchFunction const& inBatchFunction, size_t numThreads = 0)
+            :
+            mNumPDimensions(numPDimensions),
+            mNumFDimensions(numFDimensions),
+            mF{},
+            mJ{},
+            mJTJ(mNumPDimensions, mNumPDimensions),
+            mNegJTF(mNumPDimensions),
+            mJTJBase(mNumPDimensions, mNumPDimensions),
+            mNegJTFBase(mNumPDimensions),
+            mDecomposer(mNumPDimensions),
+            mBatch(std::make_unique<BatchedNormalEquations<T>>(numPDimensions,
+                numFDimensions, inBatchFunction, numThreads)),
+            mUseJFunction(false)
+        {
+        }
+
         // Disallow copy, assignment and move semantics.
         LevenbergMarquardtMinimizer(LevenbergMarquardtMinimizer const&) = delete;
         LevenbergMarquardtMinimizer& operator=(LevenbergMarquardtMinimizer const&) = delete;
@@ -132,13 +164,16 @@ namespace gte
             errorDifferenceTolerance = std::max(errorDifferenceTolerance, (T)0);
 
             // Compute the initial error.
-            mFFunction(p0, mF);
-            result.minError = Dot(mF, mF);
+            result.minError = ComputeError(p0);
 
             // Do the Levenberg-Marquart iterations.
             auto pCurrent = p0;
             for (result.numIterations = 1; result.numIterations <= maxIterations; ++result.numIterations)
             {
+                // The inputs depend on pCurrent but not on lambda, so they
+                // are computed once for all the adjustments of lambda.
+                ComputeLinearSystemInputs(pCurrent);
+
                 std::pair<bool, bool> status;
                 DVector pNext;
                 for (result.numAdjustments = 0; result.numAdjustments < maxAdjustments; ++result.numAdjustments)
@@ -198,18 +233,44 @@ namespace gte
         }
 
     private:
-        void ComputeLinearSystemInputs(DVector const& pCurrent, T lambda)
+        T ComputeError(DVector const& p)
+        {
+            if (mBatch)
+            {
+                return mBatch->ComputeError(p);
+            }
+            else
+            {
+                mFFunction(p, mF);
+                return Dot(mF, mF);
+            }
+        }
+
+        // The function is called when mF stores F(pCurrent).
+        void ComputeLinearSystemInputs(DVector const& pCurrent)
         {
-            if (mUseJFunction)
+            if (mBatch)
+            {
+                mBatch->Compute(pCurrent, mJTJBase, mNegJTFBase);
+            }
+            else if (mUseJFunction)
             {
                 mJFunction(pCurrent, mJ);
-                mJTJ = MultiplyATB(mJ, mJ);
-                mNegJTF = -(mF * mJ);
+                mJTJBase = MultiplyATB(mJ, mJ);
+                mNegJTFBase = -(mF * mJ);
             }
             else
             {
-                mJPlusFunction(pCurrent, mJTJ, mNegJTF);
+                mJPlusFunction(pCurrent, mJTJBase, mNegJTFBase);
             }
+        }
+
+        // Copy the inputs to the storage of the decomposition and add the
+        // lambda term to the diagonal.
+        void AdjustLinearSystemInputs(T lambda)
+        {
+            mJTJ = mJTJBase;
+            mNegJTF = mNegJTFBase;
 
             T diagonalSum(0);
             for (int32_t i = 0; i < mNumPDimensions; ++i)
@@ -234,7 +295,7 @@ namespace gte
             T updateLengthTolerance, T errorDifferenceTolerance, DVector& pNext,
             Result& result)
         {
-            ComputeLinearSystemInputs(pCurrent, lambdaFactor);
+            AdjustLinearSystemInputs(lambdaFactor);
             if (!mDecomposer.Factor(mJTJ))
             {
                 // TODO: The matrix mJTJ is positive semi-definite, so the
@@ -247,8 +308,7 @@ namespace gte
             mDecomposer.SolveUpper(mJTJ, mNegJTF);
 
             pNext = pCurrent + mNegJTF;
-            mFFunction(pNext, mF);
-            T error = Dot(mF, mF);
+            T error = ComputeError(pNext);
             if (error < result.minError)
             {
                 result.minErrorDifference = result.minError - error;
@@ -283,7 +343,13 @@ namespace gte
         JTJMatrix mJTJ;
         JTFVector mNegJTF;
 
+        // J^T(p)*J(p) and -J^T(p)*F(p) at the current iterate, which are
+        // reused by the adjustments of lambda.
+        JTJMatrix mJTJBase;
+        JTFVector mNegJTFBase;
+
         CholeskyDecomposition<T> mDecomposer;
+        std::unique_ptr<BatchedNormalEquations<T>> mBatch;
 
         bool mUseJFunction;
     };
@@ -6,6 +6,8 @@
 #include "Matrix3x3.h"
 #include "Matrix4x4.h"
 #include "GaussianElimination.h"
+#include "CSRMatrix.h"
+#include <limits>
 #include <map>
 
 // Solve linear systems of equations where the matrix A is NxN.  The return
@@ -264,6 +266,134 @@ namespace gte
             return iteration;
         }
 
+        // Solve A*X = B using the preconditioned conjugate gradient method,
+        // where A is sparse and symmetric positive (semi)definite and stored
+        // in compressed sparse row format with both (i,j) and (j,i). The
+        // iterations stop when |B - A*X| <= tolerance * |B|. The return value
+        // is the number of iterations, which is maxIterations + 1 when the
+        // tolerance is not reached.
+        //
+        // JACOBI scales the residual by the inverse diagonal of A. IC0 uses
+        // the incomplete Cholesky factor L of A whose sparsity pattern is
+        // that of the lower triangle of A; it reduces the number of
+        // iterations much more on meshes and grids, but its triangular
+        // solves are sequential. When A has a diagonal element that is not
+        // positive, JACOBI is used instead of IC0.
+        //
+        // When warmStart is true, X on input is the initial guess, typically
+        // the solution of the previous time step; otherwise the initial
+        // guess is zero. Set numThreads to 2 or larger to compute the
+        // matrix-vector products, dot products and vector updates in blocks
+        // as tasks of TaskScheduler::GetDefault().
+        enum class Preconditioner
+        {
+            NONE,
+            JACOBI,
+            IC0
+        };
+
+        static uint32_t SolveSymmetricCG(CSRMatrix<Real> const& A, Real const* B,
+            Real* X, uint32_t maxIterations, Real tolerance,
+            Preconditioner preconditioner = Preconditioner::JACOBI,
+            bool warmStart = false, size_t numThreads = 0)
+        {
+            LogAssert(A.GetNumRows() == A.GetNumCols(), "The matrix must be square.");
+            int32_t const N = A.GetNumRows();
+            if (N == 0)
+            {
+                return 0;
+            }
+
+            std::vector<Real> invDiagonal{}, factor{};
+            if (preconditioner == Preconditioner::IC0 && !FactorIC0(A, factor))
+            {
+                preconditioner = Preconditioner::JACOBI;
+            }
+            if (preconditioner == Preconditioner::JACOBI)
+            {
+                invDiagonal.resize(N);
+                for (int32_t i = 0; i < N; ++i)
+                {
+                    Real diagonal = A(i, i);
+                    invDiagonal[i] = (diagonal > (Real)0 ? (Real)1 / diagonal : (Real)1);
+                }
+            }
+
+            std::vector<Real> tmpR(N), tmpZ(N), tmpP(N), tmpW(N);
+            Real* R = tmpR.data();
+            Real* Z = tmpZ.data();
+            Real* P = tmpP.data();
+            Real* W = tmpW.data();
+            size_t numBytes = N * sizeof(Real);
+            if (warmStart)
+            {
+                A.Multiply(X, W, numThreads);
+                ForBlocks(N, numThreads, [R, B, W](size_t, int32_t imin, int32_t imax)
+                {
+                    for (int32_t i = imin; i < imax; ++i)
+                    {
+                        R[i] = B[i] - W[i];
+                    }
+                });
+            }
+            else
+            {
+                std::memset(X, 0, numBytes);
+                std::memcpy(R, B, numBytes);
+            }
+
+            Real threshold = tolerance * std::sqrt(Dot(N, B, B, numThreads));
+            Real rr = Dot(N, R, R, numThreads);
+            uint32_t iteration = 0;
+            Real rho0 = (Real)0;
+            while (std::sqrt(rr) > threshold)
+            {
+                if (iteration == maxIterations)
+                {
+                    return maxIterations + 1;
+                }
+
+                Precondition(A, preconditioner, invDiagonal, factor, R, Z, numThreads);
+                Real rho1 = Dot(N, R, Z, numThreads);
+                if (iteration == 0)
+                {
+                    std::memcpy(P, Z, numBytes);
+                }
+                else
+                {
+                    Real beta = rho1 / rho0;
+                    ForBlocks(N, numThreads, [P, Z, beta](size_t, int32_t imin, int32_t imax)
+                    {
+                        for (int32_t i = imin; i < imax; ++i)
+                        {
+                            P[i] = Z[i] + beta * P[i];
+                        }
+                    });
+                }
+
+                A.Multiply(P, W, numThreads);
+                Real pw = Dot(N, P, W, numThreads);
+                if (pw <= (Real)0)
+                {
+                    // A is singular along P, so X cannot be improved.
+                    return maxIterations + 1;
+                }
+                Real alpha = rho1 / pw;
+                ForBlocks(N, numThreads, [X, R, P, W, alpha](size_t, int32_t imin, int32_t imax)
+                {
+                    for (int32_t i = imin; i < imax; ++i)
+                    {
+                        X[i] += alpha * P[i];
+                        R[i] -= alpha * W[i];
+                    }
+                });
+                rr = Dot(N, R, R, numThreads);
+                rho0 = rho1;
+                ++iteration;
+            }
+            return iteration;
+        }
+
     private:
         // Support for the conjugate gradient method.
         static Real Dot(int32_t N, Real const* U, Real const* V)
@@ -333,5 +463,185 @@ namespace gte
                 P[i] = R[i] + beta * P[i];
             }
         }
+
+        // Support for the preconditioned conjugate gradient method with a
+        // CSRMatrix. The vectors are processed in blocks of consecutive
+        // indices, function(block, imin, imax), one block per task. The
+        // partial sums of Dot are added in block order, so the result
+        // depends only on numThreads.
+        template <typename Function>
+        static void ForBlocks(int32_t N, size_t numThreads, Function const& function)
+        {
+            size_t const numTasks = std::max(std::min(numThreads,
+                static_cast<size_t>(N) / 4096), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                function(0, 0, N);
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [N, numTasks, &function](size_t k)
+                {
+                    int32_t imin = static_cast<int32_t>(k * N / numTasks);
+                    int32_t imax = static_cast<int32_t>((k + 1) * N / numTasks);
+                    function(k, imin, imax);
+                });
+        }
+
+        static Real Dot(int32_t N, Real const* U, Real const* V, size_t numThreads)
+        {
+            std::vector<Real> partial(std::max(numThreads, static_cast<size_t>(1)), (Real)0);
+            ForBlocks(N, numThreads, [U, V, &partial](size_t k, int32_t imin, int32_t imax)
+            {
+                Real dot = (Real)0;
+                for (int32_t i = imin; i < imax; ++i)
+                {
+                    dot += U[i] * V[i];
+                }
+                partial[k] = dot;
+            });
+
+            Real dot = (Real)0;
+            for (auto const& value : partial)
+            {
+                dot += value;
+            }
+            return dot;
+        }
+
+        // Compute the incomplete Cholesky factor L, A = L*L^T + E, where L
+        // has the sparsity pattern of the lower triangle of A. The values of
+        // L are stored in the order of the lower-triangle elements of each
+        // row of A, with the diagonal element last. The function returns
+        // false when a diagonal element of A is not positive.
+        static bool FactorIC0(CSRMatrix<Real> const& A, std::vector<Real>& factor)
+        {
+            int32_t const N = A.GetNumRows();
+            auto const& offsets = A.GetRowOffsets();
+            auto const& columns = A.GetColumns();
+            auto const& values = A.GetValues();
+
+            // lowerEnd[r] is one past the diagonal element of row r.
+            std::vector<size_t> lowerEnd(N);
+            for (int32_t r = 0; r < N; ++r)
+            {
+                size_t k = offsets[r];
+                while (k < offsets[static_cast<size_t>(r) + 1] && columns[k] < r)
+                {
+                    ++k;
+                }
+                if (k == offsets[static_cast<size_t>(r) + 1] || columns[k] != r)
+                {
+                    return false;
+                }
+                lowerEnd[r] = k + 1;
+            }
+
+            // The factor uses the storage of A, the elements of the upper
+            // triangle are not referenced.
+            Real const epsilon = std::sqrt(std::numeric_limits<Real>::epsilon());
+            factor.resize(values.size());
+            for (int32_t r = 0; r < N; ++r)
+            {
+                size_t const kmin = offsets[r], kdiag = lowerEnd[r] - 1;
+                for (size_t k = kmin; k < kdiag; ++k)
+                {
+                    // L(r,c) = (A(r,c) - sum_{j<c} L(r,j)*L(c,j)) / L(c,c)
+                    int32_t const c = columns[k];
+                    size_t const cdiag = lowerEnd[c] - 1;
+                    Real sum = values[k];
+                    size_t i0 = kmin, i1 = offsets[c];
+                    while (i0 < k && i1 < cdiag)
+                    {
+                        if (columns[i0] < columns[i1])
+                        {
+                            ++i0;
+                        }
+                        else if (columns[i1] < columns[i0])
+                        {
+                            ++i1;
+                        }
+                        else
+                        {
+                            sum -= factor[i0++] * factor[i1++];
+                        }
+                    }
+                    factor[k] = sum / factor[cdiag];
+                }
+
+                // A pivot that is not positive or is tiny compared to the
+                // diagonal of A, for example the last pivot of a singular
+                // Laplacian matrix, is replaced by the diagonal of A.
+                Real diagonal = values[kdiag], pivot = diagonal;
+                for (size_t k = kmin; k < kdiag; ++k)
+                {
+                    pivot -= factor[k] * factor[k];
+                }
+                if (!(pivot > epsilon * diagonal))
+                {
+                    if (!(diagonal > (Real)0))
+                    {
+                        return false;
+                    }
+                    pivot = diagonal;
+                }
+                factor[kdiag] = std::sqrt(pivot);
+            }
+            return true;
+        }
+
+        // Compute Z = M^{-1}*R for the preconditioner M.
+        static void Precondition(CSRMatrix<Real> const& A, Preconditioner preconditioner,
+            std::vector<Real> const& invDiagonal, std::vector<Real> const& factor,
+            Real const* R, Real* Z, size_t numThreads)
+        {
+            int32_t const N = A.GetNumRows();
+            if (preconditioner == Preconditioner::JACOBI)
+            {
+                Real const* invD = invDiagonal.data();
+                ForBlocks(N, numThreads, [R, Z, invD](size_t, int32_t imin, int32_t imax)
+                {
+                    for (int32_t i = imin; i < imax; ++i)
+                    {
+                        Z[i] = invD[i] * R[i];
+                    }
+                });
+            }
+            else if (preconditioner == Preconditioner::IC0)
+            {
+                auto const& offsets = A.GetRowOffsets();
+                auto const& columns = A.GetColumns();
+
+                // Solve L*Y = R, then L^T*Z = Y, in place in Z.
+                for (int32_t r = 0; r < N; ++r)
+                {
+                    Real sum = R[r];
+                    size_t k = offsets[r];
+                    for (; columns[k] < r; ++k)
+                    {
+                        sum -= factor[k] * Z[columns[k]];
+                    }
+                    Z[r] = sum / factor[k];
+                }
+                for (int32_t r = N - 1; r >= 0; --r)
+                {
+                    size_t kdiag = offsets[r];
+                    while (columns[kdiag] < r)
+                    {
+                        ++kdiag;
+                    }
+                    Z[r] /= factor[kdiag];
+                    for (size_t k = offsets[r]; k < kdiag; ++k)
+                    {
+                        Z[columns[k]] -= factor[k] * Z[r];
+                    }
+                }
+            }
+            else
+            {
+                std::memcpy(Z, R, N * sizeof(Real));
+            }
+        }
     };
 }
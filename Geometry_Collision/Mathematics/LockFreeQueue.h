@@ -0,0 +1,179 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+// A bounded multiple-producer multiple-consumer queue that does not use a
+// mutex. It is a drop-in alternative to ThreadSafeQueue when many threads
+// push and pop concurrently. The elements are stored in a ring buffer whose
+// capacity is the smallest power of two that is at least maxNumElements.
+// Each cell has a sequence number that tells the producers and consumers
+// whether the cell is ready for them, so a Push or Pop claims its cell with
+// a single compare-and-swap on the tail or head index. The algorithm is
+// the bounded MPMC queue of Dmitry Vyukov,
+// https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+//
+// Unlike ThreadSafeQueue, the queue is always bounded, so maxNumElements
+// must be positive. Element must be default constructible and assignable.
+// GetNumElements() is exact only when no other thread modifies the queue.
+
+namespace gte
+{
+    template <typename Element>
+    class LockFreeQueue
+    {
+    public:
+        // Construction and destruction.
+        LockFreeQueue(size_t maxNumElements)
+            :
+            mMask(0),
+            mCells{},
+            mHead(0),
+            mTail(0)
+        {
+            LogAssert(maxNumElements > 0, "The queue must be bounded.");
+
+            size_t capacity = 1;
+            while (capacity < maxNumElements)
+            {
+                capacity <<= 1;
+            }
+            mMask = capacity - 1;
+
+            mCells = std::make_unique<Cell[]>(capacity);
+            for (size_t i = 0; i < capacity; ++i)
+            {
+                mCells[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        virtual ~LockFreeQueue() = default;
+
+        LockFreeQueue(LockFreeQueue const&) = delete;
+        LockFreeQueue& operator=(LockFreeQueue const&) = delete;
+
+        // All the operations are thread-safe.
+        inline size_t GetMaxNumElements() const
+        {
+            return mMask + 1;
+        }
+
+        size_t GetNumElements() const
+        {
+            size_t const head = mHead.value.load(std::memory_order_acquire);
+            size_t const tail = mTail.value.load(std::memory_order_acquire);
+            return (tail > head ? tail - head : 0);
+        }
+
+        // The return value is 'false' when the queue is full.
+        bool Push(Element const& element)
+        {
+            Cell* cell = nullptr;
+            size_t position = mTail.value.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &mCells[position & mMask];
+                size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t const difference =
+                    static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+                if (difference == 0)
+                {
+                    // The cell is free. Claim it unless another producer
+                    // claimed it first, in which case 'position' is
+                    // updated to the current tail.
+                    if (mTail.value.compare_exchange_weak(position, position + 1,
+                        std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // The cell still holds the element pushed one lap
+                    // earlier, so the queue is full.
+                    return false;
+                }
+                else
+                {
+                    position = mTail.value.load(std::memory_order_relaxed);
+                }
+            }
+
+            cell->element = element;
+            cell->sequence.store(position + 1, std::memory_order_release);
+            return true;
+        }
+
+        // The return value is 'false' when the queue is empty.
+        bool Pop(Element& element)
+        {
+            Cell* cell = nullptr;
+            size_t position = mHead.value.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                cell = &mCells[position & mMask];
+                size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+                intptr_t const difference =
+                    static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+                if (difference == 0)
+                {
+                    if (mHead.value.compare_exchange_weak(position, position + 1,
+                        std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (difference < 0)
+                {
+                    // No producer has filled the cell, so the queue is
+                    // empty.
+                    return false;
+                }
+                else
+                {
+                    position = mHead.value.load(std::memory_order_relaxed);
+                }
+            }
+
+            element = cell->element;
+            cell->sequence.store(position + mMask + 1, std::memory_order_release);
+            return true;
+        }
+
+    protected:
+        // The head and tail indices are on separate cache lines so that
+        // producers and consumers do not invalidate each other's lines.
+        static size_t constexpr cacheLineSize = 64;
+
+        struct Cell
+        {
+            std::atomic<size_t> sequence;
+            Element element;
+        };
+
+        struct alignas(cacheLineSize) Index
+        {
+            Index(size_t initial)
+                :
+                value(initial)
+            {
+            }
+
+            std::atomic<size_t> value;
+        };
+
+        size_t mMask;
+        std::unique_ptr<Cell[]> mCells;
+        Index mHead, mTail;
+    };
+}
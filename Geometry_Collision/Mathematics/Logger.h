@@ -11,6 +11,35 @@
     #define GTE_THROW_OR_TERMINATE(exception, message) std::terminate()
 #endif
 
+// The validation policy selects the builds in which the assertions test
+// their conditions. Define GTE_VALIDATION to one of
+//   GTE_VALIDATION_FULL   always (the default)
+//   GTE_VALIDATION_DEBUG  only when NDEBUG is not defined
+//   GTE_VALIDATION_NONE   never
+// The policy applies to GTE_ASSERT, GTE_ASSERT_INDIRECT and LogAssert and
+// to the assertions of the top-level Exceptions.h. The errors (GTE_ERROR,
+// GTE_ERROR_INDIRECT and LogError) are not affected. A condition that is
+// not tested is not evaluated, so the conditions must not have side
+// effects. Use the same policy for all translation units of a program.
+#define GTE_VALIDATION_NONE 0
+#define GTE_VALIDATION_DEBUG 1
+#define GTE_VALIDATION_FULL 2
+
+#if !defined(GTE_VALIDATION)
+#define GTE_VALIDATION GTE_VALIDATION_FULL
+#endif
+
+#if (GTE_VALIDATION == GTE_VALIDATION_FULL) || (GTE_VALIDATION == GTE_VALIDATION_DEBUG && !defined(NDEBUG))
+#define GTE_VALIDATION_ENABLED 1
+#else
+#define GTE_VALIDATION_ENABLED 0
+#endif
+
+// An assertion whose condition is not tested. The condition is an
+// unevaluated operand, so variables that are used only in assertions do
+// not generate unused-variable warnings.
+#define GTE_UNCHECKED_ASSERT(condition) static_cast<void>(sizeof(!(condition)))
+
 // Generate exceptions about unexpected conditions. The messages can be
 // intercepted in a 'catch' block and processed as desired. The 'exception'
 // in the macros is one of the standard exceptions provided by C++. You can
@@ -19,16 +48,26 @@
 
 // The report uses the current source file, function and line on which the
 // macro is expanded.
+#if GTE_VALIDATION_ENABLED
 #define GTE_ASSERT(condition, exception, message) \
 if (!(condition)) { GTE_THROW_OR_TERMINATE(exception, std::string(__FILE__) + "(" + std::string(__FUNCTION__) + "," + std::to_string(__LINE__) + "): " + message + "\n"); }
+#else
+#define GTE_ASSERT(condition, exception, message) \
+GTE_UNCHECKED_ASSERT(condition)
+#endif
 
 #define GTE_ERROR(exception, message) \
 { GTE_THROW_OR_TERMINATE(exception, std::string(__FILE__) + "(" + std::string(__FUNCTION__) + "," + std::to_string(__LINE__) + "): " + message + "\n"); }
 
 // The report uses the specified source file, function and line. The file
 // and function are type 'char const*' and the line is type 'int32_t'.
+#if GTE_VALIDATION_ENABLED
 #define GTE_ASSERT_INDIRECT(condition, exception, file, function, line, message) \
 if (!(condition)) { GTE_THROW_OR_TERMINATE(exception, std::string(file) + "(" + std::string(function) + "," + std::to_string(line) + "): " + message + "\n"); }
+#else
+#define GTE_ASSERT_INDIRECT(condition, exception, file, function, line, message) \
+GTE_UNCHECKED_ASSERT(condition)
+#endif
 
 #define GTE_ERROR_INDIRECT(exception, file, function, line, message) \
 { GTE_THROW_OR_TERMINATE(exception, std::string(file) + "(" + std::string(function) + "," + std::to_string(line) + "): " + message + "\n"); }
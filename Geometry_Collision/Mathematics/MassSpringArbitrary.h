@@ -111,6 +111,17 @@ namespace gte
             return acceleration;
         }
 
+        // Callback for UpdateImplicit(...).
+        virtual void GetSprings(std::vector<typename ParticleSystem<N, Real>::SpringElement>& springs) const override
+        {
+            springs.resize(mSpring.size());
+            for (size_t i = 0; i < mSpring.size(); ++i)
+            {
+                Spring const& spring = mSpring[i];
+                springs[i] = { spring.particle0, spring.particle1, spring.constant, spring.length };
+            }
+        }
+
         std::vector<Spring> mSpring;
 
         // Each particle has an associated array of spring indices for those
@@ -107,6 +107,16 @@ namespace gte
             return acceleration;
         }
 
+        // Callback for UpdateImplicit(...).
+        virtual void GetSprings(std::vector<typename ParticleSystem<N, Real>::SpringElement>& springs) const override
+        {
+            springs.resize(static_cast<size_t>(GetNumSprings()));
+            for (int32_t i = 0; i < GetNumSprings(); ++i)
+            {
+                springs[i] = { i, i + 1, mConstant[i], mLength[i] };
+            }
+        }
+
         std::vector<Real> mConstant, mLength;
     };
 }
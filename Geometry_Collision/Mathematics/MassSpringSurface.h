@@ -208,6 +208,93 @@ namespace gte
             return acceleration;
         }
 
+        // Callback for UpdateParallel(...). The ranges of particles consist
+        // of whole rows. The force of each spring is computed once for the
+        // range, including the springs to the rows of the neighboring
+        // ranges, and the accelerations are accumulated in the order of
+        // Acceleration(...), so the results are the same.
+        virtual int32_t GetBlockSize() const override
+        {
+            return mNumCols;
+        }
+
+        virtual void Accelerations(int32_t i0, int32_t i1, Real time,
+            std::vector<Vector<N, Real>> const& position,
+            std::vector<Vector<N, Real>> const& velocity,
+            std::vector<Vector<N, Real>>& acceleration) override
+        {
+            // The force of the r-spring from particle i to i + C is stored in
+            // forceR[i - i0 + C] and the force of the c-spring from i to
+            // i + 1 in forceC[i - i0].
+            int32_t const r0 = i0 / mNumCols, r1 = i1 / mNumCols;
+            std::vector<Vector<N, Real>> forceR(static_cast<size_t>(i1 - i0 + mNumCols));
+            std::vector<Vector<N, Real>> forceC(static_cast<size_t>(i1 - i0));
+
+            for (int32_t r = std::max(r0 - 1, 0); r < std::min(r1, mNumRows - 1); ++r)
+            {
+                int32_t const i = mNumCols * r;
+                this->SpringForces(mNumCols, &position[i], &position[i + mNumCols],
+                    &mConstantR[i], &mLengthR[i], &forceR[i - i0 + mNumCols]);
+            }
+
+            for (int32_t r = r0; r < r1; ++r)
+            {
+                int32_t const i = mNumCols * r;
+                this->SpringForces(mNumCols - 1, &position[i], &position[i + 1],
+                    &mConstantC[i], &mLengthC[i], &forceC[i - i0]);
+            }
+
+            for (int32_t r = r0; r < r1; ++r)
+            {
+                for (int32_t c = 0, i = mNumCols * r; c < mNumCols; ++c, ++i)
+                {
+                    Real const invMass = this->mInvMass[i];
+                    if (invMass > (Real)0)
+                    {
+                        int32_t const j = i - i0;
+                        Vector<N, Real> accel = ExternalAcceleration(i, time, position, velocity);
+                        if (r > 0)
+                        {
+                            accel -= invMass * forceR[j];
+                        }
+                        if (r < mNumRows - 1)
+                        {
+                            accel += invMass * forceR[j + mNumCols];
+                        }
+                        if (c > 0)
+                        {
+                            accel -= invMass * forceC[j - 1];
+                        }
+                        if (c < mNumCols - 1)
+                        {
+                            accel += invMass * forceC[j];
+                        }
+                        acceleration[i] = accel;
+                    }
+                }
+            }
+        }
+
+        // Callback for UpdateImplicit(...).
+        virtual void GetSprings(std::vector<typename ParticleSystem<N, Real>::SpringElement>& springs) const override
+        {
+            springs.clear();
+            for (int32_t r = 0, i = 0; r < mNumRows; ++r)
+            {
+                for (int32_t c = 0; c < mNumCols; ++c, ++i)
+                {
+                    if (r < mNumRows - 1)
+                    {
+                        springs.push_back({ i, i + mNumCols, mConstantR[i], mLengthR[i] });
+                    }
+                    if (c < mNumCols - 1)
+                    {
+                        springs.push_back({ i, i + 1, mConstantC[i], mLengthC[i] });
+                    }
+                }
+            }
+        }
+
         inline int32_t GetIndex(int32_t r, int32_t c) const
         {
             return c + mNumCols * r;
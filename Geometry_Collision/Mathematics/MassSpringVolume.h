@@ -261,6 +261,130 @@ namespace gte
             return acceleration;
         }
 
+        // Callback for UpdateParallel(...). The ranges of particles consist
+        // of whole rows, so a task processes a slab of consecutive rows of
+        // consecutive slices. The force of each spring is computed once
+        // for the range, including the springs to the rows of the
+        // neighboring ranges (the halo), which the tasks of those ranges
+        // compute again for their own particles. The springs are processed
+        // a row at a time, and the accelerations are accumulated in the
+        // order of Acceleration(...), so the results are the same.
+        virtual int32_t GetBlockSize() const override
+        {
+            return mNumCols;
+        }
+
+        virtual void Accelerations(int32_t i0, int32_t i1, Real time,
+            std::vector<Vector<N, Real>> const& position,
+            std::vector<Vector<N, Real>> const& velocity,
+            std::vector<Vector<N, Real>>& acceleration) override
+        {
+            // The rows of the range are q0 <= q < q1 for q = r + R * s. The
+            // force of the s-spring from particle i to i + R * C is stored
+            // in forceS[i - i0 + R * C], the force of the r-spring from i
+            // to i + C in forceR[i - i0 + C] and the force of the c-spring
+            // from i to i + 1 in forceC[i - i0].
+            int32_t const numRC = mNumRows * mNumCols;
+            int32_t const q0 = i0 / mNumCols, q1 = i1 / mNumCols;
+            std::vector<Vector<N, Real>> forceS(static_cast<size_t>(i1 - i0 + numRC));
+            std::vector<Vector<N, Real>> forceR(static_cast<size_t>(i1 - i0 + mNumCols));
+            std::vector<Vector<N, Real>> forceC(static_cast<size_t>(i1 - i0));
+
+            for (int32_t q = std::max(q0 - mNumRows, 0); q < q1; ++q)
+            {
+                int32_t const i = mNumCols * q;
+                if (i + numRC < this->mNumParticles)
+                {
+                    this->SpringForces(mNumCols, &position[i], &position[i + numRC],
+                        &mConstantS[i], &mLengthS[i], &forceS[i - i0 + numRC]);
+                }
+            }
+
+            for (int32_t q = std::max(q0 - 1, 0); q < q1; ++q)
+            {
+                int32_t const i = mNumCols * q;
+                if (q % mNumRows < mNumRows - 1)
+                {
+                    this->SpringForces(mNumCols, &position[i], &position[i + mNumCols],
+                        &mConstantR[i], &mLengthR[i], &forceR[i - i0 + mNumCols]);
+                }
+            }
+
+            for (int32_t q = q0; q < q1; ++q)
+            {
+                int32_t const i = mNumCols * q;
+                this->SpringForces(mNumCols - 1, &position[i], &position[i + 1],
+                    &mConstantC[i], &mLengthC[i], &forceC[i - i0]);
+            }
+
+            for (int32_t q = q0; q < q1; ++q)
+            {
+                int32_t const s = q / mNumRows, r = q % mNumRows;
+                for (int32_t c = 0, i = mNumCols * q; c < mNumCols; ++c, ++i)
+                {
+                    Real const invMass = this->mInvMass[i];
+                    if (invMass > (Real)0)
+                    {
+                        int32_t const j = i - i0;
+                        Vector<N, Real> accel = ExternalAcceleration(i, time, position, velocity);
+                        if (s > 0)
+                        {
+                            accel -= invMass * forceS[j];
+                        }
+                        if (s < mNumSlices - 1)
+                        {
+                            accel += invMass * forceS[j + numRC];
+                        }
+                        if (r > 0)
+                        {
+                            accel -= invMass * forceR[j];
+                        }
+                        if (r < mNumRows - 1)
+                        {
+                            accel += invMass * forceR[j + mNumCols];
+                        }
+                        if (c > 0)
+                        {
+                            accel -= invMass * forceC[j - 1];
+                        }
+                        if (c < mNumCols - 1)
+                        {
+                            accel += invMass * forceC[j];
+                        }
+                        acceleration[i] = accel;
+                    }
+                }
+            }
+        }
+
+        // Callback for UpdateImplicit(...).
+        virtual void GetSprings(std::vector<typename ParticleSystem<N, Real>::SpringElement>& springs) const override
+        {
+            int32_t const numRC = mNumRows * mNumCols;
+            springs.clear();
+            for (int32_t s = 0, i = 0; s < mNumSlices; ++s)
+            {
+                for (int32_t r = 0; r < mNumRows; ++r)
+                {
+                    for (int32_t c = 0; c < mNumCols; ++c, ++i)
+                    {
+                        if (s < mNumSlices - 1)
+                        {
+                            springs.push_back({ i, i + numRC, mConstantS[i], mLengthS[i] });
+                        }
+                        if (r < mNumRows - 1)
+                        {
+                            springs.push_back({ i, i + mNumCols, mConstantR[i], mLengthR[i] });
+                        }
+                        if (c < mNumCols - 1)
+                        {
+                            springs.push_back({ i, i + 1, mConstantC[i], mLengthC[i] });
+                        }
+                    }
+                }
+            }
+        }
+
         inline int32_t GetIndex(int32_t s, int32_t r, int32_t c) const
         {
             return c + mNumCols * (r + mNumRows * s);
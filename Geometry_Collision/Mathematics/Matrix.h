@@ -4,6 +4,7 @@
 
 #include "Vector.h"
 #include "GaussianElimination.h"
+#include "MatrixSIMD.h"
 
 namespace Vector_GM
 {
@@ -520,6 +521,13 @@ namespace Vector_GM
         Vector<NumCols, Real> const& V)
     {
         Vector<NumRows, Real> result;
+#if !defined(GTE_USE_ROW_MAJOR)
+        if (MatrixSIMDSelect<NumRows == NumCols && MatrixSIMD<NumRows, Real>::supported>::
+            template Combine<NumRows>(&M[0], &V[0], &result[0]))
+        {
+            return result;
+        }
+#endif
         for (int32_t r = 0; r < NumRows; ++r)
         {
             result[r] = (Real)0;
@@ -537,6 +545,13 @@ namespace Vector_GM
         Matrix<NumRows, NumCols, Real> const& M)
     {
         Vector<NumCols, Real> result;
+#if defined(GTE_USE_ROW_MAJOR)
+        if (MatrixSIMDSelect<NumRows == NumCols && MatrixSIMD<NumRows, Real>::supported>::
+            template Combine<NumRows>(&M[0], &V[0], &result[0]))
+        {
+            return result;
+        }
+#endif
         for (int32_t c = 0; c < NumCols; ++c)
         {
             result[c] = (Real)0;
@@ -563,6 +578,16 @@ namespace Vector_GM
         Matrix<NumCommon, NumCols, Real> const& B)
     {
         Matrix<NumRows, NumCols, Real> result;
+        using Select = MatrixSIMDSelect<NumRows == NumCols && NumCols == NumCommon &&
+            MatrixSIMD<NumRows, Real>::supported>;
+#if defined(GTE_USE_ROW_MAJOR)
+        if (Select::template Multiply<NumRows, false>(&A[0], &B[0], &result[0]))
+#else
+        if (Select::template Multiply<NumRows, false>(&B[0], &A[0], &result[0]))
+#endif
+        {
+            return result;
+        }
         for (int32_t r = 0; r < NumRows; ++r)
         {
             for (int32_t c = 0; c < NumCols; ++c)
@@ -584,6 +609,14 @@ namespace Vector_GM
         Matrix<NumCols, NumCommon, Real> const& B)
     {
         Matrix<NumRows, NumCols, Real> result;
+#if !defined(GTE_USE_ROW_MAJOR)
+        if (MatrixSIMDSelect<NumRows == NumCols && NumCols == NumCommon &&
+            MatrixSIMD<NumRows, Real>::supported>::
+            template Multiply<NumRows, true>(&B[0], &A[0], &result[0]))
+        {
+            return result;
+        }
+#endif
         for (int32_t r = 0; r < NumRows; ++r)
         {
             for (int32_t c = 0; c < NumCols; ++c)
@@ -605,6 +638,14 @@ namespace Vector_GM
         Matrix<NumCommon, NumCols, Real> const& B)
     {
         Matrix<NumRows, NumCols, Real> result;
+#if defined(GTE_USE_ROW_MAJOR)
+        if (MatrixSIMDSelect<NumRows == NumCols && NumCols == NumCommon &&
+            MatrixSIMD<NumRows, Real>::supported>::
+            template Multiply<NumRows, true>(&A[0], &B[0], &result[0]))
+        {
+            return result;
+        }
+#endif
         for (int32_t r = 0; r < NumRows; ++r)
         {
             for (int32_t c = 0; c < NumCols; ++c)
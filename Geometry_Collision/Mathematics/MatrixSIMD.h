@@ -0,0 +1,561 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+// SIMD kernels for the products of 3x3 and 4x4 matrices of float and
+// double. The file is included by Matrix.h. The primary template
+// MatrixSIMD<N, Real> is not supported; its specializations for 3x3 and
+// 4x4 matrices of float and double are compiled only when
+// GTE_USE_MATRIX_SIMD is defined, so by default the generic loops are used
+// for all types. The Matrix.h functions select the kernels through
+// MatrixSIMDSelect<MatrixSIMD<N, Real>::supported>, whose members return
+// false when the kernels are not supported, so the public interface does
+// not change and the selection compiles as C++14.
+//
+// A matrix is stored as N lines of N elements, the rows when
+// GTE_USE_ROW_MAJOR is defined and the columns otherwise. The kernels
+// compute linear combinations of the lines of a matrix Y,
+//   line j of the result = sum_i w(j,i) * (line i of Y)
+// with the weights w(j,i) = X[j*N+i], or X[i*N+j] when X is transposed,
+// taken from the storage of a matrix X. When the lines are columns, A*B
+// and A*B^T have this form with Y = A and X = B; when the lines are rows,
+// A*B and A^T*B have this form with Y = B and X = A. M*V (columns) and
+// V^T*M (rows) are single combinations. The other products use the generic
+// loops.
+//
+// Each element of the result is accumulated as in the generic loops,
+// starting with 0 and adding the products in the order of the common
+// index. The results are therefore the same as those of the generic code,
+// except possibly for the sign and payload of NaN results, provided the
+// compiler does not contract a*b+c into fused multiply-adds in the generic
+// code (MSVC /fp:precise, or -ffp-contract=off for GCC and Clang).
+//
+// The lines of a 3x3 matrix have 3 elements, and a 4-element load of the
+// last line would read past the matrix. A line of 3 floats is loaded as
+// (e0,e1,e2,e2), so the fourth lane repeats the arithmetic of the third
+// one and raises no other floating-point exceptions. A line of 3 doubles
+// is a register with elements 0 and 1 and a scalar with element 2.
+//
+// Supported instruction sets: SSE2 (all x64 targets), AVX for the lines of
+// 4 doubles when __AVX__ is defined, and NEON on AArch64. Other targets use
+// the generic loops.
+
+#include <cstdint>
+
+namespace Vector_GM
+{
+    template <int32_t N, typename Real>
+    struct MatrixSIMD
+    {
+        static bool constexpr supported = false;
+    };
+
+    // The selection of the kernels. The members of MatrixSIMDSelect<false>
+    // do nothing and return false, and the caller then runs the generic
+    // loops. Only the members of the selected specialization are
+    // instantiated, so MatrixSIMD<N, Real> is used only when it is
+    // supported.
+    template <bool Supported>
+    struct MatrixSIMDSelect
+    {
+        template <int32_t N, typename Real>
+        inline static bool Combine(Real const*, Real const*, Real*)
+        {
+            return false;
+        }
+
+        template <int32_t N, bool TransposeX, typename Real>
+        inline static bool Multiply(Real const*, Real const*, Real*)
+        {
+            return false;
+        }
+    };
+
+    template <>
+    struct MatrixSIMDSelect<true>
+    {
+        template <int32_t N, typename Real>
+        inline static bool Combine(Real const* y, Real const* weights, Real* result)
+        {
+            MatrixSIMD<N, Real>::Combine(y, weights, result);
+            return true;
+        }
+
+        template <int32_t N, bool TransposeX, typename Real>
+        inline static bool Multiply(Real const* x, Real const* y, Real* result)
+        {
+            MatrixSIMD<N, Real>::template Multiply<TransposeX>(x, y, result);
+            return true;
+        }
+    };
+}
+
+#if defined(GTE_USE_MATRIX_SIMD)
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GTE_MATRIX_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define GTE_MATRIX_SIMD_AVX
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GTE_MATRIX_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(GTE_MATRIX_SIMD_SSE2) || defined(GTE_MATRIX_SIMD_NEON)
+
+namespace Vector_GM
+{
+    // The register operations on a line of N elements.
+    template <int32_t N, typename Real>
+    struct MatrixSIMDLine;
+
+    template <>
+    struct MatrixSIMDLine<4, float>
+    {
+#if defined(GTE_MATRIX_SIMD_SSE2)
+        using Register = __m128;
+
+        inline static Register Load(float const* p)
+        {
+            return _mm_loadu_ps(p);
+        }
+
+        inline static void Store(Register r, float* p)
+        {
+            _mm_storeu_ps(p, r);
+        }
+
+        inline static Register Zero()
+        {
+            return _mm_setzero_ps();
+        }
+
+        inline static Register Broadcast(float s)
+        {
+            return _mm_set1_ps(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return _mm_add_ps(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return _mm_mul_ps(a, b);
+        }
+#else
+        using Register = float32x4_t;
+
+        inline static Register Load(float const* p)
+        {
+            return vld1q_f32(p);
+        }
+
+        inline static void Store(Register r, float* p)
+        {
+            vst1q_f32(p, r);
+        }
+
+        inline static Register Zero()
+        {
+            return vdupq_n_f32(0.0f);
+        }
+
+        inline static Register Broadcast(float s)
+        {
+            return vdupq_n_f32(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return vaddq_f32(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return vmulq_f32(a, b);
+        }
+#endif
+    };
+
+    template <>
+    struct MatrixSIMDLine<3, float>
+    {
+#if defined(GTE_MATRIX_SIMD_SSE2)
+        using Register = __m128;
+
+        // The register is (p[0],p[1],p[2],p[2]).
+        inline static Register Load(float const* p)
+        {
+            return _mm_loadl_pi(_mm_set1_ps(p[2]), reinterpret_cast<__m64 const*>(p));
+        }
+
+        inline static void Store(Register r, float* p)
+        {
+            _mm_storel_pi(reinterpret_cast<__m64*>(p), r);
+            _mm_store_ss(p + 2, _mm_movehl_ps(r, r));
+        }
+
+        inline static Register Zero()
+        {
+            return _mm_setzero_ps();
+        }
+
+        inline static Register Broadcast(float s)
+        {
+            return _mm_set1_ps(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return _mm_add_ps(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return _mm_mul_ps(a, b);
+        }
+#else
+        using Register = float32x4_t;
+
+        // The register is (p[0],p[1],p[2],p[2]).
+        inline static Register Load(float const* p)
+        {
+            return vcombine_f32(vld1_f32(p), vdup_n_f32(p[2]));
+        }
+
+        inline static void Store(Register r, float* p)
+        {
+            vst1_f32(p, vget_low_f32(r));
+            p[2] = vgetq_lane_f32(r, 2);
+        }
+
+        inline static Register Zero()
+        {
+            return vdupq_n_f32(0.0f);
+        }
+
+        inline static Register Broadcast(float s)
+        {
+            return vdupq_n_f32(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return vaddq_f32(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return vmulq_f32(a, b);
+        }
+#endif
+    };
+
+    // Two doubles in one register. This is the building block of the
+    // lines of doubles and of the quaternion kernels of QuaternionSIMD.h.
+    struct MatrixSIMDDouble2
+    {
+#if defined(GTE_MATRIX_SIMD_SSE2)
+        using Register = __m128d;
+
+        inline static Register Load(double const* p)
+        {
+            return _mm_loadu_pd(p);
+        }
+
+        inline static void Store(Register r, double* p)
+        {
+            _mm_storeu_pd(p, r);
+        }
+
+        inline static Register Zero()
+        {
+            return _mm_setzero_pd();
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return _mm_set1_pd(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return _mm_add_pd(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return _mm_mul_pd(a, b);
+        }
+
+        inline static Register Div(Register a, Register b)
+        {
+            return _mm_div_pd(a, b);
+        }
+
+        // Flip the sign bits of the lanes whose flag is true, which is what
+        // scalar negation does.
+        inline static Register Negate(Register a, bool negate0, bool negate1)
+        {
+            return _mm_xor_pd(a, _mm_setr_pd(negate0 ? -0.0 : 0.0, negate1 ? -0.0 : 0.0));
+        }
+
+        // (a[1],a[0])
+        inline static Register Swap(Register a)
+        {
+            return _mm_shuffle_pd(a, a, 1);
+        }
+#else
+        using Register = float64x2_t;
+
+        inline static Register Load(double const* p)
+        {
+            return vld1q_f64(p);
+        }
+
+        inline static void Store(Register r, double* p)
+        {
+            vst1q_f64(p, r);
+        }
+
+        inline static Register Zero()
+        {
+            return vdupq_n_f64(0.0);
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return vdupq_n_f64(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return vaddq_f64(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return vmulq_f64(a, b);
+        }
+
+        inline static Register Div(Register a, Register b)
+        {
+            return vdivq_f64(a, b);
+        }
+
+        inline static Register Negate(Register a, bool negate0, bool negate1)
+        {
+            uint64_t const mask[2] =
+            {
+                negate0 ? 0x8000000000000000ull : 0ull,
+                negate1 ? 0x8000000000000000ull : 0ull
+            };
+            return vreinterpretq_f64_u64(veorq_u64(vreinterpretq_u64_f64(a), vld1q_u64(mask)));
+        }
+
+        inline static Register Swap(Register a)
+        {
+            return vextq_f64(a, a, 1);
+        }
+#endif
+    };
+
+    template <>
+    struct MatrixSIMDLine<4, double>
+    {
+#if defined(GTE_MATRIX_SIMD_AVX)
+        using Register = __m256d;
+
+        inline static Register Load(double const* p)
+        {
+            return _mm256_loadu_pd(p);
+        }
+
+        inline static void Store(Register r, double* p)
+        {
+            _mm256_storeu_pd(p, r);
+        }
+
+        inline static Register Zero()
+        {
+            return _mm256_setzero_pd();
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return _mm256_set1_pd(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return _mm256_add_pd(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return _mm256_mul_pd(a, b);
+        }
+#else
+        // Elements 0 and 1 are in lo, elements 2 and 3 are in hi.
+        struct Register
+        {
+            MatrixSIMDDouble2::Register lo, hi;
+        };
+
+        using D2 = MatrixSIMDDouble2;
+
+        inline static Register Load(double const* p)
+        {
+            return Register{ D2::Load(p), D2::Load(p + 2) };
+        }
+
+        inline static void Store(Register const& r, double* p)
+        {
+            D2::Store(r.lo, p);
+            D2::Store(r.hi, p + 2);
+        }
+
+        inline static Register Zero()
+        {
+            return Register{ D2::Zero(), D2::Zero() };
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return Register{ D2::Broadcast(s), D2::Broadcast(s) };
+        }
+
+        inline static Register Add(Register const& a, Register const& b)
+        {
+            return Register{ D2::Add(a.lo, b.lo), D2::Add(a.hi, b.hi) };
+        }
+
+        inline static Register Mul(Register const& a, Register const& b)
+        {
+            return Register{ D2::Mul(a.lo, b.lo), D2::Mul(a.hi, b.hi) };
+        }
+#endif
+    };
+
+    template <>
+    struct MatrixSIMDLine<3, double>
+    {
+        // Elements 0 and 1 are in a register, element 2 is a scalar.
+        struct Register
+        {
+            MatrixSIMDDouble2::Register xy;
+            double z;
+        };
+
+        using D2 = MatrixSIMDDouble2;
+
+        inline static Register Load(double const* p)
+        {
+            return Register{ D2::Load(p), p[2] };
+        }
+
+        inline static void Store(Register const& r, double* p)
+        {
+            D2::Store(r.xy, p);
+            p[2] = r.z;
+        }
+
+        inline static Register Zero()
+        {
+            return Register{ D2::Zero(), 0.0 };
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return Register{ D2::Broadcast(s), s };
+        }
+
+        inline static Register Add(Register const& a, Register const& b)
+        {
+            return Register{ D2::Add(a.xy, b.xy), a.z + b.z };
+        }
+
+        inline static Register Mul(Register const& a, Register const& b)
+        {
+            return Register{ D2::Mul(a.xy, b.xy), a.z * b.z };
+        }
+    };
+
+    // The kernels, which are the same for all supported line types.
+    template <int32_t N, typename Real>
+    struct MatrixSIMDKernels
+    {
+        static bool constexpr supported = true;
+
+        using Line = MatrixSIMDLine<N, Real>;
+
+        // result = sum_i weights[i] * (line i of y)
+        inline static void Combine(Real const* y, Real const* weights, Real* result)
+        {
+            typename Line::Register sum = Line::Zero();
+            for (int32_t i = 0; i < N; ++i)
+            {
+                sum = Line::Add(sum, Line::Mul(Line::Broadcast(weights[i]), Line::Load(y + i * N)));
+            }
+            Line::Store(sum, result);
+        }
+
+        // line j of result = sum_i w(j,i) * (line i of y), where w(j,i) is
+        // x[j*N+i], or x[i*N+j] when TransposeX is true. The result must
+        // not overlap the inputs.
+        template <bool TransposeX>
+        inline static void Multiply(Real const* x, Real const* y, Real* result)
+        {
+            typename Line::Register lines[N];
+            for (int32_t i = 0; i < N; ++i)
+            {
+                lines[i] = Line::Load(y + i * N);
+            }
+
+            for (int32_t j = 0; j < N; ++j)
+            {
+                typename Line::Register sum = Line::Zero();
+                for (int32_t i = 0; i < N; ++i)
+                {
+                    Real const weight = (TransposeX ? x[i * N + j] : x[j * N + i]);
+                    sum = Line::Add(sum, Line::Mul(Line::Broadcast(weight), lines[i]));
+                }
+                Line::Store(sum, result + j * N);
+            }
+        }
+    };
+
+    template <>
+    struct MatrixSIMD<3, float> : public MatrixSIMDKernels<3, float>
+    {
+    };
+
+    template <>
+    struct MatrixSIMD<4, float> : public MatrixSIMDKernels<4, float>
+    {
+    };
+
+    template <>
+    struct MatrixSIMD<3, double> : public MatrixSIMDKernels<3, double>
+    {
+    };
+
+    template <>
+    struct MatrixSIMD<4, double> : public MatrixSIMDKernels<4, double>
+    {
+    };
+}
+
+#endif
+
+#endif
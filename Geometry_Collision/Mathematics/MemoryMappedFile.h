@@ -0,0 +1,184 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#if !defined(WIN32_LEAN_AND_MEAN)
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// A file whose contents are accessed through views mapped into memory. The
+// views are mapped and unmapped by the caller, so only the mapped parts of
+// a file larger than memory use address space, and the operating system
+// reads and writes their pages on demand. The offset of a view must be a
+// multiple of GetGranularity(). A new file is created with the requested
+// size and zero contents.
+
+namespace gte
+{
+    class MemoryMappedFile
+    {
+    public:
+        enum class Mode
+        {
+            CREATE,
+            READ_WRITE,
+            READ_ONLY
+        };
+
+        // For CREATE, the file is created, or truncated if it exists, and
+        // has 'size' bytes. For READ_WRITE and READ_ONLY, the file must
+        // exist and 'size' is ignored.
+        MemoryMappedFile(std::string const& filename, Mode mode, uint64_t size = 0)
+            :
+            mMode(mode),
+            mSize(0)
+        {
+#if defined(_WIN32)
+            DWORD const access = (mode == Mode::READ_ONLY ? GENERIC_READ : GENERIC_READ | GENERIC_WRITE);
+            DWORD const disposition = (mode == Mode::CREATE ? CREATE_ALWAYS : OPEN_EXISTING);
+            mFile = CreateFileA(filename.c_str(), access, FILE_SHARE_READ, nullptr,
+                disposition, FILE_ATTRIBUTE_NORMAL, nullptr);
+            LogAssert(mFile != INVALID_HANDLE_VALUE, "Cannot open " + filename + ".");
+
+            if (mode == Mode::CREATE)
+            {
+                LARGE_INTEGER end;
+                end.QuadPart = static_cast<LONGLONG>(size);
+                LogAssert(SetFilePointerEx(mFile, end, nullptr, FILE_BEGIN) && SetEndOfFile(mFile),
+                    "Cannot resize " + filename + ".");
+                mSize = size;
+            }
+            else
+            {
+                LARGE_INTEGER fileSize;
+                LogAssert(GetFileSizeEx(mFile, &fileSize), "Cannot query " + filename + ".");
+                mSize = static_cast<uint64_t>(fileSize.QuadPart);
+            }
+
+            mMapping = nullptr;
+            if (mSize > 0)
+            {
+                DWORD const protect = (mode == Mode::READ_ONLY ? PAGE_READONLY : PAGE_READWRITE);
+                mMapping = CreateFileMappingA(mFile, nullptr, protect, 0, 0, nullptr);
+                LogAssert(mMapping != nullptr, "Cannot map " + filename + ".");
+            }
+#else
+            int const flags = (mode == Mode::CREATE ? O_RDWR | O_CREAT | O_TRUNC :
+                (mode == Mode::READ_WRITE ? O_RDWR : O_RDONLY));
+            mFile = open(filename.c_str(), flags, 0644);
+            LogAssert(mFile >= 0, "Cannot open " + filename + ".");
+
+            if (mode == Mode::CREATE)
+            {
+                LogAssert(ftruncate(mFile, static_cast<off_t>(size)) == 0,
+                    "Cannot resize " + filename + ".");
+                mSize = size;
+            }
+            else
+            {
+                struct stat status;
+                LogAssert(fstat(mFile, &status) == 0, "Cannot query " + filename + ".");
+                mSize = static_cast<uint64_t>(status.st_size);
+            }
+#endif
+        }
+
+        ~MemoryMappedFile()
+        {
+#if defined(_WIN32)
+            if (mMapping != nullptr)
+            {
+                CloseHandle(mMapping);
+            }
+            CloseHandle(mFile);
+#else
+            close(mFile);
+#endif
+        }
+
+        // Disallow copying, because the object owns the file handles.
+        MemoryMappedFile(MemoryMappedFile const&) = delete;
+        MemoryMappedFile& operator=(MemoryMappedFile const&) = delete;
+
+        inline Mode GetMode() const
+        {
+            return mMode;
+        }
+
+        inline uint64_t GetSize() const
+        {
+            return mSize;
+        }
+
+        // The offsets of views must be multiples of the granularity.
+        static size_t GetGranularity()
+        {
+#if defined(_WIN32)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            return static_cast<size_t>(info.dwAllocationGranularity);
+#else
+            return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+        }
+
+        // Map the bytes [offset,offset+size) of the file. The changes of a
+        // writable view are stored in the file.
+        void* Map(uint64_t offset, size_t size)
+        {
+            LogAssert(offset + size <= mSize, "View out of range.");
+#if defined(_WIN32)
+            DWORD const access = (mMode == Mode::READ_ONLY ? FILE_MAP_READ : FILE_MAP_WRITE);
+            void* view = MapViewOfFile(mMapping, access, static_cast<DWORD>(offset >> 32),
+                static_cast<DWORD>(offset & 0xFFFFFFFFull), size);
+            LogAssert(view != nullptr, "Cannot map the view.");
+#else
+            int const protection = (mMode == Mode::READ_ONLY ? PROT_READ : PROT_READ | PROT_WRITE);
+            void* view = mmap(nullptr, size, protection, MAP_SHARED, mFile, static_cast<off_t>(offset));
+            LogAssert(view != MAP_FAILED, "Cannot map the view.");
+#endif
+            return view;
+        }
+
+        void Unmap(void* view, size_t size)
+        {
+#if defined(_WIN32)
+            (void)size;
+            UnmapViewOfFile(view);
+#else
+            munmap(view, size);
+#endif
+        }
+
+    private:
+        Mode mMode;
+        uint64_t mSize;
+#if defined(_WIN32)
+        HANDLE mFile;
+        HANDLE mMapping;
+#else
+        int mFile;
+#endif
+    };
+}
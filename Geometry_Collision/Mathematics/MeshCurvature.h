@@ -9,11 +9,17 @@
 
 #include <Mathematics/Matrix2x2.h>
 #include <Mathematics/Matrix3x3.h>
+#include <Mathematics/MeshVertexAdjacency.h>
 
 // The MeshCurvature class estimates principal curvatures and principal
 // directions at the vertices of a manifold triangle mesh.  The algorithm
 // is described in
 // https://www.geometrictools.com/Documentation/MeshDifferentialGeometry.pdf
+//
+// The per-vertex sums are gathered over the triangles sharing each vertex
+// using a MeshVertexAdjacency, which can be shared with MeshSmoother, and
+// the vertices are processed in chunks, as numThreads tasks of
+// TaskScheduler::GetDefault() when numThreads is 2 or larger.
 
 namespace gte
 {
@@ -21,7 +27,11 @@ namespace gte
     class MeshCurvature
     {
     public:
-        MeshCurvature() = default;
+        MeshCurvature(size_t numThreads = 1)
+            :
+            mNumThreads(numThreads)
+        {
+        }
 
         // The input to operator() is a triangle mesh with the specified
         // vertex buffer and index buffer.  The number of elements of
@@ -38,87 +48,115 @@ namespace gte
             size_t numTriangles, uint32_t const* indices,
             Real singularityThreshold)
         {
+            MeshVertexAdjacency adjacency;
+            adjacency.Create(numVertices, numTriangles, indices);
+            operator()(vertices, adjacency, singularityThreshold);
+        }
+
+        // The input is a triangle mesh whose adjacency was created by the
+        // caller.
+        void operator()(Vector3<Real> const* vertices,
+            MeshVertexAdjacency const& adjacency, Real singularityThreshold)
+        {
+            size_t const numVertices = adjacency.GetNumVertices();
             mNormals.resize(numVertices);
             mMinCurvatures.resize(numVertices);
             mMaxCurvatures.resize(numVertices);
             mMinDirections.resize(numVertices);
             mMaxDirections.resize(numVertices);
 
+            auto const& offsets = adjacency.GetOffsets();
+            auto const& corners = adjacency.GetCorners();
+
             // Compute the normal vectors for the vertices as an
             // area-weighted sum of the triangles sharing a vertex.
-            Vector3<Real> vzero{ (Real)0, (Real)0, (Real)0 };
-            std::fill(mNormals.begin(), mNormals.end(), vzero);
-            uint32_t const* currentIndex = indices;
-            for (size_t i = 0; i < numTriangles; ++i)
+            adjacency.ForEachChunk(mNumThreads, [&](size_t vmin, size_t vmax)
             {
-                // Get vertex indices.
-                uint32_t v0 = *currentIndex++;
-                uint32_t v1 = *currentIndex++;
-                uint32_t v2 = *currentIndex++;
-
-                // Compute the normal (length provides a weighted sum).
-                Vector3<Real> edge1 = vertices[v1] - vertices[v0];
-                Vector3<Real> edge2 = vertices[v2] - vertices[v0];
-                Vector3<Real> normal = Cross(edge1, edge2);
+                for (size_t i = vmin; i < vmax; ++i)
+                {
+                    // Compute the normal (length provides a weighted sum).
+                    Vector3<Real> normal{ (Real)0, (Real)0, (Real)0 };
+                    for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                    {
+                        Vector3<Real> edge1 = vertices[corners[k][0]] - vertices[i];
+                        Vector3<Real> edge2 = vertices[corners[k][1]] - vertices[i];
+                        normal += Cross(edge1, edge2);
+                    }
+                    Normalize(normal);
+                    mNormals[i] = normal;
+                }
+            });
 
-                mNormals[v0] += normal;
-                mNormals[v1] += normal;
-                mNormals[v2] += normal;
-            }
-            for (size_t i = 0; i < numVertices; ++i)
+            adjacency.ForEachChunk(mNumThreads, [&](size_t vmin, size_t vmax)
             {
-                Normalize(mNormals[i]);
-            }
+                for (size_t i = vmin; i < vmax; ++i)
+                {
+                    ComputeCurvatures(i, vertices, &corners[offsets[i]],
+                        adjacency.GetNumCorners(i), singularityThreshold);
+                }
+            });
+        }
 
-            // Compute the matrix of normal derivatives.
-            Matrix3x3<Real> mzero;
-            std::vector<Matrix3x3<Real>> DNormal(numVertices, mzero);
-            std::vector<Matrix3x3<Real>> WWTrn(numVertices, mzero);
-            std::vector<Matrix3x3<Real>> DWTrn(numVertices, mzero);
-            std::vector<bool> DWTrnZero(numVertices, false);
+        void operator()(
+            std::vector<Vector3<Real>> const& vertices,
+            std::vector<uint32_t> const& indices,
+            Real singularityThreshold)
+        {
+            operator()(vertices.size(), vertices.data(), indices.size() / 3,
+                indices.data(), singularityThreshold);
+        }
 
-            currentIndex = indices;
-            for (size_t i = 0; i < numTriangles; ++i)
-            {
-                // Get vertex indices.
-                uint32_t v[3];
-                v[0] = *currentIndex++;
-                v[1] = *currentIndex++;
-                v[2] = *currentIndex++;
+        inline std::vector<Vector3<Real>> const& GetNormals() const
+        {
+            return mNormals;
+        }
 
-                for (size_t j = 0; j < 3; j++)
-                {
-                    uint32_t v0 = v[j];
-                    uint32_t v1 = v[(j + 1) % 3];
-                    uint32_t v2 = v[(j + 2) % 3];
+        inline std::vector<Real> const& GetMinCurvatures() const
+        {
+            return mMinCurvatures;
+        }
 
-                    // Compute the edge direction from vertex v0 to vertex v1,
-                    // project it to the tangent plane of vertex v0 and
-                    // compute the difference of adjacent normals.
-                    Vector3<Real> E = vertices[v1] - vertices[v0];
-                    Vector3<Real> W = E - Dot(E, mNormals[v0]) * mNormals[v0];
-                    Vector3<Real> D = mNormals[v1] - mNormals[v0];
-                    for (int32_t row = 0; row < 3; ++row)
-                    {
-                        for (int32_t col = 0; col < 3; ++col)
-                        {
-                            WWTrn[v0](row, col) += W[row] * W[col];
-                            DWTrn[v0](row, col) += D[row] * W[col];
-                        }
-                    }
+        inline std::vector<Real> const& GetMaxCurvatures() const
+        {
+            return mMaxCurvatures;
+        }
 
-                    // Compute the edge direction from vertex v0 to vertex v2,
-                    // project it to the tangent plane of vertex v0 and
-                    // compute the difference of adjacent normals.
-                    E = vertices[v2] - vertices[v0];
-                    W = E - Dot(E, mNormals[v0]) * mNormals[v0];
-                    D = mNormals[v2] - mNormals[v0];
+        inline std::vector<Vector3<Real>> const& GetMinDirections() const
+        {
+            return mMinDirections;
+        }
+
+        inline std::vector<Vector3<Real>> const& GetMaxDirections() const
+        {
+            return mMaxDirections;
+        }
+
+    private:
+        void ComputeCurvatures(size_t i, Vector3<Real> const* vertices,
+            std::array<uint32_t, 2> const* corners, size_t numCorners,
+            Real singularityThreshold)
+        {
+            // Compute the matrix of normal derivatives.
+            Vector3<Real> const& N = mNormals[i];
+            Matrix3x3<Real> WWTrn, DWTrn;
+            for (size_t k = 0; k < numCorners; ++k)
+            {
+                for (size_t j = 0; j < 2; ++j)
+                {
+                    // Compute the edge direction from vertex i to the
+                    // adjacent vertex, project it to the tangent plane of
+                    // vertex i and compute the difference of adjacent
+                    // normals.
+                    uint32_t const v = corners[k][j];
+                    Vector3<Real> E = vertices[v] - vertices[i];
+                    Vector3<Real> W = E - Dot(E, N) * N;
+                    Vector3<Real> D = mNormals[v] - N;
                     for (int32_t row = 0; row < 3; ++row)
                     {
                         for (int32_t col = 0; col < 3; ++col)
                         {
-                            WWTrn[v0](row, col) += W[row] * W[col];
-                            DWTrn[v0](row, col) += D[row] * W[col];
+                            WWTrn(row, col) += W[row] * W[col];
+                            DWTrn(row, col) += D[row] * W[col];
                         }
                     }
                 }
@@ -127,39 +165,32 @@ namespace gte
             // Add in N*N^T to W*W^T for numerical stability.  In theory 0*0^T
             // is added to D*W^T, but of course no update is needed in the
             // implementation.  Compute the matrix of normal derivatives.
-            for (size_t i = 0; i < numVertices; ++i)
+            for (int32_t row = 0; row < 3; ++row)
             {
-                for (int32_t row = 0; row < 3; ++row)
+                for (int32_t col = 0; col < 3; ++col)
                 {
-                    for (int32_t col = 0; col < 3; ++col)
-                    {
-                        WWTrn[i](row, col) = (Real)0.5 * WWTrn[i](row, col) +
-                            mNormals[i][row] * mNormals[i][col];
-                        DWTrn[i](row, col) *= (Real)0.5;
-                    }
+                    WWTrn(row, col) = (Real)0.5 * WWTrn(row, col) + N[row] * N[col];
+                    DWTrn(row, col) *= (Real)0.5;
                 }
+            }
 
-                // Compute the max-abs entry of D*W^T.  If this entry is
-                // (nearly) zero, flag the DNormal matrix as singular.
-                Real maxAbs = (Real)0;
-                for (int32_t row = 0; row < 3; ++row)
+            // Compute the max-abs entry of D*W^T.  If this entry is
+            // (nearly) zero, flag the DNormal matrix as singular.
+            Real maxAbs = (Real)0;
+            for (int32_t row = 0; row < 3; ++row)
+            {
+                for (int32_t col = 0; col < 3; ++col)
                 {
-                    for (int32_t col = 0; col < 3; ++col)
+                    Real absEntry = std::fabs(DWTrn(row, col));
+                    if (absEntry > maxAbs)
                     {
-                        Real absEntry = std::fabs(DWTrn[i](row, col));
-                        if (absEntry > maxAbs)
-                        {
-                            maxAbs = absEntry;
-                        }
+                        maxAbs = absEntry;
                     }
                 }
-                if (maxAbs < singularityThreshold)
-                {
-                    DWTrnZero[i] = true;
-                }
-
-                DNormal[i] = DWTrn[i] * Inverse(WWTrn[i]);
             }
+            bool DWTrnZero = (maxAbs < singularityThreshold);
+
+            Matrix3x3<Real> DNormal = DWTrn * Inverse(WWTrn);
 
             // If N is a unit-length normal at a vertex, let U and V be
             // unit-length tangents so that {U, V, N} is an orthonormal set.
@@ -175,107 +206,71 @@ namespace gte
             // 2-by-1 eigenvector corresponding to it, then S*W = k*W (by
             // definition).  The corresponding 3-by-1 tangent vector at the
             // vertex is a principal direction for k and is J*W.
-            for (size_t i = 0; i < numVertices; ++i)
-            {
-                // Compute U and V given N.
-                Vector3<Real> basis[3];
-                basis[0] = mNormals[i];
-                ComputeOrthogonalComplement(1, basis);
-                Vector3<Real> const& U = basis[1];
-                Vector3<Real> const& V = basis[2];
-
-                if (DWTrnZero[i])
-                {
-                    // At a locally planar point.
-                    mMinCurvatures[i] = (Real)0;
-                    mMaxCurvatures[i] = (Real)0;
-                    mMinDirections[i] = U;
-                    mMaxDirections[i] = V;
-                    continue;
-                }
 
-                // Compute S = J^T * dN/dX * J.  In theory S is symmetric, but
-                // because dN/dX is estimated, we must ensure that the
-                // computed S is symmetric.
-                Real s00 = Dot(U, DNormal[i] * U);
-                Real s01 = Dot(U, DNormal[i] * V);
-                Real s10 = Dot(V, DNormal[i] * U);
-                Real s11 = Dot(V, DNormal[i] * V);
-                Real avr = (Real)0.5 * (s01 + s10);
-                Matrix2x2<Real> S{ s00, avr, avr, s11 };
+            // Compute U and V given N.
+            Vector3<Real> basis[3];
+            basis[0] = N;
+            ComputeOrthogonalComplement(1, basis);
+            Vector3<Real> const& U = basis[1];
+            Vector3<Real> const& V = basis[2];
 
-                // Compute the eigenvalues of S (min and max curvatures).
-                Real trace = S(0, 0) + S(1, 1);
-                Real det = S(0, 0) * S(1, 1) - S(0, 1) * S(1, 0);
-                Real discr = trace * trace - (Real)4.0 * det;
-                Real rootDiscr = std::sqrt(std::max(discr, (Real)0));
-                mMinCurvatures[i] = (Real)0.5* (trace - rootDiscr);
-                mMaxCurvatures[i] = (Real)0.5* (trace + rootDiscr);
-
-                // Compute the eigenvectors of S.
-                Vector2<Real> W0{ S(0, 1), mMinCurvatures[i] - S(0, 0) };
-                Vector2<Real> W1{ mMinCurvatures[i] - S(1, 1), S(1, 0) };
-                if (Dot(W0, W0) >= Dot(W1, W1))
-                {
-                    Normalize(W0);
-                    mMinDirections[i] = W0[0] * U + W0[1] * V;
-                }
-                else
-                {
-                    Normalize(W1);
-                    mMinDirections[i] = W1[0] * U + W1[1] * V;
-                }
-
-                W0 = Vector2<Real>{ S(0, 1), mMaxCurvatures[i] - S(0, 0) };
-                W1 = Vector2<Real>{ mMaxCurvatures[i] - S(1, 1), S(1, 0) };
-                if (Dot(W0, W0) >= Dot(W1, W1))
-                {
-                    Normalize(W0);
-                    mMaxDirections[i] = W0[0] * U + W0[1] * V;
-                }
-                else
-                {
-                    Normalize(W1);
-                    mMaxDirections[i] = W1[0] * U + W1[1] * V;
-                }
+            if (DWTrnZero)
+            {
+                // At a locally planar point.
+                mMinCurvatures[i] = (Real)0;
+                mMaxCurvatures[i] = (Real)0;
+                mMinDirections[i] = U;
+                mMaxDirections[i] = V;
+                return;
             }
-        }
-
-        void operator()(
-            std::vector<Vector3<Real>> const& vertices,
-            std::vector<uint32_t> const& indices,
-            Real singularityThreshold)
-        {
-            operator()(vertices.size(), vertices.data(), indices.size() / 3,
-                indices.data(), singularityThreshold);
-        }
-
-        inline std::vector<Vector3<Real>> const& GetNormals() const
-        {
-            return mNormals;
-        }
 
-        inline std::vector<Real> const& GetMinCurvatures() const
-        {
-            return mMinCurvatures;
-        }
+            // Compute S = J^T * dN/dX * J.  In theory S is symmetric, but
+            // because dN/dX is estimated, we must ensure that the
+            // computed S is symmetric.
+            Real s00 = Dot(U, DNormal * U);
+            Real s01 = Dot(U, DNormal * V);
+            Real s10 = Dot(V, DNormal * U);
+            Real s11 = Dot(V, DNormal * V);
+            Real avr = (Real)0.5 * (s01 + s10);
+            Matrix2x2<Real> S{ s00, avr, avr, s11 };
 
-        inline std::vector<Real> const& GetMaxCurvatures() const
-        {
-            return mMaxCurvatures;
-        }
+            // Compute the eigenvalues of S (min and max curvatures).
+            Real trace = S(0, 0) + S(1, 1);
+            Real det = S(0, 0) * S(1, 1) - S(0, 1) * S(1, 0);
+            Real discr = trace * trace - (Real)4.0 * det;
+            Real rootDiscr = std::sqrt(std::max(discr, (Real)0));
+            mMinCurvatures[i] = (Real)0.5* (trace - rootDiscr);
+            mMaxCurvatures[i] = (Real)0.5* (trace + rootDiscr);
 
-        inline std::vector<Vector3<Real>> const& GetMinDirections() const
-        {
-            return mMinDirections;
-        }
+            // Compute the eigenvectors of S.
+            Vector2<Real> W0{ S(0, 1), mMinCurvatures[i] - S(0, 0) };
+            Vector2<Real> W1{ mMinCurvatures[i] - S(1, 1), S(1, 0) };
+            if (Dot(W0, W0) >= Dot(W1, W1))
+            {
+                Normalize(W0);
+                mMinDirections[i] = W0[0] * U + W0[1] * V;
+            }
+            else
+            {
+                Normalize(W1);
+                mMinDirections[i] = W1[0] * U + W1[1] * V;
+            }
 
-        inline std::vector<Vector3<Real>> const& GetMaxDirections() const
-        {
-            return mMaxDirections;
+            W0 = Vector2<Real>{ S(0, 1), mMaxCurvatures[i] - S(0, 0) };
+            W1 = Vector2<Real>{ mMaxCurvatures[i] - S(1, 1), S(1, 0) };
+            if (Dot(W0, W0) >= Dot(W1, W1))
+            {
+                Normalize(W0);
+                mMaxDirections[i] = W0[0] * U + W0[1] * V;
+            }
+            else
+            {
+                Normalize(W1);
+                mMaxDirections[i] = W1[0] * U + W1[1] * V;
+            }
         }
 
-    private:
+        size_t mNumThreads;
         std::vector<Vector3<Real>> mNormals;
         std::vector<Real> mMinCurvatures;
         std::vector<Real> mMaxCurvatures;
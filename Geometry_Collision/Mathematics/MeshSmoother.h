@@ -8,16 +8,26 @@
 #pragma once
 
 #include <Mathematics/Logger.h>
+#include <Mathematics/MeshVertexAdjacency.h>
 #include <Mathematics/Vector3.h>
 #include <vector>
 
+// The smoother computes the vertex normals and the means of the vertex
+// neighbors by gathering over the triangles sharing each vertex, using a
+// MeshVertexAdjacency that is created once per mesh, or shared with other
+// algorithms such as MeshCurvature. The vertices are processed in chunks,
+// as numThreads tasks of TaskScheduler::GetDefault() when numThreads is 2
+// or larger, in which case the overrides of VertexInfluenced,
+// GetTangentWeight and GetNormalWeight are called concurrently for
+// different vertices.
+
 namespace gte
 {
     template <typename T>
     class MeshSmoother
     {
     public:
-        MeshSmoother()
+        MeshSmoother(size_t numThreads = 1)
             :
             mNumVertices(0),
             mVertices(nullptr),
@@ -25,7 +35,10 @@ namespace gte
             mIndices(nullptr),
             mNormals{},
             mMeans{},
-            mNeighborCounts{}
+            mNeighborCounts{},
+            mNumThreads(numThreads),
+            mAdjacency(nullptr),
+            mOwnAdjacency{}
         {
         }
 
@@ -45,33 +58,44 @@ namespace gte
                 numTriangles >= 1 && indices != nullptr,
                 "Invalid input.");
 
-            mNumVertices = numVertices;
-            mVertices = vertices;
-            mNumTriangles = numTriangles;
+            mOwnAdjacency.Create(numVertices, numTriangles, indices);
+            operator()(vertices, mOwnAdjacency);
             mIndices = indices;
+        }
+
+        void operator()(std::vector<Vector3<T>>& vertices,
+            std::vector<int32_t> const& indices)
+        {
+            operator()(vertices.size(), vertices.data(),
+                indices.size() / 3, indices.data());
+        }
+
+        // The input is a triangle mesh whose adjacency was created by the
+        // caller, which must keep it alive while the smoother is used.
+        void operator()(Vector3<T>* vertices, MeshVertexAdjacency const& adjacency)
+        {
+            LogAssert(
+                adjacency.GetNumVertices() >= 3 && vertices != nullptr &&
+                adjacency.GetNumTriangles() >= 1,
+                "Invalid input.");
+
+            mNumVertices = adjacency.GetNumVertices();
+            mVertices = vertices;
+            mNumTriangles = adjacency.GetNumTriangles();
+            mIndices = nullptr;
+            mAdjacency = &adjacency;
 
             mNormals.resize(mNumVertices);
             mMeans.resize(mNumVertices);
             mNeighborCounts.resize(mNumVertices);
 
             // Count the number of vertex neighbors.
-            std::fill(mNeighborCounts.begin(), mNeighborCounts.end(), 0);
-            int32_t const* current = mIndices;
-            for (size_t i = 0; i < mNumTriangles; ++i)
+            for (size_t i = 0; i < mNumVertices; ++i)
             {
-                mNeighborCounts[*current++] += 2;
-                mNeighborCounts[*current++] += 2;
-                mNeighborCounts[*current++] += 2;
+                mNeighborCounts[i] = 2 * adjacency.GetNumCorners(i);
             }
         }
 
-        void operator()(std::vector<Vector3<T>>& vertices,
-            std::vector<int32_t> const& indices)
-        {
-            operator()(vertices.size(), vertices.data(),
-                indices.size() / 3, indices.data());
-        }
-
         inline size_t GetNumVertices() const
         {
             return mNumVertices;
@@ -87,6 +111,7 @@ namespace gte
             return mNumTriangles;
         }
 
+        // The index buffer is null when the smoother was given an adjacency.
         inline int32_t const* GetIndices() const
         {
             return mIndices;
@@ -107,57 +132,58 @@ namespace gte
             return mNeighborCounts;
         }
 
+        inline MeshVertexAdjacency const* GetAdjacency() const
+        {
+            return mAdjacency;
+        }
+
         // Apply one iteration of the smoother. The input time is supported
         // for applications where the surface evolution is time-dependent.
         void Update(T t = static_cast<T>(0))
         {
-            std::fill(mNormals.begin(), mNormals.end(), Vector3<T>::Zero());
-            std::fill(mMeans.begin(), mMeans.end(), Vector3<T>::Zero());
-
-            int32_t const* current = mIndices;
-            for (size_t i = 0; i < mNumTriangles; ++i)
-            {
-                int32_t v0 = *current++;
-                int32_t v1 = *current++;
-                int32_t v2 = *current++;
-
-                Vector3<T>& V0 = mVertices[v0];
-                Vector3<T>& V1 = mVertices[v1];
-                Vector3<T>& V2 = mVertices[v2];
-
-                Vector3<T> edge1 = V1 - V0;
-                Vector3<T> edge2 = V2 - V0;
-                Vector3<T> normal = Cross(edge1, edge2);
+            auto const& offsets = mAdjacency->GetOffsets();
+            auto const& corners = mAdjacency->GetCorners();
 
-                mNormals[v0] += normal;
-                mNormals[v1] += normal;
-                mNormals[v2] += normal;
-
-                mMeans[v0] += V1 + V2;
-                mMeans[v1] += V2 + V0;
-                mMeans[v2] += V0 + V1;
-            }
-
-            for (size_t i = 0; i < mNumVertices; ++i)
+            // The normal of a vertex is the sum of the normals of the
+            // triangles sharing it, and its mean is that of the other
+            // vertices of those triangles.
+            mAdjacency->ForEachChunk(mNumThreads, [this, &offsets, &corners](size_t vmin, size_t vmax)
             {
-                Normalize(mNormals[i]);
-                mMeans[i] /= static_cast<T>(mNeighborCounts[i]);
-            }
+                for (size_t i = vmin; i < vmax; ++i)
+                {
+                    Vector3<T> const V0 = mVertices[i];
+                    Vector3<T> normal = Vector3<T>::Zero();
+                    Vector3<T> mean = Vector3<T>::Zero();
+                    for (size_t k = offsets[i]; k < offsets[i + 1]; ++k)
+                    {
+                        Vector3<T> const& V1 = mVertices[corners[k][0]];
+                        Vector3<T> const& V2 = mVertices[corners[k][1]];
+                        normal += Cross(V1 - V0, V2 - V0);
+                        mean += V1 + V2;
+                    }
+                    Normalize(normal);
+                    mNormals[i] = normal;
+                    mMeans[i] = mean / static_cast<T>(mNeighborCounts[i]);
+                }
+            });
 
-            for (size_t i = 0; i < mNumVertices; ++i)
+            mAdjacency->ForEachChunk(mNumThreads, [this, t](size_t vmin, size_t vmax)
             {
-                if (VertexInfluenced(i, t))
+                for (size_t i = vmin; i < vmax; ++i)
                 {
-                    Vector3<T> diff = mMeans[i] - mVertices[i];
-                    T dotDifNor = Dot(diff, mNormals[i]);
-                    Vector3<T> surfaceNormal = dotDifNor * mNormals[i];
-                    Vector3<T> tangent = diff - surfaceNormal;
-
-                    T tanWeight = GetTangentWeight(i, t);
-                    T norWeight = GetNormalWeight(i, t);
-                    mVertices[i] += tanWeight * tangent + norWeight * mNormals[i];
+                    if (VertexInfluenced(i, t))
+                    {
+                        Vector3<T> diff = mMeans[i] - mVertices[i];
+                        T dotDifNor = Dot(diff, mNormals[i]);
+                        Vector3<T> surfaceNormal = dotDifNor * mNormals[i];
+                        Vector3<T> tangent = diff - surfaceNormal;
+
+                        T tanWeight = GetTangentWeight(i, t);
+                        T norWeight = GetNormalWeight(i, t);
+                        mVertices[i] += tanWeight * tangent + norWeight * mNormals[i];
+                    }
                 }
-            }
+            });
         }
 
     protected:
@@ -186,5 +212,9 @@ namespace gte
         std::vector<Vector3<T>> mNormals;
         std::vector<Vector3<T>> mMeans;
         std::vector<size_t> mNeighborCounts;
+
+        size_t mNumThreads;
+        MeshVertexAdjacency const* mAdjacency;
+        MeshVertexAdjacency mOwnAdjacency;
     };
 }
@@ -0,0 +1,149 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// The triangles sharing each vertex of a triangle mesh in compressed sparse
+// row (CSR) form. The corners of vertex v are
+//   corners[offsets[v]] through corners[offsets[v + 1] - 1]
+// in the order of the triangles. Corner {v1, v2} is a triangle <v, v1, v2>
+// rotated so that v is first, which keeps the orientation of the triangle.
+// The adjacency is built once for a mesh and shared by MeshSmoother and
+// MeshCurvature, which then compute their per-vertex sums by gathering over
+// the corners of each vertex. Each vertex is written by one thread only, so
+// the vertices are processed in parallel chunks without atomics, and the
+// results do not depend on the number of threads.
+
+namespace gte
+{
+    class MeshVertexAdjacency
+    {
+    public:
+        MeshVertexAdjacency()
+            :
+            mNumVertices(0),
+            mNumTriangles(0),
+            mOffsets{},
+            mCorners{}
+        {
+        }
+
+        // The IndexType is int32_t or uint32_t. The number of elements of
+        // 'indices' is 3 * numTriangles, each triple (3*t, 3*t+1, 3*t+2)
+        // representing a triangle.
+        template <typename IndexType>
+        void Create(size_t numVertices, size_t numTriangles, IndexType const* indices)
+        {
+            LogAssert(
+                numVertices > 0 && numTriangles > 0 && indices != nullptr,
+                "Invalid input.");
+
+            mNumVertices = numVertices;
+            mNumTriangles = numTriangles;
+            mOffsets.assign(numVertices + 1, 0);
+            mCorners.resize(3 * numTriangles);
+
+            // Count the corners of each vertex and convert the counts to
+            // offsets by a prefix sum.
+            size_t const numIndices = 3 * numTriangles;
+            for (size_t i = 0; i < numIndices; ++i)
+            {
+                size_t const v = static_cast<size_t>(indices[i]);
+                LogAssert(v < numVertices, "Invalid index.");
+                ++mOffsets[v + 1];
+            }
+            for (size_t v = 0; v < numVertices; ++v)
+            {
+                mOffsets[v + 1] += mOffsets[v];
+            }
+
+            // Store the corners in the order of the triangles.
+            std::vector<size_t> next(mOffsets.begin(), mOffsets.end() - 1);
+            for (size_t t = 0; t < numTriangles; ++t)
+            {
+                IndexType const* triangle = &indices[3 * t];
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    mCorners[next[static_cast<size_t>(triangle[j])]++] =
+                    {
+                        static_cast<uint32_t>(triangle[(j + 1) % 3]),
+                        static_cast<uint32_t>(triangle[(j + 2) % 3])
+                    };
+                }
+            }
+        }
+
+        inline size_t GetNumVertices() const
+        {
+            return mNumVertices;
+        }
+
+        inline size_t GetNumTriangles() const
+        {
+            return mNumTriangles;
+        }
+
+        inline std::vector<size_t> const& GetOffsets() const
+        {
+            return mOffsets;
+        }
+
+        inline std::vector<std::array<uint32_t, 2>> const& GetCorners() const
+        {
+            return mCorners;
+        }
+
+        // The number of triangles sharing vertex v.
+        inline size_t GetNumCorners(size_t v) const
+        {
+            return mOffsets[v + 1] - mOffsets[v];
+        }
+
+        // Call function(vmin, vmax) for contiguous chunks of the vertices
+        // [0,numVertices). Set numThreads to 2 or larger to process the
+        // chunks as tasks of TaskScheduler::GetDefault().
+        template <typename Function>
+        void ForEachChunk(size_t numThreads, Function const& function) const
+        {
+            size_t const numTasks = std::max(std::min(numThreads,
+                mNumVertices / minPerTask), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                if (mNumVertices > 0)
+                {
+                    function(0, mNumVertices);
+                }
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [this, numTasks, &function](size_t k)
+                {
+                    function(k * mNumVertices / numTasks,
+                        (k + 1) * mNumVertices / numTasks);
+                });
+        }
+
+    private:
+        // A task is created only for this many vertices or more, because
+        // the work per vertex is small compared to scheduling a task.
+        static size_t constexpr minPerTask = 4096;
+
+        size_t mNumVertices;
+        size_t mNumTriangles;
+        std::vector<size_t> mOffsets;
+        std::vector<std::array<uint32_t, 2>> mCorners;
+    };
+}
@@ -7,6 +7,8 @@
 
 #pragma once
 
+#include <Mathematics/Logger.h>
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
@@ -29,6 +31,14 @@
 // update their weights, and re-insert them.  The min-heap implementation here
 // does support the update without removal and reinsertion.
 //
+// The Arity is the number of children of a node, 2 for a binary tree.  A
+// 4-ary or 8-ary tree has half or a third of the levels of a binary tree,
+// so an insertion or an update toward the root moves fewer records, and the
+// children compared by a removal are adjacent in memory.  For heaps with
+// millions of elements, such as those of mesh decimation, this reduces the
+// cache misses of the sift operations.  The elements may also be inserted
+// or updated in bulk, in which case the heap is rebuilt in linear time.
+//
 // The ValueType represents the weight and it must support comparisons
 // "<" and "<=".  Additional information can be stored in the min-heap for
 // convenient access; this is stored as the KeyType.  In the (open) polyline
@@ -73,10 +83,12 @@
 
 namespace gte
 {
-    template <typename KeyType, typename ValueType>
+    template <typename KeyType, typename ValueType, int32_t Arity = 2>
     class MinHeap
     {
     public:
+        static_assert(Arity >= 2, "The heap must have at least 2 children per node.");
+
         struct Record
         {
             Record()
@@ -115,6 +127,7 @@ namespace gte
             {
                 mPointers[record.index] = &record;
             }
+            mValues = minHeap.mValues;
             return *this;
         }
 
@@ -128,6 +141,7 @@ namespace gte
             {
                 mRecords.resize(maxElements);
                 mPointers.resize(maxElements);
+                mValues.resize(maxElements);
                 for (int32_t i = 0; i < maxElements; ++i)
                 {
                     mPointers[i] = &mRecords[i];
@@ -138,6 +152,7 @@ namespace gte
             {
                 mRecords.clear();
                 mPointers.clear();
+                mValues.clear();
             }
         }
 
@@ -183,40 +198,53 @@ namespace gte
             }
 
             // Store the input information in the last heap record, which is
-            // the last leaf in the tree.
+            // the last leaf in the tree, and propagate it toward the root of
+            // the tree until it reaches its correct position.
             int32_t child = mNumElements++;
             Record* record = mPointers[child];
             record->key = key;
             record->value = value;
+            SiftUp(child, record);
+            return record;
+        }
 
-            // Propagate the information toward the root of the tree until it
-            // reaches its correct position, thus restoring the tree to a
-            // valid heap.
-            while (child > 0)
+        // Insert the pairs (keys[i],values[i]) and store the pointers to
+        // their records in records[i].  When more pairs are inserted than
+        // the min-heap has room for, the pointers of the pairs that are not
+        // inserted are null.  When the pairs are at least as many as the
+        // elements already in the min-heap, the min-heap is rebuilt bottom
+        // up in time linear in the number of elements, which is faster than
+        // inserting the pairs one at a time.
+        void Insert(std::vector<KeyType> const& keys, std::vector<ValueType> const& values,
+            std::vector<Record*>& records)
+        {
+            LogAssert(keys.size() == values.size(), "Mismatched sizes.");
+            size_t const numAvailable = mRecords.size() - static_cast<size_t>(mNumElements);
+            size_t const numInserted = std::min(keys.size(), numAvailable);
+            records.assign(keys.size(), nullptr);
+
+            bool const rebuild = (numInserted >= static_cast<size_t>(mNumElements));
+            for (size_t i = 0; i < numInserted; ++i)
             {
-                int32_t parent = (child - 1) / 2;
-                if (mPointers[parent]->value <= value)
+                int32_t child = mNumElements++;
+                Record* record = mPointers[child];
+                record->key = keys[i];
+                record->value = values[i];
+                records[i] = record;
+                if (rebuild)
                 {
-                    // The parent has a value smaller than or equal to the
-                    // child's value, so we now have a valid heap.
-                    break;
+                    mValues[child] = record->value;
+                }
+                else
+                {
+                    SiftUp(child, record);
                 }
-
-                // The parent has a larger value than the child's value.  Swap
-                // the parent and child:
-
-                // Move the parent into the child's slot.
-                mPointers[child] = mPointers[parent];
-                mPointers[child]->index = child;
-
-                // Move the child into the parent's slot.
-                mPointers[parent] = record;
-                mPointers[parent]->index = parent;
-
-                child = parent;
             }
 
-            return mPointers[child];
+            if (rebuild)
+            {
+                Rebuild();
+            }
         }
 
         // Remove the root of the heap and return its 'key' and 'value
@@ -236,49 +264,20 @@ namespace gte
             key = root->key;
             value = root->value;
 
-            // Restore the tree to a heap.  Abstractly, record is the new root
-            // of the heap.  It is moved down the tree via parent-child swaps
-            // until it is in a location that restores the tree to a heap.
+            // Restore the tree to a heap.  Abstractly, the last record is
+            // the new root of the heap.  It is moved down the tree until it
+            // is in a location that restores the tree to a heap.
             int32_t last = --mNumElements;
-            Record* record = mPointers[last];
-            int32_t parent = 0, child = 1;
-            while (child <= last)
+            if (last > 0)
             {
-                if (child < last)
-                {
-                    // Select the child with smallest value to be the one that
-                    // is swapped with the parent, if necessary.
-                    int32_t childP1 = child + 1;
-                    if (mPointers[childP1]->value < mPointers[child]->value)
-                    {
-                        child = childP1;
-                    }
-                }
-
-                if (record->value <= mPointers[child]->value)
-                {
-                    // The tree is now a heap.
-                    break;
-                }
-
-                // Move the child into the parent's slot.
-                mPointers[parent] = mPointers[child];
-                mPointers[parent]->index = parent;
-
-                parent = child;
-                child = 2 * child + 1;
+                SiftDown(0, mPointers[last]);
             }
 
-            // The previous 'last' record was moved to the root and propagated
-            // down the tree to its final resting place, restoring the tree to
-            // a heap.  The slot mPointers[parent] is that resting place.
-            mPointers[parent] = record;
-            mPointers[parent]->index = parent;
-
             // The old root record must not be lost.  Attach it to the slot
             // that contained the old last record.
             mPointers[last] = root;
             mPointers[last]->index = last;
+            mValues[last] = root->value;
             return true;
         }
 
@@ -295,94 +294,49 @@ namespace gte
                 return;
             }
 
-            int32_t parent, child, childP1, maxChild;
-
             if (record->value < value)
             {
-                record->value = value;
-
                 // The new value is larger than the old value.  Propagate it
                 // toward the leaves.
-                parent = record->index;
-                child = 2 * parent + 1;
-                while (child < mNumElements)
-                {
-                    // At least one child exists.  Locate the one of maximum
-                    // value.
-                    childP1 = child + 1;
-                    if (childP1 < mNumElements)
-                    {
-                        // Two children exist.
-                        if (mPointers[child]->value <= mPointers[childP1]->value)
-                        {
-                            maxChild = child;
-                        }
-                        else
-                        {
-                            maxChild = childP1;
-                        }
-                    }
-                    else
-                    {
-                        // One child exists.
-                        maxChild = child;
-                    }
-
-                    if (value <= mPointers[maxChild]->value)
-                    {
-                        // The new value is in the correct place to restore
-                        // the tree to a heap.
-                        break;
-                    }
-
-                    // The child has a larger value than the parent's value.
-                    // Swap the parent and child:
-
-                    // Move the child into the parent's slot.
-                    mPointers[parent] = mPointers[maxChild];
-                    mPointers[parent]->index = parent;
-
-                    // Move the parent into the child's slot.
-                    mPointers[maxChild] = record;
-                    mPointers[maxChild]->index = maxChild;
-
-                    parent = maxChild;
-                    child = 2 * parent + 1;
-                }
+                record->value = value;
+                SiftDown(record->index, record);
             }
             else if (value < record->value)
             {
+                // The new value is smaller than the old value.  Propagate it
+                // toward the root.
                 record->value = value;
+                SiftUp(record->index, record);
+            }
+        }
 
-                // The new weight is smaller than the old weight.  Propagate
-                // it toward the root.
-                child = record->index;
-                while (child > 0)
+        // Update the records[i] to the values[i].  The null records are
+        // ignored.  When the records are at least a quarter of the elements
+        // in the min-heap, the values are assigned and the min-heap is
+        // rebuilt bottom up in time linear in the number of elements, which
+        // is faster than updating the records one at a time.
+        void Update(std::vector<Record*> const& records, std::vector<ValueType> const& values)
+        {
+            LogAssert(records.size() == values.size(), "Mismatched sizes.");
+            if (4 * records.size() < static_cast<size_t>(mNumElements))
+            {
+                for (size_t i = 0; i < records.size(); ++i)
                 {
-                    // A parent exists.
-                    parent = (child - 1) / 2;
-
-                    if (mPointers[parent]->value <= value)
-                    {
-                        // The new value is in the correct place to restore
-                        // the tree to a heap.
-                        break;
-                    }
-
-                    // The parent has a smaller value than the child's value.
-                    // Swap the child and parent.
-
-                    // Move the parent into the child's slot.
-                    mPointers[child] = mPointers[parent];
-                    mPointers[child]->index = child;
-
-                    // Move the child into the parent's slot.
-                    mPointers[parent] = record;
-                    mPointers[parent]->index = parent;
+                    Update(records[i], values[i]);
+                }
+                return;
+            }
 
-                    child = parent;
+            for (size_t i = 0; i < records.size(); ++i)
+            {
+                Record* record = records[i];
+                if (record)
+                {
+                    record->value = values[i];
+                    mValues[record->index] = values[i];
                 }
             }
+            Rebuild();
         }
 
         // Support for debugging.  The functions test whether the data
@@ -391,15 +345,17 @@ namespace gte
         {
             for (int32_t child = 0; child < mNumElements; ++child)
             {
-                int32_t parent = (child - 1) / 2;
-                if (parent > 0)
+                if (mPointers[child]->index != child
+                    || !(mValues[child] <= mPointers[child]->value
+                    && mPointers[child]->value <= mValues[child]))
                 {
-                    if (mPointers[child]->value < mPointers[parent]->value)
-                    {
-                        return false;
-                    }
+                    return false;
+                }
 
-                    if (mPointers[parent]->index != parent)
+                if (child > 0)
+                {
+                    int32_t parent = (child - 1) / Arity;
+                    if (mValues[child] < mValues[parent])
                     {
                         return false;
                     }
@@ -410,13 +366,93 @@ namespace gte
         }
 
     private:
+        // Move 'record' from the slot 'child' toward the root, moving the
+        // ancestors with larger values one level down, until the parent of
+        // its slot has a value smaller than or equal to its value.
+        void SiftUp(int32_t child, Record* record)
+        {
+            ValueType const& value = record->value;
+            while (child > 0)
+            {
+                int32_t parent = (child - 1) / Arity;
+                if (mValues[parent] <= value)
+                {
+                    break;
+                }
+
+                mPointers[child] = mPointers[parent];
+                mPointers[child]->index = child;
+                mValues[child] = mValues[parent];
+                child = parent;
+            }
+
+            mPointers[child] = record;
+            mPointers[child]->index = child;
+            mValues[child] = value;
+        }
+
+        // Move 'record' from the slot 'parent' toward the leaves, moving the
+        // child of minimum value one level up, until its value is smaller
+        // than or equal to the values of the children of its slot.
+        void SiftDown(int32_t parent, Record* record)
+        {
+            ValueType const& value = record->value;
+            for (;;)
+            {
+                int32_t first = Arity * parent + 1;
+                if (first >= mNumElements)
+                {
+                    break;
+                }
+
+                // The children of a node are adjacent in mValues, so the
+                // search for the minimum reads contiguous memory.
+                int32_t end = std::min(first + Arity, mNumElements);
+                int32_t minChild = first;
+                for (int32_t child = first + 1; child < end; ++child)
+                {
+                    if (mValues[child] < mValues[minChild])
+                    {
+                        minChild = child;
+                    }
+                }
+
+                if (value <= mValues[minChild])
+                {
+                    break;
+                }
+
+                mPointers[parent] = mPointers[minChild];
+                mPointers[parent]->index = parent;
+                mValues[parent] = mValues[minChild];
+                parent = minChild;
+            }
+
+            mPointers[parent] = record;
+            mPointers[parent]->index = parent;
+            mValues[parent] = value;
+        }
+
+        // Restore the heap invariant for arbitrary values by sifting down
+        // the interior nodes from the last to the root.
+        void Rebuild()
+        {
+            for (int32_t parent = (mNumElements - 2) / Arity; parent >= 0; --parent)
+            {
+                SiftDown(parent, mPointers[parent]);
+            }
+        }
+
         // A 2-level storage system is used.  The pointers have two roles.
         // Firstly, they are unique to each inserted value in order to support
         // the Update() capability of the min-heap.  Secondly, they avoid
         // potentially expensive copying of Record objects as sorting occurs
-        // in the heap.
+        // in the heap.  The values are also stored in heap order in mValues,
+        // mValues[i] = mPointers[i]->value, so the comparisons of the sift
+        // operations do not dereference the pointers.
         int32_t mNumElements;
         std::vector<Record> mRecords;
         std::vector<Record*> mPointers;
+        std::vector<ValueType> mValues;
     };
 }
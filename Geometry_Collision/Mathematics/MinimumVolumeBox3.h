@@ -12,6 +12,7 @@
 #include <Mathematics/VETManifoldMesh.h>
 #include <Mathematics/AlignedBox.h>
 #include <Mathematics/UniqueVerticesSimplices.h>
+#include <Mathematics/TaskScheduler.h>
 #include <cstring>
 
 // Compute a minimum-volume oriented box containing the specified points. The
@@ -34,7 +35,8 @@
 // approximation to it based on how many samples the minimizer uses in its
 // search. You can also derive from a class and override the virtual
 // functions that are used for minimization in order to provided your own
-// minimizer algorithm.
+// minimizer algorithm. For a fast approximation with a bound on the volume
+// ratio, see ApproximateMinimumVolumeBox3.
 
 namespace gte
 {
@@ -285,7 +287,9 @@ namespace gte
                     projection[i][1] = Dot(basis[2], diff);
                 }
 
-                // Compute the minimum area box in 2D.
+                // Compute the minimum area box in 2D. The rational
+                // temporaries are allocated from the thread-local arena.
+                UIntegerAP32Arena::Scope scope;
                 MinimumAreaBox2<InputType, BSRational<UIntegerAP32>> mab2;
                 OrientedBox2<InputType> rectangle = mab2(numPoints, &projection[0]);
 
@@ -735,10 +739,10 @@ namespace gte
                 imax.back() = mEdgeIndices.size();
 
                 std::vector<Candidate> candidates(mNumThreads);
-                std::vector<std::thread> process(mNumThreads);
+                TaskScheduler::TaskGroup group;
                 for (size_t t = 0; t < mNumThreads; ++t)
                 {
-                    process[t] = std::thread(
+                    group.Run(
                         [this, t, &imin, &imax, &candidates]()
                         {
                             candidates[t] = mAlignedCandidate;
@@ -749,9 +753,9 @@ namespace gte
                         });
                 }
 
+                group.Wait();
                 for (size_t t = 0; t < mNumThreads; ++t)
                 {
-                    process[t].join();
                     if (candidates[t].volume < mMinimumVolumeObject.volume)
                     {
                         mMinimumVolumeObject = candidates[t];
@@ -816,8 +820,9 @@ namespace gte
             volume = static_cast<InputType>(mRBox.volume);
         }
 
-        // The number of threads to use for computing. If 0, the main thread
-        // is used. If positive, std::thread objects are used.
+        // The number of tasks to use for computing. If 0, the main thread
+        // is used. If positive, the edge pairs are partitioned into tasks of
+        // TaskScheduler::GetDefault().
         size_t mNumThreads;
 
         // The maximum sample index used to search each level curve for
@@ -0,0 +1,209 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+// The first and second moments of a set of points: the number of points,
+// the mean and the sums of the products of the deviations from the mean.
+// The moments of two sets are merged into the moments of their union by
+//     Tony F. Chan, Gene H. Golub and Randall J. LeVeque,
+//     "Updating Formulae and a Pairwise Algorithm for Computing Sample
+//     Variances", Technical Report STAN-CS-79-773, Stanford University,
+//     1979.
+// so the points can be accumulated in chunks, for example while streaming
+// a scan from disk, and on several threads whose moments are merged at the
+// end. Only the moments are stored, so the memory does not depend on the
+// number of points. The moments are the input to the FitMoments functions
+// of ApprGaussian3 and ApprOrthogonalPlane3.
+//
+// The points of a chunk are accumulated in blocks. The mean of a block is
+// computed first and then the deviations from it, as in the two passes of
+// ApprGaussian3::FitIndexed, and the block is merged into the moments. This
+// is as accurate as the two-pass algorithm for each block and avoids the
+// cancellation of the sums of squares of the one-pass algorithm for points
+// far from the origin.
+
+namespace gte
+{
+    template <typename Real>
+    class Moments3
+    {
+    public:
+        Moments3()
+            :
+            mNumPoints(0),
+            mMean(Vector3<Real>::Zero()),
+            mComoment{ (Real)0, (Real)0, (Real)0, (Real)0, (Real)0, (Real)0 }
+        {
+        }
+
+        void Clear()
+        {
+            *this = Moments3();
+        }
+
+        void Accumulate(Vector3<Real> const& point)
+        {
+            Accumulate(1, &point);
+        }
+
+        void Accumulate(size_t numPoints, Vector3<Real> const* points)
+        {
+            for (size_t first = 0; first < numPoints; first += blockSize)
+            {
+                size_t const count = std::min(blockSize, numPoints - first);
+                Merge(ComputeBlock(count, points + first));
+            }
+        }
+
+        // Merge the moments of another set of points, for example those of
+        // another thread or another chunk.
+        void Merge(Moments3 const& other)
+        {
+            if (other.mNumPoints == 0)
+            {
+                return;
+            }
+            if (mNumPoints == 0)
+            {
+                *this = other;
+                return;
+            }
+
+            size_t const numPoints = mNumPoints + other.mNumPoints;
+            Real const invNumPoints = (Real)1 / (Real)numPoints;
+            Real const weight = (Real)other.mNumPoints * invNumPoints;
+            Real const product = (Real)mNumPoints * weight;
+            Vector3<Real> const delta = other.mMean - mMean;
+            mMean += weight * delta;
+            mComoment[0] += other.mComoment[0] + product * delta[0] * delta[0];
+            mComoment[1] += other.mComoment[1] + product * delta[0] * delta[1];
+            mComoment[2] += other.mComoment[2] + product * delta[0] * delta[2];
+            mComoment[3] += other.mComoment[3] + product * delta[1] * delta[1];
+            mComoment[4] += other.mComoment[4] + product * delta[1] * delta[2];
+            mComoment[5] += other.mComoment[5] + product * delta[2] * delta[2];
+            mNumPoints = numPoints;
+        }
+
+        // Compute the moments of an array of points on numThreads threads,
+        // or on the hardware concurrency when numThreads is 0. Each thread
+        // accumulates a contiguous range of points, and the moments of the
+        // ranges are merged in order, so the result does not depend on the
+        // scheduling of the threads.
+        static Moments3 Compute(size_t numPoints, Vector3<Real> const* points,
+            size_t numThreads = 1)
+        {
+            if (numThreads == 0)
+            {
+                numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+            }
+            numThreads = std::max(std::min(numThreads, numPoints / blockSize),
+                static_cast<size_t>(1));
+
+            std::vector<Moments3> moments(numThreads);
+            auto accumulate = [numPoints, numThreads, points, &moments](size_t t)
+            {
+                size_t const begin = t * numPoints / numThreads;
+                size_t const end = (t + 1) * numPoints / numThreads;
+                moments[t].Accumulate(end - begin, points + begin);
+            };
+
+            std::vector<std::thread> threads;
+            threads.reserve(numThreads);
+            for (size_t t = 1; t < numThreads; ++t)
+            {
+                threads.emplace_back(accumulate, t);
+            }
+            accumulate(0);
+            for (auto& thread : threads)
+            {
+                thread.join();
+            }
+
+            for (size_t t = 1; t < numThreads; ++t)
+            {
+                moments[0].Merge(moments[t]);
+            }
+            return moments[0];
+        }
+
+        inline size_t GetNumPoints() const
+        {
+            return mNumPoints;
+        }
+
+        inline Vector3<Real> const& GetMean() const
+        {
+            return mMean;
+        }
+
+        // The sums of the products of the deviations from the mean, packed
+        // as { c00, c01, c02, c11, c12, c22 }.
+        inline std::array<Real, 6> const& GetComoment() const
+        {
+            return mComoment;
+        }
+
+        // The covariance matrix, the comoment divided by the number of
+        // points, packed as { c00, c01, c02, c11, c12, c22 } for
+        // SymmetricEigensolver3x3 and NISymmetricEigensolver3x3Batch. It is
+        // the covariance matrix of ApprGaussian3 and ApprOrthogonalPlane3.
+        std::array<Real, 6> GetCovariance() const
+        {
+            std::array<Real, 6> covariance = mComoment;
+            if (mNumPoints > 0)
+            {
+                Real const invNumPoints = (Real)1 / (Real)mNumPoints;
+                for (auto& element : covariance)
+                {
+                    element *= invNumPoints;
+                }
+            }
+            return covariance;
+        }
+
+    private:
+        static Moments3 ComputeBlock(size_t numPoints, Vector3<Real> const* points)
+        {
+            Moments3 block;
+            block.mNumPoints = numPoints;
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                block.mMean += points[i];
+            }
+            block.mMean /= (Real)numPoints;
+
+            auto& c = block.mComoment;
+            for (size_t i = 0; i < numPoints; ++i)
+            {
+                Vector3<Real> diff = points[i] - block.mMean;
+                c[0] += diff[0] * diff[0];
+                c[1] += diff[0] * diff[1];
+                c[2] += diff[0] * diff[2];
+                c[3] += diff[1] * diff[1];
+                c[4] += diff[1] * diff[2];
+                c[5] += diff[2] * diff[2];
+            }
+            return block;
+        }
+
+        // The number of points whose mean is computed before their
+        // deviations are accumulated.
+        static size_t constexpr blockSize = 1024;
+
+        size_t mNumPoints;
+        Vector3<Real> mMean;
+        std::array<Real, 6> mComoment;
+    };
+}
@@ -9,6 +9,8 @@
 
 #include <Mathematics/BasisFunction.h>
 #include <Mathematics/ParametricCurve.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 
 namespace gte
 {
@@ -153,43 +155,123 @@ namespace gte
             int32_t imin, imax;
             mBasisFunction.Evaluate(t, order, imin, imax);
 
+            std::array<Vector<N, Real>, ParametricCurve<N, Real>::SUP_ORDER> X{};
+            std::array<Real, ParametricCurve<N, Real>::SUP_ORDER> w{};
+            for (uint32_t k = 0; k <= order; ++k)
+            {
+                Compute(k, imin, imax, X[k], w[k]);
+            }
+            GetJet(order, X.data(), w.data(), jet);
+        }
+
+        // Batch evaluation of the curve at the parameters t[0] through
+        // t[numSamples-1].  The jets are stored consecutively; that is,
+        // jets[s * (order + 1) + k] is jet[k] of Evaluate(t[s], order, jet).
+        // The basis functions are evaluated by the batch function of
+        // BasisFunction, which is fastest when the parameters are sorted.
+        // Set numThreads to 2 or larger to evaluate blocks of samples as
+        // tasks of TaskScheduler::GetDefault().
+        void Evaluate(size_t numSamples, Real const* t, uint32_t order,
+            Vector<N, Real>* jets, size_t numThreads = 0) const
+        {
+            LogAssert(order <= 3, "Invalid order.");
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+            if (!this->mConstructed)
+            {
+                // Return zero-valued jets for invalid state.
+                for (size_t i = 0; i < numSamples * numOrders; ++i)
+                {
+                    jets[i].MakeZero();
+                }
+                return;
+            }
+
+            size_t const numTasks = std::max(std::min(numThreads,
+                numSamples / 1024), static_cast<size_t>(1));
+            if (numTasks == 1)
+            {
+                EvaluateBlock(0, numSamples, t, order, jets);
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [this, numSamples, numTasks, t, order, jets](size_t k)
+                {
+                    EvaluateBlock(k * numSamples / numTasks,
+                        (k + 1) * numSamples / numTasks, t, order, jets);
+                });
+        }
+
+    protected:
+        // Compute the jet of the curve from the derivatives X[k] of the
+        // numerator and w[k] of the denominator for 0 <= k <= order.
+        static void GetJet(uint32_t order, Vector<N, Real> const* X,
+            Real const* w, Vector<N, Real>* jet)
+        {
             // Compute position.
-            Vector<N, Real> X;
-            Real w;
-            Compute(0, imin, imax, X, w);
-            Real invW = (Real)1 / w;
-            jet[0] = invW * X;
+            Real invW = (Real)1 / w[0];
+            jet[0] = invW * X[0];
 
             if (order >= 1)
             {
                 // Compute first derivative.
-                Vector<N, Real> XDer1;
-                Real wDer1;
-                Compute(1, imin, imax, XDer1, wDer1);
-                jet[1] = invW * (XDer1 - wDer1 * jet[0]);
+                jet[1] = invW * (X[1] - w[1] * jet[0]);
 
                 if (order >= 2)
                 {
                     // Compute second derivative.
-                    Vector<N, Real> XDer2;
-                    Real wDer2;
-                    Compute(2, imin, imax, XDer2, wDer2);
-                    jet[2] = invW * (XDer2 - (Real)2 * wDer1 * jet[1] - wDer2 * jet[0]);
+                    jet[2] = invW * (X[2] - (Real)2 * w[1] * jet[1] - w[2] * jet[0]);
 
                     if (order == 3)
                     {
                         // Compute third derivative.
-                        Vector<N, Real> XDer3;
-                        Real wDer3;
-                        Compute(3, imin, imax, XDer3, wDer3);
-                        jet[3] = invW * (XDer3 - (Real)3 * wDer1 * jet[2] -
-                            (Real)3 * wDer2 * jet[1] - wDer3 * jet[0]);
+                        jet[3] = invW * (X[3] - (Real)3 * w[1] * jet[2] -
+                            (Real)3 * w[2] * jet[1] - w[3] * jet[0]);
                     }
                 }
             }
         }
 
-    protected:
+        // Support for the batch Evaluate(...).  The basis values are
+        // computed for chunks of samples to bound the scratch memory.
+        void EvaluateBlock(size_t smin, size_t smax, Real const* t,
+            uint32_t order, Vector<N, Real>* jets) const
+        {
+            size_t const chunkSize = 256;
+            size_t const numOrders = static_cast<size_t>(order) + 1;
+            size_t const numBasis = static_cast<size_t>(mBasisFunction.GetDegree()) + 1;
+            int32_t const numControls = GetNumControls();
+            std::vector<int32_t> minIndices(chunkSize);
+            std::vector<Real> values(chunkSize * numOrders * numBasis);
+            std::array<Vector<N, Real>, ParametricCurve<N, Real>::SUP_ORDER> X{};
+            std::array<Real, ParametricCurve<N, Real>::SUP_ORDER> w{};
+            for (size_t s0 = smin; s0 < smax; s0 += chunkSize)
+            {
+                size_t const numChunkSamples = std::min(chunkSize, smax - s0);
+                mBasisFunction.Evaluate(numChunkSamples, t + s0, order,
+                    minIndices.data(), values.data());
+
+                for (size_t c = 0; c < numChunkSamples; ++c)
+                {
+                    Real const* basis = &values[c * numOrders * numBasis];
+                    for (size_t k = 0; k < numOrders; ++k, basis += numBasis)
+                    {
+                        X[k].MakeZero();
+                        w[k] = (Real)0;
+                        for (size_t m = 0; m < numBasis; ++m)
+                        {
+                            int32_t i = minIndices[c] + static_cast<int32_t>(m);
+                            int32_t j = (i >= numControls ? i - numControls : i);
+                            Real tmp = basis[m] * mWeights[j];
+                            X[k] += tmp * mControls[j];
+                            w[k] += tmp;
+                        }
+                    }
+                    GetJet(order, X.data(), w.data(), &jets[(s0 + c) * numOrders]);
+                }
+            }
+        }
+
         // Support for Evaluate(...).
         void Compute(uint32_t order, int32_t imin, int32_t imax, Vector<N, Real>& X, Real& w) const
         {
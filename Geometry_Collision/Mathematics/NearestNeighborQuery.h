@@ -9,6 +9,13 @@
 
 #include <Mathematics/Logger.h>
 #include <Mathematics/Vector.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <utility>
 #include <vector>
 
 // TODO: This is not a KD-tree nearest neighbor query. Instead, it is an
@@ -24,6 +31,21 @@
 // 'Vector<N,Real> GetPosition () const'. The Site template parameter
 // allows the query to be applied even when it has more local information
 // than just point location.
+//
+// The subtrees of the top levels of the tree can be built on separate
+// threads, and batch versions of the queries distribute the query points
+// over threads. The sites are stored in structure-of-arrays layout in the
+// order of the leaves for the distance computations.
+//
+// Sites can be inserted, removed and moved after construction, which is
+// much cheaper than rebuilding the tree when only some of the sites of a
+// particle system change leaves between frames. The splits of the tree are
+// not changed when a site moves within the cell of its leaf. Each leaf has
+// a fixed number of site slots; when a site is added to a full leaf, the
+// lowest subtree containing the leaf that is at most 3/4 full is marked
+// dirty and its sites are redistributed in place, in the manner of a
+// scapegoat tree. The tree is rebuilt with twice the number of slots per
+// site when no such subtree exists.
 
 namespace gte
 {
@@ -72,6 +94,10 @@ namespace gte
         // Supporting data structures.
         typedef std::pair<Vector<N, Real>, int32_t> SortedPoint;
 
+        // The nodes are stored in depth-first order, so the left child of
+        // an interior node i is node i+1. The capacity is the number of
+        // site slots of a leaf, or of the leaves of the subtree of an
+        // interior node, and numSites <= capacity.
         struct Node
         {
             Real split;
@@ -80,16 +106,29 @@ namespace gte
             int32_t siteOffset;
             int32_t left;
             int32_t right;
+            int32_t capacity;
         };
 
-        // Construction.
-        NearestNeighborQuery(std::vector<Site> const& sites, int32_t maxLeafSize, int32_t maxLevel)
+        // Construction. The subtrees of the top levels are built on
+        // separate threads when numThreads > 1. The tree does not depend on
+        // the number of threads.
+        NearestNeighborQuery(std::vector<Site> const& sites, int32_t maxLeafSize, int32_t maxLevel,
+            size_t numThreads = 0)
             :
             mMaxLeafSize(maxLeafSize),
             mMaxLevel(maxLevel),
+            mNumThreads(numThreads),
             mSortedPoints(sites.size()),
+            mNodes{},
             mDepth(0),
-            mLargestNodeSize(0)
+            mLargestNodeSize(0),
+            mNumSites(static_cast<int32_t>(sites.size())),
+            mLeafCoordinates{},
+            mSiteIndices{},
+            mCells{},
+            mParents{},
+            mSlotLeaves{},
+            mSiteSlots(sites.size())
         {
             LogAssert(mMaxLevel > 0 && mMaxLevel <= 32, "Invalid max level.");
 
@@ -99,8 +138,7 @@ namespace gte
                 mSortedPoints[i] = std::make_pair(sites[i].GetPosition(), i);
             }
 
-            mNodes.push_back(Node());
-            Build(numSites, 0, 0, 0);
+            BuildTree(1);
         }
 
         // Member access.
@@ -124,6 +162,24 @@ namespace gte
             return mLargestNodeSize;
         }
 
+        // The number of sites currently in the tree.
+        inline int32_t GetNumSites() const
+        {
+            return mNumSites;
+        }
+
+        // The site indices are in [0,GetNumSiteIndices()). The indices of
+        // removed sites are not reused.
+        inline int32_t GetNumSiteIndices() const
+        {
+            return static_cast<int32_t>(mSiteSlots.size());
+        }
+
+        inline bool IsSite(int32_t i) const
+        {
+            return 0 <= i && i < GetNumSiteIndices() && mSiteSlots[i] != -1;
+        }
+
         int32_t GetNumNodes() const
         {
             return static_cast<int32_t>(mNodes.size());
@@ -137,11 +193,13 @@ namespace gte
         // Compute up to MaxNeighbors nearest neighbors within the specified
         // radius of the point. The returned integer is the number of
         // neighbors found, possibly zero. The neighbors array stores indices
-        // into the array passed to the constructor.
+        // into the array passed to the constructor, sorted by increasing
+        // distance to the point. Once MaxNeighbors neighbors have been
+        // found, the search radius is reduced to the distance of the
+        // farthest of them, which prunes more of the tree.
         template <int32_t MaxNeighbors>
         int32_t FindNeighbors(Vector<N, Real> const& point, Real radius, std::array<int32_t, MaxNeighbors>& neighbors) const
         {
-            Real sqrRadius = radius * radius;
             int32_t numNeighbors = 0;
             std::array<int32_t, MaxNeighbors + 1> localNeighbors;
             std::array<Real, MaxNeighbors + 1> neighborSqrLength;
@@ -151,143 +209,576 @@ namespace gte
                 neighborSqrLength[i] = std::numeric_limits<Real>::max();
             }
 
-            // The kd-tree construction is recursive, simulated here by using
-            // a stack. The maximum depth is limited to 32, because the number
-            // of sites is limited to 2^{32} (the number of 32-bit integer
-            // indices).
-            std::array<int32_t, 32> stack{};
-            int32_t top = 0;
-            stack[0] = 0;
-
-            int32_t maxNeighbors = MaxNeighbors;
-            if (maxNeighbors == 1)
-            {
-                while (top >= 0)
+            Real bound = radius * radius;
+            Traverse(point, bound,
+                [&](int32_t j, Real sqrLength)
                 {
-                    Node node = mNodes[stack[top--]];
-
-                    if (node.siteOffset != -1)
+                    // Maintain the nearest neighbors.
+                    int32_t k;
+                    for (k = 0; k < numNeighbors; ++k)
                     {
-                        for (int32_t i = 0, j = node.siteOffset; i < node.numSites; ++i, ++j)
+                        if (sqrLength <= neighborSqrLength[k])
                         {
-                            auto diff = mSortedPoints[j].first - point;
-                            auto sqrLength = Dot(diff, diff);
-                            if (sqrLength <= sqrRadius)
+                            for (int32_t n = numNeighbors; n > k; --n)
                             {
-                                // Maintain the nearest neighbors.
-                                if (sqrLength <= neighborSqrLength[0])
-                                {
-                                    localNeighbors[0] = mSortedPoints[j].second;
-                                    neighborSqrLength[0] = sqrLength;
-                                    numNeighbors = 1;
-                                }
+                                localNeighbors[n] = localNeighbors[static_cast<size_t>(n) - 1];
+                                neighborSqrLength[n] = neighborSqrLength[static_cast<size_t>(n) - 1];
                             }
+                            break;
                         }
                     }
+                    if (k < MaxNeighbors)
+                    {
+                        localNeighbors[k] = mSiteIndices[j];
+                        neighborSqrLength[k] = sqrLength;
+                    }
+                    if (numNeighbors < MaxNeighbors)
+                    {
+                        ++numNeighbors;
+                    }
+                    if (numNeighbors == MaxNeighbors)
+                    {
+                        bound = std::min(bound, neighborSqrLength[static_cast<size_t>(MaxNeighbors) - 1]);
+                    }
+                });
+
+            for (int32_t i = 0; i < numNeighbors; ++i)
+            {
+                neighbors[i] = localNeighbors[i];
+            }
+
+            return numNeighbors;
+        }
 
-                    if (node.left != -1 && point[node.axis] - radius <= node.split)
+        // Compute all the neighbors within the specified radius of the
+        // point. The neighbors are indices into the array passed to the
+        // constructor, in the order the tree is traversed; the input array
+        // is cleared but its capacity is reused.
+        void FindNeighbors(Vector<N, Real> const& point, Real radius, std::vector<int32_t>& neighbors) const
+        {
+            neighbors.clear();
+            Real bound = radius * radius;
+            Traverse(point, bound,
+                [this, &neighbors](int32_t j, Real)
+                {
+                    neighbors.push_back(mSiteIndices[j]);
+                });
+        }
+
+        // Batch queries for many points. The points are partitioned into
+        // contiguous ranges, one per thread, and the outputs do not depend
+        // on numThreads. The query runs on the calling thread when
+        // numThreads <= 1.
+        //
+        // The nearest-neighbor query stores the neighbors of points[i] in
+        // neighbors[i] and their number in numNeighbors[i].
+        template <int32_t MaxNeighbors>
+        void FindNeighbors(std::vector<Vector<N, Real>> const& points, Real radius,
+            std::vector<std::array<int32_t, MaxNeighbors>>& neighbors,
+            std::vector<int32_t>& numNeighbors, size_t numThreads = 0) const
+        {
+            neighbors.resize(points.size());
+            numNeighbors.resize(points.size());
+            ForEachRange(points.size(), numThreads,
+                [this, &points, radius, &neighbors, &numNeighbors](size_t, size_t i0, size_t i1)
+                {
+                    for (size_t i = i0; i < i1; ++i)
                     {
-                        stack[++top] = node.left;
+                        numNeighbors[i] = FindNeighbors<MaxNeighbors>(points[i], radius, neighbors[i]);
                     }
+                });
+        }
 
-                    if (node.right != -1 && point[node.axis] + radius >= node.split)
+        // The radius query stores the neighbors of points[i] in
+        // neighbors[offsets[i]] through neighbors[offsets[i+1]-1], so
+        // offsets has points.size()+1 elements.
+        void FindNeighbors(std::vector<Vector<N, Real>> const& points, Real radius,
+            std::vector<int32_t>& neighbors, std::vector<size_t>& offsets,
+            size_t numThreads = 0) const
+        {
+            offsets.resize(points.size() + 1);
+            offsets[0] = 0;
+
+            // Each thread gathers the neighbors of its range of points and
+            // then the ranges are concatenated in order.
+            size_t const numRanges = std::max(numThreads, static_cast<size_t>(1));
+            std::vector<std::vector<int32_t>> rangeNeighbors(numRanges);
+            ForEachRange(points.size(), numThreads,
+                [this, &points, radius, &rangeNeighbors, &offsets](size_t r, size_t i0, size_t i1)
+                {
+                    auto& output = rangeNeighbors[r];
+                    std::vector<int32_t> pointNeighbors{};
+                    for (size_t i = i0; i < i1; ++i)
                     {
-#if defined(GTE_USE_MSWINDOWS)
-#pragma warning(disable : 28020)
-#endif
-                        stack[++top] = node.right;
-#if defined(GTE_USE_MSWINDOWS)
-#pragma warning(default : 28020)
-#endif
+                        FindNeighbors(points[i], radius, pointNeighbors);
+                        output.insert(output.end(), pointNeighbors.begin(), pointNeighbors.end());
+                        offsets[i + 1] = pointNeighbors.size();
                     }
-                }
+                });
+
+            for (size_t i = 0; i < points.size(); ++i)
+            {
+                offsets[i + 1] += offsets[i];
+            }
+
+            neighbors.clear();
+            neighbors.reserve(offsets.back());
+            for (auto const& output : rangeNeighbors)
+            {
+                neighbors.insert(neighbors.end(), output.begin(), output.end());
+            }
+        }
+
+        // Incremental updates. A site inserted after construction gets the
+        // next unused site index, which is returned by Insert. Only the
+        // position of a site is stored, so Move takes the new position.
+        int32_t Insert(Site const& site)
+        {
+            int32_t const i = GetNumSiteIndices();
+            mSiteSlots.push_back(-1);
+            std::vector<SortedPoint> pending(1, std::make_pair(site.GetPosition(), i));
+            Place(pending);
+            return i;
+        }
+
+        void Remove(int32_t i)
+        {
+            LogAssert(IsSite(i), "Invalid site index.");
+            RemoveFromLeaf(i);
+        }
+
+        void Move(int32_t i, Vector<N, Real> const& position)
+        {
+            LogAssert(IsSite(i), "Invalid site index.");
+            int32_t const slot = mSiteSlots[i];
+            int32_t const leaf = mSlotLeaves[slot];
+            if (Contains(leaf, position))
+            {
+                SetSlot(leaf, slot, std::make_pair(position, i));
             }
             else
             {
-                while (top >= 0)
-                {
-                    Node node = mNodes[stack[top--]];
+                RemoveFromLeaf(i);
+                std::vector<SortedPoint> pending(1, std::make_pair(position, i));
+                Place(pending);
+            }
+        }
 
-                    if (node.siteOffset != -1)
+        // Set the positions of all the sites, where positions[i] is the
+        // new position of site i and positions.size() is
+        // GetNumSiteIndices(); the positions of removed sites are ignored.
+        // This is the update for a particle system whose particles are the
+        // sites. The sites that remain in the cells of their leaves are
+        // updated on max(numThreads,1) threads. The other sites are then
+        // placed in their new leaves and each dirty subtree is rebalanced
+        // once.
+        void Move(std::vector<Vector<N, Real>> const& positions, size_t numThreads = 0)
+        {
+            LogAssert(positions.size() == mSiteSlots.size(), "Invalid number of positions.");
+
+            // The slots are processed in order, so the writes to the
+            // leaves are sequential. The sites that remain in their leaves
+            // are written to their own slots, so the ranges of slots can be
+            // processed concurrently.
+            std::vector<uint32_t> leavesCell(positions.size(), 0);
+            ForEachRange(mSiteIndices.size(), numThreads,
+                [this, &positions, &leavesCell](size_t, size_t s0, size_t s1)
+                {
+                    for (size_t slot = s0; slot < s1; ++slot)
                     {
-                        for (int32_t i = 0, j = node.siteOffset; i < node.numSites; ++i, ++j)
+                        int32_t const i = mSiteIndices[slot];
+                        if (i != -1)
                         {
-                            Vector<N, Real> diff = mSortedPoints[j].first - point;
-                            Real sqrLength = Dot(diff, diff);
-                            if (sqrLength <= sqrRadius)
+                            int32_t const leaf = mSlotLeaves[slot];
+                            if (Contains(leaf, positions[i]))
                             {
-                                // Maintain the nearest neighbors.
-                                int32_t k;
-                                for (k = 0; k < numNeighbors; ++k)
-                                {
-                                    if (sqrLength <= neighborSqrLength[k])
-                                    {
-                                        for (int32_t n = numNeighbors; n > k; --n)
-                                        {
-                                            localNeighbors[n] = localNeighbors[static_cast<size_t>(n) - 1];
-                                            neighborSqrLength[n] = neighborSqrLength[static_cast<size_t>(n) - 1];
-                                        }
-                                        break;
-                                    }
-                                }
-                                if (k < MaxNeighbors)
-                                {
-                                    localNeighbors[k] = mSortedPoints[j].second;
-                                    neighborSqrLength[k] = sqrLength;
-                                }
-                                if (numNeighbors < MaxNeighbors)
-                                {
-                                    ++numNeighbors;
-                                }
+                                SetSlot(leaf, static_cast<int32_t>(slot), std::make_pair(positions[i], i));
+                            }
+                            else
+                            {
+                                leavesCell[i] = 1;
                             }
                         }
                     }
+                });
+
+            std::vector<SortedPoint> pending{};
+            for (size_t i = 0; i < positions.size(); ++i)
+            {
+                if (leavesCell[i])
+                {
+                    RemoveFromLeaf(static_cast<int32_t>(i));
+                    pending.push_back(std::make_pair(positions[i], static_cast<int32_t>(i)));
+                }
+            }
+            if (pending.size() > 0)
+            {
+                Place(pending);
+            }
+        }
+
+        // The sorted points are stored in the site slots of the leaves. The
+        // slots of a leaf with siteOffset s are [s,s+capacity), and the
+        // unused slots at the end of the range have an index of -1.
+        inline std::vector<SortedPoint> const& GetSortedPoints() const
+        {
+            return mSortedPoints;
+        }
+
+    private:
+        struct BuildInfo
+        {
+            int32_t depth;
+            int32_t largestNodeSize;
+        };
+
+        // Subtrees with fewer sites are built on the calling thread.
+        static int32_t constexpr minSitesPerThread = 4096;
+
+        // The distances at a leaf are computed in blocks of this size.
+        static int32_t constexpr blockSize = 64;
+
+        // Build the tree from the sites in mSortedPoints[0,mNumSites) and
+        // give each leaf 'slotsPerSite' site slots per site.
+        void BuildTree(int32_t slotsPerSite)
+        {
+            size_t taskDepth = 0;
+            while ((static_cast<size_t>(1) << taskDepth) < mNumThreads)
+            {
+                ++taskDepth;
+            }
+
+            mNodes.clear();
+            BuildInfo info = Build(mNumSites, 0, 0, taskDepth, mNodes);
+            mDepth = info.depth;
+            mLargestNodeSize = info.largestNodeSize;
+
+            // The children of a node follow it in the depth-first order, so
+            // the capacities can be accumulated in reverse order.
+            int32_t const numNodes = static_cast<int32_t>(mNodes.size());
+            int32_t numSlots = 0;
+            mParents.resize(mNodes.size());
+            mParents[0] = -1;
+            for (int32_t i = numNodes - 1; i >= 0; --i)
+            {
+                Node& node = mNodes[i];
+                if (node.siteOffset != -1)
+                {
+                    node.capacity = slotsPerSite * node.numSites;
+                    numSlots += node.capacity;
+                }
+                else
+                {
+                    node.capacity = mNodes[node.left].capacity + mNodes[node.right].capacity;
+                    mParents[node.left] = i;
+                    mParents[node.right] = i;
+                }
+            }
 
-                    if (node.left != -1 && point[node.axis] - radius <= node.split)
+            Real const maxReal = std::numeric_limits<Real>::max();
+            mCells.resize(mNodes.size());
+            for (int32_t d = 0; d < N; ++d)
+            {
+                mCells[0][0][d] = -maxReal;
+                mCells[0][1][d] = maxReal;
+            }
+            ComputeCells(0, numNodes);
+
+            // The queries read the sites from a copy of the sorted points
+            // in which the sites of each leaf are stored in a block in
+            // structure-of-arrays layout, so the distance computations at a
+            // leaf load consecutive coordinates from one block of memory.
+            std::vector<SortedPoint> sortedPoints = std::move(mSortedPoints);
+            mSortedPoints.assign(static_cast<size_t>(numSlots), std::make_pair(Vector<N, Real>{}, -1));
+            mLeafCoordinates.resize(static_cast<size_t>(N) * static_cast<size_t>(numSlots));
+            mSiteIndices.assign(static_cast<size_t>(numSlots), -1);
+            mSlotLeaves.resize(static_cast<size_t>(numSlots));
+            std::fill(mSiteSlots.begin(), mSiteSlots.end(), -1);
+            int32_t slot = 0;
+            for (int32_t i = 0; i < numNodes; ++i)
+            {
+                Node& node = mNodes[i];
+                if (node.siteOffset != -1)
+                {
+                    int32_t const siteOffset = node.siteOffset;
+                    node.siteOffset = slot;
+                    for (int32_t j = 0; j < node.capacity; ++j)
                     {
-                        stack[++top] = node.left;
+                        mSlotLeaves[static_cast<size_t>(slot) + j] = i;
                     }
+                    for (int32_t j = 0; j < node.numSites; ++j)
+                    {
+                        SetSlot(i, slot + j, sortedPoints[static_cast<size_t>(siteOffset) + j]);
+                    }
+                    slot += node.capacity;
+                }
+            }
+        }
+
+        // Store the site in the slot of the leaf.
+        void SetSlot(int32_t leaf, int32_t slot, SortedPoint const& sortedPoint)
+        {
+            Node const& node = mNodes[leaf];
+            Real* block = &mLeafCoordinates[static_cast<size_t>(N) * static_cast<size_t>(node.siteOffset)];
+            size_t const i = static_cast<size_t>(slot) - static_cast<size_t>(node.siteOffset);
+            for (int32_t d = 0; d < N; ++d)
+            {
+                block[static_cast<size_t>(d) * static_cast<size_t>(node.capacity) + i] = sortedPoint.first[d];
+            }
+            mSortedPoints[slot] = sortedPoint;
+            mSiteIndices[slot] = sortedPoint.second;
+            mSiteSlots[sortedPoint.second] = slot;
+        }
 
-                    if (node.right != -1 && point[node.axis] + radius >= node.split)
+        // Compute the cells of the children of the interior nodes in
+        // [i0,i1) from the cells of the nodes. The left subtree of a node
+        // has coordinates at most the split and the right subtree has
+        // coordinates at least the split.
+        void ComputeCells(int32_t i0, int32_t i1)
+        {
+            for (int32_t i = i0; i < i1; ++i)
+            {
+                Node const& node = mNodes[i];
+                if (node.siteOffset == -1)
+                {
+                    mCells[node.left] = mCells[i];
+                    mCells[node.left][1][node.axis] = node.split;
+                    mCells[node.right] = mCells[i];
+                    mCells[node.right][0][node.axis] = node.split;
+                }
+            }
+        }
+
+        // Test whether the point is in the cell of the node, which is the
+        // box bounded by the splits of its ancestors.
+        inline bool Contains(int32_t nodeIndex, Vector<N, Real> const& point) const
+        {
+            auto const& cell = mCells[nodeIndex];
+            bool inside = true;
+            for (int32_t d = 0; d < N; ++d)
+            {
+                inside &= (cell[0][d] <= point[d]) & (point[d] <= cell[1][d]);
+            }
+            return inside;
+        }
+
+        // Remove the site from its leaf by moving the last site of the
+        // leaf into its slot.
+        void RemoveFromLeaf(int32_t i)
+        {
+            int32_t const slot = mSiteSlots[i];
+            int32_t const leaf = mSlotLeaves[slot];
+            int32_t const last = mNodes[leaf].siteOffset + mNodes[leaf].numSites - 1;
+            if (slot != last)
+            {
+                SetSlot(leaf, slot, mSortedPoints[last]);
+            }
+            mSortedPoints[last].second = -1;
+            mSiteIndices[last] = -1;
+            mSiteSlots[i] = -1;
+
+            for (int32_t n = leaf; n != -1; n = mParents[n])
+            {
+                --mNodes[n].numSites;
+            }
+            --mNumSites;
+        }
+
+        // Add the sites to the leaves whose cells contain them. The sites
+        // that do not fit in their leaves are the overflow of the leaves,
+        // and the subtrees containing those leaves are rebalanced after all
+        // the sites have been added.
+        void Place(std::vector<SortedPoint> const& pending)
+        {
+            std::vector<std::pair<int32_t, SortedPoint>> overflow{};
+            for (auto const& sortedPoint : pending)
+            {
+                // The counts include the overflow until the rebalancing.
+                int32_t n = 0;
+                for (;;)
+                {
+                    Node& node = mNodes[n];
+                    ++node.numSites;
+                    if (node.siteOffset != -1)
                     {
-#if defined(GTE_USE_MSWINDOWS)
-#pragma warning(disable : 28020)
-#endif
-                        stack[++top] = node.right;
-#if defined(GTE_USE_MSWINDOWS)
-#pragma warning(default : 28020)
-#endif
+                        break;
                     }
+                    n = (sortedPoint.first[node.axis] <= node.split ? node.left : node.right);
+                }
+
+                Node const& leaf = mNodes[n];
+                if (leaf.numSites <= leaf.capacity)
+                {
+                    SetSlot(n, leaf.siteOffset + leaf.numSites - 1, sortedPoint);
+                    mLargestNodeSize = std::max(mLargestNodeSize, leaf.numSites);
+                }
+                else
+                {
+                    overflow.push_back(std::make_pair(n, sortedPoint));
                 }
+                ++mNumSites;
             }
 
+            if (overflow.size() == 0)
+            {
+                return;
+            }
 
-            for (int32_t i = 0; i < numNeighbors; ++i)
+            // The dirty subtree of an overfull leaf is that of its lowest
+            // ancestor that is at most 3/4 full. The dirty subtrees that are
+            // contained in other dirty subtrees are not processed.
+            std::vector<int32_t> dirty{};
+            for (auto const& element : overflow)
             {
-                neighbors[i] = localNeighbors[i];
+                int32_t n = element.first;
+                while (n != -1 && 4 * static_cast<int64_t>(mNodes[n].numSites) >
+                    3 * static_cast<int64_t>(mNodes[n].capacity))
+                {
+                    n = mParents[n];
+                }
+
+                if (n == -1)
+                {
+                    // The tree is too full to rebalance, so rebuild it with
+                    // twice as many slots per site.
+                    Rebuild(overflow);
+                    return;
+                }
+                dirty.push_back(n);
             }
 
-            return numNeighbors;
+            auto compare = [](std::pair<int32_t, SortedPoint> const& element0,
+                std::pair<int32_t, SortedPoint> const& element1)
+            {
+                return element0.first < element1.first;
+            };
+            std::sort(overflow.begin(), overflow.end(), compare);
+            std::sort(dirty.begin(), dirty.end());
+
+            // An ancestor precedes its descendants in the depth-first order,
+            // and the nodes of the subtree of node i are [i,end).
+            int32_t end = 0;
+            for (auto i : dirty)
+            {
+                if (i < end)
+                {
+                    continue;
+                }
+
+                end = i;
+                while (mNodes[end].siteOffset == -1)
+                {
+                    end = mNodes[end].right;
+                }
+                ++end;
+
+                std::vector<SortedPoint> sortedPoints{};
+                sortedPoints.reserve(static_cast<size_t>(mNodes[i].numSites));
+                GatherSites(i, end, sortedPoints);
+                auto iter = std::lower_bound(overflow.begin(), overflow.end(),
+                    std::make_pair(i, SortedPoint{}), compare);
+                for (; iter != overflow.end() && iter->first < end; ++iter)
+                {
+                    sortedPoints.push_back(iter->second);
+                }
+                Distribute(i, sortedPoints.begin(), sortedPoints.end());
+                ComputeCells(i, end);
+            }
         }
 
-        inline std::vector<SortedPoint> const& GetSortedPoints() const
+        // Append the sites in the leaves of the nodes [i0,i1) to the array
+        // and clear their slots. The counts of overfull leaves include
+        // their overflow, which is not stored in the slots.
+        void GatherSites(int32_t i0, int32_t i1, std::vector<SortedPoint>& sortedPoints)
         {
-            return mSortedPoints;
+            for (int32_t i = i0; i < i1; ++i)
+            {
+                Node const& node = mNodes[i];
+                if (node.siteOffset != -1)
+                {
+                    int32_t const numStored = std::min(node.numSites, node.capacity);
+                    for (int32_t j = 0; j < numStored; ++j)
+                    {
+                        int32_t const slot = node.siteOffset + j;
+                        sortedPoints.push_back(mSortedPoints[slot]);
+                        mSortedPoints[slot].second = -1;
+                        mSiteIndices[slot] = -1;
+                    }
+                }
+            }
+        }
+
+        // Redistribute the sites of a subtree over its leaves in proportion
+        // to their capacities. The axes of the nodes are not changed and
+        // the splits are moved to the medians of the sites, which is the
+        // Build algorithm restricted to the existing nodes.
+        template <typename Iterator>
+        void Distribute(int32_t n, Iterator begin, Iterator end)
+        {
+            Node& node = mNodes[n];
+            node.numSites = static_cast<int32_t>(end - begin);
+            if (node.siteOffset != -1)
+            {
+                int32_t slot = node.siteOffset;
+                for (auto iter = begin; iter != end; ++iter)
+                {
+                    SetSlot(n, slot++, *iter);
+                }
+                mLargestNodeSize = std::max(mLargestNodeSize, node.numSites);
+                return;
+            }
+
+            // The left child gets floor(numSites*leftCapacity/capacity)
+            // sites, so neither child gets more sites than its capacity when
+            // the node is not overfull.
+            int32_t const numLeft = static_cast<int32_t>(static_cast<int64_t>(node.numSites) *
+                static_cast<int64_t>(mNodes[node.left].capacity) / static_cast<int64_t>(node.capacity));
+            auto mid = begin + numLeft;
+            if (mid != end)
+            {
+                int32_t const axis = node.axis;
+                std::nth_element(begin, mid, end,
+                    [axis](SortedPoint const& p0, SortedPoint const& p1)
+                    {
+                        return p0.first[axis] < p1.first[axis];
+                    });
+                node.split = mid->first[axis];
+            }
+
+            int32_t const left = node.left, right = node.right;
+            Distribute(left, begin, mid);
+            Distribute(right, mid, end);
+        }
+
+        // Rebuild the tree from the sites in the slots and the overflow.
+        void Rebuild(std::vector<std::pair<int32_t, SortedPoint>> const& overflow)
+        {
+            std::vector<SortedPoint> sortedPoints{};
+            sortedPoints.reserve(static_cast<size_t>(mNumSites));
+            GatherSites(0, static_cast<int32_t>(mNodes.size()), sortedPoints);
+            for (auto const& element : overflow)
+            {
+                sortedPoints.push_back(element.second);
+            }
+            mSortedPoints = std::move(sortedPoints);
+            BuildTree(2);
         }
 
-    private:
         // Populate the node so that it contains the points split along the
-        // coordinate axes.
-        void Build(int32_t numSites, int32_t siteOffset, int32_t nodeIndex, int32_t level)
+        // coordinate axes. The nodes of the subtree are appended to 'nodes'
+        // in depth-first order, and the child indices are offset by
+        // nodeOffset, the index of nodes[0] in the final array.
+        BuildInfo Build(int32_t numSites, int32_t siteOffset, int32_t level,
+            size_t taskDepth, std::vector<Node>& nodes, int32_t nodeOffset = 0)
         {
             LogAssert(siteOffset != -1, "Invalid site offset.");
-            LogAssert(nodeIndex != -1, "Invalid node index.");
             LogAssert(numSites > 0, "Empty point list.");
 
-            mDepth = std::max(mDepth, level);
-
-            Node& node = mNodes[nodeIndex];
+            size_t const nodeIndex = nodes.size();
+            nodes.push_back(Node());
+            Node node{};
             node.numSites = numSites;
+            BuildInfo info{ level, 0 };
 
             if (numSites > mMaxLeafSize && level <= mMaxLevel)
             {
@@ -313,16 +804,47 @@ namespace gte
                 node.axis = axis;
                 node.siteOffset = -1;
 
-                // Apply a divide-and-conquer step.
-                int32_t left = (int32_t)mNodes.size(), right = left + 1;
-                node.left = left;
-                node.right = right;
-                mNodes.push_back(Node());
-                mNodes.push_back(Node());
-
+                // Apply a divide-and-conquer step. The two halves of the
+                // sites are disjoint, so the right subtree can be built on
+                // another thread into its own node array.
                 int32_t nextLevel = level + 1;
-                Build(halfNumSites, siteOffset, left, nextLevel);
-                Build(numSites - halfNumSites, siteOffset + halfNumSites, right, nextLevel);
+                BuildInfo leftInfo{}, rightInfo{};
+                node.left = nodeOffset + static_cast<int32_t>(nodes.size());
+                if (taskDepth > 0 && numSites >= minSitesPerThread)
+                {
+                    std::vector<Node> rightNodes{};
+                    std::thread worker([this, numSites, halfNumSites, siteOffset,
+                        nextLevel, taskDepth, &rightNodes, &rightInfo]()
+                    {
+                        rightInfo = Build(numSites - halfNumSites, siteOffset + halfNumSites,
+                            nextLevel, taskDepth - 1, rightNodes);
+                    });
+                    leftInfo = Build(halfNumSites, siteOffset, nextLevel, taskDepth - 1,
+                        nodes, nodeOffset);
+                    worker.join();
+
+                    int32_t const rightOffset = nodeOffset + static_cast<int32_t>(nodes.size());
+                    node.right = rightOffset;
+                    for (auto rightNode : rightNodes)
+                    {
+                        if (rightNode.left != -1)
+                        {
+                            rightNode.left += rightOffset;
+                            rightNode.right += rightOffset;
+                        }
+                        nodes.push_back(rightNode);
+                    }
+                }
+                else
+                {
+                    leftInfo = Build(halfNumSites, siteOffset, nextLevel, 0, nodes, nodeOffset);
+                    node.right = nodeOffset + static_cast<int32_t>(nodes.size());
+                    rightInfo = Build(numSites - halfNumSites, siteOffset + halfNumSites,
+                        nextLevel, 0, nodes, nodeOffset);
+                }
+
+                info.depth = std::max(leftInfo.depth, rightInfo.depth);
+                info.largestNodeSize = std::max(leftInfo.largestNodeSize, rightInfo.largestNodeSize);
             }
             else
             {
@@ -334,15 +856,161 @@ namespace gte
                 node.left = -1;
                 node.right = -1;
 
-                mLargestNodeSize = std::max(mLargestNodeSize, node.numSites);
+                info.largestNodeSize = node.numSites;
+            }
+
+            nodes[nodeIndex] = node;
+            return info;
+        }
+
+        // Visit the sites whose squared distance to the point is at most
+        // 'bound' by calling visit(j, sqrLength), where j is the index into
+        // the sorted points. The visitor may decrease 'bound' to prune the
+        // remainder of the traversal.
+        template <typename Visitor>
+        void Traverse(Vector<N, Real> const& point, Real& bound, Visitor&& visit) const
+        {
+            if (mNodes.size() == 0)
+            {
+                return;
+            }
+
+            // The kd-tree construction is recursive, simulated here by using
+            // a stack. A node pushes at most two children after it is
+            // popped, and the maximum depth is limited to 33, so the stack
+            // has at most 34 elements.
+            std::array<int32_t, 64> stack;
+            int32_t top = 0;
+            stack[0] = 0;
+
+            std::array<Real, blockSize> sqrLength;
+            while (top >= 0)
+            {
+                Node const& node = mNodes[stack[top--]];
+
+                if (node.siteOffset != -1)
+                {
+                    // Compute the squared distances of a block of sites in
+                    // loops that the compiler can vectorize, then visit the
+                    // sites that are within the bound.
+                    for (int32_t b = 0; b < node.numSites; b += blockSize)
+                    {
+                        int32_t const count = std::min(blockSize, node.numSites - b);
+                        int32_t const j0 = node.siteOffset + b;
+                        for (int32_t i = 0; i < count; ++i)
+                        {
+                            sqrLength[i] = static_cast<Real>(0);
+                        }
+                        Real const* block = &mLeafCoordinates[static_cast<size_t>(N) *
+                            static_cast<size_t>(node.siteOffset)];
+                        for (int32_t d = 0; d < N; ++d)
+                        {
+                            Real const* coordinate = block +
+                                static_cast<size_t>(d) * static_cast<size_t>(node.capacity) + b;
+                            Real const p = point[d];
+                            for (int32_t i = 0; i < count; ++i)
+                            {
+                                Real diff = coordinate[i] - p;
+                                sqrLength[i] += diff * diff;
+                            }
+                        }
+                        for (int32_t i = 0; i < count; ++i)
+                        {
+                            if (sqrLength[i] <= bound)
+                            {
+                                visit(j0 + i, sqrLength[i]);
+                            }
+                        }
+                    }
+                }
+                else
+                {
+                    // The left subtree has coordinates at most the split
+                    // and the right subtree has coordinates at least the
+                    // split.
+                    Real delta = point[node.axis] - node.split;
+                    bool visitLeft = (delta <= static_cast<Real>(0) || delta * delta <= bound);
+                    bool visitRight = (delta >= static_cast<Real>(0) || delta * delta <= bound);
+
+                    // Visit the child on the side of the point first, which
+                    // finds near neighbors early and lets the visitor
+                    // decrease the bound.
+                    if (delta <= static_cast<Real>(0))
+                    {
+                        if (visitRight)
+                        {
+                            stack[++top] = node.right;
+                        }
+                        if (visitLeft)
+                        {
+                            stack[++top] = node.left;
+                        }
+                    }
+                    else
+                    {
+                        if (visitLeft)
+                        {
+                            stack[++top] = node.left;
+                        }
+                        if (visitRight)
+                        {
+                            stack[++top] = node.right;
+                        }
+                    }
+                }
+            }
+        }
+
+        // Call process(r, i0, i1) for the ranges [i0,i1) of a partition of
+        // [0,numElements) into max(numThreads,1) ranges, where r is the
+        // index of the range.
+        template <typename Process>
+        static void ForEachRange(size_t numElements, size_t numThreads, Process const& process)
+        {
+            if (numThreads <= 1)
+            {
+                process(0, 0, numElements);
+                return;
+            }
+
+            std::vector<std::thread> workers(numThreads);
+            for (size_t r = 0; r < numThreads; ++r)
+            {
+                size_t const i0 = numElements * r / numThreads;
+                size_t const i1 = numElements * (r + 1) / numThreads;
+                workers[r] = std::thread([&process, r, i0, i1]()
+                {
+                    process(r, i0, i1);
+                });
+            }
+            for (auto& worker : workers)
+            {
+                worker.join();
             }
         }
 
         int32_t mMaxLeafSize;
         int32_t mMaxLevel;
+        size_t mNumThreads;
         std::vector<SortedPoint> mSortedPoints;
         std::vector<Node> mNodes;
         int32_t mDepth;
         int32_t mLargestNodeSize;
+        int32_t mNumSites;
+
+        // The coordinates of the sites of a leaf with siteOffset s and
+        // capacity c are mLeafCoordinates[N*s + d*c + i] for d in [0,N)
+        // and i in [0,c). The site indices are in the order of
+        // mSortedPoints.
+        std::vector<Real> mLeafCoordinates;
+        std::vector<int32_t> mSiteIndices;
+
+        // The cells of the nodes as (min,max) corners, the parents of the
+        // nodes, the leaves of the slots and the slots of the sites (-1 for
+        // removed sites).
+        std::vector<std::array<Vector<N, Real>, 2>> mCells;
+        std::vector<int32_t> mParents;
+        std::vector<int32_t> mSlotLeaves;
+        std::vector<int32_t> mSiteSlots;
     };
 }
@@ -17,6 +17,7 @@
 #include <cstdint>
 #include <limits>
 #include <numeric>
+#include <thread>
 #include <vector>
 
 // OBBTree is an abstract class for computing an oriented bounding box tree of
@@ -44,6 +45,14 @@
 // primitives into two subsets of equal size or absolute size difference of 1.
 // This leads to a balanced tree, which is helpful for performance of tree
 // traversals.
+//
+// The children of node i are nodes 2*i+1 and 2*i+2, so the subtrees of a
+// node write disjoint sets of nodes and disjoint ranges of the partition.
+// This allows the subtrees to be built concurrently. The construction is
+// single-threaded when numThreads = 0 or 1 and multithreaded otherwise,
+// where the subtrees of the top levels with enough primitives are built on
+// separate threads. The overrides of ComputeInteriorBox and ComputeLeafBox
+// must therefore only read the members of the tree.
 
 namespace gte
 {
@@ -89,7 +98,8 @@ namespace gte
         // centroids.size(). If larger than 31, the height is clamped to 31.
         void Create(
             std::vector<Vector3<T>> const& centroids,
-            size_t height)
+            size_t height,
+            size_t numThreads = 0)
         {
             LogAssert(centroids.size() > 0, "Invalid input.");
             mCentroids = centroids;
@@ -121,12 +131,20 @@ namespace gte
             mPartition.resize(mCentroids.size());
             std::iota(mPartition.begin(), mPartition.end(), 0);
 
-            // Build the tree recursively.
+            // Build the tree recursively. The subtrees of the nodes with
+            // depth smaller than taskDepth are built on separate threads,
+            // so at most 2^taskDepth threads are active.
+            size_t taskDepth = 0;
+            while ((static_cast<size_t>(1) << taskDepth) < numThreads)
+            {
+                ++taskDepth;
+            }
+
             size_t const depth = 0;
             size_t const nodeIndex = 0;
             size_t const i0 = 0;
             size_t const i1 = mCentroids.size() - 1;
-            BuildTree(depth, nodeIndex, i0, i1);
+            BuildTree(depth, nodeIndex, i0, i1, taskDepth);
         }
 
         // Member access.
@@ -156,15 +174,17 @@ namespace gte
         // to ensure the box contains the primitives represented by the ndoe.
         virtual void ComputeInteriorBox(size_t i0, size_t i1, OrientedBox3<T>& box)
         {
-            // Compute the mean of the centroids.
-            Vector3<T> const vzero = Vector3<T>::Zero();
-            box.center = vzero;
+            // Compute the mean of the centroids. The sum is accumulated in a
+            // local variable rather than in box.center, which the compiler
+            // must assume can alias mCentroids.
+            Vector3<T> center = Vector3<T>::Zero();
             for (size_t i = i0; i <= i1; ++i)
             {
-                box.center += mCentroids[mPartition[i]];
+                center += mCentroids[mPartition[i]];
             }
             T denom = static_cast<T>(i1 - i0 + 1);
-            box.center /= denom;
+            center /= denom;
+            box.center = center;
 
             // Compute the covariance matrix of the centroids.
             T const zero = static_cast<T>(0);
@@ -172,7 +192,7 @@ namespace gte
             T covar11 = zero, covar12 = zero, covar22 = zero;
             for (size_t i = i0; i <= i1; ++i)
             {
-                Vector3<T> diff = mCentroids[mPartition[i]] - box.center;
+                Vector3<T> diff = mCentroids[mPartition[i]] - center;
                 covar00 += diff[0] * diff[0];
                 covar01 += diff[0] * diff[1];
                 covar02 += diff[0] * diff[2];
@@ -212,7 +232,11 @@ namespace gte
         std::vector<size_t> mPartition;
 
     private:
-        void BuildTree(size_t depth, size_t nodeIndex, size_t i0, size_t i1)
+        // Subtrees with fewer primitives are built on the calling thread.
+        static size_t constexpr minPrimitivesPerThread = 1024;
+
+        void BuildTree(size_t depth, size_t nodeIndex, size_t i0, size_t i1,
+            size_t taskDepth)
         {
             auto& node = mNodes[nodeIndex];
             node.minIndex = i0;
@@ -242,8 +266,21 @@ namespace gte
                 // Recurse on the two children.
                 node.leftChild = 2 * nodeIndex + 1;
                 node.rightChild = node.leftChild + 1;
-                BuildTree(depth + 1, node.leftChild, i0, j0);
-                BuildTree(depth + 1, node.rightChild, j1, i1);
+                if (depth < taskDepth && i1 - i0 + 1 >= minPrimitivesPerThread)
+                {
+                    size_t const rightChild = node.rightChild;
+                    std::thread worker([this, depth, rightChild, j1, i1, taskDepth]()
+                    {
+                        BuildTree(depth + 1, rightChild, j1, i1, taskDepth);
+                    });
+                    BuildTree(depth + 1, node.leftChild, i0, j0, taskDepth);
+                    worker.join();
+                }
+                else
+                {
+                    BuildTree(depth + 1, node.leftChild, i0, j0, 0);
+                    BuildTree(depth + 1, node.rightChild, j1, i1, 0);
+                }
             }
             else // i0 = i1
             {
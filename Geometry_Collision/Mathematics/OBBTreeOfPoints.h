@@ -33,13 +33,15 @@ namespace gte
         // be no larger than 31. If std::numeric_limits<size_t>::max(), the
         // the entire tree is built and the actual height is computed from
         // centroids.size(). If larger than 31, the height is clamped to 31.
+        // Read the comments in OBBTree.h regarding numThreads.
         void Create(
             std::vector<Vector3<T>> const& points,
-            size_t height = std::numeric_limits<size_t>::max())
+            size_t height = std::numeric_limits<size_t>::max(),
+            size_t numThreads = 0)
         {
             // Create the OBB tree for centroids. The points are already the
             // centroids.
-            OBBTree<T>::Create(points, height);
+            OBBTree<T>::Create(points, height, numThreads);
         }
 
         // Member access.
@@ -34,10 +34,12 @@ namespace gte
         // be no larger than 31. If std::numeric_limits<size_t>::max(), the
         // the entire tree is built and the actual height is computed from
         // centroids.size(). If larger than 31, the height is clamped to 31.
+        // Read the comments in OBBTree.h regarding numThreads.
         void Create(
             std::vector<Vector3<T>> const& vertices,
             std::vector<std::array<size_t, 2>> const& segments,
-            size_t height = std::numeric_limits<size_t>::max())
+            size_t height = std::numeric_limits<size_t>::max(),
+            size_t numThreads = 0)
         {
             LogAssert(
                 vertices.size() >= 2 && segments.size() > 0,
@@ -56,7 +58,7 @@ namespace gte
             }
 
             // Create the OBB tree for centroids.
-            OBBTree<T>::Create(centroids, height);
+            OBBTree<T>::Create(centroids, height, numThreads);
         }
 
         // Member access.
@@ -13,6 +13,8 @@
 #include <Mathematics/IntrLine3Triangle3.h>
 #include <Mathematics/IntrRay3Triangle3.h>
 #include <Mathematics/IntrSegment3Triangle3.h>
+#include <Mathematics/IntrOrientedBox3OrientedBox3.h>
+#include <Mathematics/IntrTriangle3Triangle3.h>
 #include <Mathematics/OBBTree.h>
 #include <algorithm>
 #include <array>
@@ -21,6 +23,7 @@
 #include <cstdint>
 #include <limits>
 #include <set>
+#include <utility>
 #include <vector>
 
 // Read the comments in OBBTree.h regarding tree construction.
@@ -45,10 +48,12 @@ namespace gte
         // be no larger than 31. If std::numeric_limits<size_t>::max(), the
         // the entire tree is built and the actual height is computed from
         // centroids.size(). If larger than 31, the height is clamped to 31.
+        // Read the comments in OBBTree.h regarding numThreads.
         void Create(
             std::vector<Vector3<T>> const& vertices,
             std::vector<std::array<size_t, 3>> const& triangles,
-            size_t height = std::numeric_limits<size_t>::max())
+            size_t height = std::numeric_limits<size_t>::max(),
+            size_t numThreads = 0)
         {
             LogAssert(
                 vertices.size() >= 3 && triangles.size() > 0,
@@ -67,7 +72,7 @@ namespace gte
             }
 
             // Create the OBB tree for centroids.
-            OBBTree<T>::Create(centroids, height);
+            OBBTree<T>::Create(centroids, height, numThreads);
         }
 
         // Member access.
@@ -256,6 +261,130 @@ namespace gte
             }
         }
 
+        // Generate the pairs (t0,t1) of intersecting triangles, where t0 is
+        // a triangle of this tree and t1 is a triangle of the other tree.
+        // The trees are traversed simultaneously; a pair of nodes is
+        // skipped when their boxes are separated and otherwise the node
+        // with the larger box is descended, or the interior node when the
+        // other is a leaf. The pairs are generated in traversal order.
+        //
+        // The vertices of the other tree are mapped into the coordinate
+        // system of this tree by the rigid motion
+        //   Y = translation + X[0]*rotation[0] + X[1]*rotation[1]
+        //       + X[2]*rotation[2]
+        // so the trees of moving meshes can be queried without rebuilding
+        // them. The rotation[] vectors must be orthonormal.
+        void Execute(OBBTreeOfTriangles const& other,
+            std::array<Vector3<T>, 3> const& rotation, Vector3<T> const& translation,
+            std::vector<std::array<size_t, 2>>& overlaps) const
+        {
+            size_t constexpr invalid = std::numeric_limits<size_t>::max();
+            overlaps.clear();
+
+            auto transformPoint = [&rotation, &translation](Vector3<T> const& X)
+            {
+                return translation + X[0] * rotation[0] + X[1] * rotation[1] + X[2] * rotation[2];
+            };
+
+            auto transformBox = [&rotation, &transformPoint](OrientedBox3<T> const& box)
+            {
+                OrientedBox3<T> result{};
+                result.center = transformPoint(box.center);
+                for (int32_t j = 0; j < 3; ++j)
+                {
+                    auto const& U = box.axis[j];
+                    result.axis[j] = U[0] * rotation[0] + U[1] * rotation[1] + U[2] * rotation[2];
+                }
+                result.extent = box.extent;
+                return result;
+            };
+
+            auto isLeaf = [](OBBNode<T> const& node)
+            {
+                return node.leftChild == invalid || node.rightChild == invalid;
+            };
+
+            // The box of a node is compared many times, so the boxes of
+            // the other tree are transformed once, when first visited.
+            std::vector<OrientedBox3<T>> otherBoxes(other.mNodes.size());
+            std::vector<uint8_t> transformed(other.mNodes.size(), 0);
+            auto getOtherBox = [&](size_t i) -> OrientedBox3<T> const&
+            {
+                if (transformed[i] == 0)
+                {
+                    otherBoxes[i] = transformBox(other.mNodes[i].box);
+                    transformed[i] = 1;
+                }
+                return otherBoxes[i];
+            };
+
+            TIQuery<T, OrientedBox3<T>, OrientedBox3<T>> boxQuery{};
+            TIQuery<T, Triangle3<T>, Triangle3<T>> triangleQuery{};
+            std::vector<std::pair<size_t, size_t>> pairStack{};
+            pairStack.reserve(2 * (this->mHeight + other.mHeight) + 1);
+            pairStack.emplace_back(0, 0);
+            while (pairStack.size() > 0)
+            {
+                size_t n0 = pairStack.back().first;
+                size_t n1 = pairStack.back().second;
+                pairStack.pop_back();
+
+                auto const& node0 = this->mNodes[n0];
+                auto const& node1 = other.mNodes[n1];
+                auto const& box1 = getOtherBox(n1);
+                if (!boxQuery(node0.box, box1).intersect)
+                {
+                    continue;
+                }
+
+                bool leaf0 = isLeaf(node0), leaf1 = isLeaf(node1);
+                if (!leaf0 && (leaf1 || Size(node0.box) >= Size(box1)))
+                {
+                    pairStack.emplace_back(node0.rightChild, n1);
+                    pairStack.emplace_back(node0.leftChild, n1);
+                }
+                else if (!leaf1)
+                {
+                    pairStack.emplace_back(n0, node1.rightChild);
+                    pairStack.emplace_back(n0, node1.leftChild);
+                }
+                else
+                {
+                    for (size_t i0 = node0.minIndex; i0 <= node0.maxIndex; ++i0)
+                    {
+                        size_t t0 = this->mPartition[i0];
+                        auto const& tri0 = mTriangles[t0];
+                        Triangle3<T> triangle0(mVertices[tri0[0]], mVertices[tri0[1]], mVertices[tri0[2]]);
+                        for (size_t i1 = node1.minIndex; i1 <= node1.maxIndex; ++i1)
+                        {
+                            size_t t1 = other.mPartition[i1];
+                            auto const& tri1 = other.mTriangles[t1];
+                            Triangle3<T> triangle1(
+                                transformPoint(other.mVertices[tri1[0]]),
+                                transformPoint(other.mVertices[tri1[1]]),
+                                transformPoint(other.mVertices[tri1[2]]));
+                            if (triangleQuery(triangle0, triangle1).intersect)
+                            {
+                                overlaps.push_back({ t0, t1 });
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        // The other tree is in the coordinate system of this tree.
+        void Execute(OBBTreeOfTriangles const& other,
+            std::vector<std::array<size_t, 2>>& overlaps) const
+        {
+            Vector3<T> const vzero = Vector3<T>::Zero();
+            std::array<Vector3<T>, 3> const identity =
+            {
+                Vector3<T>::Unit(0), Vector3<T>::Unit(1), Vector3<T>::Unit(2)
+            };
+            Execute(other, identity, vzero, overlaps);
+        }
+
     private:
         using BoxQuery = bool (*)(
             Vector3<T> const&, Vector3<T> const&, OrientedBox3<T> const&);
@@ -339,6 +468,14 @@ namespace gte
             return triResult;
         }
 
+        // The sum of the extents, which orders the boxes by size for the
+        // traversal of Execute. The product is not used because the boxes
+        // of planar sets of triangles have a zero extent.
+        static T Size(OrientedBox3<T> const& box)
+        {
+            return box.extent[0] + box.extent[1] + box.extent[2];
+        }
+
         std::array<BoxQuery, 3> mBoxQueries;
         std::array<TriangleQuery, 3> mTriangleQueries;
     };
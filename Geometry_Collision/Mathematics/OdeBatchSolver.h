@@ -0,0 +1,229 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Advance numSystems independent differential equations dx/dt = F(t,x) of
+// the same dimension with a common time step. The states are stored
+// component-major: component c of system s is x[c * numSystems + s], so
+// each component of all systems is contiguous. The derivative is a functor
+// of the template type Derivative, called without type erasure as
+//
+//   void operator()(Real t, size_t smin, size_t smax, size_t numSystems,
+//       Real const* x, Real* dxdt) const;
+//
+// It must store F(t,x_s) for the systems smin <= s < smax, component c in
+// dxdt[c * numSystems + s], and must read x only at those systems. A loop
+// over s in the inner position reads and writes contiguous memory and can
+// be vectorized by the compiler. The index s also allows per-system
+// parameters. The systems are processed in blocks of blockSize, and all
+// stages of the method are computed for a block before the next block, so
+// the stages read the states from the cache.
+//
+// To run in the main thread only, choose numThreads to be 0. For
+// multithreading, choose numThreads > 0. The systems are then partitioned
+// into contiguous ranges that are advanced by tasks of
+// TaskScheduler::GetDefault(), and the functor is called concurrently for
+// disjoint ranges of systems, so it must be thread-safe. The methods are
+// those of OdeEuler, OdeMidpoint and OdeRungeKutta4. OdeImplicitEuler
+// requires the Jacobian of F and a linear solve per system, so it has no
+// batched version.
+
+namespace gte
+{
+    template <typename Real, typename Derivative>
+    class OdeBatchSolver
+    {
+    public:
+        enum class Method
+        {
+            EULER,
+            MIDPOINT,
+            RUNGE_KUTTA_4
+        };
+
+        OdeBatchSolver(size_t numSystems, size_t dimension, Real tDelta,
+            Derivative const& F, Method method = Method::RUNGE_KUTTA_4,
+            size_t numThreads = 0)
+            :
+            mNumSystems(numSystems),
+            mDimension(dimension),
+            mTDelta(tDelta),
+            mDerivative(F),
+            mMethod(method),
+            mNumTasks(std::max(std::min(numThreads, numSystems / minPerTask),
+                static_cast<size_t>(1))),
+            mXTemp(numSystems * dimension),
+            mF1(numSystems * dimension),
+            mF2(method != Method::EULER ? numSystems * dimension : 0),
+            mF3(method == Method::RUNGE_KUTTA_4 ? numSystems * dimension : 0),
+            mF4(method == Method::RUNGE_KUTTA_4 ? numSystems * dimension : 0)
+        {
+            LogAssert(numSystems > 0 && dimension > 0, "Invalid dimensions.");
+        }
+
+        // Member access.
+        inline void SetTDelta(Real tDelta)
+        {
+            mTDelta = tDelta;
+        }
+
+        inline Real GetTDelta() const
+        {
+            return mTDelta;
+        }
+
+        inline size_t GetNumSystems() const
+        {
+            return mNumSystems;
+        }
+
+        inline size_t GetDimension() const
+        {
+            return mDimension;
+        }
+
+        inline Method GetMethod() const
+        {
+            return mMethod;
+        }
+
+        inline Derivative& GetDerivative()
+        {
+            return mDerivative;
+        }
+
+        // Estimate x(t + tDelta) from x(t) for all systems. The arrays have
+        // numSystems * dimension elements in the layout described above.
+        // You may allow xIn and xOut to be the same array.
+        void Update(Real tIn, Real const* xIn, Real& tOut, Real* xOut)
+        {
+            auto advanceRange = [this, tIn, xIn, xOut](size_t k)
+            {
+                size_t const smin = k * mNumSystems / mNumTasks;
+                size_t const smax = (k + 1) * mNumSystems / mNumTasks;
+                for (size_t s0 = smin; s0 < smax; s0 += blockSize)
+                {
+                    size_t const s1 = std::min(s0 + blockSize, smax);
+                    switch (mMethod)
+                    {
+                    case Method::EULER:
+                        UpdateEuler(tIn, xIn, xOut, s0, s1);
+                        break;
+                    case Method::MIDPOINT:
+                        UpdateMidpoint(tIn, xIn, xOut, s0, s1);
+                        break;
+                    default:
+                        UpdateRungeKutta4(tIn, xIn, xOut, s0, s1);
+                        break;
+                    }
+                }
+            };
+
+            if (mNumTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(mNumTasks, advanceRange);
+            }
+            else
+            {
+                advanceRange(0);
+            }
+            tOut = tIn + mTDelta;
+        }
+
+        void Update(Real tIn, std::vector<Real> const& xIn, Real& tOut, std::vector<Real>& xOut)
+        {
+            LogAssert(xIn.size() == mNumSystems * mDimension, "Invalid input size.");
+            xOut.resize(xIn.size());
+            Update(tIn, xIn.data(), tOut, xOut.data());
+        }
+
+    private:
+        // xOut[i] = xIn[i] + scale * f[i] for the systems [s0,s1).
+        void Combine(Real const* xIn, Real scale, Real const* f, Real* xOut,
+            size_t s0, size_t s1) const
+        {
+            for (size_t c = 0, base = 0; c < mDimension; ++c, base += mNumSystems)
+            {
+                for (size_t i = base + s0; i < base + s1; ++i)
+                {
+                    xOut[i] = xIn[i] + scale * f[i];
+                }
+            }
+        }
+
+        void UpdateEuler(Real tIn, Real const* xIn, Real* xOut, size_t s0, size_t s1)
+        {
+            Real* f1 = mF1.data();
+            mDerivative(tIn, s0, s1, mNumSystems, xIn, f1);
+            Combine(xIn, mTDelta, f1, xOut, s0, s1);
+        }
+
+        void UpdateMidpoint(Real tIn, Real const* xIn, Real* xOut, size_t s0, size_t s1)
+        {
+            Real* xTemp = mXTemp.data();
+            Real* f1 = mF1.data();
+            Real* f2 = mF2.data();
+            Real const halfTDelta = static_cast<Real>(0.5) * mTDelta;
+            mDerivative(tIn, s0, s1, mNumSystems, xIn, f1);
+            Combine(xIn, halfTDelta, f1, xTemp, s0, s1);
+            mDerivative(tIn + halfTDelta, s0, s1, mNumSystems, xTemp, f2);
+            Combine(xIn, mTDelta, f2, xOut, s0, s1);
+        }
+
+        void UpdateRungeKutta4(Real tIn, Real const* xIn, Real* xOut, size_t s0, size_t s1)
+        {
+            Real* xTemp = mXTemp.data();
+            Real* f1 = mF1.data();
+            Real* f2 = mF2.data();
+            Real* f3 = mF3.data();
+            Real* f4 = mF4.data();
+            Real const halfTDelta = static_cast<Real>(0.5) * mTDelta;
+            Real const halfT = tIn + halfTDelta;
+
+            mDerivative(tIn, s0, s1, mNumSystems, xIn, f1);
+            Combine(xIn, halfTDelta, f1, xTemp, s0, s1);
+            mDerivative(halfT, s0, s1, mNumSystems, xTemp, f2);
+            Combine(xIn, halfTDelta, f2, xTemp, s0, s1);
+            mDerivative(halfT, s0, s1, mNumSystems, xTemp, f3);
+            Combine(xIn, mTDelta, f3, xTemp, s0, s1);
+            mDerivative(tIn + mTDelta, s0, s1, mNumSystems, xTemp, f4);
+
+            Real const sixthTDelta = mTDelta / static_cast<Real>(6);
+            Real const two = static_cast<Real>(2);
+            for (size_t c = 0, base = 0; c < mDimension; ++c, base += mNumSystems)
+            {
+                for (size_t i = base + s0; i < base + s1; ++i)
+                {
+                    xOut[i] = xIn[i] + sixthTDelta * (f1[i] + two * (f2[i] + f3[i]) + f4[i]);
+                }
+            }
+        }
+
+        // The number of systems passed to one call of the functor and the
+        // minimum number of systems of a task.
+        static size_t constexpr blockSize = 256;
+        static size_t constexpr minPerTask = 1024;
+
+        size_t mNumSystems, mDimension;
+        Real mTDelta;
+        Derivative mDerivative;
+        Method mMethod;
+        size_t mNumTasks;
+
+        // The intermediate states and derivatives. The tasks and blocks
+        // write disjoint systems of the arrays.
+        std::vector<Real> mXTemp, mF1, mF2, mF3, mF4;
+    };
+}
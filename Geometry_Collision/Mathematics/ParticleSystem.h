@@ -8,6 +8,12 @@
 #pragma once
 
 #include <Mathematics/Vector.h>
+#include <Mathematics/LinearSystem.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <limits>
 #include <vector>
 
 namespace gte
@@ -33,7 +39,14 @@ namespace gte
             mPTmp(numParticles),
             mVTmp(numParticles),
             mPAllTmp(numParticles),
-            mVAllTmp(numParticles)
+            mVAllTmp(numParticles),
+            mATmp{},
+            mSprings{},
+            mTriplets{},
+            mImplicitMatrix{},
+            mImplicitB{},
+            mImplicitV{},
+            mImplicitDeltaV{}
         {
             std::fill(mMass.begin(), mMass.end(), (Real)0);
             std::fill(mInvMass.begin(), mInvMass.end(), (Real)0);
@@ -200,7 +213,244 @@ namespace gte
             }
         }
 
+        // The same Runge-Kutta solver as Update(...), but each stage first
+        // computes the accelerations of all particles by calls to
+        // Accelerations(...) and then advances the particles. To run in the
+        // main thread only, choose numThreads to be 0. For multithreading,
+        // choose numThreads > 0. The particles are then partitioned into
+        // numThreads ranges of consecutive indices, each a multiple of
+        // GetBlockSize() particles, that are processed as tasks of
+        // TaskScheduler::GetDefault(). Acceleration(...) must then be safe
+        // to call concurrently for different particles. The results are
+        // the same as those of Update(...) unless a derived class overrides
+        // Accelerations(...) with a different order of operations.
+        void UpdateParallel(Real time, size_t numThreads)
+        {
+            Real halfTime = time + mHalfStep;
+            Real fullTime = time + mStep;
+            mATmp.resize(static_cast<size_t>(mNumParticles));
+
+            ForEachRange(numThreads, [this, time](int32_t i0, int32_t i1)
+            {
+                Accelerations(i0, i1, time, mPosition, mVelocity, mATmp);
+            });
+            ForEachRange(numThreads, [this](int32_t i0, int32_t i1)
+            {
+                Advance(i0, i1, mVelocity, &Temporary::d1, mHalfStep);
+            });
+
+            ForEachRange(numThreads, [this, halfTime](int32_t i0, int32_t i1)
+            {
+                Accelerations(i0, i1, halfTime, mPTmp, mVTmp, mATmp);
+            });
+            ForEachRange(numThreads, [this](int32_t i0, int32_t i1)
+            {
+                Advance(i0, i1, mVTmp, &Temporary::d2, mHalfStep);
+            });
+
+            ForEachRange(numThreads, [this, halfTime](int32_t i0, int32_t i1)
+            {
+                Accelerations(i0, i1, halfTime, mPTmp, mVTmp, mATmp);
+            });
+            ForEachRange(numThreads, [this](int32_t i0, int32_t i1)
+            {
+                Advance(i0, i1, mVTmp, &Temporary::d3, mStep);
+            });
+
+            ForEachRange(numThreads, [this, fullTime](int32_t i0, int32_t i1)
+            {
+                Accelerations(i0, i1, fullTime, mPTmp, mVTmp, mATmp);
+            });
+            ForEachRange(numThreads, [this](int32_t i0, int32_t i1)
+            {
+                for (int32_t i = i0; i < i1; ++i)
+                {
+                    if (mInvMass[i] > (Real)0)
+                    {
+                        mPAllTmp[i].d4 = mVTmp[i];
+                        mVAllTmp[i].d4 = mATmp[i];
+
+                        mPosition[i] += mSixthStep * (mPAllTmp[i].d1 +
+                            (Real)2 * (mPAllTmp[i].d2 + mPAllTmp[i].d3) + mPAllTmp[i].d4);
+
+                        mVelocity[i] += mSixthStep * (mVAllTmp[i].d1 +
+                            (Real)2 * (mVAllTmp[i].d2 + mVAllTmp[i].d3) + mVAllTmp[i].d4);
+                    }
+                }
+            });
+        }
+
+        // A linearized backward Euler step for stiff springs, which is
+        // stable for much larger steps than Update(...). The new velocities
+        // are V' = V + dV, where dV is the solution of
+        //   (M - h^2 * K) * dV = h * (F + h * K * V)
+        // for the masses M, the step h, the forces F = M * Acceleration(...)
+        // and the Jacobian K of the spring forces with respect to the
+        // positions, and then the new positions are X' = X + h * V'. K is
+        // assembled from the springs reported by GetSprings(...), and the
+        // forces other than those of the springs are integrated explicitly.
+        // The part of K for compressed springs that is not negative
+        // semidefinite is dropped, so M - h^2 * K is symmetric positive
+        // definite and the system is solved by LinearSystem::
+        // SolveSymmetricCG with the Jacobi preconditioner, starting from
+        // the dV of the previous call. The accelerations are computed as
+        // in UpdateParallel(...), and numThreads is also passed to the
+        // solver. The return value is the number of iterations, which is
+        // maxIterations + 1 when the tolerance is not reached.
+        uint32_t UpdateImplicit(Real time, uint32_t maxIterations, Real tolerance,
+            size_t numThreads = 0)
+        {
+            size_t const numParticles = static_cast<size_t>(mNumParticles);
+            int32_t const numRows = N * mNumParticles;
+            mATmp.resize(numParticles);
+            mImplicitB.resize(static_cast<size_t>(numRows));
+            mImplicitV.resize(static_cast<size_t>(numRows));
+            mImplicitDeltaV.resize(static_cast<size_t>(numRows), (Real)0);
+
+            ForEachRange(numThreads, [this, time](int32_t i0, int32_t i1)
+            {
+                Accelerations(i0, i1, time, mPosition, mVelocity, mATmp);
+            });
+
+            // Assemble A = M - h^2 * K. The rows of an immovable particle
+            // are those of the identity, and its couplings to the other
+            // particles are dropped, so its dV is zero.
+            mTriplets.clear();
+            for (int32_t i = 0; i < mNumParticles; ++i)
+            {
+                Real diagonal = (mInvMass[i] > (Real)0 ? mMass[i] : (Real)1);
+                for (int32_t d = 0; d < N; ++d)
+                {
+                    mTriplets.push_back({ N * i + d, N * i + d, diagonal });
+                }
+            }
+
+            GetSprings(mSprings);
+            Real const stepSqr = mStep * mStep;
+            std::array<std::array<Real, N>, N> block{};
+            for (auto const& spring : mSprings)
+            {
+                int32_t const i0 = spring.particle0, i1 = spring.particle1;
+                bool const movable0 = (mInvMass[i0] > (Real)0);
+                bool const movable1 = (mInvMass[i1] > (Real)0);
+                Vector<N, Real> diff = mPosition[i1] - mPosition[i0];
+                Real length = Length(diff);
+                if ((!movable0 && !movable1) || length == (Real)0)
+                {
+                    continue;
+                }
+
+                // The Jacobian of the force on particle i0 with respect to
+                // the position of particle i1 is
+                //   k * ((1 - L/|D|) * I + (L/|D|) * U * U^T)
+                // for D = X[i1] - X[i0] and U = D/|D|.
+                Real ratio = spring.length / length;
+                Real identityWeight = stepSqr * spring.constant * std::max((Real)1 - ratio, (Real)0);
+                Real outerWeight = stepSqr * spring.constant * ratio;
+                diff /= length;
+                for (int32_t r = 0; r < N; ++r)
+                {
+                    for (int32_t c = 0; c < N; ++c)
+                    {
+                        block[r][c] = outerWeight * diff[r] * diff[c];
+                    }
+                    block[r][r] += identityWeight;
+                }
+
+                for (int32_t r = 0; r < N; ++r)
+                {
+                    for (int32_t c = 0; c < N; ++c)
+                    {
+                        Real const value = block[r][c];
+                        if (movable0)
+                        {
+                            mTriplets.push_back({ N * i0 + r, N * i0 + c, value });
+                        }
+                        if (movable1)
+                        {
+                            mTriplets.push_back({ N * i1 + r, N * i1 + c, value });
+                        }
+                        if (movable0 && movable1)
+                        {
+                            mTriplets.push_back({ N * i0 + r, N * i1 + c, -value });
+                            mTriplets.push_back({ N * i1 + r, N * i0 + c, -value });
+                        }
+                    }
+                }
+            }
+            mImplicitMatrix.Create(numRows, numRows, mTriplets);
+
+            // B = h * F + h^2 * K * V = h * F + (M - A) * V.
+            Real* B = mImplicitB.data();
+            Real* V = mImplicitV.data();
+            Real* deltaV = mImplicitDeltaV.data();
+            ForEachRange(numThreads, [this, V](int32_t i0, int32_t i1)
+            {
+                for (int32_t i = i0; i < i1; ++i)
+                {
+                    for (int32_t d = 0; d < N; ++d)
+                    {
+                        V[N * i + d] = mVelocity[i][d];
+                    }
+                }
+            });
+            mImplicitMatrix.Multiply(V, B, numThreads);
+            ForEachRange(numThreads, [this, B](int32_t i0, int32_t i1)
+            {
+                for (int32_t i = i0; i < i1; ++i)
+                {
+                    for (int32_t d = 0; d < N; ++d)
+                    {
+                        Real& b = B[N * i + d];
+                        if (mInvMass[i] > (Real)0)
+                        {
+                            b = mMass[i] * (mStep * mATmp[i][d] + mVelocity[i][d]) - b;
+                        }
+                        else
+                        {
+                            b = (Real)0;
+                        }
+                    }
+                }
+            });
+
+            uint32_t iterations = LinearSystem<Real>::SolveSymmetricCG(mImplicitMatrix,
+                B, deltaV, maxIterations, tolerance,
+                LinearSystem<Real>::Preconditioner::JACOBI, true, numThreads);
+
+            ForEachRange(numThreads, [this, deltaV](int32_t i0, int32_t i1)
+            {
+                for (int32_t i = i0; i < i1; ++i)
+                {
+                    if (mInvMass[i] > (Real)0)
+                    {
+                        for (int32_t d = 0; d < N; ++d)
+                        {
+                            mVelocity[i][d] += deltaV[N * i + d];
+                        }
+                        mPosition[i] += mStep * mVelocity[i];
+                    }
+                }
+            });
+            return iterations;
+        }
+
     protected:
+        // A spring between two particles with spring constant and rest
+        // length, as reported by GetSprings(...).
+        struct SpringElement
+        {
+            int32_t particle0, particle1;
+            Real constant, length;
+        };
+
+        // Callback of UpdateImplicit(...) that replaces the springs by those
+        // of the system. The default is a system without springs.
+        virtual void GetSprings(std::vector<SpringElement>& springs) const
+        {
+            springs.clear();
+        }
+
         // Callback for acceleration (ODE solver uses x" = F/m) applied to
         // particle i.  The positions and velocities are not necessarily
         // mPosition and mVelocity, because the ODE solver evaluates the
@@ -209,6 +459,73 @@ namespace gte
             std::vector<Vector<N, Real>> const& position,
             std::vector<Vector<N, Real>> const& velocity) = 0;
 
+        // Callback of UpdateParallel(...) that stores in acceleration[i] the
+        // acceleration of each movable particle i with i0 <= i < i1. The
+        // default calls Acceleration(...) for each particle. A derived class
+        // can override it to share work among the particles of the range,
+        // but it must not write the accelerations of other particles.
+        virtual void Accelerations(int32_t i0, int32_t i1, Real time,
+            std::vector<Vector<N, Real>> const& position,
+            std::vector<Vector<N, Real>> const& velocity,
+            std::vector<Vector<N, Real>>& acceleration)
+        {
+            for (int32_t i = i0; i < i1; ++i)
+            {
+                if (mInvMass[i] > (Real)0)
+                {
+                    acceleration[i] = Acceleration(i, time, position, velocity);
+                }
+            }
+        }
+
+        // The ranges of particles passed to Accelerations(...) start and end
+        // at multiples of the block size, except that the last range ends at
+        // the number of particles.
+        virtual int32_t GetBlockSize() const
+        {
+            return 1;
+        }
+
+        template <typename Function>
+        void ForEachRange(size_t numThreads, Function const& function)
+        {
+            int32_t const blockSize = std::max(GetBlockSize(), 1);
+            size_t const numBlocks = static_cast<size_t>((mNumParticles + blockSize - 1) / blockSize);
+            size_t const numRanges = std::min(numThreads, numBlocks);
+            if (numRanges <= 1)
+            {
+                function(0, mNumParticles);
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numRanges, [this, &function,
+                blockSize, numBlocks, numRanges](size_t k)
+            {
+                int32_t const i0 = blockSize * static_cast<int32_t>(k * numBlocks / numRanges);
+                int32_t const i1 = std::min(mNumParticles,
+                    blockSize * static_cast<int32_t>((k + 1) * numBlocks / numRanges));
+                function(i0, i1);
+            });
+        }
+
+        // Compute the forces of springs j = 0 through numSprings-1, where
+        // spring j connects the particles at positions p0[j] and p1[j] and
+        // has the given constant and rest length. The force on the particle
+        // at p0[j] is force[j] and the force on the particle at p1[j] is
+        // -force[j]. The springs are independent, so the loop can be
+        // vectorized by the compiler.
+        static void SpringForces(int32_t numSprings, Vector<N, Real> const* p0,
+            Vector<N, Real> const* p1, Real const* constant, Real const* length,
+            Vector<N, Real>* force)
+        {
+            for (int32_t j = 0; j < numSprings; ++j)
+            {
+                Vector<N, Real> diff = p1[j] - p0[j];
+                Real ratio = length[j] / Length(diff);
+                force[j] = constant[j] * ((Real)1 - ratio) * diff;
+            }
+        }
+
         int32_t mNumParticles;
         std::vector<Real> mMass, mInvMass;
         std::vector<Vector<N, Real>> mPosition, mVelocity;
@@ -220,7 +537,40 @@ namespace gte
             Vector<N, Real> d1, d2, d3, d4;
         };
 
+        // Store the derivatives of a stage of UpdateParallel(...), whose
+        // velocities are in velocity and whose accelerations are in mATmp,
+        // and compute the state at which the next stage is evaluated.
+        void Advance(int32_t i0, int32_t i1, std::vector<Vector<N, Real>> const& velocity,
+            Vector<N, Real> Temporary::* d, Real step)
+        {
+            for (int32_t i = i0; i < i1; ++i)
+            {
+                if (mInvMass[i] > (Real)0)
+                {
+                    (mPAllTmp[i].*d) = velocity[i];
+                    (mVAllTmp[i].*d) = mATmp[i];
+                    mPTmp[i] = mPosition[i] + step * (mPAllTmp[i].*d);
+                    mVTmp[i] = mVelocity[i] + step * (mVAllTmp[i].*d);
+                }
+                else
+                {
+                    mPTmp[i] = mPosition[i];
+                    mVTmp[i].MakeZero();
+                }
+            }
+        }
+
         std::vector<Vector<N, Real>> mPTmp, mVTmp;
         std::vector<Temporary> mPAllTmp, mVAllTmp;
+
+        // The accelerations of a stage of UpdateParallel(...).
+        std::vector<Vector<N, Real>> mATmp;
+
+        // Storage for UpdateImplicit(...). The arrays keep their capacity,
+        // and mImplicitDeltaV is the initial guess of the next solve.
+        std::vector<SpringElement> mSprings;
+        std::vector<typename CSRMatrix<Real>::Triplet> mTriplets;
+        CSRMatrix<Real> mImplicitMatrix;
+        std::vector<Real> mImplicitB, mImplicitV, mImplicitDeltaV;
     };
 }
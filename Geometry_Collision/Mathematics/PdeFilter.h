@@ -55,6 +55,13 @@ namespace gte
             return mScaleType;
         }
 
+        // Map a value of the filtered image, which is in the range of the
+        // scaled input data, back to the range of the input data.
+        inline Real Unscale(Real value) const
+        {
+            return mMin + (value - mOffset) / mScale;
+        }
+
         // Access to the time step for the PDE solver.
         inline void SetTimeStep(Real timeStep)
         {
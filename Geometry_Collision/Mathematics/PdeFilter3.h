@@ -9,11 +9,19 @@
 
 #include <Mathematics/PdeFilter.h>
 #include <Mathematics/Array3.h>
+#include <Mathematics/Image3.h>
+#include <Mathematics/SparseImage3.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 #include <array>
 #include <limits>
+#include <memory>
+#include <vector>
 
 namespace gte
 {
+    template <typename PixelType> class TiledImage3;
+
     template <typename Real>
     class PdeFilter3 : public PdeFilter<Real>
     {
@@ -54,7 +62,9 @@ namespace gte
             mSrc(0),
             mDst(1),
             mMask(static_cast<size_t>(xBound) + 2, static_cast<size_t>(yBound) + 2, static_cast<size_t>(zBound) + 2),
-            mHasMask(mask != nullptr)
+            mHasMask(mask != nullptr),
+            mActiveBricks{},
+            mNumThreads(0)
         {
             for (int32_t i = 0; i < 2; ++i)
             {
@@ -105,6 +115,25 @@ namespace gte
         {
         }
 
+        // To update in the main thread only, choose numThreads to be 0. For
+        // multithreading, choose numThreads > 0. The image is then
+        // partitioned into numThreads slabs of z-values, or the active
+        // bricks into numThreads groups, that are updated by tasks of
+        // TaskScheduler::GetDefault(). The rows are updated concurrently, so
+        // OnUpdateRow must not write members of the filter. The filters of
+        // the library satisfy this, but a derived class that relies on the
+        // default OnUpdateRow and the LookUp7 or LookUp27 members must use
+        // numThreads = 0.
+        inline void SetNumThreads(size_t numThreads)
+        {
+            mNumThreads = numThreads;
+        }
+
+        inline size_t GetNumThreads() const
+        {
+            return mNumThreads;
+        }
+
         // Member access.  The internal 2D images for "data" and "mask" are
         // copies of the inputs to the constructor but padded with a 1-voxel
         // thick border to support filtering on the image boundary.  These
@@ -222,6 +251,39 @@ namespace gte
             return mMask[zp1][yp1][xp1];
         }
 
+        // Restrict the updates to the voxels of the active bricks of a
+        // sparse image with the dimensions of the filter, for example the
+        // narrow band of a level set. The other voxels keep their values.
+        // The voxels of the bricks are still subject to the mask. Pass an
+        // image without active bricks to update all the voxels again.
+        template <typename PixelType>
+        void SetActiveRegion(SparseImage3<PixelType> const& image)
+        {
+            LogAssert(image.GetDimension(0) == mXBound
+                && image.GetDimension(1) == mYBound
+                && image.GetDimension(2) == mZBound,
+                "The image dimensions must match those of the filter.");
+
+            mActiveBricks.clear();
+            std::array<int32_t, 3> brick{}, extent{};
+            for (auto b : image.GetActiveBricks())
+            {
+                image.GetBrickCoordinates(b, brick);
+                image.GetBrickExtent(brick, extent);
+                std::array<int32_t, 6> box{};
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    box[2 * d] = (brick[d] << SparseImage3<PixelType>::brickLog2) + 1;
+                    box[2 * d + 1] = box[2 * d] + extent[d];
+                }
+                mActiveBricks.push_back(box);
+            }
+
+            // The voxels outside the bricks are not written, so they must
+            // have the same values in both buffers.
+            mBuffer[mDst] = mBuffer[mSrc];
+        }
+
     protected:
         // Assign values to the 1-voxel image border.
         void AssignDirichletImageBorder()
@@ -828,22 +890,49 @@ namespace gte
             // conditions are in use.  Nothing to do.
         }
 
-        // Iterate over all the pixels and call OnUpdate(x,y,z) for each voxel
-        // that is not masked out.
+        // Iterate over all the pixels, or those of the active region when one
+        // is set, and call OnUpdateRow for each run of consecutive voxels in
+        // a row that are not masked out.
         virtual void OnUpdate() override
         {
-            for (int32_t z = 1; z <= mZBound; ++z)
+            size_t numTasks = 1;
+            if (mActiveBricks.size() > 0)
             {
-                for (int32_t y = 1; y <= mYBound; ++y)
+                size_t const numBricks = mActiveBricks.size();
+                if (mNumThreads > 0)
                 {
-                    for (int32_t x = 1; x <= mXBound; ++x)
+                    numTasks = std::min(mNumThreads, numBricks);
+                }
+
+                RunTasks(numTasks, [this, numBricks, numTasks](size_t k)
+                {
+                    size_t const imin = k * numBricks / numTasks;
+                    size_t const isup = (k + 1) * numBricks / numTasks;
+                    for (size_t i = imin; i < isup; ++i)
                     {
-                        if (!mHasMask || mMask[z][y][x])
-                        {
-                            OnUpdateSingle(x, y, z);
-                        }
+                        UpdateBox(mActiveBricks[i]);
                     }
+                });
+            }
+            else
+            {
+                size_t const numSlices = static_cast<size_t>(mZBound);
+                if (mNumThreads > 0)
+                {
+                    numTasks = std::min(mNumThreads, numSlices);
                 }
+
+                RunTasks(numTasks, [this, numSlices, numTasks](size_t k)
+                {
+                    std::array<int32_t, 6> const box =
+                    {
+                        1, mXBound + 1,
+                        1, mYBound + 1,
+                        1 + static_cast<int32_t>(k * numSlices / numTasks),
+                        1 + static_cast<int32_t>((k + 1) * numSlices / numTasks)
+                    };
+                    UpdateBox(box);
+                });
             }
         }
 
@@ -860,6 +949,72 @@ namespace gte
         // and 1 <= z <= zbound.
         virtual void OnUpdateSingle(int32_t x, int32_t y, int32_t z) = 0;
 
+        // Update the voxels (x,y,z) with xmin <= x < xsup, in padded
+        // coordinates. The default calls OnUpdateSingle for each voxel. A
+        // filter overrides this with a loop over the row that reads the
+        // source buffer through row pointers, which avoids a virtual call
+        // per voxel and lets the compiler vectorize the loop.
+        virtual void OnUpdateRow(int32_t xmin, int32_t xsup, int32_t y, int32_t z)
+        {
+            for (int32_t x = xmin; x < xsup; ++x)
+            {
+                OnUpdateSingle(x, y, z);
+            }
+        }
+
+        // Update the voxels of [xmin,xsup) x [ymin,ysup) x [zmin,zsup) that
+        // are not masked out, where box = (xmin,xsup,ymin,ysup,zmin,zsup).
+        void UpdateBox(std::array<int32_t, 6> const& box)
+        {
+            for (int32_t z = box[4]; z < box[5]; ++z)
+            {
+                for (int32_t y = box[2]; y < box[3]; ++y)
+                {
+                    if (!mHasMask)
+                    {
+                        OnUpdateRow(box[0], box[1], y, z);
+                        continue;
+                    }
+
+                    int32_t const* mask = mMask[z][y];
+                    for (int32_t x = box[0]; x < box[1]; )
+                    {
+                        while (x < box[1] && !mask[x])
+                        {
+                            ++x;
+                        }
+
+                        int32_t const xmin = x;
+                        while (x < box[1] && mask[x])
+                        {
+                            ++x;
+                        }
+
+                        if (xmin < x)
+                        {
+                            OnUpdateRow(xmin, x, y, z);
+                        }
+                    }
+                }
+            }
+        }
+
+        template <typename Function>
+        void RunTasks(size_t numTasks, Function const& function)
+        {
+            if (mNumThreads > 0 && numTasks > 1)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, function);
+            }
+            else
+            {
+                for (size_t k = 0; k < numTasks; ++k)
+                {
+                    function(k);
+                }
+            }
+        }
+
         // Copy source data to temporary storage.
         void LookUp7(int32_t x, int32_t y, int32_t z)
         {
@@ -947,5 +1102,76 @@ namespace gte
         int32_t mSrc, mDst;
         Array3<int32_t> mMask;
         bool mHasMask;
+
+        // The padded-coordinate ranges [xmin,xsup) x [ymin,ysup) x
+        // [zmin,zsup) of the active bricks set by SetActiveRegion, stored as
+        // (xmin,xsup,ymin,ysup,zmin,zsup).
+        std::vector<std::array<int32_t, 6>> mActiveBricks;
+
+        // The number of tasks for OnUpdate, where 0 means the main thread.
+        size_t mNumThreads;
     };
+
+    // Filter an out-of-core image a block at a time, which requires including
+    // TiledImage3.h. A block of at most blockSize^3 voxels is copied with a
+    // halo of numIterations voxels clipped to the image, and the filter
+    //   std::unique_ptr<PdeFilter3<Real>> createFilter(
+    //       int32_t xBound, int32_t yBound, int32_t zBound, Real const* data)
+    // of the copy is updated numIterations times. An update reads the
+    // 3x3x3 neighborhoods of the voxels, so the voxels of the block do not
+    // depend on the border of the copy. The output is that of filtering the
+    // whole image, up to rounding errors, when the filter uses
+    // ScaleType::NONE and Neumann boundary conditions and depends only on
+    // differences of the values, as the filters of the library do. The data
+    // of each block is offset by its own minimum, which is why a Dirichlet
+    // border value does not carry over, and the other scale types also
+    // scale each block by its own range. The filtered values are mapped back to the range of the input
+    // by PdeFilter::Unscale. The input and output must be different images
+    // with the same dimensions.
+    template <typename Real, typename CreateFilter>
+    void FilterTiledImage3(TiledImage3<Real> const& input, TiledImage3<Real>& output,
+        int32_t blockSize, int32_t numIterations, CreateFilter const& createFilter)
+    {
+        LogAssert(static_cast<void const*>(&input) != static_cast<void const*>(&output)
+            && input.GetDimensions() == output.GetDimensions(),
+            "The input and output must be different images of the same size.");
+        LogAssert(numIterations >= 0, "Invalid number of iterations.");
+
+        Image3<Real> source, target;
+        std::array<int32_t, 3> rmin{}, rmax{}, smin{}, smax{};
+        input.ForEachBlock(blockSize,
+            [&](std::array<int32_t, 3> const& bmin, std::array<int32_t, 3> const& bmax)
+            {
+                input.GetHaloRegion(bmin, bmax, numIterations, rmin, rmax);
+                input.GetRegion(rmin, rmax, source);
+                int32_t const xBound = source.GetDimension(0);
+                int32_t const yBound = source.GetDimension(1);
+                int32_t const zBound = source.GetDimension(2);
+                std::unique_ptr<PdeFilter3<Real>> filter =
+                    createFilter(xBound, yBound, zBound, source.GetPixels().data());
+                for (int32_t i = 0; i < numIterations; ++i)
+                {
+                    filter->Update();
+                }
+
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    smin[d] = bmin[d] - rmin[d];
+                    smax[d] = bmax[d] - rmin[d];
+                }
+
+                target.Reconstruct(xBound, yBound, zBound);
+                for (int32_t z = smin[2]; z < smax[2]; ++z)
+                {
+                    for (int32_t y = smin[1]; y < smax[1]; ++y)
+                    {
+                        for (int32_t x = smin[0]; x < smax[0]; ++x)
+                        {
+                            target(x, y, z) = filter->Unscale(filter->GetU(x, y, z));
+                        }
+                    }
+                }
+                output.SetRegion(bmin, target, smin, smax);
+            });
+    }
 }
@@ -8,6 +8,10 @@
 #pragma once
 
 #include <Mathematics/Matrix3x3.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <vector>
 
 namespace gte
 {
@@ -21,122 +25,309 @@ namespace gte
     // The code assumes the rigid body has a constant density of 1.  If your
     // application assigns a constant density of 'd', then you must multiply
     // the output 'mass' by 'd' and the output 'inertia' by 'd'.
+    //
+    // The mass properties are computed from the integrals of 1, x, y, z,
+    // x^2, y^2, z^2, xy, yz and zx over the polyhedron, each a sum of terms
+    // of the boundary triangles. PolyhedralMassIntegrals stores the sums, so
+    // triangles can be added and removed, for example when a polyhedron is
+    // sliced: remove the triangles that are split, then add their pieces and
+    // the triangles of the cut face. A removal subtracts the terms that the
+    // addition added, so the sums have the rounding errors of both.
 
     template <typename Real>
-    void ComputeMassProperties(Vector3<Real> const* vertices, int32_t numTriangles,
-        int32_t const* indices, bool bodyCoords, Real& mass, Vector3<Real>& center,
-        Matrix3x3<Real>& inertia)
+    class PolyhedralMassIntegrals
     {
-        Real const oneDiv6 = (Real)1 / (Real)6;
-        Real const oneDiv24 = (Real)1 / (Real)24;
-        Real const oneDiv60 = (Real)1 / (Real)60;
-        Real const oneDiv120 = (Real)1 / (Real)120;
+    public:
+        PolyhedralMassIntegrals()
+        {
+            Reset();
+        }
 
-        // order:  1, x, y, z, x^2, y^2, z^2, xy, yz, zx
-        std::array<Real, 10> integral;
-        integral.fill((Real)0);
+        void Reset()
+        {
+            mIntegral.fill((Real)0);
+        }
+
+        void Add(Vector3<Real> const& v0, Vector3<Real> const& v1, Vector3<Real> const& v2)
+        {
+            std::array<Real, 10> term{};
+            ComputeTerms(v0[0], v0[1], v0[2], v1[0], v1[1], v1[2],
+                v2[0], v2[1], v2[2], term);
+            for (size_t k = 0; k < 10; ++k)
+            {
+                mIntegral[k] += term[k];
+            }
+        }
+
+        void Remove(Vector3<Real> const& v0, Vector3<Real> const& v1, Vector3<Real> const& v2)
+        {
+            std::array<Real, 10> term{};
+            ComputeTerms(v0[0], v0[1], v0[2], v1[0], v1[1], v1[2],
+                v2[0], v2[1], v2[2], term);
+            for (size_t k = 0; k < 10; ++k)
+            {
+                mIntegral[k] -= term[k];
+            }
+        }
+
+        // Add the triangles of a mesh. The vertices of blocks of triangles
+        // are copied to separate coordinate arrays and the terms are
+        // accumulated per triangle of a block, which the compiler
+        // vectorizes.
+        void Add(Vector3<Real> const* vertices, size_t numTriangles, int32_t const* indices)
+        {
+            // order: x0, y0, z0, x1, y1, z1, x2, y2, z2
+            std::array<std::array<Real, blockSize>, 9> coordinate{};
+            std::array<std::array<Real, blockSize>, 10> sum{};
+            for (auto& lanes : sum)
+            {
+                lanes.fill((Real)0);
+            }
+
+            for (size_t tmin = 0; tmin < numTriangles; tmin += blockSize)
+            {
+                // The unused lanes of the last block are degenerate
+                // triangles at the origin, whose terms are zero.
+                size_t const count = std::min(blockSize, numTriangles - tmin);
+                int32_t const* index = &indices[3 * tmin];
+                for (size_t j = 0; j < count; ++j)
+                {
+                    for (size_t i = 0; i < 3; ++i)
+                    {
+                        Vector3<Real> const& v = vertices[*index++];
+                        coordinate[3 * i + 0][j] = v[0];
+                        coordinate[3 * i + 1][j] = v[1];
+                        coordinate[3 * i + 2][j] = v[2];
+                    }
+                }
+                for (size_t j = count; j < blockSize; ++j)
+                {
+                    for (size_t k = 0; k < 9; ++k)
+                    {
+                        coordinate[k][j] = (Real)0;
+                    }
+                }
+
+                for (size_t j = 0; j < blockSize; ++j)
+                {
+                    std::array<Real, 10> term{};
+                    ComputeTerms(
+                        coordinate[0][j], coordinate[1][j], coordinate[2][j],
+                        coordinate[3][j], coordinate[4][j], coordinate[5][j],
+                        coordinate[6][j], coordinate[7][j], coordinate[8][j],
+                        term);
+                    for (size_t k = 0; k < 10; ++k)
+                    {
+                        sum[k][j] += term[k];
+                    }
+                }
+            }
+
+            for (size_t k = 0; k < 10; ++k)
+            {
+                for (size_t j = 0; j < blockSize; ++j)
+                {
+                    mIntegral[k] += sum[k][j];
+                }
+            }
+        }
+
+        // The sums of the integrals of the polyhedra are the integrals of
+        // their union.
+        PolyhedralMassIntegrals& operator+=(PolyhedralMassIntegrals const& other)
+        {
+            for (size_t k = 0; k < 10; ++k)
+            {
+                mIntegral[k] += other.mIntegral[k];
+            }
+            return *this;
+        }
 
-        int32_t const* index = indices;
-        for (int32_t i = 0; i < numTriangles; ++i)
+        void GetMassProperties(bool bodyCoords, Real& mass, Vector3<Real>& center,
+            Matrix3x3<Real>& inertia) const
         {
-            // Get vertices of triangle i.
-            Vector3<Real> v0 = vertices[*index++];
-            Vector3<Real> v1 = vertices[*index++];
-            Vector3<Real> v2 = vertices[*index++];
+            Real const oneDiv6 = (Real)1 / (Real)6;
+            Real const oneDiv24 = (Real)1 / (Real)24;
+            Real const oneDiv60 = (Real)1 / (Real)60;
+            Real const oneDiv120 = (Real)1 / (Real)120;
 
+            // order:  1, x, y, z, x^2, y^2, z^2, xy, yz, zx
+            std::array<Real, 10> integral = mIntegral;
+            integral[0] *= oneDiv6;
+            integral[1] *= oneDiv24;
+            integral[2] *= oneDiv24;
+            integral[3] *= oneDiv24;
+            integral[4] *= oneDiv60;
+            integral[5] *= oneDiv60;
+            integral[6] *= oneDiv60;
+            integral[7] *= oneDiv120;
+            integral[8] *= oneDiv120;
+            integral[9] *= oneDiv120;
+
+            // mass
+            mass = integral[0];
+
+            // center of mass
+            center = Vector3<Real>{ integral[1], integral[2], integral[3] } / mass;
+
+            // inertia relative to world origin
+            inertia(0, 0) = integral[5] + integral[6];
+            inertia(0, 1) = -integral[7];
+            inertia(0, 2) = -integral[9];
+            inertia(1, 0) = inertia(0, 1);
+            inertia(1, 1) = integral[4] + integral[6];
+            inertia(1, 2) = -integral[8];
+            inertia(2, 0) = inertia(0, 2);
+            inertia(2, 1) = inertia(1, 2);
+            inertia(2, 2) = integral[4] + integral[5];
+
+            // inertia relative to center of mass
+            if (bodyCoords)
+            {
+                inertia(0, 0) -= mass * (center[1] * center[1] + center[2] * center[2]);
+                inertia(0, 1) += mass * center[0] * center[1];
+                inertia(0, 2) += mass * center[2] * center[0];
+                inertia(1, 0) = inertia(0, 1);
+                inertia(1, 1) -= mass * (center[2] * center[2] + center[0] * center[0]);
+                inertia(1, 2) += mass * center[1] * center[2];
+                inertia(2, 0) = inertia(0, 2);
+                inertia(2, 1) = inertia(1, 2);
+                inertia(2, 2) -= mass * (center[0] * center[0] + center[1] * center[1]);
+            }
+        }
+
+    private:
+        static size_t constexpr blockSize = 16;
+
+        // The terms of the triangle <v0,v1,v2> before the division by the
+        // constants of GetMassProperties.
+        static inline void ComputeTerms(
+            Real x0, Real y0, Real z0, Real x1, Real y1, Real z1,
+            Real x2, Real y2, Real z2, std::array<Real, 10>& term)
+        {
             // Get cross product of edges and normal vector.
-            Vector3<Real> V1mV0 = v1 - v0;
-            Vector3<Real> V2mV0 = v2 - v0;
-            Vector3<Real> N = Cross(V1mV0, V2mV0);
+            Real e1x = x1 - x0, e1y = y1 - y0, e1z = z1 - z0;
+            Real e2x = x2 - x0, e2y = y2 - y0, e2z = z2 - z0;
+            Real N0 = e1y * e2z - e1z * e2y;
+            Real N1 = e1z * e2x - e1x * e2z;
+            Real N2 = e1x * e2y - e1y * e2x;
 
             // Compute integral terms.
             Real tmp0, tmp1, tmp2;
             Real f1x, f2x, f3x, g0x, g1x, g2x;
-            tmp0 = v0[0] + v1[0];
-            f1x = tmp0 + v2[0];
-            tmp1 = v0[0] * v0[0];
-            tmp2 = tmp1 + v1[0] * tmp0;
-            f2x = tmp2 + v2[0] * f1x;
-            f3x = v0[0] * tmp1 + v1[0] * tmp2 + v2[0] * f2x;
-            g0x = f2x + v0[0] * (f1x + v0[0]);
-            g1x = f2x + v1[0] * (f1x + v1[0]);
-            g2x = f2x + v2[0] * (f1x + v2[0]);
-
-            Real f1y, f2y, f3y, g0y, g1y, g2y;
-            tmp0 = v0[1] + v1[1];
-            f1y = tmp0 + v2[1];
-            tmp1 = v0[1] * v0[1];
-            tmp2 = tmp1 + v1[1] * tmp0;
-            f2y = tmp2 + v2[1] * f1y;
-            f3y = v0[1] * tmp1 + v1[1] * tmp2 + v2[1] * f2y;
-            g0y = f2y + v0[1] * (f1y + v0[1]);
-            g1y = f2y + v1[1] * (f1y + v1[1]);
-            g2y = f2y + v2[1] * (f1y + v2[1]);
-
-            Real f1z, f2z, f3z, g0z, g1z, g2z;
-            tmp0 = v0[2] + v1[2];
-            f1z = tmp0 + v2[2];
-            tmp1 = v0[2] * v0[2];
-            tmp2 = tmp1 + v1[2] * tmp0;
-            f2z = tmp2 + v2[2] * f1z;
-            f3z = v0[2] * tmp1 + v1[2] * tmp2 + v2[2] * f2z;
-            g0z = f2z + v0[2] * (f1z + v0[2]);
-            g1z = f2z + v1[2] * (f1z + v1[2]);
-            g2z = f2z + v2[2] * (f1z + v2[2]);
-
-            // Update integrals.
-            integral[0] += N[0] * f1x;
-            integral[1] += N[0] * f2x;
-            integral[2] += N[1] * f2y;
-            integral[3] += N[2] * f2z;
-            integral[4] += N[0] * f3x;
-            integral[5] += N[1] * f3y;
-            integral[6] += N[2] * f3z;
-            integral[7] += N[0] * (v0[1] * g0x + v1[1] * g1x + v2[1] * g2x);
-            integral[8] += N[1] * (v0[2] * g0y + v1[2] * g1y + v2[2] * g2y);
-            integral[9] += N[2] * (v0[0] * g0z + v1[0] * g1z + v2[0] * g2z);
+            tmp0 = x0 + x1;
+            f1x = tmp0 + x2;
+            tmp1 = x0 * x0;
+            tmp2 = tmp1 + x1 * tmp0;
+            f2x = tmp2 + x2 * f1x;
+            f3x = x0 * tmp1 + x1 * tmp2 + x2 * f2x;
+            g0x = f2x + x0 * (f1x + x0);
+            g1x = f2x + x1 * (f1x + x1);
+            g2x = f2x + x2 * (f1x + x2);
+
+            Real f2y, f3y, g0y, g1y, g2y;
+            tmp0 = y0 + y1;
+            Real f1y = tmp0 + y2;
+            tmp1 = y0 * y0;
+            tmp2 = tmp1 + y1 * tmp0;
+            f2y = tmp2 + y2 * f1y;
+            f3y = y0 * tmp1 + y1 * tmp2 + y2 * f2y;
+            g0y = f2y + y0 * (f1y + y0);
+            g1y = f2y + y1 * (f1y + y1);
+            g2y = f2y + y2 * (f1y + y2);
+
+            Real f2z, f3z, g0z, g1z, g2z;
+            tmp0 = z0 + z1;
+            Real f1z = tmp0 + z2;
+            tmp1 = z0 * z0;
+            tmp2 = tmp1 + z1 * tmp0;
+            f2z = tmp2 + z2 * f1z;
+            f3z = z0 * tmp1 + z1 * tmp2 + z2 * f2z;
+            g0z = f2z + z0 * (f1z + z0);
+            g1z = f2z + z1 * (f1z + z1);
+            g2z = f2z + z2 * (f1z + z2);
+
+            term[0] = N0 * f1x;
+            term[1] = N0 * f2x;
+            term[2] = N1 * f2y;
+            term[3] = N2 * f2z;
+            term[4] = N0 * f3x;
+            term[5] = N1 * f3y;
+            term[6] = N2 * f3z;
+            term[7] = N0 * (y0 * g0x + y1 * g1x + y2 * g2x);
+            term[8] = N1 * (z0 * g0y + z1 * g1y + z2 * g2y);
+            term[9] = N2 * (x0 * g0z + x1 * g1z + x2 * g2z);
         }
 
-        integral[0] *= oneDiv6;
-        integral[1] *= oneDiv24;
-        integral[2] *= oneDiv24;
-        integral[3] *= oneDiv24;
-        integral[4] *= oneDiv60;
-        integral[5] *= oneDiv60;
-        integral[6] *= oneDiv60;
-        integral[7] *= oneDiv120;
-        integral[8] *= oneDiv120;
-        integral[9] *= oneDiv120;
-
-        // mass
-        mass = integral[0];
-
-        // center of mass
-        center = Vector3<Real>{ integral[1], integral[2], integral[3] } / mass;
-
-        // inertia relative to world origin
-        inertia(0, 0) = integral[5] + integral[6];
-        inertia(0, 1) = -integral[7];
-        inertia(0, 2) = -integral[9];
-        inertia(1, 0) = inertia(0, 1);
-        inertia(1, 1) = integral[4] + integral[6];
-        inertia(1, 2) = -integral[8];
-        inertia(2, 0) = inertia(0, 2);
-        inertia(2, 1) = inertia(1, 2);
-        inertia(2, 2) = integral[4] + integral[5];
-
-        // inertia relative to center of mass
-        if (bodyCoords)
+        // order:  1, x, y, z, x^2, y^2, z^2, xy, yz, zx
+        std::array<Real, 10> mIntegral;
+    };
+
+    template <typename Real>
+    void ComputeMassProperties(Vector3<Real> const* vertices, int32_t numTriangles,
+        int32_t const* indices, bool bodyCoords, Real& mass, Vector3<Real>& center,
+        Matrix3x3<Real>& inertia)
+    {
+        PolyhedralMassIntegrals<Real> integrals;
+        integrals.Add(vertices, static_cast<size_t>(numTriangles), indices);
+        integrals.GetMassProperties(bodyCoords, mass, center, inertia);
+    }
+
+    // Batch computation of the mass properties of many polyhedra, for
+    // example the pieces of an imported scene or of a fracture. The meshes
+    // are distributed over numThreads tasks of TaskScheduler::GetDefault()
+    // when numThreads is 2 or larger.
+    template <typename Real>
+    struct PolyhedralMesh
+    {
+        Vector3<Real> const* vertices;
+        int32_t numTriangles;
+        int32_t const* indices;
+    };
+
+    template <typename Real>
+    struct PolyhedralMassProperties
+    {
+        Real mass;
+        Vector3<Real> center;
+        Matrix3x3<Real> inertia;
+    };
+
+    template <typename Real>
+    void ComputeMassProperties(std::vector<PolyhedralMesh<Real>> const& meshes,
+        bool bodyCoords, std::vector<PolyhedralMassProperties<Real>>& properties,
+        size_t numThreads = 0)
+    {
+        properties.resize(meshes.size());
+
+        auto compute = [&meshes, bodyCoords, &properties](size_t i)
         {
-            inertia(0, 0) -= mass * (center[1] * center[1] + center[2] * center[2]);
-            inertia(0, 1) += mass * center[0] * center[1];
-            inertia(0, 2) += mass * center[2] * center[0];
-            inertia(1, 0) = inertia(0, 1);
-            inertia(1, 1) -= mass * (center[2] * center[2] + center[0] * center[0]);
-            inertia(1, 2) += mass * center[1] * center[2];
-            inertia(2, 0) = inertia(0, 2);
-            inertia(2, 1) = inertia(1, 2);
-            inertia(2, 2) -= mass * (center[0] * center[0] + center[1] * center[1]);
+            PolyhedralMesh<Real> const& mesh = meshes[i];
+            PolyhedralMassProperties<Real>& output = properties[i];
+            ComputeMassProperties(mesh.vertices, mesh.numTriangles, mesh.indices,
+                bodyCoords, output.mass, output.center, output.inertia);
+        };
+
+        // The meshes are interleaved among the tasks, which balances the
+        // work when the mesh sizes vary.
+        size_t const numTasks = std::min(numThreads, meshes.size());
+        if (numTasks > 1)
+        {
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [numTasks, &meshes, &compute](size_t t)
+                {
+                    for (size_t i = t; i < meshes.size(); i += numTasks)
+                    {
+                        compute(i);
+                    }
+                });
+        }
+        else
+        {
+            for (size_t i = 0; i < meshes.size(); ++i)
+            {
+                compute(i);
+            }
         }
     }
 }
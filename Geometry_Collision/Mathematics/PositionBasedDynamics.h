@@ -0,0 +1,533 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+// Extended position-based dynamics (XPBD) of particles connected by
+// distance, bending and volume constraints. See
+//   Macklin, Mueller and Chentanez, "XPBD: Position-Based Simulation of
+//   Compliant Constrained Dynamics", Motion in Games 2016.
+// A step of Update(...) integrates the external accelerations explicitly to
+// predict the positions, then moves the predicted positions a fixed number
+// of iterations to satisfy the constraints and to resolve the collisions,
+// and finally sets the velocities to the displacements divided by the step.
+// The cost of a step is therefore proportional to the number of iterations
+// times the number of constraints, regardless of their stiffness, and the
+// system is stable for any step size.
+//
+// The constraints are projected in Gauss-Seidel order within groups of
+// constraints that do not share a particle (the colors of the constraint
+// graph). The constraints of a group are independent, so they are
+// projected in parallel, and the results do not depend on the number of
+// threads. The groups are recomputed on the first Update(...) after a
+// constraint is added.
+//
+// The mass and position storage is that of ParticleSystem. The predicted
+// positions are stored in mPTmp. A particle with infinite mass does not
+// move.
+
+#include <Mathematics/ParticleSystem.h>
+#include <Mathematics/Hyperplane.h>
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace gte
+{
+    template <int32_t N, typename Real>
+    class PositionBasedDynamics : public ParticleSystem<N, Real>
+    {
+    public:
+        // Construction and destruction. The constraints are projected
+        // numIterations times per step.
+        virtual ~PositionBasedDynamics() = default;
+
+        PositionBasedDynamics(int32_t numParticles, Real step, int32_t numIterations)
+            :
+            ParticleSystem<N, Real>(numParticles, step),
+            mNumIterations(std::max(numIterations, 1)),
+            mNumThreads(0),
+            mConstraints{},
+            mLambda{},
+            mColorsDirty(false),
+            mColorOffsets(1, 0),
+            mColorConstraints{},
+            mPlanes{},
+            mCollisionRadius((Real)0)
+        {
+        }
+
+        // The constraints. The rest value of a constraint is computed from
+        // the current positions of its particles, so set the positions
+        // first. The compliance is the inverse of the stiffness; a
+        // compliance of 0 is a rigid constraint. The return value is the
+        // index of the constraint.
+        //
+        // A distance constraint keeps |X[i1] - X[i0]| at its rest length.
+        int32_t AddDistanceConstraint(int32_t i0, int32_t i1, Real compliance = (Real)0)
+        {
+            Constraint constraint(DISTANCE, { i0, i1, i0, i0 }, compliance);
+            constraint.rest = Length(this->mPosition[i1] - this->mPosition[i0]);
+            return AddConstraint(constraint);
+        }
+
+        // A bending constraint keeps the distance from X[i1] to the centroid
+        // of X[i0], X[i1] and X[i2] at its rest value, which resists the
+        // bending of the polyline or of the surface at X[i1] along the
+        // direction from X[i0] to X[i2]. See
+        //   Kelager, Niebe and Erleben, "A Triangle Bending Constraint
+        //   Model for Position-Based Dynamics", VRIPHYS 2010.
+        int32_t AddBendingConstraint(int32_t i0, int32_t i1, int32_t i2, Real compliance = (Real)0)
+        {
+            Constraint constraint(BENDING, { i0, i1, i2, i0 }, compliance);
+            Vector<N, Real> centroid = (this->mPosition[i0] + this->mPosition[i1]
+                + this->mPosition[i2]) / (Real)3;
+            constraint.rest = Length(this->mPosition[i1] - centroid);
+            return AddConstraint(constraint);
+        }
+
+        // A volume constraint keeps the signed volume of the tetrahedron
+        // <X[i0],X[i1],X[i2],X[i3]> at its rest value. It is available only
+        // for N = 3.
+        int32_t AddVolumeConstraint(int32_t i0, int32_t i1, int32_t i2, int32_t i3,
+            Real compliance = (Real)0)
+        {
+            LogAssert(N == 3, "Volume constraints require N = 3.");
+            Constraint constraint(VOLUME, { i0, i1, i2, i3 }, compliance);
+            std::array<Vector<N, Real>, 4> gradient{};
+            constraint.rest = GetVolume(constraint, this->mPosition, gradient);
+            return AddConstraint(constraint);
+        }
+
+        inline int32_t GetNumConstraints() const
+        {
+            return static_cast<int32_t>(mConstraints.size());
+        }
+
+        // The number of groups of independent constraints, which is the
+        // number of sequential passes of an iteration. It is computed by
+        // Update(...).
+        inline int32_t GetNumColors() const
+        {
+            return static_cast<int32_t>(mColorOffsets.size()) - 1;
+        }
+
+        // The particles are spheres of the collision radius that do not
+        // penetrate the planes, whose normals point to the free side. A
+        // derived class can add other colliders by overriding
+        // GetColliderDistance(...).
+        void AddCollisionPlane(Hyperplane<N, Real> const& plane)
+        {
+            mPlanes.push_back(plane);
+        }
+
+        inline std::vector<Hyperplane<N, Real>> const& GetCollisionPlanes() const
+        {
+            return mPlanes;
+        }
+
+        inline void SetCollisionRadius(Real radius)
+        {
+            mCollisionRadius = radius;
+        }
+
+        inline Real GetCollisionRadius() const
+        {
+            return mCollisionRadius;
+        }
+
+        inline void SetNumIterations(int32_t numIterations)
+        {
+            mNumIterations = std::max(numIterations, 1);
+        }
+
+        inline int32_t GetNumIterations() const
+        {
+            return mNumIterations;
+        }
+
+        // To run in the main thread only, choose numThreads to be 0. For
+        // multithreading, choose numThreads > 0. The particles and the
+        // constraints of each color are then partitioned into numThreads
+        // tasks of TaskScheduler::GetDefault().
+        inline void SetNumThreads(size_t numThreads)
+        {
+            mNumThreads = numThreads;
+        }
+
+        inline size_t GetNumThreads() const
+        {
+            return mNumThreads;
+        }
+
+        // The default external force is zero. Derive a class from this one
+        // to provide nonzero external forces such as gravity, wind,
+        // friction and so on. This function is called by Acceleration(...)
+        // to compute the impulse F/m generated by the external force F.
+        virtual Vector<N, Real> ExternalAcceleration(int32_t, Real,
+            std::vector<Vector<N, Real>> const&,
+            std::vector<Vector<N, Real>> const&)
+        {
+            return Vector<N, Real>::Zero();
+        }
+
+        // A step of the position-based solver. It replaces the Runge-Kutta
+        // solver of ParticleSystem.
+        virtual void Update(Real time) override
+        {
+            if (mColorsDirty)
+            {
+                ColorConstraints();
+            }
+
+            // Predict the positions from the external accelerations.
+            size_t const numThreads = mNumThreads;
+            this->mATmp.resize(static_cast<size_t>(this->mNumParticles));
+            this->ForEachRange(numThreads, [this, time](int32_t i0, int32_t i1)
+            {
+                this->Accelerations(i0, i1, time, this->mPosition, this->mVelocity, this->mATmp);
+                for (int32_t i = i0; i < i1; ++i)
+                {
+                    if (this->mInvMass[i] > (Real)0)
+                    {
+                        this->mVelocity[i] += this->mStep * this->mATmp[i];
+                        this->mPTmp[i] = this->mPosition[i] + this->mStep * this->mVelocity[i];
+                    }
+                    else
+                    {
+                        this->mPTmp[i] = this->mPosition[i];
+                    }
+                }
+            });
+
+            std::fill(mLambda.begin(), mLambda.end(), (Real)0);
+            Real const timeScale = (Real)1 / (this->mStep * this->mStep);
+            for (int32_t iteration = 0; iteration < mNumIterations; ++iteration)
+            {
+                for (int32_t color = 0; color < GetNumColors(); ++color)
+                {
+                    ForEachConstraint(color, [this, timeScale](int32_t index)
+                    {
+                        Project(index, timeScale);
+                    });
+                }
+
+                this->ForEachRange(numThreads, [this](int32_t i0, int32_t i1)
+                {
+                    for (int32_t i = i0; i < i1; ++i)
+                    {
+                        if (this->mInvMass[i] > (Real)0)
+                        {
+                            Collide(this->mPTmp[i]);
+                        }
+                    }
+                });
+            }
+
+            // The velocities are the displacements divided by the step.
+            Real const invStep = (Real)1 / this->mStep;
+            this->ForEachRange(numThreads, [this, invStep](int32_t i0, int32_t i1)
+            {
+                for (int32_t i = i0; i < i1; ++i)
+                {
+                    if (this->mInvMass[i] > (Real)0)
+                    {
+                        this->mVelocity[i] = invStep * (this->mPTmp[i] - this->mPosition[i]);
+                        this->mPosition[i] = this->mPTmp[i];
+                    }
+                }
+            });
+        }
+
+    protected:
+        enum ConstraintType
+        {
+            DISTANCE,
+            BENDING,
+            VOLUME
+        };
+
+        // The particles of a constraint are the first 2, 3 or 4 elements of
+        // 'particles' according to the type.
+        struct Constraint
+        {
+            Constraint(ConstraintType inType, std::array<int32_t, 4> const& inParticles,
+                Real inCompliance)
+                :
+                type(inType),
+                particles(inParticles),
+                rest((Real)0),
+                compliance(inCompliance)
+            {
+            }
+
+            ConstraintType type;
+            std::array<int32_t, 4> particles;
+            Real rest, compliance;
+        };
+
+        // The accelerations of the prediction are the external
+        // accelerations.
+        virtual Vector<N, Real> Acceleration(int32_t i, Real time,
+            std::vector<Vector<N, Real>> const& position,
+            std::vector<Vector<N, Real>> const& velocity) override
+        {
+            return ExternalAcceleration(i, time, position, velocity);
+        }
+
+        // Callback for colliders other than the planes, for example signed
+        // distance fields. If the point is near a collider, return true with
+        // the signed distance to the collider, negative inside, and the
+        // unit-length outer normal at the point. The function is called
+        // concurrently for different particles when multithreading.
+        virtual bool GetColliderDistance(Vector<N, Real> const&, Real&, Vector<N, Real>&) const
+        {
+            return false;
+        }
+
+        int32_t AddConstraint(Constraint const& constraint)
+        {
+            int32_t const numParticles = (constraint.type == DISTANCE ? 2 :
+                (constraint.type == BENDING ? 3 : 4));
+            for (int32_t k = 0; k < numParticles; ++k)
+            {
+                int32_t const i = constraint.particles[k];
+                LogAssert(0 <= i && i < this->mNumParticles, "Invalid particle index.");
+            }
+
+            mConstraints.push_back(constraint);
+            mLambda.push_back((Real)0);
+            mColorsDirty = true;
+            return static_cast<int32_t>(mConstraints.size()) - 1;
+        }
+
+        // Assign the constraints to colors in rounds. A round visits the
+        // uncolored constraints in order and gives the color of the round to
+        // each constraint whose particles are not used by the constraints
+        // already given that color.
+        void ColorConstraints()
+        {
+            std::vector<int32_t> stamp(static_cast<size_t>(this->mNumParticles), -1);
+            std::vector<int32_t> uncolored(mConstraints.size()), remaining{};
+            for (size_t index = 0; index < mConstraints.size(); ++index)
+            {
+                uncolored[index] = static_cast<int32_t>(index);
+            }
+
+            mColorOffsets.assign(1, 0);
+            mColorConstraints.clear();
+            for (int32_t color = 0; uncolored.size() > 0; ++color)
+            {
+                remaining.clear();
+                for (auto index : uncolored)
+                {
+                    auto const& particles = mConstraints[index].particles;
+                    bool free = true;
+                    for (auto i : particles)
+                    {
+                        if (stamp[i] == color)
+                        {
+                            free = false;
+                            break;
+                        }
+                    }
+
+                    if (free)
+                    {
+                        for (auto i : particles)
+                        {
+                            stamp[i] = color;
+                        }
+                        mColorConstraints.push_back(index);
+                    }
+                    else
+                    {
+                        remaining.push_back(index);
+                    }
+                }
+                std::swap(uncolored, remaining);
+                mColorOffsets.push_back(static_cast<int32_t>(mColorConstraints.size()));
+            }
+            mColorsDirty = false;
+        }
+
+        // Execute function(index) for the constraints of a color, as tasks
+        // when multithreading and the color has enough constraints.
+        template <typename Function>
+        void ForEachConstraint(int32_t color, Function const& function)
+        {
+            int32_t const cmin = mColorOffsets[color];
+            int32_t const numConstraints = mColorOffsets[static_cast<size_t>(color) + 1] - cmin;
+            size_t const numTasks = std::min(mNumThreads,
+                static_cast<size_t>(numConstraints / msMinTaskSize));
+            if (numTasks <= 1)
+            {
+                for (int32_t c = 0; c < numConstraints; ++c)
+                {
+                    function(mColorConstraints[static_cast<size_t>(cmin) + c]);
+                }
+                return;
+            }
+
+            TaskScheduler::GetDefault().ParallelFor(numTasks,
+                [this, &function, cmin, numConstraints, numTasks](size_t t)
+                {
+                    int32_t const c0 = static_cast<int32_t>(t * numConstraints / numTasks);
+                    int32_t const c1 = static_cast<int32_t>((t + 1) * numConstraints / numTasks);
+                    for (int32_t c = c0; c < c1; ++c)
+                    {
+                        function(mColorConstraints[static_cast<size_t>(cmin) + c]);
+                    }
+                });
+        }
+
+        // The XPBD update of a constraint C with gradients G[k] with respect
+        // to its particles is
+        //   dLambda = -(C + a * lambda) / (sum_k w[k] * |G[k]|^2 + a)
+        //   X[k] += w[k] * dLambda * G[k]
+        // for the inverse masses w[k] and a = compliance / step^2.
+        void Project(int32_t index, Real timeScale)
+        {
+            Constraint const& constraint = mConstraints[index];
+            std::array<Vector<N, Real>, 4> gradient{};
+            int32_t numParticles = 0;
+            Real value = (Real)0;
+
+            if (constraint.type == DISTANCE)
+            {
+                numParticles = 2;
+                Vector<N, Real> diff = this->mPTmp[constraint.particles[1]]
+                    - this->mPTmp[constraint.particles[0]];
+                Real length = Length(diff);
+                if (length == (Real)0)
+                {
+                    return;
+                }
+                gradient[1] = diff / length;
+                gradient[0] = -gradient[1];
+                value = length - constraint.rest;
+            }
+            else if (constraint.type == BENDING)
+            {
+                numParticles = 3;
+                Vector<N, Real> centroid = (this->mPTmp[constraint.particles[0]]
+                    + this->mPTmp[constraint.particles[1]]
+                    + this->mPTmp[constraint.particles[2]]) / (Real)3;
+                Vector<N, Real> diff = this->mPTmp[constraint.particles[1]] - centroid;
+                Real length = Length(diff);
+                if (length == (Real)0)
+                {
+                    return;
+                }
+                Vector<N, Real> direction = diff / length;
+                gradient[0] = direction / (Real)-3;
+                gradient[1] = direction * ((Real)2 / (Real)3);
+                gradient[2] = gradient[0];
+                value = length - constraint.rest;
+            }
+            else
+            {
+                numParticles = 4;
+                value = GetVolume(constraint, this->mPTmp, gradient) - constraint.rest;
+            }
+
+            Real alpha = constraint.compliance * timeScale;
+            Real denominator = alpha;
+            for (int32_t k = 0; k < numParticles; ++k)
+            {
+                denominator += this->mInvMass[constraint.particles[k]] * Dot(gradient[k], gradient[k]);
+            }
+            if (denominator == (Real)0)
+            {
+                return;
+            }
+
+            Real deltaLambda = -(value + alpha * mLambda[index]) / denominator;
+            mLambda[index] += deltaLambda;
+            for (int32_t k = 0; k < numParticles; ++k)
+            {
+                int32_t const i = constraint.particles[k];
+                this->mPTmp[i] += (this->mInvMass[i] * deltaLambda) * gradient[k];
+            }
+        }
+
+        // The signed volume of the tetrahedron of a volume constraint and
+        // its gradients with respect to the vertices. The components 0, 1
+        // and 2 are used, so N must be 3.
+        static Real GetVolume(Constraint const& constraint,
+            std::vector<Vector<N, Real>> const& position,
+            std::array<Vector<N, Real>, 4>& gradient)
+        {
+            Vector<N, Real> const& X0 = position[constraint.particles[0]];
+            std::array<Vector<N, Real>, 3> E{};
+            for (int32_t k = 0; k < 3; ++k)
+            {
+                E[k] = position[constraint.particles[k + 1]] - X0;
+            }
+
+            Real const sixth = (Real)1 / (Real)6;
+            gradient[0].MakeZero();
+            for (int32_t k = 0; k < 3; ++k)
+            {
+                Vector<N, Real> const& U = E[(k + 1) % 3];
+                Vector<N, Real> const& V = E[(k + 2) % 3];
+                Vector<N, Real>& cross = gradient[static_cast<size_t>(k) + 1];
+                cross.MakeZero();
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    int32_t const d1 = (d + 1) % 3, d2 = (d + 2) % 3;
+                    cross[d] = sixth * (U[d1] * V[d2] - U[d2] * V[d1]);
+                }
+                gradient[0] -= cross;
+            }
+            return Dot(E[0], gradient[1]);
+        }
+
+        // Move a predicted position out of the planes and the colliders.
+        void Collide(Vector<N, Real>& position) const
+        {
+            for (auto const& plane : mPlanes)
+            {
+                Real distance = Dot(plane.normal, position) - plane.constant - mCollisionRadius;
+                if (distance < (Real)0)
+                {
+                    position -= distance * plane.normal;
+                }
+            }
+
+            Real distance = (Real)0;
+            Vector<N, Real> normal{};
+            if (GetColliderDistance(position, distance, normal) && distance < mCollisionRadius)
+            {
+                position += (mCollisionRadius - distance) * normal;
+            }
+        }
+
+        // A task of ForEachConstraint projects at least this many
+        // constraints.
+        static int32_t constexpr msMinTaskSize = 256;
+
+        int32_t mNumIterations;
+        size_t mNumThreads;
+
+        std::vector<Constraint> mConstraints;
+        std::vector<Real> mLambda;
+
+        // The constraints of color c are mColorConstraints[k] for
+        // mColorOffsets[c] <= k < mColorOffsets[c+1].
+        bool mColorsDirty;
+        std::vector<int32_t> mColorOffsets;
+        std::vector<int32_t> mColorConstraints;
+
+        std::vector<Hyperplane<N, Real>> mPlanes;
+        Real mCollisionRadius;
+    };
+}
@@ -8,6 +8,10 @@
 #pragma once
 
 #include <Mathematics/Vector2.h>
+#include <Mathematics/SIMDInterval.h>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 // Queries about the relation of a point to various geometric objects.  The
 // choices for N when using UIntegerFP32<N> for either BSNumber of BSRational
@@ -15,6 +19,14 @@
 // N-values are worst case scenarios. Your specific input data might require
 // much smaller N, in which case you can modify PrecisionCalculator to use the
 // BSPrecision(int32_t,int32_t,int32_t,bool) constructors.
+//
+// When Real is not a floating-point type, the queries are filtered. The
+// determinant is first evaluated with SIMDInterval arithmetic on
+// intervals that contain the vertex coordinates. If the interval does not
+// contain zero, its sign is the sign of the determinant. Otherwise, the
+// determinant is evaluated in Real. The exact arithmetic is therefore used
+// only for nearly degenerate inputs, and the results are the same as those
+// of the unfiltered queries.
 
 namespace gte
 {
@@ -56,6 +68,10 @@ namespace gte
             return mVertices;
         }
 
+        // The filters are used only for the exact arithmetic types. For
+        // floating-point types they would change the classifications.
+        static bool constexpr isFiltered = !std::is_floating_point<Real>::value;
+
         // In the following, point P refers to vertices[i] or 'test' and Vi
         // refers to vertices[vi].
 
@@ -81,6 +97,15 @@ namespace gte
             Vector2<Real> const& vec0 = mVertices[v0];
             Vector2<Real> const& vec1 = mVertices[v1];
 
+            if (isFiltered)
+            {
+                int32_t sign = ToLineFilter(test, vec0, vec1);
+                if (sign != 0)
+                {
+                    return sign;
+                }
+            }
+
             Real x0 = test[0] - vec0[0];
             Real y0 = test[1] - vec0[1];
             Real x1 = vec1[0] - vec0[0];
@@ -124,6 +149,16 @@ namespace gte
             Vector2<Real> const& vec0 = mVertices[v0];
             Vector2<Real> const& vec1 = mVertices[v1];
 
+            if (isFiltered)
+            {
+                int32_t sign = ToLineFilter(test, vec0, vec1);
+                if (sign != 0)
+                {
+                    order = 3 * sign;
+                    return sign;
+                }
+            }
+
             Real x0 = test[0] - vec0[0];
             Real y0 = test[1] - vec0[1];
             Real x1 = vec1[0] - vec0[0];
@@ -247,6 +282,15 @@ namespace gte
             Vector2<Real> const& vec1 = mVertices[v1];
             Vector2<Real> const& vec2 = mVertices[v2];
 
+            if (isFiltered)
+            {
+                int32_t sign = ToCircumcircleFilter(test, vec0, vec1, vec2);
+                if (sign != 0)
+                {
+                    return sign;
+                }
+            }
+
             Real x0 = vec0[0] - test[0];
             Real y0 = vec0[1] - test[1];
             Real s00 = vec0[0] + test[0];
@@ -322,6 +366,17 @@ namespace gte
         // worst-case path has the same computational complexity.
         OrderType ToLineExtended(Vector2<Real> const& P, Vector2<Real> const& Q0, Vector2<Real> const& Q1) const
         {
+            // A nonzero determinant implies that the points are distinct, so
+            // the filter can be applied before the equality tests.
+            if (isFiltered)
+            {
+                int32_t sign = ToLineFilter(P, Q0, Q1);
+                if (sign != 0)
+                {
+                    return (sign > 0 ? OrderType::NEGATIVE : OrderType::POSITIVE);
+                }
+            }
+
             Real const zero(0);
 
             Real x0 = Q1[0] - Q0[0];
@@ -394,6 +449,63 @@ namespace gte
         }
 
     private:
+        using Interval = SIMDInterval;
+
+        // An interval of doubles that contains the number. The conversion
+        // to double is rounded, so the interval is the rounded value
+        // widened in each direction.
+        static Interval Enclose(Real const& value)
+        {
+            return Interval::Enclose(static_cast<double>(value));
+        }
+
+        // The sign of the determinant when the interval does not contain
+        // zero, or 0 when the sign cannot be determined.
+        static int32_t GetSign(Interval const& det)
+        {
+            return det.GetSign();
+        }
+
+        // The filters evaluate the same expression trees as ToLine and
+        // ToCircumcircle. ToLineExtended computes the determinant for
+        // <P,Q0,Q1> as (Q1-Q0)x(P-Q0), the negative of (P-Q0)x(Q1-Q0) used
+        // by ToLine, so it negates the sign of ToLineFilter.
+        static int32_t ToLineFilter(Vector2<Real> const& test, Vector2<Real> const& vec0,
+            Vector2<Real> const& vec1)
+        {
+            Interval p0 = Enclose(vec0[0]), p1 = Enclose(vec0[1]);
+            Interval x0 = Enclose(test[0]) - p0;
+            Interval y0 = Enclose(test[1]) - p1;
+            Interval x1 = Enclose(vec1[0]) - p0;
+            Interval y1 = Enclose(vec1[1]) - p1;
+            Interval det = x0 * y1 - x1 * y0;
+            return GetSign(det);
+        }
+
+        static int32_t ToCircumcircleFilter(Vector2<Real> const& test,
+            Vector2<Real> const& vec0, Vector2<Real> const& vec1, Vector2<Real> const& vec2)
+        {
+            std::array<Vector2<Real> const*, 3> const vec{ &vec0, &vec1, &vec2 };
+            Interval t0 = Enclose(test[0]), t1 = Enclose(test[1]);
+            std::array<Interval, 3> x{}, y{}, z{};
+            for (size_t i = 0; i < 3; ++i)
+            {
+                Interval v0 = Enclose((*vec[i])[0]);
+                Interval v1 = Enclose((*vec[i])[1]);
+                x[i] = v0 - t0;
+                y[i] = v1 - t1;
+                z[i] = (v0 + t0) * x[i] + (v1 + t1) * y[i];
+            }
+
+            Interval c0 = y[1] * z[2] - y[2] * z[1];
+            Interval c1 = y[2] * z[0] - y[0] * z[2];
+            Interval c2 = y[0] * z[1] - y[1] * z[0];
+            Interval det = x[0] * c0 + x[1] * c1 + x[2] * c2;
+
+            // ToCircumcircle returns +1 for a negative determinant.
+            return -GetSign(det);
+        }
+
         int32_t mNumVertices;
         Vector2<Real> const* mVertices;
     };
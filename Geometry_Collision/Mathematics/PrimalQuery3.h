@@ -7,7 +7,12 @@
 
 #pragma once
 
+#include <Mathematics/BSPrecision.h>
 #include <Mathematics/Vector3.h>
+#include <Mathematics/SIMDInterval.h>
+#include <cmath>
+#include <limits>
+#include <type_traits>
 
 // Queries about the relation of a point to various geometric objects.  The
 // choices for N when using UIntegerFP32<N> for either BSNumber of BSRational
@@ -15,6 +20,14 @@
 // N-values are worst case scenarios. Your specific input data might require
 // much smaller N, in which case you can modify PrecisionCalculator to use the
 // BSPrecision(int32_t,int32_t,int32_t,bool) constructors.
+//
+// When Real is not a floating-point type, the queries are filtered. The
+// determinant is first evaluated with SIMDInterval arithmetic on
+// intervals that contain the vertex coordinates. If the interval does not
+// contain zero, its sign is the sign of the determinant. Otherwise, the
+// determinant is evaluated in Real. The exact arithmetic is therefore used
+// only for nearly degenerate inputs, and the results are the same as those
+// of the unfiltered queries.
 
 namespace gte
 {
@@ -56,6 +69,39 @@ namespace gte
             return mVertices;
         }
 
+        // The filters are used only for the exact arithmetic types. For
+        // floating-point types they would change the classifications.
+        static bool constexpr isFiltered = !std::is_floating_point<Real>::value;
+
+        // The precisions of the expression trees of ToPlane and
+        // ToCircumsphere for inputs of the specified type. The number of
+        // words N for UIntegerFP32<N> is bsn.maxWords of the result when
+        // Real is BSNumber and bsr.maxWords when Real is BSRational, so the
+        // queries can use fixed-size storage without dynamic allocations,
+        //   int32_t constexpr N = PrimalQuery3<float>::GetToPlanePrecision(
+        //       BSPrecision::GetType<float>()).bsn.maxWords;
+        //   PrimalQuery3<BSNumber<UIntegerFP32<N>>> query;
+        static constexpr BSPrecision GetToPlanePrecision(BSPrecision::Type type)
+        {
+            BSPrecision const x(type);
+            BSPrecision const d = x - x;
+            BSPrecision const c = d * d - d * d;
+            return d * c + d * c + d * c;
+        }
+
+        static constexpr BSPrecision GetToCircumspherePrecision(BSPrecision::Type type)
+        {
+            BSPrecision const x(type);
+            BSPrecision const d = x - x;
+            BSPrecision const s = x + x;
+            BSPrecision const t = s * d;
+            BSPrecision const w = t + t + t;
+            BSPrecision const a = d * d - d * d;
+            BSPrecision const b = d * w - d * w;
+            BSPrecision const ab = a * b;
+            return ab - ab + ab + ab - ab + ab;
+        }
+
         // In the following, point P refers to vertices[i] or 'test' and Vi
         // refers to vertices[vi].
 
@@ -83,6 +129,15 @@ namespace gte
             Vector3<Real> const& vec1 = mVertices[v1];
             Vector3<Real> const& vec2 = mVertices[v2];
 
+            if (isFiltered)
+            {
+                int32_t sign = ToPlaneFilter(test, vec0, vec1, vec2);
+                if (sign != 0)
+                {
+                    return sign;
+                }
+            }
+
             Real x0 = test[0] - vec0[0];
             Real y0 = test[1] - vec0[1];
             Real z0 = test[2] - vec0[2];
@@ -185,6 +240,15 @@ namespace gte
             Vector3<Real> const& vec2 = mVertices[v2];
             Vector3<Real> const& vec3 = mVertices[v3];
 
+            if (isFiltered)
+            {
+                int32_t sign = ToCircumsphereFilter(test, vec0, vec1, vec2, vec3);
+                if (sign != 0)
+                {
+                    return sign;
+                }
+            }
+
             Real x0 = vec0[0] - test[0];
             Real y0 = vec0[1] - test[1];
             Real z0 = vec0[2] - test[2];
@@ -287,6 +351,80 @@ namespace gte
         }
 
     private:
+        using Interval = SIMDInterval;
+
+        // An interval of doubles that contains the number. The conversion
+        // to double is rounded, so the interval is the rounded value
+        // widened in each direction.
+        static Interval Enclose(Real const& value)
+        {
+            return Interval::Enclose(static_cast<double>(value));
+        }
+
+        // The sign of the determinant when the interval does not contain
+        // zero, or 0 when the sign cannot be determined.
+        static int32_t GetSign(Interval const& det)
+        {
+            return det.GetSign();
+        }
+
+        // The filters evaluate the same expression trees as ToPlane and
+        // ToCircumsphere.
+        static int32_t ToPlaneFilter(Vector3<Real> const& test, Vector3<Real> const& vec0,
+            Vector3<Real> const& vec1, Vector3<Real> const& vec2)
+        {
+            Interval t0 = Enclose(test[0]), t1 = Enclose(test[1]), t2 = Enclose(test[2]);
+            Interval p0 = Enclose(vec0[0]), p1 = Enclose(vec0[1]), p2 = Enclose(vec0[2]);
+            Interval x0 = t0 - p0;
+            Interval y0 = t1 - p1;
+            Interval z0 = t2 - p2;
+            Interval x1 = Enclose(vec1[0]) - p0;
+            Interval y1 = Enclose(vec1[1]) - p1;
+            Interval z1 = Enclose(vec1[2]) - p2;
+            Interval x2 = Enclose(vec2[0]) - p0;
+            Interval y2 = Enclose(vec2[1]) - p1;
+            Interval z2 = Enclose(vec2[2]) - p2;
+            Interval c0 = y1 * z2 - y2 * z1;
+            Interval c1 = y2 * z0 - y0 * z2;
+            Interval c2 = y0 * z1 - y1 * z0;
+            Interval det = x0 * c0 + x1 * c1 + x2 * c2;
+            return GetSign(det);
+        }
+
+        static int32_t ToCircumsphereFilter(Vector3<Real> const& test,
+            Vector3<Real> const& vec0, Vector3<Real> const& vec1,
+            Vector3<Real> const& vec2, Vector3<Real> const& vec3)
+        {
+            std::array<Vector3<Real> const*, 4> const vec{ &vec0, &vec1, &vec2, &vec3 };
+            Interval t0 = Enclose(test[0]), t1 = Enclose(test[1]), t2 = Enclose(test[2]);
+            std::array<Interval, 4> x{}, y{}, z{}, w{};
+            for (size_t i = 0; i < 4; ++i)
+            {
+                Interval v0 = Enclose((*vec[i])[0]);
+                Interval v1 = Enclose((*vec[i])[1]);
+                Interval v2 = Enclose((*vec[i])[2]);
+                x[i] = v0 - t0;
+                y[i] = v1 - t1;
+                z[i] = v2 - t2;
+                w[i] = (v0 + t0) * x[i] + (v1 + t1) * y[i] + (v2 + t2) * z[i];
+            }
+
+            Interval a0 = x[0] * y[1] - x[1] * y[0];
+            Interval a1 = x[0] * y[2] - x[2] * y[0];
+            Interval a2 = x[0] * y[3] - x[3] * y[0];
+            Interval a3 = x[1] * y[2] - x[2] * y[1];
+            Interval a4 = x[1] * y[3] - x[3] * y[1];
+            Interval a5 = x[2] * y[3] - x[3] * y[2];
+            Interval b0 = z[0] * w[1] - z[1] * w[0];
+            Interval b1 = z[0] * w[2] - z[2] * w[0];
+            Interval b2 = z[0] * w[3] - z[3] * w[0];
+            Interval b3 = z[1] * w[2] - z[2] * w[1];
+            Interval b4 = z[1] * w[3] - z[3] * w[1];
+            Interval b5 = z[2] * w[3] - z[3] * w[2];
+            Interval det = a0 * b5 - a1 * b4 + a2 * b3 + a3 * b2 - a4 * b1 + a5 * b0;
+            return GetSign(det);
+        }
+
         int32_t mNumVertices;
         Vector3<Real> const* mVertices;
     };
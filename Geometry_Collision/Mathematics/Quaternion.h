@@ -4,6 +4,7 @@
 #include "Vector.h"
 #include "Matrix.h"
 #include "ChebyshevRatio.h"
+#include "QuaternionSIMD.h"
 
 // A quaternion is of the form
 //   q = x * i + y * j + z * k + w * 1 = x * i + y * j + z * k + w
@@ -241,7 +242,13 @@ namespace Vector_GM
     template <typename Real>
     Real Normalize(Quaternion<Real>& q)
     {
-        Real length = std::sqrt(Dot(q, q));
+        Real length;
+        if (QuaternionSIMDSelect<QuaternionSIMD<Real>::supported>::Normalize(&q[0], length))
+        {
+            return length;
+        }
+
+        length = std::sqrt(Dot(q, q));
         if (length > (Real)0)
         {
             q /= length;
@@ -274,6 +281,13 @@ namespace Vector_GM
         // k*(+x0*y1 - y0*x1 + z0*w1 + w0*z1) +
         // 1*(-x0*x1 - y0*y1 - z0*z1 + w0*w1)
 
+        Quaternion<Real> result;
+        if (QuaternionSIMDSelect<QuaternionSIMD<Real>::supported>::Multiply(
+            &q0[0], &q1[0], &result[0]))
+        {
+            return result;
+        }
+
         return Quaternion<Real>
         (
             +q0[0] * q1[3] + q0[1] * q1[2] - q0[2] * q1[1] + q0[3] * q1[0],
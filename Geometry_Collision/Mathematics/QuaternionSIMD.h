@@ -0,0 +1,379 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+// SIMD kernels for the product and the normalization of quaternions of
+// float and double. The file is included by Quaternion.h. As in
+// MatrixSIMD.h, whose instruction-set selection it uses, the primary
+// template QuaternionSIMD<Real> is not supported, the specializations for
+// float and double are compiled only when GTE_USE_MATRIX_SIMD is defined,
+// and Quaternion.h selects them through QuaternionSIMDSelect.
+//
+// The product q0*q1 is the sum over k of q0[k] times a permutation of q1
+// with a sign pattern. The four terms are added in the order of the
+// expressions of operator*, and a negated product is the product with its
+// sign bit flipped, as in the scalar code. Normalize multiplies in SIMD
+// registers but adds the squares in the order of Dot, takes the scalar
+// square root and divides the lanes by it. The results are the same as
+// those of the generic code under the conditions stated in MatrixSIMD.h.
+//
+// The conversion of a quaternion to a rotation matrix keeps the scalar
+// code of Rotation.h. Its 12 products would fit in 3 registers, but the 9
+// matrix entries combine them in a different lane pattern each, and the
+// shuffles and stores cost more than the scalar operations.
+
+#include "MatrixSIMD.h"
+#include <cmath>
+#include <cstdint>
+
+namespace Vector_GM
+{
+    template <typename Real>
+    struct QuaternionSIMD
+    {
+        static bool constexpr supported = false;
+    };
+
+    // The members of QuaternionSIMDSelect<false> do nothing and return
+    // false, and the caller then runs the scalar code.
+    template <bool Supported>
+    struct QuaternionSIMDSelect
+    {
+        template <typename Real>
+        inline static bool Multiply(Real const*, Real const*, Real*)
+        {
+            return false;
+        }
+
+        template <typename Real>
+        inline static bool Normalize(Real*, Real&)
+        {
+            return false;
+        }
+    };
+
+    template <>
+    struct QuaternionSIMDSelect<true>
+    {
+        template <typename Real>
+        inline static bool Multiply(Real const* q0, Real const* q1, Real* result)
+        {
+            QuaternionSIMD<Real>::Multiply(q0, q1, result);
+            return true;
+        }
+
+        template <typename Real>
+        inline static bool Normalize(Real* q, Real& length)
+        {
+            length = QuaternionSIMD<Real>::Normalize(q);
+            return true;
+        }
+    };
+}
+
+#if defined(GTE_MATRIX_SIMD_SSE2) || defined(GTE_MATRIX_SIMD_NEON)
+
+namespace Vector_GM
+{
+    // The register operations on the 4 components of a quaternion.
+    template <typename Real>
+    struct QuaternionSIMDQuad;
+
+    template <>
+    struct QuaternionSIMDQuad<float>
+    {
+#if defined(GTE_MATRIX_SIMD_SSE2)
+        using Register = __m128;
+
+        inline static Register Load(float const* p)
+        {
+            return _mm_loadu_ps(p);
+        }
+
+        inline static void Store(Register r, float* p)
+        {
+            _mm_storeu_ps(p, r);
+        }
+
+        inline static Register Broadcast(float s)
+        {
+            return _mm_set1_ps(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return _mm_add_ps(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return _mm_mul_ps(a, b);
+        }
+
+        inline static Register Div(Register a, Register b)
+        {
+            return _mm_div_ps(a, b);
+        }
+
+        template <bool N0, bool N1, bool N2, bool N3>
+        inline static Register Negate(Register a)
+        {
+            return _mm_xor_ps(a, _mm_setr_ps(N0 ? -0.0f : 0.0f, N1 ? -0.0f : 0.0f,
+                N2 ? -0.0f : 0.0f, N3 ? -0.0f : 0.0f));
+        }
+
+        // (a[1],a[0],a[3],a[2])
+        inline static Register SwapPairs(Register a)
+        {
+            return _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+
+        // (a[2],a[3],a[0],a[1])
+        inline static Register SwapHalves(Register a)
+        {
+            return _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 0, 3, 2));
+        }
+#else
+        using Register = float32x4_t;
+
+        inline static Register Load(float const* p)
+        {
+            return vld1q_f32(p);
+        }
+
+        inline static void Store(Register r, float* p)
+        {
+            vst1q_f32(p, r);
+        }
+
+        inline static Register Broadcast(float s)
+        {
+            return vdupq_n_f32(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return vaddq_f32(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return vmulq_f32(a, b);
+        }
+
+        inline static Register Div(Register a, Register b)
+        {
+            return vdivq_f32(a, b);
+        }
+
+        template <bool N0, bool N1, bool N2, bool N3>
+        inline static Register Negate(Register a)
+        {
+            uint32_t const mask[4] =
+            {
+                N0 ? 0x80000000u : 0u,
+                N1 ? 0x80000000u : 0u,
+                N2 ? 0x80000000u : 0u,
+                N3 ? 0x80000000u : 0u
+            };
+            return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), vld1q_u32(mask)));
+        }
+
+        inline static Register SwapPairs(Register a)
+        {
+            return vrev64q_f32(a);
+        }
+
+        inline static Register SwapHalves(Register a)
+        {
+            return vextq_f32(a, a, 2);
+        }
+#endif
+    };
+
+    template <>
+    struct QuaternionSIMDQuad<double>
+    {
+#if defined(GTE_MATRIX_SIMD_AVX)
+        using Register = __m256d;
+
+        inline static Register Load(double const* p)
+        {
+            return _mm256_loadu_pd(p);
+        }
+
+        inline static void Store(Register r, double* p)
+        {
+            _mm256_storeu_pd(p, r);
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return _mm256_set1_pd(s);
+        }
+
+        inline static Register Add(Register a, Register b)
+        {
+            return _mm256_add_pd(a, b);
+        }
+
+        inline static Register Mul(Register a, Register b)
+        {
+            return _mm256_mul_pd(a, b);
+        }
+
+        inline static Register Div(Register a, Register b)
+        {
+            return _mm256_div_pd(a, b);
+        }
+
+        template <bool N0, bool N1, bool N2, bool N3>
+        inline static Register Negate(Register a)
+        {
+            return _mm256_xor_pd(a, _mm256_setr_pd(N0 ? -0.0 : 0.0, N1 ? -0.0 : 0.0,
+                N2 ? -0.0 : 0.0, N3 ? -0.0 : 0.0));
+        }
+
+        inline static Register SwapPairs(Register a)
+        {
+            return _mm256_permute_pd(a, 0x5);
+        }
+
+        inline static Register SwapHalves(Register a)
+        {
+            return _mm256_permute2f128_pd(a, a, 0x1);
+        }
+#else
+        // Components 0 and 1 are in lo, components 2 and 3 are in hi.
+        struct Register
+        {
+            MatrixSIMDDouble2::Register lo, hi;
+        };
+
+        using D2 = MatrixSIMDDouble2;
+
+        inline static Register Load(double const* p)
+        {
+            return Register{ D2::Load(p), D2::Load(p + 2) };
+        }
+
+        inline static void Store(Register const& r, double* p)
+        {
+            D2::Store(r.lo, p);
+            D2::Store(r.hi, p + 2);
+        }
+
+        inline static Register Broadcast(double s)
+        {
+            return Register{ D2::Broadcast(s), D2::Broadcast(s) };
+        }
+
+        inline static Register Add(Register const& a, Register const& b)
+        {
+            return Register{ D2::Add(a.lo, b.lo), D2::Add(a.hi, b.hi) };
+        }
+
+        inline static Register Mul(Register const& a, Register const& b)
+        {
+            return Register{ D2::Mul(a.lo, b.lo), D2::Mul(a.hi, b.hi) };
+        }
+
+        inline static Register Div(Register const& a, Register const& b)
+        {
+            return Register{ D2::Div(a.lo, b.lo), D2::Div(a.hi, b.hi) };
+        }
+
+        template <bool N0, bool N1, bool N2, bool N3>
+        inline static Register Negate(Register const& a)
+        {
+            return Register{ D2::Negate(a.lo, N0, N1), D2::Negate(a.hi, N2, N3) };
+        }
+
+        inline static Register SwapPairs(Register const& a)
+        {
+            return Register{ D2::Swap(a.lo), D2::Swap(a.hi) };
+        }
+
+        inline static Register SwapHalves(Register const& a)
+        {
+            return Register{ a.hi, a.lo };
+        }
+#endif
+    };
+
+    template <typename Real>
+    struct QuaternionSIMDKernels
+    {
+        static bool constexpr supported = true;
+
+        using Quad = QuaternionSIMDQuad<Real>;
+
+        // result = q0*q1; the terms of the components are listed with
+        // operator* in Quaternion.h.
+        inline static void Multiply(Real const* q0, Real const* q1, Real* result)
+        {
+            typename Quad::Register const v1 = Quad::Load(q1);
+            typename Quad::Register const halves = Quad::SwapHalves(v1);
+
+            // +x0*w1, -x0*z1, +x0*y1, -x0*x1
+            typename Quad::Register sum = Quad::template Negate<false, true, false, true>(
+                Quad::Mul(Quad::Broadcast(q0[0]), Quad::SwapPairs(halves)));
+
+            // +y0*z1, +y0*w1, -y0*x1, -y0*y1
+            sum = Quad::Add(sum, Quad::template Negate<false, false, true, true>(
+                Quad::Mul(Quad::Broadcast(q0[1]), halves)));
+
+            // -z0*y1, +z0*x1, +z0*w1, -z0*z1
+            sum = Quad::Add(sum, Quad::template Negate<true, false, false, true>(
+                Quad::Mul(Quad::Broadcast(q0[2]), Quad::SwapPairs(v1))));
+
+            // +w0*x1, +w0*y1, +w0*z1, +w0*w1
+            sum = Quad::Add(sum, Quad::Mul(Quad::Broadcast(q0[3]), v1));
+
+            Quad::Store(sum, result);
+        }
+
+        // The Normalize function of Quaternion.h.
+        inline static Real Normalize(Real* q)
+        {
+            typename Quad::Register const v = Quad::Load(q);
+            Real squares[4];
+            Quad::Store(Quad::Mul(v, v), squares);
+            Real sqrLength = squares[0];
+            sqrLength += squares[1];
+            sqrLength += squares[2];
+            sqrLength += squares[3];
+
+            Real length = std::sqrt(sqrLength);
+            if (length > (Real)0)
+            {
+                Quad::Store(Quad::Div(v, Quad::Broadcast(length)), q);
+            }
+            else
+            {
+                for (int32_t i = 0; i < 4; ++i)
+                {
+                    q[i] = (Real)0;
+                }
+            }
+            return length;
+        }
+    };
+
+    template <>
+    struct QuaternionSIMD<float> : public QuaternionSIMDKernels<float>
+    {
+    };
+
+    template <>
+    struct QuaternionSIMD<double> : public QuaternionSIMDKernels<double>
+    {
+    };
+}
+
+#endif
@@ -8,8 +8,8 @@
 #pragma once
 
 #include <Mathematics/IntrAlignedBox2AlignedBox2.h>
-#include <Mathematics/EdgeKey.h>
-#include <set>
+#include <Mathematics/IndexPairSet.h>
+#include <algorithm>
 #include <vector>
 
 namespace gte
@@ -75,12 +75,18 @@ namespace gte
                 mYLookup[2 * static_cast<size_t>(mYEndpoints[j].index) + static_cast<size_t>(mYEndpoints[j].type)] = j;
             }
 
-            // Active set of rectangles (stored by index in array).
-            std::set<int32_t> active;
+            // Active set of rectangles (stored by index in array). The
+            // position of each active rectangle in the array supports
+            // constant-time removal by moving the last active rectangle to
+            // its position.
+            std::vector<int32_t> active{}, position(intrSize);
+            active.reserve(intrSize);
 
             // Set of overlapping rectangles (stored by pairs of indices in
-            // array).
-            mOverlap.clear();
+            // array). The previous set is replaced, and the changes are
+            // reported by GetAddedOverlaps() and GetRemovedOverlaps().
+            mOverlap.BeginChanges();
+            mOverlap.Clear();
 
             // Sweep through the endpoints to determine overlapping
             // x-intervals.
@@ -101,23 +107,21 @@ namespace gte
                         AlignedBox2<Real> const& r1 = mRectangles[index];
                         if (r0.max[1] >= r1.min[1] && r0.min[1] <= r1.max[1])
                         {
-                            if (activeIndex < index)
-                            {
-                                mOverlap.insert(EdgeKey<false>(activeIndex, index));
-                            }
-                            else
-                            {
-                                mOverlap.insert(EdgeKey<false>(index, activeIndex));
-                            }
+                            mOverlap.Insert(activeIndex, index);
                         }
                     }
-                    active.insert(index);
+                    position[index] = static_cast<int32_t>(active.size());
+                    active.push_back(index);
                 }
                 else  // an interval 'end' value
                 {
-                    active.erase(index);
+                    int32_t const last = active.back();
+                    active[position[index]] = last;
+                    position[last] = position[index];
+                    active.pop_back();
                 }
             }
+            mOverlap.EndChanges();
         }
 
         // After the system is initialized, you can move the rectangles using
@@ -140,23 +144,76 @@ namespace gte
             rectangle = mRectangles[i];
         }
 
+        // Move the rectangles first <= i < first + numRectangles, where the
+        // extremes of rectangle i are stored in the arrays at index
+        // i - first. This is equivalent to calling SetRectangle for each
+        // rectangle, but the coordinates are read from separate arrays,
+        // which is convenient when the caller stores positions and radii as
+        // structures of arrays.
+        void SetRectangles(int32_t first, int32_t numRectangles,
+            Real const* xMin, Real const* yMin, Real const* xMax, Real const* yMax)
+        {
+            LogAssert(first >= 0 && numRectangles >= 0 &&
+                static_cast<size_t>(first) + static_cast<size_t>(numRectangles) <= mRectangles.size(),
+                "Invalid range of rectangles.");
+
+            for (int32_t k = 0; k < numRectangles; ++k)
+            {
+                size_t const i = static_cast<size_t>(first) + static_cast<size_t>(k);
+                AlignedBox2<Real>& rectangle = mRectangles[i];
+                rectangle.min = { xMin[k], yMin[k] };
+                rectangle.max = { xMax[k], yMax[k] };
+                mXEndpoints[mXLookup[2 * i]].value = xMin[k];
+                mXEndpoints[mXLookup[2 * i + 1]].value = xMax[k];
+                mYEndpoints[mYLookup[2 * i]].value = yMin[k];
+                mYEndpoints[mYLookup[2 * i + 1]].value = yMax[k];
+            }
+        }
+
         // When you are finished moving rectangles, call this function to
         // determine the overlapping rectangles.  An incremental update is
         // applied to determine the new set of overlapping rectangles.
         void Update()
         {
+            mOverlap.BeginChanges();
             InsertionSort(mXEndpoints, mXLookup);
             InsertionSort(mYEndpoints, mYLookup);
+            mOverlap.EndChanges();
         }
 
         // If (i,j) is in the overlap set, then rectangle i and rectangle j
         // are overlapping.  The indices are those for the the input array.
-        // The set elements (i,j) are stored so that i < j.
-        inline std::set<EdgeKey<false>> const& GetOverlap() const
+        // The set elements (i,j) are stored so that i < j and are sorted
+        // lexicographically.  The sorted array is updated by Initialize and
+        // Update, by merging the previous array with the changes, so
+        // GetOverlap does not modify the manager and can be called
+        // concurrently between updates.
+        inline std::vector<EdgeKey<false>> const& GetOverlap() const
+        {
+            return mOverlap.GetSorted();
+        }
+
+        // The overlap set itself, for queries by Contains(i,j) and for
+        // visiting the pairs in an unspecified order by ForEach.
+        inline IndexPairSet const& GetOverlapSet() const
         {
             return mOverlap;
         }
 
+        // The pairs that started or stopped overlapping during the last call
+        // to Initialize or Update, sorted lexicographically.  A consumer that
+        // maintains its own state per pair can process these instead of
+        // rescanning the overlap set.
+        inline std::vector<EdgeKey<false>> const& GetAddedOverlaps() const
+        {
+            return mOverlap.GetAdded();
+        }
+
+        inline std::vector<EdgeKey<false>> const& GetRemovedOverlaps() const
+        {
+            return mOverlap.GetRemoved();
+        }
+
     private:
         class Endpoint
         {
@@ -213,7 +270,7 @@ namespace gte
                             // expensive part of the operation, so there is no
                             // real time savings in testing for existence
                             // first, then deleting if it does.
-                            mOverlap.erase(EdgeKey<false>(e0.index, e1.index));
+                            mOverlap.Erase(e0.index, e1.index);
                         }
                     }
                     else
@@ -228,7 +285,7 @@ namespace gte
                             // and then insert.
                             if (query(mRectangles[e0.index], mRectangles[e1.index]).intersect)
                             {
-                                mOverlap.insert(EdgeKey<false>(e0.index, e1.index));
+                                mOverlap.Insert(e0.index, e1.index);
                             }
                         }
                     }
@@ -247,7 +304,7 @@ namespace gte
 
         std::vector<AlignedBox2<Real>>& mRectangles;
         std::vector<Endpoint> mXEndpoints, mYEndpoints;
-        std::set<EdgeKey<false>> mOverlap;
+        IndexPairSet mOverlap;
 
         // The intervals are indexed 0 <= i < n.  The endpoint array has 2*n
         // entries.  The original 2*n interval values are ordered as
@@ -0,0 +1,403 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/ArbitraryPrecision.h>
+#include <Mathematics/RootsPolynomial.h>
+#include <Mathematics/SymmetricEigensolver3x3Batch.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+
+// The smallest root on an interval [0,tMax] of arrays of quadratic and
+// cubic polynomials, such as the contact-time polynomials of the pairs of
+// a continuous collision detection pass. The coefficients are passed as
+// structure-of-arrays, p0[i] + p1[i]*t + p2[i]*t^2 (+ p3[i]*t^3), and the
+// polynomials are processed in blocks, one polynomial per SIMD lane, using
+// the lane operations of NISymmetricEigensolver3x3Batch. The branches of a
+// scalar solver are replaced by lane selections.
+//
+// The quadratic roots are computed by the closed-form formula that avoids
+// the cancellation of -p1 + sqrt(discriminant). For a cubic, the roots of
+// the derivative split [0,tMax] into at most three intervals on which the
+// cubic is monotonic. The first interval whose endpoint values have
+// different signs brackets the smallest root, which is computed by Newton's
+// method safeguarded by bisection.
+//
+// Floating-point rounding errors can change the classification of a root:
+// a double root can become two roots or none, and a root near 0 or tMax
+// can move into or out of the interval. A lane is marked as not robust
+// when the classification is within the rounding errors, when the leading
+// coefficients are too small for the closed-form formulas or when the
+// iteration does not converge. Call SmallestRootExact for those lanes; it
+// classifies the roots with rational arithmetic.
+//
+//   size_t numUncertain = RootsPolynomialBatch<double>::SmallestRootQuadratic(
+//       n, p0, p1, p2, tMax, root, robust);
+//   for (size_t i = 0; numUncertain > 0 && i < n; ++i)
+//   {
+//       if (!robust[i])
+//       {
+//           root[i] = RootsPolynomialBatch<double>::SmallestRootExact(
+//               p0[i], p1[i], p2[i], 0.0, tMax);
+//       }
+//   }
+
+namespace gte
+{
+    template <typename T>
+    class RootsPolynomialBatch
+    {
+    public:
+        using Lanes = NISymmetricEigensolver3x3Lanes<T>;
+        static size_t constexpr batchSize = Lanes::numLanes;
+
+        // The value of root[i] when the polynomial has no root on [0,tMax].
+        static T constexpr noRoot = std::numeric_limits<T>::max();
+
+        // On return, root[i] is the smallest root of polynomial i on
+        // [0,tMax], or noRoot, and robust[i] is false when the root must be
+        // computed by SmallestRootExact. The functions return the number of
+        // polynomials that are not robust. The input tMax must be positive.
+        static size_t SmallestRootQuadratic(size_t numPolynomials, T const* p0,
+            T const* p1, T const* p2, T tMax, T* root, bool* robust)
+        {
+            size_t numUncertain = 0;
+            for (size_t first = 0; first < numPolynomials; first += batchSize)
+            {
+                size_t const count = std::min(batchSize, numPolynomials - first);
+                Register r0, r1, r2;
+                LoadBlock(count, p0 + first, one, r0);
+                LoadBlock(count, p1 + first, zero, r1);
+                LoadBlock(count, p2 + first, zero, r2);
+
+                Register rRoot, rRobust;
+                QuadraticBlock(r0, r1, r2, Lanes::Set(tMax), rRoot, rRobust);
+                numUncertain += StoreBlock(count, rRoot, rRobust, root + first, robust + first);
+            }
+            return numUncertain;
+        }
+
+        static size_t SmallestRootCubic(size_t numPolynomials, T const* p0,
+            T const* p1, T const* p2, T const* p3, T tMax, T* root, bool* robust)
+        {
+            size_t numUncertain = 0;
+            for (size_t first = 0; first < numPolynomials; first += batchSize)
+            {
+                size_t const count = std::min(batchSize, numPolynomials - first);
+                Register r0, r1, r2, r3;
+                LoadBlock(count, p0 + first, one, r0);
+                LoadBlock(count, p1 + first, zero, r1);
+                LoadBlock(count, p2 + first, zero, r2);
+                LoadBlock(count, p3 + first, zero, r3);
+
+                Register rRoot, rRobust;
+                CubicBlock(r0, r1, r2, r3, Lanes::Set(tMax), rRoot, rRobust);
+                numUncertain += StoreBlock(count, rRoot, rRobust, root + first, robust + first);
+            }
+            return numUncertain;
+        }
+
+        // The smallest root of p0 + p1*t + p2*t^2 + p3*t^3 on [0,tMax], or
+        // noRoot, using the rational classification of the roots by
+        // RootsPolynomial. Pass p3 = 0 for a quadratic. The roots at 0 and
+        // tMax are detected exactly; the others are rounded to T. When the
+        // polynomial is identically zero, the function returns 0.
+        static T SmallestRootExact(T p0, T p1, T p2, T p3, T tMax)
+        {
+            using Rational = BSRational<UIntegerAP32>;
+
+            if (p0 == zero)
+            {
+                return zero;
+            }
+
+            std::map<T, int32_t> rmMap;
+            if (p3 != zero)
+            {
+                RootsPolynomial<T>::template SolveCubic<Rational>(p0, p1, p2, p3, rmMap);
+            }
+            else if (p2 != zero)
+            {
+                RootsPolynomial<T>::template SolveQuadratic<Rational>(p0, p1, p2, rmMap);
+            }
+            else if (p1 != zero)
+            {
+                Rational const rRoot = -Rational(p0) / Rational(p1);
+                rmMap.insert(std::make_pair(static_cast<T>(rRoot), 1));
+            }
+            else
+            {
+                return noRoot;
+            }
+
+            // The map is sorted by increasing root.
+            for (auto const& rm : rmMap)
+            {
+                if (zero <= rm.first && rm.first <= tMax)
+                {
+                    return rm.first;
+                }
+            }
+
+            // A root at tMax can be rounded out of the interval.
+            Rational const rT = tMax;
+            Rational const value = ((Rational(p3) * rT + Rational(p2)) * rT + Rational(p1)) * rT + Rational(p0);
+            return (value.GetSign() == 0 ? tMax : noRoot);
+        }
+
+    private:
+        using Register = typename Lanes::Register;
+        using Mask = typename Lanes::Mask;
+        using Buffer = std::array<T, batchSize>;
+
+        static T constexpr zero = static_cast<T>(0);
+        static T constexpr one = static_cast<T>(1);
+        static T constexpr epsilon = std::numeric_limits<T>::epsilon();
+
+        // The classification of a lane is not robust when a quantity is
+        // within this multiple of epsilon times its rounding error bound.
+        static T constexpr tolerance = static_cast<T>(64) * epsilon;
+
+        // Newton's method converges in a few iterations; bisection needs
+        // about one per bit of precision.
+        static uint32_t constexpr maxIterations = std::numeric_limits<T>::digits + 8;
+
+        // The last block is padded with the polynomial 1, which has no
+        // roots.
+        static void LoadBlock(size_t count, T const* p, T pad, Register& r)
+        {
+            if (count == batchSize)
+            {
+                r = Lanes::Load(p);
+            }
+            else
+            {
+                Buffer buffer;
+                buffer.fill(pad);
+                std::copy(p, p + count, buffer.begin());
+                r = Lanes::Load(buffer.data());
+            }
+        }
+
+        // The robust flags are stored as 0 or 1 in a register, so they are
+        // combined by Mul (and) and Max (or).
+        static size_t StoreBlock(size_t count, Register const& rRoot, Register const& rRobust,
+            T* root, bool* robust)
+        {
+            Buffer bRoot, bRobust;
+            Lanes::Store(rRoot, bRoot.data());
+            Lanes::Store(rRobust, bRobust.data());
+            size_t numUncertain = 0;
+            for (size_t j = 0; j < count; ++j)
+            {
+                root[j] = bRoot[j];
+                robust[j] = (bRobust[j] != zero);
+                numUncertain += (robust[j] ? 0 : 1);
+            }
+            return numUncertain;
+        }
+
+        inline static Register Flag(Mask m)
+        {
+            return Lanes::Select(m, Lanes::Set(one), Lanes::Set(zero));
+        }
+
+        inline static Register Evaluate(Register const& p0, Register const& p1,
+            Register const& p2, Register const& p3, Register const& t)
+        {
+            return Lanes::Add(p0, Lanes::Mul(t, Lanes::Add(p1, Lanes::Mul(t,
+                Lanes::Add(p2, Lanes::Mul(t, p3))))));
+        }
+
+        // The bound |p0| + |p1|*t + |p2|*t^2 + |p3|*t^3 for t >= 0. The
+        // rounding error of Evaluate is at most 6*epsilon times the bound.
+        inline static Register EvaluateBound(Register const& p0, Register const& p1,
+            Register const& p2, Register const& p3, Register const& t)
+        {
+            return Evaluate(Lanes::Abs(p0), Lanes::Abs(p1), Lanes::Abs(p2), Lanes::Abs(p3), t);
+        }
+
+        // The roots r0 <= r1 of p0 + p1*t + p2*t^2 when the discriminant is
+        // nonnegative. The flag 'real' is 1 when the discriminant is
+        // nonnegative and 'certain' is 1 when the sign of the discriminant
+        // is not within its rounding error. Lanes with p2 = 0 have one
+        // infinite root and lanes with p0 = p1 = 0 have NaN roots.
+        static void QuadraticRoots(Register const& p0, Register const& p1,
+            Register const& p2, Register& r0, Register& r1, Register& real,
+            Register& certain)
+        {
+            Register const rZero = Lanes::Set(zero);
+            Register const p1Sqr = Lanes::Mul(p1, p1);
+            Register const p0p2 = Lanes::Mul(Lanes::Set(static_cast<T>(4)), Lanes::Mul(p0, p2));
+            Register const discr = Lanes::Sub(p1Sqr, p0p2);
+            Register const discrError = Lanes::Mul(Lanes::Set(tolerance),
+                Lanes::Add(p1Sqr, Lanes::Abs(p0p2)));
+            real = Flag(Lanes::GreaterEqual(discr, rZero));
+            certain = Flag(Lanes::Greater(Lanes::Abs(discr), discrError));
+
+            // q = -(p1 + sign(p1)*sqrt(discr))/2, r = q/p2 and p0/q.
+            Register const root = Lanes::Sqrt(Lanes::Max(discr, rZero));
+            Register const signedRoot = Lanes::Select(Lanes::GreaterEqual(p1, rZero),
+                root, Lanes::Negate(root));
+            Register const q = Lanes::Mul(Lanes::Set(static_cast<T>(-0.5)), Lanes::Add(p1, signedRoot));
+            Register const s0 = Lanes::Div(q, p2);
+            Register const s1 = Lanes::Div(p0, q);
+            r0 = Lanes::Min(s0, s1);
+            r1 = Lanes::Max(s0, s1);
+        }
+
+        static void QuadraticBlock(Register const& p0, Register const& p1,
+            Register const& p2, Register const& tMax, Register& root, Register& robust)
+        {
+            Register const rZero = Lanes::Set(zero);
+            Register const rNoRoot = Lanes::Set(noRoot);
+
+            Register r0, r1, real, certain;
+            QuadraticRoots(p0, p1, p2, r0, r1, real, certain);
+
+            // The first root in [0,tMax].
+            Register const in0 = Lanes::Mul(Flag(Lanes::GreaterEqual(r0, rZero)),
+                Flag(Lanes::GreaterEqual(tMax, r0)));
+            Register const in1 = Lanes::Mul(Flag(Lanes::GreaterEqual(r1, rZero)),
+                Flag(Lanes::GreaterEqual(tMax, r1)));
+            Register const half = Lanes::Set(static_cast<T>(0.5));
+            root = Lanes::Select(Lanes::Greater(in1, half), r1, rNoRoot);
+            root = Lanes::Select(Lanes::Greater(in0, half), r0, root);
+            root = Lanes::Select(Lanes::Greater(real, half), root, rNoRoot);
+
+            // The formulas are not robust when p2*tMax^2 is small compared
+            // to the other terms, including p2 = 0. A root is not robust
+            // when it is near 0 or tMax, except for the exact root 0 of
+            // p0 = 0.
+            Register const bound = EvaluateBound(p0, p1, p2, rZero, tMax);
+            Register const relative = Lanes::Mul(Lanes::Set(tolerance), bound);
+            Register const leading = Lanes::Mul(Lanes::Abs(p2), Lanes::Mul(tMax, tMax));
+            Register const nearError = Lanes::Mul(Lanes::Set(tolerance), tMax);
+            Register const nearZero = Lanes::Mul(Flag(Lanes::Greater(nearError, Lanes::Abs(root))),
+                Flag(Lanes::Greater(Lanes::Abs(p0), rZero)));
+            Register const nearMax = Flag(Lanes::Greater(nearError, Lanes::Abs(Lanes::Sub(root, tMax))));
+            robust = Lanes::Mul(certain, Flag(Lanes::Greater(leading, relative)));
+            robust = Lanes::Mul(robust, Lanes::Sub(Lanes::Set(one), Lanes::Max(nearZero, nearMax)));
+        }
+
+        static void CubicBlock(Register const& p0, Register const& p1,
+            Register const& p2, Register const& p3, Register const& tMax,
+            Register& root, Register& robust)
+        {
+            Register const rZero = Lanes::Set(zero);
+            Register const rOne = Lanes::Set(one);
+            Register const half = Lanes::Set(static_cast<T>(0.5));
+
+            // The critical points are the roots of the derivative
+            // p1 + 2*p2*t + 3*p3*t^2, clamped to [0,tMax]. The cubic is
+            // monotonic on [0,a], [a,b] and [b,tMax]. When p3 = 0, one root
+            // is infinite and is clamped to tMax.
+            Register const d1 = Lanes::Add(p2, p2);
+            Register const d2 = Lanes::Mul(Lanes::Set(static_cast<T>(3)), p3);
+            Register c0, c1, real, certain;
+            QuadraticRoots(p1, d1, d2, c0, c1, real, certain);
+            Mask const hasCritical = Lanes::Greater(real, half);
+            Register const numeric = Lanes::Mul(Flag(Lanes::GreaterEqual(c0, c0)),
+                Flag(Lanes::GreaterEqual(c1, c1)));
+            Register a = Lanes::Select(Lanes::Greater(numeric, half), c0, tMax);
+            Register b = Lanes::Select(Lanes::Greater(numeric, half), c1, tMax);
+            a = Lanes::Select(hasCritical, Lanes::Max(Lanes::Min(a, tMax), rZero), tMax);
+            b = Lanes::Select(hasCritical, Lanes::Max(Lanes::Min(b, tMax), rZero), tMax);
+
+            Register const f0 = p0;
+            Register const fa = Evaluate(p0, p1, p2, p3, a);
+            Register const fb = Evaluate(p0, p1, p2, p3, b);
+            Register const fMax = Evaluate(p0, p1, p2, p3, tMax);
+
+            // The first interval whose endpoint values have different signs
+            // brackets the smallest root.
+            Register const sign0a = Flag(Lanes::GreaterEqual(rZero, Lanes::Mul(f0, fa)));
+            Register const signab = Flag(Lanes::GreaterEqual(rZero, Lanes::Mul(fa, fb)));
+            Register const signbMax = Flag(Lanes::GreaterEqual(rZero, Lanes::Mul(fb, fMax)));
+            Register tLo = Lanes::Select(Lanes::Greater(signbMax, half), b, rZero);
+            Register tHi = Lanes::Select(Lanes::Greater(signbMax, half), tMax, rZero);
+            Register fLo = Lanes::Select(Lanes::Greater(signbMax, half), fb, rOne);
+            tLo = Lanes::Select(Lanes::Greater(signab, half), a, tLo);
+            tHi = Lanes::Select(Lanes::Greater(signab, half), b, tHi);
+            fLo = Lanes::Select(Lanes::Greater(signab, half), fa, fLo);
+            tLo = Lanes::Select(Lanes::Greater(sign0a, half), rZero, tLo);
+            tHi = Lanes::Select(Lanes::Greater(sign0a, half), a, tHi);
+            fLo = Lanes::Select(Lanes::Greater(sign0a, half), f0, fLo);
+            Register const found = Lanes::Max(sign0a, Lanes::Max(signab, signbMax));
+
+            // Newton's method from the midpoint, bisecting when a step
+            // leaves the bracket. The lanes without a root iterate on the
+            // empty bracket [0,0].
+            Mask const rootAtLo = Lanes::GreaterEqual(rZero, Lanes::Abs(fLo));
+            Register t = Lanes::Select(rootAtLo, tLo, Lanes::Mul(half, Lanes::Add(tLo, tHi)));
+            Register converged = Lanes::Max(Flag(Lanes::GreaterEqual(tLo, tHi)), Flag(rootAtLo));
+            Register const stepError = Lanes::Mul(Lanes::Set(static_cast<T>(4) * epsilon), tMax);
+            Register const e1 = Lanes::Add(p2, p2);
+            Register const e2 = Lanes::Mul(Lanes::Set(static_cast<T>(3)), p3);
+            for (uint32_t iteration = 0; iteration < maxIterations; ++iteration)
+            {
+                Register const f = Evaluate(p0, p1, p2, p3, t);
+                Register const df = Lanes::Add(p1, Lanes::Mul(t, Lanes::Add(e1, Lanes::Mul(t, e2))));
+
+                // Shrink the bracket; f(tLo) and f(t) have the same sign
+                // when t replaces tLo.
+                Mask const sameSign = Lanes::Greater(Lanes::Mul(f, fLo), rZero);
+                tLo = Lanes::Select(sameSign, t, tLo);
+                fLo = Lanes::Select(sameSign, f, fLo);
+                tHi = Lanes::Select(sameSign, tHi, t);
+
+                Register next = Lanes::Sub(t, Lanes::Div(f, df));
+                Register const inside = Lanes::Mul(Flag(Lanes::Greater(next, tLo)),
+                    Flag(Lanes::Greater(tHi, next)));
+                next = Lanes::Select(Lanes::Greater(inside, half), next,
+                    Lanes::Mul(half, Lanes::Add(tLo, tHi)));
+
+                // An exact root ends the iteration at t; otherwise t moves
+                // to the next estimate, and the iteration ends when the
+                // step is within the rounding error.
+                Register const isRoot = Flag(Lanes::GreaterEqual(rZero, Lanes::Abs(f)));
+                Register const step = Lanes::Abs(Lanes::Sub(next, t));
+                converged = Lanes::Max(converged, isRoot);
+                t = Lanes::Select(Lanes::Greater(converged, half), t, next);
+                converged = Lanes::Max(converged, Flag(Lanes::GreaterEqual(stepError, step)));
+
+                Buffer bConverged;
+                Lanes::Store(converged, bConverged.data());
+                if (std::all_of(bConverged.begin(), bConverged.end(),
+                    [](T const& value) { return value != zero; }))
+                {
+                    break;
+                }
+            }
+            root = Lanes::Select(Lanes::Greater(found, half), t, Lanes::Set(noRoot));
+
+            // The signs are not robust when the values at the critical points
+            // and at tMax are within their rounding errors, which includes
+            // the double roots, and when the critical points are. A root is
+            // not robust near 0 unless p0 = 0.
+            Register const rTolerance = Lanes::Set(tolerance);
+            Register const errorA = Lanes::Mul(rTolerance, EvaluateBound(p0, p1, p2, p3, a));
+            Register const errorB = Lanes::Mul(rTolerance, EvaluateBound(p0, p1, p2, p3, b));
+            Register const errorMax = Lanes::Mul(rTolerance, EvaluateBound(p0, p1, p2, p3, tMax));
+            robust = Lanes::Mul(converged, Flag(Lanes::Greater(Lanes::Abs(fa), errorA)));
+            robust = Lanes::Mul(robust, Flag(Lanes::Greater(Lanes::Abs(fb), errorB)));
+            robust = Lanes::Mul(robust, Flag(Lanes::Greater(Lanes::Abs(fMax), errorMax)));
+            robust = Lanes::Mul(robust, Lanes::Max(certain, Lanes::Sub(rOne, real)));
+            robust = Lanes::Mul(robust, Lanes::Max(numeric, Lanes::Sub(rOne, real)));
+            Register const nearZero = Lanes::Mul(
+                Flag(Lanes::Greater(Lanes::Mul(rTolerance, tMax), Lanes::Abs(root))),
+                Flag(Lanes::Greater(Lanes::Abs(p0), rZero)));
+            robust = Lanes::Mul(robust, Lanes::Sub(rOne, nearZero));
+        }
+    };
+}
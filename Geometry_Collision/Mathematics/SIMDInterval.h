@@ -0,0 +1,248 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+// Interval arithmetic on doubles for filtered predicates, with the interval
+// [e0,e1] stored as the pair (-e0,e1) in one SIMD register (SSE2 or NEON;
+// other targets use two doubles). With the lower endpoint negated, both
+// lanes are upper bounds, so one rounding direction suffices: every
+// operation evaluates the two lanes in the default round-to-nearest mode and
+// then rounds both upward by
+//   RoundUp(x) = max(x + (|x| * 2^{-50} + DBL_MIN), x)
+// which exceeds the rounded x by more than the rounding error of the
+// operation, also for subnormal results and when subnormals are flushed to
+// zero. There are no changes of the rounding mode as for FPInterval and no
+// calls of std::nextafter per endpoint as for SWInterval, so an operation is
+// a few SIMD instructions. The intervals are a few ulps wider than those of
+// FPInterval, which does not matter for sign filters.
+//
+// An overflow or an invalid operation makes the interval non-finite, which
+// is preserved by all later operations, so GetSign returns 0 (sign unknown)
+// in that case rather than a sign from invalid bounds.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GTE_SIMD_INTERVAL_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GTE_SIMD_INTERVAL_NEON
+#include <arm_neon.h>
+#endif
+
+namespace gte
+{
+    class SIMDInterval
+    {
+    public:
+        // Construction. SIMDInterval(e) is the degenerate interval [e,e],
+        // which is exact. Use Enclose for a number that was rounded to
+        // double.
+        SIMDInterval()
+            :
+            mValue(Make(0.0, 0.0))
+        {
+        }
+
+        explicit SIMDInterval(double e)
+            :
+            mValue(Make(-e, e))
+        {
+        }
+
+        SIMDInterval(double e0, double e1)
+            :
+            mValue(Make(-e0, e1))
+        {
+#if defined(GTE_THROW_ON_INVALID_INTERVAL)
+            LogAssert(e0 <= e1, "Invalid SIMDInterval.");
+#endif
+        }
+
+        // An interval that contains the number from which e was rounded.
+        static SIMDInterval Enclose(double e)
+        {
+            return SIMDInterval(RoundUp(Make(-e, e)));
+        }
+
+        // Member access. The endpoints are read-only.
+        inline double operator[](size_t i) const
+        {
+            return (i == 0 ? -GetLane0(mValue) : GetLane1(mValue));
+        }
+
+        // The sign of the numbers in the interval when it does not contain
+        // zero and is finite, or 0 when the sign cannot be determined.
+        int32_t GetSign() const
+        {
+            double const e0 = operator[](0), e1 = operator[](1);
+            if (std::isfinite(e0) && std::isfinite(e1))
+            {
+                return (e0 > 0.0 ? +1 : (e1 < 0.0 ? -1 : 0));
+            }
+            return 0;
+        }
+
+        // Arithmetic.
+        friend SIMDInterval operator+(SIMDInterval const& u)
+        {
+            return u;
+        }
+
+        friend SIMDInterval operator-(SIMDInterval const& u)
+        {
+            // -[e0,e1] = [-e1,-e0] is stored as (e1,-e0), the swapped pair.
+            return SIMDInterval(Swap(u.mValue));
+        }
+
+        friend SIMDInterval operator+(SIMDInterval const& u, SIMDInterval const& v)
+        {
+            // (-u0 - v0, u1 + v1)
+            return SIMDInterval(RoundUp(Add(u.mValue, v.mValue)));
+        }
+
+        friend SIMDInterval operator-(SIMDInterval const& u, SIMDInterval const& v)
+        {
+            // [u0 - v1, u1 - v0] is (-u0 + v1, u1 - v0).
+            return SIMDInterval(RoundUp(Add(u.mValue, Swap(v.mValue))));
+        }
+
+        friend SIMDInterval operator*(SIMDInterval const& u, SIMDInterval const& v)
+        {
+            // The endpoint products, each rounded up in both directions:
+            //   p = (u0*v0, u1*v1), q = (-u0*v1, -u1*v0)
+            // upper = max(u0*v0, u1*v1, u0*v1, u1*v0) from p and -q,
+            // -lower = max(-u0*v0, -u1*v1, -u0*v1, -u1*v0) from -p and q.
+            // Products are rounded before the maximum, which is exact, so
+            // the endpoints of the maximum are bounds.
+            Register const p = Mul(u.mValue, v.mValue);
+            Register const q = Mul(u.mValue, Swap(v.mValue));
+            Register const upper = Max(RoundUp(p), RoundUp(Negate(q)));
+            Register const negLower = Max(RoundUp(Negate(p)), RoundUp(q));
+
+            // (max(negLower), max(upper)) with the lanes paired.
+            Register const result = Max(
+                Make(GetLane0(negLower), GetLane0(upper)),
+                Make(GetLane1(negLower), GetLane1(upper)));
+
+            // Max discards a NaN operand, so non-finite factors are
+            // propagated explicitly: x - x is 0 for finite x and NaN
+            // otherwise.
+            Register const poison = Add(Sub(u.mValue, u.mValue), Sub(v.mValue, v.mValue));
+            return SIMDInterval(Add(result, Add(poison, Swap(poison))));
+        }
+
+        // The square root of the nonnegative part of the interval.
+        friend SIMDInterval Sqrt(SIMDInterval const& u)
+        {
+            double const e0 = std::max(u[0], 0.0);
+            double const e1 = u[1];
+            Register const root = Sqrt(Make(e0, e1));
+            return SIMDInterval(RoundUp(Make(-GetLane0(root), GetLane1(root))));
+        }
+
+        friend SIMDInterval& operator+=(SIMDInterval& u, SIMDInterval const& v)
+        {
+            u = u + v;
+            return u;
+        }
+
+        friend SIMDInterval& operator-=(SIMDInterval& u, SIMDInterval const& v)
+        {
+            u = u - v;
+            return u;
+        }
+
+        friend SIMDInterval& operator*=(SIMDInterval& u, SIMDInterval const& v)
+        {
+            u = u * v;
+            return u;
+        }
+
+    private:
+#if defined(GTE_SIMD_INTERVAL_SSE2)
+        using Register = __m128d;
+
+        inline static Register Make(double x0, double x1) { return _mm_set_pd(x1, x0); }
+        inline static double GetLane0(Register r) { return _mm_cvtsd_f64(r); }
+        inline static double GetLane1(Register r) { return _mm_cvtsd_f64(_mm_unpackhi_pd(r, r)); }
+        inline static Register Swap(Register r) { return _mm_shuffle_pd(r, r, 1); }
+        inline static Register Add(Register a, Register b) { return _mm_add_pd(a, b); }
+        inline static Register Sub(Register a, Register b) { return _mm_sub_pd(a, b); }
+        inline static Register Mul(Register a, Register b) { return _mm_mul_pd(a, b); }
+        inline static Register Max(Register a, Register b) { return _mm_max_pd(a, b); }
+        inline static Register Sqrt(Register a) { return _mm_sqrt_pd(a); }
+        inline static Register Negate(Register a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+        inline static Register Abs(Register a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+#elif defined(GTE_SIMD_INTERVAL_NEON)
+        using Register = float64x2_t;
+
+        inline static Register Make(double x0, double x1) { return vsetq_lane_f64(x1, vdupq_n_f64(x0), 1); }
+        inline static double GetLane0(Register r) { return vgetq_lane_f64(r, 0); }
+        inline static double GetLane1(Register r) { return vgetq_lane_f64(r, 1); }
+        inline static Register Swap(Register r) { return vextq_f64(r, r, 1); }
+        inline static Register Add(Register a, Register b) { return vaddq_f64(a, b); }
+        inline static Register Sub(Register a, Register b) { return vsubq_f64(a, b); }
+        inline static Register Mul(Register a, Register b) { return vmulq_f64(a, b); }
+        inline static Register Sqrt(Register a) { return vsqrtq_f64(a); }
+        inline static Register Negate(Register a) { return vnegq_f64(a); }
+        inline static Register Abs(Register a) { return vabsq_f64(a); }
+
+        // vmaxq_f64 returns NaN for a NaN operand, whereas Max must return
+        // the second operand like _mm_max_pd.
+        inline static Register Max(Register a, Register b)
+        {
+            return vbslq_f64(vcgtq_f64(a, b), a, b);
+        }
+#else
+        struct Register
+        {
+            double x0, x1;
+        };
+
+        inline static Register Make(double x0, double x1) { return Register{ x0, x1 }; }
+        inline static double GetLane0(Register r) { return r.x0; }
+        inline static double GetLane1(Register r) { return r.x1; }
+        inline static Register Swap(Register r) { return Register{ r.x1, r.x0 }; }
+        inline static Register Add(Register a, Register b) { return Register{ a.x0 + b.x0, a.x1 + b.x1 }; }
+        inline static Register Sub(Register a, Register b) { return Register{ a.x0 - b.x0, a.x1 - b.x1 }; }
+        inline static Register Mul(Register a, Register b) { return Register{ a.x0 * b.x0, a.x1 * b.x1 }; }
+        inline static Register Sqrt(Register a) { return Register{ std::sqrt(a.x0), std::sqrt(a.x1) }; }
+        inline static Register Negate(Register a) { return Register{ -a.x0, -a.x1 }; }
+        inline static Register Abs(Register a) { return Register{ std::fabs(a.x0), std::fabs(a.x1) }; }
+        inline static Register Max(Register a, Register b)
+        {
+            return Register{ a.x0 > b.x0 ? a.x0 : b.x0, a.x1 > b.x1 ? a.x1 : b.x1 };
+        }
+#endif
+
+        explicit SIMDInterval(Register value)
+            :
+            mValue(value)
+        {
+        }
+
+        // The upward rounding of both lanes. The second operand of Max is
+        // returned for a NaN sum, so -infinity is not turned into a NaN.
+        inline static Register RoundUp(Register x)
+        {
+            // The scale is 2^{-50}, written in decimal because hexadecimal
+            // floating-point literals require C++17.
+            Register const scale = Make(8.8817841970012523e-16, 8.8817841970012523e-16);
+            Register const tiny = Make(std::numeric_limits<double>::min(),
+                std::numeric_limits<double>::min());
+            return Max(Add(x, Add(Mul(Abs(x), scale), tiny)), x);
+        }
+
+        Register mValue;
+    };
+}
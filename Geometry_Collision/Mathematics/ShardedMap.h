@@ -0,0 +1,180 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <vector>
+
+// A concurrent map with the interface of ThreadSafeMap. The keys are
+// distributed by hash over a number of shards, each a std::map with its own
+// reader-writer mutex. The mutex is a std::shared_timed_mutex, so the
+// header stays C++14. Operations on keys in different shards do not
+// contend, and Exists and Get on the same shard run concurrently. Key must
+// be hashable by std::hash<Key> and ordered by operator<.
+//
+// HasElements, RemoveAll and GatherAll visit the shards one at a time, so
+// they do not see a snapshot of the map when other threads modify it
+// concurrently. The values of GatherAll are grouped by shard and ordered by
+// key within a shard rather than ordered by key overall.
+
+namespace gte
+{
+    template <typename Key, typename Value>
+    class ShardedMap
+    {
+    public:
+        // Construction and destruction. The number of shards is rounded up
+        // to a power of two. A good choice is a few times the number of
+        // threads that access the map.
+        ShardedMap(size_t numShards = 64)
+            :
+            mMask(0),
+            mShards{}
+        {
+            LogAssert(numShards > 0, "The map must have at least one shard.");
+
+            size_t powerOfTwo = 1;
+            while (powerOfTwo < numShards)
+            {
+                powerOfTwo <<= 1;
+            }
+            mMask = powerOfTwo - 1;
+            mShards = std::make_unique<Shard[]>(powerOfTwo);
+        }
+
+        virtual ~ShardedMap() = default;
+
+        ShardedMap(ShardedMap const&) = delete;
+        ShardedMap& operator=(ShardedMap const&) = delete;
+
+        inline size_t GetNumShards() const
+        {
+            return mMask + 1;
+        }
+
+        // All the operations are thread-safe.
+        bool HasElements() const
+        {
+            for (size_t i = 0; i <= mMask; ++i)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(mShards[i].mutex);
+                if (mShards[i].map.size() > 0)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        bool Exists(Key key) const
+        {
+            Shard const& shard = GetShard(key);
+            std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+            return shard.map.find(key) != shard.map.end();
+        }
+
+        void Insert(Key key, Value value)
+        {
+            Shard& shard = GetShard(key);
+            std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+            shard.map[key] = value;
+        }
+
+        bool Remove(Key key, Value& value)
+        {
+            Shard& shard = GetShard(key);
+            std::unique_lock<std::shared_timed_mutex> lock(shard.mutex);
+            auto iter = shard.map.find(key);
+            if (iter != shard.map.end())
+            {
+                value = iter->second;
+                shard.map.erase(iter);
+                return true;
+            }
+            return false;
+        }
+
+        void RemoveAll()
+        {
+            for (size_t i = 0; i <= mMask; ++i)
+            {
+                std::unique_lock<std::shared_timed_mutex> lock(mShards[i].mutex);
+                mShards[i].map.clear();
+            }
+        }
+
+        bool Get(Key key, Value& value) const
+        {
+            Shard const& shard = GetShard(key);
+            std::shared_lock<std::shared_timed_mutex> lock(shard.mutex);
+            auto iter = shard.map.find(key);
+            if (iter != shard.map.end())
+            {
+                value = iter->second;
+                return true;
+            }
+            return false;
+        }
+
+        void GatherAll(std::vector<Value>& values) const
+        {
+            values.clear();
+            for (size_t i = 0; i <= mMask; ++i)
+            {
+                std::shared_lock<std::shared_timed_mutex> lock(mShards[i].mutex);
+                for (auto const& m : mShards[i].map)
+                {
+                    values.push_back(m.second);
+                }
+            }
+        }
+
+    protected:
+        // Each shard is padded to whole cache lines so that the mutexes of
+        // neighboring shards do not share a line. The shards are allocated
+        // on cache-line boundaries only with the aligned operator new of
+        // C++17; with C++14 they are padded but can be misaligned.
+        struct alignas(64) Shard
+        {
+            mutable std::shared_timed_mutex mutex;
+            std::map<Key, Value> map;
+        };
+
+        // The hash is mixed before it is masked, because std::hash of an
+        // integer is the identity for common standard libraries and keys
+        // with equal low-order bits would map to the same shard.
+        size_t GetShardIndex(Key const& key) const
+        {
+            uint64_t h = static_cast<uint64_t>(std::hash<Key>{}(key));
+            h ^= h >> 33;
+            h *= 0xFF51AFD7ED558CCDull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h) & mMask;
+        }
+
+        Shard& GetShard(Key const& key)
+        {
+            return mShards[GetShardIndex(key)];
+        }
+
+        Shard const& GetShard(Key const& key) const
+        {
+            return mShards[GetShardIndex(key)];
+        }
+
+        size_t mMask;
+        std::unique_ptr<Shard[]> mShards;
+    };
+}
@@ -41,6 +41,28 @@ namespace gte
             return Degree<D>(Reduce(x));
         }
 
+        // Degree<D> and DegreeRR<D> for the numValues inputs x[], stored in
+        // result[]. The range reduction has no branches, so the compiler
+        // evaluates several inputs per instruction. The results are those
+        // of the single-input functions.
+        template <int32_t D>
+        static void Degree(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                result[i] = Evaluate(degree<D>(), x[i]);
+            }
+        }
+
+        template <int32_t D>
+        static void DegreeRR(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                result[i] = Evaluate(degree<D>(), Reduce(x[i]));
+            }
+        }
+
     private:
         // Metaprogramming and private implementation to allow specialization
         // of a template member function.
@@ -111,26 +133,16 @@ namespace gte
         {
             // Map x to y in [-pi,pi], x = 2*pi*quotient + remainder.
             Real quotient = (Real)GTE_C_INV_TWO_PI * x;
-            if (x >= (Real)0)
-            {
-                quotient = (Real)((int32_t)(quotient + (Real)0.5));
-            }
-            else
-            {
-                quotient = (Real)((int32_t)(quotient - (Real)0.5));
-            }
+            quotient = (Real)((int32_t)(quotient + (x >= (Real)0 ? (Real)0.5 : (Real)-0.5)));
             Real y = x - (Real)GTE_C_TWO_PI * quotient;
 
-            // Map y to [-pi/2,pi/2] with sin(y) = sin(x).
-            if (y > (Real)GTE_C_HALF_PI)
-            {
-                y = (Real)GTE_C_PI - y;
-            }
-            else if (y < (Real)-GTE_C_HALF_PI)
-            {
-                y = (Real)-GTE_C_PI - y;
-            }
-            return y;
+            // Map y to [-pi/2,pi/2] with sin(y) = sin(x). The reflection is
+            // y' = offset + sign * y, where y' = (+-pi) - y for |y| > pi/2
+            // and y' = (+-0) + y otherwise. It selects only a constant, so
+            // the array functions have no branches.
+            Real const sign = (std::fabs(y) > (Real)GTE_C_HALF_PI ? (Real)-1 : (Real)1);
+            Real const offset = (((Real)1 - sign) * (Real)0.5) * std::copysign((Real)GTE_C_PI, y);
+            return offset + sign * y;
         }
     };
 }
@@ -0,0 +1,292 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <Mathematics/Image3.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// A 3D image stored as a map of bricks of 8x8x8 voxels. A brick is either
+// active, in which case its 512 voxels are stored, or inactive, in which
+// case all its voxels have the single tile value of the brick. Only the
+// active bricks use memory beyond the brick map, which stores an index and
+// a tile value per brick. This is the layout of sparse volumes such as
+// narrow-band signed distance functions, where the voxels far from the
+// surface are clamped to +background outside and -background inside and
+// the bricks containing them become tiles.
+//
+// The bricks along the maximum faces of the image can extend beyond the
+// image dimensions. Their voxels outside the image are stored but are not
+// part of the image.
+
+namespace gte
+{
+    template <typename PixelType>
+    class SparseImage3
+    {
+    public:
+        static int32_t constexpr brickLog2 = 3;
+        static int32_t constexpr brickSize = (1 << brickLog2);
+        static int32_t constexpr brickMask = brickSize - 1;
+        static size_t constexpr brickVolume = static_cast<size_t>(brickSize * brickSize * brickSize);
+
+        using Brick = std::array<PixelType, brickVolume>;
+
+        // Construction and destruction. All the bricks are inactive with
+        // tile value 'background'.
+        SparseImage3(int32_t dimension0, int32_t dimension1, int32_t dimension2,
+            PixelType const& background)
+            :
+            mDimensions{ dimension0, dimension1, dimension2 },
+            mBrickDimensions{},
+            mBrickOf{},
+            mTileValues{},
+            mBricks{},
+            mActive{}
+        {
+            LogAssert(dimension0 > 0 && dimension1 > 0 && dimension2 > 0,
+                "The dimensions must be positive.");
+
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                mBrickDimensions[d] = (mDimensions[d] + brickMask) >> brickLog2;
+            }
+
+            size_t const numBricks = GetNumBricks();
+            mBrickOf.resize(numBricks, -1);
+            mTileValues.resize(numBricks, background);
+        }
+
+        // Create the sparse image of a dense image. A brick is inactive when
+        // all its voxels have the same value.
+        SparseImage3(Image3<PixelType> const& image)
+            :
+            SparseImage3(image.GetDimension(0), image.GetDimension(1),
+                image.GetDimension(2), PixelType{})
+        {
+            for (int32_t z = 0; z < mDimensions[2]; ++z)
+            {
+                for (int32_t y = 0; y < mDimensions[1]; ++y)
+                {
+                    size_t i = image.GetIndex(0, y, z);
+                    for (int32_t x = 0; x < mDimensions[0]; ++x, ++i)
+                    {
+                        Set(x, y, z, image[i]);
+                    }
+                }
+            }
+            Prune();
+        }
+
+        virtual ~SparseImage3() = default;
+
+        // Member access.
+        inline int32_t GetDimension(int32_t d) const
+        {
+            return mDimensions[d];
+        }
+
+        inline int32_t GetBrickDimension(int32_t d) const
+        {
+            return mBrickDimensions[d];
+        }
+
+        inline size_t GetNumBricks() const
+        {
+            return static_cast<size_t>(mBrickDimensions[0]) *
+                static_cast<size_t>(mBrickDimensions[1]) *
+                static_cast<size_t>(mBrickDimensions[2]);
+        }
+
+        inline size_t GetBrickIndex(int32_t bx, int32_t by, int32_t bz) const
+        {
+            return static_cast<size_t>(bx) + static_cast<size_t>(mBrickDimensions[0]) *
+                (static_cast<size_t>(by) + static_cast<size_t>(mBrickDimensions[1]) *
+                    static_cast<size_t>(bz));
+        }
+
+        void GetBrickCoordinates(size_t b, std::array<int32_t, 3>& brick) const
+        {
+            size_t const bound0 = static_cast<size_t>(mBrickDimensions[0]);
+            size_t const bound1 = static_cast<size_t>(mBrickDimensions[1]);
+            brick[0] = static_cast<int32_t>(b % bound0);
+            b /= bound0;
+            brick[1] = static_cast<int32_t>(b % bound1);
+            brick[2] = static_cast<int32_t>(b / bound1);
+        }
+
+        inline bool IsActive(size_t b) const
+        {
+            return mBrickOf[b] >= 0;
+        }
+
+        inline size_t GetNumActiveBricks() const
+        {
+            return mActive.size();
+        }
+
+        // The brick indices of the active bricks, in the order of their
+        // activation.
+        inline std::vector<size_t> const& GetActiveBricks() const
+        {
+            return mActive;
+        }
+
+        // The voxels of an active brick, stored at x + 8 * (y + 8 * z) for
+        // the brick-local coordinates.
+        inline Brick const& GetBrick(size_t b) const
+        {
+            return mBricks[mBrickOf[b]];
+        }
+
+        inline Brick& GetBrick(size_t b)
+        {
+            return mBricks[mBrickOf[b]];
+        }
+
+        inline PixelType const& GetTileValue(size_t b) const
+        {
+            return mTileValues[b];
+        }
+
+        // Voxel access. The coordinates must satisfy 0 <= x < dimension0,
+        // 0 <= y < dimension1 and 0 <= z < dimension2. Set activates the
+        // brick of the voxel when the value differs from the tile value.
+        PixelType const& operator()(int32_t x, int32_t y, int32_t z) const
+        {
+            size_t const b = GetBrickIndex(x >> brickLog2, y >> brickLog2, z >> brickLog2);
+            int32_t const brick = mBrickOf[b];
+            if (brick >= 0)
+            {
+                return mBricks[brick][GetVoxelIndex(x, y, z)];
+            }
+            return mTileValues[b];
+        }
+
+        void Set(int32_t x, int32_t y, int32_t z, PixelType const& value)
+        {
+            size_t const b = GetBrickIndex(x >> brickLog2, y >> brickLog2, z >> brickLog2);
+            if (mBrickOf[b] < 0)
+            {
+                if (value == mTileValues[b])
+                {
+                    return;
+                }
+                Activate(b);
+            }
+            mBricks[mBrickOf[b]][GetVoxelIndex(x, y, z)] = value;
+        }
+
+        // Activate a brick. Its voxels are set to its tile value.
+        void Activate(size_t b)
+        {
+            if (mBrickOf[b] < 0)
+            {
+                mBrickOf[b] = static_cast<int32_t>(mBricks.size());
+                mBricks.emplace_back();
+                mBricks.back().fill(mTileValues[b]);
+                mActive.push_back(b);
+            }
+        }
+
+        // Make a brick inactive with the specified tile value. The storage
+        // of the last active brick is moved into the released slot, so the
+        // order of GetActiveBricks() changes.
+        void Deactivate(size_t b, PixelType const& tileValue)
+        {
+            mTileValues[b] = tileValue;
+            int32_t const brick = mBrickOf[b];
+            if (brick >= 0)
+            {
+                size_t const last = mBricks.size() - 1;
+                if (static_cast<size_t>(brick) != last)
+                {
+                    mBricks[brick] = mBricks[last];
+                    mActive[brick] = mActive[last];
+                    mBrickOf[mActive[brick]] = brick;
+                }
+                mBricks.pop_back();
+                mActive.pop_back();
+                mBrickOf[b] = -1;
+            }
+        }
+
+        // Deactivate the bricks whose voxels inside the image all have the
+        // same value.
+        void Prune()
+        {
+            std::vector<size_t> const active = mActive;
+            std::array<int32_t, 3> brick{}, extent{};
+            for (auto b : active)
+            {
+                GetBrickCoordinates(b, brick);
+                GetBrickExtent(brick, extent);
+
+                Brick const& voxels = GetBrick(b);
+                PixelType const value = voxels[0];
+                bool uniform = true;
+                for (int32_t z = 0; z < extent[2] && uniform; ++z)
+                {
+                    for (int32_t y = 0; y < extent[1] && uniform; ++y)
+                    {
+                        size_t i = GetVoxelIndex(0, y, z);
+                        for (int32_t x = 0; x < extent[0]; ++x, ++i)
+                        {
+                            if (!(voxels[i] == value))
+                            {
+                                uniform = false;
+                                break;
+                            }
+                        }
+                    }
+                }
+
+                if (uniform)
+                {
+                    Deactivate(b, value);
+                }
+            }
+        }
+
+        // The number of voxels of a brick in each dimension that are inside
+        // the image, which is 8 except for the bricks along the maximum
+        // faces of the image.
+        void GetBrickExtent(std::array<int32_t, 3> const& brick, std::array<int32_t, 3>& extent) const
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                int32_t const remaining = mDimensions[d] - (brick[d] << brickLog2);
+                extent[d] = (remaining < brickSize ? remaining : brickSize);
+            }
+        }
+
+        // The index of voxel (x,y,z) in its brick.
+        inline static size_t GetVoxelIndex(int32_t x, int32_t y, int32_t z)
+        {
+            return static_cast<size_t>(x & brickMask) +
+                static_cast<size_t>(brickSize) * (static_cast<size_t>(y & brickMask) +
+                    static_cast<size_t>(brickSize) * static_cast<size_t>(z & brickMask));
+        }
+
+    private:
+        std::array<int32_t, 3> mDimensions;
+        std::array<int32_t, 3> mBrickDimensions;
+
+        // For each brick, the index into mBricks of its voxels or -1 when it
+        // is inactive, and its tile value.
+        std::vector<int32_t> mBrickOf;
+        std::vector<PixelType> mTileValues;
+
+        // The voxels of the active bricks and their brick indices.
+        std::vector<Brick> mBricks;
+        std::vector<size_t> mActive;
+    };
+}
@@ -8,8 +8,10 @@
 #pragma once
 
 #include <Mathematics/DistPointHyperplane.h>
-#include <Mathematics/EdgeKey.h>
-#include <map>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
+#include <array>
+#include <utility>
 
 // The algorithm for splitting a mesh by a plane is described in
 // https://www.geometrictools.com/Documentation/ClipMesh.pdf
@@ -17,6 +19,18 @@
 // mesh (from the "positive" and "zero" vertices) by attaching
 // triangulated faces to the mesh, where the those faces live in
 // the splitting plane.  (TODO: Add this code.)
+//
+// The mesh can be split by many planes in one call, each plane cutting the
+// input mesh independently, for example for cross sections or fracture
+// patterns. The edges of the mesh are computed once and shared by the
+// cuts, and also by later calls for the same triangles, each cut storing its intersection vertices in an array indexed by
+// edge rather than in a map. A first pass classifies the vertices against
+// each plane and counts the outputs of the cut, which determines where the
+// cut writes in the output arrays, and a second pass writes the outputs.
+// The cuts are processed as tasks of TaskScheduler::GetDefault() when
+// numThreads is 2 or larger. The outputs of a cut are the same as those of
+// the single-plane operator() except that the indices of its intersection
+// vertices are offset by those of the previous cuts.
 
 namespace gte
 {
@@ -24,6 +38,41 @@ namespace gte
     class SplitMeshByPlane
     {
     public:
+        // The outputs of splitting a mesh by multiple planes. The vertices
+        // are the input vertices followed by the intersection vertices of
+        // the cuts. For cut p, the intersection vertices are
+        //   vertices[numInputVertices + vertexOffsets[p]] through
+        //   vertices[numInputVertices + vertexOffsets[p + 1] - 1],
+        // the triangles on the negative side of the plane are
+        //   negIndices[negOffsets[p]] through negIndices[negOffsets[p + 1] - 1]
+        // and similarly for the triangles on the positive side. The arrays
+        // are resized by operator(), which does not allocate when an output
+        // is reused for meshes and planes of similar sizes.
+        struct MultiOutput
+        {
+            std::vector<Vector3<Real>> vertices;
+            std::vector<int32_t> negIndices;
+            std::vector<int32_t> posIndices;
+            std::vector<size_t> vertexOffsets;
+            std::vector<size_t> negOffsets;
+            std::vector<size_t> posOffsets;
+        };
+
+        SplitMeshByPlane()
+            :
+            mNumVertices(0),
+            mNumTriangles(0),
+            mIndices(nullptr),
+            mX{},
+            mY{},
+            mZ{},
+            mEdges{},
+            mTriangleEdges{},
+            mTopologyIndices{},
+            mTopologyNumVertices(0)
+        {
+        }
+
         // The 'indices' are lookups into the 'vertices' array.  The indices
         // represent a triangle mesh.  The number of indices must be a
         // multiple of 3, each triple representing a triangle.  If t is a
@@ -38,117 +87,305 @@ namespace gte
             std::vector<int32_t>& negIndices,
             std::vector<int32_t>& posIndices)
         {
-            mSignedDistances.resize(vertices.size());
-            mEMap.clear();
+            MultiOutput output{};
+            output.vertices = std::move(clipVertices);
+            output.negIndices = std::move(negIndices);
+            output.posIndices = std::move(posIndices);
+            operator()(vertices, indices, std::vector<Plane3<Real>>{ plane }, 1, output);
+            clipVertices = std::move(output.vertices);
+            negIndices = std::move(output.negIndices);
+            posIndices = std::move(output.posIndices);
+        }
 
-            // Make a copy of the incoming vertices.  If the mesh intersects
-            // the plane, new vertices must be generated.  These are appended
-            // to the clipVertices array.
-            clipVertices = vertices;
+        // Split the mesh by each of the planes.
+        void operator()(
+            std::vector<Vector3<Real>> const& vertices,
+            std::vector<int32_t> const& indices,
+            std::vector<Plane3<Real>> const& planes,
+            size_t numThreads,
+            MultiOutput& output)
+        {
+            size_t const numPlanes = planes.size();
+            CreateTopology(vertices, indices);
 
-            ClassifyVertices(clipVertices, plane);
-            ClassifyEdges(clipVertices, indices);
-            ClassifyTriangles(indices, negIndices, posIndices);
+            // Count the outputs of the cuts and convert the counts to
+            // offsets.
+            std::vector<Count> counts(numPlanes);
+            ForEachCut(numPlanes, numThreads, [this, &planes, &counts](Cut& cut, size_t p)
+            {
+                ClassifyVertices(cut, planes[p]);
+                counts[p] = CountOutputs(cut);
+            });
+
+            output.vertexOffsets.resize(numPlanes + 1);
+            output.negOffsets.resize(numPlanes + 1);
+            output.posOffsets.resize(numPlanes + 1);
+            output.vertexOffsets[0] = 0;
+            output.negOffsets[0] = 0;
+            output.posOffsets[0] = 0;
+            for (size_t p = 0; p < numPlanes; ++p)
+            {
+                output.vertexOffsets[p + 1] = output.vertexOffsets[p] + counts[p].numVertices;
+                output.negOffsets[p + 1] = output.negOffsets[p] + counts[p].numNegIndices;
+                output.posOffsets[p + 1] = output.posOffsets[p] + counts[p].numPosIndices;
+            }
+
+            output.vertices.resize(mNumVertices + output.vertexOffsets[numPlanes]);
+            std::copy(vertices.begin(), vertices.end(), output.vertices.begin());
+            output.negIndices.resize(output.negOffsets[numPlanes]);
+            output.posIndices.resize(output.posOffsets[numPlanes]);
+
+            // Each cut writes its outputs in its own ranges of the arrays.
+            ForEachCut(numPlanes, numThreads, [this, &planes, &output](Cut& cut, size_t p)
+            {
+                ClassifyVertices(cut, planes[p]);
+                cut.vertices = output.vertices.data();
+                cut.nextIndex = static_cast<int32_t>(mNumVertices + output.vertexOffsets[p]);
+                cut.negIndices = output.negIndices.data() + output.negOffsets[p];
+                cut.posIndices = output.posIndices.data() + output.posOffsets[p];
+                ClassifyEdges(cut);
+                ClassifyTriangles(cut);
+            });
         }
 
     private:
-        void ClassifyVertices(std::vector<Vector3<Real>> const& clipVertices,
-            Plane3<Real> const& plane)
+        // The state of a cut. The arrays are reused by the cuts of a task.
+        struct Cut
+        {
+            // The signed distances from the vertices to the plane.
+            std::vector<Real> signedDistances;
+
+            // The index of the intersection vertex of each edge whose
+            // vertices are on opposite sides of the plane, or -1.
+            std::vector<int32_t> edgeVertices;
+
+            // The output vertices and the positions of the cut in the
+            // output arrays, advanced as the outputs are written.
+            Vector3<Real>* vertices;
+            int32_t nextIndex;
+            int32_t* negIndices;
+            int32_t* posIndices;
+        };
+
+        struct Count
         {
-            DCPQuery<Real, Vector3<Real>, Plane3<Real>> query;
-            for (size_t i = 0; i < clipVertices.size(); ++i)
+            size_t numVertices;
+            size_t numNegIndices;
+            size_t numPosIndices;
+        };
+
+        template <typename Function>
+        void ForEachCut(size_t numPlanes, size_t numThreads, Function const& function)
+        {
+            size_t const numTasks = std::max(std::min(numThreads, numPlanes),
+                static_cast<size_t>(1));
+
+            auto process = [this, numPlanes, numTasks, &function](size_t k)
             {
-                mSignedDistances[i] = query(clipVertices[i], plane).signedDistance;
+                Cut cut{};
+                cut.signedDistances.resize(mNumVertices);
+                cut.edgeVertices.resize(mEdges.size());
+                size_t const pmin = k * numPlanes / numTasks;
+                size_t const pmax = (k + 1) * numPlanes / numTasks;
+                for (size_t p = pmin; p < pmax; ++p)
+                {
+                    function(cut, p);
+                }
+            };
+
+            if (numTasks == 1)
+            {
+                process(0);
+            }
+            else
+            {
+                TaskScheduler::GetDefault().ParallelFor(numTasks, process);
             }
         }
 
-        void ClassifyEdges(std::vector<Vector3<Real>>& clipVertices,
+        // Copy the vertices to separate coordinate arrays, which the
+        // compiler vectorizes in ClassifyVertices, and store the edges of
+        // the triangles. The edge (v0,v1) of a triangle <v0,v1,v2> is
+        // mTriangleEdges[t][0], the edge (v1,v2) is mTriangleEdges[t][1]
+        // and the edge (v2,v0) is mTriangleEdges[t][2]. The edges are
+        // created again only when the indices differ from those of the
+        // previous call.
+        void CreateTopology(std::vector<Vector3<Real>> const& vertices,
             std::vector<int32_t> const& indices)
         {
-            size_t const numTriangles = indices.size() / 3;
-            int32_t nextIndex = static_cast<int32_t>(clipVertices.size());
-            for (size_t i = 0; i < numTriangles; ++i)
+            mNumVertices = vertices.size();
+            mNumTriangles = indices.size() / 3;
+            mIndices = indices.data();
+
+            mX.resize(mNumVertices);
+            mY.resize(mNumVertices);
+            mZ.resize(mNumVertices);
+            for (size_t i = 0; i < mNumVertices; ++i)
             {
-                size_t threeI = 3 * static_cast<size_t>(i);
-                int32_t v0 = indices[threeI + 0];
-                int32_t v1 = indices[threeI + 1];
-                int32_t v2 = indices[threeI + 2];
-                Real sDist0 = mSignedDistances[v0];
-                Real sDist1 = mSignedDistances[v1];
-                Real sDist2 = mSignedDistances[v2];
-
-                EdgeKey<false> key;
-                Real t;
-                Vector3<Real> intr, diff;
-
-                // The change-in-sign tests are structured this way to avoid
-                // numerical round-off problems.  For example, sDist0 > 0 and
-                // sDist1 < 0, but both are very small and sDist0 * sDist1 = 0
-                // because of round-off errors.  The tests also guarantee
-                // consistency between this function and ClassifyTriangles,
-                // the latter function using sign tests only on the individual
-                // sDist values.
-
-                if ((sDist0 > (Real)0 && sDist1 < (Real)0)
-                    || (sDist0 < (Real)0 && sDist1 >(Real)0))
+                mX[i] = vertices[i][0];
+                mY[i] = vertices[i][1];
+                mZ[i] = vertices[i][2];
+            }
+
+            if (indices == mTopologyIndices && mNumVertices == mTopologyNumVertices)
+            {
+                return;
+            }
+            mTopologyIndices = indices;
+            mTopologyNumVertices = mNumVertices;
+
+            // The edges are bucketed by their smaller vertex index, so an
+            // edge is found by a search of the few edges of its bucket.
+            size_t const numIndices = 3 * mNumTriangles;
+            std::vector<size_t> offsets(mNumVertices + 1, 0);
+            for (size_t t = 0; t < mNumTriangles; ++t)
+            {
+                int32_t const* v = &mIndices[3 * t];
+                for (size_t j = 0; j < 3; ++j)
                 {
-                    key = EdgeKey<false>(v0, v1);
-                    if (mEMap.find(key) == mEMap.end())
-                    {
-                        t = sDist0 / (sDist0 - sDist1);
-                        diff = clipVertices[v1] - clipVertices[v0];
-                        intr = clipVertices[v0] + t * diff;
-                        clipVertices.push_back(intr);
-                        mEMap[key] = std::make_pair(intr, nextIndex);
-                        ++nextIndex;
-                    }
+                    ++offsets[static_cast<size_t>(std::min(v[j], v[(j + 1) % 3])) + 1];
                 }
+            }
+            for (size_t i = 0; i < mNumVertices; ++i)
+            {
+                offsets[i + 1] += offsets[i];
+            }
 
-                if ((sDist1 > (Real)0 && sDist2 < (Real)0)
-                    || (sDist1 < (Real)0 && sDist2 >(Real)0))
+            std::vector<std::pair<int32_t, size_t>> buckets(numIndices);
+            std::vector<size_t> bucketEnds(offsets.begin(), offsets.end() - 1);
+            mEdges.clear();
+            mTriangleEdges.resize(mNumTriangles);
+            for (size_t t = 0; t < mNumTriangles; ++t)
+            {
+                int32_t const* v = &mIndices[3 * t];
+                for (size_t j = 0; j < 3; ++j)
                 {
-                    key = EdgeKey<false>(v1, v2);
-                    if (mEMap.find(key) == mEMap.end())
+                    int32_t v0 = v[j], v1 = v[(j + 1) % 3];
+                    size_t const vmin = static_cast<size_t>(std::min(v0, v1));
+                    int32_t const vmax = std::max(v0, v1);
+                    size_t k = offsets[vmin];
+                    while (k < bucketEnds[vmin] && buckets[k].first != vmax)
+                    {
+                        ++k;
+                    }
+                    if (k == bucketEnds[vmin])
                     {
-                        t = sDist1 / (sDist1 - sDist2);
-                        diff = clipVertices[v2] - clipVertices[v1];
-                        intr = clipVertices[v1] + t * diff;
-                        clipVertices.push_back(intr);
-                        mEMap[key] = std::make_pair(intr, nextIndex);
-                        ++nextIndex;
+                        buckets[bucketEnds[vmin]++] = std::make_pair(vmax, mEdges.size());
+                        mEdges.push_back({ v0, v1 });
                     }
+                    mTriangleEdges[t][j] = buckets[k].second;
+                }
+            }
+        }
+
+        void ClassifyVertices(Cut& cut, Plane3<Real> const& plane)
+        {
+            // The operations are those of DCPQuery for a point and a plane.
+            Real const n0 = plane.normal[0];
+            Real const n1 = plane.normal[1];
+            Real const n2 = plane.normal[2];
+            Real const c = plane.constant;
+            Real* signedDistances = cut.signedDistances.data();
+            for (size_t i = 0; i < mNumVertices; ++i)
+            {
+                signedDistances[i] = n0 * mX[i] + n1 * mY[i] + n2 * mZ[i] - c;
+            }
+        }
+
+        // The change-in-sign test of an edge.  The test is structured this
+        // way to avoid numerical round-off problems.  For example,
+        // sDist0 > 0 and sDist1 < 0, but both are very small and
+        // sDist0 * sDist1 = 0 because of round-off errors.  The test also
+        // guarantees consistency between ClassifyEdges and
+        // ClassifyTriangles, the latter function using sign tests only on
+        // the individual sDist values.
+        static inline bool IsCrossing(Real sDist0, Real sDist1)
+        {
+            return (sDist0 > (Real)0 && sDist1 < (Real)0)
+                || (sDist0 < (Real)0 && sDist1 > (Real)0);
+        }
+
+        Count CountOutputs(Cut const& cut) const
+        {
+            Count count{ 0, 0, 0 };
+            for (auto const& edge : mEdges)
+            {
+                if (IsCrossing(cut.signedDistances[edge[0]], cut.signedDistances[edge[1]]))
+                {
+                    ++count.numVertices;
+                }
+            }
+
+            // A triangle with vertices on both sides of the plane is split
+            // into one triangle on each side when its third vertex is on
+            // the plane and otherwise into two triangles on the side of two
+            // vertices and one triangle on the other side. Triangles lying
+            // in the plane are rejected.
+            for (size_t t = 0; t < mNumTriangles; ++t)
+            {
+                size_t numPositive = 0, numNegative = 0;
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    Real sDist = cut.signedDistances[mIndices[3 * t + j]];
+                    numPositive += (sDist > (Real)0 ? 1 : 0);
+                    numNegative += (sDist < (Real)0 ? 1 : 0);
                 }
 
-                if ((sDist2 > (Real)0 && sDist0 < (Real)0)
-                    || (sDist2 < (Real)0 && sDist0 >(Real)0))
+                if (numNegative == 0)
+                {
+                    count.numPosIndices += (numPositive > 0 ? 3 : 0);
+                }
+                else if (numPositive == 0)
                 {
-                    key = EdgeKey<false>(v2, v0);
-                    if (mEMap.find(key) == mEMap.end())
+                    count.numNegIndices += 3;
+                }
+                else
+                {
+                    count.numNegIndices += 3 * numNegative;
+                    count.numPosIndices += 3 * numPositive;
+                }
+            }
+            return count;
+        }
+
+        // Compute the intersection vertices of the edges whose vertices
+        // are on opposite sides of the plane, numbered in the order of the
+        // triangles.
+        void ClassifyEdges(Cut& cut)
+        {
+            std::fill(cut.edgeVertices.begin(), cut.edgeVertices.end(), -1);
+            Vector3<Real> const* vertices = cut.vertices;
+            for (size_t i = 0; i < mNumTriangles; ++i)
+            {
+                int32_t const* v = &mIndices[3 * i];
+                for (size_t j = 0; j < 3; ++j)
+                {
+                    int32_t v0 = v[j], v1 = v[(j + 1) % 3];
+                    Real sDist0 = cut.signedDistances[v0];
+                    Real sDist1 = cut.signedDistances[v1];
+                    int32_t& edgeVertex = cut.edgeVertices[mTriangleEdges[i][j]];
+                    if (IsCrossing(sDist0, sDist1) && edgeVertex == -1)
                     {
-                        t = sDist2 / (sDist2 - sDist0);
-                        diff = clipVertices[v0] - clipVertices[v2];
-                        intr = clipVertices[v2] + t * diff;
-                        clipVertices.push_back(intr);
-                        mEMap[key] = std::make_pair(intr, nextIndex);
-                        ++nextIndex;
+                        Real t = sDist0 / (sDist0 - sDist1);
+                        Vector3<Real> diff = vertices[v1] - vertices[v0];
+                        cut.vertices[cut.nextIndex] = vertices[v0] + t * diff;
+                        edgeVertex = cut.nextIndex++;
                     }
                 }
             }
         }
 
-        void ClassifyTriangles(std::vector<int32_t> const& indices,
-            std::vector<int32_t>& negIndices, std::vector<int32_t>& posIndices)
+        void ClassifyTriangles(Cut& cut)
         {
-            size_t const numTriangles = static_cast<int32_t>(indices.size() / 3);
-            for (size_t i = 0; i < numTriangles; ++i)
+            for (size_t i = 0; i < mNumTriangles; ++i)
             {
-                size_t threeI = 3 * static_cast<size_t>(i);
-                int32_t v0 = indices[threeI + 0];
-                int32_t v1 = indices[threeI + 1];
-                int32_t v2 = indices[threeI + 2];
-                Real sDist0 = mSignedDistances[v0];
-                Real sDist1 = mSignedDistances[v1];
-                Real sDist2 = mSignedDistances[v2];
+                size_t threeI = 3 * i;
+                int32_t v0 = mIndices[threeI + 0];
+                int32_t v1 = mIndices[threeI + 1];
+                int32_t v2 = mIndices[threeI + 2];
+                Real sDist0 = cut.signedDistances[v0];
+                Real sDist1 = cut.signedDistances[v1];
+                Real sDist2 = cut.signedDistances[v2];
 
                 if (sDist0 > (Real)0)
                 {
@@ -157,17 +394,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // +++
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // ++-
-                            SplitTrianglePPM(negIndices, posIndices, v0, v1, v2);
+                            SplitTrianglePPM(cut, i, v0, v1, v2);
                         }
                         else
                         {
                             // ++0
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                     }
                     else if (sDist1 < (Real)0)
@@ -175,17 +412,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // +-+
-                            SplitTrianglePPM(negIndices, posIndices, v2, v0, v1);
+                            SplitTrianglePPM(cut, i, v2, v0, v1);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // +--
-                            SplitTriangleMMP(negIndices, posIndices, v1, v2, v0);
+                            SplitTriangleMMP(cut, i, v1, v2, v0);
                         }
                         else
                         {
                             // +-0
-                            SplitTrianglePMZ(negIndices, posIndices, v0, v1, v2);
+                            SplitTrianglePMZ(cut, i, v0, v1, v2);
                         }
                     }
                     else
@@ -193,17 +430,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // +0+
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // +0-
-                            SplitTriangleMPZ(negIndices, posIndices, v2, v0, v1);
+                            SplitTriangleMPZ(cut, i, v2, v0, v1);
                         }
                         else
                         {
                             // +00
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                     }
                 }
@@ -214,17 +451,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // -++
-                            SplitTrianglePPM(negIndices, posIndices, v1, v2, v0);
+                            SplitTrianglePPM(cut, i, v1, v2, v0);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // -+-
-                            SplitTriangleMMP(negIndices, posIndices, v2, v0, v1);
+                            SplitTriangleMMP(cut, i, v2, v0, v1);
                         }
                         else
                         {
                             // -+0
-                            SplitTriangleMPZ(negIndices, posIndices, v0, v1, v2);
+                            SplitTriangleMPZ(cut, i, v0, v1, v2);
                         }
                     }
                     else if (sDist1 < (Real)0)
@@ -232,17 +469,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // --+
-                            SplitTriangleMMP(negIndices, posIndices, v0, v1, v2);
+                            SplitTriangleMMP(cut, i, v0, v1, v2);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // ---
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                         else
                         {
                             // --0
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                     }
                     else
@@ -250,17 +487,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // -0+
-                            SplitTrianglePMZ(negIndices, posIndices, v2, v0, v1);
+                            SplitTrianglePMZ(cut, i, v2, v0, v1);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // -0-
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                         else
                         {
                             // -00
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                     }
                 }
@@ -271,17 +508,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // 0++
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // 0+-
-                            SplitTrianglePMZ(negIndices, posIndices, v1, v2, v0);
+                            SplitTrianglePMZ(cut, i, v1, v2, v0);
                         }
                         else
                         {
                             // 0+0
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                     }
                     else if (sDist1 < (Real)0)
@@ -289,17 +526,17 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // 0-+
-                            SplitTriangleMPZ(negIndices, posIndices, v1, v2, v0);
+                            SplitTriangleMPZ(cut, i, v1, v2, v0);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // 0--
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                         else
                         {
                             // 0-0
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                     }
                     else
@@ -307,12 +544,12 @@ namespace gte
                         if (sDist2 > (Real)0)
                         {
                             // 00+
-                            AppendTriangle(posIndices, v0, v1, v2);
+                            AppendTriangle(cut.posIndices, v0, v1, v2);
                         }
                         else if (sDist2 < (Real)0)
                         {
                             // 00-
-                            AppendTriangle(negIndices, v0, v1, v2);
+                            AppendTriangle(cut.negIndices, v0, v1, v2);
                         }
                         else
                         {
@@ -323,77 +560,70 @@ namespace gte
             }
         }
 
-        void AppendTriangle(std::vector<int32_t>& indices, int32_t v0, int32_t v1, int32_t v2)
+        void AppendTriangle(int32_t*& indices, int32_t v0, int32_t v1, int32_t v2)
+        {
+            *indices++ = v0;
+            *indices++ = v1;
+            *indices++ = v2;
+        }
+
+        // The intersection vertex of the edge <v0,v1> of triangle t.
+        int32_t GetEdgeVertex(Cut const& cut, size_t t, int32_t v0, int32_t v1) const
         {
-            indices.push_back(v0);
-            indices.push_back(v1);
-            indices.push_back(v2);
+            int32_t const* v = &mIndices[3 * t];
+            for (size_t j = 0; j < 2; ++j)
+            {
+                int32_t w0 = v[j], w1 = v[j + 1];
+                if ((w0 == v0 && w1 == v1) || (w0 == v1 && w1 == v0))
+                {
+                    return cut.edgeVertices[mTriangleEdges[t][j]];
+                }
+            }
+            return cut.edgeVertices[mTriangleEdges[t][2]];
         }
 
-        void SplitTrianglePPM(std::vector<int32_t>& negIndices,
-            std::vector<int32_t>& posIndices, int32_t v0, int32_t v1, int32_t v2)
+        void SplitTrianglePPM(Cut& cut, size_t t, int32_t v0, int32_t v1, int32_t v2)
         {
-            int32_t v12 = mEMap[EdgeKey<false>(v1, v2)].second;
-            int32_t v20 = mEMap[EdgeKey<false>(v2, v0)].second;
-            posIndices.push_back(v0);
-            posIndices.push_back(v1);
-            posIndices.push_back(v12);
-            posIndices.push_back(v0);
-            posIndices.push_back(v12);
-            posIndices.push_back(v20);
-            negIndices.push_back(v2);
-            negIndices.push_back(v20);
-            negIndices.push_back(v12);
+            int32_t v12 = GetEdgeVertex(cut, t, v1, v2);
+            int32_t v20 = GetEdgeVertex(cut, t, v2, v0);
+            AppendTriangle(cut.posIndices, v0, v1, v12);
+            AppendTriangle(cut.posIndices, v0, v12, v20);
+            AppendTriangle(cut.negIndices, v2, v20, v12);
         }
 
-        void SplitTriangleMMP(std::vector<int32_t>& negIndices,
-            std::vector<int32_t>& posIndices, int32_t v0, int32_t v1, int32_t v2)
+        void SplitTriangleMMP(Cut& cut, size_t t, int32_t v0, int32_t v1, int32_t v2)
         {
-            int32_t v12 = mEMap[EdgeKey<false>(v1, v2)].second;
-            int32_t v20 = mEMap[EdgeKey<false>(v2, v0)].second;
-            negIndices.push_back(v0);
-            negIndices.push_back(v1);
-            negIndices.push_back(v12);
-            negIndices.push_back(v0);
-            negIndices.push_back(v12);
-            negIndices.push_back(v20);
-            posIndices.push_back(v2);
-            posIndices.push_back(v20);
-            posIndices.push_back(v12);
+            int32_t v12 = GetEdgeVertex(cut, t, v1, v2);
+            int32_t v20 = GetEdgeVertex(cut, t, v2, v0);
+            AppendTriangle(cut.negIndices, v0, v1, v12);
+            AppendTriangle(cut.negIndices, v0, v12, v20);
+            AppendTriangle(cut.posIndices, v2, v20, v12);
         }
 
-        void SplitTrianglePMZ(std::vector<int32_t>& negIndices,
-            std::vector<int32_t>& posIndices, int32_t v0, int32_t v1, int32_t v2)
+        void SplitTrianglePMZ(Cut& cut, size_t t, int32_t v0, int32_t v1, int32_t v2)
         {
-            int32_t v01 = mEMap[EdgeKey<false>(v0, v1)].second;
-            posIndices.push_back(v2);
-            posIndices.push_back(v0);
-            posIndices.push_back(v01);
-            negIndices.push_back(v2);
-            negIndices.push_back(v01);
-            negIndices.push_back(v1);
+            int32_t v01 = GetEdgeVertex(cut, t, v0, v1);
+            AppendTriangle(cut.posIndices, v2, v0, v01);
+            AppendTriangle(cut.negIndices, v2, v01, v1);
         }
 
-        void SplitTriangleMPZ(std::vector<int32_t>& negIndices,
-            std::vector<int32_t>& posIndices, int32_t v0, int32_t v1, int32_t v2)
+        void SplitTriangleMPZ(Cut& cut, size_t t, int32_t v0, int32_t v1, int32_t v2)
         {
-            int32_t v01 = mEMap[EdgeKey<false>(v0, v1)].second;
-            negIndices.push_back(v2);
-            negIndices.push_back(v0);
-            negIndices.push_back(v01);
-            posIndices.push_back(v2);
-            posIndices.push_back(v01);
-            posIndices.push_back(v1);
+            int32_t v01 = GetEdgeVertex(cut, t, v0, v1);
+            AppendTriangle(cut.negIndices, v2, v0, v01);
+            AppendTriangle(cut.posIndices, v2, v01, v1);
         }
 
-        // Stores the signed distances from the vertices to the plane.
-        std::vector<Real> mSignedDistances;
+        // The input mesh, its vertices as coordinate arrays and its edges.
+        size_t mNumVertices;
+        size_t mNumTriangles;
+        int32_t const* mIndices;
+        std::vector<Real> mX, mY, mZ;
+        std::vector<std::array<int32_t, 2>> mEdges;
+        std::vector<std::array<size_t, 3>> mTriangleEdges;
 
-        // Stores the edges whose vertices are on opposite sides of the
-        // plane.  The key is a pair of indices into the vertex array.
-        // The value is the point of intersection of the edge with the
-        // plane and an index into m_kVertices (the index is larger or
-        // equal to the number of vertices of incoming rkVertices).
-        std::map<EdgeKey<false>, std::pair<Vector3<Real>, int32_t>> mEMap;
+        // The input of the last creation of the edges.
+        std::vector<int32_t> mTopologyIndices;
+        size_t mTopologyNumVertices;
     };
 }
@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include <Mathematics/IEEEBinary.h>
 #include <Mathematics/Math.h>
+#include <type_traits>
 
 // Minimax polynomial approximations to sqrt(x).  The polynomial p(x) of
 // degree D minimizes the quantity maximum{|sqrt(x) - p(x)| : x in [1,2]}
@@ -46,7 +48,49 @@ namespace gte
             return result;
         }
 
+        // Degree<D> and DegreeRR<D> for the numValues inputs x[], stored in
+        // result[]. DegreeRR replaces std::frexp and std::ldexp by operations
+        // on the exponent bits, so the compiler evaluates several inputs per
+        // instruction. The inputs of DegreeRR must be positive normal
+        // numbers, and then the results are those of the single-input
+        // functions.
+        template <int32_t D>
+        static void Degree(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                result[i] = Evaluate(degree<D>(), x[i] - (Real)1);
+            }
+        }
+
+        template <int32_t D>
+        static void DegreeRR(size_t numValues, Real const* x, Real* result)
+        {
+            for (size_t i = 0; i < numValues; ++i)
+            {
+                // y = 2*frexp(x,&p) in [1,2) and p is decremented, as in
+                // Reduce, by replacing the biased exponent of x with the
+                // bias.
+                Binary value(x[i]);
+                int32_t p = static_cast<int32_t>((value.encoding & Binary::EXPONENT_MASK)
+                    >> Binary::NUM_TRAILING_BITS) - Binary::EXPONENT_BIAS;
+                value.encoding = (value.encoding & Binary::TRAILING_MASK) |
+                    (static_cast<UInt>(Binary::EXPONENT_BIAS) << Binary::NUM_TRAILING_BITS);
+                Real adj = (1 & p) * (Real)GTE_C_SQRT_2 + (1 & ~p) * (Real)1;
+                p >>= 1;
+
+                // ldexp(poly,p) = poly*2^p, because the result is normal.
+                Binary power(static_cast<UInt>(p + Binary::EXPONENT_BIAS) << Binary::NUM_TRAILING_BITS);
+                Real poly = Evaluate(degree<D>(), value.number - (Real)1);
+                result[i] = adj * (poly * power.number);
+            }
+        }
+
     private:
+        using Binary = typename std::conditional<std::is_same<Real, float>::value,
+            IEEEBinary32, IEEEBinary64>::type;
+        using UInt = typename Binary::UIntType;
+
         // Metaprogramming and private implementation to allow specialization
         // of a template member function.
         template <int32_t D> struct degree {};
@@ -130,25 +130,51 @@ namespace gte
         //      ordered clockwise; no mixed chirality.
         // Set numThreads to 2 or larger to activate multithreading in the
         // mesh construction. If numThreads is 0 or 1, the construction
-        // occurs in the main thread.
+        // occurs in the main thread. The mesh is the same for all numbers
+        // of threads.
         StaticVETManifoldMesh2(
             size_t numVertices,
             std::vector<std::array<size_t, 3>> const& triangles,
             size_t numThreads)
             :
-            mVertices(numVertices),
-            mStorage(15 * triangles.size(), invalid),
-            mTriangles(triangles),
-            mAdjacents(triangles.size(), { invalid, invalid, invalid }),
+            mVertices{},
+            mStorage{},
+            mTriangles{},
+            mAdjacents{},
             mMinTrianglesAtVertex(0),
-            mMaxTrianglesAtVertex(0)
+            mMaxTrianglesAtVertex(0),
+            mCounts{}
+        {
+            Rebuild(numVertices, triangles, numThreads);
+        }
+
+        // Replace the mesh by the mesh of new triangles with the same
+        // preconditions as the constructor. The arrays of the mesh keep
+        // their capacity, so an application that rebuilds a mesh of similar
+        // size every frame does not allocate after the first frames.
+        //
+        // The vertex adjacency is built by a counting sort. Each thread
+        // counts the triangles of its range at each vertex, the counts are
+        // converted to the offsets of the threads' triangles in the storage
+        // of each vertex, and each thread writes the outgoing edges of its
+        // triangles at those offsets. The adjacent vertices are then found
+        // per vertex. This requires numThreads * numVertices counters.
+        void Rebuild(
+            size_t numVertices,
+            std::vector<std::array<size_t, 3>> const& triangles,
+            size_t numThreads)
         {
             LogAssert(numVertices >= 3 && triangles.size() > 0, "invalid input");
 
-            std::vector<size_t> numTrianglesAtVertex(numVertices, 0);
-            GetNumTrianglesAtVertex(numTrianglesAtVertex);
-            InitializeVertexStorage(numTrianglesAtVertex);
-            PopulateVertices();
+            mVertices.assign(numVertices, Vertex());
+            mStorage.assign(15 * triangles.size(), static_cast<size_t>(invalid));
+            mTriangles = triangles;
+            mAdjacents.assign(triangles.size(), { invalid, invalid, invalid });
+
+            size_t const numWorkers = std::max(numThreads, static_cast<size_t>(1));
+            CountTrianglesAtVertex(numWorkers);
+            InitializeVertexStorage();
+            PopulateVertices(numWorkers);
             UpdateAdjacencyForSharedEdges(numThreads);
         }
 
@@ -387,66 +413,135 @@ namespace gte
 
         using BoundaryEdgeMap = std::map<std::array<size_t, 2>, BoundaryEdge>;
 
-        // Count the number of triangles sharing each vertex. The total number
-        // of indices for triangles adjacent to vertices is 3 * numTriangles.
-        // This is easy to see from the code where an increment occurs 3 times
-        // per triangle.
-        void GetNumTrianglesAtVertex(std::vector<size_t>& counts)
+        // Execute function(worker, begin, end) for numWorkers consecutive
+        // ranges that partition [0,numItems), on threads when numWorkers is
+        // 2 or larger.
+        template <typename Function>
+        static void RunWorkers(size_t numWorkers, size_t numItems, Function const& function)
         {
-            for (auto const& tri : mTriangles)
+            if (numWorkers <= 1)
             {
-                for (size_t i = 0; i < 3; ++i)
+                function(0, 0, numItems);
+                return;
+            }
+
+            std::vector<std::thread> process(numWorkers);
+            for (size_t w = 0; w < numWorkers; ++w)
+            {
+                size_t const begin = numItems * w / numWorkers;
+                size_t const end = numItems * (w + 1) / numWorkers;
+                process[w] = std::thread([&function, w, begin, end]()
                 {
-                    ++counts[tri[i]];
-                }
+                    function(w, begin, end);
+                });
+            }
+
+            for (size_t w = 0; w < numWorkers; ++w)
+            {
+                process[w].join();
             }
+        }
+
+        // Count the number of triangles sharing each vertex. The total number
+        // of indices for triangles adjacent to vertices is 3 * numTriangles.
+        // mCounts[w * numVertices + v] is first the number of triangles of
+        // worker w at vertex v and then the number of triangles of workers
+        // 0 through w-1 at v, the offset of worker w in the edges of v.
+        void CountTrianglesAtVertex(size_t numWorkers)
+        {
+            size_t const numVertices = mVertices.size();
+            mCounts.assign(numWorkers * numVertices, 0);
+            RunWorkers(numWorkers, mTriangles.size(),
+                [this, numVertices](size_t w, size_t tmin, size_t tsup)
+                {
+                    size_t* counts = mCounts.data() + w * numVertices;
+                    for (size_t t = tmin; t < tsup; ++t)
+                    {
+                        auto const& tri = mTriangles[t];
+                        for (size_t i = 0; i < 3; ++i)
+                        {
+                            ++counts[tri[i]];
+                        }
+                    }
+                });
+
+            RunWorkers(numWorkers, numVertices,
+                [this, numWorkers, numVertices](size_t, size_t vmin, size_t vsup)
+                {
+                    for (size_t v = vmin; v < vsup; ++v)
+                    {
+                        size_t total = 0;
+                        for (size_t w = 0; w < numWorkers; ++w)
+                        {
+                            size_t& count = mCounts[w * numVertices + v];
+                            size_t const numAtWorker = count;
+                            count = total;
+                            total += numAtWorker;
+                        }
+                        mVertices[v].mNumTAdjacents = total;
+                    }
+                });
 
-            auto extremes = std::minmax_element(counts.begin(), counts.end());
-            mMinTrianglesAtVertex = *extremes.first;
-            mMaxTrianglesAtVertex = *extremes.second;
+            auto extremes = std::minmax_element(mVertices.begin(), mVertices.end(),
+                [](Vertex const& vertex0, Vertex const& vertex1)
+                {
+                    return vertex0.mNumTAdjacents < vertex1.mNumTAdjacents;
+                });
+            mMinTrianglesAtVertex = extremes.first->mNumTAdjacents;
+            mMaxTrianglesAtVertex = extremes.second->mNumTAdjacents;
         }
 
         // Assign the storage subblocks to the vertices. The mNumVAdjacents
         // member is incremented later during a triangle traversal and is
         // used as an index into mVAdjacents during the traversal.
-        void InitializeVertexStorage(std::vector<size_t> const& numTrianglesAtVertex)
+        void InitializeVertexStorage()
         {
             auto* storage = mStorage.data();
-            for (size_t v = 0; v < mVertices.size(); ++v)
+            for (auto& vertex : mVertices)
             {
-                mVertices[v].Initialize(numTrianglesAtVertex[v], storage);
+                vertex.Initialize(vertex.mNumTAdjacents, storage);
             }
         }
 
         // Populate each vertex with its adjacent L-triangle, adjacent
-        // vertices and outgoing edges.
-        void PopulateVertices()
+        // vertices and outgoing edges. The outgoing edges of a vertex are
+        // in increasing order of their triangles and the adjacent vertices
+        // are in the order of their first occurrence in those triangles,
+        // which is the order of inserting the triangles one at a time.
+        void PopulateVertices(size_t numWorkers)
         {
-            for (size_t t = 0; t < mTriangles.size(); ++t)
-            {
-                auto const& tri = mTriangles[t];
-                size_t v0 = tri[0];
-                size_t v1 = tri[1];
-                size_t v2 = tri[2];
-
-                // Update the adjacency information at v0.
-                auto& vertex0 = mVertices[v0];
-                vertex0.InsertVAdjacent(v1);
-                vertex0.InsertVAdjacent(v2);
-                vertex0.InsertEAdjacent(v1, t);
-
-                // Update the adjacency information at v1.
-                auto& vertex1 = mVertices[v1];
-                vertex1.InsertVAdjacent(v2);
-                vertex1.InsertVAdjacent(v0);
-                vertex1.InsertEAdjacent(v2, t);
-
-                // Update the adjacency information at v2.
-                auto& vertex2 = mVertices[v2];
-                vertex2.InsertVAdjacent(v0);
-                vertex2.InsertVAdjacent(v1);
-                vertex2.InsertEAdjacent(v0, t);
-            }
+            size_t const numVertices = mVertices.size();
+            RunWorkers(numWorkers, mTriangles.size(),
+                [this, numVertices](size_t w, size_t tmin, size_t tsup)
+                {
+                    size_t* offsets = mCounts.data() + w * numVertices;
+                    for (size_t t = tmin; t < tsup; ++t)
+                    {
+                        auto const& tri = mTriangles[t];
+                        for (size_t i = 0; i < 3; ++i)
+                        {
+                            auto& vertex = mVertices[tri[i]];
+                            vertex.mEAdjacents[offsets[tri[i]]++] = { tri[(i + 1) % 3], t, invalid };
+                        }
+                    }
+                });
+
+            RunWorkers(numWorkers, numVertices,
+                [this](size_t, size_t vmin, size_t vsup)
+                {
+                    for (size_t v = vmin; v < vsup; ++v)
+                    {
+                        auto& vertex = mVertices[v];
+                        vertex.mNumEAdjacents = vertex.mNumTAdjacents;
+                        for (size_t j = 0; j < vertex.mNumEAdjacents; ++j)
+                        {
+                            auto const& tri = mTriangles[vertex.mEAdjacents[j][1]];
+                            size_t const i = (tri[0] == v ? 0 : (tri[1] == v ? 1 : 2));
+                            vertex.InsertVAdjacent(tri[(i + 1) % 3]);
+                            vertex.InsertVAdjacent(tri[(i + 2) % 3]);
+                        }
+                    }
+                });
         }
 
         // Update triangle adjacency information for edges that are shared by
@@ -647,5 +742,8 @@ namespace gte
         std::vector<std::array<size_t, 3>> mAdjacents;
         size_t mMinTrianglesAtVertex;
         size_t mMaxTrianglesAtVertex;
+
+        // The per-worker counters of the construction, kept for Rebuild.
+        std::vector<size_t> mCounts;
     };
 }
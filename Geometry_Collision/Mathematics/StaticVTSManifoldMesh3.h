@@ -158,25 +158,55 @@ namespace gte
         //      ordered clockwise; no mixed chirality.
         // Set numThreads to 2 or larger to activate multithreading in the
         // mesh construction. If numThreads is 0 or 1, the construction
-        // occurs in the main thread.
+        // occurs in the main thread. The mesh is the same for all numbers
+        // of threads.
         StaticVTSManifoldMesh3(
             size_t numVertices,
             std::vector<std::array<size_t, 4>> const& tetrahedra,
             size_t numThreads)
             :
-            mVertices(numVertices),
-            mStorage(60 * tetrahedra.size(), invalid),
-            mTetrahedra(tetrahedra),
-            mAdjacents(tetrahedra.size(), { invalid, invalid, invalid, invalid }),
+            mVertices{},
+            mStorage{},
+            mTetrahedra{},
+            mAdjacents{},
             mMinTetrahedraAtVertex(0),
-            mMaxTetrahedraAtVertex(0)
+            mMaxTetrahedraAtVertex(0),
+            mTetrahedronCounts{},
+            mFaceCounts{},
+            mVertexOffsets{},
+            mTetrahedraAtVertex{}
+        {
+            Rebuild(numVertices, tetrahedra, numThreads);
+        }
+
+        // Replace the mesh by the mesh of new tetrahedra with the same
+        // preconditions as the constructor. The arrays of the mesh keep
+        // their capacity, so an application that rebuilds a mesh of similar
+        // size every frame does not allocate after the first frames.
+        //
+        // The vertex adjacency is built by counting sorts. Each thread
+        // counts the tetrahedra of its range at each vertex and the faces
+        // of its range at their minimum vertices, the counts are converted
+        // to the offsets of the threads' elements for each vertex, and each
+        // thread writes the outgoing faces and the tetrahedra of its range
+        // at those offsets. The adjacent vertices are then found per vertex.
+        // This requires 2 * numThreads * numVertices counters.
+        void Rebuild(
+            size_t numVertices,
+            std::vector<std::array<size_t, 4>> const& tetrahedra,
+            size_t numThreads)
         {
             LogAssert(numVertices >= 4 && tetrahedra.size() > 0, "invalid input");
 
-            std::vector<size_t> numTetrahedraAtVertex(numVertices, 0);
-            GetNumTetrahedraAtVertex(numTetrahedraAtVertex);
-            InitializeVertexStorage(numTetrahedraAtVertex);
-            PopulateVertices();
+            mVertices.assign(numVertices, Vertex());
+            mStorage.assign(60 * tetrahedra.size(), static_cast<size_t>(invalid));
+            mTetrahedra = tetrahedra;
+            mAdjacents.assign(tetrahedra.size(), { invalid, invalid, invalid, invalid });
+
+            size_t const numWorkers = std::max(numThreads, static_cast<size_t>(1));
+            CountTetrahedraAtVertex(numWorkers);
+            InitializeVertexStorage();
+            PopulateVertices(numWorkers);
             //Print("TetraBefore.txt");
             UpdateAdjacencyForSharedFaces(numThreads);
             //Print("TetraAfter.txt");
@@ -300,95 +330,181 @@ namespace gte
         }
 
     protected:
-        // Count the number of tetrahedra sharing each vertex. The total
-        // number of indices for tetrahedra adjacent to vertices is
-        // 4 * numTetrahedra. This is easy to see from the code where an
-        // increment occurs 4 times per tetrahedra.
-        void GetNumTetrahedraAtVertex(std::vector<size_t>& counts)
+        // Execute function(worker, begin, end) for numWorkers consecutive
+        // ranges that partition [0,numItems), on threads when numWorkers is
+        // 2 or larger.
+        template <typename Function>
+        static void RunWorkers(size_t numWorkers, size_t numItems, Function const& function)
         {
-            for (auto const& tri : mTetrahedra)
+            if (numWorkers <= 1)
             {
-                for (size_t i = 0; i < 4; ++i)
-                {
-                    ++counts[tri[i]];
-                }
+                function(0, 0, numItems);
+                return;
             }
 
-            auto extremes = std::minmax_element(counts.begin(), counts.end());
-            mMinTetrahedraAtVertex = *extremes.first;
-            mMaxTetrahedraAtVertex = *extremes.second;
-        }
+            std::vector<std::thread> process(numWorkers);
+            for (size_t w = 0; w < numWorkers; ++w)
+            {
+                size_t const begin = numItems * w / numWorkers;
+                size_t const end = numItems * (w + 1) / numWorkers;
+                process[w] = std::thread([&function, w, begin, end]()
+                {
+                    function(w, begin, end);
+                });
+            }
 
-        // Assign the storage subblocks to the vertices. The mNumVAdjacents
-        // member is incremented later during a tetrahedron traversal and is
-        // used as an index into mVAdjacents during the traversal.
-        void InitializeVertexStorage(std::vector<size_t> const& numTetrahedraAtVertex)
-        {
-            auto* storage = mStorage.data();
-            for (size_t v = 0; v < mVertices.size(); ++v)
+            for (size_t w = 0; w < numWorkers; ++w)
             {
-                mVertices[v].Initialize(numTetrahedraAtVertex[v], storage);
+                process[w].join();
             }
         }
 
-        // Populate each vertex with its adjacent L-tetrahedra and adjacent
-        // faces.
-        void UpdateVertexAdjacents(size_t t)
+        // Count the number of tetrahedra sharing each vertex and the number
+        // of outgoing faces at each vertex. The total number of indices for
+        // tetrahedra adjacent to vertices is 4 * numTetrahedra, and each
+        // face is outgoing at its minimum vertex. The counters of worker w
+        // at vertex v are first the numbers of elements of the worker's
+        // tetrahedra and then the numbers of elements of workers 0 through
+        // w-1, the offsets of worker w for v.
+        void CountTetrahedraAtVertex(size_t numWorkers)
         {
-            // Iterate over all vertex pairs (u0,u1). Update u0's vertex
-            // adjacents with u1 and update u1's vertex adjacents with u0.
-            auto const& tetra = mTetrahedra[t];
-            size_t v0 = tetra[0];
-            size_t v1 = tetra[1];
-            size_t v2 = tetra[2];
-            size_t v3 = tetra[3];
-            auto& vertex0 = mVertices[v0];
-            auto& vertex1 = mVertices[v1];
-            auto& vertex2 = mVertices[v2];
-            auto& vertex3 = mVertices[v3];
-            vertex0.InsertVAdjacent(v1);
-            vertex0.InsertVAdjacent(v2);
-            vertex0.InsertVAdjacent(v3);
-            vertex1.InsertVAdjacent(v2);
-            vertex1.InsertVAdjacent(v0);
-            vertex1.InsertVAdjacent(v3);
-            vertex2.InsertVAdjacent(v0);
-            vertex2.InsertVAdjacent(v1);
-            vertex2.InsertVAdjacent(v3);
-            vertex3.InsertVAdjacent(v1);
-            vertex3.InsertVAdjacent(v0);
-            vertex3.InsertVAdjacent(v2);
+            size_t const numVertices = mVertices.size();
+            mTetrahedronCounts.assign(numWorkers * numVertices, 0);
+            mFaceCounts.assign(numWorkers * numVertices, 0);
+            RunWorkers(numWorkers, mTetrahedra.size(),
+                [this, numVertices](size_t w, size_t tmin, size_t tsup)
+                {
+                    size_t* tetrahedronCounts = mTetrahedronCounts.data() + w * numVertices;
+                    size_t* faceCounts = mFaceCounts.data() + w * numVertices;
+                    for (size_t t = tmin; t < tsup; ++t)
+                    {
+                        auto const& tetra = mTetrahedra[t];
+                        for (size_t i = 0; i < 4; ++i)
+                        {
+                            ++tetrahedronCounts[tetra[i]];
+                            ++faceCounts[std::min(std::min(tetra[face[i][0]],
+                                tetra[face[i][1]]), tetra[face[i][2]])];
+                        }
+                    }
+                });
+
+            RunWorkers(numWorkers, numVertices,
+                [this, numWorkers, numVertices](size_t, size_t vmin, size_t vsup)
+                {
+                    for (size_t v = vmin; v < vsup; ++v)
+                    {
+                        size_t numTetrahedra = 0, numFaces = 0;
+                        for (size_t w = 0; w < numWorkers; ++w)
+                        {
+                            size_t& tetrahedronCount = mTetrahedronCounts[w * numVertices + v];
+                            size_t const numAtWorker = tetrahedronCount;
+                            tetrahedronCount = numTetrahedra;
+                            numTetrahedra += numAtWorker;
+
+                            size_t& faceCount = mFaceCounts[w * numVertices + v];
+                            size_t const numFacesAtWorker = faceCount;
+                            faceCount = numFaces;
+                            numFaces += numFacesAtWorker;
+                        }
+                        mVertices[v].mNumSAdjacents = numTetrahedra;
+                    }
+                });
+
+            auto extremes = std::minmax_element(mVertices.begin(), mVertices.end(),
+                [](Vertex const& vertex0, Vertex const& vertex1)
+                {
+                    return vertex0.mNumSAdjacents < vertex1.mNumSAdjacents;
+                });
+            mMinTetrahedraAtVertex = extremes.first->mNumSAdjacents;
+            mMaxTetrahedraAtVertex = extremes.second->mNumSAdjacents;
         }
 
-        void UpdateFaceAdjacents(size_t t)
+        // Assign the storage subblocks to the vertices. The mNumVAdjacents
+        // member is incremented later during a tetrahedron traversal and is
+        // used as an index into mVAdjacents during the traversal. The
+        // tetrahedra sharing vertex v are stored temporarily in
+        // mTetrahedraAtVertex[mVertexOffsets[v]] through
+        // mTetrahedraAtVertex[mVertexOffsets[v + 1] - 1].
+        void InitializeVertexStorage()
         {
-            auto const& tetra = mTetrahedra[t];
-            for (size_t i = 0; i < 4; ++i)
+            auto* storage = mStorage.data();
+            mVertexOffsets.resize(mVertices.size() + 1);
+            mVertexOffsets[0] = 0;
+            for (size_t v = 0; v < mVertices.size(); ++v)
             {
-                // Get an outgoing face <v0,v1,v2>, which is CCW when
-                // viewed from outside the tetrahedron.
-                size_t v0 = tetra[face[i][0]];
-                size_t v1 = tetra[face[i][1]];
-                size_t v2 = tetra[face[i][2]];
-
-                // Sort the face to <u0,u1,u2> where u0 = min(u0,u1,u2)
-                // and the face is CCW when viewed from outside the
-                // tetrahedron.
-                size_t u0{}, u1{}, u2{};
-                SortFace(v0, v1, v2, u0, u1, u2);
-
-                // Update the face adjacency information at u0.
-                mVertices[u0].InsertFAdjacent(u1, u2, t);
+                auto& vertex = mVertices[v];
+                vertex.Initialize(vertex.mNumSAdjacents, storage);
+                mVertexOffsets[v + 1] = mVertexOffsets[v] + vertex.mNumSAdjacents;
             }
+            mTetrahedraAtVertex.resize(mVertexOffsets.back());
         }
 
-        void PopulateVertices()
+        // Populate each vertex with its adjacent vertices and outgoing
+        // faces. The outgoing faces of a vertex are in increasing order of
+        // their tetrahedra and the adjacent vertices are in the order of
+        // their first occurrence in those tetrahedra, which is the order of
+        // inserting the tetrahedra one at a time.
+        void PopulateVertices(size_t numWorkers)
         {
-            for (size_t t = 0; t < mTetrahedra.size(); ++t)
-            {
-                UpdateVertexAdjacents(t);
-                UpdateFaceAdjacents(t);
-            }
+            size_t const numVertices = mVertices.size();
+            RunWorkers(numWorkers, mTetrahedra.size(),
+                [this, numVertices](size_t w, size_t tmin, size_t tsup)
+                {
+                    size_t* tetrahedronOffsets = mTetrahedronCounts.data() + w * numVertices;
+                    size_t* faceOffsets = mFaceCounts.data() + w * numVertices;
+                    for (size_t t = tmin; t < tsup; ++t)
+                    {
+                        auto const& tetra = mTetrahedra[t];
+                        for (size_t i = 0; i < 4; ++i)
+                        {
+                            size_t const v = tetra[i];
+                            mTetrahedraAtVertex[mVertexOffsets[v] + tetrahedronOffsets[v]++] = t;
+
+                            // Sort the outgoing face <v0,v1,v2> to <u0,u1,u2>
+                            // where u0 = min(u0,u1,u2) and the face is CCW
+                            // when viewed from outside the tetrahedron.
+                            size_t u0{}, u1{}, u2{};
+                            SortFace(tetra[face[i][0]], tetra[face[i][1]],
+                                tetra[face[i][2]], u0, u1, u2);
+                            mVertices[u0].mFAdjacents[faceOffsets[u0]++] = { u1, u2, t, invalid };
+                        }
+                    }
+                });
+
+            // The vertices adjacent to tetra[i] in the order of the
+            // insertions of the single-threaded construction.
+            static std::array<std::array<size_t, 3>, 4> const order =
+            { {
+                { 1, 2, 3 },
+                { 2, 0, 3 },
+                { 0, 1, 3 },
+                { 1, 0, 2 }
+            } };
+
+            RunWorkers(numWorkers, numVertices,
+                [this, numWorkers, numVertices](size_t, size_t vmin, size_t vsup)
+                {
+                    for (size_t v = vmin; v < vsup; ++v)
+                    {
+                        // The offset of the last worker is now the number
+                        // of outgoing faces at v.
+                        auto& vertex = mVertices[v];
+                        vertex.mNumFAdjacents = mFaceCounts[(numWorkers - 1) * numVertices + v];
+                        for (size_t j = mVertexOffsets[v]; j < mVertexOffsets[v + 1]; ++j)
+                        {
+                            auto const& tetra = mTetrahedra[mTetrahedraAtVertex[j]];
+                            size_t i = 0;
+                            while (tetra[i] != v)
+                            {
+                                ++i;
+                            }
+                            for (size_t k = 0; k < 3; ++k)
+                            {
+                                vertex.InsertVAdjacent(tetra[order[i][k]]);
+                            }
+                        }
+                    }
+                });
         }
 
         // Update tetrahedra adjacency information for faces that are shared
@@ -542,5 +658,10 @@ namespace gte
         std::vector<std::array<size_t, 4>> mAdjacents;
         size_t mMinTetrahedraAtVertex;
         size_t mMaxTetrahedraAtVertex;
+
+        // The per-worker counters and the tetrahedra sharing each vertex
+        // during the construction, kept for Rebuild.
+        std::vector<size_t> mTetrahedronCounts, mFaceCounts;
+        std::vector<size_t> mVertexOffsets, mTetrahedraAtVertex;
     };
 }
@@ -9,11 +9,16 @@
 
 #include <Mathematics/MarchingCubes.h>
 #include <Mathematics/Image3.h>
+#include <Mathematics/TaskScheduler.h>
 #include <Mathematics/UniqueVerticesSimplices.h>
 #include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <array>
 
 namespace gte
 {
+    template <typename PixelType> class TiledImage3;
+
     template <typename Real>
     class SurfaceExtractorMC : public MarchingCubes
     {
@@ -160,6 +165,176 @@ namespace gte
             return true;
         }
 
+        // Extract the triangle mesh approximating F = 0 for all the voxels of
+        // an out-of-core image a block at a time, which requires including
+        // TiledImage3.h. The voxels whose minimum corners are in a block of
+        // at most blockSize^3 samples are extracted from a copy of the block
+        // with the samples of its maximum faces, so the voxels of the blocks
+        // partition those of the image. The output is that of Extract(level,
+        // vertices, indices) for the whole image with the triangles ordered
+        // by block, up to rounding errors of the vertices, whose block-local
+        // coordinates are offset by the block origin.
+        static bool Extract(TiledImage3<Real> const& image, Real level, int32_t blockSize,
+            std::vector<Vector3<Real>>& vertices, std::vector<int32_t>& indices)
+        {
+            vertices.clear();
+            indices.clear();
+
+            Image3<Real> region;
+            std::vector<Vector3<Real>> blockVertices;
+            std::vector<int32_t> blockIndices;
+            bool valid = true;
+            image.ForEachBlock(blockSize,
+                [&](std::array<int32_t, 3> const& bmin, std::array<int32_t, 3> const& bmax)
+                {
+                    if (!valid)
+                    {
+                        return;
+                    }
+
+                    std::array<int32_t, 3> rmax{};
+                    for (int32_t d = 0; d < 3; ++d)
+                    {
+                        rmax[d] = std::min(bmax[d] + 1, image.GetDimension(d));
+                    }
+                    image.GetRegion(bmin, rmax, region);
+
+                    SurfaceExtractorMC extractor(region);
+                    if (!extractor.Extract(level, blockVertices, blockIndices))
+                    {
+                        valid = false;
+                        return;
+                    }
+
+                    int32_t const vbase = static_cast<int32_t>(vertices.size());
+                    for (auto const& vertex : blockVertices)
+                    {
+                        vertices.push_back({
+                            vertex[0] + static_cast<Real>(bmin[0]),
+                            vertex[1] + static_cast<Real>(bmin[1]),
+                            vertex[2] + static_cast<Real>(bmin[2]) });
+                    }
+                    for (auto index : blockIndices)
+                    {
+                        indices.push_back(vbase + index);
+                    }
+                });
+
+            if (!valid)
+            {
+                vertices.clear();
+                indices.clear();
+            }
+            return valid;
+        }
+
+        // Extract the triangle mesh approximating F = 0 for all the voxels in
+        // a 3D image without duplicate vertices. Each edge of the sample
+        // lattice whose endpoint values have opposite signs produces one
+        // vertex that is shared by the triangles of the voxels containing
+        // the edge, so the output is that of Extract(level, vertices,
+        // indices) followed by MakeUnique, up to rounding errors and the
+        // order of the vertices. The vertices are ordered by lattice edge
+        // and the triangles by voxel, so the output does not depend on
+        // numThreads.
+        //
+        // To run in the main thread only, choose numThreads to be 0. For
+        // multithreading, choose numThreads > 0. The voxels are then
+        // partitioned into numThreads slabs of consecutive z-values that are
+        // extracted by tasks of TaskScheduler::GetDefault(). A slab caches
+        // the vertex indices of the lattice edges of only two z-values at a
+        // time, so the memory used in addition to the output is proportional
+        // to numThreads times the number of samples of a z-slice.
+        bool ExtractShared(Real level, size_t numThreads,
+            std::vector<Vector3<Real>>& vertices, std::vector<int32_t>& indices) const
+        {
+            vertices.clear();
+            indices.clear();
+
+            int32_t const bound0 = mImage.GetDimension(0);
+            int32_t const bound1 = mImage.GetDimension(1);
+            int32_t const bound2 = mImage.GetDimension(2);
+            if (bound0 < 2 || bound1 < 2 || bound2 < 2)
+            {
+                return true;
+            }
+
+            // Partition the z-values of the voxels into slabs.
+            size_t const numVoxelSlices = static_cast<size_t>(bound2) - 1;
+            size_t const numSlabs = std::max(std::min(numThreads, numVoxelSlices), static_cast<size_t>(1));
+            std::vector<Slab> slabs(numSlabs);
+            for (size_t k = 0; k < numSlabs; ++k)
+            {
+                slabs[k].zmin = static_cast<int32_t>(k * numVoxelSlices / numSlabs);
+                slabs[k].zsup = static_cast<int32_t>((k + 1) * numVoxelSlices / numSlabs);
+            }
+
+            auto extractSlab = [this, level, &slabs](size_t k)
+            {
+                ExtractSlab(level, k + 1 == slabs.size(), slabs[k]);
+            };
+
+            if (numThreads > 0)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numSlabs, extractSlab);
+            }
+            else
+            {
+                extractSlab(0);
+            }
+
+            size_t numVertices = 0, numIndices = 0;
+            for (auto& slab : slabs)
+            {
+                if (!slab.valid)
+                {
+                    return false;
+                }
+
+                slab.vbase = numVertices;
+                slab.ibase = numIndices;
+                numVertices += slab.vertices.size();
+                numIndices += slab.indices.size();
+            }
+
+            // Concatenate the slab outputs. The indices local to a slab are
+            // offset by the number of vertices of the previous slabs. The
+            // triangles in the last voxel slice of a slab refer to vertices
+            // of the next slab by their lattice edges.
+            vertices.resize(numVertices);
+            indices.resize(numIndices);
+            auto mergeSlab = [&slabs, &vertices, &indices](size_t k)
+            {
+                Slab const& slab = slabs[k];
+                std::copy(slab.vertices.begin(), slab.vertices.end(), vertices.begin() + slab.vbase);
+
+                int32_t const vbase = static_cast<int32_t>(slab.vbase);
+                int32_t* output = indices.data() + slab.ibase;
+                for (auto index : slab.indices)
+                {
+                    if (index >= 0)
+                    {
+                        *output++ = vbase + index;
+                    }
+                    else
+                    {
+                        Slab const& next = slabs[k + 1];
+                        *output++ = static_cast<int32_t>(next.vbase) + next.firstSlice[-1 - static_cast<size_t>(index)];
+                    }
+                }
+            };
+
+            if (numThreads > 0)
+            {
+                TaskScheduler::GetDefault().ParallelFor(numSlabs, mergeSlab);
+            }
+            else
+            {
+                mergeSlab(0);
+            }
+            return true;
+        }
+
         // The extraction has duplicate vertices on edges shared by voxels.
         // This function will eliminate the duplication.
         void MakeUnique(std::vector<Vector3<Real>>& vertices, std::vector<int32_t>& indices) const
@@ -272,6 +447,195 @@ namespace gte
         }
 
     protected:
+        // Support for ExtractShared. A slab contains the voxels with
+        // zmin <= z < zsup. It creates the vertices of the lattice edges
+        // whose first endpoint has zmin <= z < zsup and, for the last slab,
+        // those of the x-edges and y-edges with z = zsup. The vertex indices
+        // of a z-slice of x-edges and y-edges are stored at 2 * (x + bound0
+        // * y) + d, where d is 0 for an x-edge and 1 for a y-edge, and those
+        // of the z-edges at x + bound0 * y. An index is -1 when the edge has
+        // no vertex. In the slice z = zsup, which is the first slice of the
+        // next slab, the index is -1 - (2 * (x + bound0 * y) + d) and is
+        // resolved from the firstSlice of the next slab.
+        struct Slab
+        {
+            Slab()
+                :
+                zmin(0),
+                zsup(0),
+                valid(true),
+                vertices{},
+                indices{},
+                firstSlice{},
+                vbase(0),
+                ibase(0)
+            {
+            }
+
+            int32_t zmin, zsup;
+            bool valid;
+            std::vector<Vector3<Real>> vertices;
+            std::vector<int32_t> indices;
+            std::vector<int32_t> firstSlice;
+            size_t vbase, ibase;
+        };
+
+        void ExtractSlab(Real level, bool isLastSlab, Slab& slab) const
+        {
+            size_t const sliceSize = static_cast<size_t>(mImage.GetDimension(0)) *
+                static_cast<size_t>(mImage.GetDimension(1));
+            std::vector<int32_t> lowerXY(2 * sliceSize), upperXY(2 * sliceSize);
+            std::vector<int32_t> edgesZ(sliceSize);
+
+            CreateVerticesXY(level, slab.zmin, slab, lowerXY);
+            if (slab.zmin > 0)
+            {
+                slab.firstSlice = lowerXY;
+            }
+
+            for (int32_t z = slab.zmin; z < slab.zsup; ++z)
+            {
+                CreateVerticesZ(level, z, slab, edgesZ);
+                if (z + 1 < slab.zsup || isLastSlab)
+                {
+                    CreateVerticesXY(level, z + 1, slab, upperXY);
+                }
+                else
+                {
+                    for (size_t i = 0; i < upperXY.size(); ++i)
+                    {
+                        upperXY[i] = -1 - static_cast<int32_t>(i);
+                    }
+                }
+
+                if (!CreateTriangles(level, z, lowerXY, upperXY, edgesZ, slab))
+                {
+                    slab.valid = false;
+                    slab.vertices.clear();
+                    slab.indices.clear();
+                    return;
+                }
+                std::swap(lowerXY, upperXY);
+            }
+        }
+
+        // Create the vertex of the lattice edge from sample (x,y,z) with
+        // value f0 to the next sample along axis d with value f1. The return
+        // value is the slab-local vertex index or -1 when the values do not
+        // have opposite signs.
+        int32_t CreateVertex(Real f0, Real f1, int32_t x, int32_t y, int32_t z,
+            int32_t d, Slab& slab) const
+        {
+            if ((f0 < (Real)0) == (f1 < (Real)0))
+            {
+                return -1;
+            }
+
+            Vector3<Real> position{ static_cast<Real>(x), static_cast<Real>(y), static_cast<Real>(z) };
+            position[d] += f0 / (f0 - f1);
+            int32_t const index = static_cast<int32_t>(slab.vertices.size());
+            slab.vertices.push_back(position);
+            return index;
+        }
+
+        void CreateVerticesXY(Real level, int32_t z, Slab& slab, std::vector<int32_t>& slice) const
+        {
+            int32_t const bound0 = mImage.GetDimension(0);
+            int32_t const bound1 = mImage.GetDimension(1);
+            size_t i = 0, j = mImage.GetIndex(0, 0, z);
+            for (int32_t y = 0; y < bound1; ++y)
+            {
+                for (int32_t x = 0; x < bound0; ++x, ++i, ++j)
+                {
+                    Real const f = mImage[j] - level;
+                    slice[2 * i] = (x + 1 < bound0 ?
+                        CreateVertex(f, mImage[j + 1] - level, x, y, z, 0, slab) : -1);
+                    slice[2 * i + 1] = (y + 1 < bound1 ?
+                        CreateVertex(f, mImage[j + bound0] - level, x, y, z, 1, slab) : -1);
+                }
+            }
+        }
+
+        void CreateVerticesZ(Real level, int32_t z, Slab& slab, std::vector<int32_t>& slice) const
+        {
+            int32_t const bound0 = mImage.GetDimension(0);
+            int32_t const bound1 = mImage.GetDimension(1);
+            size_t const sliceSize = slice.size();
+            size_t i = 0, j = mImage.GetIndex(0, 0, z);
+            for (int32_t y = 0; y < bound1; ++y)
+            {
+                for (int32_t x = 0; x < bound0; ++x, ++i, ++j)
+                {
+                    slice[i] = CreateVertex(mImage[j] - level,
+                        mImage[j + sliceSize] - level, x, y, z, 2, slab);
+                }
+            }
+        }
+
+        // Create the triangles of the voxels with z-value z. The vertices of
+        // a voxel edge from corner j0 to corner j1 are looked up from the
+        // lattice edge that starts at corner j0 & j1 in direction j0 ^ j1.
+        bool CreateTriangles(Real level, int32_t z, std::vector<int32_t> const& lowerXY,
+            std::vector<int32_t> const& upperXY, std::vector<int32_t> const& edgesZ,
+            Slab& slab) const
+        {
+            int32_t const bound0 = mImage.GetDimension(0);
+            int32_t const bound1 = mImage.GetDimension(1);
+            std::array<int32_t, 8> offsets{};
+            mImage.GetCorners(offsets);
+
+            std::array<int32_t, MAX_VERTICES> vertexIndices{};
+            for (int32_t y = 0; y + 1 < bound1; ++y)
+            {
+                size_t j = mImage.GetIndex(0, y, z);
+                for (int32_t x = 0; x + 1 < bound0; ++x, ++j)
+                {
+                    int32_t entry = 0;
+                    for (int32_t k = 0, mask = 1; k < 8; ++k, mask <<= 1)
+                    {
+                        Real const f = mImage[j + offsets[k]] - level;
+                        if (f < (Real)0)
+                        {
+                            entry |= mask;
+                        }
+                        else if (f == (Real)0)
+                        {
+                            return false;
+                        }
+                    }
+
+                    Topology const& topology = GetTable(entry);
+                    for (int32_t i = 0; i < topology.numVertices; ++i)
+                    {
+                        int32_t const j0 = topology.vpair[i][0];
+                        int32_t const j1 = topology.vpair[i][1];
+                        int32_t const corner = (j0 & j1);
+                        int32_t const axis = (j0 ^ j1);
+                        size_t const s = static_cast<size_t>(x + (corner & 1)) +
+                            static_cast<size_t>(bound0) * static_cast<size_t>(y + ((corner & 2) >> 1));
+                        if (axis == 4)
+                        {
+                            vertexIndices[i] = edgesZ[s];
+                        }
+                        else
+                        {
+                            auto const& slice = ((corner & 4) ? upperXY : lowerXY);
+                            vertexIndices[i] = slice[2 * s + (axis >> 1)];
+                        }
+                    }
+
+                    for (int32_t i = 0; i < topology.numTriangles; ++i)
+                    {
+                        for (int32_t k = 0; k < 3; ++k)
+                        {
+                            slab.indices.push_back(vertexIndices[topology.itriple[i][k]]);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
         Vector3<Real> GetGradient(Vector3<Real> position) const
         {
             int32_t x = static_cast<int32_t>(std::floor(position[0]));
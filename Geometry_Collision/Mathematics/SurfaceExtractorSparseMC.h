@@ -0,0 +1,296 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/MarchingCubes.h>
+#include <Mathematics/SparseImage3.h>
+#include <Mathematics/Vector3.h>
+#include <algorithm>
+#include <unordered_map>
+
+// Marching cubes for a SparseImage3. The voxels are processed a brick at a
+// time, and only the bricks that are active or adjacent to an active brick
+// or to a tile of the other sign are visited, so the cost is proportional
+// to the number of active bricks rather than to the size of the image. The
+// output is the same as that of SurfaceExtractorMC::ExtractShared for the
+// dense image, except for the order of the vertices and triangles.
+
+namespace gte
+{
+    template <typename Real>
+    class SurfaceExtractorSparseMC : public MarchingCubes
+    {
+    public:
+        // Construction and destruction.
+        virtual ~SurfaceExtractorSparseMC()
+        {
+        }
+
+        SurfaceExtractorSparseMC(SparseImage3<Real> const& image)
+            :
+            mImage(image)
+        {
+        }
+
+        // Object copies are not allowed.
+        SurfaceExtractorSparseMC() = delete;
+        SurfaceExtractorSparseMC(SurfaceExtractorSparseMC const&) = delete;
+        SurfaceExtractorSparseMC const& operator=(SurfaceExtractorSparseMC const&) = delete;
+
+        // Extract the triangle mesh approximating F = 0 for the image. Each
+        // lattice edge whose endpoint values have opposite signs produces
+        // one vertex shared by the triangles of the voxels that contain the
+        // edge. The function fails as SurfaceExtractorMC::Extract does when
+        // a visited voxel has a corner value equal to the level.
+        bool Extract(Real level, std::vector<Vector3<Real>>& vertices, std::vector<int32_t>& indices) const
+        {
+            vertices.clear();
+            indices.clear();
+
+            int32_t const bound0 = mImage.GetDimension(0);
+            int32_t const bound1 = mImage.GetDimension(1);
+            int32_t const bound2 = mImage.GetDimension(2);
+            if (bound0 < 2 || bound1 < 2 || bound2 < 2)
+            {
+                return true;
+            }
+
+            // The samples of the voxels of a brick and the vertex indices of
+            // the lattice edges starting at the samples. The edges on the
+            // faces of the brick are shared with the neighboring bricks and
+            // are looked up in sharedEdges.
+            std::vector<Real> samples(blockVolume);
+            std::vector<int32_t> edges(3 * blockVolume);
+            std::unordered_map<uint64_t, int32_t> sharedEdges{};
+            std::array<int32_t, MAX_VERTICES> vertexIndices{};
+            std::array<int32_t, 3> brick{}, origin{}, extent{};
+
+            size_t const numBricks = mImage.GetNumBricks();
+            for (size_t b = 0; b < numBricks; ++b)
+            {
+                mImage.GetBrickCoordinates(b, brick);
+                if (!HasSurface(level, brick))
+                {
+                    continue;
+                }
+
+                // Get the samples of the voxels of the brick that are inside
+                // the image.
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    origin[d] = (brick[d] << SparseImage3<Real>::brickLog2);
+                    extent[d] = std::min(brickSize, mImage.GetDimension(d) - 1 - origin[d]);
+                }
+                if (extent[0] <= 0 || extent[1] <= 0 || extent[2] <= 0)
+                {
+                    continue;
+                }
+
+                for (int32_t z = 0; z <= extent[2]; ++z)
+                {
+                    for (int32_t y = 0; y <= extent[1]; ++y)
+                    {
+                        for (int32_t x = 0; x <= extent[0]; ++x)
+                        {
+                            Real const f = mImage(origin[0] + x, origin[1] + y, origin[2] + z) - level;
+                            if (f == (Real)0)
+                            {
+                                vertices.clear();
+                                indices.clear();
+                                return false;
+                            }
+                            samples[GetSampleIndex(x, y, z)] = f;
+                        }
+                    }
+                }
+                std::fill(edges.begin(), edges.end(), -1);
+
+                for (int32_t z = 0; z < extent[2]; ++z)
+                {
+                    for (int32_t y = 0; y < extent[1]; ++y)
+                    {
+                        for (int32_t x = 0; x < extent[0]; ++x)
+                        {
+                            size_t const s = GetSampleIndex(x, y, z);
+                            int32_t entry = 0;
+                            for (int32_t k = 0; k < 8; ++k)
+                            {
+                                if (samples[s + cornerOffsets[k]] < (Real)0)
+                                {
+                                    entry |= (1 << k);
+                                }
+                            }
+
+                            Topology const& topology = GetTable(entry);
+                            for (int32_t i = 0; i < topology.numVertices; ++i)
+                            {
+                                int32_t const j0 = topology.vpair[i][0];
+                                int32_t const j1 = topology.vpair[i][1];
+                                int32_t const corner = (j0 & j1);
+                                int32_t const axis = ((j0 ^ j1) >> 1);
+                                std::array<int32_t, 3> const local =
+                                {
+                                    x + (corner & 1),
+                                    y + ((corner & 2) >> 1),
+                                    z + ((corner & 4) >> 2)
+                                };
+
+                                int32_t& edge = edges[3 * (s + cornerOffsets[corner]) + axis];
+                                if (edge < 0)
+                                {
+                                    edge = GetVertex(samples, origin, local, axis,
+                                        sharedEdges, vertices);
+                                }
+                                vertexIndices[i] = edge;
+                            }
+
+                            for (int32_t i = 0; i < topology.numTriangles; ++i)
+                            {
+                                for (int32_t k = 0; k < 3; ++k)
+                                {
+                                    indices.push_back(vertexIndices[topology.itriple[i][k]]);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+    protected:
+        // The samples of a brick are those of its voxels, which include the
+        // samples of the minimum faces of the neighboring bricks.
+        static int32_t constexpr brickSize = SparseImage3<Real>::brickSize;
+        static int32_t constexpr blockSize = brickSize + 1;
+        static size_t constexpr blockVolume = static_cast<size_t>(blockSize * blockSize * blockSize);
+
+        static constexpr std::array<size_t, 8> cornerOffsets =
+        {
+            0, 1, blockSize, blockSize + 1,
+            blockSize * blockSize, blockSize * blockSize + 1,
+            blockSize * blockSize + blockSize, blockSize * blockSize + blockSize + 1
+        };
+
+        inline static size_t GetSampleIndex(int32_t x, int32_t y, int32_t z)
+        {
+            return static_cast<size_t>(x) + static_cast<size_t>(blockSize) *
+                (static_cast<size_t>(y) + static_cast<size_t>(blockSize) * static_cast<size_t>(z));
+        }
+
+        // The voxels whose minimum corner is in the brick have their other
+        // corners in the bricks with coordinates at most 1 larger. The
+        // voxels can intersect the surface only when one of these bricks is
+        // active or when their tile values do not all have the same sign.
+        bool HasSurface(Real level, std::array<int32_t, 3> const& brick) const
+        {
+            bool hasNegative = false, hasPositive = false;
+            for (int32_t dz = 0; dz < 2; ++dz)
+            {
+                int32_t const bz = brick[2] + dz;
+                if (bz == mImage.GetBrickDimension(2))
+                {
+                    break;
+                }
+
+                for (int32_t dy = 0; dy < 2; ++dy)
+                {
+                    int32_t const by = brick[1] + dy;
+                    if (by == mImage.GetBrickDimension(1))
+                    {
+                        break;
+                    }
+
+                    for (int32_t dx = 0; dx < 2; ++dx)
+                    {
+                        int32_t const bx = brick[0] + dx;
+                        if (bx == mImage.GetBrickDimension(0))
+                        {
+                            break;
+                        }
+
+                        size_t const b = mImage.GetBrickIndex(bx, by, bz);
+                        if (mImage.IsActive(b))
+                        {
+                            return true;
+                        }
+
+                        if (mImage.GetTileValue(b) < level)
+                        {
+                            hasNegative = true;
+                        }
+                        else
+                        {
+                            hasPositive = true;
+                        }
+                    }
+                }
+            }
+            return hasNegative && hasPositive;
+        }
+
+        // Get the vertex of the lattice edge from the sample at 'local' in
+        // the direction 'axis' or -1 when the edge does not intersect the
+        // surface. An edge on a face of the brick is shared with the
+        // neighboring bricks, so its vertex is created once and stored in
+        // sharedEdges with a key that identifies the edge in the image.
+        int32_t GetVertex(std::vector<Real> const& samples, std::array<int32_t, 3> const& origin,
+            std::array<int32_t, 3> const& local, int32_t axis,
+            std::unordered_map<uint64_t, int32_t>& sharedEdges,
+            std::vector<Vector3<Real>>& vertices) const
+        {
+            size_t const s0 = GetSampleIndex(local[0], local[1], local[2]);
+            size_t const s1 = s0 + cornerOffsets[static_cast<size_t>(1) << axis];
+            Real const f0 = samples[s0];
+            Real const f1 = samples[s1];
+            if ((f0 < (Real)0) == (f1 < (Real)0))
+            {
+                return -1;
+            }
+
+            std::array<int32_t, 3> global{};
+            bool isShared = false;
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                global[d] = origin[d] + local[d];
+                if (d != axis && (local[d] == 0 || local[d] == brickSize))
+                {
+                    isShared = true;
+                }
+            }
+
+            uint64_t key = 0;
+            if (isShared)
+            {
+                key = 3 * (static_cast<uint64_t>(global[0]) +
+                    static_cast<uint64_t>(mImage.GetDimension(0)) * (static_cast<uint64_t>(global[1]) +
+                        static_cast<uint64_t>(mImage.GetDimension(1)) * static_cast<uint64_t>(global[2])))
+                    + static_cast<uint64_t>(axis);
+                auto iter = sharedEdges.find(key);
+                if (iter != sharedEdges.end())
+                {
+                    return iter->second;
+                }
+            }
+
+            Vector3<Real> position{ static_cast<Real>(global[0]),
+                static_cast<Real>(global[1]), static_cast<Real>(global[2]) };
+            position[axis] += f0 / (f0 - f1);
+            int32_t const index = static_cast<int32_t>(vertices.size());
+            vertices.push_back(position);
+
+            if (isShared)
+            {
+                sharedEdges.emplace(key, index);
+            }
+            return index;
+        }
+
+        SparseImage3<Real> const& mImage;
+    };
+}
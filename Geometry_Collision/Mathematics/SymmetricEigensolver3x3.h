@@ -17,8 +17,10 @@
 // describes algorithms for solving the eigensystem associated with a 3x3
 // symmetric real-valued matrix. The iterative algorithm is implemented
 // by class SymmmetricEigensolver3x3. The noniterative algorithm is
-// implemented by class NISymmetricEigensolver3x3. The code does not use
-// GTEngine objects.
+// implemented by class NISymmetricEigensolver3x3. To solve arrays of
+// matrices several at a time in SIMD registers, use class
+// NISymmetricEigensolver3x3Batch in SymmetricEigensolver3x3Batch.h. The
+// code does not use GTEngine objects.
 
 namespace gte
 {
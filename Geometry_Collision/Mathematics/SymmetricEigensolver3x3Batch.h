@@ -0,0 +1,543 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/SymmetricEigensolver3x3.h>
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <vector>
+
+// The noniterative algorithm of NISymmetricEigensolver3x3 applied to arrays
+// of symmetric 3x3 matrices, such as the covariance matrices of the nodes of
+// a bounding volume tree or the inertia tensors of a set of rigid bodies.
+// The matrices are processed in blocks, one matrix per SIMD lane: 8 floats
+// or 4 doubles with AVX, 4 floats or 2 doubles with SSE2 or NEON. The
+// branches of NISymmetricEigensolver3x3 are replaced by lane selections,
+// and only acos and cos are evaluated one lane at a time. Other targets
+// call NISymmetricEigensolver3x3 for each matrix.
+//
+// Each lane performs the IEEE operations of NISymmetricEigensolver3x3 in the
+// same order, so the results are the same as those of that class, provided
+// the compiler does not contract a*b+c into fused multiply-adds in the
+// scalar code (MSVC /fp:precise, or -ffp-contract=off for GCC and Clang).
+// The zero and diagonal matrices, for which NISymmetricEigensolver3x3 takes
+// other paths, are passed to it. The lanes of those matrices and the unused
+// lanes of the last block can divide by zero; their results are discarded,
+// but the floating-point status flags can be raised.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GTE_EIGENSOLVER_BATCH_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define GTE_EIGENSOLVER_BATCH_AVX
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GTE_EIGENSOLVER_BATCH_NEON
+#include <arm_neon.h>
+#endif
+
+namespace gte
+{
+    // The lane operations used by NISymmetricEigensolver3x3Batch. The
+    // generic version has one lane. Max and Min return the operand that
+    // std::max and std::min return, including when one of them is a NaN.
+    // The comparisons return masks that are consumed by Select(mask, a, b),
+    // which returns a in the lanes where the mask is set and b in the
+    // others.
+    template <typename T>
+    struct NISymmetricEigensolver3x3Lanes
+    {
+        static size_t constexpr numLanes = 1;
+        using Register = T;
+        using Mask = bool;
+
+        inline static Register Load(T const* p) { return *p; }
+        inline static void Store(Register r, T* p) { *p = r; }
+        inline static Register Set(T s) { return s; }
+        inline static Register Add(Register a, Register b) { return a + b; }
+        inline static Register Sub(Register a, Register b) { return a - b; }
+        inline static Register Mul(Register a, Register b) { return a * b; }
+        inline static Register Div(Register a, Register b) { return a / b; }
+        inline static Register Negate(Register a) { return -a; }
+        inline static Register Sqrt(Register a) { return std::sqrt(a); }
+        inline static Register Abs(Register a) { return std::fabs(a); }
+        inline static Register Max(Register a, Register b) { return std::max(a, b); }
+        inline static Register Min(Register a, Register b) { return std::min(a, b); }
+        inline static Mask Greater(Register a, Register b) { return a > b; }
+        inline static Mask GreaterEqual(Register a, Register b) { return a >= b; }
+        inline static Register Select(Mask m, Register a, Register b) { return m ? a : b; }
+    };
+
+#if defined(GTE_EIGENSOLVER_BATCH_AVX)
+    template <>
+    struct NISymmetricEigensolver3x3Lanes<float>
+    {
+        static size_t constexpr numLanes = 8;
+        using Register = __m256;
+        using Mask = __m256;
+
+        inline static Register Load(float const* p) { return _mm256_loadu_ps(p); }
+        inline static void Store(Register r, float* p) { _mm256_storeu_ps(p, r); }
+        inline static Register Set(float s) { return _mm256_set1_ps(s); }
+        inline static Register Add(Register a, Register b) { return _mm256_add_ps(a, b); }
+        inline static Register Sub(Register a, Register b) { return _mm256_sub_ps(a, b); }
+        inline static Register Mul(Register a, Register b) { return _mm256_mul_ps(a, b); }
+        inline static Register Div(Register a, Register b) { return _mm256_div_ps(a, b); }
+        inline static Register Negate(Register a) { return _mm256_xor_ps(a, _mm256_set1_ps(-0.0f)); }
+        inline static Register Sqrt(Register a) { return _mm256_sqrt_ps(a); }
+        inline static Register Abs(Register a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+        inline static Register Max(Register a, Register b) { return _mm256_max_ps(b, a); }
+        inline static Register Min(Register a, Register b) { return _mm256_min_ps(b, a); }
+        inline static Mask Greater(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+        inline static Mask GreaterEqual(Register a, Register b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+        inline static Register Select(Mask m, Register a, Register b) { return _mm256_blendv_ps(b, a, m); }
+    };
+
+    template <>
+    struct NISymmetricEigensolver3x3Lanes<double>
+    {
+        static size_t constexpr numLanes = 4;
+        using Register = __m256d;
+        using Mask = __m256d;
+
+        inline static Register Load(double const* p) { return _mm256_loadu_pd(p); }
+        inline static void Store(Register r, double* p) { _mm256_storeu_pd(p, r); }
+        inline static Register Set(double s) { return _mm256_set1_pd(s); }
+        inline static Register Add(Register a, Register b) { return _mm256_add_pd(a, b); }
+        inline static Register Sub(Register a, Register b) { return _mm256_sub_pd(a, b); }
+        inline static Register Mul(Register a, Register b) { return _mm256_mul_pd(a, b); }
+        inline static Register Div(Register a, Register b) { return _mm256_div_pd(a, b); }
+        inline static Register Negate(Register a) { return _mm256_xor_pd(a, _mm256_set1_pd(-0.0)); }
+        inline static Register Sqrt(Register a) { return _mm256_sqrt_pd(a); }
+        inline static Register Abs(Register a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+        inline static Register Max(Register a, Register b) { return _mm256_max_pd(b, a); }
+        inline static Register Min(Register a, Register b) { return _mm256_min_pd(b, a); }
+        inline static Mask Greater(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+        inline static Mask GreaterEqual(Register a, Register b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+        inline static Register Select(Mask m, Register a, Register b) { return _mm256_blendv_pd(b, a, m); }
+    };
+#elif defined(GTE_EIGENSOLVER_BATCH_SSE2)
+    template <>
+    struct NISymmetricEigensolver3x3Lanes<float>
+    {
+        static size_t constexpr numLanes = 4;
+        using Register = __m128;
+        using Mask = __m128;
+
+        inline static Register Load(float const* p) { return _mm_loadu_ps(p); }
+        inline static void Store(Register r, float* p) { _mm_storeu_ps(p, r); }
+        inline static Register Set(float s) { return _mm_set1_ps(s); }
+        inline static Register Add(Register a, Register b) { return _mm_add_ps(a, b); }
+        inline static Register Sub(Register a, Register b) { return _mm_sub_ps(a, b); }
+        inline static Register Mul(Register a, Register b) { return _mm_mul_ps(a, b); }
+        inline static Register Div(Register a, Register b) { return _mm_div_ps(a, b); }
+        inline static Register Negate(Register a) { return _mm_xor_ps(a, _mm_set1_ps(-0.0f)); }
+        inline static Register Sqrt(Register a) { return _mm_sqrt_ps(a); }
+        inline static Register Abs(Register a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+        inline static Register Max(Register a, Register b) { return _mm_max_ps(b, a); }
+        inline static Register Min(Register a, Register b) { return _mm_min_ps(b, a); }
+        inline static Mask Greater(Register a, Register b) { return _mm_cmpgt_ps(a, b); }
+        inline static Mask GreaterEqual(Register a, Register b) { return _mm_cmpge_ps(a, b); }
+        inline static Register Select(Mask m, Register a, Register b)
+        {
+            return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b));
+        }
+    };
+
+    template <>
+    struct NISymmetricEigensolver3x3Lanes<double>
+    {
+        static size_t constexpr numLanes = 2;
+        using Register = __m128d;
+        using Mask = __m128d;
+
+        inline static Register Load(double const* p) { return _mm_loadu_pd(p); }
+        inline static void Store(Register r, double* p) { _mm_storeu_pd(p, r); }
+        inline static Register Set(double s) { return _mm_set1_pd(s); }
+        inline static Register Add(Register a, Register b) { return _mm_add_pd(a, b); }
+        inline static Register Sub(Register a, Register b) { return _mm_sub_pd(a, b); }
+        inline static Register Mul(Register a, Register b) { return _mm_mul_pd(a, b); }
+        inline static Register Div(Register a, Register b) { return _mm_div_pd(a, b); }
+        inline static Register Negate(Register a) { return _mm_xor_pd(a, _mm_set1_pd(-0.0)); }
+        inline static Register Sqrt(Register a) { return _mm_sqrt_pd(a); }
+        inline static Register Abs(Register a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+        inline static Register Max(Register a, Register b) { return _mm_max_pd(b, a); }
+        inline static Register Min(Register a, Register b) { return _mm_min_pd(b, a); }
+        inline static Mask Greater(Register a, Register b) { return _mm_cmpgt_pd(a, b); }
+        inline static Mask GreaterEqual(Register a, Register b) { return _mm_cmpge_pd(a, b); }
+        inline static Register Select(Mask m, Register a, Register b)
+        {
+            return _mm_or_pd(_mm_and_pd(m, a), _mm_andnot_pd(m, b));
+        }
+    };
+#elif defined(GTE_EIGENSOLVER_BATCH_NEON)
+    template <>
+    struct NISymmetricEigensolver3x3Lanes<float>
+    {
+        static size_t constexpr numLanes = 4;
+        using Register = float32x4_t;
+        using Mask = uint32x4_t;
+
+        inline static Register Load(float const* p) { return vld1q_f32(p); }
+        inline static void Store(Register r, float* p) { vst1q_f32(p, r); }
+        inline static Register Set(float s) { return vdupq_n_f32(s); }
+        inline static Register Add(Register a, Register b) { return vaddq_f32(a, b); }
+        inline static Register Sub(Register a, Register b) { return vsubq_f32(a, b); }
+        inline static Register Mul(Register a, Register b) { return vmulq_f32(a, b); }
+        inline static Register Div(Register a, Register b) { return vdivq_f32(a, b); }
+        inline static Register Negate(Register a) { return vnegq_f32(a); }
+        inline static Register Sqrt(Register a) { return vsqrtq_f32(a); }
+        inline static Register Abs(Register a) { return vabsq_f32(a); }
+        inline static Register Max(Register a, Register b) { return vbslq_f32(vcltq_f32(a, b), b, a); }
+        inline static Register Min(Register a, Register b) { return vbslq_f32(vcltq_f32(b, a), b, a); }
+        inline static Mask Greater(Register a, Register b) { return vcgtq_f32(a, b); }
+        inline static Mask GreaterEqual(Register a, Register b) { return vcgeq_f32(a, b); }
+        inline static Register Select(Mask m, Register a, Register b) { return vbslq_f32(m, a, b); }
+    };
+
+    template <>
+    struct NISymmetricEigensolver3x3Lanes<double>
+    {
+        static size_t constexpr numLanes = 2;
+        using Register = float64x2_t;
+        using Mask = uint64x2_t;
+
+        inline static Register Load(double const* p) { return vld1q_f64(p); }
+        inline static void Store(Register r, double* p) { vst1q_f64(p, r); }
+        inline static Register Set(double s) { return vdupq_n_f64(s); }
+        inline static Register Add(Register a, Register b) { return vaddq_f64(a, b); }
+        inline static Register Sub(Register a, Register b) { return vsubq_f64(a, b); }
+        inline static Register Mul(Register a, Register b) { return vmulq_f64(a, b); }
+        inline static Register Div(Register a, Register b) { return vdivq_f64(a, b); }
+        inline static Register Negate(Register a) { return vnegq_f64(a); }
+        inline static Register Sqrt(Register a) { return vsqrtq_f64(a); }
+        inline static Register Abs(Register a) { return vabsq_f64(a); }
+        inline static Register Max(Register a, Register b) { return vbslq_f64(vcltq_f64(a, b), b, a); }
+        inline static Register Min(Register a, Register b) { return vbslq_f64(vcltq_f64(b, a), b, a); }
+        inline static Mask Greater(Register a, Register b) { return vcgtq_f64(a, b); }
+        inline static Mask GreaterEqual(Register a, Register b) { return vcgeq_f64(a, b); }
+        inline static Register Select(Mask m, Register a, Register b) { return vbslq_f64(m, a, b); }
+    };
+#endif
+
+    template <typename T>
+    class NISymmetricEigensolver3x3Batch
+    {
+    public:
+        using Lanes = NISymmetricEigensolver3x3Lanes<T>;
+        static size_t constexpr batchSize = Lanes::numLanes;
+
+        // Each matrix is packed as { a00, a01, a02, a11, a12, a22 }. The
+        // eval[] and evec[] arrays must have numMatrices elements. The
+        // sortType is that of NISymmetricEigensolver3x3.
+        void operator()(size_t numMatrices, std::array<T, 6> const* matrices,
+            int32_t sortType, std::array<T, 3>* eval,
+            std::array<std::array<T, 3>, 3>* evec) const
+        {
+            Solve(numMatrices, matrices, sortType, eval, evec,
+                std::integral_constant<bool, batchSize == 1>());
+        }
+
+        void operator()(std::vector<std::array<T, 6>> const& matrices,
+            int32_t sortType, std::vector<std::array<T, 3>>& eval,
+            std::vector<std::array<std::array<T, 3>, 3>>& evec) const
+        {
+            eval.resize(matrices.size());
+            evec.resize(matrices.size());
+            operator()(matrices.size(), matrices.data(), sortType, eval.data(), evec.data());
+        }
+
+    private:
+        // The targets without SIMD lanes call NISymmetricEigensolver3x3 for
+        // each matrix.
+        void Solve(size_t numMatrices, std::array<T, 6> const* matrices,
+            int32_t sortType, std::array<T, 3>* eval,
+            std::array<std::array<T, 3>, 3>* evec, std::true_type) const
+        {
+            NISymmetricEigensolver3x3<T> solver{};
+            for (size_t i = 0; i < numMatrices; ++i)
+            {
+                std::array<T, 6> const& matrix = matrices[i];
+                solver(matrix[0], matrix[1], matrix[2], matrix[3], matrix[4], matrix[5],
+                    sortType, eval[i], evec[i]);
+            }
+        }
+
+        void Solve(size_t numMatrices, std::array<T, 6> const* matrices,
+            int32_t sortType, std::array<T, 3>* eval,
+            std::array<std::array<T, 3>, 3>* evec, std::false_type) const
+        {
+            for (size_t first = 0; first < numMatrices; first += batchSize)
+            {
+                size_t const remaining = numMatrices - first;
+                size_t const count = (remaining < batchSize ? remaining : batchSize);
+                SolveBlock(count, matrices + first, sortType, eval + first, evec + first);
+            }
+        }
+
+        using Register = typename Lanes::Register;
+        using Mask = typename Lanes::Mask;
+        using Buffer = std::array<T, batchSize>;
+
+        // The SIMD register types have attributes that std::array<Register, 3>
+        // would ignore.
+        struct Register3
+        {
+            inline Register& operator[](size_t i) { return element[i]; }
+            inline Register const& operator[](size_t i) const { return element[i]; }
+
+            Register element[3];
+        };
+        void SolveBlock(size_t count, std::array<T, 6> const* matrices,
+            int32_t sortType, std::array<T, 3>* eval,
+            std::array<std::array<T, 3>, 3>* evec) const
+        {
+            Register const zero = Lanes::Set((T)0);
+            Register const one = Lanes::Set((T)1);
+
+            // Load the matrix components, one matrix per lane. The unused
+            // lanes of the last block repeat the first matrix.
+            std::array<Buffer, 6> components{};
+            for (size_t j = 0; j < batchSize; ++j)
+            {
+                std::array<T, 6> const& matrix = matrices[j < count ? j : 0];
+                for (size_t k = 0; k < 6; ++k)
+                {
+                    components[k][j] = matrix[k];
+                }
+            }
+            Register a00 = Lanes::Load(components[0].data());
+            Register a01 = Lanes::Load(components[1].data());
+            Register a02 = Lanes::Load(components[2].data());
+            Register a11 = Lanes::Load(components[3].data());
+            Register a12 = Lanes::Load(components[4].data());
+            Register a22 = Lanes::Load(components[5].data());
+
+            // Precondition the matrices and compute q, p and cos(3*theta)
+            // as NISymmetricEigensolver3x3 does. The lanes of the zero and
+            // diagonal matrices use 1 for the scale and for p.
+            Register max0 = Lanes::Max(Lanes::Abs(a00), Lanes::Abs(a01));
+            Register max1 = Lanes::Max(Lanes::Abs(a02), Lanes::Abs(a11));
+            Register max2 = Lanes::Max(Lanes::Abs(a12), Lanes::Abs(a22));
+            Register maxAbsElement = Lanes::Max(Lanes::Max(max0, max1), max2);
+            Register invMaxAbsElement = Lanes::Div(one,
+                Lanes::Select(Lanes::Greater(maxAbsElement, zero), maxAbsElement, one));
+            a00 = Lanes::Mul(a00, invMaxAbsElement);
+            a01 = Lanes::Mul(a01, invMaxAbsElement);
+            a02 = Lanes::Mul(a02, invMaxAbsElement);
+            a11 = Lanes::Mul(a11, invMaxAbsElement);
+            a12 = Lanes::Mul(a12, invMaxAbsElement);
+            a22 = Lanes::Mul(a22, invMaxAbsElement);
+
+            Register norm = Lanes::Add(Lanes::Add(Lanes::Mul(a01, a01),
+                Lanes::Mul(a02, a02)), Lanes::Mul(a12, a12));
+            Register q = Lanes::Div(Lanes::Add(Lanes::Add(a00, a11), a22), Lanes::Set((T)3));
+            Register b00 = Lanes::Sub(a00, q);
+            Register b11 = Lanes::Sub(a11, q);
+            Register b22 = Lanes::Sub(a22, q);
+            Register sum = Lanes::Add(Lanes::Add(Lanes::Mul(b00, b00), Lanes::Mul(b11, b11)),
+                Lanes::Mul(b22, b22));
+            sum = Lanes::Add(sum, Lanes::Mul(norm, Lanes::Set((T)2)));
+            Register p = Lanes::Sqrt(Lanes::Div(sum, Lanes::Set((T)6)));
+            Register safeP = Lanes::Select(Lanes::Greater(norm, zero), p, one);
+
+            Register c00 = Lanes::Sub(Lanes::Mul(b11, b22), Lanes::Mul(a12, a12));
+            Register c01 = Lanes::Sub(Lanes::Mul(a01, b22), Lanes::Mul(a12, a02));
+            Register c02 = Lanes::Sub(Lanes::Mul(a01, a12), Lanes::Mul(b11, a02));
+            Register det = Lanes::Add(Lanes::Sub(Lanes::Mul(b00, c00), Lanes::Mul(a01, c01)),
+                Lanes::Mul(a02, c02));
+            det = Lanes::Div(det, Lanes::Mul(Lanes::Mul(safeP, safeP), safeP));
+            Register halfDet = Lanes::Mul(det, Lanes::Set((T)0.5));
+            halfDet = Lanes::Min(Lanes::Max(halfDet, Lanes::Set((T)-1)), one);
+
+            // Compute the eigenvalues in ascending order, one lane at a
+            // time for the trigonometric functions.
+            Buffer qBuffer{}, pBuffer{}, halfDetBuffer{};
+            std::array<Buffer, 3> valueBuffer{};
+            Lanes::Store(q, qBuffer.data());
+            Lanes::Store(p, pBuffer.data());
+            Lanes::Store(halfDet, halfDetBuffer.data());
+            T const twoThirdsPi = (T)2.09439510239319549;
+            for (size_t j = 0; j < batchSize; ++j)
+            {
+                T angle = std::acos(halfDetBuffer[j]) / (T)3;
+                T beta2 = std::cos(angle) * (T)2;
+                T beta0 = std::cos(angle + twoThirdsPi) * (T)2;
+                T beta1 = -(beta0 + beta2);
+                valueBuffer[0][j] = qBuffer[j] + pBuffer[j] * beta0;
+                valueBuffer[1][j] = qBuffer[j] + pBuffer[j] * beta1;
+                valueBuffer[2][j] = qBuffer[j] + pBuffer[j] * beta2;
+            }
+
+            // Compute the eigenvector W of the eigenvalue that is well
+            // separated from the others, which is eval[2] when
+            // cos(3*theta) >= 0 and eval[0] otherwise, then the eigenvector
+            // E of eval[1]. The third eigenvector is their cross product.
+            Mask const useMax = Lanes::GreaterEqual(halfDet, zero);
+            Register const eval0 = Lanes::Select(useMax,
+                Lanes::Load(valueBuffer[2].data()), Lanes::Load(valueBuffer[0].data()));
+            Register const eval1 = Lanes::Load(valueBuffer[1].data());
+            Register3 W = ComputeEigenvector0(a00, a01, a02, a11, a12, a22, eval0);
+            Register3 E = ComputeEigenvector1(a00, a01, a02, a11, a12, a22, W, eval1);
+            Register3 WxE = Cross(W, E), ExW = Cross(E, W);
+
+            // Store the results, reverting the preconditioning scale.
+            Buffer maxAbsBuffer{}, normBuffer{};
+            std::array<std::array<Buffer, 3>, 3> vectorBuffer{};
+            Lanes::Store(maxAbsElement, maxAbsBuffer.data());
+            Lanes::Store(norm, normBuffer.data());
+            for (size_t i = 0; i < 3; ++i)
+            {
+                Lanes::Store(Lanes::Select(useMax, ExW[i], W[i]), vectorBuffer[0][i].data());
+                Lanes::Store(E[i], vectorBuffer[1][i].data());
+                Lanes::Store(Lanes::Select(useMax, W[i], WxE[i]), vectorBuffer[2][i].data());
+            }
+
+            NISymmetricEigensolver3x3<T> solver{};
+            for (size_t j = 0; j < count; ++j)
+            {
+                if (maxAbsBuffer[j] == (T)0 || !(normBuffer[j] > (T)0))
+                {
+                    std::array<T, 6> const& matrix = matrices[j];
+                    solver(matrix[0], matrix[1], matrix[2], matrix[3], matrix[4], matrix[5],
+                        sortType, eval[j], evec[j]);
+                    continue;
+                }
+
+                for (size_t i = 0; i < 3; ++i)
+                {
+                    eval[j][i] = valueBuffer[i][j] * maxAbsBuffer[j];
+                    for (size_t k = 0; k < 3; ++k)
+                    {
+                        evec[j][i][k] = vectorBuffer[i][k][j];
+                    }
+                }
+                SortEigenstuff<T>()(sortType, true, eval[j], evec[j]);
+            }
+        }
+
+        static Register Dot(Register3 const& U, Register3 const& V)
+        {
+            return Lanes::Add(Lanes::Add(Lanes::Mul(U[0], V[0]), Lanes::Mul(U[1], V[1])),
+                Lanes::Mul(U[2], V[2]));
+        }
+
+        static Register3 Cross(Register3 const& U, Register3 const& V)
+        {
+            Register3 cross =
+            {
+                Lanes::Sub(Lanes::Mul(U[1], V[2]), Lanes::Mul(U[2], V[1])),
+                Lanes::Sub(Lanes::Mul(U[2], V[0]), Lanes::Mul(U[0], V[2])),
+                Lanes::Sub(Lanes::Mul(U[0], V[1]), Lanes::Mul(U[1], V[0]))
+            };
+            return cross;
+        }
+
+        // NISymmetricEigensolver3x3::ComputeEigenvector0 with the row pair
+        // of largest cross product selected per lane.
+        static Register3 ComputeEigenvector0(Register a00, Register a01, Register a02,
+            Register a11, Register a12, Register a22, Register eval0)
+        {
+            Register3 row0 = { Lanes::Sub(a00, eval0), a01, a02 };
+            Register3 row1 = { a01, Lanes::Sub(a11, eval0), a12 };
+            Register3 row2 = { a02, a12, Lanes::Sub(a22, eval0) };
+            Register3 r0xr1 = Cross(row0, row1);
+            Register3 r0xr2 = Cross(row0, row2);
+            Register3 r1xr2 = Cross(row1, row2);
+            Register d0 = Dot(r0xr1, r0xr1);
+            Register d1 = Dot(r0xr2, r0xr2);
+            Register d2 = Dot(r1xr2, r1xr2);
+
+            Mask const use1 = Lanes::Greater(d1, d0);
+            Register dmax = Lanes::Select(use1, d1, d0);
+            Mask const use2 = Lanes::Greater(d2, dmax);
+            dmax = Lanes::Select(use2, d2, dmax);
+            Register invLength = Lanes::Div(Lanes::Set((T)1), Lanes::Sqrt(dmax));
+
+            Register3 evec0{};
+            for (size_t i = 0; i < 3; ++i)
+            {
+                Register r = Lanes::Select(use2, r1xr2[i], Lanes::Select(use1, r0xr2[i], r0xr1[i]));
+                evec0[i] = Lanes::Mul(r, invLength);
+            }
+            return evec0;
+        }
+
+        // NISymmetricEigensolver3x3::ComputeEigenvector1 with the row of M
+        // and its normalization selected per lane. The selected row is
+        // (x,y), where x is the diagonal entry m00 or m11 and y is m01.
+        static Register3 ComputeEigenvector1(Register a00, Register a01, Register a02,
+            Register a11, Register a12, Register a22, Register3 const& evec0, Register eval1)
+        {
+            Register const zero = Lanes::Set((T)0);
+            Register const one = Lanes::Set((T)1);
+
+            // ComputeOrthogonalComplement(evec0, U, V).
+            Mask const useX = Lanes::Greater(Lanes::Abs(evec0[0]), Lanes::Abs(evec0[1]));
+            Register w = Lanes::Select(useX, evec0[0], evec0[1]);
+            Register invLength = Lanes::Div(one, Lanes::Sqrt(Lanes::Add(
+                Lanes::Mul(w, w), Lanes::Mul(evec0[2], evec0[2]))));
+            Register3 U =
+            {
+                Lanes::Select(useX, Lanes::Mul(Lanes::Negate(evec0[2]), invLength), zero),
+                Lanes::Select(useX, zero, Lanes::Mul(evec0[2], invLength)),
+                Lanes::Select(useX, Lanes::Mul(evec0[0], invLength),
+                    Lanes::Mul(Lanes::Negate(evec0[1]), invLength))
+            };
+            Register3 V = Cross(evec0, U);
+
+            Register3 AU =
+            {
+                Lanes::Add(Lanes::Add(Lanes::Mul(a00, U[0]), Lanes::Mul(a01, U[1])), Lanes::Mul(a02, U[2])),
+                Lanes::Add(Lanes::Add(Lanes::Mul(a01, U[0]), Lanes::Mul(a11, U[1])), Lanes::Mul(a12, U[2])),
+                Lanes::Add(Lanes::Add(Lanes::Mul(a02, U[0]), Lanes::Mul(a12, U[1])), Lanes::Mul(a22, U[2]))
+            };
+            Register3 AV =
+            {
+                Lanes::Add(Lanes::Add(Lanes::Mul(a00, V[0]), Lanes::Mul(a01, V[1])), Lanes::Mul(a02, V[2])),
+                Lanes::Add(Lanes::Add(Lanes::Mul(a01, V[0]), Lanes::Mul(a11, V[1])), Lanes::Mul(a12, V[2])),
+                Lanes::Add(Lanes::Add(Lanes::Mul(a02, V[0]), Lanes::Mul(a12, V[1])), Lanes::Mul(a22, V[2]))
+            };
+            Register m00 = Lanes::Sub(Dot(U, AU), eval1);
+            Register m01 = Dot(U, AV);
+            Register m11 = Lanes::Sub(Dot(V, AV), eval1);
+
+            Register absM00 = Lanes::Abs(m00);
+            Register absM01 = Lanes::Abs(m01);
+            Register absM11 = Lanes::Abs(m11);
+            Mask const useRow0 = Lanes::GreaterEqual(absM00, absM11);
+            Register x = Lanes::Select(useRow0, m00, m11);
+            Register absX = Lanes::Select(useRow0, absM00, absM11);
+            Register y = m01;
+            Register absY = absM01;
+
+            Mask const xIsLarger = Lanes::GreaterEqual(absX, absY);
+            Register ratio = Lanes::Select(xIsLarger, Lanes::Div(y, x), Lanes::Div(x, y));
+            Register invNorm = Lanes::Div(one, Lanes::Sqrt(Lanes::Add(one, Lanes::Mul(ratio, ratio))));
+            Register scaled = Lanes::Mul(ratio, invNorm);
+            x = Lanes::Select(xIsLarger, invNorm, scaled);
+            y = Lanes::Select(xIsLarger, scaled, invNorm);
+            Mask const isNonzero = Lanes::Greater(Lanes::Max(absX, absY), zero);
+            Register cu = Lanes::Select(useRow0, y, x);
+            Register cv = Lanes::Select(useRow0, x, y);
+
+            Register3 evec1{};
+            for (size_t i = 0; i < 3; ++i)
+            {
+                evec1[i] = Lanes::Select(isNonzero,
+                    Lanes::Sub(Lanes::Mul(cu, U[i]), Lanes::Mul(cv, V[i])), U[i]);
+            }
+            return evec1;
+        }
+    };
+}
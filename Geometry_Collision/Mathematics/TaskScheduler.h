@@ -0,0 +1,344 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Logger.h>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A persistent pool of worker threads that execute tasks. Each worker has
+// a double-ended queue of tasks. A task submitted by a worker is pushed to
+// the back of its own queue and the worker pops tasks from the back, so
+// nested work stays on the worker that created it. A worker whose queue is
+// empty steals from the front of the other queues. Tasks submitted by
+// threads that are not workers go to a shared queue.
+//
+// Tasks are submitted through a TaskGroup. TaskGroup::Wait() executes
+// queued tasks on the waiting thread until all tasks of the group have
+// finished, so a scheduler with 0 workers runs every task on the threads
+// that wait, and nested groups do not deadlock.
+//
+//   TaskScheduler::TaskGroup group;
+//   for (size_t t = 0; t < numTasks; ++t)
+//   {
+//       group.Run([t, &data]() { Process(t, data); });
+//   }
+//   group.Wait();
+//
+// The algorithms in this library that run on multiple threads submit their
+// tasks to TaskScheduler::GetDefault(). The built-in default has one worker
+// fewer than std::thread::hardware_concurrency(), because the submitting
+// thread also executes tasks while it waits. A host that manages its own
+// threads can create a scheduler with the number of workers it wants, or
+// with 0 workers and host threads that call RunOneTask(), and install it
+// with SetDefault.
+
+namespace gte
+{
+    class TaskScheduler
+    {
+    public:
+        // Construction and destruction. The destructor stops the workers.
+        // All task groups of the scheduler must have been waited on.
+        TaskScheduler(size_t numWorkers)
+            :
+            mQueues{},
+            mWorkers{},
+            mSleepMutex{},
+            mSleep{},
+            mNumQueued(0),
+            mStop(false)
+        {
+            // Queue numWorkers is the shared queue.
+            mQueues.resize(numWorkers + 1);
+            for (auto& queue : mQueues)
+            {
+                queue = std::make_unique<Queue>();
+            }
+
+            mWorkers.resize(numWorkers);
+            for (size_t i = 0; i < numWorkers; ++i)
+            {
+                mWorkers[i] = std::thread([this, i]() { WorkerLoop(i); });
+            }
+        }
+
+        ~TaskScheduler()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mSleepMutex);
+                mStop = true;
+            }
+            mSleep.notify_all();
+            for (auto& worker : mWorkers)
+            {
+                worker.join();
+            }
+        }
+
+        TaskScheduler(TaskScheduler const&) = delete;
+        TaskScheduler& operator=(TaskScheduler const&) = delete;
+
+        inline size_t GetNumWorkers() const
+        {
+            return mWorkers.size();
+        }
+
+        // The scheduler used by the algorithms of the library. Pass nullptr
+        // to SetDefault to restore the built-in scheduler. The installed
+        // scheduler must outlive its use.
+        static TaskScheduler& GetDefault()
+        {
+            TaskScheduler* scheduler = InstalledDefault().load();
+            if (scheduler == nullptr)
+            {
+                static TaskScheduler builtIn(GetDefaultNumWorkers());
+                scheduler = &builtIn;
+            }
+            return *scheduler;
+        }
+
+        static void SetDefault(TaskScheduler* scheduler)
+        {
+            InstalledDefault().store(scheduler);
+        }
+
+        // Execute one queued task on the calling thread. The return value
+        // is 'false' when no task was queued.
+        bool RunOneTask()
+        {
+            Task task{};
+            if (TryGetTask(task))
+            {
+                task();
+                return true;
+            }
+            return false;
+        }
+
+        class TaskGroup
+        {
+        public:
+            TaskGroup(TaskScheduler& scheduler = TaskScheduler::GetDefault())
+                :
+                mScheduler(scheduler),
+                mNumPending(0),
+                mExceptionMutex{},
+                mException{}
+            {
+            }
+
+            // Waiting in the destructor ensures that no task refers to the
+            // group after it is destroyed. Exceptions of the tasks are
+            // discarded here; call Wait() to receive them.
+            ~TaskGroup()
+            {
+                WaitForTasks();
+            }
+
+            TaskGroup(TaskGroup const&) = delete;
+            TaskGroup& operator=(TaskGroup const&) = delete;
+
+            template <typename Function>
+            void Run(Function&& function)
+            {
+                mNumPending.fetch_add(1);
+                mScheduler.Submit(
+                    [this, function = std::forward<Function>(function)]() mutable
+                    {
+                        try
+                        {
+                            function();
+                        }
+                        catch (...)
+                        {
+                            std::lock_guard<std::mutex> lock(mExceptionMutex);
+                            if (!mException)
+                            {
+                                mException = std::current_exception();
+                            }
+                        }
+                        mNumPending.fetch_sub(1);
+                    });
+            }
+
+            // Execute queued tasks until all tasks of the group have
+            // finished. The first exception thrown by a task is rethrown.
+            void Wait()
+            {
+                WaitForTasks();
+                if (mException)
+                {
+                    std::exception_ptr exception = mException;
+                    mException = nullptr;
+                    std::rethrow_exception(exception);
+                }
+            }
+
+        private:
+            void WaitForTasks()
+            {
+                while (mNumPending.load() > 0)
+                {
+                    if (!mScheduler.RunOneTask())
+                    {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            TaskScheduler& mScheduler;
+            std::atomic<size_t> mNumPending;
+            std::mutex mExceptionMutex;
+            std::exception_ptr mException;
+        };
+
+        // Execute function(i) for 0 <= i < numTasks as tasks of the
+        // scheduler and wait for them.
+        template <typename Function>
+        void ParallelFor(size_t numTasks, Function const& function)
+        {
+            TaskGroup group(*this);
+            for (size_t i = 0; i < numTasks; ++i)
+            {
+                group.Run([&function, i]() { function(i); });
+            }
+            group.Wait();
+        }
+
+    private:
+        using Task = std::function<void()>;
+
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        static size_t GetDefaultNumWorkers()
+        {
+            size_t const numHardware = static_cast<size_t>(std::thread::hardware_concurrency());
+            return (numHardware > 1 ? numHardware - 1 : 0);
+        }
+
+        static std::atomic<TaskScheduler*>& InstalledDefault()
+        {
+            static std::atomic<TaskScheduler*> installed(nullptr);
+            return installed;
+        }
+
+        // The scheduler and queue index of the calling worker thread, or
+        // nullptr for threads that are not workers.
+        struct WorkerIdentity
+        {
+            TaskScheduler* scheduler;
+            size_t index;
+        };
+
+        static WorkerIdentity& CurrentWorker()
+        {
+            static thread_local WorkerIdentity identity{ nullptr, 0 };
+            return identity;
+        }
+
+        size_t GetOwnQueue() const
+        {
+            WorkerIdentity const& identity = CurrentWorker();
+            return (identity.scheduler == this ? identity.index : mWorkers.size());
+        }
+
+        void Submit(Task&& task)
+        {
+            Queue& queue = *mQueues[GetOwnQueue()];
+            {
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                queue.tasks.push_back(std::move(task));
+            }
+
+            // The counter is updated under the sleep mutex so that a worker
+            // that is about to sleep cannot miss the notification.
+            {
+                std::lock_guard<std::mutex> lock(mSleepMutex);
+                mNumQueued.fetch_add(1);
+            }
+            mSleep.notify_one();
+        }
+
+        bool TryGetTask(Task& task)
+        {
+            if (mNumQueued.load() == 0)
+            {
+                return false;
+            }
+
+            // Pop from the back of the own queue, then steal from the front
+            // of the other queues starting at the next one.
+            size_t const own = GetOwnQueue();
+            {
+                Queue& queue = *mQueues[own];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                    mNumQueued.fetch_sub(1);
+                    return true;
+                }
+            }
+
+            size_t const numQueues = mQueues.size();
+            for (size_t k = 1; k < numQueues; ++k)
+            {
+                Queue& queue = *mQueues[(own + k) % numQueues];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (!queue.tasks.empty())
+                {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                    mNumQueued.fetch_sub(1);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        void WorkerLoop(size_t index)
+        {
+            CurrentWorker() = { this, index };
+            for (;;)
+            {
+                if (RunOneTask())
+                {
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock(mSleepMutex);
+                mSleep.wait(lock, [this]() { return mStop || mNumQueued.load() > 0; });
+                if (mStop)
+                {
+                    return;
+                }
+            }
+        }
+
+        std::vector<std::unique_ptr<Queue>> mQueues;
+        std::vector<std::thread> mWorkers;
+        std::mutex mSleepMutex;
+        std::condition_variable mSleep;
+        std::atomic<size_t> mNumQueued;
+        bool mStop;
+    };
+}
@@ -8,11 +8,12 @@
 #pragma once
 
 #include <Mathematics/Logger.h>
+#include <Mathematics/TaskScheduler.h>
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <cstdint>
 #include <stdexcept>
-#include <thread>
 #include <vector>
 
 namespace gte
@@ -39,6 +40,8 @@ namespace gte
             mTetrahedra(tetrahedra),
             mTetraMin(numTetrahedra),
             mTetraMax(numTetrahedra),
+            mClipTetraMin(numTetrahedra),
+            mClipTetraMax(numTetrahedra),
             mValid(numTetrahedra),
             mGridVertices(numVertices),
             mGridTetraMin(numTetrahedra),
@@ -64,35 +67,28 @@ namespace gte
         // contained by a tetrahedron, grid[i] is set to the tetrahedron
         // index t where 0 <= t < numTetrahedra.
         //
+        // A grid point contained by several tetrahedra, for example a point
+        // on a shared face, stores the largest of their indices.
+        //
         // To run in the main thread only, choose numThreads to be 0. For
-        // multithreading, choose numThreads > 0. The number of available
-        // hardware threads is std::thread::hardware_concurrency(). A
-        // reasonable choice for numThreads will not exceed the number of
-        // available hardware threads. You might want to keep 1 or 2 threads
-        // available for the operating system and other applications running
-        // on the machine.
+        // multithreading, choose numThreads > 0. The grid is then
+        // partitioned into numThreads slabs of z-values, each rasterized
+        // by a task of TaskScheduler::GetDefault(), whose workers are shared
+        // with the other algorithms. Each task visits the tetrahedra in
+        // order, so the grid does not depend on numThreads. A reasonable
+        // choice for numThreads is a small multiple of the number of
+        // workers.
         void operator()(size_t numThreads, std::array<T, 3> const& regionMin,
             std::array<T, 3> const& regionMax, std::array<size_t, 3> const& bound,
             std::vector<int32_t>& grid)
         {
-            if (bound[0] < 2 || bound[1] < 2 || bound[2] < 2)
-            {
-                LogError("Invalid argument.");
-            }
-
             // Initialize the grid values to -1. When a grid cell is contained
             // in a tetrahedron, the index of that tetrahedron is stored in
             // grid[i]. All such contained grid[] values are nonnegative.
+            Prepare(regionMin, regionMax, bound);
             grid.resize(bound[0] * bound[1] * bound[2]);
             std::fill(grid.begin(), grid.end(), -1);
 
-            // Clip-cull the tetrahedra bounding boxes against the region.
-            ClipCullAABBs(regionMin, regionMax);
-
-            // Transform the vertices and tetrahedra bounding boxes to
-            // grid coordinates.
-            TransformToGridCoordinates(regionMin, regionMax, bound);
-
             if (numThreads > 0)
             {
                 MultiThreadedRasterizer(numThreads, bound, grid);
@@ -103,6 +99,86 @@ namespace gte
             }
         }
 
+        // Clip-cull the tetrahedra against the region and transform the
+        // vertices and the bounding boxes of the tetrahedra to grid
+        // coordinates. The operator() calls this function; it is public for
+        // other implementations of the rasterization, such as a compute
+        // shader, which test the grid points of the same rows with the same
+        // arithmetic.
+        void Prepare(std::array<T, 3> const& regionMin,
+            std::array<T, 3> const& regionMax, std::array<size_t, 3> const& bound)
+        {
+            if (bound[0] < 2 || bound[1] < 2 || bound[2] < 2)
+            {
+                LogError("Invalid argument.");
+            }
+
+            ClipCullAABBs(regionMin, regionMax);
+            TransformToGridCoordinates(regionMin, regionMax, bound);
+        }
+
+        // The results of Prepare. A tetrahedron is rasterized only when
+        // IsValid(t) is true, and only the grid points (x,y,z) with
+        // GetGridTetraMin(t) <= (x,y,z) <= GetGridTetraMax(t).
+        inline bool IsValid(size_t t) const
+        {
+            return mValid[t];
+        }
+
+        inline std::vector<std::array<T, 3>> const& GetGridVertices() const
+        {
+            return mGridVertices;
+        }
+
+        inline std::vector<std::array<size_t, 3>> const& GetGridTetraMin() const
+        {
+            return mGridTetraMin;
+        }
+
+        inline std::vector<std::array<size_t, 3>> const& GetGridTetraMax() const
+        {
+            return mGridTetraMax;
+        }
+
+        // The grid point test of the rasterization, in grid coordinates.
+        // The point is contained when it is on the nonpositive side of the
+        // 4 face planes, so points on a face are contained.
+        static bool PointInTetrahedron(std::array<T, 3> const& P,
+            std::array<T, 3> const& V0, std::array<T, 3> const& V1,
+            std::array<T, 3> const& V2, std::array<T, 3> const& V3)
+        {
+            T const zero = static_cast<T>(0);
+
+            std::array<T, 3> PmV0 = Sub(P, V0);
+            std::array<T, 3> V1mV0 = Sub(V1, V0);
+            std::array<T, 3> V2mV0 = Sub(V2, V0);
+            if (DotCross(PmV0, V2mV0, V1mV0) > zero)
+            {
+                return false;
+            }
+
+            std::array<T, 3> V3mV0 = Sub(V3, V0);
+            if (DotCross(PmV0, V1mV0, V3mV0) > zero)
+            {
+                return false;
+            }
+
+            if (DotCross(PmV0, V3mV0, V2mV0) > zero)
+            {
+                return false;
+            }
+
+            std::array<T, 3> PmV1 = Sub(P, V1);
+            std::array<T, 3> V2mV1 = Sub(V2, V1);
+            std::array<T, 3> V3mV1 = Sub(V3, V1);
+            if (DotCross(PmV1, V2mV1, V3mV1) > zero)
+            {
+                return false;
+            }
+
+            return true;
+        }
+
     private:
         // Compute the axis-aligned bounding boxes of the tetrahedra.
         void ComputeTetrahedraAABBs()
@@ -133,14 +209,17 @@ namespace gte
 
         // Clip-cull the tetrahedra bounding boxes against the region.
         // The mValid[t] is true whenever the mAABB[t] intersects the
-        // region.
+        // region. The clipped boxes are stored separately so that the
+        // rasterizer can be called again with another region.
         void ClipCullAABBs(std::array<T, 3> const& regionMin,
             std::array<T, 3> const& regionMax)
         {
             for (size_t t = 0; t < mNumTetrahedra; ++t)
             {
-                auto& tetraMin = mTetraMin[t];
-                auto& tetraMax = mTetraMax[t];
+                auto& tetraMin = mClipTetraMin[t];
+                auto& tetraMax = mClipTetraMax[t];
+                tetraMin = mTetraMin[t];
+                tetraMax = mTetraMax[t];
                 mValid[t] = true;
                 for (size_t i = 0; i < 3; ++i)
                 {
@@ -175,8 +254,8 @@ namespace gte
 
             for (size_t t = 0; t < mNumTetrahedra; ++t)
             {
-                auto const& tetraMin = mTetraMin[t];
-                auto const& tetraMax = mTetraMax[t];
+                auto const& tetraMin = mClipTetraMin[t];
+                auto const& tetraMax = mClipTetraMax[t];
                 auto& gridTetraMin = mGridTetraMin[t];
                 auto& gridTetraMax = mGridTetraMax[t];
                 for (size_t i = 0; i < 3; ++i)
@@ -197,7 +276,7 @@ namespace gte
             {
                 if (mValid[t])
                 {
-                    Rasterize(t, bound, grid);
+                    Rasterize(t, 0, bound[2], bound, grid);
                 }
             }
         }
@@ -205,45 +284,41 @@ namespace gte
         void MultiThreadedRasterizer(size_t numThreads,
             std::array<size_t, 3> const& bound, std::vector<int32_t>& grid)
         {
-            // Partition the data for multiple threads.
-            size_t const numTetrahedraPerThread = mNumTetrahedra / numThreads;
-            std::vector<size_t> nmin(numThreads), nsup(numThreads);
+            // Partition the grid into slabs of z-values. A task writes only
+            // the rows of its slab, so the tasks do not write the same grid
+            // points.
+            numThreads = std::min(numThreads, bound[2]);
+            TaskScheduler::TaskGroup group;
             for (size_t k = 0; k < numThreads; ++k)
             {
-                nmin[k] = k * numTetrahedraPerThread;
-                nsup[k] = (k + 1) * numTetrahedraPerThread;
-            }
-            nsup[numThreads - 1] = mNumTetrahedra;
-
-            std::vector<std::thread> process(numThreads);
-            for (size_t k = 0; k < numThreads; ++k)
-            {
-                process[k] = std::thread([this, k, &nmin, &nsup, &bound, &grid]()
+                size_t const zmin = k * bound[2] / numThreads;
+                size_t const zsup = (k + 1) * bound[2] / numThreads;
+                group.Run([this, zmin, zsup, &bound, &grid]()
                 {
-                    for (size_t t = nmin[k]; t < nsup[k]; ++t)
+                    for (size_t t = 0; t < mNumTetrahedra; ++t)
                     {
                         if (mValid[t])
                         {
-                            Rasterize(t, bound, grid);
+                            Rasterize(t, zmin, zsup, bound, grid);
                         }
                     }
                 });
             }
 
-            for (size_t t = 0; t < numThreads; ++t)
-            {
-                process[t].join();
-            }
+            group.Wait();
         }
 
-        void Rasterize(size_t t, std::array<size_t, 3> const& bound,
-            std::vector<int32_t>& grid)
+        // Rasterize the rows of the tetrahedron with zmin <= z < zsup.
+        void Rasterize(size_t t, size_t zmin, size_t zsup,
+            std::array<size_t, 3> const& bound, std::vector<int32_t>& grid)
         {
             auto const& imin = mGridTetraMin[t];
             auto const& imax = mGridTetraMax[t];
             std::array<T, 3> gridP{};
 
-            for (size_t i2 = imin[2]; i2 <= imax[2]; ++i2)
+            size_t const i2min = std::max(imin[2], zmin);
+            size_t const i2max = std::min(imax[2] + 1, zsup);
+            for (size_t i2 = i2min; i2 < i2max; ++i2)
             {
                 gridP[2] = static_cast<T>(i2);
                 for (size_t i1 = imin[1]; i1 <= imax[1]; ++i1)
@@ -294,42 +369,6 @@ namespace gte
             }
         }
 
-        static bool PointInTetrahedron(std::array<T, 3> const& P,
-            std::array<T, 3> const& V0, std::array<T, 3> const& V1,
-            std::array<T, 3> const& V2, std::array<T, 3> const& V3)
-        {
-            T const zero = static_cast<T>(0);
-
-            std::array<T, 3> PmV0 = Sub(P, V0);
-            std::array<T, 3> V1mV0 = Sub(V1, V0);
-            std::array<T, 3> V2mV0 = Sub(V2, V0);
-            if (DotCross(PmV0, V2mV0, V1mV0) > zero)
-            {
-                return false;
-            }
-
-            std::array<T, 3> V3mV0 = Sub(V3, V0);
-            if (DotCross(PmV0, V1mV0, V3mV0) > zero)
-            {
-                return false;
-            }
-
-            if (DotCross(PmV0, V3mV0, V2mV0) > zero)
-            {
-                return false;
-            }
-
-            std::array<T, 3> PmV1 = Sub(P, V1);
-            std::array<T, 3> V2mV1 = Sub(V2, V1);
-            std::array<T, 3> V3mV1 = Sub(V3, V1);
-            if (DotCross(PmV1, V2mV1, V3mV1) > zero)
-            {
-                return false;
-            }
-
-            return true;
-        }
-
         inline static std::array<T, 3> Sub(std::array<T, 3> const& U,
             std::array<T, 3> const& V)
         {
@@ -370,6 +409,8 @@ namespace gte
         // Axis-aligned bounding boxes for the tetrahedra.
         std::vector<std::array<T, 3>> mTetraMin;
         std::vector<std::array<T, 3>> mTetraMax;
+        std::vector<std::array<T, 3>> mClipTetraMin;
+        std::vector<std::array<T, 3>> mClipTetraMax;
         std::vector<bool> mValid;
 
         // Vertices and axis-aligned bounding boxes in grid coordinates.
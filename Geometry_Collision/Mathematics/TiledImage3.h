@@ -0,0 +1,401 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <Mathematics/Image3.h>
+#include <Mathematics/Logger.h>
+#include <Mathematics/MemoryMappedFile.h>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+// A 3D image stored in a file as bricks of 16x16x16 voxels, for volumes that
+// are larger than memory. The bricks are stored in lexicographical order of
+// the brick grid and the voxels of a brick in Morton (z-curve) order, so the
+// voxels of a small neighborhood are in the same brick and mostly in the
+// same page. Bricks are mapped into memory on demand and kept in a cache of
+// at most cacheCapacity bricks; the least recently used brick is unmapped
+// when the cache is full. Changes to a brick are written to the file by the
+// operating system.
+//
+// The file has no header; its size is determined by the dimensions, and an
+// existing file is opened with the dimensions it was created with. The
+// bricks at the maximum faces of the image are stored as full bricks. The
+// offset of each brick is a multiple of MemoryMappedFile::GetGranularity().
+//
+// The filters process a TiledImage3 a block at a time: the block with a
+// border of 'halo' voxels is copied to an Image3 by GetRegion, the dense
+// filter is applied to it, and the voxels of the block are copied back by
+// SetRegion. See FastGaussianBlur3, FilterTiledImage3 in PdeFilter3.h and
+// SurfaceExtractorMC for the drivers.
+//
+// The class is not thread safe, not even for reading, because the reads
+// update the cache.
+
+namespace gte
+{
+    template <typename PixelType>
+    class TiledImage3
+    {
+    public:
+        static_assert(std::is_trivially_copyable<PixelType>::value,
+            "The pixels are stored in a file.");
+
+        static int32_t constexpr brickLog2 = 4;
+        static int32_t constexpr brickSize = (1 << brickLog2);
+        static int32_t constexpr brickMask = brickSize - 1;
+        static size_t constexpr brickVolume = static_cast<size_t>(brickSize * brickSize * brickSize);
+
+        // For MemoryMappedFile::Mode::CREATE, the file is created with all
+        // voxels zero. For READ_WRITE and READ_ONLY, the file must have been
+        // created with the same dimensions.
+        TiledImage3(std::string const& filename, MemoryMappedFile::Mode mode,
+            int32_t dimension0, int32_t dimension1, int32_t dimension2,
+            size_t cacheCapacity = 1024)
+            :
+            mDimensions{ dimension0, dimension1, dimension2 },
+            mNumBricks{
+                (dimension0 + brickMask) >> brickLog2,
+                (dimension1 + brickMask) >> brickLog2,
+                (dimension2 + brickMask) >> brickLog2 },
+            mBrickBytes(brickVolume * sizeof(PixelType)),
+            mBrickStride(0),
+            mFile(filename, mode, GetFileSize(dimension0, dimension1, dimension2)),
+            mCacheCapacity(cacheCapacity),
+            mViews{},
+            mLRU{},
+            mLRUPosition{},
+            mLastBrick(invalidBrick),
+            mLastView(nullptr)
+        {
+            LogAssert(cacheCapacity > 0, "The cache must hold at least one brick.");
+
+            size_t const granularity = MemoryMappedFile::GetGranularity();
+            mBrickStride = (mBrickBytes + granularity - 1) / granularity * granularity;
+
+            size_t const numBricks = GetNumBricks();
+            LogAssert(mFile.GetSize() == static_cast<uint64_t>(numBricks) * mBrickStride,
+                "The file size does not match the dimensions.");
+
+            mViews.resize(numBricks, nullptr);
+            mLRUPosition.resize(numBricks, mLRU.end());
+        }
+
+        ~TiledImage3()
+        {
+            for (auto b : mLRU)
+            {
+                mFile.Unmap(mViews[b], mBrickBytes);
+            }
+        }
+
+        // Disallow copying, because the object owns the mapped views.
+        TiledImage3(TiledImage3 const&) = delete;
+        TiledImage3& operator=(TiledImage3 const&) = delete;
+
+        // Member access.
+        inline int32_t GetDimension(int32_t d) const
+        {
+            return mDimensions[d];
+        }
+
+        inline std::array<int32_t, 3> const& GetDimensions() const
+        {
+            return mDimensions;
+        }
+
+        inline size_t GetNumPixels() const
+        {
+            return static_cast<size_t>(mDimensions[0]) *
+                static_cast<size_t>(mDimensions[1]) *
+                static_cast<size_t>(mDimensions[2]);
+        }
+
+        inline size_t GetNumBricks() const
+        {
+            return static_cast<size_t>(mNumBricks[0]) *
+                static_cast<size_t>(mNumBricks[1]) *
+                static_cast<size_t>(mNumBricks[2]);
+        }
+
+        inline MemoryMappedFile::Mode GetMode() const
+        {
+            return mFile.GetMode();
+        }
+
+        // Access a voxel. The reference is valid until the next access of
+        // a voxel in another brick, which might unmap the brick of the
+        // voxel. The write access is invalid for a read-only file.
+        inline PixelType const& operator()(int32_t x, int32_t y, int32_t z) const
+        {
+            return GetBrick(GetBrickIndex(x, y, z))[GetMortonIndex(x, y, z)];
+        }
+
+        inline PixelType& operator()(int32_t x, int32_t y, int32_t z)
+        {
+            return GetBrick(GetBrickIndex(x, y, z))[GetMortonIndex(x, y, z)];
+        }
+
+        // Copy the voxels of the box [rmin,rmax) to 'region', which is
+        // reconstructed with dimensions rmax - rmin. The voxels are copied
+        // a brick at a time, so each brick is mapped once.
+        void GetRegion(std::array<int32_t, 3> const& rmin, std::array<int32_t, 3> const& rmax,
+            Image3<PixelType>& region) const
+        {
+            ValidateRegion(rmin, rmax);
+            region.Reconstruct(rmax[0] - rmin[0], rmax[1] - rmin[1], rmax[2] - rmin[2]);
+            ForEachBrick(rmin, rmax,
+                [&rmin, &region](PixelType* brick, int32_t x, int32_t y, int32_t z)
+                {
+                    region(x - rmin[0], y - rmin[1], z - rmin[2]) = brick[GetMortonIndex(x, y, z)];
+                });
+        }
+
+        // Copy the voxels of 'region' to the box whose minimum corner is
+        // rmin, which must be inside the image.
+        void SetRegion(std::array<int32_t, 3> const& rmin, Image3<PixelType> const& region)
+        {
+            SetRegion(rmin, region, { 0, 0, 0 },
+                { region.GetDimension(0), region.GetDimension(1), region.GetDimension(2) });
+        }
+
+        // Copy the voxels of the box [smin,smax) of 'region' to the box
+        // whose minimum corner is rmin, which must be inside the image. The
+        // block drivers use this to store the block without its halo.
+        void SetRegion(std::array<int32_t, 3> const& rmin, Image3<PixelType> const& region,
+            std::array<int32_t, 3> const& smin, std::array<int32_t, 3> const& smax)
+        {
+            LogAssert(mFile.GetMode() != MemoryMappedFile::Mode::READ_ONLY,
+                "The file is read only.");
+
+            std::array<int32_t, 3> const rmax =
+            {
+                rmin[0] + smax[0] - smin[0],
+                rmin[1] + smax[1] - smin[1],
+                rmin[2] + smax[2] - smin[2]
+            };
+            ValidateRegion(rmin, rmax);
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                LogAssert(0 <= smin[d] && smax[d] <= region.GetDimension(d),
+                    "Invalid region.");
+            }
+
+            std::array<int32_t, 3> const delta =
+            {
+                smin[0] - rmin[0],
+                smin[1] - rmin[1],
+                smin[2] - rmin[2]
+            };
+            ForEachBrick(rmin, rmax,
+                [&delta, &region](PixelType* brick, int32_t x, int32_t y, int32_t z)
+                {
+                    brick[GetMortonIndex(x, y, z)] = region(x + delta[0], y + delta[1], z + delta[2]);
+                });
+        }
+
+        // Call function(bmin, bmax) for the boxes [bmin,bmax) of a partition
+        // of the image into blocks of at most blockSize^3 voxels, in
+        // lexicographical order of the blocks. Choose blockSize to be a
+        // multiple of brickSize so that the blocks consist of whole bricks.
+        template <typename Function>
+        void ForEachBlock(int32_t blockSize, Function const& function) const
+        {
+            LogAssert(blockSize > 0, "Invalid block size.");
+            std::array<int32_t, 3> bmin{}, bmax{};
+            for (bmin[2] = 0; bmin[2] < mDimensions[2]; bmin[2] += blockSize)
+            {
+                bmax[2] = std::min(bmin[2] + blockSize, mDimensions[2]);
+                for (bmin[1] = 0; bmin[1] < mDimensions[1]; bmin[1] += blockSize)
+                {
+                    bmax[1] = std::min(bmin[1] + blockSize, mDimensions[1]);
+                    for (bmin[0] = 0; bmin[0] < mDimensions[0]; bmin[0] += blockSize)
+                    {
+                        bmax[0] = std::min(bmin[0] + blockSize, mDimensions[0]);
+                        function(bmin, bmax);
+                    }
+                }
+            }
+        }
+
+        // The box [bmin,bmax) extended by 'halo' voxels on each side and
+        // clipped to the image.
+        void GetHaloRegion(std::array<int32_t, 3> const& bmin, std::array<int32_t, 3> const& bmax,
+            int32_t halo, std::array<int32_t, 3>& rmin, std::array<int32_t, 3>& rmax) const
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                rmin[d] = std::max(bmin[d] - halo, 0);
+                rmax[d] = std::min(bmax[d] + halo, mDimensions[d]);
+            }
+        }
+
+        // Unmap all bricks. The changes to them are in the file.
+        void ClearCache()
+        {
+            for (auto b : mLRU)
+            {
+                mFile.Unmap(mViews[b], mBrickBytes);
+                mViews[b] = nullptr;
+                mLRUPosition[b] = mLRU.end();
+            }
+            mLRU.clear();
+            mLastBrick = invalidBrick;
+            mLastView = nullptr;
+        }
+
+    private:
+        static size_t constexpr invalidBrick = std::numeric_limits<size_t>::max();
+
+        static uint64_t GetFileSize(int32_t dimension0, int32_t dimension1, int32_t dimension2)
+        {
+            LogAssert(dimension0 > 0 && dimension1 > 0 && dimension2 > 0,
+                "Invalid dimensions.");
+
+            size_t const granularity = MemoryMappedFile::GetGranularity();
+            uint64_t const stride = static_cast<uint64_t>(
+                (brickVolume * sizeof(PixelType) + granularity - 1) / granularity * granularity);
+            return stride *
+                static_cast<uint64_t>((dimension0 + brickMask) >> brickLog2) *
+                static_cast<uint64_t>((dimension1 + brickMask) >> brickLog2) *
+                static_cast<uint64_t>((dimension2 + brickMask) >> brickLog2);
+        }
+
+        // Interleave the bits of the brick-local coordinates, x in bit 0.
+        inline static size_t Spread(int32_t v)
+        {
+            size_t const u = static_cast<size_t>(v & brickMask);
+            return (u & 1) | ((u & 2) << 2) | ((u & 4) << 4) | ((u & 8) << 6);
+        }
+
+        inline static size_t GetMortonIndex(int32_t x, int32_t y, int32_t z)
+        {
+            return Spread(x) | (Spread(y) << 1) | (Spread(z) << 2);
+        }
+
+        inline size_t GetBrickIndex(int32_t x, int32_t y, int32_t z) const
+        {
+            return static_cast<size_t>(x >> brickLog2) + static_cast<size_t>(mNumBricks[0]) *
+                (static_cast<size_t>(y >> brickLog2) + static_cast<size_t>(mNumBricks[1]) *
+                static_cast<size_t>(z >> brickLog2));
+        }
+
+        void ValidateRegion(std::array<int32_t, 3> const& rmin, std::array<int32_t, 3> const& rmax) const
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                LogAssert(0 <= rmin[d] && rmin[d] <= rmax[d] && rmax[d] <= mDimensions[d],
+                    "Invalid region.");
+            }
+        }
+
+        // The view of brick b, which is mapped if it is not in the cache.
+        PixelType* GetBrick(size_t b) const
+        {
+            if (b == mLastBrick)
+            {
+                return mLastView;
+            }
+
+            PixelType* view = mViews[b];
+            if (view != nullptr)
+            {
+                mLRU.splice(mLRU.begin(), mLRU, mLRUPosition[b]);
+            }
+            else
+            {
+                if (mLRU.size() == mCacheCapacity)
+                {
+                    size_t const oldest = mLRU.back();
+                    mLRU.pop_back();
+                    mFile.Unmap(mViews[oldest], mBrickBytes);
+                    mViews[oldest] = nullptr;
+                    mLRUPosition[oldest] = mLRU.end();
+                }
+
+                view = static_cast<PixelType*>(mFile.Map(
+                    static_cast<uint64_t>(b) * mBrickStride, mBrickBytes));
+                mViews[b] = view;
+                mLRU.push_front(b);
+                mLRUPosition[b] = mLRU.begin();
+            }
+
+            mLastBrick = b;
+            mLastView = view;
+            return view;
+        }
+
+        // Call function(brick, x, y, z) for the voxels (x,y,z) of the box
+        // [rmin,rmax), grouped by brick.
+        template <typename Function>
+        void ForEachBrick(std::array<int32_t, 3> const& rmin, std::array<int32_t, 3> const& rmax,
+            Function const& function) const
+        {
+            if (rmin[0] == rmax[0] || rmin[1] == rmax[1] || rmin[2] == rmax[2])
+            {
+                return;
+            }
+
+            std::array<int32_t, 3> bmin{}, bmax{};
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                bmin[d] = rmin[d] >> brickLog2;
+                bmax[d] = ((rmax[d] - 1) >> brickLog2) + 1;
+            }
+
+            for (int32_t bz = bmin[2]; bz < bmax[2]; ++bz)
+            {
+                int32_t const z0 = std::max(bz << brickLog2, rmin[2]);
+                int32_t const z1 = std::min((bz + 1) << brickLog2, rmax[2]);
+                for (int32_t by = bmin[1]; by < bmax[1]; ++by)
+                {
+                    int32_t const y0 = std::max(by << brickLog2, rmin[1]);
+                    int32_t const y1 = std::min((by + 1) << brickLog2, rmax[1]);
+                    for (int32_t bx = bmin[0]; bx < bmax[0]; ++bx)
+                    {
+                        int32_t const x0 = std::max(bx << brickLog2, rmin[0]);
+                        int32_t const x1 = std::min((bx + 1) << brickLog2, rmax[0]);
+                        PixelType* brick = GetBrick(GetBrickIndex(x0, y0, z0));
+                        for (int32_t z = z0; z < z1; ++z)
+                        {
+                            for (int32_t y = y0; y < y1; ++y)
+                            {
+                                for (int32_t x = x0; x < x1; ++x)
+                                {
+                                    function(brick, x, y, z);
+                                }
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        std::array<int32_t, 3> mDimensions;
+        std::array<int32_t, 3> mNumBricks;
+        size_t mBrickBytes;
+        size_t mBrickStride;
+
+        // The cache of mapped bricks. The reads of a const image map and
+        // unmap bricks, so these are mutable. The list is ordered from the
+        // most recently used brick to the least recently used brick.
+        mutable MemoryMappedFile mFile;
+        size_t mCacheCapacity;
+        mutable std::vector<PixelType*> mViews;
+        mutable std::list<size_t> mLRU;
+        mutable std::vector<typename std::list<size_t>::iterator> mLRUPosition;
+        mutable size_t mLastBrick;
+        mutable PixelType* mLastView;
+    };
+}
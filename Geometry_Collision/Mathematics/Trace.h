@@ -0,0 +1,324 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// CPU tracing of named scopes for the analysis of frame hitches. A scope is
+// recorded when it ends, as one event with its name, start time and
+// duration, into a ring buffer owned by the thread that executed it. The
+// ring of a thread keeps its latest events, so a trace written after a
+// hitch contains the frames that preceded it. Recording an event takes two
+// clock reads and no locks or allocations. The rings of all threads are
+// written as a Chrome trace, which chrome://tracing and Perfetto display
+// as one timeline per thread.
+//
+//   void Window::OnIdle()
+//   {
+//       GTE_TRACE_SCOPE("OnIdle");
+//       ...
+//   }
+//
+//   Trace::ExportChromeTrace("trace.json");
+//
+// The scope names must be string literals or otherwise outlive the trace,
+// because only their pointers are stored. Define GTE_DISABLE_TRACE to
+// compile out the GTE_TRACE_* macros; the Trace functions remain and the
+// written trace has no events. Tracing can also be disabled at run time
+// with Trace::SetEnabled(false).
+//
+// Writing the trace while other threads record events is allowed. The
+// events that a thread might overwrite while its ring is being copied are
+// dropped from the trace.
+
+#if defined(GTE_DISABLE_TRACE)
+#define GTE_TRACE_SCOPE(name)
+#define GTE_TRACE_THREAD_NAME(name)
+#else
+#define GTE_TRACE_CONCATENATE_INDIRECT(x, y) x##y
+#define GTE_TRACE_CONCATENATE(x, y) GTE_TRACE_CONCATENATE_INDIRECT(x, y)
+#define GTE_TRACE_SCOPE(name) \
+gte::TraceScope GTE_TRACE_CONCATENATE(gteTraceScope, __LINE__)(name)
+#define GTE_TRACE_THREAD_NAME(name) gte::Trace::SetThreadName(name)
+#endif
+
+namespace gte
+{
+    class Trace
+    {
+    public:
+        // A completed scope. The times are in nanoseconds since the first
+        // use of the trace.
+        struct Event
+        {
+            char const* name;
+            int64_t start, duration;
+        };
+
+        // The current time in nanoseconds since the first use of the
+        // trace.
+        static int64_t Now()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - GetRegistry().origin).count();
+        }
+
+        // Append an event to the ring of the calling thread.
+        static void Record(char const* name, int64_t start, int64_t end)
+        {
+            if (GetRegistry().enabled.load(std::memory_order_relaxed))
+            {
+                Ring& ring = GetRing();
+                uint64_t const count = ring.count.load(std::memory_order_relaxed);
+                Event& event = ring.events[static_cast<size_t>(count % ring.events.size())];
+                event.name = name;
+                event.start = start;
+                event.duration = end - start;
+                ring.count.store(count + 1, std::memory_order_release);
+            }
+        }
+
+        // Tracing is enabled by default.
+        static void SetEnabled(bool enabled)
+        {
+            GetRegistry().enabled.store(enabled, std::memory_order_relaxed);
+        }
+
+        static bool IsEnabled()
+        {
+            return GetRegistry().enabled.load(std::memory_order_relaxed);
+        }
+
+        // The number of events of a ring. The capacity applies to the rings
+        // of the threads that record their first event after the call. The
+        // default is 65536 events, 1.5 MB per thread.
+        static void SetCapacity(size_t numEvents)
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.capacity = std::max(numEvents, static_cast<size_t>(1));
+        }
+
+        // The name of the calling thread in the trace. The default names
+        // are "thread 0", "thread 1" and so on, in the order of the first
+        // events of the threads.
+        static void SetThreadName(std::string const& name)
+        {
+            Ring& ring = GetRing();
+            std::lock_guard<std::mutex> lock(GetRegistry().mutex);
+            ring.name = name;
+        }
+
+        // Discard the events of all threads. The events being recorded
+        // during the call might not be discarded.
+        static void Clear()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            for (auto const& ring : registry.rings)
+            {
+                ring->first.store(ring->count.load(std::memory_order_acquire),
+                    std::memory_order_relaxed);
+            }
+        }
+
+        // Write the events of all threads as a Chrome trace, a JSON array of
+        // complete events with one thread-name metadata event per thread.
+        static void WriteChromeTrace(std::ostream& output)
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+
+            std::ios_base::fmtflags const flags = output.flags();
+            std::streamsize const precision = output.precision();
+            output << std::fixed << std::setprecision(3) << "[";
+
+            std::vector<Event> events{};
+            bool isFirst = true;
+            for (size_t tid = 0; tid < registry.rings.size(); ++tid)
+            {
+                Ring const& ring = *registry.rings[tid];
+                output << (isFirst ? "\n" : ",\n")
+                    << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << tid
+                    << ",\"args\":{\"name\":";
+                WriteString(output, ring.name);
+                output << "}}";
+                isFirst = false;
+
+                // Copy the latest events. The events that the thread might
+                // have overwritten during the copy are those that are older
+                // than the capacity relative to the count after the copy.
+                uint64_t const capacity = static_cast<uint64_t>(ring.events.size());
+                uint64_t const count0 = ring.count.load(std::memory_order_acquire);
+                uint64_t const first = ring.first.load(std::memory_order_relaxed);
+                uint64_t begin = (count0 > capacity ? count0 - capacity : 0);
+                begin = std::max(begin, first);
+                events.clear();
+                for (uint64_t i = begin; i < count0; ++i)
+                {
+                    events.push_back(ring.events[static_cast<size_t>(i % capacity)]);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                uint64_t const count1 = ring.count.load(std::memory_order_relaxed);
+                uint64_t const valid = (count1 > capacity ? count1 - capacity : 0);
+
+                for (uint64_t i = std::max(begin, valid); i < count0; ++i)
+                {
+                    Event const& event = events[static_cast<size_t>(i - begin)];
+                    output << ",\n{\"name\":";
+                    WriteString(output, event.name);
+                    output << ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+                        << ",\"ts\":" << 1e-3 * static_cast<double>(event.start)
+                        << ",\"dur\":" << 1e-3 * static_cast<double>(event.duration) << "}";
+                }
+            }
+            output << "\n]\n";
+            output.flags(flags);
+            output.precision(precision);
+        }
+
+        // Write the Chrome trace to a file. The function returns false when
+        // the file cannot be written.
+        static bool ExportChromeTrace(std::string const& filename)
+        {
+            std::ofstream output(filename);
+            if (!output)
+            {
+                return false;
+            }
+
+            WriteChromeTrace(output);
+            return static_cast<bool>(output);
+        }
+
+    private:
+        // The events of a thread. The thread writes the events and the
+        // count; 'first' is the count at the last Clear(). The ring is
+        // shared by the registry so that its events outlive the thread.
+        struct Ring
+        {
+            Ring(size_t capacity, std::string const& inName)
+                :
+                events(capacity),
+                count(0),
+                first(0),
+                name(inName)
+            {
+            }
+
+            std::vector<Event> events;
+            std::atomic<uint64_t> count;
+            std::atomic<uint64_t> first;
+            std::string name;
+        };
+
+        struct Registry
+        {
+            Registry()
+                :
+                mutex{},
+                rings{},
+                capacity(65536),
+                enabled(true),
+                origin(std::chrono::steady_clock::now())
+            {
+            }
+
+            std::mutex mutex;
+            std::vector<std::shared_ptr<Ring>> rings;
+            size_t capacity;
+            std::atomic<bool> enabled;
+            std::chrono::steady_clock::time_point origin;
+        };
+
+        static Registry& GetRegistry()
+        {
+            static Registry registry;
+            return registry;
+        }
+
+        static Ring& GetRing()
+        {
+            thread_local std::shared_ptr<Ring> ring = CreateRing();
+            return *ring;
+        }
+
+        static std::shared_ptr<Ring> CreateRing()
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            auto ring = std::make_shared<Ring>(registry.capacity,
+                "thread " + std::to_string(registry.rings.size()));
+            registry.rings.push_back(ring);
+            return ring;
+        }
+
+        static void WriteString(std::ostream& output, char const* text)
+        {
+            output << '"';
+            for (; *text != 0; ++text)
+            {
+                char const c = *text;
+                if (c == '"' || c == '\\')
+                {
+                    output << '\\' << c;
+                }
+                else if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    output << ' ';
+                }
+                else
+                {
+                    output << c;
+                }
+            }
+            output << '"';
+        }
+
+        static void WriteString(std::ostream& output, std::string const& text)
+        {
+            WriteString(output, text.c_str());
+        }
+    };
+
+    // Record the scope of the object as a trace event.
+    class TraceScope
+    {
+    public:
+        TraceScope(char const* name)
+            :
+            mName(name),
+            mStart(Trace::Now())
+        {
+        }
+
+        ~TraceScope()
+        {
+            Trace::Record(mName, mStart, Trace::Now());
+        }
+
+        // Object copies are not allowed.
+        TraceScope(TraceScope const&) = delete;
+        TraceScope& operator=(TraceScope const&) = delete;
+
+    private:
+        char const* mName;
+        int64_t mStart;
+    };
+}
@@ -159,6 +159,24 @@ namespace Vector_GM
             UpdateHMatrix();
         }
 
+        // Set all components with one update of the homogeneous matrix, for
+        // code that composes many transforms, such as TransformHierarchy.
+        // The 'matrix' is R and 'scale' is S when isRSMatrix is true;
+        // otherwise, 'matrix' is M and 'scale' is ignored. The hints are
+        // those that the corresponding Set* calls produce.
+        void SetComponents(Matrix4x4<Real> const& matrix, Vector4<Real> const& translate,
+            Vector4<Real> const& scale, bool isRSMatrix, bool isUniformScale)
+        {
+            mMatrix = matrix;
+            mTranslate = { translate[0], translate[1], translate[2], (Real)1 };
+            mScale = (isRSMatrix ? Vector4<Real>{ scale[0], scale[1], scale[2], (Real)1 } :
+                Vector4<Real>{ (Real)1, (Real)1, (Real)1, (Real)1 });
+            mIsIdentity = false;
+            mIsRSMatrix = isRSMatrix;
+            mIsUniformScale = isRSMatrix && isUniformScale;
+            UpdateHMatrix();
+        }
+
         void SetTranslation(Real x0, Real x1, Real x2)
         {
             mTranslate = Vector4<Real>{ x0, x1, x2, (Real)1 };
@@ -478,7 +496,9 @@ namespace Vector_GM
                     }
                     else
                     {
-                        mInvHMatrix = gte::Inverse(mHMatrix);
+                        // H is affine, so only the 3x3 block M needs to be
+                        // inverted; the translation is handled below.
+                        Invert3x3(mHMatrix, mInvHMatrix);
                     }
 
 #if defined(GTE_USE_MAT_VEC)
@@ -556,8 +576,23 @@ namespace Vector_GM
                 }
                 else
                 {
-                    Matrix4x4<Real> invMatrix = gte::Inverse(GetHMatrix());
-                    Vector4<Real> invTranslate = invMatrix.GetCol(3);
+                    // The inverse of R*S (or S*R) is generally not an
+                    // RS-matrix, so it is set as a general matrix. Use the
+                    // cached H^{-1}, which has the block M^{-1}.
+                    Matrix4x4<Real> const& invHMatrix = GetHInverse();
+                    Matrix4x4<Real> invMatrix = Matrix4x4<Real>::Identity();
+                    for (int32_t r = 0; r < 3; ++r)
+                    {
+                        for (int32_t c = 0; c < 3; ++c)
+                        {
+                            invMatrix(r, c) = invHMatrix(r, c);
+                        }
+                    }
+#if defined(GTE_USE_MAT_VEC)
+                    Vector4<Real> invTranslate = invHMatrix.GetCol(3);
+#else
+                    Vector4<Real> invTranslate = invHMatrix.GetRow(3);
+#endif
                     inverse.SetMatrix(invMatrix);
                     inverse.SetTranslation(invTranslate);
                 }
@@ -566,6 +601,27 @@ namespace Vector_GM
             return inverse;
         }
 
+        // Transform arrays of points (x,y,z), {Y,1} = H*{X,1} or
+        // {Y,1} = {X,1}*H, using only the affine part of H. The input may
+        // be vertex buffer data; 'stride' is the number of bytes between
+        // consecutive points, or zero when the points are contiguous
+        // Vector3<Real> values. The outputs are contiguous and must not
+        // overlap the inputs.
+        void TransformPoints(size_t numPoints, void const* points, size_t stride,
+            Vector3<Real>* output) const
+        {
+            TransformPoints(mHMatrix, mIsIdentity, numPoints, points, stride, output);
+        }
+
+        // The same for {X,1} = H^{-1}*{Y,1} or {X,1} = {Y,1}*H^{-1}, using
+        // the cached inverse, for example to convert world-space points to
+        // model space for picking.
+        void InverseTransformPoints(size_t numPoints, void const* points, size_t stride,
+            Vector3<Real>* output) const
+        {
+            TransformPoints(GetHInverse(), mIsIdentity, numPoints, points, stride, output);
+        }
+
         // The identity transformation.
         static Transform Identity()
         {
@@ -643,6 +699,44 @@ namespace Vector_GM
             mInverseNeedsUpdate = true;
         }
 
+        static void TransformPoints(Matrix4x4<Real> const& hmatrix, bool isIdentity,
+            size_t numPoints, void const* points, size_t stride, Vector3<Real>* output)
+        {
+            if (stride == 0)
+            {
+                stride = sizeof(Vector3<Real>);
+            }
+
+            char const* input = static_cast<char const*>(points);
+            if (isIdentity)
+            {
+                for (size_t i = 0; i < numPoints; ++i, input += stride)
+                {
+                    Real const* x = reinterpret_cast<Real const*>(input);
+                    output[i] = { x[0], x[1], x[2] };
+                }
+                return;
+            }
+
+            // The rows (GTE_USE_MAT_VEC) or columns of the affine part.
+#if defined(GTE_USE_MAT_VEC)
+            auto H = [&hmatrix](int32_t r, int32_t c) { return hmatrix(r, c); };
+#else
+            auto H = [&hmatrix](int32_t r, int32_t c) { return hmatrix(c, r); };
+#endif
+            Real const h00 = H(0, 0), h01 = H(0, 1), h02 = H(0, 2), h03 = H(0, 3);
+            Real const h10 = H(1, 0), h11 = H(1, 1), h12 = H(1, 2), h13 = H(1, 3);
+            Real const h20 = H(2, 0), h21 = H(2, 1), h22 = H(2, 2), h23 = H(2, 3);
+            for (size_t i = 0; i < numPoints; ++i, input += stride)
+            {
+                Real const* x = reinterpret_cast<Real const*>(input);
+                Real const x0 = x[0], x1 = x[1], x2 = x[2];
+                output[i][0] = h00 * x0 + h01 * x1 + h02 * x2 + h03;
+                output[i][1] = h10 * x0 + h11 * x1 + h12 * x2 + h13;
+                output[i][2] = h20 * x0 + h21 * x1 + h22 * x2 + h23;
+            }
+        }
+
         // Invert the 3x3 upper-left block of the input matrix.
         static void Invert3x3(Matrix4x4<Real> const& mat, Matrix4x4<Real>& invMat)
         {
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <Mathematics/Triangle.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure-of-arrays storage for the batched triangle queries. Coordinate
+// d of vertex i of the triangles is stored in the contiguous array v[i][d],
+// so the query loops load consecutive triangles with unit stride.
+
+namespace gte
+{
+    template <typename T>
+    class TriangleArray3
+    {
+    public:
+        TriangleArray3() = default;
+
+        inline size_t size() const
+        {
+            return v[0][0].size();
+        }
+
+        void Clear()
+        {
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    v[i][d].clear();
+                }
+            }
+        }
+
+        void Reserve(size_t numTriangles)
+        {
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    v[i][d].reserve(numTriangles);
+                }
+            }
+        }
+
+        void Push(Triangle3<T> const& triangle)
+        {
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    v[i][d].push_back(triangle.v[i][d]);
+                }
+            }
+        }
+
+        Triangle3<T> Get(size_t j) const
+        {
+            Triangle3<T> triangle{};
+            for (int32_t i = 0; i < 3; ++i)
+            {
+                for (int32_t d = 0; d < 3; ++d)
+                {
+                    triangle.v[i][d] = v[i][d][j];
+                }
+            }
+            return triangle;
+        }
+
+        std::array<std::array<std::vector<T>, 3>, 3> v;
+    };
+}
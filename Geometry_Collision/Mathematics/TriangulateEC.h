@@ -10,8 +10,9 @@
 #include <Mathematics/Logger.h>
 #include <Mathematics/PolygonTree.h>
 #include <Mathematics/PrimalQuery2.h>
+#include <algorithm>
+#include <cmath>
 #include <memory>
-#include <map>
 #include <queue>
 #include <vector>
 
@@ -20,6 +21,15 @@
 // The algorithm for processing nested polygons involves a division, so the
 // ComputeType must be rational-based, say, BSRational.  If you process only
 // triangles that are simple, you may use BSNumber for the ComputeType.
+//
+// An ear test searches the reflex vertices for one inside the candidate
+// triangle.  For polygons with many reflex vertices, the reflex vertices are
+// binned in a uniform grid over the bounding box of the polygon, and only
+// those in the cells overlapped by the bounding box of the triangle are
+// tested, which makes the ear tests nearly constant time for polygons with
+// evenly distributed vertices.  The cells are computed from the InputType
+// coordinates converted to double, so the grid only filters candidates and
+// the triangulation is the same as without the grid.
 
 namespace gte
 {
@@ -48,7 +58,12 @@ namespace gte
             mRFirst(-1),
             mRLast(-1),
             mEFirst(-1),
-            mELast(-1)
+            mELast(-1),
+            mNumReflex(0),
+            mGridNumReflex(0),
+            mGridMin{ 0.0, 0.0 },
+            mGridInvCellSize{ 0.0, 0.0 },
+            mGridBound{ 0, 0 }
         {
             LogAssert(numPoints >= 3 && points != nullptr, "Invalid input.");
             mComputePoints.resize(mNumPoints);
@@ -66,7 +81,12 @@ namespace gte
             mRFirst(-1),
             mRLast(-1),
             mEFirst(-1),
-            mELast(-1)
+            mELast(-1),
+            mNumReflex(0),
+            mGridNumReflex(0),
+            mGridMin{ 0.0, 0.0 },
+            mGridInvCellSize{ 0.0, 0.0 },
+            mGridBound{ 0, 0 }
         {
             LogAssert(mNumPoints >= 3 && mPoints != nullptr, "Invalid input.");
             mComputePoints.resize(mNumPoints);
@@ -103,6 +123,7 @@ namespace gte
                 }
 
                 // Triangulate the unindexed polygon.
+                mIndexMap.clear();
                 InitializeVertices(mNumPoints, nullptr);
                 DoEarClipping(mNumPoints, nullptr);
                 return true;
@@ -137,6 +158,7 @@ namespace gte
                 }
 
                 // Triangulate the indexed polygon.
+                mIndexMap.clear();
                 InitializeVertices(numIndices, indices);
                 DoEarClipping(numIndices, indices);
                 return true;
@@ -205,9 +227,9 @@ namespace gte
                 // visible vertices, one from the outer polygon and one from
                 // the inner polygon.
                 int32_t nextElement = mNumPoints;  // The next available element.
-                std::map<int32_t, int32_t> indexMap;
+                mIndexMap.assign(2, -1);
                 std::vector<int32_t> combined;
-                if (!CombinePolygons(nextElement, outer, inner, indexMap, combined))
+                if (!CombinePolygons(nextElement, outer, inner, combined))
                 {
                     // An unexpected condition was encountered.
                     return false;
@@ -221,7 +243,7 @@ namespace gte
                 DoEarClipping(numVertices, indices);
 
                 // Map the duplicate indices back to the original indices.
-                RemapIndices(indexMap);
+                RemapIndices();
                 return true;
             }
             else
@@ -293,9 +315,9 @@ namespace gte
                 // simple polygon by inserting two edges per inner polygon
                 // connecting mutually visible vertices.
                 int32_t nextElement = mNumPoints;  // The next available element.
-                std::map<int32_t, int32_t> indexMap;
+                mIndexMap.assign(2 * inners.size(), -1);
                 std::vector<int32_t> combined;
-                if (!ProcessOuterAndInners(nextElement, outer, inners, indexMap, combined))
+                if (!ProcessOuterAndInners(nextElement, outer, inners, combined))
                 {
                     // An unexpected condition was encountered.
                     return false;
@@ -309,7 +331,7 @@ namespace gte
                 DoEarClipping(numVertices, indices);
 
                 // Map the duplicate indices back to the original indices.
-                RemapIndices(indexMap);
+                RemapIndices();
                 return true;
             }
             else
@@ -328,7 +350,8 @@ namespace gte
                 // Two extra elements per inner polygon are needed to
                 // duplicate the endpoints of the edges introduced to combine
                 // outer and inner polygons.
-                int32_t numPointsPlusExtras = mNumPoints + InitializeFromTree(tree);
+                int32_t const numExtraPoints = InitializeFromTree(tree);
+                int32_t numPointsPlusExtras = mNumPoints + numExtraPoints;
                 if (numPointsPlusExtras > static_cast<int32_t>(mComputePoints.size()))
                 {
                     mComputePoints.resize(numPointsPlusExtras);
@@ -341,7 +364,7 @@ namespace gte
                 }
 
                 int32_t nextElement = mNumPoints;
-                std::map<int32_t, int32_t> indexMap;
+                mIndexMap.assign(static_cast<size_t>(numExtraPoints), -1);
 
                 std::queue<std::shared_ptr<PolygonTree>> treeQueue;
                 treeQueue.push(tree);
@@ -383,7 +406,7 @@ namespace gte
                         // into a simple polygon by inserting two edges per
                         // inner polygon connecting mutually visible vertices.
                         std::vector<int32_t> combined;
-                        ProcessOuterAndInners(nextElement, outer->polygon, inners, indexMap, combined);
+                        ProcessOuterAndInners(nextElement, outer->polygon, inners, combined);
 
                         // The combined polygon is now in the format of a
                         // simple polygon, albeit with coincident edges.
@@ -395,7 +418,7 @@ namespace gte
                 }
 
                 // Map the duplicate indices back to the original indices.
-                RemapIndices(indexMap);
+                RemapIndices();
                 return true;
             }
             else
@@ -417,6 +440,7 @@ namespace gte
             mRLast = -1;
             mEFirst = -1;
             mELast = -1;
+            mNumReflex = 0;
 
             // Create a circular list of the polygon vertices for dynamic
             // removal of vertices.
@@ -445,6 +469,122 @@ namespace gte
                     InsertAfterR(i);
                 }
             }
+
+            InitializeReflexGrid();
+        }
+
+        // Bin the reflex vertices in a uniform grid with about one reflex
+        // vertex per cell.  The grid is not used for polygons with few
+        // reflex vertices, for which the list of reflex vertices is faster.
+        // Vertices are removed from the list of reflex vertices but never
+        // inserted after this function, so IsEar skips the grid vertices
+        // that are no longer in the list, and the grid is rebuilt for the
+        // remaining reflex vertices when half of them have been removed.
+        void InitializeReflexGrid()
+        {
+            mGridCellOffsets.clear();
+            mGridCellVertices.clear();
+            mGridBound = { 0, 0 };
+            mGridNumReflex = 0;
+            if (mNumReflex < msMinGridReflex)
+            {
+                return;
+            }
+
+            int32_t const numVertices = static_cast<int32_t>(mVertices.size());
+            mGridPoints.resize(mVertices.size());
+            for (int32_t i = 0; i < numVertices; ++i)
+            {
+                int32_t index = V(i).index;
+                if (index >= mNumPoints)
+                {
+                    index = mIndexMap[static_cast<size_t>(index) - static_cast<size_t>(mNumPoints)];
+                }
+                for (int32_t j = 0; j < 2; ++j)
+                {
+                    mGridPoints[i][j] = static_cast<double>(mPoints[index][j]);
+                }
+            }
+
+            BuildReflexGrid();
+        }
+
+        void BuildReflexGrid()
+        {
+            mGridCellOffsets.clear();
+            mGridCellVertices.clear();
+            mGridNumReflex = mNumReflex;
+            if (mNumReflex < msMinGridReflex)
+            {
+                return;
+            }
+
+            // The grid covers the bounding box of the reflex vertices.  The
+            // cell coordinates are clamped to the grid, so the cells of a
+            // triangle's bounding box are still found when the box extends
+            // outside the grid.
+            std::array<double, 2> vmin = mGridPoints[mRFirst], vmax = vmin;
+            for (int32_t i = mRFirst; i != -1; i = V(i).sNext)
+            {
+                for (int32_t j = 0; j < 2; ++j)
+                {
+                    vmin[j] = std::min(vmin[j], mGridPoints[i][j]);
+                    vmax[j] = std::max(vmax[j], mGridPoints[i][j]);
+                }
+            }
+
+            // Choose square cells with about mNumReflex cells in total.
+            double const width = vmax[0] - vmin[0];
+            double const height = vmax[1] - vmin[1];
+            double const area = std::max(width * height, std::max(width, height) * 1e-6);
+            double const cellSize = std::sqrt(area / static_cast<double>(mNumReflex));
+            for (int32_t j = 0; j < 2; ++j)
+            {
+                double const extent = (j == 0 ? width : height);
+                double const bound = (cellSize > 0.0 ? std::ceil(extent / cellSize) : 1.0);
+                mGridBound[j] = static_cast<int32_t>(std::min(std::max(bound, 1.0),
+                    static_cast<double>(mNumReflex)));
+                mGridMin[j] = vmin[j];
+                mGridInvCellSize[j] = (extent > 0.0 ? static_cast<double>(mGridBound[j]) / extent : 0.0);
+            }
+
+            // Sort the reflex vertices into the cells with a counting sort.
+            size_t const numCells = static_cast<size_t>(mGridBound[0]) * static_cast<size_t>(mGridBound[1]);
+            mGridCellOffsets.assign(numCells + 1, 0);
+            for (int32_t i = mRFirst; i != -1; i = V(i).sNext)
+            {
+                ++mGridCellOffsets[GetGridCell(mGridPoints[i]) + 1];
+            }
+            for (size_t c = 1; c <= numCells; ++c)
+            {
+                mGridCellOffsets[c] += mGridCellOffsets[c - 1];
+            }
+            mGridCellVertices.resize(static_cast<size_t>(mNumReflex));
+            std::vector<size_t> next(mGridCellOffsets.begin(), mGridCellOffsets.end() - 1);
+            for (int32_t i = mRFirst; i != -1; i = V(i).sNext)
+            {
+                mGridCellVertices[next[GetGridCell(mGridPoints[i])]++] = i;
+            }
+        }
+
+        inline int32_t GetGridCoordinate(double value, int32_t j) const
+        {
+            double const c = (value - mGridMin[j]) * mGridInvCellSize[j];
+            if (c <= 0.0)
+            {
+                return 0;
+            }
+            if (c >= static_cast<double>(mGridBound[j] - 1))
+            {
+                return mGridBound[j] - 1;
+            }
+            return static_cast<int32_t>(c);
+        }
+
+        inline size_t GetGridCell(std::array<double, 2> const& point) const
+        {
+            return static_cast<size_t>(GetGridCoordinate(point[0], 0))
+                + static_cast<size_t>(mGridBound[0]) * static_cast<size_t>(GetGridCoordinate(point[1], 1));
         }
 
         // Apply ear clipping to the input polygon.  Polygons with holes are
@@ -578,8 +718,7 @@ namespace gte
         // function determines a pair of visible vertices and inserts two
         // coincident edges to generate a nearly simple polygon.
         bool CombinePolygons(int32_t nextElement, Polygon const& outer,
-            Polygon const& inner, std::map<int32_t, int32_t>& indexMap,
-            std::vector<int32_t>& combined)
+            Polygon const& inner, std::vector<int32_t>& combined)
         {
             int32_t const numOuterIndices = static_cast<int32_t>(outer.size());
             int32_t const* outerIndices = outer.data();
@@ -828,24 +967,14 @@ namespace gte
             int32_t innerIndex = innerIndices[xmaxIndex];
             mComputePoints[nextElement] = mComputePoints[innerIndex];
             combined[cIndex] = nextElement;
-            auto iter = indexMap.find(innerIndex);
-            if (iter != indexMap.end())
-            {
-                innerIndex = iter->second;
-            }
-            indexMap[nextElement] = innerIndex;
+            SetOriginalIndex(nextElement, innerIndex);
             ++cIndex;
             ++nextElement;
 
             int32_t outerIndex = outerIndices[maxCosIndex];
             mComputePoints[nextElement] = mComputePoints[outerIndex];
             combined[cIndex] = nextElement;
-            iter = indexMap.find(outerIndex);
-            if (iter != indexMap.end())
-            {
-                outerIndex = iter->second;
-            }
-            indexMap[nextElement] = outerIndex;
+            SetOriginalIndex(nextElement, outerIndex);
             ++cIndex;
             ++nextElement;
 
@@ -862,8 +991,7 @@ namespace gte
         // repeatedly calls CombinePolygons for each inner polygon of the
         // outer polygon.
         bool ProcessOuterAndInners(int32_t& nextElement, Polygon const& outer,
-            std::vector<Polygon> const& inners, std::map<int32_t, int32_t>& indexMap,
-            std::vector<int32_t>& combined)
+            std::vector<Polygon> const& inners, std::vector<int32_t>& combined)
         {
             // Sort the inner polygons based on maximum x-values.
             int32_t numInners = static_cast<int32_t>(inners.size());
@@ -892,7 +1020,7 @@ namespace gte
             {
                 Polygon const& polygon = inners[pairs[p].second];
                 Polygon currentCombined;
-                if (!CombinePolygons(nextElement, currentPolygon, polygon, indexMap, currentCombined))
+                if (!CombinePolygons(nextElement, currentPolygon, polygon, currentCombined))
                 {
                     return false;
                 }
@@ -907,11 +1035,25 @@ namespace gte
             return true;
         }
 
+        // The duplicate of a vertex has an index nextElement >= mNumPoints.
+        // The index of the original vertex is stored in
+        // mIndexMap[nextElement - mNumPoints].  A duplicate can itself be
+        // duplicated when an inner polygon is combined with a polygon that
+        // was combined before, so the original is looked up first.
+        void SetOriginalIndex(int32_t duplicate, int32_t original)
+        {
+            if (original >= mNumPoints)
+            {
+                original = mIndexMap[static_cast<size_t>(original) - static_cast<size_t>(mNumPoints)];
+            }
+            mIndexMap[static_cast<size_t>(duplicate) - static_cast<size_t>(mNumPoints)] = original;
+        }
+
         // The insertion of coincident edges to obtain a nearly simple polygon
         // requires duplication of vertices in order that the ear-clipping
         // algorithm work correctly.  After the triangulation, the indices of
         // the duplicated vertices are converted to the original indices.
-        void RemapIndices(std::map<int32_t, int32_t> const& indexMap)
+        void RemapIndices()
         {
             // The triangulation includes indices to the duplicated outer and
             // inner vertices.  These indices must be mapped back to the
@@ -920,10 +1062,9 @@ namespace gte
             {
                 for (int32_t i = 0; i < 3; ++i)
                 {
-                    auto iter = indexMap.find(tri[i]);
-                    if (iter != indexMap.end())
+                    if (tri[i] >= mNumPoints)
                     {
-                        tri[i] = iter->second;
+                        tri[i] = mIndexMap[static_cast<size_t>(tri[i]) - static_cast<size_t>(mNumPoints)];
                     }
                 }
             }
@@ -1031,7 +1172,8 @@ namespace gte
                 ePrev(-1),
                 eNext(-1),
                 isConvex(false),
-                isEar(false)
+                isEar(false),
+                isReflex(false)
             {
             }
 
@@ -1040,6 +1182,7 @@ namespace gte
             int32_t sPrev, sNext;   // convex/reflex vertex links (disjoint lists)
             int32_t ePrev, eNext;   // ear links
             bool isConvex, isEar;
+            bool isReflex;          // in the list of reflex vertices
         };
 
         inline Vertex& V(int32_t i)
@@ -1072,41 +1215,89 @@ namespace gte
 
             // Search the reflex vertices and test if any are in the triangle
             // <V[prev],V[curr],V[next]>.
-            int32_t prev = V(vertex.vPrev).index;
-            int32_t curr = vertex.index;
-            int32_t next = V(vertex.vNext).index;
             vertex.isEar = true;
-            for (int32_t j = mRFirst; j != -1; j = V(j).sNext)
+            if (mGridCellOffsets.size() > 0 && 2 * mNumReflex < mGridNumReflex)
             {
-                // Check if the test vertex is already one of the triangle
-                // vertices.
-                if (j == vertex.vPrev || j == i || j == vertex.vNext)
-                {
-                    continue;
-                }
+                BuildReflexGrid();
+            }
 
-                // V[j] has been ruled out as one of the original vertices of
-                // the triangle <V[prev],V[curr],V[next]>.  When triangulating
-                // polygons with holes, V[j] might be a duplicated vertex, in
-                // which case it does not affect the earness of V[curr].
-                int32_t test = V(j).index;
-                if (mComputePoints[test] == mComputePoints[prev]
-                    || mComputePoints[test] == mComputePoints[curr]
-                    || mComputePoints[test] == mComputePoints[next])
+            if (mGridCellOffsets.size() == 0)
+            {
+                for (int32_t j = mRFirst; j != -1; j = V(j).sNext)
                 {
-                    continue;
+                    if (IsInEarTriangle(i, j))
+                    {
+                        vertex.isEar = false;
+                        break;
+                    }
                 }
+                return vertex.isEar;
+            }
 
-                // Test if the vertex is inside or on the triangle.  When it
-                // is, it causes V[curr] not to be an ear.
-                if (mQuery.ToTriangle(test, prev, curr, next) <= 0)
+            // Search the cells overlapped by the bounding box of the
+            // triangle.  A reflex vertex inside the triangle is inside the
+            // bounding box, and the conversion to double and the cell
+            // computation preserve the order of coordinates, so the vertex
+            // is in one of these cells.
+            std::array<double, 2> const& p0 = mGridPoints[vertex.vPrev];
+            std::array<double, 2> const& p1 = mGridPoints[i];
+            std::array<double, 2> const& p2 = mGridPoints[vertex.vNext];
+            int32_t const xmin = GetGridCoordinate(std::min(std::min(p0[0], p1[0]), p2[0]), 0);
+            int32_t const xmax = GetGridCoordinate(std::max(std::max(p0[0], p1[0]), p2[0]), 0);
+            int32_t const ymin = GetGridCoordinate(std::min(std::min(p0[1], p1[1]), p2[1]), 1);
+            int32_t const ymax = GetGridCoordinate(std::max(std::max(p0[1], p1[1]), p2[1]), 1);
+            for (int32_t y = ymin; y <= ymax; ++y)
+            {
+                size_t const row = static_cast<size_t>(mGridBound[0]) * static_cast<size_t>(y);
+                for (int32_t x = xmin; x <= xmax; ++x)
                 {
-                    vertex.isEar = false;
-                    break;
+                    size_t const cell = row + static_cast<size_t>(x);
+                    for (size_t k = mGridCellOffsets[cell]; k < mGridCellOffsets[cell + 1]; ++k)
+                    {
+                        // The vertices that became convex have been removed
+                        // from the list of reflex vertices.
+                        int32_t const j = mGridCellVertices[k];
+                        if (V(j).isReflex && IsInEarTriangle(i, j))
+                        {
+                            vertex.isEar = false;
+                            return false;
+                        }
+                    }
                 }
             }
+            return true;
+        }
+
+        // Test whether the reflex vertex V[j] prevents V[i] from being an
+        // ear.
+        bool IsInEarTriangle(int32_t i, int32_t j)
+        {
+            // Check if the test vertex is already one of the triangle
+            // vertices.
+            Vertex& vertex = V(i);
+            if (j == vertex.vPrev || j == i || j == vertex.vNext)
+            {
+                return false;
+            }
+
+            // V[j] has been ruled out as one of the original vertices of the
+            // triangle <V[prev],V[curr],V[next]>.  When triangulating
+            // polygons with holes, V[j] might be a duplicated vertex, in
+            // which case it does not affect the earness of V[curr].
+            int32_t prev = V(vertex.vPrev).index;
+            int32_t curr = vertex.index;
+            int32_t next = V(vertex.vNext).index;
+            int32_t test = V(j).index;
+            if (mComputePoints[test] == mComputePoints[prev]
+                || mComputePoints[test] == mComputePoints[curr]
+                || mComputePoints[test] == mComputePoints[next])
+            {
+                return false;
+            }
 
-            return vertex.isEar;
+            // Test if the vertex is inside or on the triangle.  When it is,
+            // it causes V[curr] not to be an ear.
+            return mQuery.ToTriangle(test, prev, curr, next) <= 0;
         }
 
         // insert convex vertex
@@ -1139,6 +1330,8 @@ namespace gte
                 V(i).sPrev = mRLast;
             }
             mRLast = i;
+            V(i).isReflex = true;
+            ++mNumReflex;
         }
 
         // insert ear at end of list
@@ -1202,6 +1395,8 @@ namespace gte
         void RemoveR(int32_t i)
         {
             LogAssert(mRFirst != -1 && mRLast != -1, "Reflex vertices must exist.");
+            V(i).isReflex = false;
+            --mNumReflex;
 
             if (i == mRFirst)
             {
@@ -1237,5 +1432,23 @@ namespace gte
         int32_t mCFirst, mCLast;  // linear list of convex vertices
         int32_t mRFirst, mRLast;  // linear list of reflex vertices
         int32_t mEFirst, mELast;  // cyclical list of ears
+        int32_t mNumReflex;       // number of reflex vertices in the list
+
+        // The original indices of the duplicated vertices; see
+        // SetOriginalIndex.
+        std::vector<int32_t> mIndexMap;
+
+        // The grid of reflex vertices.  The vertices of cell c are
+        // mGridCellVertices[k] for mGridCellOffsets[c] <= k <
+        // mGridCellOffsets[c+1], and the cells are ordered with x varying
+        // fastest.  The grid is not used when mGridCellOffsets is empty.
+        // It was built for mGridNumReflex reflex vertices.
+        static int32_t constexpr msMinGridReflex = 64;
+        int32_t mGridNumReflex;
+        std::vector<std::array<double, 2>> mGridPoints;
+        std::array<double, 2> mGridMin, mGridInvCellSize;
+        std::array<int32_t, 2> mGridBound;
+        std::vector<size_t> mGridCellOffsets;
+        std::vector<int32_t> mGridCellVertices;
     };
 }
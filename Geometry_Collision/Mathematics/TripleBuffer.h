@@ -0,0 +1,100 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// A wait-free channel from one writer thread to one reader thread that
+// always delivers the most recent value. There are three slots: the writer
+// fills its back slot and publishes it, the reader acquires the most
+// recently published slot as its front slot, and the third slot is in the
+// middle between them. Neither thread waits for the other, and a value the
+// reader did not acquire before the next Publish is dropped.
+//
+//   writer thread                  reader thread
+//   T& value = buffer.GetWriteBuffer();
+//   <fill value>                   if (buffer.Acquire())
+//   buffer.Publish();              {
+//                                      T& value = buffer.GetReadBuffer();
+//                                      <use value>
+//                                  }
+//
+// The writer owns the slot returned by GetWriteBuffer() until it calls
+// Publish(), and the reader owns the slot returned by GetReadBuffer() until
+// its next successful Acquire(). Either thread may modify its own slot, for
+// example to swap the contents with other storage. A slot returned to the
+// writer holds an old value, so the writer must overwrite all of it.
+
+namespace gte
+{
+    template <typename T>
+    class TripleBuffer
+    {
+    public:
+        // Construction and destruction.
+        TripleBuffer()
+            :
+            mSlots{},
+            mBack(0),
+            mMiddle(1),
+            mFront(2)
+        {
+        }
+
+        virtual ~TripleBuffer() = default;
+
+        TripleBuffer(TripleBuffer const&) = delete;
+        TripleBuffer& operator=(TripleBuffer const&) = delete;
+
+        // Member access for the writer thread.
+        inline T& GetWriteBuffer()
+        {
+            return mSlots[mBack];
+        }
+
+        void Publish()
+        {
+            uint32_t const previous = mMiddle.exchange(mBack | fresh, std::memory_order_acq_rel);
+            mBack = previous & indexMask;
+        }
+
+        // Member access for the reader thread. The return value of Acquire()
+        // is 'true' when a value was published since the last acquisition,
+        // in which case GetReadBuffer() now returns that value. Otherwise the
+        // front slot is unchanged.
+        bool Acquire()
+        {
+            if ((mMiddle.load(std::memory_order_relaxed) & fresh) == 0)
+            {
+                return false;
+            }
+
+            uint32_t const previous = mMiddle.exchange(mFront, std::memory_order_acq_rel);
+            mFront = previous & indexMask;
+            return true;
+        }
+
+        inline T& GetReadBuffer()
+        {
+            return mSlots[mFront];
+        }
+
+    private:
+        // The middle index has a flag that is set by Publish() and cleared
+        // by Acquire().
+        static uint32_t constexpr indexMask = 3;
+        static uint32_t constexpr fresh = 4;
+
+        std::array<T, 3> mSlots;
+        uint32_t mBack;
+        std::atomic<uint32_t> mMiddle;
+        uint32_t mFront;
+    };
+}
@@ -9,6 +9,7 @@
 
 #include <Mathematics/Logger.h>
 #include <Mathematics/UIntegerALU32.h>
+#include <Mathematics/UIntegerAP32Arena.h>
 #include <limits>
 #include <istream>
 #include <ostream>
@@ -32,6 +33,11 @@
 // types of computation you perform.  See class BSPrecision for code that
 // allows you to compute maximum N.
 //
+// The storage is allocated by UIntegerAP32Allocator. Create a
+// UIntegerAP32Arena::Scope object around a predicate or an algorithm phase
+// to allocate the storage from a thread-local arena instead of the heap.
+// See UIntegerAP32Arena.h for the lifetime rules.
+//
 //#define GTE_COLLECT_UINTEGERAP32_STATISTICS
 
 #if defined(GTE_COLLECT_UINTEGERAP32_STATISTICS)
@@ -47,6 +53,8 @@ namespace gte
     class UIntegerAP32 : public UIntegerALU32<UIntegerAP32>
     {
     public:
+        using Storage = std::vector<uint32_t, UIntegerAP32Allocator<uint32_t>>;
+
         // Construction.
         UIntegerAP32()
             :
@@ -154,12 +162,12 @@ namespace gte
             return mNumBits;
         }
 
-        inline std::vector<uint32_t> const& GetBits() const
+        inline Storage const& GetBits() const
         {
             return mBits;
         }
 
-        inline std::vector<uint32_t>& GetBits()
+        inline Storage& GetBits()
         {
             return mBits;
         }
@@ -226,6 +234,6 @@ namespace gte
 
     private:
         int32_t mNumBits;
-        std::vector<uint32_t> mBits;
+        Storage mBits;
     };
 }
@@ -0,0 +1,272 @@
+// David Eberly, Geometric Tools, Redmond WA 98052
+// Copyright (c) 1998-2023
+// Distributed under the Boost Software License, Version 1.0.
+// https://www.boost.org/LICENSE_1_0.txt
+// https://www.geometrictools.com/License/Boost/LICENSE_1_0.txt
+// Version: 6.0.2022.01.06
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+
+// The storage for the bits of UIntegerAP32 is allocated by
+// UIntegerAP32Allocator. When no UIntegerAP32Arena::Scope object is alive on
+// the calling thread, the storage is allocated on the heap. While a Scope
+// object is alive, the storage is allocated from an arena owned by the
+// calling thread. The arena carves its chunks from large blocks and recycles
+// released chunks through free lists of power-of-two sizes, so a sequence of
+// BSNumber or BSRational operations does not call the heap manager and
+// threads do not contend for it.
+//
+//   void MyAlgorithm()
+//   {
+//       UIntegerAP32Arena::Scope scope;
+//       ... BSRational<UIntegerAP32> computations ...
+//   }
+//
+// Scopes may be nested. When the outermost scope ends and all the arena
+// chunks have been released, the arena is reset and its blocks are reused
+// by the next scope. A number that outlives the scope keeps its storage
+// valid; the arena is then not reset until that number is destroyed and
+// another outermost scope ends. The blocks are returned to the heap by
+// ReleaseMemory() or when the thread exits.
+//
+// A number whose storage is in an arena must be destroyed on the thread
+// that created it. UIntegerFP32 does not allocate, so BSNumber and
+// BSRational of UIntegerFP32<N> are unaffected by the arena and can be
+// mixed freely with the arena-backed numbers.
+
+namespace gte
+{
+    class UIntegerAP32Arena
+    {
+    public:
+        // Construction and destruction. Use the thread-local arena returned
+        // by GetThreadArena() rather than creating your own.
+        UIntegerAP32Arena()
+            :
+            mScopeDepth(0),
+            mNumLive(0),
+            mBlocks{},
+            mCurrentBlock(0),
+            mOffset(0),
+            mFreeLists{}
+        {
+            mFreeLists.fill(nullptr);
+        }
+
+        // The arena of the calling thread.
+        static UIntegerAP32Arena& GetThreadArena()
+        {
+            static thread_local UIntegerAP32Arena arena;
+            return arena;
+        }
+
+        // The arena of the calling thread when a scope is active, otherwise
+        // nullptr.
+        static UIntegerAP32Arena* GetActiveArena()
+        {
+            UIntegerAP32Arena& arena = GetThreadArena();
+            return (arena.mScopeDepth > 0 ? &arena : nullptr);
+        }
+
+        class Scope
+        {
+        public:
+            Scope()
+                :
+                mArena(GetThreadArena())
+            {
+                ++mArena.mScopeDepth;
+            }
+
+            ~Scope()
+            {
+                if (--mArena.mScopeDepth == 0 && mArena.mNumLive == 0)
+                {
+                    mArena.Reset();
+                }
+            }
+
+            Scope(Scope const&) = delete;
+            Scope& operator=(Scope const&) = delete;
+
+        private:
+            UIntegerAP32Arena& mArena;
+        };
+
+        // Return the blocks of the calling thread's arena to the heap. The
+        // call is ignored when a scope is active or chunks are still in use.
+        static void ReleaseMemory()
+        {
+            UIntegerAP32Arena& arena = GetThreadArena();
+            if (arena.mScopeDepth == 0 && arena.mNumLive == 0)
+            {
+                arena.Reset();
+                arena.mBlocks.clear();
+            }
+        }
+
+        // Allocation of storage. The heap is used when no scope is active on
+        // the calling thread or the request is larger than maxChunkSize.
+        static void* Allocate(size_t numBytes)
+        {
+            UIntegerAP32Arena* arena = GetActiveArena();
+            Header* header = nullptr;
+            if (arena != nullptr && numBytes <= maxChunkSize)
+            {
+                header = arena->AllocateChunk(numBytes);
+            }
+            else
+            {
+                header = static_cast<Header*>(::operator new(sizeof(Header) + numBytes));
+                header->arena = nullptr;
+                header->sizeClass = 0;
+            }
+            return header + 1;
+        }
+
+        static void Deallocate(void* data)
+        {
+            Header* header = static_cast<Header*>(data) - 1;
+            if (header->arena != nullptr)
+            {
+                header->arena->ReleaseChunk(header);
+            }
+            else
+            {
+                ::operator delete(header);
+            }
+        }
+
+    private:
+        // Each allocation is preceded by a header that identifies its arena
+        // (nullptr for the heap) and its free list.
+        struct alignas(std::max_align_t) Header
+        {
+            UIntegerAP32Arena* arena;
+            size_t sizeClass;
+        };
+
+        // Free chunks store the link to the next free chunk of the same size
+        // class in place of their data.
+        struct FreeChunk
+        {
+            FreeChunk* next;
+        };
+
+        // The chunk sizes are minChunkSize * 2^k for k < numSizeClasses.
+        static size_t constexpr minChunkSize = 16;
+        static size_t constexpr numSizeClasses = 12;
+        static size_t constexpr maxChunkSize = minChunkSize << (numSizeClasses - 1);
+        static size_t constexpr blockSize = 1 << 18;
+
+        Header* AllocateChunk(size_t numBytes)
+        {
+            size_t sizeClass = 0;
+            while ((minChunkSize << sizeClass) < numBytes)
+            {
+                ++sizeClass;
+            }
+
+            Header* header = nullptr;
+            FreeChunk* chunk = mFreeLists[sizeClass];
+            if (chunk != nullptr)
+            {
+                mFreeLists[sizeClass] = chunk->next;
+                header = reinterpret_cast<Header*>(chunk) - 1;
+            }
+            else
+            {
+                size_t const numChunkBytes = sizeof(Header) + (minChunkSize << sizeClass);
+                if (mBlocks.size() == 0 || mOffset + numChunkBytes > blockSize)
+                {
+                    if (mBlocks.size() > 0)
+                    {
+                        ++mCurrentBlock;
+                    }
+                    if (mCurrentBlock == mBlocks.size())
+                    {
+                        mBlocks.push_back(std::make_unique<Header[]>(blockSize / sizeof(Header)));
+                    }
+                    mOffset = 0;
+                }
+                header = reinterpret_cast<Header*>(
+                    reinterpret_cast<uint8_t*>(mBlocks[mCurrentBlock].get()) + mOffset);
+                mOffset += numChunkBytes;
+            }
+
+            header->arena = this;
+            header->sizeClass = sizeClass;
+            ++mNumLive;
+            return header;
+        }
+
+        void ReleaseChunk(Header* header)
+        {
+            FreeChunk* chunk = reinterpret_cast<FreeChunk*>(header + 1);
+            chunk->next = mFreeLists[header->sizeClass];
+            mFreeLists[header->sizeClass] = chunk;
+            --mNumLive;
+        }
+
+        void Reset()
+        {
+            mCurrentBlock = 0;
+            mOffset = 0;
+            mFreeLists.fill(nullptr);
+        }
+
+        size_t mScopeDepth;
+        size_t mNumLive;
+
+        // The blocks are arrays of Header so that every chunk is aligned.
+        // The chunk sizes are multiples of sizeof(Header).
+        std::vector<std::unique_ptr<Header[]>> mBlocks;
+        size_t mCurrentBlock, mOffset;
+        std::array<FreeChunk*, numSizeClasses> mFreeLists;
+    };
+
+    // The allocator for the std::vector that stores the bits of
+    // UIntegerAP32.
+    template <typename T>
+    class UIntegerAP32Allocator
+    {
+    public:
+        using value_type = T;
+
+        UIntegerAP32Allocator() noexcept = default;
+
+        template <typename U>
+        UIntegerAP32Allocator(UIntegerAP32Allocator<U> const&) noexcept
+        {
+        }
+
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(UIntegerAP32Arena::Allocate(n * sizeof(T)));
+        }
+
+        void deallocate(T* p, size_t)
+        {
+            UIntegerAP32Arena::Deallocate(p);
+        }
+
+        template <typename U>
+        bool operator==(UIntegerAP32Allocator<U> const&) const noexcept
+        {
+            return true;
+        }
+
+        template <typename U>
+        bool operator!=(UIntegerAP32Allocator<U> const&) const noexcept
+        {
+            return false;
+        }
+    };
+}
@@ -9,8 +9,8 @@
 
 // UniqueVerticesSimplices allows mesh generation and elimination of duplicate
 // and/or unused vertices. The vertices have type VertexType, which must have
-// a less-than comparison predicate because it is used as the key type in
-// std::map. The IndexType can be any signed or unsigned integer type, not
+// a less-than comparison predicate because the vertices are sorted. The
+// IndexType can be any signed or unsigned integer type, not
 // including 1-byte types or bool. The mesh can be in any dimension D >= 2. In
 // 2 dimensions, the mesh is a collection of edges. In 3 dimensions, the mesh
 // is a collection of triangles. Generally, the mesh is a collection of
@@ -37,14 +37,31 @@
 //   4. Remove duplicate and unused vertices from a vertex pool, a combination
 //      of the operations in #2 and #3.
 //
+//   5. Weld the vertices of a vertex pool that are within a distance epsilon
+//      of each other, otherwise as in #2. This requires VertexType to have
+//      D components that are accessed by operator[] and are convertible to
+//      double, for example Vector<D, float>.
+//
+// The duplicates are found by sorting the indices of the vertices, which
+// is done on multiple threads when numThreads is 2 or larger, as are the
+// remapping of the indices and the packing of the vertices. The outputs are
+// the same for all numbers of threads: the unique vertices are in the order
+// of their first occurrence in the input. Welding searches a hashed grid of
+// cells of size epsilon on one thread, because the selection of the vertex
+// that represents a cluster depends on the order of the vertices.
+//
 // In the Geometric Tools distribution, the class is used for polygon Boolean
 // operations (D = 2) and for compactifying triangle meshes (D = 3).
 
 #include <Mathematics/Logger.h>
+#include <algorithm>
 #include <array>
-#include <map>
-#include <set>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <thread>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 namespace gte
@@ -53,7 +70,11 @@ namespace gte
     class UniqueVerticesSimplices
     {
     public:
-        UniqueVerticesSimplices()
+        // Set numThreads to 2 or larger to activate multithreading. If
+        // numThreads is 0 or 1, the computations occur in the main thread.
+        UniqueVerticesSimplices(size_t numThreads = 1)
+            :
+            mNumThreads(numThreads)
         {
             // The index type must be an integral type that does not include
             // bool. MSVS 2019 16.7.3 does not trigger this static assertion
@@ -144,10 +165,8 @@ namespace gte
             RemoveDuplicates(inVertices, outVertices, inToOutMapping.data());
 
             outIndices.resize(inIndices.size());
-            for (size_t i = 0; i < inIndices.size(); ++i)
-            {
-                outIndices[i] = inToOutMapping[inIndices[i]];
-            }
+            Remap(inToOutMapping.data(), inIndices.size(), inIndices.data(),
+                outIndices.data());
         }
 
         // See #2 in the comments at the beginning of the file. The
@@ -184,15 +203,10 @@ namespace gte
             std::vector<IndexType> inToOutMapping(inVertices.size());
             RemoveDuplicates(inVertices, outVertices, inToOutMapping.data());
 
-            size_t const numSimplices = inSimplices.size();
-            outSimplices.resize(numSimplices);
-            for (size_t s = 0; s < numSimplices; ++s)
-            {
-                for (size_t d = 0; d < Dimension; ++d)
-                {
-                    outSimplices[s][d] = inToOutMapping[inSimplices[s][d]];
-                }
-            }
+            outSimplices.resize(inSimplices.size());
+            Remap(inToOutMapping.data(), Dimension * inSimplices.size(),
+                reinterpret_cast<IndexType const*>(inSimplices.data()),
+                reinterpret_cast<IndexType*>(outSimplices.data()));
         }
 
         // See #3 in the comments at the beginning of the file. The
@@ -298,74 +312,390 @@ namespace gte
             RemoveUnusedVertices(tempVertices, tempSimplices, outVertices, outSimplices);
         }
 
-    private:
-        void RemoveDuplicates(
+        // See #5 in the comments at the beginning of the file. The
+        // preconditions are those of RemoveDuplicateVertices and
+        //   1. epsilon > 0
+        // The postconditions are those of RemoveDuplicateVertices. The
+        // vertices are visited in the input order. A vertex closer than
+        // epsilon to a representative vertex is mapped to the closest one;
+        // otherwise, it becomes a representative. The output vertices are
+        // the representatives in the input order.
+        void WeldVertices(
             std::vector<VertexType> const& inVertices,
+            std::vector<IndexType> const& inIndices,
+            double epsilon,
             std::vector<VertexType>& outVertices,
-            IndexType* inToOutMapping)
+            std::vector<IndexType>& outIndices)
         {
-            // Construct the unique vertices.
-            size_t const numInVertices = inVertices.size();
-            size_t numOutVertices = 0;
-            std::map<VertexType, IndexType> vmap;
-            for (size_t i = 0; i < numInVertices; ++i)
+            LogAssert(
+                inVertices.size() > 0,
+                "Invalid number of vertices.");
+            LogAssert(
+                inIndices.size() > 0 &&
+                inIndices.size() % Dimension == 0,
+                "Invalid number of indices.");
+            LogAssert(
+                epsilon > 0.0,
+                "Invalid epsilon.");
+
+            std::vector<IndexType> inToOutMapping(inVertices.size());
+            Weld(inVertices, epsilon, outVertices, inToOutMapping.data());
+
+            outIndices.resize(inIndices.size());
+            Remap(inToOutMapping.data(), inIndices.size(), inIndices.data(),
+                outIndices.data());
+        }
+
+        void WeldVertices(
+            std::vector<VertexType> const& inVertices,
+            std::vector<std::array<IndexType, Dimension>> const& inSimplices,
+            double epsilon,
+            std::vector<VertexType>& outVertices,
+            std::vector<std::array<IndexType, Dimension>>& outSimplices)
+        {
+            LogAssert(
+                inVertices.size() > 0,
+                "Invalid number of vertices.");
+            LogAssert(
+                inSimplices.size() > 0,
+                "Invalid number of simplices.");
+            LogAssert(
+                epsilon > 0.0,
+                "Invalid epsilon.");
+
+            std::vector<IndexType> inToOutMapping(inVertices.size());
+            Weld(inVertices, epsilon, outVertices, inToOutMapping.data());
+
+            outSimplices.resize(inSimplices.size());
+            Remap(inToOutMapping.data(), Dimension * inSimplices.size(),
+                reinterpret_cast<IndexType const*>(inSimplices.data()),
+                reinterpret_cast<IndexType*>(outSimplices.data()));
+        }
+
+    private:
+        // The minimum number of items per thread.
+        static size_t constexpr minItemsPerWorker = 4096;
+
+        size_t GetNumWorkers(size_t numItems) const
+        {
+            return std::max(static_cast<size_t>(1),
+                std::min(mNumThreads, numItems / minItemsPerWorker));
+        }
+
+        // Execute function(worker, begin, end) for numWorkers consecutive
+        // ranges that partition [0,numItems), on threads when numWorkers is
+        // 2 or larger.
+        template <typename Function>
+        static void RunWorkers(size_t numWorkers, size_t numItems, Function const& function)
+        {
+            if (numWorkers <= 1)
+            {
+                function(0, 0, numItems);
+                return;
+            }
+
+            std::vector<std::thread> process(numWorkers);
+            for (size_t w = 0; w < numWorkers; ++w)
             {
-                auto const iter = vmap.find(inVertices[i]);
-                if (iter != vmap.end())
+                size_t const begin = numItems * w / numWorkers;
+                size_t const end = numItems * (w + 1) / numWorkers;
+                process[w] = std::thread([&function, w, begin, end]()
                 {
-                    // The vertex is a duplicate of one inserted earlier into
-                    // the map. Its index i will be modified to that of the
-                    // first-found vertex.
-                    inToOutMapping[i] = iter->second;
+                    function(w, begin, end);
+                });
+            }
+
+            for (size_t w = 0; w < numWorkers; ++w)
+            {
+                process[w].join();
+            }
+        }
+
+        // Sort the indices of the vertices by vertex and then by index. The
+        // workers sort consecutive blocks that are then merged in pairs.
+        void SortIndices(std::vector<VertexType> const& vertices,
+            std::vector<size_t>& order) const
+        {
+            auto const less = [&vertices](size_t i0, size_t i1)
+            {
+                if (vertices[i0] < vertices[i1])
+                {
+                    return true;
                 }
-                else
+                if (vertices[i1] < vertices[i0])
                 {
-                    // The vertex occurs for the first time.
-                    vmap.insert(std::make_pair(inVertices[i],
-                        static_cast<IndexType>(numOutVertices)));
-                    inToOutMapping[i] = static_cast<IndexType>(numOutVertices);
-                    ++numOutVertices;
+                    return false;
                 }
+                return i0 < i1;
+            };
+
+            size_t const numItems = order.size();
+            size_t const numWorkers = GetNumWorkers(numItems);
+            std::vector<size_t> bounds(numWorkers + 1);
+            for (size_t w = 0; w <= numWorkers; ++w)
+            {
+                bounds[w] = numItems * w / numWorkers;
             }
+            RunWorkers(numWorkers, numItems,
+                [&order, &less](size_t, size_t begin, size_t end)
+                {
+                    std::sort(order.begin() + begin, order.begin() + end, less);
+                });
 
-            // Pack the unique vertices into an array.
-            outVertices.resize(numOutVertices);
-            for (auto const& element : vmap)
+            std::vector<size_t> merged(numItems);
+            while (bounds.size() > 2)
             {
-                outVertices[element.second] = element.first;
+                size_t const numBlocks = bounds.size() - 1;
+                size_t const numMerges = (numBlocks + 1) / 2;
+                RunWorkers(numMerges, numMerges,
+                    [&order, &merged, &bounds, &less, numBlocks](size_t, size_t mbegin, size_t mend)
+                    {
+                        for (size_t m = mbegin; m < mend; ++m)
+                        {
+                            auto const first = order.begin() + bounds[2 * m];
+                            auto const middle = order.begin() + bounds[std::min(2 * m + 1, numBlocks)];
+                            auto const last = order.begin() + bounds[std::min(2 * m + 2, numBlocks)];
+                            std::merge(first, middle, middle, last,
+                                merged.begin() + bounds[2 * m], less);
+                        }
+                    });
+
+                std::vector<size_t> mergedBounds(numMerges + 1);
+                for (size_t m = 0; m < numMerges; ++m)
+                {
+                    mergedBounds[m] = bounds[2 * m];
+                }
+                mergedBounds[numMerges] = numItems;
+                bounds = std::move(mergedBounds);
+                std::swap(order, merged);
             }
         }
 
+        void RemoveDuplicates(
+            std::vector<VertexType> const& inVertices,
+            std::vector<VertexType>& outVertices,
+            IndexType* inToOutMapping) const
+        {
+            // Sort the vertex indices so that equal vertices are contiguous
+            // and the first element of each run has the smallest index.
+            size_t const numInVertices = inVertices.size();
+            std::vector<size_t> order(numInVertices);
+            std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+            SortIndices(inVertices, order);
+
+            // Map each vertex to the first occurrence of its value. A worker
+            // processes the runs that start in its range.
+            size_t const numWorkers = GetNumWorkers(numInVertices);
+            std::vector<size_t> representative(numInVertices);
+            std::vector<uint8_t> isFirst(numInVertices, 0);
+            auto const equal = [&inVertices](size_t i0, size_t i1)
+            {
+                return !(inVertices[i0] < inVertices[i1]) && !(inVertices[i1] < inVertices[i0]);
+            };
+            RunWorkers(numWorkers, numInVertices,
+                [&](size_t, size_t begin, size_t end)
+                {
+                    size_t k = begin;
+                    while (k > 0 && k < end && equal(order[k - 1], order[k]))
+                    {
+                        ++k;
+                    }
+                    while (k < end)
+                    {
+                        size_t const first = order[k];
+                        isFirst[first] = 1;
+                        representative[first] = first;
+                        for (++k; k < numInVertices && equal(first, order[k]); ++k)
+                        {
+                            representative[order[k]] = first;
+                        }
+                    }
+                });
+
+            // Number the unique vertices in the order of first occurrence
+            // and pack them into an array.
+            std::vector<IndexType> outIndex(numInVertices);
+            Compact(inVertices, isFirst, outVertices, outIndex.data());
+
+            RunWorkers(numWorkers, numInVertices,
+                [&](size_t, size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        inToOutMapping[i] = outIndex[representative[i]];
+                    }
+                });
+        }
+
         void RemoveUnused(
             std::vector<VertexType> const& inVertices,
             size_t const numInIndices,
             IndexType const* inIndices,
             std::vector<VertexType>& outVertices,
-            IndexType* outIndices)
+            IndexType* outIndices) const
         {
-            // Get the unique set of used indices.
-            std::set<IndexType> usedIndices;
+            // Locate the used vertices and pack them into an array in the
+            // order of their indices.
+            std::vector<uint8_t> isUsed(inVertices.size(), 0);
             for (size_t i = 0; i < numInIndices; ++i)
             {
-                usedIndices.insert(inIndices[i]);
+                isUsed[static_cast<size_t>(inIndices[i])] = 1;
             }
 
-            // Locate the used vertices and pack them into an array.
-            outVertices.resize(usedIndices.size());
-            size_t numOutVertices = 0;
-            std::map<IndexType, IndexType> vmap;
-            for (auto oldIndex : usedIndices)
-            {
-                outVertices[numOutVertices] = inVertices[oldIndex];
-                vmap.insert(std::make_pair(oldIndex, static_cast<IndexType>(numOutVertices)));
-                ++numOutVertices;
-            }
+            std::vector<IndexType> outIndex(inVertices.size());
+            Compact(inVertices, isUsed, outVertices, outIndex.data());
 
             // Reassign the old indices to the new indices.
-            for (size_t i = 0; i < numInIndices; ++i)
+            Remap(outIndex.data(), numInIndices, inIndices, outIndices);
+        }
+
+        void Weld(
+            std::vector<VertexType> const& inVertices,
+            double epsilon,
+            std::vector<VertexType>& outVertices,
+            IndexType* inToOutMapping) const
+        {
+            using Cell = std::array<int64_t, Dimension>;
+            struct CellHash
             {
-                outIndices[i] = vmap.find(inIndices[i])->second;
+                size_t operator()(Cell const& cell) const
+                {
+                    uint64_t hash = 14695981039346656037ull;
+                    for (size_t d = 0; d < Dimension; ++d)
+                    {
+                        hash = (hash ^ static_cast<uint64_t>(cell[d])) * 1099511628211ull;
+                    }
+                    return static_cast<size_t>(hash);
+                }
+            };
+
+            // The representatives are stored in the grid cells that contain
+            // them. A vertex within epsilon of a representative is in the
+            // same cell or in an adjacent one.
+            size_t const numInVertices = inVertices.size();
+            double const sqrEpsilon = epsilon * epsilon;
+            std::unordered_map<Cell, std::vector<size_t>, CellHash> grid;
+            std::vector<uint8_t> isFirst(numInVertices, 0);
+            std::vector<size_t> representative(numInVertices);
+            for (size_t i = 0; i < numInVertices; ++i)
+            {
+                Cell cell{};
+                for (size_t d = 0; d < Dimension; ++d)
+                {
+                    cell[d] = static_cast<int64_t>(std::floor(
+                        static_cast<double>(inVertices[i][d]) / epsilon));
+                }
+
+                size_t closest = i;
+                double minSqrDistance = sqrEpsilon;
+                size_t const numNeighbors = static_cast<size_t>(std::pow(3.0, static_cast<double>(Dimension)));
+                for (size_t n = 0; n < numNeighbors; ++n)
+                {
+                    Cell neighbor = cell;
+                    for (size_t d = 0, m = n; d < Dimension; ++d, m /= 3)
+                    {
+                        neighbor[d] += static_cast<int64_t>(m % 3) - 1;
+                    }
+
+                    auto const iter = grid.find(neighbor);
+                    if (iter == grid.end())
+                    {
+                        continue;
+                    }
+                    for (auto j : iter->second)
+                    {
+                        double sqrDistance = 0.0;
+                        for (size_t d = 0; d < Dimension; ++d)
+                        {
+                            double const diff = static_cast<double>(inVertices[i][d])
+                                - static_cast<double>(inVertices[j][d]);
+                            sqrDistance += diff * diff;
+                        }
+                        if (sqrDistance < minSqrDistance ||
+                            (sqrDistance == minSqrDistance && j < closest))
+                        {
+                            minSqrDistance = sqrDistance;
+                            closest = j;
+                        }
+                    }
+                }
+
+                representative[i] = closest;
+                if (closest == i)
+                {
+                    isFirst[i] = 1;
+                    grid[cell].push_back(i);
+                }
             }
+
+            std::vector<IndexType> outIndex(numInVertices);
+            Compact(inVertices, isFirst, outVertices, outIndex.data());
+
+            RunWorkers(GetNumWorkers(numInVertices), numInVertices,
+                [&](size_t, size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        inToOutMapping[i] = outIndex[representative[i]];
+                    }
+                });
         }
+
+        // Copy the vertices with nonzero flags into outVertices, preserving
+        // their order, and set outIndex[i] to the output index of vertex i
+        // when its flag is nonzero. The workers count the selected vertices
+        // of their ranges, and the prefix sums of the counts are the output
+        // offsets of the ranges.
+        void Compact(
+            std::vector<VertexType> const& inVertices,
+            std::vector<uint8_t> const& flags,
+            std::vector<VertexType>& outVertices,
+            IndexType* outIndex) const
+        {
+            size_t const numInVertices = inVertices.size();
+            size_t const numWorkers = GetNumWorkers(numInVertices);
+            std::vector<size_t> offsets(numWorkers + 1, 0);
+            RunWorkers(numWorkers, numInVertices,
+                [&flags, &offsets](size_t w, size_t begin, size_t end)
+                {
+                    offsets[w + 1] = static_cast<size_t>(std::count(
+                        flags.begin() + begin, flags.begin() + end, static_cast<uint8_t>(1)));
+                });
+            std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+            outVertices.resize(offsets[numWorkers]);
+            RunWorkers(numWorkers, numInVertices,
+                [&](size_t w, size_t begin, size_t end)
+                {
+                    size_t next = offsets[w];
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        if (flags[i])
+                        {
+                            outVertices[next] = inVertices[i];
+                            outIndex[i] = static_cast<IndexType>(next);
+                            ++next;
+                        }
+                    }
+                });
+        }
+
+        void Remap(
+            IndexType const* inToOutMapping,
+            size_t numIndices,
+            IndexType const* inIndices,
+            IndexType* outIndices) const
+        {
+            RunWorkers(GetNumWorkers(numIndices), numIndices,
+                [&](size_t, size_t begin, size_t end)
+                {
+                    for (size_t i = begin; i < end; ++i)
+                    {
+                        outIndices[i] = inToOutMapping[static_cast<size_t>(inIndices[i])];
+                    }
+                });
+        }
+
+        size_t mNumThreads;
     };
 }
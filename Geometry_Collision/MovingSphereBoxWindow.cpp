@@ -1,11 +1,146 @@
 #include "MovingSphereBoxWindow.h"
 #include "MeshFactory.h"
 #include "ConstantColorEffect.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+namespace
+{
+	// The spheres and velocities of the full direction sweep in the
+	// coordinate system of the box.
+	template <typename Real>
+	struct DirectionSweep
+	{
+		AlignedBox3<Real> box;
+		Vector3<Real> boxVelocity;
+		SphereArray3<Real> spheres;
+		std::array<std::vector<Real>, 3> velocity;
+	};
+
+	// Direction j = sample1 * numSamples0 + sample0 of the sweep is the
+	// velocity that UpdateSphereVelocity computes for (sample0,sample1).
+	template <typename Real>
+	void CreateSweep(AlignedBox3<float> const& box, Vector3<float> const& boxVelocity,
+		Sphere3<float> const& sphere, std::array<Vector3<float>, 3> const& axis,
+		int32_t numSamples0, int32_t numSamples1, DirectionSweep<Real>& sweep)
+	{
+		Sphere3<Real> realSphere{};
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			sweep.box.min[d] = static_cast<Real>(box.min[d]);
+			sweep.box.max[d] = static_cast<Real>(box.max[d]);
+			sweep.boxVelocity[d] = static_cast<Real>(boxVelocity[d]);
+			realSphere.center[d] = static_cast<Real>(sphere.center[d]);
+		}
+		realSphere.radius = static_cast<Real>(sphere.radius);
+
+		size_t const numDirections = static_cast<size_t>(numSamples0) * static_cast<size_t>(numSamples1);
+		sweep.spheres.Clear();
+		sweep.spheres.Reserve(numDirections);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			sweep.velocity[d].resize(numDirections);
+		}
+		for (int32_t sample1 = 0, j = 0; sample1 < numSamples1; ++sample1)
+		{
+			for (int32_t sample0 = 0; sample0 < numSamples0; ++sample0, ++j)
+			{
+				float angle0 = static_cast<float>(sample0 * GTE_C_TWO_PI / numSamples0);
+				float angle1 = static_cast<float>(sample1 * GTE_C_PI / numSamples1);
+				float cs0 = std::cos(angle0), sn0 = std::sin(angle0);
+				float cs1 = std::cos(angle1), sn1 = std::sin(angle1);
+				Vector3<float> velocity{ cs0 * sn1, sn0 * sn1, cs1 };
+				for (int32_t d = 0; d < 3; ++d)
+				{
+					sweep.velocity[d][j] = static_cast<Real>(Dot(velocity, axis[d]));
+				}
+				sweep.spheres.Push(realSphere);
+			}
+		}
+	}
+
+	// Query the sweep numRepeats times on numThreads threads, each thread
+	// querying its own range of directions, and return the queries per
+	// second. The single query is the scalar path; the batched query tests
+	// 64 directions at a time with vectorized slab loops.
+	template <typename Real>
+	double MeasureSweep(DirectionSweep<Real> const& sweep, bool batched,
+		size_t numThreads, size_t numRepeats, size_t& numContacts)
+	{
+		size_t const numQueries = sweep.spheres.size();
+		typename FIQuery<Real, AlignedBox3<Real>, SphereArray3<Real>>::Result result{};
+		result.Resize(numQueries);
+		std::vector<size_t> contacts(numThreads, 0);
+
+		auto work = [&sweep, &result, &contacts, batched, numThreads, numRepeats, numQueries](size_t t)
+		{
+			size_t const begin = numQueries * t / numThreads;
+			size_t const end = numQueries * (t + 1) / numThreads;
+			if (batched)
+			{
+				FIQuery<Real, AlignedBox3<Real>, SphereArray3<Real>> query{};
+				for (size_t repeat = 0; repeat < numRepeats; ++repeat)
+				{
+					contacts[t] = query(sweep.box, sweep.boxVelocity, sweep.spheres,
+						sweep.velocity, begin, end, result);
+				}
+			}
+			else
+			{
+				FIQuery<Real, AlignedBox3<Real>, Sphere3<Real>> query{};
+				for (size_t repeat = 0; repeat < numRepeats; ++repeat)
+				{
+					size_t count = 0;
+					for (size_t j = begin; j < end; ++j)
+					{
+						Vector3<Real> const velocity{ sweep.velocity[0][j],
+							sweep.velocity[1][j], sweep.velocity[2][j] };
+						auto const single = query(sweep.box, sweep.boxVelocity,
+							sweep.spheres.Get(j), velocity);
+						result.intersectionType[j] = single.intersectionType;
+						result.contactTime[j] = single.contactTime;
+						for (int32_t d = 0; d < 3; ++d)
+						{
+							result.contactPoint[d][j] = single.contactPoint[d];
+						}
+						count += static_cast<size_t>(single.intersectionType != 0);
+					}
+					contacts[t] = count;
+				}
+			}
+		};
+
+		auto start = std::chrono::steady_clock::now();
+		std::vector<std::thread> threads;
+		for (size_t t = 1; t < numThreads; ++t)
+		{
+			threads.emplace_back(work, t);
+		}
+		work(0);
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		double const seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+
+		numContacts = 0;
+		for (auto count : contacts)
+		{
+			numContacts += count;
+		}
+		return static_cast<double>(numRepeats * numQueries) / std::max(seconds, 1e-9);
+	}
+}
 
 MovingSphereBoxWindow3::MovingSphereBoxWindow3(Parameters& parameters)
 	:
 	Window3(parameters),
 	mAlpha(0.5f),
+	mNumPVWMatrices(0),
+	mDrawContactCloud(true),
 	mNumSamples0(128),
 	mNumSamples1(64),
 	mSample0(0),
@@ -46,6 +181,11 @@ void MovingSphereBoxWindow3::OnIdle()
 
 	mEngine->ClearBuffers();
 
+	if (mDrawContactCloud && mContactCloud->culling != CullingMode::ALWAYS)
+	{
+		mEngine->Draw(mContactCloud);
+	}
+
 	// This is not the correct drawing order, but it is close enough for
 	// demonstrating the moving sphere-box intersection query.
 	mEngine->SetBlendState(mBlendState);
@@ -62,25 +202,18 @@ void MovingSphereBoxWindow3::OnIdle()
 	}
 
 	mEngine->Draw(mBoxVisual);
-	for (int32_t i = 0; i < 8; ++i)
-	{
-		mEngine->Draw(mVertexVisual[i]);
-	}
-	for (int32_t i = 0; i < 12; ++i)
-	{
-		mEngine->Draw(mEdgeVisual[i]);
-	}
-	for (int32_t i = 0; i < 6; ++i)
-	{
-		mEngine->Draw(mFaceVisual[i]);
-	}
+	mEngine->Draw(mRoundedBoxVisuals);
 
 	mEngine->SetDefaultBlendState();
 
 	std::array<float, 4> const black{ 0.0f, 0.0f, 0.0f, 1.0f };
 	mEngine->Draw(8, mYSize - 8, black, mTimer.GetFPS());
 	mEngine->Draw(8, 24, black, mMessage);
-	mEngine->DisplayColorBuffer(0);
+	for (size_t k = 0; k < mBenchmarkLines.size(); ++k)
+	{
+		mEngine->Draw(8, 48 + 16 * static_cast<int32_t>(k), black, mBenchmarkLines[k]);
+	}
+	mEngine->DisplayColorBuffer(GetSyncInterval());
 
 	mTimer.UpdateFrameCount();
 }
@@ -158,6 +291,18 @@ bool MovingSphereBoxWindow3::OnCharPress(uint8_t key, int32_t x, int32_t y)
 	case 'S':
 		mDrawSphereVisual = !mDrawSphereVisual;
 		return true;
+
+		// Toggle the drawing of the contact points of the full sweep.
+	case 'c':
+	case 'C':
+		mDrawContactCloud = !mDrawContactCloud;
+		return true;
+
+		// Measure the throughput of the queries over the full sweep.
+	case 'p':
+	case 'P':
+		RunSweepBenchmark();
+		return true;
 	}
 
 	return Window3::OnCharPress(key, x, y);
@@ -165,6 +310,9 @@ bool MovingSphereBoxWindow3::OnCharPress(uint8_t key, int32_t x, int32_t y)
 
 void MovingSphereBoxWindow3::CreateScene()
 {
+	mPVWBuffer = PVWUpdater::CreatePVWBuffer(NUM_VISUALS);
+	mNumPVWMatrices = 0;
+
 	mBoxRoot = std::make_shared<Node>();
 	mTrackBall.Attach(mBoxRoot);
 
@@ -193,10 +341,24 @@ void MovingSphereBoxWindow3::CreateScene()
 	CreateRoundedBoxVertices();
 	CreateRoundedBoxEdges();
 	CreateRoundedBoxFaces();
+	for (auto const& visual : mVertexVisual)
+	{
+		mRoundedBoxVisuals.push_back(visual.get());
+	}
+	for (auto const& visual : mEdgeVisual)
+	{
+		mRoundedBoxVisuals.push_back(visual.get());
+	}
+	for (auto const& visual : mFaceVisual)
+	{
+		mRoundedBoxVisuals.push_back(visual.get());
+	}
 	CreateBox();
 	CreateSpheres();
 	CreateMotionCylinder();
+	CreateContactCloud();
 	UpdateSphereVelocity();
+	UpdateContactCloud();
 }
 
 void MovingSphereBoxWindow3::CreateRoundedBoxVertices()
@@ -414,11 +576,11 @@ void MovingSphereBoxWindow3::CreateRoundedBoxVertices()
 
 	for (int32_t i = 0; i < 8; ++i)
 	{
-		auto effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color[i]);
+		auto effect = CreateEffect(color[i]);
 		mVertexVisual[i] = std::make_shared<Visual>(vbuffer, ibuffer, effect);
 		mVertexVisual[i]->localTransform.SetTranslation(center[i]);
 		mVertexVisual[i]->localTransform.SetRotation(orient[i]);
-		mPVWMatrices.Subscribe(mVertexVisual[i]->worldTransform, effect->GetPVWMatrixConstant());
+		mPVWMatrices.Subscribe(mVertexVisual[i]->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 
 		mBoxRoot->AttachChild(mVertexVisual[i]);
 	}
@@ -561,12 +723,12 @@ void MovingSphereBoxWindow3::CreateRoundedBoxEdges()
 
 	for (int32_t i = 0; i < 12; ++i)
 	{
-		auto effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color[i]);
+		auto effect = CreateEffect(color[i]);
 		mEdgeVisual[i] = std::make_shared<Visual>(vbuffer, ibuffer, effect);
 		mEdgeVisual[i]->localTransform.SetTranslation(center[i]);
 		mEdgeVisual[i]->localTransform.SetRotation(orient[i]);
 		mEdgeVisual[i]->localTransform.SetScale(scale[i]);
-		mPVWMatrices.Subscribe(mEdgeVisual[i]->worldTransform, effect->GetPVWMatrixConstant());
+		mPVWMatrices.Subscribe(mEdgeVisual[i]->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 
 		mBoxRoot->AttachChild(mEdgeVisual[i]);
 	}
@@ -660,12 +822,12 @@ void MovingSphereBoxWindow3::CreateRoundedBoxFaces()
 
 	for (int32_t i = 0; i < 6; ++i)
 	{
-		auto effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color[i]);
+		auto effect = CreateEffect(color[i]);
 		mFaceVisual[i] = std::make_shared<Visual>(vbuffer, ibuffer, effect);
 		mFaceVisual[i]->localTransform.SetTranslation(center[i]);
 		mFaceVisual[i]->localTransform.SetRotation(orient[i]);
 		mFaceVisual[i]->localTransform.SetScale(scale[i]);
-		mPVWMatrices.Subscribe(mFaceVisual[i]->worldTransform, effect->GetPVWMatrixConstant());
+		mPVWMatrices.Subscribe(mFaceVisual[i]->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 
 		mBoxRoot->AttachChild(mFaceVisual[i]);
 	}
@@ -684,9 +846,9 @@ void MovingSphereBoxWindow3::CreateBox()
 	mBoxVisual = mf.CreateBox(extent[0], extent[1], extent[2]);
 #endif
 	Vector4<float> color{ 0.5f, 0.5f, 0.5f, mAlpha };
-	auto effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color);
+	auto effect = CreateEffect(color);
 	mBoxVisual->SetEffect(effect);
-	mPVWMatrices.Subscribe(mBoxVisual->worldTransform, effect->GetPVWMatrixConstant());
+	mPVWMatrices.Subscribe(mBoxVisual->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 
 	mBoxRoot->AttachChild(mBoxVisual);
 }
@@ -699,27 +861,27 @@ void MovingSphereBoxWindow3::CreateSpheres()
 	mf.SetVertexFormat(vformat);
 	mSphereVisual = mf.CreateSphere(16, 16, mSphere.radius);
 	Vector4<float> color{ 0.75f, 0.75f, 0.75f, mAlpha };
-	auto effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color);
+	auto effect = CreateEffect(color);
 	mSphereVisual->SetEffect(effect);
 	mSphereVisual->localTransform.SetTranslation(mSphere.center);
-	mPVWMatrices.Subscribe(mSphereVisual->worldTransform, effect->GetPVWMatrixConstant());
+	mPVWMatrices.Subscribe(mSphereVisual->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 	mTrackBall.Attach(mSphereVisual);
 
 	mSphereContactVisual = mf.CreateSphere(16, 16, mSphere.radius);
 	color = { 0.25f, 0.25f, 0.25f, mAlpha };
 	mSphereContactVisual->culling = CullingMode::ALWAYS;
-	effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color);
+	effect = CreateEffect(color);
 	mSphereContactVisual->SetEffect(effect);
 	mSphereContactVisual->localTransform.SetTranslation(mSphere.center);
-	mPVWMatrices.Subscribe(mSphereContactVisual->worldTransform, effect->GetPVWMatrixConstant());
+	mPVWMatrices.Subscribe(mSphereContactVisual->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 	mTrackBall.Attach(mSphereContactVisual);
 
 	mPointContactVisual = mf.CreateSphere(8, 8, mSphere.radius / 8.0f);
 	color = { 1.0f, 0.0f, 0.0f, mAlpha };
-	effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color);
+	effect = CreateEffect(color);
 	mPointContactVisual->SetEffect(effect);
 	mPointContactVisual->localTransform.SetTranslation(mSphere.center);
-	mPVWMatrices.Subscribe(mPointContactVisual->worldTransform, effect->GetPVWMatrixConstant());
+	mPVWMatrices.Subscribe(mPointContactVisual->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 	mTrackBall.Attach(mPointContactVisual);
 }
 
@@ -733,12 +895,43 @@ void MovingSphereBoxWindow3::CreateMotionCylinder()
 	vertices[1] = { 0.0f, 0.0f, 1000.0f };
 	auto ibuffer = std::make_shared<IndexBuffer>(IP_POLYSEGMENT_DISJOINT, 1);
 	Vector4<float> color{ 0.0f, 1.0f, 0.0f, mAlpha };
-	auto effect = std::make_shared<ConstantColorEffect>(mProgramFactory, color);
+	auto effect = CreateEffect(color);
 	mVelocityVisual = std::make_shared<Visual>(vbuffer, ibuffer, effect);
-	mPVWMatrices.Subscribe(mVelocityVisual->worldTransform, effect->GetPVWMatrixConstant());
+	mPVWMatrices.Subscribe(mVelocityVisual->worldTransform, mPVWBuffer, effect->GetPVWIndex());
 	mTrackBall.Attach(mVelocityVisual);
 }
 
+void MovingSphereBoxWindow3::CreateContactCloud()
+{
+	// The contact points are instances of a small sphere. The instance
+	// matrices are relative to the trackball node, so the visual has the
+	// identity transform, and it must not be culled.
+	VertexFormat vformat;
+	vformat.Bind(VASemantic::POSITION, DF_R32G32B32_FLOAT, 0);
+	vformat.Bind(VASemantic::TEXCOORD, DF_R32G32_FLOAT, 0);
+	MeshFactory mf;
+	mf.SetVertexFormat(vformat);
+	mContactCloud = mf.CreateSphere(6, 6, mSphere.radius / 16.0f);
+
+	auto texture = std::make_shared<Texture2>(DF_R8G8B8A8_UNORM, 1, 1);
+	*texture->Get<uint32_t>() = 0xFF0080FF;
+	uint32_t const numDirections = static_cast<uint32_t>(mNumSamples0 * mNumSamples1);
+	mContactCloudEffect = std::make_shared<InstancedTexture2Effect>(mProgramFactory, texture,
+		SamplerState::Filter::MIN_P_MAG_P_MIP_P, SamplerState::Mode::CLAMP,
+		SamplerState::Mode::CLAMP, numDirections);
+	mContactCloud->SetEffect(mContactCloudEffect);
+	mContactCloud->culling = CullingMode::NEVER;
+	mPVWMatrices.Subscribe(mContactCloud->worldTransform, mContactCloudEffect->GetPVWMatrixConstant());
+	mTrackBall.Attach(mContactCloud);
+}
+
+std::shared_ptr<ConstantColorEffect> MovingSphereBoxWindow3::CreateEffect(Vector4<float> const& color)
+{
+	LogAssert(mNumPVWMatrices < NUM_VISUALS, "Too many visuals for the PVW buffer.");
+	return std::make_shared<ConstantColorEffect>(mProgramFactory, color, mPVWBuffer,
+		mNumPVWMatrices++);
+}
+
 void MovingSphereBoxWindow3::UpdateSphereVelocity()
 {
 	float angle0 = static_cast<float>(mSample0 * GTE_C_TWO_PI / mNumSamples0);
@@ -795,5 +988,117 @@ void MovingSphereBoxWindow3::UpdateSphereCenter()
 {
 	mSphereVisual->localTransform.SetTranslation(mSphere.center);
 	mSphereVisual->Update();
+	UpdateContactCloud();
 	UpdateSphereVelocity();
-}
\ No newline at end of file
+}
+
+void MovingSphereBoxWindow3::GetSweepFrame(AlignedBox3<float>& box, Vector3<float>& boxVelocity,
+	Sphere3<float>& sphere, Vector3<float>& origin, std::array<Vector3<float>, 3>& axis) const
+{
+#if defined(APP_USE_OBB)
+	origin = mBox.center;
+	axis = mBox.axis;
+	box.min = -mBox.extent;
+	box.max = mBox.extent;
+#else
+	origin = { 0.0f, 0.0f, 0.0f };
+	axis[0] = { 1.0f, 0.0f, 0.0f };
+	axis[1] = { 0.0f, 1.0f, 0.0f };
+	axis[2] = { 0.0f, 0.0f, 1.0f };
+	box = mBox;
+#endif
+	Vector3<float> diff = mSphere.center - origin;
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		boxVelocity[d] = Dot(mBoxVelocity, axis[d]);
+		sphere.center[d] = Dot(diff, axis[d]);
+	}
+	sphere.radius = mSphere.radius;
+}
+
+void MovingSphereBoxWindow3::UpdateContactCloud()
+{
+	AlignedBox3<float> box{};
+	Vector3<float> boxVelocity{}, origin{};
+	Sphere3<float> sphere{};
+	std::array<Vector3<float>, 3> axis{};
+	GetSweepFrame(box, boxVelocity, sphere, origin, axis);
+
+	DirectionSweep<float> sweep{};
+	CreateSweep(box, boxVelocity, sphere, axis, mNumSamples0, mNumSamples1, sweep);
+	FIQuery<float, AlignedBox3<float>, SphereArray3<float>> query{};
+	auto result = query(sweep.box, sweep.boxVelocity, sweep.spheres, sweep.velocity);
+
+	auto const& instances = mContactCloudEffect->GetInstanceBuffer();
+	auto world = instances->Get<Matrix4x4<float>>();
+	Transform<float> transform{};
+	uint32_t numInstances = 0;
+	for (size_t j = 0; j < result.intersectionType.size(); ++j)
+	{
+		if (result.intersectionType[j] != 0)
+		{
+			Vector3<float> P = origin;
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				P += result.contactPoint[d][j] * axis[d];
+			}
+			transform.SetTranslation(P);
+			world[numInstances++] = transform.GetHMatrix();
+		}
+	}
+
+	if (numInstances > 0)
+	{
+		instances->SetNumActiveElements(numInstances);
+		mContactCloud->GetIndexBuffer()->SetNumInstances(numInstances);
+		mEngine->Update(instances);
+		mContactCloud->culling = CullingMode::NEVER;
+	}
+	else
+	{
+		mContactCloud->culling = CullingMode::ALWAYS;
+	}
+}
+
+void MovingSphereBoxWindow3::RunSweepBenchmark()
+{
+	AlignedBox3<float> box{};
+	Vector3<float> boxVelocity{}, origin{};
+	Sphere3<float> sphere{};
+	std::array<Vector3<float>, 3> axis{};
+	GetSweepFrame(box, boxVelocity, sphere, origin, axis);
+
+	DirectionSweep<float> sweepFloat{};
+	DirectionSweep<double> sweepDouble{};
+	CreateSweep(box, boxVelocity, sphere, axis, mNumSamples0, mNumSamples1, sweepFloat);
+	CreateSweep(box, boxVelocity, sphere, axis, mNumSamples0, mNumSamples1, sweepDouble);
+
+	size_t const numRepeats = 64;
+	size_t const maxThreads = std::max(static_cast<size_t>(std::thread::hardware_concurrency()),
+		static_cast<size_t>(1));
+	std::vector<size_t> threadCounts = { 1 };
+	if (maxThreads > 1)
+	{
+		threadCounts.push_back(maxThreads);
+	}
+
+	mBenchmarkLines.clear();
+	char line[128];
+	for (auto numThreads : threadCounts)
+	{
+		for (int32_t path = 0; path < 2; ++path)
+		{
+			bool const batched = (path == 1);
+			size_t numFloatContacts = 0, numDoubleContacts = 0;
+			double const floatRate = MeasureSweep(sweepFloat, batched, numThreads,
+				numRepeats, numFloatContacts);
+			double const doubleRate = MeasureSweep(sweepDouble, batched, numThreads,
+				numRepeats, numDoubleContacts);
+			std::snprintf(line, sizeof(line),
+				"%s, %zu thread(s): float %.2f Mq/s, double %.2f Mq/s, contacts %zu/%zu",
+				(batched ? "batch " : "scalar"), numThreads, floatRate * 1e-6,
+				doubleRate * 1e-6, numFloatContacts, numDoubleContacts);
+			mBenchmarkLines.push_back(line);
+		}
+	}
+}
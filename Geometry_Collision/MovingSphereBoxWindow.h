@@ -1,10 +1,16 @@
 #pragma once
 
 #include "Applications/Window3.h"
+#include "ConstantColorEffect.h"
+#include "InstancedTexture2Effect.h"
 #include "IntrAlignedBoxSphere.h"
+#include "IntrAlignedBoxSphereBatch.h"
 #include "IntrOrientedBoxShere.h"
+#include <array>
 #include <memory>
+#include <string>
 #include <utility>
+#include <vector>
 
 using namespace Vector_GM;
 
@@ -12,6 +18,16 @@ using namespace Vector_GM;
 // Uncomment this to test the query for oriented box and sphere.
 //#define APP_USE_OBB
 
+// The keys 'a', 'A', 'b' and 'B' step the velocity of the sphere through a
+// grid of mNumSamples0*mNumSamples1 directions. The full sweep of the grid
+// is queried in the coordinate system of the box, where the box is axis
+// aligned, with the batched FIQuery of IntrAlignedBoxSphereBatch.h. Its
+// contact points are drawn as one instanced point cloud, toggled with 'c'.
+// The key 'p' runs the sweep benchmark, which reports the queries per
+// second of the single (scalar) query and of the batched query, whose
+// ray-box rejection test is vectorized, for float and double on one thread
+// and on all hardware threads.
+
 class MovingSphereBoxWindow3 : public Window3
 {
 public:
@@ -21,7 +37,9 @@ public:
 	virtual bool OnCharPress(uint8_t key, int32_t x, int32_t y) override;
 
 private:
-	enum { DENSITY = 32 };
+	// The 8 vertex, 12 edge and 6 face visuals of the rounded box, the box,
+	// the 3 spheres and the motion cylinder.
+	enum { DENSITY = 32, NUM_VISUALS = 31 };
 	void CreateScene();
 	void CreateRoundedBoxVertices();
 	void CreateRoundedBoxEdges();
@@ -29,13 +47,31 @@ private:
 	void CreateBox();
 	void CreateSpheres();
 	void CreateMotionCylinder();
+	void CreateContactCloud();
+
+	// Create an effect whose PVW matrix is the next element of mPVWBuffer.
+	std::shared_ptr<ConstantColorEffect> CreateEffect(Vector4<float> const& color);
 	void UpdateSphereVelocity();
 	void UpdateSphereCenter();
 
+	// The box, sphere and box velocity of the sweep, in the coordinate
+	// system with the given origin and axes in which the box is axis
+	// aligned.
+	void GetSweepFrame(AlignedBox3<float>& box, Vector3<float>& boxVelocity,
+		Sphere3<float>& sphere, Vector3<float>& origin,
+		std::array<Vector3<float>, 3>& axis) const;
+	void UpdateContactCloud();
+	void RunSweepBenchmark();
+
 	std::shared_ptr<BlendState> mBlendState;
 	std::shared_ptr<RasterizerState> mNoCullState;
 	float mAlpha;
 
+	// The PVW matrices of all visuals, updated by mPVWMatrices with one
+	// copy to GPU memory per camera change.
+	std::shared_ptr<StructuredBuffer> mPVWBuffer;
+	uint32_t mNumPVWMatrices;
+
 	// Octants of spheres for the rounded box corners.
 	std::array<std::shared_ptr<Visual>, 8> mVertexVisual;
 	std::array<Vector3<float>, 8> mVNormal;
@@ -48,6 +84,10 @@ private:
 	std::array<std::shared_ptr<Visual>, 6> mFaceVisual;
 	std::array<Vector3<float>, 6> mFNormal;
 
+	// The vertex, edge and face visuals in drawing order. They are drawn
+	// with one call so that the engine binds their shared buffers once.
+	std::vector<Visual*> mRoundedBoxVisuals;
+
 	// The visual representation of mBox.
 	std::shared_ptr<Visual> mBoxVisual;
 
@@ -64,6 +104,11 @@ private:
 	// The contact point representation.
 	std::shared_ptr<Visual> mPointContactVisual;
 
+	// The contact points of the full sweep, instances of a small sphere.
+	std::shared_ptr<Visual> mContactCloud;
+	std::shared_ptr<InstancedTexture2Effect> mContactCloudEffect;
+	bool mDrawContactCloud;
+
 #if defined(APP_USE_OBB)
 	OrientedBox3<float> mBox;
 	FIQuery<float, OrientedBox3<float>, Sphere3<float>> mQuery;
@@ -77,5 +122,6 @@ private:
 	int32_t mNumSamples0, mNumSamples1, mSample0, mSample1;
 	float mDX, mDY, mDZ;
 	std::string mMessage;
+	std::vector<std::string> mBenchmarkLines;
 	bool mDrawSphereVisual;
 };
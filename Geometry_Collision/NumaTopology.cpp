@@ -0,0 +1,135 @@
+#include "NumaTopology.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+NumaTopology::NumaTopology()
+	:
+	mNumNodes(1),
+	mProcessors{}
+{
+#if defined(_WIN32)
+	ULONG highestNode = 0;
+	if (GetNumaHighestNodeNumber(&highestNode))
+	{
+		mNumNodes = static_cast<size_t>(highestNode) + 1;
+	}
+#elif defined(__linux__)
+	// The file cpulist of a node is a comma-separated list of processor
+	// numbers and ranges, for example "0-7,16-23". The nodes are numbered
+	// consecutively from 0.
+	for (size_t node = 0; ; ++node)
+	{
+		std::string const name = "/sys/devices/system/node/node" +
+			std::to_string(node) + "/cpulist";
+		FILE* file = std::fopen(name.c_str(), "r");
+		if (!file)
+		{
+			break;
+		}
+
+		std::vector<int> processors;
+		int first = 0, last = 0;
+		while (std::fscanf(file, "%d", &first) == 1)
+		{
+			last = first;
+			int c = std::fgetc(file);
+			if (c == '-')
+			{
+				if (std::fscanf(file, "%d", &last) != 1)
+				{
+					break;
+				}
+				c = std::fgetc(file);
+			}
+			for (int p = first; p <= last; ++p)
+			{
+				processors.push_back(p);
+			}
+			if (c != ',')
+			{
+				break;
+			}
+		}
+		std::fclose(file);
+		mProcessors.push_back(processors);
+	}
+
+	if (mProcessors.size() > 0)
+	{
+		mNumNodes = mProcessors.size();
+	}
+#endif
+}
+
+bool NumaTopology::PinThread(size_t node) const
+{
+	if (node >= mNumNodes)
+	{
+		return false;
+	}
+
+#if defined(_WIN32)
+	GROUP_AFFINITY affinity{};
+	if (!GetNumaNodeProcessorMaskEx(static_cast<USHORT>(node), &affinity) ||
+		affinity.Mask == 0)
+	{
+		return false;
+	}
+	return SetThreadGroupAffinity(GetCurrentThread(), &affinity, nullptr) != 0;
+#elif defined(__linux__)
+	if (node >= mProcessors.size() || mProcessors[node].empty())
+	{
+		return false;
+	}
+
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	for (int p : mProcessors[node])
+	{
+		if (p >= 0 && p < CPU_SETSIZE)
+		{
+			CPU_SET(p, &set);
+		}
+	}
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	return false;
+#endif
+}
+
+void NumaTopology::DiscardPages(void* data, size_t numBytes)
+{
+#if defined(__linux__)
+	long const pageSize = sysconf(_SC_PAGESIZE);
+	if (pageSize <= 0 || !data)
+	{
+		return;
+	}
+
+	uintptr_t const size = static_cast<uintptr_t>(pageSize);
+	uintptr_t const begin = reinterpret_cast<uintptr_t>(data);
+	uintptr_t const end = begin + numBytes;
+	uintptr_t const first = (begin + size - 1) / size * size;
+	uintptr_t const last = end / size * size;
+	if (first < last)
+	{
+		madvise(reinterpret_cast<void*>(first), last - first, MADV_DONTNEED);
+	}
+#else
+	(void)data;
+	(void)numBytes;
+#endif
+}
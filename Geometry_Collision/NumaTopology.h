@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// The NUMA nodes of the machine and the placement of threads and memory on
+// them. On Linux the nodes and their processors are read from
+// /sys/devices/system/node, on Windows they are queried with
+// GetNumaHighestNodeNumber and GetNumaNodeProcessorMaskEx. On other
+// platforms, or when the query fails, the machine has a single node and
+// threads are not pinned.
+//
+// The operating systems allocate a page of memory on the node of the
+// thread that first writes it (first-touch), so data written by threads
+// pinned to a node is local to that node.
+
+class NumaTopology
+{
+public:
+	// Query the nodes of the machine.
+	NumaTopology();
+
+	inline size_t GetNumNodes() const
+	{
+		return mNumNodes;
+	}
+
+	// Restrict the calling thread to the processors of the node. Returns
+	// false when the thread was not pinned, for example when the node has
+	// no processors or the platform does not support it.
+	bool PinThread(size_t node) const;
+
+	// Return the whole pages in [data, data + numBytes) to the operating
+	// system, so that the next write to each page allocates it again on the
+	// node of the writing thread. The contents of these pages are lost and
+	// must be written before they are read. The partial pages at the ends
+	// are kept. This is supported on Linux only and does nothing elsewhere.
+	static void DiscardPages(void* data, size_t numBytes);
+
+private:
+	size_t mNumNodes;
+
+	// The processors of each node on Linux.
+	std::vector<std::vector<int>> mProcessors;
+};
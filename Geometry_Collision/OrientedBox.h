@@ -16,26 +16,26 @@
 
 namespace Vector_GM
 {
-	template <int32_t N, typename T>
+	template <typename T, size_t N>
 	class OrientedBox
 	{
 	public:
 		// Construction and destruction.  The default constructor sets the
-		// center to (0,...,0), axis d to Vector<N,T>::Unit(d) and
+		// center to (0,...,0), axis d to the basis vector e[d] and
 		// extent d to +1.
 		OrientedBox()
 		{
-			center.MakeZero();
-			for (int32_t i = 0; i < N; ++i)
+			MakeZero(center);
+			for (size_t i = 0; i < N; ++i)
 			{
-				axis[i].MakeUnit(i);
+				MakeBasis(i, axis[i]);
 				extent[i] = (T)1;
 			}
 		}
 
-		OrientedBox(Vector<N, T> const& inCenter,
-			std::array<Vector<N, T>, N> const& inAxis,
-			Vector<N, T> const& inExtent)
+		OrientedBox(Vector<T, N> const& inCenter,
+			std::array<Vector<T, N>, N> const& inAxis,
+			Vector<T, N> const& inExtent)
 			:
 			center(inCenter),
 			axis(inAxis),
@@ -47,19 +47,19 @@ namespace Vector_GM
 		// i = b[N-1]...b[0], then
 		// vertex[i] = center + sum_{d=0}^{N-1} sign[d] * extent[d] * axis[d]
 		// where sign[d] = 2*b[d] - 1.
-		void GetVertices(std::array<Vector<N, T>, (1 << N)>& vertex) const
+		void GetVertices(std::array<Vector<T, N>, (size_t(1) << N)>& vertex) const
 		{
-			std::array<Vector<N, T>, N> product;
-			for (int32_t d = 0; d < N; ++d)
+			std::array<Vector<T, N>, N> product;
+			for (size_t d = 0; d < N; ++d)
 			{
 				product[d] = extent[d] * axis[d];
 			}
 
-			int32_t const imax = (1 << N);
-			for (int32_t i = 0; i < imax; ++i)
+			size_t const imax = (size_t(1) << N);
+			for (size_t i = 0; i < imax; ++i)
 			{
 				vertex[i] = center;
-				for (int32_t d = 0, mask = 1; d < N; ++d, mask <<= 1)
+				for (size_t d = 0, mask = 1; d < N; ++d, mask <<= 1)
 				{
 					if ((i & mask) > 0)
 					{
@@ -74,9 +74,9 @@ namespace Vector_GM
 		}
 
 		// Public member access.  It is required that extent[i] >= 0.
-		Vector<N, T> center;
-		std::array<Vector<N, T>, N> axis;
-		Vector<N, T> extent;
+		Vector<T, N> center;
+		std::array<Vector<T, N>, N> axis;
+		Vector<T, N> extent;
 
 	public:
 		// Comparisons to support sorted containers.
@@ -133,8 +133,8 @@ namespace Vector_GM
 
 	// Template aliases for convenience.
 	template <typename T>
-	using OrientedBox2 = OrientedBox<2, T>;
+	using OrientedBox2 = OrientedBox<T, 2>;
 
 	template <typename T>
-	using OrientedBox3 = OrientedBox<3, T>;
+	using OrientedBox3 = OrientedBox<T, 3>;
 }
\ No newline at end of file
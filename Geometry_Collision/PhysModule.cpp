@@ -1,270 +1,4286 @@
 #include "PhysModule.h"
 #include "LinearSystem.h"
+#include "CycleProfiler.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <type_traits>
 
-PhysicsModule::PhysicsModule(size_t numSpheres, double xMin, double xMax,
-	double yMin, double yMax, double zMin, double zMax)
+namespace
+{
+	// Component k of the Runge-Kutta combination
+	// S1 = S0 + (DT/6)*(A1+2*(A2+A3)+A4). The sum is evaluated in double and
+	// rounded to Real once, so a float state does not lose the small
+	// per-tick increments to four intermediate roundings.
+	template <typename Real>
+	inline Real CombineStages(Real s0, double sixthDT, Real a1, Real a2, Real a3, Real a4)
+	{
+		double const sum = static_cast<double>(a1) +
+			2.0 * (static_cast<double>(a2) + static_cast<double>(a3)) +
+			static_cast<double>(a4);
+		return static_cast<Real>(static_cast<double>(s0) + sixthDT * sum);
+	}
+
+	// The floor friction of GetForce and GetTorque opposes the sliding and
+	// the spin with a force and a torque of constant magnitude. A method
+	// with one evaluation per (half) step reverses a motion that stops
+	// within the step, which adds energy, so the motion is stopped
+	// instead. Gravity has no horizontal component and the torque is the
+	// friction only, so a reversal of the horizontal momentum or of the
+	// angular momentum is due to the friction.
+	template <typename Real>
+	inline void StopReversedFriction(Vector3<Real> const& P0, Vector3<Real> const& L0,
+		Vector3<Real>& P, Vector3<Real>& L)
+	{
+		if (P[0] * P0[0] + P[1] * P0[1] < static_cast<Real>(0))
+		{
+			P[0] = static_cast<Real>(0);
+			P[1] = static_cast<Real>(0);
+		}
+		if (Dot(L, L0) < static_cast<Real>(0))
+		{
+			L = { static_cast<Real>(0), static_cast<Real>(0), static_cast<Real>(0) };
+		}
+	}
+
+	// The instrumentation of DoTick. A ScopedTimer adds the wall-clock
+	// time of its scope, measured with the CycleClock ticks, to a
+	// TickStatistics time and AddCount adds to a TickStatistics counter.
+	// Both do nothing when the statistics are compiled out.
+#if defined(PHYSICS_MODULE_NO_STATISTICS)
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(int64_t&)
+		{
+		}
+	};
+
+	inline void AddCount(size_t&, size_t)
+	{
+	}
+#else
+	class ScopedTimer
+	{
+	public:
+		ScopedTimer(int64_t& nanoseconds)
+			:
+			mNanoseconds(nanoseconds),
+			mStart(CycleClock::Now())
+		{
+		}
+
+		~ScopedTimer()
+		{
+			mNanoseconds += CycleClock::ToNanoseconds(CycleClock::Now() - mStart);
+		}
+
+	private:
+		int64_t& mNanoseconds;
+		uint64_t mStart;
+	};
+
+	inline void AddCount(size_t& counter, size_t increment)
+	{
+		counter += increment;
+	}
+#endif
+
+	// A snapshot is the header, the largest sphere radius and the arrays in
+	// the order of PhysicsModule<Real>::SaveSnapshot. The version must be
+	// incremented whenever the layout changes.
+	uint32_t constexpr SnapshotMagic = 0x50485953;  // 'PHYS'
+	uint32_t constexpr SnapshotVersion = 3;
+
+	struct SnapshotHeader
+	{
+		uint32_t magic, version, realSize, numColliders;
+		uint64_t numSpheres, numHandles, numFreeHandles, numManifolds;
+	};
+
+	template <typename T>
+	inline void WriteSnapshot(T const* data, size_t count, uint8_t*& target)
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"Snapshot arrays must be trivially copyable.");
+		size_t const numBytes = count * sizeof(T);
+		if (numBytes > 0)
+		{
+			std::memcpy(target, data, numBytes);
+			target += numBytes;
+		}
+	}
+
+	template <typename T>
+	inline void ReadSnapshot(uint8_t const*& source, size_t count, std::vector<T>& data)
+	{
+		static_assert(std::is_trivially_copyable<T>::value,
+			"Snapshot arrays must be trivially copyable.");
+		size_t const numBytes = count * sizeof(T);
+		data.resize(count);
+		if (numBytes > 0)
+		{
+			std::memcpy(data.data(), source, numBytes);
+			source += numBytes;
+		}
+	}
+}
+
+template <typename Real>
+PhysicsModule<Real>::PhysicsModule(size_t numSpheres, Real xMin, Real xMax,
+	Real yMin, Real yMax, Real zMin, Real zMax)
 	:
-	mRigidSphere(numSpheres),
+	mSpheres{},
+	mHandleToIndex(numSpheres),
+	mIndexToHandle(numSpheres),
+	mFreeHandles{},
 	mRigidPlane{},
+	mPlaneOpen{},
+	mPlaneMin{ xMin, yMin, zMin },
+	mPlaneMax{ xMax, yMax, zMax },
+	mColliders{},
+	mMeshes{},
 	mContacts{},
-	mRestitution(0.8)  // selected arbitrarily
+	mRestitution(static_cast<Real>(0.8)),  // selected arbitrarily
+	mRegionMin{ xMin, yMin, zMin },
+	mRegionMax{ xMax, yMax, zMax },
+	mMaxRadius(0.0),
+	mBroadphase(Broadphase::BRUTE_FORCE),
+	mActiveBroadphase(Broadphase::BRUTE_FORCE),
+	mGrid{},
+	mGridDirty(true),
+	mHierarchicalGrid{},
+	mPairs{},
+	mNumCandidatePairs(0),
+	mBoxes{},
+	mBoxManager{},
+	mTree{},
+	mTreeProxies{},
+	mTreeMargin(static_cast<Real>(0.1)),
+	mTreeDeltaTime(0.0),
+	mIntegrator(Integrator::SCALAR),
+	mIntegrationMethod(IntegrationMethod::RUNGE_KUTTA),
+	mAdaptiveMaxAngle(static_cast<Real>(0.1)),
+	mAdaptiveMaxLevel(6),
+	mStepLevels{},
+	mLevelSpheres{},
+	mLevelStarts{},
+	mNumThreads(0),
+	mBounds{},
+	mThreadContacts{},
+	mThreadPairs{},
+	mThreadNumTests{},
+	mOverlaps{},
+	mTeam{},
+	mNumaNodes(0),
+	mTopology{},
+	mChunkStarts{},
+	mPairStarts{},
+	mPartitionPairs{},
+	mSleepTicks(0),
+	mSleepLinearSpeed(0.0),
+	mSleepAngularSpeed(0.0),
+	mAwake(numSpheres, 1),
+	mSleepCounter(numSpheres, 0),
+	mIslandNext(numSpheres),
+	mIslandParent{},
+	mIslandMinCounter{},
+	mIslandLast{},
+	mTickStatistics{},
+	mSolver(Solver::SINGLE_PASS),
+	mSolverMaxIterations(10),
+	mSolverTolerance(static_cast<Real>(1e-06)),
+	mSolverFriction(0.5),
+	mSolverNumIterations(0),
+	mSolverContacts{},
+	mManifolds{},
+	mNewManifolds{},
+	mContactPersistence(4),
+	mContactMatchDistance(static_cast<Real>(0.25)),
+	mNumWarmStartedContacts(0),
+	mLCPMaxContacts(64),
+	mNumContactIslands(0),
+	mNumFallbackIslands(0),
+	mContactIslands{},
+	mIslandOfRoot{},
+	mContactBodies{},
+	mColorMasks{},
+	mContactColors{},
+	mColorStarts{},
+	mColorContacts{},
+	mNumContactColors(0),
+	mThreadMaxDelta{},
+	mSolverLanes{},
+	mColorBatches{},
+	mContinuousCollision(false),
+	mNumSweptContacts(0),
+	mSweepStart{},
+	mFast{},
+	mFastSpheres{},
+	mFastOrder{},
+	mSweepOrder{},
+	mSweptCandidates{},
+	mSweptContacts{}
+{
+	mSpheres.Resize(numSpheres);
+
+	// Each sphere has at most three plane contacts per tick. Reserving
+	// them up front means that the plane contacts never reallocate and the
+	// sphere-sphere contacts reallocate only until the storage reaches its
+	// high-water mark.
+	mContacts.reserve(3 * numSpheres);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		mIslandNext[i] = i;
+		mHandleToIndex[i] = i;
+		mIndexToHandle[i] = i;
+	}
+
+	// Create the immovable planes.
+	mRigidPlane[0] = std::make_shared<RigidPlane<Real>>(Plane3<Real>({ +1.0,  0.0,  0.0 }, +xMin));
+	mRigidPlane[1] = std::make_shared<RigidPlane<Real>>(Plane3<Real>({ 0.0, +1.0,  0.0 }, +yMin));
+	mRigidPlane[2] = std::make_shared<RigidPlane<Real>>(Plane3<Real>({ 0.0,  0.0, +1.0 }, +zMin));
+	mRigidPlane[3] = std::make_shared<RigidPlane<Real>>(Plane3<Real>({ -1.0,  0.0,  0.0 }, -xMax));
+	mRigidPlane[4] = std::make_shared<RigidPlane<Real>>(Plane3<Real>({ 0.0, -1.0,  0.0 }, -yMax));
+	mRigidPlane[5] = std::make_shared<RigidPlane<Real>>(Plane3<Real>({ 0.0,  0.0, -1.0 }, -zMax));
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetPlaneOpen(size_t i, bool open)
+{
+	LogAssert(i < 6, "Invalid plane index.");
+	Real const maxReal = std::numeric_limits<Real>::max();
+	size_t const d = i % 3;
+	mPlaneOpen[i] = (open ? 1 : 0);
+	if (i < 3)
+	{
+		mPlaneMin[d] = (open ? -maxReal : mRegionMin[d]);
+	}
+	else
+	{
+		mPlaneMax[d] = (open ? maxReal : mRegionMax[d]);
+	}
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::AddStaticCollider(
+	std::shared_ptr<RigidDistanceField<Real>> const& collider)
+{
+	LogAssert(collider != nullptr, "Invalid collider.");
+	mColliders.push_back(collider);
+	return mColliders.size() - 1;
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::AddStaticMesh(std::shared_ptr<RigidMesh<Real>> const& mesh)
+{
+	LogAssert(mesh != nullptr, "Invalid mesh.");
+	mMeshes.push_back(mesh);
+	return mMeshes.size() - 1;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::InitializeSphere(size_t i, Real radius, Real massDensity,
+	Vector3<Real> const& center, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	// This sets the constant quantities, the initial linear and angular
+	// momenta and the initial orientation.
+	WakeIsland(i);
+	mSpheres.Initialize(i, radius, massDensity, center, linearVelocity,
+		qOrientation, angularVelocity);
+	OnBodyInitialized(i);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::InitializeCapsule(size_t i, Real radius, Real halfLength,
+	Real massDensity, Vector3<Real> const& center, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	WakeIsland(i);
+	mSpheres.InitializeCapsule(i, radius, halfLength, massDensity, center,
+		linearVelocity, qOrientation, angularVelocity);
+	OnBodyInitialized(i);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::InitializeBox(size_t i, Vector3<Real> const& extent,
+	Real massDensity, Vector3<Real> const& center, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	WakeIsland(i);
+	mSpheres.InitializeBox(i, extent, massDensity, center, linearVelocity,
+		qOrientation, angularVelocity);
+	OnBodyInitialized(i);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::OnBodyInitialized(size_t i)
+{
+	// The uniform grid is sized by the largest bounding radius.
+	if (mSpheres.radius[i] > mMaxRadius)
+	{
+		mMaxRadius = mSpheres.radius[i];
+		mGridDirty = true;
+	}
+	mBoxManager = nullptr;
+	mTreeProxies.clear();
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::AddSphere(Real radius, Real massDensity,
+	Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	size_t const handle = AppendBody();
+	InitializeSphere(mSpheres.GetNumSpheres() - 1, radius, massDensity, position,
+		linearVelocity, qOrientation, angularVelocity);
+	return handle;
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::AddCapsule(Real radius, Real halfLength, Real massDensity,
+	Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	size_t const handle = AppendBody();
+	InitializeCapsule(mSpheres.GetNumSpheres() - 1, radius, halfLength, massDensity,
+		position, linearVelocity, qOrientation, angularVelocity);
+	return handle;
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::AddBox(Vector3<Real> const& extent, Real massDensity,
+	Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	size_t const handle = AppendBody();
+	InitializeBox(mSpheres.GetNumSpheres() - 1, extent, massDensity, position,
+		linearVelocity, qOrientation, angularVelocity);
+	return handle;
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::AppendBody()
+{
+	size_t const i = mSpheres.Append();
+	mAwake.push_back(1);
+	mSleepCounter.push_back(0);
+	mIslandNext.push_back(i);
+	RemapPlaneKeys(i, i + 1);
+
+	size_t handle = mHandleToIndex.size();
+	if (mFreeHandles.empty())
+	{
+		mHandleToIndex.push_back(i);
+	}
+	else
+	{
+		handle = mFreeHandles.back();
+		mFreeHandles.pop_back();
+		mHandleToIndex[handle] = i;
+	}
+	mIndexToHandle.push_back(handle);
+	return handle;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::RemoveSphere(size_t handle)
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	size_t const i = mHandleToIndex[handle];
+	size_t const last = numSpheres - 1;
+
+	// Awake spheres link to themselves, so after waking both islands the
+	// island links need no renumbering.
+	WakeIsland(i);
+	WakeIsland(last);
+	mSpheres.SwapRemove(i);
+	mAwake.pop_back();
+	mSleepCounter.pop_back();
+	mIslandNext.pop_back();
+
+	// The sphere-sphere manifolds that refer to the removed or the moved
+	// sphere are discarded. The remaining manifolds stay sorted, because
+	// the plane keys, which are larger than the sphere keys, all decrease
+	// by one.
+	mManifolds.erase(std::remove_if(mManifolds.begin(), mManifolds.end(),
+		[i, last, numSpheres](ContactManifold const& manifold)
+		{
+			return manifold.a == i || manifold.a == last ||
+				(manifold.key < numSpheres && (manifold.key == i || manifold.key == last));
+		}), mManifolds.end());
+	RemapPlaneKeys(numSpheres, last);
+
+	size_t const movedHandle = mIndexToHandle[last];
+	mIndexToHandle[i] = movedHandle;
+	mHandleToIndex[movedHandle] = i;
+	mIndexToHandle.pop_back();
+	mHandleToIndex[handle] = InvalidIndex;
+	mFreeHandles.push_back(handle);
+
+	mBoxManager = nullptr;
+	mTreeProxies.clear();
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GetSphereState(size_t i, SphereState& state) const
+{
+	state.radius = mSpheres.shapeRadius[i];
+	state.massDensity = mSpheres.massDensity[i];
+	state.shape = mSpheres.shape[i];
+	state.extent = mSpheres.extent[i];
+	state.position = mSpheres.position[i];
+	state.qOrientation = mSpheres.qOrientation[i];
+	state.linearMomentum = mSpheres.linearMomentum[i];
+	state.angularMomentum = mSpheres.angularMomentum[i];
+}
+
+template <typename Real>
+void PhysicsModule<Real>::AddSpheres(std::vector<SphereState> const& states,
+	std::vector<size_t>& handles)
+{
+	size_t const oldNumSpheres = mSpheres.GetNumSpheres();
+	size_t const newNumSpheres = oldNumSpheres + states.size();
+	RemapPlaneKeys(oldNumSpheres, newNumSpheres);
+	handles.resize(states.size());
+	for (size_t k = 0; k < states.size(); ++k)
+	{
+		auto const& state = states[k];
+		size_t const i = mSpheres.Append();
+		mAwake.push_back(1);
+		mSleepCounter.push_back(0);
+		mIslandNext.push_back(i);
+
+		size_t handle = mHandleToIndex.size();
+		if (mFreeHandles.empty())
+		{
+			mHandleToIndex.push_back(i);
+		}
+		else
+		{
+			handle = mFreeHandles.back();
+			mFreeHandles.pop_back();
+			mHandleToIndex[handle] = i;
+		}
+		mIndexToHandle.push_back(handle);
+		handles[k] = handle;
+
+		Vector3<Real> const zero = Vector3<Real>::Zero();
+		if (state.shape == RigidSphereStore<Real>::CAPSULE)
+		{
+			mSpheres.InitializeCapsule(i, state.radius, state.extent[2],
+				state.massDensity, state.position, zero, state.qOrientation, zero);
+		}
+		else if (state.shape == RigidSphereStore<Real>::BOX)
+		{
+			mSpheres.InitializeBox(i, state.extent, state.massDensity,
+				state.position, zero, state.qOrientation, zero);
+		}
+		else
+		{
+			mSpheres.Initialize(i, state.radius, state.massDensity,
+				state.position, zero, state.qOrientation, zero);
+		}
+		mSpheres.SetLinearMomentum(i, state.linearMomentum);
+		mSpheres.SetAngularMomentum(i, state.angularMomentum);
+		if (mSpheres.radius[i] > mMaxRadius)
+		{
+			mMaxRadius = mSpheres.radius[i];
+			mGridDirty = true;
+		}
+	}
+
+	if (!states.empty())
+	{
+		mBoxManager = nullptr;
+		mTreeProxies.clear();
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::RemoveLastSpheres(size_t first)
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	if (first >= numSpheres)
+	{
+		return;
+	}
+
+	// A sleeping island can contain spheres on both sides of first, so
+	// the islands are woken before the links are removed.
+	for (size_t i = first; i < numSpheres; ++i)
+	{
+		WakeIsland(i);
+	}
+
+	for (size_t i = numSpheres; i > first; --i)
+	{
+		size_t const handle = mIndexToHandle[i - 1];
+		mSpheres.SwapRemove(i - 1);
+		mHandleToIndex[handle] = InvalidIndex;
+		mFreeHandles.push_back(handle);
+	}
+	mAwake.resize(first);
+	mSleepCounter.resize(first);
+	mIslandNext.resize(first);
+	mIndexToHandle.resize(first);
+
+	mManifolds.erase(std::remove_if(mManifolds.begin(), mManifolds.end(),
+		[first, numSpheres](ContactManifold const& manifold)
+		{
+			return manifold.a >= first ||
+				(manifold.key < numSpheres && manifold.key >= first);
+		}), mManifolds.end());
+	RemapPlaneKeys(numSpheres, first);
+
+	mBoxManager = nullptr;
+	mTreeProxies.clear();
+}
+
+template <typename Real>
+void PhysicsModule<Real>::RemapPlaneKeys(size_t oldNumSpheres, size_t newNumSpheres)
+{
+	for (auto& manifold : mManifolds)
+	{
+		if (manifold.key >= oldNumSpheres)
+		{
+			manifold.key = manifold.key - oldNumSpheres + newNumSpheres;
+		}
+	}
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::GetSnapshotSize(size_t numSpheres, size_t numHandles,
+	size_t numFreeHandles, size_t numManifolds)
+{
+	size_t const sphereSize =
+		sizeof(uint8_t) +                   // shape
+		5 * sizeof(Real) +                  // shapeRadius, radius, mass, invMass, massDensity
+		8 * sizeof(Vector3<Real>) +         // extent, inertia, invInertia, position, momenta, velocities
+		sizeof(Quaternion<Real>) +          // qOrientation
+		sizeof(Matrix3x3<Real>) +           // rOrientation
+		sizeof(uint8_t) +                   // mAwake
+		3 * sizeof(size_t);                 // mSleepCounter, mIslandNext, mIndexToHandle
+
+	return sizeof(SnapshotHeader) + sizeof(Real) + numSpheres * sphereSize +
+		(numHandles + numFreeHandles) * sizeof(size_t) +
+		numManifolds * sizeof(ContactManifold);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SaveSnapshot(std::vector<uint8_t>& snapshot) const
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	SnapshotHeader header{};
+	header.magic = SnapshotMagic;
+	header.version = SnapshotVersion;
+	header.realSize = static_cast<uint32_t>(sizeof(Real));
+	header.numColliders = static_cast<uint32_t>(mColliders.size() + mMeshes.size());
+	header.numSpheres = numSpheres;
+	header.numHandles = mHandleToIndex.size();
+	header.numFreeHandles = mFreeHandles.size();
+	header.numManifolds = mManifolds.size();
+	snapshot.resize(GetSnapshotSize(numSpheres, mHandleToIndex.size(),
+		mFreeHandles.size(), mManifolds.size()));
+
+	uint8_t* target = snapshot.data();
+	WriteSnapshot(&header, 1, target);
+	WriteSnapshot(&mMaxRadius, 1, target);
+	WriteSnapshot(mSpheres.shape.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.shapeRadius.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.extent.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.radius.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.mass.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.invMass.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.massDensity.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.inertia.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.invInertia.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.position.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.qOrientation.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.linearMomentum.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.angularMomentum.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.rOrientation.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.linearVelocity.data(), numSpheres, target);
+	WriteSnapshot(mSpheres.angularVelocity.data(), numSpheres, target);
+	WriteSnapshot(mAwake.data(), numSpheres, target);
+	WriteSnapshot(mSleepCounter.data(), numSpheres, target);
+	WriteSnapshot(mIslandNext.data(), numSpheres, target);
+	WriteSnapshot(mIndexToHandle.data(), numSpheres, target);
+	WriteSnapshot(mHandleToIndex.data(), mHandleToIndex.size(), target);
+	WriteSnapshot(mFreeHandles.data(), mFreeHandles.size(), target);
+	WriteSnapshot(mManifolds.data(), mManifolds.size(), target);
+}
+
+template <typename Real>
+bool PhysicsModule<Real>::RestoreSnapshot(std::vector<uint8_t> const& snapshot)
+{
+	SnapshotHeader header{};
+	if (snapshot.size() < sizeof(header))
+	{
+		return false;
+	}
+	std::memcpy(&header, snapshot.data(), sizeof(header));
+	if (header.magic != SnapshotMagic ||
+		header.version != SnapshotVersion ||
+		header.realSize != sizeof(Real) ||
+		header.numColliders != mColliders.size() + mMeshes.size() ||
+		snapshot.size() != GetSnapshotSize(static_cast<size_t>(header.numSpheres),
+			static_cast<size_t>(header.numHandles),
+			static_cast<size_t>(header.numFreeHandles),
+			static_cast<size_t>(header.numManifolds)))
+	{
+		return false;
+	}
+
+	size_t const numSpheres = static_cast<size_t>(header.numSpheres);
+	Real const oldMaxRadius = mMaxRadius;
+	uint8_t const* source = snapshot.data() + sizeof(header);
+	std::memcpy(&mMaxRadius, source, sizeof(Real));
+	source += sizeof(Real);
+	ReadSnapshot(source, numSpheres, mSpheres.shape);
+	ReadSnapshot(source, numSpheres, mSpheres.shapeRadius);
+	ReadSnapshot(source, numSpheres, mSpheres.extent);
+	ReadSnapshot(source, numSpheres, mSpheres.radius);
+	ReadSnapshot(source, numSpheres, mSpheres.mass);
+	ReadSnapshot(source, numSpheres, mSpheres.invMass);
+	ReadSnapshot(source, numSpheres, mSpheres.massDensity);
+	ReadSnapshot(source, numSpheres, mSpheres.inertia);
+	ReadSnapshot(source, numSpheres, mSpheres.invInertia);
+	ReadSnapshot(source, numSpheres, mSpheres.position);
+	ReadSnapshot(source, numSpheres, mSpheres.qOrientation);
+	ReadSnapshot(source, numSpheres, mSpheres.linearMomentum);
+	ReadSnapshot(source, numSpheres, mSpheres.angularMomentum);
+	ReadSnapshot(source, numSpheres, mSpheres.rOrientation);
+	ReadSnapshot(source, numSpheres, mSpheres.linearVelocity);
+	ReadSnapshot(source, numSpheres, mSpheres.angularVelocity);
+	ReadSnapshot(source, numSpheres, mAwake);
+	ReadSnapshot(source, numSpheres, mSleepCounter);
+	ReadSnapshot(source, numSpheres, mIslandNext);
+	ReadSnapshot(source, numSpheres, mIndexToHandle);
+	ReadSnapshot(source, static_cast<size_t>(header.numHandles), mHandleToIndex);
+	ReadSnapshot(source, static_cast<size_t>(header.numFreeHandles), mFreeHandles);
+	ReadSnapshot(source, static_cast<size_t>(header.numManifolds), mManifolds);
+
+	if (mMaxRadius != oldMaxRadius)
+	{
+		mGridDirty = true;
+	}
+	mBoxManager = nullptr;
+	mTreeProxies.clear();
+	return true;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::EnableSleeping(size_t numTicks, Real linearSpeed,
+	Real angularSpeed)
+{
+	mSleepTicks = numTicks;
+	mSleepLinearSpeed = linearSpeed;
+	mSleepAngularSpeed = angularSpeed;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::DisableSleeping()
+{
+	mSleepTicks = 0;
+	for (size_t i = 0; i < mAwake.size(); ++i)
+	{
+		WakeIsland(i);
+	}
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::GetNumAwakeSpheres() const
+{
+	size_t numAwake = 0;
+	for (auto awake : mAwake)
+	{
+		numAwake += awake;
+	}
+	return numAwake;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::WakeIsland(size_t i)
+{
+	// The sleeping spheres of an island form a cycle of mIslandNext links.
+	// An awake sphere links to itself.
+	if (mAwake[i] == 0)
+	{
+		size_t j = i;
+		do
+		{
+			size_t next = mIslandNext[j];
+			mAwake[j] = 1;
+			mSleepCounter[j] = 0;
+			mIslandNext[j] = j;
+			j = next;
+		} while (j != i);
+	}
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::FindIsland(size_t i)
+{
+	while (mIslandParent[i] != i)
+	{
+		mIslandParent[i] = mIslandParent[mIslandParent[i]];
+		i = mIslandParent[i];
+	}
+	return i;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::UpdateSleepStates()
+{
+	// Count the consecutive ticks for which each awake sphere has been
+	// slower than the thresholds.
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	Real const sqrLinearSpeed = mSleepLinearSpeed * mSleepLinearSpeed;
+	Real const sqrAngularSpeed = mSleepAngularSpeed * mSleepAngularSpeed;
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mAwake[i] != 0 && mSpheres.IsMovable(i))
+		{
+			auto const& V = mSpheres.linearVelocity[i];
+			auto const& W = mSpheres.angularVelocity[i];
+			if (Dot(V, V) < sqrLinearSpeed && Dot(W, W) < sqrAngularSpeed)
+			{
+				++mSleepCounter[i];
+			}
+			else
+			{
+				mSleepCounter[i] = 0;
+			}
+		}
+	}
+
+	// The islands are the connected components of the graph whose edges
+	// are the sphere-sphere contacts of this tick. The planes and the
+	// immovable spheres do not connect islands. Every sphere of a contact
+	// is awake, because contact wakes a sleeping island.
+	mIslandParent.resize(numSpheres);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		mIslandParent[i] = i;
+	}
+	for (auto const& contact : mContacts)
+	{
+		if (!contact.isPlane && mSpheres.IsMovable(contact.i0) &&
+			mSpheres.IsMovable(contact.i1))
+		{
+			size_t r0 = FindIsland(contact.i0);
+			size_t r1 = FindIsland(contact.i1);
+			if (r0 != r1)
+			{
+				mIslandParent[std::max(r0, r1)] = std::min(r0, r1);
+			}
+		}
+	}
+
+	// An island falls asleep when all its spheres have been slow for
+	// mSleepTicks ticks.
+	size_t const invalid = std::numeric_limits<size_t>::max();
+	mIslandMinCounter.assign(numSpheres, invalid);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mAwake[i] != 0 && mSpheres.IsMovable(i))
+		{
+			size_t r = FindIsland(i);
+			mIslandMinCounter[r] = std::min(mIslandMinCounter[r], mSleepCounter[i]);
+		}
+	}
+
+	// Link the spheres of each sleeping island into a cycle and stop them.
+	mIslandLast.assign(numSpheres, invalid);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mAwake[i] != 0 && mSpheres.IsMovable(i))
+		{
+			size_t r = FindIsland(i);
+			if (mIslandMinCounter[r] >= mSleepTicks)
+			{
+				if (mIslandLast[r] != invalid)
+				{
+					mIslandNext[mIslandLast[r]] = i;
+				}
+				mIslandLast[r] = i;
+				mAwake[i] = 0;
+				mSpheres.SetLinearMomentum(i, Vector3<Real>::Zero());
+				mSpheres.SetAngularMomentum(i, Vector3<Real>::Zero());
+			}
+		}
+	}
+
+	// Close the cycles. The root r is the smallest index of its island, so
+	// it is the first sphere that was linked.
+	for (size_t r = 0; r < numSpheres; ++r)
+	{
+		if (mIslandLast[r] != invalid)
+		{
+			mIslandNext[mIslandLast[r]] = r;
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetSolverParameters(size_t maxIterations, Real tolerance,
+	Real friction)
+{
+	mSolverMaxIterations = maxIterations;
+	mSolverTolerance = tolerance;
+	mSolverFriction = friction;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetContactPersistence(size_t numTicks, Real matchDistance)
+{
+	mContactPersistence = numTicks;
+	mContactMatchDistance = matchDistance;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetNumThreads(size_t numThreads)
+{
+	mNumThreads = numThreads;
+	mThreadContacts.resize(numThreads);
+	mThreadPairs.resize(numThreads);
+	mThreadNumTests.resize(numThreads);
+	mThreadMaxDelta.resize(numThreads);
+	if (mTeam && mTeam->GetNumWorkers() != numThreads)
+	{
+		mTeam = nullptr;
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetNumaNodes(size_t numNodes)
+{
+	if (mTeam && numNodes != mNumaNodes)
+	{
+		// The workers are pinned when they start, so a new grouping needs
+		// a new team.
+		mTeam = nullptr;
+	}
+	mNumaNodes = numNodes;
+	if (numNodes > 0 && !mTopology)
+	{
+		mTopology = std::make_unique<NumaTopology>();
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::PartitionSpheres()
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	int32_t axis = 0;
+	for (int32_t d = 1; d < 3; ++d)
+	{
+		if (mRegionMax[d] - mRegionMin[d] > mRegionMax[axis] - mRegionMin[axis])
+		{
+			axis = d;
+		}
+	}
+
+	// The sphere of new index k is the sphere of old index order[k]. The
+	// ties are broken by index, so the order is deterministic.
+	std::vector<size_t> order(numSpheres);
+	std::iota(order.begin(), order.end(), static_cast<size_t>(0));
+	std::sort(order.begin(), order.end(), [this, axis](size_t i0, size_t i1)
+	{
+		Real const x0 = mSpheres.position[i0][axis];
+		Real const x1 = mSpheres.position[i1][axis];
+		return x0 < x1 || (x0 == x1 && i0 < i1);
+	});
+
+	RigidSphereStore<Real> sorted;
+	sorted.Resize(numSpheres);
+	if (GetNumPartitions() == 0)
+	{
+		sorted.Gather(mSpheres, order, 0, numSpheres);
+	}
+	else
+	{
+		GetSphereBounds(numSpheres, BatchSize);
+		RunThreads([this, &sorted, &order](size_t, size_t begin, size_t end)
+		{
+			sorted.Gather(mSpheres, order, begin, end);
+		});
+	}
+	mSpheres = std::move(sorted);
+
+	// Renumber the per-sphere states, the island links, the handles and
+	// the contact manifolds.
+	std::vector<size_t> newIndex(numSpheres);
+	for (size_t k = 0; k < numSpheres; ++k)
+	{
+		newIndex[order[k]] = k;
+	}
+
+	std::vector<uint8_t> awake(numSpheres);
+	std::vector<size_t> sleepCounter(numSpheres), islandNext(numSpheres);
+	std::vector<size_t> indexToHandle(numSpheres);
+	for (size_t k = 0; k < numSpheres; ++k)
+	{
+		size_t const i = order[k];
+		awake[k] = mAwake[i];
+		sleepCounter[k] = mSleepCounter[i];
+		islandNext[k] = newIndex[mIslandNext[i]];
+		indexToHandle[k] = mIndexToHandle[i];
+		mHandleToIndex[mIndexToHandle[i]] = k;
+	}
+	mAwake = std::move(awake);
+	mSleepCounter = std::move(sleepCounter);
+	mIslandNext = std::move(islandNext);
+	mIndexToHandle = std::move(indexToHandle);
+
+	for (auto& manifold : mManifolds)
+	{
+		manifold.a = newIndex[manifold.a];
+		if (manifold.key < numSpheres)
+		{
+			manifold.key = newIndex[manifold.key];
+		}
+	}
+	mManifolds.erase(std::remove_if(mManifolds.begin(), mManifolds.end(),
+		[](ContactManifold const& manifold)
+		{
+			return manifold.key < manifold.a;
+		}), mManifolds.end());
+	std::sort(mManifolds.begin(), mManifolds.end());
+
+	mBoxManager = nullptr;
+	mTreeProxies.clear();
+}
+
+template <typename Real>
+double PhysicsModule<Real>::GetEnergy() const
+{
+	// The gravity constant of GetForce.
+	double constexpr gravityConstant = 9.81;
+	double energy = 0.0;
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mSpheres.IsMovable(i))
+		{
+			double const mass = static_cast<double>(mSpheres.mass[i]);
+			double const z = static_cast<double>(mSpheres.position[i][2]);
+			bool const isotropic = mSpheres.IsIsotropic(i);
+			double sqrV = 0.0, rotational = 0.0;
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				// The angular velocity about principal axis k, which for
+				// equal moments may be any axis.
+				double const v = static_cast<double>(mSpheres.linearVelocity[i][k]);
+				double const w = static_cast<double>(isotropic ?
+					mSpheres.angularVelocity[i][k] :
+					Dot(mSpheres.angularVelocity[i], mSpheres.rOrientation[i].GetCol(k)));
+				sqrV += v * v;
+				rotational += w * w * static_cast<double>(mSpheres.inertia[i][k]);
+			}
+			energy += 0.5 * (mass * sqrV + rotational) + mass * gravityConstant * z;
+		}
+	}
+	return energy;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetAdaptiveParameters(Real maxAngle, size_t maxLevel)
+{
+	LogAssert(maxAngle > static_cast<Real>(0) && maxLevel <= 16, "Invalid argument.");
+	mAdaptiveMaxAngle = maxAngle;
+	mAdaptiveMaxLevel = maxLevel;
+}
+
+template <typename Real>
+Vector3<Real> PhysicsModule<Real>::GetForce(size_t i, double,
+	Vector3<Real> const& position, Vector3<Real> const& linearVelocity) const
+{
+	// The only external force is gravity.
+	Real constexpr gravityConstant = static_cast<Real>(9.81);   // m/sec^2
+	Vector3<Real> gravityDirection{ 0.0, 0.0, -1.0 };
+	Vector3<Real> gravityForce =
+		(mSpheres.mass[i] * gravityConstant) * gravityDirection;
+
+	// Take into account friction when the spheres are sliding on the
+	// floor.
+	Real constexpr epsilon = static_cast<Real>(1e-03);
+	Vector3<Real> frictionForce{ 0.0, 0.0, 0.0 };
+	Real z = position[2];
+	Real radius = mSpheres.radius[i];
+	if (z - radius <= epsilon)
+	{
+		Real constexpr viscosity = static_cast<Real>(1000.0);
+		Vector3<Real> direction = linearVelocity;
+		Normalize(direction);
+		frictionForce = -viscosity * direction;
+		frictionForce[2] = 0.0;
+	}
+
+	return gravityForce + frictionForce;
+}
+
+template <typename Real>
+Vector3<Real> PhysicsModule<Real>::GetTorque(size_t i, double,
+	Vector3<Real> const& position, Vector3<Real> const& angularVelocity) const
+{
+	// No external torque is applied. However, take into account friction
+	// when the spheres are spinning on the floor.
+	Real constexpr epsilon = static_cast<Real>(1e-03);
+	Vector3<Real> torque{ 0.0, 0.0, 0.0 };
+	Real z = position[2];
+	Real radius = mSpheres.radius[i];
+	if (z - radius <= epsilon)
+	{
+		Real constexpr viscosity = static_cast<Real>(1000.0);
+		Vector3<Real> direction = angularVelocity;
+		Normalize(direction);
+		Vector3<Real> newAngularVelocity = -viscosity * direction;
+		Vector3<Real> newAngularMomentum = mSpheres.MultiplyInertia(i, newAngularVelocity);
+		torque = newAngularMomentum;
+	}
+	return torque;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::DoTick(double time, double deltaTime)
+{
+	GTE_TRACE_SCOPE("PhysicsModule::DoTick");
+	mTickStatistics = TickStatistics{};
+	mTreeDeltaTime = deltaTime;
+	DoCollisionDetection();
+	DoCollisionResponse();
+	if (mContinuousCollision)
+	{
+		mSweepStart = mSpheres.position;
+		DoIntegration(time, deltaTime);
+		DoContinuousCollision(deltaTime);
+	}
+	else
+	{
+		mNumSweptContacts = 0;
+		DoIntegration(time, deltaTime);
+	}
+	if (mActiveBroadphase == Broadphase::AABB_TREE)
+	{
+		ScopedTimer timer(mTickStatistics.broadphaseNanoseconds);
+		UpdateTree();
+	}
+
+	mTickStatistics.detectionNanoseconds = mTickStatistics.broadphaseNanoseconds +
+		mTickStatistics.spherePlaneNanoseconds + mTickStatistics.sphereSphereNanoseconds;
+	mTickStatistics.numContacts = mContacts.size();
+
+	if (mSleepTicks > 0)
+	{
+		UpdateSleepStates();
+	}
+}
+
+template <typename Real>
+WorkerTeam& PhysicsModule<Real>::GetTeam()
+{
+	if (!mTeam)
+	{
+		// With partitioning, thread t is pinned to the node of its group.
+		size_t const numPartitions = GetNumPartitions();
+		if (numPartitions > 0)
+		{
+			std::vector<size_t> workerNodes(mNumThreads);
+			for (size_t t = 0; t < mNumThreads; ++t)
+			{
+				workerNodes[t] = t * numPartitions / mNumThreads % mTopology->GetNumNodes();
+			}
+			mTeam = std::make_unique<WorkerTeam>(mNumThreads, mTopology.get(), workerNodes);
+		}
+		else
+		{
+			mTeam = std::make_unique<WorkerTeam>(mNumThreads);
+		}
+	}
+	return *mTeam;
+}
+
+template <typename Real>
+template <typename Function>
+void PhysicsModule<Real>::RunThreads(Function const& function)
+{	GetTeam().Run([this, &function](size_t t)
+	{
+		function(t, mBounds[t], mBounds[t + 1]);
+	});
+}
+
+template <typename Real>
+void PhysicsModule<Real>::DoCollisionDetection()
+{
+	GTE_TRACE_SCOPE("PhysicsModule::DoCollisionDetection");
+	mContacts.clear();
+
+	// Test for sphere-plane collisions. The tests of a sphere modify only
+	// that sphere, so the spheres are partitioned among the threads. The
+	// per-thread contacts are concatenated in thread order, which is the
+	// sphere order of the single-threaded loop.
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	mMoved.assign(numSpheres, 0);
+	{
+		ScopedTimer timer(mTickStatistics.spherePlaneNanoseconds);
+		if (mNumThreads == 0)
+		{
+			TestSpherePlanes(0, numSpheres, mContacts);
+		}
+		else
+		{
+			GetSphereBounds(numSpheres, BatchSize);
+			RunThreads([this](size_t t, size_t begin, size_t end)
+			{
+				auto& contacts = mThreadContacts[t];
+				contacts.clear();
+				TestSpherePlanes(begin, end, contacts);
+			});
+			for (auto const& contacts : mThreadContacts)
+			{
+				mContacts.insert(mContacts.end(), contacts.begin(), contacts.end());
+			}
+		}
+
+		if (mColliders.size() > 0 || mMeshes.size() > 0)
+		{
+			if (mNumThreads == 0)
+			{
+				TestSphereColliders(0, numSpheres, mContacts);
+			}
+			else
+			{
+				GetSphereBounds(numSpheres, ColliderChunkSize);
+				RunThreads([this](size_t t, size_t begin, size_t end)
+				{
+					auto& contacts = mThreadContacts[t];
+					contacts.clear();
+					TestSphereColliders(begin, end, contacts);
+				});
+				for (auto const& contacts : mThreadContacts)
+				{
+					mContacts.insert(mContacts.end(), contacts.begin(), contacts.end());
+				}
+			}
+		}
+	}
+	mTickStatistics.numPlaneContacts = mContacts.size();
+
+	// Test for sphere-sphere collisions. A change of the active broadphase
+	// discards the incremental states, which were not updated while the
+	// other broadphase was active.
+	Broadphase const broadphase = (mBroadphase == Broadphase::AUTOMATIC ?
+		SelectBroadphase() : mBroadphase);
+	if (broadphase != mActiveBroadphase)
+	{
+		mActiveBroadphase = broadphase;
+		mBoxManager = nullptr;
+		mTreeProxies.clear();
+	}
+
+	bool const useGrid = (broadphase == Broadphase::UNIFORM_GRID && mMaxRadius > static_cast<Real>(0));
+	bool const useSweep = (broadphase == Broadphase::SORT_AND_SWEEP);
+	bool const useTree = (broadphase == Broadphase::AABB_TREE);
+	bool const useHierarchy = (broadphase == Broadphase::HIERARCHICAL_GRID);
+	bool const usePairs = (useGrid || useSweep || useTree || useHierarchy);
+	{
+		ScopedTimer timer(mTickStatistics.broadphaseNanoseconds);
+		if (useGrid)
+		{
+			ComputeGridPairs();
+			mNumCandidatePairs = mPairs.size();
+		}
+		else if (useSweep)
+		{
+			ComputeSweepPairs();
+			mNumCandidatePairs = mPairs.size();
+		}
+		else if (useTree)
+		{
+			ComputeTreePairs();
+			mNumCandidatePairs = mPairs.size();
+		}
+		else if (useHierarchy)
+		{
+			ComputeHierarchicalPairs();
+			mNumCandidatePairs = mPairs.size();
+		}
+		else
+		{
+			mNumCandidatePairs = (numSpheres > 1 ? numSpheres * (numSpheres - 1) / 2 : 0);
+		}
+	}
+
+	ScopedTimer timer(mTickStatistics.sphereSphereNanoseconds);
+	if (!usePairs && mNumThreads == 0)
+	{
+		size_t numTests = 0;
+		for (size_t i0 = 0; i0 + 1 < numSpheres; ++i0)
+		{
+			for (size_t i1 = i0 + 1; i1 < numSpheres; ++i1)
+			{
+				if (TestSphereOverlap(i0, i1))
+				{
+					++numTests;
+				}
+			}
+		}
+		AddCount(mTickStatistics.numPairsTested, numTests);
+		return;
+	}
+
+	// The single-threaded all-pairs narrowphase resolves an overlap before
+	// testing the next pair, so each test can see the fixups of the
+	// previous ones. Instead, the candidates are first tested against the
+	// current centers, which are only read, by FindOverlappingPairs or, in
+	// parallel, by the threads. The overlapping pairs are then sorted and
+	// resolved on this thread, and each is retested before its fixup. The
+	// resolved set does not depend on the number of threads or on the
+	// broadphase. As with the broadphases, an overlap created by a fixup is
+	// resolved on the next tick.
+	mOverlaps.clear();
+	if (usePairs && mNumThreads == 0)
+	{
+		size_t numTests = FindOverlappingPairs(0, mPairs.size(), mOverlaps);
+		AddCount(mTickStatistics.numPairsTested, numTests);
+	}
+	else if (usePairs && GetNumPartitions() > 0)
+	{
+		// The pairs within a chunk are tested by the threads of its group,
+		// which read only the spheres of their node. The pairs across the
+		// chunks are then tested by all threads.
+		PartitionPairs(numSpheres);
+		GetGroupBounds(mPairStarts, BatchSize);
+		RunThreads([this](size_t t, size_t begin, size_t end)
+		{
+			auto& overlaps = mThreadPairs[t];
+			overlaps.clear();
+			mThreadNumTests[t] = FindOverlappingPairs(begin, end, overlaps);
+		});
+
+		size_t const crossBegin = mPairStarts[GetNumPartitions()];
+		GetUniformBounds(mPairs.size() - crossBegin, BatchSize);
+		for (auto& bound : mBounds)
+		{
+			bound += crossBegin;
+		}
+		RunThreads([this](size_t t, size_t begin, size_t end)
+		{
+			mThreadNumTests[t] += FindOverlappingPairs(begin, end, mThreadPairs[t]);
+		});
+	}
+	else if (usePairs)
+	{
+		GetUniformBounds(mPairs.size(), BatchSize);
+		RunThreads([this](size_t t, size_t begin, size_t end)
+		{
+			auto& overlaps = mThreadPairs[t];
+			overlaps.clear();
+			mThreadNumTests[t] = FindOverlappingPairs(begin, end, overlaps);
+		});
+	}
+	else
+	{
+		// Row i0 has numSpheres - 1 - i0 pairs. Partition the rows so that
+		// the threads test similar numbers of pairs.
+		mBounds.resize(mNumThreads + 1);
+		mBounds[0] = 0;
+		size_t const numRows = (numSpheres > 0 ? numSpheres - 1 : 0);
+		size_t const pairsPerThread = mNumCandidatePairs / mNumThreads + 1;
+		size_t row = 0, count = 0;
+		for (size_t t = 1; t < mNumThreads; ++t)
+		{
+			while (row < numRows && count < t * pairsPerThread)
+			{
+				count += numSpheres - 1 - row;
+				++row;
+			}
+			mBounds[t] = row;
+		}
+		mBounds[mNumThreads] = numRows;
+
+		RunThreads([this, numSpheres](size_t t, size_t begin, size_t end)
+		{
+			auto& overlaps = mThreadPairs[t];
+			overlaps.clear();
+			size_t numTests = 0;
+			for (size_t i0 = begin; i0 < end; ++i0)
+			{
+				for (size_t i1 = i0 + 1; i1 < numSpheres; ++i1)
+				{
+					if ((mAwake[i0] | mAwake[i1]) != 0)
+					{
+						++numTests;
+						bool const isSpherePair = ((mSpheres.shape[i0] | mSpheres.shape[i1]) ==
+							RigidSphereStore<Real>::SPHERE);
+						if (isSpherePair ? GetSphereOverlap(i0, i1) > static_cast<Real>(0) :
+							GetShapeMargin(i0, i1) > static_cast<Real>(0))
+						{
+							overlaps.emplace_back(i0, i1);
+						}
+					}
+				}
+			}
+			mThreadNumTests[t] = numTests;
+		});
+	}
+
+	for (size_t t = 0; t < mNumThreads; ++t)
+	{
+		auto const& overlaps = mThreadPairs[t];
+		mOverlaps.insert(mOverlaps.end(), overlaps.begin(), overlaps.end());
+		AddCount(mTickStatistics.numPairsTested, mThreadNumTests[t]);
+	}
+	std::sort(mOverlaps.begin(), mOverlaps.end());
+	for (auto const& pair : mOverlaps)
+	{
+		TestSphereOverlap(pair.first, pair.second);
+	}
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::FindOverlappingPairs(size_t begin, size_t end,
+	std::vector<std::pair<size_t, size_t>>& overlaps) const
+{
+	// The centers and radii of BatchSize candidate pairs are gathered into
+	// lanes, and the squared distances of the centers are compared with the
+	// squared sums of the radii without branches or square roots. Only the
+	// overlapping pairs of the batch are visited to append them. Pairs of
+	// sleeping spheres get a zero margin, so they are never appended. The
+	// margins of the capsule-capsule, capsule-sphere and box-sphere lanes
+	// are replaced by those of their kernels, which are evaluated only for
+	// the batches that contain such pairs.
+	Real const zero = static_cast<Real>(0);
+	PairLanes lanes{};
+	Lanes awake{}, margin{};
+	size_t numTests = 0;
+	for (size_t first = begin; first < end; first += BatchSize)
+	{
+		size_t const numLanes = (end - first < BatchSize ? end - first : BatchSize);
+		bool anySegment = false, anyBoxSphere = false;
+		for (size_t j = 0; j < numLanes; ++j)
+		{
+			auto const& pair = mPairs[first + j];
+			GatherPair(pair.first, pair.second, j, lanes);
+			awake[j] = ((mAwake[pair.first] | mAwake[pair.second]) != 0 ?
+				static_cast<Real>(1) : zero);
+			anySegment = anySegment || lanes.isSegment[j] > zero;
+			anyBoxSphere = anyBoxSphere || lanes.isBoxSphere[j] > zero;
+		}
+
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			Real const sqrLength = lanes.delta[0][j] * lanes.delta[0][j] +
+				lanes.delta[1][j] * lanes.delta[1][j] + lanes.delta[2][j] * lanes.delta[2][j];
+			Real const difference = lanes.sumRadii[j] * lanes.sumRadii[j] - sqrLength;
+			margin[j] = (awake[j] > zero ? difference : zero);
+		}
+
+		if (anySegment)
+		{
+			for (size_t j = 0; j < BatchSize; ++j)
+			{
+				Real const difference = GetSegmentMargin(lanes, j);
+				margin[j] = (lanes.isSegment[j] * awake[j] > zero ? difference : margin[j]);
+			}
+		}
+
+		if (anyBoxSphere)
+		{
+			for (size_t j = 0; j < BatchSize; ++j)
+			{
+				Real const difference = GetBoxSphereMargin(lanes, j);
+				margin[j] = (lanes.isBoxSphere[j] * awake[j] > zero ? difference : margin[j]);
+			}
+		}
+
+		for (size_t j = 0; j < numLanes; ++j)
+		{
+			if (awake[j] > zero)
+			{
+				++numTests;
+				if (margin[j] > zero)
+				{
+					overlaps.push_back(mPairs[first + j]);
+				}
+			}
+		}
+	}
+	return numTests;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GatherPair(size_t i0, size_t i1, size_t j,
+	PairLanes& lanes) const
+{
+	Real const zero = static_cast<Real>(0);
+	Real const one = static_cast<Real>(1);
+	auto const& center0 = mSpheres.position[i0];
+	auto const& center1 = mSpheres.position[i1];
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		lanes.delta[d][j] = center1[d] - center0[d];
+	}
+	lanes.sumRadii[j] = mSpheres.radius[i0] + mSpheres.radius[i1];
+	lanes.isSegment[j] = zero;
+	lanes.isBoxSphere[j] = zero;
+
+	uint8_t const shape0 = mSpheres.shape[i0];
+	uint8_t const shape1 = mSpheres.shape[i1];
+	if ((shape0 | shape1) == RigidSphereStore<Real>::CAPSULE)
+	{
+		// A capsule and a capsule or a sphere.
+		Vector3<Real> axis0 = mSpheres.extent[i0][2] * mSpheres.rOrientation[i0].GetCol(2);
+		Vector3<Real> axis1 = mSpheres.extent[i1][2] * mSpheres.rOrientation[i1].GetCol(2);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			lanes.D0[d][j] = axis0[d];
+			lanes.D1[d][j] = axis1[d];
+		}
+		lanes.sumShapeRadii[j] = mSpheres.shapeRadius[i0] + mSpheres.shapeRadius[i1];
+		lanes.isSegment[j] = one;
+	}
+	else if ((shape0 | shape1) == RigidSphereStore<Real>::BOX && shape0 != shape1)
+	{
+		// A box and a sphere. The delta is from the box center to the
+		// sphere center.
+		bool const boxFirst = (shape0 == RigidSphereStore<Real>::BOX);
+		size_t const box = (boxFirst ? i0 : i1);
+		auto const& rotate = mSpheres.rOrientation[box];
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			lanes.delta[d][j] = (boxFirst ? lanes.delta[d][j] : -lanes.delta[d][j]);
+			lanes.boxExtent[d][j] = mSpheres.extent[box][d];
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				lanes.boxAxis[3 * k + d][j] = rotate(d, k);
+			}
+		}
+		lanes.sumShapeRadii[j] = mSpheres.shapeRadius[boxFirst ? i1 : i0];
+		lanes.isBoxSphere[j] = one;
+	}
+}
+
+template <typename Real>
+Real PhysicsModule<Real>::GetShapeMargin(size_t i0, size_t i1) const
+{
+	PairLanes lanes{};
+	GatherPair(i0, i1, 0, lanes);
+	if (lanes.isSegment[0] > static_cast<Real>(0))
+	{
+		return GetSegmentMargin(lanes, 0);
+	}
+	if (lanes.isBoxSphere[0] > static_cast<Real>(0))
+	{
+		return GetBoxSphereMargin(lanes, 0);
+	}
+	Real const sqrLength = lanes.delta[0][0] * lanes.delta[0][0] +
+		lanes.delta[1][0] * lanes.delta[1][0] + lanes.delta[2][0] * lanes.delta[2][0];
+	return lanes.sumRadii[0] * lanes.sumRadii[0] - sqrLength;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::TestSpherePlanes(size_t begin, size_t end,
+	std::vector<Contact>& contacts)
+{
+	// These checks are done in pairs with the assumption that the sphere
+	// diameters are smaller than the distance between parallel planar
+	// boundaries. In this case, only one of each parallel pair of planes
+	// can be intersected at any time. Each pair of parallel planes is
+	// tested in order to handle the case when a sphere intersects two
+	// planes meeting at a region edge or three planes meeting at a region
+	// corner. When the sphere is partially or fully outside a plane, the
+	// interpenetration is removed to push the sphere back into the
+	// simulation region.
+	//
+	// The signed distance of a center to plane p0 or p0 + 3 depends only on
+	// its coordinate p0, and the push-back from that plane changes only
+	// that coordinate, so the overlaps of all 6 planes are computed from
+	// the initial center. For the region box, Dot(normal,center)-constant
+	// evaluates exactly to center[d]-min[d] or max[d]-center[d], so the
+	// overlaps and contacts are those of testing the RigidPlane objects one
+	// after the other. Sleeping spheres are not tested.
+	//
+	// The support distance of a capsule or a box along coordinate axis d is
+	// shapeRadius + sum_k extent[k] * |R(d,k)|, the same for both planes of
+	// the pair, so the capsule-plane and box-plane tests are those of a
+	// sphere with that radius per axis.
+	Real const zero = static_cast<Real>(0);
+	std::array<Lanes, 3> lowOverlap{}, highOverlap{}, support{};
+	Lanes touching{};
+	for (size_t first = begin; first < end; first += BatchSize)
+	{
+		size_t const numLanes = (end - first < BatchSize ? end - first : BatchSize);
+		for (size_t j = 0; j < numLanes; ++j)
+		{
+			size_t const i = first + j;
+			if (mSpheres.shape[i] == RigidSphereStore<Real>::SPHERE)
+			{
+				Real const radius = mSpheres.radius[i];
+				support[0][j] = radius;
+				support[1][j] = radius;
+				support[2][j] = radius;
+			}
+			else
+			{
+				auto const& rotate = mSpheres.rOrientation[i];
+				auto const& extent = mSpheres.extent[i];
+				for (int32_t d = 0; d < 3; ++d)
+				{
+					support[d][j] = mSpheres.shapeRadius[i] +
+						extent[0] * std::fabs(rotate(d, 0)) +
+						extent[1] * std::fabs(rotate(d, 1)) +
+						extent[2] * std::fabs(rotate(d, 2));
+				}
+			}
+		}
+
+		for (size_t j = 0; j < numLanes; ++j)
+		{
+			size_t const i = first + j;
+			auto const& center = mSpheres.position[i];
+			Real maxOverlap = zero;
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				lowOverlap[d][j] = support[d][j] - (center[d] - mPlaneMin[d]);
+				highOverlap[d][j] = support[d][j] - (mPlaneMax[d] - center[d]);
+				maxOverlap = std::max(maxOverlap, std::max(lowOverlap[d][j], highOverlap[d][j]));
+			}
+			touching[j] = (mAwake[i] != 0 ? maxOverlap : zero);
+		}
+
+		for (size_t j = 0; j < numLanes; ++j)
+		{
+			if (touching[j] > zero)
+			{
+				// Test the x-, y- and z-constant planes p0 and p0 + 3.
+				size_t const i = first + j;
+				for (size_t p0 = 0; p0 < 3; ++p0)
+				{
+					if (lowOverlap[p0][j] > zero)
+					{
+						SetSpherePlaneContact(i, p0, lowOverlap[p0][j], contacts);
+					}
+					else if (highOverlap[p0][j] > zero)
+					{
+						SetSpherePlaneContact(i, p0 + 3, highOverlap[p0][j], contacts);
+					}
+				}
+			}
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::TestSphereColliders(size_t begin, size_t end,
+	std::vector<Contact>& contacts)
+{
+	// The signed distance of a center is the first-order approximation of
+	// the distance of the sphere to the surface along the normal, so
+	// moving the sphere by the overlap along the normal makes it just
+	// touch the surface. A sphere pushed out of one collider is gathered
+	// for the next one at its new position. Sleeping spheres are not
+	// tested.
+	Real const zero = static_cast<Real>(0);
+	std::array<size_t, ColliderChunkSize> sphere{};
+	std::array<Real, ColliderChunkSize> X{}, Y{}, Z{}, distance{}, gradX{}, gradY{}, gradZ{};
+	std::vector<typename RigidMesh<Real>::Range> leaves{};
+	for (size_t first = begin; first < end; first += ColliderChunkSize)
+	{
+		size_t const last = std::min(end, first + ColliderChunkSize);
+		for (size_t c = 0; c < mColliders.size(); ++c)
+		{
+			auto const& collider = *mColliders[c];
+			auto const& cmin = collider.GetMin();
+			auto const& cmax = collider.GetMax();
+			size_t numQueries = 0;
+			for (size_t i = first; i < last; ++i)
+			{
+				auto const& center = mSpheres.position[i];
+				if (mAwake[i] != 0
+					&& cmin[0] <= center[0] && center[0] <= cmax[0]
+					&& cmin[1] <= center[1] && center[1] <= cmax[1]
+					&& cmin[2] <= center[2] && center[2] <= cmax[2])
+				{
+					sphere[numQueries] = i;
+					X[numQueries] = center[0];
+					Y[numQueries] = center[1];
+					Z[numQueries] = center[2];
+					++numQueries;
+				}
+			}
+			if (numQueries == 0)
+			{
+				continue;
+			}
+
+			collider.Evaluate(numQueries, X.data(), Y.data(), Z.data(), distance.data(),
+				gradX.data(), gradY.data(), gradZ.data());
+			for (size_t k = 0; k < numQueries; ++k)
+			{
+				size_t const i = sphere[k];
+				Real overlap = mSpheres.radius[i] - distance[k];
+				if (overlap > zero)
+				{
+					Vector3<Real> normal{ gradX[k], gradY[k], gradZ[k] };
+					if (Normalize(normal) > zero)
+					{
+						if (mSpheres.shape[i] != RigidSphereStore<Real>::SPHERE)
+						{
+							overlap = mSpheres.GetSupportDistance(i, normal) - distance[k];
+							if (overlap <= zero)
+							{
+								continue;
+							}
+						}
+						SetStaticContact(i, 6 + c, overlap, normal, contacts);
+					}
+				}
+			}
+		}
+
+		for (size_t m = 0; m < mMeshes.size(); ++m)
+		{
+			auto const& mesh = *mMeshes[m];
+			auto const& mmin = mesh.GetMin();
+			auto const& mmax = mesh.GetMax();
+			for (size_t i = first; i < last; ++i)
+			{
+				auto const& center = mSpheres.position[i];
+				Real const radius = mSpheres.radius[i];
+				if (mAwake[i] == 0
+					|| center[0] + radius < mmin[0] || center[0] - radius > mmax[0]
+					|| center[1] + radius < mmin[1] || center[1] - radius > mmax[1]
+					|| center[2] + radius < mmin[2] || center[2] - radius > mmax[2])
+				{
+					continue;
+				}
+
+				// The pushed-out positions are tested against the triangles
+				// within the radius of the original center. A push that
+				// moves the sphere onto other triangles is resolved in the
+				// next tick.
+				mesh.GetLeaves(center, radius, leaves);
+				if (leaves.empty())
+				{
+					continue;
+				}
+
+				Vector3<Real> point = center;
+				for (size_t iteration = 0; iteration < MeshPushIterations; ++iteration)
+				{
+					Vector3<Real> closest{};
+					size_t triangle = 0;
+					Real const distance = mesh.GetClosestPoint(point, leaves, closest, triangle);
+					Vector3<Real> normal = point - closest;
+					if (Normalize(normal) == zero)
+					{
+						// The center is on the triangle. Push the sphere
+						// back to the side it came from.
+						normal = mesh.GetNormal(triangle);
+						if (Dot(normal, mSpheres.linearVelocity[i]) > zero)
+						{
+							normal = -normal;
+						}
+					}
+
+					Real const overlap = (mSpheres.shape[i] == RigidSphereStore<Real>::SPHERE ?
+						radius : mSpheres.GetSupportDistance(i, normal)) - distance;
+					if (overlap <= zero)
+					{
+						break;
+					}
+					point += overlap * normal;
+				}
+
+				Vector3<Real> push = point - center;
+				Real const length = Normalize(push);
+				if (length > zero)
+				{
+					SetStaticContact(i, 6 + mColliders.size() + m, length, push, contacts);
+				}
+			}
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GetUniformBounds(size_t numItems, size_t alignment)
+{
+	// Thread t processes items mBounds[t] through mBounds[t + 1] - 1. With
+	// alignment > 1 the interior bounds are multiples of the alignment.
+	mBounds.resize(mNumThreads + 1);
+	size_t const step = (alignment > 1 ? alignment : 1);
+	size_t const numBlocks = (numItems + step - 1) / step;
+	for (size_t t = 0; t < mNumThreads; ++t)
+	{
+		mBounds[t] = std::min(numItems, step * (numBlocks * t / mNumThreads));
+	}
+	mBounds[mNumThreads] = numItems;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ComputeChunkStarts(size_t numSpheres)
+{
+	size_t const numPartitions = GetNumPartitions();
+	size_t const numBlocks = (numSpheres + ColliderChunkSize - 1) / ColliderChunkSize;
+	mChunkStarts.resize(numPartitions + 1);
+	for (size_t p = 0; p < numPartitions; ++p)
+	{
+		mChunkStarts[p] = std::min(numSpheres, ColliderChunkSize * (numBlocks * p / numPartitions));
+	}
+	mChunkStarts[numPartitions] = numSpheres;
+}
+
+template <typename Real>
+size_t PhysicsModule<Real>::GetChunk(size_t i, size_t numSpheres) const
+{
+	// Chunk p starts at block floor(numBlocks * p / numPartitions), so the
+	// chunk of block b is the largest p whose start is at most b. The
+	// empty chunks share their start with the next nonempty one.
+	size_t const numPartitions = GetNumPartitions();
+	size_t const numBlocks = (numSpheres + ColliderChunkSize - 1) / ColliderChunkSize;
+	size_t const block = i / ColliderChunkSize;
+	return std::min(numPartitions - 1, ((block + 1) * numPartitions - 1) / numBlocks);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GetGroupBounds(std::vector<size_t> const& starts, size_t alignment)
+{
+	size_t const numPartitions = GetNumPartitions();
+	size_t const step = (alignment > 1 ? alignment : 1);
+	mBounds.resize(mNumThreads + 1);
+	for (size_t p = 0; p < numPartitions; ++p)
+	{
+		size_t const first = GetGroupStart(p), numGroupThreads = GetGroupStart(p + 1) - first;
+		size_t const begin = starts[p], end = starts[p + 1];
+		size_t const numBlocks = (end - begin + step - 1) / step;
+		for (size_t t = 0; t < numGroupThreads; ++t)
+		{
+			mBounds[first + t] = std::min(end, begin + step * (numBlocks * t / numGroupThreads));
+		}
+	}
+	mBounds[mNumThreads] = starts[numPartitions];
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GetSphereBounds(size_t numSpheres, size_t alignment)
+{
+	if (GetNumPartitions() == 0)
+	{
+		GetUniformBounds(numSpheres, alignment);
+	}
+	else
+	{
+		ComputeChunkStarts(numSpheres);
+		GetGroupBounds(mChunkStarts, alignment);
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::PartitionPairs(size_t numSpheres)
+{
+	// A stable counting sort by chunk; the pairs across chunks are in the
+	// last bin.
+	size_t const numPartitions = GetNumPartitions();
+	auto getBin = [this, numSpheres, numPartitions](std::pair<size_t, size_t> const& pair)
+	{
+		size_t const c0 = GetChunk(pair.first, numSpheres);
+		size_t const c1 = GetChunk(pair.second, numSpheres);
+		return (c0 == c1 ? c0 : numPartitions);
+	};
+
+	mPairStarts.assign(numPartitions + 2, 0);
+	for (auto const& pair : mPairs)
+	{
+		++mPairStarts[getBin(pair) + 1];
+	}
+	for (size_t p = 1; p < mPairStarts.size(); ++p)
+	{
+		mPairStarts[p] += mPairStarts[p - 1];
+	}
+
+	mPartitionPairs.resize(mPairs.size());
+	std::vector<size_t> next(mPairStarts.begin(), mPairStarts.end() - 1);
+	for (auto const& pair : mPairs)
+	{
+		mPartitionPairs[next[getBin(pair)]++] = pair;
+	}
+	std::swap(mPairs, mPartitionPairs);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ComputeGridPairs()
+{
+	if (mGridDirty)
+	{
+		// The cell size is the diameter of the largest sphere, so only
+		// spheres in the same or in adjacent cells can overlap.
+		mGrid.Initialize(mRegionMin, mRegionMax, static_cast<Real>(2) * mMaxRadius);
+		mGridDirty = false;
+	}
+
+	// The centers are sampled after the sphere-plane tests have pushed the
+	// spheres back into the region. The narrowphase reads the current
+	// centers, so it sees the positional fixups of UndoSphereOverlap. A
+	// fixup that pushes a sphere into a non-candidate is resolved on the
+	// next tick. The grid reads the contiguous position array directly.
+	mGrid.ComputePairs(mSpheres.position, mPairs,
+		(mNumThreads > 0 ? &GetTeam() : nullptr));
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ComputeSweepPairs()
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	if (!mBoxManager)
+	{
+		// Initialize the sort-and-sweep with the current bounding boxes.
+		mBoxes.resize(numSpheres);
+		for (size_t i = 0; i < numSpheres; ++i)
+		{
+			auto const& center = mSpheres.position[i];
+			Real const radius = mSpheres.radius[i];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				mBoxes[i].min[d] = center[d] - radius;
+				mBoxes[i].max[d] = center[d] + radius;
+			}
+		}
+		mBoxManager = std::make_unique<gte::BoxManager<Real>>(mBoxes);
+	}
+	else
+	{
+		// Move the boxes to the current sphere centers and let the manager
+		// update the overlap set incrementally.
+		gte::AlignedBox3<Real> box{};
+		for (size_t i = 0; i < numSpheres; ++i)
+		{
+			auto const& center = mSpheres.position[i];
+			Real const radius = mSpheres.radius[i];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				box.min[d] = center[d] - radius;
+				box.max[d] = center[d] + radius;
+			}
+			mBoxManager->SetBox(static_cast<int32_t>(i), box);
+		}
+		mBoxManager->Update();
+	}
+
+	// The overlap set is ordered lexicographically with V[0] < V[1].
+	auto const& overlap = mBoxManager->GetOverlap();
+	mPairs.clear();
+	mPairs.reserve(overlap.size());
+	for (auto const& key : overlap)
+	{
+		mPairs.emplace_back(static_cast<size_t>(key.V[0]),
+			static_cast<size_t>(key.V[1]));
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ComputeTreePairs()
+{
+	// The pairs are sorted lexicographically.
+	UpdateTree();
+	mTree.ComputePairs(mPairs);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ComputeHierarchicalPairs()
+{
+	// The spheres are binned by their bounding radii. The pairs are sorted
+	// lexicographically for a single thread and are in cell order
+	// otherwise, as for the uniform grid.
+	mHierarchicalGrid.ComputePairs(mSpheres.position, mSpheres.radius, mPairs,
+		(mNumThreads > 0 ? &GetTeam() : nullptr));
+}
+
+template <typename Real>
+typename PhysicsModule<Real>::Broadphase PhysicsModule<Real>::SelectBroadphase() const
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	if (numSpheres < 64)
+	{
+		return Broadphase::BRUTE_FORCE;
+	}
+
+	Real const zero = static_cast<Real>(0);
+	Real const two = static_cast<Real>(2);
+	Real minRadius = std::numeric_limits<Real>::max(), maxRadius = zero;
+	Real cubeVolume = zero;
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		Real const radius = mSpheres.radius[i];
+		if (radius > zero)
+		{
+			minRadius = std::min(minRadius, radius);
+			maxRadius = std::max(maxRadius, radius);
+			cubeVolume += two * radius * two * radius * two * radius;
+		}
+	}
+
+	Real regionVolume = static_cast<Real>(1), numGridCells = static_cast<Real>(1);
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		Real const extent = mRegionMax[d] - mRegionMin[d];
+		regionVolume *= extent;
+		numGridCells *= std::max(std::floor(extent / (two * maxRadius)), static_cast<Real>(1));
+	}
+
+	if (maxRadius <= static_cast<Real>(4) * minRadius)
+	{
+		return (numGridCells <= static_cast<Real>(8 * numSpheres) ?
+			Broadphase::UNIFORM_GRID : Broadphase::SORT_AND_SWEEP);
+	}
+
+	if (cubeVolume >= regionVolume)
+	{
+		int32_t const maxLevel = static_cast<int32_t>(mHierarchicalGrid.GetMaxLevels()) - 1;
+		return (maxRadius <= std::ldexp(minRadius, maxLevel) ?
+			Broadphase::HIERARCHICAL_GRID : Broadphase::AABB_TREE);
+	}
+	return Broadphase::SORT_AND_SWEEP;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::UpdateTree()
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	gte::AlignedBox3<Real> box{};
+	if (mTreeProxies.size() != numSpheres)
+	{
+		mTree.Clear();
+		mTreeProxies.resize(numSpheres);
+		for (size_t i = 0; i < numSpheres; ++i)
+		{
+			auto const& center = mSpheres.position[i];
+			Real const radius = mSpheres.radius[i];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				box.min[d] = center[d] - radius;
+				box.max[d] = center[d] + radius;
+			}
+			mTreeProxies[i] = mTree.Insert(box, i, mTreeMargin * radius);
+		}
+	}
+	else
+	{
+		// A sphere that leaves its fat box is reinserted with a box that
+		// is extended by its displacement over the next four ticks at the
+		// current velocity. The margin is proportional to the radius, so
+		// small and large spheres are reinserted at similar rates.
+		Real const lookahead = static_cast<Real>(4.0 * mTreeDeltaTime);
+		for (size_t i = 0; i < numSpheres; ++i)
+		{
+			auto const& center = mSpheres.position[i];
+			Real const radius = mSpheres.radius[i];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				box.min[d] = center[d] - radius;
+				box.max[d] = center[d] + radius;
+			}
+			Vector3<Real> displacement = lookahead * mSpheres.linearVelocity[i];
+			mTree.Move(mTreeProxies[i], box, displacement, mTreeMargin * radius);
+		}
+	}
+}
+
+template <typename Real>
+bool PhysicsModule<Real>::RayCast(Vector3<Real> const& origin,
+	Vector3<Real> const& direction, Real tMax, size_t& sphere, Real& t) const
+{
+	bool found = false;
+	Real tFirst = tMax;
+	if (mActiveBroadphase == Broadphase::AABB_TREE && mTree.GetNumLeaves() > 0 &&
+		mTreeProxies.size() == mSpheres.GetNumSpheres())
+	{
+		// The fat boxes contain the spheres, so the hits are sorted by a
+		// lower bound of the sphere parameters and the search can stop at
+		// the first box that is entered after the best sphere hit.
+		std::vector<std::pair<Real, size_t>> hits{};
+		mTree.RayCast(origin, direction, tMax, hits);
+		for (auto const& hit : hits)
+		{
+			if (hit.first > tFirst)
+			{
+				break;
+			}
+
+			Real tHit{};
+			if (IntersectSphere(hit.second, origin, direction, tFirst, tHit))
+			{
+				if (!found || tHit < tFirst || (tHit == tFirst && hit.second < sphere))
+				{
+					tFirst = tHit;
+					sphere = hit.second;
+					found = true;
+				}
+			}
+		}
+	}
+	else
+	{
+		for (size_t i = 0; i < mSpheres.GetNumSpheres(); ++i)
+		{
+			Real tHit{};
+			if (IntersectSphere(i, origin, direction, tFirst, tHit) && (!found || tHit < tFirst))
+			{
+				tFirst = tHit;
+				sphere = i;
+				found = true;
+			}
+		}
+	}
+
+	if (found)
+	{
+		t = tFirst;
+	}
+	return found;
+}
+
+template <typename Real>
+bool PhysicsModule<Real>::IntersectSphere(size_t i, Vector3<Real> const& origin,
+	Vector3<Real> const& direction, Real tMax, Real& t) const
+{
+	// Solve |origin + t * direction - center|^2 = radius^2, that is,
+	// a*t^2 + 2*b*t + c = 0. A segment that starts inside the sphere hits
+	// it at t = 0.
+	Real const zero = static_cast<Real>(0);
+	Vector3<Real> delta = origin - mSpheres.position[i];
+	Real const radius = mSpheres.radius[i];
+	Real c = Dot(delta, delta) - radius * radius;
+	if (c <= zero)
+	{
+		t = zero;
+		return true;
+	}
+
+	Real a = Dot(direction, direction);
+	Real b = Dot(direction, delta);
+	Real discr = b * b - a * c;
+	if (a == zero || b >= zero || discr < zero)
+	{
+		return false;
+	}
+
+	t = (-b - std::sqrt(discr)) / a;
+	return t <= tMax;
+}
+
+template <typename Real>
+Real PhysicsModule<Real>::GetSphereOverlap(size_t i0, size_t i1) const
+{
+	// The square root is computed only for intersecting spheres.
+	auto delta = mSpheres.position[i1] - mSpheres.position[i0];
+	Real const sqrLengthDelta = Dot(delta, delta);
+	Real const sumRadii = mSpheres.radius[i0] + mSpheres.radius[i1];
+	if (sqrLengthDelta >= sumRadii * sumRadii)
+	{
+		return static_cast<Real>(0);
+	}
+	return sumRadii - std::sqrt(sqrLengthDelta);
+}
+
+template <typename Real>
+bool PhysicsModule<Real>::TestSphereOverlap(size_t i0, size_t i1)
+{
+	// Test for overlap of sphere i0 and sphere i1. Two sleeping spheres
+	// are at rest relative to each other and are not tested.
+	if ((mAwake[i0] | mAwake[i1]) == 0)
+	{
+		return false;
+	}
+
+	if ((mSpheres.shape[i0] | mSpheres.shape[i1]) != RigidSphereStore<Real>::SPHERE)
+	{
+		Real overlap{};
+		Vector3<Real> normal{}, point{};
+		if (GetShapeContact(i0, i1, overlap, normal, point))
+		{
+			WakeIsland(i0);
+			WakeIsland(i1);
+			UndoShapeOverlap(i0, i1, overlap, normal, point,
+				mMoved[i0] != 0, mMoved[i1] != 0);
+		}
+		return true;
+	}
+
+	Real overlap = GetSphereOverlap(i0, i1);
+	if (overlap > static_cast<Real>(0))
+	{
+		// Contact with an awake sphere wakes a sleeping island.
+		WakeIsland(i0);
+		WakeIsland(i1);
+		UndoSphereOverlap(i0, i1, overlap, mMoved[i0] != 0, mMoved[i1] != 0);
+	}
+	return true;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GetSegment(size_t i, Vector3<Real>& A, Vector3<Real>& E) const
+{
+	Vector3<Real> D = mSpheres.extent[i][2] * mSpheres.rOrientation[i].GetCol(2);
+	A = mSpheres.position[i] - D;
+	E = static_cast<Real>(2) * D;
+}
+
+template <typename Real>
+bool PhysicsModule<Real>::GetShapeContact(size_t i0, size_t i1, Real& overlap,
+	Vector3<Real>& normal, Vector3<Real>& point) const
+{
+	Real const zero = static_cast<Real>(0);
+	uint8_t const shape0 = mSpheres.shape[i0];
+	uint8_t const shape1 = mSpheres.shape[i1];
+	Real const radius0 = mSpheres.shapeRadius[i0];
+	Real const radius1 = mSpheres.shapeRadius[i1];
+
+	if ((shape0 | shape1) == RigidSphereStore<Real>::CAPSULE)
+	{
+		// Capsule-capsule or capsule-sphere.
+		Vector3<Real> A0{}, E0{}, A1{}, E1{};
+		GetSegment(i0, A0, E0);
+		GetSegment(i1, A1, E1);
+		Vector3<Real> r = A0 - A1;
+		Real s{}, t{};
+		GetSegmentParameters(Dot(E0, E0), Dot(E0, E1), Dot(E0, r), Dot(E1, E1),
+			Dot(E1, r), s, t);
+		Vector3<Real> closest0 = A0 + s * E0;
+		Vector3<Real> closest1 = A1 + t * E1;
+		normal = closest1 - closest0;
+		Real const sumRadii = radius0 + radius1;
+		Real const sqrDistance = Dot(normal, normal);
+		if (sqrDistance >= sumRadii * sumRadii)
+		{
+			return false;
+		}
+
+		Real distance = Normalize(normal);
+		if (distance == zero)
+		{
+			// The segments intersect. Separate them perpendicular to both
+			// when they are not parallel and along the centers otherwise.
+			normal = Cross(E0, E1);
+			if (Normalize(normal) == zero)
+			{
+				normal = mSpheres.position[i1] - mSpheres.position[i0];
+				if (Normalize(normal) == zero)
+				{
+					normal = { zero, zero, static_cast<Real>(1) };
+				}
+			}
+			else if (Dot(normal, mSpheres.position[i1] - mSpheres.position[i0]) < zero)
+			{
+				normal = -normal;
+			}
+		}
+		overlap = sumRadii - distance;
+		point = closest0 + radius0 * normal;
+		return true;
+	}
+
+	if ((shape0 | shape1) == RigidSphereStore<Real>::BOX && shape0 != shape1)
+	{
+		// Box-sphere. The closest box point to the sphere center is found
+		// in box coordinates. When the center is inside the box, the
+		// sphere is pushed out through the nearest face.
+		bool const boxFirst = (shape0 == RigidSphereStore<Real>::BOX);
+		size_t const box = (boxFirst ? i0 : i1);
+		size_t const sphere = (boxFirst ? i1 : i0);
+		Real const radius = mSpheres.shapeRadius[sphere];
+		auto const& rotate = mSpheres.rOrientation[box];
+		auto const& extent = mSpheres.extent[box];
+		Vector3<Real> diff = mSpheres.position[sphere] - mSpheres.position[box];
+		Vector3<Real> y{}, clamped{};
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			y[k] = Dot(rotate.GetCol(k), diff);
+			clamped[k] = std::min(std::max(y[k], -extent[k]), extent[k]);
+		}
+
+		Vector3<Real> outward = y - clamped;
+		Real const sqrDistance = Dot(outward, outward);
+		if (sqrDistance >= radius * radius)
+		{
+			return false;
+		}
+
+		if (sqrDistance > zero)
+		{
+			Real const distance = std::sqrt(sqrDistance);
+			overlap = radius - distance;
+			outward /= distance;
+		}
+		else
+		{
+			int32_t face = 0;
+			Real depth = extent[0] - std::fabs(y[0]);
+			for (int32_t k = 1; k < 3; ++k)
+			{
+				Real const faceDepth = extent[k] - std::fabs(y[k]);
+				if (faceDepth < depth)
+				{
+					depth = faceDepth;
+					face = k;
+				}
+			}
+			outward = Vector3<Real>::Zero();
+			outward[face] = (y[face] >= zero ? static_cast<Real>(1) : static_cast<Real>(-1));
+			clamped[face] = outward[face] * extent[face];
+			overlap = radius + depth;
+		}
+
+		// The normal from the box to the sphere and the closest box point
+		// in world coordinates.
+		Vector3<Real> boxNormal = rotate * outward;
+		Vector3<Real> boxPoint = mSpheres.position[box] + rotate * clamped;
+		if (boxFirst)
+		{
+			normal = boxNormal;
+			point = boxPoint;
+		}
+		else
+		{
+			normal = -boxNormal;
+			point = mSpheres.position[sphere] + radius * normal;
+		}
+		return true;
+	}
+
+	// Box-box and box-capsule use the bounding spheres.
+	overlap = GetSphereOverlap(i0, i1);
+	if (overlap > zero)
+	{
+		normal = mSpheres.position[i1] - mSpheres.position[i0];
+		Normalize(normal);
+		point = mSpheres.position[i0] + mSpheres.radius[i0] * normal;
+		return true;
+	}
+	return false;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::DoCollisionResponse()
+{
+	GTE_TRACE_SCOPE("PhysicsModule::DoCollisionResponse");
+	ScopedTimer timer(mTickStatistics.responseNanoseconds);
+
+	// Apply the instantaneous impulse forces at the current time.
+	if (mSolver == Solver::SEQUENTIAL_IMPULSE)
+	{
+		SolveContacts();
+	}
+	else if (mSolver == Solver::LCP)
+	{
+		SolveContactsLCP();
+	}
+	else
+	{
+		mContactBodies.resize(mContacts.size());
+		for (size_t k = 0; k < mContacts.size(); ++k)
+		{
+			auto const& contact = mContacts[k];
+			mContactBodies[k] = { contact.i0, contact.isPlane ? InvalidIndex : contact.i1 };
+		}
+		ColorContacts();
+		RunColors([this](size_t, size_t begin, size_t end)
+		{
+			ApplyImpulses(begin, end);
+		});
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ColorContacts()
+{
+	size_t const numContacts = mContactBodies.size();
+	mColorMasks.assign(mSpheres.GetNumSpheres(), 0);
+	mContactColors.resize(numContacts);
+	mColorStarts.assign(MaxContactColors + 2, 0);
+	for (size_t k = 0; k < numContacts; ++k)
+	{
+		uint64_t used = 0;
+		for (auto const i : mContactBodies[k])
+		{
+			if (i != InvalidIndex && mSpheres.IsMovable(i))
+			{
+				used |= mColorMasks[i];
+			}
+		}
+
+		size_t color = 0;
+		while (color < MaxContactColors && (used & (uint64_t(1) << color)) != 0)
+		{
+			++color;
+		}
+		if (color < MaxContactColors)
+		{
+			for (auto const i : mContactBodies[k])
+			{
+				if (i != InvalidIndex && mSpheres.IsMovable(i))
+				{
+					mColorMasks[i] |= uint64_t(1) << color;
+				}
+			}
+		}
+		mContactColors[k] = color;
+		++mColorStarts[color + 1];
+	}
+
+	// A stable counting sort by color.
+	mNumContactColors = 0;
+	for (size_t c = 0; c <= MaxContactColors; ++c)
+	{
+		if (mColorStarts[c + 1] > 0)
+		{
+			mNumContactColors = c + 1;
+		}
+		mColorStarts[c + 1] += mColorStarts[c];
+	}
+	mColorContacts.resize(numContacts);
+	for (size_t k = 0; k < numContacts; ++k)
+	{
+		mColorContacts[mColorStarts[mContactColors[k]]++] = k;
+	}
+	for (size_t c = MaxContactColors + 1; c > 0; --c)
+	{
+		mColorStarts[c] = mColorStarts[c - 1];
+	}
+	mColorStarts[0] = 0;
+}
+
+template <typename Real>
+template <typename Function>
+void PhysicsModule<Real>::RunColors(Function const& function)
+{
+	if (mNumThreads == 0)
+	{
+		for (size_t c = 0; c < mNumContactColors; ++c)
+		{
+			function(0, mColorStarts[c], mColorStarts[c + 1]);
+		}
+		return;
+	}
+
+	// All the colors are processed in one call of the team. The workers
+	// meet at a barrier between two colors unless both are processed by
+	// worker 0, and every worker evaluates the same conditions, so they
+	// call Barrier the same number of times.
+	auto isSplit = [this](size_t c)
+	{
+		return c != MaxContactColors &&
+			mColorStarts[c + 1] - mColorStarts[c] >= MinColorContactsPerThread * mNumThreads;
+	};
+
+	WorkerTeam& team = GetTeam();
+	team.Run([this, &function, &team, &isSplit](size_t t)
+	{
+		for (size_t c = 0; c < mNumContactColors; ++c)
+		{
+			size_t const begin = mColorStarts[c], end = mColorStarts[c + 1];
+			bool const split = isSplit(c);
+			if (split)
+			{
+				size_t const numBatches = (end - begin + BatchSize - 1) / BatchSize;
+				size_t const first = begin + numBatches * t / mNumThreads * BatchSize;
+				size_t const last = (t + 1 < mNumThreads ?
+					begin + numBatches * (t + 1) / mNumThreads * BatchSize : end);
+				function(t, first, last);
+			}
+			else if (t == 0)
+			{
+				function(0, begin, end);
+			}
+
+			if (c + 1 < mNumContactColors && (split || isSplit(c + 1)))
+			{
+				team.Barrier();
+			}
+		}
+	});
+}
+
+template <typename Real>
+void PhysicsModule<Real>::DoIntegration(double time, double deltaTime)
+{
+	GTE_TRACE_SCOPE("PhysicsModule::DoIntegration");
+	// Solve the equations of motion. The spheres are independent, so the
+	// threads integrate ranges of spheres aligned to the batch size and
+	// the results do not depend on the number of threads.
+	ScopedTimer timer(mTickStatistics.integrationNanoseconds);
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+#if !defined(PHYSICS_MODULE_NO_STATISTICS)
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mSpheres.IsMovable(i) && mAwake[i] != 0)
+		{
+			++mTickStatistics.numBodiesIntegrated;
+		}
+	}
+	mTickStatistics.numIntegrationSteps = mTickStatistics.numBodiesIntegrated;
+#endif
+	if (mIntegrator == Integrator::ADAPTIVE)
+	{
+		IntegrateSpheresAdaptive(time, deltaTime);
+	}
+	else if (mNumThreads == 0)
+	{
+		IntegrateSpheres(0, numSpheres, time, deltaTime);
+	}
+	else
+	{
+		GetSphereBounds(numSpheres, BatchSize);
+		RunThreads([this, time, deltaTime](size_t, size_t begin, size_t end)
+		{
+			IntegrateSpheres(begin, end, time, deltaTime);
+		});
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::DoContinuousCollision(double deltaTime)
+{
+	ScopedTimer timer(mTickStatistics.continuousNanoseconds);
+
+	// Mark the spheres that moved farther than their radius. The discrete
+	// detection of the next tick handles the slower spheres and the
+	// capsules and boxes.
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	mFast.assign(numSpheres, 0);
+	mFastSpheres.clear();
+	mSweptContacts.clear();
+	mNumSweptContacts = 0;
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mAwake[i] != 0 && mSpheres.IsMovable(i) &&
+			mSpheres.shape[i] == RigidSphereStore<Real>::SPHERE)
+		{
+			auto displacement = mSpheres.position[i] - mSweepStart[i];
+			Real const radius = mSpheres.radius[i];
+			if (Dot(displacement, displacement) > radius * radius)
+			{
+				mFast[i] = 1;
+				mFastSpheres.push_back(i);
+			}
+		}
+	}
+	if (mFastSpheres.empty())
+	{
+		return;
+	}
+
+	PrepareSweptQueries();
+	for (auto i : mFastSpheres)
+	{
+		FindSweptContacts(i);
+	}
+	FindFastSweptContacts();
+	std::sort(mSweptContacts.begin(), mSweptContacts.end());
+
+	for (auto const& swept : mSweptContacts)
+	{
+		size_t const a = swept.i0;
+		size_t const b = swept.i1;
+		if (mFast[a] == 2 || (!swept.isPlane && mFast[b] == 2))
+		{
+			// One of the spheres was already sub-stepped on this tick.
+			continue;
+		}
+
+		// Move the spheres back to their positions at the time of impact
+		// and create the contact as the discrete detection would.
+		auto& centerA = mSpheres.position[a];
+		centerA = mSweepStart[a] + swept.t * (centerA - mSweepStart[a]);
+		Contact contact{};
+		contact.i0 = a;
+		contact.i1 = b;
+		contact.isPlane = swept.isPlane;
+		Vector3<Real> velDiff = mSpheres.linearVelocity[a];
+		if (swept.isPlane)
+		{
+			contact.P = centerA;
+			contact.N = mRigidPlane[b]->GetPlane().normal;
+		}
+		else
+		{
+			WakeIsland(b);
+			auto& centerB = mSpheres.position[b];
+			centerB = mSweepStart[b] + swept.t * (centerB - mSweepStart[b]);
+			contact.N = centerB - centerA;
+			Normalize(contact.N);
+			contact.P = centerA + mSpheres.radius[a] * contact.N;
+			velDiff -= mSpheres.linearVelocity[b];
+		}
+
+		// The normal of a plane contact points to the sphere and that of a
+		// sphere contact points from sphere a to sphere b.
+		Real const approach = Dot(contact.N, velDiff);
+		if ((swept.isPlane && approach < static_cast<Real>(0)) ||
+			(!swept.isPlane && approach > static_cast<Real>(0)))
+		{
+			ApplyImpulse(contact);
+		}
+		mContacts.push_back(contact);
+		++mNumSweptContacts;
+
+		// Advance the spheres with their new velocities for the remainder
+		// of the tick.
+		Real const remaining = static_cast<Real>((1.0 - swept.t) * deltaTime);
+		centerA += remaining * mSpheres.linearVelocity[a];
+		mFast[a] = 2;
+		if (!swept.isPlane)
+		{
+			mSpheres.position[b] += remaining * mSpheres.linearVelocity[b];
+			mFast[b] = 2;
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::PrepareSweptQueries()
+{
+	ScopedTimer timer(mTickStatistics.broadphaseNanoseconds);
+	if (mActiveBroadphase == Broadphase::UNIFORM_GRID && mGrid.IsInitialized())
+	{
+		mGrid.Bin(mSpheres.position);
+	}
+	else if (mActiveBroadphase == Broadphase::AABB_TREE)
+	{
+		UpdateTree();
+	}
+	else
+	{
+		size_t const numSpheres = mSpheres.GetNumSpheres();
+		mSweepOrder.resize(numSpheres);
+		for (size_t i = 0; i < numSpheres; ++i)
+		{
+			mSweepOrder[i] = i;
+		}
+		std::sort(mSweepOrder.begin(), mSweepOrder.end(),
+			[this](size_t i0, size_t i1)
+			{
+				return mSpheres.position[i0][0] < mSpheres.position[i1][0];
+			});
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::FindSweptContacts(size_t i)
+{
+	// The motion over the tick is X(t) = X0 + t * D for t in [0,1]. Only
+	// impacts of spheres that do not touch at t = 0 are reported; contacts
+	// at the start of the tick were handled by the discrete detection.
+	Vector3<Real> const& X0 = mSweepStart[i];
+	Vector3<Real> const& X1 = mSpheres.position[i];
+	Real const radius = mSpheres.radius[i];
+
+	// The signed distance to a plane is linear in t.
+	for (size_t p = 0; p < 6; ++p)
+	{
+		if (mPlaneOpen[p] != 0)
+		{
+			continue;
+		}
+
+		Real s0 = mRigidPlane[p]->GetSignedDistance(X0);
+		Real s1 = mRigidPlane[p]->GetSignedDistance(X1);
+		if (s0 >= radius && s1 < radius)
+		{
+			mSweptContacts.push_back({ (s0 - radius) / (s0 - s1), i, p, true });
+		}
+	}
+
+	// A sphere that is not fast is within its radius of its final
+	// position during the tick, so an impact requires its final center to
+	// be within radius + 2 * mMaxRadius of the swept box.
+	Real const margin = radius + static_cast<Real>(2) * mMaxRadius;
+	gte::AlignedBox3<Real> box{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		box.min[d] = std::min(X0[d], X1[d]) - margin;
+		box.max[d] = std::max(X0[d], X1[d]) + margin;
+	}
+
+	mSweptCandidates.clear();
+	if (mActiveBroadphase == Broadphase::UNIFORM_GRID && mGrid.IsInitialized())
+	{
+		mGrid.Query(box.min, box.max, mSweptCandidates);
+	}
+	else if (mActiveBroadphase == Broadphase::AABB_TREE)
+	{
+		// The fat boxes contain the final bounding boxes of the spheres,
+		// so the query box is shrunk by the largest radius.
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			box.min[d] += mMaxRadius;
+			box.max[d] -= mMaxRadius;
+		}
+		mTree.Query(box, mSweptCandidates);
+	}
+	else
+	{
+		auto lower = std::lower_bound(mSweepOrder.begin(), mSweepOrder.end(), box.min[0],
+			[this](size_t j, Real x) { return mSpheres.position[j][0] < x; });
+		for (auto iter = lower; iter != mSweepOrder.end() &&
+			mSpheres.position[*iter][0] <= box.max[0]; ++iter)
+		{
+			mSweptCandidates.push_back(*iter);
+		}
+	}
+
+	for (auto j : mSweptCandidates)
+	{
+		if (mFast[j] == 0 && mSpheres.shape[j] == RigidSphereStore<Real>::SPHERE)
+		{
+			AddSweptContact(i, j);
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::FindFastSweptContacts()
+{
+	// The swept box of fast sphere i is the bounding box of its spheres at
+	// the start and the end of the tick.
+	auto getBound = [this](size_t i, int32_t d, bool isMax)
+	{
+		Real const x0 = mSweepStart[i][d], x1 = mSpheres.position[i][d];
+		Real const radius = mSpheres.radius[i];
+		return (isMax ? std::max(x0, x1) + radius : std::min(x0, x1) - radius);
+	};
+
+	mFastOrder.clear();
+	for (auto i : mFastSpheres)
+	{
+		mFastOrder.emplace_back(getBound(i, 0, false), i);
+	}
+	std::sort(mFastOrder.begin(), mFastOrder.end());
+
+	for (size_t k0 = 0; k0 < mFastOrder.size(); ++k0)
+	{
+		size_t const i0 = mFastOrder[k0].second;
+		Real const xMax = getBound(i0, 0, true);
+		for (size_t k1 = k0 + 1; k1 < mFastOrder.size() && mFastOrder[k1].first <= xMax; ++k1)
+		{
+			size_t const i1 = mFastOrder[k1].second;
+			if (getBound(i0, 1, false) <= getBound(i1, 1, true) &&
+				getBound(i1, 1, false) <= getBound(i0, 1, true) &&
+				getBound(i0, 2, false) <= getBound(i1, 2, true) &&
+				getBound(i1, 2, false) <= getBound(i0, 2, true))
+			{
+				AddSweptContact(std::min(i0, i1), std::max(i0, i1));
+			}
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::AddSweptContact(size_t i, size_t j)
+{
+	// The spheres touch when |delta0 + t * deltaD| = r0 + r1, a quadratic
+	// equation a*t^2 + 2*b*t + c = 0. The first root is the time of impact
+	// when the spheres approach each other.
+	auto delta0 = mSweepStart[j] - mSweepStart[i];
+	auto deltaD = (mSpheres.position[j] - mSweepStart[j]) -
+		(mSpheres.position[i] - mSweepStart[i]);
+	Real sumRadii = mSpheres.radius[i] + mSpheres.radius[j];
+	Real c = Dot(delta0, delta0) - sumRadii * sumRadii;
+	Real b = Dot(delta0, deltaD);
+	if (c <= static_cast<Real>(0) || b >= static_cast<Real>(0))
+	{
+		return;
+	}
+
+	Real a = Dot(deltaD, deltaD);
+	Real discr = b * b - a * c;
+	if (discr >= static_cast<Real>(0))
+	{
+		Real t = (-b - std::sqrt(discr)) / a;
+		if (t <= static_cast<Real>(1))
+		{
+			mSweptContacts.push_back({ t, i, j, false });
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetSpherePlaneContact(size_t sphere, size_t plane,
+	Real overlap, std::vector<Contact>& contacts)
+{
+	SetStaticContact(sphere, plane, overlap, mRigidPlane[plane]->GetPlane().normal, contacts);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::SetStaticContact(size_t sphere, size_t i1,
+	Real overlap, Vector3<Real> const& normal, std::vector<Contact>& contacts)
+{
+	Contact contact{};
+	contact.i0 = sphere;
+	contact.i1 = i1;
+	contact.isPlane = true;
+	contact.P = mSpheres.position[sphere] + overlap * normal;
+	contact.N = normal;
+
+	// Move the intersecting sphere to be just touching the plane or the
+	// collider.
+	mSpheres.position[sphere] = contact.P;
+	mMoved[sphere] = 1;
+	if (mSpheres.shape[sphere] != RigidSphereStore<Real>::SPHERE)
+	{
+		contact.P = mSpheres.GetSupportPoint(sphere, -normal);
+	}
+	contacts.push_back(contact);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::UndoSphereOverlap(size_t sphere0, size_t sphere1,
+	Real overlap, bool moved0, bool moved1)
+{
+	auto& center0 = mSpheres.position[sphere0];
+	auto& center1 = mSpheres.position[sphere1];
+	auto normal = center1 - center0;
+	Normalize(normal);
+
+	Contact contact{};
+	contact.i0 = sphere0;
+	contact.i1 = sphere1;
+	contact.isPlane = false;
+	contact.N = normal;
+	auto offset = overlap * contact.N;
+
+	if (moved0 && !moved1)
+	{
+		// Sphere i0 moved but sphere i1 did not.
+		center1 += offset;
+	}
+	else if (!moved0 && moved1)
+	{
+		// Sphere i1 moved but sphere i0 did not.
+		center0 -= offset;
+	}
+	else
+	{
+		// Neither sphere moved or both spheres moved. Avoid bias
+		// by moving both spheres half the offset.
+		offset *= 0.5;
+		center1 += offset;
+		center0 -= offset;
+	}
+
+	contact.P = center0 + mSpheres.radius[sphere0] * contact.N;
+	mContacts.push_back(contact);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::UndoShapeOverlap(size_t sphere0, size_t sphere1,
+	Real overlap, Vector3<Real> const& normal, Vector3<Real> const& point,
+	bool moved0, bool moved1)
+{
+	Contact contact{};
+	contact.i0 = sphere0;
+	contact.i1 = sphere1;
+	contact.isPlane = false;
+	contact.N = normal;
+	contact.P = point;
+	auto offset = overlap * normal;
+
+	if (moved0 && !moved1)
+	{
+		mSpheres.position[sphere1] += offset;
+	}
+	else if (!moved0 && moved1)
+	{
+		mSpheres.position[sphere0] -= offset;
+		contact.P -= offset;
+	}
+	else
+	{
+		offset *= static_cast<Real>(0.5);
+		mSpheres.position[sphere1] += offset;
+		mSpheres.position[sphere0] -= offset;
+		contact.P -= offset;
+	}
+	mContacts.push_back(contact);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ApplyImpulse(Contact const& contact)
+{
+	size_t const a = contact.i0;
+	size_t const b = contact.i1;
+	Vector3<Real> const& P = contact.P;
+	Vector3<Real> const& N = contact.N;
+	Vector3<Real> const zeroVector = Vector3<Real>::Zero();
+
+	// The location of the contact points relative to the centers of mass.
+	// The plane is immovable, so its terms vanish; rB is not needed.
+	Vector3<Real> rA = P - mSpheres.position[a];
+	Vector3<Real> rB = (contact.isPlane ? zeroVector : P - mSpheres.position[b]);
+
+	// The preimpulse linear and angular velocities of the centers of mass.
+	Vector3<Real> linvelANeg = mSpheres.linearVelocity[a];
+	Vector3<Real> linvelBNeg = (contact.isPlane ? zeroVector : mSpheres.linearVelocity[b]);
+	Vector3<Real> angvelANeg = mSpheres.angularVelocity[a];
+	Vector3<Real> angvelBNeg = (contact.isPlane ? zeroVector : mSpheres.angularVelocity[b]);
+
+	// The preimpulse velocities of P0.
+	auto velANeg = linvelANeg + Cross(angvelANeg, rA);
+	auto velBNeg = linvelBNeg + Cross(angvelBNeg, rB);
+	auto velDiffNeg = velANeg - velBNeg;
+
+	// The inverse masses and the quadratic forms of the inverse world
+	// inertia tensors, added to the specified base.
+	Real invMassB = (contact.isPlane ? static_cast<Real>(0) : mSpheres.invMass[b]);
+	Real sumInvMasses = mSpheres.invMass[a] + invMassB;
+	auto invJ = [this, &contact, a, b](Real base, Vector3<Real> const& rAxU,
+		Vector3<Real> const& rAxV, Vector3<Real> const& rBxU, Vector3<Real> const& rBxV)
+	{
+		Real form = base + mSpheres.GetInverseInertiaForm(a, rAxU, rAxV);
+		if (!contact.isPlane)
+		{
+			form += mSpheres.GetInverseInertiaForm(b, rBxU, rBxV);
+		}
+		return form;
+	};
+
+	Real const restitution = mRestitution;
+	Vector3<Real> impulse{};
+	Vector3<Real> T0 = velDiffNeg - Dot(N, velDiffNeg) * N;
+	Normalize(T0);
+	if (T0 != zeroVector)
+	{
+		// T0 is tangent at P, unit length and perpendicular to N.
+		Vector3<Real> T1 = Cross(N, T0);
+		auto rAxN = Cross(rA, N);
+		auto rAxT0 = Cross(rA, T0);
+		auto rAxT1 = Cross(rA, T1);
+		auto rBxN = Cross(rB, N);
+		auto rBxT0 = Cross(rB, T0);
+		auto rBxT1 = Cross(rB, T1);
+
+		// The matrix constructed here is positive definite. This ensures
+		// the linear system always has a solution, so the bool return
+		// value from LinearSystem<T>::Solve is ignored.
+		Matrix3x3<Real> sysMatrix{};
+		Real const zero = static_cast<Real>(0);
+		sysMatrix(0, 0) = invJ(sumInvMasses, rAxN, rAxN, rBxN, rBxN);
+		sysMatrix(1, 1) = invJ(sumInvMasses, rAxT0, rAxT0, rBxT0, rBxT0);
+		sysMatrix(2, 2) = invJ(sumInvMasses, rAxT1, rAxT1, rBxT1, rBxT1);
+		sysMatrix(0, 1) = invJ(zero, rAxN, rAxT0, rBxN, rBxT0);
+		sysMatrix(0, 2) = invJ(zero, rAxN, rAxT1, rBxN, rBxT1);
+		sysMatrix(1, 2) = invJ(zero, rAxT0, rAxT1, rBxT0, rBxT1);
+		sysMatrix(1, 0) = sysMatrix(0, 1);
+		sysMatrix(2, 0) = sysMatrix(0, 2);
+		sysMatrix(2, 1) = sysMatrix(1, 2);
+		Vector3<Real> sysInput{};
+		sysInput[0] = -(static_cast<Real>(1) + restitution) * Dot(N, velDiffNeg);
+		sysInput[1] = 0.0;
+		sysInput[2] = 0.0;
+		Vector3<Real> sysOutput{};
+		(void)LinearSystem<Real>::Solve(sysMatrix, sysInput, sysOutput);
+		impulse = sysOutput[0] * N + sysOutput[1] * T0 + sysOutput[2] * T1;
+	}
+	else
+	{
+		// Fall back to the impulse force f*N0 when the relative velocity at
+		// the contact P0 is parallel to N0.
+		auto rAxN = Cross(rA, N);
+		auto rBxN = Cross(rB, N);
+		// The magnitude of the impulse force.
+		Real numer = -(static_cast<Real>(1) + restitution) * Dot(N, velDiffNeg);
+		Real denom = invJ(sumInvMasses, rAxN, rAxN, rBxN, rBxN);
+		Real f = numer / denom;
+		impulse = f * N;
+	}
+
+	// Apply the impulsive force to the bodies to change linear and angular
+	// momentum.
+	mSpheres.SetLinearMomentum(a, mSpheres.linearMomentum[a] + impulse);
+	mSpheres.SetAngularMomentum(a, mSpheres.angularMomentum[a] + Cross(rA, impulse));
+	if (!contact.isPlane)
+	{
+		mSpheres.SetLinearMomentum(b, mSpheres.linearMomentum[b] - impulse);
+		mSpheres.SetAngularMomentum(b, mSpheres.angularMomentum[b] - Cross(rB, impulse));
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::IntegrateSpheres(size_t begin, size_t end, double t, double dt)
+{
+	size_t first = begin;
+	if (mIntegrator == Integrator::BATCHED &&
+		mIntegrationMethod == IntegrationMethod::RUNGE_KUTTA)
+	{
+		// The lanes of a batch share the scalar inertia of the spheres, so
+		// a batch that contains an anisotropic capsule or box is stepped
+		// one body at a time.
+		for (; first + BatchSize <= end; first += BatchSize)
+		{
+			bool isotropic = true;
+			for (size_t j = 0; j < BatchSize; ++j)
+			{
+				isotropic = isotropic && mSpheres.IsIsotropic(first + j);
+			}
+
+			if (isotropic)
+			{
+				IntegrateSphereBatch(first, t, dt);
+				continue;
+			}
+			for (size_t i = first; i < first + BatchSize; ++i)
+			{
+				if (mSpheres.IsMovable(i) && mAwake[i] != 0)
+				{
+					StepSphere(i, t, dt);
+				}
+			}
+		}
+	}
+
+	// All spheres in SCALAR mode, the remaining spheres in BATCHED mode.
+	for (size_t i = first; i < end; ++i)
+	{
+		if (mSpheres.IsMovable(i) && mAwake[i] != 0)
+		{
+			StepSphere(i, t, dt);
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GroupStepLevels(double deltaTime)
+{
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	size_t const numLevels = mAdaptiveMaxLevel + 1;
+	mStepLevels.resize(numSpheres);
+	mLevelStarts.assign(numLevels + 1, 0);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mSpheres.IsMovable(i) && mAwake[i] != 0)
+		{
+			// The smallest level with |W|*deltaTime/2^level <= maxAngle.
+			Real angle = Length(mSpheres.angularVelocity[i]) * static_cast<Real>(deltaTime);
+			size_t level = 0;
+			while (angle > mAdaptiveMaxAngle && level < mAdaptiveMaxLevel)
+			{
+				angle *= static_cast<Real>(0.5);
+				++level;
+			}
+			mStepLevels[i] = static_cast<uint8_t>(level);
+			++mLevelStarts[level + 1];
+		}
+		else
+		{
+			mStepLevels[i] = std::numeric_limits<uint8_t>::max();
+		}
+	}
+
+	for (size_t level = 0; level < numLevels; ++level)
+	{
+		mLevelStarts[level + 1] += mLevelStarts[level];
+	}
+	mLevelSpheres.resize(mLevelStarts[numLevels]);
+	std::array<size_t, 17> next{};
+	std::copy(mLevelStarts.begin(), mLevelStarts.end() - 1, next.begin());
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		if (mStepLevels[i] != std::numeric_limits<uint8_t>::max())
+		{
+			mLevelSpheres[next[mStepLevels[i]]++] = i;
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::IntegrateSpheresAdaptive(double time, double deltaTime)
+{
+	GroupStepLevels(deltaTime);
+
+	size_t const numLevels = mAdaptiveMaxLevel + 1;
+	for (size_t level = 0; level < numLevels; ++level)
+	{
+		size_t const begin = mLevelStarts[level];
+		size_t const end = mLevelStarts[level + 1];
+		if (begin == end)
+		{
+			continue;
+		}
+
+		size_t const numSubsteps = static_cast<size_t>(1) << level;
+		double const h = deltaTime / static_cast<double>(numSubsteps);
+		auto function = [this, time, h, numSubsteps](size_t, size_t first, size_t last)
+		{
+			for (size_t k = first; k < last; ++k)
+			{
+				size_t const i = mLevelSpheres[k];
+				for (size_t s = 0; s < numSubsteps; ++s)
+				{
+					StepSphere(i, time + static_cast<double>(s) * h, h);
+				}
+			}
+		};
+
+		if (end - begin < mNumThreads || mNumThreads == 0)
+		{
+			function(0, begin, end);
+		}
+		else
+		{
+			mBounds.resize(mNumThreads + 1);
+			for (size_t t = 0; t <= mNumThreads; ++t)
+			{
+				mBounds[t] = begin + (end - begin) * t / mNumThreads;
+			}
+			RunThreads(function);
+		}
+		AddCount(mTickStatistics.numIntegrationSteps, (end - begin) * (numSubsteps - 1));
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::StepSphere(size_t i, double t, double dt)
+{
+	switch (mIntegrationMethod)
+	{
+	case IntegrationMethod::SEMI_IMPLICIT_EULER:
+		StepSphereSemiImplicitEuler(i, t, dt);
+		break;
+	case IntegrationMethod::VELOCITY_VERLET:
+		StepSphereVelocityVerlet(i, t, dt);
+		break;
+	default:
+		IntegrateSphere(i, t, dt);
+		break;
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::StepSphereSemiImplicitEuler(size_t i, double t, double dt)
+{
+	Real const half = static_cast<Real>(0.5);
+	Real const fullDT = static_cast<Real>(dt);
+
+	Real const invMass = mSpheres.invMass[i];
+	Vector3<Real> const X0 = mSpheres.position[i];
+	Quaternion<Real> const Q0 = mSpheres.qOrientation[i];
+	Vector3<Real> const V0 = mSpheres.linearVelocity[i];
+	Vector3<Real> const W0 = mSpheres.angularVelocity[i];
+
+	Vector3<Real> const P0 = mSpheres.linearMomentum[i];
+	Vector3<Real> const L0 = mSpheres.angularMomentum[i];
+	Vector3<Real> P = P0 + fullDT * GetForce(i, t, X0, V0);
+	Vector3<Real> L = L0 + fullDT * GetTorque(i, t, X0, W0);
+	StopReversedFriction(P0, L0, P, L);
+	Vector3<Real> V = invMass * P;
+	Vector3<Real> W = mSpheres.MultiplyInverseInertia(i, L);
+
+	mSpheres.position[i] = X0 + fullDT * V;
+	mSpheres.SetQOrientation(i, Q0 + (half * fullDT) * Quaternion<Real>(W[0], W[1], W[2], 0.0) * Q0);
+	mSpheres.SetLinearMomentum(i, P);
+	mSpheres.SetAngularMomentum(i, L);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::StepSphereVelocityVerlet(size_t i, double t, double dt)
+{
+	Real const halfDT = static_cast<Real>(0.5 * dt);
+	Real const fullDT = static_cast<Real>(dt);
+
+	Real const invMass = mSpheres.invMass[i];
+	Vector3<Real> const X0 = mSpheres.position[i];
+	Quaternion<Real> const Q0 = mSpheres.qOrientation[i];
+	Vector3<Real> const V0 = mSpheres.linearVelocity[i];
+	Vector3<Real> const W0 = mSpheres.angularVelocity[i];
+
+	// The momenta at the half step. The second half step evaluates the
+	// velocity-dependent friction with the half-step velocities.
+	Vector3<Real> const P0 = mSpheres.linearMomentum[i];
+	Vector3<Real> const L0 = mSpheres.angularMomentum[i];
+	Vector3<Real> P = P0 + halfDT * GetForce(i, t, X0, V0);
+	Vector3<Real> L = L0 + halfDT * GetTorque(i, t, X0, W0);
+	StopReversedFriction(P0, L0, P, L);
+	Vector3<Real> const PHalf = P;
+	Vector3<Real> const LHalf = L;
+	Vector3<Real> V = invMass * P;
+	Vector3<Real> W = mSpheres.MultiplyInverseInertia(i, L);
+
+	Vector3<Real> const X = X0 + fullDT * V;
+	P = PHalf + halfDT * GetForce(i, t + dt, X, V);
+	L = LHalf + halfDT * GetTorque(i, t + dt, X, W);
+	StopReversedFriction(PHalf, LHalf, P, L);
+
+	mSpheres.position[i] = X;
+	mSpheres.SetQOrientation(i, Q0 + halfDT * Quaternion<Real>(W[0], W[1], W[2], 0.0) * Q0);
+	mSpheres.SetLinearMomentum(i, P);
+	mSpheres.SetAngularMomentum(i, L);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::IntegrateSphere(size_t i, double t, double dt)
+{
+	Real const half = static_cast<Real>(0.5);
+	Real const halfDT = static_cast<Real>(0.5 * dt);
+	Real const fullDT = static_cast<Real>(dt);
+	double const sixthDT = dt / 6.0;
+	double const TpHalfDT = t + 0.5 * dt;
+	double const TpDT = t + dt;
+
+	Real const invMass = mSpheres.invMass[i];
+	Vector3<Real> const X0 = mSpheres.position[i];
+	Quaternion<Real> const Q0 = mSpheres.qOrientation[i];
+	Vector3<Real> const P0 = mSpheres.linearMomentum[i];
+	Vector3<Real> const L0 = mSpheres.angularMomentum[i];
+	Vector3<Real> const V0 = mSpheres.linearVelocity[i];
+	Vector3<Real> const W0 = mSpheres.angularVelocity[i];
+
+	// The intermediate states B1, B2 and B3.
+	Vector3<Real> X{}, P{}, L{}, V{}, W{};
+	Quaternion<Real> Q{};
+
+	// A1 = G(T,S0), B1 = S0 + (DT/2)*A1
+	Vector3<Real> A1DXDT = V0;
+	Quaternion<Real> A1DQDT = half * Quaternion<Real>(W0[0], W0[1], W0[2], 0.0) * Q0;
+	Vector3<Real> A1DPDT = GetForce(i, t, X0, V0);
+	Vector3<Real> A1DLDT = GetTorque(i, t, X0, W0);
+	X = X0 + halfDT * A1DXDT;
+	Q = Q0 + halfDT * A1DQDT;
+	Normalize(Q);
+	P = P0 + halfDT * A1DPDT;
+	L = L0 + halfDT * A1DLDT;
+	V = invMass * P;
+	W = mSpheres.MultiplyInverseInertia(i, Q, L);
+
+	// A2 = G(T+DT/2,B1), B2 = S0 + (DT/2)*A2
+	Vector3<Real> A2DXDT = V;
+	Quaternion<Real> A2DQDT = half * Quaternion<Real>(W[0], W[1], W[2], 0.0) * Q;
+	Vector3<Real> A2DPDT = GetForce(i, TpHalfDT, X, V);
+	Vector3<Real> A2DLDT = GetTorque(i, TpHalfDT, X, W);
+	X = X0 + halfDT * A2DXDT;
+	Q = Q0 + halfDT * A2DQDT;
+	Normalize(Q);
+	P = P0 + halfDT * A2DPDT;
+	L = L0 + halfDT * A2DLDT;
+	V = invMass * P;
+	W = mSpheres.MultiplyInverseInertia(i, Q, L);
+
+	// A3 = G(T+DT/2,B2), B3 = S0 + DT*A3
+	Vector3<Real> A3DXDT = V;
+	Quaternion<Real> A3DQDT = half * Quaternion<Real>(W[0], W[1], W[2], 0.0) * Q;
+	Vector3<Real> A3DPDT = GetForce(i, TpHalfDT, X, V);
+	Vector3<Real> A3DLDT = GetTorque(i, TpHalfDT, X, W);
+	X = X0 + fullDT * A3DXDT;
+	Q = Q0 + fullDT * A3DQDT;
+	Normalize(Q);
+	P = P0 + fullDT * A3DPDT;
+	L = L0 + fullDT * A3DLDT;
+	V = invMass * P;
+	W = mSpheres.MultiplyInverseInertia(i, Q, L);
+
+	// A4 = G(T+DT,B3), S1 = S0 + (DT/6)*(A1+2*(A2+A3)+A4)
+	Vector3<Real> A4DXDT = V;
+	Quaternion<Real> A4DQDT = half * Quaternion<Real>(W[0], W[1], W[2], 0.0) * Q;
+	Vector3<Real> A4DPDT = GetForce(i, TpDT, X, V);
+	Vector3<Real> A4DLDT = GetTorque(i, TpDT, X, W);
+
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		X[k] = CombineStages(X0[k], sixthDT, A1DXDT[k], A2DXDT[k], A3DXDT[k], A4DXDT[k]);
+		P[k] = CombineStages(P0[k], sixthDT, A1DPDT[k], A2DPDT[k], A3DPDT[k], A4DPDT[k]);
+		L[k] = CombineStages(L0[k], sixthDT, A1DLDT[k], A2DLDT[k], A3DLDT[k], A4DLDT[k]);
+	}
+	for (int32_t k = 0; k < 4; ++k)
+	{
+		Q[k] = CombineStages(Q0[k], sixthDT, A1DQDT[k], A2DQDT[k], A3DQDT[k], A4DQDT[k]);
+	}
+
+	mSpheres.position[i] = X;
+	mSpheres.SetQOrientation(i, Q);
+	mSpheres.SetLinearMomentum(i, P);
+	mSpheres.SetAngularMomentum(i, L);
+}
+
+template <typename Real>
+void PhysicsModule<Real>::EvaluateBatch(size_t first, BatchState const& state,
+	BatchState& derivative) const
+{
+	// The force and torque are those of GetForce and GetTorque. The
+	// branches are replaced by selects so that the loop has no control
+	// flow, and each expression is evaluated in the same order as in the
+	// Vector3<Real> and Quaternion<Real> operators.
+	Real constexpr gravityConstant = static_cast<Real>(9.81);   // m/sec^2
+	Real constexpr epsilon = static_cast<Real>(1e-03);
+	Real constexpr viscosity = static_cast<Real>(1000.0);
+	Real constexpr zero = static_cast<Real>(0);
+	Real constexpr one = static_cast<Real>(1);
+	Real constexpr half = static_cast<Real>(0.5);
+	for (size_t j = 0; j < BatchSize; ++j)
+	{
+		Real const mass = mSpheres.mass[first + j];
+		Real const radius = mSpheres.radius[first + j];
+		Real const inertia = mSpheres.inertia[first + j][0];
+		Real const vx = state.V[0][j], vy = state.V[1][j], vz = state.V[2][j];
+		Real const wx = state.W[0][j], wy = state.W[1][j], wz = state.W[2][j];
+		Real const qx = state.Q[0][j], qy = state.Q[1][j];
+		Real const qz = state.Q[2][j], qw = state.Q[3][j];
+
+		// dX/dt = V
+		derivative.X[0][j] = vx;
+		derivative.X[1][j] = vy;
+		derivative.X[2][j] = vz;
+
+		// dQ/dt = (W/2)*Q, where W = (wx,wy,wz,0) is a quaternion.
+		Real const hx = half * wx, hy = half * wy, hz = half * wz, hw = half * zero;
+		derivative.Q[0][j] = +hx * qw + hy * qz - hz * qy + hw * qx;
+		derivative.Q[1][j] = -hx * qz + hy * qw + hz * qx + hw * qy;
+		derivative.Q[2][j] = +hx * qy - hy * qx + hz * qw + hw * qz;
+		derivative.Q[3][j] = -hx * qx - hy * qy - hz * qz + hw * qw;
+
+		// dP/dt = gravity + friction, dL/dt = friction torque.
+		bool const onFloor = (state.X[2][j] - radius <= epsilon);
+		Real const gravity = mass * gravityConstant;
+		Real const vLength = std::sqrt(zero + vx * vx + vy * vy + vz * vz);
+		Real const wLength = std::sqrt(zero + wx * wx + wy * wy + wz * wz);
+		Real const fx = (onFloor ? -viscosity * (vLength > zero ? vx / vLength : zero) : zero);
+		Real const fy = (onFloor ? -viscosity * (vLength > zero ? vy / vLength : zero) : zero);
+		Real const tx = (onFloor ?
+			inertia * (-viscosity * (wLength > zero ? wx / wLength : zero)) : zero);
+		Real const ty = (onFloor ?
+			inertia * (-viscosity * (wLength > zero ? wy / wLength : zero)) : zero);
+		Real const tz = (onFloor ?
+			inertia * (-viscosity * (wLength > zero ? wz / wLength : zero)) : zero);
+		derivative.P[0][j] = gravity * zero + fx;
+		derivative.P[1][j] = gravity * zero + fy;
+		derivative.P[2][j] = gravity * -one + zero;
+		derivative.L[0][j] = tx;
+		derivative.L[1][j] = ty;
+		derivative.L[2][j] = tz;
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::AdvanceBatch(size_t first, BatchState const& state0,
+	BatchState const& derivative, Real step, BatchState& state) const
+{
+	for (size_t j = 0; j < BatchSize; ++j)
+	{
+		Real const invMass = mSpheres.invMass[first + j];
+		Real const invInertia = mSpheres.invInertia[first + j][0];
+		for (size_t k = 0; k < 3; ++k)
+		{
+			state.X[k][j] = state0.X[k][j] + step * derivative.X[k][j];
+			state.P[k][j] = state0.P[k][j] + step * derivative.P[k][j];
+			state.L[k][j] = state0.L[k][j] + step * derivative.L[k][j];
+			state.V[k][j] = invMass * state.P[k][j];
+			state.W[k][j] = invInertia * state.L[k][j];
+		}
+
+		for (size_t k = 0; k < 4; ++k)
+		{
+			state.Q[k][j] = state0.Q[k][j] + step * derivative.Q[k][j];
+		}
+		NormalizeBatch(state.Q, j);
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::NormalizeBatch(std::array<Lanes, 4>& q, size_t j)
 {
-	// Create the immovable planes.
-	mRigidPlane[0] = std::make_shared<RigidPlane>(Plane3<double>({ +1.0,  0.0,  0.0 }, +xMin));
-	mRigidPlane[1] = std::make_shared<RigidPlane>(Plane3<double>({ 0.0, +1.0,  0.0 }, +yMin));
-	mRigidPlane[2] = std::make_shared<RigidPlane>(Plane3<double>({ 0.0,  0.0, +1.0 }, +zMin));
-	mRigidPlane[3] = std::make_shared<RigidPlane>(Plane3<double>({ -1.0,  0.0,  0.0 }, -xMax));
-	mRigidPlane[4] = std::make_shared<RigidPlane>(Plane3<double>({ 0.0, -1.0,  0.0 }, -yMax));
-	mRigidPlane[5] = std::make_shared<RigidPlane>(Plane3<double>({ 0.0,  0.0, -1.0 }, -zMax));
+	// Normalize(Quaternion<Real>&) for lane j.
+	Real const length = std::sqrt(q[0][j] * q[0][j] + q[1][j] * q[1][j] +
+		q[2][j] * q[2][j] + q[3][j] * q[3][j]);
+	for (size_t k = 0; k < 4; ++k)
+	{
+		q[k][j] = (length > static_cast<Real>(0) ? q[k][j] / length : static_cast<Real>(0));
+	}
 }
 
-void PhysicsModule::InitializeSphere(size_t i, double radius, double massDensity,
-	Vector3<double> const& center, Vector3<double> const& linearVelocity,
-	Quaternion<double> const& qOrientation, Vector3<double> const& angularVelocity)
+template <typename Real>
+void PhysicsModule<Real>::IntegrateSphereBatch(size_t first, double, double dt)
 {
-	mRigidSphere[i] = std::make_shared<RigidSphere>(
-		Sphere3<double>(center, radius), massDensity);
+	// This is IntegrateSphere applied to spheres first through
+	// first + BatchSize - 1 at once. Each quantity is stored as one lane
+	// per sphere, so the loops over the lanes perform the same operation on
+	// consecutive numbers and the compiler can map them to SIMD registers.
+	// The lanes of immovable spheres are computed but not stored.
+	Real const halfDT = static_cast<Real>(0.5 * dt);
+	Real const fullDT = static_cast<Real>(dt);
+	double const sixthDT = dt / 6.0;
 
-	// This sets the initial linear velocity. It also sets the initial linear
-	// momentum.
-	mRigidSphere[i]->SetLinearVelocity(linearVelocity);
+	BatchState S0{}, S{}, A1{}, A2{}, A3{}, A4{};
+	for (size_t j = 0; j < BatchSize; ++j)
+	{
+		size_t const i = first + j;
+		for (size_t k = 0; k < 3; ++k)
+		{
+			S0.X[k][j] = mSpheres.position[i][k];
+			S0.P[k][j] = mSpheres.linearMomentum[i][k];
+			S0.L[k][j] = mSpheres.angularMomentum[i][k];
+			S0.V[k][j] = mSpheres.linearVelocity[i][k];
+			S0.W[k][j] = mSpheres.angularVelocity[i][k];
+		}
+		for (size_t k = 0; k < 4; ++k)
+		{
+			S0.Q[k][j] = mSpheres.qOrientation[i][static_cast<int32_t>(k)];
+		}
+	}
+
+	// A1 = G(T,S0), B1 = S0 + (DT/2)*A1
+	EvaluateBatch(first, S0, A1);
+	AdvanceBatch(first, S0, A1, halfDT, S);
+
+	// A2 = G(T+DT/2,B1), B2 = S0 + (DT/2)*A2
+	EvaluateBatch(first, S, A2);
+	AdvanceBatch(first, S0, A2, halfDT, S);
 
-	// This sets the initial orientation. It also synchronizes the world
-	// inertia tensor with the current orientation.
-	mRigidSphere[i]->SetQOrientation(qOrientation, true);
+	// A3 = G(T+DT/2,B2), B3 = S0 + DT*A3
+	EvaluateBatch(first, S, A3);
+	AdvanceBatch(first, S0, A3, fullDT, S);
 
-	// SetAngularVelocity requires a current world inertia tensor, so it must
-	// be called after SetQOrientation.
-	mRigidSphere[i]->SetAngularVelocity(angularVelocity);
+	// A4 = G(T+DT,B3), S1 = S0 + (DT/6)*(A1+2*(A2+A3)+A4)
+	EvaluateBatch(first, S, A4);
+	for (size_t j = 0; j < BatchSize; ++j)
+	{
+		Real const invMass = mSpheres.invMass[first + j];
+		Real const invInertia = mSpheres.invInertia[first + j][0];
+		for (size_t k = 0; k < 3; ++k)
+		{
+			S.X[k][j] = CombineStages(S0.X[k][j], sixthDT,
+				A1.X[k][j], A2.X[k][j], A3.X[k][j], A4.X[k][j]);
+			S.P[k][j] = CombineStages(S0.P[k][j], sixthDT,
+				A1.P[k][j], A2.P[k][j], A3.P[k][j], A4.P[k][j]);
+			S.L[k][j] = CombineStages(S0.L[k][j], sixthDT,
+				A1.L[k][j], A2.L[k][j], A3.L[k][j], A4.L[k][j]);
+			S.V[k][j] = invMass * S.P[k][j];
+			S.W[k][j] = invInertia * S.L[k][j];
+		}
+
+		for (size_t k = 0; k < 4; ++k)
+		{
+			S.Q[k][j] = CombineStages(S0.Q[k][j], sixthDT,
+				A1.Q[k][j], A2.Q[k][j], A3.Q[k][j], A4.Q[k][j]);
+		}
+		NormalizeBatch(S.Q, j);
+	}
 
-	mRigidSphere[i]->Force = [this, i](double, RigidBodyState<double> const& state)
+	for (size_t j = 0; j < BatchSize; ++j)
 	{
-		// The only external force is gravity.
-		double constexpr gravityConstant = 9.81;   // m/sec^2
-		Vector3<double> gravityDirection{ 0.0, 0.0, -1.0 };
-		Vector3<double> gravityForce =
-			(state.GetMass() * gravityConstant) * gravityDirection;
+		size_t const i = first + j;
+		if (!mSpheres.IsMovable(i) || mAwake[i] == 0)
+		{
+			continue;
+		}
 
-		// Take into account friction when the spheres are sliding on the
-		// floor.
-		double constexpr epsilon = 1e-03;
-		Vector3<double> frictionForce{ 0.0, 0.0, 0.0 };
-		double z = state.GetPosition()[2];
-		double radius = mRigidSphere[i]->GetRadius();
-		if (z - radius <= epsilon)
+		for (size_t k = 0; k < 3; ++k)
+		{
+			mSpheres.position[i][k] = S.X[k][j];
+			mSpheres.linearMomentum[i][k] = S.P[k][j];
+			mSpheres.angularMomentum[i][k] = S.L[k][j];
+			mSpheres.linearVelocity[i][k] = S.V[k][j];
+			mSpheres.angularVelocity[i][k] = S.W[k][j];
+		}
+		for (size_t k = 0; k < 4; ++k)
 		{
-			double constexpr viscosity = 1000.0;
-			Vector3<double> linearVelocity = state.GetLinearVelocity();
-			Normalize(linearVelocity);
-			frictionForce = -viscosity * linearVelocity;
-			frictionForce[2] = 0.0;
+			mSpheres.qOrientation[i][static_cast<int32_t>(k)] = S.Q[k][j];
 		}
+		mSpheres.rOrientation[i] = Rotation<3, Real>(mSpheres.qOrientation[i]);
+	}
+}
 
-		return gravityForce + frictionForce;
-	};
+template <typename Real>
+Vector3<Real> PhysicsModule<Real>::GetRelativeVelocity(SolverContact const& sc) const
+{
+	auto const& S = mSpheres;
+	Vector3<Real> velA = S.linearVelocity[sc.a] + Cross(S.angularVelocity[sc.a], sc.rA);
+	if (sc.isPlane)
+	{
+		return velA;
+	}
+	Vector3<Real> velB = S.linearVelocity[sc.b] + Cross(S.angularVelocity[sc.b], sc.rB);
+	return velA - velB;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::ApplySolverImpulse(SolverContact const& sc,
+	Vector3<Real> const& impulse)
+{
+	mSpheres.SetLinearMomentum(sc.a, mSpheres.linearMomentum[sc.a] + impulse);
+	mSpheres.SetAngularMomentum(sc.a, mSpheres.angularMomentum[sc.a] + Cross(sc.rA, impulse));
+	if (!sc.isPlane)
+	{
+		mSpheres.SetLinearMomentum(sc.b, mSpheres.linearMomentum[sc.b] - impulse);
+		mSpheres.SetAngularMomentum(sc.b, mSpheres.angularMomentum[sc.b] - Cross(sc.rB, impulse));
+	}
+}
+
+template <typename Real>
+Real PhysicsModule<Real>::GetEffectiveMass(SolverContact const& sc,
+	Vector3<Real> const& direction) const
+{
+	// The inverse of the change in relative velocity along the direction
+	// for a unit impulse along the direction.
+	auto rAxD = Cross(sc.rA, direction);
+	Real K = mSpheres.invMass[sc.a] + mSpheres.GetInverseInertiaForm(sc.a, rAxD, rAxD);
+	if (!sc.isPlane)
+	{
+		auto rBxD = Cross(sc.rB, direction);
+		K += mSpheres.invMass[sc.b] + mSpheres.GetInverseInertiaForm(sc.b, rBxD, rBxD);
+	}
+	return (K > static_cast<Real>(0) ? static_cast<Real>(1) / K : static_cast<Real>(0));
+}
+
+template <typename Real>
+void PhysicsModule<Real>::PrepareSolverContacts()
+{
+	// Prepare the contacts. The solver normal points from body B to body A,
+	// so the normal impulse on A is nonnegative: the plane normal for a
+	// sphere-plane contact and -N for a sphere-sphere contact. The
+	// restitution is applied to the approaching normal velocity before any
+	// impulse is applied.
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	mSolverContacts.resize(mContacts.size());
+	for (size_t c = 0; c < mContacts.size(); ++c)
+	{
+		auto const& contact = mContacts[c];
+		auto& sc = mSolverContacts[c];
+		sc.a = contact.i0;
+		sc.b = contact.i1;
+		sc.isPlane = contact.isPlane;
+		sc.key = (contact.isPlane ? numSpheres + contact.i1 : contact.i1);
+		sc.rA = contact.P - mSpheres.position[sc.a];
+		sc.rB = (contact.isPlane ? Vector3<Real>::Zero() : contact.P - mSpheres.position[sc.b]);
+		sc.N = (contact.isPlane ? contact.N : -contact.N);
+		Vector3<Real> normal = sc.N;
+		(void)ComputeOrthonormalBasis(1, normal, sc.T1, sc.T2);
+		sc.massN = GetEffectiveMass(sc, sc.N);
+		sc.massT1 = GetEffectiveMass(sc, sc.T1);
+		sc.massT2 = GetEffectiveMass(sc, sc.T2);
+
+		Real vn = Dot(sc.N, GetRelativeVelocity(sc));
+		sc.target = (vn < static_cast<Real>(0) ? -mRestitution * vn : static_cast<Real>(0));
+		sc.lambdaN = 0.0;
+		sc.lambdaT1 = 0.0;
+		sc.lambdaT2 = 0.0;
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::CacheSolverImpulses()
+{
+	// The contacts of this tick replace the manifolds of their pairs. The
+	// other manifolds age by one tick and are discarded when they are
+	// older than the persistence.
+	mNewManifolds.clear();
+	for (auto const& sc : mSolverContacts)
+	{
+		mNewManifolds.push_back({ sc.a, sc.key, mSpheres.position[sc.a] + sc.rA, sc.N,
+			sc.lambdaN, static_cast<Real>(sc.lambdaT1) * sc.T1 + static_cast<Real>(sc.lambdaT2) * sc.T2, 0 });
+	}
+	std::sort(mNewManifolds.begin(), mNewManifolds.end());
 
-	mRigidSphere[i]->Torque = [this, i](double, RigidBodyState<double> const& state)
+	size_t const numCurrent = mNewManifolds.size();
+	size_t current = 0;
+	for (auto const& manifold : mManifolds)
 	{
-		// No external torque is applied. However, take into account friction
-		// when the spheres are spinning on the floor.
-		double constexpr epsilon = 1e-03;
-		Vector3<double> torque{ 0.0, 0.0, 0.0 };
-		double z = state.GetPosition()[2];
-		double radius = mRigidSphere[i]->GetRadius();
-		if (z - radius <= epsilon)
+		while (current < numCurrent && mNewManifolds[current] < manifold)
 		{
-			double constexpr viscosity = 1000.0;
-			Vector3<double> angularVelocity = state.GetAngularVelocity();
-			Normalize(angularVelocity);
-			Vector3<double> newAngularVelocity = -viscosity * angularVelocity;
-			Vector3<double> newAngularMomentum = state.GetWorldInertia() * newAngularVelocity;
-			torque = newAngularMomentum;
+			++current;
 		}
-		return torque;
-	};
+
+		bool const replaced = (current < numCurrent &&
+			!(manifold < mNewManifolds[current]));
+		if (!replaced && manifold.age < mContactPersistence)
+		{
+			mNewManifolds.push_back(manifold);
+			++mNewManifolds.back().age;
+		}
+	}
+	std::inplace_merge(mNewManifolds.begin(), mNewManifolds.begin() + numCurrent,
+		mNewManifolds.end());
+	std::swap(mManifolds, mNewManifolds);
 }
 
-void PhysicsModule::DoTick(double time, double deltaTime)
+template <typename Real>
+void PhysicsModule<Real>::SolveContacts()
 {
-	DoCollisionDetection();
-	DoCollisionResponse(time, deltaTime);
+	PrepareSolverContacts();
+
+	// Warm start with the accumulated impulses of the manifold of the body
+	// pair when the contact is near the cached one. The tangential impulse
+	// is cached in world coordinates and projected onto the current
+	// tangent plane.
+	Real const cosMaxAngle = static_cast<Real>(0.8660254037844386);
+	mNumWarmStartedContacts = 0;
+	for (auto& sc : mSolverContacts)
+	{
+		ContactManifold probe{ sc.a, sc.key, Vector3<Real>::Zero(), Vector3<Real>::Zero(),
+			0.0, Vector3<Real>::Zero(), 0 };
+		auto iter = std::lower_bound(mManifolds.begin(), mManifolds.end(), probe);
+		if (iter == mManifolds.end() || iter->a != sc.a || iter->key != sc.key)
+		{
+			continue;
+		}
+
+		Real const maxDistance = mContactMatchDistance * mSpheres.radius[sc.a];
+		Vector3<Real> const diff = mSpheres.position[sc.a] + sc.rA - iter->P;
+		if (Dot(diff, diff) <= maxDistance * maxDistance && Dot(sc.N, iter->N) >= cosMaxAngle)
+		{
+			double maxT = static_cast<double>(mSolverFriction) * iter->normal;
+			sc.lambdaN = iter->normal;
+			sc.lambdaT1 = std::min(std::max(static_cast<double>(Dot(sc.T1, iter->tangent)), -maxT), maxT);
+			sc.lambdaT2 = std::min(std::max(static_cast<double>(Dot(sc.T2, iter->tangent)), -maxT), maxT);
+			ApplySolverImpulse(sc, static_cast<Real>(sc.lambdaN) * sc.N +
+				static_cast<Real>(sc.lambdaT1) * sc.T1 + static_cast<Real>(sc.lambdaT2) * sc.T2);
+			++mNumWarmStartedContacts;
+		}
+	}
+
+	// Projected Gauss-Seidel iterations over the contact colors.
+	mContactBodies.resize(mSolverContacts.size());
+	for (size_t k = 0; k < mSolverContacts.size(); ++k)
+	{
+		auto const& sc = mSolverContacts[k];
+		mContactBodies[k] = { sc.a, sc.isPlane ? InvalidIndex : sc.b };
+	}
+	ColorContacts();
+	PackSolverLanes();
+	mSolverNumIterations = 0;
+	while (mSolverNumIterations < mSolverMaxIterations)
+	{
+		++mSolverNumIterations;
+		std::fill(mThreadMaxDelta.begin(), mThreadMaxDelta.end(), 0.0);
+		double maxDelta = 0.0;
+		RunColors([this, &maxDelta](size_t t, size_t begin, size_t end)
+		{
+			double& threadMaxDelta = (mNumThreads > 0 ? mThreadMaxDelta[t] : maxDelta);
+			threadMaxDelta = std::max(threadMaxDelta, SolveSolverContacts(begin, end));
+		});
+		for (auto const delta : mThreadMaxDelta)
+		{
+			maxDelta = std::max(maxDelta, delta);
+		}
+
+		if (maxDelta <= static_cast<double>(mSolverTolerance))
+		{
+			break;
+		}
+	}
+
+	// Cache the accumulated impulses for the next tick.
+	UnpackSolverLanes();
+	CacheSolverImpulses();
 }
 
-void PhysicsModule::DoCollisionDetection()
+template <typename Real>
+double PhysicsModule<Real>::SolveSolverContact(SolverContact& sc)
 {
-	mContacts.clear();
+	// The accumulated normal impulse is clamped to be nonnegative and the
+	// accumulated friction impulses to the Coulomb limit of the accumulated
+	// normal impulse.
+	Real vn = Dot(sc.N, GetRelativeVelocity(sc));
+	double lambda = std::max(sc.lambdaN +
+		static_cast<double>(sc.massN * (sc.target - vn)), 0.0);
+	double deltaN = lambda - sc.lambdaN;
+	sc.lambdaN = lambda;
+	ApplySolverImpulse(sc, static_cast<Real>(deltaN) * sc.N);
 
-	// Test for sphere-plane collisions. These checks are done in pairs with
-	// the assumption that the sphere diameters are smaller than the distance
-	// between parallel planar boundaries. In this case, only one of each
-	// parallel pair of planes can be intersected at any time. Each pair of
-	// parallel planes is tested in order to handle the case when a sphere
-	// intersects two planes meeting at a region edge or three planes meeting
-	// at a region corner. When the sphere is partially or fully outside a
-	// plane, the interpenetration is removed to push the sphere back into
-	// the simulation region.
-	size_t const numSpheres = mRigidSphere.size();
-	std::vector<bool> moved(numSpheres, false);
-	double overlap{};
-	for (size_t i = 0; i < numSpheres; ++i)
+	double maxT = static_cast<double>(mSolverFriction) * sc.lambdaN;
+	Vector3<Real> vRel = GetRelativeVelocity(sc);
+	lambda = std::min(std::max(sc.lambdaT1 -
+		static_cast<double>(sc.massT1 * Dot(sc.T1, vRel)), -maxT), maxT);
+	double deltaT1 = lambda - sc.lambdaT1;
+	sc.lambdaT1 = lambda;
+	lambda = std::min(std::max(sc.lambdaT2 -
+		static_cast<double>(sc.massT2 * Dot(sc.T2, vRel)), -maxT), maxT);
+	double deltaT2 = lambda - sc.lambdaT2;
+	sc.lambdaT2 = lambda;
+	ApplySolverImpulse(sc, static_cast<Real>(deltaT1) * sc.T1 +
+		static_cast<Real>(deltaT2) * sc.T2);
+
+	return std::max(std::fabs(deltaN), std::max(std::fabs(deltaT1), std::fabs(deltaT2)));
+}
+
+template <typename Real>
+double PhysicsModule<Real>::SolveSolverContacts(size_t begin, size_t end)
+{
+	double maxDelta = 0.0;
+	if (begin < end && mContactColors[mColorContacts[begin]] == MaxContactColors)
+	{
+		for (size_t p = begin; p < end; ++p)
+		{
+			maxDelta = std::max(maxDelta, SolveSolverContact(mSolverContacts[mColorContacts[p]]));
+		}
+		return maxDelta;
+	}
+
+	if (begin == end)
 	{
-		mRigidSphere[i]->UpdateWorldQuantities();
-		auto const& sphere = mRigidSphere[i]->GetWorldSphere();
+		return maxDelta;
+	}
 
-		// Test for the sphere intersecting or occurring outside an
-		// x-constant plane.
-		overlap = sphere.radius - mRigidPlane[0]->GetSignedDistance(sphere.center);
-		if (overlap > 0.0)
+	Real const one = static_cast<Real>(1);
+	double const friction = static_cast<double>(mSolverFriction);
+	size_t const c = mContactColors[mColorContacts[begin]];
+	size_t batch = mColorBatches[c] + (begin - mColorStarts[c]) / BatchSize;
+	BodyLanes bodyA{}, bodyB{};
+	std::array<double, BatchSize> deltaN{}, delta{};
+	for (size_t first = begin; first < end; first += BatchSize, ++batch)
+	{
+		SolverLanes& lanes = mSolverLanes[batch];
+		size_t const numLanes = (end - first < BatchSize ? end - first : BatchSize);
+		for (size_t j = 0; j < BatchSize; ++j)
 		{
-			moved[i] = SetSpherePlaneContact(
-				mRigidSphere[i], mRigidPlane[0], overlap);
+			GatherBody(lanes.a[j], j, bodyA);
+			GatherBody(lanes.b[j], j, bodyB);
 		}
-		else
+
+		// The normal impulses.
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			std::array<Real, 3> const vRel = GetRelativeVelocity(lanes, bodyA, bodyB, j);
+			Real const vn = lanes.N[0][j] * vRel[0] + lanes.N[1][j] * vRel[1] +
+				lanes.N[2][j] * vRel[2];
+			double const lambda = std::max(lanes.lambdaN[j] +
+				static_cast<double>(lanes.massN[j] * (lanes.target[j] - vn)), 0.0);
+			deltaN[j] = lambda - lanes.lambdaN[j];
+			lanes.lambdaN[j] = lambda;
+			std::array<Real, 3> impulse{};
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				impulse[d] = static_cast<Real>(deltaN[j]) * lanes.N[d][j];
+			}
+			ApplyBodyImpulse(lanes.rA, impulse, one, bodyA, j);
+			ApplyBodyImpulse(lanes.rB, impulse, -one, bodyB, j);
+		}
+		UpdateAnisotropicVelocities(bodyA);
+		UpdateAnisotropicVelocities(bodyB);
+
+		// The friction impulses, clamped to the Coulomb limit of the
+		// accumulated normal impulse.
+		for (size_t j = 0; j < BatchSize; ++j)
 		{
-			overlap = sphere.radius - mRigidPlane[3]->GetSignedDistance(sphere.center);
-			if (overlap > 0.0)
+			double const maxT = friction * lanes.lambdaN[j];
+			std::array<Real, 3> const vRel = GetRelativeVelocity(lanes, bodyA, bodyB, j);
+			Real const vt1 = lanes.T1[0][j] * vRel[0] + lanes.T1[1][j] * vRel[1] +
+				lanes.T1[2][j] * vRel[2];
+			Real const vt2 = lanes.T2[0][j] * vRel[0] + lanes.T2[1][j] * vRel[1] +
+				lanes.T2[2][j] * vRel[2];
+			double lambda = std::min(std::max(lanes.lambdaT1[j] -
+				static_cast<double>(lanes.massT1[j] * vt1), -maxT), maxT);
+			double const deltaT1 = lambda - lanes.lambdaT1[j];
+			lanes.lambdaT1[j] = lambda;
+			lambda = std::min(std::max(lanes.lambdaT2[j] -
+				static_cast<double>(lanes.massT2[j] * vt2), -maxT), maxT);
+			double const deltaT2 = lambda - lanes.lambdaT2[j];
+			lanes.lambdaT2[j] = lambda;
+			std::array<Real, 3> impulse{};
+			for (int32_t d = 0; d < 3; ++d)
 			{
-				moved[i] = SetSpherePlaneContact(
-					mRigidSphere[i], mRigidPlane[3], overlap);
+				impulse[d] = static_cast<Real>(deltaT1) * lanes.T1[d][j] +
+					static_cast<Real>(deltaT2) * lanes.T2[d][j];
 			}
+			ApplyBodyImpulse(lanes.rA, impulse, one, bodyA, j);
+			ApplyBodyImpulse(lanes.rB, impulse, -one, bodyB, j);
+			delta[j] = std::max(std::fabs(deltaN[j]),
+				std::max(std::fabs(deltaT1), std::fabs(deltaT2)));
 		}
+		UpdateAnisotropicVelocities(bodyA);
+		UpdateAnisotropicVelocities(bodyB);
 
-		// Test for the sphere intersection or occurring outside a
-		// y-constant plane.
-		overlap = sphere.radius - mRigidPlane[1]->GetSignedDistance(sphere.center);
-		if (overlap > 0.0)
+		ScatterBodies(bodyA, numLanes);
+		ScatterBodies(bodyB, numLanes);
+		for (size_t j = 0; j < numLanes; ++j)
 		{
-			moved[i] = SetSpherePlaneContact(
-				mRigidSphere[i], mRigidPlane[1], overlap);
+			maxDelta = std::max(maxDelta, delta[j]);
 		}
-		else
+	}
+	return maxDelta;
+}
+
+template <typename Real>
+void PhysicsModule<Real>::PackSolverLanes()
+{
+	Real const zero = static_cast<Real>(0);
+	mColorBatches.assign(MaxContactColors + 1, 0);
+	size_t numBatches = 0;
+	for (size_t c = 0; c < mNumContactColors && c < MaxContactColors; ++c)
+	{
+		mColorBatches[c] = numBatches;
+		numBatches += (mColorStarts[c + 1] - mColorStarts[c] + BatchSize - 1) / BatchSize;
+	}
+
+	mSolverLanes.resize(numBatches);
+	for (size_t c = 0; c < mNumContactColors && c < MaxContactColors; ++c)
+	{
+		size_t const begin = mColorStarts[c], end = mColorStarts[c + 1];
+		size_t batch = mColorBatches[c];
+		for (size_t first = begin; first < end; first += BatchSize, ++batch)
+		{
+			SolverLanes& lanes = mSolverLanes[batch];
+			for (size_t j = 0; j < BatchSize; ++j)
+			{
+				SolverContact const* sc = (first + j < end ?
+					&mSolverContacts[mColorContacts[first + j]] : nullptr);
+				lanes.a[j] = (sc ? sc->a : InvalidIndex);
+				lanes.b[j] = (sc && !sc->isPlane ? sc->b : InvalidIndex);
+				for (int32_t d = 0; d < 3; ++d)
+				{
+					lanes.rA[d][j] = (sc ? sc->rA[d] : zero);
+					lanes.rB[d][j] = (sc ? sc->rB[d] : zero);
+					lanes.N[d][j] = (sc ? sc->N[d] : zero);
+					lanes.T1[d][j] = (sc ? sc->T1[d] : zero);
+					lanes.T2[d][j] = (sc ? sc->T2[d] : zero);
+				}
+				lanes.massN[j] = (sc ? sc->massN : zero);
+				lanes.massT1[j] = (sc ? sc->massT1 : zero);
+				lanes.massT2[j] = (sc ? sc->massT2 : zero);
+				lanes.target[j] = (sc ? sc->target : zero);
+				lanes.lambdaN[j] = (sc ? sc->lambdaN : 0.0);
+				lanes.lambdaT1[j] = (sc ? sc->lambdaT1 : 0.0);
+				lanes.lambdaT2[j] = (sc ? sc->lambdaT2 : 0.0);
+			}
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::UnpackSolverLanes()
+{
+	for (size_t c = 0; c < mNumContactColors && c < MaxContactColors; ++c)
+	{
+		size_t const begin = mColorStarts[c], end = mColorStarts[c + 1];
+		size_t batch = mColorBatches[c];
+		for (size_t first = begin; first < end; first += BatchSize, ++batch)
 		{
-			overlap = sphere.radius - mRigidPlane[4]->GetSignedDistance(sphere.center);
-			if (overlap > 0.0)
+			SolverLanes const& lanes = mSolverLanes[batch];
+			for (size_t j = 0; j < BatchSize && first + j < end; ++j)
 			{
-				moved[i] = SetSpherePlaneContact(
-					mRigidSphere[i], mRigidPlane[4], overlap);
+				auto& sc = mSolverContacts[mColorContacts[first + j]];
+				sc.lambdaN = lanes.lambdaN[j];
+				sc.lambdaT1 = lanes.lambdaT1[j];
+				sc.lambdaT2 = lanes.lambdaT2[j];
 			}
 		}
+	}
+}
 
-		// Test for the sphere intersecting or occurring outside a
-		// z-constant plane.
-		overlap = sphere.radius - mRigidPlane[2]->GetSignedDistance(sphere.center);
-		if (overlap > 0.0)
+
+template <typename Real>
+void PhysicsModule<Real>::ApplyImpulses(size_t begin, size_t end)
+{
+	if (begin < end && mContactColors[mColorContacts[begin]] == MaxContactColors)
+	{
+		for (size_t p = begin; p < end; ++p)
 		{
-			moved[i] = SetSpherePlaneContact(
-				mRigidSphere[i], mRigidPlane[2], overlap);
+			ApplyImpulse(mContacts[mColorContacts[p]]);
 		}
-		else
+		return;
+	}
+
+	// The lanes follow ApplyImpulse, with its T0 and T1 stored in
+	// lanes.T1 and lanes.T2. Both the solution of the 3x3 system and the
+	// fallback f*N are evaluated and blended by whether T0 is zero. The
+	// right-hand side of the system is (numer,0,0), so the solution is
+	// numer times the first column of Inverse(Matrix3x3). rxU[0] through rxU[2] are rA x N,
+	// rA x T0 and rA x T1, and rxU[3] through rxU[5] the same for rB.
+	// formA and formB are the quadratic forms of the inverse inertia
+	// tensors for the pairs (N,N), (T0,T0), (T1,T1), (N,T0), (N,T1) and
+	// (T0,T1); the zero body of a plane has zero forms.
+	Real const zero = static_cast<Real>(0);
+	Real const one = static_cast<Real>(1);
+	Real const restitution = mRestitution;
+	std::array<size_t, 6> const formU = { 0, 1, 2, 0, 0, 1 };
+	std::array<size_t, 6> const formV = { 0, 1, 2, 1, 2, 2 };
+	SolverLanes lanes{};
+	BodyLanes bodyA{}, bodyB{};
+	std::array<std::array<Lanes, 3>, 6> rxU{};
+	std::array<Lanes, 6> formA{}, formB{};
+	std::array<Lanes, 3> velDiff{}, cofactor{};
+	Lanes invLength{}, det{}, diagonal{}, numer{}, tangent{};
+	for (size_t first = begin; first < end; first += BatchSize)
+	{
+		size_t const numLanes = (end - first < BatchSize ? end - first : BatchSize);
+		bool anisotropic = false;
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			Contact const* contact = (j < numLanes ? &mContacts[mColorContacts[first + j]] : nullptr);
+			bool const isPlane = (contact && contact->isPlane);
+			GatherBody(contact ? contact->i0 : InvalidIndex, j, bodyA);
+			GatherBody(contact && !isPlane ? contact->i1 : InvalidIndex, j, bodyB);
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				lanes.N[d][j] = (contact ? contact->N[d] : zero);
+				lanes.rA[d][j] = (contact ? contact->P[d] - bodyA.X[d][j] : zero);
+				lanes.rB[d][j] = (contact && !isPlane ? contact->P[d] - bodyB.X[d][j] : zero);
+			}
+			anisotropic = anisotropic || bodyA.isIsotropic[j] == zero ||
+				bodyB.isIsotropic[j] == zero;
+		}
+
+		// The tangential relative velocity. The square roots of its
+		// squared lengths are taken in a separate loop, because std::sqrt
+		// can set errno and keeps the loop that calls it from being
+		// vectorized.
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			std::array<Real, 3> const vRel = GetRelativeVelocity(lanes, bodyA, bodyB, j);
+			Real const vn = lanes.N[0][j] * vRel[0] + lanes.N[1][j] * vRel[1] +
+				lanes.N[2][j] * vRel[2];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				velDiff[d][j] = vRel[d];
+				lanes.T1[d][j] = vRel[d] - vn * lanes.N[d][j];
+			}
+			invLength[j] = lanes.T1[0][j] * lanes.T1[0][j] +
+				lanes.T1[1][j] * lanes.T1[1][j] + lanes.T1[2][j] * lanes.T1[2][j];
+		}
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			Real const length = std::sqrt(invLength[j]);
+			invLength[j] = one / (length > zero ? length : one);
+		}
+
+		// The unit tangent T0, T1 = Cross(N,T0), the cross products and the
+		// forms of the isotropic bodies.
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				lanes.T1[d][j] *= invLength[j];
+			}
+			SetCross(lanes.N, lanes.T1, lanes.T2, j);
+			SetCross(lanes.rA, lanes.N, rxU[0], j);
+			SetCross(lanes.rA, lanes.T1, rxU[1], j);
+			SetCross(lanes.rA, lanes.T2, rxU[2], j);
+			SetCross(lanes.rB, lanes.N, rxU[3], j);
+			SetCross(lanes.rB, lanes.T1, rxU[4], j);
+			SetCross(lanes.rB, lanes.T2, rxU[5], j);
+			for (size_t f = 0; f < 6; ++f)
+			{
+				auto const& UA = rxU[formU[f]];
+				auto const& VA = rxU[formV[f]];
+				auto const& UB = rxU[formU[f] + 3];
+				auto const& VB = rxU[formV[f] + 3];
+				formA[f][j] = bodyA.invInertia[j] *
+					(UA[0][j] * VA[0][j] + UA[1][j] * VA[1][j] + UA[2][j] * VA[2][j]);
+				formB[f][j] = bodyB.invInertia[j] *
+					(UB[0][j] * VB[0][j] + UB[1][j] * VB[1][j] + UB[2][j] * VB[2][j]);
+			}
+		}
+
+		// The forms of the capsules and boxes.
+		if (anisotropic)
+		{
+			auto getLane = [](std::array<Lanes, 3> const& v, size_t j)
+			{
+				return Vector3<Real>{ v[0][j], v[1][j], v[2][j] };
+			};
+
+			for (size_t j = 0; j < numLanes; ++j)
+			{
+				for (size_t f = 0; f < 6; ++f)
+				{
+					size_t const u = formU[f], v = formV[f];
+					if (bodyA.isIsotropic[j] == zero)
+					{
+						formA[f][j] = mSpheres.GetInverseInertiaForm(bodyA.index[j],
+							getLane(rxU[u], j), getLane(rxU[v], j));
+					}
+					if (bodyB.isIsotropic[j] == zero)
+					{
+						formB[f][j] = mSpheres.GetInverseInertiaForm(bodyB.index[j],
+							getLane(rxU[u + 3], j), getLane(rxU[v + 3], j));
+					}
+				}
+			}
+		}
+
+		// The first column of the cofactors of the system matrix, its
+		// determinant and the right-hand side.
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			Real const sumInvMasses = bodyA.invMass[j] + bodyB.invMass[j];
+			Real const m00 = sumInvMasses + formA[0][j] + formB[0][j];
+			Real const m11 = sumInvMasses + formA[1][j] + formB[1][j];
+			Real const m22 = sumInvMasses + formA[2][j] + formB[2][j];
+			Real const m01 = zero + formA[3][j] + formB[3][j];
+			Real const m02 = zero + formA[4][j] + formB[4][j];
+			Real const m12 = zero + formA[5][j] + formB[5][j];
+			cofactor[0][j] = m11 * m22 - m12 * m12;
+			cofactor[1][j] = m12 * m02 - m01 * m22;
+			cofactor[2][j] = m01 * m12 - m11 * m02;
+			det[j] = m00 * cofactor[0][j] + m01 * cofactor[1][j] + m02 * cofactor[2][j];
+			diagonal[j] = m00;
+			numer[j] = -(one + restitution) * (lanes.N[0][j] * velDiff[0][j] +
+				lanes.N[1][j] * velDiff[1][j] + lanes.N[2][j] * velDiff[2][j]);
+		}
+
+		// The divisions are taken in a separate loop, like the square
+		// roots, because the compilers do not vectorize a loop with a
+		// division that is executed only in some lanes.
+		for (size_t j = 0; j < BatchSize; ++j)
 		{
-			overlap = sphere.radius - mRigidPlane[5]->GetSignedDistance(sphere.center);
-			if (overlap > 0.0)
+			det[j] = (det[j] != zero ? one / det[j] : zero);
+			diagonal[j] = (diagonal[j] != zero ? numer[j] / diagonal[j] : zero);
+			tangent[j] = ((lanes.T1[0][j] != zero) | (lanes.T1[1][j] != zero) |
+				(lanes.T1[2][j] != zero) ? one : zero);
+		}
+
+		// The impulses, with det holding the inverse determinant and
+		// diagonal the magnitude f of the fallback.
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			Real const x0 = zero + cofactor[0][j] * det[j] * numer[j];
+			Real const x1 = zero + cofactor[1][j] * det[j] * numer[j];
+			Real const x2 = zero + cofactor[2][j] * det[j] * numer[j];
+			std::array<Real, 3> impulse{};
+			for (int32_t d = 0; d < 3; ++d)
 			{
-				moved[i] = SetSpherePlaneContact(
-					mRigidSphere[i], mRigidPlane[5], overlap);
+				impulse[d] = tangent[j] * (x0 * lanes.N[d][j] + x1 * lanes.T1[d][j] +
+					x2 * lanes.T2[d][j]) + (one - tangent[j]) * (diagonal[j] * lanes.N[d][j]);
 			}
+			ApplyBodyImpulse(lanes.rA, impulse, one, bodyA, j);
+			ApplyBodyImpulse(lanes.rB, impulse, -one, bodyB, j);
+		}
+		UpdateAnisotropicVelocities(bodyA);
+		UpdateAnisotropicVelocities(bodyB);
+
+		ScatterBodies(bodyA, numLanes);
+		ScatterBodies(bodyB, numLanes);
+	}
+}
+
+template <typename Real>
+void PhysicsModule<Real>::GatherBody(size_t i, size_t j, BodyLanes& body) const
+{
+	Real const zero = static_cast<Real>(0);
+	Real const one = static_cast<Real>(1);
+	body.index[j] = i;
+	body.hasAnisotropic = (j > 0 && body.hasAnisotropic);
+	if (i == InvalidIndex)
+	{
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			body.X[d][j] = zero;
+			body.P[d][j] = zero;
+			body.L[d][j] = zero;
+			body.V[d][j] = zero;
+			body.W[d][j] = zero;
 		}
+		body.invMass[j] = zero;
+		body.invInertia[j] = zero;
+		body.isMovable[j] = zero;
+		body.isIsotropic[j] = one;
+		return;
 	}
 
-	// Test for sphere-sphere collisions.
-	for (size_t i0 = 0; i0 + 1 < numSpheres; ++i0)
+	for (int32_t d = 0; d < 3; ++d)
 	{
-		auto const& sphere0 = mRigidSphere[i0]->GetWorldSphere();
+		body.X[d][j] = mSpheres.position[i][d];
+		body.P[d][j] = mSpheres.linearMomentum[i][d];
+		body.L[d][j] = mSpheres.angularMomentum[i][d];
+		body.V[d][j] = mSpheres.linearVelocity[i][d];
+		body.W[d][j] = mSpheres.angularVelocity[i][d];
+	}
+	body.invMass[j] = mSpheres.invMass[i];
+	body.invInertia[j] = mSpheres.invInertia[i][0];
+	body.isMovable[j] = (mSpheres.IsMovable(i) ? one : zero);
+	body.isIsotropic[j] = (mSpheres.IsIsotropic(i) ? one : zero);
+	body.hasAnisotropic = body.hasAnisotropic ||
+		(mSpheres.IsMovable(i) && !mSpheres.IsIsotropic(i));
+}
 
-		for (size_t i1 = i0 + 1; i1 < numSpheres; ++i1)
+template <typename Real>
+void PhysicsModule<Real>::ScatterBodies(BodyLanes const& body, size_t numLanes)
+{
+	Real const zero = static_cast<Real>(0);
+	for (size_t j = 0; j < numLanes; ++j)
+	{
+		if (body.isMovable[j] > zero)
 		{
-			auto const& sphere1 = mRigidSphere[i1]->GetWorldSphere();
+			size_t const i = body.index[j];
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				mSpheres.linearMomentum[i][d] = body.P[d][j];
+				mSpheres.angularMomentum[i][d] = body.L[d][j];
+				mSpheres.linearVelocity[i][d] = body.V[d][j];
+				mSpheres.angularVelocity[i][d] = body.W[d][j];
+			}
+		}
+	}
+}
 
-			// Test for overlap of sphere i0 and sphere i1.
-			auto delta = sphere1.center - sphere0.center;
-			double lengthDelta = Length(delta);
-			overlap = sphere0.radius + sphere1.radius - lengthDelta;
-			if (overlap > 0.0)
+template <typename Real>
+void PhysicsModule<Real>::UpdateAnisotropicVelocities(BodyLanes& body) const
+{
+	Real const zero = static_cast<Real>(0);
+	if (body.hasAnisotropic)
+	{
+		for (size_t j = 0; j < BatchSize; ++j)
+		{
+			if (body.isMovable[j] > zero && body.isIsotropic[j] == zero)
 			{
-				UndoSphereOverlap(mRigidSphere[i0], mRigidSphere[i1],
-					overlap, moved[i0], moved[i1]);
+				Vector3<Real> const W = mSpheres.MultiplyInverseInertia(body.index[j],
+					Vector3<Real>{ body.L[0][j], body.L[1][j], body.L[2][j] });
+				for (int32_t d = 0; d < 3; ++d)
+				{
+					body.W[d][j] = W[d];
+				}
 			}
 		}
 	}
 }
 
-void PhysicsModule::DoCollisionResponse(double time, double deltaTime)
+template <typename Real>
+void PhysicsModule<Real>::SolveContactsLCP()
 {
-	// Apply the instantaneous impulse forces at the current time.
-	for (auto& contact : mContacts)
+	PrepareSolverContacts();
+	BuildContactIslands();
+
+	if (mNumThreads > 0 && mNumContactIslands > 1)
+	{
+		// The islands share no movable spheres, so they are solved
+		// concurrently.
+		GetUniformBounds(mNumContactIslands, 1);
+		RunThreads([this](size_t, size_t begin, size_t end)
+		{
+			for (size_t k = begin; k < end; ++k)
+			{
+				SolveContactIsland(mContactIslands[k]);
+			}
+		});
+	}
+	else
 	{
-		contact.ApplyImpulse();
+		for (size_t k = 0; k < mNumContactIslands; ++k)
+		{
+			SolveContactIsland(mContactIslands[k]);
+		}
 	}
 
-	for (size_t i = 0; i < mRigidSphere.size(); ++i)
+	mSolverNumIterations = 0;
+	mNumFallbackIslands = 0;
+	for (size_t k = 0; k < mNumContactIslands; ++k)
 	{
-		// Solve the equations of motion.
-		mRigidSphere[i]->Update(time, deltaTime);
+		auto const& island = mContactIslands[k];
+		mSolverNumIterations = std::max(mSolverNumIterations, island.numIterations);
+		mNumFallbackIslands += (island.fallback ? 1 : 0);
 	}
+
+	// The impulses also warm-start SEQUENTIAL_IMPULSE when the solver is
+	// switched.
+	CacheSolverImpulses();
 }
 
-bool PhysicsModule::SetSpherePlaneContact(
-	std::shared_ptr<RigidSphere> const& rigidSphere,
-	std::shared_ptr<RigidPlane> const& rigidPlane,
-	double overlap)
+template <typename Real>
+void PhysicsModule<Real>::BuildContactIslands()
 {
-	auto const& sphere = rigidSphere->GetWorldSphere();
-	auto const& plane = rigidPlane->GetPlane();
+	// The islands are the connected components of the graph whose edges
+	// are the sphere-sphere contacts between movable spheres. A contact
+	// belongs to the island of its movable spheres; contacts without a
+	// movable sphere have no effect and are skipped. The islands are
+	// numbered in the order of their first contacts.
+	size_t const numSpheres = mSpheres.GetNumSpheres();
+	mIslandParent.resize(numSpheres);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		mIslandParent[i] = i;
+	}
+	for (auto const& sc : mSolverContacts)
+	{
+		if (!sc.isPlane && mSpheres.IsMovable(sc.a) && mSpheres.IsMovable(sc.b))
+		{
+			size_t r0 = FindIsland(sc.a);
+			size_t r1 = FindIsland(sc.b);
+			if (r0 != r1)
+			{
+				mIslandParent[std::max(r0, r1)] = std::min(r0, r1);
+			}
+		}
+	}
 
-	Contact contact{};
-	contact.A = rigidSphere;
-	contact.B = rigidPlane;
-	contact.P = sphere.center + overlap * plane.normal;
-	contact.N = plane.normal;
-	contact.restitution = mRestitution;
-	mContacts.push_back(contact);
+	size_t const invalid = std::numeric_limits<size_t>::max();
+	mIslandOfRoot.assign(numSpheres, invalid);
+	mNumContactIslands = 0;
+	for (size_t c = 0; c < mSolverContacts.size(); ++c)
+	{
+		auto const& sc = mSolverContacts[c];
+		size_t body;
+		if (mSpheres.IsMovable(sc.a))
+		{
+			body = sc.a;
+		}
+		else if (!sc.isPlane && mSpheres.IsMovable(sc.b))
+		{
+			body = sc.b;
+		}
+		else
+		{
+			continue;
+		}
 
-	// Move the intersecting sphere to be just touching the plane.
-	rigidSphere->SetPosition(contact.P);
-	rigidSphere->UpdateWorldQuantities();
-	return true;
+		size_t r = FindIsland(body);
+		if (mIslandOfRoot[r] == invalid)
+		{
+			if (mNumContactIslands == mContactIslands.size())
+			{
+				mContactIslands.emplace_back();
+				mContactIslands.back().lcpDimension = 0;
+			}
+			mIslandOfRoot[r] = mNumContactIslands;
+			mContactIslands[mNumContactIslands].contacts.clear();
+			++mNumContactIslands;
+		}
+		mContactIslands[mIslandOfRoot[r]].contacts.push_back(c);
+	}
 }
 
-void PhysicsModule::UndoSphereOverlap(
-	std::shared_ptr<RigidSphere> const& rigidSphere0,
-	std::shared_ptr<RigidSphere> const& rigidSphere1,
-	double overlap, bool moved0, bool moved1)
+template <typename Real>
+void PhysicsModule<Real>::SolveContactIsland(ContactIsland& island)
 {
-	auto const& sphere0 = rigidSphere0->GetWorldSphere();
-	auto const& sphere1 = rigidSphere1->GetWorldSphere();
-	auto normal = sphere1.center - sphere0.center;
-	Normalize(normal);
+	// The problem is w = q + M*z with z the normal impulses and w the
+	// normal relative velocities after the impulses minus the restitution
+	// targets. M[i][j] is the normal relative velocity at contact i per
+	// unit normal impulse at contact j. A body contributes to M[i][j] when
+	// it belongs to both contacts, with sign +1 as body A and -1 as body B
+	// of a contact, and its contribution is
+	//   invMass * Dot(N[i],N[j]) + Dot(rxN[i],invJ*rxN[j])
+	// where r is the contact point relative to the center of the body.
+	size_t const n = island.contacts.size();
+	size_t const invalid = std::numeric_limits<size_t>::max();
+	island.q.resize(n);
+	island.M.resize(n * n);
+	for (size_t i = 0; i < n; ++i)
+	{
+		auto const& sci = mSolverContacts[island.contacts[i]];
+		island.q[i] = static_cast<double>(Dot(sci.N, GetRelativeVelocity(sci)) - sci.target);
 
-	Contact contact{};
-	contact.A = rigidSphere0;
-	contact.B = rigidSphere1;
-	contact.N = normal;
-	contact.restitution = mRestitution;
-	auto offset = overlap * contact.N;
+		std::array<size_t, 2> const bodyI{ sci.a, (sci.isPlane ? invalid : sci.b) };
+		Vector3<Real> const rAxNI = Cross(sci.rA, sci.N), rBxNI = Cross(sci.rB, sci.N);
+		std::array<Vector3<Real> const*, 2> const rxNI{ &rAxNI, &rBxNI };
+		for (size_t j = i; j < n; ++j)
+		{
+			auto const& scj = mSolverContacts[island.contacts[j]];
+			std::array<size_t, 2> const bodyJ{ scj.a, (scj.isPlane ? invalid : scj.b) };
+			Vector3<Real> const rAxNJ = Cross(scj.rA, scj.N), rBxNJ = Cross(scj.rB, scj.N);
+			std::array<Vector3<Real> const*, 2> const rxNJ{ &rAxNJ, &rBxNJ };
+			double const NdotN = static_cast<double>(Dot(sci.N, scj.N));
+			double m = 0.0;
+			for (size_t si = 0; si < 2; ++si)
+			{
+				for (size_t sj = 0; sj < 2; ++sj)
+				{
+					size_t const body = bodyI[si];
+					if (body != invalid && body == bodyJ[sj] && mSpheres.IsMovable(body))
+					{
+						double const term =
+							static_cast<double>(mSpheres.invMass[body]) * NdotN +
+							static_cast<double>(mSpheres.GetInverseInertiaForm(body,
+								*rxNI[si], *rxNJ[sj]));
+						m += (si == sj ? term : -term);
+					}
+				}
+			}
+			island.M[i * n + j] = m;
+			island.M[j * n + i] = m;
+		}
+	}
 
-	if (moved0 && !moved1)
+	// Solve the LCP, reusing the solver of the previous tick when the
+	// island has the same number of contacts.
+	island.fallback = true;
+	island.numIterations = 0;
+	if (n <= mLCPMaxContacts)
 	{
-		// Sphere i0 moved but sphere i1 did not.
-		rigidSphere1->SetPosition(rigidSphere1->GetPosition() + offset);
-		rigidSphere1->UpdateWorldQuantities();
+		if (!island.lcp || island.lcpDimension != n)
+		{
+			island.lcp = std::make_unique<gte::LCPSolver<double>>(static_cast<int32_t>(n));
+			island.lcpDimension = n;
+		}
+		gte::LCPSolverShared<double>::Result result{};
+		if (island.lcp->Solve(island.q, island.M, island.w, island.z, &result))
+		{
+			island.fallback = false;
+			island.numIterations = static_cast<size_t>(island.lcp->GetNumIterations());
+		}
 	}
-	else if (!moved0 && moved1)
+
+	if (island.fallback)
 	{
-		// Sphere i1 moved but sphere i0 did not.
-		rigidSphere0->SetPosition(rigidSphere0->GetPosition() - offset);
-		rigidSphere0->UpdateWorldQuantities();
+		// Projected Gauss-Seidel iterations on the same problem.
+		island.z.assign(n, 0.0);
+		while (island.numIterations < mSolverMaxIterations)
+		{
+			++island.numIterations;
+			double maxDelta = 0.0;
+			for (size_t i = 0; i < n; ++i)
+			{
+				double const Mii = island.M[i * n + i];
+				if (Mii <= 0.0)
+				{
+					continue;
+				}
+				double wi = island.q[i];
+				for (size_t j = 0; j < n; ++j)
+				{
+					wi += island.M[i * n + j] * island.z[j];
+				}
+				double const lambda = std::max(island.z[i] - wi / Mii, 0.0);
+				maxDelta = std::max(maxDelta, std::fabs(lambda - island.z[i]));
+				island.z[i] = lambda;
+			}
+
+			if (maxDelta <= static_cast<double>(mSolverTolerance))
+			{
+				break;
+			}
+		}
 	}
-	else
+
+	// Apply the normal impulses, then one friction impulse per contact
+	// bounded by the Coulomb limit of its normal impulse.
+	for (size_t i = 0; i < n; ++i)
 	{
-		// Neither sphere moved or both spheres moved. Avoid bias
-		// by moving both spheres half the offset.
-		offset *= 0.5;
-		rigidSphere1->SetPosition(rigidSphere1->GetPosition() + offset);
-		rigidSphere1->UpdateWorldQuantities();
-		rigidSphere0->SetPosition(rigidSphere0->GetPosition() - offset);
-		rigidSphere0->UpdateWorldQuantities();
+		auto& sc = mSolverContacts[island.contacts[i]];
+		sc.lambdaN = island.z[i];
+		ApplyIslandImpulse(sc, static_cast<Real>(sc.lambdaN) * sc.N);
+	}
+	for (size_t i = 0; i < n; ++i)
+	{
+		auto& sc = mSolverContacts[island.contacts[i]];
+		double maxT = static_cast<double>(mSolverFriction) * sc.lambdaN;
+		Vector3<Real> vRel = GetRelativeVelocity(sc);
+		sc.lambdaT1 = std::min(std::max(
+			-static_cast<double>(sc.massT1 * Dot(sc.T1, vRel)), -maxT), maxT);
+		sc.lambdaT2 = std::min(std::max(
+			-static_cast<double>(sc.massT2 * Dot(sc.T2, vRel)), -maxT), maxT);
+		ApplyIslandImpulse(sc, static_cast<Real>(sc.lambdaT1) * sc.T1 +
+			static_cast<Real>(sc.lambdaT2) * sc.T2);
 	}
+}
 
-	contact.P = rigidSphere0->GetPosition() + sphere0.radius * contact.N;
-	mContacts.push_back(contact);
+template <typename Real>
+void PhysicsModule<Real>::ApplyIslandImpulse(SolverContact const& sc,
+	Vector3<Real> const& impulse)
+{
+	if (mSpheres.IsMovable(sc.a))
+	{
+		mSpheres.SetLinearMomentum(sc.a, mSpheres.linearMomentum[sc.a] + impulse);
+		mSpheres.SetAngularMomentum(sc.a, mSpheres.angularMomentum[sc.a] + Cross(sc.rA, impulse));
+	}
+	if (!sc.isPlane && mSpheres.IsMovable(sc.b))
+	{
+		mSpheres.SetLinearMomentum(sc.b, mSpheres.linearMomentum[sc.b] - impulse);
+		mSpheres.SetAngularMomentum(sc.b, mSpheres.angularMomentum[sc.b] - Cross(sc.rB, impulse));
+	}
 }
+
+template class PhysicsModule<float>;
+template class PhysicsModule<double>;
@@ -1,5 +1,18 @@
 #include "RigidPlane.h"
-#include "RigidSphere.h"
+#include "RigidDistanceField.h"
+#include "RigidMesh.h"
+#include "RigidSphereStore.h"
+#include "UniformGrid.h"
+#include "HierarchicalGrid.h"
+#include "DynamicAABBTree.h"
+#include "BoxManager.h"
+#include "LCPSolver.h"
+#include "NumaTopology.h"
+#include "WorkerTeam.h"
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <vector>
 using namespace Vector_GM;
@@ -10,22 +23,123 @@ using namespace Vector_GM;
 // the DoCollisionResponse function uses a variation for computing impulses,
 // described in
 //   https://www.geometrictools.com/Documentation/ComputingImpulsiveForces.pdf
+//
+// Real is the type of the sphere state and of the per-contact arithmetic,
+// float or double; both are instantiated in PhysModule.cpp. With float the
+// state arrays are half the size and the batched integrator processes
+// twice as many spheres per SIMD register. The quantities that accumulate
+// many small increments are kept in double for both types: the physics
+// clock passed to DoTick, the Runge-Kutta combination of the four stages,
+// which is rounded to Real once per tick, and the accumulated impulses of
+// the sequential-impulse solver. PhysicsModule<double> produces the same
+// results as before the type was made a template parameter.
 
+template <typename Real>
 class PhysicsModule
 {
 public:
-	PhysicsModule(size_t numSpheres, double xMin, double xMax, double yMin,
-		double yMax, double zMin, double zMax);
+	PhysicsModule(size_t numSpheres, Real xMin, Real xMax, Real yMin,
+		Real yMax, Real zMin, Real zMax);
 
 	// This function must be called for each of the numSpheres sphere objects
 	// before starting the simulation.
-	void InitializeSphere(size_t i, double radius, double massDensity,
-		Vector3<double> const& position, Vector3<double> const& linearVelocity,
-		Quaternion<double> const& qOrientation, Vector3<double> const& angularVelocity);
+	void InitializeSphere(size_t i, Real radius, Real massDensity,
+		Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity);
+
+	// Capsules and oriented boxes are bodies of the same storage as the
+	// spheres; see RigidSphereStore for their representation. Index i,
+	// handles, sleeping, the solvers and the snapshots treat all bodies
+	// alike, and the functions named for spheres apply to every body.
+	// Every pair of bodies whose bounding spheres are a broadphase
+	// candidate is tested with the contact kernel of its shapes:
+	//   sphere-sphere, capsule-sphere, capsule-capsule: the closest points
+	//     of two segments, a sphere being a segment of length zero;
+	//   box-sphere: the closest point of the box to the sphere center;
+	//   capsule-plane, box-plane: the support point of the body in the
+	//     direction opposite the plane normal.
+	// The pairs box-box and box-capsule and the static colliders use the
+	// bounding spheres of the boxes and the capsules. The continuous
+	// collision detection, the floor friction of the integrator and
+	// RayCast also use the bounding spheres, and capsules and boxes are
+	// neither swept nor hit by swept spheres.
+	void InitializeCapsule(size_t i, Real radius, Real halfLength, Real massDensity,
+		Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity);
+
+	void InitializeBox(size_t i, Vector3<Real> const& extent, Real massDensity,
+		Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity);
 
 	inline size_t GetNumSpheres() const
 	{
-		return mRigidSphere.size();
+		return mSpheres.GetNumSpheres();
+	}
+
+	// Insertion and removal of spheres between calls to DoTick. The storage
+	// stays compact: AddSphere appends the sphere and RemoveSphere moves
+	// the last sphere into the slot of the removed one, which changes the
+	// index of the moved sphere. A handle identifies a sphere for its
+	// lifetime regardless of its index; the spheres of the constructor have
+	// handles 0 through numSpheres-1. The handle of a removed sphere becomes
+	// invalid and can be returned again by a later AddSphere. Both functions
+	// wake the affected islands, make the broadphase rebuild its structures
+	// on the next tick and discard the contact manifolds of the removed and
+	// the moved spheres.
+	size_t AddSphere(Real radius, Real massDensity, Vector3<Real> const& position,
+		Vector3<Real> const& linearVelocity, Quaternion<Real> const& qOrientation,
+		Vector3<Real> const& angularVelocity);
+
+	size_t AddCapsule(Real radius, Real halfLength, Real massDensity,
+		Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity);
+
+	size_t AddBox(Vector3<Real> const& extent, Real massDensity,
+		Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity);
+
+	void RemoveSphere(size_t handle);
+
+	// The state of a sphere that determines its motion, for transferring
+	// spheres between modules. The mass density of an immovable sphere is
+	// zero. The radius is the shape radius and the shape and the extent
+	// are those of RigidSphereStore.
+	struct SphereState
+	{
+		Real radius, massDensity;
+		uint8_t shape;
+		Vector3<Real> extent;
+		Vector3<Real> position;
+		Quaternion<Real> qOrientation;
+		Vector3<Real> linearMomentum, angularMomentum;
+	};
+
+	void GetSphereState(size_t i, SphereState& state) const;
+
+	// Bulk insertion and removal at the end of the storage. AddSpheres
+	// appends the spheres, with the momenta of the states, and returns the
+	// handle of each in 'handles'. RemoveLastSpheres removes the spheres
+	// with indices i >= first, which moves no other sphere. Both have the
+	// effects of the corresponding sequence of AddSphere or RemoveSphere
+	// calls but update the contact manifolds once instead of per sphere.
+	void AddSpheres(std::vector<SphereState> const& states, std::vector<size_t>& handles);
+	void RemoveLastSpheres(size_t first);
+
+	inline bool IsValidHandle(size_t handle) const
+	{
+		return handle < mHandleToIndex.size() && mHandleToIndex[handle] != InvalidIndex;
+	}
+
+	// The handle must be valid.
+	inline size_t GetSphereIndex(size_t handle) const
+	{
+		return mHandleToIndex[handle];
+	}
+
+	// The input must satisfy 0 <= i < GetNumSpheres().
+	inline size_t GetSphereHandle(size_t i) const
+	{
+		return mIndexToHandle[i];
 	}
 
 	// The input must satisfy 0 <= i < 6 where the extremes were passed to the
@@ -37,48 +151,1310 @@ public:
 	//   plane[3]: front wall, Dot((-1,0,0),(x,y,z)) = -xMax
 	//   plane[4]: side2 wall, Dot((0,-1,0),(x,y,z)) = -yMax
 	//   plane[5]: ceiling, Dot((0,0,-1),(x,y,z)) = -zMax
-	inline Plane3<double> GetPlane(size_t i) const
+	inline Plane3<Real> GetPlane(size_t i) const
 	{
 		return mRigidPlane[i]->GetPlane();
 	}
 
+	// An open plane generates no contacts, so spheres can leave the region
+	// through it. PhysicsDomain opens the planes between neighboring
+	// domains. The planes are closed by default.
+	void SetPlaneOpen(size_t i, bool open);
+
+	inline bool IsPlaneOpen(size_t i) const
+	{
+		return mPlaneOpen[i] != 0;
+	}
+
+	// Static colliders of arbitrary shape, for example the level geometry,
+	// represented by signed distance fields. A sphere is tested against a
+	// collider with one batched sample of the distance and the gradient of
+	// its center, so the cost does not depend on the number of triangles
+	// of the geometry. A sphere touches the collider when the distance is
+	// smaller than its radius; it is pushed out along the normal, the
+	// normalized gradient, and its contact is handled like a sphere-plane
+	// contact. AddStaticCollider returns the index of the collider. The
+	// colliders are not part of the continuous collision detection.
+	size_t AddStaticCollider(std::shared_ptr<RigidDistanceField<Real>> const& collider);
+
+	inline size_t GetNumStaticColliders() const
+	{
+		return mColliders.size();
+	}
+
+	inline std::shared_ptr<RigidDistanceField<Real>> const& GetStaticCollider(size_t c) const
+	{
+		return mColliders[c];
+	}
+
+	// Static colliders that are triangle meshes. The triangles near a
+	// sphere are found in the bounding volume hierarchy of the mesh and
+	// tested with batched closest-point queries, so the cost is
+	// logarithmic in the number of triangles. A sphere that touches the
+	// mesh is pushed out of the closest triangle, and the test is repeated
+	// at the new position up to MeshPushIterations times, so a sphere in a
+	// corner is pushed out of all its walls. The sphere has one contact per
+	// mesh, whose normal is the direction of the total push. For a capsule
+	// or a box the radius is replaced by the support distance along the
+	// normal. AddStaticMesh returns the index of the mesh. The meshes are
+	// not part of the continuous collision detection; a swept sphere can be
+	// tested with RigidMesh::FindFirstContact.
+	size_t AddStaticMesh(std::shared_ptr<RigidMesh<Real>> const& mesh);
+
+	inline size_t GetNumStaticMeshes() const
+	{
+		return mMeshes.size();
+	}
+
+	inline std::shared_ptr<RigidMesh<Real>> const& GetStaticMesh(size_t m) const
+	{
+		return mMeshes[m];
+	}
+
 	// The input must satisfy 0 <= i < numSpheres where the upper bound was
 	// passed to the constructor.
-	inline Sphere3<double> GetWorldSphere(size_t i) const
+	inline Sphere3<Real> GetWorldSphere(size_t i) const
 	{
-		return mRigidSphere[i]->GetWorldSphere();
+		return mSpheres.GetWorldSphere(i);
 	}
 
-	inline Matrix3x3<double> const& GetOrientation(size_t i) const
+	inline Matrix3x3<Real> const& GetOrientation(size_t i) const
 	{
-		return mRigidSphere[i]->GetROrientation();
+		return mSpheres.rOrientation[i];
+	}
+
+	// Read-only access to the structure-of-arrays sphere storage.
+	inline RigidSphereStore<Real> const& GetSpheres() const
+	{
+		return mSpheres;
 	}
 
 	// Execute the physics simulation. The caller of this function maintains
 	// the physics clock.
 	void DoTick(double time, double deltaTime);
 
+	// The coefficient of restitution of all contacts, in [0,1]. The
+	// default is 0.8.
+	inline void SetRestitution(Real restitution)
+	{
+		mRestitution = restitution;
+	}
+
+	inline Real GetRestitution() const
+	{
+		return mRestitution;
+	}
+
+	// The instrumentation of the last call to DoTick: the wall-clock times
+	// in nanoseconds of its phases and the amount of work of each phase.
+	// The detection time is the sum of the broadphase time, which includes
+	// the tree update at the end of the tick, the sphere-plane time, which
+	// includes the static colliders, and the sphere-sphere time. The
+	// response time is the application of the impulses. The integration
+	// time is the Runge-Kutta step and the continuous time is the
+	// continuous collision detection. numPairsTested is the number of
+	// candidate pairs passed to the sphere-sphere overlap test,
+	// numContacts the number of contacts of which numPlaneContacts are
+	// sphere-plane and sphere-collider contacts, and numBodiesIntegrated
+	// the number of movable awake spheres. numIntegrationSteps is the
+	// number of Runge-Kutta steps, which exceeds numBodiesIntegrated when
+	// the ADAPTIVE integrator substeps spheres. Define
+	// PHYSICS_MODULE_NO_STATISTICS to compile out the timers and the
+	// counters; the times, numPairsTested, numBodiesIntegrated and
+	// numIntegrationSteps are then zero.
+	struct TickStatistics
+	{
+		int64_t detectionNanoseconds;
+		int64_t broadphaseNanoseconds;
+		int64_t spherePlaneNanoseconds;
+		int64_t sphereSphereNanoseconds;
+		int64_t responseNanoseconds;
+		int64_t integrationNanoseconds;
+		int64_t continuousNanoseconds;
+		size_t numPairsTested;
+		size_t numContacts;
+		size_t numPlaneContacts;
+		size_t numBodiesIntegrated;
+		size_t numIntegrationSteps;
+	};
+
+	inline TickStatistics const& GetTickStatistics() const
+	{
+		return mTickStatistics;
+	}
+
+	// The broadphase generates the candidate sphere-sphere pairs that are
+	// passed to the overlap test. BRUTE_FORCE tests all n*(n-1)/2 pairs.
+	// UNIFORM_GRID bins the spheres into a grid over the simulation region
+	// whose cells are at least the diameter of the largest sphere.
+	// SORT_AND_SWEEP keeps one bounding box per sphere in a BoxManager and
+	// incrementally re-sorts the box endpoints each tick; for coherent
+	// motion the endpoints are nearly sorted and the update is close to
+	// linear in the number of spheres. AABB_TREE keeps the fat bounding
+	// boxes of the spheres in a DynamicAABBTree; its cost does not depend
+	// on the ratio of the largest to the smallest radius, so it is the
+	// choice when the radii vary by orders of magnitude. HIERARCHICAL_GRID
+	// inserts each sphere into a spatial hash at the level whose cells fit
+	// its diameter (see HierarchicalGrid); it is rebuilt each tick, needs
+	// no simulation region and suits crowded scenes whose radii vary by
+	// orders of magnitude. AUTOMATIC selects one of the others on each tick
+	// from the number, the sizes and the crowding of the spheres; see
+	// SelectBroadphase. All modes process the candidate pairs in
+	// lexicographic order, so overlaps are resolved in the same order. The
+	// default is BRUTE_FORCE.
+	enum class Broadphase
+	{
+		BRUTE_FORCE,
+		UNIFORM_GRID,
+		SORT_AND_SWEEP,
+		AABB_TREE,
+		HIERARCHICAL_GRID,
+		AUTOMATIC
+	};
+
+	inline void SetBroadphase(Broadphase broadphase)
+	{
+		mBroadphase = broadphase;
+	}
+
+	inline Broadphase GetBroadphase() const
+	{
+		return mBroadphase;
+	}
+
+	// The broadphase used by the last call to DoTick, which differs from
+	// GetBroadphase() only in AUTOMATIC mode.
+	inline Broadphase GetActiveBroadphase() const
+	{
+		return mActiveBroadphase;
+	}
+
+	// The selection of AUTOMATIC mode for the current spheres, from the
+	// number of spheres n, the ratio of the largest to the smallest
+	// positive radius and the crowding, the total volume of the bounding
+	// cubes of the spheres divided by the volume of the simulation region:
+	//   BRUTE_FORCE for n < 64, for which the batched all-pairs test is
+	//     cheaper than maintaining a structure;
+	//   UNIFORM_GRID for a ratio of at most 4 when the grid has at most 8n
+	//     cells, so that binning the spheres is not dominated by the empty
+	//     cells;
+	//   HIERARCHICAL_GRID for a larger ratio when the crowding is at least
+	//     1, where the bounding boxes of the large spheres overlap so many
+	//     others that the incremental structures degrade;
+	//   AABB_TREE in the same case when the ratio exceeds the levels of the
+	//     hierarchical grid;
+	//   SORT_AND_SWEEP otherwise, which is the fastest for sparse scenes
+	//     with coherent motion.
+	Broadphase SelectBroadphase() const;
+
+	// The hierarchical grid of the HIERARCHICAL_GRID broadphase, for its
+	// levels and cells after a tick and for setting the maximum number of
+	// levels.
+	inline HierarchicalGrid<Real>& GetHierarchicalGrid()
+	{
+		return mHierarchicalGrid;
+	}
+
+	inline HierarchicalGrid<Real> const& GetHierarchicalGrid() const
+	{
+		return mHierarchicalGrid;
+	}
+
+	// The number of candidate sphere-sphere pairs that the broadphase
+	// produced during the last call to DoTick.
+	inline size_t GetNumCandidatePairs() const
+	{
+		return mNumCandidatePairs;
+	}
+
+	// The fat box of a sphere in the AABB_TREE broadphase is its bounding
+	// box enlarged by margin * radius on each side and by the predicted
+	// motion of the next ticks. A larger margin makes reinsertions rarer
+	// but produces more candidate pairs. The default is 0.1.
+	inline void SetTreeMargin(Real margin)
+	{
+		mTreeMargin = margin;
+	}
+
+	inline Real GetTreeMargin() const
+	{
+		return mTreeMargin;
+	}
+
+	// The tree of the AABB_TREE broadphase, for box queries and ray casts
+	// against the fat boxes. The user data of a leaf is the sphere index.
+	// The tree is updated by DoTick, and after DoTick every sphere is
+	// inside its fat box. It is empty before the first tick in AABB_TREE
+	// mode.
+	inline DynamicAABBTree<Real> const& GetTree() const
+	{
+		return mTree;
+	}
+
+	// Find the first sphere hit by the segment origin + t * direction,
+	// 0 <= t <= tMax. On a hit the function returns true and sets the
+	// sphere index and the parameter of the hit point. The candidates are
+	// taken from the tree in AABB_TREE mode after the first tick, and all
+	// spheres are tested otherwise. The direction need not be unit length.
+	bool RayCast(Vector3<Real> const& origin, Vector3<Real> const& direction,
+		Real tMax, size_t& sphere, Real& t) const;
+
+	// The integrator solves the equations of motion with the integration
+	// method, the Runge-Kutta fourth-order method by default. SCALAR advances
+	// one sphere at a time. BATCHED advances groups of BatchSize spheres with
+	// each quantity stored in one lane per sphere, so the arithmetic can be
+	// compiled to SIMD instructions (AVX2 holds 4 doubles or 8 floats). Both
+	// modes perform the same IEEE operations in the same order, so they produce
+	// identical results provided the compiler does not contract a*b+c into
+	// fused multiply-adds (MSVC /fp:precise, or -ffp-contract=off for GCC and
+	// Clang). ADAPTIVE advances each sphere with 2^level substeps of
+	// deltaTime/2^level, where level is the smallest integer for which the
+	// sphere turns by at most maxAngle radians per substep, limited to
+	// maxLevel. The translation under gravity is integrated exactly by any
+	// step, so the error of a sphere away from the floor comes from the
+	// rotation and grows with (|W|*deltaTime)^5 per step. A few fast spinning
+	// spheres then get the accuracy of a small time step without the cost of
+	// reducing the time step of all spheres. The spheres are grouped by level
+	// and the threads split each level, so the results do not depend on the
+	// number of threads. The default is SCALAR.
+	enum class Integrator
+	{
+		SCALAR,
+		BATCHED,
+		ADAPTIVE
+	};
+
+	inline void SetIntegrator(Integrator integrator)
+	{
+		mIntegrator = integrator;
+	}
+
+	inline Integrator GetIntegrator() const
+	{
+		return mIntegrator;
+	}
+
+	// The method that advances a sphere by one step. RUNGE_KUTTA is the
+	// fourth-order method with four force and torque evaluations per step.
+	// SEMI_IMPLICIT_EULER advances the momenta with the force and torque at the
+	// start of the step and then the position and orientation with the new
+	// velocities, one evaluation per step. VELOCITY_VERLET splits the momentum
+	// update into two half steps around the position update, two evaluations
+	// per step. SEMI_IMPLICIT_EULER is first-order accurate and VELOCITY_VERLET
+	// second-order accurate, but both are symplectic, so the energy of a
+	// bouncing sphere oscillates instead of drifting. Their floor friction
+	// stops a sliding or spinning sphere rather than reversing its motion
+	// within a step. BATCHED applies to RUNGE_KUTTA; the other methods advance
+	// one sphere at a time. The default is RUNGE_KUTTA.
+	enum class IntegrationMethod
+	{
+		RUNGE_KUTTA,
+		SEMI_IMPLICIT_EULER,
+		VELOCITY_VERLET
+	};
+
+	inline void SetIntegrationMethod(IntegrationMethod method)
+	{
+		mIntegrationMethod = method;
+	}
+
+	inline IntegrationMethod GetIntegrationMethod() const
+	{
+		return mIntegrationMethod;
+	}
+
+	// The kinetic energy of the spheres plus their gravitational potential
+	// energy relative to z = 0.
+	double GetEnergy() const;
+
+	// The parameters of ADAPTIVE mode, maxAngle > 0 and maxLevel <= 16. The
+	// defaults are maxAngle = 0.1 and maxLevel = 6, at most 64 substeps per
+	// tick.
+	void SetAdaptiveParameters(Real maxAngle, size_t maxLevel);
+
+	inline Real GetAdaptiveMaxAngle() const
+	{
+		return mAdaptiveMaxAngle;
+	}
+
+	inline size_t GetAdaptiveMaxLevel() const
+	{
+		return mAdaptiveMaxLevel;
+	}
+
+	// Set numThreads to 0 to run DoTick single-threaded in the calling
+	// thread. Set numThreads > 0 to run the sphere-plane tests, the
+	// sphere-sphere tests and the integration on numThreads threads. The
+	// impulses are applied in the calling thread. The multithreaded
+	// narrowphase first finds the overlapping pairs and then resolves them
+	// in lexicographic order, so the results are the same for every
+	// numThreads > 0 but can differ slightly from those for numThreads = 0.
+	// The default is 0.
+	void SetNumThreads(size_t numThreads);
+
+	inline size_t GetNumThreads() const
+	{
+		return mNumThreads;
+	}
+
+	// NUMA-aware partitioning of the threads and the spheres, for machines
+	// with several NUMA nodes (sockets). With numNodes > 0 and
+	// numThreads > 0 the threads are divided into min(numNodes,numThreads)
+	// groups of consecutive threads, and the threads of group p are pinned
+	// to the processors of node p modulo the number of nodes of the
+	// machine. Each worker is pinned once, when the team is started. The spheres are divided into as many chunks of consecutive
+	// indices, and the threads of group p test the spheres of chunk p
+	// against the planes and the colliders and integrate them. The
+	// candidate pairs of a broadphase are tested in two phases: the pairs
+	// within chunk p by the threads of group p, then the pairs across
+	// chunks by all threads. The all-pairs test of BRUTE_FORCE is not
+	// partitioned. For a fixed order of the spheres the results do not
+	// depend on numNodes. The default is 0, which disables the partitioning
+	// and the pinning.
+	void SetNumaNodes(size_t numNodes);
+
+	inline size_t GetNumaNodes() const
+	{
+		return mNumaNodes;
+	}
+
+	// Sort the spheres along the longest axis of the region, so that the
+	// chunks are slabs of the region and most candidate pairs are within a
+	// chunk. With partitioning, the threads of group p write the sorted
+	// spheres of chunk p into newly discarded pages, so the operating
+	// system allocates the storage of the chunk on the node of the group
+	// (first-touch). The indices of the spheres change and their handles
+	// do not. The broadphase rebuilds its structures on the next tick, and
+	// the contact manifolds whose two spheres change order are discarded.
+	// Call it after SetNumThreads and SetNumaNodes, and again every few
+	// hundred ticks as the spheres move between slabs.
+	void PartitionSpheres();
+
+	// Sleeping skips the spheres that have come to rest. The islands are
+	// the groups of spheres connected by sphere-sphere contacts during a
+	// tick. An island falls asleep when each of its spheres has had a
+	// linear speed smaller than linearSpeed and an angular speed smaller
+	// than angularSpeed for numTicks consecutive ticks, at which time its
+	// velocities are set to zero. Sleeping spheres are not integrated, not
+	// tested against the planes and not tested against other sleeping
+	// spheres. An awake sphere that overlaps a sleeping sphere wakes the
+	// island of the sleeping sphere. Sleeping is disabled by default;
+	// DisableSleeping wakes all spheres.
+	void EnableSleeping(size_t numTicks, Real linearSpeed, Real angularSpeed);
+	void DisableSleeping();
+
+	inline bool IsAwake(size_t i) const
+	{
+		return mAwake[i] != 0;
+	}
+
+	size_t GetNumAwakeSpheres() const;
+
+	// The contact solver computes the collision impulses. SINGLE_PASS
+	// applies the impulse of each contact once. SEQUENTIAL_IMPULSE
+	// iterates over all contacts, applying
+	// corrective impulses until the accumulated impulses change by at most
+	// the tolerance or the maximum number of iterations is reached. The
+	// accumulated normal impulses are nonnegative, the friction impulses
+	// are bounded by the friction coefficient times the normal impulse, and
+	// the accumulated impulses of each body pair warm-start the solver on
+	// the next ticks; see SetContactPersistence. Both visit the contacts
+	// color by color, where the contacts of a color share no movable
+	// sphere, and split large colors among the threads set by
+	// SetNumThreads; the results do not depend on the number of threads.
+	// LCP groups the contacts into islands of spheres
+	// connected by sphere-sphere contacts and solves the normal impulses
+	// of each island together as a linear complementarity problem with
+	// LCPSolver: the normal impulses are nonnegative and every contact
+	// either separates at its restitution velocity or has no impulse. A
+	// single friction impulse, bounded by the friction coefficient times
+	// the normal impulse, is then applied at each contact. Islands with
+	// more contacts than the LCP limit, and islands whose LCP fails, are
+	// solved with projected Gauss-Seidel iterations on the same system
+	// using the iteration parameters. The islands are solved on the
+	// threads set by SetNumThreads. The defaults are SINGLE_PASS and, for
+	// the iterative solver, 10 iterations, a tolerance of 1e-06 and a
+	// friction coefficient of 0.5. The default LCP limit is 64 contacts.
+	enum class Solver
+	{
+		SINGLE_PASS,
+		SEQUENTIAL_IMPULSE,
+		LCP
+	};
+
+	inline void SetSolver(Solver solver)
+	{
+		mSolver = solver;
+	}
+
+	inline Solver GetSolver() const
+	{
+		return mSolver;
+	}
+
+	void SetSolverParameters(size_t maxIterations, Real tolerance, Real friction);
+
+	inline size_t GetSolverMaxIterations() const
+	{
+		return mSolverMaxIterations;
+	}
+
+	inline Real GetSolverTolerance() const
+	{
+		return mSolverTolerance;
+	}
+
+	inline Real GetSolverFriction() const
+	{
+		return mSolverFriction;
+	}
+
+	inline void SetLCPMaxContacts(size_t maxContacts)
+	{
+		mLCPMaxContacts = maxContacts;
+	}
+
+	inline size_t GetLCPMaxContacts() const
+	{
+		return mLCPMaxContacts;
+	}
+
+	// The sequential-impulse solver keeps a contact manifold per body
+	// pair. A contact of the current tick warm-starts from the manifold of
+	// its pair when its point is within matchDistance times the radius of
+	// sphere A of the cached point and its normal is within 30 degrees of
+	// the cached normal; otherwise it starts from zero impulses. A
+	// manifold is kept for numTicks ticks after its pair last had a
+	// contact, so resting contacts that are missed for a tick, because
+	// the position correction left the bodies exactly touching or an
+	// island slept, resume with their accumulated impulses. With numTicks
+	// = 0 only the contacts of the previous tick are kept. The defaults
+	// are 4 ticks and 0.25.
+	void SetContactPersistence(size_t numTicks, Real matchDistance);
+
+	inline size_t GetContactPersistence() const
+	{
+		return mContactPersistence;
+	}
+
+	inline Real GetContactMatchDistance() const
+	{
+		return mContactMatchDistance;
+	}
+
+	// The number of cached manifolds and the number of contacts of the
+	// last call to DoTick that were warm-started from them.
+	inline size_t GetNumContactManifolds() const
+	{
+		return mManifolds.size();
+	}
+
+	inline size_t GetNumWarmStartedContacts() const
+	{
+		return mNumWarmStartedContacts;
+	}
+
+	// The number of iterations of the last call to DoTick. For the LCP
+	// solver it is the largest number of pivots or Gauss-Seidel iterations
+	// of an island.
+	inline size_t GetSolverNumIterations() const
+	{
+		return mSolverNumIterations;
+	}
+
+	// The number of contact islands of the last call to DoTick in LCP mode
+	// and how many of them were solved with Gauss-Seidel iterations.
+	inline size_t GetNumContactIslands() const
+	{
+		return mNumContactIslands;
+	}
+
+	inline size_t GetNumFallbackIslands() const
+	{
+		return mNumFallbackIslands;
+	}
+
+	// The number of contact colors of the last call to DoTick in
+	// SINGLE_PASS or SEQUENTIAL_IMPULSE mode; see ColorContacts.
+	inline size_t GetNumContactColors() const
+	{
+		return mNumContactColors;
+	}
+
+	// Continuous collision detection keeps fast spheres from passing
+	// through the planes and through each other within one tick. After the
+	// integration, a sphere is fast when it moved farther than its radius.
+	// The motion of each fast sphere is treated as linear over the tick,
+	// and the first time of impact with a plane or another sphere is
+	// computed. The other spheres of an impact are found by querying the
+	// active broadphase with the box swept by the fast sphere, and the
+	// pairs of fast spheres by a sort-and-sweep of their swept boxes, so
+	// the cost does not grow with the product of the numbers of fast and
+	// other spheres. The spheres of the earliest impacts are moved back to
+	// the contact positions, the impulse is applied, and they are advanced
+	// with the new velocities for the rest of the tick. A sphere is
+	// sub-stepped at most once per tick; the discrete detection of the
+	// next tick handles any further contact. Only these spheres are
+	// sub-stepped, so the tick does not have to be shortened for the
+	// fastest sphere. The impacts are processed on the calling thread in
+	// the order of (time, sphere, other), and they are counted as contacts
+	// of the tick.
+	// Continuous collision is disabled by default.
+	inline void SetContinuousCollision(bool enable)
+	{
+		mContinuousCollision = enable;
+	}
+
+	inline bool GetContinuousCollision() const
+	{
+		return mContinuousCollision;
+	}
+
+	// The number of impacts found by continuous collision detection during
+	// the last call to DoTick.
+	inline size_t GetNumSweptContacts() const
+	{
+		return mNumSweptContacts;
+	}
+
+	// Snapshots for rollback and replay. SaveSnapshot copies the state
+	// that DoTick reads and modifies into a flat versioned binary blob: the
+	// sphere storage, the sphere handles, the sleeping state and the
+	// contact manifolds. Each array is copied with one memcpy. The settings
+	// (restitution, broadphase, solver, sleeping thresholds and so on), the
+	// planes and the static colliders are not part of the snapshot and must
+	// be the same when it is restored. RestoreSnapshot returns false and
+	// leaves the module unchanged when the blob is not a snapshot of this
+	// version, of the same Real type and of a module with the same number
+	// of static colliders. Both functions reuse the storage of the blob and
+	// of the module, so repeated saves and restores do not allocate once
+	// the sizes have reached their high-water marks. After a restore the
+	// broadphase rebuilds its structures on the next tick; all broadphase
+	// modes resolve the overlaps in lexicographic order, so the ticks that
+	// follow a restore reproduce those that followed the save.
+	void SaveSnapshot(std::vector<uint8_t>& snapshot) const;
+	bool RestoreSnapshot(std::vector<uint8_t> const& snapshot);
+
 private:
-	using Contact = RigidBodyContact<double>;
+	// A contact between sphere i0 and either sphere i1 or the immovable
+	// plane i1. The plane contacts store i1 as the plane index and set
+	// isPlane to true. The contacts with static collider c are handled as
+	// plane contacts with i1 = 6 + c and those with static mesh m with
+	// i1 = 6 + numColliders + m. The coefficient of restitution is mRestitution.
+	// The contact is a flat record of indices into the sphere storage, so
+	// unlike RigidBodyContact<double> it holds no shared_ptr references
+	// and has no virtual functions; copying it is a plain copy.
+	struct Contact
+	{
+		size_t i0, i1;
+		bool isPlane;
+		Vector3<Real> P, N;
+	};
+
+	static size_t constexpr InvalidIndex = std::numeric_limits<size_t>::max();
+
+	// The keys of the sphere-plane manifolds are numSpheres plus the plane
+	// index, so they change with the number of spheres.
+	void RemapPlaneKeys(size_t oldNumSpheres, size_t newNumSpheres);
+
+	// The number of bytes of a snapshot with the specified array sizes.
+	static size_t GetSnapshotSize(size_t numSpheres, size_t numHandles,
+		size_t numFreeHandles, size_t numManifolds);
 
 	void DoCollisionDetection();
-	void DoCollisionResponse(double time, double deltaTime);
+	void DoCollisionResponse();
+	void DoIntegration(double time, double deltaTime);
+	void DoContinuousCollision(double deltaTime);
+
+	// A first time of impact, as a fraction t in [0,1] of the tick,
+	// between sphere i0 and either sphere i1 or plane i1.
+	struct SweptContact
+	{
+		Real t;
+		size_t i0, i1;
+		bool isPlane;
+
+		inline bool operator<(SweptContact const& other) const
+		{
+			if (t != other.t)
+			{
+				return t < other.t;
+			}
+			if (i0 != other.i0)
+			{
+				return i0 < other.i0;
+			}
+			if (isPlane != other.isPlane)
+			{
+				return isPlane;
+			}
+			return i1 < other.i1;
+		}
+	};
+
+	// Prepare the broadphase for the queries of FindSweptContacts. The
+	// uniform grid bins the spheres and the tree moves them to their
+	// positions after the integration. The other broadphases use
+	// mSweepOrder, the spheres sorted by the x-coordinates of those
+	// positions.
+	void PrepareSweptQueries();
+
+	// Append the impacts of fast sphere i with the planes and with the
+	// spheres that are not fast. Those spheres moved at most their radius,
+	// so the candidates are the spheres of the broadphase whose final
+	// bounding boxes are within radius[i] + mMaxRadius of the box swept by
+	// sphere i.
+	void FindSweptContacts(size_t i);
+
+	// Append the impacts of pairs of fast spheres, the candidates of a
+	// sort-and-sweep of their swept bounding boxes along x.
+	void FindFastSweptContacts();
+
+	// Append the impact of sphere i with sphere j, if any, as (t,i,j).
+	void AddSweptContact(size_t i, size_t j);
+
+	// The impulse computation of RigidBodyContact<T>::ApplyImpulse applied
+	// to the sphere storage. Body B is the other sphere or an immovable
+	// plane, in which case its velocities, inverse mass and inverse inertia
+	// are zero.
+	void ApplyImpulse(Contact const& contact);
+
+	// Advance each movable awake sphere i of the storage with begin <= i <
+	// end. IntegrateSphere is the Runge-Kutta fourth-order solver of
+	// RigidBody<T>::Update applied to the sphere storage.
+	void IntegrateSpheres(size_t begin, size_t end, double time, double deltaTime);
+	void IntegrateSphere(size_t i, double time, double deltaTime);
+
+	// Advance sphere i by one step of the integration method.
+	void StepSphere(size_t i, double time, double deltaTime);
+	void StepSphereSemiImplicitEuler(size_t i, double time, double deltaTime);
+	void StepSphereVelocityVerlet(size_t i, double time, double deltaTime);
+
+	// The ADAPTIVE integrator. GroupStepLevels computes the level of each
+	// movable awake sphere and sorts the spheres by level into
+	// mLevelSpheres, stably, so the spheres of level l are
+	// mLevelSpheres[mLevelStarts[l]] through mLevelSpheres[mLevelStarts[l+1]-1].
+	void GroupStepLevels(double deltaTime);
+	void IntegrateSpheresAdaptive(double time, double deltaTime);
+
+	// The batched integrator. BatchState stores the state variables, or
+	// their derivatives, of BatchSize consecutive spheres with component k
+	// of lane j in X[k][j], and similarly for the other quantities. A
+	// batch is 32 bytes per component, the width of an AVX register.
+	static size_t constexpr BatchSize = 32 / sizeof(Real);
+	using Lanes = std::array<Real, BatchSize>;
+	struct BatchState
+	{
+		std::array<Lanes, 3> X, P, L, V, W;
+		std::array<Lanes, 4> Q;
+	};
+
+	void IntegrateSphereBatch(size_t first, double time, double deltaTime);
+
+	// Compute the derivatives dX/dt, dQ/dt, dP/dt and dL/dt of the spheres
+	// starting at first.
+	void EvaluateBatch(size_t first, BatchState const& state,
+		BatchState& derivative) const;
+
+	// Compute state = state0 + step * derivative, normalize the quaternions
+	// and update the velocities.
+	void AdvanceBatch(size_t first, BatchState const& state0,
+		BatchState const& derivative, Real step, BatchState& state) const;
+
+	static void NormalizeBatch(std::array<Lanes, 4>& q, size_t j);
 
-	bool SetSpherePlaneContact(std::shared_ptr<RigidSphere> const& rigidSphere,
-		std::shared_ptr<RigidPlane> const& rigidPlane, double overlap);
+	// The external force and torque on sphere i at the specified time and
+	// for the specified state.
+	Vector3<Real> GetForce(size_t i, double time, Vector3<Real> const& position,
+		Vector3<Real> const& linearVelocity) const;
+	Vector3<Real> GetTorque(size_t i, double time, Vector3<Real> const& position,
+		Vector3<Real> const& angularVelocity) const;
 
-	void UndoSphereOverlap(
-		std::shared_ptr<RigidSphere> const& rigidSphere0,
-		std::shared_ptr<RigidSphere> const& rigidSphere1,
-		double overlap, bool moved0, bool moved1);
+	// Partition [0,numItems) into mNumThreads ranges stored in mBounds and
+	// run function(t, mBounds[t], mBounds[t + 1]) on worker t of mTeam.
+	// GetTeam starts the workers on the first call after SetNumThreads.
+	void GetUniformBounds(size_t numItems, size_t alignment);
+	WorkerTeam& GetTeam();
+
+	template <typename Function>
+	void RunThreads(Function const& function);
+
+	// The number of thread groups and sphere chunks of SetNumaNodes, 0 when
+	// the spheres are not partitioned. The threads of group p are
+	// GetGroupStart(p) through GetGroupStart(p + 1) - 1.
+	inline size_t GetNumPartitions() const
+	{
+		return (mNumThreads > 0 ? std::min(mNumaNodes, mNumThreads) : 0);
+	}
+
+	inline size_t GetGroupStart(size_t p) const
+	{
+		size_t const numPartitions = GetNumPartitions();
+		return (p * mNumThreads + numPartitions - 1) / numPartitions;
+	}
+
+	// Chunk p has the spheres mChunkStarts[p] through mChunkStarts[p + 1]
+	// - 1. The interior starts are multiples of ColliderChunkSize, which is
+	// a multiple of BatchSize, so the threads of a group can use either
+	// alignment.
+	void ComputeChunkStarts(size_t numSpheres);
+	size_t GetChunk(size_t i, size_t numSpheres) const;
+
+	// Partition each range starts[p] through starts[p + 1] - 1 among the
+	// threads of group p and store the bounds in mBounds.
+	void GetGroupBounds(std::vector<size_t> const& starts, size_t alignment);
+
+	// GetUniformBounds for the spheres, or GetGroupBounds for the chunks
+	// when the spheres are partitioned.
+	void GetSphereBounds(size_t numSpheres, size_t alignment);
+
+	// Reorder mPairs so that the pairs within chunk p are mPairs[k] for
+	// mPairStarts[p] <= k < mPairStarts[p + 1], followed by the pairs
+	// across chunks.
+	void PartitionPairs(size_t numSpheres);
+
+	// A contact prepared for the sequential-impulse solver. The solver
+	// normal N points from body B to body A, T1 and T2 span the tangent
+	// plane and the lambda members are the accumulated impulses. For
+	// sphere-sphere contacts the key is the index b of sphere B; for
+	// sphere-plane contacts it is numSpheres plus the plane index.
+	struct SolverContact
+	{
+		size_t a, b, key;
+		bool isPlane;
+		Vector3<Real> rA, rB, N, T1, T2;
+		Real massN, massT1, massT2, target;
+		double lambdaN, lambdaT1, lambdaT2;
+	};
+
+	// The persistent contact of a body pair, sorted by (a,key). A sphere
+	// touches another sphere or a plane at a single point, so the manifold
+	// of a pair has one point: its position P and solver normal N when the
+	// pair last had a contact, the accumulated impulses of that contact and
+	// the number of ticks since then.
+	struct ContactManifold
+	{
+		size_t a, key;
+		Vector3<Real> P, N;
+		double normal;
+		Vector3<Real> tangent;
+		size_t age;
+
+		inline bool operator<(ContactManifold const& other) const
+		{
+			return a < other.a || (a == other.a && key < other.key);
+		}
+	};
+
+	// The contacts of an island of the LCP solver, as indices into
+	// mSolverContacts, and the storage of its problem w = q + M*z. The
+	// islands are kept across ticks so that their arrays and solvers are
+	// reused; the solver is recreated only when the number of contacts of
+	// the island changes.
+	struct ContactIsland
+	{
+		std::vector<size_t> contacts;
+		std::vector<double> q, M, w, z;
+		std::unique_ptr<gte::LCPSolver<double>> lcp;
+		size_t lcpDimension;
+		size_t numIterations;
+		bool fallback;
+	};
+
+	void PrepareSolverContacts();
+	void CacheSolverImpulses();
+	void SolveContacts();
+	void SolveContactsLCP();
+	void BuildContactIslands();
+	void SolveContactIsland(ContactIsland& island);
+
+	// Graph coloring of the contacts, so that their impulses can be applied
+	// on several threads. mContactBodies[k] holds the spheres of contact k,
+	// with InvalidIndex for a plane. ColorContacts gives each contact, in
+	// contact order, the smallest color that no earlier contact of one of
+	// its movable spheres has; planes and immovable spheres are never
+	// written, so they do not conflict. The contacts of a color share no
+	// movable sphere and can be applied in any order, and in parallel,
+	// with the same result. Color c is mColorContacts[mColorStarts[c]]
+	// through mColorContacts[mColorStarts[c + 1] - 1], in contact order. A
+	// contact that would need more than MaxContactColors colors goes into
+	// a last group that is applied on one thread.
+	void ColorContacts();
+
+	// Call function(t, begin, end) on ranges of the positions in
+	// mColorContacts, one color after the other, in a single call of
+	// mTeam with barriers between the colors. A color is split among the
+	// workers when it has at least MinColorContactsPerThread contacts per
+	// worker; otherwise it is processed by worker 0 with t = 0. The ranges
+	// of a split color start at multiples of BatchSize from the start of
+	// the color, so they cover whole batches of mSolverLanes.
+	template <typename Function>
+	void RunColors(Function const& function);
+
+	// One projected Gauss-Seidel update of a contact of the
+	// sequential-impulse solver. The function returns the largest change
+	// of the accumulated impulses.
+	double SolveSolverContact(SolverContact& sc);
+
+	// The batched versions of SolveSolverContact and ApplyImpulse for the
+	// positions [begin,end) of one color in mColorContacts. The contacts
+	// of a color share no movable sphere, so BatchSize of them are gathered
+	// into lanes and updated together. The lanes repeat the operations of
+	// the scalar functions in the same order, so the results do not depend
+	// on the batching. The last group of ColorContacts shares spheres and
+	// is processed by the scalar functions.
+	double SolveSolverContacts(size_t begin, size_t end);
+	void ApplyImpulses(size_t begin, size_t end);
+
+	// The contact data of the sequential-impulse solver does not change
+	// during the iterations, so PackSolverLanes gathers the colored
+	// contacts into mSolverLanes once per tick, BatchSize contacts of a
+	// color per element, and each iteration gathers only the bodies. The
+	// batches of color c start at mColorBatches[c]. UnpackSolverLanes
+	// copies the accumulated impulses back to mSolverContacts.
+	void PackSolverLanes();
+	void UnpackSolverLanes();
+
+	// The lanes of a body of the batched solver: body A or body B of the
+	// contacts. A lane of a plane, or an unused lane of a batch, holds a
+	// zero body with isMovable = 0 and is never written back. The lanes
+	// apply the scalar inverse inertia of isotropic bodies; the products
+	// and quadratic forms of a capsule or a box are computed by
+	// RigidSphereStore. hasAnisotropic is true when a movable lane is a
+	// capsule or a box.
+	struct BodyLanes
+	{
+		std::array<size_t, BatchSize> index;
+		std::array<Lanes, 3> X, P, L, V, W;
+		Lanes invMass, invInertia, isMovable, isIsotropic;
+		bool hasAnisotropic;
+	};
+
+	// The lanes of the contacts of the batched solver. a and b are the
+	// bodies of the lanes, InvalidIndex for the body B of a plane and for
+	// both bodies of an unused lane.
+	struct SolverLanes
+	{
+		std::array<size_t, BatchSize> a, b;
+		std::array<Lanes, 3> rA, rB, N, T1, T2;
+		Lanes massN, massT1, massT2, target;
+		std::array<double, BatchSize> lambdaN, lambdaT1, lambdaT2;
+	};
+
+	// Gather body i into lane j, or a zero body for i = InvalidIndex, and
+	// write the movable bodies of the lanes back to mSpheres. The lanes are
+	// gathered in order, starting with j = 0.
+	void GatherBody(size_t i, size_t j, BodyLanes& body) const;
+	void ScatterBodies(BodyLanes const& body, size_t numLanes);
+
+	// The relative velocity of the bodies at the contact point of lane j.
+	static inline std::array<Real, 3> GetRelativeVelocity(SolverLanes const& lanes,
+		BodyLanes const& bodyA, BodyLanes const& bodyB, size_t j)
+	{
+		std::array<Real, 3> velocity{};
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			int32_t const d1 = (d + 1) % 3, d2 = (d + 2) % 3;
+			Real const velA = bodyA.V[d][j] +
+				(bodyA.W[d1][j] * lanes.rA[d2][j] - bodyA.W[d2][j] * lanes.rA[d1][j]);
+			Real const velB = bodyB.V[d][j] +
+				(bodyB.W[d1][j] * lanes.rB[d2][j] - bodyB.W[d2][j] * lanes.rB[d1][j]);
+			velocity[d] = velA - velB;
+		}
+		return velocity;
+	}
+
+	// Store Cross(U,V) of lane j in UxV.
+	static inline void SetCross(std::array<Lanes, 3> const& U,
+		std::array<Lanes, 3> const& V, std::array<Lanes, 3>& UxV, size_t j)
+	{
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			int32_t const d1 = (d + 1) % 3, d2 = (d + 2) % 3;
+			UxV[d][j] = U[d1][j] * V[d2][j] - U[d2][j] * V[d1][j];
+		}
+	}
+
+	// Add sign * impulse at the point r relative to the center to the
+	// momenta of body lane j, sign = 1 for body A and -1 for body B, and
+	// update its velocities. The lane is blended with isMovable, which is
+	// 0 or 1, instead of selected, so the compilers vectorize the loops
+	// over the lanes. For finite momenta the products by 0 and 1 and the
+	// sums with 0 do not change the values of a movable lane. The momenta
+	// of an immovable lane are not written back by ScatterBodies, and its
+	// velocities are kept. The angular velocities of the capsules and
+	// boxes are then recomputed by UpdateAnisotropicVelocities.
+	static inline void ApplyBodyImpulse(std::array<Lanes, 3> const& r,
+		std::array<Real, 3> const& impulse, Real sign, BodyLanes& body, size_t j)
+	{
+		Real const movable = body.isMovable[j];
+		Real const fixed = static_cast<Real>(1) - movable;
+		std::array<Real, 3> I{};
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			I[d] = sign * impulse[d];
+		}
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			int32_t const d1 = (d + 1) % 3, d2 = (d + 2) % 3;
+			Real const P = body.P[d][j] + movable * I[d];
+			Real const L = body.L[d][j] + movable * (r[d1][j] * I[d2] - r[d2][j] * I[d1]);
+			body.P[d][j] = P;
+			body.L[d][j] = L;
+			body.V[d][j] = movable * (body.invMass[j] * P) + fixed * body.V[d][j];
+			body.W[d][j] = movable * (body.invInertia[j] * L) + fixed * body.W[d][j];
+		}
+	}
+
+	void UpdateAnisotropicVelocities(BodyLanes& body) const;
+
+	// Apply an impulse to the movable bodies of a contact. Immovable
+	// spheres can be shared by islands on different threads, so their
+	// momenta are not written.
+	void ApplyIslandImpulse(SolverContact const& sc, Vector3<Real> const& impulse);
+
+	Vector3<Real> GetRelativeVelocity(SolverContact const& sc) const;
+	Real GetEffectiveMass(SolverContact const& sc, Vector3<Real> const& direction) const;
+	void ApplySolverImpulse(SolverContact const& sc, Vector3<Real> const& impulse);
+
+	// Island bookkeeping for sleeping.
+	void WakeIsland(size_t i);
+	size_t FindIsland(size_t i);
+	void UpdateSleepStates();
+
+	// Compute the candidate pairs for the uniform-grid broadphase.
+	void ComputeGridPairs();
+
+	// Compute the candidate pairs for the sort-and-sweep broadphase.
+	void ComputeSweepPairs();
+
+	// Compute the candidate pairs for the AABB-tree broadphase.
+	void ComputeTreePairs();
+
+	// Compute the candidate pairs for the hierarchical-grid broadphase.
+	void ComputeHierarchicalPairs();
+
+	// Build the tree or move the leaves of the spheres that have left
+	// their fat boxes. The tree is updated before the pairs are computed
+	// and after the integration, so that RayCast sees fat boxes that
+	// contain the spheres.
+	void UpdateTree();
+
+	// Intersect the segment with sphere i. On an intersection the function
+	// returns true and sets t to the first parameter in [0,tMax].
+	bool IntersectSphere(size_t i, Vector3<Real> const& origin,
+		Vector3<Real> const& direction, Real tMax, Real& t) const;
+
+	// The narrowphase for a candidate sphere-sphere pair. The overlap is
+	// positive when the spheres intersect and zero otherwise.
+	// TestSphereOverlap returns false when the pair is skipped because both
+	// spheres are sleeping. It uses GetShapeContact for the pairs with a
+	// capsule or a box.
+	Real GetSphereOverlap(size_t i0, size_t i1) const;
+	bool TestSphereOverlap(size_t i0, size_t i1);
+
+	// The contact kernels of the pairs with a capsule or a box. On an
+	// intersection the function returns true and sets the overlap, the
+	// unit-length normal from body i0 to body i1 and the contact point on
+	// the surface of body i0.
+	bool GetShapeContact(size_t i0, size_t i1, Real& overlap,
+		Vector3<Real>& normal, Vector3<Real>& point) const;
+
+	// Body i as the segment A + s * E, 0 <= s <= 1, swept by its shape
+	// radius; E is zero for a sphere.
+	void GetSegment(size_t i, Vector3<Real>& A, Vector3<Real>& E) const;
+
+	// The parameters of the closest points A0 + s * E0 and A1 + t * E1 of
+	// two segments, from a = Dot(E0,E0), b = Dot(E0,E1), c = Dot(E0,A0-A1),
+	// e = Dot(E1,E1) and f = Dot(E1,A0-A1); see "Real-Time Collision
+	// Detection" by Christer Ericson, section 5.1.9. Segments of length
+	// zero are allowed. The function has no branches, so the batched
+	// narrowphase evaluates it in SIMD lanes.
+	static inline void GetSegmentParameters(Real a, Real b, Real c, Real e,
+		Real f, Real& s, Real& t)
+	{
+		Real const zero = static_cast<Real>(0);
+		Real const one = static_cast<Real>(1);
+		Real const epsilon = static_cast<Real>(1e-06);
+		Real const denom = a * e - b * b;
+		Real const invDenom = (denom > epsilon * a * e ? one / denom : zero);
+		Real const invA = (a > zero ? one / a : zero);
+		Real const invE = (e > zero ? one / e : zero);
+		Real const s0 = std::min(std::max((b * f - c * e) * invDenom, zero), one);
+		Real const t0 = (b * s0 + f) * invE;
+		t = std::min(std::max(t0, zero), one);
+		Real const s1 = std::min(std::max((b * t - c) * invA, zero), one);
+		s = ((t0 != t) | (e == zero) ? s1 : s0);
+	}
+
+	// The lanes of the batched narrowphase. delta is the difference of the
+	// centers of the pair and sumRadii the sum of the bounding radii. A
+	// lane with isSegment = 1 is a capsule-capsule or capsule-sphere pair
+	// whose segments are 0 + u * D0 and delta + v * D1 for u and v in
+	// [-1,1]. A lane with isBoxSphere = 1 is a box-sphere pair with delta
+	// from the box center to the sphere center, the box axes boxAxis[3*k]
+	// through boxAxis[3*k+2] and the box extents. sumShapeRadii is the sum
+	// of the shape radii of the pair.
+	struct PairLanes
+	{
+		std::array<Lanes, 3> delta, D0, D1, boxExtent;
+		std::array<Lanes, 9> boxAxis;
+		Lanes sumRadii, sumShapeRadii, isSegment, isBoxSphere;
+	};
+
+	void GatherPair(size_t i0, size_t i1, size_t j, PairLanes& lanes) const;
+
+	// The squared sum of the radii minus the squared distance for lane j,
+	// positive when the bodies intersect. The kernels have no branches.
+	static inline Real GetSegmentMargin(PairLanes const& lanes, size_t j)
+	{
+		// The segments are A0 + s * E0 and A1 + t * E1 for s and t in
+		// [0,1] with A0 = -D0, E0 = 2 * D0, A1 = delta - D1, E1 = 2 * D1.
+		Real const two = static_cast<Real>(2);
+		Real const e0x = two * lanes.D0[0][j], e0y = two * lanes.D0[1][j], e0z = two * lanes.D0[2][j];
+		Real const e1x = two * lanes.D1[0][j], e1y = two * lanes.D1[1][j], e1z = two * lanes.D1[2][j];
+		Real const rx = lanes.D1[0][j] - lanes.D0[0][j] - lanes.delta[0][j];
+		Real const ry = lanes.D1[1][j] - lanes.D0[1][j] - lanes.delta[1][j];
+		Real const rz = lanes.D1[2][j] - lanes.D0[2][j] - lanes.delta[2][j];
+		Real s{}, t{};
+		GetSegmentParameters(e0x * e0x + e0y * e0y + e0z * e0z,
+			e0x * e1x + e0y * e1y + e0z * e1z, e0x * rx + e0y * ry + e0z * rz,
+			e1x * e1x + e1y * e1y + e1z * e1z, e1x * rx + e1y * ry + e1z * rz, s, t);
+		Real const dx = rx + s * e0x - t * e1x;
+		Real const dy = ry + s * e0y - t * e1y;
+		Real const dz = rz + s * e0z - t * e1z;
+		return lanes.sumShapeRadii[j] * lanes.sumShapeRadii[j] - (dx * dx + dy * dy + dz * dz);
+	}
+
+	static inline Real GetBoxSphereMargin(PairLanes const& lanes, size_t j)
+	{
+		// The squared distance of the sphere center from the box, computed
+		// in box coordinates by clamping.
+		Real sqrDistance = static_cast<Real>(0);
+		for (size_t k = 0; k < 3; ++k)
+		{
+			Real const y = lanes.boxAxis[3 * k][j] * lanes.delta[0][j] +
+				lanes.boxAxis[3 * k + 1][j] * lanes.delta[1][j] +
+				lanes.boxAxis[3 * k + 2][j] * lanes.delta[2][j];
+			Real const clamped = std::min(std::max(y, -lanes.boxExtent[k][j]), lanes.boxExtent[k][j]);
+			sqrDistance += (y - clamped) * (y - clamped);
+		}
+		return lanes.sumShapeRadii[j] * lanes.sumShapeRadii[j] - sqrDistance;
+	}
+
+	// The margin of a pair with a capsule or a box as the batched
+	// narrowphase computes it, for the all-pairs narrowphase. Pairs that
+	// have no kernel use their bounding spheres.
+	Real GetShapeMargin(size_t i0, size_t i1) const;
+
+	// Move the bodies of a pair apart by the overlap along the normal as
+	// UndoSphereOverlap does and append the contact.
+	void UndoShapeOverlap(size_t i0, size_t i1, Real overlap,
+		Vector3<Real> const& normal, Vector3<Real> const& point,
+		bool moved0, bool moved1);
+
+	// The bookkeeping of InitializeSphere, InitializeCapsule and
+	// InitializeBox after the storage of body i is set.
+	void OnBodyInitialized(size_t i);
+
+	// Append a body to the storage with a new handle and return the handle.
+	// Initialize the body at index GetNumSpheres() - 1.
+	size_t AppendBody();
+
+	// Test the candidate pairs mPairs[p] with begin <= p < end against the
+	// current centers and append the overlapping pairs in candidate order.
+	// The pairs are tested BatchSize at a time. The capsule-capsule,
+	// capsule-sphere and box-sphere pairs of a batch are tested with their
+	// contact kernels in the same lanes, and the other pairs with a capsule
+	// or a box with their bounding spheres. The function returns the
+	// number of pairs tested, which excludes the pairs of two sleeping
+	// spheres.
+	size_t FindOverlappingPairs(size_t begin, size_t end,
+		std::vector<std::pair<size_t, size_t>>& overlaps) const;
+
+	// Test the spheres begin <= i < end against the planes and append the
+	// contacts in sphere order. The planes are the faces of the region box,
+	// so the signed distances are differences of the center coordinates
+	// and the box extremes. They are computed for BatchSize spheres at a
+	// time without branches, and only the spheres that touch a plane are
+	// visited to emit contacts. For a capsule or a box the radius is
+	// replaced by the support distance along the plane normal.
+	void TestSpherePlanes(size_t begin, size_t end, std::vector<Contact>& contacts);
+
+	void SetSpherePlaneContact(size_t sphere, size_t plane, Real overlap,
+		std::vector<Contact>& contacts);
+
+	// Test the spheres begin <= i < end against the static colliders and
+	// append the contacts. The awake spheres of a chunk of ColliderChunkSize
+	// spheres whose centers are in the grid of a collider are gathered and
+	// evaluated with one batch query. The chunks are processed in sphere
+	// order and the colliders in index order within a chunk, so with bounds
+	// that are multiples of the chunk size the per-thread contacts
+	// concatenate to those of the single-threaded test. The meshes are
+	// tested after the distance fields in each chunk.
+	static size_t constexpr ColliderChunkSize = 64;
+	static size_t constexpr MeshPushIterations = 4;
+
+	void TestSphereColliders(size_t begin, size_t end, std::vector<Contact>& contacts);
+
+	// Create the contact of a sphere with plane or collider i1 and move the
+	// sphere by overlap along the unit-length normal. The contact point of a
+	// capsule or a box is its support point opposite the normal.
+	void SetStaticContact(size_t sphere, size_t i1, Real overlap,
+		Vector3<Real> const& normal, std::vector<Contact>& contacts);
+
+	void UndoSphereOverlap(size_t sphere0, size_t sphere1, Real overlap,
+		bool moved0, bool moved1);
 
 	// Physical representations of solid spheres.
-	std::vector<std::shared_ptr<RigidSphere>> mRigidSphere;
+	RigidSphereStore<Real> mSpheres;
+
+	// mHandleToIndex[h] is the index of the sphere with handle h, or
+	// InvalidIndex for a removed sphere whose handle is in mFreeHandles.
+	std::vector<size_t> mHandleToIndex;
+	std::vector<size_t> mIndexToHandle;
+	std::vector<size_t> mFreeHandles;
 
-	// Physical representation of planar boundaries.
-	std::array<std::shared_ptr<RigidPlane>, 6> mRigidPlane;
+	// Physical representation of planar boundaries. The plane tests use
+	// the region extremes of the closed planes; the extremes of the open
+	// planes are -max and +max, so their overlaps are never positive.
+	std::array<std::shared_ptr<RigidPlane<Real>>, 6> mRigidPlane;
+	std::array<uint8_t, 6> mPlaneOpen;
+	Vector3<Real> mPlaneMin, mPlaneMax;
 
-	// Contact points during one pass of the physical simulation.
+	// Static colliders of arbitrary shape.
+	std::vector<std::shared_ptr<RigidDistanceField<Real>>> mColliders;
+	std::vector<std::shared_ptr<RigidMesh<Real>>> mMeshes;
+
+	// Contact points during one pass of the physical simulation. The
+	// array is the per-tick contact arena: it is cleared but not released
+	// at the start of each tick, so after the first ticks contact
+	// generation does not allocate.
 	std::vector<Contact> mContacts;
-	double mRestitution;
+	Real mRestitution;
+
+	// mMoved[i] is 1 when a plane test moved sphere i during the current
+	// tick. The flags are bytes rather than std::vector<bool> bits so that
+	// threads can set the flags of different spheres concurrently.
+	std::vector<uint8_t> mMoved;
+
+	// The simulation region and the largest sphere radius, used to size the
+	// uniform grid.
+	Vector3<Real> mRegionMin, mRegionMax;
+	Real mMaxRadius;
+
+	// Broadphase state. The grid is rebuilt lazily when the maximum radius
+	// changes. The pairs are reused across ticks. The sweep and tree states
+	// are discarded when the active broadphase changes.
+	Broadphase mBroadphase, mActiveBroadphase;
+	UniformGrid<Real> mGrid;
+	bool mGridDirty;
+	HierarchicalGrid<Real> mHierarchicalGrid;
+	std::vector<std::pair<size_t, size_t>> mPairs;
+	size_t mNumCandidatePairs;
+
+	// Sort-and-sweep state. The BoxManager stores a reference to mBoxes, so
+	// mBoxes must not be resized while the manager exists. The manager is
+	// created on the first tick in SORT_AND_SWEEP mode and is discarded
+	// when a sphere is (re)initialized.
+	std::vector<gte::AlignedBox3<Real>> mBoxes;
+	std::unique_ptr<gte::BoxManager<Real>> mBoxManager;
+
+	// AABB-tree state. mTreeProxies[i] is the leaf of sphere i. The tree
+	// is rebuilt on the first tick in AABB_TREE mode and after a sphere is
+	// (re)initialized. The motion of the spheres is predicted from their
+	// velocities and the time step of the current tick.
+	DynamicAABBTree<Real> mTree;
+	std::vector<size_t> mTreeProxies;
+	Real mTreeMargin;
+	double mTreeDeltaTime;
+
+	Integrator mIntegrator;
+	IntegrationMethod mIntegrationMethod;
+	Real mAdaptiveMaxAngle;
+	size_t mAdaptiveMaxLevel;
+	std::vector<uint8_t> mStepLevels;
+	std::vector<size_t> mLevelSpheres, mLevelStarts;
+
+	// Multithreading state. Thread t writes only mThreadContacts[t],
+	// mThreadPairs[t] and mThreadNumTests[t]. Those are merged in thread
+	// order, which is the single-threaded order. The threads are the
+	// persistent workers of mTeam, which run every phase of every tick.
+	size_t mNumThreads;
+	std::vector<size_t> mBounds;
+	std::vector<std::vector<Contact>> mThreadContacts;
+	std::vector<std::vector<std::pair<size_t, size_t>>> mThreadPairs;
+	std::vector<size_t> mThreadNumTests;
+	std::vector<std::pair<size_t, size_t>> mOverlaps;
+	std::unique_ptr<WorkerTeam> mTeam;
+
+	// NUMA partitioning state. mTopology is created by SetNumaNodes.
+	size_t mNumaNodes;
+	std::unique_ptr<NumaTopology> mTopology;
+	std::vector<size_t> mChunkStarts, mPairStarts;
+	std::vector<std::pair<size_t, size_t>> mPartitionPairs;
+
+	// Sleeping state; mSleepTicks = 0 disables sleeping. mSleepCounter[i]
+	// is the number of consecutive slow ticks of sphere i. The union-find
+	// parents, minimum counters and last members of the islands are
+	// stored per root and reused across ticks.
+	size_t mSleepTicks;
+	Real mSleepLinearSpeed, mSleepAngularSpeed;
+	std::vector<uint8_t> mAwake;
+	std::vector<size_t> mSleepCounter;
+	std::vector<size_t> mIslandNext;
+	std::vector<size_t> mIslandParent;
+	std::vector<size_t> mIslandMinCounter;
+	std::vector<size_t> mIslandLast;
+
+	TickStatistics mTickStatistics;
+
+	// Contact solver state. mManifolds holds the persistent contacts of
+	// the previous ticks.
+	Solver mSolver;
+	size_t mSolverMaxIterations;
+	Real mSolverTolerance;
+	Real mSolverFriction;
+	size_t mSolverNumIterations;
+	std::vector<SolverContact> mSolverContacts;
+	std::vector<ContactManifold> mManifolds, mNewManifolds;
+	size_t mContactPersistence;
+	Real mContactMatchDistance;
+	size_t mNumWarmStartedContacts;
+
+	// LCP solver state. mIslandOfRoot[r] is the index in mContactIslands
+	// of the island whose root sphere is r during the current tick.
+	size_t mLCPMaxContacts;
+	size_t mNumContactIslands;
+	size_t mNumFallbackIslands;
+	std::vector<ContactIsland> mContactIslands;
+	std::vector<size_t> mIslandOfRoot;
+
+	// Contact coloring state. Bit c of mColorMasks[i] is set when a contact
+	// of color c writes sphere i. mThreadMaxDelta[t] is the largest impulse
+	// change of the contacts solved by thread t.
+	static size_t constexpr MaxContactColors = 64;
+	static size_t constexpr MinColorContactsPerThread = 256;
+	std::vector<std::array<size_t, 2>> mContactBodies;
+	std::vector<uint64_t> mColorMasks;
+	std::vector<size_t> mContactColors, mColorStarts, mColorContacts;
+	size_t mNumContactColors;
+	std::vector<double> mThreadMaxDelta;
+	std::vector<SolverLanes> mSolverLanes;
+	std::vector<size_t> mColorBatches;
+
+	// Continuous collision state. mSweepStart holds the positions before
+	// the integration; mFast[i] is 1 when sphere i is fast and 2 after it
+	// has been sub-stepped. mFastSpheres lists the fast spheres,
+	// mFastOrder the minimum x of their swept boxes and their indices,
+	// and mSweptCandidates receives the broadphase queries.
+	bool mContinuousCollision;
+	size_t mNumSweptContacts;
+	std::vector<Vector3<Real>> mSweepStart;
+	std::vector<uint8_t> mFast;
+	std::vector<size_t> mFastSpheres;
+	std::vector<std::pair<Real, size_t>> mFastOrder;
+	std::vector<size_t> mSweepOrder;
+	std::vector<size_t> mSweptCandidates;
+	std::vector<SweptContact> mSweptContacts;
 };
\ No newline at end of file
@@ -0,0 +1,352 @@
+#include "PhysicsDomain.h"
+#include <algorithm>
+#include <cstring>
+
+SharedMemoryMailboxes::SharedMemoryMailboxes(size_t numRanks)
+	:
+	mNumRanks(numRanks),
+	mMailboxes(numRanks * numRanks)
+{
+	for (auto& mailbox : mMailboxes)
+	{
+		mailbox = std::make_unique<Mailbox>();
+	}
+}
+
+void SharedMemoryMailboxes::Post(size_t source, size_t target,
+	std::vector<uint8_t> const& message)
+{
+	Mailbox& mailbox = *mMailboxes[source * mNumRanks + target];
+	{
+		std::lock_guard<std::mutex> lock(mailbox.mutex);
+		mailbox.messages.push_back(message);
+	}
+	mailbox.ready.notify_one();
+}
+
+void SharedMemoryMailboxes::Take(size_t source, size_t target,
+	std::vector<uint8_t>& message)
+{
+	Mailbox& mailbox = *mMailboxes[source * mNumRanks + target];
+	std::unique_lock<std::mutex> lock(mailbox.mutex);
+	mailbox.ready.wait(lock, [&mailbox]() { return !mailbox.messages.empty(); });
+	message.swap(mailbox.messages.front());
+	mailbox.messages.pop_front();
+}
+
+SharedMemoryTransport::SharedMemoryTransport(
+	std::shared_ptr<SharedMemoryMailboxes> const& mailboxes, size_t rank)
+	:
+	mMailboxes(mailboxes),
+	mRank(rank)
+{
+	LogAssert(mMailboxes != nullptr && rank < mMailboxes->GetNumRanks(),
+		"Invalid argument.");
+}
+
+void SharedMemoryTransport::Send(size_t target, std::vector<uint8_t> const& message)
+{
+	mMailboxes->Post(mRank, target, message);
+}
+
+void SharedMemoryTransport::Receive(size_t source, std::vector<uint8_t>& message)
+{
+	mMailboxes->Take(source, mRank, message);
+}
+
+namespace
+{
+	template <typename Real>
+	inline Real GetBrickBound(Real rmin, Real rmax, size_t b, size_t n)
+	{
+		return (b < n ? rmin + (rmax - rmin) * static_cast<Real>(b) / static_cast<Real>(n) : rmax);
+	}
+
+	inline std::array<size_t, 3> GetBrickOfRank(std::array<size_t, 3> const& numDomains,
+		size_t rank)
+	{
+		return std::array<size_t, 3>{ rank % numDomains[0],
+			(rank / numDomains[0]) % numDomains[1],
+			rank / (numDomains[0] * numDomains[1]) };
+	}
+}
+
+template <typename Real>
+PhysicsDomain<Real>::PhysicsDomain(PhysicsTransport& transport,
+	std::array<size_t, 3> const& numDomains, size_t rank, Real xMin, Real xMax,
+	Real yMin, Real yMax, Real zMin, Real zMax, Real ghostWidth)
+	:
+	mTransport(transport),
+	mNumDomains(numDomains),
+	mRank(rank),
+	mBrick(GetBrickOfRank(numDomains, rank)),
+	mRegionMin{ xMin, yMin, zMin },
+	mRegionMax{ xMax, yMax, zMax },
+	mBrickMin{
+		GetBrickBound(xMin, xMax, mBrick[0], numDomains[0]),
+		GetBrickBound(yMin, yMax, mBrick[1], numDomains[1]),
+		GetBrickBound(zMin, zMax, mBrick[2], numDomains[2]) },
+	mBrickMax{
+		GetBrickBound(xMin, xMax, mBrick[0] + 1, numDomains[0]),
+		GetBrickBound(yMin, yMax, mBrick[1] + 1, numDomains[1]),
+		GetBrickBound(zMin, zMax, mBrick[2] + 1, numDomains[2]) },
+	mGhostWidth(ghostWidth),
+	mModule(0, mBrickMin[0], mBrickMax[0], mBrickMin[1], mBrickMax[1],
+		mBrickMin[2], mBrickMax[2]),
+	mNeighbors{},
+	mNeighborMin{},
+	mNeighborMax{},
+	mIds{},
+	mNumMigrated(0),
+	mNumGhosts(0),
+	mRecords{},
+	mOutgoing{},
+	mIncoming{},
+	mStates{},
+	mHandles{}
+{
+	LogAssert(numDomains[0] > 0 && numDomains[1] > 0 && numDomains[2] > 0 &&
+		rank < numDomains[0] * numDomains[1] * numDomains[2], "Invalid argument.");
+
+	for (size_t d = 0; d < 3; ++d)
+	{
+		mModule.SetPlaneOpen(d, mBrick[d] > 0);
+		mModule.SetPlaneOpen(d + 3, mBrick[d] + 1 < mNumDomains[d]);
+	}
+
+	// Iterating over z, y and x in this order visits the neighbors in
+	// increasing rank order.
+	std::array<size_t, 3> neighbor{};
+	for (size_t dz = 0; dz < 3; ++dz)
+	{
+		for (size_t dy = 0; dy < 3; ++dy)
+		{
+			for (size_t dx = 0; dx < 3; ++dx)
+			{
+				std::array<size_t, 3> const delta{ dx, dy, dz };
+				bool valid = (dx != 1 || dy != 1 || dz != 1);
+				for (size_t d = 0; d < 3 && valid; ++d)
+				{
+					// mBrick[d] + delta[d] - 1 must be in [0,mNumDomains[d]).
+					valid = (mBrick[d] + delta[d] >= 1 && mBrick[d] + delta[d] <= mNumDomains[d]);
+					neighbor[d] = mBrick[d] + delta[d] - 1;
+				}
+
+				if (valid)
+				{
+					Vector3<Real> nmin{}, nmax{};
+					for (size_t d = 0; d < 3; ++d)
+					{
+						nmin[d] = GetBrickBound(mRegionMin[d], mRegionMax[d], neighbor[d], mNumDomains[d]);
+						nmax[d] = GetBrickBound(mRegionMin[d], mRegionMax[d], neighbor[d] + 1, mNumDomains[d]);
+					}
+					mNeighbors.push_back(GetRank(neighbor));
+					mNeighborMin.push_back(nmin);
+					mNeighborMax.push_back(nmax);
+				}
+			}
+		}
+	}
+
+	mRecords.resize(mNeighbors.size());
+	mOutgoing.resize(mNeighbors.size());
+	mIncoming.resize(mNeighbors.size());
+}
+
+template <typename Real>
+bool PhysicsDomain<Real>::AddSphere(uint64_t id, Real radius, Real massDensity,
+	Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity)
+{
+	if (GetBrick(position) != mBrick)
+	{
+		return false;
+	}
+
+	mModule.AddSphere(radius, massDensity, position, linearVelocity,
+		qOrientation, angularVelocity);
+	mIds.push_back(id);
+	return true;
+}
+
+template <typename Real>
+std::array<size_t, 3> PhysicsDomain<Real>::GetBrick(Vector3<Real> const& point) const
+{
+	std::array<size_t, 3> brick{};
+	for (size_t d = 0; d < 3; ++d)
+	{
+		Real const t = static_cast<Real>(mNumDomains[d]) *
+			(point[d] - mRegionMin[d]) / (mRegionMax[d] - mRegionMin[d]);
+		if (t <= static_cast<Real>(0))
+		{
+			brick[d] = 0;
+		}
+		else
+		{
+			brick[d] = std::min(static_cast<size_t>(t), mNumDomains[d] - 1);
+		}
+	}
+	return brick;
+}
+
+template <typename Real>
+size_t PhysicsDomain<Real>::GetRank(std::array<size_t, 3> const& brick) const
+{
+	return brick[0] + mNumDomains[0] * (brick[1] + mNumDomains[1] * brick[2]);
+}
+
+template <typename Real>
+void PhysicsDomain<Real>::Exchange()
+{
+	size_t const numNeighbors = mNeighbors.size();
+	for (size_t k = 0; k < numNeighbors; ++k)
+	{
+		auto const& records = mRecords[k];
+		auto& message = mOutgoing[k];
+		message.resize(records.size() * sizeof(SphereRecord));
+		if (!records.empty())
+		{
+			std::memcpy(message.data(), records.data(), message.size());
+		}
+		mTransport.Send(mNeighbors[k], message);
+	}
+
+	// The messages are unpacked in neighbor order, so the spheres are
+	// appended in the same order regardless of the timing of the ranks.
+	mStates.clear();
+	for (size_t k = 0; k < numNeighbors; ++k)
+	{
+		auto& message = mIncoming[k];
+		mTransport.Receive(mNeighbors[k], message);
+		LogAssert(message.size() % sizeof(SphereRecord) == 0, "Invalid message.");
+		auto& records = mRecords[k];
+		records.resize(message.size() / sizeof(SphereRecord));
+		if (!records.empty())
+		{
+			std::memcpy(records.data(), message.data(), message.size());
+		}
+	}
+}
+
+template <typename Real>
+void PhysicsDomain<Real>::DoTick(double time, double deltaTime)
+{
+	size_t const numNeighbors = mNeighbors.size();
+
+	// Migration. Removing sphere i moves the last owned sphere into its
+	// slot, and the ids are moved the same way.
+	for (auto& records : mRecords)
+	{
+		records.clear();
+	}
+	mNumMigrated = 0;
+	for (size_t i = 0; i < mIds.size(); )
+	{
+		std::array<size_t, 3> const brick = GetBrick(mModule.GetSpheres().position[i]);
+		if (brick == mBrick)
+		{
+			++i;
+			continue;
+		}
+
+		std::array<size_t, 3> toward = mBrick;
+		for (size_t d = 0; d < 3; ++d)
+		{
+			if (brick[d] < mBrick[d])
+			{
+				--toward[d];
+			}
+			else if (brick[d] > mBrick[d])
+			{
+				++toward[d];
+			}
+		}
+		size_t const k = static_cast<size_t>(std::lower_bound(mNeighbors.begin(),
+			mNeighbors.end(), GetRank(toward)) - mNeighbors.begin());
+
+		SphereRecord record{};
+		record.id = mIds[i];
+		mModule.GetSphereState(i, record.state);
+		mRecords[k].push_back(record);
+		mModule.RemoveSphere(mModule.GetSphereHandle(i));
+		mIds[i] = mIds.back();
+		mIds.pop_back();
+		++mNumMigrated;
+	}
+
+	Exchange();
+	for (auto const& records : mRecords)
+	{
+		for (auto const& record : records)
+		{
+			mStates.push_back(record.state);
+			mIds.push_back(record.id);
+		}
+	}
+	mModule.AddSpheres(mStates, mHandles);
+
+	// Ghost exchange. Only the spheres near a face of the brick can be
+	// near a neighboring brick.
+	for (auto& records : mRecords)
+	{
+		records.clear();
+	}
+	size_t const numOwned = mIds.size();
+	for (size_t i = 0; i < numOwned; ++i)
+	{
+		auto const& center = mModule.GetSpheres().position[i];
+		bool nearFace = false;
+		for (size_t d = 0; d < 3; ++d)
+		{
+			nearFace = nearFace ||
+				center[d] - mBrickMin[d] <= mGhostWidth ||
+				mBrickMax[d] - center[d] <= mGhostWidth;
+		}
+		if (!nearFace)
+		{
+			continue;
+		}
+
+		SphereRecord record{};
+		record.id = mIds[i];
+		mModule.GetSphereState(i, record.state);
+		for (size_t k = 0; k < numNeighbors; ++k)
+		{
+			Real sqrDistance = static_cast<Real>(0);
+			for (size_t d = 0; d < 3; ++d)
+			{
+				Real diff = static_cast<Real>(0);
+				if (center[d] < mNeighborMin[k][d])
+				{
+					diff = mNeighborMin[k][d] - center[d];
+				}
+				else if (center[d] > mNeighborMax[k][d])
+				{
+					diff = center[d] - mNeighborMax[k][d];
+				}
+				sqrDistance += diff * diff;
+			}
+			if (sqrDistance <= mGhostWidth * mGhostWidth)
+			{
+				mRecords[k].push_back(record);
+			}
+		}
+	}
+
+	Exchange();
+	for (auto const& records : mRecords)
+	{
+		for (auto const& record : records)
+		{
+			mStates.push_back(record.state);
+		}
+	}
+	mNumGhosts = mStates.size();
+	mModule.AddSpheres(mStates, mHandles);
+
+	mModule.DoTick(time, deltaTime);
+	mModule.RemoveLastSpheres(numOwned);
+}
+
+template class PhysicsDomain<float>;
+template class PhysicsDomain<double>;
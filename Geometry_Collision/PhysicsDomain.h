@@ -0,0 +1,209 @@
+#pragma once
+
+#include "PhysModule.h"
+#include <array>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+using namespace Vector_GM;
+
+// Domain decomposition of a PhysicsModule simulation. The region is
+// divided into bricks, and each PhysicsDomain owns the spheres whose
+// centers are in its brick and simulates them with its own PhysicsModule.
+// The domains exchange messages through a PhysicsTransport, so they can
+// run on threads of one process or in separate processes.
+//
+// Each tick of a domain has three phases.
+//   1. Migration: the owned spheres whose centers have left the brick are
+//      removed and sent, with their complete state, to the neighbor in the
+//      direction of the brick that contains them. A sphere that moves more
+//      than one brick per tick is forwarded on the next ticks.
+//   2. Ghost exchange: a copy of every owned sphere within ghostWidth of a
+//      neighboring brick is sent to that neighbor, which appends it to its
+//      module as a ghost sphere.
+//   3. The module tick. The ghosts are removed afterwards, so between ticks
+//      the module contains only the owned spheres.
+// A contact between an owned sphere and a ghost is resolved by both
+// domains, each keeping the result for its own sphere, so the results
+// differ slightly from those of a single module. The ghost width must be at
+// least the largest sphere diameter plus the largest distance a sphere
+// moves in a tick. The planes between neighboring bricks are opened; the
+// planes on the boundary of the region stay closed. Sleeping islands do not
+// extend across bricks, because the ghosts are appended awake every tick.
+
+// The messages between the domains. Send must not wait for the matching
+// Receive, and the messages from one rank to another arrive in the order
+// they were sent. Implement the interface over sockets or MPI to run the
+// domains in separate processes.
+class PhysicsTransport
+{
+public:
+	virtual ~PhysicsTransport() = default;
+
+	virtual void Send(size_t target, std::vector<uint8_t> const& message) = 0;
+
+	// Block until the next message from the source rank arrives.
+	virtual void Receive(size_t source, std::vector<uint8_t>& message) = 0;
+};
+
+// The mailboxes of numRanks domains that run on threads of one process.
+// Create one SharedMemoryMailboxes and one SharedMemoryTransport per rank.
+class SharedMemoryMailboxes
+{
+public:
+	SharedMemoryMailboxes(size_t numRanks);
+
+	inline size_t GetNumRanks() const
+	{
+		return mNumRanks;
+	}
+
+	void Post(size_t source, size_t target, std::vector<uint8_t> const& message);
+	void Take(size_t source, size_t target, std::vector<uint8_t>& message);
+
+private:
+	struct Mailbox
+	{
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::deque<std::vector<uint8_t>> messages;
+	};
+
+	size_t mNumRanks;
+	std::vector<std::unique_ptr<Mailbox>> mMailboxes;
+};
+
+class SharedMemoryTransport : public PhysicsTransport
+{
+public:
+	SharedMemoryTransport(std::shared_ptr<SharedMemoryMailboxes> const& mailboxes,
+		size_t rank);
+
+	virtual void Send(size_t target, std::vector<uint8_t> const& message) override;
+	virtual void Receive(size_t source, std::vector<uint8_t>& message) override;
+
+private:
+	std::shared_ptr<SharedMemoryMailboxes> mMailboxes;
+	size_t mRank;
+};
+
+template <typename Real>
+class PhysicsDomain
+{
+public:
+	// The region [xMin,xMax]x[yMin,yMax]x[zMin,zMax] is divided into
+	// numDomains[0]*numDomains[1]*numDomains[2] bricks of equal size. The
+	// brick (b0,b1,b2) belongs to rank b0 + numDomains[0]*(b1 +
+	// numDomains[1]*b2). All ranks must use the same region, division and
+	// ghost width.
+	PhysicsDomain(PhysicsTransport& transport, std::array<size_t, 3> const& numDomains,
+		size_t rank, Real xMin, Real xMax, Real yMin, Real yMax, Real zMin,
+		Real zMax, Real ghostWidth);
+
+	// The module of the brick, for the settings (restitution, broadphase,
+	// solver and so on) and the static colliders. Add and remove spheres
+	// through the domain, not the module.
+	inline PhysicsModule<Real>& GetModule()
+	{
+		return mModule;
+	}
+
+	inline PhysicsModule<Real> const& GetModule() const
+	{
+		return mModule;
+	}
+
+	inline size_t GetRank() const
+	{
+		return mRank;
+	}
+
+	inline Vector3<Real> const& GetBrickMin() const
+	{
+		return mBrickMin;
+	}
+
+	inline Vector3<Real> const& GetBrickMax() const
+	{
+		return mBrickMax;
+	}
+
+	// Add a sphere if its center is in the brick of this domain; otherwise
+	// the function returns false. Every rank can be passed all spheres.
+	// The id identifies the sphere in all domains; the caller chooses it.
+	bool AddSphere(uint64_t id, Real radius, Real massDensity,
+		Vector3<Real> const& position, Vector3<Real> const& linearVelocity,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularVelocity);
+
+	// Between ticks, the spheres of the module are the owned spheres, and
+	// GetSphereId(i) is the id of module sphere i.
+	inline size_t GetNumOwnedSpheres() const
+	{
+		return mIds.size();
+	}
+
+	inline uint64_t GetSphereId(size_t i) const
+	{
+		return mIds[i];
+	}
+
+	// Migrate, exchange the ghosts and execute the tick of the module. All
+	// ranks must call DoTick with the same arguments.
+	void DoTick(double time, double deltaTime);
+
+	// The number of spheres sent to other domains and of ghost spheres
+	// received during the last call to DoTick.
+	inline size_t GetNumMigrated() const
+	{
+		return mNumMigrated;
+	}
+
+	inline size_t GetNumGhosts() const
+	{
+		return mNumGhosts;
+	}
+
+private:
+	// A sphere in a message. The messages are arrays of records copied with
+	// memcpy, like the arrays of PhysicsModule<Real>::SaveSnapshot.
+	struct SphereRecord
+	{
+		uint64_t id;
+		typename PhysicsModule<Real>::SphereState state;
+	};
+
+	// The rank of the brick that contains the point, with the point clamped
+	// to the region.
+	std::array<size_t, 3> GetBrick(Vector3<Real> const& point) const;
+
+	size_t GetRank(std::array<size_t, 3> const& brick) const;
+
+	// Send mOutgoing[k] to neighbor k and receive the message of each
+	// neighbor into mIncoming.
+	void Exchange();
+
+	PhysicsTransport& mTransport;
+	std::array<size_t, 3> mNumDomains;
+	size_t mRank;
+	std::array<size_t, 3> mBrick;
+	Vector3<Real> mRegionMin, mRegionMax, mBrickMin, mBrickMax;
+	Real mGhostWidth;
+	PhysicsModule<Real> mModule;
+
+	// The neighbors are the up to 26 adjacent bricks, in increasing rank
+	// order, with their boxes.
+	std::vector<size_t> mNeighbors;
+	std::vector<Vector3<Real>> mNeighborMin, mNeighborMax;
+
+	std::vector<uint64_t> mIds;
+	size_t mNumMigrated, mNumGhosts;
+
+	// Message storage reused across ticks.
+	std::vector<std::vector<SphereRecord>> mRecords;
+	std::vector<std::vector<uint8_t>> mOutgoing, mIncoming;
+	std::vector<typename PhysicsModule<Real>::SphereState> mStates;
+	std::vector<size_t> mHandles;
+};
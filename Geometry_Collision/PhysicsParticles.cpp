@@ -0,0 +1,49 @@
+#include "PhysicsParticles.h"
+
+template <typename Real>
+PhysicsParticles<Real>::PhysicsParticles(PhysicsModule<Real> const& module,
+	int32_t numParticles, Real step, int32_t numIterations)
+	:
+	gte::PositionBasedDynamics<3, Real>(numParticles, step, numIterations),
+	mModule(module)
+{
+	for (size_t i = 0; i < 6; ++i)
+	{
+		if (!mModule.IsPlaneOpen(i))
+		{
+			Plane3<Real> const plane = mModule.GetPlane(i);
+			this->AddCollisionPlane(gte::Hyperplane<3, Real>(plane.normal, plane.constant));
+		}
+	}
+}
+
+template <typename Real>
+bool PhysicsParticles<Real>::GetColliderDistance(Vector3<Real> const& point,
+	Real& distance, Vector3<Real>& normal) const
+{
+	bool found = false;
+	for (size_t c = 0; c < mModule.GetNumStaticColliders(); ++c)
+	{
+		auto const& collider = mModule.GetStaticCollider(c);
+		Vector3<Real> const& vmin = collider->GetMin();
+		Vector3<Real> const& vmax = collider->GetMax();
+		if (point[0] < vmin[0] || point[0] > vmax[0]
+			|| point[1] < vmin[1] || point[1] > vmax[1]
+			|| point[2] < vmin[2] || point[2] > vmax[2])
+		{
+			continue;
+		}
+
+		Real const signedDistance = collider->GetSignedDistance(point);
+		if (!found || signedDistance < distance)
+		{
+			distance = signedDistance;
+			normal = collider->GetNormal(point);
+			found = true;
+		}
+	}
+	return found;
+}
+
+template class PhysicsParticles<float>;
+template class PhysicsParticles<double>;
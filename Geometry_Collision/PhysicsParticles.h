@@ -0,0 +1,37 @@
+#pragma once
+
+#include "PhysModule.h"
+#include "PositionBasedDynamics.h"
+#include <cstdint>
+using namespace Vector_GM;
+
+// Position-based particles, for example cloth or soft bodies, that collide
+// with the static geometry of a PhysicsModule: the closed planes of the
+// simulation region and the static colliders represented by signed
+// distance fields. The particles do not interact with the spheres. The
+// module is referenced, not copied, so it must outlive the particles, and
+// colliders added to it later are used by the next Update(...). The
+// collision radius is the thickness of the particles; the default is 0.
+
+template <typename Real>
+class PhysicsParticles : public gte::PositionBasedDynamics<3, Real>
+{
+public:
+	PhysicsParticles(PhysicsModule<Real> const& module, int32_t numParticles,
+		Real step, int32_t numIterations);
+
+	virtual ~PhysicsParticles() = default;
+
+	inline PhysicsModule<Real> const& GetModule() const
+	{
+		return mModule;
+	}
+
+protected:
+	// The nearest static collider whose grid contains the point.
+	virtual bool GetColliderDistance(Vector3<Real> const& point, Real& distance,
+		Vector3<Real>& normal) const override;
+
+private:
+	PhysicsModule<Real> const& mModule;
+};
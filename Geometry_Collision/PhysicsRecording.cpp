@@ -0,0 +1,338 @@
+#include "PhysicsRecording.h"
+#include "Transform.h"
+#include <algorithm>
+#include <cstring>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	char const recordingMagic[8] = { 'G', 'T', 'E', 'P', 'R', 'E', 'C', '1' };
+	uint32_t constexpr recordingVersion = 1;
+	uint32_t constexpr recordingByteOrder = 0x01020304u;
+	intptr_t constexpr invalidFile = -1;
+
+	// Round up to a multiple of the alignment.
+	uint64_t Align(uint64_t offset, uint64_t alignment)
+	{
+		return (offset + alignment - 1) / alignment * alignment;
+	}
+
+	intptr_t CreateRecordingFile(std::string const& filename)
+	{
+#if defined(_WIN32)
+		HANDLE file = ::CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE,
+			FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		return (file != INVALID_HANDLE_VALUE ? reinterpret_cast<intptr_t>(file) : invalidFile);
+#else
+		int fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		return (fd >= 0 ? static_cast<intptr_t>(fd) : invalidFile);
+#endif
+	}
+
+	void CloseRecordingFile(intptr_t file)
+	{
+#if defined(_WIN32)
+		::CloseHandle(reinterpret_cast<HANDLE>(file));
+#else
+		::close(static_cast<int>(file));
+#endif
+	}
+
+	// Map [offset, offset + numBytes) of the file for writing, extending
+	// the file when it is smaller. The offset must be a multiple of the
+	// allocation granularity, 64 KiB on Windows and a page elsewhere.
+	char* MapRecordingFile(intptr_t file, uint64_t offset, uint64_t numBytes)
+	{
+		uint64_t const end = offset + numBytes;
+#if defined(_WIN32)
+		// A mapping larger than the file extends the file.
+		HANDLE mapping = ::CreateFileMappingA(reinterpret_cast<HANDLE>(file), nullptr,
+			PAGE_READWRITE, static_cast<DWORD>(end >> 32),
+			static_cast<DWORD>(end & 0xFFFFFFFFull), nullptr);
+		if (!mapping)
+		{
+			return nullptr;
+		}
+		void* data = ::MapViewOfFile(mapping, FILE_MAP_WRITE,
+			static_cast<DWORD>(offset >> 32), static_cast<DWORD>(offset & 0xFFFFFFFFull),
+			static_cast<SIZE_T>(numBytes));
+		::CloseHandle(mapping);
+		return static_cast<char*>(data);
+#else
+		int const fd = static_cast<int>(file);
+		struct stat status;
+		if (::fstat(fd, &status) != 0)
+		{
+			return nullptr;
+		}
+		if (static_cast<uint64_t>(status.st_size) < end &&
+			::ftruncate(fd, static_cast<off_t>(end)) != 0)
+		{
+			return nullptr;
+		}
+		void* data = ::mmap(nullptr, static_cast<size_t>(numBytes),
+			PROT_READ | PROT_WRITE, MAP_SHARED, fd, static_cast<off_t>(offset));
+		return (data != MAP_FAILED ? static_cast<char*>(data) : nullptr);
+#endif
+	}
+
+	void UnmapRecordingFile(void* data, uint64_t numBytes)
+	{
+#if defined(_WIN32)
+		(void)numBytes;
+		::UnmapViewOfFile(data);
+#else
+		::munmap(data, static_cast<size_t>(numBytes));
+#endif
+	}
+}
+
+PhysicsRecorder::PhysicsRecorder(std::string const& filename, size_t maxBodies,
+	Vector3<double> const& regionMin, Vector3<double> const& regionMax,
+	size_t framesPerChunk)
+	:
+	mHeader(nullptr),
+	mChunk(nullptr),
+	mNumFrames(0),
+	mChunkIndex(0),
+	mFramesPerChunk(std::max(framesPerChunk, static_cast<size_t>(1))),
+	mMaxBodies(maxBodies),
+	mFrameBytes(0),
+	mChunkHeaderBytes(0),
+	mChunkBytes(0),
+	mHandles{},
+	mFile(invalidFile)
+{
+	// The frames start at multiples of 64 bytes so that the matrices are
+	// aligned for the SIMD loads of the graphics drivers. The chunks start
+	// at multiples of the header size, which is the allocation granularity
+	// of the file mappings on Windows and a multiple of the page size
+	// elsewhere.
+	uint64_t const headerBytes = PhysicsRecordingHeader::HeaderBytes;
+	mFrameBytes = Align(mMaxBodies * (sizeof(Matrix4x4<float>) + sizeof(uint32_t)), 64);
+	mChunkHeaderBytes = Align(mFramesPerChunk * (sizeof(double) + sizeof(uint32_t)), 64);
+	mChunkBytes = Align(mChunkHeaderBytes + mFramesPerChunk * mFrameBytes, headerBytes);
+
+	mFile = CreateRecordingFile(filename);
+	if (mFile == invalidFile)
+	{
+		return;
+	}
+
+	char* data = MapRecordingFile(mFile, 0, headerBytes);
+	if (!data)
+	{
+		CloseRecordingFile(mFile);
+		mFile = invalidFile;
+		return;
+	}
+
+	mHeader = reinterpret_cast<PhysicsRecordingHeader*>(data);
+	std::memcpy(mHeader->magic, recordingMagic, sizeof(recordingMagic));
+	mHeader->version = recordingVersion;
+	mHeader->byteOrder = recordingByteOrder;
+	mHeader->numFrames = 0;
+	mHeader->maxBodies = mMaxBodies;
+	mHeader->framesPerChunk = mFramesPerChunk;
+	mHeader->frameBytes = mFrameBytes;
+	mHeader->chunkHeaderBytes = mChunkHeaderBytes;
+	mHeader->chunkBytes = mChunkBytes;
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		mHeader->regionMin[d] = regionMin[d];
+		mHeader->regionMax[d] = regionMax[d];
+	}
+}
+
+PhysicsRecorder::~PhysicsRecorder()
+{
+	Close();
+}
+
+template <typename Real>
+bool PhysicsRecorder::Record(double time, size_t numBodies,
+	Vector3<Real> const* positions, Quaternion<Real> const* orientations,
+	Real const* radii, size_t const* handles)
+{
+	if (!mHeader || numBodies > mMaxBodies)
+	{
+		return false;
+	}
+
+	uint64_t const c = mNumFrames / mFramesPerChunk;
+	uint64_t const j = mNumFrames % mFramesPerChunk;
+	if (!mChunk || c != mChunkIndex)
+	{
+		UnmapChunk();
+		if (!MapChunk(c))
+		{
+			return false;
+		}
+	}
+
+	// The matrices are those of BouncingSpheresWindow3, computed directly
+	// into the mapping.
+	char* frame = mChunk + mChunkHeaderBytes + j * mFrameBytes;
+	auto world = reinterpret_cast<Matrix4x4<float>*>(frame);
+	auto frameHandles = reinterpret_cast<uint32_t*>(frame + mMaxBodies * sizeof(Matrix4x4<float>));
+	Transform<float> transform{};
+	Vector3<float> position{};
+	Quaternion<float> orientation{};
+	for (size_t i = 0; i < numBodies; ++i)
+	{
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			position[d] = static_cast<float>(positions[i][d]);
+		}
+		for (int32_t d = 0; d < 4; ++d)
+		{
+			orientation[d] = static_cast<float>(orientations[i][d]);
+		}
+		transform.SetTranslation(position);
+		transform.SetRotation(orientation);
+		transform.SetUniformScale(static_cast<float>(radii[i]));
+		world[i] = transform.GetHMatrix();
+		frameHandles[i] = static_cast<uint32_t>(handles[i]);
+	}
+
+	// The time index of the chunk, then the number of frames, so a reader
+	// of an unfinished recording sees only complete frames.
+	reinterpret_cast<double*>(mChunk)[j] = time;
+	reinterpret_cast<uint32_t*>(mChunk + mFramesPerChunk * sizeof(double))[j] =
+		static_cast<uint32_t>(numBodies);
+	++mNumFrames;
+	mHeader->numFrames = mNumFrames;
+	return true;
+}
+
+void PhysicsRecorder::Close()
+{
+	UnmapChunk();
+	if (mHeader)
+	{
+		UnmapRecordingFile(mHeader, PhysicsRecordingHeader::HeaderBytes);
+		mHeader = nullptr;
+	}
+	if (mFile != invalidFile)
+	{
+		CloseRecordingFile(mFile);
+		mFile = invalidFile;
+	}
+}
+
+bool PhysicsRecorder::MapChunk(uint64_t c)
+{
+	uint64_t const offset = PhysicsRecordingHeader::HeaderBytes + c * mChunkBytes;
+	mChunk = MapRecordingFile(mFile, offset, mChunkBytes);
+	mChunkIndex = c;
+	return mChunk != nullptr;
+}
+
+void PhysicsRecorder::UnmapChunk()
+{
+	if (mChunk)
+	{
+		UnmapRecordingFile(mChunk, mChunkBytes);
+		mChunk = nullptr;
+	}
+}
+
+PhysicsPlayer::PhysicsPlayer(std::string const& filename)
+	:
+	mMapping(std::make_unique<gte::FileMapping>(filename)),
+	mChunks(nullptr),
+	mNumFrames(0),
+	mMaxBodies(0),
+	mFramesPerChunk(1),
+	mFrameBytes(0),
+	mChunkHeaderBytes(0),
+	mChunkBytes(0),
+	mRegionMin{ 0.0, 0.0, 0.0 },
+	mRegionMax{ 0.0, 0.0, 0.0 }
+{
+	uint64_t const headerBytes = PhysicsRecordingHeader::HeaderBytes;
+	uint64_t const fileSize = mMapping->GetSize();
+	if (!mMapping->GetData() || fileSize < headerBytes)
+	{
+		return;
+	}
+
+	auto const* header = reinterpret_cast<PhysicsRecordingHeader const*>(mMapping->GetData());
+	uint64_t const F = header->framesPerChunk;
+	if (std::memcmp(header->magic, recordingMagic, sizeof(recordingMagic)) != 0 ||
+		header->version != recordingVersion || header->byteOrder != recordingByteOrder ||
+		F == 0 || header->chunkBytes == 0 ||
+		header->frameBytes / (sizeof(Matrix4x4<float>) + sizeof(uint32_t)) < header->maxBodies ||
+		header->chunkHeaderBytes / (sizeof(double) + sizeof(uint32_t)) < F ||
+		(header->chunkBytes - header->chunkHeaderBytes) / F < header->frameBytes ||
+		header->chunkBytes < header->chunkHeaderBytes)
+	{
+		return;
+	}
+
+	// Only the frames of the chunks that are in the file are played, in
+	// case the file was truncated.
+	uint64_t const numChunks = (fileSize - headerBytes) / header->chunkBytes;
+	mNumFrames = std::min(header->numFrames, numChunks * F);
+	mMaxBodies = header->maxBodies;
+	mFramesPerChunk = F;
+	mFrameBytes = header->frameBytes;
+	mChunkHeaderBytes = header->chunkHeaderBytes;
+	mChunkBytes = header->chunkBytes;
+	mChunks = mMapping->GetData() + headerBytes;
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		mRegionMin[d] = header->regionMin[d];
+		mRegionMax[d] = header->regionMax[d];
+	}
+}
+
+size_t PhysicsPlayer::FindFrame(double time) const
+{
+	// The number of frames whose times are at most 'time'.
+	size_t lower = 0, upper = GetNumFrames();
+	while (lower < upper)
+	{
+		size_t const middle = lower + (upper - lower) / 2;
+		if (GetTime(middle) <= time)
+		{
+			lower = middle + 1;
+		}
+		else
+		{
+			upper = middle;
+		}
+	}
+	return (lower > 0 ? lower - 1 : 0);
+}
+
+bool PhysicsPlayer::Bind(size_t k, StructuredBuffer& instances) const
+{
+	if (k >= mNumFrames || instances.GetElementSize() != sizeof(Matrix4x4<float>) ||
+		instances.GetNumElements() > mMaxBodies)
+	{
+		return false;
+	}
+
+	uint32_t const numBodies = static_cast<uint32_t>(GetNumBodies(k));
+	instances.SetData(const_cast<char*>(GetFrame(k)));
+	instances.SetOffset(0);
+	instances.SetNumActiveElements(std::min(numBodies, instances.GetNumElements()));
+	return true;
+}
+
+template bool PhysicsRecorder::Record<float>(double, size_t, Vector3<float> const*,
+	Quaternion<float> const*, float const*, size_t const*);
+template bool PhysicsRecorder::Record<double>(double, size_t, Vector3<double> const*,
+	Quaternion<double> const*, double const*, size_t const*);
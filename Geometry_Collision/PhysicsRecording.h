@@ -0,0 +1,220 @@
+#pragma once
+
+#include "PhysModule.h"
+#include "FileMapping.h"
+#include "Matrix4x4.h"
+#include "StructuredBuffer.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+using namespace Vector_GM;
+
+// Recording of PhysicsModule simulations to a file, for offline analysis
+// and for replay in a viewer. The recorder appends one frame per call,
+// and the player maps the file and returns pointers to the frames in the
+// mapping, so a frame is never parsed or copied on the CPU.
+//
+// A frame holds the simulation time and, for each body, the world matrix
+// of an InstancedTexture2Effect instance: the translation to the position,
+// the rotation of the orientation and the uniform scale of the bounding
+// radius, as computed by Transform<float>::GetHMatrix, followed by the
+// sphere handles. The matrices are the instance data of the instanced
+// draw path, so Bind points the instance buffer of a viewer at a frame and
+// the graphics engine copies the matrices from the mapped pages to the
+// GPU. The handles identify the bodies across frames for analysis,
+// because the indices change when bodies are removed or repartitioned.
+//
+// The file is a header followed by chunks of framesPerChunk frames. Each
+// frame has room for maxBodies bodies, so the frames and the chunks have
+// fixed sizes and the offset of frame k is computed from k. A chunk starts
+// with its time index, the times and the numbers of bodies of its frames,
+// followed by the frames. The recorder extends the file by one chunk at a
+// time and maps only the header and the current chunk, writing the
+// matrices directly into the mapping, so the memory use does not grow
+// with the length of the recording. The number of frames in the header is
+// updated after each frame, so a recording that was not closed, for
+// example after a crash, can be played up to its last frame. The file has
+// the byte order of the machine that recorded it; files of the other byte
+// order fail to open.
+//
+//   PhysicsRecorder recorder("Run.gtrec", maxSpheres, regionMin, regionMax);
+//   <for each tick> module.DoTick(time, dt); recorder.Record(time, module);
+//
+//   PhysicsPlayer player("Run.gtrec");
+//   size_t frame = player.FindFrame(replayTime);
+//   player.Bind(frame, *effect->GetInstanceBuffer());
+//   engine->Update(effect->GetInstanceBuffer());
+//   ibuffer->SetNumInstances(static_cast<uint32_t>(player.GetNumBodies(frame)));
+
+// The header at the start of the file. numFrames is the number of frames
+// written so far; the other members are set when the file is created.
+// The chunks start at offset HeaderBytes, and each frame stores maxBodies
+// matrices followed by maxBodies handles.
+struct PhysicsRecordingHeader
+{
+	static uint64_t constexpr HeaderBytes = 65536;
+
+	char magic[8];
+	uint32_t version, byteOrder;
+	uint64_t numFrames;
+	uint64_t maxBodies, framesPerChunk;
+	uint64_t frameBytes, chunkHeaderBytes, chunkBytes;
+	double regionMin[3], regionMax[3];
+};
+
+class PhysicsRecorder
+{
+public:
+	// Create the file, replacing an existing one. The region is stored for
+	// the viewers. Use IsOpen to test whether the file was created.
+	PhysicsRecorder(std::string const& filename, size_t maxBodies,
+		Vector3<double> const& regionMin, Vector3<double> const& regionMax,
+		size_t framesPerChunk = 64);
+
+	~PhysicsRecorder();
+
+	// Disallow copy and assignment.
+	PhysicsRecorder(PhysicsRecorder const&) = delete;
+	PhysicsRecorder& operator=(PhysicsRecorder const&) = delete;
+
+	inline bool IsOpen() const
+	{
+		return mHeader != nullptr;
+	}
+
+	inline size_t GetNumFrames() const
+	{
+		return static_cast<size_t>(mNumFrames);
+	}
+
+	// Append a frame. The function returns false when the recorder is not
+	// open, when there are more than maxBodies bodies or when the file
+	// cannot be extended, in which case the frame is not recorded.
+	template <typename Real>
+	bool Record(double time, size_t numBodies, Vector3<Real> const* positions,
+		Quaternion<Real> const* orientations, Real const* radii,
+		size_t const* handles);
+
+	template <typename Real>
+	inline bool Record(double time, PhysicsModule<Real> const& module)
+	{
+		auto const& spheres = module.GetSpheres();
+		size_t const numBodies = spheres.GetNumSpheres();
+		mHandles.resize(numBodies);
+		for (size_t i = 0; i < numBodies; ++i)
+		{
+			mHandles[i] = module.GetSphereHandle(i);
+		}
+		return Record(time, numBodies, spheres.position.data(),
+			spheres.qOrientation.data(), spheres.radius.data(), mHandles.data());
+	}
+
+	// Unmap the file and close it. The destructor calls Close.
+	void Close();
+
+private:
+	// Map chunk c, extending the file to contain it.
+	bool MapChunk(uint64_t c);
+	void UnmapChunk();
+
+	PhysicsRecordingHeader* mHeader;
+	char* mChunk;
+	uint64_t mNumFrames, mChunkIndex;
+	uint64_t mFramesPerChunk, mMaxBodies;
+	uint64_t mFrameBytes, mChunkHeaderBytes, mChunkBytes;
+	std::vector<size_t> mHandles;
+
+	// The native file handle, a HANDLE on Windows and a file descriptor
+	// elsewhere.
+	intptr_t mFile;
+};
+
+class PhysicsPlayer
+{
+public:
+	// Map the file. Use IsOpen to test whether it is a valid recording.
+	PhysicsPlayer(std::string const& filename);
+
+	inline bool IsOpen() const
+	{
+		return mNumFrames > 0;
+	}
+
+	inline size_t GetNumFrames() const
+	{
+		return static_cast<size_t>(mNumFrames);
+	}
+
+	inline size_t GetMaxBodies() const
+	{
+		return static_cast<size_t>(mMaxBodies);
+	}
+
+	inline Vector3<double> const& GetRegionMin() const
+	{
+		return mRegionMin;
+	}
+
+	inline Vector3<double> const& GetRegionMax() const
+	{
+		return mRegionMax;
+	}
+
+	// Access to frame k < GetNumFrames() in constant time. The pointers are
+	// into the mapping and are valid while the player exists.
+	inline double GetTime(size_t k) const
+	{
+		return reinterpret_cast<double const*>(GetChunk(k))[k % mFramesPerChunk];
+	}
+
+	inline size_t GetNumBodies(size_t k) const
+	{
+		char const* chunk = GetChunk(k);
+		return reinterpret_cast<uint32_t const*>(chunk + mFramesPerChunk * sizeof(double))
+			[k % mFramesPerChunk];
+	}
+
+	inline Matrix4x4<float> const* GetTransforms(size_t k) const
+	{
+		return reinterpret_cast<Matrix4x4<float> const*>(GetFrame(k));
+	}
+
+	inline uint32_t const* GetHandles(size_t k) const
+	{
+		return reinterpret_cast<uint32_t const*>(GetFrame(k) +
+			mMaxBodies * sizeof(Matrix4x4<float>));
+	}
+
+	// The last frame whose time is at most the specified time, or frame 0
+	// for earlier times, by a binary search of the times.
+	size_t FindFrame(double time) const;
+
+	// Point the instance buffer at the matrices of frame k and set its
+	// number of active elements to the number of bodies, at most the
+	// number of elements. The buffer must have Matrix4x4<float> elements
+	// and at most GetMaxBodies() of them, so that the engine reads only the
+	// frame; otherwise the function returns false and the buffer is not
+	// changed. The buffer must not be used after the player is destroyed;
+	// call its ResetData to return it to its own storage. Set the number of
+	// instances of the index buffer and call the engine Update of the
+	// buffer as usual.
+	bool Bind(size_t k, StructuredBuffer& instances) const;
+
+private:
+	inline char const* GetChunk(size_t k) const
+	{
+		return mChunks + (k / mFramesPerChunk) * mChunkBytes;
+	}
+
+	inline char const* GetFrame(size_t k) const
+	{
+		return GetChunk(k) + mChunkHeaderBytes + (k % mFramesPerChunk) * mFrameBytes;
+	}
+
+	std::unique_ptr<gte::FileMapping> mMapping;
+	char const* mChunks;
+	uint64_t mNumFrames, mMaxBodies, mFramesPerChunk;
+	uint64_t mFrameBytes, mChunkHeaderBytes, mChunkBytes;
+	Vector3<double> mRegionMin, mRegionMax;
+};
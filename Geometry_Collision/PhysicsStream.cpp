@@ -0,0 +1,634 @@
+#include "PhysicsStream.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+	// The order of the Exp-Golomb codes of the position and orientation
+	// differences. A zigzag-mapped difference v < 2^(k+m) - 2^k costs
+	// 2*m + k + 1 bits, so the codes are short for the small differences
+	// of coherent motion and still bounded for large ones.
+	uint32_t constexpr PositionCodeOrder = 4;
+	uint32_t constexpr OrientationCodeOrder = 3;
+
+	class BitWriter
+	{
+	public:
+		BitWriter(std::vector<uint8_t>& bytes)
+			:
+			mBytes(bytes),
+			mBuffer(0),
+			mNumBits(0)
+		{
+			mBytes.clear();
+		}
+
+		// The count must be at most 32.
+		void Write(uint64_t value, uint32_t count)
+		{
+			mBuffer |= (value & ((uint64_t(1) << count) - 1)) << mNumBits;
+			mNumBits += count;
+			while (mNumBits >= 8)
+			{
+				mBytes.push_back(static_cast<uint8_t>(mBuffer));
+				mBuffer >>= 8;
+				mNumBits -= 8;
+			}
+		}
+
+		// Exp-Golomb code of order k: the number of bits n of v + 2^k in
+		// unary as n - k - 1 ones and a zero, then the low n - 1 bits of
+		// v + 2^k.
+		void WriteCode(uint32_t value, uint32_t k)
+		{
+			uint64_t const w = static_cast<uint64_t>(value) + (uint64_t(1) << k);
+			uint32_t n = 0;
+			while ((w >> n) > 1)
+			{
+				++n;
+			}
+			for (uint32_t i = k; i < n; ++i)
+			{
+				Write(1, 1);
+			}
+			Write(0, 1);
+			Write(w, n);
+		}
+
+		void Flush()
+		{
+			if (mNumBits > 0)
+			{
+				mBytes.push_back(static_cast<uint8_t>(mBuffer));
+				mBuffer = 0;
+				mNumBits = 0;
+			}
+		}
+
+	private:
+		std::vector<uint8_t>& mBytes;
+		uint64_t mBuffer;
+		uint32_t mNumBits;
+	};
+
+	class BitReader
+	{
+	public:
+		BitReader(std::vector<uint8_t> const& bytes)
+			:
+			mBytes(bytes),
+			mPosition(0)
+		{
+		}
+
+		// The count must be at most 32. The function returns false when
+		// the frame has fewer bits.
+		bool Read(uint32_t count, uint64_t& value)
+		{
+			if (mPosition + count > 8 * mBytes.size())
+			{
+				return false;
+			}
+			value = 0;
+			for (uint32_t i = 0; i < count; ++i, ++mPosition)
+			{
+				uint64_t const bit = (mBytes[mPosition >> 3] >> (mPosition & 7)) & 1;
+				value |= bit << i;
+			}
+			return true;
+		}
+
+		bool ReadCode(uint32_t k, uint32_t& value)
+		{
+			uint32_t n = k;
+			uint64_t bit = 1;
+			while (true)
+			{
+				if (!Read(1, bit))
+				{
+					return false;
+				}
+				if (bit == 0)
+				{
+					break;
+				}
+				if (++n > 32)
+				{
+					return false;
+				}
+			}
+			uint64_t low = 0;
+			if (!Read(n, low))
+			{
+				return false;
+			}
+			uint64_t const w = (uint64_t(1) << n) | low;
+			value = static_cast<uint32_t>(w - (uint64_t(1) << k));
+			return true;
+		}
+
+	private:
+		std::vector<uint8_t> const& mBytes;
+		size_t mPosition;
+	};
+
+	inline uint32_t ZigZag(int64_t difference)
+	{
+		return static_cast<uint32_t>(difference >= 0 ? 2 * difference : -2 * difference - 1);
+	}
+
+	inline int64_t UnZigZag(uint32_t value)
+	{
+		return ((value & 1) == 0 ? static_cast<int64_t>(value >> 1) : -static_cast<int64_t>(value >> 1) - 1);
+	}
+
+	template <typename Real>
+	inline uint32_t Quantize(Real value, Real vmin, Real vmax, uint32_t maxQuantized)
+	{
+		Real const t = (value - vmin) / (vmax - vmin);
+		Real const scaled = std::round(t * static_cast<Real>(maxQuantized));
+		if (!(scaled > static_cast<Real>(0)))
+		{
+			return 0;
+		}
+		return (scaled < static_cast<Real>(maxQuantized) ? static_cast<uint32_t>(scaled) : maxQuantized);
+	}
+
+	template <typename Real>
+	inline Real Dequantize(uint32_t value, Real vmin, Real vmax, uint32_t maxQuantized)
+	{
+		return vmin + (vmax - vmin) * static_cast<Real>(value) / static_cast<Real>(maxQuantized);
+	}
+
+	template <typename Real>
+	void QuantizePose(Vector3<Real> const& regionMin, Vector3<Real> const& regionMax,
+		PhysicsStreamParameters const& parameters, Vector3<Real> const& position,
+		Quaternion<Real> const& orientation, PhysicsStreamPose& pose)
+	{
+		uint32_t const maxPosition = (uint32_t(1) << parameters.positionBits) - 1;
+		uint32_t const maxOrientation = (uint32_t(1) << parameters.orientationBits) - 1;
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			pose.position[d] = Quantize(position[d], regionMin[d], regionMax[d], maxPosition);
+		}
+
+		// The smallest three components of a unit quaternion are bounded
+		// by 1/sqrt(2) in magnitude.
+		int32_t largest = 0;
+		for (int32_t c = 1; c < 4; ++c)
+		{
+			if (std::fabs(orientation[c]) > std::fabs(orientation[largest]))
+			{
+				largest = c;
+			}
+		}
+		Real const sign = (orientation[largest] < static_cast<Real>(0) ? static_cast<Real>(-1) : static_cast<Real>(1));
+		Real const bound = static_cast<Real>(GTE_C_INV_SQRT_2);
+		pose.largest = static_cast<uint8_t>(largest);
+		for (int32_t c = 0, k = 0; c < 4; ++c)
+		{
+			if (c != largest)
+			{
+				pose.orientation[k++] = static_cast<uint16_t>(
+					Quantize(sign * orientation[c], -bound, bound, maxOrientation));
+			}
+		}
+	}
+
+	template <typename Real>
+	void DequantizePose(Vector3<Real> const& regionMin, Vector3<Real> const& regionMax,
+		PhysicsStreamParameters const& parameters, PhysicsStreamPose const& pose,
+		Vector3<Real>& position, Quaternion<Real>& orientation)
+	{
+		uint32_t const maxPosition = (uint32_t(1) << parameters.positionBits) - 1;
+		uint32_t const maxOrientation = (uint32_t(1) << parameters.orientationBits) - 1;
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			position[d] = Dequantize(pose.position[d], regionMin[d], regionMax[d], maxPosition);
+		}
+
+		Real const bound = static_cast<Real>(GTE_C_INV_SQRT_2);
+		Real sqrLength = static_cast<Real>(0);
+		for (int32_t c = 0, k = 0; c < 4; ++c)
+		{
+			if (c != pose.largest)
+			{
+				orientation[c] = Dequantize(static_cast<uint32_t>(pose.orientation[k++]),
+					-bound, bound, maxOrientation);
+				sqrLength += orientation[c] * orientation[c];
+			}
+		}
+		orientation[pose.largest] = std::sqrt(std::max(static_cast<Real>(1) - sqrLength, static_cast<Real>(0)));
+		Normalize(orientation);
+	}
+
+	inline bool IsPoseChanged(PhysicsStreamPose const& pose, PhysicsStreamPose const& baseline,
+		PhysicsStreamParameters const& parameters)
+	{
+		if (pose.largest != baseline.largest)
+		{
+			return true;
+		}
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			int64_t const difference = static_cast<int64_t>(pose.position[d]) - baseline.position[d];
+			if (static_cast<uint64_t>(difference < 0 ? -difference : difference) > parameters.positionThreshold)
+			{
+				return true;
+			}
+		}
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			int64_t const difference = static_cast<int64_t>(pose.orientation[k]) - baseline.orientation[k];
+			if (static_cast<uint64_t>(difference < 0 ? -difference : difference) > parameters.orientationThreshold)
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void ValidateParameters(PhysicsStreamParameters const& parameters)
+	{
+		LogAssert(
+			1 <= parameters.positionBits && parameters.positionBits <= 24 &&
+			1 <= parameters.orientationBits && parameters.orientationBits <= 16 &&
+			parameters.keyframeInterval > 0 && parameters.historySize > 1,
+			"Invalid stream parameters.");
+	}
+}
+
+template <typename Real>
+PhysicsStreamEncoder<Real>::PhysicsStreamEncoder(Vector3<Real> const& regionMin,
+	Vector3<Real> const& regionMax, PhysicsStreamParameters const& parameters)
+	:
+	mRegionMin(regionMin),
+	mRegionMax(regionMax),
+	mParameters(parameters),
+	mFrameNumber(0),
+	mAcknowledged(0),
+	mNumBodiesSent(0),
+	mHistory(parameters.historySize)
+{
+	ValidateParameters(parameters);
+	for (auto& frame : mHistory)
+	{
+		frame.number = 0;
+	}
+}
+
+template <typename Real>
+void PhysicsStreamEncoder<Real>::Encode(double time, size_t numBodies,
+	Vector3<Real> const* positions, Quaternion<Real> const* orientations,
+	std::vector<uint8_t>& frame)
+{
+	uint32_t const historySize = mParameters.historySize;
+	uint32_t const number = ++mFrameNumber;
+
+	// The baseline is the last acknowledged frame when it is still in the
+	// history, except for the periodic keyframes.
+	Frame const* baseline = nullptr;
+	if (mAcknowledged != 0 && number - mAcknowledged < historySize &&
+		number % mParameters.keyframeInterval != 0)
+	{
+		Frame const& candidate = mHistory[mAcknowledged % historySize];
+		if (candidate.number == mAcknowledged)
+		{
+			baseline = &candidate;
+		}
+	}
+
+	Frame& current = mHistory[number % historySize];
+	current.number = number;
+	current.poses.resize(numBodies);
+
+	BitWriter writer(frame);
+	uint64_t timeBits = 0;
+	std::memcpy(&timeBits, &time, sizeof(time));
+	writer.Write(number, 32);
+	writer.Write(baseline ? baseline->number : 0, 32);
+	writer.Write(static_cast<uint64_t>(numBodies), 32);
+	writer.Write(timeBits & 0xFFFFFFFFu, 32);
+	writer.Write(timeBits >> 32, 32);
+
+	mNumBodiesSent = 0;
+	PhysicsStreamPose pose{};
+	for (size_t i = 0; i < numBodies; ++i)
+	{
+		QuantizePose(mRegionMin, mRegionMax, mParameters, positions[i], orientations[i], pose);
+		PhysicsStreamPose const* base =
+			(baseline && i < baseline->poses.size() ? &baseline->poses[i] : nullptr);
+
+		if (base && !IsPoseChanged(pose, *base, mParameters))
+		{
+			// The decoder keeps the baseline pose, and so does the history.
+			writer.Write(0, 1);
+			current.poses[i] = *base;
+			continue;
+		}
+
+		writer.Write(1, 1);
+		current.poses[i] = pose;
+		++mNumBodiesSent;
+		if (base)
+		{
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				writer.WriteCode(ZigZag(static_cast<int64_t>(pose.position[d]) - base->position[d]),
+					PositionCodeOrder);
+			}
+			if (pose.largest == base->largest)
+			{
+				writer.Write(1, 1);
+				for (int32_t k = 0; k < 3; ++k)
+				{
+					writer.WriteCode(ZigZag(static_cast<int64_t>(pose.orientation[k]) - base->orientation[k]),
+						OrientationCodeOrder);
+				}
+				continue;
+			}
+			writer.Write(0, 1);
+		}
+		else
+		{
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				writer.Write(pose.position[d], mParameters.positionBits);
+			}
+		}
+		writer.Write(pose.largest, 2);
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			writer.Write(pose.orientation[k], mParameters.orientationBits);
+		}
+	}
+	writer.Flush();
+}
+
+template <typename Real>
+void PhysicsStreamEncoder<Real>::Acknowledge(uint32_t frameNumber)
+{
+	if (frameNumber > mAcknowledged && frameNumber <= mFrameNumber)
+	{
+		mAcknowledged = frameNumber;
+	}
+}
+
+template <typename Real>
+PhysicsStreamDecoder<Real>::PhysicsStreamDecoder(Vector3<Real> const& regionMin,
+	Vector3<Real> const& regionMax, PhysicsStreamParameters const& parameters)
+	:
+	mRegionMin(regionMin),
+	mRegionMax(regionMax),
+	mParameters(parameters),
+	mFrameNumber(0),
+	mTime(0.0),
+	mPositions{},
+	mOrientations{},
+	mHistory(parameters.historySize),
+	mPoses{}
+{
+	ValidateParameters(parameters);
+	for (auto& frame : mHistory)
+	{
+		frame.number = 0;
+	}
+}
+
+template <typename Real>
+bool PhysicsStreamDecoder<Real>::Decode(std::vector<uint8_t> const& frame)
+{
+	uint32_t const historySize = mParameters.historySize;
+	BitReader reader(frame);
+	uint64_t number = 0, baselineNumber = 0, numBodies = 0, timeLow = 0, timeHigh = 0;
+	if (!reader.Read(32, number) || !reader.Read(32, baselineNumber) ||
+		!reader.Read(32, numBodies) || !reader.Read(32, timeLow) ||
+		!reader.Read(32, timeHigh) || number == 0 || numBodies > 8 * frame.size())
+	{
+		return false;
+	}
+
+	Frame const* baseline = nullptr;
+	if (baselineNumber != 0)
+	{
+		Frame const& candidate = mHistory[baselineNumber % historySize];
+		if (candidate.number != baselineNumber)
+		{
+			return false;
+		}
+		baseline = &candidate;
+	}
+
+	uint32_t const maxPosition = (uint32_t(1) << mParameters.positionBits) - 1;
+	uint32_t const maxOrientation = (uint32_t(1) << mParameters.orientationBits) - 1;
+	mPoses.resize(static_cast<size_t>(numBodies));
+	uint64_t bits = 0;
+	uint32_t code = 0;
+	for (size_t i = 0; i < mPoses.size(); ++i)
+	{
+		PhysicsStreamPose const* base =
+			(baseline && i < baseline->poses.size() ? &baseline->poses[i] : nullptr);
+		PhysicsStreamPose& pose = mPoses[i];
+		if (!reader.Read(1, bits))
+		{
+			return false;
+		}
+		if (bits == 0)
+		{
+			if (!base)
+			{
+				return false;
+			}
+			pose = *base;
+			continue;
+		}
+
+		bool absoluteOrientation = true;
+		if (base)
+		{
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				if (!reader.ReadCode(PositionCodeOrder, code))
+				{
+					return false;
+				}
+				int64_t const value = static_cast<int64_t>(base->position[d]) + UnZigZag(code);
+				if (value < 0 || value > static_cast<int64_t>(maxPosition))
+				{
+					return false;
+				}
+				pose.position[d] = static_cast<uint32_t>(value);
+			}
+			if (!reader.Read(1, bits))
+			{
+				return false;
+			}
+			if (bits == 1)
+			{
+				absoluteOrientation = false;
+				pose.largest = base->largest;
+				for (int32_t k = 0; k < 3; ++k)
+				{
+					if (!reader.ReadCode(OrientationCodeOrder, code))
+					{
+						return false;
+					}
+					int64_t const value = static_cast<int64_t>(base->orientation[k]) + UnZigZag(code);
+					if (value < 0 || value > static_cast<int64_t>(maxOrientation))
+					{
+						return false;
+					}
+					pose.orientation[k] = static_cast<uint16_t>(value);
+				}
+			}
+		}
+		else
+		{
+			for (int32_t d = 0; d < 3; ++d)
+			{
+				if (!reader.Read(mParameters.positionBits, bits))
+				{
+					return false;
+				}
+				pose.position[d] = static_cast<uint32_t>(bits);
+			}
+		}
+
+		if (absoluteOrientation)
+		{
+			if (!reader.Read(2, bits))
+			{
+				return false;
+			}
+			pose.largest = static_cast<uint8_t>(bits);
+			for (int32_t k = 0; k < 3; ++k)
+			{
+				if (!reader.Read(mParameters.orientationBits, bits))
+				{
+					return false;
+				}
+				pose.orientation[k] = static_cast<uint16_t>(bits);
+			}
+		}
+	}
+
+	// The frame is complete. The baseline slot is never the slot of the
+	// frame, because the encoder uses baselines within the history.
+	Frame& current = mHistory[number % historySize];
+	current.number = static_cast<uint32_t>(number);
+	current.poses.swap(mPoses);
+
+	uint64_t const timeBits = timeLow | (timeHigh << 32);
+	std::memcpy(&mTime, &timeBits, sizeof(mTime));
+	mFrameNumber = static_cast<uint32_t>(number);
+	size_t const numPoses = current.poses.size();
+	mPositions.resize(numPoses);
+	mOrientations.resize(numPoses);
+	for (size_t i = 0; i < numPoses; ++i)
+	{
+		DequantizePose(mRegionMin, mRegionMax, mParameters, current.poses[i],
+			mPositions[i], mOrientations[i]);
+	}
+	return true;
+}
+
+template <typename Real>
+PhysicsInterpolationBuffer<Real>::PhysicsInterpolationBuffer(size_t capacity)
+	:
+	mFrames(std::max(capacity, static_cast<size_t>(2))),
+	mFirst(0),
+	mNumFrames(0)
+{
+}
+
+template <typename Real>
+void PhysicsInterpolationBuffer<Real>::Push(double time,
+	std::vector<Vector3<Real>> const& positions,
+	std::vector<Quaternion<Real>> const& orientations)
+{
+	size_t const capacity = mFrames.size();
+	if (mNumFrames > 0 && time <= mFrames[(mFirst + mNumFrames - 1) % capacity].time)
+	{
+		return;
+	}
+
+	// The oldest frame is overwritten when the ring is full, reusing its
+	// storage.
+	if (mNumFrames == capacity)
+	{
+		mFirst = (mFirst + 1) % capacity;
+		--mNumFrames;
+	}
+	Frame& frame = mFrames[(mFirst + mNumFrames) % capacity];
+	frame.time = time;
+	frame.positions = positions;
+	frame.orientations = orientations;
+	++mNumFrames;
+}
+
+template <typename Real>
+bool PhysicsInterpolationBuffer<Real>::Sample(double time,
+	std::vector<Vector3<Real>>& positions,
+	std::vector<Quaternion<Real>>& orientations) const
+{
+	if (mNumFrames == 0)
+	{
+		return false;
+	}
+
+	size_t const capacity = mFrames.size();
+	Frame const& oldest = mFrames[mFirst];
+	Frame const& newest = mFrames[(mFirst + mNumFrames - 1) % capacity];
+	if (time <= oldest.time || time >= newest.time)
+	{
+		Frame const& frame = (time <= oldest.time ? oldest : newest);
+		positions = frame.positions;
+		orientations = frame.orientations;
+		return true;
+	}
+
+	size_t k = 1;
+	while (mFrames[(mFirst + k) % capacity].time < time)
+	{
+		++k;
+	}
+	Frame const& frame0 = mFrames[(mFirst + k - 1) % capacity];
+	Frame const& frame1 = mFrames[(mFirst + k) % capacity];
+	Real const t = static_cast<Real>((time - frame0.time) / (frame1.time - frame0.time));
+	Real const one = static_cast<Real>(1);
+
+	Frame const& nearer = (t < static_cast<Real>(0.5) ? frame0 : frame1);
+	Frame const& other = (t < static_cast<Real>(0.5) ? frame1 : frame0);
+	size_t const numBodies = nearer.positions.size();
+	size_t const numShared = std::min(numBodies, other.positions.size());
+	positions.resize(numBodies);
+	orientations.resize(numBodies);
+	for (size_t i = 0; i < numShared; ++i)
+	{
+		positions[i] = (one - t) * frame0.positions[i] + t * frame1.positions[i];
+
+		// q and -q are the same rotation; interpolate along the shorter
+		// arc.
+		Quaternion<Real> q1 = frame1.orientations[i];
+		if (Dot(frame0.orientations[i], q1) < static_cast<Real>(0))
+		{
+			q1 = -q1;
+		}
+		orientations[i] = (one - t) * frame0.orientations[i] + t * q1;
+		Normalize(orientations[i]);
+	}
+	for (size_t i = numShared; i < numBodies; ++i)
+	{
+		positions[i] = nearer.positions[i];
+		orientations[i] = nearer.orientations[i];
+	}
+	return true;
+}
+
+template class PhysicsStreamEncoder<float>;
+template class PhysicsStreamEncoder<double>;
+template class PhysicsStreamDecoder<float>;
+template class PhysicsStreamDecoder<double>;
+template class PhysicsInterpolationBuffer<float>;
+template class PhysicsInterpolationBuffer<double>;
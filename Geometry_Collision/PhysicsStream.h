@@ -0,0 +1,213 @@
+#pragma once
+
+#include "PhysModule.h"
+#include <cstdint>
+#include <vector>
+using namespace Vector_GM;
+
+// Streaming of the sphere poses of a PhysicsModule to remote viewers. The
+// encoder runs next to the module and produces one frame per call, the
+// decoder runs in the viewer and reconstructs the poses, and the
+// interpolation buffer turns the decoded frames into poses at the render
+// time. The frames are byte arrays; sending them and the acknowledgments
+// is left to the application.
+//
+// A position is quantized to positionBits per coordinate over the region
+// box, and an orientation with the smallest-three encoding: the index of
+// the largest quaternion component (the quaternion is negated to make it
+// positive) and the other three components, which are in
+// [-1/sqrt(2),1/sqrt(2)], with orientationBits each.
+//
+// A frame is a delta against a baseline, the last frame acknowledged by
+// the viewer. A body is sent only when its quantized position or
+// orientation differs from the baseline by more than the thresholds, in
+// quantization steps, and the differences are sent with a variable-length
+// code, so the size of a frame grows with the number of bodies that move
+// and with their motion since the baseline. Frames without a baseline
+// (keyframes) contain all bodies; the encoder sends one when no
+// acknowledged frame is in its history and every keyframeInterval frames.
+// A body that is not sent keeps its baseline pose in the frame, and the
+// encoder records that pose, so the encoder and the decoder have the same
+// frames for use as baselines.
+
+struct PhysicsStreamParameters
+{
+	PhysicsStreamParameters()
+		:
+		positionBits(16),
+		orientationBits(10),
+		positionThreshold(0),
+		orientationThreshold(0),
+		keyframeInterval(60),
+		historySize(32)
+	{
+	}
+
+	// positionBits in [1,24] and orientationBits in [1,16].
+	uint32_t positionBits;
+	uint32_t orientationBits;
+	uint32_t positionThreshold;
+	uint32_t orientationThreshold;
+	uint32_t keyframeInterval;
+	uint32_t historySize;
+};
+
+// A quantized body pose. 'largest' is the index of the omitted quaternion
+// component; 'orientation' holds the other three in increasing index order.
+struct PhysicsStreamPose
+{
+	uint32_t position[3];
+	uint16_t orientation[3];
+	uint8_t largest;
+};
+
+template <typename Real>
+class PhysicsStreamEncoder
+{
+public:
+	// The encoder and its decoders must use the same region and parameters.
+	PhysicsStreamEncoder(Vector3<Real> const& regionMin, Vector3<Real> const& regionMax,
+		PhysicsStreamParameters const& parameters = PhysicsStreamParameters{});
+
+	// Encode the poses of the bodies at the specified time into a frame.
+	// The storage of 'frame' is reused.
+	void Encode(double time, size_t numBodies, Vector3<Real> const* positions,
+		Quaternion<Real> const* orientations, std::vector<uint8_t>& frame);
+
+	inline void Encode(double time, PhysicsModule<Real> const& module,
+		std::vector<uint8_t>& frame)
+	{
+		auto const& spheres = module.GetSpheres();
+		Encode(time, spheres.GetNumSpheres(), spheres.position.data(),
+			spheres.qOrientation.data(), frame);
+	}
+
+	// The viewer has decoded the frame; later frames can use it as their
+	// baseline. Acknowledgments of frames older than the latest one are
+	// ignored.
+	void Acknowledge(uint32_t frameNumber);
+
+	// The number of the last encoded frame; the first frame is 1.
+	inline uint32_t GetFrameNumber() const
+	{
+		return mFrameNumber;
+	}
+
+	// The number of bodies sent in the last frame.
+	inline size_t GetNumBodiesSent() const
+	{
+		return mNumBodiesSent;
+	}
+
+private:
+	struct Frame
+	{
+		uint32_t number;
+		std::vector<PhysicsStreamPose> poses;
+	};
+
+	Vector3<Real> mRegionMin, mRegionMax;
+	PhysicsStreamParameters mParameters;
+	uint32_t mFrameNumber, mAcknowledged;
+	size_t mNumBodiesSent;
+
+	// Frame n is stored in mHistory[n % historySize].
+	std::vector<Frame> mHistory;
+};
+
+template <typename Real>
+class PhysicsStreamDecoder
+{
+public:
+	PhysicsStreamDecoder(Vector3<Real> const& regionMin, Vector3<Real> const& regionMax,
+		PhysicsStreamParameters const& parameters = PhysicsStreamParameters{});
+
+	// Decode a frame. The function returns false when the frame is
+	// malformed or its baseline is not in the history, for example after
+	// lost frames; decoding resumes with the next keyframe or with the
+	// next frame whose baseline has been received. After a successful
+	// call, acknowledge GetFrameNumber() to the encoder and read the poses.
+	bool Decode(std::vector<uint8_t> const& frame);
+
+	inline uint32_t GetFrameNumber() const
+	{
+		return mFrameNumber;
+	}
+
+	inline double GetTime() const
+	{
+		return mTime;
+	}
+
+	inline std::vector<Vector3<Real>> const& GetPositions() const
+	{
+		return mPositions;
+	}
+
+	inline std::vector<Quaternion<Real>> const& GetOrientations() const
+	{
+		return mOrientations;
+	}
+
+private:
+	struct Frame
+	{
+		uint32_t number;
+		std::vector<PhysicsStreamPose> poses;
+	};
+
+	Vector3<Real> mRegionMin, mRegionMax;
+	PhysicsStreamParameters mParameters;
+	uint32_t mFrameNumber;
+	double mTime;
+	std::vector<Vector3<Real>> mPositions;
+	std::vector<Quaternion<Real>> mOrientations;
+	std::vector<Frame> mHistory;
+	std::vector<PhysicsStreamPose> mPoses;
+};
+
+// The decoded frames of the last 'capacity' simulation times. Sample
+// interpolates the poses at a render time between two frames, linearly for
+// the positions and with a normalized linear interpolation for the
+// quaternions. Render a little behind the newest frame, for example two
+// frame intervals, so that a frame on each side is usually available.
+template <typename Real>
+class PhysicsInterpolationBuffer
+{
+public:
+	PhysicsInterpolationBuffer(size_t capacity = 8);
+
+	// The times must increase; a frame that is not newer than the newest
+	// one is ignored.
+	void Push(double time, std::vector<Vector3<Real>> const& positions,
+		std::vector<Quaternion<Real>> const& orientations);
+
+	inline void Push(PhysicsStreamDecoder<Real> const& decoder)
+	{
+		Push(decoder.GetTime(), decoder.GetPositions(), decoder.GetOrientations());
+	}
+
+	// The poses at the specified time. Times before the oldest frame or
+	// after the newest frame return the poses of that frame. The bodies
+	// that are not in both frames take the poses of the nearer frame. The
+	// function returns false when the buffer is empty.
+	bool Sample(double time, std::vector<Vector3<Real>>& positions,
+		std::vector<Quaternion<Real>>& orientations) const;
+
+	inline size_t GetNumFrames() const
+	{
+		return mNumFrames;
+	}
+
+private:
+	struct Frame
+	{
+		double time;
+		std::vector<Vector3<Real>> positions;
+		std::vector<Quaternion<Real>> orientations;
+	};
+
+	// A ring of frames; the oldest is mFrames[mFirst].
+	std::vector<Frame> mFrames;
+	size_t mFirst, mNumFrames;
+};
@@ -0,0 +1,743 @@
+// QueryBenchmark.cpp : Microbenchmarks of the queries in the top-level
+// collision headers, the baseline for optimizations of the queries. Every
+// TIQuery, FIQuery and DCPQuery of DistPointAlignedBox.h,
+// DistPointOrientedBox.h, DistPointCanonicalBox.h, IntrRayAlignedBox.h,
+// IntrLineAlignedBox.h, IntrAlignedBoxSphere.h, IntrOrientedBoxShere.h and
+// IntrIntervals.h is timed with float and double, and the exact queries
+// also with BSRational.
+//
+// The inputs are drawn in double precision from a seeded generator and are
+// sorted into hits and misses by the double query, so every type receives
+// the same inputs. A hit is an intersection for TIQuery and FIQuery and a
+// point inside the box for DCPQuery. Each query is timed separately on
+// hits only, on misses only and on a shuffled mix with the requested
+// fraction of hits, because most queries have early exits that make misses
+// much cheaper than hits. The timings are written to stdout as a JSON
+// object in nanoseconds per query.
+//
+// The program is not part of the Visual Studio project, which builds the
+// Geometry_Collision program. Build it with the BUILD_QUERY_BENCHMARK
+// option of Mathematics/CMakeLists.txt. That target does not compile yet,
+// because the top-level Vector.h, Line.h and Ray.h included through the
+// query headers do not compile; see the comment in the CMakeLists.txt.
+//
+// Usage: QueryBenchmark [options]
+//   --count n          number of inputs of each set (default 4096)
+//   --repeats n        number of timed passes over each set (default 64)
+//   --rational-count n number of inputs of each set for BSRational
+//                      (default 256)
+//   --rational-repeats n
+//                      number of timed passes for BSRational (default 4)
+//   --hit-fraction f   fraction of hits in the mixed set (default 0.5)
+//   --filter text      time only the queries whose names contain the text
+//   --seed n           random number seed (default 0)
+
+#include "DistPointAlignedBox.h"
+#include "DistPointCanonicalBox.h"
+#include "DistPointOrientedBox.h"
+#include "IntrAlignedBoxSphere.h"
+#include "IntrIntervals.h"
+#include "IntrLineAlignedBox.h"
+#include "IntrOrientedBoxShere.h"
+#include "IntrRayAlignedBox.h"
+#include <Mathematics/ArbitraryPrecision.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+using namespace Vector_GM;
+
+namespace gtl
+{
+	// BSRational of the Mathematics library specializes the trait of
+	// namespace gte, but the top-level queries select their exact
+	// arithmetic paths with the trait of namespace gtl.
+	template <typename UInteger>
+	struct _is_arbitrary_precision_internal<gte::BSRational<UInteger>> : std::true_type {};
+}
+
+namespace
+{
+	using Rational = gte::BSRational<gte::UIntegerAP32>;
+
+	struct Options
+	{
+		size_t count = 4096;
+		size_t repeats = 64;
+		size_t rationalCount = 256;
+		size_t rationalRepeats = 4;
+		double hitFraction = 0.5;
+		std::string filter;
+		uint32_t seed = 0;
+	};
+
+	// The parameters of one input, drawn in double precision. The layout
+	// depends on the query; see CreateAllSamples.
+	using Sample = std::vector<double>;
+
+	struct SampleSets
+	{
+		std::vector<Sample> hit, miss, mixed;
+	};
+
+	struct Timing
+	{
+		std::string query, type;
+		size_t count;
+		double hitNs, missNs, mixedNs, checksum;
+	};
+
+	bool ParseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			std::string const arg = argv[i];
+			bool const hasValue = (i + 1 < argc);
+			if (arg == "--count" && hasValue)
+			{
+				options.count = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--repeats" && hasValue)
+			{
+				options.repeats = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--rational-count" && hasValue)
+			{
+				options.rationalCount = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--rational-repeats" && hasValue)
+			{
+				options.rationalRepeats = std::strtoull(argv[++i], nullptr, 10);
+			}
+			else if (arg == "--hit-fraction" && hasValue)
+			{
+				options.hitFraction = std::strtod(argv[++i], nullptr);
+			}
+			else if (arg == "--filter" && hasValue)
+			{
+				options.filter = argv[++i];
+			}
+			else if (arg == "--seed" && hasValue)
+			{
+				options.seed = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+			}
+			else
+			{
+				std::fprintf(stderr, "Unknown or incomplete option '%s'.\n", arg.c_str());
+				return false;
+			}
+		}
+
+		if (options.count == 0 || options.repeats == 0 || options.rationalCount == 0 ||
+			options.rationalRepeats == 0 || options.hitFraction < 0.0 || options.hitFraction > 1.0)
+		{
+			std::fprintf(stderr, "Invalid option value.\n");
+			return false;
+		}
+		return true;
+	}
+
+	// Draw samples until there are 'count' hits and 'count' misses. The
+	// mixed set takes the first hits and misses in the requested proportion
+	// and is shuffled, so the branches of the query are not predictable.
+	template <typename Draw, typename IsHit>
+	SampleSets CreateSamples(size_t count, double hitFraction, std::mt19937& rng,
+		Draw const& draw, IsHit const& isHit)
+	{
+		SampleSets sets{};
+		size_t const maxAttempts = 1000 * count;
+		for (size_t attempt = 0; attempt < maxAttempts &&
+			(sets.hit.size() < count || sets.miss.size() < count); ++attempt)
+		{
+			Sample sample = draw(rng);
+			auto& set = (isHit(sample) ? sets.hit : sets.miss);
+			if (set.size() < count)
+			{
+				set.push_back(std::move(sample));
+			}
+		}
+		if (sets.hit.size() < count || sets.miss.size() < count)
+		{
+			std::fprintf(stderr, "The input generator does not produce enough hits or misses.\n");
+			std::exit(1);
+		}
+
+		size_t const numHits = static_cast<size_t>(std::llround(hitFraction * static_cast<double>(count)));
+		sets.mixed.assign(sets.hit.begin(), sets.hit.begin() + numHits);
+		sets.mixed.insert(sets.mixed.end(), sets.miss.begin(), sets.miss.begin() + (count - numHits));
+		std::shuffle(sets.mixed.begin(), sets.mixed.end(), rng);
+		return sets;
+	}
+
+	// Construction of the primitives of type T from the sample parameters
+	// starting at index i.
+	template <typename T>
+	Vector3<T> MakeVector(Sample const& s, size_t i)
+	{
+		return Vector3<T>{ static_cast<T>(s[i]), static_cast<T>(s[i + 1]), static_cast<T>(s[i + 2]) };
+	}
+
+	template <typename T>
+	AlignedBox3<T> MakeAlignedBox(Sample const& s, size_t i)
+	{
+		AlignedBox3<T> box{};
+		box.min = MakeVector<T>(s, i);
+		box.max = MakeVector<T>(s, i + 3);
+		return box;
+	}
+
+	// center, axis[0..2], extent
+	template <typename T>
+	OrientedBox3<T> MakeOrientedBox(Sample const& s, size_t i)
+	{
+		OrientedBox3<T> box{};
+		box.center = MakeVector<T>(s, i);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			box.axis[d] = MakeVector<T>(s, i + 3 + 3 * static_cast<size_t>(d));
+		}
+		box.extent = MakeVector<T>(s, i + 12);
+		return box;
+	}
+
+	template <typename T>
+	Sphere3<T> MakeSphere(Sample const& s, size_t i)
+	{
+		Sphere3<T> sphere{};
+		sphere.center = MakeVector<T>(s, i);
+		sphere.radius = static_cast<T>(s[i + 3]);
+		return sphere;
+	}
+
+	template <typename T>
+	std::array<T, 2> MakeInterval(Sample const& s, size_t i)
+	{
+		return std::array<T, 2>{ static_cast<T>(s[i]), static_cast<T>(s[i + 1]) };
+	}
+
+	// Random primitives in double precision. The boxes have centers in
+	// [-1,1]^3 and extents in [1/4,2]^3.
+	void DrawVector(std::mt19937& rng, double rmin, double rmax, Sample& s)
+	{
+		std::uniform_real_distribution<double> rnd(rmin, rmax);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			s.push_back(rnd(rng));
+		}
+	}
+
+	void DrawBoxCenterExtent(std::mt19937& rng, std::array<double, 3>& center,
+		std::array<double, 3>& extent)
+	{
+		std::uniform_real_distribution<double> rndCenter(-1.0, 1.0), rndExtent(0.25, 2.0);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			center[d] = rndCenter(rng);
+			extent[d] = rndExtent(rng);
+		}
+	}
+
+	void DrawAlignedBox(std::mt19937& rng, Sample& s)
+	{
+		std::array<double, 3> center{}, extent{};
+		DrawBoxCenterExtent(rng, center, extent);
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			s.push_back(center[d] - extent[d]);
+		}
+		for (int32_t d = 0; d < 3; ++d)
+		{
+			s.push_back(center[d] + extent[d]);
+		}
+	}
+
+	// The axes are an orthonormal basis obtained from two random vectors
+	// by Gram-Schmidt orthonormalization.
+	void DrawOrientedBox(std::mt19937& rng, Sample& s)
+	{
+		std::array<double, 3> center{}, extent{};
+		DrawBoxCenterExtent(rng, center, extent);
+		std::normal_distribution<double> rnd(0.0, 1.0);
+		Vector3<double> U0{ rnd(rng), rnd(rng), rnd(rng) };
+		Vector3<double> U1{ rnd(rng), rnd(rng), rnd(rng) };
+		Normalize(U0);
+		U1 -= Dot(U0, U1) * U0;
+		Normalize(U1);
+		Vector3<double> U2 = Cross(U0, U1);
+
+		s.insert(s.end(), center.begin(), center.end());
+		for (auto const& U : { U0, U1, U2 })
+		{
+			s.push_back(U[0]);
+			s.push_back(U[1]);
+			s.push_back(U[2]);
+		}
+		s.insert(s.end(), extent.begin(), extent.end());
+	}
+
+	void DrawSphere(std::mt19937& rng, Sample& s)
+	{
+		DrawVector(rng, -4.0, 4.0, s);
+		s.push_back(std::uniform_real_distribution<double>(0.25, 1.0)(rng));
+	}
+
+	void DrawInterval(std::mt19937& rng, Sample& s)
+	{
+		std::uniform_real_distribution<double> rndStart(-1.0, 1.0), rndWidth(0.0, 1.0);
+		double const start = rndStart(rng);
+		s.push_back(start);
+		s.push_back(start + rndWidth(rng));
+	}
+
+	// The samples of all queries, keyed by the query name. The same samples
+	// are used for every type.
+	std::map<std::string, SampleSets> CreateAllSamples(size_t count, double hitFraction,
+		uint32_t seed)
+	{
+		std::map<std::string, SampleSets> samples{};
+		std::mt19937 rng(seed);
+
+		// point, box min, box max
+		auto drawPointAlignedBox = [](std::mt19937& r)
+		{
+			Sample s{};
+			DrawVector(r, -4.0, 4.0, s);
+			DrawAlignedBox(r, s);
+			return s;
+		};
+		auto isInAlignedBox = [](Sample const& s)
+		{
+			DCPQuery<double, Vector3<double>, AlignedBox3<double>> query{};
+			return query.SqrDistance(MakeVector<double>(s, 0), MakeAlignedBox<double>(s, 3)) == 0.0;
+		};
+		samples["DCPQuery Vector3 AlignedBox3"] =
+			CreateSamples(count, hitFraction, rng, drawPointAlignedBox, isInAlignedBox);
+
+		// point, box center, box axes, box extent
+		samples["DCPQuery Vector3 OrientedBox3"] = CreateSamples(count, hitFraction, rng,
+			[](std::mt19937& r)
+			{
+				Sample s{};
+				DrawVector(r, -4.0, 4.0, s);
+				DrawOrientedBox(r, s);
+				return s;
+			},
+			[](Sample const& s)
+			{
+				DCPQuery<double, Vector3<double>, OrientedBox3<double>> query{};
+				return query.SqrDistance(MakeVector<double>(s, 0), MakeOrientedBox<double>(s, 3)) == 0.0;
+			});
+
+		// point, box extent
+		samples["DCPQuery Vector3 CanonicalBox3"] = CreateSamples(count, hitFraction, rng,
+			[](std::mt19937& r)
+			{
+				Sample s{};
+				DrawVector(r, -3.0, 3.0, s);
+				DrawVector(r, 0.25, 2.0, s);
+				return s;
+			},
+			[](Sample const& s)
+			{
+				DCPQuery<double, Vector3<double>, CanonicalBox3<double>> query{};
+				CanonicalBox3<double> box(MakeVector<double>(s, 3));
+				return query.SqrDistance(MakeVector<double>(s, 0), box) == 0.0;
+			});
+
+		// origin, direction, box min, box max. The direction points from
+		// the origin toward a point of the box enlarged three times, so
+		// about a third of the samples are hits.
+		auto drawLinearAlignedBox = [](std::mt19937& r)
+		{
+			Sample s{};
+			DrawVector(r, -6.0, 6.0, s);
+			DrawVector(r, 0.0, 0.0, s);
+			DrawAlignedBox(r, s);
+			std::uniform_real_distribution<double> rnd(-1.0, 1.0);
+			for (size_t d = 0; d < 3; ++d)
+			{
+				double const center = 0.5 * (s[6 + d] + s[9 + d]);
+				double const extent = 0.5 * (s[9 + d] - s[6 + d]);
+				s[3 + d] = center + 3.0 * extent * rnd(r) - s[d];
+			}
+			return s;
+		};
+		samples["TIQuery Ray3 AlignedBox3"] = CreateSamples(count, hitFraction, rng,
+			drawLinearAlignedBox,
+			[](Sample const& s)
+			{
+				TIQuery<double, Ray3<double>, AlignedBox3<double>> query{};
+				Ray3<double> ray(MakeVector<double>(s, 0), MakeVector<double>(s, 3));
+				return query(ray, MakeAlignedBox<double>(s, 6)).intersect;
+			});
+		samples["FIQuery Ray3 AlignedBox3"] = samples["TIQuery Ray3 AlignedBox3"];
+		samples["TIQuery Line3 AlignedBox3"] = CreateSamples(count, hitFraction, rng,
+			drawLinearAlignedBox,
+			[](Sample const& s)
+			{
+				TIQuery<double, Line3<double>, AlignedBox3<double>> query{};
+				Line3<double> line(MakeVector<double>(s, 0), MakeVector<double>(s, 3));
+				return query(line, MakeAlignedBox<double>(s, 6)).intersect;
+			});
+		samples["FIQuery Line3 AlignedBox3"] = samples["TIQuery Line3 AlignedBox3"];
+
+		// box min, box max, sphere center, sphere radius
+		samples["TIQuery AlignedBox3 Sphere3"] = CreateSamples(count, hitFraction, rng,
+			[](std::mt19937& r)
+			{
+				Sample s{};
+				DrawAlignedBox(r, s);
+				DrawSphere(r, s);
+				return s;
+			},
+			[](Sample const& s)
+			{
+				TIQuery<double, AlignedBox3<double>, Sphere3<double>> query{};
+				return query(MakeAlignedBox<double>(s, 0), MakeSphere<double>(s, 6)).intersect;
+			});
+
+		// box min, box max, sphere center, sphere radius, box velocity,
+		// sphere velocity
+		samples["FIQuery AlignedBox3 Sphere3"] = CreateSamples(count, hitFraction, rng,
+			[](std::mt19937& r)
+			{
+				Sample s{};
+				DrawAlignedBox(r, s);
+				DrawSphere(r, s);
+				DrawVector(r, -0.5, 0.5, s);
+				DrawVector(r, -2.0, 2.0, s);
+				return s;
+			},
+			[](Sample const& s)
+			{
+				FIQuery<double, AlignedBox3<double>, Sphere3<double>> query{};
+				return query(MakeAlignedBox<double>(s, 0), MakeVector<double>(s, 10),
+					MakeSphere<double>(s, 6), MakeVector<double>(s, 13)).intersectionType != 0;
+			});
+
+		// box center, box axes, box extent, sphere center, sphere radius
+		samples["TIQuery OrientedBox3 Sphere3"] = CreateSamples(count, hitFraction, rng,
+			[](std::mt19937& r)
+			{
+				Sample s{};
+				DrawOrientedBox(r, s);
+				DrawSphere(r, s);
+				return s;
+			},
+			[](Sample const& s)
+			{
+				TIQuery<double, OrientedBox3<double>, Sphere3<double>> query{};
+				return query(MakeOrientedBox<double>(s, 0), MakeSphere<double>(s, 15)).intersect;
+			});
+
+		// box center, box axes, box extent, sphere center, sphere radius,
+		// box velocity, sphere velocity
+		samples["FIQuery OrientedBox3 Sphere3"] = CreateSamples(count, hitFraction, rng,
+			[](std::mt19937& r)
+			{
+				Sample s{};
+				DrawOrientedBox(r, s);
+				DrawSphere(r, s);
+				DrawVector(r, -0.5, 0.5, s);
+				DrawVector(r, -2.0, 2.0, s);
+				return s;
+			},
+			[](Sample const& s)
+			{
+				FIQuery<double, OrientedBox3<double>, Sphere3<double>> query{};
+				return query(MakeOrientedBox<double>(s, 0), MakeVector<double>(s, 19),
+					MakeSphere<double>(s, 15), MakeVector<double>(s, 22)).intersectionType != 0;
+			});
+
+		// interval0, interval1
+		auto drawIntervals = [](std::mt19937& r)
+		{
+			Sample s{};
+			DrawInterval(r, s);
+			DrawInterval(r, s);
+			return s;
+		};
+		samples["TIQuery Interval Interval"] = CreateSamples(count, hitFraction, rng,
+			drawIntervals,
+			[](Sample const& s)
+			{
+				TIQuery<double, std::array<double, 2>, std::array<double, 2>> query{};
+				return query(MakeInterval<double>(s, 0), MakeInterval<double>(s, 2)).intersect;
+			});
+		samples["FIQuery Interval Interval"] = samples["TIQuery Interval Interval"];
+
+		return samples;
+	}
+
+	// Time 'repeats' passes of the query over the inputs and return the
+	// nanoseconds per query. The values returned by the query are summed
+	// into the checksum so that the compiler cannot discard the work.
+	template <typename Input, typename Query>
+	double Measure(std::vector<Input> const& inputs, size_t repeats, Query const& query,
+		double& checksum)
+	{
+		double sum = 0.0;
+		auto start = std::chrono::steady_clock::now();
+		for (size_t repeat = 0; repeat < repeats; ++repeat)
+		{
+			for (auto const& input : inputs)
+			{
+				sum += query(input);
+			}
+		}
+		double const seconds = std::chrono::duration<double>(
+			std::chrono::steady_clock::now() - start).count();
+		checksum += sum;
+		return 1e9 * seconds / static_cast<double>(repeats * inputs.size());
+	}
+
+	template <typename T>
+	class QueryRunner
+	{
+	public:
+		QueryRunner(std::map<std::string, SampleSets> const& samples, Options const& options,
+			char const* typeName, std::vector<Timing>& timings)
+			:
+			mSamples(samples),
+			mOptions(options),
+			mTypeName(typeName),
+			mTimings(timings)
+		{
+		}
+
+		// The inputs are constructed from the samples by 'make' before the
+		// timing starts. BSRational is timed on the first rationalCount
+		// samples of each set.
+		template <typename Make, typename Query>
+		void Run(std::string const& name, Make const& make, Query const& query)
+		{
+			if (!mOptions.filter.empty() && name.find(mOptions.filter) == std::string::npos)
+			{
+				return;
+			}
+
+			bool const isRational = std::is_same<T, Rational>::value;
+			size_t const count = (isRational ? std::min(mOptions.rationalCount, mOptions.count) : mOptions.count);
+			size_t const repeats = (isRational ? mOptions.rationalRepeats : mOptions.repeats);
+			auto const& sets = mSamples.at(name);
+			auto convert = [&make, count](std::vector<Sample> const& samples)
+			{
+				std::vector<decltype(make(samples[0]))> inputs{};
+				inputs.reserve(count);
+				for (size_t i = 0; i < count; ++i)
+				{
+					inputs.push_back(make(samples[i]));
+				}
+				return inputs;
+			};
+			auto const hit = convert(sets.hit);
+			auto const miss = convert(sets.miss);
+			auto const mixed = convert(sets.mixed);
+
+			Timing timing{};
+			timing.query = name;
+			timing.type = mTypeName;
+			timing.count = count;
+			timing.checksum = 0.0;
+			timing.hitNs = Measure(hit, repeats, query, timing.checksum);
+			timing.missNs = Measure(miss, repeats, query, timing.checksum);
+			timing.mixedNs = Measure(mixed, repeats, query, timing.checksum);
+			mTimings.push_back(timing);
+		}
+
+	private:
+		std::map<std::string, SampleSets> const& mSamples;
+		Options const& mOptions;
+		char const* mTypeName;
+		std::vector<Timing>& mTimings;
+	};
+
+	// The queries for the floating-point types. The DCPQuery operator()
+	// computes a square root; the SqrDistance versions do not and are
+	// exact, so they are also timed with BSRational.
+	template <typename T>
+	void RunExactQueries(QueryRunner<T>& runner)
+	{
+		T const zero = static_cast<T>(0);
+
+		runner.Run("DCPQuery Vector3 AlignedBox3",
+			[](Sample const& s) { return std::make_pair(MakeVector<T>(s, 0), MakeAlignedBox<T>(s, 3)); },
+			[zero](auto const& input)
+			{
+				DCPQuery<T, Vector3<T>, AlignedBox3<T>> query{};
+				return (query.SqrDistance(input.first, input.second) > zero ? 1.0 : 0.0);
+			});
+
+		runner.Run("DCPQuery Vector3 CanonicalBox3",
+			[](Sample const& s) { return std::make_pair(MakeVector<T>(s, 0), CanonicalBox3<T>(MakeVector<T>(s, 3))); },
+			[zero](auto const& input)
+			{
+				DCPQuery<T, Vector3<T>, CanonicalBox3<T>> query{};
+				return (query.SqrDistance(input.first, input.second) > zero ? 1.0 : 0.0);
+			});
+
+		runner.Run("TIQuery Ray3 AlignedBox3",
+			[](Sample const& s) { return std::make_pair(Ray3<T>(MakeVector<T>(s, 0), MakeVector<T>(s, 3)), MakeAlignedBox<T>(s, 6)); },
+			[](auto const& input)
+			{
+				TIQuery<T, Ray3<T>, AlignedBox3<T>> query{};
+				return (query(input.first, input.second).intersect ? 1.0 : 0.0);
+			});
+
+		runner.Run("TIQuery Line3 AlignedBox3",
+			[](Sample const& s) { return std::make_pair(Line3<T>(MakeVector<T>(s, 0), MakeVector<T>(s, 3)), MakeAlignedBox<T>(s, 6)); },
+			[](auto const& input)
+			{
+				TIQuery<T, Line3<T>, AlignedBox3<T>> query{};
+				return (query(input.first, input.second).intersect ? 1.0 : 0.0);
+			});
+
+		runner.Run("TIQuery AlignedBox3 Sphere3",
+			[](Sample const& s) { return std::make_pair(MakeAlignedBox<T>(s, 0), MakeSphere<T>(s, 6)); },
+			[](auto const& input)
+			{
+				TIQuery<T, AlignedBox3<T>, Sphere3<T>> query{};
+				return (query(input.first, input.second).intersect ? 1.0 : 0.0);
+			});
+
+		runner.Run("TIQuery Interval Interval",
+			[](Sample const& s) { return std::make_pair(MakeInterval<T>(s, 0), MakeInterval<T>(s, 2)); },
+			[](auto const& input)
+			{
+				TIQuery<T, std::array<T, 2>, std::array<T, 2>> query{};
+				return (query(input.first, input.second).intersect ? 1.0 : 0.0);
+			});
+
+		runner.Run("FIQuery Interval Interval",
+			[](Sample const& s) { return std::make_pair(MakeInterval<T>(s, 0), MakeInterval<T>(s, 2)); },
+			[](auto const& input)
+			{
+				FIQuery<T, std::array<T, 2>, std::array<T, 2>> query{};
+				return static_cast<double>(query(input.first, input.second).numIntersections);
+			});
+	}
+
+	// The queries that compute square roots or use floating-point
+	// tolerances, timed only with float and double.
+	template <typename T>
+	void RunFloatingPointQueries(QueryRunner<T>& runner)
+	{
+		runner.Run("DCPQuery Vector3 OrientedBox3",
+			[](Sample const& s) { return std::make_pair(MakeVector<T>(s, 0), MakeOrientedBox<T>(s, 3)); },
+			[](auto const& input)
+			{
+				DCPQuery<T, Vector3<T>, OrientedBox3<T>> query{};
+				return static_cast<double>(query(input.first, input.second).distance);
+			});
+
+		runner.Run("FIQuery Ray3 AlignedBox3",
+			[](Sample const& s) { return std::make_pair(Ray3<T>(MakeVector<T>(s, 0), MakeVector<T>(s, 3)), MakeAlignedBox<T>(s, 6)); },
+			[](auto const& input)
+			{
+				FIQuery<T, Ray3<T>, AlignedBox3<T>> query{};
+				return static_cast<double>(query(input.first, input.second).numIntersections);
+			});
+
+		runner.Run("FIQuery Line3 AlignedBox3",
+			[](Sample const& s) { return std::make_pair(Line3<T>(MakeVector<T>(s, 0), MakeVector<T>(s, 3)), MakeAlignedBox<T>(s, 6)); },
+			[](auto const& input)
+			{
+				FIQuery<T, Line3<T>, AlignedBox3<T>> query{};
+				return static_cast<double>(query(input.first, input.second).numIntersections);
+			});
+
+		runner.Run("FIQuery AlignedBox3 Sphere3",
+			[](Sample const& s)
+			{
+				return std::make_tuple(MakeAlignedBox<T>(s, 0), MakeVector<T>(s, 10),
+					MakeSphere<T>(s, 6), MakeVector<T>(s, 13));
+			},
+			[](auto const& input)
+			{
+				FIQuery<T, AlignedBox3<T>, Sphere3<T>> query{};
+				auto result = query(std::get<0>(input), std::get<1>(input),
+					std::get<2>(input), std::get<3>(input));
+				return static_cast<double>(result.contactTime);
+			});
+
+		runner.Run("TIQuery OrientedBox3 Sphere3",
+			[](Sample const& s) { return std::make_pair(MakeOrientedBox<T>(s, 0), MakeSphere<T>(s, 15)); },
+			[](auto const& input)
+			{
+				TIQuery<T, OrientedBox3<T>, Sphere3<T>> query{};
+				return (query(input.first, input.second).intersect ? 1.0 : 0.0);
+			});
+
+		runner.Run("FIQuery OrientedBox3 Sphere3",
+			[](Sample const& s)
+			{
+				return std::make_tuple(MakeOrientedBox<T>(s, 0), MakeVector<T>(s, 19),
+					MakeSphere<T>(s, 15), MakeVector<T>(s, 22));
+			},
+			[](auto const& input)
+			{
+				FIQuery<T, OrientedBox3<T>, Sphere3<T>> query{};
+				auto result = query(std::get<0>(input), std::get<1>(input),
+					std::get<2>(input), std::get<3>(input));
+				return static_cast<double>(result.contactTime);
+			});
+	}
+
+	void WriteTimings(Options const& options, std::vector<Timing> const& timings)
+	{
+		std::printf("{\n");
+		std::printf("  \"count\": %zu,\n", options.count);
+		std::printf("  \"repeats\": %zu,\n", options.repeats);
+		std::printf("  \"rationalCount\": %zu,\n", options.rationalCount);
+		std::printf("  \"rationalRepeats\": %zu,\n", options.rationalRepeats);
+		std::printf("  \"hitFraction\": %.17g,\n", options.hitFraction);
+		std::printf("  \"seed\": %u,\n", options.seed);
+		std::printf("  \"queries\": [\n");
+		for (size_t i = 0; i < timings.size(); ++i)
+		{
+			Timing const& timing = timings[i];
+			std::printf("    { \"query\": \"%s\", \"type\": \"%s\", \"count\": %zu, "
+				"\"hitNs\": %.3f, \"missNs\": %.3f, \"mixedNs\": %.3f, \"checksum\": %.17g }%s\n",
+				timing.query.c_str(), timing.type.c_str(), timing.count, timing.hitNs,
+				timing.missNs, timing.mixedNs, timing.checksum,
+				(i + 1 < timings.size() ? "," : ""));
+		}
+		std::printf("  ]\n");
+		std::printf("}\n");
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options{};
+	if (!ParseOptions(argc, argv, options))
+	{
+		return 1;
+	}
+
+	auto const samples = CreateAllSamples(options.count, options.hitFraction, options.seed);
+	std::vector<Timing> timings{};
+
+	QueryRunner<float> floatRunner(samples, options, "float", timings);
+	RunExactQueries(floatRunner);
+	RunFloatingPointQueries(floatRunner);
+
+	QueryRunner<double> doubleRunner(samples, options, "double", timings);
+	RunExactQueries(doubleRunner);
+	RunFloatingPointQueries(doubleRunner);
+
+	QueryRunner<Rational> rationalRunner(samples, options, "BSRational", timings);
+	RunExactQueries(rationalRunner);
+
+	WriteTimings(options, timings);
+	return 0;
+}
@@ -15,6 +15,15 @@ namespace Vector_GM
 	// to be passed to the functionals. This makes the Runge-Kutta ODE
 	// solver easier to read. The RigidBody<T> class provides wrappers
 	// around the state accessors to avoid exposing a public state member.
+	//
+	// The rotation matrix, the world inertia tensors and the angular
+	// velocity are derived quantities that are computed lazily by their
+	// Get functions, so the intermediate states of the Runge-Kutta solver
+	// pay for them only when a Force or Torque functional reads them. The
+	// Get functions update mutable members, so a state must not be read
+	// concurrently by multiple threads. When the body inertia is a multiple
+	// of the identity (for example, a sphere), the world inertia tensors
+	// are the body inertia tensors and are never transformed.
 	template <typename T>
 	class RigidBodyState
 	{
@@ -25,6 +34,7 @@ namespace Vector_GM
 			mInvMass(static_cast<T>(0)),
 			mBodyInertia(Matrix3x3<T>::Zero()),
 			mBodyInverseInertia(Matrix3x3<T>::Zero()),
+			mIsotropic(true),
 			mPosition(Vector3<T>::Zero()),
 			mQOrientation(Quaternion<T>::Identity()),
 			mLinearMomentum(Vector3<T>::Zero()),
@@ -34,7 +44,10 @@ namespace Vector_GM
 			mROrientation(Matrix3x3<T>::Identity()),
 			mLinearVelocity(Vector3<T>::Zero()),
 			mAngularVelocity(Vector3<T>::Zero()),
-			mQAngularVelocity{}
+			mQAngularVelocity{},
+			mROrientationDirty(false),
+			mWorldInertiaDirty(false),
+			mAngularVelocityDirty(false)
 		{
 		}
 
@@ -66,18 +79,31 @@ namespace Vector_GM
 		{
 			Matrix3x3<T> const zero = Matrix3x3<T>::Zero();
 
+			// A pending angular velocity uses the previous inertia.
+			ResolveAngularVelocity();
+
 			if (bodyInertia != zero)
 			{
 				mBodyInertia = bodyInertia;
 				mBodyInverseInertia = Inverse(bodyInertia);
-				UpdateWorldInertialQuantities();
+				mIsotropic = IsIsotropic(bodyInertia);
 			}
 			else
 			{
 				mBodyInertia = zero;
 				mBodyInverseInertia = zero;
-				mWorldInertia = zero;
-				mWorldInverseInertia = zero;
+				mIsotropic = true;
+			}
+
+			if (mIsotropic)
+			{
+				mWorldInertia = mBodyInertia;
+				mWorldInverseInertia = mBodyInverseInertia;
+				mWorldInertiaDirty = false;
+			}
+			else
+			{
+				mWorldInertiaDirty = true;
 			}
 		}
 
@@ -91,6 +117,13 @@ namespace Vector_GM
 			return mMass == static_cast<T>(0);
 		}
 
+		// The body inertia is a multiple of the identity matrix, in which
+		// case the world inertia does not depend on the orientation.
+		inline bool IsIsotropic() const
+		{
+			return mIsotropic;
+		}
+
 		inline void SetPosition(Vector3<T> const& position)
 		{
 			mPosition = position;
@@ -98,17 +131,17 @@ namespace Vector_GM
 
 		void SetQOrientation(Quaternion<T> const& qOrientation, bool normalize = false)
 		{
+			// A pending angular velocity uses the previous orientation.
+			ResolveAngularVelocity();
+
 			mQOrientation = qOrientation;
 			if (normalize)
 			{
 				Normalize(mQOrientation);
 			}
 
-			mROrientation = Rotation<3, T>(qOrientation);
-			if (IsMovable())
-			{
-				UpdateWorldInertialQuantities();
-			}
+			mROrientationDirty = true;
+			mWorldInertiaDirty = !mIsotropic;
 		}
 
 		void SetLinearMomentum(Vector3<T> const& linearMomentum)
@@ -125,22 +158,18 @@ namespace Vector_GM
 			if (IsMovable())
 			{
 				mAngularMomentum = angularMomentum;
-				mAngularVelocity = mWorldInverseInertia * angularMomentum;
-				mQAngularVelocity[0] = mAngularVelocity[0];
-				mQAngularVelocity[1] = mAngularVelocity[1];
-				mQAngularVelocity[2] = mAngularVelocity[2];
-				mQAngularVelocity[3] = static_cast<T>(0);
+				mAngularVelocityDirty = true;
 			}
 		}
 
 		void SetROrientation(Matrix3x3<T> const& rOrientation)
 		{
+			ResolveAngularVelocity();
+
 			mROrientation = rOrientation;
 			mQOrientation = Rotation<3, T>(rOrientation);
-			if (IsMovable())
-			{
-				UpdateWorldInertialQuantities();
-			}
+			mROrientationDirty = false;
+			mWorldInertiaDirty = !mIsotropic;
 		}
 
 		void SetLinearVelocity(Vector3<T> const& linearVelocity)
@@ -157,11 +186,12 @@ namespace Vector_GM
 			if (IsMovable())
 			{
 				mAngularVelocity = angularVelocity;
-				mAngularMomentum = mWorldInertia * angularVelocity;
+				mAngularMomentum = GetWorldInertia() * angularVelocity;
 				mQAngularVelocity[0] = mAngularVelocity[0];
 				mQAngularVelocity[1] = mAngularVelocity[1];
 				mQAngularVelocity[2] = mAngularVelocity[2];
 				mQAngularVelocity[3] = static_cast<T>(0);
+				mAngularVelocityDirty = false;
 			}
 		}
 
@@ -187,11 +217,13 @@ namespace Vector_GM
 
 		inline Matrix3x3<T> const& GetWorldInertia() const
 		{
+			ResolveWorldInertia();
 			return mWorldInertia;
 		}
 
 		inline Matrix3x3<T> const& GetWorldInverseInertia() const
 		{
+			ResolveWorldInertia();
 			return mWorldInverseInertia;
 		}
 
@@ -217,6 +249,7 @@ namespace Vector_GM
 
 		inline Matrix3x3<T> const& GetROrientation() const
 		{
+			ResolveROrientation();
 			return mROrientation;
 		}
 
@@ -227,22 +260,79 @@ namespace Vector_GM
 
 		inline Vector3<T> const& GetAngularVelocity() const
 		{
+			ResolveAngularVelocity();
 			return mAngularVelocity;
 		}
 
 		inline Quaternion<T> const& GetQAngularVelocity() const
 		{
+			ResolveAngularVelocity();
 			return mQAngularVelocity;
 		}
 
 	private:
-		void UpdateWorldInertialQuantities()
+		static bool IsIsotropic(Matrix3x3<T> const& inertia)
 		{
-			mWorldInertia = MultiplyABT(
-				mROrientation * mBodyInertia, mROrientation);
+			T const zero = static_cast<T>(0);
+			return inertia(0, 1) == zero && inertia(0, 2) == zero
+				&& inertia(1, 0) == zero && inertia(1, 2) == zero
+				&& inertia(2, 0) == zero && inertia(2, 1) == zero
+				&& inertia(0, 0) == inertia(1, 1)
+				&& inertia(0, 0) == inertia(2, 2);
+		}
 
-			mWorldInverseInertia = MultiplyABT(
-				mROrientation * mBodyInverseInertia, mROrientation);
+		void ResolveROrientation() const
+		{
+			if (mROrientationDirty)
+			{
+				mROrientation = Rotation<3, T>(mQOrientation);
+				mROrientationDirty = false;
+			}
+		}
+
+		void ResolveWorldInertia() const
+		{
+			if (mWorldInertiaDirty)
+			{
+				ResolveROrientation();
+
+				mWorldInertia = MultiplyABT(
+					mROrientation * mBodyInertia, mROrientation);
+
+				mWorldInverseInertia = MultiplyABT(
+					mROrientation * mBodyInverseInertia, mROrientation);
+
+				mWorldInertiaDirty = false;
+			}
+		}
+
+		void ResolveAngularVelocity() const
+		{
+			if (mAngularVelocityDirty)
+			{
+				if (mIsotropic)
+				{
+					mAngularVelocity = mBodyInverseInertia(0, 0) * mAngularMomentum;
+				}
+				else if (!mWorldInertiaDirty)
+				{
+					mAngularVelocity = mWorldInverseInertia * mAngularMomentum;
+				}
+				else
+				{
+					// R*J^{-1}*R^T*L with three matrix-vector products
+					// instead of forming the world inverse inertia.
+					ResolveROrientation();
+					mAngularVelocity = mROrientation *
+						(mBodyInverseInertia * (mAngularMomentum * mROrientation));
+				}
+
+				mQAngularVelocity[0] = mAngularVelocity[0];
+				mQAngularVelocity[1] = mAngularVelocity[1];
+				mQAngularVelocity[2] = mAngularVelocity[2];
+				mQAngularVelocity[3] = static_cast<T>(0);
+				mAngularVelocityDirty = false;
+			}
 		}
 
 		// Constant quantities during the simulation.
@@ -250,6 +340,7 @@ namespace Vector_GM
 		T mInvMass;
 		Matrix3x3<T> mBodyInertia;
 		Matrix3x3<T> mBodyInverseInertia;
+		bool mIsotropic;
 
 		// State variables in the differential equations of motion.
 		Vector3<T> mPosition;
@@ -257,13 +348,39 @@ namespace Vector_GM
 		Vector3<T> mLinearMomentum;
 		Vector3<T> mAngularMomentum;
 
-		// Quantities derived from the state variables.
-		Matrix3x3<T> mWorldInertia;
-		Matrix3x3<T> mWorldInverseInertia;
-		Matrix3x3<T> mROrientation;
+		// Quantities derived from the state variables. The mutable ones are
+		// valid only when their dirty flags are false.
+		mutable Matrix3x3<T> mWorldInertia;
+		mutable Matrix3x3<T> mWorldInverseInertia;
+		mutable Matrix3x3<T> mROrientation;
 		Vector3<T> mLinearVelocity;
-		Vector3<T> mAngularVelocity;
-		Quaternion<T> mQAngularVelocity;
+		mutable Vector3<T> mAngularVelocity;
+		mutable Quaternion<T> mQAngularVelocity;
+		mutable bool mROrientationDirty;
+		mutable bool mWorldInertiaDirty;
+		mutable bool mAngularVelocityDirty;
+	};
+
+
+	// A force or torque that does not depend on the time or on the rigid
+	// body state. Passing it to the templated RigidBody<T>::Update reduces
+	// the evaluations to copies of the value.
+	template <typename T>
+	class RigidBodyConstant
+	{
+	public:
+		RigidBodyConstant(Vector3<T> const& inValue = Vector3<T>::Zero())
+			:
+			value(inValue)
+		{
+		}
+
+		inline Vector3<T> operator()(T, RigidBodyState<T> const&) const
+		{
+			return value;
+		}
+
+		Vector3<T> value;
 	};
 
 
@@ -424,8 +541,23 @@ namespace Vector_GM
 		Function Force;
 		Function Torque;
 
-		// Runge-Kutta fourth-order differential equation solver
+		// Runge-Kutta fourth-order differential equation solver using the
+		// Force and Torque members.
 		void Update(T const& t, T const& dt)
+		{
+			Update(t, dt, Force, Torque);
+		}
+
+		// Runge-Kutta fourth-order differential equation solver using the
+		// callables force and torque, each with the signature of Function.
+		// The types are template parameters, so function objects and lambdas
+		// are called directly and can be inlined, whereas the Force and
+		// Torque members are type-erased calls, eight per step. Use
+		// RigidBodyConstant<T> for a force or torque that does not depend on
+		// the time or state, such as uniform gravity or zero torque.
+		template <typename ForceFunction, typename TorqueFunction>
+		void Update(T const& t, T const& dt, ForceFunction const& force,
+			TorqueFunction const& torque)
 		{
 			// TODO: When GTE_MAT_VEC is not defined (i.e. use vec-mat),
 			// test to see whether dq/dt = 0.5 * w * q (mat-vec convention)
@@ -440,16 +572,16 @@ namespace Vector_GM
 			T TpHalfDT = t + halfDT;
 			T TpDT = t + dt;
 
-			RigidBodyState<T> newState{};
-			newState.SetMass(GetMass());
-			newState.SetBodyInertia(GetBodyInertia());
+			// The copy shares the mass and inertia constants, so the body
+			// inertia is not inverted again.
+			RigidBodyState<T> newState = mState;
 
 			// A1 = G(T,S0), B1 = S0 + (DT/2)*A1
 			Vector3<T> A1DXDT = GetLinearVelocity();
 			Quaternion<T> W = GetQAngularVelocity();
 			Quaternion<T> A1DQDT = half * W * GetQOrientation();
-			Vector3<T> A1DPDT = Force(t, mState);
-			Vector3<T> A1DLDT = Torque(t, mState);
+			Vector3<T> A1DPDT = force(t, mState);
+			Vector3<T> A1DLDT = torque(t, mState);
 			newState.SetPosition(GetPosition() + halfDT * A1DXDT);
 			newState.SetQOrientation(GetQOrientation() + halfDT * A1DQDT, true);
 			newState.SetLinearMomentum(GetLinearMomentum() + halfDT * A1DPDT);
@@ -459,8 +591,8 @@ namespace Vector_GM
 			Vector3<T> A2DXDT = newState.GetLinearVelocity();
 			W = newState.GetQAngularVelocity();
 			Quaternion<T> A2DQDT = half * W * newState.GetQOrientation();
-			Vector3<T> A2DPDT = Force(TpHalfDT, newState);
-			Vector3<T> A2DLDT = Torque(TpHalfDT, newState);
+			Vector3<T> A2DPDT = force(TpHalfDT, newState);
+			Vector3<T> A2DLDT = torque(TpHalfDT, newState);
 			newState.SetPosition(GetPosition() + halfDT * A2DXDT);
 			newState.SetQOrientation(GetQOrientation() + halfDT * A2DQDT, true);
 			newState.SetLinearMomentum(GetLinearMomentum() + halfDT * A2DPDT);
@@ -470,8 +602,8 @@ namespace Vector_GM
 			Vector3<T> A3DXDT = newState.GetLinearVelocity();
 			W = newState.GetQAngularVelocity();
 			Quaternion<T> A3DQDT = half * W * newState.GetQOrientation();
-			Vector3<T> A3DPDT = Force(TpHalfDT, newState);
-			Vector3<T> A3DLDT = Torque(TpHalfDT, newState);
+			Vector3<T> A3DPDT = force(TpHalfDT, newState);
+			Vector3<T> A3DLDT = torque(TpHalfDT, newState);
 			newState.SetPosition(GetPosition() + dt * A3DXDT);
 			newState.SetQOrientation(GetQOrientation() + dt * A3DQDT, true);
 			newState.SetLinearMomentum(GetLinearMomentum() + dt * A3DPDT);
@@ -481,8 +613,8 @@ namespace Vector_GM
 			Vector3<T> A4DXDT = newState.GetLinearVelocity();
 			W = newState.GetQAngularVelocity();
 			Quaternion<T> A4DQDT = half * W * newState.GetQOrientation();
-			Vector3<T> A4DPDT = Force(TpDT, newState);
-			Vector3<T> A4DLDT = Torque(TpDT, newState);
+			Vector3<T> A4DPDT = force(TpDT, newState);
+			Vector3<T> A4DLDT = torque(TpDT, newState);
 
 			SetPosition(GetPosition() +
 				sixthDT * (A1DXDT + two * (A2DXDT + A3DXDT) + A4DXDT));
@@ -497,6 +629,57 @@ namespace Vector_GM
 				sixthDT * (A1DLDT + two * (A2DLDT + A3DLDT) + A4DLDT));
 		}
 
+		// Semi-implicit (symplectic) Euler solver with one force and one
+		// torque evaluation per step. The momenta are advanced with the
+		// force and torque at time t, and the position and orientation with
+		// the new velocities. The method is first-order accurate, but the
+		// energy of an oscillating body does not drift, so it is a cheap
+		// alternative to Update for scenes dominated by contacts.
+		template <typename ForceFunction, typename TorqueFunction>
+		void UpdateSemiImplicitEuler(T const& t, T const& dt,
+			ForceFunction const& force, TorqueFunction const& torque)
+		{
+			T const half = static_cast<T>(0.5);
+
+			Vector3<T> DPDT = force(t, mState);
+			Vector3<T> DLDT = torque(t, mState);
+			SetLinearMomentum(GetLinearMomentum() + dt * DPDT);
+			SetAngularMomentum(GetAngularMomentum() + dt * DLDT);
+
+			Quaternion<T> W = GetQAngularVelocity();
+			SetPosition(GetPosition() + dt * GetLinearVelocity());
+			SetQOrientation(GetQOrientation() + (half * dt) * W * GetQOrientation(), true);
+		}
+
+		// Velocity Verlet solver with two force and two torque evaluations
+		// per step: half a step of the momenta with the force and torque at
+		// time t, a full step of the position and orientation with the
+		// half-step velocities, and half a step of the momenta with the
+		// force and torque at time t+dt. The method is second-order accurate
+		// for forces that depend only on the position and, like the
+		// semi-implicit Euler solver, does not drift in energy.
+		template <typename ForceFunction, typename TorqueFunction>
+		void UpdateVelocityVerlet(T const& t, T const& dt,
+			ForceFunction const& force, TorqueFunction const& torque)
+		{
+			T const half = static_cast<T>(0.5);
+			T halfDT = half * dt;
+
+			Vector3<T> DPDT = force(t, mState);
+			Vector3<T> DLDT = torque(t, mState);
+			SetLinearMomentum(GetLinearMomentum() + halfDT * DPDT);
+			SetAngularMomentum(GetAngularMomentum() + halfDT * DLDT);
+
+			Quaternion<T> W = GetQAngularVelocity();
+			SetPosition(GetPosition() + dt * GetLinearVelocity());
+			SetQOrientation(GetQOrientation() + halfDT * W * GetQOrientation(), true);
+
+			DPDT = force(t + dt, mState);
+			DLDT = torque(t + dt, mState);
+			SetLinearMomentum(GetLinearMomentum() + halfDT * DPDT);
+			SetAngularMomentum(GetAngularMomentum() + halfDT * DLDT);
+		}
+
 	private:
 		RigidBodyState<T> mState;
 	};
@@ -0,0 +1,169 @@
+#include "RigidBodyStore.h"
+#include "SymmetricEigensolver3x3.h"
+
+template <typename Real>
+void RigidBodyStore<Real>::Resize(size_t numBodies)
+{
+	constants.assign(numBodies, Constants{});
+	state.assign(numBodies, State{});
+	for (auto& s : state)
+	{
+		s.qOrientation = Quaternion<Real>::Identity();
+	}
+}
+
+template <typename Real>
+size_t RigidBodyStore<Real>::Append()
+{
+	size_t const i = state.size();
+	constants.push_back(Constants{});
+	state.push_back(State{});
+	state[i].qOrientation = Quaternion<Real>::Identity();
+	return i;
+}
+
+template <typename Real>
+void RigidBodyStore<Real>::SwapRemove(size_t i)
+{
+	size_t const last = state.size() - 1;
+	if (i != last)
+	{
+		constants[i] = constants[last];
+		state[i] = state[last];
+	}
+	constants.pop_back();
+	state.pop_back();
+}
+
+template <typename Real>
+void RigidBodyStore<Real>::Initialize(size_t i, Real inMass,
+	Vector3<Real> const& principalInertia, Vector3<Real> const& inPosition,
+	Vector3<Real> const& inLinearVelocity, Quaternion<Real> const& inQOrientation,
+	Vector3<Real> const& inAngularVelocity)
+{
+	Real const zero = static_cast<Real>(0);
+	Real const one = static_cast<Real>(1);
+	Constants& c = constants[i];
+	State& s = state[i];
+
+	c = Constants{};
+	if (inMass > zero)
+	{
+		c.mass = inMass;
+		c.invMass = one / inMass;
+		c.inertia = principalInertia;
+		for (int32_t j = 0; j < 3; ++j)
+		{
+			c.invInertia[j] = one / principalInertia[j];
+		}
+	}
+
+	s = State{};
+	s.position = inPosition;
+	s.qOrientation = inQOrientation;
+	Normalize(s.qOrientation);
+	if (IsMovable(i))
+	{
+		s.linearVelocity = inLinearVelocity;
+		s.linearMomentum = c.mass * inLinearVelocity;
+		s.angularVelocity = inAngularVelocity;
+		s.angularMomentum = GetWorldInertia(i) * inAngularVelocity;
+	}
+}
+
+template <typename Real>
+void RigidBodyStore<Real>::SetLinearMomentum(size_t i,
+	Vector3<Real> const& inLinearMomentum)
+{
+	if (IsMovable(i))
+	{
+		state[i].linearMomentum = inLinearMomentum;
+		state[i].linearVelocity = constants[i].invMass * inLinearMomentum;
+	}
+}
+
+template <typename Real>
+void RigidBodyStore<Real>::SetAngularMomentum(size_t i,
+	Vector3<Real> const& inAngularMomentum)
+{
+	if (IsMovable(i))
+	{
+		state[i].angularMomentum = inAngularMomentum;
+		state[i].angularVelocity = GetAngularVelocity(constants[i],
+			state[i].qOrientation, inAngularMomentum);
+	}
+}
+
+template <typename Real>
+void RigidBodyStore<Real>::SetQOrientation(size_t i,
+	Quaternion<Real> const& inQOrientation)
+{
+	state[i].qOrientation = inQOrientation;
+	Normalize(state[i].qOrientation);
+	if (IsMovable(i))
+	{
+		state[i].angularVelocity = GetAngularVelocity(constants[i],
+			state[i].qOrientation, state[i].angularMomentum);
+	}
+}
+
+template <typename Real>
+Matrix3x3<Real> RigidBodyStore<Real>::GetWorldInertia(size_t i) const
+{
+	Matrix3x3<Real> rotate = GetROrientation(i);
+	Matrix3x3<Real> rotateD = rotate;
+	for (int32_t c = 0; c < 3; ++c)
+	{
+		rotateD.SetCol(c, constants[i].inertia[c] * rotate.GetCol(c));
+	}
+	return MultiplyABT(rotateD, rotate);
+}
+
+template <typename Real>
+Matrix3x3<Real> RigidBodyStore<Real>::GetWorldInverseInertia(size_t i) const
+{
+	Matrix3x3<Real> rotate = GetROrientation(i);
+	Matrix3x3<Real> rotateD = rotate;
+	for (int32_t c = 0; c < 3; ++c)
+	{
+		rotateD.SetCol(c, constants[i].invInertia[c] * rotate.GetCol(c));
+	}
+	return MultiplyABT(rotateD, rotate);
+}
+
+template <typename Real>
+Vector3<Real> RigidBodyStore<Real>::GetAngularVelocity(Constants const& bodyConstants,
+	Quaternion<Real> const& qOrientation, Vector3<Real> const& angularMomentum)
+{
+	Matrix3x3<Real> rotate = Rotation<3, Real>(qOrientation);
+	Vector3<Real> bodyL = angularMomentum * rotate;
+	for (int32_t j = 0; j < 3; ++j)
+	{
+		bodyL[j] *= bodyConstants.invInertia[j];
+	}
+	return rotate * bodyL;
+}
+
+template <typename Real>
+void RigidBodyStore<Real>::GetPrincipalFrame(Matrix3x3<Real> const& bodyInertia,
+	Vector3<Real>& principalInertia, Quaternion<Real>& qPrincipal)
+{
+	std::array<Real, 3> eval{};
+	std::array<std::array<Real, 3>, 3> evec{};
+	SymmetricEigensolver3x3<Real>{}(bodyInertia(0, 0), bodyInertia(0, 1),
+		bodyInertia(0, 2), bodyInertia(1, 1), bodyInertia(1, 2),
+		bodyInertia(2, 2), false, +1, eval, evec);
+
+	// The sorted eigenvectors are a right-handed orthonormal set, so the
+	// matrix with them as columns is a rotation.
+	Matrix3x3<Real> axes{};
+	for (int32_t c = 0; c < 3; ++c)
+	{
+		principalInertia[c] = eval[c];
+		axes.SetCol(c, Vector3<Real>{ evec[c][0], evec[c][1], evec[c][2] });
+	}
+	qPrincipal = Rotation<3, Real>(axes);
+}
+
+template class RigidBodyStore<float>;
+template class RigidBodyStore<double>;
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "Matrix3x3.h"
+#include "Rotation.h"
+#include <cstddef>
+#include <vector>
+using namespace Vector_GM;
+
+// Compact storage for many rigid bodies of arbitrary shape. A body is
+// referenced by its index (handle) 0 <= i < GetNumBodies(). A RigidBodyState
+// stores six 3x3 matrices, over 600 bytes per body for double. Here the
+// body frame is the principal frame of the inertia tensor, so the inertia
+// and its inverse are diagonals, the orientation is only the quaternion and
+// the rotation matrix and the world inertia tensors are computed on demand.
+// The quantities read and written by every integration step are in the
+// 'state' array (152 bytes per body for double) and the constants are in
+// the 'constants' array (64 bytes per body for double), so the integration
+// loops stream through both arrays linearly.
+//
+// Use GetPrincipalFrame to convert a general body inertia tensor to the
+// principal moments and the rotation from the principal frame to the model
+// frame; the principal orientation of a body is its model orientation times
+// that rotation.
+
+template <typename Real>
+class RigidBodyStore
+{
+public:
+	// Constant quantities during the simulation. The principal moments of
+	// inertia are the diagonal of the body inertia tensor. The mass and
+	// inertia are zero for immovable bodies.
+	struct Constants
+	{
+		Real mass;
+		Real invMass;
+		Vector3<Real> inertia;
+		Vector3<Real> invInertia;
+	};
+
+	// State variables in the differential equations of motion followed by
+	// the velocities derived from them.
+	struct State
+	{
+		Vector3<Real> position;
+		Quaternion<Real> qOrientation;
+		Vector3<Real> linearMomentum;
+		Vector3<Real> angularMomentum;
+		Vector3<Real> linearVelocity;
+		Vector3<Real> angularVelocity;
+	};
+
+	RigidBodyStore() = default;
+
+	// All bodies are set to zero values. Call Initialize(i,...) for each
+	// body before starting the simulation.
+	void Resize(size_t numBodies);
+
+	inline size_t GetNumBodies() const
+	{
+		return state.size();
+	}
+
+	// Append a body with zero values and return its index, which is the
+	// previous number of bodies. Call Initialize for it.
+	size_t Append();
+
+	// Remove body i by moving the last body into its slot, so the arrays
+	// stay contiguous. The index of the last body becomes i.
+	void SwapRemove(size_t i);
+
+	// Set the constant quantities and the initial state of body i. The
+	// principal moments must be positive for a movable body; a mass of
+	// zero makes the body immovable. The quaternion is normalized.
+	void Initialize(size_t i, Real inMass, Vector3<Real> const& principalInertia,
+		Vector3<Real> const& inPosition, Vector3<Real> const& inLinearVelocity,
+		Quaternion<Real> const& inQOrientation,
+		Vector3<Real> const& inAngularVelocity);
+
+	inline bool IsMovable(size_t i) const
+	{
+		return constants[i].mass > static_cast<Real>(0);
+	}
+
+	// These keep the derived velocities synchronized with the momenta and
+	// the orientation. The momenta have no effect on immovable bodies.
+	void SetLinearMomentum(size_t i, Vector3<Real> const& inLinearMomentum);
+	void SetAngularMomentum(size_t i, Vector3<Real> const& inAngularMomentum);
+	void SetQOrientation(size_t i, Quaternion<Real> const& inQOrientation);
+
+	// Derived quantities that are not stored.
+	inline Matrix3x3<Real> GetROrientation(size_t i) const
+	{
+		return Rotation<3, Real>(state[i].qOrientation);
+	}
+
+	Matrix3x3<Real> GetWorldInertia(size_t i) const;
+	Matrix3x3<Real> GetWorldInverseInertia(size_t i) const;
+
+	// The angular velocity R*J^{-1}*R^T*L for the principal inverse inertia
+	// J^{-1} and the rotation R of the unit-length quaternion.
+	static Vector3<Real> GetAngularVelocity(Constants const& bodyConstants,
+		Quaternion<Real> const& qOrientation, Vector3<Real> const& angularMomentum);
+
+	// Compute the principal moments of a symmetric body inertia tensor J,
+	// in increasing order, and the rotation Q whose columns are the
+	// principal axes, so that J = Q*D*Q^T for the diagonal matrix D of the
+	// moments.
+	static void GetPrincipalFrame(Matrix3x3<Real> const& bodyInertia,
+		Vector3<Real>& principalInertia, Quaternion<Real>& qPrincipal);
+
+	// The Runge-Kutta fourth-order solver of RigidBody<T>::Update applied to
+	// the movable bodies begin <= i < end. The force and torque callables
+	// have the signature
+	//   Vector3<Real> (Real time, Constants const&, State const&)
+	// and are passed the intermediate states of the solver. Disjoint ranges
+	// can be updated concurrently.
+	template <typename ForceFunction, typename TorqueFunction>
+	void Update(size_t begin, size_t end, Real t, Real dt,
+		ForceFunction const& force, TorqueFunction const& torque)
+	{
+		for (size_t i = begin; i < end; ++i)
+		{
+			if (IsMovable(i))
+			{
+				UpdateBody(constants[i], state[i], t, dt, force, torque);
+			}
+		}
+	}
+
+	template <typename ForceFunction, typename TorqueFunction>
+	inline void Update(Real t, Real dt, ForceFunction const& force,
+		TorqueFunction const& torque)
+	{
+		Update(0, GetNumBodies(), t, dt, force, torque);
+	}
+
+	std::vector<Constants> constants;
+	std::vector<State> state;
+
+private:
+	static inline Quaternion<Real> ToQuaternion(Vector3<Real> const& w)
+	{
+		return Quaternion<Real>(w[0], w[1], w[2], static_cast<Real>(0));
+	}
+
+	static void SetStage(Constants const& c, State const& s0, Real h,
+		Vector3<Real> const& dxdt, Quaternion<Real> const& dqdt,
+		Vector3<Real> const& dpdt, Vector3<Real> const& dldt, State& s1)
+	{
+		s1.position = s0.position + h * dxdt;
+		s1.qOrientation = s0.qOrientation + h * dqdt;
+		Normalize(s1.qOrientation);
+		s1.linearMomentum = s0.linearMomentum + h * dpdt;
+		s1.angularMomentum = s0.angularMomentum + h * dldt;
+		s1.linearVelocity = c.invMass * s1.linearMomentum;
+		s1.angularVelocity = GetAngularVelocity(c, s1.qOrientation, s1.angularMomentum);
+	}
+
+	template <typename ForceFunction, typename TorqueFunction>
+	static void UpdateBody(Constants const& c, State& s, Real t, Real dt,
+		ForceFunction const& force, TorqueFunction const& torque)
+	{
+		Real const half = static_cast<Real>(0.5);
+		Real const two = static_cast<Real>(2);
+		Real const six = static_cast<Real>(6);
+
+		Real halfDT = half * dt;
+		Real sixthDT = dt / six;
+		Real TpHalfDT = t + halfDT;
+		Real TpDT = t + dt;
+
+		State b{};
+
+		// A1 = G(T,S0), B1 = S0 + (DT/2)*A1
+		Vector3<Real> A1DXDT = s.linearVelocity;
+		Quaternion<Real> A1DQDT = half * ToQuaternion(s.angularVelocity) * s.qOrientation;
+		Vector3<Real> A1DPDT = force(t, c, s);
+		Vector3<Real> A1DLDT = torque(t, c, s);
+		SetStage(c, s, halfDT, A1DXDT, A1DQDT, A1DPDT, A1DLDT, b);
+
+		// A2 = G(T+DT/2,B1), B2 = S0 + (DT/2)*A2
+		Vector3<Real> A2DXDT = b.linearVelocity;
+		Quaternion<Real> A2DQDT = half * ToQuaternion(b.angularVelocity) * b.qOrientation;
+		Vector3<Real> A2DPDT = force(TpHalfDT, c, b);
+		Vector3<Real> A2DLDT = torque(TpHalfDT, c, b);
+		SetStage(c, s, halfDT, A2DXDT, A2DQDT, A2DPDT, A2DLDT, b);
+
+		// A3 = G(T+DT/2,B2), B3 = S0 + DT*A3
+		Vector3<Real> A3DXDT = b.linearVelocity;
+		Quaternion<Real> A3DQDT = half * ToQuaternion(b.angularVelocity) * b.qOrientation;
+		Vector3<Real> A3DPDT = force(TpHalfDT, c, b);
+		Vector3<Real> A3DLDT = torque(TpHalfDT, c, b);
+		SetStage(c, s, dt, A3DXDT, A3DQDT, A3DPDT, A3DLDT, b);
+
+		// A4 = G(T+DT,B3), S1 = S0 + (DT/6)*(A1+2*(A2+A3)+A4)
+		Vector3<Real> A4DXDT = b.linearVelocity;
+		Quaternion<Real> A4DQDT = half * ToQuaternion(b.angularVelocity) * b.qOrientation;
+		Vector3<Real> A4DPDT = force(TpDT, c, b);
+		Vector3<Real> A4DLDT = torque(TpDT, c, b);
+		SetStage(c, s, sixthDT,
+			A1DXDT + two * (A2DXDT + A3DXDT) + A4DXDT,
+			A1DQDT + two * (A2DQDT + A3DQDT) + A4DQDT,
+			A1DPDT + two * (A2DPDT + A3DPDT) + A4DPDT,
+			A1DLDT + two * (A2DLDT + A3DLDT) + A4DLDT, s);
+	}
+};
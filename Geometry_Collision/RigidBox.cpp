@@ -0,0 +1,40 @@
+#include "RigidBox.h"
+using namespace Vector_GM;
+
+template <typename Real>
+RigidBox<Real>::RigidBox(Vector3<Real> const& center,
+	Vector3<Real> const& extent, Real massDensity)
+	:
+	RigidBody<Real>{},
+	mWorldBox{}
+{
+	mWorldBox.extent = extent;
+	Real volume = static_cast<Real>(8) * extent[0] * extent[1] * extent[2];
+	Real mass = massDensity * volume;
+	Real const third = static_cast<Real>(1.0 / 3.0);
+	Real const sqrE0 = extent[0] * extent[0];
+	Real const sqrE1 = extent[1] * extent[1];
+	Real const sqrE2 = extent[2] * extent[2];
+	Matrix3x3<Real> bodyInertia = Matrix3x3<Real>::Zero();
+	bodyInertia(0, 0) = third * mass * (sqrE1 + sqrE2);
+	bodyInertia(1, 1) = third * mass * (sqrE0 + sqrE2);
+	bodyInertia(2, 2) = third * mass * (sqrE0 + sqrE1);
+	this->SetMass(mass);
+	this->SetBodyInertia(bodyInertia);
+	this->SetPosition(center);
+	UpdateWorldQuantities();
+}
+
+template <typename Real>
+void RigidBox<Real>::UpdateWorldQuantities()
+{
+	Matrix3x3<Real> const& rotate = this->GetROrientation();
+	mWorldBox.center = this->GetPosition();
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		mWorldBox.axis[k] = rotate.GetCol(k);
+	}
+}
+
+template class RigidBox<float>;
+template class RigidBox<double>;
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "RigidBody.h"
+#include "OrientedBox.h"
+using namespace Vector_GM;
+
+// An oriented box whose center is the position of the body and whose axes
+// are the columns of the rotation matrix. The body inertia is that of the
+// solid box, diagonal with the moments mass*(e1^2+e2^2)/3 for the pairs of
+// extents.
+
+template <typename Real>
+class RigidBox : public RigidBody<Real>
+{
+public:
+	RigidBox(Vector3<Real> const& center, Vector3<Real> const& extent,
+		Real massDensity);
+	virtual ~RigidBox() = default;
+
+	inline OrientedBox3<Real> const& GetWorldBox() const
+	{
+		return mWorldBox;
+	}
+
+	inline Vector3<Real> const& GetExtent() const
+	{
+		return mWorldBox.extent;
+	}
+
+	void UpdateWorldQuantities();
+
+private:
+	OrientedBox3<Real> mWorldBox;
+};
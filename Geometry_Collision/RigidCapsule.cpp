@@ -0,0 +1,50 @@
+#include "RigidCapsule.h"
+using namespace Vector_GM;
+
+template <typename Real>
+RigidCapsule<Real>::RigidCapsule(Vector3<Real> const& center, Real radius,
+	Real halfLength, Real massDensity)
+	:
+	RigidBody<Real>{},
+	mRadius(radius),
+	mHalfLength(halfLength),
+	mWorldSegment{}
+{
+	Real rSquared = radius * radius;
+	Real volume = static_cast<Real>(GTE_C_PI) * rSquared *
+		(static_cast<Real>(2) * halfLength + static_cast<Real>(4.0 / 3.0) * radius);
+	Real mass = massDensity * volume;
+
+	// The cylinder has mass mc and the caps have mass mh each. The center
+	// of mass of a cap is at distance 3*r/8 from its base, so by the
+	// parallel axis theorem the moment of a cap about a diameter through
+	// the center of the capsule is mh*(2*r^2/5 + h^2 + 3*h*r/4).
+	Real const h = halfLength;
+	Real const mc = massDensity * static_cast<Real>(GTE_C_PI) * rSquared *
+		static_cast<Real>(2) * h;
+	Real const mh = massDensity * static_cast<Real>(2.0 * GTE_C_PI / 3.0) *
+		rSquared * radius;
+	Real const capAxial = static_cast<Real>(0.4) * rSquared;
+	Real const capDiameter = capAxial + h * h + static_cast<Real>(0.75) * h * radius;
+	Matrix3x3<Real> bodyInertia = Matrix3x3<Real>::Zero();
+	bodyInertia(0, 0) = mc * (static_cast<Real>(0.25) * rSquared +
+		h * h / static_cast<Real>(3)) + static_cast<Real>(2) * mh * capDiameter;
+	bodyInertia(1, 1) = bodyInertia(0, 0);
+	bodyInertia(2, 2) = mc * static_cast<Real>(0.5) * rSquared +
+		static_cast<Real>(2) * mh * capAxial;
+	this->SetMass(mass);
+	this->SetBodyInertia(bodyInertia);
+	this->SetPosition(center);
+	UpdateWorldQuantities();
+}
+
+template <typename Real>
+void RigidCapsule<Real>::UpdateWorldQuantities()
+{
+	Vector3<Real> offset = mHalfLength * this->GetROrientation().GetCol(2);
+	mWorldSegment[0] = this->GetPosition() - offset;
+	mWorldSegment[1] = this->GetPosition() + offset;
+}
+
+template class RigidCapsule<float>;
+template class RigidCapsule<double>;
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "RigidBody.h"
+#include <array>
+using namespace Vector_GM;
+
+// A capsule is the set of points within distance 'radius' of a segment. In
+// body coordinates the segment is centered at the origin with endpoints
+// (0,0,-halfLength) and (0,0,+halfLength), so the world segment is
+// position -/+ halfLength times the third column of the rotation matrix.
+// The body inertia is that of the solid cylinder plus the two solid
+// hemispherical caps, diagonal with the segment as the third axis.
+
+template <typename Real>
+class RigidCapsule : public RigidBody<Real>
+{
+public:
+	RigidCapsule(Vector3<Real> const& center, Real radius, Real halfLength,
+		Real massDensity);
+	virtual ~RigidCapsule() = default;
+
+	inline Real GetRadius() const
+	{
+		return mRadius;
+	}
+
+	inline Real GetHalfLength() const
+	{
+		return mHalfLength;
+	}
+
+	// The endpoints of the world segment, updated by UpdateWorldQuantities.
+	inline std::array<Vector3<Real>, 2> const& GetWorldSegment() const
+	{
+		return mWorldSegment;
+	}
+
+	void UpdateWorldQuantities();
+
+private:
+	Real mRadius, mHalfLength;
+	std::array<Vector3<Real>, 2> mWorldSegment;
+};
@@ -0,0 +1,165 @@
+#include "RigidDistanceField.h"
+#include "FastMarch3.h"
+#include "TetrahedraRasterizer.h"
+#include <algorithm>
+#include <cmath>
+
+template <typename Real>
+RigidDistanceField<Real>::RigidDistanceField(int32_t xBound, int32_t yBound,
+	int32_t zBound, Vector3<Real> const& origin, Real spacing,
+	std::vector<Real> const& distances)
+	:
+	RigidBody<Real>{},
+	mBound{ xBound, yBound, zBound },
+	mOrigin(origin),
+	mMax(origin),
+	mSpacing(spacing),
+	mDistances(distances),
+	mInterpolator(xBound, yBound, zBound, origin[0], spacing, origin[1], spacing,
+		origin[2], spacing, mDistances.data())
+{
+	LogAssert(mDistances.size() == static_cast<size_t>(xBound) * static_cast<size_t>(yBound) *
+		static_cast<size_t>(zBound), "Invalid number of distances.");
+
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		mMax[d] += spacing * static_cast<Real>(mBound[d] - 1);
+	}
+
+	this->SetMass(static_cast<Real>(0));
+	this->SetBodyInertia(Matrix3x3<Real>::Zero());
+	this->SetPosition(mOrigin);
+}
+
+template <typename Real>
+std::shared_ptr<RigidDistanceField<Real>> RigidDistanceField<Real>::CreateFromTetrahedra(
+	std::vector<std::array<Real, 3>> const& vertices,
+	std::vector<std::array<size_t, 4>> const& tetrahedra, Real spacing, Real margin,
+	size_t numThreads)
+{
+	LogAssert(vertices.size() > 0 && tetrahedra.size() > 0 && spacing > static_cast<Real>(0)
+		&& margin >= static_cast<Real>(0), "Invalid input.");
+
+	// The grid has an extra layer of points on each side. The front of
+	// FastMarch3 does not enter the points on the faces of the grid, so the
+	// extra layer keeps them outside the solid.
+	std::array<Real, 3> vmin = vertices[0], vmax = vertices[0];
+	for (auto const& vertex : vertices)
+	{
+		for (size_t d = 0; d < 3; ++d)
+		{
+			vmin[d] = std::min(vmin[d], vertex[d]);
+			vmax[d] = std::max(vmax[d], vertex[d]);
+		}
+	}
+
+	std::array<size_t, 3> bound{};
+	std::array<Real, 3> regionMin{}, regionMax{};
+	for (size_t d = 0; d < 3; ++d)
+	{
+		Real const extent = vmax[d] - vmin[d] + static_cast<Real>(2) * margin;
+		bound[d] = static_cast<size_t>(std::ceil(extent / spacing)) + 3;
+		regionMin[d] = vmin[d] - margin - spacing;
+		regionMax[d] = regionMin[d] + spacing * static_cast<Real>(bound[d] - 1);
+	}
+
+	std::vector<int32_t> grid{};
+	gte::TetrahedraRasterizer<Real> rasterizer(vertices.size(), vertices.data(),
+		tetrahedra.size(), tetrahedra.data());
+	rasterizer(numThreads, regionMin, regionMax, bound, grid);
+
+	// The seeds are the interior grid points with a 6-neighbor on the other
+	// side of the boundary.
+	size_t const xBound = bound[0], xyBound = bound[0] * bound[1];
+	std::vector<size_t> seeds{};
+	for (size_t z = 1; z + 1 < bound[2]; ++z)
+	{
+		for (size_t y = 1; y + 1 < bound[1]; ++y)
+		{
+			for (size_t x = 1; x + 1 < bound[0]; ++x)
+			{
+				size_t const i = x + xBound * y + xyBound * z;
+				bool const inside = (grid[i] >= 0);
+				if (inside != (grid[i - 1] >= 0) || inside != (grid[i + 1] >= 0)
+					|| inside != (grid[i - xBound] >= 0) || inside != (grid[i + xBound] >= 0)
+					|| inside != (grid[i - xyBound] >= 0) || inside != (grid[i + xyBound] >= 0))
+				{
+					seeds.push_back(i);
+				}
+			}
+		}
+	}
+	LogAssert(seeds.size() > 0, "The tetrahedra contain no grid points.");
+
+	gte::FastMarch3<Real> march(bound[0], bound[1], bound[2], spacing, spacing,
+		spacing, seeds, static_cast<Real>(1));
+	march.March();
+
+	// The crossing times are in units of grid cells. The boundary is
+	// between a seed and its neighbors on the other side, about half a
+	// cell from the seed. The points on the faces of the grid are outside,
+	// and their distances are extrapolated from the nearest interior point.
+	Real const half = static_cast<Real>(0.5);
+	std::vector<Real> distances(grid.size());
+	for (size_t z = 0; z < bound[2]; ++z)
+	{
+		size_t const zc = std::min(std::max(z, static_cast<size_t>(1)), bound[2] - 2);
+		for (size_t y = 0; y < bound[1]; ++y)
+		{
+			size_t const yc = std::min(std::max(y, static_cast<size_t>(1)), bound[1] - 2);
+			for (size_t x = 0; x < bound[0]; ++x)
+			{
+				size_t const xc = std::min(std::max(x, static_cast<size_t>(1)), bound[0] - 2);
+				size_t const i = x + xBound * y + xyBound * z;
+				size_t const ic = xc + xBound * yc + xyBound * zc;
+				Real const distance = spacing * (march.GetTime(ic) + half);
+				if (i == ic)
+				{
+					distances[i] = (grid[i] >= 0 ? -distance : distance);
+				}
+				else
+				{
+					Real const dx = static_cast<Real>(x != xc);
+					Real const dy = static_cast<Real>(y != yc);
+					Real const dz = static_cast<Real>(z != zc);
+					distances[i] = distance + spacing * std::sqrt(dx + dy + dz);
+				}
+			}
+		}
+	}
+
+	Vector3<Real> const origin{ regionMin[0], regionMin[1], regionMin[2] };
+	return std::make_shared<RigidDistanceField<Real>>(static_cast<int32_t>(bound[0]),
+		static_cast<int32_t>(bound[1]), static_cast<int32_t>(bound[2]), origin, spacing,
+		distances);
+}
+
+template <typename Real>
+void RigidDistanceField<Real>::Evaluate(size_t numQueries, Real const* X,
+	Real const* Y, Real const* Z, Real* distances, Real* gradX, Real* gradY,
+	Real* gradZ) const
+{
+	mInterpolator.Evaluate(numQueries, X, Y, Z, distances, gradX, gradY, gradZ);
+}
+
+template <typename Real>
+Real RigidDistanceField<Real>::GetSignedDistance(Vector3<Real> const& point) const
+{
+	return mInterpolator(point[0], point[1], point[2]);
+}
+
+template <typename Real>
+Vector3<Real> RigidDistanceField<Real>::GetNormal(Vector3<Real> const& point) const
+{
+	Vector3<Real> normal
+	{
+		mInterpolator(1, 0, 0, point[0], point[1], point[2]),
+		mInterpolator(0, 1, 0, point[0], point[1], point[2]),
+		mInterpolator(0, 0, 1, point[0], point[1], point[2])
+	};
+	Normalize(normal);
+	return normal;
+}
+
+template class RigidDistanceField<float>;
+template class RigidDistanceField<double>;
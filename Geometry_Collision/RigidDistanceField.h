@@ -0,0 +1,109 @@
+#pragma once
+
+#include "RigidBody.h"
+#include "IntpTrilinear3.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+using namespace Vector_GM;
+
+// An immovable collider whose surface is the zero level set of a signed
+// distance field sampled on a regular grid. The distances are negative
+// inside the solid and positive outside. The field is sampled with
+// trilinear interpolation, and the normal of the surface is the
+// normalized gradient, so a sphere is tested against the whole collider
+// with one sample regardless of the number of triangles of its mesh. The
+// samples have cell size h in each dimension and the grid point (x,y,z)
+// is at origin + h*(x,y,z) for 0 <= x < xBound and similarly for y and z.
+// The distances are only meaningful inside the grid, so the grid must
+// contain the solid enlarged by the largest radius of the spheres that
+// can touch it; spheres whose centers are outside the grid are not
+// tested.
+
+template <typename Real>
+class RigidDistanceField : public RigidBody<Real>
+{
+public:
+	// The distances are stored with x varying fastest, distances[x +
+	// xBound * (y + yBound * z)], and the bounds must be at least 2.
+	RigidDistanceField(int32_t xBound, int32_t yBound, int32_t zBound,
+		Vector3<Real> const& origin, Real spacing, std::vector<Real> const& distances);
+
+	virtual ~RigidDistanceField() = default;
+
+	// The interpolator refers to the distances of the object, so a copy
+	// would refer to those of the original.
+	RigidDistanceField(RigidDistanceField const&) = delete;
+	RigidDistanceField& operator=(RigidDistanceField const&) = delete;
+
+	// Create the field of a solid represented by a tetrahedral mesh, using
+	// the vertex and tetrahedron conventions of TetrahedraRasterizer. The
+	// grid covers the bounding box of the vertices enlarged by margin on
+	// each side. The grid points are classified as inside or outside by
+	// the rasterizer, the points on either side of the boundary are the
+	// seeds of FastMarch3, and the distances to the seeds, which are the
+	// crossing times of the front scaled by h, are offset by h/2 and signed
+	// by the classification. The marching is first-order accurate, so the
+	// error of the distances is a cell or two, largest in the directions
+	// diagonal to the grid. Set numThreads to 0 to rasterize in the
+	// calling thread and to 1 or more to rasterize as tasks of
+	// TaskScheduler::GetDefault().
+	static std::shared_ptr<RigidDistanceField<Real>> CreateFromTetrahedra(
+		std::vector<std::array<Real, 3>> const& vertices,
+		std::vector<std::array<size_t, 4>> const& tetrahedra,
+		Real spacing, Real margin, size_t numThreads = 0);
+
+	inline std::array<int32_t, 3> const& GetBound() const
+	{
+		return mBound;
+	}
+
+	inline Vector3<Real> const& GetOrigin() const
+	{
+		return mOrigin;
+	}
+
+	inline Real GetSpacing() const
+	{
+		return mSpacing;
+	}
+
+	inline std::vector<Real> const& GetDistances() const
+	{
+		return mDistances;
+	}
+
+	// The corners of the grid. The field is defined for the points of the
+	// box [min,max].
+	inline Vector3<Real> const& GetMin() const
+	{
+		return mOrigin;
+	}
+
+	inline Vector3<Real> const& GetMax() const
+	{
+		return mMax;
+	}
+
+	// Evaluate the distances and, when gradX, gradY and gradZ are not
+	// null, the gradients at numQueries points whose coordinates are
+	// stored in separate arrays. Spatially coherent points share the
+	// samples of their cells. The points must be in the box [min,max].
+	void Evaluate(size_t numQueries, Real const* X, Real const* Y, Real const* Z,
+		Real* distances, Real* gradX = nullptr, Real* gradY = nullptr,
+		Real* gradZ = nullptr) const;
+
+	// The signed distance and the unit-length outer normal at a point in
+	// the box [min,max]. The normal is zero where the gradient vanishes.
+	Real GetSignedDistance(Vector3<Real> const& point) const;
+	Vector3<Real> GetNormal(Vector3<Real> const& point) const;
+
+private:
+	std::array<int32_t, 3> mBound;
+	Vector3<Real> mOrigin, mMax;
+	Real mSpacing;
+	std::vector<Real> mDistances;
+	gte::IntpTrilinear3<Real> mInterpolator;
+};
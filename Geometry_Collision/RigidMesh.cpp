@@ -0,0 +1,436 @@
+#include "RigidMesh.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+template <typename Real>
+RigidMesh<Real>::RigidMesh(std::vector<std::array<Real, 3>> const& vertices,
+	std::vector<std::array<int32_t, 3>> const& triangles, size_t maxTrisPerLeaf)
+	:
+	RigidBody<Real>{},
+	mNodes{},
+	mTriangles(triangles.size()),
+	mMin(Vector3<Real>::Zero()),
+	mMax(Vector3<Real>::Zero())
+{
+	LogAssert(vertices.size() > 0 && triangles.size() > 0 &&
+		triangles.size() <= static_cast<size_t>(std::numeric_limits<int32_t>::max()),
+		"Invalid mesh.");
+	LogAssert(maxTrisPerLeaf > 0 && maxTrisPerLeaf <= maxLeafSize,
+		"Invalid number of triangles per leaf.");
+
+	Real const zero = static_cast<Real>(0), one = static_cast<Real>(1);
+	Real const oneThird = one / static_cast<Real>(3);
+	std::vector<Vector3<Real>> centroids(triangles.size());
+	for (size_t t = 0; t < triangles.size(); ++t)
+	{
+		Vector3<Real> centroid = Vector3<Real>::Zero();
+		for (size_t j = 0; j < 3; ++j)
+		{
+			int32_t const v = triangles[t][j];
+			LogAssert(0 <= v && static_cast<size_t>(v) < vertices.size(), "Invalid index.");
+			for (size_t d = 0; d < 3; ++d)
+			{
+				centroid[d] += vertices[v][d];
+			}
+		}
+		centroids[t] = oneThird * centroid;
+	}
+
+	std::iota(mTriangles.begin(), mTriangles.end(), 0);
+	mNodes.reserve(2 * triangles.size() / maxTrisPerLeaf + 1);
+	BuildNode(centroids, vertices, triangles, 0, static_cast<uint32_t>(triangles.size()),
+		maxTrisPerLeaf);
+	for (size_t d = 0; d < 3; ++d)
+	{
+		mMin[d] = mNodes[0].min[d];
+		mMax[d] = mNodes[0].max[d];
+	}
+
+	size_t const numTriangles = mTriangles.size();
+	for (auto* component : { &mV0X, &mV0Y, &mV0Z, &mE1X, &mE1Y, &mE1Z, &mE2X, &mE2Y,
+		&mE2Z, &mNX, &mNY, &mNZ, &mA, &mB, &mC, &mInvDet, &mInvA, &mInvC, &mInvE })
+	{
+		component->resize(numTriangles);
+	}
+
+	for (size_t t = 0; t < numTriangles; ++t)
+	{
+		auto const& triangle = triangles[mTriangles[t]];
+		auto const& v0 = vertices[triangle[0]];
+		auto const& v1 = vertices[triangle[1]];
+		auto const& v2 = vertices[triangle[2]];
+		Vector3<Real> const E1{ v1[0] - v0[0], v1[1] - v0[1], v1[2] - v0[2] };
+		Vector3<Real> const E2{ v2[0] - v0[0], v2[1] - v0[1], v2[2] - v0[2] };
+		Vector3<Real> N = Cross(E1, E2);
+		Normalize(N);
+		Real const a = Dot(E1, E1), b = Dot(E1, E2), c = Dot(E2, E2);
+		Real const det = a * c - b * b;
+		Real const e = a - static_cast<Real>(2) * b + c;
+
+		mV0X[t] = v0[0];
+		mV0Y[t] = v0[1];
+		mV0Z[t] = v0[2];
+		mE1X[t] = E1[0];
+		mE1Y[t] = E1[1];
+		mE1Z[t] = E1[2];
+		mE2X[t] = E2[0];
+		mE2Y[t] = E2[1];
+		mE2Z[t] = E2[2];
+		mNX[t] = N[0];
+		mNY[t] = N[1];
+		mNZ[t] = N[2];
+		mA[t] = a;
+		mB[t] = b;
+		mC[t] = c;
+		mInvDet[t] = (det > zero ? one / det : zero);
+		mInvA[t] = (a > zero ? one / a : zero);
+		mInvC[t] = (c > zero ? one / c : zero);
+		mInvE[t] = (e > zero ? one / e : zero);
+	}
+
+	this->SetMass(zero);
+	this->SetBodyInertia(Matrix3x3<Real>::Zero());
+	this->SetPosition(mMin);
+}
+
+template <typename Real>
+void RigidMesh<Real>::BuildNode(std::vector<Vector3<Real>> const& centroids,
+	std::vector<std::array<Real, 3>> const& vertices,
+	std::vector<std::array<int32_t, 3>> const& triangles,
+	uint32_t first, uint32_t count, size_t maxTrisPerLeaf)
+{
+	size_t const nodeIndex = mNodes.size();
+	mNodes.emplace_back();
+
+	Real const maxReal = std::numeric_limits<Real>::max();
+	Node node{};
+	node.min = { maxReal, maxReal, maxReal };
+	node.max = { -maxReal, -maxReal, -maxReal };
+	node.rightChild = 0;
+	node.firstTriangle = first;
+	node.numTriangles = count;
+	std::array<Real, 3> cmin = node.min, cmax = node.max;
+	for (uint32_t t = first; t < first + count; ++t)
+	{
+		int32_t const triangle = mTriangles[t];
+		for (size_t j = 0; j < 3; ++j)
+		{
+			auto const& vertex = vertices[triangles[triangle][j]];
+			for (size_t d = 0; d < 3; ++d)
+			{
+				node.min[d] = std::min(node.min[d], vertex[d]);
+				node.max[d] = std::max(node.max[d], vertex[d]);
+			}
+		}
+		for (size_t d = 0; d < 3; ++d)
+		{
+			cmin[d] = std::min(cmin[d], centroids[triangle][d]);
+			cmax[d] = std::max(cmax[d], centroids[triangle][d]);
+		}
+	}
+
+	if (count <= maxTrisPerLeaf)
+	{
+		mNodes[nodeIndex] = node;
+		return;
+	}
+
+	// Split at the median of the centroids along the axis of largest
+	// centroid extent, which leads to a balanced tree.
+	size_t axis = 0;
+	for (size_t d = 1; d < 3; ++d)
+	{
+		if (cmax[d] - cmin[d] > cmax[axis] - cmin[axis])
+		{
+			axis = d;
+		}
+	}
+
+	uint32_t const mid = first + count / 2;
+	std::nth_element(mTriangles.begin() + first, mTriangles.begin() + mid,
+		mTriangles.begin() + first + count,
+		[&centroids, axis](int32_t t0, int32_t t1)
+		{
+			return centroids[t0][axis] < centroids[t1][axis];
+		});
+
+	BuildNode(centroids, vertices, triangles, first, mid - first, maxTrisPerLeaf);
+	node.rightChild = static_cast<uint32_t>(mNodes.size());
+	BuildNode(centroids, vertices, triangles, mid, first + count - mid, maxTrisPerLeaf);
+	mNodes[nodeIndex] = node;
+}
+
+template <typename Real>
+void RigidMesh<Real>::GetLeaves(Vector3<Real> const& center, Real radius,
+	std::vector<Range>& ranges) const
+{
+	// The depth of the tree is at most log2 of the number of triangles
+	// plus 1, so the stack cannot overflow.
+	Real const zero = static_cast<Real>(0);
+	Real const sqrRadius = radius * radius;
+	std::array<uint32_t, 64> stack{};
+	size_t top = 0;
+	stack[top++] = 0;
+	ranges.clear();
+	while (top > 0)
+	{
+		Node const& node = mNodes[stack[--top]];
+		Real sqrDistance = zero;
+		for (size_t d = 0; d < 3; ++d)
+		{
+			Real const outside = std::max(std::max(node.min[d] - center[d],
+				center[d] - node.max[d]), zero);
+			sqrDistance += outside * outside;
+		}
+		if (sqrDistance > sqrRadius)
+		{
+			continue;
+		}
+
+		if (node.rightChild == 0)
+		{
+			ranges.emplace_back(node.firstTriangle, node.numTriangles);
+		}
+		else
+		{
+			stack[top++] = node.rightChild;
+			stack[top++] = static_cast<uint32_t>(&node - mNodes.data()) + 1;
+		}
+	}
+}
+
+template <typename Real>
+void RigidMesh<Real>::GetLeaves(Vector3<Real> const& vmin, Vector3<Real> const& vmax,
+	std::vector<Range>& ranges) const
+{
+	std::array<uint32_t, 64> stack{};
+	size_t top = 0;
+	stack[top++] = 0;
+	ranges.clear();
+	while (top > 0)
+	{
+		Node const& node = mNodes[stack[--top]];
+		if (node.min[0] > vmax[0] || node.max[0] < vmin[0]
+			|| node.min[1] > vmax[1] || node.max[1] < vmin[1]
+			|| node.min[2] > vmax[2] || node.max[2] < vmin[2])
+		{
+			continue;
+		}
+
+		if (node.rightChild == 0)
+		{
+			ranges.emplace_back(node.firstTriangle, node.numTriangles);
+		}
+		else
+		{
+			stack[top++] = node.rightChild;
+			stack[top++] = static_cast<uint32_t>(&node - mNodes.data()) + 1;
+		}
+	}
+}
+
+template <typename Real>
+void RigidMesh<Real>::GetSqrDistances(Vector3<Real> const& point, uint32_t first,
+	uint32_t count, Real* sqrDistance) const
+{
+	// The squared distances to the interior of the triangle and to its
+	// three edges are computed for every triangle and the result is
+	// selected, so the loop has no branches. The closest point is interior
+	// when the barycentric coordinates of the projection of the point onto
+	// the plane are nonnegative; otherwise it is on one of the edges, and
+	// the distance is the smallest of the edge distances.
+	Real const zero = static_cast<Real>(0), one = static_cast<Real>(1);
+	Real const px = point[0], py = point[1], pz = point[2];
+	Real const* V0X = mV0X.data() + first;
+	Real const* V0Y = mV0Y.data() + first;
+	Real const* V0Z = mV0Z.data() + first;
+	Real const* E1X = mE1X.data() + first;
+	Real const* E1Y = mE1Y.data() + first;
+	Real const* E1Z = mE1Z.data() + first;
+	Real const* E2X = mE2X.data() + first;
+	Real const* E2Y = mE2Y.data() + first;
+	Real const* E2Z = mE2Z.data() + first;
+	Real const* NX = mNX.data() + first;
+	Real const* NY = mNY.data() + first;
+	Real const* NZ = mNZ.data() + first;
+	Real const* A = mA.data() + first;
+	Real const* B = mB.data() + first;
+	Real const* C = mC.data() + first;
+	Real const* invDet = mInvDet.data() + first;
+	Real const* invA = mInvA.data() + first;
+	Real const* invC = mInvC.data() + first;
+	Real const* invE = mInvE.data() + first;
+	for (uint32_t k = 0; k < count; ++k)
+	{
+		Real const dx = px - V0X[k], dy = py - V0Y[k], dz = pz - V0Z[k];
+		Real const dE1 = dx * E1X[k] + dy * E1Y[k] + dz * E1Z[k];
+		Real const dE2 = dx * E2X[k] + dy * E2Y[k] + dz * E2Z[k];
+
+		Real const u = (C[k] * dE1 - B[k] * dE2) * invDet[k];
+		Real const v = (A[k] * dE2 - B[k] * dE1) * invDet[k];
+		Real const dN = dx * NX[k] + dy * NY[k] + dz * NZ[k];
+		bool const inside = (u >= zero) & (v >= zero) & (u + v <= one) & (invDet[k] > zero);
+
+		Real const t0 = std::min(std::max(dE1 * invA[k], zero), one);
+		Real const q0x = dx - t0 * E1X[k], q0y = dy - t0 * E1Y[k], q0z = dz - t0 * E1Z[k];
+		Real const s0 = q0x * q0x + q0y * q0y + q0z * q0z;
+
+		Real const t1 = std::min(std::max(dE2 * invC[k], zero), one);
+		Real const q1x = dx - t1 * E2X[k], q1y = dy - t1 * E2Y[k], q1z = dz - t1 * E2Z[k];
+		Real const s1 = q1x * q1x + q1y * q1y + q1z * q1z;
+
+		// The edge from V1 to V2 is E3 = E2 - E1 and the point relative
+		// to V1 is D - E1.
+		Real const e3x = E2X[k] - E1X[k], e3y = E2Y[k] - E1Y[k], e3z = E2Z[k] - E1Z[k];
+		Real const d1x = dx - E1X[k], d1y = dy - E1Y[k], d1z = dz - E1Z[k];
+		Real const t2 = std::min(std::max((d1x * e3x + d1y * e3y + d1z * e3z) * invE[k], zero), one);
+		Real const q2x = d1x - t2 * e3x, q2y = d1y - t2 * e3y, q2z = d1z - t2 * e3z;
+		Real const s2 = q2x * q2x + q2y * q2y + q2z * q2z;
+
+		sqrDistance[k] = (inside ? dN * dN : std::min(s0, std::min(s1, s2)));
+	}
+}
+
+template <typename Real>
+Vector3<Real> RigidMesh<Real>::GetClosestPoint(Vector3<Real> const& point, size_t t) const
+{
+	// The scalar version of the selection of GetSqrDistances.
+	Real const zero = static_cast<Real>(0), one = static_cast<Real>(1);
+	Vector3<Real> const V0{ mV0X[t], mV0Y[t], mV0Z[t] };
+	Vector3<Real> const E1{ mE1X[t], mE1Y[t], mE1Z[t] };
+	Vector3<Real> const E2{ mE2X[t], mE2Y[t], mE2Z[t] };
+	Vector3<Real> const N{ mNX[t], mNY[t], mNZ[t] };
+	Vector3<Real> const D = point - V0;
+	Real const dE1 = Dot(D, E1), dE2 = Dot(D, E2);
+	Real const u = (mC[t] * dE1 - mB[t] * dE2) * mInvDet[t];
+	Real const v = (mA[t] * dE2 - mB[t] * dE1) * mInvDet[t];
+	if (u >= zero && v >= zero && u + v <= one && mInvDet[t] > zero)
+	{
+		return point - Dot(D, N) * N;
+	}
+
+	Real const t0 = std::min(std::max(dE1 * mInvA[t], zero), one);
+	Vector3<Real> const Q0 = V0 + t0 * E1;
+	Real const t1 = std::min(std::max(dE2 * mInvC[t], zero), one);
+	Vector3<Real> const Q1 = V0 + t1 * E2;
+	Vector3<Real> const E3 = E2 - E1;
+	Real const t2 = std::min(std::max(Dot(D - E1, E3) * mInvE[t], zero), one);
+	Vector3<Real> const Q2 = V0 + E1 + t2 * E3;
+
+	Vector3<Real> closest = Q0;
+	Real sqrDistance = Dot(point - Q0, point - Q0);
+	Real const s1 = Dot(point - Q1, point - Q1);
+	if (s1 < sqrDistance)
+	{
+		closest = Q1;
+		sqrDistance = s1;
+	}
+	if (Dot(point - Q2, point - Q2) < sqrDistance)
+	{
+		closest = Q2;
+	}
+	return closest;
+}
+
+template <typename Real>
+Real RigidMesh<Real>::GetClosestPoint(Vector3<Real> const& point,
+	std::vector<Range> const& ranges, Vector3<Real>& closest, size_t& triangle) const
+{
+	Real const maxReal = std::numeric_limits<Real>::max();
+	std::array<Real, maxLeafSize> sqrDistance{};
+	Real minSqrDistance = maxReal;
+	size_t minTriangle = 0;
+	for (auto const& range : ranges)
+	{
+		GetSqrDistances(point, range.first, range.second, sqrDistance.data());
+		for (uint32_t k = 0; k < range.second; ++k)
+		{
+			if (sqrDistance[k] < minSqrDistance)
+			{
+				minSqrDistance = sqrDistance[k];
+				minTriangle = range.first + k;
+			}
+		}
+	}
+
+	if (minSqrDistance == maxReal)
+	{
+		return maxReal;
+	}
+
+	closest = GetClosestPoint(point, minTriangle);
+	triangle = minTriangle;
+	return std::sqrt(minSqrDistance);
+}
+
+template <typename Real>
+bool RigidMesh<Real>::FindFirstContact(Vector3<Real> const& center, Real radius,
+	Vector3<Real> const& velocity, Real tmax, Real tolerance, Real& contactTime,
+	Vector3<Real>& normal, size_t maxIterations) const
+{
+	// The triangles that the sphere can reach are those in the box of the
+	// swept sphere. They are gathered once for all the steps.
+	Real const zero = static_cast<Real>(0);
+	Real const maxReal = std::numeric_limits<Real>::max();
+	Vector3<Real> const end = center + tmax * velocity;
+	Vector3<Real> vmin{}, vmax{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		vmin[d] = std::min(center[d], end[d]) - radius - tolerance;
+		vmax[d] = std::max(center[d], end[d]) + radius + tolerance;
+	}
+	std::vector<Range> ranges{};
+	GetLeaves(vmin, vmax, ranges);
+	if (ranges.empty())
+	{
+		return false;
+	}
+
+	// The sphere cannot touch the mesh before it has moved the distance
+	// from the mesh minus the radius, so each step is safe.
+	Real const speed = Length(velocity);
+	Real t = zero;
+	for (size_t iteration = 0; iteration < maxIterations; ++iteration)
+	{
+		Vector3<Real> const point = center + t * velocity;
+		Vector3<Real> closest{};
+		size_t triangle = 0;
+		Real const distance = GetClosestPoint(point, ranges, closest, triangle);
+		if (distance == maxReal)
+		{
+			return false;
+		}
+
+		if (distance <= radius + tolerance)
+		{
+			contactTime = t;
+			normal = point - closest;
+			if (Normalize(normal) == zero)
+			{
+				normal = GetNormal(triangle);
+				if (Dot(normal, velocity) > zero)
+				{
+					normal = -normal;
+				}
+			}
+			return true;
+		}
+
+		if (speed == zero)
+		{
+			return false;
+		}
+
+		t += (distance - radius) / speed;
+		if (t > tmax)
+		{
+			return false;
+		}
+	}
+	return false;
+}
+
+template class RigidMesh<float>;
+template class RigidMesh<double>;
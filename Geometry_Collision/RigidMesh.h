@@ -0,0 +1,141 @@
+#pragma once
+
+#include "RigidBody.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+using namespace Vector_GM;
+
+// An immovable collider whose surface is a triangle mesh, for example the
+// geometry of a level. The triangles are stored in a bounding volume
+// hierarchy of axis-aligned boxes that is built once by the constructor.
+// The tree has the layout of BoundTree: an array of nodes in depth-first
+// order, the left child of interior node i is node i+1 and the right child
+// is stored in the node, and the triangles of a subtree are contiguous. The
+// triangles are stored in that order as separate arrays of coordinates, so
+// the triangles of the leaves near a sphere are tested against it in
+// batched loops without branches. A query visits the nodes whose boxes are
+// within the radius of the sphere, so its cost is logarithmic in the number
+// of triangles for spheres that are small compared to the mesh.
+//
+// The triangles are two-sided and the collider has no inside, so a sphere
+// whose center has crossed a triangle is pushed out on the other side.
+
+template <typename Real>
+class RigidMesh : public RigidBody<Real>
+{
+public:
+	// The triangles index the vertices. A leaf of the tree has at most
+	// maxTrisPerLeaf triangles.
+	RigidMesh(std::vector<std::array<Real, 3>> const& vertices,
+		std::vector<std::array<int32_t, 3>> const& triangles,
+		size_t maxTrisPerLeaf = 8);
+
+	virtual ~RigidMesh() = default;
+
+	// A range [first,first+count) of triangles in tree order.
+	typedef std::pair<uint32_t, uint32_t> Range;
+
+	struct Node
+	{
+		std::array<Real, 3> min, max;
+		uint32_t rightChild;
+		uint32_t firstTriangle;
+		uint32_t numTriangles;
+	};
+
+	inline size_t GetNumTriangles() const
+	{
+		return mTriangles.size();
+	}
+
+	inline std::vector<Node> const& GetNodes() const
+	{
+		return mNodes;
+	}
+
+	// The index in the input of the triangle at tree position t.
+	inline int32_t GetTriangle(size_t t) const
+	{
+		return mTriangles[t];
+	}
+
+	// The corners of the bounding box of the mesh.
+	inline Vector3<Real> const& GetMin() const
+	{
+		return mMin;
+	}
+
+	inline Vector3<Real> const& GetMax() const
+	{
+		return mMax;
+	}
+
+	// Replace the contents of 'ranges' by the leaves whose boxes are within
+	// distance 'radius' of 'center'. The triangles of the other leaves are
+	// farther from the center than the radius.
+	void GetLeaves(Vector3<Real> const& center, Real radius,
+		std::vector<Range>& ranges) const;
+
+	// The same for the leaves whose boxes intersect the box [vmin,vmax].
+	void GetLeaves(Vector3<Real> const& vmin, Vector3<Real> const& vmax,
+		std::vector<Range>& ranges) const;
+
+	// The closest point to 'point' of the triangles of the ranges. The
+	// function returns the distance and stores the closest point and the
+	// tree position of its triangle, or returns the largest Real when the
+	// ranges are empty.
+	Real GetClosestPoint(Vector3<Real> const& point, std::vector<Range> const& ranges,
+		Vector3<Real>& closest, size_t& triangle) const;
+
+	// The unit-length normal of the triangle at tree position t, or zero
+	// for a degenerate triangle.
+	inline Vector3<Real> GetNormal(size_t t) const
+	{
+		return Vector3<Real>{ mNX[t], mNY[t], mNZ[t] };
+	}
+
+	// The first contact of a sphere moving with constant velocity during
+	// [0,tmax]. The sphere advances conservatively by the distance to the
+	// mesh until the distance is at most radius + tolerance. The function
+	// returns true when a contact is found and stores its time and the
+	// unit-length normal from the mesh to the sphere, and returns false
+	// when the sphere does not reach the mesh or when more than
+	// maxIterations steps are needed. A sphere that intersects the mesh at
+	// time 0 has its contact at time 0.
+	bool FindFirstContact(Vector3<Real> const& center, Real radius,
+		Vector3<Real> const& velocity, Real tmax, Real tolerance,
+		Real& contactTime, Vector3<Real>& normal, size_t maxIterations = 64) const;
+
+private:
+	void BuildNode(std::vector<Vector3<Real>> const& centroids,
+		std::vector<std::array<Real, 3>> const& vertices,
+		std::vector<std::array<int32_t, 3>> const& triangles,
+		uint32_t first, uint32_t count, size_t maxTrisPerLeaf);
+
+	// The squared distances of 'point' to the triangles [first,first+count)
+	// are stored in sqrDistance[0..count).
+	void GetSqrDistances(Vector3<Real> const& point, uint32_t first, uint32_t count,
+		Real* sqrDistance) const;
+
+	Vector3<Real> GetClosestPoint(Vector3<Real> const& point, size_t t) const;
+
+	std::vector<Node> mNodes;
+	std::vector<int32_t> mTriangles;
+	Vector3<Real> mMin, mMax;
+
+	// For the triangle at tree position t with vertices V0, V1 and V2, the
+	// vertex V0, the edges E1 = V1 - V0 and E2 = V2 - V0, the unit-length
+	// normal N = Cross(E1,E2)/|Cross(E1,E2)|, the entries of the Gram
+	// matrix of the edges, a = Dot(E1,E1), b = Dot(E1,E2), c = Dot(E2,E2),
+	// the inverse of its determinant and the reciprocals of the squared
+	// lengths of the edges E1, E2 and E2 - E1. The inverses are 0 for
+	// degenerate triangles and edges.
+	std::vector<Real> mV0X, mV0Y, mV0Z, mE1X, mE1Y, mE1Z, mE2X, mE2Y, mE2Z;
+	std::vector<Real> mNX, mNY, mNZ, mA, mB, mC, mInvDet, mInvA, mInvC, mInvE;
+
+	// Storage for the squared distances of a leaf.
+	static size_t constexpr maxLeafSize = 64;
+};
@@ -1,11 +1,15 @@
 #include "RigidPlane.h"
 
-RigidPlane::RigidPlane(Plane3<double> const& plane)
+template <typename Real>
+RigidPlane<Real>::RigidPlane(Plane3<Real> const& plane)
 	:
-	RigidBody<double>{},
+	RigidBody<Real>{},
 	mPlane(plane)
 {
-	SetMass(0.0);
-	SetBodyInertia(Matrix3x3<double>::Zero());
-	SetPosition(mPlane.origin);
+	this->SetMass(static_cast<Real>(0));
+	this->SetBodyInertia(Matrix3x3<Real>::Zero());
+	this->SetPosition(mPlane.origin);
 }
+
+template class RigidPlane<float>;
+template class RigidPlane<double>;
@@ -2,22 +2,23 @@
 #include "Hyperplane.h"
 using namespace Vector_GM;
 
-class RigidPlane : public RigidBody<double>
+template <typename Real>
+class RigidPlane : public RigidBody<Real>
 {
 public:
-	RigidPlane(Plane3<double> const& plane);
+	RigidPlane(Plane3<Real> const& plane);
 	virtual ~RigidPlane() = default;
 
-	inline Plane3<double> const& GetPlane() const
+	inline Plane3<Real> const& GetPlane() const
 	{
 		return mPlane;
 	}
 
-	inline double GetSignedDistance(Vector3<double> const& point) const
+	inline Real GetSignedDistance(Vector3<Real> const& point) const
 	{
 		return Dot(mPlane.normal, point) - mPlane.constant;
 	}
 
 private:
-	Plane3<double> mPlane;
+	Plane3<Real> mPlane;
 };
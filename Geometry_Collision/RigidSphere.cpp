@@ -1,22 +1,27 @@
 #include "RigidSphere.h"
 using namespace Vector_GM;
 
-RigidSphere::RigidSphere(Sphere3<double> const& sphere, double massDensity)
+template <typename Real>
+RigidSphere<Real>::RigidSphere(Sphere3<Real> const& sphere, Real massDensity)
 	:
-	RigidBody<double>{},
-	mWorldSphere({ 0.0, 0.0, 0.0 }, sphere.radius)
+	RigidBody<Real>{},
+	mWorldSphere(Vector3<Real>::Zero(), sphere.radius)
 {
-	double rCubed = sphere.radius * sphere.radius * sphere.radius;
-	double volume = 4.0 * GTE_C_PI * rCubed / 3.0;
-	double mass = massDensity * volume;
-	Matrix3x3<double> bodyInertia = massDensity * Matrix3x3<double>::Identity();
-	SetMass(mass);
-	SetBodyInertia(bodyInertia);
-	SetPosition(sphere.center);
+	Real rCubed = sphere.radius * sphere.radius * sphere.radius;
+	Real volume = static_cast<Real>(4.0 * GTE_C_PI * rCubed / 3.0);
+	Real mass = massDensity * volume;
+	Matrix3x3<Real> bodyInertia = massDensity * Matrix3x3<Real>::Identity();
+	this->SetMass(mass);
+	this->SetBodyInertia(bodyInertia);
+	this->SetPosition(sphere.center);
 	UpdateWorldQuantities();
 }
 
-void RigidSphere::UpdateWorldQuantities()
+template <typename Real>
+void RigidSphere<Real>::UpdateWorldQuantities()
 {
-	mWorldSphere.center = GetPosition();
+	mWorldSphere.center = this->GetPosition();
 }
+
+template class RigidSphere<float>;
+template class RigidSphere<double>;
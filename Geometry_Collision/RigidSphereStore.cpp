@@ -0,0 +1,382 @@
+#include "RigidSphereStore.h"
+#include "NumaTopology.h"
+#include <algorithm>
+#include <cmath>
+
+template <typename Real>
+void RigidSphereStore<Real>::Resize(size_t numSpheres)
+{
+	Real const zero = static_cast<Real>(0);
+	shape.assign(numSpheres, SPHERE);
+	shapeRadius.assign(numSpheres, zero);
+	extent.assign(numSpheres, Vector3<Real>::Zero());
+	radius.assign(numSpheres, zero);
+	mass.assign(numSpheres, zero);
+	invMass.assign(numSpheres, zero);
+	massDensity.assign(numSpheres, zero);
+	inertia.assign(numSpheres, Vector3<Real>::Zero());
+	invInertia.assign(numSpheres, Vector3<Real>::Zero());
+	position.assign(numSpheres, Vector3<Real>::Zero());
+	qOrientation.assign(numSpheres, Quaternion<Real>::Identity());
+	linearMomentum.assign(numSpheres, Vector3<Real>::Zero());
+	angularMomentum.assign(numSpheres, Vector3<Real>::Zero());
+	rOrientation.assign(numSpheres, Matrix3x3<Real>::Identity());
+	linearVelocity.assign(numSpheres, Vector3<Real>::Zero());
+	angularVelocity.assign(numSpheres, Vector3<Real>::Zero());
+}
+
+template <typename Real>
+size_t RigidSphereStore<Real>::Append()
+{
+	Real const zero = static_cast<Real>(0);
+	size_t const i = position.size();
+	shape.push_back(SPHERE);
+	shapeRadius.push_back(zero);
+	extent.push_back(Vector3<Real>::Zero());
+	radius.push_back(zero);
+	mass.push_back(zero);
+	invMass.push_back(zero);
+	massDensity.push_back(zero);
+	inertia.push_back(Vector3<Real>::Zero());
+	invInertia.push_back(Vector3<Real>::Zero());
+	position.push_back(Vector3<Real>::Zero());
+	qOrientation.push_back(Quaternion<Real>::Identity());
+	linearMomentum.push_back(Vector3<Real>::Zero());
+	angularMomentum.push_back(Vector3<Real>::Zero());
+	rOrientation.push_back(Matrix3x3<Real>::Identity());
+	linearVelocity.push_back(Vector3<Real>::Zero());
+	angularVelocity.push_back(Vector3<Real>::Zero());
+	return i;
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::SwapRemove(size_t i)
+{
+	size_t const last = position.size() - 1;
+	if (i != last)
+	{
+		shape[i] = shape[last];
+		shapeRadius[i] = shapeRadius[last];
+		extent[i] = extent[last];
+		radius[i] = radius[last];
+		mass[i] = mass[last];
+		invMass[i] = invMass[last];
+		massDensity[i] = massDensity[last];
+		inertia[i] = inertia[last];
+		invInertia[i] = invInertia[last];
+		position[i] = position[last];
+		qOrientation[i] = qOrientation[last];
+		linearMomentum[i] = linearMomentum[last];
+		angularMomentum[i] = angularMomentum[last];
+		rOrientation[i] = rOrientation[last];
+		linearVelocity[i] = linearVelocity[last];
+		angularVelocity[i] = angularVelocity[last];
+	}
+	shape.pop_back();
+	shapeRadius.pop_back();
+	extent.pop_back();
+	radius.pop_back();
+	mass.pop_back();
+	invMass.pop_back();
+	massDensity.pop_back();
+	inertia.pop_back();
+	invInertia.pop_back();
+	position.pop_back();
+	qOrientation.pop_back();
+	linearMomentum.pop_back();
+	angularMomentum.pop_back();
+	rOrientation.pop_back();
+	linearVelocity.pop_back();
+	angularVelocity.pop_back();
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::Gather(RigidSphereStore const& source,
+	std::vector<size_t> const& order, size_t begin, size_t end)
+{
+	auto gather = [&order, begin, end](auto& target, auto const& values)
+	{
+		NumaTopology::DiscardPages(target.data() + begin,
+			(end - begin) * sizeof(target[0]));
+		for (size_t k = begin; k < end; ++k)
+		{
+			target[k] = values[order[k]];
+		}
+	};
+
+	gather(shape, source.shape);
+	gather(shapeRadius, source.shapeRadius);
+	gather(extent, source.extent);
+	gather(radius, source.radius);
+	gather(mass, source.mass);
+	gather(invMass, source.invMass);
+	gather(massDensity, source.massDensity);
+	gather(inertia, source.inertia);
+	gather(invInertia, source.invInertia);
+	gather(position, source.position);
+	gather(qOrientation, source.qOrientation);
+	gather(linearMomentum, source.linearMomentum);
+	gather(angularMomentum, source.angularMomentum);
+	gather(rOrientation, source.rOrientation);
+	gather(linearVelocity, source.linearVelocity);
+	gather(angularVelocity, source.angularVelocity);
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::Initialize(size_t i, Real inRadius, Real inMassDensity,
+	Vector3<Real> const& center, Vector3<Real> const& inLinearVelocity,
+	Quaternion<Real> const& inQOrientation,
+	Vector3<Real> const& inAngularVelocity)
+{
+	Real rCubed = inRadius * inRadius * inRadius;
+	Real volume = static_cast<Real>(4.0 * GTE_C_PI * rCubed / 3.0);
+	Vector3<Real> unitInertia{ static_cast<Real>(1), static_cast<Real>(1),
+		static_cast<Real>(1) };
+	InitializeBody(i, SPHERE, inRadius, Vector3<Real>::Zero(), volume,
+		inMassDensity, unitInertia, center, inLinearVelocity, inQOrientation,
+		inAngularVelocity);
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::InitializeCapsule(size_t i, Real inRadius,
+	Real halfLength, Real inMassDensity, Vector3<Real> const& center,
+	Vector3<Real> const& inLinearVelocity,
+	Quaternion<Real> const& inQOrientation,
+	Vector3<Real> const& inAngularVelocity)
+{
+	// The volume of the cylinder of length 2*halfLength plus that of the
+	// two hemispherical caps.
+	Real rSquared = inRadius * inRadius;
+	Real volume = static_cast<Real>(GTE_C_PI) * rSquared *
+		(static_cast<Real>(2) * halfLength + static_cast<Real>(4.0 / 3.0) * inRadius);
+	Vector3<Real> inExtent{ static_cast<Real>(0), static_cast<Real>(0), halfLength };
+	InitializeBody(i, CAPSULE, inRadius, inExtent, volume, inMassDensity,
+		GetCapsuleUnitInertia(inRadius, halfLength), center, inLinearVelocity,
+		inQOrientation, inAngularVelocity);
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::InitializeBox(size_t i, Vector3<Real> const& inExtent,
+	Real inMassDensity, Vector3<Real> const& center,
+	Vector3<Real> const& inLinearVelocity,
+	Quaternion<Real> const& inQOrientation,
+	Vector3<Real> const& inAngularVelocity)
+{
+	// The moment about axis k of a solid box is mass*(e1^2+e2^2)/3 for the
+	// other two extents e1 and e2.
+	Real volume = static_cast<Real>(8) * inExtent[0] * inExtent[1] * inExtent[2];
+	Real const third = static_cast<Real>(1.0 / 3.0);
+	Real const sqrE0 = inExtent[0] * inExtent[0];
+	Real const sqrE1 = inExtent[1] * inExtent[1];
+	Real const sqrE2 = inExtent[2] * inExtent[2];
+	Vector3<Real> unitInertia{ third * volume * (sqrE1 + sqrE2),
+		third * volume * (sqrE0 + sqrE2), third * volume * (sqrE0 + sqrE1) };
+	InitializeBody(i, BOX, static_cast<Real>(0), inExtent, volume, inMassDensity,
+		unitInertia, center, inLinearVelocity, inQOrientation, inAngularVelocity);
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::InitializeBody(size_t i, uint8_t inShape,
+	Real inShapeRadius, Vector3<Real> const& inExtent, Real volume,
+	Real inMassDensity, Vector3<Real> const& unitInertia,
+	Vector3<Real> const& center,
+	Vector3<Real> const& inLinearVelocity,
+	Quaternion<Real> const& inQOrientation,
+	Vector3<Real> const& inAngularVelocity)
+{
+	Real const zero = static_cast<Real>(0);
+	Real const one = static_cast<Real>(1);
+	shape[i] = inShape;
+	shapeRadius[i] = inShapeRadius;
+	extent[i] = inExtent;
+	radius[i] = (inShape == SPHERE ? inShapeRadius : inShapeRadius + Length(inExtent));
+	if (inMassDensity > zero)
+	{
+		mass[i] = inMassDensity * volume;
+		invMass[i] = one / mass[i];
+		massDensity[i] = inMassDensity;
+		for (int32_t k = 0; k < 3; ++k)
+		{
+			inertia[i][k] = inMassDensity * unitInertia[k];
+			invInertia[i][k] = one / inertia[i][k];
+		}
+	}
+	else
+	{
+		mass[i] = zero;
+		invMass[i] = zero;
+		massDensity[i] = zero;
+		inertia[i] = Vector3<Real>::Zero();
+		invInertia[i] = Vector3<Real>::Zero();
+	}
+
+	position[i] = center;
+	SetQOrientation(i, inQOrientation);
+
+	linearMomentum[i] = Vector3<Real>::Zero();
+	angularMomentum[i] = Vector3<Real>::Zero();
+	linearVelocity[i] = Vector3<Real>::Zero();
+	angularVelocity[i] = Vector3<Real>::Zero();
+	if (IsMovable(i))
+	{
+		linearVelocity[i] = inLinearVelocity;
+		linearMomentum[i] = mass[i] * inLinearVelocity;
+		angularVelocity[i] = inAngularVelocity;
+		angularMomentum[i] = MultiplyInertia(i, inAngularVelocity);
+	}
+}
+
+template <typename Real>
+Vector3<Real> RigidSphereStore<Real>::GetCapsuleUnitInertia(Real inRadius,
+	Real halfLength)
+{
+	// The cylinder has volume vc and the caps have volume vh each. The
+	// center of mass of a cap is at distance 3*r/8 from its base, so by the
+	// parallel axis theorem the moment of a cap about a diameter through
+	// the center of the capsule is vh*(2*r^2/5 + h^2 + 3*h*r/4).
+	Real const pi = static_cast<Real>(GTE_C_PI);
+	Real const r = inRadius, h = halfLength;
+	Real const sqrR = r * r;
+	Real const vc = pi * sqrR * static_cast<Real>(2) * h;
+	Real const vh = static_cast<Real>(2.0 / 3.0) * pi * sqrR * r;
+	Real const capAxial = static_cast<Real>(0.4) * sqrR;
+	Real const capDiameter = capAxial + h * h + static_cast<Real>(0.75) * h * r;
+	Real const axial = vc * static_cast<Real>(0.5) * sqrR +
+		static_cast<Real>(2) * vh * capAxial;
+	Real const diameter = vc * (static_cast<Real>(0.25) * sqrR +
+		h * h / static_cast<Real>(3)) + static_cast<Real>(2) * vh * capDiameter;
+	return Vector3<Real>{ diameter, diameter, axial };
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::SetLinearMomentum(size_t i,
+	Vector3<Real> const& inLinearMomentum)
+{
+	if (IsMovable(i))
+	{
+		linearMomentum[i] = inLinearMomentum;
+		linearVelocity[i] = invMass[i] * inLinearMomentum;
+	}
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::SetAngularMomentum(size_t i,
+	Vector3<Real> const& inAngularMomentum)
+{
+	if (IsMovable(i))
+	{
+		angularMomentum[i] = inAngularMomentum;
+		angularVelocity[i] = MultiplyInverseInertia(i, inAngularMomentum);
+	}
+}
+
+template <typename Real>
+void RigidSphereStore<Real>::SetQOrientation(size_t i,
+	Quaternion<Real> const& inQOrientation)
+{
+	qOrientation[i] = inQOrientation;
+	Normalize(qOrientation[i]);
+	rOrientation[i] = Rotation<3, Real>(qOrientation[i]);
+}
+
+template <typename Real>
+Vector3<Real> RigidSphereStore<Real>::MultiplyInertia(size_t i,
+	Vector3<Real> const& v) const
+{
+	if (IsIsotropic(i))
+	{
+		return inertia[i][0] * v;
+	}
+	return MultiplyPrincipal(inertia[i], rOrientation[i], v);
+}
+
+template <typename Real>
+Vector3<Real> RigidSphereStore<Real>::MultiplyInverseInertia(size_t i,
+	Vector3<Real> const& v) const
+{
+	if (IsIsotropic(i))
+	{
+		return invInertia[i][0] * v;
+	}
+	return MultiplyPrincipal(invInertia[i], rOrientation[i], v);
+}
+
+template <typename Real>
+Vector3<Real> RigidSphereStore<Real>::MultiplyInverseInertia(size_t i,
+	Quaternion<Real> const& q, Vector3<Real> const& v) const
+{
+	if (IsIsotropic(i))
+	{
+		return invInertia[i][0] * v;
+	}
+	return MultiplyPrincipal(invInertia[i], Rotation<3, Real>(q), v);
+}
+
+template <typename Real>
+Vector3<Real> RigidSphereStore<Real>::MultiplyPrincipal(
+	Vector3<Real> const& moments, Matrix3x3<Real> const& rotate,
+	Vector3<Real> const& v)
+{
+	Vector3<Real> bodyV = v * rotate;
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		bodyV[k] *= moments[k];
+	}
+	return rotate * bodyV;
+}
+
+template <typename Real>
+Real RigidSphereStore<Real>::GetInverseInertiaForm(size_t i,
+	Vector3<Real> const& u, Vector3<Real> const& v) const
+{
+	if (IsIsotropic(i))
+	{
+		return invInertia[i][0] * Dot(u, v);
+	}
+
+	Real form = static_cast<Real>(0);
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		Vector3<Real> axis = rOrientation[i].GetCol(k);
+		form += invInertia[i][k] * Dot(u, axis) * Dot(v, axis);
+	}
+	return form;
+}
+
+template <typename Real>
+Real RigidSphereStore<Real>::GetSupportDistance(size_t i,
+	Vector3<Real> const& direction) const
+{
+	Real distance = shapeRadius[i];
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		Vector3<Real> axis = rOrientation[i].GetCol(k);
+		distance += extent[i][k] * std::fabs(Dot(direction, axis));
+	}
+	return distance;
+}
+
+template <typename Real>
+Vector3<Real> RigidSphereStore<Real>::GetSupportPoint(size_t i,
+	Vector3<Real> const& direction) const
+{
+	// A single point stands for the contact region of a face or an edge
+	// of the core box, so the offset along an axis nearly perpendicular
+	// to the direction blends from the end of the axis to the center of
+	// the feature. Otherwise a box resting on a face would alternate
+	// between contacts at opposite vertices and tip back and forth.
+	Real const one = static_cast<Real>(1);
+	Real const invTolerance = static_cast<Real>(16);
+	Vector3<Real> point = position[i] + shapeRadius[i] * direction;
+	for (int32_t k = 0; k < 3; ++k)
+	{
+		Vector3<Real> axis = rOrientation[i].GetCol(k);
+		Real weight = invTolerance * Dot(direction, axis);
+		weight = std::min(std::max(weight, -one), one);
+		point += (weight * extent[i][k]) * axis;
+	}
+	return point;
+}
+
+template class RigidSphereStore<float>;
+template class RigidSphereStore<double>;
@@ -0,0 +1,184 @@
+#pragma once
+
+#include "Matrix3x3.h"
+#include "Rotation.h"
+#include "Hypersphere.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+using namespace Vector_GM;
+
+// Structure-of-arrays storage for the rigid spheres of a PhysicsModule. A
+// sphere is referenced by its index (handle) 0 <= i < GetNumSpheres(), and
+// each quantity lives in its own contiguous array, so the detection and
+// integration loops stream linearly through memory instead of chasing one
+// shared_ptr and one RigidBodyState per sphere.
+//
+// The body inertia is stored as its principal moments, the diagonal of the
+// body inertia tensor J in the body frame, and the world inertia tensor is
+// R*J*R^T for the rotation matrix R. The body inertia of a RigidSphere is
+// massDensity times the identity matrix. Rotating a multiple of the
+// identity does not change it, so for equal moments the world inertia is
+// the scalar moment times the identity and is never rotated. The rotation
+// matrix is derived from the quaternion once per tick for the graphics and
+// for the contact kernels and the world inertia of the capsules and the
+// boxes.
+//
+// Besides spheres the store holds capsules and oriented boxes, the shapes
+// of RigidCapsule and RigidBox. Every body is the set of points within
+// distance shapeRadius of its core box, whose center is the position,
+// whose axes are the columns of rOrientation and whose half-widths are the
+// extent components:
+//   SPHERE:  shapeRadius = radius, extent = (0,0,0);
+//   CAPSULE: shapeRadius = capsule radius, extent = (0,0,halfLength), so
+//            the axis of the capsule is the body z-axis;
+//   BOX:     shapeRadius = 0, extent = box extents.
+// For every shape 'radius' is the radius of the bounding sphere about the
+// position, shapeRadius + Length(extent), so the broadphase and every other
+// test written for spheres treat a capsule or a box as its bounding sphere.
+// The principal moments of a box are those of the solid box with the
+// extents and of a capsule those of its cylinder plus its two solid
+// hemispherical caps, with the axis of the capsule as the third principal
+// axis. The spheres keep the massDensity moments of RigidSphere.
+
+template <typename Real>
+class RigidSphereStore
+{
+public:
+	enum Shape : uint8_t
+	{
+		SPHERE,
+		CAPSULE,
+		BOX
+	};
+
+	RigidSphereStore() = default;
+
+	// All spheres are set to zero values. Call Initialize(i,...) for each
+	// sphere before starting the simulation.
+	void Resize(size_t numSpheres);
+
+	inline size_t GetNumSpheres() const
+	{
+		return position.size();
+	}
+
+	// Append a sphere with zero values and return its index, which is the
+	// previous number of spheres. Call Initialize for it.
+	size_t Append();
+
+	// Remove sphere i by moving the last sphere into its slot, so the
+	// arrays stay contiguous. The index of the last sphere becomes i.
+	void SwapRemove(size_t i);
+
+	// Set spheres begin <= k < end to the spheres order[k] of the source,
+	// which has the same number of spheres. The whole pages of the ranges
+	// are discarded before they are written, so when threads pinned to
+	// different NUMA nodes gather disjoint ranges, each range is allocated
+	// on the node of its thread; see NumaTopology::DiscardPages.
+	void Gather(RigidSphereStore const& source, std::vector<size_t> const& order,
+		size_t begin, size_t end);
+
+	// Set the constant quantities and the initial state of sphere i. This
+	// matches the construction of a RigidSphere followed by calls to
+	// SetLinearVelocity, SetQOrientation(q, true) and SetAngularVelocity.
+	void Initialize(size_t i, Real inRadius, Real inMassDensity,
+		Vector3<Real> const& center, Vector3<Real> const& inLinearVelocity,
+		Quaternion<Real> const& inQOrientation,
+		Vector3<Real> const& inAngularVelocity);
+
+	// The same for a capsule, whose segment has the specified half-length
+	// along the body z-axis, and for a box with the specified extents.
+	void InitializeCapsule(size_t i, Real inRadius, Real halfLength,
+		Real inMassDensity, Vector3<Real> const& center,
+		Vector3<Real> const& inLinearVelocity,
+		Quaternion<Real> const& inQOrientation,
+		Vector3<Real> const& inAngularVelocity);
+
+	void InitializeBox(size_t i, Vector3<Real> const& inExtent,
+		Real inMassDensity, Vector3<Real> const& center,
+		Vector3<Real> const& inLinearVelocity,
+		Quaternion<Real> const& inQOrientation,
+		Vector3<Real> const& inAngularVelocity);
+
+	inline bool IsMovable(size_t i) const
+	{
+		return mass[i] > static_cast<Real>(0);
+	}
+
+	inline Sphere3<Real> GetWorldSphere(size_t i) const
+	{
+		return Sphere3<Real>(position[i], radius[i]);
+	}
+
+	// The moments of body i are equal, which includes every sphere.
+	inline bool IsIsotropic(size_t i) const
+	{
+		return inertia[i][0] == inertia[i][1] && inertia[i][1] == inertia[i][2];
+	}
+
+	// The products J*v and J^{-1}*v of the world inertia J of body i and a
+	// vector, and the quadratic form Dot(u,J^{-1}*v). The orientation is
+	// that of the body unless a unit-length quaternion is specified, which
+	// is converted to a rotation matrix only for unequal moments.
+	Vector3<Real> MultiplyInertia(size_t i, Vector3<Real> const& v) const;
+	Vector3<Real> MultiplyInverseInertia(size_t i, Vector3<Real> const& v) const;
+	Vector3<Real> MultiplyInverseInertia(size_t i, Quaternion<Real> const& q,
+		Vector3<Real> const& v) const;
+	Real GetInverseInertiaForm(size_t i, Vector3<Real> const& u,
+		Vector3<Real> const& v) const;
+
+	// These keep the derived velocities synchronized with the momenta. They
+	// have no effect on immovable spheres.
+	void SetLinearMomentum(size_t i, Vector3<Real> const& inLinearMomentum);
+	void SetAngularMomentum(size_t i, Vector3<Real> const& inAngularMomentum);
+
+	// Set the quaternion of sphere i, normalize it and update the rotation
+	// matrix.
+	void SetQOrientation(size_t i, Quaternion<Real> const& inQOrientation);
+
+	// The largest distance of a point of body i from its position in the
+	// direction of the unit-length vector, and the point of the body that
+	// attains it; for a feature of the core box perpendicular to the
+	// direction the point is the center of the feature.
+	Real GetSupportDistance(size_t i, Vector3<Real> const& direction) const;
+	Vector3<Real> GetSupportPoint(size_t i, Vector3<Real> const& direction) const;
+
+	// Constant quantities during the simulation.
+	std::vector<uint8_t> shape;
+	std::vector<Real> shapeRadius;
+	std::vector<Vector3<Real>> extent;
+	std::vector<Real> radius;
+	std::vector<Real> mass;
+	std::vector<Real> invMass;
+	std::vector<Real> massDensity;
+	std::vector<Vector3<Real>> inertia;
+	std::vector<Vector3<Real>> invInertia;
+
+	// State variables in the differential equations of motion.
+	std::vector<Vector3<Real>> position;
+	std::vector<Quaternion<Real>> qOrientation;
+	std::vector<Vector3<Real>> linearMomentum;
+	std::vector<Vector3<Real>> angularMomentum;
+
+	// Quantities derived from the state variables.
+	std::vector<Matrix3x3<Real>> rOrientation;
+	std::vector<Vector3<Real>> linearVelocity;
+	std::vector<Vector3<Real>> angularVelocity;
+
+private:
+	// The principal moments of the body are inMassDensity*unitInertia.
+	void InitializeBody(size_t i, uint8_t inShape, Real inShapeRadius,
+		Vector3<Real> const& inExtent, Real volume, Real inMassDensity,
+		Vector3<Real> const& unitInertia, Vector3<Real> const& center,
+		Vector3<Real> const& inLinearVelocity,
+		Quaternion<Real> const& inQOrientation,
+		Vector3<Real> const& inAngularVelocity);
+
+	// The product R*diag(moments)*R^T*v.
+	static Vector3<Real> MultiplyPrincipal(Vector3<Real> const& moments,
+		Matrix3x3<Real> const& rotate, Vector3<Real> const& v);
+
+	// The principal moments of a capsule with unit mass density.
+	static Vector3<Real> GetCapsuleUnitInertia(Real inRadius, Real halfLength);
+};
@@ -2,18 +2,19 @@
 #include "Hypersphere.h"
 using namespace Vector_GM;
 
-class RigidSphere : public RigidBody<double>
+template <typename Real>
+class RigidSphere : public RigidBody<Real>
 {
 public:
-	RigidSphere(Sphere3<double> const& sphere, double massDensity);
+	RigidSphere(Sphere3<Real> const& sphere, Real massDensity);
 	virtual ~RigidSphere() = default;
 
-	inline Sphere3<double> const& GetWorldSphere() const
+	inline Sphere3<Real> const& GetWorldSphere() const
 	{
 		return mWorldSphere;
 	}
 
-	inline double GetRadius() const
+	inline Real GetRadius() const
 	{
 		return mWorldSphere.radius;
 	}
@@ -21,5 +22,5 @@ public:
 	void UpdateWorldQuantities();
 
 private:
-	Sphere3<double> mWorldSphere;
+	Sphere3<Real> mWorldSphere;
 };
@@ -0,0 +1,283 @@
+#pragma once
+
+#include "Exceptions.h"
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// A contiguous container with the std::vector subset used by Vector<T>.
+// Up to InlineCapacity elements are stored inside the object, so small
+// vectors do not allocate. Larger vectors move their elements to the heap,
+// after which they behave like a std::vector. The elements can be of any
+// type, including the arbitrary-precision types; they are constructed and
+// destroyed explicitly.
+
+namespace Vector_GM
+{
+	template <typename T, size_t InlineCapacity>
+	class SmallVector
+	{
+	public:
+		using value_type = T;
+		using iterator = T*;
+		using const_iterator = T const*;
+
+		// Construction and destruction.
+		SmallVector() noexcept
+			:
+			mData(GetInline()),
+			mSize(0),
+			mCapacity(InlineCapacity)
+		{
+		}
+
+		explicit SmallVector(size_t numElements)
+			:
+			SmallVector()
+		{
+			resize(numElements);
+		}
+
+		SmallVector(size_t numElements, T const& value)
+			:
+			SmallVector()
+		{
+			reserve(numElements);
+			std::uninitialized_fill_n(mData, numElements, value);
+			mSize = numElements;
+		}
+
+		template <typename InputIterator,
+			typename = std::enable_if_t<!std::is_integral<InputIterator>::value>>
+		SmallVector(InputIterator first, InputIterator last)
+			:
+			SmallVector()
+		{
+			reserve(static_cast<size_t>(std::distance(first, last)));
+			mSize = static_cast<size_t>(std::uninitialized_copy(first, last, mData) - mData);
+		}
+
+		~SmallVector()
+		{
+			Release();
+		}
+
+		// Copy semantics.
+		SmallVector(SmallVector const& other)
+			:
+			SmallVector(other.begin(), other.end())
+		{
+		}
+
+		SmallVector& operator=(SmallVector const& other)
+		{
+			if (this != &other)
+			{
+				clear();
+				reserve(other.mSize);
+				std::uninitialized_copy(other.begin(), other.end(), mData);
+				mSize = other.mSize;
+			}
+			return *this;
+		}
+
+		// Move semantics. Heap storage is transferred; inline elements are
+		// moved one at a time. The source is left empty.
+		SmallVector(SmallVector&& other) noexcept
+			:
+			SmallVector()
+		{
+			TakeFrom(other);
+		}
+
+		SmallVector& operator=(SmallVector&& other) noexcept
+		{
+			if (this != &other)
+			{
+				Release();
+				mData = GetInline();
+				mSize = 0;
+				mCapacity = InlineCapacity;
+				TakeFrom(other);
+			}
+			return *this;
+		}
+
+		// Size and capacity.
+		inline size_t size() const noexcept
+		{
+			return mSize;
+		}
+
+		inline size_t capacity() const noexcept
+		{
+			return mCapacity;
+		}
+
+		inline bool empty() const noexcept
+		{
+			return mSize == 0;
+		}
+
+		inline bool IsInline() const noexcept
+		{
+			return mData == GetInline();
+		}
+
+		// The storage grows to max(numElements, 2 * capacity()) when
+		// numElements exceeds the capacity; it never shrinks.
+		void reserve(size_t numElements)
+		{
+			if (numElements > mCapacity)
+			{
+				size_t newCapacity = std::max(numElements, 2 * mCapacity);
+				T* newData = std::allocator<T>{}.allocate(newCapacity);
+				for (size_t i = 0; i < mSize; ++i)
+				{
+					::new (static_cast<void*>(newData + i)) T(std::move(mData[i]));
+					mData[i].~T();
+				}
+				if (!IsInline())
+				{
+					std::allocator<T>{}.deallocate(mData, mCapacity);
+				}
+				mData = newData;
+				mCapacity = newCapacity;
+			}
+		}
+
+		// New elements are value-initialized, as for std::vector.
+		void resize(size_t numElements)
+		{
+			if (numElements < mSize)
+			{
+				std::destroy(mData + numElements, mData + mSize);
+			}
+			else if (numElements > mSize)
+			{
+				reserve(numElements);
+				std::uninitialized_value_construct(mData + mSize, mData + numElements);
+			}
+			mSize = numElements;
+		}
+
+		void clear() noexcept
+		{
+			std::destroy(mData, mData + mSize);
+			mSize = 0;
+		}
+
+		// Data and element access.
+		inline T const* data() const noexcept
+		{
+			return mData;
+		}
+
+		inline T* data() noexcept
+		{
+			return mData;
+		}
+
+		inline T const& at(size_t i) const
+		{
+			GTL_OUTOFRANGE_ASSERT(
+				i < mSize,
+				"Invalid index.");
+
+			return mData[i];
+		}
+
+		inline T& at(size_t i)
+		{
+			GTL_OUTOFRANGE_ASSERT(
+				i < mSize,
+				"Invalid index.");
+
+			return mData[i];
+		}
+
+		inline T const& operator[](size_t i) const
+		{
+			return mData[i];
+		}
+
+		inline T& operator[](size_t i)
+		{
+			return mData[i];
+		}
+
+		inline T const* begin() const noexcept
+		{
+			return mData;
+		}
+
+		inline T const* end() const noexcept
+		{
+			return mData + mSize;
+		}
+
+		inline T* begin() noexcept
+		{
+			return mData;
+		}
+
+		inline T* end() noexcept
+		{
+			return mData + mSize;
+		}
+
+	private:
+		inline T* GetInline() noexcept
+		{
+			return reinterpret_cast<T*>(mInline);
+		}
+
+		inline T const* GetInline() const noexcept
+		{
+			return reinterpret_cast<T const*>(mInline);
+		}
+
+		// Destroy the elements and free the heap storage.
+		void Release() noexcept
+		{
+			clear();
+			if (!IsInline())
+			{
+				std::allocator<T>{}.deallocate(mData, mCapacity);
+			}
+		}
+
+		// On entry this vector is empty and inline.
+		void TakeFrom(SmallVector& other) noexcept
+		{
+			if (other.IsInline())
+			{
+				for (size_t i = 0; i < other.mSize; ++i)
+				{
+					::new (static_cast<void*>(mData + i)) T(std::move(other.mData[i]));
+				}
+				mSize = other.mSize;
+				other.clear();
+			}
+			else
+			{
+				mData = other.mData;
+				mSize = other.mSize;
+				mCapacity = other.mCapacity;
+				other.mData = other.GetInline();
+				other.mSize = 0;
+				other.mCapacity = InlineCapacity;
+			}
+		}
+
+		T* mData;
+		size_t mSize, mCapacity;
+
+		// The inline storage has room for at least one element so that
+		// the array is not empty when InlineCapacity is 0.
+		alignas(T) unsigned char mInline[sizeof(T) * (InlineCapacity > 0 ? InlineCapacity : 1)];
+	};
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "HyperSphere.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Structure-of-arrays storage for the batched sphere queries. Each
+// coordinate of the centers and the radii have their own contiguous
+// arrays, so the query loops load consecutive spheres with unit stride.
+
+namespace Vector_GM
+{
+    template <typename T>
+    class SphereArray3
+    {
+    public:
+        SphereArray3() = default;
+
+        inline size_t size() const
+        {
+            return radius.size();
+        }
+
+        void Clear()
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                center[d].clear();
+            }
+            radius.clear();
+        }
+
+        void Reserve(size_t numSpheres)
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                center[d].reserve(numSpheres);
+            }
+            radius.reserve(numSpheres);
+        }
+
+        void Push(Sphere3<T> const& sphere)
+        {
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                center[d].push_back(sphere.center[d]);
+            }
+            radius.push_back(sphere.radius);
+        }
+
+        Sphere3<T> Get(size_t i) const
+        {
+            Sphere3<T> sphere{};
+            for (int32_t d = 0; d < 3; ++d)
+            {
+                sphere.center[d] = center[d][i];
+            }
+            sphere.radius = radius[i];
+            return sphere;
+        }
+
+        std::array<std::vector<T>, 3> center;
+        std::vector<T> radius;
+    };
+}
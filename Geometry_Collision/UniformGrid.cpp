@@ -0,0 +1,231 @@
+#include "UniformGrid.h"
+#include <algorithm>
+#include <cmath>
+
+template <typename Real>
+UniformGrid<Real>::UniformGrid()
+	:
+	mRegionMin(Vector3<Real>::Zero()),
+	mInvCellSize(Vector3<Real>::Zero()),
+	mCellsPerDimension{ 0, 0, 0 },
+	mNumCells(0),
+	mCellOfSphere{},
+	mCellStart{},
+	mSorted{},
+	mThreadPairs{}
+{
+}
+
+template <typename Real>
+void UniformGrid<Real>::Initialize(Vector3<Real> const& regionMin,
+	Vector3<Real> const& regionMax, Real cellSize)
+{
+	Real const zero = static_cast<Real>(0);
+	mRegionMin = regionMin;
+	mNumCells = 1;
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		// Round down so that the actual cell size is not smaller than the
+		// requested one. A region thinner than a cell has a single layer.
+		Real extent = regionMax[d] - regionMin[d];
+		Real numCells = std::floor(extent / cellSize);
+		mCellsPerDimension[d] = (numCells >= static_cast<Real>(1) ? static_cast<size_t>(numCells) : 1);
+		mInvCellSize[d] = (extent > zero ?
+			static_cast<Real>(mCellsPerDimension[d]) / extent : zero);
+		mNumCells *= mCellsPerDimension[d];
+	}
+
+	mCellStart.resize(mNumCells + 1);
+}
+
+template <typename Real>
+size_t UniformGrid<Real>::GetCellCoordinate(Real value, int32_t d) const
+{
+	Real t = std::floor((value - mRegionMin[d]) * mInvCellSize[d]);
+	Real tMax = static_cast<Real>(mCellsPerDimension[d] - 1);
+	return static_cast<size_t>(std::min(std::max(t, static_cast<Real>(0)), tMax));
+}
+
+template <typename Real>
+size_t UniformGrid<Real>::GetCellIndex(Vector3<Real> const& center) const
+{
+	std::array<size_t, 3> cell{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		cell[d] = GetCellCoordinate(center[d], d);
+	}
+	return cell[0] + mCellsPerDimension[0] * (cell[1] + mCellsPerDimension[1] * cell[2]);
+}
+
+template <typename Real>
+void UniformGrid<Real>::ComputePairs(std::vector<Vector3<Real>> const& centers,
+	std::vector<std::pair<size_t, size_t>>& pairs, WorkerTeam* team)
+{
+	pairs.clear();
+	Bin(centers);
+
+	if (team == nullptr || team->GetNumWorkers() == 0)
+	{
+		AppendPairs(0, mNumCells, pairs);
+		std::sort(pairs.begin(), pairs.end());
+		return;
+	}
+
+	// The cells are read-only during the pairing, so the workers share
+	// them. Each worker appends to its own array, and the arrays are
+	// concatenated in cell order.
+	size_t const numThreads = team->GetNumWorkers();
+	mThreadPairs.resize(numThreads);
+	team->Run([this, numThreads](size_t t)
+	{
+		size_t cBegin = mNumCells * t / numThreads;
+		size_t cEnd = mNumCells * (t + 1) / numThreads;
+		mThreadPairs[t].clear();
+		AppendPairs(cBegin, cEnd, mThreadPairs[t]);
+	});
+
+	for (size_t t = 0; t < numThreads; ++t)
+	{
+		pairs.insert(pairs.end(), mThreadPairs[t].begin(), mThreadPairs[t].end());
+	}
+}
+
+template <typename Real>
+void UniformGrid<Real>::Bin(std::vector<Vector3<Real>> const& centers)
+{
+	// Count the spheres in each cell.
+	size_t const numSpheres = centers.size();
+	mCellOfSphere.resize(numSpheres);
+	std::fill(mCellStart.begin(), mCellStart.end(), 0);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		size_t c = GetCellIndex(centers[i]);
+		mCellOfSphere[i] = c;
+		++mCellStart[c + 1];
+	}
+
+	// Convert the counts to starting offsets.
+	for (size_t c = 0; c < mNumCells; ++c)
+	{
+		mCellStart[c + 1] += mCellStart[c];
+	}
+
+	// Scatter the sphere indices into the cell-sorted array. The spheres are
+	// visited in increasing index order, so each cell lists its spheres in
+	// increasing index order.
+	mSorted.resize(numSpheres);
+	for (size_t i = 0; i < numSpheres; ++i)
+	{
+		size_t c = mCellOfSphere[i];
+		mSorted[mCellStart[c]++] = i;
+	}
+
+	// The scatter advanced each start to the start of the next cell. Shift
+	// the offsets back.
+	for (size_t c = mNumCells; c > 0; --c)
+	{
+		mCellStart[c] = mCellStart[c - 1];
+	}
+	mCellStart[0] = 0;
+}
+
+template <typename Real>
+void UniformGrid<Real>::Query(Vector3<Real> const& boxMin,
+	Vector3<Real> const& boxMax, std::vector<size_t>& spheres) const
+{
+	std::array<size_t, 3> cMin{}, cMax{};
+	for (int32_t d = 0; d < 3; ++d)
+	{
+		cMin[d] = GetCellCoordinate(boxMin[d], d);
+		cMax[d] = GetCellCoordinate(boxMax[d], d);
+	}
+
+	for (size_t z = cMin[2]; z <= cMax[2]; ++z)
+	{
+		for (size_t y = cMin[1]; y <= cMax[1]; ++y)
+		{
+			size_t const row = mCellsPerDimension[0] * (y + mCellsPerDimension[1] * z);
+			for (size_t c = row + cMin[0]; c <= row + cMax[0]; ++c)
+			{
+				spheres.insert(spheres.end(), mSorted.begin() + mCellStart[c],
+					mSorted.begin() + mCellStart[c + 1]);
+			}
+		}
+	}
+}
+
+template <typename Real>
+void UniformGrid<Real>::AppendPairs(size_t cBegin, size_t cEnd,
+	std::vector<std::pair<size_t, size_t>>& pairs) const
+{
+	// The forward half of the 3x3x3 neighborhood, excluding the cell itself.
+	// The offsets (dx,dy,dz) are those that are lexicographically positive
+	// when compared in (dz,dy,dx) order.
+	static std::array<std::array<int32_t, 3>, 13> const neighbor =
+	{ {
+		{ +1,  0,  0 },
+		{ -1, +1,  0 }, {  0, +1,  0 }, { +1, +1,  0 },
+		{ -1, -1, +1 }, {  0, -1, +1 }, { +1, -1, +1 },
+		{ -1,  0, +1 }, {  0,  0, +1 }, { +1,  0, +1 },
+		{ -1, +1, +1 }, {  0, +1, +1 }, { +1, +1, +1 }
+	} };
+
+	int32_t const nx = static_cast<int32_t>(mCellsPerDimension[0]);
+	int32_t const ny = static_cast<int32_t>(mCellsPerDimension[1]);
+	int32_t const nz = static_cast<int32_t>(mCellsPerDimension[2]);
+	for (size_t c0 = cBegin; c0 < cEnd; ++c0)
+	{
+		size_t begin0 = mCellStart[c0], end0 = mCellStart[c0 + 1];
+		if (begin0 == end0)
+		{
+			continue;
+		}
+
+		int32_t const x = static_cast<int32_t>(c0 % mCellsPerDimension[0]);
+		int32_t const y = static_cast<int32_t>((c0 / mCellsPerDimension[0]) % mCellsPerDimension[1]);
+		int32_t const z = static_cast<int32_t>(c0 / (mCellsPerDimension[0] * mCellsPerDimension[1]));
+
+		// Pairs within the cell.
+		for (size_t j0 = begin0; j0 + 1 < end0; ++j0)
+		{
+			for (size_t j1 = j0 + 1; j1 < end0; ++j1)
+			{
+				pairs.emplace_back(mSorted[j0], mSorted[j1]);
+			}
+		}
+
+		// Pairs with the forward neighbors.
+		for (auto const& offset : neighbor)
+		{
+			int32_t x1 = x + offset[0];
+			int32_t y1 = y + offset[1];
+			int32_t z1 = z + offset[2];
+			if (x1 < 0 || x1 >= nx || y1 < 0 || y1 >= ny || z1 < 0 || z1 >= nz)
+			{
+				continue;
+			}
+
+			size_t c1 = static_cast<size_t>(x1 + nx * (y1 + ny * z1));
+			size_t begin1 = mCellStart[c1], end1 = mCellStart[c1 + 1];
+			for (size_t j0 = begin0; j0 < end0; ++j0)
+			{
+				size_t i0 = mSorted[j0];
+				for (size_t j1 = begin1; j1 < end1; ++j1)
+				{
+					size_t i1 = mSorted[j1];
+					if (i0 < i1)
+					{
+						pairs.emplace_back(i0, i1);
+					}
+					else
+					{
+						pairs.emplace_back(i1, i0);
+					}
+				}
+			}
+		}
+	}
+}
+
+template class UniformGrid<float>;
+template class UniformGrid<double>;
@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Vector.h"
+#include "WorkerTeam.h"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+using namespace Vector_GM;
+
+// A uniform-grid broadphase for spheres in an axis-aligned region. The cell
+// size is at least the diameter of the largest sphere, so two spheres can
+// overlap only when their centers are in the same cell or in neighboring
+// cells. Each sphere is binned by its center using a counting sort, which
+// makes the cell contents contiguous in memory. Each cell is then paired
+// with itself and with the 13 neighbors in its "forward" half of the 3x3x3
+// neighborhood, so every candidate pair is generated exactly once.
+//
+// Centers outside the region are clamped to the boundary cells. Clamping is
+// monotonic, so the cell indices of two nearby clamped centers still differ
+// by at most one in each dimension and no overlapping pair is missed.
+
+template <typename Real>
+class UniformGrid
+{
+public:
+	UniformGrid();
+
+	// The region is [regionMin,regionMax]. The cell size must be positive;
+	// for correctness it must be at least twice the maximum sphere radius.
+	// The number of cells in each dimension is chosen so that the actual
+	// cell dimensions are no smaller than cellSize.
+	void Initialize(Vector3<Real> const& regionMin,
+		Vector3<Real> const& regionMax, Real cellSize);
+
+	inline bool IsInitialized() const
+	{
+		return mNumCells > 0;
+	}
+
+	inline std::array<size_t, 3> const& GetNumCells() const
+	{
+		return mCellsPerDimension;
+	}
+
+	// Bin the sphere centers and compute the candidate pairs (i0,i1) with
+	// i0 < i1. Without a team the pairs are sorted lexicographically so
+	// that the narrowphase processes them in the same order as an all-pairs
+	// loop. With a team the cells are partitioned into ranges that are
+	// paired by the workers. The pairs are then in cell order, not sorted,
+	// but the order does not depend on the number of workers.
+	void ComputePairs(std::vector<Vector3<Real>> const& centers,
+		std::vector<std::pair<size_t, size_t>>& pairs, WorkerTeam* team = nullptr);
+
+	// Bin the sphere centers without computing pairs. ComputePairs also
+	// bins the centers.
+	void Bin(std::vector<Vector3<Real>> const& centers);
+
+	// Append the spheres of the last binning whose cells overlap the box
+	// [boxMin,boxMax], in cell order. The box is clamped to the region as
+	// the centers are, so every sphere whose center is in the box is
+	// found. The caller enlarges the box by the sphere radii.
+	void Query(Vector3<Real> const& boxMin, Vector3<Real> const& boxMax,
+		std::vector<size_t>& spheres) const;
+
+private:
+	// The cell coordinate of the number in dimension d, clamped to the
+	// grid.
+	size_t GetCellCoordinate(Real value, int32_t d) const;
+
+	size_t GetCellIndex(Vector3<Real> const& center) const;
+
+	// Append the pairs of the cells c0 with cBegin <= c0 < cEnd.
+	void AppendPairs(size_t cBegin, size_t cEnd,
+		std::vector<std::pair<size_t, size_t>>& pairs) const;
+
+	Vector3<Real> mRegionMin;
+	Vector3<Real> mInvCellSize;
+	std::array<size_t, 3> mCellsPerDimension;
+	size_t mNumCells;
+
+	// Counting-sort storage, reused across calls to avoid allocations.
+	// The spheres in cell c are mSorted[mCellStart[c]] through
+	// mSorted[mCellStart[c + 1] - 1].
+	std::vector<size_t> mCellOfSphere;
+	std::vector<size_t> mCellStart;
+	std::vector<size_t> mSorted;
+
+	// Per-worker pairs for a team.
+	std::vector<std::vector<std::pair<size_t, size_t>>> mThreadPairs;
+};
@@ -2,6 +2,7 @@
 
 #include "Constants.h"
 #include "Exceptions.h"
+#include "SmallVector.h"
 #include <algorithm>
 #include <array>
 #include <cmath>
@@ -20,6 +21,12 @@ namespace Vector_GM
 		using value_type = T;
 		static size_t constexpr N = Dimension;
 	};
+
+	// The tag for constructing a fixed-size vector whose elements are not
+	// initialized, for example Vector<T, N> result(uninitialized). Use it
+	// only when every element is assigned before it is read.
+	struct UninitializedTag {};
+	inline constexpr UninitializedTag uninitialized{};
 }
 
 // Implementation for vectors whose sizes are known at compile time.
@@ -43,6 +50,15 @@ namespace Vector_GM
 			fill(C_<T>(0));
 		}
 
+		// The elements of the vector are not initialized. This avoids
+		// zero-filling temporaries whose elements are all assigned.
+		explicit Vector(UninitializedTag)
+		{
+			static_assert(
+				N > 0,
+				"The dimension must be positive.");
+		}
+
 		// Create a vector from an initializer list with N elements.
 		Vector(std::initializer_list<T> const& elements)
 			:
@@ -87,12 +103,12 @@ namespace Vector_GM
 
 		~Vector() = default;
 
-		// Copy semantics.
+		// Copy semantics. The container is copied directly rather than
+		// zero-filled and then assigned.
 		Vector(Vector const& other)
 			:
-			mContainer{}
+			mContainer(other.mContainer)
 		{
-			*this = other;
 		}
 
 		Vector& operator=(Vector const& other)
@@ -104,9 +120,8 @@ namespace Vector_GM
 		// Move semantics.
 		Vector(Vector&& other) noexcept
 			:
-			mContainer{}
+			mContainer(std::move(other.mContainer))
 		{
-			*this = std::move(other);
 		}
 
 		Vector& operator=(Vector&& other) noexcept
@@ -170,9 +185,35 @@ namespace Vector_GM
 	};
 }
 
+// SIMD kernels for the operations on fixed-size vectors. The primary
+// template is not supported; VectorSIMD.h specializes it for some types
+// when GTL_USE_VECTOR_SIMD is defined.
+namespace Vector_GM
+{
+	template <typename T, size_t N>
+	struct VectorSIMD
+	{
+		static bool constexpr supported = false;
+	};
+}
+
+#if defined(GTL_USE_VECTOR_SIMD)
+#include "VectorSIMD.h"
+#endif
+
 // Implementation for vectors whose sizes are known only at run time.
 namespace Vector_GM
 {
+	// The number of elements of a Vector<T> that are stored inside the
+	// object. Vectors with at most this many elements do not allocate;
+	// larger vectors store their elements on the heap. Specialize the
+	// template to choose a different capacity for a type T.
+	template <typename T>
+	struct VectorInlineCapacity
+	{
+		static size_t constexpr value = 8;
+	};
+
 	template <typename T>
 	class Vector<T> : public VectorTraits<T, 0>
 	{
@@ -191,24 +232,22 @@ namespace Vector_GM
 		// causes the default constructor to be called, not this constructor.
 		Vector(std::initializer_list<T> const& elements)
 			:
-			mContainer(elements.size())
+			mContainer(elements.begin(), elements.end())
 		{
-			std::copy(elements.begin(), elements.end(), mContainer.begin());
 		}
 
 		// Create a vector from a std::array.
 		template <size_t N>
 		Vector(std::array<T, N> const& elements)
 			:
-			mContainer(elements.size())
+			mContainer(elements.begin(), elements.end())
 		{
-			std::copy(elements.begin(), elements.end(), mContainer.begin());
 		}
 
 		// Create a vector from a std::vector.
 		Vector(std::vector<T> const& elements)
 			:
-			mContainer(elements)
+			mContainer(elements.begin(), elements.end())
 		{
 		}
 
@@ -221,12 +260,12 @@ namespace Vector_GM
 		~Vector() = default;
 
 
-		// Copy semantics.
+		// Copy semantics. The container is copy-constructed directly, so
+		// the elements are written once.
 		Vector(Vector const& other)
 			:
-			mContainer{}
+			mContainer(other.mContainer)
 		{
-			*this = other;
 		}
 
 		Vector& operator=(Vector const& other)
@@ -235,12 +274,11 @@ namespace Vector_GM
 			return *this;
 		}
 
-		// Move semantics.
+		// Move semantics. The container takes over the storage of other.
 		Vector(Vector&& other) noexcept
 			:
-			mContainer{}
+			mContainer(std::move(other.mContainer))
 		{
-			*this = std::move(other);
 		}
 
 		Vector& operator=(Vector&& other) noexcept
@@ -298,7 +336,7 @@ namespace Vector_GM
 		}
 
 	private:
-		std::vector<T> mContainer;
+		SmallVector<T, VectorInlineCapacity<T>::value> mContainer;
 
 		friend class UnitTestVector;
 	};
@@ -457,10 +495,18 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator-(Vector<T, N> const& v)
 	{
-		Vector<T, N> result{};
-		for (size_t i = 0; i < N; ++i)
+		Vector<T, N> result(uninitialized);
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] = -v[i];
+			using SIMD = VectorSIMD<T, N>;
+			SIMD::Store(SIMD::Negate(SIMD::Load(v)), result);
+		}
+		else
+		{
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] = -v[i];
+			}
 		}
 		return result;
 	}
@@ -469,20 +515,38 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator+(Vector<T, N> const& v0, Vector<T, N> const& v1)
 	{
-		Vector<T, N> result = v0;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] += v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Add(SIMD::Load(v0), SIMD::Load(v1)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v0;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] += v1[i];
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
 	Vector<T, N>& operator+=(Vector<T, N>& v0, Vector<T, N> const& v1)
 	{
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			v0[i] += v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			SIMD::Store(SIMD::Add(SIMD::Load(v0), SIMD::Load(v1)), v0);
+		}
+		else
+		{
+			for (size_t i = 0; i < N; ++i)
+			{
+				v0[i] += v1[i];
+			}
 		}
 		return v0;
 	}
@@ -490,20 +554,38 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator-(Vector<T, N> const& v0, Vector<T, N> const& v1)
 	{
-		Vector<T, N> result = v0;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] -= v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Sub(SIMD::Load(v0), SIMD::Load(v1)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v0;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] -= v1[i];
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
 	Vector<T, N>& operator-=(Vector<T, N>& v0, Vector<T, N> const& v1)
 	{
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			v0[i] -= v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			SIMD::Store(SIMD::Sub(SIMD::Load(v0), SIMD::Load(v1)), v0);
+		}
+		else
+		{
+			for (size_t i = 0; i < N; ++i)
+			{
+				v0[i] -= v1[i];
+			}
 		}
 		return v0;
 	}
@@ -511,23 +593,43 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator*(Vector<T, N> const& v, T const& scalar)
 	{
-		Vector<T, N> result = v;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] *= scalar;
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Mul(SIMD::Load(v), SIMD::Broadcast(scalar)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] *= scalar;
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
 	Vector<T, N> operator*(T const& scalar, Vector<T, N> const& v)
 	{
-		Vector<T, N> result = v;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] *= scalar;
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Mul(SIMD::Load(v), SIMD::Broadcast(scalar)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] *= scalar;
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
@@ -540,12 +642,22 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator/(Vector<T, N> const& v, T const& scalar)
 	{
-		Vector<T, N> result = v;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] /= scalar;
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Div(SIMD::Load(v), SIMD::Broadcast(scalar)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] /= scalar;
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
@@ -559,20 +671,38 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator*(Vector<T, N> const& v0, Vector<T, N> const& v1)
 	{
-		Vector<T, N> result = v0;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] *= v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Mul(SIMD::Load(v0), SIMD::Load(v1)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v0;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] *= v1[i];
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
 	Vector<T, N>& operator*=(Vector<T, N>& v0, Vector<T, N> const& v1)
 	{
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			v0[i] *= v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			SIMD::Store(SIMD::Mul(SIMD::Load(v0), SIMD::Load(v1)), v0);
+		}
+		else
+		{
+			for (size_t i = 0; i < N; ++i)
+			{
+				v0[i] *= v1[i];
+			}
 		}
 		return v0;
 	}
@@ -580,20 +710,38 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N> operator/(Vector<T, N> const& v0, Vector<T, N> const& v1)
 	{
-		Vector<T, N> result = v0;
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			result[i] /= v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			Vector<T, N> result(uninitialized);
+			SIMD::Store(SIMD::Div(SIMD::Load(v0), SIMD::Load(v1)), result);
+			return result;
+		}
+		else
+		{
+			Vector<T, N> result = v0;
+			for (size_t i = 0; i < N; ++i)
+			{
+				result[i] /= v1[i];
+			}
+			return result;
 		}
-		return result;
 	}
 
 	template <typename T, size_t N>
 	Vector<T, N>& operator/=(Vector<T, N>& v0, Vector<T, N> const& v1)
 	{
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			v0[i] /= v1[i];
+			using SIMD = VectorSIMD<T, N>;
+			SIMD::Store(SIMD::Div(SIMD::Load(v0), SIMD::Load(v1)), v0);
+		}
+		else
+		{
+			for (size_t i = 0; i < N; ++i)
+			{
+				v0[i] /= v1[i];
+			}
 		}
 		return v0;
 	}
@@ -602,12 +750,19 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	T Dot(Vector<T, N> const& v0, Vector<T, N> const& v1)
 	{
-		T dot = C_<T>(0);
-		for (size_t i = 0; i < N; ++i)
+		if constexpr (VectorSIMD<T, N>::supported)
 		{
-			dot += v0[i] * v1[i];
+			return VectorSIMD<T, N>::Dot(v0, v1);
+		}
+		else
+		{
+			T dot = C_<T>(0);
+			for (size_t i = 0; i < N; ++i)
+			{
+				dot += v0[i] * v1[i];
+			}
+			return dot;
 		}
-		return dot;
 	}
 
 	// Compute the length of a vector.
@@ -781,7 +936,7 @@ namespace Vector_GM
 	template <typename T, size_t N>
 	Vector<T, N + 1> HLift(Vector<T, N> const& v, T const& last)
 	{
-		Vector<T, N + 1> result{};
+		Vector<T, N + 1> result(uninitialized);
 		for (size_t i = 0; i < N; ++i)
 		{
 			result[i] = v[i];
@@ -798,7 +953,7 @@ namespace Vector_GM
 			N > 1,
 			"Invalid dimension for a projection.");
 
-		Vector<T, N - 1> result{};
+		Vector<T, N - 1> result(uninitialized);
 		for (size_t i = 0; i < N - 1; ++i)
 		{
 			result[i] = v[i];
@@ -816,7 +971,7 @@ namespace Vector_GM
 			inject <= N,
 			"Invalid index.");
 
-		Vector<T, N + 1> result{};
+		Vector<T, N + 1> result(uninitialized);
 		size_t i{};
 		for (i = 0; i < inject; ++i)
 		{
@@ -845,7 +1000,7 @@ namespace Vector_GM
 			reject < N,
 			"Invalid index.");
 
-		Vector<T, N - 1> result{};
+		Vector<T, N - 1> result(uninitialized);
 		for (size_t i = 0, j = 0; i < N - 1; ++i, ++j)
 		{
 			if (j == reject)
@@ -0,0 +1,435 @@
+#pragma once
+
+// SIMD kernels for the element-wise operations and the dot product of
+// Vector<float, 4>, Vector<double, 3> and Vector<double, 4>. The file is
+// included by Vector.h when GTL_USE_VECTOR_SIMD is defined; otherwise the
+// generic loops are used for all types. The kernels are selected in the
+// Vector.h functions with 'if constexpr (VectorSIMD<T, N>::supported)',
+// so the public interface does not change.
+//
+// The vectors keep their std::array storage. Changing the alignment or
+// padding Vector<T, 3> to 4 elements would change the layout of the
+// vertex buffers and of arrays of vectors, so the kernels use unaligned
+// loads and stores. The third element of Vector<double, 3> is processed
+// with scalar instructions, so no arithmetic is done on lanes outside the
+// vector and no floating-point exceptions are raised for them.
+//
+// Each lane performs the IEEE operation of the generic loop, and the dot
+// product multiplies in SIMD registers but adds the products in the order
+// of the generic loop, starting with 0. The results are therefore the
+// same as those of the generic code, except possibly for the sign and
+// payload of NaN results, provided the compiler does not contract a*b+c
+// into fused multiply-adds in the generic code (MSVC /fp:precise, or
+// -ffp-contract=off for GCC and Clang).
+//
+// Supported instruction sets: SSE2 (all x64 targets), AVX for
+// Vector<double, 4> when __AVX__ is defined, and NEON on AArch64. Other
+// targets use the generic loops.
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define GTL_VECTOR_SIMD_SSE2
+#include <emmintrin.h>
+#if defined(__AVX__)
+#define GTL_VECTOR_SIMD_AVX
+#include <immintrin.h>
+#endif
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#define GTL_VECTOR_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(GTL_VECTOR_SIMD_SSE2) || defined(GTL_VECTOR_SIMD_NEON)
+
+namespace Vector_GM
+{
+	// Two doubles in one register. This is the building block of the
+	// Vector<double, 3> and Vector<double, 4> kernels.
+	struct VectorSIMDDouble2
+	{
+#if defined(GTL_VECTOR_SIMD_SSE2)
+		using Register = __m128d;
+
+		inline static Register Load(double const* p)
+		{
+			return _mm_loadu_pd(p);
+		}
+
+		inline static void Store(Register r, double* p)
+		{
+			_mm_storeu_pd(p, r);
+		}
+
+		inline static Register Broadcast(double s)
+		{
+			return _mm_set1_pd(s);
+		}
+
+		inline static Register Add(Register a, Register b)
+		{
+			return _mm_add_pd(a, b);
+		}
+
+		inline static Register Sub(Register a, Register b)
+		{
+			return _mm_sub_pd(a, b);
+		}
+
+		inline static Register Mul(Register a, Register b)
+		{
+			return _mm_mul_pd(a, b);
+		}
+
+		inline static Register Div(Register a, Register b)
+		{
+			return _mm_div_pd(a, b);
+		}
+
+		// Flip the sign bits, which is what scalar negation does.
+		inline static Register Negate(Register a)
+		{
+			return _mm_xor_pd(a, _mm_set1_pd(-0.0));
+		}
+#else
+		using Register = float64x2_t;
+
+		inline static Register Load(double const* p)
+		{
+			return vld1q_f64(p);
+		}
+
+		inline static void Store(Register r, double* p)
+		{
+			vst1q_f64(p, r);
+		}
+
+		inline static Register Broadcast(double s)
+		{
+			return vdupq_n_f64(s);
+		}
+
+		inline static Register Add(Register a, Register b)
+		{
+			return vaddq_f64(a, b);
+		}
+
+		inline static Register Sub(Register a, Register b)
+		{
+			return vsubq_f64(a, b);
+		}
+
+		inline static Register Mul(Register a, Register b)
+		{
+			return vmulq_f64(a, b);
+		}
+
+		inline static Register Div(Register a, Register b)
+		{
+			return vdivq_f64(a, b);
+		}
+
+		inline static Register Negate(Register a)
+		{
+			return vnegq_f64(a);
+		}
+#endif
+	};
+
+	template <>
+	struct VectorSIMD<float, 4>
+	{
+		static bool constexpr supported = true;
+
+#if defined(GTL_VECTOR_SIMD_SSE2)
+		using Register = __m128;
+
+		inline static Register Load(Vector<float, 4> const& v)
+		{
+			return _mm_loadu_ps(v.data());
+		}
+
+		inline static void Store(Register r, Vector<float, 4>& v)
+		{
+			_mm_storeu_ps(v.data(), r);
+		}
+
+		inline static Register Broadcast(float s)
+		{
+			return _mm_set1_ps(s);
+		}
+
+		inline static Register Add(Register a, Register b)
+		{
+			return _mm_add_ps(a, b);
+		}
+
+		inline static Register Sub(Register a, Register b)
+		{
+			return _mm_sub_ps(a, b);
+		}
+
+		inline static Register Mul(Register a, Register b)
+		{
+			return _mm_mul_ps(a, b);
+		}
+
+		inline static Register Div(Register a, Register b)
+		{
+			return _mm_div_ps(a, b);
+		}
+
+		inline static Register Negate(Register a)
+		{
+			return _mm_xor_ps(a, _mm_set1_ps(-0.0f));
+		}
+#else
+		using Register = float32x4_t;
+
+		inline static Register Load(Vector<float, 4> const& v)
+		{
+			return vld1q_f32(v.data());
+		}
+
+		inline static void Store(Register r, Vector<float, 4>& v)
+		{
+			vst1q_f32(v.data(), r);
+		}
+
+		inline static Register Broadcast(float s)
+		{
+			return vdupq_n_f32(s);
+		}
+
+		inline static Register Add(Register a, Register b)
+		{
+			return vaddq_f32(a, b);
+		}
+
+		inline static Register Sub(Register a, Register b)
+		{
+			return vsubq_f32(a, b);
+		}
+
+		inline static Register Mul(Register a, Register b)
+		{
+			return vmulq_f32(a, b);
+		}
+
+		inline static Register Div(Register a, Register b)
+		{
+			return vdivq_f32(a, b);
+		}
+
+		inline static Register Negate(Register a)
+		{
+			return vnegq_f32(a);
+		}
+#endif
+
+		inline static float Dot(Vector<float, 4> const& v0, Vector<float, 4> const& v1)
+		{
+			alignas(16) float product[4];
+#if defined(GTL_VECTOR_SIMD_SSE2)
+			_mm_store_ps(product, Mul(Load(v0), Load(v1)));
+#else
+			vst1q_f32(product, Mul(Load(v0), Load(v1)));
+#endif
+			float dot = 0.0f;
+			dot += product[0];
+			dot += product[1];
+			dot += product[2];
+			dot += product[3];
+			return dot;
+		}
+	};
+
+	template <>
+	struct VectorSIMD<double, 3>
+	{
+		static bool constexpr supported = true;
+
+		// Elements 0 and 1 are in a register, element 2 is a scalar.
+		struct Register
+		{
+			VectorSIMDDouble2::Register xy;
+			double z;
+		};
+
+		using D2 = VectorSIMDDouble2;
+
+		inline static Register Load(Vector<double, 3> const& v)
+		{
+			return Register{ D2::Load(v.data()), v[2] };
+		}
+
+		inline static void Store(Register const& r, Vector<double, 3>& v)
+		{
+			D2::Store(r.xy, v.data());
+			v[2] = r.z;
+		}
+
+		inline static Register Broadcast(double s)
+		{
+			return Register{ D2::Broadcast(s), s };
+		}
+
+		inline static Register Add(Register const& a, Register const& b)
+		{
+			return Register{ D2::Add(a.xy, b.xy), a.z + b.z };
+		}
+
+		inline static Register Sub(Register const& a, Register const& b)
+		{
+			return Register{ D2::Sub(a.xy, b.xy), a.z - b.z };
+		}
+
+		inline static Register Mul(Register const& a, Register const& b)
+		{
+			return Register{ D2::Mul(a.xy, b.xy), a.z * b.z };
+		}
+
+		inline static Register Div(Register const& a, Register const& b)
+		{
+			return Register{ D2::Div(a.xy, b.xy), a.z / b.z };
+		}
+
+		inline static Register Negate(Register const& a)
+		{
+			return Register{ D2::Negate(a.xy), -a.z };
+		}
+
+		inline static double Dot(Vector<double, 3> const& v0, Vector<double, 3> const& v1)
+		{
+			alignas(16) double product[2];
+			D2::Store(D2::Mul(D2::Load(v0.data()), D2::Load(v1.data())), product);
+			double dot = 0.0;
+			dot += product[0];
+			dot += product[1];
+			dot += v0[2] * v1[2];
+			return dot;
+		}
+	};
+
+	template <>
+	struct VectorSIMD<double, 4>
+	{
+		static bool constexpr supported = true;
+
+#if defined(GTL_VECTOR_SIMD_AVX)
+		using Register = __m256d;
+
+		inline static Register Load(Vector<double, 4> const& v)
+		{
+			return _mm256_loadu_pd(v.data());
+		}
+
+		inline static void Store(Register r, Vector<double, 4>& v)
+		{
+			_mm256_storeu_pd(v.data(), r);
+		}
+
+		inline static Register Broadcast(double s)
+		{
+			return _mm256_set1_pd(s);
+		}
+
+		inline static Register Add(Register a, Register b)
+		{
+			return _mm256_add_pd(a, b);
+		}
+
+		inline static Register Sub(Register a, Register b)
+		{
+			return _mm256_sub_pd(a, b);
+		}
+
+		inline static Register Mul(Register a, Register b)
+		{
+			return _mm256_mul_pd(a, b);
+		}
+
+		inline static Register Div(Register a, Register b)
+		{
+			return _mm256_div_pd(a, b);
+		}
+
+		inline static Register Negate(Register a)
+		{
+			return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));
+		}
+
+		inline static void StoreProduct(Register r, double* product)
+		{
+			_mm256_storeu_pd(product, r);
+		}
+#else
+		// Elements 0 and 1 are in lo, elements 2 and 3 are in hi.
+		struct Register
+		{
+			VectorSIMDDouble2::Register lo, hi;
+		};
+
+		using D2 = VectorSIMDDouble2;
+
+		inline static Register Load(Vector<double, 4> const& v)
+		{
+			return Register{ D2::Load(v.data()), D2::Load(v.data() + 2) };
+		}
+
+		inline static void Store(Register const& r, Vector<double, 4>& v)
+		{
+			D2::Store(r.lo, v.data());
+			D2::Store(r.hi, v.data() + 2);
+		}
+
+		inline static Register Broadcast(double s)
+		{
+			return Register{ D2::Broadcast(s), D2::Broadcast(s) };
+		}
+
+		inline static Register Add(Register const& a, Register const& b)
+		{
+			return Register{ D2::Add(a.lo, b.lo), D2::Add(a.hi, b.hi) };
+		}
+
+		inline static Register Sub(Register const& a, Register const& b)
+		{
+			return Register{ D2::Sub(a.lo, b.lo), D2::Sub(a.hi, b.hi) };
+		}
+
+		inline static Register Mul(Register const& a, Register const& b)
+		{
+			return Register{ D2::Mul(a.lo, b.lo), D2::Mul(a.hi, b.hi) };
+		}
+
+		inline static Register Div(Register const& a, Register const& b)
+		{
+			return Register{ D2::Div(a.lo, b.lo), D2::Div(a.hi, b.hi) };
+		}
+
+		inline static Register Negate(Register const& a)
+		{
+			return Register{ D2::Negate(a.lo), D2::Negate(a.hi) };
+		}
+
+		inline static void StoreProduct(Register const& r, double* product)
+		{
+			D2::Store(r.lo, product);
+			D2::Store(r.hi, product + 2);
+		}
+#endif
+
+		inline static double Dot(Vector<double, 4> const& v0, Vector<double, 4> const& v1)
+		{
+			double product[4];
+			StoreProduct(Mul(Load(v0), Load(v1)), product);
+			double dot = 0.0;
+			dot += product[0];
+			dot += product[1];
+			dot += product[2];
+			dot += product[3];
+			return dot;
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,116 @@
+#include "WorkerTeam.h"
+
+WorkerTeam::WorkerTeam(size_t numWorkers, NumaTopology const* topology,
+	std::vector<size_t> const& workerNodes)
+	:
+	mMutex{},
+	mStart{},
+	mDone{},
+	mGeneration(0),
+	mRemaining(0),
+	mStop(false),
+	mInvoke(nullptr),
+	mFunction(nullptr),
+	mBarrierCount(0),
+	mBarrierPhase(0),
+	mWorkers{}
+{
+	mWorkers.reserve(numWorkers);
+	for (size_t t = 0; t < numWorkers; ++t)
+	{
+		if (topology)
+		{
+			size_t node = workerNodes[t];
+			mWorkers.emplace_back([this, t, topology, node]()
+			{
+				topology->PinThread(node);
+				WorkerLoop(t);
+			});
+		}
+		else
+		{
+			mWorkers.emplace_back([this, t]() { WorkerLoop(t); });
+		}
+	}
+}
+
+WorkerTeam::~WorkerTeam()
+{
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mStop = true;
+	}
+	mStart.notify_all();
+	for (auto& worker : mWorkers)
+	{
+		worker.join();
+	}
+}
+
+void WorkerTeam::Dispatch(void (*invoke)(void const*, size_t), void const* function)
+{
+	if (mWorkers.empty())
+	{
+		return;
+	}
+
+	std::unique_lock<std::mutex> lock(mMutex);
+	mInvoke = invoke;
+	mFunction = function;
+	mRemaining = mWorkers.size();
+	++mGeneration;
+	mStart.notify_all();
+	mDone.wait(lock, [this]() { return mRemaining == 0; });
+}
+
+void WorkerTeam::Barrier()
+{
+	// The phase is read before the arrival is counted, so the last worker
+	// cannot release the others before they have read it.
+	size_t const numWorkers = mWorkers.size();
+	size_t const phase = mBarrierPhase.load(std::memory_order_acquire);
+	if (mBarrierCount.fetch_add(1, std::memory_order_acq_rel) + 1 == numWorkers)
+	{
+		mBarrierCount.store(0, std::memory_order_relaxed);
+		mBarrierPhase.store(phase + 1, std::memory_order_release);
+		return;
+	}
+
+	size_t constexpr maxSpins = 1024;
+	for (size_t spin = 0; mBarrierPhase.load(std::memory_order_acquire) == phase; ++spin)
+	{
+		if (spin >= maxSpins)
+		{
+			std::this_thread::yield();
+		}
+	}
+}
+
+void WorkerTeam::WorkerLoop(size_t t)
+{
+	size_t generation = 0;
+	for (;;)
+	{
+		void (*invoke)(void const*, size_t) = nullptr;
+		void const* function = nullptr;
+		{
+			std::unique_lock<std::mutex> lock(mMutex);
+			mStart.wait(lock, [this, generation]() { return mStop || mGeneration != generation; });
+			if (mStop)
+			{
+				return;
+			}
+			generation = mGeneration;
+			invoke = mInvoke;
+			function = mFunction;
+		}
+
+		invoke(function, t);
+
+		std::lock_guard<std::mutex> lock(mMutex);
+		if (--mRemaining == 0)
+		{
+			mDone.notify_one();
+		}
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include "NumaTopology.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed team of persistent worker threads for the fork-join phases of a
+// PhysicsModule tick. Run(function) wakes the workers, calls function(t) on
+// worker t for 0 <= t < GetNumWorkers() and returns after every worker has
+// returned, so a phase costs two synchronizations instead of the creation
+// and the join of a thread per worker. The calling thread waits and does
+// not run any part of the function.
+//
+// Unlike the tasks of gte::TaskScheduler, the calls of one Run execute
+// concurrently on distinct threads, so they may synchronize with each other
+// through Barrier(). Idle workers block on a condition variable between
+// calls of Run.
+
+class WorkerTeam
+{
+public:
+	// Start the workers. For a topology, worker t pins itself once to node
+	// workerNodes[t] when it starts, so it stays on that node for all the
+	// calls of Run. The destructor stops and joins the workers.
+	WorkerTeam(size_t numWorkers, NumaTopology const* topology = nullptr,
+		std::vector<size_t> const& workerNodes = {});
+	~WorkerTeam();
+
+	WorkerTeam(WorkerTeam const&) = delete;
+	WorkerTeam& operator=(WorkerTeam const&) = delete;
+
+	inline size_t GetNumWorkers() const
+	{
+		return mWorkers.size();
+	}
+
+	// Run function(t) on every worker t and wait for all of them. The
+	// function is not copied; it must not throw.
+	template <typename Function>
+	void Run(Function const& function)
+	{
+		Dispatch(&Invoke<Function>, &function);
+	}
+
+	// Wait until every worker has called Barrier the same number of times
+	// during the current Run. It must be called by all workers or by none.
+	void Barrier();
+
+private:
+	template <typename Function>
+	static void Invoke(void const* function, size_t t)
+	{
+		(*static_cast<Function const*>(function))(t);
+	}
+
+	void Dispatch(void (*invoke)(void const*, size_t), void const* function);
+	void WorkerLoop(size_t t);
+
+	// The current call. mGeneration is incremented by each Run and
+	// mRemaining counts the workers that have not finished it.
+	std::mutex mMutex;
+	std::condition_variable mStart, mDone;
+	size_t mGeneration, mRemaining;
+	bool mStop;
+	void (*mInvoke)(void const*, size_t);
+	void const* mFunction;
+
+	// The barrier counts the arrived workers and releases them by
+	// incrementing its phase. The workers spin briefly and then yield.
+	std::atomic<size_t> mBarrierCount;
+	std::atomic<size_t> mBarrierPhase;
+
+	std::vector<std::thread> mWorkers;
+};